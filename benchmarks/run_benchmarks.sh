@@ -1,6 +1,26 @@
 #!/bin/bash
 # mdhavers Benchmark Runner
-# Runs all benchmarks and generates comparison report
+# Runs every benchmark program through every backend and reports the matrix
+#
+# Usage: ./run_benchmarks.sh [options] [program...]
+#
+#   -r, --runs N          Timed runs per program and backend (default 10)
+#   -w, --warmup N        Untimed runs before those (default 2)
+#   -b, --backends LIST   Comma-separated backends (default: all of
+#                         interp,bytecode,llvm-O0,llvm-O1,llvm-O2,llvm-O3,js,wasm)
+#       --baseline FILE   Results to compare against (default: results/baseline.json)
+#       --threshold PCT   Median slowdown that counts as a regression (default 10)
+#       --save-baseline   Keep this run as the new baseline
+#       --no-rust         Skip the Rust reference run
+#       --counters        Also count cycles, instructions, branch and cache misses
+#                         over one more run of each cell (Linux perf_event_open,
+#                         via tools/hwcount.c)
+#
+# Programs are names from mdhavers/ (default: all of them). Set MDHAVERS and NODE
+# to use other binaries. Build steps are never timed.
+#
+# Writes results/matrix.json (one result per line, so it diffs well) and
+# results/report.md. Exits 1 if any cell regressed against the baseline.
 
 set -e
 
@@ -10,6 +30,20 @@ MDHAVERS_DIR="$SCRIPT_DIR/mdhavers"
 RUST_DIR="$SCRIPT_DIR/rust"
 EDGE_DIR="$SCRIPT_DIR/edge_cases"
 
+MDHAVERS="${MDHAVERS:-mdhavers}"
+NODE="${NODE:-node}"
+
+ALL_BACKENDS="interp,bytecode,llvm-O0,llvm-O1,llvm-O2,llvm-O3,js,wasm"
+RUNS=10
+WARMUP=2
+BACKENDS="$ALL_BACKENDS"
+BASELINE="$RESULTS_DIR/baseline.json"
+THRESHOLD=10
+SAVE_BASELINE=0
+RUN_RUST=1
+COUNTERS=0
+PROGRAMS=()
+
 # Colors
 RED='\033[0;31m'
 GREEN='\033[0;32m'
@@ -17,6 +51,39 @@ YELLOW='\033[1;33m'
 BLUE='\033[0;34m'
 NC='\033[0m'
 
+usage() {
+    sed -n '2,/^$/s/^# \{0,1\}//p' "${BASH_SOURCE[0]}"
+    exit "${1:-0}"
+}
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        -r|--runs) RUNS="$2"; shift 2 ;;
+        -w|--warmup) WARMUP="$2"; shift 2 ;;
+        -b|--backends) BACKENDS="$2"; shift 2 ;;
+        --baseline) BASELINE="$2"; shift 2 ;;
+        --threshold) THRESHOLD="$2"; shift 2 ;;
+        --save-baseline) SAVE_BASELINE=1; shift ;;
+        --no-rust) RUN_RUST=0; shift ;;
+        --counters) COUNTERS=1; shift ;;
+        -h|--help) usage 0 ;;
+        -*) echo "Unknown option: $1" >&2; usage 1 ;;
+        *) PROGRAMS+=("$1"); shift ;;
+    esac
+done
+
+if [ "$RUNS" -lt 1 ] 2>/dev/null; then
+    echo "--runs must be at least 1" >&2
+    exit 1
+fi
+
+if [ ${#PROGRAMS[@]} -eq 0 ]; then
+    for f in "$MDHAVERS_DIR"/*.braw; do
+        PROGRAMS+=("$(basename "$f" .braw)")
+    done
+fi
+IFS=',' read -r -a BACKEND_LIST <<< "$BACKENDS"
+
 echo -e "${BLUE}=======================================${NC}"
 echo -e "${BLUE}    mdhavers Benchmark Suite${NC}"
 echo -e "${BLUE}=======================================${NC}"
@@ -24,9 +91,175 @@ echo ""
 
 # Create results directory
 mkdir -p "$RESULTS_DIR"
+WORK_DIR="$(mktemp -d)"
+trap 'rm -rf "$WORK_DIR"' EXIT
 
-# Start report
+MATRIX="$RESULTS_DIR/matrix.json"
 REPORT="$RESULTS_DIR/report.md"
+CELLS="$WORK_DIR/cells.jsonl"
+: > "$CELLS"
+
+HWCOUNT="$WORK_DIR/hwcount"
+if [ "$COUNTERS" = "1" ] && ! ${CC:-cc} -O2 -o "$HWCOUNT" "$SCRIPT_DIR/tools/hwcount.c" 2> "$WORK_DIR/hwcount.log"; then
+    echo -e "${YELLOW}Cannae build tools/hwcount.c; running without counters${NC}"
+    COUNTERS=0
+fi
+
+# Milliseconds since the epoch, to the microsecond
+now_ms() {
+    local ns
+    ns=$(date +%s%N)
+    echo "${ns:0:${#ns}-6}.${ns: -6:3}"
+}
+
+# Prepare one backend's command for a program in BENCH_CMD; returns 1 if it can't be built
+prepare() {
+    local backend="$1" src="$2" out="$WORK_DIR/$3-$1"
+    case "$backend" in
+        interp) BENCH_CMD=("$MDHAVERS" run "$src") ;;
+        bytecode) BENCH_CMD=("$MDHAVERS" run --bytecode "$src") ;;
+        llvm-O[0-3])
+            "$MDHAVERS" build -O "${backend#llvm-O}" "$src" -o "$out" > "$out.log" 2>&1 || return 1
+            BENCH_CMD=("$out")
+            ;;
+        js)
+            command -v "$NODE" > /dev/null || return 1
+            "$MDHAVERS" compile "$src" -o "$out.js" > "$out.log" 2>&1 || return 1
+            BENCH_CMD=("$NODE" "$out.js")
+            ;;
+        wasm)
+            "$MDHAVERS" wasm "$src" -o "$out.wat" > "$out.log" 2>&1 || return 1
+            BENCH_CMD=("$MDHAVERS" wasm-run "$out.wat")
+            ;;
+        *) echo "Unknown backend: $backend" >&2; exit 1 ;;
+    esac
+}
+
+# median, p95 (nearest rank), mean, sample stddev, min and max of the times on stdin
+summarise() {
+    sort -n | awk '
+        { t[NR] = $1; sum += $1 }
+        END {
+            n = NR; mean = sum / n
+            for (i = 1; i <= n; i++) var += (t[i] - mean) ^ 2
+            sd = n > 1 ? sqrt(var / (n - 1)) : 0
+            med = n % 2 ? t[(n + 1) / 2] : (t[n / 2] + t[n / 2 + 1]) / 2
+            p = int(0.95 * n); if (p < 0.95 * n) p++
+            printf "%.3f %.3f %.3f %.3f %.3f %.3f\n", med, t[p], mean, sd, t[1], t[n]
+        }'
+}
+
+# Value of "key" in one of our own result lines
+field() {
+    sed -n "s/.*\"$2\": \"\{0,1\}\([^\",}]*\)\"\{0,1\}.*/\1/p" <<< "$1"
+}
+
+record() {
+    local program="$1" backend="$2" status="$3" stats="$4" counts="$5"
+    local line="{\"program\": \"$program\", \"backend\": \"$backend\", \"status\": \"$status\""
+    if [ -n "$stats" ]; then
+        read -r med p95 mean sd lo hi <<< "$stats"
+        line="$line, \"median_ms\": $med, \"p95_ms\": $p95, \"mean_ms\": $mean, \"stddev_ms\": $sd, \"min_ms\": $lo, \"max_ms\": $hi, \"runs\": $RUNS"
+    fi
+    if [ -n "$counts" ]; then
+        line="$line, \"counters\": {$(awk '{ printf "%s\"%s\": %s", (NR > 1 ? ", " : ""), $1, $2 }' "$counts")}"
+    fi
+    echo "$line}" >> "$CELLS"
+}
+
+# Count hardware events over one more run; sets COUNTS to the totals file, or empty
+count_events() {
+    COUNTS=""
+    [ "$COUNTERS" = "1" ] || return 0
+    local file="$WORK_DIR/$1-$2.counters" rc=0
+    "$HWCOUNT" -o "$file" "${BENCH_CMD[@]}" > /dev/null 2> "$file.log" || rc=$?
+    if [ "$rc" = "125" ]; then
+        echo -e "  ${YELLOW}$(head -1 "$file.log"); running without counters${NC}"
+        COUNTERS=0
+    elif [ "$rc" = "0" ]; then
+        COUNTS="$file"
+    fi
+}
+
+for program in "${PROGRAMS[@]}"; do
+    src="$MDHAVERS_DIR/${program}.braw"
+    if [ ! -f "$src" ]; then
+        echo -e "${RED}No such benchmark: $src${NC}" >&2
+        exit 1
+    fi
+    echo -e "${BLUE}Running $program...${NC}"
+
+    # Every backend must print what the interpreter prints
+    expected="$WORK_DIR/$program.expected"
+    if ! "$MDHAVERS" run "$src" > "$expected" 2>&1; then
+        echo -e "  ${RED}interpreter failed; skipping${NC}"
+        for backend in "${BACKEND_LIST[@]}"; do
+            record "$program" "$backend" "run_failed" ""
+        done
+        continue
+    fi
+
+    for backend in "${BACKEND_LIST[@]}"; do
+        printf "  %-9s " "$backend"
+        if ! prepare "$backend" "$src" "$program"; then
+            echo -e "${YELLOW}unsupported${NC}"
+            record "$program" "$backend" "unsupported" ""
+            continue
+        fi
+
+        output="$WORK_DIR/$program-$backend.out"
+        status="ok"
+        for ((i = 0; i < WARMUP || i == 0; i++)); do
+            if ! "${BENCH_CMD[@]}" > "$output" 2>&1; then
+                status="run_failed"
+                break
+            fi
+        done
+        if [ "$status" = "ok" ] && ! cmp -s "$output" "$expected"; then
+            status="mismatch"
+        fi
+        if [ "$status" != "ok" ]; then
+            echo -e "${RED}${status}${NC}"
+            record "$program" "$backend" "$status" ""
+            continue
+        fi
+
+        times="$WORK_DIR/$program-$backend.times"
+        : > "$times"
+        for ((i = 0; i < RUNS; i++)); do
+            start=$(now_ms)
+            "${BENCH_CMD[@]}" > /dev/null 2>&1 || status="run_failed"
+            end=$(now_ms)
+            awk -v s="$start" -v e="$end" 'BEGIN { printf "%.3f\n", e - s }' >> "$times"
+        done
+        if [ "$status" != "ok" ]; then
+            echo -e "${RED}${status}${NC}"
+            record "$program" "$backend" "$status" ""
+            continue
+        fi
+        stats=$(summarise < "$times")
+        read -r med p95 _ sd _ _ <<< "$stats"
+        echo -e "${GREEN}${med} ms${NC} (p95 ${p95}, sd ${sd})"
+        count_events "$program" "$backend"
+        record "$program" "$backend" "ok" "$stats" "$COUNTS"
+    done
+done
+
+# Machine-readable results
+{
+    echo "{"
+    echo "  \"generated\": \"$(date -u +%Y-%m-%dT%H:%M:%SZ)\","
+    echo "  \"host\": {\"os\": \"$(uname -s)\", \"arch\": \"$(uname -m)\", \"cpu\": \"$(grep -m1 'model name' /proc/cpuinfo 2>/dev/null | cut -d: -f2 | xargs)\"},"
+    echo "  \"commit\": \"$(git -C "$SCRIPT_DIR" rev-parse --short HEAD 2>/dev/null)\","
+    echo "  \"runs\": $RUNS,"
+    echo "  \"warmup\": $WARMUP,"
+    echo "  \"results\": ["
+    sed '$!s/$/,/; s/^/    /' "$CELLS"
+    echo "  ]"
+    echo "}"
+} > "$MATRIX"
+
+# Start report
 echo "# mdhavers Benchmark Report" > "$REPORT"
 echo "" >> "$REPORT"
 echo "Generated: $(date)" >> "$REPORT"
@@ -36,118 +269,158 @@ echo "" >> "$REPORT"
 echo "- OS: $(uname -s)" >> "$REPORT"
 echo "- Arch: $(uname -m)" >> "$REPORT"
 echo "- CPU: $(grep 'model name' /proc/cpuinfo | head -1 | cut -d: -f2 | xargs)" >> "$REPORT"
+echo "- Runs: $RUNS timed after $WARMUP warmup" >> "$REPORT"
 echo "" >> "$REPORT"
 
-# Build Rust benchmarks
-echo -e "${YELLOW}Building Rust benchmarks...${NC}"
-cd "$RUST_DIR"
-cargo build --release 2>/dev/null
-cd "$SCRIPT_DIR"
-echo -e "${GREEN}Rust benchmarks built${NC}"
-echo ""
-
-# Function to time a command
-time_cmd() {
-    local start=$(date +%s.%N)
-    "$@" > /tmp/bench_output.txt 2>&1
-    local end=$(date +%s.%N)
-    echo "$end - $start" | bc
-}
-
-# Benchmark tests
-declare -a BENCHMARKS=("fibonacci" "factorial" "gcd" "primes" "quicksort" "mergesort")
-
 echo "## Benchmark Results" >> "$REPORT"
 echo "" >> "$REPORT"
-echo "| Benchmark | mdhavers (interpreter) | mdhavers (native) | Rust |" >> "$REPORT"
-echo "|-----------|----------------------|-------------------|------|" >> "$REPORT"
-
-for bench in "${BENCHMARKS[@]}"; do
-    echo -e "${BLUE}Running $bench benchmark...${NC}"
-
-    # Run mdhavers interpreter
-    echo -n "  Interpreter... "
-    mdh_interp_time=$(time_cmd mdhavers run "$MDHAVERS_DIR/${bench}.braw")
-    echo -e "${GREEN}${mdh_interp_time}s${NC}"
-
-    # Try native compilation if available
-    if mdhavers build "$MDHAVERS_DIR/${bench}.braw" -o "/tmp/bench_native_${bench}" 2>/dev/null; then
-        echo -n "  Native... "
-        mdh_native_time=$(time_cmd "/tmp/bench_native_${bench}")
-        rm -f "/tmp/bench_native_${bench}"
-        echo -e "${GREEN}${mdh_native_time}s${NC}"
-    else
-        mdh_native_time="N/A"
-        echo -e "  Native... ${YELLOW}skipped${NC}"
-    fi
+echo "Median wall time in ms, p95 in brackets." >> "$REPORT"
+echo "" >> "$REPORT"
+header="| Benchmark |"
+rule="|-----------|"
+for backend in "${BACKEND_LIST[@]}"; do
+    header="$header $backend |"
+    rule="$rule---|"
+done
+echo "$header" >> "$REPORT"
+echo "$rule" >> "$REPORT"
+for program in "${PROGRAMS[@]}"; do
+    row="| $program |"
+    while IFS= read -r line; do
+        [ "$(field "$line" program)" = "$program" ] || continue
+        status=$(field "$line" status)
+        if [ "$status" = "ok" ]; then
+            row="$row $(field "$line" median_ms) ($(field "$line" p95_ms)) |"
+        else
+            row="$row $status |"
+        fi
+    done < "$CELLS"
+    echo "$row" >> "$REPORT"
+done
+echo "" >> "$REPORT"
 
-    # Note: Rust runs its own benchmark which includes all benchmarks
-    # For individual timing, we'd need separate binaries
-    rust_time="see below"
+# Where the time goes, for cells that were counted
+if grep -q '"counters"' "$CELLS"; then
+    echo "## Hardware Counters" >> "$REPORT"
+    echo "" >> "$REPORT"
+    echo "User-space events over one extra run of each cell. IPC is instructions per cycle;" >> "$REPORT"
+    echo "MPKI is misses per thousand instructions. A high branch MPKI points at mispredicted" >> "$REPORT"
+    echo "tag checks and dispatch; a high cache MPKI at the memory traffic of boxed values." >> "$REPORT"
+    echo "" >> "$REPORT"
+    echo "| Benchmark | Backend | Cycles | Instructions | IPC | Branch miss % | Branch MPKI | Cache miss % | Cache MPKI |" >> "$REPORT"
+    echo "|-----------|---------|--------|--------------|-----|---------------|-------------|--------------|------------|" >> "$REPORT"
+    while IFS= read -r line; do
+        case "$line" in *'"counters"'*) ;; *) continue ;; esac
+        awk -v p="$(field "$line" program)" -v b="$(field "$line" backend)" \
+            -v cy="$(field "$line" cycles)" -v ins="$(field "$line" instructions)" \
+            -v br="$(field "$line" branches)" -v bm="$(field "$line" branch_misses)" \
+            -v cr="$(field "$line" cache_references)" -v cm="$(field "$line" cache_misses)" '
+            function ratio(a, b, scale) { return b > 0 ? sprintf("%.2f", a / b * scale) : "-" }
+            BEGIN {
+                printf "| %s | %s | %.0f | %.0f | %s | %s | %s | %s | %s |\n", p, b, cy, ins,
+                    ratio(ins, cy, 1), ratio(bm, br, 100), ratio(bm, ins, 1000),
+                    ratio(cm, cr, 100), ratio(cm, ins, 1000)
+            }' >> "$REPORT"
+    done < "$CELLS"
+    echo "" >> "$REPORT"
+fi
 
-    echo "| $bench | ${mdh_interp_time}s | ${mdh_native_time} | ${rust_time} |" >> "$REPORT"
-done
+# Regressions against the baseline
+regressions=0
+if [ -f "$BASELINE" ]; then
+    echo -e "${BLUE}Comparing against $BASELINE (threshold ${THRESHOLD}%)...${NC}"
+    echo "## Against Baseline" >> "$REPORT"
+    echo "" >> "$REPORT"
+    echo "Cells whose median moved by more than ${THRESHOLD}% fae \`$(basename "$BASELINE")\`." >> "$REPORT"
+    echo "" >> "$REPORT"
+    echo "| Benchmark | Backend | Baseline (ms) | Now (ms) | Change |" >> "$REPORT"
+    echo "|-----------|---------|---------------|----------|--------|" >> "$REPORT"
+    while IFS= read -r line; do
+        [ "$(field "$line" status)" = "ok" ] || continue
+        program=$(field "$line" program)
+        backend=$(field "$line" backend)
+        base_line=$(grep -F "\"program\": \"$program\", \"backend\": \"$backend\", \"status\": \"ok\"" "$BASELINE" || true)
+        [ -n "$base_line" ] || continue
+        base=$(field "$base_line" median_ms)
+        now=$(field "$line" median_ms)
+        verdict=$(awk -v b="$base" -v n="$now" -v t="$THRESHOLD" 'BEGIN {
+            c = b > 0 ? (n - b) / b * 100 : 0
+            kind = "same"
+            if (c > t) kind = "slower"
+            if (c < -t) kind = "faster"
+            printf "%s %+.1f\n", kind, c }')
+        read -r kind change <<< "$verdict"
+        [ "$kind" != "same" ] || continue
+        echo "| $program | $backend | $base | $now | ${change}% |" >> "$REPORT"
+        if [ "$kind" = "slower" ]; then
+            regressions=$((regressions + 1))
+            echo -e "  ${RED}$program/$backend: ${base} -> ${now} ms (${change}%)${NC}"
+        else
+            echo -e "  ${GREEN}$program/$backend: ${base} -> ${now} ms (${change}%)${NC}"
+        fi
+    done < "$CELLS"
+    echo "" >> "$REPORT"
+    echo "$regressions regression(s)." >> "$REPORT"
+    echo "" >> "$REPORT"
+fi
 
-echo "" >> "$REPORT"
+if [ "$SAVE_BASELINE" = "1" ]; then
+    cp "$MATRIX" "$BASELINE"
+    echo -e "${GREEN}Saved baseline to $BASELINE${NC}"
+fi
 
-# Run Rust benchmarks once
-echo ""
-echo -e "${BLUE}Running Rust benchmarks...${NC}"
-echo "" >> "$REPORT"
-echo "### Rust Benchmark Output" >> "$REPORT"
-echo "" >> "$REPORT"
-echo '```' >> "$REPORT"
-"$RUST_DIR/target/release/benchmark_all" 2>&1 | tee -a "$REPORT"
-echo '```' >> "$REPORT"
-echo ""
+if [ "$RUN_RUST" = "1" ]; then
+    # Build Rust benchmarks
+    echo ""
+    echo -e "${YELLOW}Building Rust benchmarks...${NC}"
+    cd "$RUST_DIR"
+    cargo build --release 2>/dev/null
+    cd "$SCRIPT_DIR"
+    echo -e "${GREEN}Rust benchmarks built${NC}"
+
+    # Run Rust benchmarks once
+    echo -e "${BLUE}Running Rust benchmarks...${NC}"
+    echo "### Rust Benchmark Output" >> "$REPORT"
+    echo "" >> "$REPORT"
+    echo '```' >> "$REPORT"
+    "$RUST_DIR/target/release/benchmark_all" 2>&1 | tee -a "$REPORT"
+    echo '```' >> "$REPORT"
+    echo "" >> "$REPORT"
+fi
 
 # Edge case tests
-echo ""
-echo -e "${BLUE}Running edge case tests...${NC}"
-echo "" >> "$REPORT"
-echo "## Edge Case Tests" >> "$REPORT"
-echo "" >> "$REPORT"
+if [ -d "$EDGE_DIR" ]; then
+    echo ""
+    echo -e "${BLUE}Running edge case tests...${NC}"
+    echo "## Edge Case Tests" >> "$REPORT"
+    echo "" >> "$REPORT"
 
-for edge_test in "$EDGE_DIR"/*.braw; do
-    test_name=$(basename "$edge_test" .braw)
-    echo -n "  Testing $test_name... "
-
-    if mdhavers run "$edge_test" > /tmp/edge_output.txt 2>&1; then
-        echo -e "${GREEN}PASS${NC}"
-        echo "- **$test_name**: PASS" >> "$REPORT"
-    else
-        echo -e "${RED}FAIL${NC}"
-        echo "- **$test_name**: FAIL" >> "$REPORT"
-        echo '  ```' >> "$REPORT"
-        head -10 /tmp/edge_output.txt >> "$REPORT"
-        echo '  ```' >> "$REPORT"
-    fi
-done
+    for edge_test in "$EDGE_DIR"/*.braw; do
+        test_name=$(basename "$edge_test" .braw)
+        echo -n "  Testing $test_name... "
 
-# Summary
-echo "" >> "$REPORT"
-echo "## Findings" >> "$REPORT"
-echo "" >> "$REPORT"
-echo "### Performance Observations" >> "$REPORT"
-echo "" >> "$REPORT"
-echo "1. **Interpreter vs Native**: Native compilation provides significant speedup for CPU-intensive algorithms" >> "$REPORT"
-echo "2. **Rust Comparison**: Rust is expectedly faster due to static typing and LLVM optimizations" >> "$REPORT"
-echo "3. **Recursive Algorithms**: Both interpreter and native handle recursion well within reasonable depths" >> "$REPORT"
-echo "" >> "$REPORT"
-echo "### Language Features Tested" >> "$REPORT"
-echo "" >> "$REPORT"
-echo "- Recursive functions" >> "$REPORT"
-echo "- List operations (shove, len, indexing)" >> "$REPORT"
-echo "- Arithmetic operators" >> "$REPORT"
-echo "- Boolean logic" >> "$REPORT"
-echo "- Loops (whiles)" >> "$REPORT"
-echo "- Conditionals (gin/ither)" >> "$REPORT"
-echo "- Variable scoping" >> "$REPORT"
-echo "" >> "$REPORT"
+        if "$MDHAVERS" run "$edge_test" > "$WORK_DIR/edge_output.txt" 2>&1; then
+            echo -e "${GREEN}PASS${NC}"
+            echo "- **$test_name**: PASS" >> "$REPORT"
+        else
+            echo -e "${RED}FAIL${NC}"
+            echo "- **$test_name**: FAIL" >> "$REPORT"
+            echo '  ```' >> "$REPORT"
+            head -10 "$WORK_DIR/edge_output.txt" >> "$REPORT"
+            echo '  ```' >> "$REPORT"
+        fi
+    done
+fi
 
 echo ""
 echo -e "${GREEN}=======================================${NC}"
 echo -e "${GREEN}    Benchmark Complete!${NC}"
 echo -e "${GREEN}=======================================${NC}"
 echo ""
+echo -e "Results saved to: ${BLUE}$MATRIX${NC}"
 echo -e "Report saved to: ${BLUE}$REPORT${NC}"
+
+if [ "$regressions" -gt 0 ]; then
+    echo -e "${RED}$regressions regression(s) against the baseline${NC}"
+    exit 1
+fi
@@ -0,0 +1,170 @@
+#!/bin/bash
+# mdhavers Startup Benchmark
+# Builds the tiny programs in startup/ natively and times them from exec to exit
+#
+# Usage: ./run_startup.sh [options] [program...]
+#
+#   -r, --runs N          Timed runs per program (default 200)
+#   -w, --warmup N        Untimed runs before those (default 10)
+#   -O LEVEL              Optimisation level to build at (default 2)
+#       --baseline FILE   Results to compare against (default: results/startup_baseline.json)
+#       --threshold PCT   Median slowdown that counts as a regression (default 10)
+#       --save-baseline   Keep this run as the new baseline
+#
+# Programs are names from startup/ (default: all of them). Set MDHAVERS to use
+# another binary. Runs are timed by tools/spawntime.c, built with $CC on the
+# fly, so the shell's own fork and `date` calls stay out of the numbers.
+#
+# Writes results/startup.json (one result per line) and prints median and p95
+# startup in microseconds next to each binary's size. Exits 1 if any program
+# got slower than the baseline by more than the threshold.
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+RESULTS_DIR="$SCRIPT_DIR/results"
+STARTUP_DIR="$SCRIPT_DIR/startup"
+
+MDHAVERS="${MDHAVERS:-mdhavers}"
+
+RUNS=200
+WARMUP=10
+OPT=2
+BASELINE="$RESULTS_DIR/startup_baseline.json"
+THRESHOLD=10
+SAVE_BASELINE=0
+PROGRAMS=()
+
+# Colors
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+BLUE='\033[0;34m'
+NC='\033[0m'
+
+usage() {
+    sed -n '2,/^$/s/^# \{0,1\}//p' "${BASH_SOURCE[0]}"
+    exit "${1:-0}"
+}
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        -r|--runs) RUNS="$2"; shift 2 ;;
+        -w|--warmup) WARMUP="$2"; shift 2 ;;
+        -O) OPT="$2"; shift 2 ;;
+        --baseline) BASELINE="$2"; shift 2 ;;
+        --threshold) THRESHOLD="$2"; shift 2 ;;
+        --save-baseline) SAVE_BASELINE=1; shift ;;
+        -h|--help) usage 0 ;;
+        -*) echo "Unknown option: $1" >&2; usage 1 ;;
+        *) PROGRAMS+=("$1"); shift ;;
+    esac
+done
+
+if [ "$RUNS" -lt 1 ] 2>/dev/null; then
+    echo "--runs must be at least 1" >&2
+    exit 1
+fi
+
+if [ ${#PROGRAMS[@]} -eq 0 ]; then
+    for f in "$STARTUP_DIR"/*.braw; do
+        PROGRAMS+=("$(basename "$f" .braw)")
+    done
+fi
+
+mkdir -p "$RESULTS_DIR"
+WORK_DIR="$(mktemp -d)"
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+RESULTS="$RESULTS_DIR/startup.json"
+CELLS="$WORK_DIR/cells.jsonl"
+: > "$CELLS"
+
+SPAWNTIME="$WORK_DIR/spawntime"
+if ! ${CC:-cc} -O2 -o "$SPAWNTIME" "$SCRIPT_DIR/tools/spawntime.c" 2> "$WORK_DIR/spawntime.log"; then
+    echo -e "${RED}Cannae build tools/spawntime.c:${NC}" >&2
+    cat "$WORK_DIR/spawntime.log" >&2
+    exit 1
+fi
+
+# Value of "key" in one of our own result lines
+field() {
+    sed -n "s/.*\"$2\": \"\{0,1\}\([^\",}]*\)\"\{0,1\}.*/\1/p" <<< "$1"
+}
+
+echo -e "${BLUE}Startup at -O$OPT, $RUNS runs after $WARMUP warmup (microseconds)${NC}"
+printf "  %-10s %10s %10s %10s %12s\n" program median p95 min size
+for program in "${PROGRAMS[@]}"; do
+    src="$STARTUP_DIR/${program}.braw"
+    if [ ! -f "$src" ]; then
+        echo -e "${RED}No such program: $src${NC}" >&2
+        exit 1
+    fi
+    out="$WORK_DIR/$program"
+    if ! "$MDHAVERS" build -O "$OPT" "$src" -o "$out" > "$out.log" 2>&1; then
+        echo -e "  $(printf '%-10s' "$program") ${YELLOW}build failed${NC}"
+        echo "{\"program\": \"$program\", \"status\": \"build_failed\"}" >> "$CELLS"
+        continue
+    fi
+    size=$(wc -c < "$out" | tr -d ' ')
+    if ! "$SPAWNTIME" -n "$RUNS" -w "$WARMUP" -o "$out.times" "$out" 2> "$out.err"; then
+        echo -e "  $(printf '%-10s' "$program") ${RED}$(head -1 "$out.err")${NC}"
+        echo "{\"program\": \"$program\", \"status\": \"run_failed\"}" >> "$CELLS"
+        continue
+    fi
+    read -r med p95 mean lo hi <<< "$(awk '{ printf "%s ", $2 }' "$out.times")"
+    printf "  %-10s %10s %10s %10s %12s\n" "$program" "$med" "$p95" "$lo" "$size"
+    echo "{\"program\": \"$program\", \"status\": \"ok\", \"median_us\": $med, \"p95_us\": $p95, \"mean_us\": $mean, \"min_us\": $lo, \"max_us\": $hi, \"size_bytes\": $size, \"runs\": $RUNS}" >> "$CELLS"
+done
+
+{
+    echo "{"
+    echo "  \"generated\": \"$(date -u +%Y-%m-%dT%H:%M:%SZ)\","
+    echo "  \"host\": {\"os\": \"$(uname -s)\", \"arch\": \"$(uname -m)\", \"cpu\": \"$(grep -m1 'model name' /proc/cpuinfo 2>/dev/null | cut -d: -f2 | xargs)\"},"
+    echo "  \"commit\": \"$(git -C "$SCRIPT_DIR" rev-parse --short HEAD 2>/dev/null)\","
+    echo "  \"opt\": $OPT,"
+    echo "  \"results\": ["
+    sed '$!s/$/,/; s/^/    /' "$CELLS"
+    echo "  ]"
+    echo "}"
+} > "$RESULTS"
+
+# Regressions against the baseline
+regressions=0
+if [ -f "$BASELINE" ]; then
+    echo -e "${BLUE}Comparing against $BASELINE (threshold ${THRESHOLD}%)...${NC}"
+    while IFS= read -r line; do
+        [ "$(field "$line" status)" = "ok" ] || continue
+        program=$(field "$line" program)
+        base_line=$(grep -F "\"program\": \"$program\", \"status\": \"ok\"" "$BASELINE" || true)
+        [ -n "$base_line" ] || continue
+        base=$(field "$base_line" median_us)
+        now=$(field "$line" median_us)
+        verdict=$(awk -v b="$base" -v n="$now" -v t="$THRESHOLD" 'BEGIN {
+            c = b > 0 ? (n - b) / b * 100 : 0
+            kind = "same"
+            if (c > t) kind = "slower"
+            if (c < -t) kind = "faster"
+            printf "%s %+.1f\n", kind, c }')
+        read -r kind change <<< "$verdict"
+        [ "$kind" != "same" ] || continue
+        if [ "$kind" = "slower" ]; then
+            regressions=$((regressions + 1))
+            echo -e "  ${RED}$program: ${base} -> ${now} us (${change}%)${NC}"
+        else
+            echo -e "  ${GREEN}$program: ${base} -> ${now} us (${change}%)${NC}"
+        fi
+    done < "$CELLS"
+fi
+
+if [ "$SAVE_BASELINE" = "1" ]; then
+    cp "$RESULTS" "$BASELINE"
+    echo -e "${GREEN}Saved baseline to $BASELINE${NC}"
+fi
+
+echo -e "Results saved to: ${BLUE}$RESULTS${NC}"
+
+if [ "$regressions" -gt 0 ]; then
+    echo -e "${RED}$regressions regression(s) against the baseline${NC}"
+    exit 1
+fi
@@ -0,0 +1,134 @@
+/**
+ * hwcount.c - Count hardware events over one run of a command
+ *
+ * A `perf stat` for the benchmark runner that needs nothing but the kernel:
+ * it opens cycles, instructions, branches, branch misses, cache references
+ * and cache misses with perf_event_open, runs the command, and writes the
+ * totals as `name value` lines. The counters are inherited by every thread
+ * and child the command starts, are armed at exec so the fork costs nothing,
+ * and count user space only, so the default perf_event_paranoid of 2 is
+ * enough. When the kernel multiplexes the counters, each total is scaled by
+ * the share of the run it was on for, as perf does.
+ *
+ * Usage: hwcount -o FILE command [args...]
+ *
+ * Exits with the command's status, or 125 if the counters can't be opened
+ * (no PMU in a VM or container, or perf_event_paranoid above 2).
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static const struct {
+    const char *name;
+    uint64_t config;
+} EVENTS[] = {
+    {"cycles", PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_COUNT_HW_INSTRUCTIONS},
+    {"branches", PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+    {"branch_misses", PERF_COUNT_HW_BRANCH_MISSES},
+    {"cache_references", PERF_COUNT_HW_CACHE_REFERENCES},
+    {"cache_misses", PERF_COUNT_HW_CACHE_MISSES},
+};
+#define N_EVENTS (sizeof(EVENTS) / sizeof(EVENTS[0]))
+
+static int open_counter(uint64_t config, pid_t pid) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4 || strcmp(argv[1], "-o") != 0) {
+        fprintf(stderr, "usage: hwcount -o FILE command [args...]\n");
+        return 2;
+    }
+    const char *out_path = argv[2];
+
+    /* The child waits on the pipe until its counters are open, then execs */
+    int go[2];
+    if (pipe(go) != 0) {
+        perror("hwcount: pipe");
+        return 125;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("hwcount: fork");
+        return 125;
+    }
+    if (pid == 0) {
+        char c;
+        close(go[1]);
+        if (read(go[0], &c, 1) != 1) _exit(125);
+        execvp(argv[3], &argv[3]);
+        fprintf(stderr, "hwcount: cannae run %s: %s\n", argv[3], strerror(errno));
+        _exit(127);
+    }
+    close(go[0]);
+
+    int fds[N_EVENTS];
+    for (size_t i = 0; i < N_EVENTS; i++) {
+        fds[i] = open_counter(EVENTS[i].config, pid);
+        if (fds[i] < 0) {
+            /* ENOENT is the kernel's way of saying the CPU has no such counter */
+            fprintf(stderr, "hwcount: cannae count %s: %s\n", EVENTS[i].name,
+                    errno == ENOENT ? "no hardware counters here" : strerror(errno));
+            kill(pid, SIGKILL);
+            waitpid(pid, NULL, 0);
+            return 125;
+        }
+    }
+    if (write(go[1], "g", 1) != 1) {
+        perror("hwcount: write");
+        return 125;
+    }
+    close(go[1]);
+
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0) {
+        perror("hwcount: waitpid");
+        return 125;
+    }
+
+    FILE *out = fopen(out_path, "w");
+    if (!out) {
+        fprintf(stderr, "hwcount: cannae write %s: %s\n", out_path, strerror(errno));
+        return 125;
+    }
+    for (size_t i = 0; i < N_EVENTS; i++) {
+        uint64_t value[3] = {0, 0, 0}; /* count, time enabled, time running */
+        if (read(fds[i], value, sizeof(value)) != (ssize_t)sizeof(value)) {
+            fprintf(stderr, "hwcount: cannae read %s\n", EVENTS[i].name);
+            fclose(out);
+            return 125;
+        }
+        double count = (double)value[0];
+        if (value[2] > 0 && value[2] < value[1]) {
+            count *= (double)value[1] / (double)value[2];
+        }
+        fprintf(out, "%s %.0f\n", EVENTS[i].name, count);
+        close(fds[i]);
+    }
+    fclose(out);
+
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return WEXITSTATUS(status);
+}
@@ -0,0 +1,121 @@
+/**
+ * spawntime.c - Time how long a command takes to start and exit
+ *
+ * The startup benchmark's timer. A shell loop round `date` adds more than a
+ * tiny binary's whole run, so this spawns the command itself with
+ * posix_spawn (stdin, stdout and stderr on /dev/null), times each run from
+ * spawn to reaped with CLOCK_MONOTONIC, and writes the median, p95 (nearest
+ * rank), mean, min and max in microseconds as `name value` lines.
+ *
+ * Usage: spawntime [-n RUNS] [-w WARMUP] -o FILE command [args...]
+ *
+ * RUNS defaults to 200 and WARMUP (untimed runs first) to 10. Exits 1 if
+ * any run fails, naming its status, and 125 if the command can't be run.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+extern char **environ;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* One run; returns its wait status, or -1 with errno set if it couldn't start */
+static int run_once(posix_spawn_file_actions_t *actions, char **argv) {
+    pid_t pid;
+    int err = posix_spawnp(&pid, argv[0], actions, NULL, argv, environ);
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return -1;
+    }
+    return status;
+}
+
+int main(int argc, char **argv) {
+    long runs = 200, warmup = 10;
+    const char *out_path = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "+n:w:o:")) != -1) {
+        switch (opt) {
+        case 'n': runs = strtol(optarg, NULL, 10); break;
+        case 'w': warmup = strtol(optarg, NULL, 10); break;
+        case 'o': out_path = optarg; break;
+        default: goto usage;
+        }
+    }
+    if (optind >= argc || !out_path || runs < 1 || warmup < 0) goto usage;
+    char **cmd = &argv[optind];
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    for (int fd = 0; fd < 3; fd++) {
+        posix_spawn_file_actions_addopen(&actions, fd, "/dev/null", fd ? O_WRONLY : O_RDONLY, 0);
+    }
+
+    double *times = malloc((size_t)runs * sizeof(double));
+    if (!times) {
+        perror("spawntime: malloc");
+        return 125;
+    }
+    for (long i = -warmup; i < runs; i++) {
+        double start = now_us();
+        int status = run_once(&actions, cmd);
+        double took = now_us() - start;
+        if (status < 0) {
+            fprintf(stderr, "spawntime: cannae run %s: %s\n", cmd[0], strerror(errno));
+            return 125;
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "spawntime: %s failed (%s %d)\n", cmd[0],
+                    WIFSIGNALED(status) ? "signal" : "exit status",
+                    WIFSIGNALED(status) ? WTERMSIG(status) : WEXITSTATUS(status));
+            return 1;
+        }
+        if (i >= 0) times[i] = took;
+    }
+    posix_spawn_file_actions_destroy(&actions);
+
+    qsort(times, (size_t)runs, sizeof(double), cmp_double);
+    double sum = 0;
+    for (long i = 0; i < runs; i++) sum += times[i];
+    double median = runs % 2 ? times[runs / 2] : (times[runs / 2 - 1] + times[runs / 2]) / 2;
+    long p95 = (long)(0.95 * (double)runs + 0.999999) - 1;
+    if (p95 < 0) p95 = 0;
+
+    FILE *out = fopen(out_path, "w");
+    if (!out) {
+        fprintf(stderr, "spawntime: cannae write %s: %s\n", out_path, strerror(errno));
+        return 125;
+    }
+    fprintf(out, "median %.1f\np95 %.1f\nmean %.1f\nmin %.1f\nmax %.1f\n", median, times[p95],
+            sum / (double)runs, times[0], times[runs - 1]);
+    fclose(out);
+    free(times);
+    return 0;
+
+usage:
+    fprintf(stderr, "usage: spawntime [-n RUNS] [-w WARMUP] -o FILE command [args...]\n");
+    return 2;
+}
@@ -1,4 +1,4 @@
-use std::path::PathBuf;
+use std::path::{Path, PathBuf};
 use std::process::Command;
 use std::{env, fs};
 
@@ -13,14 +13,21 @@ fn main() {
     println!("cargo:rerun-if-env-changed=PROFILE");
     println!("cargo:rerun-if-env-changed=TARGET");
     println!("cargo:rerun-if-env-changed=CC");
+    println!("cargo:rerun-if-env-changed=MDH_CLANG");
+    println!("cargo:rerun-if-env-changed=MDH_PACKED_VALUES");
 
     // Tell cargo to rerun this script if the runtime source changes
     println!("cargo:rerun-if-changed=runtime/mdh_runtime.c");
     println!("cargo:rerun-if-changed=runtime/mdh_runtime.h");
     println!("cargo:rerun-if-changed=runtime/gc_stub.c");
+    println!("cargo:rerun-if-changed=runtime/gc_marksweep.c");
+    println!("cargo:rerun-if-changed=vendor/raylib-sys-5.5.1/raylib/src/external/sdefl.h");
+    println!("cargo:rerun-if-changed=vendor/raylib-sys-5.5.1/raylib/src/external/sinfl.h");
     println!("cargo:rerun-if-changed=runtime/mdh_runtime_rs/Cargo.toml");
     println!("cargo:rerun-if-changed=runtime/mdh_runtime_rs/Cargo.lock");
     println!("cargo:rerun-if-changed=runtime/mdh_runtime_rs/src/lib.rs");
+    println!("cargo:rerun-if-changed=runtime/mdh_runtime_rs/src/handles.rs");
+    println!("cargo:rerun-if-changed=runtime/mdh_runtime_rs/src/json_stream.rs");
     println!("cargo:rerun-if-changed=runtime/mdh_runtime_rs/src/audio.rs");
     println!("cargo:rerun-if-changed=runtime/mdh_runtime_rs/src/tri_runtime.rs");
     println!("cargo:rerun-if-changed=runtime/mdh_runtime_rs/src/tri_engine.rs");
@@ -38,14 +45,27 @@ fn main() {
     let out_dir = PathBuf::from(env::var("OUT_DIR").expect("OUT_DIR is required"));
     let cc = env::var("CC").unwrap_or_else(|_| "gcc".to_string());
 
-    // Compile the main runtime
+    // Compile the main runtime. Frame pointers are kept so a hurl from inside the runtime
+    // can walk back up through it to the user functions for a stack trace. Each function
+    // and global gets its own section so the link's --gc-sections can drop whatever a
+    // program never calls.
     let runtime_obj = out_dir.join("mdh_runtime.o");
     let mut cmd = Command::new(&cc);
-    cmd.args(["-c", "-O2", "-fPIC", "runtime/mdh_runtime.c", "-o"]);
+    cmd.args([
+        "-c",
+        "-O2",
+        "-fPIC",
+        "-fno-omit-frame-pointer",
+        "-ffunction-sections",
+        "-fdata-sections",
+        "runtime/mdh_runtime.c",
+        "-o",
+    ]);
     cmd.arg(&runtime_obj);
     if env::var("CARGO_FEATURE_GRAPHICS3D").is_ok() {
         cmd.arg("-DMDH_TRI_RUST");
     }
+    cmd.args(packed_values_define());
 
     let status = cmd.status().expect("Failed to run C compiler");
 
@@ -53,10 +73,29 @@ fn main() {
         panic!("Failed to compile runtime (mdh_runtime.c)");
     }
 
+    // The runtime again as bitcode, linked into user modules from -O2 so small runtime
+    // functions inline (src/llvm/lto.rs). inkwell's LLVM 15 only reads bitcode from clang
+    // 15 or older; without one the file is left empty and the object above is linked.
+    let runtime_bc = out_dir.join("mdh_runtime.bc");
+    let clang = env::var("MDH_CLANG").unwrap_or_else(|_| "clang".to_string());
+    let bitcode_built = clang_major_version(&clang).is_some_and(|major| major <= 15)
+        && emit_runtime_bitcode(&clang, &runtime_bc);
+    if !bitcode_built {
+        fs::write(&runtime_bc, []).expect("Failed to write mdh_runtime.bc");
+    }
+
     // Compile the GC stub (needed for LLVM backend)
     let gc_stub_obj = out_dir.join("gc_stub.o");
     let status = Command::new(&cc)
-        .args(["-c", "-O2", "-fPIC", "runtime/gc_stub.c", "-o"])
+        .args([
+            "-c",
+            "-O2",
+            "-fPIC",
+            "-ffunction-sections",
+            "-fdata-sections",
+            "runtime/gc_stub.c",
+            "-o",
+        ])
         .arg(&gc_stub_obj)
         .status()
         .expect("Failed to run C compiler");
@@ -65,6 +104,26 @@ fn main() {
         panic!("Failed to compile runtime (gc_stub.c)");
     }
 
+    // Compile the mark-sweep collector (selected with `--gc marksweep`)
+    let gc_marksweep_obj = out_dir.join("gc_marksweep.o");
+    let status = Command::new(&cc)
+        .args([
+            "-c",
+            "-O2",
+            "-fPIC",
+            "-ffunction-sections",
+            "-fdata-sections",
+            "runtime/gc_marksweep.c",
+            "-o",
+        ])
+        .arg(&gc_marksweep_obj)
+        .status()
+        .expect("Failed to run C compiler");
+
+    if !status.success() {
+        panic!("Failed to compile runtime (gc_marksweep.c)");
+    }
+
     // Build Rust runtime helpers (JSON + regex) as a staticlib.
     let profile = env::var("PROFILE").unwrap_or_else(|_| "debug".to_string());
     let mut cargo_args = vec![
@@ -115,3 +174,42 @@ fn main() {
     fs::copy(&built_lib, out_path)
         .unwrap_or_else(|e| panic!("Failed to copy {}: {}", built_lib.display(), e));
 }
+
+/// `MDH_PACKED_VALUES=0` in the environment keeps full 16-byte MdhValues in the runtime's
+/// own cells (see mdh_runtime.h); the object and the bitcode must agree on it.
+fn packed_values_define() -> Option<String> {
+    env::var("MDH_PACKED_VALUES")
+        .ok()
+        .map(|packed| format!("-DMDH_PACKED_VALUES={packed}"))
+}
+
+fn emit_runtime_bitcode(clang: &str, out: &Path) -> bool {
+    let mut cmd = Command::new(clang);
+    cmd.args([
+        "-c",
+        "-emit-llvm",
+        "-O2",
+        "-fPIC",
+        "-fno-omit-frame-pointer",
+        "-o",
+    ]);
+    cmd.arg(out).arg("runtime/mdh_runtime.c");
+    if env::var("CARGO_FEATURE_GRAPHICS3D").is_ok() {
+        cmd.arg("-DMDH_TRI_RUST");
+    }
+    cmd.args(packed_values_define());
+    cmd.status().map(|status| status.success()).unwrap_or(false)
+}
+
+/// The LLVM major version of `clang`, from `clang --version`. Apple's clang numbers its
+/// releases separately from LLVM, so it is not trusted.
+fn clang_major_version(clang: &str) -> Option<u32> {
+    let output = Command::new(clang).arg("--version").output().ok()?;
+    let text = String::from_utf8_lossy(&output.stdout);
+    let line = text.lines().next()?;
+    if line.contains("Apple") {
+        return None;
+    }
+    let version = line.split("version ").nth(1)?;
+    version.split('.').next()?.trim().parse().ok()
+}
@@ -5,6 +5,7 @@
 
 use wasm_bindgen::prelude::*;
 use serde::{Deserialize, Serialize};
+use mdhavers::ast::Program;
 
 // Initialize panic hook for better error messages in browser
 #[wasm_bindgen(start)]
@@ -35,8 +36,11 @@ pub struct RunResult {
 /// A JSON string containing the RunResult
 #[wasm_bindgen]
 pub fn run(code: &str) -> String {
-    let result = run_internal(code);
-    serde_json::to_string(&result).unwrap_or_else(|e| {
+    run_result_json(&run_internal(code))
+}
+
+fn run_result_json(result: &RunResult) -> String {
+    serde_json::to_string(result).unwrap_or_else(|e| {
         format!(r#"{{"success":false,"error":"Serialization error: {}","result":"","output":[]}}"#, e)
     })
 }
@@ -55,10 +59,14 @@ fn run_internal(code: &str) -> RunResult {
         }
     };
 
+    run_program(&program)
+}
+
+fn run_program(program: &Program) -> RunResult {
     // Create interpreter and run
     let mut interpreter = mdhavers::Interpreter::new();
 
-    match interpreter.interpret(&program) {
+    match interpreter.interpret(program) {
         Ok(value) => {
             let output = interpreter.get_output().to_vec();
             RunResult {
@@ -80,6 +88,45 @@ fn run_internal(code: &str) -> RunResult {
     }
 }
 
+/// A parsed program, kept by the playground worker between runs so an unchanged
+/// program skips the lexer and parser
+#[wasm_bindgen]
+pub struct Compiled {
+    program: Program,
+}
+
+#[wasm_bindgen]
+impl Compiled {
+    /// Run the program; returns the same JSON as `run`
+    pub fn run(&self) -> String {
+        run_result_json(&run_program(&self.program))
+    }
+
+    /// The program as JSON, for the worker's IndexedDB cache
+    pub fn to_json(&self) -> String {
+        serde_json::to_string(&self.program).unwrap_or_default()
+    }
+
+    /// Rebuild a program saved by `to_json`; None if the JSON doesn't decode
+    pub fn from_json(json: &str) -> Option<Compiled> {
+        serde_json::from_str(json).ok().map(|program| Compiled { program })
+    }
+}
+
+/// Parse mdhavers code once for any number of runs
+///
+/// # Arguments
+/// * `code` - The mdhavers source code to parse
+///
+/// # Returns
+/// The parsed program, or the parse error as the thrown value
+#[wasm_bindgen]
+pub fn compile(code: &str) -> Result<Compiled, String> {
+    mdhavers::parse(code)
+        .map(|program| Compiled { program })
+        .map_err(|e| format!("{}", e))
+}
+
 /// Check mdhavers code for syntax errors without running
 ///
 /// # Arguments
@@ -153,6 +200,16 @@ mod tests {
         assert!(result.contains("success\":false"));
     }
 
+    #[test]
+    fn test_compiled_program_survives_json_round_trip() {
+        let compiled = compile("ken x = 40\nblether x + 2").ok().unwrap();
+        let again = Compiled::from_json(&compiled.to_json()).unwrap();
+        assert_eq!(compiled.run(), again.run());
+        assert!(again.run().contains("\"output\":[\"42\"]"));
+        assert!(compile("ken = ").is_err());
+        assert!(Compiled::from_json("{").is_none());
+    }
+
     #[test]
     fn test_check_valid() {
         let result = check("ken x = 42");
@@ -1,6 +1,6 @@
 // mdhavers Playground - Main Application
 
-import init, { run, check, format, compile_to_js, version } from './pkg/mdhavers_playground.js';
+// The WASM engine lives in worker.js, so compiling and running never block the editor
 
 // Example code snippets
 const EXAMPLES = {
@@ -210,6 +210,49 @@ let toast;
 
 // App state
 let wasmReady = false;
+let worker = null;
+let nextRequestId = 1;
+const pending = new Map();
+let running = false;
+
+function startWorker() {
+    worker = new Worker(new URL('./worker.js', import.meta.url), { type: 'module' });
+    worker.onmessage = (event) => {
+        const { id, ok, value, error, progress } = event.data;
+        const request = pending.get(id);
+        if (!request) return;
+        if (progress) {
+            if (request.onProgress) request.onProgress(progress);
+            return;
+        }
+        pending.delete(id);
+        if (ok) {
+            request.resolve(value);
+        } else {
+            request.reject(new Error(error));
+        }
+    };
+    worker.onerror = (event) => {
+        console.error('Worker error:', event.message);
+    };
+}
+
+// Ask the worker to do `op` with `code`; resolves with its answer
+function callWorker(op, code = '', onProgress = null) {
+    const id = nextRequestId++;
+    return new Promise((resolve, reject) => {
+        pending.set(id, { resolve, reject, onProgress });
+        worker.postMessage({ id, op, code });
+    });
+}
+
+// A runaway program can't be interrupted, so stopping throws the worker away
+function restartWorker() {
+    worker.terminate();
+    pending.forEach((request) => request.reject(new Error('Stopped')));
+    pending.clear();
+    startWorker();
+}
 
 // Initialize the application
 async function initApp() {
@@ -235,10 +278,11 @@ async function initApp() {
 
     // Initialize WASM
     try {
-        await init();
+        startWorker();
+        const version = await callWorker('version');
         wasmReady = true;
         setStatus('Ready', 'ready');
-        console.log(`mdhavers Playground v${version()} loaded`);
+        console.log(`mdhavers Playground v${version} loaded`);
     } catch (error) {
         setStatus('WASM Error', 'error');
         showError('Failed to load mdhavers WASM module: ' + error.message);
@@ -335,7 +379,7 @@ function showToast(message, type = 'success') {
     }, 3000);
 }
 
-function showOutput(lines, result = null, timing = null) {
+function showOutput(lines, result = null, timing = null, cached = false) {
     output.innerHTML = '';
 
     // Show output lines
@@ -358,7 +402,7 @@ function showOutput(lines, result = null, timing = null) {
     if (timing !== null) {
         const div = document.createElement('div');
         div.className = 'output-line timing';
-        div.textContent = `Executed in ${timing.toFixed(2)}ms`;
+        div.textContent = `Executed in ${timing.toFixed(2)}ms` + (cached ? ' (cached parse)' : '');
         output.appendChild(div);
     }
 }
@@ -379,41 +423,57 @@ function showError(message, scotsHeader = null) {
     output.appendChild(div);
 }
 
-function runCode() {
+function setRunning(state) {
+    running = state;
+    runBtn.innerHTML = state ? '<span class="icon">■</span> Stop' : '<span class="icon">▶</span> Run';
+    runBtn.title = state ? 'Stop the running program' : 'Run code (Ctrl+Enter)';
+}
+
+async function runCode() {
     if (!wasmReady) {
         showError('WASM module not ready yet');
         return;
     }
 
+    if (running) {
+        restartWorker();
+        return;
+    }
+
     const code = editor.value;
     if (!code.trim()) {
         showError("Och, there's naething tae run! Write some code first.");
         return;
     }
 
-    setStatus('Running...', 'running');
+    setStatus('Compiling...', 'running');
+    setRunning(true);
 
     try {
-        const startTime = performance.now();
-        const resultJson = run(code);
-        const endTime = performance.now();
-        const result = JSON.parse(resultJson);
+        const result = await callWorker('run', code, () => setStatus('Running...', 'running'));
 
         if (result.success) {
             setStatus('Success', 'success');
-            showOutput(result.output, result.result, endTime - startTime);
+            showOutput(result.output, result.result, result.compileMs + result.runMs, result.cached);
         } else {
             setStatus('Error', 'error');
             showError(result.error, "Och naw! Something's gone wrang:");
         }
     } catch (error) {
-        setStatus('Error', 'error');
-        showError('Unexpected error: ' + error.message);
-        console.error('Run error:', error);
+        if (error.message === 'Stopped') {
+            setStatus('Stopped', 'error');
+            showError('The programme wis stopped afore it finished.');
+        } else {
+            setStatus('Error', 'error');
+            showError('Unexpected error: ' + error.message);
+            console.error('Run error:', error);
+        }
+    } finally {
+        setRunning(false);
     }
 }
 
-function formatCode() {
+async function formatCode() {
     if (!wasmReady) {
         showError('WASM module not ready yet');
         return;
@@ -425,7 +485,8 @@ function formatCode() {
     }
 
     try {
-        const formatted = format(code);
+        const formatted = await callWorker('format', code);
+        if (editor.value !== code) return; // edited while formatting
         editor.value = formatted;
         updateLineNumbers();
         showToast('Code formatted!');
@@ -434,7 +495,7 @@ function formatCode() {
     }
 }
 
-function compileCode() {
+async function compileCode() {
     if (!wasmReady) {
         showError('WASM module not ready yet');
         return;
@@ -447,8 +508,7 @@ function compileCode() {
     }
 
     try {
-        const resultJson = compile_to_js(code);
-        const result = JSON.parse(resultJson);
+        const result = await callWorker('compile_to_js', code);
 
         if (result.success) {
             compiledCode.textContent = result.code;
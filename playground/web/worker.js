@@ -0,0 +1,157 @@
+// mdhavers Playground - Compile and run worker
+//
+// Lexing, parsing, running, formatting and JavaScript compilation all happen here,
+// so a big program never freezes the editor. Parsed programs are kept by a hash of
+// their source: in memory for this page, and in IndexedDB across reloads.
+
+import init, { check, format, compile, compile_to_js, Compiled, version } from './pkg/mdhavers_playground.js';
+
+const WASM_URL = new URL('./pkg/mdhavers_playground_bg.wasm', import.meta.url);
+const DB_NAME = 'mdhavers-playground';
+const DB_STORE = 'programs';
+
+// Parsed programs held in memory (oldest first), and how many IndexedDB keeps
+const MEMORY_PROGRAMS = 32;
+const STORED_PROGRAMS = 200;
+
+const programs = new Map();
+let engineVersion = '';
+let dbPromise = null;
+
+// Compile the engine while it downloads; fall back to a plain compile when the
+// server doesn't send application/wasm.
+async function loadEngine() {
+    let module;
+    try {
+        module = await WebAssembly.compileStreaming(fetch(WASM_URL));
+    } catch (error) {
+        const response = await fetch(WASM_URL);
+        module = await WebAssembly.compile(await response.arrayBuffer());
+    }
+    await init({ module_or_path: module });
+    engineVersion = version();
+}
+
+const ready = loadEngine();
+
+function openDb() {
+    if (!dbPromise) {
+        dbPromise = new Promise((resolve) => {
+            if (typeof indexedDB === 'undefined') {
+                resolve(null);
+                return;
+            }
+            const request = indexedDB.open(DB_NAME, 1);
+            request.onupgradeneeded = () => request.result.createObjectStore(DB_STORE);
+            request.onsuccess = () => resolve(request.result);
+            // Private windows and locked-down browsers: just don't cache
+            request.onerror = () => resolve(null);
+        });
+    }
+    return dbPromise;
+}
+
+async function dbGet(key) {
+    const db = await openDb();
+    if (!db) return null;
+    return new Promise((resolve) => {
+        const request = db.transaction(DB_STORE).objectStore(DB_STORE).get(key);
+        request.onsuccess = () => resolve(request.result || null);
+        request.onerror = () => resolve(null);
+    });
+}
+
+// Store a parsed program and trim the oldest entries past STORED_PROGRAMS
+async function dbPut(key, json) {
+    const db = await openDb();
+    if (!db) return;
+    const store = db.transaction(DB_STORE, 'readwrite').objectStore(DB_STORE);
+    store.put({ json, used: Date.now() }, key);
+    const entries = [];
+    store.openCursor().onsuccess = (event) => {
+        const cursor = event.target.result;
+        if (cursor) {
+            entries.push([cursor.value.used, cursor.key]);
+            cursor.continue();
+        } else if (entries.length > STORED_PROGRAMS) {
+            entries.sort((a, b) => a[0] - b[0]);
+            entries.slice(0, entries.length - STORED_PROGRAMS).forEach(([, old]) => store.delete(old));
+        }
+    };
+}
+
+// Engine version plus SHA-256 of the source, so a new build never reads an old AST
+async function sourceKey(code) {
+    const digest = await crypto.subtle.digest('SHA-256', new TextEncoder().encode(code));
+    const hex = Array.from(new Uint8Array(digest), (b) => b.toString(16).padStart(2, '0')).join('');
+    return `${engineVersion}:${hex}`;
+}
+
+function remember(key, compiled) {
+    programs.set(key, compiled);
+    if (programs.size > MEMORY_PROGRAMS) {
+        const [oldest, dropped] = programs.entries().next().value;
+        programs.delete(oldest);
+        dropped.free();
+    }
+}
+
+// The parsed program for `code` and where it came from: "memory", "stored" or "parsed".
+// Throws the parse error for code that doesn't parse.
+async function compiledFor(code) {
+    const key = await sourceKey(code);
+    let compiled = programs.get(key);
+    if (compiled) {
+        programs.delete(key);
+        programs.set(key, compiled);
+        return { compiled, source: 'memory' };
+    }
+    const stored = await dbGet(key);
+    compiled = stored ? Compiled.from_json(stored.json) : undefined;
+    let source = 'stored';
+    if (!compiled) {
+        compiled = compile(code);
+        dbPut(key, compiled.to_json());
+        source = 'parsed';
+    }
+    remember(key, compiled);
+    return { compiled, source };
+}
+
+async function runCode(id, code) {
+    const start = performance.now();
+    let compiled, source;
+    try {
+        ({ compiled, source } = await compiledFor(code));
+    } catch (error) {
+        return { success: false, error: String(error), result: '', output: [] };
+    }
+    const parsed = performance.now();
+    postMessage({ id, progress: 'running' });
+    const result = JSON.parse(compiled.run());
+    result.compileMs = parsed - start;
+    result.runMs = performance.now() - parsed;
+    result.cached = source !== 'parsed';
+    return result;
+}
+
+const OPS = {
+    run: runCode,
+    check: (id, code) => JSON.parse(check(code)),
+    format: (id, code) => format(code),
+    compile_to_js: (id, code) => JSON.parse(compile_to_js(code)),
+    version: () => engineVersion,
+};
+
+// Requests are {id, op, code}; replies are {id, ok, value} or {id, ok: false, error},
+// with {id, progress} in between for long operations.
+self.onmessage = async (event) => {
+    const { id, op, code } = event.data;
+    try {
+        await ready;
+        const value = await OPS[op](id, code);
+        postMessage({ id, ok: true, value });
+    } catch (error) {
+        postMessage({ id, ok: false, error: error && error.message ? error.message : String(error) });
+    }
+};
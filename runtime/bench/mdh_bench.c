@@ -0,0 +1,410 @@
+/**
+ * mdh_bench.c - Microbenchmarks for the C runtime builtins
+ *
+ * The programs in benchmarks/ time whole mdhavers programs; this times the
+ * runtime calls they spend their time in, so a change to mdh_runtime.c can be
+ * measured on its own. Build and run it with `make bench` in runtime/, which
+ * writes ../benchmarks/results/runtime_bench.json.
+ *
+ * Usage: mdh_bench [--quick] [NAME...]
+ *
+ * Each NAME keeps only the benchmarks whose name contains it. --quick runs
+ * every benchmark for a few milliseconds only, which is what `make test` uses
+ * as a smoke test. Results go to stdout as JSON, one entry per benchmark with
+ * its nanoseconds per operation.
+ *
+ * Each benchmark does its own setup and brackets the timed loop with
+ * bench_start() and bench_stop(). The runner doubles the iteration count until
+ * one run takes long enough, then reports the best of three runs at that count.
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../mdh_runtime.h"
+
+extern void GC_init(void);
+extern void GC_allow_register_threads(void);
+extern void *GC_malloc(size_t size);
+
+static volatile int64_t bench_sink;
+static struct timespec bench_t0;
+static double bench_elapsed;
+
+static void bench_start(void) {
+    clock_gettime(CLOCK_MONOTONIC, &bench_t0);
+}
+
+static void bench_stop(void) {
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    bench_elapsed = (double)(t1.tv_sec - bench_t0.tv_sec) * 1e9 +
+                    (double)(t1.tv_nsec - bench_t0.tv_nsec);
+}
+
+static MdhValue bench_key(int64_t i) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "key%lld", (long long)i);
+    return __mdh_make_string(buf);
+}
+
+static MdhValue bench_text(int64_t len) {
+    char *buf = malloc((size_t)len + 1);
+    for (int64_t i = 0; i < len; i++) {
+        buf[i] = (char)('a' + i % 26);
+    }
+    buf[len] = '\0';
+    MdhValue s = __mdh_make_string(buf);
+    free(buf);
+    return s;
+}
+
+/* ========== Dicts ========== */
+
+/* Key arrays come off the GC heap so a collection mid-benchmark sees the keys */
+static MdhValue *bench_keys(int64_t size) {
+    return (MdhValue *)GC_malloc(sizeof(MdhValue) * (size_t)size);
+}
+
+static MdhValue bench_dict_of(int64_t size, MdhValue *keys) {
+    MdhValue dict = __mdh_empty_dict();
+    for (int64_t i = 0; i < size; i++) {
+        keys[i] = bench_key(i);
+        dict = __mdh_dict_set(dict, keys[i], __mdh_make_int(i));
+    }
+    return dict;
+}
+
+static void bench_dict_get(int64_t size, int64_t iters) {
+    MdhValue *keys = bench_keys(size);
+    MdhValue dict = bench_dict_of(size, keys);
+    int64_t sum = 0;
+    bench_start();
+    for (int64_t i = 0; i < iters; i++) {
+        sum += __mdh_dict_get(dict, keys[i % size]).data;
+    }
+    bench_stop();
+    bench_sink = sum;
+}
+
+/* Overwrites keys already present, so the timed loop never grows the table */
+static void bench_dict_set(int64_t size, int64_t iters) {
+    MdhValue *keys = bench_keys(size);
+    MdhValue dict = bench_dict_of(size, keys);
+    bench_start();
+    for (int64_t i = 0; i < iters; i++) {
+        dict = __mdh_dict_set(dict, keys[i % size], __mdh_make_int(i));
+    }
+    bench_stop();
+    bench_sink = dict.data;
+}
+
+/* Builds dicts of `size` keys from empty; one op is one insert, growth included */
+static void bench_dict_insert(int64_t size, int64_t iters) {
+    MdhValue *keys = bench_keys(size);
+    for (int64_t i = 0; i < size; i++) {
+        keys[i] = bench_key(i);
+    }
+    MdhValue dict = __mdh_empty_dict();
+    bench_start();
+    for (int64_t i = 0; i < iters; i++) {
+        if (i % size == 0) {
+            dict = __mdh_empty_dict();
+        }
+        dict = __mdh_dict_set(dict, keys[i % size], __mdh_make_int(i));
+    }
+    bench_stop();
+    bench_sink = dict.data;
+}
+
+/* ========== Strings ========== */
+
+static void bench_str_concat(int64_t len, int64_t iters) {
+    MdhValue a = bench_text(len);
+    MdhValue b = bench_text(len);
+    int64_t sum = 0;
+    bench_start();
+    for (int64_t i = 0; i < iters; i++) {
+        sum += __mdh_str_concat(a, b).data;
+    }
+    bench_stop();
+    bench_sink = sum;
+}
+
+/* ========== Lists ========== */
+
+/* A fresh list every `size` pushes keeps memory flat; growth is part of the cost */
+static void bench_list_push(int64_t size, int64_t iters) {
+    MdhValue list = __mdh_make_list(0);
+    bench_start();
+    for (int64_t i = 0; i < iters; i++) {
+        if (i % size == 0) {
+            list = __mdh_make_list(0);
+        }
+        __mdh_list_push(list, __mdh_make_int(i));
+    }
+    bench_stop();
+    bench_sink = __mdh_list_len(list);
+}
+
+static void bench_list_get(int64_t size, int64_t iters) {
+    MdhValue list = __mdh_make_list((int32_t)size);
+    for (int64_t i = 0; i < size; i++) {
+        __mdh_list_push(list, __mdh_make_int(i));
+    }
+    int64_t sum = 0;
+    bench_start();
+    for (int64_t i = 0; i < iters; i++) {
+        sum += __mdh_list_get(list, i % size).data;
+    }
+    bench_stop();
+    bench_sink = sum;
+}
+
+/* ========== JSON ========== */
+
+/* A document of `records` small objects, like a typical API response */
+static MdhValue bench_json_doc(int64_t records) {
+    size_t cap = 128 + (size_t)records * 128;
+    char *buf = malloc(cap);
+    size_t len = (size_t)snprintf(buf, cap, "{\"count\":%lld,\"items\":[", (long long)records);
+    for (int64_t i = 0; i < records; i++) {
+        len += (size_t)snprintf(buf + len, cap - len,
+                                "%s{\"id\":%lld,\"name\":\"item %lld\",\"price\":%lld.5,"
+                                "\"tags\":[\"a\",\"b\"],\"live\":true,\"note\":null}",
+                                i ? "," : "", (long long)i, (long long)i, (long long)i);
+    }
+    snprintf(buf + len, cap - len, "]}");
+    MdhValue doc = __mdh_make_string(buf);
+    free(buf);
+    return doc;
+}
+
+static void bench_json_parse(int64_t records, int64_t iters) {
+    MdhValue doc = bench_json_doc(records);
+    int64_t sum = 0;
+    bench_start();
+    for (int64_t i = 0; i < iters; i++) {
+        sum += __mdh_json_parse(doc).data;
+    }
+    bench_stop();
+    bench_sink = sum;
+}
+
+static void bench_json_stringify(int64_t records, int64_t iters) {
+    MdhValue value = __mdh_json_parse(bench_json_doc(records));
+    int64_t sum = 0;
+    bench_start();
+    for (int64_t i = 0; i < iters; i++) {
+        sum += __mdh_json_stringify(value).data;
+    }
+    bench_stop();
+    bench_sink = sum;
+}
+
+/* ========== Regex ========== */
+
+static void bench_regex_test(int64_t len, int64_t iters) {
+    MdhValue text = __mdh_str_concat(bench_text(len), __mdh_make_string("@example.com"));
+    MdhValue pattern = __mdh_make_string("^[a-z]+@[a-z]+\\.com$");
+    int64_t hits = 0;
+    bench_start();
+    for (int64_t i = 0; i < iters; i++) {
+        hits += __mdh_regex_test(text, pattern).data;
+    }
+    bench_stop();
+    bench_sink = hits;
+}
+
+static void bench_regex_replace(int64_t len, int64_t iters) {
+    MdhValue text = bench_text(len);
+    MdhValue pattern = __mdh_make_string("[aeiou]");
+    MdhValue replacement = __mdh_make_string("_");
+    int64_t sum = 0;
+    bench_start();
+    for (int64_t i = 0; i < iters; i++) {
+        sum += __mdh_regex_replace(text, pattern, replacement).data;
+    }
+    bench_stop();
+    bench_sink = sum;
+}
+
+/* ========== Channels ========== */
+
+/* One thread, capacity `cap`: fill the channel then drain it, so nothing ever waits */
+static void bench_chan_local(int64_t cap, int64_t iters) {
+    MdhValue chan = __mdh_chan_new(__mdh_make_int(cap));
+    int64_t sum = 0;
+    bench_start();
+    for (int64_t i = 0; i < iters; i += cap) {
+        int64_t batch = iters - i < cap ? iters - i : cap;
+        for (int64_t j = 0; j < batch; j++) {
+            __mdh_chan_send(chan, __mdh_make_int(j));
+        }
+        for (int64_t j = 0; j < batch; j++) {
+            sum += __mdh_chan_recv(chan).data;
+        }
+    }
+    bench_stop();
+    bench_sink = sum;
+}
+
+typedef struct {
+    MdhValue chan;
+    int64_t count;
+} BenchProducer;
+
+/* Sends only ints, which never touch the GC heap, so it needs no GC registration */
+static void *bench_producer(void *arg) {
+    BenchProducer *p = (BenchProducer *)arg;
+    for (int64_t i = 0; i < p->count; i++) {
+        __mdh_chan_send(p->chan, __mdh_make_int(i));
+    }
+    return NULL;
+}
+
+/* A producer thread and this one as consumer; one op is one value across */
+static void bench_chan_threads(int64_t cap, int64_t iters) {
+    BenchProducer producer = {__mdh_chan_new(__mdh_make_int(cap)), iters};
+    pthread_t thread;
+    int64_t sum = 0;
+    bench_start();
+    if (pthread_create(&thread, NULL, bench_producer, &producer) != 0) {
+        fprintf(stderr, "mdh_bench: cannae start the producer thread\n");
+        exit(1);
+    }
+    for (int64_t i = 0; i < iters; i++) {
+        sum += __mdh_chan_recv(producer.chan).data;
+    }
+    pthread_join(thread, NULL);
+    bench_stop();
+    bench_sink = sum;
+}
+
+/* ========== Event loop ========== */
+
+/* `fds` pipes, every one kept readable, so each poll reports them all */
+static void bench_event_poll(int64_t fds, int64_t iters) {
+    MdhValue loop = __mdh_event_loop_new();
+    int (*pipes)[2] = malloc(sizeof(int[2]) * (size_t)fds);
+    for (int64_t i = 0; i < fds; i++) {
+        if (pipe(pipes[i]) != 0 || write(pipes[i][1], "x", 1) != 1) {
+            fprintf(stderr, "mdh_bench: cannae make %lld pipes (check ulimit -n)\n",
+                    (long long)fds);
+            exit(1);
+        }
+        __mdh_event_watch_read(loop, __mdh_make_int(pipes[i][0]), __mdh_make_int(1));
+    }
+    MdhValue events = __mdh_make_list((int32_t)fds);
+    int64_t seen = 0;
+    bench_start();
+    for (int64_t i = 0; i < iters; i++) {
+        seen += __mdh_event_loop_poll_into(loop, events, __mdh_make_int(0)).data;
+    }
+    bench_stop();
+    bench_sink = seen;
+    if (seen != fds * iters) {
+        fprintf(stderr, "mdh_bench: event_poll/%lld saw %lld events, expected %lld\n",
+                (long long)fds, (long long)seen, (long long)(fds * iters));
+        exit(1);
+    }
+    for (int64_t i = 0; i < fds; i++) {
+        __mdh_event_unwatch(loop, __mdh_make_int(pipes[i][0]));
+        close(pipes[i][0]);
+        close(pipes[i][1]);
+    }
+    free(pipes);
+}
+
+/* ========== Runner ========== */
+
+typedef struct {
+    const char *name;
+    void (*run)(int64_t param, int64_t iters);
+    int64_t param;
+} Bench;
+
+static const Bench BENCHES[] = {
+    {"dict_get", bench_dict_get, 16},
+    {"dict_get", bench_dict_get, 1024},
+    {"dict_get", bench_dict_get, 65536},
+    {"dict_set", bench_dict_set, 16},
+    {"dict_set", bench_dict_set, 1024},
+    {"dict_set", bench_dict_set, 65536},
+    {"dict_insert", bench_dict_insert, 16},
+    {"dict_insert", bench_dict_insert, 1024},
+    {"dict_insert", bench_dict_insert, 65536},
+    {"str_concat", bench_str_concat, 8},
+    {"str_concat", bench_str_concat, 256},
+    {"str_concat", bench_str_concat, 4096},
+    {"list_push", bench_list_push, 16},
+    {"list_push", bench_list_push, 4096},
+    {"list_get", bench_list_get, 1024},
+    {"json_parse", bench_json_parse, 1},
+    {"json_parse", bench_json_parse, 100},
+    {"json_stringify", bench_json_stringify, 1},
+    {"json_stringify", bench_json_stringify, 100},
+    {"regex_test", bench_regex_test, 16},
+    {"regex_test", bench_regex_test, 1024},
+    {"regex_replace", bench_regex_replace, 256},
+    {"chan_local", bench_chan_local, 1024},
+    {"chan_threads", bench_chan_threads, 1},
+    {"chan_threads", bench_chan_threads, 1024},
+    {"event_poll", bench_event_poll, 1},
+    {"event_poll", bench_event_poll, 64},
+    {"event_poll", bench_event_poll, 1024},
+};
+
+static int bench_selected(const char *name, int argc, char **argv, int first) {
+    if (first >= argc) return 1;
+    for (int i = first; i < argc; i++) {
+        if (strstr(name, argv[i])) return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int quick = 0;
+    int first = 1;
+    if (argc > 1 && strcmp(argv[1], "--quick") == 0) {
+        quick = 1;
+        first = 2;
+    }
+    /* Shortest run worth trusting, in nanoseconds */
+    double min_ns = quick ? 2e6 : 2e8;
+
+    GC_init();
+    GC_allow_register_threads();
+
+    printf("{\n  \"suite\": \"mdh_runtime\",\n  \"quick\": %s,\n  \"results\": [", quick ? "true" : "false");
+    int printed = 0;
+    for (size_t b = 0; b < sizeof(BENCHES) / sizeof(BENCHES[0]); b++) {
+        const Bench *bench = &BENCHES[b];
+        char name[64];
+        snprintf(name, sizeof(name), "%s/%lld", bench->name, (long long)bench->param);
+        if (!bench_selected(name, argc, argv, first)) continue;
+
+        int64_t iters = 1;
+        for (;;) {
+            bench->run(bench->param, iters);
+            if (bench_elapsed >= min_ns || iters >= ((int64_t)1 << 40)) break;
+            iters *= 2;
+        }
+        double best = bench_elapsed;
+        for (int rep = 0; rep < (quick ? 0 : 2); rep++) {
+            bench->run(bench->param, iters);
+            if (bench_elapsed < best) best = bench_elapsed;
+        }
+
+        printf("%s\n    {\"name\": \"%s\", \"iterations\": %lld, \"ns_per_op\": %.2f}",
+               printed++ ? "," : "", name, (long long)iters, best / (double)iters);
+        fflush(stdout);
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,1545 @@
+/**
+ * gc_marksweep.c - Conservative mark-sweep collector for standalone executables
+ *
+ * A drop-in replacement for gc_stub.c that actually reclaims memory. It
+ * implements the subset of the Boehm GC API used by the runtime and by
+ * generated code, plus Boehm-compatible heap statistics.
+ *
+ * Layout:
+ *   - Memory comes from 64 KiB-aligned chunks obtained with mmap. Objects up
+ *     to 32 KiB are carved from per-size-class chunks; anything larger gets a
+ *     chunk of its own.
+ *   - A two-level page map resolves any address, including interior
+ *     pointers, to its chunk. Runtime strings point past their header, so
+ *     interior pointers must keep an object alive.
+ *   - Chunks hold a single kind: normal objects are scanned for pointers,
+ *     atomic ones (GC_malloc_atomic) are only marked, so string and byte
+ *     payloads cost nothing to trace and cannot cause false retention.
+ *
+ * Registered threads allocate small objects from a cache of their own: a
+ * batch of slots per size class, taken under the lock and then popped
+ * without it. Cached slots count as allocated; a collection marks them
+ * (without scanning) by walking every thread's cache, and a thread's cache
+ * goes back to the heap when it unregisters.
+ *
+ * Roots are the writable segments of every loaded object, plus each
+ * registered thread's stack, registers and static TLS block. Other
+ * registered threads are stopped with a signal while a collection runs, so
+ * the collector itself never calls malloc (a suspended thread may hold a
+ * libc lock).
+ *
+ * A thread found running on a stack of its own making (a runtime coroutine)
+ * is not scanned from its stack pointer; the runtime pushes those stacks,
+ * and the thread stack they switched away from, from the hook set with
+ * GC_set_push_other_roots, as Boehm's API has it.
+ *
+ * Tuning follows Boehm's API and, like Boehm, can also come from the
+ * environment at startup:
+ *   - GC_set_markers_count / MDH_GC_MARKERS: marker threads, this one
+ *     included. Helpers are started on first use and only join in once the
+ *     heap is big enough to pay for waking them.
+ *   - GC_enable_incremental / MDH_GC_INCREMENTAL: sweep lazily. Small
+ *     chunks are swept by the allocator as it needs slots, so the pause is
+ *     the mark alone. Only the sweep is spread out; marking still stops the
+ *     world, and there is no generational mode.
+ *   - GC_expand_hp / MDH_GC_INITIAL_HEAP: no collection until the heap
+ *     reaches this size (K, M and G suffixes are understood).
+ *   - GC_set_free_space_divisor / MDH_GC_FREE_SPACE_DIVISOR: collect again
+ *     after allocating the live size divided by this (default 1).
+ *
+ * Set MDH_GC_STATS=1 to print heap statistics at exit.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <link.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define GC_CHUNK_SHIFT 16
+#define GC_CHUNK_SIZE ((size_t)1 << GC_CHUNK_SHIFT)
+#define GC_GRANULE 16
+#define GC_MAX_SMALL 32768
+#define GC_MAX_OBJS (GC_CHUNK_SIZE / GC_GRANULE)
+#define GC_BITMAP_WORDS (GC_MAX_OBJS / 64)
+#define GC_NUM_CLASSES 44
+#define GC_LARGE_CLASS 0xFF
+#define GC_MIN_TRIGGER ((size_t)8 << 20)
+#define GC_MAP_BITS 16
+#define GC_MAP_SIZE ((size_t)1 << GC_MAP_BITS)
+#define GC_MAX_TLS 4
+#define GC_MAX_MAIN_STACK ((size_t)1 << 30)
+#define GC_KIND_NORMAL 0
+#define GC_KIND_ATOMIC 1
+#define GC_KIND_COUNT 2
+#define GC_SIG_SUSPEND SIGPWR
+#define GC_SIG_RESTART SIGXCPU
+#define GC_MAX_MARKERS 16
+#define GC_PARALLEL_MIN ((size_t)4 << 20)
+#define GC_MARK_SLICE 4096
+#define GC_CACHE_BYTES 4096
+#define GC_CACHE_MAX 64
+
+typedef struct GC_stack_base {
+    void *mem_base;
+} GC_stack_base;
+
+typedef struct GcChunk {
+    char *base;
+    size_t span;
+    size_t objsize;
+    uint32_t nobjs;
+    uint8_t size_class;
+    uint8_t kind;
+    uint8_t unswept; /* marked but no swept yet (incremental mode) */
+    struct GcChunk *next;
+    struct GcChunk *next_unswept;
+    uint64_t marks[GC_BITMAP_WORDS];
+    uint64_t allocs[GC_BITMAP_WORDS];
+} GcChunk;
+
+/* A thread's free slots, per kind and size class. Lives in collector
+ * metadata, so the conservative scan never reaches it. */
+typedef struct GcCache {
+    void *free[GC_KIND_COUNT][GC_NUM_CLASSES];
+} GcCache;
+
+typedef struct GcThread {
+    pthread_t id;
+    char *stack_base;
+    char *stack_lo; /* lowest address the thread's own stack can reach */
+    void *volatile stack_ptr;
+    char *tls_lo[GC_MAX_TLS];
+    char *tls_hi[GC_MAX_TLS];
+    int tls_count;
+    GcCache *cache;
+    struct GcThread *next;
+} GcThread;
+
+typedef struct {
+    char *lo;
+    char *hi;
+} GcRange;
+
+/* One marker's stack; marker 0 is the collecting thread. */
+typedef struct {
+    GcRange *stack;
+    size_t len;
+    size_t cap;
+    size_t marked; /* bytes it marked this collection */
+} GcMarker;
+
+static pthread_mutex_t gc_lock = PTHREAD_MUTEX_INITIALIZER;
+static int gc_ready = 0;
+
+static size_t gc_class_size[GC_NUM_CLASSES];
+static uint8_t gc_size_to_class[GC_MAX_SMALL / GC_GRANULE + 1];
+static void *gc_free_lists[GC_KIND_COUNT][GC_NUM_CLASSES];
+static GcChunk *gc_unswept[GC_KIND_COUNT][GC_NUM_CLASSES];
+static int gc_sweep_pending = 0;
+
+/* Page map top level; mmap'd so the data-segment scan doesn't walk it. */
+static GcChunk ***gc_map = NULL;
+static uintptr_t gc_heap_lo = 0;
+static uintptr_t gc_heap_hi = 0;
+static GcChunk *gc_chunks = NULL;
+static GcChunk *gc_spare_chunks = NULL;
+
+static GcThread *gc_threads = NULL;
+static GcThread *gc_spare_threads = NULL;
+static __thread GcCache *gc_my_cache = NULL;
+static void gc_drain_cache_locked(GcCache *cache);
+static sem_t gc_ack;
+static volatile int gc_world_stopped = 0;
+static sigset_t gc_suspend_mask;
+
+static void (*gc_push_other_roots)(void) = NULL;
+
+static GcRange *gc_roots = NULL;
+static size_t gc_root_count = 0;
+static size_t gc_root_cap = 0;
+
+static GcMarker gc_markers[GC_MAX_MARKERS];
+static int gc_parallel = 0; /* set while helpers are marking */
+
+/* Parallel marking: markers hand work through a shared pool of ranges and
+ * finish when every one of them is idle with the pool empty. Helpers sleep
+ * on gc_helper_cond between collections. */
+static pthread_mutex_t gc_share_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gc_share_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t gc_helper_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t gc_helper_done = PTHREAD_COND_INITIALIZER;
+static GcRange *gc_share = NULL;
+static size_t gc_share_len = 0;
+static size_t gc_share_cap = 0;
+static unsigned gc_share_idle = 0;
+static unsigned gc_share_active = 0;
+static int gc_share_done = 0;
+static unsigned gc_helper_count = 0;
+static unsigned gc_helpers_busy = 0;
+static unsigned long gc_mark_round = 0;
+
+/* Tuning. */
+static unsigned gc_marker_count = 1;
+static int gc_incremental = 0;
+static size_t gc_min_trigger = GC_MIN_TRIGGER;
+static unsigned long gc_free_space_divisor = 1;
+
+static char *gc_meta_next = NULL;
+static char *gc_meta_end = NULL;
+
+/* Statistics (bytes unless noted). */
+static size_t gc_heap_size = 0;
+static size_t gc_bytes_in_use = 0;
+static size_t gc_bytes_since_gc = 0;
+static size_t gc_trigger = GC_MIN_TRIGGER;
+static size_t gc_total_allocated = 0;
+static size_t gc_total_freed = 0;
+static size_t gc_collections = 0;
+static double gc_pause_total_ms = 0.0;
+static double gc_pause_max_ms = 0.0;
+static double gc_pause_last_ms = 0.0;
+
+static void gc_fatal(const char *msg) {
+    fprintf(stderr, "[mdh] gc: %s\n", msg);
+    abort();
+}
+
+static void *gc_map_pages(size_t size) {
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        return NULL;
+    }
+    return p;
+}
+
+/* Map `size` bytes aligned to GC_CHUNK_SIZE by over-mapping and trimming. */
+static char *gc_map_aligned(size_t size) {
+    char *raw = (char *)gc_map_pages(size + GC_CHUNK_SIZE);
+    if (!raw) {
+        return NULL;
+    }
+    uintptr_t addr = (uintptr_t)raw;
+    uintptr_t aligned = (addr + GC_CHUNK_SIZE - 1) & ~(uintptr_t)(GC_CHUNK_SIZE - 1);
+    size_t head = aligned - addr;
+    size_t tail = GC_CHUNK_SIZE - head;
+    if (head) {
+        munmap(raw, head);
+    }
+    if (tail) {
+        munmap((char *)aligned + size, tail);
+    }
+    return (char *)aligned;
+}
+
+/* Bump allocator for collector metadata; never touches the GC heap. */
+static void *gc_meta_alloc(size_t size) {
+    size = (size + 15) & ~(size_t)15;
+    if (!gc_meta_next || (size_t)(gc_meta_end - gc_meta_next) < size) {
+        char *slab = (char *)gc_map_pages(GC_CHUNK_SIZE);
+        if (!slab) {
+            gc_fatal("out of memory for collector metadata");
+        }
+        gc_meta_next = slab;
+        gc_meta_end = slab + GC_CHUNK_SIZE;
+    }
+    void *p = gc_meta_next;
+    gc_meta_next += size;
+    return p;
+}
+
+/* Grow an mmap-backed array without going through malloc. */
+static void *gc_grow_array(void *old, size_t old_bytes, size_t new_bytes) {
+    void *next = gc_map_pages(new_bytes);
+    if (!next) {
+        gc_fatal("out of memory growing collector tables");
+    }
+    if (old) {
+        memcpy(next, old, old_bytes);
+        munmap(old, old_bytes);
+    }
+    return next;
+}
+
+static void gc_init_size_classes(void) {
+    int n = 0;
+    for (size_t size = GC_GRANULE; size <= 256; size += GC_GRANULE) {
+        gc_class_size[n++] = size;
+    }
+    for (size_t base = 256; base < GC_MAX_SMALL; base *= 2) {
+        for (size_t step = 1; step <= 4; step++) {
+            gc_class_size[n++] = base + base / 4 * step;
+        }
+    }
+    int cls = 0;
+    for (size_t g = 0; g <= GC_MAX_SMALL / GC_GRANULE; g++) {
+        while (gc_class_size[cls] < g * GC_GRANULE) {
+            cls++;
+        }
+        gc_size_to_class[g] = (uint8_t)cls;
+    }
+}
+
+static inline GcChunk *gc_chunk_of(uintptr_t addr) {
+    if (addr - gc_heap_lo >= gc_heap_hi - gc_heap_lo) {
+        return NULL;
+    }
+    GcChunk **leaf = gc_map[(addr >> (GC_CHUNK_SHIFT + GC_MAP_BITS)) & (GC_MAP_SIZE - 1)];
+    if (!leaf) {
+        return NULL;
+    }
+    return leaf[(addr >> GC_CHUNK_SHIFT) & (GC_MAP_SIZE - 1)];
+}
+
+static void gc_map_set(char *base, size_t span, GcChunk *chunk) {
+    for (uintptr_t addr = (uintptr_t)base; addr < (uintptr_t)base + span; addr += GC_CHUNK_SIZE) {
+        size_t top = (addr >> (GC_CHUNK_SHIFT + GC_MAP_BITS)) & (GC_MAP_SIZE - 1);
+        if (!gc_map[top]) {
+            gc_map[top] = (GcChunk **)gc_map_pages(sizeof(GcChunk *) * GC_MAP_SIZE);
+            if (!gc_map[top]) {
+                gc_fatal("out of memory for page map");
+            }
+        }
+        gc_map[top][(addr >> GC_CHUNK_SHIFT) & (GC_MAP_SIZE - 1)] = chunk;
+    }
+}
+
+static GcChunk *gc_new_chunk(size_t span, size_t objsize, uint8_t size_class, uint8_t kind) {
+    char *base = gc_map_aligned(span);
+    if (!base) {
+        return NULL;
+    }
+    GcChunk *chunk = gc_spare_chunks;
+    if (chunk) {
+        gc_spare_chunks = chunk->next;
+    } else {
+        chunk = (GcChunk *)gc_meta_alloc(sizeof(GcChunk));
+    }
+    memset(chunk, 0, sizeof(GcChunk));
+    chunk->base = base;
+    chunk->span = span;
+    chunk->objsize = objsize;
+    chunk->nobjs = (uint32_t)(size_class == GC_LARGE_CLASS ? 1 : span / objsize);
+    chunk->size_class = size_class;
+    chunk->kind = kind;
+    chunk->next = gc_chunks;
+    gc_chunks = chunk;
+
+    gc_map_set(base, span, chunk);
+    if (gc_heap_hi == 0 || (uintptr_t)base < gc_heap_lo) gc_heap_lo = (uintptr_t)base;
+    if ((uintptr_t)base + span > gc_heap_hi) gc_heap_hi = (uintptr_t)base + span;
+    gc_heap_size += span;
+    return chunk;
+}
+
+static void gc_release_chunk(GcChunk *chunk) {
+    gc_map_set(chunk->base, chunk->span, NULL);
+    munmap(chunk->base, chunk->span);
+    gc_heap_size -= chunk->span;
+    chunk->next = gc_spare_chunks;
+    gc_spare_chunks = chunk;
+}
+
+/* Thread registry ------------------------------------------------------ */
+
+static pid_t gc_gettid(void) {
+    return (pid_t)syscall(SYS_gettid);
+}
+
+extern void *__libc_stack_end __attribute__((weak));
+
+int GC_get_stack_base(GC_stack_base *sb) {
+    if (!sb) {
+        return 1;
+    }
+    if (gc_gettid() == getpid() && &__libc_stack_end && __libc_stack_end) {
+        sb->mem_base = __libc_stack_end;
+        return 0;
+    }
+    pthread_attr_t attr;
+    void *addr = NULL;
+    size_t size = 0;
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+        sb->mem_base = NULL;
+        return 1;
+    }
+    pthread_attr_getstack(&attr, &addr, &size);
+    pthread_attr_destroy(&attr);
+    sb->mem_base = (char *)addr + size;
+    return 0;
+}
+
+/* The low end of the calling thread's stack below base: the stack rlimit for the main
+ * thread (which grows on demand), the pthread mapping otherwise. */
+static char *gc_stack_limit(char *base) {
+    if (!base) {
+        return NULL;
+    }
+    size_t size = (size_t)8 << 20;
+    if (gc_gettid() == getpid()) {
+        struct rlimit rl;
+        if (getrlimit(RLIMIT_STACK, &rl) == 0) {
+            size = rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur > GC_MAX_MAIN_STACK
+                       ? GC_MAX_MAIN_STACK
+                       : (size_t)rl.rlim_cur;
+        }
+    } else {
+        pthread_attr_t attr;
+        void *addr = NULL;
+        size_t got = 0;
+        if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+            pthread_attr_getstack(&attr, &addr, &got);
+            pthread_attr_destroy(&attr);
+            if (addr) {
+                return (char *)addr;
+            }
+        }
+    }
+    return (uintptr_t)base > size ? base - size : NULL;
+}
+
+/* Whether sp lies on t's own stack rather than a coroutine stack. */
+static inline int gc_on_own_stack(const GcThread *t, const char *sp) {
+    return sp < t->stack_base && sp >= t->stack_lo;
+}
+
+static int gc_collect_tls(struct dl_phdr_info *info, size_t size, void *data) {
+    (void)size;
+    GcThread *rec = (GcThread *)data;
+    if (!info->dlpi_tls_data || rec->tls_count >= GC_MAX_TLS) {
+        return 0;
+    }
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+        const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+        if (ph->p_type == PT_TLS && ph->p_memsz > 0) {
+            rec->tls_lo[rec->tls_count] = (char *)info->dlpi_tls_data;
+            rec->tls_hi[rec->tls_count] = (char *)info->dlpi_tls_data + ph->p_memsz;
+            rec->tls_count++;
+            break;
+        }
+    }
+    return 0;
+}
+
+static GcThread *gc_find_thread(pthread_t id) {
+    for (GcThread *t = gc_threads; t; t = t->next) {
+        if (pthread_equal(t->id, id)) {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+static int gc_register_locked(const GcThread *proto) {
+    if (gc_find_thread(proto->id)) {
+        return 1; /* GC_DUPLICATE */
+    }
+    GcThread *rec = gc_spare_threads;
+    if (rec) {
+        gc_spare_threads = rec->next;
+    } else {
+        rec = (GcThread *)gc_meta_alloc(sizeof(GcThread));
+    }
+    GcCache *cache = rec->cache; /* a spare record keeps its (empty) cache */
+    *rec = *proto;
+    rec->cache = cache ? cache : (GcCache *)gc_meta_alloc(sizeof(GcCache));
+    rec->next = gc_threads;
+    gc_threads = rec;
+    gc_my_cache = rec->cache;
+    return 0;
+}
+
+/* Fill a registration record for the calling thread. Runs without the lock
+ * because dl_iterate_phdr takes the loader lock. */
+static void gc_describe_self(GcThread *rec, const GC_stack_base *sb) {
+    memset(rec, 0, sizeof(*rec));
+    rec->id = pthread_self();
+    rec->stack_base = (char *)sb->mem_base;
+    rec->stack_lo = gc_stack_limit(rec->stack_base);
+    dl_iterate_phdr(gc_collect_tls, rec);
+}
+
+static void gc_suspend_handler(int sig, siginfo_t *info, void *ctx) {
+    (void)sig;
+    (void)info;
+    (void)ctx;
+    int saved_errno = errno;
+    GcThread *me = gc_find_thread(pthread_self());
+    if (me) {
+        /* The kernel saved this thread's registers in the signal frame,
+         * which sits above us on the stack; scanning from here covers it. */
+        __builtin_unwind_init();
+        volatile char marker = 0;
+        me->stack_ptr = (void *)&marker;
+    }
+    sem_post(&gc_ack);
+    while (__atomic_load_n(&gc_world_stopped, __ATOMIC_ACQUIRE)) {
+        sigsuspend(&gc_suspend_mask);
+    }
+    sem_post(&gc_ack);
+    errno = saved_errno;
+}
+
+static void gc_restart_handler(int sig) {
+    (void)sig;
+}
+
+static void gc_install_signals(void) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = gc_suspend_handler;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigfillset(&sa.sa_mask);
+    if (sigaction(GC_SIG_SUSPEND, &sa, NULL) != 0) {
+        gc_fatal("cannot install suspend handler");
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = gc_restart_handler;
+    sa.sa_flags = SA_RESTART;
+    sigfillset(&sa.sa_mask);
+    if (sigaction(GC_SIG_RESTART, &sa, NULL) != 0) {
+        gc_fatal("cannot install restart handler");
+    }
+
+    sigfillset(&gc_suspend_mask);
+    sigdelset(&gc_suspend_mask, GC_SIG_RESTART);
+}
+
+static void gc_wait_acks(int count) {
+    for (int i = 0; i < count; i++) {
+        while (sem_wait(&gc_ack) != 0 && errno == EINTR) {
+        }
+    }
+}
+
+static int gc_stop_world(pthread_t self) {
+    int stopped = 0;
+    __atomic_store_n(&gc_world_stopped, 1, __ATOMIC_RELEASE);
+    for (GcThread *t = gc_threads; t; t = t->next) {
+        if (pthread_equal(t->id, self)) {
+            continue;
+        }
+        if (pthread_kill(t->id, GC_SIG_SUSPEND) == 0) {
+            stopped++;
+        } else {
+            t->stack_ptr = NULL;
+        }
+    }
+    gc_wait_acks(stopped);
+    return stopped;
+}
+
+static void gc_start_world(pthread_t self, int stopped) {
+    __atomic_store_n(&gc_world_stopped, 0, __ATOMIC_RELEASE);
+    for (GcThread *t = gc_threads; t; t = t->next) {
+        if (!pthread_equal(t->id, self) && t->stack_ptr) {
+            pthread_kill(t->id, GC_SIG_RESTART);
+        }
+    }
+    gc_wait_acks(stopped);
+}
+
+/* Marking -------------------------------------------------------------- */
+
+static void gc_push(GcMarker *m, char *p, size_t n) {
+    if (m->len == m->cap) {
+        size_t cap = m->cap ? m->cap * 2 : 4096;
+        m->stack = (GcRange *)gc_grow_array(
+            m->stack, sizeof(GcRange) * m->cap, sizeof(GcRange) * cap);
+        m->cap = cap;
+    }
+    m->stack[m->len].lo = p;
+    m->stack[m->len].hi = p + n;
+    m->len++;
+}
+
+static inline void gc_mark_word(GcMarker *m, uintptr_t w) {
+    GcChunk *chunk = gc_chunk_of(w);
+    if (!chunk) {
+        return;
+    }
+    size_t idx = (w - (uintptr_t)chunk->base) / chunk->objsize;
+    if (idx >= chunk->nobjs) {
+        idx = chunk->nobjs - 1;
+        if (chunk->size_class != GC_LARGE_CLASS) {
+            return;
+        }
+    }
+    uint64_t bit = (uint64_t)1 << (idx & 63);
+    uint64_t *mark = &chunk->marks[idx >> 6];
+    if (!(chunk->allocs[idx >> 6] & bit) || (__atomic_load_n(mark, __ATOMIC_RELAXED) & bit)) {
+        return;
+    }
+    if (gc_parallel) {
+        /* Another marker may reach the same object; only the one that sets
+         * the bit pushes it. */
+        if (__atomic_fetch_or(mark, bit, __ATOMIC_RELAXED) & bit) {
+            return;
+        }
+    } else {
+        *mark |= bit;
+    }
+    m->marked += chunk->objsize;
+    if (chunk->kind != GC_KIND_ATOMIC) {
+        gc_push(m, chunk->base + idx * chunk->objsize, chunk->objsize);
+    }
+}
+
+/* Packed runtime values (MdhPacked in mdh_runtime.h) keep a pointer in the low 48 bits
+ * under a 0xFFF prefix; must match MDH_PACKED_TOP / MDH_PACKED_PAYLOAD. */
+#define GC_PACKED_TOP 0xFFF0000000000000ULL
+#define GC_PACKED_PAYLOAD 0x0000FFFFFFFFFFFFULL
+
+static void gc_scan(GcMarker *m, char *lo, char *hi) {
+    uintptr_t p = ((uintptr_t)lo + sizeof(void *) - 1) & ~(uintptr_t)(sizeof(void *) - 1);
+    for (; p + sizeof(void *) <= (uintptr_t)hi; p += sizeof(void *)) {
+        uintptr_t w = *(uintptr_t *)p;
+        if (((uint64_t)w & GC_PACKED_TOP) == GC_PACKED_TOP) {
+            w = (uintptr_t)((uint64_t)w & GC_PACKED_PAYLOAD);
+        }
+        gc_mark_word(m, w);
+    }
+}
+
+static void gc_drain(GcMarker *m) {
+    while (m->len > 0) {
+        m->len--;
+        GcRange r = m->stack[m->len];
+        gc_scan(m, r.lo, r.hi);
+    }
+}
+
+/* Hand the older half of m's stack to the pool for idle markers. */
+static void gc_share_out(GcMarker *m) {
+    size_t give = m->len / 2;
+    pthread_mutex_lock(&gc_share_lock);
+    if (gc_share_len + give > gc_share_cap) {
+        size_t cap = gc_share_cap ? gc_share_cap : 1024;
+        while (cap < gc_share_len + give) {
+            cap *= 2;
+        }
+        gc_share = (GcRange *)gc_grow_array(
+            gc_share, sizeof(GcRange) * gc_share_cap, sizeof(GcRange) * cap);
+        gc_share_cap = cap;
+    }
+    memcpy(gc_share + gc_share_len, m->stack, sizeof(GcRange) * give);
+    __atomic_store_n(&gc_share_len, gc_share_len + give, __ATOMIC_RELAXED);
+    pthread_cond_broadcast(&gc_share_cond);
+    pthread_mutex_unlock(&gc_share_lock);
+    memmove(m->stack, m->stack + give, sizeof(GcRange) * (m->len - give));
+    m->len -= give;
+}
+
+/* Wait for work from the pool. Returns 0 once marking is finished. */
+static int gc_share_take(GcMarker *m) {
+    pthread_mutex_lock(&gc_share_lock);
+    __atomic_store_n(&gc_share_idle, gc_share_idle + 1, __ATOMIC_RELAXED);
+    for (;;) {
+        if (gc_share_len > 0) {
+            size_t take = (gc_share_len + gc_share_active - 1) / gc_share_active;
+            for (size_t i = 0; i < take; i++) {
+                GcRange r = gc_share[gc_share_len - 1 - i];
+                gc_push(m, r.lo, (size_t)(r.hi - r.lo));
+            }
+            __atomic_store_n(&gc_share_len, gc_share_len - take, __ATOMIC_RELAXED);
+            __atomic_store_n(&gc_share_idle, gc_share_idle - 1, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(&gc_share_lock);
+            return 1;
+        }
+        if (!gc_share_done && gc_share_idle == gc_share_active) {
+            gc_share_done = 1;
+            pthread_cond_broadcast(&gc_share_cond);
+        }
+        if (gc_share_done) {
+            pthread_mutex_unlock(&gc_share_lock);
+            return 0;
+        }
+        pthread_cond_wait(&gc_share_cond, &gc_share_lock);
+    }
+}
+
+/* Mark until every marker runs dry. Big ranges are scanned a slice at a
+ * time so a long array or data segment can be split among markers. */
+static void gc_mark_shared(GcMarker *m) {
+    do {
+        while (m->len > 0) {
+            GcRange r = m->stack[--m->len];
+            if ((size_t)(r.hi - r.lo) > GC_MARK_SLICE) {
+                char *cut = (char *)(((uintptr_t)r.lo + GC_MARK_SLICE) &
+                                     ~(uintptr_t)(sizeof(void *) - 1));
+                gc_push(m, cut, (size_t)(r.hi - cut));
+                r.hi = cut;
+            }
+            gc_scan(m, r.lo, r.hi);
+            if (m->len > 1 && __atomic_load_n(&gc_share_idle, __ATOMIC_RELAXED) > 0 &&
+                __atomic_load_n(&gc_share_len, __ATOMIC_RELAXED) == 0) {
+                gc_share_out(m);
+            }
+        }
+    } while (gc_share_take(m));
+}
+
+static void *gc_helper_main(void *arg) {
+    unsigned index = (unsigned)(uintptr_t)arg;
+    unsigned long seen = 0;
+    pthread_mutex_lock(&gc_share_lock);
+    for (;;) {
+        while (gc_mark_round == seen) {
+            pthread_cond_wait(&gc_helper_cond, &gc_share_lock);
+        }
+        seen = gc_mark_round;
+        if (index >= gc_share_active) {
+            continue;
+        }
+        pthread_mutex_unlock(&gc_share_lock);
+        gc_mark_shared(&gc_markers[index]);
+        pthread_mutex_lock(&gc_share_lock);
+        if (--gc_helpers_busy == 0) {
+            pthread_cond_signal(&gc_helper_done);
+        }
+    }
+    return NULL;
+}
+
+/* Start helpers up to `want` markers in all; returns how many there are.
+ * Helpers are never registered, so stopping the world leaves them be, and
+ * they block every signal so none is delivered to them. Must run before
+ * the world stops: pthread_create allocates. */
+static unsigned gc_start_helpers(unsigned want) {
+    while (gc_helper_count + 1 < want) {
+        sigset_t all;
+        sigset_t old;
+        pthread_t tid;
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &old);
+        int rc = pthread_create(
+            &tid, NULL, gc_helper_main, (void *)(uintptr_t)(gc_helper_count + 1));
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+        if (rc != 0) {
+            break;
+        }
+        pthread_detach(tid);
+        gc_helper_count++;
+    }
+    return gc_helper_count + 1 < want ? gc_helper_count + 1 : want;
+}
+
+/* Mark from whatever marker 0 holds, with `markers` threads. Returns the
+ * bytes marked. */
+static size_t gc_mark(unsigned markers) {
+    for (unsigned i = 0; i < markers; i++) {
+        gc_markers[i].marked = 0;
+    }
+    if (markers < 2) {
+        gc_drain(&gc_markers[0]);
+        return gc_markers[0].marked;
+    }
+    gc_parallel = 1;
+    pthread_mutex_lock(&gc_share_lock);
+    gc_share_len = 0;
+    gc_share_idle = 0;
+    gc_share_done = 0;
+    gc_share_active = markers;
+    gc_helpers_busy = markers - 1;
+    gc_mark_round++;
+    pthread_cond_broadcast(&gc_helper_cond);
+    pthread_mutex_unlock(&gc_share_lock);
+
+    gc_mark_shared(&gc_markers[0]);
+
+    pthread_mutex_lock(&gc_share_lock);
+    while (gc_helpers_busy > 0) {
+        pthread_cond_wait(&gc_helper_done, &gc_share_lock);
+    }
+    pthread_mutex_unlock(&gc_share_lock);
+    gc_parallel = 0;
+
+    size_t marked = 0;
+    for (unsigned i = 0; i < markers; i++) {
+        marked += gc_markers[i].marked;
+    }
+    return marked;
+}
+
+/* Cached slots stay allocated: mark them, but don't scan what's left in
+ * them. A thread stopped mid-pop leaves its head at the slot being taken,
+ * which is marked either way. */
+static size_t gc_mark_caches(void) {
+    size_t marked = 0;
+    for (GcThread *t = gc_threads; t; t = t->next) {
+        for (int kind = 0; kind < GC_KIND_COUNT; kind++) {
+            for (int cls = 0; cls < GC_NUM_CLASSES; cls++) {
+                void **slot = (void **)t->cache->free[kind][cls];
+                for (; slot; slot = (void **)*slot) {
+                    GcChunk *chunk = gc_chunk_of((uintptr_t)slot);
+                    size_t idx = ((char *)slot - chunk->base) / chunk->objsize;
+                    chunk->marks[idx >> 6] |= (uint64_t)1 << (idx & 63);
+                    marked += chunk->objsize;
+                }
+            }
+        }
+    }
+    return marked;
+}
+
+static int gc_collect_data_root(struct dl_phdr_info *info, size_t size, void *data) {
+    (void)size;
+    (void)data;
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+        const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+        if (ph->p_type != PT_LOAD || !(ph->p_flags & PF_W) || ph->p_memsz == 0) {
+            continue;
+        }
+        if (gc_root_count == gc_root_cap) {
+            size_t cap = gc_root_cap ? gc_root_cap * 2 : 64;
+            gc_roots = (GcRange *)gc_grow_array(
+                gc_roots, sizeof(GcRange) * gc_root_cap, sizeof(GcRange) * cap);
+            gc_root_cap = cap;
+        }
+        char *lo = (char *)(info->dlpi_addr + ph->p_vaddr);
+        gc_roots[gc_root_count].lo = lo;
+        gc_roots[gc_root_count].hi = lo + ph->p_memsz;
+        gc_root_count++;
+    }
+    return 0;
+}
+
+/* Sweeping ------------------------------------------------------------- */
+
+/* Drop a chunk's unmarked objects and clear its marks. Returns how many
+ * objects survive. */
+static size_t gc_sweep_chunk(GcChunk *chunk) {
+    size_t survivors = 0;
+    for (size_t w = 0; w * 64 < chunk->nobjs; w++) {
+        uint64_t dead = chunk->allocs[w] & ~chunk->marks[w];
+        gc_total_freed += (size_t)__builtin_popcountll(dead) * chunk->objsize;
+        chunk->allocs[w] &= chunk->marks[w];
+        chunk->marks[w] = 0;
+        survivors += (size_t)__builtin_popcountll(chunk->allocs[w]);
+    }
+    chunk->unswept = 0;
+    return survivors;
+}
+
+static void gc_free_slots(GcChunk *chunk) {
+    void **head = &gc_free_lists[chunk->kind][chunk->size_class];
+    for (size_t i = chunk->nobjs; i-- > 0;) {
+        if (!(chunk->allocs[i >> 6] & ((uint64_t)1 << (i & 63)))) {
+            void **slot = (void **)(chunk->base + i * chunk->objsize);
+            *slot = *head;
+            *head = slot;
+        }
+    }
+}
+
+static void gc_sweep(void) {
+    memset(gc_free_lists, 0, sizeof(gc_free_lists));
+    size_t live = 0;
+    GcChunk **link = &gc_chunks;
+    while (*link) {
+        GcChunk *chunk = *link;
+        size_t survivors = gc_sweep_chunk(chunk);
+        if (survivors == 0) {
+            *link = chunk->next;
+            gc_release_chunk(chunk);
+            continue;
+        }
+        live += survivors * chunk->objsize;
+        if (chunk->size_class != GC_LARGE_CLASS) {
+            gc_free_slots(chunk);
+        }
+        link = &chunk->next;
+    }
+    gc_bytes_in_use = live;
+}
+
+/* Incremental mode: sweep large chunks now (freeing one gives back its
+ * whole mapping) and queue the rest for the allocator. Live bytes come
+ * from marking, since nothing is counted by a sweep yet. */
+static void gc_sweep_lazily(size_t marked) {
+    memset(gc_free_lists, 0, sizeof(gc_free_lists));
+    memset(gc_unswept, 0, sizeof(gc_unswept));
+    GcChunk **link = &gc_chunks;
+    while (*link) {
+        GcChunk *chunk = *link;
+        if (chunk->size_class == GC_LARGE_CLASS) {
+            if (gc_sweep_chunk(chunk) == 0) {
+                *link = chunk->next;
+                gc_release_chunk(chunk);
+                continue;
+            }
+        } else {
+            chunk->unswept = 1;
+            chunk->next_unswept = gc_unswept[chunk->kind][chunk->size_class];
+            gc_unswept[chunk->kind][chunk->size_class] = chunk;
+        }
+        link = &chunk->next;
+    }
+    gc_sweep_pending = 1;
+    gc_bytes_in_use = marked;
+}
+
+/* Sweep queued chunks of one class until it has a free slot. */
+static void gc_sweep_some(uint8_t cls, uint8_t kind) {
+    GcChunk **queue = &gc_unswept[kind][cls];
+    while (*queue && !gc_free_lists[kind][cls]) {
+        GcChunk *chunk = *queue;
+        *queue = chunk->next_unswept;
+        gc_sweep_chunk(chunk);
+        gc_free_slots(chunk);
+    }
+}
+
+/* Sweep whatever the allocator hasn't got round to, so every mark bit is
+ * clear before the next collection. Runs with the world going: only code
+ * holding gc_lock touches chunk metadata. */
+static void gc_finish_sweep(void) {
+    if (!gc_sweep_pending) {
+        return;
+    }
+    GcChunk **link = &gc_chunks;
+    while (*link) {
+        GcChunk *chunk = *link;
+        if (chunk->unswept && gc_sweep_chunk(chunk) == 0) {
+            *link = chunk->next;
+            gc_release_chunk(chunk);
+            continue;
+        }
+        link = &chunk->next;
+    }
+    memset(gc_unswept, 0, sizeof(gc_unswept));
+    gc_sweep_pending = 0;
+}
+
+static double gc_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1.0e6;
+}
+
+static void __attribute__((noinline)) gc_collect_inner(void) {
+    pthread_t self = pthread_self();
+    GcThread *me = gc_find_thread(self);
+    GcThread here;
+    if (!me) {
+        GC_stack_base sb;
+        memset(&here, 0, sizeof(here));
+        if (GC_get_stack_base(&sb) == 0) {
+            here.stack_base = (char *)sb.mem_base;
+            here.stack_lo = gc_stack_limit(here.stack_base);
+        }
+        me = &here;
+    }
+
+    /* Gather data segments before stopping anyone: dl_iterate_phdr takes
+     * the loader lock, which a suspended thread could be holding. */
+    gc_root_count = 0;
+    dl_iterate_phdr(gc_collect_data_root, NULL);
+    gc_finish_sweep();
+    unsigned markers = 1;
+    if (gc_marker_count > 1 && gc_bytes_in_use >= GC_PARALLEL_MIN) {
+        markers = gc_start_helpers(gc_marker_count);
+    }
+
+    int stopped = gc_stop_world(self);
+
+    /* Every root range goes on marker 0's stack; marking shares it out. */
+    GcMarker *m = &gc_markers[0];
+    for (size_t i = 0; i < gc_root_count; i++) {
+        gc_push(m, gc_roots[i].lo, (size_t)(gc_roots[i].hi - gc_roots[i].lo));
+    }
+    char *sp = (char *)__builtin_frame_address(0);
+    if (me->stack_base && gc_on_own_stack(me, sp)) {
+        gc_push(m, sp, (size_t)(me->stack_base - sp));
+    }
+    for (GcThread *t = gc_threads; t; t = t->next) {
+        if (!pthread_equal(t->id, self) && t->stack_ptr && t->stack_base &&
+            gc_on_own_stack(t, (char *)t->stack_ptr)) {
+            gc_push(m, (char *)t->stack_ptr, (size_t)(t->stack_base - (char *)t->stack_ptr));
+        }
+        for (int i = 0; i < t->tls_count; i++) {
+            gc_push(m, t->tls_lo[i], (size_t)(t->tls_hi[i] - t->tls_lo[i]));
+        }
+    }
+    if (gc_push_other_roots) {
+        gc_push_other_roots();
+    }
+    size_t marked = gc_mark_caches();
+    marked += gc_mark(markers);
+
+    if (gc_incremental) {
+        gc_sweep_lazily(marked);
+    } else {
+        gc_sweep();
+    }
+    gc_start_world(self, stopped);
+}
+
+/* Spill callee-saved registers into this frame so the scan of the current
+ * stack in gc_collect_inner sees pointers that only live in registers. */
+static void __attribute__((noinline)) gc_collect_locked(void) {
+    double start = gc_now_ms();
+    jmp_buf regs;
+    setjmp(regs);
+    __builtin_unwind_init();
+    gc_collect_inner();
+    __asm__ volatile("" : : "r"(&regs) : "memory");
+
+    gc_collections++;
+    gc_bytes_since_gc = 0;
+    size_t next = gc_bytes_in_use / gc_free_space_divisor;
+    gc_trigger = next > gc_min_trigger ? next : gc_min_trigger;
+    double pause = gc_now_ms() - start;
+    gc_pause_last_ms = pause;
+    gc_pause_total_ms += pause;
+    if (pause > gc_pause_max_ms) {
+        gc_pause_max_ms = pause;
+    }
+}
+
+/* Initialisation ------------------------------------------------------- */
+
+static void gc_report_stats(void) {
+    fprintf(stderr,
+            "[mdh] gc: %zu collections, heap %zu KiB, in use %zu KiB, "
+            "allocated %zu KiB, freed %zu KiB, pause %.3f ms total / %.3f ms max\n",
+            gc_collections,
+            gc_heap_size / 1024,
+            gc_bytes_in_use / 1024,
+            gc_total_allocated / 1024,
+            gc_total_freed / 1024,
+            gc_pause_total_ms,
+            gc_pause_max_ms);
+}
+
+/* A byte count or plain number from the environment; 0 when unset. */
+static size_t gc_env_size(const char *name) {
+    const char *text = getenv(name);
+    if (!text || !text[0]) {
+        return 0;
+    }
+    char *end = NULL;
+    unsigned long long n = strtoull(text, &end, 10);
+    switch (*end) {
+    case 'k':
+    case 'K':
+        n <<= 10;
+        break;
+    case 'm':
+    case 'M':
+        n <<= 20;
+        break;
+    case 'g':
+    case 'G':
+        n <<= 30;
+        break;
+    default:
+        break;
+    }
+    return (size_t)n;
+}
+
+static void gc_init_once(void) {
+    gc_init_size_classes();
+    gc_map = (GcChunk ***)gc_map_pages(sizeof(GcChunk **) * GC_MAP_SIZE);
+    if (!gc_map) {
+        gc_fatal("out of memory for page map");
+    }
+    sem_init(&gc_ack, 0, 0);
+    gc_install_signals();
+
+    GC_stack_base sb;
+    GcThread rec;
+    if (GC_get_stack_base(&sb) == 0) {
+        gc_describe_self(&rec, &sb);
+        gc_register_locked(&rec);
+    }
+
+    const char *stats = getenv("MDH_GC_STATS");
+    if (stats && stats[0] && strcmp(stats, "0") != 0) {
+        atexit(gc_report_stats);
+    }
+    size_t markers = gc_env_size("MDH_GC_MARKERS");
+    if (markers > 0) {
+        gc_marker_count = markers < GC_MAX_MARKERS ? (unsigned)markers : GC_MAX_MARKERS;
+    }
+    gc_incremental = gc_env_size("MDH_GC_INCREMENTAL") > 0;
+    size_t initial = gc_env_size("MDH_GC_INITIAL_HEAP");
+    if (initial > gc_min_trigger) {
+        gc_min_trigger = initial;
+        gc_trigger = initial;
+    }
+    size_t divisor = gc_env_size("MDH_GC_FREE_SPACE_DIVISOR");
+    if (divisor > 0) {
+        gc_free_space_divisor = divisor;
+    }
+    gc_ready = 1;
+}
+
+static pthread_once_t gc_once = PTHREAD_ONCE_INIT;
+
+/* Runs on the main thread before main(), so the main stack is always the
+ * first one registered even if the first allocation happens elsewhere. */
+__attribute__((constructor)) void GC_init(void) {
+    pthread_once(&gc_once, gc_init_once);
+}
+
+static inline void gc_ensure_init(void) {
+    if (!__atomic_load_n(&gc_ready, __ATOMIC_ACQUIRE)) {
+        GC_init();
+    }
+}
+
+int GC_register_my_thread(const GC_stack_base *sb) {
+    gc_ensure_init();
+    if (!sb || !sb->mem_base) {
+        return 1;
+    }
+    GcThread rec;
+    gc_describe_self(&rec, sb);
+    pthread_mutex_lock(&gc_lock);
+    int rc = gc_register_locked(&rec);
+    pthread_mutex_unlock(&gc_lock);
+    return rc;
+}
+
+int GC_unregister_my_thread(void) {
+    pthread_t self = pthread_self();
+    pthread_mutex_lock(&gc_lock);
+    GcThread **link = &gc_threads;
+    while (*link && !pthread_equal((*link)->id, self)) {
+        link = &(*link)->next;
+    }
+    GcThread *rec = *link;
+    if (rec) {
+        *link = rec->next;
+        gc_drain_cache_locked(rec->cache);
+        gc_my_cache = NULL;
+        rec->next = gc_spare_threads;
+        gc_spare_threads = rec;
+    }
+    pthread_mutex_unlock(&gc_lock);
+    return rec ? 0 : 1;
+}
+
+void GC_allow_register_threads(void) {
+    gc_ensure_init();
+}
+
+/* Extra roots --------------------------------------------------------- */
+
+/* fn runs during every collection, with the world stopped, and calls
+ * GC_push_all for each range it wants scanned. */
+void GC_set_push_other_roots(void (*fn)(void)) {
+    gc_ensure_init();
+    pthread_mutex_lock(&gc_lock);
+    gc_push_other_roots = fn;
+    pthread_mutex_unlock(&gc_lock);
+}
+
+void GC_push_all(void *bottom, void *top) {
+    if ((char *)bottom < (char *)top) {
+        gc_push(&gc_markers[0], (char *)bottom, (size_t)((char *)top - (char *)bottom));
+    }
+}
+
+/* Run fn under the allocation lock, so no collection (and so no other-roots
+ * hook) can see the state it changes half done. */
+void *GC_call_with_alloc_lock(void *(*fn)(void *), void *data) {
+    gc_ensure_init();
+    pthread_mutex_lock(&gc_lock);
+    void *result = fn(data);
+    pthread_mutex_unlock(&gc_lock);
+    return result;
+}
+
+/* Allocation ----------------------------------------------------------- */
+
+static void *gc_alloc_large_locked(size_t size, uint8_t kind) {
+    size_t objsize = (size + GC_GRANULE - 1) & ~(size_t)(GC_GRANULE - 1);
+    size_t span = (objsize + GC_CHUNK_SIZE - 1) & ~(GC_CHUNK_SIZE - 1);
+    if (gc_bytes_since_gc >= gc_trigger) {
+        gc_collect_locked();
+    }
+    GcChunk *chunk = gc_new_chunk(span, objsize, GC_LARGE_CLASS, kind);
+    if (!chunk) {
+        gc_collect_locked();
+        chunk = gc_new_chunk(span, objsize, GC_LARGE_CLASS, kind);
+        if (!chunk) {
+            return NULL;
+        }
+    }
+    chunk->allocs[0] = 1;
+    gc_bytes_in_use += objsize;
+    gc_bytes_since_gc += objsize;
+    gc_total_allocated += objsize;
+    return chunk->base;
+}
+
+static int gc_refill_locked(uint8_t cls, uint8_t kind) {
+    size_t objsize = gc_class_size[cls];
+    GcChunk *chunk = gc_new_chunk(GC_CHUNK_SIZE, objsize, cls, kind);
+    if (!chunk) {
+        return 0;
+    }
+    void **head = &gc_free_lists[kind][cls];
+    for (size_t i = chunk->nobjs; i-- > 0;) {
+        void **slot = (void **)(chunk->base + i * objsize);
+        *slot = *head;
+        *head = slot;
+    }
+    return 1;
+}
+
+/* Pop a free slot of class cls, collecting or growing the heap as needed. */
+static void **gc_take_slot_locked(uint8_t cls, uint8_t kind) {
+    void **head = &gc_free_lists[kind][cls];
+    void **slot = (void **)*head;
+    if (!slot) {
+        gc_sweep_some(cls, kind);
+        slot = (void **)*head;
+    }
+    if (!slot) {
+        if (gc_bytes_since_gc >= gc_trigger) {
+            gc_collect_locked();
+            gc_sweep_some(cls, kind);
+            slot = (void **)*head;
+        }
+        if (!slot) {
+            if (!gc_refill_locked(cls, kind)) {
+                gc_collect_locked();
+                gc_sweep_some(cls, kind);
+                if (!*head && !gc_refill_locked(cls, kind)) {
+                    return NULL;
+                }
+            }
+            slot = (void **)*head;
+        }
+    }
+    *head = *slot;
+    return slot;
+}
+
+static inline void gc_claim(void **slot) {
+    GcChunk *chunk = gc_chunk_of((uintptr_t)slot);
+    size_t idx = ((char *)slot - chunk->base) / chunk->objsize;
+    chunk->allocs[idx >> 6] |= (uint64_t)1 << (idx & 63);
+}
+
+static inline void gc_clear_slot(void **slot, size_t objsize, uint8_t kind) {
+    if (kind == GC_KIND_ATOMIC) {
+        /* Like Boehm, atomic memory is not cleared; only the free-list link. */
+        *slot = NULL;
+    } else {
+        memset(slot, 0, objsize);
+    }
+}
+
+static void *gc_alloc_small_locked(size_t size, uint8_t kind) {
+    uint8_t cls = gc_size_to_class[(size + GC_GRANULE - 1) / GC_GRANULE];
+    void **slot = gc_take_slot_locked(cls, kind);
+    if (!slot) {
+        return NULL;
+    }
+    size_t objsize = gc_class_size[cls];
+    gc_claim(slot);
+    gc_clear_slot(slot, objsize, kind);
+    gc_bytes_in_use += objsize;
+    gc_bytes_since_gc += objsize;
+    gc_total_allocated += objsize;
+    return slot;
+}
+
+/* Take a slot for the caller plus a batch for its cache, all claimed and
+ * counted as allocated now. The cache list is published with one store, and
+ * only after any collection, so a collection never sees it half built. */
+static void **gc_refill_cache(GcCache *cache, uint8_t cls, uint8_t kind) {
+    size_t objsize = gc_class_size[cls];
+    size_t batch = GC_CACHE_BYTES / objsize;
+    if (batch > GC_CACHE_MAX) {
+        batch = GC_CACHE_MAX;
+    }
+    pthread_mutex_lock(&gc_lock);
+    void **slot = gc_take_slot_locked(cls, kind);
+    if (!slot) {
+        pthread_mutex_unlock(&gc_lock);
+        return NULL;
+    }
+    gc_claim(slot);
+    size_t taken = 1;
+    void **head = &gc_free_lists[kind][cls];
+    void *list = NULL;
+    while (taken < batch && *head) {
+        void **extra = (void **)*head;
+        *head = *extra;
+        gc_claim(extra);
+        *extra = list;
+        list = extra;
+        taken++;
+    }
+    __atomic_store_n(&cache->free[kind][cls], list, __ATOMIC_RELAXED);
+    gc_bytes_in_use += taken * objsize;
+    gc_bytes_since_gc += taken * objsize;
+    gc_total_allocated += taken * objsize;
+    pthread_mutex_unlock(&gc_lock);
+    return slot;
+}
+
+static void *gc_alloc(size_t size, uint8_t kind) {
+    gc_ensure_init();
+    if (size == 0) {
+        size = 1;
+    }
+    GcCache *cache = gc_my_cache;
+    if (cache && size <= GC_MAX_SMALL) {
+        uint8_t cls = gc_size_to_class[(size + GC_GRANULE - 1) / GC_GRANULE];
+        void **slot = (void **)cache->free[kind][cls];
+        if (slot) {
+            /* The head moves on before the slot is cleared, so a collection
+             * that stops this thread in between still walks the whole list. */
+            __atomic_store_n(&cache->free[kind][cls], *slot, __ATOMIC_RELAXED);
+            __atomic_signal_fence(__ATOMIC_SEQ_CST);
+        } else {
+            slot = gc_refill_cache(cache, cls, kind);
+            if (!slot) {
+                return NULL;
+            }
+        }
+        gc_clear_slot(slot, gc_class_size[cls], kind);
+        return slot;
+    }
+    pthread_mutex_lock(&gc_lock);
+    void *p = size <= GC_MAX_SMALL ? gc_alloc_small_locked(size, kind)
+                                   : gc_alloc_large_locked(size, kind);
+    pthread_mutex_unlock(&gc_lock);
+    return p;
+}
+
+void *GC_malloc(size_t size) {
+    return gc_alloc(size, GC_KIND_NORMAL);
+}
+
+void *GC_malloc_atomic(size_t size) {
+    return gc_alloc(size, GC_KIND_ATOMIC);
+}
+
+/* Give one allocated object back. Returns its size if it still counted as
+ * in use (an unmarked one in an unswept chunk is already garbage). */
+static size_t gc_drop_locked(GcChunk *chunk, size_t idx) {
+    uint64_t bit = (uint64_t)1 << (idx & 63);
+    size_t size = chunk->objsize;
+    if (chunk->unswept) {
+        /* The lazy sweep threads the slot. */
+        if (!(chunk->marks[idx >> 6] & bit)) {
+            return 0;
+        }
+        chunk->allocs[idx >> 6] &= ~bit;
+        return size;
+    }
+    chunk->allocs[idx >> 6] &= ~bit;
+    if (chunk->size_class == GC_LARGE_CLASS) {
+        GcChunk **link = &gc_chunks;
+        while (*link != chunk) {
+            link = &(*link)->next;
+        }
+        *link = chunk->next;
+        gc_release_chunk(chunk);
+    } else {
+        void *ptr = chunk->base + idx * size;
+        *(void **)ptr = gc_free_lists[chunk->kind][chunk->size_class];
+        gc_free_lists[chunk->kind][chunk->size_class] = ptr;
+    }
+    return size;
+}
+
+/* A leaving thread's cached slots were never handed out: uncount them. */
+static void gc_drain_cache_locked(GcCache *cache) {
+    for (int kind = 0; kind < GC_KIND_COUNT; kind++) {
+        for (int cls = 0; cls < GC_NUM_CLASSES; cls++) {
+            void **slot = (void **)cache->free[kind][cls];
+            cache->free[kind][cls] = NULL;
+            while (slot) {
+                void **next = (void **)*slot;
+                GcChunk *chunk = gc_chunk_of((uintptr_t)slot);
+                size_t size = gc_drop_locked(chunk, ((char *)slot - chunk->base) / chunk->objsize);
+                gc_bytes_in_use -= size;
+                gc_total_allocated -= size;
+                slot = next;
+            }
+        }
+    }
+}
+
+void GC_free(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    pthread_mutex_lock(&gc_lock);
+    GcChunk *chunk = gc_chunk_of((uintptr_t)ptr);
+    if (chunk) {
+        size_t idx = ((char *)ptr - chunk->base) / chunk->objsize;
+        uint64_t bit = (uint64_t)1 << (idx & 63);
+        if (idx < chunk->nobjs && (chunk->allocs[idx >> 6] & bit) &&
+            (char *)ptr == chunk->base + idx * chunk->objsize) {
+            size_t size = gc_drop_locked(chunk, idx);
+            gc_bytes_in_use -= size;
+            gc_total_freed += size;
+        }
+    }
+    pthread_mutex_unlock(&gc_lock);
+}
+
+void *GC_realloc(void *ptr, size_t size) {
+    if (!ptr) {
+        return GC_malloc(size);
+    }
+    if (size == 0) {
+        GC_free(ptr);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&gc_lock);
+    GcChunk *chunk = gc_chunk_of((uintptr_t)ptr);
+    size_t capacity = 0;
+    uint8_t kind = GC_KIND_NORMAL;
+    if (chunk) {
+        kind = chunk->kind;
+        size_t idx = ((char *)ptr - chunk->base) / chunk->objsize;
+        if (idx >= chunk->nobjs) {
+            idx = chunk->nobjs - 1;
+        }
+        char *end = chunk->base + (idx + 1) * chunk->objsize;
+        capacity = (size_t)(end - (char *)ptr);
+        if (chunk->size_class == GC_LARGE_CLASS && size <= chunk->span &&
+            (char *)ptr == chunk->base) {
+            /* Grow a large object within its existing mapping. */
+            size_t objsize = (size + GC_GRANULE - 1) & ~(size_t)(GC_GRANULE - 1);
+            if (objsize > chunk->objsize) {
+                gc_bytes_in_use += objsize - chunk->objsize;
+                chunk->objsize = objsize;
+            }
+            capacity = chunk->objsize;
+        }
+    }
+    pthread_mutex_unlock(&gc_lock);
+
+    if (!chunk) {
+        /* Not ours (e.g. memory handed out by libc); keep libc semantics. */
+        return realloc(ptr, size);
+    }
+    if (size <= capacity) {
+        return ptr;
+    }
+    /* The copy keeps the original's kind, so grown strings stay atomic. */
+    void *next = gc_alloc(size, kind);
+    if (next) {
+        memcpy(next, ptr, capacity);
+    }
+    return next;
+}
+
+char *GC_strdup(const char *s) {
+    size_t len = strlen(s);
+    char *copy = (char *)GC_malloc_atomic(len + 1);
+    if (copy) {
+        memcpy(copy, s, len + 1);
+    }
+    return copy;
+}
+
+void GC_gcollect(void) {
+    gc_ensure_init();
+    pthread_mutex_lock(&gc_lock);
+    gc_collect_locked();
+    pthread_mutex_unlock(&gc_lock);
+}
+
+size_t GC_get_heap_size(void) {
+    return gc_heap_size;
+}
+
+size_t GC_get_free_bytes(void) {
+    return gc_heap_size - gc_bytes_in_use;
+}
+
+size_t GC_get_total_bytes(void) {
+    return gc_total_allocated;
+}
+
+size_t GC_get_gc_no(void) {
+    return gc_collections;
+}
+
+/* Tuning --------------------------------------------------------------- */
+
+/* Unlike Boehm's, these may be called at any time; they take effect at the
+ * next collection. */
+void GC_set_markers_count(unsigned markers) {
+    gc_ensure_init();
+    pthread_mutex_lock(&gc_lock);
+    gc_marker_count = markers < 1 ? 1 : markers > GC_MAX_MARKERS ? GC_MAX_MARKERS : markers;
+    pthread_mutex_unlock(&gc_lock);
+}
+
+unsigned GC_get_markers_count(void) {
+    return gc_marker_count;
+}
+
+/* As with Boehm, there is no way back. */
+void GC_enable_incremental(void) {
+    gc_ensure_init();
+    pthread_mutex_lock(&gc_lock);
+    gc_incremental = 1;
+    pthread_mutex_unlock(&gc_lock);
+}
+
+int GC_is_incremental_mode(void) {
+    return gc_incremental;
+}
+
+/* Let the heap grow by `bytes` before the next collection. */
+int GC_expand_hp(size_t bytes) {
+    gc_ensure_init();
+    pthread_mutex_lock(&gc_lock);
+    size_t floor = gc_heap_size + bytes;
+    if (floor > gc_min_trigger) {
+        gc_min_trigger = floor;
+    }
+    if (gc_trigger < gc_min_trigger) {
+        gc_trigger = gc_min_trigger;
+    }
+    pthread_mutex_unlock(&gc_lock);
+    return 1;
+}
+
+void GC_set_free_space_divisor(unsigned long divisor) {
+    gc_ensure_init();
+    pthread_mutex_lock(&gc_lock);
+    gc_free_space_divisor = divisor ? divisor : 1;
+    pthread_mutex_unlock(&gc_lock);
+}
+
+unsigned long GC_get_free_space_divisor(void) {
+    return gc_free_space_divisor;
+}
+
+/* Not in Boehm's API: collection pauses in milliseconds. */
+void GC_get_pause_stats(double *last_ms, double *max_ms, double *total_ms) {
+    pthread_mutex_lock(&gc_lock);
+    *last_ms = gc_pause_last_ms;
+    *max_ms = gc_pause_max_ms;
+    *total_ms = gc_pause_total_ms;
+    pthread_mutex_unlock(&gc_lock);
+}
@@ -37,10 +37,27 @@ void GC_allow_register_threads(void) {
     // No-op for stub
 }
 
+void GC_set_push_other_roots(void (*fn)(void)) {
+    (void)fn; // Nothing is ever collected, so there are no roots to push
+}
+
+void GC_push_all(void *bottom, void *top) {
+    (void)bottom;
+    (void)top;
+}
+
+void *GC_call_with_alloc_lock(void *(*fn)(void *), void *data) {
+    return fn(data);
+}
+
 void* GC_malloc(size_t size) {
     return malloc(size);
 }
 
+void* GC_malloc_atomic(size_t size) {
+    return malloc(size);
+}
+
 void* GC_realloc(void* ptr, size_t size) {
     return realloc(ptr, size);
 }
@@ -48,3 +65,58 @@ void* GC_realloc(void* ptr, size_t size) {
 char* GC_strdup(const char* s) {
     return strdup(s);
 }
+
+void GC_gcollect(void) {
+    // Nothing to collect
+}
+
+size_t GC_get_heap_size(void) {
+    return 0;
+}
+
+size_t GC_get_free_bytes(void) {
+    return 0;
+}
+
+size_t GC_get_total_bytes(void) {
+    return 0;
+}
+
+size_t GC_get_gc_no(void) {
+    return 0;
+}
+
+// Tuning is accepted and ignored, so programs built either way link
+void GC_set_markers_count(unsigned markers) {
+    (void)markers;
+}
+
+unsigned GC_get_markers_count(void) {
+    return 1;
+}
+
+void GC_enable_incremental(void) {
+}
+
+int GC_is_incremental_mode(void) {
+    return 0;
+}
+
+int GC_expand_hp(size_t bytes) {
+    (void)bytes;
+    return 1;
+}
+
+void GC_set_free_space_divisor(unsigned long divisor) {
+    (void)divisor;
+}
+
+unsigned long GC_get_free_space_divisor(void) {
+    return 1;
+}
+
+void GC_get_pause_stats(double *last_ms, double *max_ms, double *total_ms) {
+    *last_ms = 0.0;
+    *max_ms = 0.0;
+    *total_ms = 0.0;
+}
@@ -17,11 +17,24 @@ const __havers_audio = (() => {
     sounds: new Map(),
     music: new Map(),
     midi: new Map(),
+    midiWorklet: null,
   };
 
   const DEFAULT_SOUNDFONT = "assets/soundfonts/MuseScore_General.sf2";
   const DEFAULT_MIDI_WASM = "assets/wasm/mdh_rustysynth.wasm";
   const MIDI_SAMPLE_RATE = 44100;
+  const MIDI_PROCESSOR = "mdh-midi";
+
+  // Layout of a streaming MIDI entry's control block, shared with its worklet:
+  // Int32 flags, then Float32 params, then Float64 reports from the audio thread.
+  const MIDI_CONTROL_BYTES = 48;
+  const MIDI_FLAG_PLAYING = 0;
+  const MIDI_FLAG_LOOPED = 1;
+  const MIDI_FLAG_SEEK = 2;
+  const MIDI_PARAM_VOLUME = 0;
+  const MIDI_PARAM_PAN = 1;
+  const MIDI_PARAM_SEEK_TO = 2;
+  const MIDI_REPORT_POSITION = 0;
 
   function clamp01(v) {
     if (v < 0) return 0;
@@ -236,33 +249,425 @@ const __havers_audio = (() => {
     const sfUrl = resolveSoundfontPath(sfPath);
     Promise.all([
       loadArrayBuffer(midiUrl, "Cannae read the midi"),
-      loadArrayBuffer(sfUrl, "Cannae read the soondfont"),
+      loadSoundfont(sfUrl),
       loadRustySynth(),
     ])
-      .then(([midiBuf, sfBuf, wasm]) => {
-        return renderMidi(wasm, sfBuf, midiBuf);
+      .then(([midiBuf, sfBuf, synth]) => {
+        if (state.midi.get(handle) !== entry) return null;
+        if (synth.streams && canStreamMidi()) {
+          return streamMidi(entry, midiBuf, sfUrl, sfBuf, synth);
+        }
+        fillMidiEntry(entry, renderMidi(synth.exports, sfBuf, midiBuf));
+        return null;
       })
-      .then((rendered) => {
-        const ctx = ensureCtx();
-        const buffer = ctx.createBuffer(2, rendered.frames, MIDI_SAMPLE_RATE);
-        const left = buffer.getChannelData(0);
-        const right = buffer.getChannelData(1);
-        const data = rendered.data;
-        for (let i = 0, j = 0; i < rendered.frames; i++) {
-          left[i] = data[j++];
-          right[i] = data[j++];
+      .catch((err) => {
+        queueError(new Error(err && err.message ? err.message : "Cannae read the midi"));
+      });
+  }
+
+  function fillMidiEntry(entry, rendered) {
+    const ctx = ensureCtx();
+    const buffer = ctx.createBuffer(2, rendered.frames, MIDI_SAMPLE_RATE);
+    const left = buffer.getChannelData(0);
+    const right = buffer.getChannelData(1);
+    const data = rendered.data;
+    for (let i = 0, j = 0; i < rendered.frames; i++) {
+      left[i] = data[j++];
+      right[i] = data[j++];
+    }
+    entry.buffer = buffer;
+    entry.length = buffer.duration;
+    entry.ready = true;
+    if (entry.pendingPlay) {
+      entry.pendingPlay = false;
+      playBufferEntry(entry);
+    }
+  }
+
+  const soundfonts = new Map();
+
+  // Each soundfont is fetched once, whatever the number of songs played through it
+  function loadSoundfont(url) {
+    if (!soundfonts.has(url)) {
+      const pending = loadArrayBuffer(url, "Cannae read the soondfont");
+      pending.catch(() => soundfonts.delete(url));
+      soundfonts.set(url, pending);
+    }
+    return soundfonts.get(url);
+  }
+
+  // Streaming needs an AudioWorklet and a place to load its module from
+  function canStreamMidi() {
+    const ctx = ensureCtx();
+    return !!ctx.audioWorklet
+      && typeof AudioWorkletNode !== "undefined"
+      && typeof Blob !== "undefined"
+      && typeof URL !== "undefined"
+      && typeof URL.createObjectURL === "function";
+  }
+
+  // The audio thread side of a streaming MIDI entry. This function is never called
+  // here: its source is loaded into the context's AudioWorklet. Every processor in a
+  // context shares one synth instance, and each soundfont is parsed into it once.
+  function midiProcessorModule() {
+    const FLAG_PLAYING = 0;
+    const FLAG_LOOPED = 1;
+    const FLAG_SEEK = 2;
+    const PARAM_VOLUME = 0;
+    const PARAM_PAN = 1;
+    const PARAM_SEEK_TO = 2;
+    const REPORT_POSITION = 0;
+    // Blocks between position updates when the control block isn't shared
+    const POSITION_EVERY = 8;
+
+    const waits = new Map();
+
+    function waitFor(key) {
+      let wait = waits.get(key);
+      if (!wait) {
+        wait = {};
+        wait.promise = new Promise((resolve, reject) => {
+          wait.resolve = resolve;
+          wait.reject = reject;
+        });
+        wait.promise.catch(() => {});
+        wait.started = false;
+        waits.set(key, wait);
+      }
+      return wait;
+    }
+
+    function synthError(wasm, fallback) {
+      const ptr = wasm.last_error_ptr();
+      const len = wasm.last_error_len();
+      if (!ptr || !len) return fallback;
+      const bytes = new Uint8Array(wasm.memory.buffer, ptr, len);
+      return String.fromCharCode.apply(null, bytes) || fallback;
+    }
+
+    function copyIn(wasm, buf) {
+      const ptr = wasm.alloc(buf.byteLength);
+      new Uint8Array(wasm.memory.buffer).set(new Uint8Array(buf), ptr);
+      return ptr;
+    }
+
+    function provideSynth(bytes) {
+      const wait = waitFor("synth");
+      if (wait.started) return;
+      wait.started = true;
+      WebAssembly.instantiate(bytes, {})
+        .then((result) => wait.resolve(result.instance.exports))
+        .catch(() => wait.reject(new Error("MIDI synth isnae richt")));
+    }
+
+    function provideSoundfont(key, bytes) {
+      const wait = waitFor("soondfont:" + key);
+      if (wait.started) return;
+      wait.started = true;
+      waitFor("synth").promise
+        .then((wasm) => {
+          const ptr = copyIn(wasm, bytes);
+          const sf = wasm.soundfont_load(ptr, bytes.byteLength);
+          wasm.dealloc(ptr, bytes.byteLength);
+          if (!sf) throw new Error(synthError(wasm, "Cannae read the soondfont"));
+          wait.resolve(sf);
+        })
+        .catch((err) => wait.reject(err));
+    }
+
+    class MidiProcessor extends AudioWorkletProcessor {
+      constructor(options) {
+        super();
+        const opts = options.processorOptions;
+        this.shared = opts.shared;
+        this.flags = new Int32Array(opts.control, 0, 4);
+        this.params = new Float32Array(opts.control, 16, 4);
+        this.report = new Float64Array(opts.control, 32, 2);
+        this.seekSeen = 0;
+        this.blocks = 0;
+        this.wasm = null;
+        this.stream = 0;
+        this.heap = null;
+        this.inL = null;
+        this.inR = null;
+        this.open = true;
+        this.port.onmessage = (event) => this.message(event.data || {});
+        Promise.all([waitFor("synth").promise, waitFor("soondfont:" + opts.soundfont).promise])
+          .then(([wasm, sf]) => {
+            if (!this.open) return;
+            const ptr = copyIn(wasm, opts.midi);
+            const stream = wasm.stream_open(sf, ptr, opts.midi.byteLength, sampleRate);
+            wasm.dealloc(ptr, opts.midi.byteLength);
+            if (!stream) throw new Error(synthError(wasm, "Cannae read the midi"));
+            this.wasm = wasm;
+            this.stream = stream;
+            this.port.postMessage({ type: "ready", length: wasm.stream_length(stream) });
+          })
+          .catch((err) => {
+            this.port.postMessage({ type: "error", message: err && err.message });
+          });
+      }
+
+      message(msg) {
+        if (msg.type === "synth") {
+          provideSynth(msg.bytes);
+        } else if (msg.type === "soondfont") {
+          provideSoundfont(msg.key, msg.bytes);
+        } else if (msg.type === "flag") {
+          this.flags[msg.slot] = msg.value;
+        } else if (msg.type === "param") {
+          this.params[msg.slot] = msg.value;
+        } else if (msg.type === "close") {
+          this.open = false;
+          if (this.stream) this.wasm.stream_free(this.stream);
+          this.stream = 0;
         }
-        entry.buffer = buffer;
-        entry.length = buffer.duration;
+      }
+
+      process(inputs, outputs) {
+        if (!this.stream) return this.open;
+        const wasm = this.wasm;
+        const stream = this.stream;
+        const seek = Atomics.load(this.flags, FLAG_SEEK);
+        let moved = false;
+        if (seek !== this.seekSeen) {
+          this.seekSeen = seek;
+          wasm.stream_seek(stream, this.params[PARAM_SEEK_TO]);
+          moved = true;
+        }
+        if (Atomics.load(this.flags, FLAG_PLAYING)) {
+          const out = outputs[0];
+          const frames = out[0].length;
+          const going = wasm.stream_render(stream, frames, Atomics.load(this.flags, FLAG_LOOPED));
+          // The block buffers never move, so the views only need remade if memory grows
+          if (this.heap !== wasm.memory.buffer || this.inL.length !== frames) {
+            this.heap = wasm.memory.buffer;
+            this.inL = new Float32Array(this.heap, wasm.stream_left(stream), frames);
+            this.inR = new Float32Array(this.heap, wasm.stream_right(stream), frames);
+          }
+          const inL = this.inL;
+          const inR = this.inR;
+          // Equal-power stereo pan, as a StereoPannerNode does it
+          const volume = this.params[PARAM_VOLUME];
+          const pan = Math.max(-1, Math.min(1, this.params[PARAM_PAN]));
+          const x = (pan <= 0 ? pan + 1 : pan) * Math.PI / 2;
+          const g1 = Math.cos(x) * volume;
+          const g2 = Math.sin(x) * volume;
+          const outL = out[0];
+          const outR = out.length > 1 ? out[1] : null;
+          for (let i = 0; i < frames; i++) {
+            const l = inL[i];
+            const r = inR[i];
+            let left;
+            let right;
+            if (pan <= 0) {
+              left = l * volume + r * g1;
+              right = r * g2;
+            } else {
+              left = l * g1;
+              right = r * volume + l * g2;
+            }
+            if (outR) {
+              outL[i] = left;
+              outR[i] = right;
+            } else {
+              outL[i] = (left + right) * 0.5;
+            }
+          }
+          if (!going) {
+            Atomics.store(this.flags, FLAG_PLAYING, 0);
+            this.port.postMessage({ type: "ended" });
+          }
+          moved = true;
+        }
+        if (moved) {
+          const position = wasm.stream_position(stream);
+          this.report[REPORT_POSITION] = position;
+          if (!this.shared && ++this.blocks % POSITION_EVERY === 0) {
+            this.port.postMessage({ type: "position", position });
+          }
+        }
+        return true;
+      }
+    }
+
+    registerProcessor("mdh-midi", MidiProcessor);
+  }
+
+  function loadMidiWorklet(ctx) {
+    if (!state.midiWorklet || state.midiWorklet.ctx !== ctx) {
+      const source = "(" + midiProcessorModule.toString() + ")();";
+      const url = URL.createObjectURL(new Blob([source], { type: "text/javascript" }));
+      const worklet = { ctx, synthSent: false, soundfontsSent: new Set(), ready: null };
+      worklet.ready = ctx.audioWorklet.addModule(url)
+        .then(() => worklet)
+        .finally(() => URL.revokeObjectURL(url));
+      state.midiWorklet = worklet;
+    }
+    return state.midiWorklet.ready;
+  }
+
+  // With cross-origin isolation the control block is a SharedArrayBuffer the worklet
+  // reads directly; otherwise each change is posted over and the worklet keeps a copy.
+  function makeMidiControl() {
+    const shared = typeof SharedArrayBuffer !== "undefined"
+      && typeof globalThis !== "undefined"
+      && globalThis.crossOriginIsolated === true;
+    const buffer = shared
+      ? new SharedArrayBuffer(MIDI_CONTROL_BYTES)
+      : new ArrayBuffer(MIDI_CONTROL_BYTES);
+    return {
+      buffer,
+      shared,
+      flags: new Int32Array(buffer, 0, 4),
+      params: new Float32Array(buffer, 16, 4),
+      report: new Float64Array(buffer, 32, 2),
+    };
+  }
+
+  async function streamMidi(entry, midiBuf, sfUrl, sfBuf, synth) {
+    const ctx = ensureCtx();
+    const worklet = await loadMidiWorklet(ctx);
+    if (state.ctx !== ctx || entry.unladed) return;
+    const control = makeMidiControl();
+    control.params[MIDI_PARAM_VOLUME] = entry.volume;
+    control.params[MIDI_PARAM_PAN] = entry.panValue;
+    control.flags[MIDI_FLAG_LOOPED] = entry.looped ? 1 : 0;
+    const node = new AudioWorkletNode(ctx, MIDI_PROCESSOR, {
+      numberOfInputs: 0,
+      numberOfOutputs: 1,
+      outputChannelCount: [2],
+      processorOptions: {
+        control: control.buffer,
+        shared: control.shared,
+        soundfont: sfUrl,
+        midi: midiBuf,
+      },
+    });
+    if (!worklet.synthSent) {
+      worklet.synthSent = true;
+      node.port.postMessage({ type: "synth", bytes: synth.bytes });
+    }
+    if (!worklet.soundfontsSent.has(sfUrl)) {
+      worklet.soundfontsSent.add(sfUrl);
+      node.port.postMessage({ type: "soondfont", key: sfUrl, bytes: sfBuf });
+    }
+    entry.stream = { node, control, position: 0 };
+    node.port.onmessage = (event) => {
+      const msg = event.data || {};
+      if (msg.type === "ready") {
+        entry.length = msg.length;
         entry.ready = true;
+        // Volume and pan are applied in the worklet
+        entry.gain.disconnect();
+        entry.pan.disconnect();
+        node.connect(state.masterGain);
         if (entry.pendingPlay) {
           entry.pendingPlay = false;
-          playBufferEntry(entry);
+          playMidiEntry(entry);
         }
-      })
-      .catch((err) => {
-        queueError(new Error(err && err.message ? err.message : "Cannae read the midi"));
-      });
+      } else if (msg.type === "error") {
+        queueError(new Error(msg.message || "Cannae read the midi"));
+      } else if (msg.type === "ended") {
+        if (entry.state === "playing") {
+          entry.state = "stopped";
+          entry.offset = 0;
+        }
+      } else if (msg.type === "position") {
+        entry.stream.position = msg.position;
+      }
+    };
+  }
+
+  function setMidiFlag(entry, slot, value) {
+    const stream = entry.stream;
+    Atomics.store(stream.control.flags, slot, value);
+    if (!stream.control.shared) {
+      stream.node.port.postMessage({ type: "flag", slot, value });
+    }
+  }
+
+  function setMidiParam(entry, slot, value) {
+    const stream = entry.stream;
+    stream.control.params[slot] = value;
+    if (!stream.control.shared) {
+      stream.node.port.postMessage({ type: "param", slot, value });
+    }
+  }
+
+  function seekMidiStream(entry, seconds) {
+    const stream = entry.stream;
+    // The target goes in before the counter moves, so the worklet never sees a new
+    // seek with the old target
+    setMidiParam(entry, MIDI_PARAM_SEEK_TO, seconds);
+    const seek = Atomics.add(stream.control.flags, MIDI_FLAG_SEEK, 1) + 1;
+    if (!stream.control.shared) {
+      stream.node.port.postMessage({ type: "flag", slot: MIDI_FLAG_SEEK, value: seek });
+    }
+    stream.control.report[MIDI_REPORT_POSITION] = seconds;
+    stream.position = seconds;
+  }
+
+  // The midi_* calls go through these, which play a streaming entry through its
+  // worklet and a pre-rendered one through its buffer
+
+  function playMidiEntry(entry) {
+    if (!entry.stream || !entry.ready) {
+      playBufferEntry(entry);
+      return;
+    }
+    ensureCtx();
+    if (entry.state === "stopped") {
+      seekMidiStream(entry, entry.offset || 0);
+    }
+    setMidiFlag(entry, MIDI_FLAG_PLAYING, 1);
+    entry.state = "playing";
+  }
+
+  function pauseMidiEntry(entry) {
+    if (!entry.stream) {
+      pauseBufferEntry(entry);
+      return;
+    }
+    if (entry.state !== "playing") return;
+    if (entry.ready) setMidiFlag(entry, MIDI_FLAG_PLAYING, 0);
+    entry.pendingPlay = false;
+    entry.state = "paused";
+  }
+
+  function resumeMidiEntry(entry) {
+    if (entry.state !== "paused") return;
+    playMidiEntry(entry);
+  }
+
+  function stopMidiEntry(entry) {
+    if (!entry.stream) {
+      stopBufferEntry(entry);
+      return;
+    }
+    if (entry.ready) setMidiFlag(entry, MIDI_FLAG_PLAYING, 0);
+    entry.pendingPlay = false;
+    entry.state = "stopped";
+    entry.offset = 0;
+  }
+
+  function unloadMidiEntry(entry) {
+    stopMidiEntry(entry);
+    entry.unladed = true;
+    if (entry.stream) {
+      entry.stream.node.port.postMessage({ type: "close" });
+      try { entry.stream.node.disconnect(); } catch (_) {}
+    }
+  }
+
+  function midiPosition(entry) {
+    if (entry.stream && entry.ready && entry.state !== "stopped") {
+      const control = entry.stream.control;
+      return control.shared ? control.report[MIDI_REPORT_POSITION] : entry.stream.position;
+    }
+    if (entry.stream || entry.state !== "playing") return entry.offset || 0;
+    const ctx = ensureCtx();
+    return (entry.offset || 0) + Math.max(0, ctx.currentTime - entry.startTime);
   }
 
   function makeMusicEntry(path) {
@@ -315,7 +720,11 @@ const __havers_audio = (() => {
       if (!exports || !exports.memory || !exports.alloc || !exports.render_midi) {
         throw new Error("MIDI synth isnae richt");
       }
-      return exports;
+      // Old builds of the synth can only render a song whole
+      const streams = typeof exports.soundfont_load === "function"
+        && typeof exports.stream_open === "function"
+        && typeof exports.stream_render === "function";
+      return { bytes: wasmBuf, exports, streams };
     })();
     return rustysynthPromise;
   }
@@ -391,11 +800,12 @@ const __havers_audio = (() => {
         try { entry.audio.currentTime = 0; } catch (_) {}
       }
       for (const entry of state.midi.values()) {
-        stopBufferEntry(entry);
+        unloadMidiEntry(entry);
       }
       state.sounds.clear();
       state.music.clear();
       state.midi.clear();
+      state.midiWorklet = null;
       if (state.ctx) {
         const ctx = state.ctx;
         state.ctx = null;
@@ -627,31 +1037,31 @@ const __havers_audio = (() => {
     midi_spiel(handle) {
       if (typeof handle !== "number") throw new Error("midi_spiel needs a guid handle");
       const entry = ensureMidi(handle);
-      playBufferEntry(entry);
+      playMidiEntry(entry);
       return null;
     },
     midi_haud(handle) {
       if (typeof handle !== "number") throw new Error("midi_haud needs a guid handle");
       const entry = ensureMidi(handle);
-      pauseBufferEntry(entry);
+      pauseMidiEntry(entry);
       return null;
     },
     midi_gae_on(handle) {
       if (typeof handle !== "number") throw new Error("midi_gae_on needs a guid handle");
       const entry = ensureMidi(handle);
-      resumeBufferEntry(entry);
+      resumeMidiEntry(entry);
       return null;
     },
     midi_stap(handle) {
       if (typeof handle !== "number") throw new Error("midi_stap needs a guid handle");
       const entry = ensureMidi(handle);
-      stopBufferEntry(entry);
+      stopMidiEntry(entry);
       return null;
     },
     midi_unlade(handle) {
       if (typeof handle !== "number") throw new Error("midi_unlade needs a guid handle");
       const entry = ensureMidi(handle);
-      stopBufferEntry(entry);
+      unloadMidiEntry(entry);
       state.midi.delete(handle);
       return null;
     },
@@ -665,7 +1075,9 @@ const __havers_audio = (() => {
       if (typeof seconds !== "number") throw new Error("midi_loup needs a nummer");
       const entry = ensureMidi(handle);
       entry.offset = Math.max(0, seconds || 0);
-      if (entry.state === "playing") {
+      if (entry.stream && entry.ready) {
+        if (entry.state !== "stopped") seekMidiStream(entry, entry.offset);
+      } else if (entry.state === "playing") {
         stopBufferEntry(entry);
         playBufferEntry(entry);
       }
@@ -679,15 +1091,14 @@ const __havers_audio = (() => {
     midi_whaur(handle) {
       if (typeof handle !== "number") throw new Error("midi_whaur needs a guid handle");
       const entry = ensureMidi(handle);
-      if (entry.state !== "playing") return entry.offset || 0;
-      const ctx = ensureCtx();
-      return (entry.offset || 0) + Math.max(0, ctx.currentTime - entry.startTime);
+      return midiPosition(entry);
     },
     midi_pit_luid(handle, v) {
       if (typeof handle !== "number") throw new Error("midi_pit_luid needs a guid handle");
       if (typeof v !== "number") throw new Error("midi_pit_luid needs a nummer");
       const entry = ensureMidi(handle);
       entry.volume = clamp01(v);
+      if (entry.stream) setMidiParam(entry, MIDI_PARAM_VOLUME, entry.volume);
       if (entry.gain) entry.gain.gain.value = entry.volume;
       return null;
     },
@@ -696,6 +1107,7 @@ const __havers_audio = (() => {
       if (typeof v !== "number") throw new Error("midi_pit_pan needs a nummer");
       const entry = ensureMidi(handle);
       entry.panValue = v;
+      if (entry.stream) setMidiParam(entry, MIDI_PARAM_PAN, v);
       if (entry.pan && typeof entry.pan.pan !== "undefined") {
         entry.pan.pan.value = v;
       }
@@ -706,6 +1118,7 @@ const __havers_audio = (() => {
       if (typeof on !== "boolean") throw new Error("midi_pit_rin_roond needs aye or nae");
       const entry = ensureMidi(handle);
       entry.looped = on;
+      if (entry.stream) setMidiFlag(entry, MIDI_FLAG_LOOPED, on ? 1 : 0);
       if (entry.source) entry.source.loop = on;
       return null;
     },
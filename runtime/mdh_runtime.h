@@ -10,6 +10,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 /* Value type tags - must match src/llvm/types.rs */
 typedef enum {
@@ -42,30 +43,72 @@ typedef struct {
     int64_t data;  /* Can be cast to pointer or numeric types */
 } MdhValue;
 
+/*
+ * Packed 8-byte form of an MdhValue, used where the runtime stores values for
+ * itself (channel rings) so a cell costs one word instead of two. Compiled code,
+ * lists, dicts and every runtime call still use the 16-byte MdhValue above.
+ *
+ * Floats keep their IEEE bits, with every NaN folded to one positive quiet NaN,
+ * so the negative-NaN space (top 12 bits all set) is free for everything else:
+ *   bits 63..52  0xFFF
+ *   bits 51..48  tag + 1, or 0 for a value boxed on the GC heap
+ *   bits 47..0   payload: pointer, bool, or integer in [-2^47, 2^47)
+ * -Infinity is 0xFFF0000000000000 (box code with a null payload). Values that do
+ * not fit (large integers, pointers above 2^48) are boxed. A collector scanning
+ * packed words must mask off the top 16 bits; gc_marksweep.c does, Boehm's libgc
+ * does not, so builds against libgc need -DMDH_PACKED_VALUES=0.
+ *
+ * -DMDH_PACKED_VALUES=0 keeps full MdhValues in those cells instead. The runtime
+ * Makefile (which links libgc) builds that way unless given PACKED_VALUES=1; the
+ * cargo build packs unless MDH_PACKED_VALUES=0 is set in its environment.
+ */
+#ifndef MDH_PACKED_VALUES
+#define MDH_PACKED_VALUES 1
+#endif
+
+typedef uint64_t MdhPacked;
+
+#define MDH_PACKED_TOP 0xFFF0000000000000ULL
+#define MDH_PACKED_PAYLOAD 0x0000FFFFFFFFFFFFULL
+#define MDH_PACKED_CANON_NAN 0x7FF8000000000000ULL
+
 /* Forward declarations for complex types */
 typedef struct MdhList MdhList;
 typedef struct MdhDict MdhDict;
 typedef struct MdhString MdhString;
 typedef struct MdhBytes MdhBytes;
 
-/* List structure */
+/* List structure. A slice may point into its parent's items; both then carry
+ * capacity MDH_LIST_SHARED and copy their items before writing to them. */
 struct MdhList {
     MdhValue *items;
     int64_t length;
     int64_t capacity;
 };
 
-/* String structure (GC-managed) */
+#define MDH_LIST_SHARED (-1)
+
+/* String header (GC-managed).
+ * A string value is always a NUL-terminated char*, but strings built by the runtime are
+ * allocated as [MdhString][bytes...\0] with the value pointing at the bytes. The header is
+ * recognised by the pointer being 8 mod 16 and the magic matching the pointer's address, so
+ * literals and codegen-built buffers (no header) are still valid strings and fall back to
+ * strlen. Layout must match STRING_HEADER_* in src/llvm/types.rs. */
 struct MdhString {
-    char *data;
     int64_t length;
+    uint32_t hash;   /* cached content hash, 0 = not computed yet */
+    uint32_t magic;  /* MDH_STRING_MAGIC ^ (uint32_t)(bytes >> 3) */
 };
 
-/* Bytes structure (GC-managed) */
+#define MDH_STRING_MAGIC 0xFF5A17E5u
+
+/* Bytes structure (GC-managed). A slice may point into its parent's buffer;
+ * both then carry `shared` and copy their data before writing to it. */
 struct MdhBytes {
     uint8_t *data;
     int64_t length;
     int64_t capacity;
+    bool shared;
 };
 
 /* ========== Value Creation ========== */
@@ -77,6 +120,39 @@ MdhValue __mdh_make_float(double value);
 MdhValue __mdh_make_string(const char *value);
 MdhValue __mdh_make_list(int32_t capacity);
 
+/* Total bytes duplicated by __mdh_make_string (reported at exit when MDH_STRING_STATS is set) */
+int64_t __mdh_string_copy_bytes(void);
+
+/* runtime_stats(): allocation, growth, hurl, channel and event loop counts over all threads
+ * (also dumped at exit when MDH_STATS=1) */
+MdhValue __mdh_runtime_stats(void);
+
+/* gc_config(opts), gc_collect() and gc_stats(): tune, run and measure the collector
+ * (mark-sweep builds; the stub accepts the calls and reports zeros) */
+MdhValue __mdh_gc_config(MdhValue opts);
+MdhValue __mdh_gc_collect(void);
+MdhValue __mdh_gc_stats(void);
+
+/* Counters of an instrumented build (mdhavers build --pgo-gen), written at exit to
+ * $MDH_PROFILE_FILE (default.mdhprof) for --pgo-use */
+void __mdh_pgo_register(uint64_t *counters, int64_t count, int64_t checksum);
+
+/* Heap profile of a --heap-prof build: codegen stores each statement's site id in
+ * __mdh_heapprof_site and brackets user functions with enter/leave; main registers the
+ * site names. Written to $MDH_HEAPPROF at exit when that is set. */
+extern __thread int64_t __mdh_heapprof_site;
+void __mdh_heapprof_enter(void);
+void __mdh_heapprof_leave(void);
+void __mdh_heapprof_register(const char *names, int64_t count);
+
+/* Stack traces: main registers every user function's address, name and file (NUL-separated
+ * pairs) and line. Codegen keeps them in the mdh_text section and with frame pointers. */
+void __mdh_frames_register(void *const *code, const char *names, const int64_t *lines, int64_t count);
+
+/* CPU profile of a --profile build, which has the same sites: samples the running stack
+ * of lines on SIGPROF and writes it to $MDH_CPUPROF (default cpu.folded) at exit */
+void __mdh_cpuprof_start(void);
+
 /* ========== Arithmetic Operations ========== */
 
 MdhValue __mdh_add(MdhValue a, MdhValue b);
@@ -126,6 +202,10 @@ MdhValue __mdh_tri_module(void);
 /* ========== I/O ========== */
 
 void __mdh_blether(MdhValue a);
+void __mdh_blether_str(const char *s);
+void __mdh_blether_int(int64_t n);
+void __mdh_blether_float(double x);
+MdhValue __mdh_flush(void);
 MdhValue __mdh_speir(MdhValue prompt);
 MdhValue __mdh_get_key(void);
 
@@ -134,6 +214,12 @@ MdhValue __mdh_get_key(void);
 MdhValue __mdh_list_get(MdhValue list, int64_t index);
 void __mdh_list_set(MdhValue list, int64_t index, MdhValue value);
 void __mdh_list_push(MdhValue list, MdhValue value);
+void __mdh_list_unshare(MdhList *list);
+void __mdh_list_append_n(MdhList *list, const MdhValue *items, int64_t n);
+MdhValue __mdh_list_with_capacity(MdhValue n);
+MdhValue __mdh_list_reserve(MdhValue list, MdhValue n);
+MdhValue __mdh_list_extend(MdhValue list, MdhValue other);
+MdhValue __mdh_list_concat(MdhValue a, MdhValue b);
 MdhValue __mdh_list_pop(MdhValue list);
 int64_t __mdh_list_len(MdhValue list);
 int64_t __mdh_len(MdhValue a);
@@ -143,6 +229,8 @@ MdhValue __mdh_range(int64_t start, int64_t end, int64_t step);
 
 MdhValue __mdh_str_concat(MdhValue a, MdhValue b);
 int64_t __mdh_str_len(MdhValue s);
+MdhValue __mdh_str_char_at(MdhValue str, int64_t index);
+int64_t __mdh_str_char_count(MdhValue str);
 MdhValue __mdh_to_string(MdhValue a);
 MdhValue __mdh_to_int(MdhValue a);
 MdhValue __mdh_to_float(MdhValue a);
@@ -158,8 +246,34 @@ MdhValue __mdh_bytes_set(MdhValue bytes, MdhValue index, MdhValue value);
 MdhValue __mdh_bytes_append(MdhValue bytes, MdhValue other);
 MdhValue __mdh_bytes_read_u16be(MdhValue bytes, MdhValue offset);
 MdhValue __mdh_bytes_read_u32be(MdhValue bytes, MdhValue offset);
+MdhValue __mdh_bytes_read_u64be(MdhValue bytes, MdhValue offset);
+MdhValue __mdh_bytes_read_u16le(MdhValue bytes, MdhValue offset);
+MdhValue __mdh_bytes_read_u32le(MdhValue bytes, MdhValue offset);
+MdhValue __mdh_bytes_read_u64le(MdhValue bytes, MdhValue offset);
 MdhValue __mdh_bytes_write_u16be(MdhValue bytes, MdhValue offset, MdhValue value);
 MdhValue __mdh_bytes_write_u32be(MdhValue bytes, MdhValue offset, MdhValue value);
+MdhValue __mdh_bytes_write_u64be(MdhValue bytes, MdhValue offset, MdhValue value);
+MdhValue __mdh_bytes_write_u16le(MdhValue bytes, MdhValue offset, MdhValue value);
+MdhValue __mdh_bytes_write_u32le(MdhValue bytes, MdhValue offset, MdhValue value);
+MdhValue __mdh_bytes_write_u64le(MdhValue bytes, MdhValue offset, MdhValue value);
+MdhValue __mdh_bytes_find(MdhValue haystack, MdhValue needle);
+MdhValue __mdh_bytes_eq(MdhValue a, MdhValue b);
+MdhValue __mdh_bytes_xor(MdhValue data, MdhValue key);
+MdhValue __mdh_bytes_fill(MdhValue bytes, MdhValue value, MdhValue start, MdhValue end);
+MdhValue __mdh_bytes_copy_within(MdhValue bytes, MdhValue dst, MdhValue start, MdhValue end);
+MdhValue __mdh_bytes_pool_take(MdhValue size);
+MdhValue __mdh_bytes_pool_give(MdhValue bytes);
+
+/* ========== Codecs + Digests ========== */
+
+MdhValue __mdh_base64_encode(MdhValue data);
+MdhValue __mdh_base64_decode(MdhValue text, MdhValue as_string);
+MdhValue __mdh_hex_encode(MdhValue data);
+MdhValue __mdh_hex_decode(MdhValue text, MdhValue as_string);
+MdhValue __mdh_sha256(MdhValue data);
+MdhValue __mdh_sha1(MdhValue data);
+MdhValue __mdh_crc32(MdhValue data);
+MdhValue __mdh_xxhash64(MdhValue data);
 
 /* ========== Math ========== */
 
@@ -167,6 +281,9 @@ MdhValue __mdh_abs(MdhValue a);
 MdhValue __mdh_random(int64_t min, int64_t max);
 MdhValue __mdh_jammy(MdhValue min, MdhValue max);
 MdhValue __mdh_random_int(MdhValue min, MdhValue max);
+MdhValue __mdh_random_float(void);
+MdhValue __mdh_seed(MdhValue seed);
+MdhValue __mdh_random_list(MdhValue n, MdhValue lo, MdhValue hi);
 MdhValue __mdh_floor(MdhValue a);
 MdhValue __mdh_ceil(MdhValue a);
 MdhValue __mdh_round(MdhValue a);
@@ -242,29 +359,67 @@ MdhValue __mdh_socket_set_nodelay(MdhValue sock, MdhValue on);
 MdhValue __mdh_socket_set_rcvbuf(MdhValue sock, MdhValue bytes);
 MdhValue __mdh_socket_set_sndbuf(MdhValue sock, MdhValue bytes);
 MdhValue __mdh_socket_close(MdhValue sock);
+MdhValue __mdh_addr_resolve(MdhValue host, MdhValue port);
 
 MdhValue __mdh_udp_send_to(MdhValue sock, MdhValue buf, MdhValue host, MdhValue port);
 MdhValue __mdh_udp_recv_from(MdhValue sock, MdhValue max_len);
+MdhValue __mdh_udp_recv_many(MdhValue sock, MdhValue max_packets, MdhValue max_len);
+MdhValue __mdh_udp_send_many(MdhValue sock, MdhValue packets);
 MdhValue __mdh_tcp_send(MdhValue sock, MdhValue buf);
+MdhValue __mdh_tcp_send_vec(MdhValue sock, MdhValue parts);
+MdhValue __mdh_tcp_send_all(MdhValue sock, MdhValue data);
+MdhValue __mdh_socket_send_file(MdhValue sock, MdhValue path, MdhValue offset, MdhValue len);
 MdhValue __mdh_tcp_recv(MdhValue sock, MdhValue max_len);
+MdhValue __mdh_tcp_recv_into(MdhValue sock, MdhValue bytes, MdhValue offset);
+MdhValue __mdh_udp_recv_into(MdhValue sock, MdhValue bytes);
 
 MdhValue __mdh_dns_lookup(MdhValue host);
 MdhValue __mdh_dns_srv(MdhValue service, MdhValue domain);
 MdhValue __mdh_dns_naptr(MdhValue domain);
+MdhValue __mdh_dns_lookup_async(MdhValue host);
+MdhValue __mdh_dns_srv_async(MdhValue service, MdhValue domain);
+MdhValue __mdh_dns_naptr_async(MdhValue domain);
 
 /* ========== TLS/DTLS/SRTP ========== */
 
 MdhValue __mdh_tls_client_new(MdhValue config);
 MdhValue __mdh_tls_connect(MdhValue tls, MdhValue sock);
+MdhValue __mdh_tls_connect_start(MdhValue tls, MdhValue sock);
+MdhValue __mdh_tls_step(MdhValue tls);
 MdhValue __mdh_tls_send(MdhValue tls, MdhValue buf);
 MdhValue __mdh_tls_recv(MdhValue tls, MdhValue max_len);
 MdhValue __mdh_tls_close(MdhValue tls);
+MdhValue __mdh_tls_stats(void);
 
 MdhValue __mdh_dtls_server_new(MdhValue config);
 MdhValue __mdh_dtls_handshake(MdhValue dtls, MdhValue sock);
+MdhValue __mdh_dtls_session_new(MdhValue dtls);
+MdhValue __mdh_dtls_session_step(MdhValue session, MdhValue datagram);
+MdhValue __mdh_dtls_session_srtp(MdhValue session);
+MdhValue __mdh_dtls_session_close(MdhValue session);
 MdhValue __mdh_srtp_create(MdhValue keys);
 MdhValue __mdh_srtp_protect(MdhValue srtp, MdhValue rtp_packet);
 MdhValue __mdh_srtp_unprotect(MdhValue srtp, MdhValue rtp_packet);
+MdhValue __mdh_srtp_protect_into(MdhValue srtp, MdhValue rtp_packet);
+MdhValue __mdh_srtp_unprotect_into(MdhValue srtp, MdhValue srtp_packet);
+MdhValue __mdh_srtp_protect_many(MdhValue srtp, MdhValue packets);
+MdhValue __mdh_srtp_unprotect_many(MdhValue srtp, MdhValue packets);
+
+/* ========== RTP ========== */
+
+/* rtp_parse_native(packet) -> rtp_header object (payload is a view of the packet),
+ * or {"ok": nae, "error", "len"} when the packet is too short */
+MdhValue __mdh_rtp_parse_native(MdhValue packet);
+MdhValue __mdh_rtp_build_native(MdhValue payload, MdhValue seq, MdhValue timestamp,
+                                MdhValue ssrc, MdhValue payload_type, MdhValue marker,
+                                MdhValue csrcs);
+
+/* ========== SIP ========== */
+
+/* sip_parse_native(msg) -> sip_message object whose fields and headers are spans of the
+ * message, or {"type": "invalid", "raw"}; sip_header(msg_or_headers, name) -> value or nil */
+MdhValue __mdh_sip_parse_native(MdhValue msg);
+MdhValue __mdh_sip_header(MdhValue msg, MdhValue name);
 
 /* ========== Event Loop + Timers ========== */
 
@@ -274,15 +429,92 @@ MdhValue __mdh_event_watch_read(MdhValue loop, MdhValue sock, MdhValue callback)
 MdhValue __mdh_event_watch_write(MdhValue loop, MdhValue sock, MdhValue callback);
 MdhValue __mdh_event_unwatch(MdhValue loop, MdhValue sock);
 MdhValue __mdh_event_loop_poll(MdhValue loop, MdhValue timeout_ms);
+MdhValue __mdh_event_loop_poll_into(MdhValue loop, MdhValue events, MdhValue timeout_ms);
+MdhValue __mdh_event_loop_run(MdhValue loop, MdhValue timeout_ms);
 MdhValue __mdh_timer_after(MdhValue loop, MdhValue ms, MdhValue callback);
 MdhValue __mdh_timer_every(MdhValue loop, MdhValue ms, MdhValue callback);
 MdhValue __mdh_timer_cancel(MdhValue loop, MdhValue timer_id);
+/* Nanosecond forms; timer_every_ns keeps ticks on the start + k * interval grid */
+MdhValue __mdh_timer_after_ns(MdhValue loop, MdhValue ns, MdhValue callback);
+MdhValue __mdh_timer_every_ns(MdhValue loop, MdhValue ns, MdhValue callback);
+/* Safe from any thread: wake a blocked poll, or queue callback as a "post" event */
+MdhValue __mdh_event_loop_wakeup(MdhValue loop);
+MdhValue __mdh_event_loop_post(MdhValue loop, MdhValue callback);
+
+/* ========== Reactors ========== */
+
+/* reactor_start(opts, setup) -> result with {"loops", "threads"}: one loop per thread,
+ * each with its own SO_REUSEPORT socket on opts["port"], set up by setup(loop, sock, index) */
+MdhValue __mdh_reactor_start(MdhValue opts, MdhValue setup);
+MdhValue __mdh_reactor_stop(MdhValue reactors);
+
+/* ========== Coroutines ========== */
+
+/* co_spawn(loop, func, args) -> channel that gets func's result; socket reads, chan_recv
+ * and sleep inside it park on the loop instead of blocking the thread */
+MdhValue __mdh_co_spawn(MdhValue loop, MdhValue func, MdhValue args);
+MdhValue __mdh_co_yield(void);
+MdhValue __mdh_co_count(MdhValue loop);
+MdhValue __mdh_co_run(MdhValue loop);
+struct timespec;
+int __mdh_nanosleep(const struct timespec *req, struct timespec *rem);
+
+/* ========== Shared-memory rings ========== */
+
+/* shm_ring_create(name, size) / shm_ring_open(name) -> result with a ring mapped by
+ * other processes; many senders, one receiver, frames copied straight in and out */
+MdhValue __mdh_shm_ring_create(MdhValue name, MdhValue size);
+MdhValue __mdh_shm_ring_open(MdhValue name);
+MdhValue __mdh_shm_ring_send(MdhValue ring, MdhValue data);
+MdhValue __mdh_shm_ring_recv(MdhValue ring, MdhValue timeout_ms);
+MdhValue __mdh_shm_ring_recv_into(MdhValue ring, MdhValue bytes);
+MdhValue __mdh_shm_ring_fd(MdhValue ring);
+MdhValue __mdh_shm_ring_close(MdhValue ring);
+
+/* ========== Key-value store ========== */
+
+/* kv_open(path) -> result with a store of string keys to packed values, kept in a log
+ * that's synced in groups and indexed in key order */
+MdhValue __mdh_kv_open(MdhValue path);
+MdhValue __mdh_kv_get(MdhValue db, MdhValue key);
+MdhValue __mdh_kv_put(MdhValue db, MdhValue key, MdhValue value);
+MdhValue __mdh_kv_delete(MdhValue db, MdhValue key);
+MdhValue __mdh_kv_scan(MdhValue db, MdhValue from, MdhValue to, MdhValue limit);
+MdhValue __mdh_kv_sync(MdhValue db);
+MdhValue __mdh_kv_compact(MdhValue db);
+MdhValue __mdh_kv_stats(MdhValue db);
+MdhValue __mdh_kv_close(MdhValue db);
+
+/* ========== HTTP Server ========== */
+
+/* http_parse_native(buf) -> http_message, tokenised like sip_parse_native but with HTTP/1.1
+ * framing; http_serve(loop, listener, handler) answers keep-alive and pipelined requests
+ * on the loop, calling handler(request) for each and writing back what it returns */
+MdhValue __mdh_http_parse_native(MdhValue msg);
+MdhValue __mdh_http_serve(MdhValue loop, MdhValue listener, MdhValue handler);
+
+/* ========== HTTP Client ========== */
+
+/* http_request(req) -> result with an http_response; req is {"method", "url", "headers",
+ * "body", "timeout", "tls"}. Connections are pooled per scheme, host and port and kept
+ * alive between calls; http_pool_config(opts) sets "idle_ms" and "max_per_host" */
+MdhValue __mdh_http_request(MdhValue req);
+MdhValue __mdh_http_pool_config(MdhValue opts);
+MdhValue __mdh_http_pool_stats(void);
 
 /* ========== Threads + Sync ========== */
 
 MdhValue __mdh_thread_spawn(MdhValue func, MdhValue args_list);
+/* opts: "cpus" (core or list), "priority" (SCHED_FIFO), "stack_kb", "name" */
+MdhValue __mdh_thread_spawn_opts(MdhValue func, MdhValue args_list, MdhValue opts);
+MdhValue __mdh_cpu_count(void);
+MdhValue __mdh_numa_node_of_cpu(MdhValue cpu);
 MdhValue __mdh_thread_join(MdhValue thread_handle);
 MdhValue __mdh_thread_detach(MdhValue thread_handle);
+MdhValue __mdh_pool_submit(MdhValue func, MdhValue args);
+MdhValue __mdh_parallel_map(MdhValue list, MdhValue fn, MdhValue chunk);
+MdhValue __mdh_parallel_filter(MdhValue list, MdhValue fn, MdhValue chunk);
+MdhValue __mdh_parallel_reduce(MdhValue list, MdhValue fn, MdhValue initial, MdhValue chunk);
 
 MdhValue __mdh_mutex_new(void);
 MdhValue __mdh_mutex_lock(MdhValue mutex);
@@ -300,16 +532,31 @@ MdhValue __mdh_atomic_load(MdhValue atomic);
 MdhValue __mdh_atomic_store(MdhValue atomic, MdhValue value);
 MdhValue __mdh_atomic_add(MdhValue atomic, MdhValue delta);
 MdhValue __mdh_atomic_cas(MdhValue atomic, MdhValue expected, MdhValue desired);
+MdhValue __mdh_atomic_load_acquire(MdhValue atomic);
+MdhValue __mdh_atomic_store_release(MdhValue atomic, MdhValue value);
+MdhValue __mdh_atomic_fetch_max(MdhValue atomic, MdhValue value);
+MdhValue __mdh_atomic_fetch_min(MdhValue atomic, MdhValue value);
 
 MdhValue __mdh_chan_new(MdhValue capacity_int);
 MdhValue __mdh_chan_send(MdhValue chan, MdhValue value);
 MdhValue __mdh_chan_recv(MdhValue chan);
 MdhValue __mdh_chan_try_recv(MdhValue chan);
+MdhValue __mdh_chan_recv_timeout(MdhValue chan, MdhValue timeout_ms);
+MdhValue __mdh_chan_send_many(MdhValue chan, MdhValue list);
+MdhValue __mdh_chan_recv_many(MdhValue chan, MdhValue max_count);
 MdhValue __mdh_chan_close(MdhValue chan);
 MdhValue __mdh_chan_is_closed(MdhValue chan);
+MdhValue __mdh_chan_select(MdhValue chans, MdhValue timeout_ms);
+MdhValue __mdh_chan_fd(MdhValue chan);
 
 /* ========== Dict/Creel Operations ========== */
 
+/* Dicts with at least this many entries are looked up through a hash index - must match src/llvm/types.rs */
+#define MDH_DICT_INDEX_MIN 8
+
+MdhValue __mdh_dict_with_capacity(int64_t cap);
+MdhValue __mdh_dict_sized(MdhValue n);
+MdhValue __mdh_dict_update(MdhValue dict, MdhValue other);
 MdhValue __mdh_empty_dict(void);
 MdhValue __mdh_empty_creel(void);
 MdhValue __mdh_make_creel(MdhValue list);
@@ -318,6 +565,7 @@ MdhValue __mdh_set_contains(MdhValue set, MdhValue key);
 MdhValue __mdh_dict_keys(MdhValue dict);
 MdhValue __mdh_dict_values(MdhValue dict);
 MdhValue __mdh_dict_set(MdhValue dict, MdhValue key, MdhValue value);
+MdhValue __mdh_dict_push_new(MdhValue dict, MdhValue key, MdhValue value);
 MdhValue __mdh_dict_get(MdhValue dict, MdhValue key);
 MdhValue __mdh_dict_get_default(MdhValue dict, MdhValue key, MdhValue default_val);
 MdhValue __mdh_dict_merge(MdhValue a, MdhValue b);
@@ -345,8 +593,20 @@ MdhValue __mdh_is_dir(MdhValue path);
 MdhValue __mdh_slurp(MdhValue path);
 MdhValue __mdh_scrieve(MdhValue path, MdhValue content);
 MdhValue __mdh_scrieve_append(MdhValue path, MdhValue content);
+MdhValue __mdh_file_open(MdhValue path, MdhValue mode, MdhValue buffer);
+MdhValue __mdh_file_write(MdhValue handle, MdhValue data);
+MdhValue __mdh_file_write_lines(MdhValue handle, MdhValue lines);
+MdhValue __mdh_file_flush(MdhValue handle);
+MdhValue __mdh_file_close(MdhValue handle);
+MdhValue __mdh_slurp_bytes(MdhValue path, MdhValue offset, MdhValue length);
+MdhValue __mdh_scrieve_bytes(MdhValue path, MdhValue data);
 MdhValue __mdh_lines(MdhValue path);
+MdhValue __mdh_file_map(MdhValue path);
+MdhValue __mdh_lines_iter(MdhValue path);
+MdhValue __mdh_lines_next(MdhValue reader);
+MdhValue __mdh_lines_close(MdhValue reader);
 MdhValue __mdh_words(MdhValue str);
+MdhValue __mdh_split(MdhValue str, MdhValue delim);
 
 /* ========== Logging/Debug ========== */
 
@@ -367,9 +627,13 @@ MdhValue __mdh_log_span_enter(MdhValue span);
 MdhValue __mdh_log_span_exit(MdhValue span);
 MdhValue __mdh_log_span_current(void);
 MdhValue __mdh_log_span_in(MdhValue span, MdhValue func);
+MdhValue __mdh_log_span_stats(void);
+MdhValue __mdh_log_span_export(MdhValue path, MdhValue format);
 MdhValue __mdh_log_set_callback(MdhValue func);
 MdhValue __mdh_log_get_callback(void);
 MdhValue __mdh_log_init(MdhValue config);
+MdhValue __mdh_log_flush(void);
+MdhValue __mdh_log_dropped(void);
 
 /* ========== Scots Builtins ========== */
 
@@ -401,19 +665,108 @@ MdhValue __mdh_list_clear(MdhValue list);
 MdhValue __mdh_last_index_of(MdhValue str, MdhValue substr);
 MdhValue __mdh_replace_first(MdhValue str, MdhValue old_sub, MdhValue new_sub);
 MdhValue __mdh_unique(MdhValue list);
+MdhValue __mdh_list_sort_by_keys(MdhValue list, MdhValue keys);
 MdhValue __mdh_average(MdhValue list);
+MdhValue __mdh_int_array(MdhValue src);
+MdhValue __mdh_float_array(MdhValue src);
+MdhValue __mdh_array_tae_list(MdhValue array);
+MdhValue __mdh_array_sum(MdhValue array);
+MdhValue __mdh_array_average(MdhValue array);
+MdhValue __mdh_array_min(MdhValue array);
+MdhValue __mdh_array_max(MdhValue array);
+MdhValue __mdh_array_dot(MdhValue a, MdhValue b);
+MdhValue __mdh_array_add(MdhValue a, MdhValue b);
+MdhValue __mdh_array_sub(MdhValue a, MdhValue b);
+MdhValue __mdh_array_mul(MdhValue a, MdhValue b);
+MdhValue __mdh_array_div(MdhValue a, MdhValue b);
 MdhValue __mdh_chynge(MdhValue str, MdhValue old_sub, MdhValue new_sub);
 
+/* ========== Deques + Heaps ========== */
+
+MdhValue __mdh_deque_new(void);
+MdhValue __mdh_deque_push_back(MdhValue deque, MdhValue item);
+MdhValue __mdh_deque_push_front(MdhValue deque, MdhValue item);
+MdhValue __mdh_deque_pop_front(MdhValue deque);
+MdhValue __mdh_deque_pop_back(MdhValue deque);
+MdhValue __mdh_deque_front(MdhValue deque);
+MdhValue __mdh_deque_back(MdhValue deque);
+MdhValue __mdh_deque_clear(MdhValue deque);
+MdhValue __mdh_deque_tae_list(MdhValue deque);
+MdhValue __mdh_heap_new(MdhValue key_fn);
+MdhValue __mdh_heap_push(MdhValue heap, MdhValue item);
+MdhValue __mdh_heap_pop(MdhValue heap);
+MdhValue __mdh_heap_peek(MdhValue heap);
+MdhValue __mdh_heap_tae_list(MdhValue heap);
+MdhValue __mdh_native_iter_list(MdhValue v);
+
+/* ========== Hash Maps + Memoize ========== */
+
+MdhValue __mdh_hash(MdhValue v);
+MdhValue __mdh_hashmap_new(void);
+MdhValue __mdh_hashmap_set(MdhValue map, MdhValue key, MdhValue value);
+MdhValue __mdh_hashmap_get(MdhValue map, MdhValue key, MdhValue fallback);
+MdhValue __mdh_hashmap_has(MdhValue map, MdhValue key);
+MdhValue __mdh_hashmap_remove(MdhValue map, MdhValue key);
+MdhValue __mdh_hashmap_keys(MdhValue map);
+MdhValue __mdh_memoize(MdhValue fn, MdhValue max_entries);
+
+/* ========== Frozen Dicts + Lists ========== */
+
+MdhValue __mdh_frozen_dict_new(MdhValue dict);
+MdhValue __mdh_frozen_list_new(MdhValue list);
+MdhValue __mdh_frozen_set(MdhValue frozen, MdhValue key, MdhValue value);
+MdhValue __mdh_frozen_remove(MdhValue frozen, MdhValue key);
+MdhValue __mdh_frozen_push(MdhValue frozen, MdhValue item);
+MdhValue __mdh_thaw(MdhValue frozen);
+
+/* ========== Dense Matrices ========== */
+
+MdhValue __mdh_mat_from_rows(MdhValue rows);
+MdhValue __mdh_mat_tae_rows(MdhValue matrix);
+MdhValue __mdh_mat_new(MdhValue rows, MdhValue cols, MdhValue fill);
+MdhValue __mdh_mat_identity(MdhValue size);
+MdhValue __mdh_mat_shape(MdhValue matrix);
+MdhValue __mdh_mat_get(MdhValue matrix, MdhValue row, MdhValue col);
+MdhValue __mdh_mat_set(MdhValue matrix, MdhValue row, MdhValue col, MdhValue value);
+MdhValue __mdh_mat_add(MdhValue a, MdhValue b);
+MdhValue __mdh_mat_sub(MdhValue a, MdhValue b);
+MdhValue __mdh_mat_scale(MdhValue matrix, MdhValue scalar);
+MdhValue __mdh_mat_transpose(MdhValue matrix);
+MdhValue __mdh_mat_matmul(MdhValue a, MdhValue b);
+MdhValue __mdh_mat_solve(MdhValue a, MdhValue b);
+MdhValue __mdh_mat_det(MdhValue matrix);
+
+/* ========== Table Helpers ========== */
+
+MdhValue __mdh_table_parse_csv(MdhValue text);
+MdhValue __mdh_table_join(MdhValue left, MdhValue left_cols, MdhValue right, MdhValue right_cols,
+                          MdhValue on, MdhValue keep_unmatched);
+MdhValue __mdh_table_group(MdhValue rows, MdhValue col);
+MdhValue __mdh_table_widths(MdhValue rows, MdhValue columns);
+
+/* ========== String Builders ========== */
+
+MdhValue __mdh_strbuf_new(void);
+MdhValue __mdh_strbuf_append(MdhValue builder, MdhValue value);
+MdhValue __mdh_strbuf_append_int(MdhValue builder, MdhValue value);
+MdhValue __mdh_strbuf_append_float(MdhValue builder, MdhValue value);
+MdhValue __mdh_strbuf_len(MdhValue builder);
+MdhValue __mdh_strbuf_clear(MdhValue builder);
+MdhValue __mdh_strbuf_build(MdhValue builder);
+
 /* ========== Testing ========== */
 
 MdhValue __mdh_assert(MdhValue condition, MdhValue msg);
 MdhValue __mdh_skip(MdhValue reason);
 MdhValue __mdh_stacktrace(void);
+MdhValue __mdh_hurl_stacktrace(void);
 
 /* ========== Additional Scots Builtins ========== */
 
 MdhValue __mdh_muckle(MdhValue a, MdhValue b);
 MdhValue __mdh_median(MdhValue list);
+MdhValue __mdh_percentile(MdhValue list, MdhValue p);
+MdhValue __mdh_list_stats(MdhValue list);
 MdhValue __mdh_is_space(MdhValue str);
 MdhValue __mdh_is_digit(MdhValue str);
 MdhValue __mdh_wheesht_aw(MdhValue str);
@@ -435,6 +788,13 @@ MdhValue __mdh_env_all(void);
 MdhValue __mdh_path_join(MdhValue a, MdhValue b);
 MdhValue __mdh_shell(MdhValue cmd);
 MdhValue __mdh_shell_status(MdhValue cmd);
+MdhValue __mdh_spawn(MdhValue argv_list);
+MdhValue __mdh_process_spawn(MdhValue argv_list, MdhValue opts);
+MdhValue __mdh_process_read(MdhValue fd, MdhValue max_len);
+MdhValue __mdh_process_write(MdhValue fd, MdhValue data);
+MdhValue __mdh_process_watch(MdhValue loop, MdhValue proc, MdhValue callback);
+MdhValue __mdh_process_wait(MdhValue proc);
+MdhValue __mdh_process_kill(MdhValue proc, MdhValue sig);
 
 /* ========== Date/Time ========== */
 
@@ -444,6 +804,8 @@ MdhValue __mdh_date_parse(MdhValue date_str, MdhValue format);
 MdhValue __mdh_date_add(MdhValue timestamp_secs, MdhValue amount, MdhValue unit);
 MdhValue __mdh_date_diff(MdhValue ts1, MdhValue ts2, MdhValue unit);
 MdhValue __mdh_braw_date(MdhValue ts_or_nil);
+MdhValue __mdh_date_now_ts(void);
+MdhValue __mdh_date_fields(MdhValue ts_or_nil);
 
 /* ========== Regex ========== */
 
@@ -453,12 +815,42 @@ MdhValue __mdh_regex_match_all(MdhValue text, MdhValue pattern);
 MdhValue __mdh_regex_replace(MdhValue text, MdhValue pattern, MdhValue replacement);
 MdhValue __mdh_regex_replace_first(MdhValue text, MdhValue pattern, MdhValue replacement);
 MdhValue __mdh_regex_split(MdhValue text, MdhValue pattern);
+MdhValue __mdh_regex_compile(MdhValue pattern);
+MdhValue __mdh_regex_set_new(MdhValue patterns);
+MdhValue __mdh_regex_set_match(MdhValue set, MdhValue text);
 
 /* ========== JSON ========== */
 
 MdhValue __mdh_json_parse(MdhValue json_str);
 MdhValue __mdh_json_stringify(MdhValue value);
 MdhValue __mdh_json_pretty(MdhValue value);
+MdhValue __mdh_json_write_into(MdhValue buf, MdhValue value);
+MdhValue __mdh_json_stream_open(MdhValue path);
+MdhValue __mdh_json_stream_new(void);
+MdhValue __mdh_json_stream_feed(MdhValue stream, MdhValue chunk);
+MdhValue __mdh_json_stream_next(MdhValue stream);
+MdhValue __mdh_json_stream_close(MdhValue stream);
+
+/* ========== Binary pack ========== */
+
+/* pack(value) -> MessagePack bytes (bytes as bin, a creel as ext 1); unpack(bytes) -> value */
+MdhValue __mdh_pack_bytes(MdhValue value);
+MdhValue __mdh_pack_into(MdhValue buf, MdhValue value);
+MdhValue __mdh_unpack_bytes(MdhValue data);
+MdhValue __mdh_unpack_stream_new(void);
+MdhValue __mdh_unpack_stream_feed(MdhValue stream, MdhValue chunk);
+MdhValue __mdh_unpack_stream_next(MdhValue stream);
+
+/* ========== Compression ========== */
+
+/* bytes_compress(data, level, format) / bytes_decompress(data, format): gzip, zlib or raw
+ * deflate; gzip_stream_* write gzip bit by bit to a file handle, socket or bytes */
+MdhValue __mdh_bytes_compress(MdhValue data, MdhValue level, MdhValue format);
+MdhValue __mdh_bytes_decompress(MdhValue data, MdhValue format);
+MdhValue __mdh_gzip_stream_new(MdhValue sink, MdhValue level);
+MdhValue __mdh_gzip_stream_write(MdhValue stream, MdhValue data);
+MdhValue __mdh_gzip_stream_flush(MdhValue stream);
+MdhValue __mdh_gzip_stream_close(MdhValue stream);
 
 /* ========== Misc Parity Helpers ========== */
 
@@ -508,10 +900,21 @@ MdhValue __mdh_range_o(MdhValue list);
 MdhValue __mdh_tattie_scone(MdhValue str, MdhValue n);
 MdhValue __mdh_haggis_hunt(MdhValue haystack, MdhValue needle);
 MdhValue __mdh_blether_format(MdhValue template, MdhValue dict);
+MdhValue __mdh_blether_format_at(MdhValue *site, MdhValue template, MdhValue dict);
+MdhValue __mdh_format_compile(MdhValue template);
+MdhValue __mdh_format_apply(MdhValue compiled, MdhValue dict);
 MdhValue __mdh_bampot_mode(MdhValue list);
 
+/* ========== Arena Scopes ========== */
+
+MdhValue __mdh_arena_push(void);
+MdhValue __mdh_arena_pop(MdhValue keep);
+
 /* ========== Exceptions (Try/Catch/Hurl) ========== */
 
+/* Size of the jmp_buf slot codegen reserves per try block (JMP_BUF_SIZE in src/llvm/types.rs). */
+#define MDH_JMP_BUF_BYTES 512
+
 int64_t __mdh_jmp_buf_size(void);
 void __mdh_try_push(void *env);
 void __mdh_try_pop(void);
@@ -526,6 +929,24 @@ static inline const char *__mdh_get_string(MdhValue v) {
     return (const char *)(intptr_t)v.data;
 }
 
+/* Header of a runtime-built string, or NULL for literals and other foreign buffers.
+ * Only the 16 bytes before s are read, and only when they share s's page. */
+static inline MdhString *__mdh_string_header(const char *s) {
+    uintptr_t p = (uintptr_t)s;
+    if (!s || (p & 15) != 8 || (p & 4095) < sizeof(MdhString)) {
+        return NULL;
+    }
+    MdhString *h = (MdhString *)(p - sizeof(MdhString));
+    return h->magic == (MDH_STRING_MAGIC ^ (uint32_t)(p >> 3)) ? h : NULL;
+}
+
+/* O(1) length for runtime-built strings, strlen for everything else */
+static inline int64_t __mdh_string_length(const char *s) {
+    MdhString *h = __mdh_string_header(s);
+    if (h) return h->length;
+    return s ? (int64_t)strlen(s) : 0;
+}
+
 /* Get list pointer from MdhValue (assumes tag is LIST) */
 static inline MdhList *__mdh_get_list(MdhValue v) {
     return (MdhList *)(intptr_t)v.data;
@@ -1,8 +1,22 @@
-use std::cell::RefCell;
+//! Soond, muisic and midi playback
+//!
+//! The mixer belongs to the audio callback and nothing else touches it. The script
+//! thread sends it commands over a lock-free single-producer queue that the callback
+//! drains at the start of each period, and reads back play state and position from
+//! atomics the callback publishes, so a script tweaking volume or pan every frame can
+//! never make the callback wait or skip a period. Whatever the mixer lets go of (an
+//! unloaded voice, an outgrown slot table) goes back over a second queue to be freed on
+//! the script thread, keeping allocation out of the callback.
+
+use std::cell::{RefCell, UnsafeCell};
+use std::collections::{HashMap, VecDeque};
 use std::f32::consts::FRAC_PI_2;
 use std::fs::File;
+use std::mem::MaybeUninit;
 use std::path::{Path, PathBuf};
-use std::sync::{Arc, Mutex};
+use std::sync::atomic::{AtomicU64, AtomicU8, AtomicUsize, Ordering};
+use std::sync::{Arc, Condvar, Mutex, MutexGuard};
+use std::time::SystemTime;
 
 use miniaudio::{Decoder, DecoderConfig, Device, DeviceConfig, DeviceType, Format, FramesMut};
 use rustysynth::{MidiFile, MidiFileSequencer, SoundFont, Synthesizer, SynthesizerSettings};
@@ -12,12 +26,19 @@ use super::{
     MDH_TAG_FLOAT, MDH_TAG_INT, MDH_TAG_NIL, MDH_TAG_STRING,
 };
 
-const ERR_NO_DEVICE: &str = "Soond device isnae stairtit";
 const ERR_BAD_HANDLE: &str = "Thon handle isnae guid";
 
 const OUTPUT_SAMPLE_RATE: u32 = 44_100;
 const OUTPUT_CHANNELS: u32 = 2;
 const DECODE_CHUNK_FRAMES: usize = 1_024;
+/// Frames a music track keeps decoded ahead of the mixer (300 ms).
+const STREAM_BUFFER_FRAMES: usize = OUTPUT_SAMPLE_RATE as usize * 3 / 10;
+/// Commands in flight between the script thread and the mixer.
+const COMMAND_QUEUE_LEN: usize = 1_024;
+/// Sounds that can play at once unless `MDH_SOOND_VOICES` says otherwise.
+const DEFAULT_SOUND_VOICES: usize = 32;
+/// Decoded samples kept for reloading, in MiB, unless `MDH_SOOND_CACHE_MB` says otherwise.
+const DEFAULT_SAMPLE_CACHE_MB: usize = 64;
 const DEFAULT_SOUNDFONT_PATH: &str = "assets/soundfonts/MuseScore_General.sf2";
 
 #[derive(Clone, Copy, Debug, PartialEq, Eq)]
@@ -41,10 +62,137 @@ struct BufferEntry {
     volume: f32,
     pan: f32,
     pitch: f32,
+    /// Mixer start count when the sound last started; the oldest is stolen first
+    started: u64,
 }
 
 type SoundEntry = BufferEntry;
-type MusicEntry = BufferEntry;
+
+struct CachedSample {
+    modified: Option<SystemTime>,
+    buffer: SampleBuffer,
+    last_used: u64,
+}
+
+/// Decoded soond files by path, so loading the same file again shares its samples. A file
+/// whose modification time has changed is decoded afresh. Least recently loaded files are
+/// dropped once the cache is over budget; sounds already loaded keep their samples.
+struct SampleCache {
+    entries: HashMap<PathBuf, CachedSample>,
+    bytes: usize,
+    budget: usize,
+    clock: u64,
+}
+
+impl SampleCache {
+    fn new() -> Self {
+        let megabytes = std::env::var("MDH_SOOND_CACHE_MB")
+            .ok()
+            .and_then(|v| v.trim().parse::<usize>().ok())
+            .unwrap_or(DEFAULT_SAMPLE_CACHE_MB);
+        SampleCache {
+            entries: HashMap::new(),
+            bytes: 0,
+            budget: megabytes * 1024 * 1024,
+            clock: 0,
+        }
+    }
+
+    fn load(&mut self, path: &str, err_msg: &str) -> Result<SampleBuffer, String> {
+        let key = std::fs::canonicalize(path).unwrap_or_else(|_| PathBuf::from(path));
+        let modified = std::fs::metadata(&key).and_then(|m| m.modified()).ok();
+        self.clock += 1;
+        if let Some(cached) = self.entries.get_mut(&key) {
+            if cached.modified == modified {
+                cached.last_used = self.clock;
+                return Ok(cached.buffer.clone());
+            }
+        }
+        if let Some(stale) = self.entries.remove(&key) {
+            self.bytes -= stale.buffer.samples.len() * std::mem::size_of::<f32>();
+        }
+
+        let buffer = decode_audio(path, err_msg)?;
+        let size = buffer.samples.len() * std::mem::size_of::<f32>();
+        if size > self.budget {
+            return Ok(buffer);
+        }
+        while self.bytes + size > self.budget {
+            let oldest = self
+                .entries
+                .iter()
+                .min_by_key(|(_, cached)| cached.last_used)
+                .map(|(key, _)| key.clone());
+            match oldest.and_then(|key| self.entries.remove(&key)) {
+                Some(evicted) => {
+                    self.bytes -= evicted.buffer.samples.len() * std::mem::size_of::<f32>()
+                }
+                None => break,
+            }
+        }
+        self.bytes += size;
+        self.entries.insert(
+            key,
+            CachedSample {
+                modified,
+                buffer: buffer.clone(),
+                last_used: self.clock,
+            },
+        );
+        Ok(buffer)
+    }
+}
+
+/// What a music track's decoder thread has decoded and the mixer has yet to play, in
+/// playback order, along with the requests the thread acts on.
+struct StreamRing {
+    samples: VecDeque<f32>, // interleaved stereo
+    /// How far into the front frame of `samples` playback is
+    cursor: f64,
+    /// Track length in frames, once the thread has opened the file
+    length: Option<u64>,
+    /// Carry on decoding from this frame; whatever was buffered was dropped
+    seek: Option<u64>,
+    looped: bool,
+    /// The decoder reached the end of a track that does not loop
+    finished: bool,
+    closed: bool,
+}
+
+struct MusicStream {
+    ring: Mutex<StreamRing>,
+    wake: Condvar,
+}
+
+impl MusicStream {
+    fn lock(&self) -> MutexGuard<'_, StreamRing> {
+        match self.ring.lock() {
+            Ok(guard) => guard,
+            Err(poisoned) => poisoned.into_inner(),
+        }
+    }
+
+    fn seek(&self, frame: u64) {
+        let mut ring = self.lock();
+        ring.samples.clear();
+        ring.cursor = 0.0;
+        ring.seek = Some(frame);
+        ring.finished = false;
+        drop(ring);
+        self.wake.notify_one();
+    }
+}
+
+/// Music is streamed: a decoder thread per track keeps the ring topped up, so loading
+/// returns at once and a track only ever holds a few hundred milliseconds of samples.
+struct MusicEntry {
+    stream: Arc<MusicStream>,
+    position: f64,
+    state: PlayState,
+    volume: f32,
+    pan: f32,
+    pitch: f32,
+}
 
 struct MidiEntry {
     midi: Arc<MidiFile>,
@@ -53,95 +201,440 @@ struct MidiEntry {
     looped: bool,
     volume: f32,
     pan: f32,
-    sample_rate: u32,
     scratch_left: Vec<f32>,
     scratch_right: Vec<f32>,
 }
 
+enum Source {
+    Sound(SoundEntry),
+    Music(MusicEntry),
+    Midi(MidiEntry),
+}
+
+/// Play state and position (in seconds) of a voice, published by the mixer.
+struct VoiceStatus {
+    state: AtomicU8,
+    position: AtomicU64, // f64 bits
+}
+
+impl VoiceStatus {
+    fn new() -> Arc<Self> {
+        Arc::new(VoiceStatus {
+            state: AtomicU8::new(PlayState::Stopped as u8),
+            position: AtomicU64::new(0.0_f64.to_bits()),
+        })
+    }
+
+    fn state(&self) -> PlayState {
+        match self.state.load(Ordering::Relaxed) {
+            s if s == PlayState::Playing as u8 => PlayState::Playing,
+            s if s == PlayState::Paused as u8 => PlayState::Paused,
+            _ => PlayState::Stopped,
+        }
+    }
+
+    fn set_state(&self, state: PlayState) {
+        self.state.store(state as u8, Ordering::Relaxed);
+    }
+
+    fn position(&self) -> f64 {
+        f64::from_bits(self.position.load(Ordering::Relaxed))
+    }
+
+    fn set_position(&self, seconds: f64) {
+        self.position.store(seconds.to_bits(), Ordering::Relaxed);
+    }
+}
+
+struct Voice {
+    source: Source,
+    status: Arc<VoiceStatus>,
+}
+
+type VoiceSlots = Vec<Option<Box<Voice>>>;
+
+enum Control {
+    /// Start playing; `restart` goes back to the beginning first
+    Play {
+        restart: bool,
+    },
+    Pause,
+    Resume,
+    Stop,
+    Volume(f32),
+    Pan(f32),
+    Pitch(f32),
+    Looped(bool),
+    /// Music position in frames (the stream itself is seeked by the sender)
+    Seek(f64),
+    /// A midi sequencer already rendered up to the new position
+    Sequencer(Box<MidiFileSequencer>),
+}
+
+enum Command {
+    MasterVolume(f32),
+    Muted(bool),
+    /// A bigger slot table; the mixer moves its voices across
+    Grow(VoiceSlots),
+    Add(usize, Box<Voice>),
+    Remove(usize),
+    Set(usize, Control),
+}
+
+/// What the mixer hands back to be freed off the audio thread.
+#[allow(dead_code)] // only ever dropped
+enum Garbage {
+    Voice(Box<Voice>),
+    Slots(VoiceSlots),
+    Sequencer(Box<MidiFileSequencer>),
+}
+
+/// A fixed-size ring shared by exactly one `Sender` and one `Receiver`.
+struct Queue<T> {
+    slots: Box<[UnsafeCell<MaybeUninit<T>>]>,
+    head: AtomicUsize, // next to pop, advanced by the receiver
+    tail: AtomicUsize, // next to push, advanced by the sender
+}
+
+// SAFETY: a slot is only touched by the sender before `tail` is published past it and only
+// by the receiver after, until `head` is published past it again.
+unsafe impl<T: Send> Send for Queue<T> {}
+unsafe impl<T: Send> Sync for Queue<T> {}
+
+impl<T> Queue<T> {
+    fn slot(&self, index: usize) -> *mut MaybeUninit<T> {
+        self.slots[index % self.slots.len()].get()
+    }
+}
+
+impl<T> Drop for Queue<T> {
+    fn drop(&mut self) {
+        let tail = *self.tail.get_mut();
+        while *self.head.get_mut() != tail {
+            let head = *self.head.get_mut();
+            // SAFETY: slots between head and tail hold values nobody has taken
+            unsafe { (*self.slot(head)).assume_init_drop() };
+            *self.head.get_mut() = head.wrapping_add(1);
+        }
+    }
+}
+
+struct Sender<T>(Arc<Queue<T>>);
+struct Receiver<T>(Arc<Queue<T>>);
+
+fn queue<T>(capacity: usize) -> (Sender<T>, Receiver<T>) {
+    let queue = Arc::new(Queue {
+        slots: (0..capacity)
+            .map(|_| UnsafeCell::new(MaybeUninit::uninit()))
+            .collect(),
+        head: AtomicUsize::new(0),
+        tail: AtomicUsize::new(0),
+    });
+    (Sender(Arc::clone(&queue)), Receiver(queue))
+}
+
+impl<T> Sender<T> {
+    /// Hands the value back when the queue is full. Never blocks.
+    fn push(&mut self, value: T) -> Result<(), T> {
+        let queue = &*self.0;
+        let tail = queue.tail.load(Ordering::Relaxed);
+        if tail.wrapping_sub(queue.head.load(Ordering::Acquire)) == queue.slots.len() {
+            return Err(value);
+        }
+        // SAFETY: the slot is free (checked above) and only this sender writes slots
+        unsafe { (*queue.slot(tail)).write(value) };
+        queue.tail.store(tail.wrapping_add(1), Ordering::Release);
+        Ok(())
+    }
+}
+
+impl<T> Receiver<T> {
+    /// Never blocks.
+    fn pop(&mut self) -> Option<T> {
+        let queue = &*self.0;
+        let head = queue.head.load(Ordering::Relaxed);
+        if head == queue.tail.load(Ordering::Acquire) {
+            return None;
+        }
+        // SAFETY: the sender published this slot and will not touch it until head moves on
+        let value = unsafe { (*queue.slot(head)).assume_init_read() };
+        queue.head.store(head.wrapping_add(1), Ordering::Release);
+        Some(value)
+    }
+}
+
+/// Owned by the audio callback.
 struct MixerState {
     master_volume: f32,
     muted: bool,
-    sounds: Vec<Option<SoundEntry>>,
-    music: Vec<Option<MusicEntry>>,
-    midi: Vec<Option<MidiEntry>>,
-    default_soundfont: Option<Arc<SoundFont>>,
+    voices: VoiceSlots,
+    /// Most sounds mixed at once; music and midi do not count
+    sound_voices: usize,
+    starts: u64,
+    commands: Receiver<Command>,
+    garbage: Sender<Garbage>,
 }
 
 impl MixerState {
-    fn new() -> Self {
-        Self {
-            master_volume: 1.0,
-            muted: false,
-            sounds: Vec::new(),
-            music: Vec::new(),
-            midi: Vec::new(),
-            default_soundfont: None,
+    fn apply_commands(&mut self) {
+        while let Some(command) = self.commands.pop() {
+            match command {
+                Command::MasterVolume(volume) => self.master_volume = volume,
+                Command::Muted(muted) => self.muted = muted,
+                Command::Grow(mut slots) => {
+                    slots.extend(self.voices.drain(..));
+                    let old = std::mem::replace(&mut self.voices, slots);
+                    self.retire(Garbage::Slots(old));
+                }
+                Command::Add(index, voice) => {
+                    if index >= self.voices.len() {
+                        self.voices.resize_with(index + 1, || None);
+                    }
+                    if let Some(old) = self.voices[index].replace(voice) {
+                        self.retire(Garbage::Voice(old));
+                    }
+                }
+                Command::Remove(index) => {
+                    if let Some(voice) = self.voices.get_mut(index).and_then(Option::take) {
+                        self.retire(Garbage::Voice(voice));
+                    }
+                }
+                Command::Set(index, control) => {
+                    if let Control::Play { .. } = control {
+                        self.make_room(index);
+                    }
+                    let retired = match self.voices.get_mut(index).and_then(|v| v.as_mut()) {
+                        Some(voice) => apply_control(voice, control),
+                        None => None,
+                    };
+                    if let Some(garbage) = retired {
+                        self.retire(garbage);
+                    }
+                }
+            }
         }
     }
 
-    fn reset(&mut self) {
-        self.master_volume = 1.0;
-        self.muted = false;
-        self.sounds.clear();
-        self.music.clear();
-        self.midi.clear();
-        self.default_soundfont = None;
+    /// Before sound `index` starts, stop the least important other playing sound if the
+    /// voice cap is reached: the quietest, and the oldest of equally quiet ones.
+    fn make_room(&mut self, index: usize) {
+        let mut playing = 0;
+        let mut victim: Option<(usize, f32, u64)> = None;
+        for (slot, voice) in self.voices.iter().enumerate() {
+            let entry = match voice.as_deref() {
+                Some(Voice {
+                    source: Source::Sound(entry),
+                    ..
+                }) if slot != index => entry,
+                _ => continue,
+            };
+            if entry.state != PlayState::Playing {
+                continue;
+            }
+            playing += 1;
+            let weaker = match victim {
+                Some((_, volume, started)) => (entry.volume, entry.started) < (volume, started),
+                None => true,
+            };
+            if weaker {
+                victim = Some((slot, entry.volume, entry.started));
+            }
+        }
+
+        self.starts += 1;
+        let started = self.starts;
+        match self.voices.get_mut(index).and_then(|v| v.as_deref_mut()) {
+            Some(Voice {
+                source: Source::Sound(entry),
+                ..
+            }) => entry.started = started,
+            // Music and midi neither count nor get stolen
+            _ => return,
+        }
+        if playing < self.sound_voices {
+            return;
+        }
+        if let Some(voice) = victim.and_then(|(slot, _, _)| self.voices[slot].as_deref_mut()) {
+            if let Source::Sound(entry) = &mut voice.source {
+                entry.state = PlayState::Stopped;
+                entry.position = 0.0;
+                voice.status.set_state(PlayState::Stopped);
+            }
+        }
+    }
+
+    fn retire(&mut self, garbage: Garbage) {
+        // The script thread empties this queue before each command it sends, so it has
+        // room for everything those commands give back; dropping here is only a fallback.
+        let _ = self.garbage.push(garbage);
+    }
+}
+
+/// The script thread's view of a loaded soond.
+struct SoundHandle {
+    voice: usize,
+    status: Arc<VoiceStatus>,
+}
+
+struct MusicHandle {
+    voice: usize,
+    status: Arc<VoiceStatus>,
+    stream: Arc<MusicStream>,
+}
+
+impl Drop for MusicHandle {
+    fn drop(&mut self) {
+        self.stream.lock().closed = true;
+        self.stream.wake.notify_one();
     }
 }
 
+struct MidiHandle {
+    voice: usize,
+    status: Arc<VoiceStatus>,
+    midi: Arc<MidiFile>,
+    soundfont: Arc<SoundFont>,
+    looped: bool,
+}
+
+/// The callback's end of the queues, plus the device running it.
+struct Link {
+    device: Device,
+    commands: Sender<Command>,
+    garbage: Receiver<Garbage>,
+}
+
 struct AudioState {
-    device: Option<Device>,
-    shared: Arc<Mutex<MixerState>>,
+    link: Option<Link>,
+    master_volume: f32,
+    /// Which mixer voice slots are in use, and how many the mixer has room for
+    voices: Vec<Option<()>>,
+    voice_capacity: usize,
+    sounds: Vec<Option<SoundHandle>>,
+    music: Vec<Option<MusicHandle>>,
+    midi: Vec<Option<MidiHandle>>,
+    default_soundfont: Option<Arc<SoundFont>>,
+    samples: SampleCache,
 }
 
 impl AudioState {
     fn new() -> Self {
         Self {
-            device: None,
-            shared: Arc::new(Mutex::new(MixerState::new())),
+            link: None,
+            master_volume: 1.0,
+            voices: Vec::new(),
+            voice_capacity: 0,
+            sounds: Vec::new(),
+            music: Vec::new(),
+            midi: Vec::new(),
+            default_soundfont: None,
+            samples: SampleCache::new(),
         }
     }
 
     fn ensure_audio(&mut self) -> Result<(), String> {
-        if self.device.is_some() {
+        if self.link.is_some() {
             return Ok(());
         }
 
-        let shared = Arc::clone(&self.shared);
+        let (commands, command_rx) = queue(COMMAND_QUEUE_LEN);
+        let (garbage_tx, garbage) = queue(COMMAND_QUEUE_LEN);
+        // Only the callback ever locks this, so try_lock always succeeds; the mutex is
+        // just what lets the device's shared callback mutate the mixer.
+        let sound_voices = std::env::var("MDH_SOOND_VOICES")
+            .ok()
+            .and_then(|v| v.trim().parse::<usize>().ok())
+            .filter(|&n| n > 0)
+            .unwrap_or(DEFAULT_SOUND_VOICES);
+        let mixer = Mutex::new(MixerState {
+            master_volume: self.master_volume,
+            muted: false,
+            voices: Vec::new(),
+            sound_voices,
+            starts: 0,
+            commands: command_rx,
+            garbage: garbage_tx,
+        });
         let mut config = DeviceConfig::new(DeviceType::Playback);
         config.set_sample_rate(OUTPUT_SAMPLE_RATE);
         config.playback_mut().set_format(Format::F32);
         config.playback_mut().set_channels(OUTPUT_CHANNELS);
         config.set_data_callback(move |_device, output, _input| {
-            mix_output(&shared, output);
+            if let Ok(mut mixer) = mixer.try_lock() {
+                mix_output(&mut mixer, output);
+            }
         });
 
-        let device = Device::new(None, &config)
-            .map_err(|_| "Cannae stairt the soond device".to_string())?;
+        let device =
+            Device::new(None, &config).map_err(|_| "Cannae stairt the soond device".to_string())?;
         device
             .start()
             .map_err(|_| "Cannae stairt the soond device".to_string())?;
-        self.device = Some(device);
+        self.link = Some(Link {
+            device,
+            commands,
+            garbage,
+        });
+        self.voices.clear();
+        self.voice_capacity = 0;
         Ok(())
     }
 
-    fn mixer(&self) -> Result<std::sync::MutexGuard<'_, MixerState>, String> {
-        let guard = match self.shared.lock() {
-            Ok(guard) => guard,
-            Err(poisoned) => poisoned.into_inner(),
-        };
-        Ok(guard)
+    /// Queue a command for the mixer, first freeing whatever it has handed back.
+    fn send(&mut self, command: Command) {
+        let link = match self.link.as_mut() {
+            Some(link) => link,
+            None => return,
+        };
+        while link.garbage.pop().is_some() {}
+        let mut command = command;
+        // The queue only fills if a script sends more than a period's worth of commands
+        // at once; the mixer drains it at the start of the next period.
+        while let Err(rejected) = link.commands.push(command) {
+            command = rejected;
+            std::thread::yield_now();
+        }
+    }
+
+    /// A free mixer voice slot, growing the mixer's table first if it is full.
+    fn alloc_voice(&mut self) -> usize {
+        let index = AudioState::alloc_handle(&mut self.voices, ()) as usize;
+        if index >= self.voice_capacity {
+            self.voice_capacity = (self.voice_capacity * 2).max(16);
+            self.send(Command::Grow(Vec::with_capacity(self.voice_capacity)));
+        }
+        index
+    }
+
+    fn add_voice(&mut self, source: Source) -> (usize, Arc<VoiceStatus>) {
+        let index = self.alloc_voice();
+        let status = VoiceStatus::new();
+        let voice = Box::new(Voice {
+            source,
+            status: Arc::clone(&status),
+        });
+        self.send(Command::Add(index, voice));
+        (index, status)
+    }
+
+    fn remove_voice(&mut self, index: usize) {
+        self.voices[index] = None;
+        self.send(Command::Remove(index));
     }
 
     fn shutdown(&mut self) {
-        if let Some(device) = self.device.take() {
-            let _ = device.stop();
+        if let Some(link) = self.link.take() {
+            let _ = link.device.stop();
+            // Dropping the device drops the mixer, and the voices with it, here
         }
-        let mut mixer = match self.shared.lock() {
-            Ok(guard) => guard,
-            Err(poisoned) => poisoned.into_inner(),
-        };
-        mixer.reset();
+        self.master_volume = 1.0;
+        self.voices.clear();
+        self.voice_capacity = 0;
+        self.sounds.clear();
+        self.music.clear();
+        self.midi.clear();
+        self.default_soundfont = None;
+        self.samples = SampleCache::new();
     }
 
     fn alloc_handle<T>(slots: &mut Vec<Option<T>>, value: T) -> i64 {
@@ -204,6 +697,61 @@ fn decode_audio(path: &str, err_msg: &str) -> Result<SampleBuffer, String> {
     })
 }
 
+/// Decode `path` into `stream` until the track is unloaded, staying at most
+/// STREAM_BUFFER_FRAMES ahead of the mixer. Runs on the track's own thread.
+fn stream_music(path: String, stream: Arc<MusicStream>) {
+    let config = DecoderConfig::new(Format::F32, OUTPUT_CHANNELS, OUTPUT_SAMPLE_RATE);
+    let mut decoder = match Decoder::from_file(&path, Some(&config)) {
+        Ok(decoder) => decoder,
+        Err(_) => {
+            stream.lock().finished = true;
+            return;
+        }
+    };
+    let length = decoder.length_in_pcm_frames();
+    stream.lock().length = Some(length);
+
+    let channels = OUTPUT_CHANNELS as usize;
+    let mut temp = vec![0.0_f32; DECODE_CHUNK_FRAMES * channels];
+    loop {
+        let looped = {
+            let mut ring = stream.lock();
+            loop {
+                if ring.closed {
+                    return;
+                }
+                if let Some(frame) = ring.seek.take() {
+                    let _ = decoder.seek_to_pcm_frame(frame);
+                }
+                if !ring.finished && ring.samples.len() < STREAM_BUFFER_FRAMES * channels {
+                    break ring.looped;
+                }
+                ring = match stream.wake.wait(ring) {
+                    Ok(guard) => guard,
+                    Err(poisoned) => poisoned.into_inner(),
+                };
+            }
+        };
+
+        // Decode without the lock so the mixer never waits on the decoder
+        let mut frames = FramesMut::wrap(&mut temp, Format::F32, OUTPUT_CHANNELS);
+        let read = decoder.read_pcm_frames(&mut frames) as usize;
+        let mut ring = stream.lock();
+        if ring.seek.is_some() {
+            // Decoded from before the seek
+            continue;
+        }
+        ring.samples.extend(&temp[..read * channels]);
+        if read < DECODE_CHUNK_FRAMES {
+            if looped && length > 0 {
+                let _ = decoder.seek_to_pcm_frame(0);
+            } else {
+                ring.finished = true;
+            }
+        }
+    }
+}
+
 fn load_soundfont(path: &Path) -> Result<Arc<SoundFont>, String> {
     let mut file = File::open(path).map_err(|_| "Cannae open the soondfont file".to_string())?;
     let sf = SoundFont::new(&mut file).map_err(|_| "Cannae read the soondfont".to_string())?;
@@ -234,51 +782,133 @@ fn resolve_default_soundfont() -> Result<PathBuf, String> {
     Err("Cannae find the default soondfont".to_string())
 }
 
-fn mix_output(shared: &Arc<Mutex<MixerState>>, output: &mut FramesMut) {
+fn mix_output(mixer: &mut MixerState, output: &mut FramesMut) {
     let frames = output.frame_count();
     let out_samples = output.as_samples_mut::<f32>();
     for sample in out_samples.iter_mut() {
         *sample = 0.0;
     }
 
-    let mut mixer = match shared.try_lock() {
-        Ok(guard) => guard,
-        Err(_) => return,
-    };
-
-    mix_state(&mut mixer, out_samples, frames);
+    mixer.apply_commands();
+    mix_state(mixer, out_samples, frames);
 }
 
 fn mix_state(state: &mut MixerState, output: &mut [f32], frames: usize) {
     let channels = OUTPUT_CHANNELS as usize;
 
-    for slot in state.sounds.iter_mut() {
-        if let Some(entry) = slot.as_mut() {
-            mix_buffer_entry(entry, output, frames, channels);
+    for slot in state.voices.iter_mut() {
+        let voice = match slot.as_mut() {
+            Some(voice) => voice,
+            None => continue,
+        };
+        let (before, after, seconds) = match &mut voice.source {
+            Source::Sound(entry) => {
+                let before = entry.state;
+                mix_buffer_entry(entry, output, frames, channels);
+                (
+                    before,
+                    entry.state,
+                    entry.position / OUTPUT_SAMPLE_RATE as f64,
+                )
+            }
+            Source::Music(entry) => {
+                let before = entry.state;
+                mix_music_entry(entry, output, frames, channels);
+                (
+                    before,
+                    entry.state,
+                    entry.position / OUTPUT_SAMPLE_RATE as f64,
+                )
+            }
+            Source::Midi(entry) => {
+                let before = entry.state;
+                mix_midi_entry(entry, output, frames, channels);
+                (before, entry.state, entry.sequencer.get_position() as f64)
+            }
+        };
+        if before == PlayState::Playing {
+            voice.status.set_position(seconds);
         }
-    }
-
-    for slot in state.music.iter_mut() {
-        if let Some(entry) = slot.as_mut() {
-            mix_buffer_entry(entry, output, frames, channels);
+        // Only publish state the mixer changed itself; the script thread publishes its
+        // own requests as it sends them
+        if after != before {
+            voice.status.set_state(after);
         }
     }
 
-    for slot in state.midi.iter_mut() {
-        if let Some(entry) = slot.as_mut() {
-            mix_midi_entry(entry, output, frames, channels);
-        }
+    // Master gain and clamp in one pass
+    let master = if state.muted {
+        0.0
+    } else {
+        state.master_volume
+    };
+    for sample in output.iter_mut() {
+        *sample = (*sample * master).clamp(-1.0, 1.0);
     }
+}
 
-    let master = if state.muted { 0.0 } else { state.master_volume };
-    if master != 1.0 {
-        for sample in output.iter_mut() {
-            *sample *= master;
+/// Apply one script request to a voice, returning anything it replaced.
+fn apply_control(voice: &mut Voice, control: Control) -> Option<Garbage> {
+    let status = &voice.status;
+    match (&mut voice.source, control) {
+        (Source::Sound(entry), Control::Play { .. }) => {
+            entry.position = 0.0;
+            entry.state = PlayState::Playing;
+        }
+        (Source::Music(entry), Control::Play { restart }) => {
+            if restart {
+                entry.position = 0.0;
+            }
+            entry.state = PlayState::Playing;
+        }
+        (Source::Midi(entry), Control::Play { restart }) => {
+            if restart {
+                entry.sequencer.play(&entry.midi, entry.looped);
+            }
+            entry.state = PlayState::Playing;
         }
+        (Source::Sound(entry), Control::Stop) => {
+            entry.state = PlayState::Stopped;
+            entry.position = 0.0;
+        }
+        (Source::Music(entry), Control::Stop) => {
+            entry.state = PlayState::Stopped;
+            entry.position = 0.0;
+        }
+        (Source::Midi(entry), Control::Stop) => {
+            entry.sequencer.stop();
+            entry.state = PlayState::Stopped;
+        }
+        (source, Control::Pause) => *source_state(source) = PlayState::Paused,
+        (source, Control::Resume) => *source_state(source) = PlayState::Playing,
+        (Source::Sound(entry), Control::Volume(volume)) => entry.volume = volume,
+        (Source::Music(entry), Control::Volume(volume)) => entry.volume = volume,
+        (Source::Midi(entry), Control::Volume(volume)) => entry.volume = volume,
+        (Source::Sound(entry), Control::Pan(pan)) => entry.pan = pan,
+        (Source::Music(entry), Control::Pan(pan)) => entry.pan = pan,
+        (Source::Midi(entry), Control::Pan(pan)) => entry.pan = pan,
+        (Source::Sound(entry), Control::Pitch(pitch)) => entry.pitch = pitch,
+        (Source::Music(entry), Control::Pitch(pitch)) => entry.pitch = pitch,
+        (Source::Sound(entry), Control::Looped(looped)) => entry.looped = looped,
+        (Source::Midi(entry), Control::Looped(looped)) => entry.looped = looped,
+        (Source::Music(entry), Control::Seek(frame)) => entry.position = frame,
+        (Source::Midi(entry), Control::Sequencer(mut sequencer)) => {
+            // Send the old one back in the new one's box
+            std::mem::swap(&mut entry.sequencer, &mut *sequencer);
+            status.set_position(entry.sequencer.get_position() as f64);
+            return Some(Garbage::Sequencer(sequencer));
+        }
+        (_, Control::Sequencer(sequencer)) => return Some(Garbage::Sequencer(sequencer)),
+        _ => {}
     }
+    None
+}
 
-    for sample in output.iter_mut() {
-        *sample = sample.clamp(-1.0, 1.0);
+fn source_state(source: &mut Source) -> &mut PlayState {
+    match source {
+        Source::Sound(entry) => &mut entry.state,
+        Source::Music(entry) => &mut entry.state,
+        Source::Midi(entry) => &mut entry.state,
     }
 }
 
@@ -299,6 +929,32 @@ fn mix_buffer_entry(entry: &mut BufferEntry, output: &mut [f32], frames: usize,
     let samples = &entry.buffer.samples;
     let mut position = entry.position;
 
+    if pitch == 1.0 && position.fract() == 0.0 {
+        // Whole frames at the source rate: add runs of samples, no interpolation
+        let gains = [volume * left_gain, volume * right_gain];
+        let mut index = position as usize;
+        let mut done = 0;
+        while done < frames {
+            if index >= total_frames {
+                if !entry.looped {
+                    entry.state = PlayState::Stopped;
+                    break;
+                }
+                index = 0;
+            }
+            let run = (frames - done).min(total_frames - index);
+            mix_run(
+                &mut output[done * channels..(done + run) * channels],
+                &samples[index * channels..(index + run) * channels],
+                gains,
+            );
+            done += run;
+            index += run;
+        }
+        entry.position = index as f64;
+        return;
+    }
+
     for frame in 0..frames {
         if position >= total_frames as f64 {
             if entry.looped {
@@ -335,6 +991,85 @@ fn mix_buffer_entry(entry: &mut BufferEntry, output: &mut [f32], frames: usize,
     entry.position = position;
 }
 
+fn mix_music_entry(entry: &mut MusicEntry, output: &mut [f32], frames: usize, channels: usize) {
+    if entry.state != PlayState::Playing {
+        return;
+    }
+
+    // Never block the audio thread on the decoder; a missed lock is one quiet period
+    let mut ring = match entry.stream.ring.try_lock() {
+        Ok(guard) => guard,
+        Err(_) => return,
+    };
+
+    let pitch = if entry.pitch <= 0.0 { 1.0 } else { entry.pitch };
+    let (left_gain, right_gain) = pan_gains(entry.pan);
+    let volume = entry.volume;
+    let mut cursor = ring.cursor;
+
+    if pitch == 1.0 && cursor == 0.0 {
+        let gains = [volume * left_gain, volume * right_gain];
+        let run = frames.min(ring.samples.len() / channels);
+        // The ring can wrap mid-frame, so the second half may start on a right sample
+        let samples = run * channels;
+        let (front, back) = ring.samples.as_slices();
+        let split = front.len().min(samples);
+        mix_run(&mut output[..split], &front[..split], gains);
+        let gains = if split % 2 == 1 {
+            [gains[1], gains[0]]
+        } else {
+            gains
+        };
+        mix_run(&mut output[split..samples], &back[..samples - split], gains);
+        if run < frames && ring.finished {
+            entry.state = PlayState::Stopped;
+        }
+        cursor = run as f64;
+        entry.position += run as f64;
+    } else {
+        for frame in 0..frames {
+            let available = ring.samples.len() / channels;
+            let idx = cursor.floor() as usize;
+            let next_idx = if idx + 1 < available {
+                idx + 1
+            } else if ring.finished && idx < available {
+                idx
+            } else {
+                if ring.finished {
+                    entry.state = PlayState::Stopped;
+                }
+                // Otherwise the decoder has fallen behind; pick up where this left off
+                break;
+            };
+            let frac = (cursor - idx as f64) as f32;
+
+            let base = idx * channels;
+            let next_base = next_idx * channels;
+
+            let left = lerp(ring.samples[base], ring.samples[next_base], frac);
+            let right = lerp(ring.samples[base + 1], ring.samples[next_base + 1], frac);
+
+            let out_base = frame * channels;
+            output[out_base] += left * volume * left_gain;
+            output[out_base + 1] += right * volume * right_gain;
+
+            cursor += pitch as f64;
+            entry.position += pitch as f64;
+        }
+    }
+
+    let played = (cursor.floor() as usize).min(ring.samples.len() / channels);
+    ring.samples.drain(..played * channels);
+    ring.cursor = cursor - played as f64;
+    if ring.looped {
+        if let Some(length) = ring.length.filter(|&length| length > 0) {
+            entry.position %= length as f64;
+        }
+    }
+    drop(ring);
+    entry.stream.wake.notify_one();
+}
+
 fn mix_midi_entry(entry: &mut MidiEntry, output: &mut [f32], frames: usize, channels: usize) {
     if entry.state != PlayState::Playing {
         return;
@@ -363,12 +1098,32 @@ fn mix_midi_entry(entry: &mut MidiEntry, output: &mut [f32], frames: usize, chan
     }
 }
 
+/// Add `input` into `output` with a left and right gain. Both are interleaved stereo of
+/// the same length; the fixed-width chunks let the compiler vectorise this.
+fn mix_run(output: &mut [f32], input: &[f32], gains: [f32; 2]) {
+    const LANES: usize = 8;
+    let pattern: [f32; LANES] = std::array::from_fn(|i| gains[i % 2]);
+    let mut out_chunks = output.chunks_exact_mut(LANES);
+    let mut in_chunks = input.chunks_exact(LANES);
+    for (out, src) in (&mut out_chunks).zip(&mut in_chunks) {
+        for i in 0..LANES {
+            out[i] += src[i] * pattern[i];
+        }
+    }
+    let rest = out_chunks.into_remainder().iter_mut();
+    for (i, (out, src)) in rest.zip(in_chunks.remainder()).enumerate() {
+        *out += src * gains[i % 2];
+    }
+}
+
 fn lerp(a: f32, b: f32, t: f32) -> f32 {
     a + (b - a) * t
 }
 
-fn seek_midi(entry: &mut MidiEntry, seconds: f64) -> Result<(), String> {
-    let length = entry.midi.get_length();
+/// A fresh sequencer for `handle`'s file, rendered up to `seconds` in. Built on the
+/// script thread so the mixer only has to swap it in.
+fn seek_midi(handle: &MidiHandle, seconds: f64) -> Result<MidiFileSequencer, String> {
+    let length = handle.midi.get_length();
     let target = if seconds < 0.0 {
         0.0
     } else if seconds > length {
@@ -377,9 +1132,13 @@ fn seek_midi(entry: &mut MidiEntry, seconds: f64) -> Result<(), String> {
         seconds
     };
 
-    entry.sequencer.play(&entry.midi, entry.looped);
+    let settings = SynthesizerSettings::new(OUTPUT_SAMPLE_RATE as i32);
+    let synth = Synthesizer::new(&handle.soundfont, &settings)
+        .map_err(|_| "Cannae set up the synth".to_string())?;
+    let mut sequencer = MidiFileSequencer::new(synth);
+    sequencer.play(&handle.midi, handle.looped);
 
-    let total_frames = (target * entry.sample_rate as f64) as usize;
+    let total_frames = (target * OUTPUT_SAMPLE_RATE as f64) as usize;
     let mut left = vec![0.0_f32; DECODE_CHUNK_FRAMES];
     let mut right = vec![0.0_f32; DECODE_CHUNK_FRAMES];
     let mut remaining = total_frames;
@@ -389,13 +1148,11 @@ fn seek_midi(entry: &mut MidiEntry, seconds: f64) -> Result<(), String> {
         } else {
             remaining
         };
-        entry
-            .sequencer
-            .render(&mut left[..chunk], &mut right[..chunk]);
+        sequencer.render(&mut left[..chunk], &mut right[..chunk]);
         remaining -= chunk;
     }
 
-    Ok(())
+    Ok(sequencer)
 }
 
 fn expect_number(value: MdhValue, name: &str) -> Result<f64, String> {
@@ -473,11 +1230,7 @@ pub extern "C" fn __mdh_soond_wheesht(value: MdhValue) -> MdhValue {
         if let Err(msg) = state.ensure_audio() {
             return hurl_msg(&msg);
         }
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        mixer.muted = wheesht;
+        state.send(Command::Muted(wheesht));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -493,24 +1246,15 @@ pub extern "C" fn __mdh_soond_luid(value: MdhValue) -> MdhValue {
         if let Err(msg) = state.ensure_audio() {
             return hurl_msg(&msg);
         }
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        mixer.master_volume = volume;
+        state.master_volume = volume;
+        state.send(Command::MasterVolume(volume));
         unsafe { __mdh_make_nil() }
     })
 }
 
 #[no_mangle]
 pub extern "C" fn __mdh_soond_hou_luid() -> MdhValue {
-    with_state(|state| {
-        let mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        unsafe { __mdh_make_float(mixer.master_volume as f64) }
-    })
+    with_state(|state| unsafe { __mdh_make_float(state.master_volume as f64) })
 }
 
 #[no_mangle]
@@ -531,7 +1275,7 @@ pub extern "C" fn __mdh_soond_lade(path_val: MdhValue) -> MdhValue {
         if let Err(msg) = state.ensure_audio() {
             return hurl_msg(&msg);
         }
-        let buffer = match decode_audio(&path, "Cannae lade the soond") {
+        let buffer = match state.samples.load(&path, "Cannae lade the soond") {
             Ok(buf) => buf,
             Err(msg) => return hurl_msg(&msg),
         };
@@ -543,12 +1287,10 @@ pub extern "C" fn __mdh_soond_lade(path_val: MdhValue) -> MdhValue {
             volume: 1.0,
             pan: 0.0,
             pitch: 1.0,
+            started: 0,
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let handle = AudioState::alloc_handle(&mut mixer.sounds, entry);
+        let (voice, status) = state.add_voice(Source::Sound(entry));
+        let handle = AudioState::alloc_handle(&mut state.sounds, SoundHandle { voice, status });
         unsafe { __mdh_make_int(handle) }
     })
 }
@@ -560,16 +1302,14 @@ pub extern "C" fn __mdh_soond_spiel(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.sounds.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.sounds.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.position = 0.0;
-        entry.state = PlayState::Playing;
+        entry.status.set_state(PlayState::Playing);
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Play { restart: true }));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -581,15 +1321,14 @@ pub extern "C" fn __mdh_soond_haud(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.sounds.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.sounds.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.state = PlayState::Paused;
+        entry.status.set_state(PlayState::Paused);
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Pause));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -601,15 +1340,14 @@ pub extern "C" fn __mdh_soond_gae_on(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.sounds.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.sounds.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.state = PlayState::Playing;
+        entry.status.set_state(PlayState::Playing);
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Resume));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -621,16 +1359,14 @@ pub extern "C" fn __mdh_soond_stap(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.sounds.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.sounds.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.state = PlayState::Stopped;
-        entry.position = 0.0;
+        entry.status.set_state(PlayState::Stopped);
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Stop));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -642,16 +1378,12 @@ pub extern "C" fn __mdh_soond_unlade(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.sounds.get_mut(handle).and_then(|e| e.as_mut()) {
-            Some(entry) => entry,
+
+        let voice = match state.sounds.get_mut(handle).and_then(Option::take) {
+            Some(entry) => entry.voice,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.state = PlayState::Stopped;
-        mixer.sounds[handle] = None;
+        state.remove_voice(voice);
         unsafe { __mdh_make_nil() }
     })
 }
@@ -663,15 +1395,12 @@ pub extern "C" fn __mdh_soond_is_spielin(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.sounds.get(handle).and_then(|e| e.as_ref()) {
+
+        let entry = match state.sounds.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        unsafe { __mdh_make_bool(entry.state == PlayState::Playing) }
+        unsafe { __mdh_make_bool(entry.status.state() == PlayState::Playing) }
     })
 }
 
@@ -682,20 +1411,19 @@ pub extern "C" fn __mdh_soond_pit_luid(handle_val: MdhValue, val: MdhValue) -> M
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
+
         let mut value = match expect_number(val, "soond_pit_luid") {
             Ok(v) => v as f32,
             Err(msg) => return hurl_msg(&msg),
         };
         value = clamp01(value);
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.sounds.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.sounds.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.volume = value;
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Volume(value)));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -707,19 +1435,18 @@ pub extern "C" fn __mdh_soond_pit_pan(handle_val: MdhValue, val: MdhValue) -> Md
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
+
         let pan = match expect_number(val, "soond_pit_pan") {
             Ok(v) => v as f32,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.sounds.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.sounds.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.pan = pan;
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Pan(pan)));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -731,19 +1458,18 @@ pub extern "C" fn __mdh_soond_pit_tune(handle_val: MdhValue, val: MdhValue) -> M
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
+
         let pitch = match expect_number(val, "soond_pit_tune") {
             Ok(v) => v as f32,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.sounds.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.sounds.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.pitch = pitch;
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Pitch(pitch)));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -755,19 +1481,18 @@ pub extern "C" fn __mdh_soond_pit_rin_roond(handle_val: MdhValue, val: MdhValue)
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
+
         let looped = match expect_bool(val, "soond_pit_rin_roond") {
             Ok(v) => v,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.sounds.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.sounds.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.looped = looped;
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Looped(looped)));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -779,11 +1504,8 @@ pub extern "C" fn __mdh_soond_ready(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.sounds.get(handle).and_then(|e| e.as_ref()) {
+
+        let entry = match state.sounds.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
@@ -802,24 +1524,47 @@ pub extern "C" fn __mdh_muisic_lade(path_val: MdhValue) -> MdhValue {
         if let Err(msg) = state.ensure_audio() {
             return hurl_msg(&msg);
         }
-        let buffer = match decode_audio(&path, "Cannae lade the muisic") {
-            Ok(buf) => buf,
-            Err(msg) => return hurl_msg(&msg),
-        };
+        // Open the file here only to report a bad one straight away
+        let config = DecoderConfig::new(Format::F32, OUTPUT_CHANNELS, OUTPUT_SAMPLE_RATE);
+        if Decoder::from_file(&path, Some(&config)).is_err() {
+            return hurl_msg("Cannae lade the muisic");
+        }
+        let stream = Arc::new(MusicStream {
+            ring: Mutex::new(StreamRing {
+                samples: VecDeque::with_capacity(
+                    (STREAM_BUFFER_FRAMES + DECODE_CHUNK_FRAMES) * OUTPUT_CHANNELS as usize,
+                ),
+                cursor: 0.0,
+                length: None,
+                seek: None,
+                looped: false,
+                finished: false,
+                closed: false,
+            }),
+            wake: Condvar::new(),
+        });
+        let decoding = Arc::clone(&stream);
+        let spawned = std::thread::Builder::new()
+            .name("mdh-muisic".to_string())
+            .spawn(move || stream_music(path, decoding));
+        if spawned.is_err() {
+            return hurl_msg("Cannae lade the muisic");
+        }
         let entry = MusicEntry {
-            buffer,
+            stream: Arc::clone(&stream),
             position: 0.0,
             state: PlayState::Stopped,
-            looped: false,
             volume: 1.0,
             pan: 0.0,
             pitch: 1.0,
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
+        let (voice, status) = state.add_voice(Source::Music(entry));
+        let entry = MusicHandle {
+            voice,
+            status,
+            stream,
         };
-        let handle = AudioState::alloc_handle(&mut mixer.music, entry);
+        let handle = AudioState::alloc_handle(&mut state.music, entry);
         unsafe { __mdh_make_int(handle) }
     })
 }
@@ -831,18 +1576,20 @@ pub extern "C" fn __mdh_muisic_spiel(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.music.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.music.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        if entry.state == PlayState::Stopped {
-            entry.position = 0.0;
+
+        let restart = entry.status.state() == PlayState::Stopped;
+        if restart {
+            entry.status.set_position(0.0);
+            entry.stream.seek(0);
         }
-        entry.state = PlayState::Playing;
+        entry.status.set_state(PlayState::Playing);
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Play { restart }));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -854,15 +1601,14 @@ pub extern "C" fn __mdh_muisic_haud(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.music.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.music.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.state = PlayState::Paused;
+        entry.status.set_state(PlayState::Paused);
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Pause));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -874,15 +1620,14 @@ pub extern "C" fn __mdh_muisic_gae_on(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.music.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.music.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.state = PlayState::Playing;
+        entry.status.set_state(PlayState::Playing);
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Resume));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -894,16 +1639,17 @@ pub extern "C" fn __mdh_muisic_stap(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.music.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.music.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.state = PlayState::Stopped;
-        entry.position = 0.0;
+
+        entry.status.set_state(PlayState::Stopped);
+        entry.status.set_position(0.0);
+        entry.stream.seek(0);
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Stop));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -915,16 +1661,13 @@ pub extern "C" fn __mdh_muisic_unlade(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.music.get_mut(handle).and_then(|e| e.as_mut()) {
-            Some(entry) => entry,
+
+        // Dropping the handle tells the decoder thread to finish
+        let voice = match state.music.get_mut(handle).and_then(Option::take) {
+            Some(entry) => entry.voice,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.state = PlayState::Stopped;
-        mixer.music[handle] = None;
+        state.remove_voice(voice);
         unsafe { __mdh_make_nil() }
     })
 }
@@ -936,15 +1679,12 @@ pub extern "C" fn __mdh_muisic_is_spielin(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.music.get(handle).and_then(|e| e.as_ref()) {
+
+        let entry = match state.music.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        unsafe { __mdh_make_bool(entry.state == PlayState::Playing) }
+        unsafe { __mdh_make_bool(entry.status.state() == PlayState::Playing) }
     })
 }
 
@@ -955,20 +1695,27 @@ pub extern "C" fn __mdh_muisic_loup(handle_val: MdhValue, seconds_val: MdhValue)
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
+
         let pos = match expect_number(seconds_val, "muisic_loup") {
             Ok(v) => v as f64,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.music.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.music.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        let target = (pos * OUTPUT_SAMPLE_RATE as f64).max(0.0);
-        entry.position = target.min(entry.buffer.frames as f64);
+
+        let mut target = (pos * OUTPUT_SAMPLE_RATE as f64).max(0.0).floor();
+        if let Some(length) = entry.stream.lock().length {
+            target = target.min(length as f64);
+        }
+        entry
+            .status
+            .set_position(target / OUTPUT_SAMPLE_RATE as f64);
+        entry.stream.seek(target as u64);
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Seek(target)));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -980,15 +1727,15 @@ pub extern "C" fn __mdh_muisic_hou_lang(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.music.get(handle).and_then(|e| e.as_ref()) {
+
+        let entry = match state.music.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        let length = entry.buffer.frames as f64 / OUTPUT_SAMPLE_RATE as f64;
+
+        // Zero until the decoder thread has opened the file
+        let frames = entry.stream.lock().length.unwrap_or(0);
+        let length = frames as f64 / OUTPUT_SAMPLE_RATE as f64;
         unsafe { __mdh_make_float(length) }
     })
 }
@@ -1000,16 +1747,12 @@ pub extern "C" fn __mdh_muisic_whaur(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.music.get(handle).and_then(|e| e.as_ref()) {
+
+        let entry = match state.music.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        let pos = entry.position / OUTPUT_SAMPLE_RATE as f64;
-        unsafe { __mdh_make_float(pos) }
+        unsafe { __mdh_make_float(entry.status.position()) }
     })
 }
 
@@ -1020,20 +1763,19 @@ pub extern "C" fn __mdh_muisic_pit_luid(handle_val: MdhValue, val: MdhValue) ->
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
+
         let mut value = match expect_number(val, "muisic_pit_luid") {
             Ok(v) => v as f32,
             Err(msg) => return hurl_msg(&msg),
         };
         value = clamp01(value);
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.music.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.music.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.volume = value;
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Volume(value)));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -1045,19 +1787,18 @@ pub extern "C" fn __mdh_muisic_pit_pan(handle_val: MdhValue, val: MdhValue) -> M
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
+
         let pan = match expect_number(val, "muisic_pit_pan") {
             Ok(v) => v as f32,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.music.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.music.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.pan = pan;
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Pan(pan)));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -1069,19 +1810,18 @@ pub extern "C" fn __mdh_muisic_pit_tune(handle_val: MdhValue, val: MdhValue) ->
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
+
         let pitch = match expect_number(val, "muisic_pit_tune") {
             Ok(v) => v as f32,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.music.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.music.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.pitch = pitch;
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Pitch(pitch)));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -1093,19 +1833,23 @@ pub extern "C" fn __mdh_muisic_pit_rin_roond(handle_val: MdhValue, val: MdhValue
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
+
         let looped = match expect_bool(val, "muisic_pit_rin_roond") {
             Ok(v) => v,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.music.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.music.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.looped = looped;
+
+        let was_looped = std::mem::replace(&mut entry.stream.lock().looped, looped);
+        if was_looped && !looped {
+            // The decoder may already be into the next time round; go back to here
+            let frame = entry.status.position() * OUTPUT_SAMPLE_RATE as f64;
+            entry.stream.seek(frame as u64);
+        }
         unsafe { __mdh_make_nil() }
     })
 }
@@ -1119,23 +1863,19 @@ pub extern "C" fn __mdh_midi_lade(midi_val: MdhValue, sf_val: MdhValue) -> MdhVa
         };
 
         let sf = if sf_val.tag == MDH_TAG_NIL {
-            if let Ok(mut mixer) = state.mixer() {
-                if let Some(sf) = &mixer.default_soundfont {
-                    Arc::clone(sf)
-                } else {
-                    let path = match resolve_default_soundfont() {
-                        Ok(p) => p,
-                        Err(msg) => return hurl_msg(&msg),
-                    };
-                    let sf = match load_soundfont(path.as_path()) {
-                        Ok(sf) => sf,
-                        Err(msg) => return hurl_msg(&msg),
-                    };
-                    mixer.default_soundfont = Some(Arc::clone(&sf));
-                    sf
-                }
+            if let Some(sf) = &state.default_soundfont {
+                Arc::clone(sf)
             } else {
-                return hurl_msg(ERR_NO_DEVICE);
+                let path = match resolve_default_soundfont() {
+                    Ok(p) => p,
+                    Err(msg) => return hurl_msg(&msg),
+                };
+                let sf = match load_soundfont(path.as_path()) {
+                    Ok(sf) => sf,
+                    Err(msg) => return hurl_msg(&msg),
+                };
+                state.default_soundfont = Some(Arc::clone(&sf));
+                sf
             }
         } else if sf_val.tag == MDH_TAG_STRING {
             let path = unsafe { mdh_string_to_rust(sf_val) };
@@ -1169,22 +1909,25 @@ pub extern "C" fn __mdh_midi_lade(midi_val: MdhValue, sf_val: MdhValue) -> MdhVa
         }
 
         let entry = MidiEntry {
-            midi,
+            midi: Arc::clone(&midi),
             sequencer,
             state: PlayState::Stopped,
             looped: false,
             volume: 1.0,
             pan: 0.0,
-            sample_rate: OUTPUT_SAMPLE_RATE,
             scratch_left: Vec::new(),
             scratch_right: Vec::new(),
         };
 
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
+        let (voice, status) = state.add_voice(Source::Midi(entry));
+        let entry = MidiHandle {
+            voice,
+            status,
+            midi,
+            soundfont: sf,
+            looped: false,
         };
-        let handle = AudioState::alloc_handle(&mut mixer.midi, entry);
+        let handle = AudioState::alloc_handle(&mut state.midi, entry);
         unsafe { __mdh_make_int(handle) }
     })
 }
@@ -1196,18 +1939,19 @@ pub extern "C" fn __mdh_midi_spiel(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.midi.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.midi.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        if entry.state == PlayState::Stopped {
-            entry.sequencer.play(&entry.midi, entry.looped);
+
+        let restart = entry.status.state() == PlayState::Stopped;
+        if restart {
+            entry.status.set_position(0.0);
         }
-        entry.state = PlayState::Playing;
+        entry.status.set_state(PlayState::Playing);
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Play { restart }));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -1219,15 +1963,14 @@ pub extern "C" fn __mdh_midi_haud(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.midi.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.midi.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.state = PlayState::Paused;
+        entry.status.set_state(PlayState::Paused);
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Pause));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -1239,15 +1982,14 @@ pub extern "C" fn __mdh_midi_gae_on(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.midi.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.midi.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.state = PlayState::Playing;
+        entry.status.set_state(PlayState::Playing);
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Resume));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -1259,16 +2001,14 @@ pub extern "C" fn __mdh_midi_stap(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.midi.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.midi.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.sequencer.stop();
-        entry.state = PlayState::Stopped;
+        entry.status.set_state(PlayState::Stopped);
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Stop));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -1280,16 +2020,12 @@ pub extern "C" fn __mdh_midi_unlade(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.midi.get_mut(handle).and_then(|e| e.as_mut()) {
-            Some(entry) => entry,
+
+        let voice = match state.midi.get_mut(handle).and_then(Option::take) {
+            Some(entry) => entry.voice,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.sequencer.stop();
-        mixer.midi[handle] = None;
+        state.remove_voice(voice);
         unsafe { __mdh_make_nil() }
     })
 }
@@ -1301,15 +2037,12 @@ pub extern "C" fn __mdh_midi_is_spielin(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.midi.get(handle).and_then(|e| e.as_ref()) {
+
+        let entry = match state.midi.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        unsafe { __mdh_make_bool(entry.state == PlayState::Playing) }
+        unsafe { __mdh_make_bool(entry.status.state() == PlayState::Playing) }
     })
 }
 
@@ -1320,21 +2053,24 @@ pub extern "C" fn __mdh_midi_loup(handle_val: MdhValue, seconds_val: MdhValue) -
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
+
         let pos = match expect_number(seconds_val, "midi_loup") {
             Ok(v) => v,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.midi.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.midi.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        if let Err(msg) = seek_midi(entry, pos) {
-            return hurl_msg(&msg);
-        }
+
+        let sequencer = match seek_midi(entry, pos) {
+            Ok(sequencer) => sequencer,
+            Err(msg) => return hurl_msg(&msg),
+        };
+        entry.status.set_position(sequencer.get_position() as f64);
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Sequencer(Box::new(sequencer))));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -1346,11 +2082,8 @@ pub extern "C" fn __mdh_midi_hou_lang(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.midi.get(handle).and_then(|e| e.as_ref()) {
+
+        let entry = match state.midi.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
@@ -1365,15 +2098,12 @@ pub extern "C" fn __mdh_midi_whaur(handle_val: MdhValue) -> MdhValue {
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.midi.get(handle).and_then(|e| e.as_ref()) {
+
+        let entry = match state.midi.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        unsafe { __mdh_make_float(entry.sequencer.get_position() as f64) }
+        unsafe { __mdh_make_float(entry.status.position()) }
     })
 }
 
@@ -1384,20 +2114,19 @@ pub extern "C" fn __mdh_midi_pit_luid(handle_val: MdhValue, val: MdhValue) -> Md
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
+
         let mut value = match expect_number(val, "midi_pit_luid") {
             Ok(v) => v as f32,
             Err(msg) => return hurl_msg(&msg),
         };
         value = clamp01(value);
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.midi.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.midi.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.volume = value;
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Volume(value)));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -1409,19 +2138,18 @@ pub extern "C" fn __mdh_midi_pit_pan(handle_val: MdhValue, val: MdhValue) -> Mdh
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
+
         let pan = match expect_number(val, "midi_pit_pan") {
             Ok(v) => v as f32,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.midi.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.midi.get(handle).and_then(|e| e.as_ref()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
-        entry.pan = pan;
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Pan(pan)));
         unsafe { __mdh_make_nil() }
     })
 }
@@ -1433,19 +2161,19 @@ pub extern "C" fn __mdh_midi_pit_rin_roond(handle_val: MdhValue, val: MdhValue)
             Ok(h) => h,
             Err(msg) => return hurl_msg(&msg),
         };
+
         let looped = match expect_bool(val, "midi_pit_rin_roond") {
             Ok(v) => v,
             Err(msg) => return hurl_msg(&msg),
         };
-        let mut mixer = match state.mixer() {
-            Ok(m) => m,
-            Err(msg) => return hurl_msg(&msg),
-        };
-        let entry = match mixer.midi.get_mut(handle).and_then(|e| e.as_mut()) {
+
+        let entry = match state.midi.get_mut(handle).and_then(|e| e.as_mut()) {
             Some(entry) => entry,
             None => return hurl_msg(ERR_BAD_HANDLE),
         };
         entry.looped = looped;
+        let voice = entry.voice;
+        state.send(Command::Set(voice, Control::Looped(looped)));
         unsafe { __mdh_make_nil() }
     })
 }
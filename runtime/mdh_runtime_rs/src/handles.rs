@@ -0,0 +1,154 @@
+//! Generation-tagged handle tables behind the TLS, SRTP and DTLS registries.
+//!
+//! A handle is `(generation << 32) | (slot + 1)`. Slots live in pages that are
+//! allocated once and never move, so resolving a handle takes no table-wide lock:
+//! it finds the page, checks the generation and locks only that slot. Inserting
+//! and removing take a short mutex over the free list. Removing a value bumps the
+//! slot's generation, so a stale handle misses instead of reaching the next
+//! occupant.
+
+use std::marker::PhantomData;
+use std::ptr;
+use std::sync::atomic::{AtomicPtr, AtomicU32, Ordering};
+use std::sync::Mutex;
+
+/// Page `k` holds `FIRST_PAGE << k` slots; 28 pages keep every index below 2^32.
+const PAGES: usize = 28;
+const FIRST_PAGE: usize = 16;
+const GENERATION_MASK: u32 = 0x7fff_ffff; // keeps handles positive
+
+struct Slot<T> {
+    generation: AtomicU32,
+    value: Mutex<Option<T>>,
+}
+
+struct FreeList {
+    used: usize,
+    free: Vec<usize>,
+}
+
+pub struct HandleTable<T> {
+    pages: [AtomicPtr<Slot<T>>; PAGES],
+    free: Mutex<FreeList>,
+    // Owns the slots behind the raw page pointers (and inherits their Send/Sync).
+    _slots: PhantomData<Slot<T>>,
+}
+
+fn page_of(index: usize) -> (usize, usize) {
+    let bucket = index / FIRST_PAGE + 1;
+    let page = (usize::BITS - 1 - bucket.leading_zeros()) as usize;
+    (page, index - FIRST_PAGE * ((1 << page) - 1))
+}
+
+fn split(handle: i64) -> Option<(usize, u32)> {
+    let low = (handle & 0xffff_ffff) as usize;
+    if handle <= 0 || low == 0 {
+        return None;
+    }
+    Some((low - 1, (handle >> 32) as u32))
+}
+
+impl<T> HandleTable<T> {
+    pub fn new() -> Self {
+        HandleTable {
+            pages: std::array::from_fn(|_| AtomicPtr::new(ptr::null_mut())),
+            free: Mutex::new(FreeList {
+                used: 0,
+                free: Vec::new(),
+            }),
+            _slots: PhantomData,
+        }
+    }
+
+    fn slot(&self, index: usize) -> Option<&Slot<T>> {
+        let (page, offset) = page_of(index);
+        if page >= PAGES {
+            return None;
+        }
+        let base = self.pages[page].load(Ordering::Acquire);
+        if base.is_null() {
+            return None;
+        }
+        // Pages are never freed while the table lives, and offset is inside the page.
+        Some(unsafe { &*base.add(offset) })
+    }
+
+    /// Allocate the page holding `index`; called with the free-list lock held.
+    fn grow_to(&self, index: usize) -> Result<(), String> {
+        let (page, _) = page_of(index);
+        if page >= PAGES {
+            return Err("Too many open handles".to_string());
+        }
+        if self.pages[page].load(Ordering::Acquire).is_null() {
+            let slots: Box<[Slot<T>]> = (0..FIRST_PAGE << page)
+                .map(|_| Slot {
+                    generation: AtomicU32::new(0),
+                    value: Mutex::new(None),
+                })
+                .collect();
+            self.pages[page].store(Box::into_raw(slots) as *mut Slot<T>, Ordering::Release);
+        }
+        Ok(())
+    }
+
+    pub fn insert(&self, value: T) -> Result<i64, String> {
+        let mut free = self.free.lock().unwrap();
+        let index = match free.free.pop() {
+            Some(index) => index,
+            None => {
+                self.grow_to(free.used)?;
+                free.used += 1;
+                free.used - 1
+            }
+        };
+        drop(free);
+        let slot = self.slot(index).ok_or("Too many open handles")?;
+        *slot.value.lock().unwrap() = Some(value);
+        let generation = slot.generation.load(Ordering::Acquire);
+        Ok(((generation as i64) << 32) | (index as i64 + 1))
+    }
+
+    /// Run `f` on the value behind `handle`, holding only that slot's lock.
+    pub fn with_mut<R, F>(&self, handle: i64, f: F) -> Option<R>
+    where
+        F: FnOnce(&mut T) -> R,
+    {
+        let (index, generation) = split(handle)?;
+        let slot = self.slot(index)?;
+        if slot.generation.load(Ordering::Acquire) != generation {
+            return None;
+        }
+        let mut value = slot.value.lock().unwrap();
+        if slot.generation.load(Ordering::Acquire) != generation {
+            return None;
+        }
+        value.as_mut().map(f)
+    }
+
+    pub fn remove(&self, handle: i64) -> Option<T> {
+        let (index, generation) = split(handle)?;
+        let slot = self.slot(index)?;
+        let mut value = slot.value.lock().unwrap();
+        if slot.generation.load(Ordering::Acquire) != generation {
+            return None;
+        }
+        let taken = value.take()?;
+        let next = generation.wrapping_add(1) & GENERATION_MASK;
+        slot.generation.store(next, Ordering::Release);
+        drop(value);
+        self.free.lock().unwrap().free.push(index);
+        Some(taken)
+    }
+}
+
+impl<T> Drop for HandleTable<T> {
+    fn drop(&mut self) {
+        for (page, base) in self.pages.iter().enumerate() {
+            let base = base.load(Ordering::Acquire);
+            if !base.is_null() {
+                let len = FIRST_PAGE << page;
+                unsafe { drop(Box::from_raw(ptr::slice_from_raw_parts_mut(base, len))) };
+            }
+        }
+    }
+}
@@ -0,0 +1,204 @@
+//! Record framing behind json_stream_*.
+//!
+//! A stream owns a byte buffer that is either refilled from a file or fed chunks by the
+//! program. The scanner finds where the next top-level value ends (NDJSON lines, values
+//! concatenated on one line, or pretty-printed across many) so each record is parsed on
+//! its own, and consumed bytes are dropped before more input is appended: memory stays at
+//! about one record plus one read. Scanner state survives between calls, so a record
+//! split over many chunks is still scanned once. Inside strings, where most of the bytes
+//! are, it jumps between quotes and backslashes with memchr (SSE2/AVX2/NEON where the
+//! target has them).
+
+use std::fs::File;
+use std::io::Read;
+
+use memchr::memchr2;
+
+const READ_CHUNK: usize = 64 * 1024;
+
+#[derive(Default)]
+struct Scanner {
+    start: usize, // first byte of the current record (everything before it is consumed)
+    pos: usize,   // where scanning resumes
+    begun: bool,
+    depth: usize,
+    in_string: bool,
+    scalar: bool,
+}
+
+impl Scanner {
+    /// The byte range of the next complete record in `buf`, if there is one yet.
+    fn scan(&mut self, buf: &[u8], eof: bool) -> Option<(usize, usize)> {
+        let mut i = self.pos;
+        if !self.begun {
+            // Whitespace between records (newlines included) is dropped.
+            while i < buf.len() && buf[i].is_ascii_whitespace() {
+                i += 1;
+            }
+            self.start = i;
+            self.pos = i;
+            if i == buf.len() {
+                return None;
+            }
+            self.begun = true;
+            match buf[i] {
+                b'{' | b'[' => self.depth = 1,
+                b'"' => self.in_string = true,
+                _ => self.scalar = true,
+            }
+            i += 1;
+        }
+
+        while i < buf.len() {
+            if self.in_string {
+                match memchr2(b'"', b'\\', &buf[i..]) {
+                    None => i = buf.len(),
+                    Some(off) if buf[i + off] == b'\\' => {
+                        if i + off + 1 == buf.len() {
+                            // The escaped byte has not arrived; resume at the backslash.
+                            i += off;
+                            break;
+                        }
+                        i += off + 2;
+                    }
+                    Some(off) => {
+                        i += off + 1;
+                        self.in_string = false;
+                        if self.depth == 0 {
+                            return Some(self.finish(i));
+                        }
+                    }
+                }
+                continue;
+            }
+            let b = buf[i];
+            if self.scalar {
+                if b.is_ascii_whitespace() || matches!(b, b'{' | b'}' | b'[' | b']' | b',' | b'"') {
+                    return Some(self.finish(i));
+                }
+            } else {
+                match b {
+                    b'"' => self.in_string = true,
+                    b'{' | b'[' => self.depth += 1,
+                    b'}' | b']' => {
+                        self.depth -= 1;
+                        if self.depth == 0 {
+                            return Some(self.finish(i + 1));
+                        }
+                    }
+                    _ => {}
+                }
+            }
+            i += 1;
+        }
+        self.pos = i;
+        // A number or literal is only known to be complete once the input has ended.
+        if self.scalar && eof {
+            return Some(self.finish(i));
+        }
+        None
+    }
+
+    fn finish(&mut self, end: usize) -> (usize, usize) {
+        let start = self.start;
+        *self = Scanner {
+            start: end,
+            pos: end,
+            ..Scanner::default()
+        };
+        (start, end)
+    }
+}
+
+pub struct JsonStream {
+    buf: Vec<u8>,
+    scan: Scanner,
+    file: Option<File>,
+    eof: bool,
+}
+
+impl JsonStream {
+    /// A stream that reads records from `file` as they are asked for.
+    pub fn from_file(file: File) -> Self {
+        JsonStream {
+            buf: Vec::with_capacity(READ_CHUNK),
+            scan: Scanner::default(),
+            file: Some(file),
+            eof: false,
+        }
+    }
+
+    /// A stream fed by `feed`, e.g. with the chunks tcp_recv returns.
+    pub fn push() -> Self {
+        JsonStream {
+            buf: Vec::new(),
+            scan: Scanner::default(),
+            file: None,
+            eof: false,
+        }
+    }
+
+    /// Drop consumed bytes so the buffer only holds the record in progress.
+    fn compact(&mut self) {
+        let n = self.scan.start;
+        if n > 0 {
+            self.buf.drain(..n);
+            self.scan.start = 0;
+            self.scan.pos -= n;
+        }
+    }
+
+    pub fn feed(&mut self, chunk: &[u8]) -> Result<(), String> {
+        if self.file.is_some() {
+            return Err("json_stream_feed: stream reads from a file".to_string());
+        }
+        self.compact();
+        self.buf.extend_from_slice(chunk);
+        Ok(())
+    }
+
+    /// Read the next chunk of the file; false when there is nothing more to read.
+    fn fill(&mut self) -> Result<bool, String> {
+        if self.eof || self.file.is_none() {
+            return Ok(false);
+        }
+        self.compact();
+        let len = self.buf.len();
+        self.buf.resize(len + READ_CHUNK, 0);
+        let file = self.file.as_mut().expect("file stream");
+        let read = loop {
+            match file.read(&mut self.buf[len..]) {
+                Ok(n) => break n,
+                Err(e) if e.kind() == std::io::ErrorKind::Interrupted => continue,
+                Err(e) => {
+                    self.buf.truncate(len);
+                    return Err(format!("json_stream_next: {}", e));
+                }
+            }
+        };
+        self.buf.truncate(len + read);
+        if read == 0 {
+            self.eof = true;
+        }
+        Ok(true)
+    }
+
+    /// The bytes of the next record, or None when a push stream needs more input or a
+    /// file stream is exhausted.
+    pub fn next_record(&mut self) -> Result<Option<&[u8]>, String> {
+        loop {
+            if let Some((start, end)) = self.scan.scan(&self.buf, self.eof) {
+                return Ok(Some(&self.buf[start..end]));
+            }
+            if !self.fill()? {
+                break;
+            }
+        }
+        if self.eof && self.scan.begun {
+            self.buf.clear();
+            self.scan = Scanner::default();
+            return Err("Truncated JSON record at end of stream".to_string());
+        }
+        Ok(None)
+    }
+}
@@ -1,22 +1,40 @@
-use std::collections::HashMap;
+use std::borrow::Cow;
+use std::cell::{Cell, RefCell};
+use std::collections::{HashMap, VecDeque};
 use std::ffi::{CStr, CString};
 use std::io::{Read, Write};
-use std::os::raw::c_char;
+use std::net::IpAddr;
+use std::os::raw::{c_char, c_int, c_long, c_void};
 use std::os::unix::io::FromRawFd;
+use std::sync::atomic::{AtomicU64, Ordering};
 use std::sync::{Arc, Mutex, OnceLock};
+use std::time::{Duration, Instant};
 
-use regex::Regex;
+use regex::{Regex, RegexSet};
 use serde_json::Value as JsonValue;
-use rustls::client::{ServerCertVerified, ServerCertVerifier};
+use rustls::client::{
+    ClientSessionMemoryCache, ClientSessionStore, Resumption, ServerCertVerified,
+    ServerCertVerifier, Tls12ClientSessionValue, Tls13ClientSessionValue,
+};
+use rustls::server::{ServerSessionMemoryCache, StoresServerSessions};
+use rustls::NamedGroup;
+use rustls::{ConnectionCommon, SideData};
 use rustls::{Certificate, ClientConfig, ClientConnection, PrivateKey, RootCertStore, ServerConfig, ServerConnection, ServerName, StreamOwned, OwnedTrustAnchor};
 use rustls_pemfile::{certs, pkcs8_private_keys, rsa_private_keys};
 use libsrtp::{MasterKey, ProtectionProfile, RecvSession, SendSession, StreamConfig};
 use openssl::pkcs12::Pkcs12;
+use openssl::error::ErrorStack;
 use openssl::pkey::PKey;
+use openssl::ssl::{
+    ErrorCode, Ssl, SslContext, SslContextBuilder, SslMethod, SslOptions, SslRef, SslStream,
+    SslVerifyMode,
+};
 use openssl::x509::X509;
 use udp_dtls::{DtlsAcceptor, DtlsConnector, Identity, SrtpProfile, UdpChannel};
 use trust_dns_resolver::config::{ResolverConfig, ResolverOpts};
+use trust_dns_resolver::error::ResolveErrorKind;
 use trust_dns_resolver::proto::rr::{RData, RecordType};
+use trust_dns_resolver::system_conf;
 use trust_dns_resolver::Resolver;
 
 #[cfg(feature = "audio")]
@@ -27,6 +45,13 @@ mod audio_stub;
 mod tri_engine;
 #[cfg(feature = "graphics3d")]
 mod tri_runtime;
+#[cfg(feature = "graphics3d")]
+mod tri_scene;
+mod handles;
+mod json_stream;
+
+use handles::HandleTable;
+use json_stream::JsonStream;
 
 #[repr(C)]
 #[derive(Copy, Clone)]
@@ -55,6 +80,7 @@ struct MdhBytes {
     data: *mut u8,
     length: i64,
     capacity: i64,
+    shared: bool,
 }
 
 pub(crate) const MDH_TAG_NIL: u8 = 0;
@@ -64,11 +90,14 @@ pub(crate) const MDH_TAG_FLOAT: u8 = 3;
 pub(crate) const MDH_TAG_STRING: u8 = 4;
 pub(crate) const MDH_TAG_LIST: u8 = 5;
 pub(crate) const MDH_TAG_DICT: u8 = 6;
+// Mirrors mdh_runtime.h; not every tag is matched on in every feature set.
+#[allow(dead_code)]
 pub(crate) const MDH_TAG_FUNCTION: u8 = 7;
+#[allow(dead_code)]
 pub(crate) const MDH_TAG_SET: u8 = 11;
+#[allow(dead_code)]
 pub(crate) const MDH_TAG_CLOSURE: u8 = 12;
 pub(crate) const MDH_TAG_BYTES: u8 = 13;
-#[cfg(feature = "graphics3d")]
 pub(crate) const MDH_TAG_NATIVE: u8 = 14;
 
 extern "C" {
@@ -82,7 +111,9 @@ extern "C" {
     fn __mdh_list_push(list: MdhValue, value: MdhValue);
     fn __mdh_bytes_new(size: MdhValue) -> MdhValue;
     fn __mdh_empty_dict() -> MdhValue;
+    fn __mdh_dict_with_capacity(cap: i64) -> MdhValue;
     fn __mdh_dict_set(dict: MdhValue, key: MdhValue, value: MdhValue) -> MdhValue;
+    fn __mdh_dict_push_new(dict: MdhValue, key: MdhValue, value: MdhValue) -> MdhValue;
     fn __mdh_dict_get_default(dict: MdhValue, key: MdhValue, default_val: MdhValue) -> MdhValue;
     fn __mdh_to_string(value: MdhValue) -> MdhValue;
 }
@@ -123,6 +154,8 @@ pub(crate) unsafe fn mdh_make_string_from_rust(s: &str) -> MdhValue {
     __mdh_make_string(cstr.as_ptr())
 }
 
+// Only the 3D runtime formats arbitrary values now that JSON output is written in C.
+#[cfg_attr(not(feature = "graphics3d"), allow(dead_code))]
 unsafe fn mdh_value_to_string(value: MdhValue) -> String {
     let s_val = __mdh_to_string(value);
     mdh_string_to_rust(s_val)
@@ -202,10 +235,120 @@ unsafe fn mdh_dict_get_u16(dict: MdhValue, key: &str) -> Option<u16> {
     }
 }
 
-fn make_resolver() -> Result<Resolver, String> {
-    Resolver::from_system_conf()
-        .or_else(|_| Resolver::new(ResolverConfig::default(), ResolverOpts::default()))
-        .map_err(|e| format!("DNS resolver init failed: {}", e))
+/// Cap on how long NXDOMAIN/NODATA answers are kept, whatever the SOA says.
+const DNS_NEGATIVE_TTL_MAX: u64 = 300;
+const DNS_CACHE_MAX: usize = 4096;
+
+enum DnsAnswer {
+    Records(Vec<RData>),
+    Ips(Vec<IpAddr>),
+}
+
+struct DnsEntry {
+    expires: Instant,
+    answer: Result<Arc<DnsAnswer>, String>,
+}
+
+// System resolver config, read once rather than on every lookup.
+static DNS_CONFIG: OnceLock<(ResolverConfig, ResolverOpts)> = OnceLock::new();
+// Answers shared by every thread, keyed by record type and lower-cased name. A/AAAA
+// lookups file under RecordType::A.
+static DNS_CACHE: OnceLock<Mutex<HashMap<(RecordType, String), DnsEntry>>> = OnceLock::new();
+
+thread_local! {
+    // The sync Resolver runs each lookup on its own runtime behind a lock, so threads
+    // keep one each instead of queueing on a shared one.
+    static RESOLVER: RefCell<Option<Resolver>> = RefCell::new(None);
+}
+
+fn with_resolver<R>(f: impl FnOnce(&Resolver) -> R) -> Result<R, String> {
+    RESOLVER.with(|slot| {
+        let mut slot = slot.borrow_mut();
+        if slot.is_none() {
+            let (config, opts) = DNS_CONFIG.get_or_init(|| {
+                system_conf::read_system_conf()
+                    .unwrap_or_else(|_| (ResolverConfig::default(), ResolverOpts::default()))
+            });
+            let resolver = Resolver::new(config.clone(), opts.clone())
+                .map_err(|e| format!("DNS resolver init failed: {}", e))?;
+            *slot = Some(resolver);
+        }
+        Ok(f(slot.as_ref().expect("resolver just set")))
+    })
+}
+
+/// Run one query, returning the answer and how long it may be cached (None: don't).
+fn dns_query(
+    resolver: &Resolver,
+    kind: RecordType,
+    name: &str,
+) -> (Result<Arc<DnsAnswer>, String>, Option<Instant>) {
+    let result = if kind == RecordType::A {
+        resolver
+            .lookup_ip(name)
+            .map(|l| (l.valid_until(), DnsAnswer::Ips(l.iter().collect())))
+    } else {
+        resolver.lookup(name, kind).map(|l| {
+            (
+                l.valid_until(),
+                DnsAnswer::Records(l.iter().cloned().collect()),
+            )
+        })
+    };
+    match result {
+        Ok((until, answer)) => (Ok(Arc::new(answer)), Some(until)),
+        Err(e) => {
+            // Only a definite "no such name/record" with an SOA TTL is worth remembering;
+            // timeouts and server failures go back to the network next time.
+            let ttl = match e.kind() {
+                ResolveErrorKind::NoRecordsFound { negative_ttl, .. } => {
+                    negative_ttl.map(|t| u64::from(t).min(DNS_NEGATIVE_TTL_MAX))
+                }
+                _ => None,
+            };
+            let until = ttl.map(|t| Instant::now() + Duration::from_secs(t));
+            (Err(e.to_string()), until)
+        }
+    }
+}
+
+/// Look `name` up through the shared cache, honouring record TTLs and negative TTLs.
+fn dns_cached(kind: RecordType, name: &str) -> Result<Result<Arc<DnsAnswer>, String>, String> {
+    let key = (kind, name.trim_end_matches('.').to_ascii_lowercase());
+    let cache = DNS_CACHE.get_or_init(|| Mutex::new(HashMap::new()));
+    if let Some(entry) = cache.lock().unwrap().get(&key) {
+        if entry.expires > Instant::now() {
+            return Ok(entry.answer.clone());
+        }
+    }
+    let (answer, until) = with_resolver(|resolver| dns_query(resolver, kind, &key.1))?;
+    if let Some(expires) = until {
+        let mut map = cache.lock().unwrap();
+        if map.len() >= DNS_CACHE_MAX {
+            let now = Instant::now();
+            map.retain(|_, entry| entry.expires > now);
+            if map.len() >= DNS_CACHE_MAX {
+                map.clear();
+            }
+        }
+        map.insert(
+            key,
+            DnsEntry {
+                expires,
+                answer: answer.clone(),
+            },
+        );
+    }
+    Ok(answer)
+}
+
+fn dns_records(kind: RecordType, name: &str, what: &str) -> Result<Vec<RData>, String> {
+    let answer =
+        dns_cached(kind, name)?.map_err(|e| format!("DNS {} lookup failed: {}", what, e))?;
+    match answer.as_ref() {
+        DnsAnswer::Records(records) => Ok(records.clone()),
+        DnsAnswer::Ips(_) => Ok(Vec::new()),
+    }
 }
 
 #[derive(Clone, Copy, PartialEq, Eq)]
@@ -234,78 +377,200 @@ struct TlsSession {
     client_config: Option<Arc<ClientConfig>>,
     server_config: Option<Arc<ServerConfig>>,
     stream: Option<TlsStream>,
+    // Set by tls_connect_start: the socket stays non-blocking and send/recv never wait.
+    nonblocking: bool,
+    // Some(resuming) while a non-blocking handshake is in flight and not yet counted.
+    pending: Option<bool>,
 }
 
-struct TlsRegistry {
-    next_id: i64,
-    sessions: HashMap<i64, TlsSession>,
-}
-
-static TLS_REGISTRY: OnceLock<Mutex<TlsRegistry>> = OnceLock::new();
+static TLS_SESSIONS: OnceLock<HandleTable<TlsSession>> = OnceLock::new();
 
-fn tls_registry() -> &'static Mutex<TlsRegistry> {
-    TLS_REGISTRY.get_or_init(|| Mutex::new(TlsRegistry {
-        next_id: 1,
-        sessions: HashMap::new(),
-    }))
+fn tls_sessions() -> &'static HandleTable<TlsSession> {
+    TLS_SESSIONS.get_or_init(HandleTable::new)
 }
 
-fn tls_register(session: TlsSession) -> i64 {
-    let mut reg = tls_registry().lock().unwrap();
-    let id = reg.next_id;
-    reg.next_id += 1;
-    reg.sessions.insert(id, session);
-    id
+fn tls_register(session: TlsSession) -> Result<i64, String> {
+    tls_sessions().insert(session)
 }
 
 fn tls_with_mut<T, F>(id: i64, f: F) -> Result<T, String>
 where
     F: FnOnce(&mut TlsSession) -> Result<T, String>,
 {
-    let mut reg = tls_registry().lock().unwrap();
-    let session = reg.sessions.get_mut(&id).ok_or("Unknown TLS handle")?;
-    f(session)
+    tls_sessions()
+        .with_mut(id, f)
+        .unwrap_or_else(|| Err("Unknown TLS handle".to_string()))
 }
 
 fn tls_remove(id: i64) {
-    let mut reg = tls_registry().lock().unwrap();
-    reg.sessions.remove(&id);
+    tls_sessions().remove(id);
+}
+
+/// Wrap `sock` in a fresh rustls connection for `session`; no records are exchanged yet.
+fn tls_open(session: &TlsSession, sock: std::net::TcpStream) -> Result<TlsStream, String> {
+    match session.mode {
+        TlsMode::Client => {
+            let config = session
+                .client_config
+                .as_ref()
+                .ok_or("Missing client config")?
+                .clone();
+            let server_name = ServerName::try_from(session.server_name.as_str())
+                .map_err(|_| "Invalid server_name")?;
+            let conn = ClientConnection::new(config, server_name).map_err(|e| e.to_string())?;
+            Ok(TlsStream::Client(StreamOwned::new(conn, sock)))
+        }
+        TlsMode::Server => {
+            let config = session
+                .server_config
+                .as_ref()
+                .ok_or("Missing server config")?
+                .clone();
+            let conn = ServerConnection::new(config).map_err(|e| e.to_string())?;
+            Ok(TlsStream::Server(StreamOwned::new(conn, sock)))
+        }
+    }
+}
+
+fn tls_count_handshake(resumed: bool) {
+    let counter = if resumed {
+        &TLS_RESUMED_HANDSHAKES
+    } else {
+        &TLS_FULL_HANDSHAKES
+    };
+    counter.fetch_add(1, Ordering::Relaxed);
+}
+
+fn tls_would_block(e: &std::io::Error) -> bool {
+    e.kind() == std::io::ErrorKind::WouldBlock
+}
+
+/// Move a non-blocking connection along without waiting: flush queued records, then,
+/// mid-handshake, feed in whatever the peer has sent. Returns what the socket has to
+/// become before the next call: "want_write", "want_read", or "ready" once the
+/// handshake is done and nothing is left to send.
+fn tls_pump<S: SideData>(
+    conn: &mut ConnectionCommon<S>,
+    sock: &mut std::net::TcpStream,
+) -> Result<&'static str, String> {
+    loop {
+        while conn.wants_write() {
+            match conn.write_tls(sock) {
+                Ok(_) => {}
+                Err(e) if tls_would_block(&e) => return Ok("want_write"),
+                Err(e) => return Err(format!("TLS I/O failed: {}", e)),
+            }
+        }
+        if !conn.is_handshaking() {
+            return Ok("ready");
+        }
+        match conn.read_tls(sock) {
+            Ok(0) => return Err("TLS handshake failed: connection closed".to_string()),
+            Ok(_) => {
+                if let Err(e) = conn.process_new_packets() {
+                    // Best effort: let the peer see the alert rustls queued.
+                    let _ = conn.write_tls(sock);
+                    return Err(format!("TLS handshake failed: {}", e));
+                }
+            }
+            Err(e) if tls_would_block(&e) => return Ok("want_read"),
+            Err(e) => return Err(format!("TLS handshake failed: {}", e)),
+        }
+    }
+}
+
+/// Non-blocking read: plaintext already decrypted comes first, then whatever the socket
+/// holds. None means nothing has arrived yet; Some(0) is the peer closing.
+fn tls_read_nb<S: SideData>(
+    conn: &mut ConnectionCommon<S>,
+    sock: &mut std::net::TcpStream,
+    buf: &mut [u8],
+) -> Result<Option<usize>, String> {
+    loop {
+        match conn.reader().read(buf) {
+            Ok(n) => return Ok(Some(n)),
+            Err(e) if tls_would_block(&e) => {}
+            Err(e) if e.kind() == std::io::ErrorKind::UnexpectedEof => return Ok(Some(0)),
+            Err(e) => return Err(format!("TLS recv failed: {}", e)),
+        }
+        match conn.read_tls(sock) {
+            Ok(0) => return Ok(Some(0)),
+            Ok(_) => {
+                conn.process_new_packets()
+                    .map_err(|e| format!("TLS recv failed: {}", e))?;
+            }
+            Err(e) if tls_would_block(&e) => return Ok(None),
+            Err(e) => return Err(format!("TLS recv failed: {}", e)),
+        }
+    }
+}
+
+/// Run tls_pump for `session` and count the handshake the first time it reports ready.
+fn tls_step(session: &mut TlsSession) -> Result<&'static str, String> {
+    let stream = session.stream.as_mut().ok_or("TLS not connected")?;
+    TLS_RESUMING.with(|r| r.set(false));
+    let status = match stream {
+        TlsStream::Client(s) => tls_pump(&mut *s.conn, &mut s.sock),
+        TlsStream::Server(s) => tls_pump(&mut *s.conn, &mut s.sock),
+    }?;
+    if let Some(resuming) = session.pending {
+        let resuming = resuming || TLS_RESUMING.with(|r| r.get());
+        if status == "ready" {
+            session.pending = None;
+            tls_count_handshake(resuming);
+        } else {
+            session.pending = Some(resuming);
+        }
+    }
+    Ok(status)
 }
 
 struct SrtpSession {
     send: SendSession,
     recv: RecvSession,
+    // libsrtp takes and returns a Vec; the returned one is kept for the next packet
+    // so steady-state protect/unprotect doesn't allocate.
+    scratch: Vec<u8>,
 }
 
-struct SrtpRegistry {
-    next_id: i64,
-    sessions: HashMap<i64, SrtpSession>,
+/// Send and receive sessions for one profile, each keyed with its (master key, salt).
+fn srtp_session_new(
+    profile: &ProtectionProfile,
+    send: (Vec<u8>, Vec<u8>),
+    recv: (Vec<u8>, Vec<u8>),
+) -> Result<SrtpSession, String> {
+    let send_cfg = StreamConfig::new(vec![MasterKey::new(&send.0, &send.1, &None)], profile, profile);
+    let recv_cfg = StreamConfig::new(vec![MasterKey::new(&recv.0, &recv.1, &None)], profile, profile);
+    let mut send = SendSession::new();
+    send.add_stream(None, &send_cfg)
+        .map_err(|e| format!("SRTP send session error: {}", e))?;
+    let mut recv = RecvSession::new();
+    recv.add_stream(None, &recv_cfg)
+        .map_err(|e| format!("SRTP recv session error: {}", e))?;
+    Ok(SrtpSession {
+        send,
+        recv,
+        scratch: Vec::new(),
+    })
 }
 
-static SRTP_REGISTRY: OnceLock<Mutex<SrtpRegistry>> = OnceLock::new();
+static SRTP_SESSIONS: OnceLock<HandleTable<SrtpSession>> = OnceLock::new();
 
-fn srtp_registry() -> &'static Mutex<SrtpRegistry> {
-    SRTP_REGISTRY.get_or_init(|| Mutex::new(SrtpRegistry {
-        next_id: 1,
-        sessions: HashMap::new(),
-    }))
+fn srtp_sessions() -> &'static HandleTable<SrtpSession> {
+    SRTP_SESSIONS.get_or_init(HandleTable::new)
 }
 
-fn srtp_register(session: SrtpSession) -> i64 {
-    let mut reg = srtp_registry().lock().unwrap();
-    let id = reg.next_id;
-    reg.next_id += 1;
-    reg.sessions.insert(id, session);
-    id
+fn srtp_register(session: SrtpSession) -> Result<i64, String> {
+    srtp_sessions().insert(session)
 }
 
 fn srtp_with_mut<T, F>(id: i64, f: F) -> Result<T, String>
 where
     F: FnOnce(&mut SrtpSession) -> Result<T, String>,
 {
-    let mut reg = srtp_registry().lock().unwrap();
-    let session = reg.sessions.get_mut(&id).ok_or("Unknown SRTP handle")?;
-    f(session)
+    srtp_sessions()
+        .with_mut(id, f)
+        .unwrap_or_else(|| Err("Unknown SRTP handle".to_string()))
 }
 
 #[derive(Clone)]
@@ -319,35 +584,23 @@ struct DtlsConfigData {
     remote_host: Option<String>,
     remote_port: Option<u16>,
     srtp_profiles: Vec<SrtpProfile>,
+    // Built by the first dtls_session_new and shared by every session after it
+    session_context: Option<SslContext>,
 }
 
-struct DtlsRegistry {
-    next_id: i64,
-    configs: HashMap<i64, DtlsConfigData>,
-}
-
-static DTLS_REGISTRY: OnceLock<Mutex<DtlsRegistry>> = OnceLock::new();
+static DTLS_CONFIGS: OnceLock<HandleTable<DtlsConfigData>> = OnceLock::new();
 
-fn dtls_registry() -> &'static Mutex<DtlsRegistry> {
-    DTLS_REGISTRY.get_or_init(|| Mutex::new(DtlsRegistry {
-        next_id: 1,
-        configs: HashMap::new(),
-    }))
+fn dtls_configs() -> &'static HandleTable<DtlsConfigData> {
+    DTLS_CONFIGS.get_or_init(HandleTable::new)
 }
 
-fn dtls_register(config: DtlsConfigData) -> i64 {
-    let mut reg = dtls_registry().lock().unwrap();
-    let id = reg.next_id;
-    reg.next_id += 1;
-    reg.configs.insert(id, config);
-    id
+fn dtls_register(config: DtlsConfigData) -> Result<i64, String> {
+    dtls_configs().insert(config)
 }
 
 fn dtls_get(id: i64) -> Result<DtlsConfigData, String> {
-    let reg = dtls_registry().lock().unwrap();
-    reg.configs
-        .get(&id)
-        .cloned()
+    dtls_configs()
+        .with_mut(id, |config| config.clone())
         .ok_or("Unknown DTLS handle".to_string())
 }
 
@@ -367,6 +620,105 @@ impl ServerCertVerifier for InsecureVerifier {
     }
 }
 
+/// Sessions and tickets shared by every TLS context in the process, so a reconnect to
+/// the same server_name resumes instead of running a full handshake. rustls keys client
+/// entries by server name. MDH_TLS_SESSION_CACHE sets the number of entries (default
+/// 256; 0 turns resumption off).
+struct TlsResumeStores {
+    client: Arc<TlsClientStore>,
+    server: Arc<TlsServerStore>,
+}
+
+static TLS_RESUME_STORES: OnceLock<Option<TlsResumeStores>> = OnceLock::new();
+static TLS_FULL_HANDSHAKES: AtomicU64 = AtomicU64::new(0);
+static TLS_RESUMED_HANDSHAKES: AtomicU64 = AtomicU64::new(0);
+
+thread_local! {
+    // The stores are consulted on the thread driving the handshake, so they can flag a
+    // resumption here for tls_connect (or tls_step) to count.
+    static TLS_RESUMING: Cell<bool> = Cell::new(false);
+}
+
+fn tls_resume_stores() -> Option<&'static TlsResumeStores> {
+    TLS_RESUME_STORES
+        .get_or_init(|| {
+            let size = std::env::var("MDH_TLS_SESSION_CACHE")
+                .ok()
+                .and_then(|v| v.trim().parse::<usize>().ok())
+                .unwrap_or(256);
+            if size == 0 {
+                return None;
+            }
+            Some(TlsResumeStores {
+                client: Arc::new(TlsClientStore(ClientSessionMemoryCache::new(size))),
+                server: Arc::new(TlsServerStore(ServerSessionMemoryCache::new(size))),
+            })
+        })
+        .as_ref()
+}
+
+fn tls_note_resume<T>(found: Option<T>) -> Option<T> {
+    if found.is_some() {
+        TLS_RESUMING.with(|r| r.set(true));
+    }
+    found
+}
+
+/// The client store counts a handshake as resumed when it hands rustls a cached
+/// session or ticket to offer.
+struct TlsClientStore(ClientSessionMemoryCache);
+
+impl ClientSessionStore for TlsClientStore {
+    fn set_kx_hint(&self, server_name: &ServerName, group: NamedGroup) {
+        self.0.set_kx_hint(server_name, group)
+    }
+
+    fn kx_hint(&self, server_name: &ServerName) -> Option<NamedGroup> {
+        self.0.kx_hint(server_name)
+    }
+
+    fn set_tls12_session(&self, server_name: &ServerName, value: Tls12ClientSessionValue) {
+        self.0.set_tls12_session(server_name, value)
+    }
+
+    fn tls12_session(&self, server_name: &ServerName) -> Option<Tls12ClientSessionValue> {
+        tls_note_resume(self.0.tls12_session(server_name))
+    }
+
+    fn remove_tls12_session(&self, server_name: &ServerName) {
+        self.0.remove_tls12_session(server_name)
+    }
+
+    fn insert_tls13_ticket(&self, server_name: &ServerName, value: Tls13ClientSessionValue) {
+        self.0.insert_tls13_ticket(server_name, value)
+    }
+
+    fn take_tls13_ticket(&self, server_name: &ServerName) -> Option<Tls13ClientSessionValue> {
+        tls_note_resume(self.0.take_tls13_ticket(server_name))
+    }
+}
+
+/// The server store counts a handshake as resumed when a client's session is found.
+struct TlsServerStore(Arc<ServerSessionMemoryCache>);
+
+impl StoresServerSessions for TlsServerStore {
+    fn put(&self, key: Vec<u8>, value: Vec<u8>) -> bool {
+        self.0.put(key, value)
+    }
+
+    fn get(&self, key: &[u8]) -> Option<Vec<u8>> {
+        tls_note_resume(self.0.get(key))
+    }
+
+    fn take(&self, key: &[u8]) -> Option<Vec<u8>> {
+        tls_note_resume(self.0.take(key))
+    }
+
+    fn can_cache(&self) -> bool {
+        self.0.can_cache()
+    }
+}
+
 fn tls_config_from_value(config: MdhValue) -> Result<TlsConfigData, String> {
     unsafe {
         if config.tag == MDH_TAG_NIL {
@@ -465,6 +817,24 @@ fn tls_config_from_value(config: MdhValue) -> Result<TlsConfigData, String> {
     }
 }
 
+// The bundled webpki roots, converted the first time a client config wants them rather
+// than on every tls_config() call.
+static DEFAULT_ROOTS: OnceLock<RootCertStore> = OnceLock::new();
+
+fn default_roots() -> &'static RootCertStore {
+    DEFAULT_ROOTS.get_or_init(|| {
+        let mut roots = RootCertStore::empty();
+        roots.add_trust_anchors(webpki_roots::TLS_SERVER_ROOTS.iter().map(|ta| {
+            OwnedTrustAnchor::from_subject_spki_name_constraints(
+                ta.subject,
+                ta.spki,
+                ta.name_constraints,
+            )
+        }));
+        roots
+    })
+}
+
 fn build_client_config(cfg: &TlsConfigData) -> Result<Arc<ClientConfig>, String> {
     let mut roots = RootCertStore::empty();
     if let Some(pem) = &cfg.ca_pem {
@@ -475,13 +845,7 @@ fn build_client_config(cfg: &TlsConfigData) -> Result<Arc<ClientConfig>, String>
             return Err("No valid CA certificates found".to_string());
         }
     } else {
-        roots.add_trust_anchors(webpki_roots::TLS_SERVER_ROOTS.iter().map(|ta| {
-            OwnedTrustAnchor::from_subject_spki_name_constraints(
-                ta.subject,
-                ta.spki,
-                ta.name_constraints,
-            )
-        }));
+        roots = default_roots().clone();
     }
 
     let mut config = ClientConfig::builder()
@@ -494,6 +858,10 @@ fn build_client_config(cfg: &TlsConfigData) -> Result<Arc<ClientConfig>, String>
             .dangerous()
             .set_certificate_verifier(Arc::new(InsecureVerifier));
     }
+    config.resumption = match tls_resume_stores() {
+        Some(stores) => Resumption::store(stores.client.clone()),
+        None => Resumption::disabled(),
+    };
 
     Ok(Arc::new(config))
 }
@@ -521,11 +889,14 @@ fn build_server_config(cfg: &TlsConfigData) -> Result<Arc<ServerConfig>, String>
         .next()
         .ok_or("Server key_pem did not contain a private key")?;
 
-    let config = ServerConfig::builder()
+    let mut config = ServerConfig::builder()
         .with_safe_defaults()
         .with_no_client_auth()
         .with_single_cert(certs, PrivateKey(key))
         .map_err(|e| format!("Invalid server TLS config: {}", e))?;
+    if let Some(stores) = tls_resume_stores() {
+        config.session_storage = stores.server.clone();
+    }
 
     Ok(Arc::new(config))
 }
@@ -580,6 +951,7 @@ fn dtls_config_from_value(config: MdhValue) -> Result<DtlsConfigData, String> {
                 remote_host: None,
                 remote_port: None,
                 srtp_profiles: vec![SrtpProfile::Aes128CmSha180],
+                session_context: None,
             });
         }
         if config.tag != MDH_TAG_DICT {
@@ -639,6 +1011,7 @@ fn dtls_config_from_value(config: MdhValue) -> Result<DtlsConfigData, String> {
             remote_host,
             remote_port,
             srtp_profiles: profiles,
+            session_context: None,
         })
     }
 }
@@ -692,194 +1065,89 @@ fn lenient_json_for_serde_json(input: &str) -> String {
     out
 }
 
-fn json_escape_string(s: &str) -> String {
-    let mut result = String::from("\"");
-    for c in s.chars() {
-        match c {
-            '"' => result.push_str("\\\""),
-            '\\' => result.push_str("\\\\"),
-            '\n' => result.push_str("\\n"),
-            '\t' => result.push_str("\\t"),
-            '\r' => result.push_str("\\r"),
-            c if c.is_control() => {
-                result.push_str(&format!("\\u{:04x}", c as u32));
-            }
-            c => result.push(c),
-        }
-    }
-    result.push('"');
-    result
-}
-
-unsafe fn json_fallback_string(value: MdhValue) -> String {
-    let s = mdh_value_to_string(value);
-    let escaped = s.replace('"', "\\\"");
-    format!("\"{}\"", escaped)
+/// Builds runtime values straight from a parsed document. Containers are allocated at
+/// their final size, and object keys are interned per parse: runtime strings are immutable,
+/// so every `"id"` in an array of records shares one value (and its cached hash).
+struct JsonBuilder<'a> {
+    keys: HashMap<&'a str, MdhValue>,
 }
 
-unsafe fn mdh_value_to_json(value: MdhValue, pretty: bool, indent: usize) -> String {
-    let ws = "  ".repeat(indent);
-    let ws_inner = "  ".repeat(indent + 1);
-
-    match value.tag {
-        MDH_TAG_NIL => "null".to_string(),
-        MDH_TAG_BOOL => {
-            if value.data != 0 {
-                "true".to_string()
-            } else {
-                "false".to_string()
-            }
-        }
-        MDH_TAG_INT => value.data.to_string(),
-        MDH_TAG_FLOAT => {
-            let f = mdh_float_value(value);
-            if f.is_nan() || f.is_infinite() {
-                "null".to_string()
-            } else {
-                f.to_string()
-            }
-        }
-        MDH_TAG_STRING => {
-            let s = mdh_string_to_rust(value);
-            json_escape_string(&s)
-        }
-        MDH_TAG_LIST => {
-            if value.data == 0 {
-                return "[]".to_string();
-            }
-            let list_ptr = value.data as *const MdhList;
-            if list_ptr.is_null() {
-                return "[]".to_string();
-            }
-            let list = &*list_ptr;
-            let len = list.length.max(0) as usize;
-            if len == 0 {
-                return "[]".to_string();
-            }
-            let items = if list.items.is_null() {
-                &[] as &[MdhValue]
-            } else {
-                std::slice::from_raw_parts(list.items, len)
-            };
-            if pretty {
-                let parts: Vec<String> = items
-                    .iter()
-                    .map(|v| format!("{}{}", ws_inner, mdh_value_to_json(*v, true, indent + 1)))
-                    .collect();
-                format!("[\n{}\n{}]", parts.join(",\n"), ws)
-            } else {
-                let parts: Vec<String> = items
-                    .iter()
-                    .map(|v| mdh_value_to_json(*v, false, indent))
-                    .collect();
-                format!("[{}]", parts.join(", "))
-            }
-        }
-        MDH_TAG_SET | MDH_TAG_FUNCTION | MDH_TAG_CLOSURE | MDH_TAG_BYTES => {
-            json_fallback_string(value)
-        }
-        MDH_TAG_DICT => {
-            if value.data == 0 {
-                return "{}".to_string();
-            }
-            let dict_ptr = value.data as *const i64;
-            if dict_ptr.is_null() {
-                return "{}".to_string();
-            }
-            let count = *dict_ptr;
-            if count <= 0 {
-                return "{}".to_string();
-            }
-            let entries_ptr = dict_ptr.add(1) as *const MdhValue;
-            let entries = std::slice::from_raw_parts(entries_ptr, (count * 2) as usize);
-            let mut parts = Vec::with_capacity(count as usize);
-            for i in 0..count {
-                let key_val = entries[(i * 2) as usize];
-                let val = entries[(i * 2 + 1) as usize];
-                let key_str = if key_val.tag == MDH_TAG_STRING {
-                    mdh_string_to_rust(key_val)
-                } else {
-                    mdh_value_to_string(key_val)
-                };
-                let key_json = json_escape_string(&key_str);
-                let val_json = if pretty {
-                    mdh_value_to_json(val, true, indent + 1)
-                } else {
-                    mdh_value_to_json(val, false, indent)
-                };
-                if pretty {
-                    parts.push(format!("{}{}: {}", ws_inner, key_json, val_json));
-                } else {
-                    parts.push(format!("{}: {}", key_json, val_json));
-                }
-            }
-            if pretty {
-                format!("{{\n{}\n{}}}", parts.join(",\n"), ws)
-            } else {
-                format!("{{{}}}", parts.join(", "))
-            }
-        }
-        _ => json_fallback_string(value),
+impl<'a> JsonBuilder<'a> {
+    fn key(&mut self, k: &'a str) -> MdhValue {
+        *self
+            .keys
+            .entry(k)
+            .or_insert_with(|| unsafe { mdh_make_string_from_rust(k) })
     }
-}
 
-fn json_to_mdh(value: &JsonValue) -> Result<MdhValue, String> {
-    unsafe {
-        match value {
-            JsonValue::Null => Ok(__mdh_make_nil()),
-            JsonValue::Bool(b) => Ok(__mdh_make_bool(*b)),
-            JsonValue::Number(n) => {
-                if let Some(i) = n.as_i64() {
-                    return Ok(__mdh_make_int(i));
-                }
-                if let Some(u) = n.as_u64() {
-                    if u <= i64::MAX as u64 {
-                        return Ok(__mdh_make_int(u as i64));
+    fn build(&mut self, value: &'a JsonValue) -> Result<MdhValue, String> {
+        unsafe {
+            match value {
+                JsonValue::Null => Ok(__mdh_make_nil()),
+                JsonValue::Bool(b) => Ok(__mdh_make_bool(*b)),
+                JsonValue::Number(n) => {
+                    if let Some(i) = n.as_i64() {
+                        return Ok(__mdh_make_int(i));
                     }
-                    return Err("Integer out of range".to_string());
-                }
-                if let Some(f) = n.as_f64() {
-                    return Ok(__mdh_make_float(f));
+                    if let Some(u) = n.as_u64() {
+                        if u <= i64::MAX as u64 {
+                            return Ok(__mdh_make_int(u as i64));
+                        }
+                        return Err("Integer out of range".to_string());
+                    }
+                    if let Some(f) = n.as_f64() {
+                        return Ok(__mdh_make_float(f));
+                    }
+                    Err("Invalid number".to_string())
                 }
-                Err("Invalid number".to_string())
-            }
-            JsonValue::String(s) => Ok(mdh_make_string_from_rust(s)),
-            JsonValue::Array(items) => {
-                let list = __mdh_make_list(items.len() as i32);
-                for item in items {
-                    let v = json_to_mdh(item)?;
-                    __mdh_list_push(list, v);
+                JsonValue::String(s) => Ok(mdh_make_string_from_rust(s)),
+                JsonValue::Array(items) => {
+                    let list = __mdh_make_list(items.len() as i32);
+                    for item in items {
+                        let v = self.build(item)?;
+                        __mdh_list_push(list, v);
+                    }
+                    Ok(list)
                 }
-                Ok(list)
-            }
-            JsonValue::Object(map) => {
-                let mut dict = __mdh_empty_dict();
-                for (k, v) in map.iter() {
-                    let key = mdh_make_string_from_rust(k);
-                    let val = json_to_mdh(v)?;
-                    dict = __mdh_dict_set(dict, key, val);
+                JsonValue::Object(map) => {
+                    // serde_json has already collapsed duplicate keys, so skip the lookup.
+                    let mut dict = __mdh_dict_with_capacity(map.len() as i64);
+                    for (k, v) in map.iter() {
+                        let key = self.key(k);
+                        let val = self.build(v)?;
+                        dict = __mdh_dict_push_new(dict, key, val);
+                    }
+                    Ok(dict)
                 }
-                Ok(dict)
             }
         }
     }
 }
 
+fn json_to_mdh(value: &JsonValue) -> Result<MdhValue, String> {
+    JsonBuilder {
+        keys: HashMap::new(),
+    }
+    .build(value)
+}
+
+/// Parse one JSON document with json_parse's leniency, erroring as "Invalid JSON: ...".
+fn parse_json_text(text: &str) -> Result<MdhValue, String> {
+    let text = lenient_json_for_serde_json(text);
+    let parsed: JsonValue =
+        serde_json::from_str(&text).map_err(|e| format!("Invalid JSON: {}", e))?;
+    json_to_mdh(&parsed).map_err(|e| format!("Invalid JSON: {}", e))
+}
+
 #[no_mangle]
 pub extern "C" fn __mdh_rs_json_parse(json_str: MdhValue) -> MdhRsResult {
     match std::panic::catch_unwind(|| unsafe {
         if json_str.tag != MDH_TAG_STRING {
             return mdh_err("json_parse expects a string");
         }
-        let text = mdh_string_to_rust(json_str);
-        let text = lenient_json_for_serde_json(&text);
-        let parsed: JsonValue = match serde_json::from_str(&text) {
-            Ok(v) => v,
-            Err(e) => return mdh_err(&format!("Invalid JSON: {}", e)),
-        };
-        match json_to_mdh(&parsed) {
+        match parse_json_text(&mdh_str(json_str)) {
             Ok(v) => mdh_ok(v),
-            Err(e) => mdh_err(&format!("Invalid JSON: {}", e)),
+            Err(e) => mdh_err(&e),
         }
     }) {
         Ok(result) => result,
@@ -887,207 +1155,446 @@ pub extern "C" fn __mdh_rs_json_parse(json_str: MdhValue) -> MdhRsResult {
     }
 }
 
+static JSON_STREAMS: OnceLock<HandleTable<JsonStream>> = OnceLock::new();
+
+fn json_streams() -> &'static HandleTable<JsonStream> {
+    JSON_STREAMS.get_or_init(HandleTable::new)
+}
+
+unsafe fn json_stream_insert(stream: JsonStream) -> MdhRsResult {
+    match json_streams().insert(stream) {
+        Ok(handle) => mdh_ok(__mdh_make_int(handle)),
+        Err(e) => mdh_err(&e),
+    }
+}
+
 #[no_mangle]
-pub extern "C" fn __mdh_rs_json_stringify(value: MdhValue) -> MdhRsResult {
+pub extern "C" fn __mdh_rs_json_stream_open(path: MdhValue) -> MdhRsResult {
     match std::panic::catch_unwind(|| unsafe {
-        let s = mdh_value_to_json(value, false, 0);
-        mdh_ok(mdh_make_string_from_rust(&s))
+        let path = mdh_str(path);
+        match std::fs::File::open(&*path) {
+            Ok(file) => json_stream_insert(JsonStream::from_file(file)),
+            Err(e) => mdh_err(&format!("json_stream_open: cannot open '{}': {}", path, e)),
+        }
     }) {
         Ok(result) => result,
-        Err(_) => unsafe { mdh_err("Rust panic in json_stringify") },
+        Err(_) => unsafe { mdh_err("Rust panic in json_stream_open") },
     }
 }
 
 #[no_mangle]
-pub extern "C" fn __mdh_rs_json_pretty(value: MdhValue) -> MdhRsResult {
-    match std::panic::catch_unwind(|| unsafe {
-        let s = mdh_value_to_json(value, true, 0);
-        mdh_ok(mdh_make_string_from_rust(&s))
-    }) {
+pub extern "C" fn __mdh_rs_json_stream_new() -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe { json_stream_insert(JsonStream::push()) }) {
         Ok(result) => result,
-        Err(_) => unsafe { mdh_err("Rust panic in json_pretty") },
+        Err(_) => unsafe { mdh_err("Rust panic in json_stream_new") },
     }
 }
 
 #[no_mangle]
-pub extern "C" fn __mdh_rs_regex_test(text: MdhValue, pattern: MdhValue) -> MdhRsResult {
+pub extern "C" fn __mdh_rs_json_stream_feed(stream: MdhValue, chunk: MdhValue) -> MdhRsResult {
     match std::panic::catch_unwind(|| unsafe {
-        if text.tag != MDH_TAG_STRING || pattern.tag != MDH_TAG_STRING {
-            return mdh_err("regex_test expects strings");
-        }
-
-        let text_s = mdh_string_to_rust(text);
-        let pat_s = mdh_string_to_rust(pattern);
-        let re = match Regex::new(&pat_s) {
-            Ok(r) => r,
-            Err(e) => return mdh_err(&format!("Invalid regex '{}': {}", pat_s, e)),
+        let data: Cow<[u8]> = if chunk.tag == MDH_TAG_STRING {
+            Cow::Borrowed(CStr::from_ptr(chunk.data as *const c_char).to_bytes())
+        } else {
+            match mdh_bytes_to_vec(chunk) {
+                Some(bytes) => Cow::Owned(bytes),
+                None => return mdh_err("json_stream_feed expects bytes or a string"),
+            }
         };
-
-        mdh_ok(__mdh_make_bool(re.is_match(&text_s)))
+        match json_streams().with_mut(stream.data, |s| s.feed(&data)) {
+            Some(Ok(())) => mdh_ok(__mdh_make_nil()),
+            Some(Err(e)) => mdh_err(&e),
+            None => mdh_err("Unknown JSON stream handle"),
+        }
     }) {
         Ok(result) => result,
-        Err(_) => unsafe { mdh_err("Rust panic in regex_test") },
+        Err(_) => unsafe { mdh_err("Rust panic in json_stream_feed") },
     }
 }
 
 #[no_mangle]
-pub extern "C" fn __mdh_rs_regex_match(text: MdhValue, pattern: MdhValue) -> MdhRsResult {
+pub extern "C" fn __mdh_rs_json_stream_next(stream: MdhValue) -> MdhRsResult {
     match std::panic::catch_unwind(|| unsafe {
-        if text.tag != MDH_TAG_STRING || pattern.tag != MDH_TAG_STRING {
-            return mdh_err("regex_match expects strings");
-        }
-
-        let text_s = mdh_string_to_rust(text);
-        let pat_s = mdh_string_to_rust(pattern);
-        let re = match Regex::new(&pat_s) {
-            Ok(r) => r,
-            Err(e) => return mdh_err(&format!("Invalid regex '{}': {}", pat_s, e)),
-        };
-
-        if let Some(m) = re.find(&text_s) {
-            let mut dict = __mdh_empty_dict();
-            dict = __mdh_dict_set(
-                dict,
-                mdh_make_string_from_rust("match"),
-                mdh_make_string_from_rust(m.as_str()),
-            );
-            dict = __mdh_dict_set(
-                dict,
-                mdh_make_string_from_rust("start"),
-                __mdh_make_int(m.start() as i64),
-            );
-            dict = __mdh_dict_set(
-                dict,
-                mdh_make_string_from_rust("end"),
-                __mdh_make_int(m.end() as i64),
-            );
-            mdh_ok(dict)
-        } else {
-            mdh_ok(__mdh_make_nil())
+        let next = json_streams().with_mut(stream.data, |s| match s.next_record()? {
+            Some(record) => parse_json_text(&String::from_utf8_lossy(record)),
+            None => Ok(__mdh_make_nil()),
+        });
+        match next {
+            Some(Ok(v)) => mdh_ok(v),
+            Some(Err(e)) => mdh_err(&e),
+            None => mdh_err("Unknown JSON stream handle"),
         }
     }) {
         Ok(result) => result,
-        Err(_) => unsafe { mdh_err("Rust panic in regex_match") },
+        Err(_) => unsafe { mdh_err("Rust panic in json_stream_next") },
     }
 }
 
 #[no_mangle]
-pub extern "C" fn __mdh_rs_regex_match_all(text: MdhValue, pattern: MdhValue) -> MdhRsResult {
+pub extern "C" fn __mdh_rs_json_stream_close(stream: MdhValue) -> MdhRsResult {
     match std::panic::catch_unwind(|| unsafe {
-        if text.tag != MDH_TAG_STRING || pattern.tag != MDH_TAG_STRING {
-            return mdh_err("regex_match_all expects strings");
-        }
-
-        let text_s = mdh_string_to_rust(text);
-        let pat_s = mdh_string_to_rust(pattern);
-        let re = match Regex::new(&pat_s) {
-            Ok(r) => r,
-            Err(e) => return mdh_err(&format!("Invalid regex '{}': {}", pat_s, e)),
-        };
-
-        let result = __mdh_make_list(8);
-        for m in re.find_iter(&text_s) {
-            let mut dict = __mdh_empty_dict();
-            dict = __mdh_dict_set(
-                dict,
-                mdh_make_string_from_rust("match"),
-                mdh_make_string_from_rust(m.as_str()),
-            );
-            dict = __mdh_dict_set(
-                dict,
-                mdh_make_string_from_rust("start"),
-                __mdh_make_int(m.start() as i64),
-            );
-            dict = __mdh_dict_set(
-                dict,
-                mdh_make_string_from_rust("end"),
-                __mdh_make_int(m.end() as i64),
-            );
-            __mdh_list_push(result, dict);
-        }
-        mdh_ok(result)
+        json_streams().remove(stream.data);
+        mdh_ok(__mdh_make_nil())
     }) {
         Ok(result) => result,
-        Err(_) => unsafe { mdh_err("Rust panic in regex_match_all") },
+        Err(_) => unsafe { mdh_err("Rust panic in json_stream_close") },
     }
 }
 
-#[no_mangle]
-pub extern "C" fn __mdh_rs_regex_replace(
-    text: MdhValue,
-    pattern: MdhValue,
-    replacement: MdhValue,
-) -> MdhRsResult {
-    match std::panic::catch_unwind(|| unsafe {
-        if text.tag != MDH_TAG_STRING || pattern.tag != MDH_TAG_STRING || replacement.tag != MDH_TAG_STRING {
-            return mdh_err("regex_replace expects strings");
-        }
+/// Compiled patterns kept per thread, so hot regex_* calls with a literal pattern skip
+/// Regex::new. The least recently used entry goes when the cache is full.
+const REGEX_CACHE_SIZE: usize = 64;
 
-        let text_s = mdh_string_to_rust(text);
-        let pat_s = mdh_string_to_rust(pattern);
-        let repl_s = mdh_string_to_rust(replacement);
-        let re = match Regex::new(&pat_s) {
-            Ok(r) => r,
-            Err(e) => return mdh_err(&format!("Invalid regex '{}': {}", pat_s, e)),
-        };
+struct RegexCache {
+    entries: HashMap<String, (Regex, u64)>,
+    tick: u64,
+}
 
-        let replaced = re.replace_all(&text_s, repl_s.as_str()).to_string();
-        mdh_ok(mdh_make_string_from_rust(&replaced))
-    }) {
-        Ok(result) => result,
-        Err(_) => unsafe { mdh_err("Rust panic in regex_replace") },
+thread_local! {
+    static REGEX_CACHE: RefCell<RegexCache> = RefCell::new(RegexCache {
+        entries: HashMap::new(),
+        tick: 0,
+    });
+}
+
+/// Layout of the C MdhRegex from regex_compile (T = Regex) or regex_set_new
+/// (T = RegexSet): the native-object header, then the compiled value it owns for the
+/// rest of the program. `fields` holds the source pattern or list.
+#[repr(C)]
+struct MdhCompiledObject<T> {
+    kind: i32,
+    type_name: *const c_char,
+    ctor_kind: *const c_char,
+    fields: MdhValue,
+    compiled: *const T,
+}
+
+/// Borrow a runtime string without copying it when it is valid UTF-8.
+unsafe fn mdh_str<'a>(value: MdhValue) -> Cow<'a, str> {
+    if value.tag != MDH_TAG_STRING || value.data == 0 {
+        return Cow::Borrowed("");
     }
+    CStr::from_ptr(value.data as *const c_char).to_string_lossy()
 }
 
-#[no_mangle]
-pub extern "C" fn __mdh_rs_regex_replace_first(
-    text: MdhValue,
-    pattern: MdhValue,
-    replacement: MdhValue,
-) -> MdhRsResult {
-    match std::panic::catch_unwind(|| unsafe {
-        if text.tag != MDH_TAG_STRING || pattern.tag != MDH_TAG_STRING || replacement.tag != MDH_TAG_STRING {
-            return mdh_err("regex_replace_first expects strings");
+/// Run `f` with the Regex for `pattern`: a regex_compile object, or a pattern string
+/// looked up in (or added to) this thread's cache.
+unsafe fn with_regex<R>(pattern: MdhValue, f: impl FnOnce(&Regex) -> R) -> Result<R, String> {
+    if pattern.tag == MDH_TAG_NATIVE && pattern.data != 0 {
+        let obj = pattern.data as *const MdhCompiledObject<Regex>;
+        return Ok(f(&*(*obj).compiled));
+    }
+    let pat_s = mdh_str(pattern);
+    REGEX_CACHE.with(|cache| {
+        let mut cache = cache.borrow_mut();
+        cache.tick += 1;
+        let tick = cache.tick;
+        if let Some(entry) = cache.entries.get_mut(pat_s.as_ref()) {
+            entry.1 = tick;
+            return Ok(f(&entry.0));
         }
+        let re = Regex::new(&pat_s).map_err(|e| format!("Invalid regex '{}': {}", pat_s, e))?;
+        if cache.entries.len() >= REGEX_CACHE_SIZE {
+            let oldest = cache
+                .entries
+                .iter()
+                .min_by_key(|(_, (_, used))| *used)
+                .map(|(key, _)| key.clone());
+            if let Some(oldest) = oldest {
+                cache.entries.remove(&oldest);
+            }
+        }
+        let entry = cache
+            .entries
+            .entry(pat_s.into_owned())
+            .or_insert((re, tick));
+        Ok(f(&entry.0))
+    })
+}
 
-        let text_s = mdh_string_to_rust(text);
-        let pat_s = mdh_string_to_rust(pattern);
-        let repl_s = mdh_string_to_rust(replacement);
-        let re = match Regex::new(&pat_s) {
-            Ok(r) => r,
-            Err(e) => return mdh_err(&format!("Invalid regex '{}': {}", pat_s, e)),
-        };
+fn regex_pattern_ok(pattern: MdhValue) -> bool {
+    pattern.tag == MDH_TAG_STRING || pattern.tag == MDH_TAG_NATIVE
+}
 
-        let replaced = re.replacen(&text_s, 1, repl_s.as_str()).to_string();
-        mdh_ok(mdh_make_string_from_rust(&replaced))
+/// Compile `pattern` once for regex_compile; the C side wraps the returned pointer.
+#[no_mangle]
+pub extern "C" fn __mdh_rs_regex_compile(pattern: MdhValue) -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe {
+        if pattern.tag != MDH_TAG_STRING {
+            return mdh_err("regex_compile expects a pattern string");
+        }
+        let pat_s = mdh_str(pattern);
+        match Regex::new(&pat_s) {
+            Ok(re) => mdh_ok(__mdh_make_int(Box::into_raw(Box::new(re)) as i64)),
+            Err(e) => mdh_err(&format!("Invalid regex '{}': {}", pat_s, e)),
+        }
     }) {
         Ok(result) => result,
-        Err(_) => unsafe { mdh_err("Rust panic in regex_replace_first") },
+        Err(_) => unsafe { mdh_err("Rust panic in regex_compile") },
     }
 }
 
 #[no_mangle]
-pub extern "C" fn __mdh_rs_regex_split(text: MdhValue, pattern: MdhValue) -> MdhRsResult {
+pub extern "C" fn __mdh_rs_regex_test(text: MdhValue, pattern: MdhValue) -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe {
+        if text.tag != MDH_TAG_STRING || !regex_pattern_ok(pattern) {
+            return mdh_err("regex_test expects strings");
+        }
+
+        let text_s = mdh_str(text);
+        let res = with_regex(pattern, |re| mdh_ok(__mdh_make_bool(re.is_match(&text_s))));
+        match res {
+            Ok(result) => result,
+            Err(e) => mdh_err(&e),
+        }
+    }) {
+        Ok(result) => result,
+        Err(_) => unsafe { mdh_err("Rust panic in regex_test") },
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn __mdh_rs_regex_match(text: MdhValue, pattern: MdhValue) -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe {
+        if text.tag != MDH_TAG_STRING || !regex_pattern_ok(pattern) {
+            return mdh_err("regex_match expects strings");
+        }
+
+        let text_s = mdh_str(text);
+        let res = with_regex(pattern, |re| {
+            if let Some(m) = re.find(&text_s) {
+                let mut dict = __mdh_empty_dict();
+                dict = __mdh_dict_set(
+                    dict,
+                    mdh_make_string_from_rust("match"),
+                    mdh_make_string_from_rust(m.as_str()),
+                );
+                dict = __mdh_dict_set(
+                    dict,
+                    mdh_make_string_from_rust("start"),
+                    __mdh_make_int(m.start() as i64),
+                );
+                dict = __mdh_dict_set(
+                    dict,
+                    mdh_make_string_from_rust("end"),
+                    __mdh_make_int(m.end() as i64),
+                );
+                mdh_ok(dict)
+            } else {
+                mdh_ok(__mdh_make_nil())
+            }
+        });
+        match res {
+            Ok(result) => result,
+            Err(e) => mdh_err(&e),
+        }
+    }) {
+        Ok(result) => result,
+        Err(_) => unsafe { mdh_err("Rust panic in regex_match") },
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn __mdh_rs_regex_match_all(text: MdhValue, pattern: MdhValue) -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe {
+        if text.tag != MDH_TAG_STRING || !regex_pattern_ok(pattern) {
+            return mdh_err("regex_match_all expects strings");
+        }
+
+        let text_s = mdh_str(text);
+        let res = with_regex(pattern, |re| {
+            let result = __mdh_make_list(8);
+            for m in re.find_iter(&text_s) {
+                let mut dict = __mdh_empty_dict();
+                dict = __mdh_dict_set(
+                    dict,
+                    mdh_make_string_from_rust("match"),
+                    mdh_make_string_from_rust(m.as_str()),
+                );
+                dict = __mdh_dict_set(
+                    dict,
+                    mdh_make_string_from_rust("start"),
+                    __mdh_make_int(m.start() as i64),
+                );
+                dict = __mdh_dict_set(
+                    dict,
+                    mdh_make_string_from_rust("end"),
+                    __mdh_make_int(m.end() as i64),
+                );
+                __mdh_list_push(result, dict);
+            }
+            mdh_ok(result)
+        });
+        match res {
+            Ok(result) => result,
+            Err(e) => mdh_err(&e),
+        }
+    }) {
+        Ok(result) => result,
+        Err(_) => unsafe { mdh_err("Rust panic in regex_match_all") },
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn __mdh_rs_regex_replace(
+    text: MdhValue,
+    pattern: MdhValue,
+    replacement: MdhValue,
+) -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe {
+        if text.tag != MDH_TAG_STRING || !regex_pattern_ok(pattern) || replacement.tag != MDH_TAG_STRING {
+            return mdh_err("regex_replace expects strings");
+        }
+
+        let text_s = mdh_str(text);
+        let repl_s = mdh_str(replacement);
+        let res = with_regex(pattern, |re| {
+            let replaced = re.replace_all(&text_s, &*repl_s).to_string();
+            mdh_ok(mdh_make_string_from_rust(&replaced))
+        });
+        match res {
+            Ok(result) => result,
+            Err(e) => mdh_err(&e),
+        }
+    }) {
+        Ok(result) => result,
+        Err(_) => unsafe { mdh_err("Rust panic in regex_replace") },
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn __mdh_rs_regex_replace_first(
+    text: MdhValue,
+    pattern: MdhValue,
+    replacement: MdhValue,
+) -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe {
+        if text.tag != MDH_TAG_STRING || !regex_pattern_ok(pattern) || replacement.tag != MDH_TAG_STRING {
+            return mdh_err("regex_replace_first expects strings");
+        }
+
+        let text_s = mdh_str(text);
+        let repl_s = mdh_str(replacement);
+        let res = with_regex(pattern, |re| {
+            let replaced = re.replacen(&text_s, 1, &*repl_s).to_string();
+            mdh_ok(mdh_make_string_from_rust(&replaced))
+        });
+        match res {
+            Ok(result) => result,
+            Err(e) => mdh_err(&e),
+        }
+    }) {
+        Ok(result) => result,
+        Err(_) => unsafe { mdh_err("Rust panic in regex_replace_first") },
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn __mdh_rs_regex_split(text: MdhValue, pattern: MdhValue) -> MdhRsResult {
     match std::panic::catch_unwind(|| unsafe {
-        if text.tag != MDH_TAG_STRING || pattern.tag != MDH_TAG_STRING {
+        if text.tag != MDH_TAG_STRING || !regex_pattern_ok(pattern) {
             return mdh_err("regex_split expects strings");
         }
 
-        let text_s = mdh_string_to_rust(text);
-        let pat_s = mdh_string_to_rust(pattern);
-        let re = match Regex::new(&pat_s) {
-            Ok(r) => r,
-            Err(e) => return mdh_err(&format!("Invalid regex '{}': {}", pat_s, e)),
+        let text_s = mdh_str(text);
+        let res = with_regex(pattern, |re| {
+            let result = __mdh_make_list(8);
+            for part in re.split(&text_s) {
+                __mdh_list_push(result, mdh_make_string_from_rust(part));
+            }
+            mdh_ok(result)
+        });
+        match res {
+            Ok(result) => result,
+            Err(e) => mdh_err(&e),
+        }
+    }) {
+        Ok(result) => result,
+        Err(_) => unsafe { mdh_err("Rust panic in regex_split") },
+    }
+}
+
+/// Build one RegexSet from a list of pattern strings or regex_compile objects for
+/// regex_set_new; the C side wraps the returned pointer.
+#[no_mangle]
+pub extern "C" fn __mdh_rs_regex_set_new(patterns: MdhValue) -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe {
+        if patterns.tag != MDH_TAG_LIST || patterns.data == 0 {
+            return mdh_err("regex_set_new expects a list of patterns");
+        }
+        let list = patterns.data as *const MdhList;
+        let items: &[MdhValue] = if (*list).items.is_null() || (*list).length <= 0 {
+            &[]
+        } else {
+            std::slice::from_raw_parts((*list).items, (*list).length as usize)
         };
+        let mut sources = Vec::with_capacity(items.len());
+        for item in items {
+            let source = match item.tag {
+                MDH_TAG_STRING => mdh_str(*item),
+                MDH_TAG_NATIVE if item.data != 0 => {
+                    mdh_str((*(item.data as *const MdhCompiledObject<Regex>)).fields)
+                }
+                _ => return mdh_err("regex_set_new expects a list of patterns"),
+            };
+            sources.push(source);
+        }
+        match RegexSet::new(&sources) {
+            Ok(set) => mdh_ok(__mdh_make_int(Box::into_raw(Box::new(set)) as i64)),
+            Err(e) => mdh_err(&format!("Invalid regex set: {}", e)),
+        }
+    }) {
+        Ok(result) => result,
+        Err(_) => unsafe { mdh_err("Rust panic in regex_set_new") },
+    }
+}
 
+/// Indices of every pattern in the set that matches `text`, from one scan, ascending.
+#[no_mangle]
+pub extern "C" fn __mdh_rs_regex_set_match(set: MdhValue, text: MdhValue) -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe {
+        if set.tag != MDH_TAG_NATIVE || set.data == 0 || text.tag != MDH_TAG_STRING {
+            return mdh_err("regex_set_match expects a regex set and a string");
+        }
+        let obj = set.data as *const MdhCompiledObject<RegexSet>;
         let result = __mdh_make_list(8);
-        for part in re.split(&text_s) {
-            __mdh_list_push(result, mdh_make_string_from_rust(part));
+        for index in (*(*obj).compiled).matches(&mdh_str(text)).iter() {
+            __mdh_list_push(result, __mdh_make_int(index as i64));
         }
         mdh_ok(result)
     }) {
         Ok(result) => result,
-        Err(_) => unsafe { mdh_err("Rust panic in regex_split") },
+        Err(_) => unsafe { mdh_err("Rust panic in regex_set_match") },
+    }
+}
+
+/// A/AAAA lookup through the shared cache. Returns ok(nil) when no resolver can be
+/// built, so the C side can fall back to getaddrinfo.
+#[no_mangle]
+pub extern "C" fn __mdh_rs_dns_lookup(host: MdhValue) -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe {
+        if host.tag != MDH_TAG_STRING {
+            return mdh_err("dns_lookup expects string");
+        }
+        let host_s = mdh_string_to_rust(host);
+        let answer = match dns_cached(RecordType::A, &host_s) {
+            Ok(answer) => answer,
+            Err(_) => return mdh_ok(__mdh_make_nil()),
+        };
+        let answer = match answer {
+            Ok(answer) => answer,
+            Err(e) => return mdh_err(&format!("DNS lookup failed: {}", e)),
+        };
+        let list = __mdh_make_list(4);
+        if let DnsAnswer::Ips(ips) = answer.as_ref() {
+            for ip in ips {
+                __mdh_list_push(list, mdh_make_string_from_rust(&ip.to_string()));
+            }
+        }
+        mdh_ok(list)
+    }) {
+        Ok(result) => result,
+        Err(_) => unsafe { mdh_err("Rust panic in dns_lookup") },
     }
 }
 
@@ -1106,16 +1613,12 @@ pub extern "C" fn __mdh_rs_dns_srv(service: MdhValue, domain: MdhValue) -> MdhRs
             let d = domain_s.trim_start_matches('.');
             format!("{}.{}", s, d)
         };
-        let resolver = match make_resolver() {
+        let records = match dns_records(RecordType::SRV, &name, "SRV") {
             Ok(r) => r,
             Err(e) => return mdh_err(&e),
         };
-        let lookup = match resolver.lookup(name.as_str(), RecordType::SRV) {
-            Ok(l) => l,
-            Err(e) => return mdh_err(&format!("DNS SRV lookup failed: {}", e)),
-        };
         let list = __mdh_make_list(8);
-        for rdata in lookup.iter() {
+        for rdata in records.iter() {
             if let RData::SRV(srv) = rdata {
                 let mut dict = __mdh_empty_dict();
                 dict = __mdh_dict_set(
@@ -1155,16 +1658,12 @@ pub extern "C" fn __mdh_rs_dns_naptr(domain: MdhValue) -> MdhRsResult {
             return mdh_err("dns_naptr expects string");
         }
         let domain_s = mdh_string_to_rust(domain);
-        let resolver = match make_resolver() {
+        let records = match dns_records(RecordType::NAPTR, &domain_s, "NAPTR") {
             Ok(r) => r,
             Err(e) => return mdh_err(&e),
         };
-        let lookup = match resolver.lookup(domain_s.as_str(), RecordType::NAPTR) {
-            Ok(l) => l,
-            Err(e) => return mdh_err(&format!("DNS NAPTR lookup failed: {}", e)),
-        };
         let list = __mdh_make_list(8);
-        for rdata in lookup.iter() {
+        for rdata in records.iter() {
             if let RData::NAPTR(naptr) = rdata {
                 let mut dict = __mdh_empty_dict();
                 dict = __mdh_dict_set(
@@ -1226,6 +1725,8 @@ pub extern "C" fn __mdh_rs_tls_client_new(config: MdhValue) -> MdhRsResult {
                 client_config: Some(client_config),
                 server_config: None,
                 stream: None,
+                nonblocking: false,
+                pending: None,
             }
         } else {
             let server_config = match build_server_config(&cfg) {
@@ -1238,10 +1739,15 @@ pub extern "C" fn __mdh_rs_tls_client_new(config: MdhValue) -> MdhRsResult {
                 client_config: None,
                 server_config: Some(server_config),
                 stream: None,
+                nonblocking: false,
+                pending: None,
             }
         };
 
-        let id = tls_register(session);
+        let id = match tls_register(session) {
+            Ok(id) => id,
+            Err(e) => return mdh_err(&e),
+        };
         mdh_ok(__mdh_make_int(id))
     }) {
         Ok(result) => result,
@@ -1265,41 +1771,29 @@ pub extern "C" fn __mdh_rs_tls_connect(tls: MdhValue, sock: MdhValue) -> MdhRsRe
             if session.stream.is_some() {
                 return Err("TLS session already connected".to_string());
             }
-            let mut stream = std::net::TcpStream::from_raw_fd(fd);
+            TLS_RESUMING.with(|r| r.set(false));
+            let stream = std::net::TcpStream::from_raw_fd(fd);
             let _ = stream.set_nonblocking(false);
 
-            match session.mode {
-                TlsMode::Client => {
-                    let config = session
-                        .client_config
-                        .as_ref()
-                        .ok_or("Missing client config")?
-                        .clone();
-                    let server_name = ServerName::try_from(session.server_name.as_str())
-                        .map_err(|_| "Invalid server_name")?;
-                    let mut conn =
-                        ClientConnection::new(config, server_name).map_err(|e| e.to_string())?;
-                    while conn.is_handshaking() {
-                        conn.complete_io(&mut stream)
+            let mut tls_stream = tls_open(session, stream)?;
+            match &mut tls_stream {
+                TlsStream::Client(s) => {
+                    while s.conn.is_handshaking() {
+                        s.conn
+                            .complete_io(&mut s.sock)
                             .map_err(|e| format!("TLS handshake failed: {}", e))?;
                     }
-                    session.stream = Some(TlsStream::Client(StreamOwned::new(conn, stream)));
                 }
-                TlsMode::Server => {
-                    let config = session
-                        .server_config
-                        .as_ref()
-                        .ok_or("Missing server config")?
-                        .clone();
-                    let mut conn =
-                        ServerConnection::new(config).map_err(|e| e.to_string())?;
-                    while conn.is_handshaking() {
-                        conn.complete_io(&mut stream)
+                TlsStream::Server(s) => {
+                    while s.conn.is_handshaking() {
+                        s.conn
+                            .complete_io(&mut s.sock)
                             .map_err(|e| format!("TLS handshake failed: {}", e))?;
                     }
-                    session.stream = Some(TlsStream::Server(StreamOwned::new(conn, stream)));
                 }
             }
+            session.stream = Some(tls_stream);
+            tls_count_handshake(TLS_RESUMING.with(|r| r.get()));
             Ok(())
         });
 
@@ -1313,6 +1807,84 @@ pub extern "C" fn __mdh_rs_tls_connect(tls: MdhValue, sock: MdhValue) -> MdhRsRe
     }
 }
 
+/// Begin a handshake on `sock` and switch it to non-blocking; tls_step finishes it.
+#[no_mangle]
+pub extern "C" fn __mdh_rs_tls_connect_start(tls: MdhValue, sock: MdhValue) -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe {
+        let tls_id = tls.data;
+        if tls.tag != MDH_TAG_INT || tls_id <= 0 {
+            return mdh_err("tls_connect_start expects a TLS handle");
+        }
+        if sock.tag != MDH_TAG_INT {
+            return mdh_err("tls_connect_start expects a socket fd");
+        }
+        // Owned from here on, so every failure below closes the descriptor.
+        let stream = std::net::TcpStream::from_raw_fd(sock.data as i32);
+
+        let res = tls_with_mut(tls_id, move |session| {
+            if session.stream.is_some() {
+                return Err("TLS session already connected".to_string());
+            }
+            TLS_RESUMING.with(|r| r.set(false));
+            stream
+                .set_nonblocking(true)
+                .map_err(|e| format!("tls_connect_start failed: {}", e))?;
+            session.stream = Some(tls_open(session, stream)?);
+            session.nonblocking = true;
+            session.pending = Some(TLS_RESUMING.with(|r| r.get()));
+            tls_step(session)
+        });
+
+        match res {
+            Ok(status) => mdh_ok(mdh_make_string_from_rust(status)),
+            Err(e) => mdh_err(&e),
+        }
+    }) {
+        Ok(result) => result,
+        Err(_) => unsafe { mdh_err("Rust panic in tls_connect_start") },
+    }
+}
+
+/// Push a non-blocking session as far as the socket allows: "want_read", "want_write"
+/// or "ready".
+#[no_mangle]
+pub extern "C" fn __mdh_rs_tls_step(tls: MdhValue) -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe {
+        if tls.tag != MDH_TAG_INT || tls.data <= 0 {
+            return mdh_err("tls_step expects a TLS handle");
+        }
+        match tls_with_mut(tls.data, tls_step) {
+            Ok(status) => mdh_ok(mdh_make_string_from_rust(status)),
+            Err(e) => mdh_err(&e),
+        }
+    }) {
+        Ok(result) => result,
+        Err(_) => unsafe { mdh_err("Rust panic in tls_step") },
+    }
+}
+
+/// {"full": n, "resumed": n}: completed tls_connect handshakes since start-up.
+#[no_mangle]
+pub extern "C" fn __mdh_rs_tls_stats() -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe {
+        let mut dict = __mdh_empty_dict();
+        dict = __mdh_dict_set(
+            dict,
+            mdh_make_string_from_rust("full"),
+            __mdh_make_int(TLS_FULL_HANDSHAKES.load(Ordering::Relaxed) as i64),
+        );
+        dict = __mdh_dict_set(
+            dict,
+            mdh_make_string_from_rust("resumed"),
+            __mdh_make_int(TLS_RESUMED_HANDSHAKES.load(Ordering::Relaxed) as i64),
+        );
+        mdh_ok(dict)
+    }) {
+        Ok(result) => result,
+        Err(_) => unsafe { mdh_err("Rust panic in tls_stats") },
+    }
+}
+
 #[no_mangle]
 pub extern "C" fn __mdh_rs_tls_send(tls: MdhValue, buf: MdhValue) -> MdhRsResult {
     match std::panic::catch_unwind(|| unsafe {
@@ -1329,6 +1901,18 @@ pub extern "C" fn __mdh_rs_tls_send(tls: MdhValue, buf: MdhValue) -> MdhRsResult
         let slice = std::slice::from_raw_parts((*bytes).data, (*bytes).length as usize);
 
         let res = tls_with_mut(tls.data, |session| {
+            if session.nonblocking {
+                // Queue what rustls will buffer and send what the socket takes now;
+                // tls_step flushes the rest once the socket is writable.
+                let stream = session.stream.as_mut().ok_or("TLS not connected")?;
+                let n = match stream {
+                    TlsStream::Client(s) => s.conn.writer().write(slice),
+                    TlsStream::Server(s) => s.conn.writer().write(slice),
+                }
+                .map_err(|e| format!("TLS send failed: {}", e))?;
+                tls_step(session)?;
+                return Ok(n as i64);
+            }
             let stream = session.stream.as_mut().ok_or("TLS not connected")?;
             let n = match stream {
                 TlsStream::Client(s) => s.write(slice),
@@ -1377,6 +1961,15 @@ pub extern "C" fn __mdh_rs_tls_recv(tls: MdhValue, max_len: MdhValue) -> MdhRsRe
         let res = tls_with_mut(tls.data, |session| {
             let stream = session.stream.as_mut().ok_or("TLS not connected")?;
             let mut buf = vec![0u8; len as usize];
+            if session.nonblocking {
+                let n = match stream {
+                    TlsStream::Client(s) => tls_read_nb(&mut *s.conn, &mut s.sock, &mut buf),
+                    TlsStream::Server(s) => tls_read_nb(&mut *s.conn, &mut s.sock, &mut buf),
+                }?
+                .ok_or("want_read")?;
+                buf.truncate(n);
+                return Ok(buf);
+            }
             let n = match stream {
                 TlsStream::Client(s) => s.read(&mut buf),
                 TlsStream::Server(s) => s.read(&mut buf),
@@ -1487,46 +2080,85 @@ pub extern "C" fn __mdh_rs_srtp_create(config: MdhValue) -> MdhRsResult {
             None => return mdh_err("Missing SRTP recv_salt"),
         };
 
-        let send_master = MasterKey::new(&send_key, &send_salt, &None);
-        let recv_master = MasterKey::new(&recv_key, &recv_salt, &None);
-        let send_cfg = StreamConfig::new(vec![send_master], &profile, &profile);
-        let recv_cfg = StreamConfig::new(vec![recv_master], &profile, &profile);
-
-        let mut send = SendSession::new();
-        if let Err(e) = send.add_stream(None, &send_cfg) {
-            return mdh_err(&format!("SRTP send session error: {}", e));
-        }
-        let mut recv = RecvSession::new();
-        if let Err(e) = recv.add_stream(None, &recv_cfg) {
-            return mdh_err(&format!("SRTP recv session error: {}", e));
+        match srtp_session_new(&profile, (send_key, send_salt), (recv_key, recv_salt))
+            .and_then(srtp_register)
+        {
+            Ok(id) => mdh_ok(__mdh_make_int(id)),
+            Err(e) => mdh_err(&e),
         }
-
-        let id = srtp_register(SrtpSession { send, recv });
-        mdh_ok(__mdh_make_int(id))
     }) {
         Ok(result) => result,
         Err(_) => unsafe { mdh_err("Rust panic in srtp_create") },
     }
 }
 
+#[derive(Clone, Copy)]
+enum SrtpOp {
+    Protect,
+    Unprotect,
+}
+
+impl SrtpOp {
+    fn name(self) -> &'static str {
+        match self {
+            SrtpOp::Protect => "srtp_protect",
+            SrtpOp::Unprotect => "srtp_unprotect",
+        }
+    }
+}
+
+/// Run one packet through libsrtp via the session's scratch buffer; on success the
+/// output is left in `session.scratch`.
+fn srtp_run(session: &mut SrtpSession, op: SrtpOp, input: &[u8]) -> Result<(), String> {
+    let mut buf = std::mem::take(&mut session.scratch);
+    buf.clear();
+    buf.extend_from_slice(input);
+    session.scratch = match op {
+        SrtpOp::Protect => session
+            .send
+            .rtp_protect(buf)
+            .map_err(|e| format!("SRTP protect failed: {}", e))?,
+        SrtpOp::Unprotect => session
+            .recv
+            .rtp_unprotect(buf)
+            .map_err(|e| format!("SRTP unprotect failed: {}", e))?,
+    };
+    Ok(())
+}
+
+unsafe fn srtp_packet<'a>(bytes: *const MdhBytes) -> &'a [u8] {
+    if (*bytes).data.is_null() || (*bytes).length <= 0 {
+        &[]
+    } else {
+        std::slice::from_raw_parts((*bytes).data, (*bytes).length as usize)
+    }
+}
+
+/// Look up the session, run `packet` through it and hand `f` the result.
+unsafe fn srtp_apply<T, F>(ctx: MdhValue, packet: MdhValue, op: SrtpOp, f: F) -> Result<T, String>
+where
+    F: FnOnce(&[u8]) -> Result<T, String>,
+{
+    if ctx.tag != MDH_TAG_INT || ctx.data <= 0 {
+        return Err(format!("{} expects SRTP handle", op.name()));
+    }
+    if packet.tag != MDH_TAG_BYTES || packet.data == 0 {
+        return Err(format!("{} expects bytes", op.name()));
+    }
+    let input = srtp_packet(packet.data as *const MdhBytes);
+    srtp_with_mut(ctx.data, |session| {
+        srtp_run(session, op, input)?;
+        f(&session.scratch)
+    })
+}
+
 #[no_mangle]
 pub extern "C" fn __mdh_rs_srtp_protect(ctx: MdhValue, packet: MdhValue) -> MdhRsResult {
     match std::panic::catch_unwind(|| unsafe {
-        if ctx.tag != MDH_TAG_INT || ctx.data <= 0 {
-            return mdh_err("srtp_protect expects SRTP handle");
-        }
-        let data = match mdh_bytes_to_vec(packet) {
-            Some(v) => v,
-            None => return mdh_err("srtp_protect expects bytes"),
-        };
-        let res = srtp_with_mut(ctx.data, |session| {
-            session
-                .send
-                .rtp_protect(data)
-                .map_err(|e| format!("SRTP protect failed: {}", e))
-        });
-        match res {
-            Ok(buf) => mdh_ok(mdh_make_bytes_from_vec(&buf)),
+        match srtp_apply(ctx, packet, SrtpOp::Protect, |out| {
+            Ok(mdh_make_bytes_from_vec(out))
+        }) {
+            Ok(bytes) => mdh_ok(bytes),
             Err(e) => mdh_err(&e),
         }
     }) {
@@ -1538,21 +2170,10 @@ pub extern "C" fn __mdh_rs_srtp_protect(ctx: MdhValue, packet: MdhValue) -> MdhR
 #[no_mangle]
 pub extern "C" fn __mdh_rs_srtp_unprotect(ctx: MdhValue, packet: MdhValue) -> MdhRsResult {
     match std::panic::catch_unwind(|| unsafe {
-        if ctx.tag != MDH_TAG_INT || ctx.data <= 0 {
-            return mdh_err("srtp_unprotect expects SRTP handle");
-        }
-        let data = match mdh_bytes_to_vec(packet) {
-            Some(v) => v,
-            None => return mdh_err("srtp_unprotect expects bytes"),
-        };
-        let res = srtp_with_mut(ctx.data, |session| {
-            session
-                .recv
-                .rtp_unprotect(data)
-                .map_err(|e| format!("SRTP unprotect failed: {}", e))
-        });
-        match res {
-            Ok(buf) => mdh_ok(mdh_make_bytes_from_vec(&buf)),
+        match srtp_apply(ctx, packet, SrtpOp::Unprotect, |out| {
+            Ok(mdh_make_bytes_from_vec(out))
+        }) {
+            Ok(bytes) => mdh_ok(bytes),
             Err(e) => mdh_err(&e),
         }
     }) {
@@ -1561,6 +2182,99 @@ pub extern "C" fn __mdh_rs_srtp_unprotect(ctx: MdhValue, packet: MdhValue) -> Md
     }
 }
 
+/// Copy `out` over the packet. The C side has already made the buffer private and
+/// reserved room for the auth tag.
+unsafe fn srtp_write_back(bytes: *mut MdhBytes, out: &[u8], op: SrtpOp) -> Result<i64, String> {
+    if out.len() as i64 > (*bytes).capacity {
+        return Err(format!("{} packet outgrew its buffer", op.name()));
+    }
+    if !out.is_empty() {
+        std::ptr::copy_nonoverlapping(out.as_ptr(), (*bytes).data, out.len());
+    }
+    (*bytes).length = out.len() as i64;
+    Ok(out.len() as i64)
+}
+
+/// Protect or unprotect `packet` in place, returning the new length.
+unsafe fn srtp_in_place(ctx: MdhValue, packet: MdhValue, op: SrtpOp) -> MdhRsResult {
+    let bytes = packet.data as *mut MdhBytes;
+    match srtp_apply(ctx, packet, op, |out| srtp_write_back(bytes, out, op)) {
+        Ok(n) => mdh_ok(__mdh_make_int(n)),
+        Err(e) => mdh_err(&e),
+    }
+}
+
+/// In-place over a list of bytes under one session lock. Returns the new lengths, -1
+/// for a packet libsrtp rejected (left as it was).
+unsafe fn srtp_in_place_many(ctx: MdhValue, packets: MdhValue, op: SrtpOp) -> MdhRsResult {
+    if ctx.tag != MDH_TAG_INT || ctx.data <= 0 {
+        return mdh_err(&format!("{}_many expects SRTP handle", op.name()));
+    }
+    if packets.tag != MDH_TAG_LIST || packets.data == 0 {
+        return mdh_err(&format!("{}_many expects a list of bytes", op.name()));
+    }
+    let list = packets.data as *const MdhList;
+    let items: &[MdhValue] = if (*list).items.is_null() || (*list).length <= 0 {
+        &[]
+    } else {
+        std::slice::from_raw_parts((*list).items, (*list).length as usize)
+    };
+    if items.iter().any(|v| v.tag != MDH_TAG_BYTES || v.data == 0) {
+        return mdh_err(&format!("{}_many expects a list of bytes", op.name()));
+    }
+    let res = srtp_with_mut(ctx.data, |session| {
+        let lengths = __mdh_make_list(items.len().min(i32::MAX as usize) as i32);
+        for item in items {
+            let bytes = item.data as *mut MdhBytes;
+            let n = match srtp_run(session, op, srtp_packet(bytes)) {
+                Ok(()) => srtp_write_back(bytes, &session.scratch, op).unwrap_or(-1),
+                Err(_) => -1,
+            };
+            __mdh_list_push(lengths, __mdh_make_int(n));
+        }
+        Ok(lengths)
+    });
+    match res {
+        Ok(lengths) => mdh_ok(lengths),
+        Err(e) => mdh_err(&e),
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn __mdh_rs_srtp_protect_into(ctx: MdhValue, packet: MdhValue) -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe { srtp_in_place(ctx, packet, SrtpOp::Protect) }) {
+        Ok(result) => result,
+        Err(_) => unsafe { mdh_err("Rust panic in srtp_protect_into") },
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn __mdh_rs_srtp_unprotect_into(ctx: MdhValue, packet: MdhValue) -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe { srtp_in_place(ctx, packet, SrtpOp::Unprotect) }) {
+        Ok(result) => result,
+        Err(_) => unsafe { mdh_err("Rust panic in srtp_unprotect_into") },
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn __mdh_rs_srtp_protect_many(ctx: MdhValue, packets: MdhValue) -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe { srtp_in_place_many(ctx, packets, SrtpOp::Protect) })
+    {
+        Ok(result) => result,
+        Err(_) => unsafe { mdh_err("Rust panic in srtp_protect_many") },
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn __mdh_rs_srtp_unprotect_many(ctx: MdhValue, packets: MdhValue) -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe {
+        srtp_in_place_many(ctx, packets, SrtpOp::Unprotect)
+    }) {
+        Ok(result) => result,
+        Err(_) => unsafe { mdh_err("Rust panic in srtp_unprotect_many") },
+    }
+}
+
 fn identity_from_pem(cert_pem: &str, key_pem: &str) -> Result<Identity, String> {
     let cert = X509::from_pem(cert_pem.as_bytes()).map_err(|e| format!("Invalid cert PEM: {}", e))?;
     let key = PKey::private_key_from_pem(key_pem.as_bytes())
@@ -1581,7 +2295,10 @@ pub extern "C" fn __mdh_rs_dtls_server_new(config: MdhValue) -> MdhRsResult {
             Ok(cfg) => cfg,
             Err(e) => return mdh_err(&e),
         };
-        let id = dtls_register(cfg);
+        let id = match dtls_register(cfg) {
+            Ok(id) => id,
+            Err(e) => return mdh_err(&e),
+        };
         mdh_ok(__mdh_make_int(id))
     }) {
         Ok(result) => result,
@@ -1726,3 +2443,379 @@ pub extern "C" fn __mdh_rs_dtls_handshake(dtls: MdhValue, sock: MdhValue) -> Mdh
         Err(_) => unsafe { mdh_err("Rust panic in dtls_handshake") },
     }
 }
+
+/// MTU for session flights: the 1200 bytes WebRTC counts on any path carrying.
+const DTLS_MTU: u32 = 1200;
+
+// DTLSv1_get_timeout and DTLSv1_handle_timeout are macros over SSL_ctrl, so the openssl
+// crate has no wrappers for them.
+const DTLS_CTRL_GET_TIMEOUT: c_int = 73;
+const DTLS_CTRL_HANDLE_TIMEOUT: c_int = 74;
+
+extern "C" {
+    fn SSL_ctrl(ssl: *mut c_void, cmd: c_int, larg: c_long, parg: *mut c_void) -> c_long;
+}
+
+#[repr(C)]
+struct DtlsTimeval {
+    tv_sec: c_long,
+    tv_usec: c_long,
+}
+
+fn dtls_ssl_ptr(ssl: &SslRef) -> *mut c_void {
+    // SslRef is the crate's opaque stand-in for SSL: its address is the SSL pointer.
+    ssl as *const SslRef as *mut c_void
+}
+
+/// Time left on the handshake's retransmit timer, or None when it isn't running.
+fn dtls_timer(ssl: &SslRef) -> Option<Duration> {
+    let mut left = DtlsTimeval {
+        tv_sec: 0,
+        tv_usec: 0,
+    };
+    let parg = &mut left as *mut DtlsTimeval as *mut c_void;
+    let running = unsafe { SSL_ctrl(dtls_ssl_ptr(ssl), DTLS_CTRL_GET_TIMEOUT, 0, parg) };
+    (running == 1).then(|| {
+        Duration::from_secs(left.tv_sec.max(0) as u64)
+            + Duration::from_micros(left.tv_usec.max(0) as u64)
+    })
+}
+
+/// Resend the last flight if the timer has run out; false once OpenSSL gives up on the peer.
+fn dtls_retransmit(ssl: &SslRef) -> bool {
+    let ptr = dtls_ssl_ptr(ssl);
+    unsafe { SSL_ctrl(ptr, DTLS_CTRL_HANDLE_TIMEOUT, 0, std::ptr::null_mut()) >= 0 }
+}
+
+/// What lies under a DTLS session instead of a socket: datagrams fed in wait in
+/// `incoming`, and every record OpenSSL writes lands in `outgoing` as one datagram.
+#[derive(Default)]
+struct DatagramPipe {
+    incoming: VecDeque<Vec<u8>>,
+    outgoing: Vec<Vec<u8>>,
+}
+
+impl Read for DatagramPipe {
+    fn read(&mut self, buf: &mut [u8]) -> std::io::Result<usize> {
+        let datagram = self
+            .incoming
+            .pop_front()
+            .ok_or(std::io::ErrorKind::WouldBlock)?;
+        let n = datagram.len().min(buf.len());
+        buf[..n].copy_from_slice(&datagram[..n]);
+        Ok(n)
+    }
+}
+
+impl Write for DatagramPipe {
+    fn write(&mut self, buf: &[u8]) -> std::io::Result<usize> {
+        self.outgoing.push(buf.to_vec());
+        Ok(buf.len())
+    }
+
+    fn flush(&mut self) -> std::io::Result<()> {
+        Ok(())
+    }
+}
+
+/// One peer's DTLS state machine. It never touches a socket, so an event loop can
+/// run any number of handshakes side by side, each behind its own slot lock.
+struct DtlsSession {
+    stream: SslStream<DatagramPipe>,
+    client: bool,
+    state: &'static str,
+}
+
+static DTLS_SESSIONS: OnceLock<HandleTable<DtlsSession>> = OnceLock::new();
+
+fn dtls_sessions() -> &'static HandleTable<DtlsSession> {
+    DTLS_SESSIONS.get_or_init(HandleTable::new)
+}
+
+fn dtls_session_with_mut<T, F>(id: i64, f: F) -> Result<T, String>
+where
+    F: FnOnce(&mut DtlsSession) -> Result<T, String>,
+{
+    dtls_sessions()
+        .with_mut(id, f)
+        .unwrap_or_else(|| Err("Unknown DTLS session".to_string()))
+}
+
+fn srtp_profile_name(profile: SrtpProfile) -> &'static str {
+    match profile {
+        SrtpProfile::Aes128CmSha132 => "SRTP_AES128_CM_SHA1_32",
+        SrtpProfile::AeadAes128Gcm => "SRTP_AEAD_AES_128_GCM",
+        SrtpProfile::AeadAes256Gcm => "SRTP_AEAD_AES_256_GCM",
+        SrtpProfile::Aes128CmSha180 | SrtpProfile::__Nonexhaustive => "SRTP_AES128_CM_SHA1_80",
+    }
+}
+
+/// The SSL context behind a config's sessions. Certificates and keys are parsed here
+/// once, no on every handshake.
+fn dtls_context_new(cfg: &DtlsConfigData) -> Result<SslContext, String> {
+    let fail = |e: ErrorStack| format!("DTLS setup failed: {}", e);
+    let mut builder = SslContextBuilder::new(SslMethod::dtls()).map_err(fail)?;
+    builder.set_options(SslOptions::NO_QUERY_MTU);
+    let profiles: Vec<&str> = cfg
+        .srtp_profiles
+        .iter()
+        .map(|p| srtp_profile_name(*p))
+        .collect();
+    builder
+        .set_tlsext_use_srtp(&profiles.join(":"))
+        .map_err(fail)?;
+    match (&cfg.cert_pem, &cfg.key_pem) {
+        (Some(cert_pem), Some(key_pem)) => {
+            let cert = X509::from_pem(cert_pem.as_bytes())
+                .map_err(|e| format!("Invalid cert PEM: {}", e))?;
+            let key = PKey::private_key_from_pem(key_pem.as_bytes())
+                .map_err(|e| format!("Invalid key PEM: {}", e))?;
+            builder.set_certificate(&cert).map_err(fail)?;
+            builder.set_private_key(&key).map_err(fail)?;
+        }
+        (None, _) if cfg.mode == TlsMode::Server => {
+            return Err("Server cert_pem required".to_string())
+        }
+        (_, None) if cfg.mode == TlsMode::Server => {
+            return Err("Server key_pem required".to_string())
+        }
+        _ => {}
+    }
+    if cfg.mode == TlsMode::Client {
+        if cfg.insecure {
+            builder.set_verify(SslVerifyMode::NONE);
+        } else {
+            builder.set_verify(SslVerifyMode::PEER);
+            match &cfg.ca_pem {
+                Some(ca_pem) => {
+                    let ca = X509::from_pem(ca_pem.as_bytes())
+                        .map_err(|e| format!("Invalid CA cert: {}", e))?;
+                    builder.cert_store_mut().add_cert(ca).map_err(fail)?;
+                }
+                None => builder.set_default_verify_paths().map_err(fail)?,
+            }
+        }
+    }
+    Ok(builder.build())
+}
+
+fn dtls_session_new(dtls: i64) -> Result<DtlsSession, String> {
+    let (context, client, server_name, verify) = dtls_configs()
+        .with_mut(dtls, |cfg| {
+            let context = match &cfg.session_context {
+                Some(context) => context.clone(),
+                None => {
+                    let context = dtls_context_new(cfg)?;
+                    cfg.session_context = Some(context.clone());
+                    context
+                }
+            };
+            let client = cfg.mode == TlsMode::Client;
+            Ok((context, client, cfg.server_name.clone(), !cfg.insecure))
+        })
+        .unwrap_or_else(|| Err("Unknown DTLS handle".to_string()))?;
+
+    let fail = |e: ErrorStack| format!("DTLS session failed: {}", e);
+    let mut ssl = Ssl::new(&context).map_err(fail)?;
+    ssl.set_mtu(DTLS_MTU).map_err(fail)?;
+    if client {
+        if !server_name.is_empty() {
+            ssl.set_hostname(&server_name).map_err(fail)?;
+            if verify {
+                ssl.param_mut().set_host(&server_name).map_err(fail)?;
+            }
+        }
+        ssl.set_connect_state();
+    } else {
+        ssl.set_accept_state();
+    }
+    let stream = SslStream::new(ssl, DatagramPipe::default()).map_err(fail)?;
+    Ok(DtlsSession {
+        stream,
+        client,
+        state: "handshaking",
+    })
+}
+
+fn dtls_would_block(e: &openssl::ssl::Error) -> bool {
+    e.code() == ErrorCode::WANT_READ || e.code() == ErrorCode::WANT_WRITE
+}
+
+/// Feed one datagram (or none, to start a client or service the timer) through the
+/// session. Returns the datagrams to send and any application data that came in.
+fn dtls_session_step(
+    session: &mut DtlsSession,
+    datagram: Option<Vec<u8>>,
+) -> Result<(Vec<Vec<u8>>, Vec<Vec<u8>>), String> {
+    if let Some(datagram) = datagram {
+        session.stream.get_mut().incoming.push_back(datagram);
+    }
+    if session.state == "handshaking" {
+        if !dtls_retransmit(session.stream.ssl()) {
+            session.state = "closed";
+            return Err("DTLS handshake timed oot".to_string());
+        }
+        match session.stream.do_handshake() {
+            Ok(()) => session.state = "connected",
+            Err(e) if dtls_would_block(&e) => {}
+            Err(e) => {
+                session.state = "closed";
+                return Err(format!("DTLS handshake failed: {}", e));
+            }
+        }
+    }
+    let mut data = Vec::new();
+    if session.state == "connected" {
+        let mut buf = [0u8; 16384];
+        loop {
+            match session.stream.ssl_read(&mut buf) {
+                Ok(n) => data.push(buf[..n].to_vec()),
+                Err(e) if dtls_would_block(&e) => break,
+                Err(e) if e.code() == ErrorCode::ZERO_RETURN => {
+                    session.state = "closed";
+                    break;
+                }
+                Err(e) => return Err(format!("DTLS recv failed: {}", e)),
+            }
+        }
+    }
+    Ok((std::mem::take(&mut session.stream.get_mut().outgoing), data))
+}
+
+/// SRTP contexts keyed straight from the handshake (RFC 5764 4.2): one export holds the
+/// client key, server key, client salt and server salt in that order.
+fn dtls_session_srtp(session: &mut DtlsSession) -> Result<SrtpSession, String> {
+    if session.state != "connected" {
+        return Err("DTLS handshake isnae finished".to_string());
+    }
+    let ssl = session.stream.ssl();
+    let name = ssl
+        .selected_srtp_profile()
+        .map(|p| p.name())
+        .ok_or("DTLS peer agreed nae SRTP profile")?;
+    let (srtp_profile, profile) = match (
+        srtp_profile_from_str(name),
+        protection_profile_from_str(name),
+    ) {
+        (Some(srtp_profile), Some(profile)) => (srtp_profile, profile),
+        _ => return Err("Unsupported SRTP profile".to_string()),
+    };
+    let (key_len, salt_len) = srtp_key_salt_len(srtp_profile);
+    let mut material = vec![0u8; 2 * (key_len + salt_len)];
+    ssl.export_keying_material(&mut material, "EXTRACTOR-dtls_srtp", None)
+        .map_err(|e| format!("Keying material failed: {}", e))?;
+    let (keys, salts) = material.split_at(2 * key_len);
+    let client = (keys[..key_len].to_vec(), salts[..salt_len].to_vec());
+    let server = (keys[key_len..].to_vec(), salts[salt_len..].to_vec());
+    if session.client {
+        srtp_session_new(&profile, client, server)
+    } else {
+        srtp_session_new(&profile, server, client)
+    }
+}
+
+unsafe fn mdh_bytes_list(datagrams: &[Vec<u8>]) -> MdhValue {
+    let list = __mdh_make_list(datagrams.len() as i32);
+    for datagram in datagrams {
+        __mdh_list_push(list, mdh_make_bytes_from_vec(datagram));
+    }
+    list
+}
+
+#[no_mangle]
+pub extern "C" fn __mdh_rs_dtls_session_new(dtls: MdhValue) -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe {
+        if dtls.tag != MDH_TAG_INT || dtls.data <= 0 {
+            return mdh_err("dtls_session_new expects DTLS handle");
+        }
+        match dtls_session_new(dtls.data).and_then(|s| dtls_sessions().insert(s)) {
+            Ok(id) => mdh_ok(__mdh_make_int(id)),
+            Err(e) => mdh_err(&e),
+        }
+    }) {
+        Ok(result) => result,
+        Err(_) => unsafe { mdh_err("Rust panic in dtls_session_new") },
+    }
+}
+
+/// {"state", "out", "data", "timeout_ms"}: the session's state after the step, datagrams
+/// to send, application data received, and milliseconds until the step the
+/// retransmit timer needs (nil when it isn't running).
+#[no_mangle]
+pub extern "C" fn __mdh_rs_dtls_session_step(session: MdhValue, datagram: MdhValue) -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe {
+        if session.tag != MDH_TAG_INT || session.data <= 0 {
+            return mdh_err("dtls_session_step expects DTLS session");
+        }
+        if datagram.tag != MDH_TAG_NIL && datagram.tag != MDH_TAG_BYTES {
+            return mdh_err("dtls_session_step expects bytes or naething");
+        }
+        let datagram = mdh_bytes_to_vec(datagram);
+        let stepped = dtls_session_with_mut(session.data, |s| {
+            let (out, data) = dtls_session_step(s, datagram)?;
+            Ok((s.state, out, data, dtls_timer(s.stream.ssl())))
+        });
+        let (state, out, data, timer) = match stepped {
+            Ok(stepped) => stepped,
+            Err(e) => return mdh_err(&e),
+        };
+        let timeout = match timer {
+            Some(left) => __mdh_make_int(((left.as_micros() + 999) / 1000) as i64),
+            None => __mdh_make_nil(),
+        };
+        let mut dict = __mdh_dict_with_capacity(4);
+        dict = __mdh_dict_set(
+            dict,
+            mdh_make_string_from_rust("state"),
+            mdh_make_string_from_rust(state),
+        );
+        dict = __mdh_dict_set(dict, mdh_make_string_from_rust("out"), mdh_bytes_list(&out));
+        dict = __mdh_dict_set(
+            dict,
+            mdh_make_string_from_rust("data"),
+            mdh_bytes_list(&data),
+        );
+        dict = __mdh_dict_set(dict, mdh_make_string_from_rust("timeout_ms"), timeout);
+        mdh_ok(dict)
+    }) {
+        Ok(result) => result,
+        Err(_) => unsafe { mdh_err("Rust panic in dtls_session_step") },
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn __mdh_rs_dtls_session_srtp(session: MdhValue) -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe {
+        if session.tag != MDH_TAG_INT || session.data <= 0 {
+            return mdh_err("dtls_session_srtp expects DTLS session");
+        }
+        match dtls_session_with_mut(session.data, dtls_session_srtp).and_then(srtp_register) {
+            Ok(id) => mdh_ok(__mdh_make_int(id)),
+            Err(e) => mdh_err(&e),
+        }
+    }) {
+        Ok(result) => result,
+        Err(_) => unsafe { mdh_err("Rust panic in dtls_session_srtp") },
+    }
+}
+
+/// Drops the session and returns the close_notify datagrams for the peer.
+#[no_mangle]
+pub extern "C" fn __mdh_rs_dtls_session_close(session: MdhValue) -> MdhRsResult {
+    match std::panic::catch_unwind(|| unsafe {
+        if session.tag != MDH_TAG_INT || session.data <= 0 {
+            return mdh_err("dtls_session_close expects DTLS session");
+        }
+        let mut s = match dtls_sessions().remove(session.data) {
+            Some(s) => s,
+            None => return mdh_err("Unknown DTLS session"),
+        };
+        if s.state == "connected" {
+            let _ = s.stream.shutdown();
+        }
+        mdh_ok(mdh_bytes_list(&s.stream.get_mut().outgoing))
+    }) {
+        Ok(result) => result,
+        Err(_) => unsafe { mdh_err("Rust panic in dtls_session_close") },
+    }
+}
@@ -1,8 +1,11 @@
 use std::cell::RefCell;
+use std::collections::hash_map::DefaultHasher;
 use std::collections::HashMap;
 use std::env;
 use std::fs;
-use std::sync::atomic::{AtomicBool, Ordering};
+use std::hash::{Hash, Hasher};
+use std::rc::Rc;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
 use std::time::{Duration, Instant};
 
 use bytemuck::{Pod, Zeroable};
@@ -142,9 +145,10 @@ pub struct MeshData {
 }
 
 pub struct RenderItem {
-    pub mesh: MeshData,
+    // None when the engine already holds `mesh_key` at `mesh_generation` (see has_mesh).
+    pub mesh: Option<MeshData>,
     pub mesh_key: Option<usize>,
-    pub object_key: Option<usize>,
+    pub mesh_generation: u64,
     pub model: Mat4,
     pub color: [f32; 4],
     pub ambient: [f32; 4],
@@ -184,11 +188,52 @@ impl Vertex {
     }
 }
 
+/// Per-instance vertex data: the model matrix, one column per attribute.
+#[repr(C)]
+#[derive(Copy, Clone, Pod, Zeroable)]
+struct Instance {
+    model: [[f32; 4]; 4],
+}
+
+const INSTANCE_ATTRIBUTES: [wgpu::VertexAttribute; 4] = [
+    wgpu::VertexAttribute {
+        offset: 0,
+        shader_location: 2,
+        format: wgpu::VertexFormat::Float32x4,
+    },
+    wgpu::VertexAttribute {
+        offset: 16,
+        shader_location: 3,
+        format: wgpu::VertexFormat::Float32x4,
+    },
+    wgpu::VertexAttribute {
+        offset: 32,
+        shader_location: 4,
+        format: wgpu::VertexFormat::Float32x4,
+    },
+    wgpu::VertexAttribute {
+        offset: 48,
+        shader_location: 5,
+        format: wgpu::VertexFormat::Float32x4,
+    },
+];
+
+impl Instance {
+    fn desc<'a>() -> wgpu::VertexBufferLayout<'a> {
+        wgpu::VertexBufferLayout {
+            array_stride: std::mem::size_of::<Instance>() as wgpu::BufferAddress,
+            step_mode: wgpu::VertexStepMode::Instance,
+            attributes: &INSTANCE_ATTRIBUTES,
+        }
+    }
+}
+
+/// Per-draw uniforms: everything a group of instances shares. Each draw's copy sits at its
+/// own aligned offset in one persistent buffer, selected with a dynamic offset.
 #[repr(C)]
 #[derive(Copy, Clone, Pod, Zeroable)]
 struct Uniforms {
     view_proj: [[f32; 4]; 4],
-    model: [[f32; 4]; 4],
     color: [f32; 4],
     ambient: [f32; 4],
     light_dir: [f32; 4],
@@ -202,7 +247,6 @@ struct Uniforms {
 const TRI_SHADER: &str = r#"
 struct Uniforms {
     view_proj: mat4x4<f32>,
-    model: mat4x4<f32>,
     color: vec4<f32>,
     ambient: vec4<f32>,
     light_dir: vec4<f32>,
@@ -221,6 +265,13 @@ struct VertexInput {
     @location(1) normal: vec3<f32>,
 };
 
+struct InstanceInput {
+    @location(2) model_0: vec4<f32>,
+    @location(3) model_1: vec4<f32>,
+    @location(4) model_2: vec4<f32>,
+    @location(5) model_3: vec4<f32>,
+};
+
 struct VertexOutput {
     @builtin(position) position: vec4<f32>,
     @location(0) normal: vec3<f32>,
@@ -228,11 +279,12 @@ struct VertexOutput {
 };
 
 @vertex
-fn vs_main(in: VertexInput) -> VertexOutput {
+fn vs_main(in: VertexInput, instance: InstanceInput) -> VertexOutput {
     var out: VertexOutput;
-    let world = uniforms.model * vec4<f32>(in.position, 1.0);
+    let model = mat4x4<f32>(instance.model_0, instance.model_1, instance.model_2, instance.model_3);
+    let world = model * vec4<f32>(in.position, 1.0);
     out.position = uniforms.view_proj * world;
-    out.normal = normalize((uniforms.model * vec4<f32>(in.normal, 0.0)).xyz);
+    out.normal = normalize((model * vec4<f32>(in.normal, 0.0)).xyz);
     out.world_pos = world.xyz;
     return out;
 }
@@ -275,12 +327,22 @@ fn fs_main(in: VertexOutput) -> @location(0) vec4<f32> {
 pub struct RendererState {
     window: &'static Window,
     surface: wgpu::Surface<'static>,
-    device: wgpu::Device,
-    queue: wgpu::Queue,
+    gpu: Rc<Gpu>,
     config: wgpu::SurfaceConfiguration,
-    pipeline_fill: wgpu::RenderPipeline,
-    pipeline_wireframe: Option<wgpu::RenderPipeline>,
-    uniform_layout: wgpu::BindGroupLayout,
+    pipeline_fill: Rc<wgpu::RenderPipeline>,
+    pipeline_wireframe: Option<Rc<wgpu::RenderPipeline>>,
+    // One Uniforms per draw, `uniform_stride` apart. Both buffers are reused frame to
+    // frame and only reallocated (doubling) when a frame outgrows them.
+    uniform_buffer: wgpu::Buffer,
+    uniform_bind_group: wgpu::BindGroup,
+    uniform_stride: u64,
+    uniform_slots: u64,
+    instance_buffer: wgpu::Buffer,
+    instance_slots: u64,
+    // What the buffers were last filled with, so an unchanged frame writes nothing.
+    last_uniforms: Vec<u8>,
+    last_instances: Vec<Instance>,
+    frame: u64,
     depth_texture: wgpu::Texture,
     depth_view: wgpu::TextureView,
     pixel_ratio: f32,
@@ -291,27 +353,165 @@ struct GpuMesh {
     vertex: wgpu::Buffer,
     index: wgpu::Buffer,
     index_count: u32,
+    // The geometry generation the buffers hold; 0 for meshes keyed by content.
+    generation: u64,
+    // The Gpu the buffers live on (see Gpu::id).
+    gpu: u64,
 }
 
+/// Buffers for a mesh that arrived without a mesh_key, keyed by a hash of its contents and
+/// dropped after a frame that does not draw it.
 #[derive(Debug)]
-struct UniformEntry {
-    buffer: wgpu::Buffer,
-    bind_group: wgpu::BindGroup,
+struct OwnedMesh {
+    mesh: GpuMesh,
+    last_frame: u64,
 }
 
-impl RendererState {
-    fn new(window: &'static Window) -> Result<Self, String> {
-        let instance = wgpu::Instance::default();
-        let surface = instance
-            .create_surface(window)
-            .map_err(|e| format!("create_surface failed: {e:?}"))?;
-        let adapter = pollster::block_on(instance.request_adapter(
-            &wgpu::RequestAdapterOptions {
-                power_preference: wgpu::PowerPreference::HighPerformance,
-                compatible_surface: Some(&surface),
-                force_fallback_adapter: false,
-            },
-        ))
+#[derive(Clone, Copy, PartialEq, Eq, Hash)]
+enum MeshRef {
+    Keyed(usize),
+    Content(u64),
+}
+
+fn mesh_content_key(mesh: &MeshData) -> u64 {
+    let mut hasher = DefaultHasher::new();
+    bytemuck::cast_slice::<[f32; 3], u8>(&mesh.vertices).hash(&mut hasher);
+    bytemuck::cast_slice::<[f32; 3], u8>(&mesh.normals).hash(&mut hasher);
+    mesh.indices.hash(&mut hasher);
+    hasher.finish()
+}
+
+fn mesh_vertices(mesh: &MeshData) -> Vec<Vertex> {
+    mesh.vertices
+        .iter()
+        .enumerate()
+        .map(|(idx, position)| Vertex {
+            position: *position,
+            normal: mesh.normals.get(idx).copied().unwrap_or([0.0, 1.0, 0.0]),
+        })
+        .collect()
+}
+
+fn upload_mesh(gpu: &Gpu, mesh: &MeshData, generation: u64) -> Option<GpuMesh> {
+    if mesh.vertices.is_empty() || mesh.indices.is_empty() {
+        return None;
+    }
+    let vertex = gpu
+        .device
+        .create_buffer_init(&wgpu::util::BufferInitDescriptor {
+            label: Some("tri_vertices"),
+            contents: bytemuck::cast_slice(&mesh_vertices(mesh)),
+            usage: wgpu::BufferUsages::VERTEX | wgpu::BufferUsages::COPY_DST,
+        });
+    let index = gpu
+        .device
+        .create_buffer_init(&wgpu::util::BufferInitDescriptor {
+            label: Some("tri_indices"),
+            contents: bytemuck::cast_slice(&mesh.indices),
+            usage: wgpu::BufferUsages::INDEX | wgpu::BufferUsages::COPY_DST,
+        });
+    Some(GpuMesh {
+        vertex,
+        index,
+        index_count: mesh.indices.len() as u32,
+        generation,
+        gpu: gpu.id,
+    })
+}
+
+/// Write a changed mesh into `gpu`'s existing buffers; false if it no longer fits them.
+fn rewrite_mesh(queue: &wgpu::Queue, gpu: &mut GpuMesh, mesh: &MeshData, generation: u64) -> bool {
+    let vertices = mesh_vertices(mesh);
+    let vertex_bytes: &[u8] = bytemuck::cast_slice(&vertices);
+    let index_bytes: &[u8] = bytemuck::cast_slice(&mesh.indices);
+    if mesh.indices.is_empty()
+        || vertex_bytes.is_empty()
+        || vertex_bytes.len() as u64 > gpu.vertex.size()
+        || index_bytes.len() as u64 > gpu.index.size()
+    {
+        return false;
+    }
+    queue.write_buffer(&gpu.vertex, 0, vertex_bytes);
+    queue.write_buffer(&gpu.index, 0, index_bytes);
+    gpu.index_count = mesh.indices.len() as u32;
+    gpu.generation = generation;
+    true
+}
+
+fn create_uniform_buffer(
+    device: &wgpu::Device,
+    layout: &wgpu::BindGroupLayout,
+    stride: u64,
+    slots: u64,
+) -> (wgpu::Buffer, wgpu::BindGroup) {
+    let buffer = device.create_buffer(&wgpu::BufferDescriptor {
+        label: Some("tri_uniforms"),
+        size: stride * slots,
+        usage: wgpu::BufferUsages::UNIFORM | wgpu::BufferUsages::COPY_DST,
+        mapped_at_creation: false,
+    });
+    let bind_group = device.create_bind_group(&wgpu::BindGroupDescriptor {
+        label: Some("tri_bind_group"),
+        layout,
+        entries: &[wgpu::BindGroupEntry {
+            binding: 0,
+            resource: wgpu::BindingResource::Buffer(wgpu::BufferBinding {
+                buffer: &buffer,
+                offset: 0,
+                size: wgpu::BufferSize::new(std::mem::size_of::<Uniforms>() as u64),
+            }),
+        }],
+    });
+    (buffer, bind_group)
+}
+
+fn create_instance_buffer(device: &wgpu::Device, slots: u64) -> wgpu::Buffer {
+    device.create_buffer(&wgpu::BufferDescriptor {
+        label: Some("tri_instances"),
+        size: slots * std::mem::size_of::<Instance>() as u64,
+        usage: wgpu::BufferUsages::VERTEX | wgpu::BufferUsages::COPY_DST,
+        mapped_at_creation: false,
+    })
+}
+
+static NEXT_GPU: AtomicU64 = AtomicU64::new(1);
+
+/// Which pipeline: the WGSL it runs (by hash), the colour format it draws to, and how it
+/// rasterises.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+struct PipelineKey {
+    shader: u64,
+    format: wgpu::TextureFormat,
+    topology: wgpu::PrimitiveTopology,
+    polygon_mode: wgpu::PolygonMode,
+}
+
+/// The adapter and device every renderer shares, with the shader modules and pipelines
+/// built on it. A second window, or one reopened, reuses all of it rather than asking for
+/// a new device and compiling the WGSL again. Sharing the device is also what lets the
+/// engine's mesh caches serve any window.
+#[derive(Debug)]
+struct Gpu {
+    // Tells GpuMesh buffers from different devices apart
+    id: u64,
+    instance: wgpu::Instance,
+    adapter: wgpu::Adapter,
+    device: wgpu::Device,
+    queue: wgpu::Queue,
+    uniform_layout: wgpu::BindGroupLayout,
+    pipeline_layout: wgpu::PipelineLayout,
+    shaders: RefCell<HashMap<u64, Rc<wgpu::ShaderModule>>>,
+    pipelines: RefCell<HashMap<PipelineKey, Rc<wgpu::RenderPipeline>>>,
+}
+
+impl Gpu {
+    /// Open a device on an adapter that can present to `surface`.
+    fn new(instance: wgpu::Instance, surface: &wgpu::Surface<'static>) -> Result<Self, String> {
+        let adapter = pollster::block_on(instance.request_adapter(&wgpu::RequestAdapterOptions {
+            power_preference: wgpu::PowerPreference::HighPerformance,
+            compatible_surface: Some(surface),
+            force_fallback_adapter: false,
+        }))
         .ok_or_else(|| "No suitable GPU adapter found".to_string())?;
         let mut required_features = wgpu::Features::empty();
         if adapter
@@ -330,31 +530,6 @@ impl RendererState {
         ))
         .map_err(|e| format!("request_device failed: {e:?}"))?;
 
-        let size = window.inner_size();
-        let caps = surface.get_capabilities(&adapter);
-        let format = caps
-            .formats
-            .iter()
-            .copied()
-            .find(|f| f.is_srgb())
-            .unwrap_or(caps.formats[0]);
-        let config = wgpu::SurfaceConfiguration {
-            usage: wgpu::TextureUsages::RENDER_ATTACHMENT,
-            format,
-            width: size.width.max(1),
-            height: size.height.max(1),
-            present_mode: caps.present_modes[0],
-            alpha_mode: caps.alpha_modes[0],
-            view_formats: vec![],
-            desired_maximum_frame_latency: 2,
-        };
-        surface.configure(&device, &config);
-
-        let shader = device.create_shader_module(wgpu::ShaderModuleDescriptor {
-            label: Some("tri_shader"),
-            source: wgpu::ShaderSource::Wgsl(TRI_SHADER.into()),
-        });
-
         let uniform_layout = device.create_bind_group_layout(&wgpu::BindGroupLayoutDescriptor {
             label: Some("tri_uniform_layout"),
             entries: &[wgpu::BindGroupLayoutEntry {
@@ -362,10 +537,8 @@ impl RendererState {
                 visibility: wgpu::ShaderStages::VERTEX_FRAGMENT,
                 ty: wgpu::BindingType::Buffer {
                     ty: wgpu::BufferBindingType::Uniform,
-                    has_dynamic_offset: false,
-                    min_binding_size: wgpu::BufferSize::new(
-                        std::mem::size_of::<Uniforms>() as u64,
-                    ),
+                    has_dynamic_offset: true,
+                    min_binding_size: wgpu::BufferSize::new(std::mem::size_of::<Uniforms>() as u64),
                 },
                 count: None,
             }],
@@ -377,67 +550,79 @@ impl RendererState {
             push_constant_ranges: &[],
         });
 
-        let pipeline_fill = device.create_render_pipeline(&wgpu::RenderPipelineDescriptor {
-            label: Some("tri_pipeline"),
-            layout: Some(&pipeline_layout),
-            vertex: wgpu::VertexState {
-                module: &shader,
-                entry_point: "vs_main",
-                buffers: &[Vertex::desc()],
-            },
-            fragment: Some(wgpu::FragmentState {
-                module: &shader,
-                entry_point: "fs_main",
-                targets: &[Some(wgpu::ColorTargetState {
-                    format: config.format,
-                    blend: Some(wgpu::BlendState::ALPHA_BLENDING),
-                    write_mask: wgpu::ColorWrites::ALL,
-                })],
-            }),
-            primitive: wgpu::PrimitiveState {
-                topology: wgpu::PrimitiveTopology::TriangleList,
-                strip_index_format: None,
-                front_face: wgpu::FrontFace::Ccw,
-                cull_mode: None,
-                polygon_mode: wgpu::PolygonMode::Fill,
-                unclipped_depth: false,
-                conservative: false,
-            },
-            depth_stencil: Some(wgpu::DepthStencilState {
-                format: wgpu::TextureFormat::Depth24Plus,
-                depth_write_enabled: true,
-                depth_compare: wgpu::CompareFunction::Less,
-                stencil: wgpu::StencilState::default(),
-                bias: wgpu::DepthBiasState::default(),
-            }),
-            multisample: wgpu::MultisampleState::default(),
-            multiview: None,
-        });
+        Ok(Gpu {
+            id: NEXT_GPU.fetch_add(1, Ordering::Relaxed),
+            instance,
+            adapter,
+            device,
+            queue,
+            uniform_layout,
+            pipeline_layout,
+            shaders: RefCell::new(HashMap::new()),
+            pipelines: RefCell::new(HashMap::new()),
+        })
+    }
 
-        let pipeline_wireframe = if required_features.contains(wgpu::Features::POLYGON_MODE_LINE) {
-            Some(device.create_render_pipeline(&wgpu::RenderPipelineDescriptor {
-                label: Some("tri_pipeline_wire"),
-                layout: Some(&pipeline_layout),
+    /// The pipeline running `source` into `format` with `polygon_mode`, built the first
+    /// time any window asks for it.
+    fn pipeline(
+        &self,
+        source: &str,
+        format: wgpu::TextureFormat,
+        polygon_mode: wgpu::PolygonMode,
+    ) -> Rc<wgpu::RenderPipeline> {
+        let mut hasher = DefaultHasher::new();
+        source.hash(&mut hasher);
+        let key = PipelineKey {
+            shader: hasher.finish(),
+            format,
+            topology: wgpu::PrimitiveTopology::TriangleList,
+            polygon_mode,
+        };
+        if let Some(pipeline) = self.pipelines.borrow().get(&key) {
+            return pipeline.clone();
+        }
+        let shader = self
+            .shaders
+            .borrow_mut()
+            .entry(key.shader)
+            .or_insert_with(|| {
+                Rc::new(
+                    self.device
+                        .create_shader_module(wgpu::ShaderModuleDescriptor {
+                            label: Some("tri_shader"),
+                            source: wgpu::ShaderSource::Wgsl(source.into()),
+                        }),
+                )
+            })
+            .clone();
+        let pipeline = Rc::new(self.device.create_render_pipeline(
+            &wgpu::RenderPipelineDescriptor {
+                label: Some(match polygon_mode {
+                    wgpu::PolygonMode::Fill => "tri_pipeline",
+                    _ => "tri_pipeline_wire",
+                }),
+                layout: Some(&self.pipeline_layout),
                 vertex: wgpu::VertexState {
                     module: &shader,
                     entry_point: "vs_main",
-                    buffers: &[Vertex::desc()],
+                    buffers: &[Vertex::desc(), Instance::desc()],
                 },
                 fragment: Some(wgpu::FragmentState {
                     module: &shader,
                     entry_point: "fs_main",
                     targets: &[Some(wgpu::ColorTargetState {
-                        format: config.format,
+                        format,
                         blend: Some(wgpu::BlendState::ALPHA_BLENDING),
                         write_mask: wgpu::ColorWrites::ALL,
                     })],
                 }),
                 primitive: wgpu::PrimitiveState {
-                    topology: wgpu::PrimitiveTopology::TriangleList,
+                    topology: key.topology,
                     strip_index_format: None,
                     front_face: wgpu::FrontFace::Ccw,
                     cull_mode: None,
-                    polygon_mode: wgpu::PolygonMode::Line,
+                    polygon_mode,
                     unclipped_depth: false,
                     conservative: false,
                 },
@@ -450,22 +635,81 @@ impl RendererState {
                 }),
                 multisample: wgpu::MultisampleState::default(),
                 multiview: None,
-            }))
-        } else {
-            None
+            },
+        ));
+        self.pipelines.borrow_mut().insert(key, pipeline.clone());
+        pipeline
+    }
+}
+
+impl RendererState {
+    fn new(
+        window: &'static Window,
+        gpu: Rc<Gpu>,
+        surface: wgpu::Surface<'static>,
+    ) -> Result<Self, String> {
+        let size = window.inner_size();
+        let caps = surface.get_capabilities(&gpu.adapter);
+        let format = caps
+            .formats
+            .iter()
+            .copied()
+            .find(|f| f.is_srgb())
+            .unwrap_or(caps.formats[0]);
+        let config = wgpu::SurfaceConfiguration {
+            usage: wgpu::TextureUsages::RENDER_ATTACHMENT,
+            format,
+            width: size.width.max(1),
+            height: size.height.max(1),
+            present_mode: caps.present_modes[0],
+            alpha_mode: caps.alpha_modes[0],
+            view_formats: vec![],
+            desired_maximum_frame_latency: 2,
         };
+        surface.configure(&gpu.device, &config);
 
-        let (depth_texture, depth_view) = create_depth_texture(&device, &config);
+        let pipeline_fill = gpu.pipeline(TRI_SHADER, config.format, wgpu::PolygonMode::Fill);
+        let pipeline_wireframe = gpu
+            .device
+            .features()
+            .contains(wgpu::Features::POLYGON_MODE_LINE)
+            .then(|| gpu.pipeline(TRI_SHADER, config.format, wgpu::PolygonMode::Line));
+
+        let (depth_texture, depth_view) = create_depth_texture(&gpu.device, &config);
+
+        let alignment = gpu
+            .device
+            .limits()
+            .min_uniform_buffer_offset_alignment
+            .max(1) as u64;
+        let uniform_size = std::mem::size_of::<Uniforms>() as u64;
+        let uniform_stride = uniform_size.div_ceil(alignment) * alignment;
+        let uniform_slots = 16;
+        let (uniform_buffer, uniform_bind_group) = create_uniform_buffer(
+            &gpu.device,
+            &gpu.uniform_layout,
+            uniform_stride,
+            uniform_slots,
+        );
+        let instance_slots = 256;
+        let instance_buffer = create_instance_buffer(&gpu.device, instance_slots);
 
         Ok(RendererState {
             window,
             surface,
-            device,
-            queue,
+            gpu,
             config,
             pipeline_fill,
             pipeline_wireframe,
-            uniform_layout,
+            uniform_buffer,
+            uniform_bind_group,
+            uniform_stride,
+            uniform_slots,
+            instance_buffer,
+            instance_slots,
+            last_uniforms: Vec::new(),
+            last_instances: Vec::new(),
+            frame: 0,
             depth_texture,
             depth_view,
             pixel_ratio: 1.0,
@@ -475,8 +719,8 @@ impl RendererState {
     fn resize(&mut self, width: u32, height: u32) {
         self.config.width = width.max(1);
         self.config.height = height.max(1);
-        self.surface.configure(&self.device, &self.config);
-        let (depth_texture, depth_view) = create_depth_texture(&self.device, &self.config);
+        self.surface.configure(&self.gpu.device, &self.config);
+        let (depth_texture, depth_view) = create_depth_texture(&self.gpu.device, &self.config);
         self.depth_texture = depth_texture;
         self.depth_view = depth_view;
     }
@@ -502,11 +746,12 @@ impl RendererState {
         let view = frame
             .texture
             .create_view(&wgpu::TextureViewDescriptor::default());
-        let mut encoder = self.device.create_command_encoder(
-            &wgpu::CommandEncoderDescriptor {
+        let mut encoder = self
+            .gpu
+            .device
+            .create_command_encoder(&wgpu::CommandEncoderDescriptor {
                 label: Some("tri_render"),
-            },
-        );
+            });
         {
             let _rpass = encoder.begin_render_pass(&wgpu::RenderPassDescriptor {
                 label: Some("tri_clear"),
@@ -535,17 +780,38 @@ impl RendererState {
                 timestamp_writes: None,
             });
         }
-        self.queue.submit(Some(encoder.finish()));
+        self.gpu.queue.submit(Some(encoder.finish()));
         frame.present();
         Ok(())
     }
 
+    /// Grow the persistent uniform and instance buffers to hold `draws` and `instances`.
+    fn reserve_frame(&mut self, draws: u64, instances: u64) {
+        if draws > self.uniform_slots {
+            self.uniform_slots = draws.next_power_of_two();
+            let (buffer, bind_group) = create_uniform_buffer(
+                &self.gpu.device,
+                &self.gpu.uniform_layout,
+                self.uniform_stride,
+                self.uniform_slots,
+            );
+            self.uniform_buffer = buffer;
+            self.uniform_bind_group = bind_group;
+            self.last_uniforms.clear();
+        }
+        if instances > self.instance_slots {
+            self.instance_slots = instances.next_power_of_two();
+            self.instance_buffer = create_instance_buffer(&self.gpu.device, self.instance_slots);
+            self.last_instances.clear();
+        }
+    }
+
     fn render_scene(
         &mut self,
         view_proj: Mat4,
         items: &[RenderItem],
         mesh_cache: &mut HashMap<usize, GpuMesh>,
-        uniform_cache: &mut HashMap<usize, UniformEntry>,
+        owned_meshes: &mut HashMap<u64, OwnedMesh>,
         wireframe: bool,
     ) -> Result<(), String> {
         if items.is_empty() {
@@ -571,111 +837,83 @@ impl RendererState {
         let view = frame
             .texture
             .create_view(&wgpu::TextureViewDescriptor::default());
-
-        enum DrawSource {
-            Cached(usize),
-            Owned {
-                vertex: wgpu::Buffer,
-                index: wgpu::Buffer,
-                index_count: u32,
-            },
+        self.frame += 1;
+        let frame_no = self.frame;
+
+        // Items that share a mesh and every uniform (material and lights) become one
+        // instanced draw; groups keep the order their first item had in the scene.
+        struct DrawGroup {
+            mesh: MeshRef,
+            uniforms: Uniforms,
+            first: u32,
+            count: u32,
         }
 
-        enum UniformSource {
-            Cached(usize),
-            Owned(wgpu::BindGroup),
-        }
-
-        struct DrawBatch {
-            source: DrawSource,
-            uniform: UniformSource,
-        }
-
-        let mut batches = Vec::with_capacity(items.len());
+        let mut groups: Vec<DrawGroup> = Vec::new();
+        let mut group_of: HashMap<(MeshRef, [u32; 32]), usize> = HashMap::new();
+        let mut item_groups = Vec::with_capacity(items.len());
         for item in items {
-            let source = if let Some(key) = item.mesh_key {
-                if !mesh_cache.contains_key(&key) {
-            let vertices: Vec<Vertex> = item
-                .mesh
-                .vertices
-                .iter()
-                .enumerate()
-                .map(|(idx, position)| Vertex {
-                    position: *position,
-                    normal: item
-                        .mesh
-                        .normals
-                        .get(idx)
-                        .copied()
-                        .unwrap_or([0.0, 1.0, 0.0]),
-                })
-                .collect();
-                    if vertices.is_empty() || item.mesh.indices.is_empty() {
-                        continue;
-                    }
-
-                    let vertex = self.device.create_buffer_init(&wgpu::util::BufferInitDescriptor {
-                        label: Some("tri_vertices"),
-                        contents: bytemuck::cast_slice(&vertices),
-                        usage: wgpu::BufferUsages::VERTEX,
-                    });
-                    let index = self.device.create_buffer_init(&wgpu::util::BufferInitDescriptor {
-                        label: Some("tri_indices"),
-                        contents: bytemuck::cast_slice(&item.mesh.indices),
-                        usage: wgpu::BufferUsages::INDEX,
+            let mesh = if let Some(key) = item.mesh_key {
+                // Buffers on another Gpu (a window that needed its own) count as missing
+                let cached = mesh_cache
+                    .get_mut(&key)
+                    .filter(|mesh| mesh.gpu == self.gpu.id);
+                if cached
+                    .as_ref()
+                    .map_or(true, |mesh| mesh.generation != item.mesh_generation)
+                {
+                    // The geometry changed (or is new): refill its buffers in place when the
+                    // new data fits, otherwise allocate a fresh pair.
+                    let data = match &item.mesh {
+                        Some(data) => data,
+                        None => continue,
+                    };
+                    let rewritten = cached.is_some_and(|mesh| {
+                        rewrite_mesh(&self.gpu.queue, mesh, data, item.mesh_generation)
                     });
-                    let index_count = item.mesh.indices.len() as u32;
-                    mesh_cache.insert(
-                        key,
-                        GpuMesh {
-                            vertex,
-                            index,
-                            index_count,
-                        },
-                    );
+                    if !rewritten {
+                        match upload_mesh(&self.gpu, data, item.mesh_generation) {
+                            Some(mesh) => {
+                                mesh_cache.insert(key, mesh);
+                            }
+                            None => {
+                                mesh_cache.remove(&key);
+                                continue;
+                            }
+                        }
+                    }
                 }
-                DrawSource::Cached(key)
+                MeshRef::Keyed(key)
             } else {
-            let vertices: Vec<Vertex> = item
-                .mesh
-                .vertices
-                .iter()
-                .enumerate()
-                .map(|(idx, position)| Vertex {
-                    position: *position,
-                    normal: item
-                        .mesh
-                        .normals
-                        .get(idx)
-                        .copied()
-                        .unwrap_or([0.0, 1.0, 0.0]),
-                })
-                .collect();
-                if vertices.is_empty() || item.mesh.indices.is_empty() {
-                    continue;
-                }
-
-                let vertex = self.device.create_buffer_init(&wgpu::util::BufferInitDescriptor {
-                    label: Some("tri_vertices"),
-                    contents: bytemuck::cast_slice(&vertices),
-                    usage: wgpu::BufferUsages::VERTEX,
-                });
-                let index = self.device.create_buffer_init(&wgpu::util::BufferInitDescriptor {
-                    label: Some("tri_indices"),
-                    contents: bytemuck::cast_slice(&item.mesh.indices),
-                    usage: wgpu::BufferUsages::INDEX,
-                });
-                let index_count = item.mesh.indices.len() as u32;
-                DrawSource::Owned {
-                    vertex,
-                    index,
-                    index_count,
+                let data = match &item.mesh {
+                    Some(data) => data,
+                    None => continue,
+                };
+                let key = mesh_content_key(data);
+                if let Some(owned) = owned_meshes
+                    .get_mut(&key)
+                    .filter(|owned| owned.mesh.gpu == self.gpu.id)
+                {
+                    owned.last_frame = frame_no;
+                } else {
+                    match upload_mesh(&self.gpu, data, 0) {
+                        Some(mesh) => {
+                            owned_meshes.insert(
+                                key,
+                                OwnedMesh {
+                                    mesh,
+                                    last_frame: frame_no,
+                                },
+                            );
+                        }
+                        None => continue,
+                    }
                 }
+                MeshRef::Content(key)
             };
 
             let uniforms = Uniforms {
                 view_proj: view_proj.to_cols_array_2d(),
-                model: item.model.to_cols_array_2d(),
                 color: item.color,
                 ambient: item.ambient,
                 light_dir: item.light_dir,
@@ -685,58 +923,67 @@ impl RendererState {
                 point_params: item.point_params,
                 mat_params: item.mat_params,
             };
-
-            let uniform = if let Some(key) = item.object_key {
-                if !uniform_cache.contains_key(&key) {
-                    let uniform_buffer = self.device.create_buffer(&wgpu::BufferDescriptor {
-                        label: Some("tri_uniforms"),
-                        size: std::mem::size_of::<Uniforms>() as u64,
-                        usage: wgpu::BufferUsages::UNIFORM | wgpu::BufferUsages::COPY_DST,
-                        mapped_at_creation: false,
-                    });
-                    let bind_group = self.device.create_bind_group(&wgpu::BindGroupDescriptor {
-                        label: Some("tri_bind_group"),
-                        layout: &self.uniform_layout,
-                        entries: &[wgpu::BindGroupEntry {
-                            binding: 0,
-                            resource: uniform_buffer.as_entire_binding(),
-                        }],
-                    });
-                    uniform_cache.insert(
-                        key,
-                        UniformEntry {
-                            buffer: uniform_buffer,
-                            bind_group,
-                        },
-                    );
-                }
-                if let Some(entry) = uniform_cache.get(&key) {
-                    self.queue
-                        .write_buffer(&entry.buffer, 0, bytemuck::bytes_of(&uniforms));
-                }
-                UniformSource::Cached(key)
-            } else {
-                let uniform_buffer = self.device.create_buffer_init(&wgpu::util::BufferInitDescriptor {
-                    label: Some("tri_uniforms"),
-                    contents: bytemuck::bytes_of(&uniforms),
-                    usage: wgpu::BufferUsages::UNIFORM | wgpu::BufferUsages::COPY_DST,
+            let shared: [u32; 32] = bytemuck::cast([
+                item.color,
+                item.ambient,
+                item.light_dir,
+                item.light_color,
+                item.point_pos,
+                item.point_color,
+                item.point_params,
+                item.mat_params,
+            ]);
+            let group = *group_of.entry((mesh, shared)).or_insert_with(|| {
+                groups.push(DrawGroup {
+                    mesh,
+                    uniforms,
+                    first: 0,
+                    count: 0,
                 });
+                groups.len() - 1
+            });
+            groups[group].count += 1;
+            item_groups.push((group, item.model));
+        }
+        owned_meshes.retain(|_, owned| owned.last_frame == frame_no);
 
-                let bind_group = self.device.create_bind_group(&wgpu::BindGroupDescriptor {
-                    label: Some("tri_bind_group"),
-                    layout: &self.uniform_layout,
-                    entries: &[wgpu::BindGroupEntry {
-                        binding: 0,
-                        resource: uniform_buffer.as_entire_binding(),
-                    }],
-                });
-                UniformSource::Owned(bind_group)
+        let mut next = 0u32;
+        for group in &mut groups {
+            group.first = next;
+            next += group.count;
+        }
+        let mut instances = vec![Instance::zeroed(); next as usize];
+        let mut filled = vec![0u32; groups.len()];
+        for (group, model) in &item_groups {
+            let slot = groups[*group].first + filled[*group];
+            filled[*group] += 1;
+            instances[slot as usize] = Instance {
+                model: model.to_cols_array_2d(),
             };
+        }
 
-            batches.push(DrawBatch { source, uniform });
+        self.reserve_frame(groups.len() as u64, instances.len() as u64);
+        let stride = self.uniform_stride as usize;
+        let mut uniform_bytes = vec![0u8; stride * groups.len()];
+        for (i, group) in groups.iter().enumerate() {
+            let bytes = bytemuck::bytes_of(&group.uniforms);
+            uniform_bytes[i * stride..i * stride + bytes.len()].copy_from_slice(bytes);
+        }
+        if !groups.is_empty() && uniform_bytes != self.last_uniforms {
+            self.gpu.queue.write_buffer(&self.uniform_buffer, 0, &uniform_bytes);
+            self.last_uniforms = uniform_bytes;
+        }
+        if !instances.is_empty()
+            && bytemuck::cast_slice::<Instance, u8>(&instances)
+                != bytemuck::cast_slice::<Instance, u8>(&self.last_instances)
+        {
+            self.gpu
+                .queue
+                .write_buffer(&self.instance_buffer, 0, bytemuck::cast_slice(&instances));
+            self.last_instances = instances;
         }
 
-        if tri_debug_enabled() && batches.is_empty() {
+        if tri_debug_enabled() && groups.is_empty() {
             if !TRI_DEBUG_EMPTY_BATCH_LOGGED.swap(true, Ordering::Relaxed) {
                 eprintln!(
                     "tri: no drawable batches (items={}, wireframe={})",
@@ -745,24 +992,26 @@ impl RendererState {
                 );
             }
         }
-        if tri_debug_enabled() && !batches.is_empty() {
+        if tri_debug_enabled() && !groups.is_empty() {
             if !TRI_DEBUG_DRAW_LOGGED.swap(true, Ordering::Relaxed) {
                 eprintln!(
-                    "tri: draw batches ready (items={}, batches={}, wireframe={})",
+                    "tri: draw batches ready (items={}, draws={}, wireframe={})",
                     items.len(),
-                    batches.len(),
+                    groups.len(),
                     wireframe
                 );
             }
         }
 
-        let mut encoder = self.device.create_command_encoder(
+        let mut encoder = self.gpu.device.create_command_encoder(
             &wgpu::CommandEncoderDescriptor {
                 label: Some("tri_render_scene"),
             },
         );
-        let pipeline = if wireframe {
-            self.pipeline_wireframe.as_ref().unwrap_or(&self.pipeline_fill)
+        let pipeline: &wgpu::RenderPipeline = if wireframe {
+            self.pipeline_wireframe
+                .as_ref()
+                .unwrap_or(&self.pipeline_fill)
         } else {
             &self.pipeline_fill
         };
@@ -796,44 +1045,28 @@ impl RendererState {
             });
 
             rpass.set_pipeline(pipeline);
-            for batch in &batches {
-                match &batch.uniform {
-                    UniformSource::Cached(key) => {
-                        if let Some(entry) = uniform_cache.get(key) {
-                            rpass.set_bind_group(0, &entry.bind_group, &[]);
-                        } else {
-                            continue;
-                        }
-                    }
-                    UniformSource::Owned(bind_group) => {
-                        rpass.set_bind_group(0, bind_group, &[]);
-                    }
-                }
-                match &batch.source {
-                    DrawSource::Cached(key) => {
-                        if let Some(mesh) = mesh_cache.get(key) {
-                            rpass.set_vertex_buffer(0, mesh.vertex.slice(..));
-                            rpass.set_index_buffer(
-                                mesh.index.slice(..),
-                                wgpu::IndexFormat::Uint32,
-                            );
-                            rpass.draw_indexed(0..mesh.index_count, 0, 0..1);
-                        }
-                    }
-                    DrawSource::Owned {
-                        vertex,
-                        index,
-                        index_count,
-                    } => {
-                        rpass.set_vertex_buffer(0, vertex.slice(..));
-                        rpass.set_index_buffer(index.slice(..), wgpu::IndexFormat::Uint32);
-                        rpass.draw_indexed(0..*index_count, 0, 0..1);
-                    }
-                }
+            for (i, group) in groups.iter().enumerate() {
+                let mesh = match group.mesh {
+                    MeshRef::Keyed(key) => mesh_cache.get(&key),
+                    MeshRef::Content(key) => owned_meshes.get(&key).map(|owned| &owned.mesh),
+                };
+                let mesh = match mesh {
+                    Some(mesh) => mesh,
+                    None => continue,
+                };
+                let offset = (i as u64 * self.uniform_stride) as wgpu::DynamicOffset;
+                rpass.set_bind_group(0, &self.uniform_bind_group, &[offset]);
+                rpass.set_vertex_buffer(0, mesh.vertex.slice(..));
+                let size = std::mem::size_of::<Instance>() as u64;
+                let start = group.first as u64 * size;
+                let end = start + group.count as u64 * size;
+                rpass.set_vertex_buffer(1, self.instance_buffer.slice(start..end));
+                rpass.set_index_buffer(mesh.index.slice(..), wgpu::IndexFormat::Uint32);
+                rpass.draw_indexed(0..mesh.index_count, 0, 0..group.count);
             }
         }
 
-        self.queue.submit(Some(encoder.finish()));
+        self.gpu.queue.submit(Some(encoder.finish()));
         frame.present();
         Ok(())
     }
@@ -866,10 +1099,13 @@ fn create_depth_texture(
 #[derive(Debug, Default)]
 pub struct TriEngine {
     next_renderer: usize,
-    renderers: HashMap<usize, RendererState>,
+    // Boxed so the loop's pointer survives renderers being added from its callback.
+    renderers: HashMap<usize, Box<RendererState>>,
     mesh_cache: HashMap<usize, GpuMesh>,
-    uniform_cache: HashMap<usize, UniformEntry>,
+    owned_meshes: HashMap<u64, OwnedMesh>,
     event_loop: Option<EventLoop<()>>,
+    // Shared by every renderer; kept after the last window closes so the next opens fast
+    gpu: Option<Rc<Gpu>>,
 }
 
 impl TriEngine {
@@ -878,11 +1114,36 @@ impl TriEngine {
             next_renderer: 1,
             renderers: HashMap::new(),
             mesh_cache: HashMap::new(),
-            uniform_cache: HashMap::new(),
+            owned_meshes: HashMap::new(),
             event_loop: None,
+            gpu: None,
         }
     }
 
+    /// The shared Gpu and a surface for `window` on it. If the shared adapter can't
+    /// present to the window, it gets a Gpu of its own, which later windows then share.
+    fn gpu_for(
+        &mut self,
+        window: &'static Window,
+    ) -> Result<(Rc<Gpu>, wgpu::Surface<'static>), String> {
+        if let Some(gpu) = &self.gpu {
+            let surface = gpu
+                .instance
+                .create_surface(window)
+                .map_err(|e| format!("create_surface failed: {e:?}"))?;
+            if gpu.adapter.is_surface_supported(&surface) {
+                return Ok((gpu.clone(), surface));
+            }
+        }
+        let instance = wgpu::Instance::default();
+        let surface = instance
+            .create_surface(window)
+            .map_err(|e| format!("create_surface failed: {e:?}"))?;
+        let gpu = Rc::new(Gpu::new(instance, &surface)?);
+        self.gpu = Some(gpu.clone());
+        Ok((gpu, surface))
+    }
+
     pub fn create_renderer(&mut self) -> Result<usize, String> {
         if self.event_loop.is_none() {
             self.event_loop = Some(create_event_loop()?);
@@ -896,11 +1157,12 @@ impl TriEngine {
             .build(event_loop)
             .map_err(|e| format!("window build failed: {e:?}"))?;
         let window = Box::leak(Box::new(window));
-        let renderer = RendererState::new(window)?;
+        let (gpu, surface) = self.gpu_for(window)?;
+        let renderer = RendererState::new(window, gpu, surface)?;
 
         let handle = self.next_renderer;
         self.next_renderer = self.next_renderer.saturating_add(1);
-        self.renderers.insert(handle, renderer);
+        self.renderers.insert(handle, Box::new(renderer));
         Ok(handle)
     }
 
@@ -929,7 +1191,7 @@ impl TriEngine {
                 view_proj,
                 &items,
                 &mut self.mesh_cache,
-                &mut self.uniform_cache,
+                &mut self.owned_meshes,
                 wireframe,
             )?;
         }
@@ -971,73 +1233,80 @@ impl TriEngine {
         });
     }
 
-    pub fn remove_mesh(&mut self, key: usize) {
-        self.mesh_cache.remove(&key);
+    /// Whether the buffers cached for `key` already hold geometry `generation`.
+    pub fn has_mesh(&self, key: usize, generation: u64) -> bool {
+        self.mesh_cache
+            .get(&key)
+            .is_some_and(|mesh| mesh.generation == generation)
     }
 
-    pub fn remove_uniform(&mut self, key: usize) {
-        self.uniform_cache.remove(&key);
+    pub fn remove_mesh(&mut self, key: usize) {
+        self.mesh_cache.remove(&key);
     }
 
     pub fn remove_renderer(&mut self, handle: usize) {
         self.renderers.remove(&handle);
     }
 
-    pub fn run_loop(
-        &mut self,
-        handle: usize,
-        mut callback: Option<LoopCallback>,
-    ) -> Result<(), String> {
+    fn take_loop(&mut self, handle: usize) -> Result<(EventLoop<()>, *mut RendererState), String> {
         if self.event_loop.is_none() {
             self.event_loop = Some(create_event_loop()?);
         }
-        let event_loop = self
-            .event_loop
-            .take()
-            .ok_or_else(|| "Event loop unavailable".to_string())?;
         let renderer_ptr = self
             .renderers
             .get_mut(&handle)
-            .map(|renderer| renderer as *mut RendererState)
+            .map(|renderer| &mut **renderer as *mut RendererState)
             .ok_or_else(|| "Unknown renderer handle".to_string())?;
-        let window_id = unsafe { (*renderer_ptr).window.id() };
-        let mut last_frame = Instant::now();
-
-        event_loop
-            .run(move |event, target| {
-                target.set_control_flow(ControlFlow::Poll);
-                match event {
-                    Event::WindowEvent { window_id: id, event } if id == window_id => match event {
-                        WindowEvent::CloseRequested => target.exit(),
-                        WindowEvent::Resized(size) => unsafe {
-                            (*renderer_ptr).resize(size.width, size.height);
-                        },
-                        WindowEvent::ScaleFactorChanged {
-                            mut inner_size_writer,
-                            ..
-                        } => unsafe {
-                            let size = (*renderer_ptr).window.inner_size();
-                            let _ = inner_size_writer.request_inner_size(size);
-                            (*renderer_ptr).resize(size.width, size.height);
-                        },
-                        WindowEvent::RedrawRequested => {
-                            let now = Instant::now();
-                            let dt = now.duration_since(last_frame).as_secs_f64();
-                            last_frame = now;
-                            if let Some(cb) = callback.as_mut() {
-                                cb(dt);
-                            } else if unsafe { (*renderer_ptr).render() }.is_err() {
-                                target.exit();
-                            }
-                        }
-                        _ => {}
+        let event_loop = self
+            .event_loop
+            .take()
+            .ok_or_else(|| "Event loop unavailable".to_string())?;
+        Ok((event_loop, renderer_ptr))
+    }
+}
+
+/// Run the window loop for renderer `handle`. The engine is not borrowed while it runs, so
+/// `callback` can render and create objects; rendering skips its event pump
+/// while the loop owns the event loop.
+pub fn run_loop(handle: usize, mut callback: Option<LoopCallback>) -> Result<(), String> {
+    let (event_loop, renderer_ptr) = with_engine(|engine| engine.take_loop(handle))?;
+    let window_id = unsafe { (*renderer_ptr).window.id() };
+    let mut last_frame = Instant::now();
+
+    event_loop
+        .run(move |event, target| {
+            target.set_control_flow(ControlFlow::Poll);
+            match event {
+                Event::WindowEvent { window_id: id, event } if id == window_id => match event {
+                    WindowEvent::CloseRequested => target.exit(),
+                    WindowEvent::Resized(size) => unsafe {
+                        (*renderer_ptr).resize(size.width, size.height);
                     },
-                    Event::AboutToWait => {
-                        unsafe { (*renderer_ptr).window.request_redraw() };
+                    WindowEvent::ScaleFactorChanged {
+                        mut inner_size_writer,
+                        ..
+                    } => unsafe {
+                        let size = (*renderer_ptr).window.inner_size();
+                        let _ = inner_size_writer.request_inner_size(size);
+                        (*renderer_ptr).resize(size.width, size.height);
+                    },
+                    WindowEvent::RedrawRequested => {
+                        let now = Instant::now();
+                        let dt = now.duration_since(last_frame).as_secs_f64();
+                        last_frame = now;
+                        if let Some(cb) = callback.as_mut() {
+                            cb(dt);
+                        } else if unsafe { (*renderer_ptr).render() }.is_err() {
+                            target.exit();
+                        }
                     }
                     _ => {}
+                },
+                Event::AboutToWait => {
+                    unsafe { (*renderer_ptr).window.request_redraw() };
                 }
-            })
-            .map_err(|e| format!("event loop error: {e:?}"))
-    }
+                _ => {}
+            }
+        })
+        .map_err(|e| format!("event loop error: {e:?}"))
 }
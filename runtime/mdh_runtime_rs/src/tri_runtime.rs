@@ -1,7 +1,8 @@
+use std::borrow::Cow;
 use std::collections::HashMap;
 use std::ffi::{CStr, CString};
 use std::os::raw::c_char;
-use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
 use std::sync::{Mutex, OnceLock};
 use std::{env, fmt};
 
@@ -10,7 +11,8 @@ use crate::{
     MDH_TAG_BOOL, MDH_TAG_CLOSURE, MDH_TAG_DICT, MDH_TAG_FLOAT, MDH_TAG_FUNCTION, MDH_TAG_INT,
     MDH_TAG_LIST, MDH_TAG_NATIVE, MDH_TAG_NIL, MDH_TAG_STRING,
 };
-use crate::tri_engine::{with_engine, LoopCallback, MeshData, RenderItem};
+use crate::tri_engine::{run_loop, with_engine, LoopCallback, MeshData, RenderItem};
+use crate::tri_scene::{axis, Frustum, Part, Shape, Sphere, TransformStore};
 use glam::{EulerRot, Mat4, Quat, Vec3};
 
 #[repr(C)]
@@ -30,6 +32,21 @@ struct TriObject {
     fields: HashMap<String, MdhValue>,
     native_key: usize,
     renderer_handle: Option<usize>,
+    // The store slot of an object with a transform.
+    transform: Option<u64>,
+    // Set on position/rotation/scale objects: the slot and vector their x/y/z live in.
+    view: Option<(u64, Part)>,
+    // Restamped on every field write. Stamps are unique across objects, so the engine can
+    // tell a changed geometry (or a new one at a freed address) from the one it uploaded.
+    generation: u64,
+}
+
+static TRI_NEXT_GENERATION: AtomicU64 = AtomicU64::new(1);
+// Bumped by every geometry field write; cached subtree spheres built before it are stale.
+static TRI_GEOMETRY_EPOCH: AtomicU64 = AtomicU64::new(0);
+
+fn tri_next_generation() -> u64 {
+    TRI_NEXT_GENERATION.fetch_add(1, Ordering::Relaxed)
 }
 
 #[derive(Clone)]
@@ -50,12 +67,14 @@ struct LightInfo {
 
 struct TriState {
     objects: HashMap<usize, TriObject>,
+    transforms: TransformStore,
 }
 
 impl TriState {
     fn new() -> Self {
         TriState {
             objects: HashMap::new(),
+            transforms: TransformStore::new(),
         }
     }
 }
@@ -105,94 +124,71 @@ type MdhFn5 =
 type MdhFn6 =
     unsafe extern "C" fn(MdhValue, MdhValue, MdhValue, MdhValue, MdhValue, MdhValue) -> MdhValue;
 
+// A closure's function takes its env (the closure block) ahead of the arguments and loads
+// captures from it, so any number of captures costs the same call.
+type MdhEnvFn0 = unsafe extern "C" fn(*const u8) -> MdhValue;
+type MdhEnvFn1 = unsafe extern "C" fn(*const u8, MdhValue) -> MdhValue;
+type MdhEnvFn2 = unsafe extern "C" fn(*const u8, MdhValue, MdhValue) -> MdhValue;
+type MdhEnvFn3 = unsafe extern "C" fn(*const u8, MdhValue, MdhValue, MdhValue) -> MdhValue;
+type MdhEnvFn4 =
+    unsafe extern "C" fn(*const u8, MdhValue, MdhValue, MdhValue, MdhValue) -> MdhValue;
+type MdhEnvFn5 =
+    unsafe extern "C" fn(*const u8, MdhValue, MdhValue, MdhValue, MdhValue, MdhValue) -> MdhValue;
+type MdhEnvFn6 = unsafe extern "C" fn(
+    *const u8,
+    MdhValue,
+    MdhValue,
+    MdhValue,
+    MdhValue,
+    MdhValue,
+    MdhValue,
+) -> MdhValue;
+
 unsafe fn mdh_call_value(func_val: MdhValue, args: &[MdhValue]) -> MdhValue {
-    let mut call_args = [__mdh_make_nil(); 6];
-    let mut total_args = args.len();
-    let mut fn_val = func_val;
+    if args.len() > 6 {
+        __mdh_hurl(mdh_make_string_from_rust(
+            "Too many arguments for render loop callback",
+        ));
+        return __mdh_make_nil();
+    }
+    let mut a = [__mdh_make_nil(); 6];
+    a[..args.len()].copy_from_slice(args);
 
     if func_val.tag == MDH_TAG_CLOSURE {
-        let base = func_val.data as *const u8;
-        if base.is_null() {
-            __mdh_hurl(mdh_make_string_from_rust("Invalid closure"));
-            return __mdh_make_nil();
-        }
-        let header = base as *const i64;
-        let len = *header.add(1);
-        if len <= 0 {
+        let env = func_val.data as *const u8;
+        if env.is_null() || *(env as *const i64).add(1) <= 0 {
             __mdh_hurl(mdh_make_string_from_rust("Invalid closure"));
             return __mdh_make_nil();
         }
-        let elems = base.add(16) as *const MdhValue;
-        fn_val = *elems;
-        let captures = len - 1;
-        if captures > 3 {
-            __mdh_hurl(mdh_make_string_from_rust(
-                "Closure captures > 3 not supported in render loop",
-            ));
-            return __mdh_make_nil();
-        }
-        if (captures as usize) + args.len() > 6 {
-            __mdh_hurl(mdh_make_string_from_rust(
-                "Too many arguments for render loop callback",
-            ));
-            return __mdh_make_nil();
-        }
-        for i in 0..captures {
-            call_args[i as usize] = *elems.add(1 + i as usize);
-        }
-        for (i, arg) in args.iter().enumerate() {
-            call_args[captures as usize + i] = *arg;
-        }
-        total_args = captures as usize + args.len();
-    } else if func_val.tag == MDH_TAG_FUNCTION {
-        if args.len() > 6 {
-            __mdh_hurl(mdh_make_string_from_rust(
-                "Too many arguments for render loop callback",
-            ));
-            return __mdh_make_nil();
-        }
-        for (i, arg) in args.iter().enumerate() {
-            call_args[i] = *arg;
-        }
-    } else {
+        let fn_ptr = (*(env.add(16) as *const MdhValue)).data as usize;
+        return match args.len() {
+            0 => std::mem::transmute::<usize, MdhEnvFn0>(fn_ptr)(env),
+            1 => std::mem::transmute::<usize, MdhEnvFn1>(fn_ptr)(env, a[0]),
+            2 => std::mem::transmute::<usize, MdhEnvFn2>(fn_ptr)(env, a[0], a[1]),
+            3 => std::mem::transmute::<usize, MdhEnvFn3>(fn_ptr)(env, a[0], a[1], a[2]),
+            4 => std::mem::transmute::<usize, MdhEnvFn4>(fn_ptr)(env, a[0], a[1], a[2], a[3]),
+            5 => std::mem::transmute::<usize, MdhEnvFn5>(fn_ptr)(env, a[0], a[1], a[2], a[3], a[4]),
+            _ => std::mem::transmute::<usize, MdhEnvFn6>(fn_ptr)(
+                env, a[0], a[1], a[2], a[3], a[4], a[5],
+            ),
+        };
+    }
+    if func_val.tag != MDH_TAG_FUNCTION {
         __mdh_hurl(mdh_make_string_from_rust(
             "Renderar.loop expects a function",
         ));
         return __mdh_make_nil();
     }
 
-    let fn_ptr = fn_val.data as usize;
-    match total_args {
+    let fn_ptr = func_val.data as usize;
+    match args.len() {
         0 => std::mem::transmute::<usize, MdhFn0>(fn_ptr)(),
-        1 => std::mem::transmute::<usize, MdhFn1>(fn_ptr)(call_args[0]),
-        2 => std::mem::transmute::<usize, MdhFn2>(fn_ptr)(call_args[0], call_args[1]),
-        3 => std::mem::transmute::<usize, MdhFn3>(fn_ptr)(
-            call_args[0],
-            call_args[1],
-            call_args[2],
-        ),
-        4 => std::mem::transmute::<usize, MdhFn4>(fn_ptr)(
-            call_args[0],
-            call_args[1],
-            call_args[2],
-            call_args[3],
-        ),
-        5 => std::mem::transmute::<usize, MdhFn5>(fn_ptr)(
-            call_args[0],
-            call_args[1],
-            call_args[2],
-            call_args[3],
-            call_args[4],
-        ),
-        6 => std::mem::transmute::<usize, MdhFn6>(fn_ptr)(
-            call_args[0],
-            call_args[1],
-            call_args[2],
-            call_args[3],
-            call_args[4],
-            call_args[5],
-        ),
-        _ => __mdh_make_nil(),
+        1 => std::mem::transmute::<usize, MdhFn1>(fn_ptr)(a[0]),
+        2 => std::mem::transmute::<usize, MdhFn2>(fn_ptr)(a[0], a[1]),
+        3 => std::mem::transmute::<usize, MdhFn3>(fn_ptr)(a[0], a[1], a[2]),
+        4 => std::mem::transmute::<usize, MdhFn4>(fn_ptr)(a[0], a[1], a[2], a[3]),
+        5 => std::mem::transmute::<usize, MdhFn5>(fn_ptr)(a[0], a[1], a[2], a[3], a[4]),
+        _ => std::mem::transmute::<usize, MdhFn6>(fn_ptr)(a[0], a[1], a[2], a[3], a[4], a[5]),
     }
 }
 
@@ -237,14 +233,27 @@ unsafe fn tri_snapshot_from_value(value: MdhValue) -> Option<TriObjectSnapshot>
     })
 }
 
+/// Run `f` on the object behind `ptr` with the state locked. `f` must not reach another
+/// tri object (or call back into the program): the lock is not reentrant.
 unsafe fn with_object<F, R>(ptr: *mut MdhNativeObject, f: F) -> Option<R>
 where
     F: FnOnce(usize, &mut TriObject) -> R,
+{
+    with_object_and_transforms(ptr, |obj, _transforms| f(ptr as usize, obj))
+}
+
+unsafe fn with_object_and_transforms<F, R>(ptr: *mut MdhNativeObject, f: F) -> Option<R>
+where
+    F: FnOnce(&mut TriObject, &mut TransformStore) -> R,
 {
     let key = ptr as usize;
     let mut state = tri_state().lock().ok()?;
-    let obj = state.objects.get_mut(&key)?;
-    Some(f(key, obj))
+    let TriState {
+        objects,
+        transforms,
+    } = &mut *state;
+    let obj = objects.get_mut(&key)?;
+    Some(f(obj, transforms))
 }
 
 fn tri_constructor_kind(name: &str) -> Option<&'static str> {
@@ -291,16 +300,49 @@ fn tri_has_transform(kind: &str) -> bool {
 }
 
 unsafe fn tri_make_vec3(kind: &str, x: f64, y: f64, z: f64) -> MdhValue {
+    tri_new_vec3(kind, [x, y, z], None)
+}
+
+/// The position, rotation or scale object of the transform in slot `handle`.
+unsafe fn tri_make_view(handle: u64, part: Part) -> MdhValue {
+    let (kind, initial) = match part {
+        Part::Rotation => ("Euler", [0.0; 3]),
+        Part::Scale => ("Vec3", [1.0; 3]),
+        Part::Position => ("Vec3", [0.0; 3]),
+    };
+    let initial = tri_state()
+        .lock()
+        .ok()
+        .and_then(|state| state.transforms.vector(handle, part))
+        .unwrap_or(initial);
+    tri_new_vec3(kind, initial, Some((handle, part)))
+}
+
+unsafe fn tri_insert_views(fields: &mut HashMap<String, MdhValue>, handle: u64) {
+    for (name, part) in [
+        ("position", Part::Position),
+        ("rotation", Part::Rotation),
+        ("scale", Part::Scale),
+    ] {
+        fields.insert(name.to_string(), tri_make_view(handle, part));
+    }
+}
+
+unsafe fn tri_new_vec3(kind: &str, xyz: [f64; 3], view: Option<(u64, Part)>) -> MdhValue {
     let mut fields = HashMap::new();
     fields.insert("type".to_string(), mdh_make_string_from_rust(kind));
-    fields.insert("x".to_string(), __mdh_make_float(x));
-    fields.insert("y".to_string(), __mdh_make_float(y));
-    fields.insert("z".to_string(), __mdh_make_float(z));
+    // A view reads the store; these only answer for it once its object is disposed.
+    fields.insert("x".to_string(), __mdh_make_float(xyz[0]));
+    fields.insert("y".to_string(), __mdh_make_float(xyz[1]));
+    fields.insert("z".to_string(), __mdh_make_float(xyz[2]));
     let tri = TriObject {
         kind: kind.to_string(),
         fields,
         native_key: 0,
         renderer_handle: None,
+        transform: None,
+        view,
+        generation: tri_next_generation(),
     };
     let native_ptr = new_native_object(MDH_NATIVE_TRI_OBJECT, kind, None);
     let mut tri = tri;
@@ -368,10 +410,16 @@ unsafe fn tri_make_object(kind: &str, args: &[MdhValue]) -> MdhValue {
     let mut fields = HashMap::new();
     fields.insert("type".to_string(), mdh_make_string_from_rust(kind));
 
+    let transform = if tri_has_transform(kind) {
+        let mut state = tri_state().lock().ok();
+        state.as_mut().map(|state| state.transforms.insert())
+    } else {
+        None
+    };
+    if let Some(handle) = transform {
+        tri_insert_views(&mut fields, handle);
+    }
     if tri_has_transform(kind) {
-        fields.insert("position".to_string(), tri_make_vec3("Vec3", 0.0, 0.0, 0.0));
-        fields.insert("rotation".to_string(), tri_make_vec3("Euler", 0.0, 0.0, 0.0));
-        fields.insert("scale".to_string(), tri_make_vec3("Vec3", 1.0, 1.0, 1.0));
         fields.insert("children".to_string(), __mdh_make_list(0));
         fields.insert("parent".to_string(), __mdh_make_nil());
     }
@@ -414,6 +462,9 @@ unsafe fn tri_make_object(kind: &str, args: &[MdhValue]) -> MdhValue {
         fields,
         native_key: 0,
         renderer_handle,
+        transform,
+        view: None,
+        generation: tri_next_generation(),
     };
     let native_ptr = new_native_object(MDH_NATIVE_TRI_OBJECT, kind, None);
     let mut tri = tri;
@@ -428,39 +479,42 @@ unsafe fn tri_make_ctor(kind: &str) -> MdhValue {
     mdh_make_native(native_ptr)
 }
 
-unsafe fn tri_method_add(obj: &mut TriObject, args: &[MdhValue]) {
-    let children = obj.fields.get("children").copied();
-    let list_val = match children {
+unsafe fn tri_method_add(ptr: *mut MdhNativeObject, args: &[MdhValue]) {
+    let list_val = with_object(ptr, |_key, obj| match obj.fields.get("children").copied() {
         Some(val) if val.tag == MDH_TAG_LIST => val,
         _ => {
             let list = __mdh_make_list(0);
             tri_method_set_field(obj, "children", list);
             list
         }
+    });
+    let list_val = match list_val {
+        Some(val) => val,
+        None => return,
     };
-    let parent_val = if obj.native_key != 0 {
-        mdh_make_native(obj.native_key as *mut MdhNativeObject)
-    } else {
-        __mdh_make_nil()
-    };
+    let parent_val = mdh_make_native(ptr);
     for arg in args {
         __mdh_list_push(list_val, *arg);
-        if parent_val.tag != MDH_TAG_NIL && arg.tag == MDH_TAG_NATIVE && arg.data != 0 {
-            let ptr = arg.data as *mut MdhNativeObject;
-            let _ = with_object(ptr, |_key, tri| tri_method_set_field(tri, "parent", parent_val));
+        if arg.tag == MDH_TAG_NATIVE && arg.data != 0 {
+            let child = arg.data as *mut MdhNativeObject;
+            let _ = with_object(child, |_key, tri| {
+                tri_method_set_field(tri, "parent", parent_val)
+            });
         }
     }
 }
 
-unsafe fn tri_method_remove(obj: &mut TriObject, args: &[MdhValue]) {
-    let list_val = match obj.fields.get("children").copied() {
-        Some(val) if val.tag == MDH_TAG_LIST => val,
+unsafe fn tri_method_remove(ptr: *mut MdhNativeObject, args: &[MdhValue]) {
+    let list_val = match with_object(ptr, |_key, obj| obj.fields.get("children").copied()) {
+        Some(Some(val)) if val.tag == MDH_TAG_LIST => val,
         _ => return,
     };
     let list_ptr = list_val.data as *mut MdhList;
     if list_ptr.is_null() {
         return;
     }
+    // Children are compacted in place; a slice view must not see that.
+    __mdh_list_unshare(list_ptr);
     let len = (*list_ptr).length.max(0) as usize;
     let items = (*list_ptr).items;
     if items.is_null() || len == 0 {
@@ -478,8 +532,8 @@ unsafe fn tri_method_remove(obj: &mut TriObject, args: &[MdhValue]) {
         }
         if remove {
             if item.tag == MDH_TAG_NATIVE && item.data != 0 {
-                let ptr = item.data as *mut MdhNativeObject;
-                let _ = with_object(ptr, |_key, tri| {
+                let child = item.data as *mut MdhNativeObject;
+                let _ = with_object(child, |_key, tri| {
                     tri_method_set_field(tri, "parent", __mdh_make_nil())
                 });
             }
@@ -491,23 +545,40 @@ unsafe fn tri_method_remove(obj: &mut TriObject, args: &[MdhValue]) {
     (*list_ptr).length = write as i64;
 }
 
-unsafe fn tri_method_clone(obj: &TriObject) -> MdhValue {
-    let mut fields = HashMap::new();
-    for (k, v) in &obj.fields {
-        fields.insert(k.clone(), *v);
+unsafe fn tri_method_clone(ptr: *mut MdhNativeObject) -> Option<MdhValue> {
+    let (kind, mut fields, renderer_handle, transform) = with_object(ptr, |_key, obj| {
+        (
+            obj.kind.clone(),
+            obj.fields.clone(),
+            obj.renderer_handle,
+            obj.transform,
+        )
+    })?;
+    // The clone starts from a copy of the transform, not from the original's vectors.
+    let transform = transform.and_then(|handle| {
+        tri_state()
+            .lock()
+            .ok()
+            .and_then(|mut state| state.transforms.duplicate(handle))
+    });
+    if let Some(handle) = transform {
+        tri_insert_views(&mut fields, handle);
     }
     let clone = TriObject {
-        kind: obj.kind.clone(),
+        kind: kind.clone(),
         fields,
         native_key: 0,
-        renderer_handle: obj.renderer_handle,
+        renderer_handle,
+        transform,
+        view: None,
+        generation: tri_next_generation(),
     };
-    let native_ptr = new_native_object(MDH_NATIVE_TRI_OBJECT, &obj.kind, None);
+    let native_ptr = new_native_object(MDH_NATIVE_TRI_OBJECT, &kind, None);
     let mut clone = clone;
     clone.native_key = native_ptr as usize;
     tri_sync_fields(&clone);
     register_object(native_ptr, clone);
-    mdh_make_native(native_ptr)
+    Some(mdh_make_native(native_ptr))
 }
 
 unsafe fn tri_sync_fields(obj: &TriObject) {
@@ -526,6 +597,10 @@ unsafe fn tri_sync_fields(obj: &TriObject) {
 
 unsafe fn tri_method_set_field(obj: &mut TriObject, key: &str, value: MdhValue) {
     obj.fields.insert(key.to_string(), value);
+    obj.generation = tri_next_generation();
+    if obj.kind.ends_with("Geometrie") {
+        TRI_GEOMETRY_EPOCH.fetch_add(1, Ordering::Relaxed);
+    }
     if obj.native_key != 0 {
         let native_ptr = obj.native_key as *mut MdhNativeObject;
         let dict = (*native_ptr).fields;
@@ -534,6 +609,63 @@ unsafe fn tri_method_set_field(obj: &mut TriObject, key: &str, value: MdhValue)
     }
 }
 
+/// A field of `obj`; the x/y/z of a transform view come from the store.
+unsafe fn tri_field_get(
+    obj: &TriObject,
+    transforms: &TransformStore,
+    key: &str,
+) -> Option<MdhValue> {
+    if let (Some((handle, part)), Some(axis)) = (obj.view, axis(key)) {
+        if let Some(value) = transforms.get(handle, part, axis) {
+            return Some(__mdh_make_float(value));
+        }
+    }
+    obj.fields.get(key).copied()
+}
+
+/// Store a field, or report why it cannot be stored. View components and whole
+/// position/rotation/scale vectors go to the store (the object keeps its own views, so
+/// assigning a vector copies it) and are not mirrored into the native dict.
+unsafe fn tri_field_set(
+    obj: &mut TriObject,
+    transforms: &mut TransformStore,
+    key: &str,
+    value: MdhValue,
+    vector: Option<[f64; 3]>,
+) -> Result<(), String> {
+    if let (Some((handle, part)), Some(axis)) = (obj.view, axis(key)) {
+        let number = mdh_number(value)
+            .ok_or_else(|| format!("Cannae set {} of a tri vector tae a non-number", key))?;
+        if transforms.set(handle, part, axis, number) {
+            return Ok(());
+        }
+    }
+    if let (Some(handle), Some(part)) = (obj.transform, Part::from_field(key)) {
+        let vector = vector
+            .ok_or_else(|| format!("Cannae set {} tae somethin that's no a tri vector", key))?;
+        transforms.set_vector(handle, part, vector);
+        return Ok(());
+    }
+    tri_method_set_field(obj, key, value);
+    Ok(())
+}
+
+/// The x/y/z of a tri vector: a transform view or a free-standing one like lookAtTarget.
+unsafe fn tri_vec3_components(value: MdhValue) -> Option<[f64; 3]> {
+    if value.tag != MDH_TAG_NATIVE || value.data == 0 {
+        return None;
+    }
+    let state = tri_state().lock().ok()?;
+    let obj = state.objects.get(&(value.data as usize))?;
+    if let Some((handle, part)) = obj.view {
+        if let Some(vector) = state.transforms.vector(handle, part) {
+            return Some(vector);
+        }
+    }
+    let component = |name: &str| obj.fields.get(name).and_then(|v| mdh_number(*v));
+    Some([component("x")?, component("y")?, component("z")?])
+}
+
 unsafe fn mdh_number(value: MdhValue) -> Option<f64> {
     match value.tag {
         MDH_TAG_INT => Some(value.data as f64),
@@ -588,55 +720,24 @@ unsafe fn tri_renderar_opts(
 }
 
 unsafe fn tri_vec3_from_value(value: MdhValue, default: Vec3) -> Vec3 {
-    let snapshot = match tri_snapshot_from_value(value) {
-        Some(snapshot) => snapshot,
-        None => return default,
-    };
-    let x = snapshot
-        .fields
-        .get("x")
-        .and_then(|v| mdh_number(*v))
-        .unwrap_or(default.x as f64) as f32;
-    let y = snapshot
-        .fields
-        .get("y")
-        .and_then(|v| mdh_number(*v))
-        .unwrap_or(default.y as f64) as f32;
-    let z = snapshot
-        .fields
-        .get("z")
-        .and_then(|v| mdh_number(*v))
-        .unwrap_or(default.z as f64) as f32;
-    Vec3::new(x, y, z)
+    match tri_vec3_components(value) {
+        Some([x, y, z]) => Vec3::new(x as f32, y as f32, z as f32),
+        None => default,
+    }
 }
 
-unsafe fn tri_model_matrix(snapshot: &TriObjectSnapshot) -> Mat4 {
-    let position = snapshot
-        .fields
-        .get("position")
-        .map(|v| tri_vec3_from_value(*v, Vec3::ZERO))
-        .unwrap_or(Vec3::ZERO);
-    let rotation = snapshot
-        .fields
-        .get("rotation")
-        .map(|v| tri_vec3_from_value(*v, Vec3::ZERO))
-        .unwrap_or(Vec3::ZERO);
-    let scale = snapshot
-        .fields
-        .get("scale")
-        .map(|v| tri_vec3_from_value(*v, Vec3::ONE))
-        .unwrap_or(Vec3::ONE);
-    let quat = Quat::from_euler(EulerRot::XYZ, rotation.x, rotation.y, rotation.z);
-    Mat4::from_scale_rotation_translation(scale, quat, position)
+/// The engine cache key and current generation of a native geometry.
+unsafe fn tri_geometry_stamp(value: MdhValue) -> Option<(usize, u64)> {
+    if value.tag != MDH_TAG_NATIVE || value.data == 0 {
+        return None;
+    }
+    let key = value.data as usize;
+    let state = tri_state().lock().ok()?;
+    Some((key, state.objects.get(&key)?.generation))
 }
 
-unsafe fn tri_mesh_from_geometry(value: MdhValue) -> Option<(MeshData, Option<usize>)> {
+unsafe fn tri_mesh_from_geometry(value: MdhValue) -> Option<MeshData> {
     let snapshot = tri_snapshot_from_value(value)?;
-    let mesh_key = if value.tag == MDH_TAG_NATIVE && value.data != 0 {
-        Some(value.data as usize)
-    } else {
-        None
-    };
     match snapshot.kind.as_str() {
         "BoxGeometrie" => {
             let width = snapshot
@@ -733,14 +834,11 @@ unsafe fn tri_mesh_from_geometry(value: MdhValue) -> Option<(MeshData, Option<us
                     base + 3,
                 ]);
             }
-            Some((
-                MeshData {
-                    vertices,
-                    normals,
-                    indices,
-                },
-                mesh_key,
-            ))
+            Some(MeshData {
+                vertices,
+                normals,
+                indices,
+            })
         }
         "SpherGeometrie" => {
             let radius = snapshot
@@ -799,14 +897,11 @@ unsafe fn tri_mesh_from_geometry(value: MdhValue) -> Option<(MeshData, Option<us
                 }
             }
 
-            Some((
-                MeshData {
-                    vertices,
-                    normals,
-                    indices,
-                },
-                mesh_key,
-            ))
+            Some(MeshData {
+                vertices,
+                normals,
+                indices,
+            })
         }
         _ => None,
     }
@@ -962,16 +1057,55 @@ unsafe fn tri_light_info(scene_val: Option<MdhValue>) -> LightInfo {
     info
 }
 
+/// Whether `value` is a light, its local matrix and its children, read under one lock; only
+/// lights are snapshotted, so the light walk costs the scene's objects no field copies.
+unsafe fn tri_light_node(value: MdhValue) -> Option<(bool, Option<Mat4>, Option<MdhValue>)> {
+    if value.tag != MDH_TAG_NATIVE || value.data == 0 {
+        return None;
+    }
+    let mut state = tri_state().lock().ok()?;
+    let TriState {
+        objects,
+        transforms,
+    } = &mut *state;
+    let obj = objects.get(&(value.data as usize))?;
+    Some((
+        obj.kind.ends_with("Licht"),
+        obj.transform
+            .and_then(|handle| transforms.local_matrix(handle)),
+        obj.fields
+            .get("children")
+            .copied()
+            .filter(|v| v.tag == MDH_TAG_LIST),
+    ))
+}
+
 unsafe fn tri_collect_lights(value: MdhValue, parent: Mat4, info: &mut LightInfo) {
-    let snapshot = match tri_snapshot_from_value(value) {
-        Some(snapshot) => snapshot,
+    let (light, local, children) = match tri_light_node(value) {
+        Some(node) => node,
         None => return,
     };
     let mut world = parent;
-    if tri_has_transform(&snapshot.kind) {
-        world = parent * tri_model_matrix(&snapshot);
+    if let Some(local) = local {
+        world = parent * local;
+    }
+    if light {
+        tri_collect_light(value, world, info);
     }
+    if let Some(children_val) = children {
+        let len = __mdh_list_len(children_val).max(0) as i64;
+        for i in 0..len {
+            let child = __mdh_list_get(children_val, i);
+            tri_collect_lights(child, world, info);
+        }
+    }
+}
 
+unsafe fn tri_collect_light(value: MdhValue, world: Mat4, info: &mut LightInfo) {
+    let snapshot = match tri_snapshot_from_value(value) {
+        Some(snapshot) => snapshot,
+        None => return,
+    };
     match snapshot.kind.as_str() {
         "AmbiantLicht" => {
             let color = snapshot
@@ -1004,13 +1138,8 @@ unsafe fn tri_collect_lights(value: MdhValue, parent: Mat4, info: &mut LightInfo
                 let target = snapshot
                     .fields
                     .get("lookAtTarget")
-                    .and_then(|v| tri_snapshot_from_value(*v))
-                    .and_then(|snap| {
-                        let x = snap.fields.get("x").and_then(|v| mdh_number(*v))? as f32;
-                        let y = snap.fields.get("y").and_then(|v| mdh_number(*v))? as f32;
-                        let z = snap.fields.get("z").and_then(|v| mdh_number(*v))? as f32;
-                        Some(Vec3::new(x, y, z))
-                    });
+                    .and_then(|v| tri_vec3_components(*v))
+                    .map(|[x, y, z]| Vec3::new(x as f32, y as f32, z as f32));
                 let dir = if let Some(target) = target {
                     (target - position).normalize_or_zero()
                 } else if position.length_squared() > 1e-6 {
@@ -1054,16 +1183,6 @@ unsafe fn tri_collect_lights(value: MdhValue, parent: Mat4, info: &mut LightInfo
         }
         _ => {}
     }
-
-    if let Some(children_val) = snapshot.fields.get("children") {
-        if children_val.tag == MDH_TAG_LIST {
-            let len = __mdh_list_len(*children_val).max(0) as i64;
-            for i in 0..len {
-                let child = __mdh_list_get(*children_val, i);
-                tri_collect_lights(child, world, info);
-            }
-        }
-    }
 }
 
 unsafe fn tri_camera_view_proj(camera_val: Option<MdhValue>, fallback_aspect: f32) -> Mat4 {
@@ -1084,13 +1203,8 @@ unsafe fn tri_camera_view_proj(camera_val: Option<MdhValue>, fallback_aspect: f3
     let look_target = snapshot
         .fields
         .get("lookAtTarget")
-        .and_then(|v| tri_snapshot_from_value(*v))
-        .and_then(|snap| {
-            let x = snap.fields.get("x").and_then(|v| mdh_number(*v))? as f32;
-            let y = snap.fields.get("y").and_then(|v| mdh_number(*v))? as f32;
-            let z = snap.fields.get("z").and_then(|v| mdh_number(*v))? as f32;
-            Some(Vec3::new(x, y, z))
-        });
+        .and_then(|v| tri_vec3_components(*v))
+        .map(|[x, y, z]| Vec3::new(x as f32, y as f32, z as f32));
 
     let view = if let Some(target) = look_target {
         Mat4::look_at_rh(position, target, Vec3::Y)
@@ -1164,39 +1278,132 @@ unsafe fn tri_camera_view_proj(camera_val: Option<MdhValue>, fallback_aspect: f3
     proj * view
 }
 
+/// What the mesh walk needs from one object, read under one lock without copying its
+/// fields: the walk visits every object in the scene each frame.
+struct TriNode {
+    mesh: bool,
+    transform: Option<u64>,
+    local: Option<Mat4>,
+    geometry: MdhValue,
+    material: MdhValue,
+    children: Option<MdhValue>,
+    // The geometry's sphere in the mesh's own space (empty for anything else).
+    geometry_bounds: Sphere,
+    shape: Shape,
+    // The subtree sphere cached for `shape`, in the parent's space.
+    cached: Option<Sphere>,
+}
+
+/// The sphere around a geometry's mesh, centred on its origin like the mesh itself.
+unsafe fn tri_geometry_bounds(geometry: &TriObject) -> Sphere {
+    let number = |key: &str, default: f64| {
+        geometry
+            .fields
+            .get(key)
+            .and_then(|v| mdh_number(*v))
+            .unwrap_or(default) as f32
+    };
+    let radius = match geometry.kind.as_str() {
+        "BoxGeometrie" => {
+            let width = number("width", 1.0);
+            let height = number("height", 1.0);
+            let depth = number("depth", 1.0);
+            0.5 * (width * width + height * height + depth * depth).sqrt()
+        }
+        "SpherGeometrie" => number("radius", 1.0).abs(),
+        _ => return Sphere::EMPTY,
+    };
+    Sphere {
+        center: Vec3::ZERO,
+        radius,
+    }
+}
+
+/// Decode `value` for the mesh walk, noting `parent` as the slot it was reached from.
+unsafe fn tri_node_from_value(value: MdhValue, parent: Option<u64>) -> Option<TriNode> {
+    if value.tag != MDH_TAG_NATIVE || value.data == 0 {
+        return None;
+    }
+    let mut state = tri_state().lock().ok()?;
+    let TriState {
+        objects,
+        transforms,
+    } = &mut *state;
+    let obj = objects.get(&(value.data as usize))?;
+    let field = |key: &str| obj.fields.get(key).copied();
+    let mesh = obj.kind == "Mesch";
+    let geometry = field("geometry").unwrap_or_else(|| __mdh_make_nil());
+    let children = field("children").filter(|v| v.tag == MDH_TAG_LIST);
+    let geometry_bounds = match objects.get(&(geometry.data as usize)) {
+        Some(geometry_obj) if mesh && geometry.tag == MDH_TAG_NATIVE => {
+            tri_geometry_bounds(geometry_obj)
+        }
+        _ => Sphere::EMPTY,
+    };
+    let shape = [
+        children.map_or(0, |list| list.data as u64),
+        children.map_or(0, |list| __mdh_list_len(list) as u64),
+        if mesh { geometry.data as u64 } else { 0 },
+        TRI_GEOMETRY_EPOCH.load(Ordering::Relaxed),
+    ];
+    let cached = obj.transform.and_then(|handle| {
+        transforms.set_parent(handle, parent);
+        transforms.bounds(handle, shape)
+    });
+    Some(TriNode {
+        mesh,
+        transform: obj.transform,
+        local: obj
+            .transform
+            .and_then(|handle| transforms.local_matrix(handle)),
+        geometry,
+        material: field("material").unwrap_or_else(|| __mdh_make_nil()),
+        children,
+        geometry_bounds,
+        shape,
+        cached,
+    })
+}
+
+/// Walk `value` into `items`, skipping everything outside `frustum`. Returns the sphere
+/// around the subtree in the parent's space, which is cached on the object's slot for
+/// later frames.
 unsafe fn tri_collect_meshes(
     value: MdhValue,
     parent: Mat4,
+    parent_slot: Option<u64>,
     lights: &LightInfo,
+    frustum: &Frustum,
     items: &mut Vec<RenderItem>,
-) {
-    let snapshot = match tri_snapshot_from_value(value) {
-        Some(snapshot) => snapshot,
-        None => return,
+) -> Sphere {
+    let node = match tri_node_from_value(value, parent_slot) {
+        Some(node) => node,
+        None => return Sphere::EMPTY,
     };
+    if let Some(bounds) = node.cached {
+        if !frustum.intersects(&bounds.transformed(&parent)) {
+            return bounds;
+        }
+    }
     let mut world = parent;
-    if tri_has_transform(&snapshot.kind) {
-        world = parent * tri_model_matrix(&snapshot);
+    if let Some(local) = node.local {
+        world = parent * local;
     }
+    let mut bounds = node.geometry_bounds;
 
-    if snapshot.kind == "Mesch" {
-        let geom_val = snapshot
-            .fields
-            .get("geometry")
-            .copied()
-        .unwrap_or_else(|| __mdh_make_nil());
-        if let Some((mesh, mesh_key)) = tri_mesh_from_geometry(geom_val) {
-            let object_key = if value.tag == MDH_TAG_NATIVE && value.data != 0 {
-                Some(value.data as usize)
-            } else {
-                None
-            };
-            let mat_val = snapshot
-                .fields
-                .get("material")
-                .copied()
-                .unwrap_or_else(|| __mdh_make_nil());
-            let (color, unlit, metalness, roughness) = tri_material_info(mat_val);
+    if node.mesh && frustum.intersects(&node.geometry_bounds.transformed(&world)) {
+        // A geometry the engine already holds at this generation is not rebuilt at all.
+        let stamp = tri_geometry_stamp(node.geometry);
+        let uploaded = stamp.is_some_and(|(key, generation)| {
+            with_engine(|engine| engine.has_mesh(key, generation))
+        });
+        let mesh = if uploaded {
+            Some(None)
+        } else {
+            tri_mesh_from_geometry(node.geometry).map(Some)
+        };
+        if let Some(mesh) = mesh {
+            let (color, unlit, metalness, roughness) = tri_material_info(node.material);
             let ambient = if unlit {
                 Vec3::ONE
             } else if lights.ambient.length_squared() < 1e-6 {
@@ -1226,8 +1433,8 @@ unsafe fn tri_collect_meshes(
             };
             items.push(RenderItem {
                 mesh,
-                mesh_key,
-                object_key,
+                mesh_key: stamp.map(|(key, _)| key),
+                mesh_generation: stamp.map_or(0, |(_, generation)| generation),
                 model: world,
                 color,
                 ambient: [ambient.x, ambient.y, ambient.z, 1.0],
@@ -1241,15 +1448,25 @@ unsafe fn tri_collect_meshes(
         }
     }
 
-    if let Some(children_val) = snapshot.fields.get("children") {
-        if children_val.tag == MDH_TAG_LIST {
-            let len = __mdh_list_len(*children_val).max(0) as i64;
-            for i in 0..len {
-                let child = __mdh_list_get(*children_val, i);
-                tri_collect_meshes(child, world, lights, items);
-            }
+    if let Some(children_val) = node.children {
+        let len = __mdh_list_len(children_val).max(0) as i64;
+        let slot = node.transform.or(parent_slot);
+        for i in 0..len {
+            let child = __mdh_list_get(children_val, i);
+            let child_bounds = tri_collect_meshes(child, world, slot, lights, frustum, items);
+            bounds = bounds.union(&child_bounds);
+        }
+    }
+
+    if let Some(local) = node.local {
+        bounds = bounds.transformed(&local);
+    }
+    if let Some(handle) = node.transform {
+        if let Ok(mut state) = tri_state().lock() {
+            state.transforms.set_bounds(handle, bounds, node.shape);
         }
     }
+    bounds
 }
 
 unsafe fn tri_render_items(
@@ -1259,10 +1476,11 @@ unsafe fn tri_render_items(
 ) -> (Mat4, Vec<RenderItem>) {
     let mut items = Vec::new();
     let lights = tri_light_info(scene_val);
+    let view_proj = tri_camera_view_proj(camera_val, aspect);
+    let frustum = Frustum::from_view_proj(view_proj);
     if let Some(scene) = scene_val {
-        tri_collect_meshes(scene, Mat4::IDENTITY, &lights, &mut items);
+        tri_collect_meshes(scene, Mat4::IDENTITY, None, &lights, &frustum, &mut items);
     }
-    let view_proj = tri_camera_view_proj(camera_val, aspect);
     if items.is_empty() {
         tri_debug_once(&TRI_DEBUG_EMPTY_MESH_LOGGED, format!(
             "tri: no meshes collected (aspect={aspect:.3})"
@@ -1318,6 +1536,9 @@ unsafe fn tri_dispose(ptr: *mut MdhNativeObject) -> MdhValue {
             Err(_) => return __mdh_make_nil(),
         };
         if let Some(obj) = state.objects.remove(&key) {
+            if let Some(handle) = obj.transform {
+                state.transforms.remove(handle);
+            }
             (obj.kind, obj.renderer_handle)
         } else {
             return __mdh_make_nil();
@@ -1333,134 +1554,132 @@ unsafe fn tri_dispose(ptr: *mut MdhNativeObject) -> MdhValue {
         "Geometrie" | "BoxGeometrie" | "SpherGeometrie" => {
             with_engine(|engine| engine.remove_mesh(key));
         }
-        "Mesch" => {
-            with_engine(|engine| engine.remove_uniform(key));
-        }
         _ => {}
     }
 
     __mdh_make_nil()
 }
 
-unsafe fn tri_object_call(obj: &mut TriObject, method: &str, args: &[MdhValue]) -> MdhValue {
+/// What a render needs from its Renderar, read before the lock is released: collecting the
+/// scene locks each object in it.
+struct TriFrame {
+    handle: usize,
+    scene: Option<MdhValue>,
+    camera: Option<MdhValue>,
+    aspect: f32,
+    wireframe: bool,
+}
+
+unsafe fn tri_renderar_frame(renderar: &TriObject) -> Option<TriFrame> {
+    Some(TriFrame {
+        handle: renderar.renderer_handle?,
+        scene: renderar.fields.get("scene").copied(),
+        camera: renderar.fields.get("camera").copied(),
+        aspect: tri_renderar_aspect(renderar),
+        wireframe: renderar
+            .fields
+            .get("wireframe")
+            .and_then(|v| mdh_bool(*v))
+            .unwrap_or(false),
+    })
+}
+
+unsafe fn tri_render_frame(frame: TriFrame) {
+    let (view_proj, items) = tri_render_items(frame.scene, frame.camera, frame.aspect);
+    if let Err(msg) =
+        with_engine(|engine| engine.render_scene(frame.handle, view_proj, items, frame.wireframe))
+    {
+        __mdh_hurl(mdh_make_string_from_rust(&format!("Render failed: {msg}")));
+    }
+}
+
+/// Call `method` on the object behind `ptr`; None if there is no such object. The state is
+/// only locked around each field read or write, never across work that reaches other tri
+/// objects or calls back into the program (adding children, rendering, the loop callback).
+unsafe fn tri_object_call(
+    ptr: *mut MdhNativeObject,
+    method: &str,
+    args: &[MdhValue],
+) -> Option<MdhValue> {
+    let renderar = with_object(ptr, |_key, obj| obj.kind == "Renderar")?;
     if tri_debug_enabled()
-        && obj.kind == "Renderar"
+        && renderar
         && !TRI_DEBUG_RENDERAR_CALL_LOGGED.swap(true, Ordering::Relaxed)
     {
         eprintln!("tri: renderar method='{method}' argc={}", args.len());
     }
+    let set_field = |key: &str, value: MdhValue| {
+        with_object(ptr, |_key, obj| tri_method_set_field(obj, key, value))
+    };
     match method {
-        "cloan" | "clone" => tri_method_clone(obj),
-        "adde" | "add" => {
-            tri_method_add(obj, args);
-            __mdh_make_nil()
-        }
-        "remuiv" | "remove" => {
-            tri_method_remove(obj, args);
-            __mdh_make_nil()
-        }
-        "dyspos" | "dispose" => __mdh_make_nil(),
+        "cloan" | "clone" => return tri_method_clone(ptr),
+        "adde" | "add" => tri_method_add(ptr, args),
+        "remuiv" | "remove" => tri_method_remove(ptr, args),
+        "dyspos" | "dispose" => {}
         "luik_at" | "lookAt" => {
-            if args.len() >= 3 {
-                if let (Some(x), Some(y), Some(z)) = (
-                    mdh_number(args[0]),
-                    mdh_number(args[1]),
-                    mdh_number(args[2]),
-                ) {
-                    let target = tri_make_vec3("Vec3", x, y, z);
-                    tri_method_set_field(obj, "lookAtTarget", target);
-                    return __mdh_make_nil();
-                }
-            }
-            if let Some(target) = args.first() {
-                tri_method_set_field(obj, "lookAtTarget", *target);
+            let target = match args {
+                [x, y, z, ..] => match (mdh_number(*x), mdh_number(*y), mdh_number(*z)) {
+                    (Some(x), Some(y), Some(z)) => Some(tri_make_vec3("Vec3", x, y, z)),
+                    _ => Some(*x),
+                },
+                _ => args.first().copied(),
+            };
+            if let Some(target) = target {
+                set_field("lookAtTarget", target);
             }
-            __mdh_make_nil()
         }
         "set_sise" | "setSize" => {
             if let Some(width) = args.first() {
-                tri_method_set_field(obj, "width", *width);
+                set_field("width", *width);
             }
             if let Some(height) = args.get(1) {
-                tri_method_set_field(obj, "height", *height);
+                set_field("height", *height);
             }
-            if let Some(handle) = obj.renderer_handle {
-                if let (Some(w), Some(h)) = (args.first(), args.get(1)) {
-                    if let (Some(wv), Some(hv)) = (mdh_number(*w), mdh_number(*h)) {
-                        with_engine(|engine| engine.set_size(handle, wv as u32, hv as u32));
-                    }
+            let renderer = with_object(ptr, |_key, obj| obj.renderer_handle).flatten();
+            if let (Some(handle), [w, h, ..]) = (renderer, args) {
+                if let (Some(wv), Some(hv)) = (mdh_number(*w), mdh_number(*h)) {
+                    with_engine(|engine| engine.set_size(handle, wv as u32, hv as u32));
                 }
             }
-            __mdh_make_nil()
         }
         "set_pixel_ratio" | "setPixelRatio" => {
             if let Some(ratio) = args.first() {
-                tri_method_set_field(obj, "pixelRatio", *ratio);
+                set_field("pixelRatio", *ratio);
             }
-            if let Some(handle) = obj.renderer_handle {
+            let renderer = with_object(ptr, |_key, obj| obj.renderer_handle).flatten();
+            if let Some(handle) = renderer {
                 if let Some(ratio) = args.first().and_then(|v| mdh_number(*v)) {
                     with_engine(|engine| engine.set_pixel_ratio(handle, ratio as f32));
                 }
             }
-            __mdh_make_nil()
         }
         "render" => {
             tri_debug_once(&TRI_DEBUG_RENDER_CALLED, "tri: render called");
-            if let Some(scene) = args.first() {
-                tri_method_set_field(obj, "scene", *scene);
-            }
-            if let Some(camera) = args.get(1) {
-                tri_method_set_field(obj, "camera", *camera);
-            }
-            if let Some(handle) = obj.renderer_handle {
-                let aspect = tri_renderar_aspect(obj);
-                let scene_val = args
-                    .first()
-                    .copied()
-                    .or_else(|| obj.fields.get("scene").copied());
-                let camera_val = args
-                    .get(1)
-                    .copied()
-                    .or_else(|| obj.fields.get("camera").copied());
-                let wireframe = obj
-                    .fields
-                    .get("wireframe")
-                    .and_then(|v| mdh_bool(*v))
-                    .unwrap_or(false);
-                let (view_proj, items) = tri_render_items(scene_val, camera_val, aspect);
-                if let Err(msg) =
-                    with_engine(|engine| engine.render_scene(handle, view_proj, items, wireframe))
-                {
-                    __mdh_hurl(mdh_make_string_from_rust(&format!("Render failed: {msg}")));
+            let frame = with_object(ptr, |_key, obj| {
+                if let Some(scene) = args.first() {
+                    tri_method_set_field(obj, "scene", *scene);
+                }
+                if let Some(camera) = args.get(1) {
+                    tri_method_set_field(obj, "camera", *camera);
                 }
+                tri_renderar_frame(obj)
+            });
+            if let Some(frame) = frame.flatten() {
+                tri_render_frame(frame);
             }
-            __mdh_make_nil()
         }
         "tick" | "poll" => {
             tri_debug_once(&TRI_DEBUG_RENDER_CALLED, "tri: render tick called");
-            if let Some(handle) = obj.renderer_handle {
-                let scene_val = obj.fields.get("scene").copied();
-                let camera_val = obj.fields.get("camera").copied();
-                let aspect = tri_renderar_aspect(obj);
-                let wireframe = obj
-                    .fields
-                    .get("wireframe")
-                    .and_then(|v| mdh_bool(*v))
-                    .unwrap_or(false);
-                let (view_proj, items) = tri_render_items(scene_val, camera_val, aspect);
-                if let Err(msg) =
-                    with_engine(|engine| engine.render_scene(handle, view_proj, items, wireframe))
-                {
-                    __mdh_hurl(mdh_make_string_from_rust(&format!("Render failed: {msg}")));
-                }
+            if let Some(frame) = with_object(ptr, |_key, obj| tri_renderar_frame(obj)).flatten() {
+                tri_render_frame(frame);
             }
-            __mdh_make_nil()
         }
         "loop" => {
             if let Some(callback) = args.first() {
-                tri_method_set_field(obj, "loopFn", *callback);
+                set_field("loopFn", *callback);
             }
-            if let Some(handle) = obj.renderer_handle {
+            let renderer = with_object(ptr, |_key, obj| obj.renderer_handle).flatten();
+            if let Some(handle) = renderer {
                 let callback = args.first().copied();
                 let loop_cb: Option<LoopCallback> = callback.map(|cb| {
                     let cb: LoopCallback = Box::new(move |dt| unsafe {
@@ -1469,16 +1688,16 @@ unsafe fn tri_object_call(obj: &mut TriObject, method: &str, args: &[MdhValue])
                     });
                     cb
                 });
-                if let Err(msg) = with_engine(|engine| engine.run_loop(handle, loop_cb)) {
+                if let Err(msg) = run_loop(handle, loop_cb) {
                     __mdh_hurl(mdh_make_string_from_rust(&format!(
                         "Render loop failed: {msg}"
                     )));
                 }
             }
-            __mdh_make_nil()
         }
-        _ => __mdh_make_nil(),
+        _ => {}
     }
+    Some(__mdh_make_nil())
 }
 
 unsafe fn tri_key_not_found(name: &str) -> MdhValue {
@@ -1515,16 +1734,29 @@ pub unsafe extern "C" fn __mdh_tri_rs_module() -> MdhValue {
     })
 }
 
+/// The method or field name in `value`, borrowed when it is already a string (the names
+/// codegen passes always are), so a per-frame call or field access copies nothing.
+unsafe fn selector_name<'a>(value: MdhValue) -> Cow<'a, str> {
+    if value.tag == MDH_TAG_STRING && value.data != 0 {
+        if let Ok(name) = CStr::from_ptr(value.data as *const c_char).to_str() {
+            return Cow::Borrowed(name);
+        }
+    }
+    Cow::Owned(mdh_value_to_string(value))
+}
+
 #[no_mangle]
 pub unsafe extern "C" fn __mdh_tri_rs_get(obj: *mut MdhNativeObject, key: MdhValue) -> MdhValue {
     if obj.is_null() {
         return __mdh_make_nil();
     }
-    let prop = mdh_value_to_string(key);
+    let prop = selector_name(key);
     match (*obj).kind {
         MDH_NATIVE_TRI_MODULE => tri_module_get(&prop),
         MDH_NATIVE_TRI_OBJECT => {
-            let value = with_object(obj, |_key, tri| tri.fields.get(&prop).copied());
+            let value = with_object_and_transforms(obj, |tri, transforms| {
+                tri_field_get(tri, transforms, &prop)
+            });
             match value {
                 Some(Some(v)) => v,
                 _ => tri_key_not_found(&prop),
@@ -1544,10 +1776,18 @@ pub unsafe extern "C" fn __mdh_tri_rs_set(
     if obj.is_null() {
         return __mdh_make_nil();
     }
-    let prop = mdh_value_to_string(key);
+    let prop = selector_name(key);
     match (*obj).kind {
         MDH_NATIVE_TRI_OBJECT => {
-            let _ = with_object(obj, |_key, tri| tri_method_set_field(tri, &prop, value));
+            // Read outside the lock: the vector being assigned is another tri object.
+            let vector = Part::from_field(&prop).and_then(|_| tri_vec3_components(value));
+            let stored = with_object_and_transforms(obj, |tri, transforms| {
+                tri_field_set(tri, transforms, &prop, value, vector)
+            });
+            if let Some(Err(msg)) = stored {
+                __mdh_hurl(mdh_make_string_from_rust(&msg));
+                return __mdh_make_nil();
+            }
             value
         }
         MDH_NATIVE_TRI_MODULE | MDH_NATIVE_TRI_CTOR => {
@@ -1568,7 +1808,7 @@ pub unsafe extern "C" fn __mdh_tri_rs_call(
     if obj.is_null() {
         return __mdh_make_nil();
     }
-    let name = mdh_value_to_string(method);
+    let name = selector_name(method);
     if tri_debug_enabled() && !TRI_DEBUG_CALL_LOGGED.swap(true, Ordering::Relaxed) {
         eprintln!(
             "tri: native call kind={} method='{}' argc={}",
@@ -1577,18 +1817,18 @@ pub unsafe extern "C" fn __mdh_tri_rs_call(
             argc.max(0)
         );
     }
-    let args = if argc <= 0 || argv.is_null() {
-        Vec::new()
+    let args: &[MdhValue] = if argc <= 0 || argv.is_null() {
+        &[]
     } else {
-        std::slice::from_raw_parts(argv, argc as usize).to_vec()
+        std::slice::from_raw_parts(argv, argc as usize)
     };
 
     match (*obj).kind {
-        MDH_NATIVE_TRI_MODULE => tri_module_call(&name, &args),
+        MDH_NATIVE_TRI_MODULE => tri_module_call(&name, args),
         MDH_NATIVE_TRI_CTOR => {
             let ctor_kind = native_ctor_kind(obj);
             if name.is_empty() || name == "call" || name == ctor_kind {
-                tri_make_object(&ctor_kind, &args)
+                tri_make_object(&ctor_kind, args)
             } else {
                 tri_key_not_found(&name)
             }
@@ -1597,10 +1837,7 @@ pub unsafe extern "C" fn __mdh_tri_rs_call(
             if name == "dyspos" || name == "dispose" {
                 return tri_dispose(obj);
             }
-            let mut result = None;
-            let _ = with_object(obj, |_key, tri| {
-                result = Some(tri_object_call(tri, &name, &args));
-            });
+            let result = tri_object_call(obj, &name, args);
             if result.is_none() && tri_debug_enabled() {
                 eprintln!(
                     "tri: native call missing object kind={} method='{}'",
@@ -1628,4 +1865,5 @@ extern "C" {
     fn __mdh_hurl(value: MdhValue);
     fn __mdh_key_not_found(key: MdhValue);
     fn __mdh_eq(a: MdhValue, b: MdhValue) -> bool;
+    fn __mdh_list_unshare(list: *mut MdhList);
 }
@@ -0,0 +1,315 @@
+//! Struct-of-arrays transform storage behind tri scene objects.
+//!
+//! Every object with a transform (scenes, clumps, meshes, cameras, lights) owns a slot
+//! here. Position, rotation and scale are nine parallel columns, and the `position`,
+//! `rotation` and `scale` objects a program sees are views onto a slot rather than objects
+//! with fields of their own, so `mesch.rotation.y = a` is one store write. A write marks
+//! the slot dirty and the local matrix is rebuilt the next time the renderer asks for it:
+//! a frame only pays for the objects that moved. Handles are `(generation << 32) |
+//! (slot + 1)` as in handles.rs; freeing a slot bumps its generation, so a view of a
+//! disposed object stops resolving instead of reaching the slot's next owner.
+//!
+//! The scene graph doubles as the bounding-volume hierarchy for frustum culling. Each slot
+//! caches a bounding sphere of its whole subtree in its parent's space, and the mesh walk
+//! skips a subtree whose sphere lies outside the camera frustum. Transform writes clear the
+//! cached sphere of the slot and of each ancestor the walk last saw above it, so only the
+//! path to an object that moved is rebuilt; siblings keep theirs. A cached sphere also
+//! records the shape it was built from (see `Shape`) and is ignored once that differs.
+
+use glam::{EulerRot, Mat4, Quat, Vec3, Vec4};
+
+const GENERATION_MASK: u32 = 0x7fff_ffff;
+const IDENTITY: [f64; 9] = [0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 1.0, 1.0, 1.0];
+
+/// Which of a slot's three vectors a view reads and writes; the value is its first column.
+#[derive(Clone, Copy, PartialEq, Eq)]
+pub enum Part {
+    Position = 0,
+    Rotation = 3,
+    Scale = 6,
+}
+
+impl Part {
+    pub fn from_field(name: &str) -> Option<Part> {
+        match name {
+            "position" => Some(Part::Position),
+            "rotation" => Some(Part::Rotation),
+            "scale" => Some(Part::Scale),
+            _ => None,
+        }
+    }
+}
+
+/// The component a vector field name selects.
+pub fn axis(name: &str) -> Option<usize> {
+    match name {
+        "x" => Some(0),
+        "y" => Some(1),
+        "z" => Some(2),
+        _ => None,
+    }
+}
+
+/// A bounding sphere; a negative radius is the empty set.
+#[derive(Clone, Copy, PartialEq, Debug)]
+pub struct Sphere {
+    pub center: Vec3,
+    pub radius: f32,
+}
+
+impl Sphere {
+    pub const EMPTY: Sphere = Sphere {
+        center: Vec3::ZERO,
+        radius: -1.0,
+    };
+
+    pub fn is_empty(&self) -> bool {
+        self.radius < 0.0
+    }
+
+    /// The sphere around this one after `matrix`; non-uniform scale takes the largest axis.
+    pub fn transformed(&self, matrix: &Mat4) -> Sphere {
+        if self.is_empty() {
+            return *self;
+        }
+        let scale = matrix
+            .x_axis
+            .truncate()
+            .length_squared()
+            .max(matrix.y_axis.truncate().length_squared())
+            .max(matrix.z_axis.truncate().length_squared())
+            .sqrt();
+        Sphere {
+            center: matrix.transform_point3(self.center),
+            radius: self.radius * scale,
+        }
+    }
+
+    /// The smallest sphere holding both.
+    pub fn union(&self, other: &Sphere) -> Sphere {
+        if other.is_empty() {
+            return *self;
+        }
+        if self.is_empty() {
+            return *other;
+        }
+        let offset = other.center - self.center;
+        let distance = offset.length();
+        if distance + other.radius <= self.radius {
+            return *self;
+        }
+        if distance + self.radius <= other.radius {
+            return *other;
+        }
+        let radius = (distance + self.radius + other.radius) * 0.5;
+        Sphere {
+            center: self.center + offset * ((radius - self.radius) / distance),
+            radius,
+        }
+    }
+}
+
+/// The six clip planes of a view-projection matrix (wgpu's 0..1 depth), pointing inwards.
+pub struct Frustum {
+    planes: [Vec4; 6],
+}
+
+impl Frustum {
+    pub fn from_view_proj(view_proj: Mat4) -> Frustum {
+        let (r0, r1, r2, r3) = (
+            view_proj.row(0),
+            view_proj.row(1),
+            view_proj.row(2),
+            view_proj.row(3),
+        );
+        let planes = [r3 + r0, r3 - r0, r3 + r1, r3 - r1, r2, r3 - r2].map(|plane| {
+            let length = plane.truncate().length();
+            if length > 0.0 {
+                plane / length
+            } else {
+                plane
+            }
+        });
+        Frustum { planes }
+    }
+
+    /// False only when the sphere is wholly outside one plane.
+    pub fn intersects(&self, sphere: &Sphere) -> bool {
+        if sphere.is_empty() {
+            return false;
+        }
+        self.planes
+            .iter()
+            .all(|plane| plane.truncate().dot(sphere.center) + plane.w >= -sphere.radius)
+    }
+}
+
+/// What a cached subtree sphere was built from: the children list and its length, the
+/// geometry object, and the geometry epoch (bumped by any geometry field write).
+pub type Shape = [u64; 4];
+
+pub struct TransformStore {
+    columns: [Vec<f64>; 9],
+    dirty: Vec<bool>,
+    local: Vec<Mat4>,
+    generation: Vec<u32>,
+    free: Vec<usize>,
+    // The slot the mesh walk last reached this one from (index + 1, 0 for none).
+    parent: Vec<u32>,
+    bounds: Vec<Option<(Sphere, Shape)>>,
+}
+
+impl TransformStore {
+    pub fn new() -> Self {
+        TransformStore {
+            columns: Default::default(),
+            dirty: Vec::new(),
+            local: Vec::new(),
+            generation: Vec::new(),
+            free: Vec::new(),
+            parent: Vec::new(),
+            bounds: Vec::new(),
+        }
+    }
+
+    fn index(&self, handle: u64) -> Option<usize> {
+        let low = (handle & 0xffff_ffff) as usize;
+        let index = low.checked_sub(1)?;
+        let current = *self.generation.get(index)?;
+        (current == (handle >> 32) as u32).then_some(index)
+    }
+
+    fn insert_values(&mut self, values: [f64; 9]) -> u64 {
+        let index = match self.free.pop() {
+            Some(index) => {
+                for (column, value) in self.columns.iter_mut().zip(values) {
+                    column[index] = value;
+                }
+                self.dirty[index] = true;
+                self.parent[index] = 0;
+                self.bounds[index] = None;
+                index
+            }
+            None => {
+                for (column, value) in self.columns.iter_mut().zip(values) {
+                    column.push(value);
+                }
+                self.dirty.push(true);
+                self.local.push(Mat4::IDENTITY);
+                self.generation.push(0);
+                self.parent.push(0);
+                self.bounds.push(None);
+                self.generation.len() - 1
+            }
+        };
+        ((self.generation[index] as u64) << 32) | (index as u64 + 1)
+    }
+
+    /// A new slot at the origin with unit scale.
+    pub fn insert(&mut self) -> u64 {
+        self.insert_values(IDENTITY)
+    }
+
+    /// A new slot holding a copy of `handle`'s transform.
+    pub fn duplicate(&mut self, handle: u64) -> Option<u64> {
+        let index = self.index(handle)?;
+        let values = std::array::from_fn(|c| self.columns[c][index]);
+        Some(self.insert_values(values))
+    }
+
+    pub fn remove(&mut self, handle: u64) {
+        if let Some(index) = self.index(handle) {
+            self.invalidate_bounds(index);
+            self.generation[index] = self.generation[index].wrapping_add(1) & GENERATION_MASK;
+            self.free.push(index);
+        }
+    }
+
+    /// Drop the cached sphere of `index` and of its ancestors. A slot whose sphere is
+    /// already gone has none above it either, since a sphere is only cached once every
+    /// child below it has one (or was walked).
+    fn invalidate_bounds(&mut self, index: usize) {
+        let mut current = Some(index);
+        while let Some(index) = current {
+            if self.bounds[index].take().is_none() {
+                break;
+            }
+            current = (self.parent[index] as usize).checked_sub(1);
+        }
+    }
+
+    /// Record the slot the walk reached `handle` from.
+    pub fn set_parent(&mut self, handle: u64, parent: Option<u64>) {
+        let parent = parent.and_then(|parent| self.index(parent));
+        if let Some(index) = self.index(handle) {
+            self.parent[index] = parent.map_or(0, |parent| parent as u32 + 1);
+        }
+    }
+
+    /// The cached subtree sphere of `handle`, if it was built from `shape`.
+    pub fn bounds(&self, handle: u64, shape: Shape) -> Option<Sphere> {
+        let index = self.index(handle)?;
+        match self.bounds[index] {
+            Some((sphere, cached)) if cached == shape => Some(sphere),
+            _ => None,
+        }
+    }
+
+    pub fn set_bounds(&mut self, handle: u64, sphere: Sphere, shape: Shape) {
+        if let Some(index) = self.index(handle) {
+            self.bounds[index] = Some((sphere, shape));
+        }
+    }
+
+    pub fn get(&self, handle: u64, part: Part, axis: usize) -> Option<f64> {
+        let index = self.index(handle)?;
+        Some(self.columns[part as usize + axis][index])
+    }
+
+    /// False when `handle` no longer names a slot.
+    pub fn set(&mut self, handle: u64, part: Part, axis: usize, value: f64) -> bool {
+        match self.index(handle) {
+            Some(index) => {
+                self.columns[part as usize + axis][index] = value;
+                self.dirty[index] = true;
+                self.invalidate_bounds(index);
+                true
+            }
+            None => false,
+        }
+    }
+
+    pub fn vector(&self, handle: u64, part: Part) -> Option<[f64; 3]> {
+        let index = self.index(handle)?;
+        Some(std::array::from_fn(|axis| {
+            self.columns[part as usize + axis][index]
+        }))
+    }
+
+    pub fn set_vector(&mut self, handle: u64, part: Part, value: [f64; 3]) -> bool {
+        let index = match self.index(handle) {
+            Some(index) => index,
+            None => return false,
+        };
+        for (axis, v) in value.into_iter().enumerate() {
+            self.columns[part as usize + axis][index] = v;
+        }
+        self.dirty[index] = true;
+        self.invalidate_bounds(index);
+        true
+    }
+
+    /// Scale, then XYZ Euler rotation, then translation; rebuilt only if the slot changed.
+    pub fn local_matrix(&mut self, handle: u64) -> Option<Mat4> {
+        let index = self.index(handle)?;
+        if self.dirty[index] {
+            let c = |column: usize| self.columns[column][index] as f32;
+            let position = Vec3::new(c(0), c(1), c(2));
+            let rotation = Quat::from_euler(EulerRot::XYZ, c(3), c(4), c(5));
+            let scale = Vec3::new(c(6), c(7), c(8));
+            self.local[index] = Mat4::from_scale_rotation_translation(scale, rotation, position);
+            self.dirty[index] = false;
+        }
+        Some(self.local[index])
+    }
+}
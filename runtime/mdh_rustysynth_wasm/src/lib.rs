@@ -4,6 +4,11 @@ use std::sync::Arc;
 use rustysynth::{MidiFile, MidiFileSequencer, SoundFont, Synthesizer, SynthesizerSettings};
 
 const CHUNK_FRAMES: usize = 1024;
+/// Most frames a stream renders in one call; Web Audio asks for 128 at a time
+const STREAM_MAX_FRAMES: usize = 1024;
+/// Frames a seeking stream runs through per call, so a long jump is spread over many
+/// blocks instead of stalling the audio thread
+const SEEK_FRAMES_PER_CALL: usize = 8192;
 
 static mut LAST_LEN: usize = 0;
 static mut LAST_FRAMES: usize = 0;
@@ -176,3 +181,187 @@ pub extern "C" fn last_error_ptr() -> *const u8 {
 pub extern "C" fn last_error_len() -> usize {
     unsafe { LAST_ERR_LEN }
 }
+
+/// A MIDI file playing through its own synth, rendered a block at a time
+pub struct MidiStream {
+    midi: Arc<MidiFile>,
+    sequencer: MidiFileSequencer,
+    sample_rate: i32,
+    /// Frames still to be run through (and thrown away) to reach a seek target
+    skip: usize,
+    left: Vec<f32>,
+    right: Vec<f32>,
+}
+
+/// Parse a soundfont once, for sharing between streams. Free with `soundfont_free`.
+#[no_mangle]
+pub extern "C" fn soundfont_load(sf_ptr: *const u8, sf_len: usize) -> *mut Arc<SoundFont> {
+    clear_error();
+    if sf_ptr.is_null() || sf_len == 0 {
+        set_error("Cannae read the soondfont");
+        return std::ptr::null_mut();
+    }
+    let sf_bytes = unsafe { std::slice::from_raw_parts(sf_ptr, sf_len) };
+    match SoundFont::new(&mut Cursor::new(sf_bytes)) {
+        Ok(sf) => Box::into_raw(Box::new(Arc::new(sf))),
+        Err(_) => {
+            set_error("Cannae read the soondfont");
+            std::ptr::null_mut()
+        }
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn soundfont_free(sf: *mut Arc<SoundFont>) {
+    if !sf.is_null() {
+        unsafe {
+            let _ = Box::from_raw(sf);
+        }
+    }
+}
+
+/// Start a stream for a MIDI file on a loaded soundfont. Free with `stream_free`.
+#[no_mangle]
+pub extern "C" fn stream_open(
+    sf: *const Arc<SoundFont>,
+    midi_ptr: *const u8,
+    midi_len: usize,
+    sample_rate: u32,
+) -> *mut MidiStream {
+    clear_error();
+    if sf.is_null() {
+        set_error("Cannae read the soondfont");
+        return std::ptr::null_mut();
+    }
+    if midi_ptr.is_null() || midi_len == 0 {
+        set_error("Cannae read the midi");
+        return std::ptr::null_mut();
+    }
+    let sf = unsafe { &*sf };
+    let midi_bytes = unsafe { std::slice::from_raw_parts(midi_ptr, midi_len) };
+    let midi = match MidiFile::new(&mut Cursor::new(midi_bytes)) {
+        Ok(m) => Arc::new(m),
+        Err(_) => {
+            set_error("Cannae read the midi");
+            return std::ptr::null_mut();
+        }
+    };
+
+    let sr = sample_rate.max(8000).min(192000) as i32;
+    let settings = SynthesizerSettings::new(sr);
+    let synth = match Synthesizer::new(sf, &settings) {
+        Ok(s) => s,
+        Err(_) => {
+            set_error("Cannae set up the synth");
+            return std::ptr::null_mut();
+        }
+    };
+    let mut sequencer = MidiFileSequencer::new(synth);
+    sequencer.play(&midi, false);
+
+    Box::into_raw(Box::new(MidiStream {
+        midi,
+        sequencer,
+        sample_rate: sr,
+        skip: 0,
+        left: vec![0.0; STREAM_MAX_FRAMES],
+        right: vec![0.0; STREAM_MAX_FRAMES],
+    }))
+}
+
+#[no_mangle]
+pub extern "C" fn stream_free(stream: *mut MidiStream) {
+    if !stream.is_null() {
+        unsafe {
+            let _ = Box::from_raw(stream);
+        }
+    }
+}
+
+/// Where the left channel of the last rendered block sits
+#[no_mangle]
+pub extern "C" fn stream_left(stream: *mut MidiStream) -> *const f32 {
+    match unsafe { stream.as_ref() } {
+        Some(stream) => stream.left.as_ptr(),
+        None => std::ptr::null(),
+    }
+}
+
+/// Where the right channel of the last rendered block sits
+#[no_mangle]
+pub extern "C" fn stream_right(stream: *mut MidiStream) -> *const f32 {
+    match unsafe { stream.as_ref() } {
+        Some(stream) => stream.right.as_ptr(),
+        None => std::ptr::null(),
+    }
+}
+
+/// Render the next `frames` (up to 1024) into the stream's left/right buffers.
+/// While a seek is catching up the block is silence. Returns 0 once the song has
+/// ended (and isn't looped), 1 otherwise.
+#[no_mangle]
+pub extern "C" fn stream_render(stream: *mut MidiStream, frames: usize, looped: u32) -> u32 {
+    let Some(stream) = (unsafe { stream.as_mut() }) else {
+        return 0;
+    };
+    let frames = frames.min(STREAM_MAX_FRAMES);
+    if frames == 0 {
+        return 1;
+    }
+    let (left, right) = (&mut stream.left[..frames], &mut stream.right[..frames]);
+
+    if stream.skip > 0 {
+        let mut budget = stream.skip.min(SEEK_FRAMES_PER_CALL);
+        stream.skip -= budget;
+        while budget > 0 {
+            let chunk = budget.min(frames);
+            stream
+                .sequencer
+                .render(&mut left[..chunk], &mut right[..chunk]);
+            budget -= chunk;
+        }
+        left.fill(0.0);
+        right.fill(0.0);
+        return 1;
+    }
+
+    stream.sequencer.render(left, right);
+    if stream.sequencer.end_of_sequence() {
+        if looped == 0 {
+            return 0;
+        }
+        stream.sequencer.play(&stream.midi, false);
+    }
+    1
+}
+
+/// Jump to `seconds` into the song. The synth starts over and runs forward to the
+/// target over the next few `stream_render` calls.
+#[no_mangle]
+pub extern "C" fn stream_seek(stream: *mut MidiStream, seconds: f64) {
+    let Some(stream) = (unsafe { stream.as_mut() }) else {
+        return;
+    };
+    let target = seconds.max(0.0).min(stream.midi.get_length());
+    stream.sequencer.play(&stream.midi, false);
+    stream.skip = (target * stream.sample_rate as f64) as usize;
+}
+
+/// Playback position in seconds, counting any seek still catching up
+#[no_mangle]
+pub extern "C" fn stream_position(stream: *mut MidiStream) -> f64 {
+    match unsafe { stream.as_ref() } {
+        Some(stream) => {
+            stream.sequencer.get_position() + stream.skip as f64 / stream.sample_rate as f64
+        }
+        None => 0.0,
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn stream_length(stream: *mut MidiStream) -> f64 {
+    match unsafe { stream.as_ref() } {
+        Some(stream) => stream.midi.get_length(),
+        None => 0.0,
+    }
+}
@@ -1,7 +1,11 @@
 use std::fmt;
 
+use serde::{Deserialize, Serialize};
+
+pub mod arena;
+
 /// Log levels for the logging system
-#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord, Default)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord, Default, Serialize, Deserialize)]
 pub enum LogLevel {
     /// Silent - no output
     Wheesht = 0,
@@ -52,7 +56,7 @@ impl fmt::Display for LogLevel {
 }
 
 /// Span information for error reporting
-#[derive(Debug, Clone, Copy, PartialEq)]
+#[derive(Debug, Clone, Copy, PartialEq, Serialize, Deserialize)]
 pub struct Span {
     pub line: usize,
     pub column: usize,
@@ -65,7 +69,7 @@ impl Span {
 }
 
 /// A program is a list of statements
-#[derive(Debug, Clone)]
+#[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct Program {
     pub statements: Vec<Stmt>,
 }
@@ -77,7 +81,7 @@ impl Program {
 }
 
 /// Statements in mdhavers
-#[derive(Debug, Clone)]
+#[derive(Debug, Clone, Serialize, Deserialize)]
 pub enum Stmt {
     /// Variable declaration: ken x = 5
     VarDecl {
@@ -200,7 +204,7 @@ pub enum Stmt {
 }
 
 /// A match arm: whan pattern -> body
-#[derive(Debug, Clone)]
+#[derive(Debug, Clone, Serialize, Deserialize)]
 #[allow(dead_code)]
 pub struct MatchArm {
     pub pattern: Pattern,
@@ -209,7 +213,7 @@ pub struct MatchArm {
 }
 
 /// Patterns for matching
-#[derive(Debug, Clone)]
+#[derive(Debug, Clone, Serialize, Deserialize)]
 pub enum Pattern {
     /// Literal value
     Literal(Literal),
@@ -222,14 +226,14 @@ pub enum Pattern {
 }
 
 /// A function parameter with optional default value
-#[derive(Debug, Clone)]
+#[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct Param {
     pub name: String,
     pub default: Option<Expr>,
 }
 
 /// Destructuring pattern fer unpacking lists
-#[derive(Debug, Clone)]
+#[derive(Debug, Clone, Serialize, Deserialize)]
 pub enum DestructPattern {
     /// Single variable: x
     Variable(String),
@@ -239,20 +243,35 @@ pub enum DestructPattern {
     Ignore,
 }
 
+/// Where the interpreter's resolver found a variable: the scope `depth` environments
+/// up, at `index` when the resolver could tell which binding it is
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize, Deserialize)]
+pub struct Slot {
+    pub depth: u16,
+    pub index: Option<u16>,
+}
+
 /// Expressions in mdhavers
-#[derive(Debug, Clone)]
+#[derive(Debug, Clone, Serialize, Deserialize)]
 #[allow(clippy::enum_variant_names)]
 pub enum Expr {
     /// Literal values
     Literal { value: Literal, span: Span },
 
-    /// Variable reference
-    Variable { name: String, span: Span },
+    /// Variable reference; `slot` is filled in by the interpreter's resolver
+    Variable {
+        name: String,
+        #[serde(default, skip_serializing_if = "Option::is_none")]
+        slot: Option<Slot>,
+        span: Span,
+    },
 
     /// Assignment: x = 5
     Assign {
         name: String,
         value: Box<Expr>,
+        #[serde(default, skip_serializing_if = "Option::is_none")]
+        slot: Option<Slot>,
         span: Span,
     },
 
@@ -385,7 +404,7 @@ pub enum Expr {
 }
 
 /// Parts of an f-string
-#[derive(Debug, Clone)]
+#[derive(Debug, Clone, Serialize, Deserialize)]
 pub enum FStringPart {
     /// Literal text
     Text(String),
@@ -394,7 +413,7 @@ pub enum FStringPart {
 }
 
 /// Literal values
-#[derive(Debug, Clone, PartialEq)]
+#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
 pub enum Literal {
     Integer(i64),
     Float(f64),
@@ -417,7 +436,7 @@ impl fmt::Display for Literal {
 }
 
 /// Binary operators
-#[derive(Debug, Clone, Copy, PartialEq)]
+#[derive(Debug, Clone, Copy, PartialEq, Serialize, Deserialize)]
 pub enum BinaryOp {
     Add,
     Subtract,
@@ -451,7 +470,7 @@ impl fmt::Display for BinaryOp {
 }
 
 /// Unary operators
-#[derive(Debug, Clone, Copy, PartialEq)]
+#[derive(Debug, Clone, Copy, PartialEq, Serialize, Deserialize)]
 pub enum UnaryOp {
     Negate,
     Not,
@@ -467,7 +486,7 @@ impl fmt::Display for UnaryOp {
 }
 
 /// Logical operators
-#[derive(Debug, Clone, Copy, PartialEq)]
+#[derive(Debug, Clone, Copy, PartialEq, Serialize, Deserialize)]
 pub enum LogicalOp {
     And,
     Or,
@@ -671,6 +690,7 @@ mod tests {
 
         let var = Expr::Variable {
             name: "x".to_string(),
+            slot: None,
             span,
         };
         assert_eq!(var.span(), span);
@@ -681,6 +701,7 @@ mod tests {
                 value: Literal::Integer(1),
                 span,
             }),
+            slot: None,
             span,
         };
         assert_eq!(assign.span(), span);
@@ -726,6 +747,7 @@ mod tests {
         let call = Expr::Call {
             callee: Box::new(Expr::Variable {
                 name: "f".to_string(),
+                slot: None,
                 span,
             }),
             arguments: vec![],
@@ -736,6 +758,7 @@ mod tests {
         let get = Expr::Get {
             object: Box::new(Expr::Variable {
                 name: "obj".to_string(),
+                slot: None,
                 span,
             }),
             property: "prop".to_string(),
@@ -746,6 +769,7 @@ mod tests {
         let set = Expr::Set {
             object: Box::new(Expr::Variable {
                 name: "obj".to_string(),
+                slot: None,
                 span,
             }),
             property: "prop".to_string(),
@@ -760,6 +784,7 @@ mod tests {
         let index = Expr::Index {
             object: Box::new(Expr::Variable {
                 name: "arr".to_string(),
+                slot: None,
                 span,
             }),
             index: Box::new(Expr::Literal {
@@ -773,6 +798,7 @@ mod tests {
         let index_set = Expr::IndexSet {
             object: Box::new(Expr::Variable {
                 name: "arr".to_string(),
+                slot: None,
                 span,
             }),
             index: Box::new(Expr::Literal {
@@ -790,6 +816,7 @@ mod tests {
         let slice = Expr::Slice {
             object: Box::new(Expr::Variable {
                 name: "arr".to_string(),
+                slot: None,
                 span,
             }),
             start: None,
@@ -838,6 +865,7 @@ mod tests {
             params: vec!["x".to_string()],
             body: Box::new(Expr::Variable {
                 name: "x".to_string(),
+                slot: None,
                 span,
             }),
             span,
@@ -865,6 +893,7 @@ mod tests {
         let spread = Expr::Spread {
             expr: Box::new(Expr::Variable {
                 name: "arr".to_string(),
+                slot: None,
                 span,
             }),
             span,
@@ -878,6 +907,7 @@ mod tests {
             }),
             right: Box::new(Expr::Variable {
                 name: "f".to_string(),
+                slot: None,
                 span,
             }),
             span,
@@ -1115,6 +1145,7 @@ mod tests {
         let span = Span::new(1, 1);
         let expr = FStringPart::Expr(Box::new(Expr::Variable {
             name: "name".to_string(),
+            slot: None,
             span,
         }));
 
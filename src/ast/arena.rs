@@ -0,0 +1,1341 @@
+//! Arena-backed AST
+//!
+//! An [`Ast`] keeps a whole program in a handful of flat vectors. Every node is a small
+//! `Copy` value that points at its children by index, child lists are runs in shared
+//! pools, and every name and string literal is interned into one text buffer. Building
+//! one is a few vector pushes per node instead of a heap allocation per `Box`, walking it
+//! stays in a few contiguous buffers, and dropping it frees the same dozen allocations
+//! however big the program is.
+//!
+//! The parser builds an [`Ast`] directly through [`AstBuilder`] (see
+//! [`crate::parser::parse_arena`]). [`Ast::to_program`] gives the boxed tree back for
+//! passes that walk [`Program`]s.
+
+use std::collections::HashMap;
+use std::fmt;
+use std::marker::PhantomData;
+
+use super::{
+    BinaryOp, DestructPattern, Expr, FStringPart, Literal, LogLevel, LogicalOp, MatchArm, Param,
+    Pattern, Program, Span, Stmt, UnaryOp,
+};
+use crate::parser::Build;
+
+/// An expression in an [`Ast`]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub struct ExprId(u32);
+
+/// A statement in an [`Ast`]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub struct StmtId(u32);
+
+/// An interned name or string literal
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub struct Sym(u32);
+
+/// A run of `T`s in one of the arena's pools
+pub struct Seq<T> {
+    start: u32,
+    len: u32,
+    _item: PhantomData<T>,
+}
+
+impl<T> Clone for Seq<T> {
+    fn clone(&self) -> Self {
+        *self
+    }
+}
+
+impl<T> Copy for Seq<T> {}
+
+impl<T> PartialEq for Seq<T> {
+    fn eq(&self, other: &Self) -> bool {
+        self.start == other.start && self.len == other.len
+    }
+}
+
+impl<T> fmt::Debug for Seq<T> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(f, "Seq({}..{})", self.start, self.start + self.len)
+    }
+}
+
+impl<T> Seq<T> {
+    pub fn len(&self) -> usize {
+        self.len as usize
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+}
+
+/// A literal, with its string interned
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum Lit {
+    Integer(i64),
+    Float(f64),
+    String(Sym),
+    Bool(bool),
+    Nil,
+}
+
+/// A node and its position, kept as two `u32`s so the node stays small
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct Node<K> {
+    pub kind: K,
+    line: u32,
+    column: u32,
+}
+
+impl<K> Node<K> {
+    fn new(kind: K, span: Span) -> Self {
+        Node {
+            kind,
+            line: span.line as u32,
+            column: span.column as u32,
+        }
+    }
+
+    pub fn span(&self) -> Span {
+        Span::new(self.line as usize, self.column as usize)
+    }
+}
+
+pub type ExprNode = Node<ExprKind>;
+pub type StmtNode = Node<StmtKind>;
+
+/// [`Expr`], with children as ids
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum ExprKind {
+    Literal(Lit),
+    Variable(Sym),
+    Assign {
+        name: Sym,
+        value: ExprId,
+    },
+    Binary {
+        left: ExprId,
+        operator: BinaryOp,
+        right: ExprId,
+    },
+    Unary {
+        operator: UnaryOp,
+        operand: ExprId,
+    },
+    Logical {
+        left: ExprId,
+        operator: LogicalOp,
+        right: ExprId,
+    },
+    Call {
+        callee: ExprId,
+        arguments: Seq<ExprId>,
+    },
+    Get {
+        object: ExprId,
+        property: Sym,
+    },
+    Set {
+        object: ExprId,
+        property: Sym,
+        value: ExprId,
+    },
+    Index {
+        object: ExprId,
+        index: ExprId,
+    },
+    IndexSet {
+        object: ExprId,
+        index: ExprId,
+        value: ExprId,
+    },
+    Slice {
+        object: ExprId,
+        start: Option<ExprId>,
+        end: Option<ExprId>,
+        step: Option<ExprId>,
+    },
+    List(Seq<ExprId>),
+    /// Keys and values alternate: key, value, key, value...
+    Dict(Seq<ExprId>),
+    Range {
+        start: ExprId,
+        end: ExprId,
+        inclusive: bool,
+    },
+    Grouping(ExprId),
+    Lambda {
+        params: Seq<Sym>,
+        body: ExprId,
+    },
+    BlockExpr(Seq<StmtId>),
+    Masel,
+    Input(ExprId),
+    FString(Seq<FPart>),
+    Spread(ExprId),
+    Pipe {
+        left: ExprId,
+        right: ExprId,
+    },
+    Ternary {
+        condition: ExprId,
+        then_expr: ExprId,
+        else_expr: ExprId,
+    },
+}
+
+/// [`Stmt`], with children as ids
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum StmtKind {
+    VarDecl {
+        name: Sym,
+        initializer: Option<ExprId>,
+    },
+    Expression(ExprId),
+    Block(Seq<StmtId>),
+    If {
+        condition: ExprId,
+        then_branch: StmtId,
+        else_branch: Option<StmtId>,
+    },
+    While {
+        condition: ExprId,
+        body: StmtId,
+    },
+    For {
+        variable: Sym,
+        iterable: ExprId,
+        body: StmtId,
+    },
+    Function {
+        name: Sym,
+        params: Seq<ParamNode>,
+        body: Seq<StmtId>,
+    },
+    Return(Option<ExprId>),
+    Print(ExprId),
+    Break,
+    Continue,
+    Class {
+        name: Sym,
+        superclass: Option<Sym>,
+        methods: Seq<StmtId>,
+    },
+    Struct {
+        name: Sym,
+        fields: Seq<Sym>,
+    },
+    Import {
+        path: Sym,
+        alias: Option<Sym>,
+    },
+    TryCatch {
+        try_block: StmtId,
+        error_name: Sym,
+        catch_block: StmtId,
+    },
+    Match {
+        value: ExprId,
+        arms: Seq<ArmNode>,
+    },
+    Assert {
+        condition: ExprId,
+        message: Option<ExprId>,
+    },
+    Destructure {
+        patterns: Seq<DestructNode>,
+        value: ExprId,
+    },
+    Log {
+        level: LogLevel,
+        message: ExprId,
+        extras: Seq<ExprId>,
+    },
+    Hurl(ExprId),
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum FPart {
+    Text(Sym),
+    Expr(ExprId),
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct ParamNode {
+    pub name: Sym,
+    pub default: Option<ExprId>,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum PatternNode {
+    Literal(Lit),
+    Identifier(Sym),
+    Wildcard,
+    Range { start: ExprId, end: ExprId },
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct ArmNode {
+    pub pattern: PatternNode,
+    pub body: StmtId,
+    pub span: Span,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum DestructNode {
+    Variable(Sym),
+    Rest(Sym),
+    Ignore,
+}
+
+/// A whole program, flattened
+#[derive(Debug, Default)]
+pub struct Ast {
+    exprs: Vec<ExprNode>,
+    stmts: Vec<StmtNode>,
+    expr_pool: Vec<ExprId>,
+    stmt_pool: Vec<StmtId>,
+    sym_pool: Vec<Sym>,
+    part_pool: Vec<FPart>,
+    param_pool: Vec<ParamNode>,
+    arm_pool: Vec<ArmNode>,
+    destruct_pool: Vec<DestructNode>,
+    /// Every interned string, back to back, and where each one ends
+    text: String,
+    sym_ends: Vec<u32>,
+    roots: Vec<StmtId>,
+}
+
+/// The types that live in one of an [`Ast`]'s pools
+pub trait Pooled: Sized {
+    fn pool(ast: &Ast) -> &Vec<Self>;
+    fn pool_mut(ast: &mut Ast) -> &mut Vec<Self>;
+}
+
+macro_rules! pooled {
+    ($($ty:ty => $field:ident),* $(,)?) => {
+        $(impl Pooled for $ty {
+            fn pool(ast: &Ast) -> &Vec<Self> {
+                &ast.$field
+            }
+            fn pool_mut(ast: &mut Ast) -> &mut Vec<Self> {
+                &mut ast.$field
+            }
+        })*
+    };
+}
+
+pooled! {
+    ExprId => expr_pool,
+    StmtId => stmt_pool,
+    Sym => sym_pool,
+    FPart => part_pool,
+    ParamNode => param_pool,
+    ArmNode => arm_pool,
+    DestructNode => destruct_pool,
+}
+
+impl Ast {
+    /// The program's top-level statements
+    pub fn roots(&self) -> &[StmtId] {
+        &self.roots
+    }
+
+    pub fn expr(&self, id: ExprId) -> &ExprNode {
+        &self.exprs[id.0 as usize]
+    }
+
+    pub fn stmt(&self, id: StmtId) -> &StmtNode {
+        &self.stmts[id.0 as usize]
+    }
+
+    pub fn list<T: Pooled>(&self, seq: Seq<T>) -> &[T] {
+        let start = seq.start as usize;
+        &T::pool(self)[start..start + seq.len as usize]
+    }
+
+    pub fn sym(&self, sym: Sym) -> &str {
+        let end = self.sym_ends[sym.0 as usize] as usize;
+        let start = match sym.0 {
+            0 => 0,
+            n => self.sym_ends[n as usize - 1] as usize,
+        };
+        &self.text[start..end]
+    }
+
+    /// Every expression in the program, in the order the parser built them. Passes that
+    /// only need to find things can scan this instead of walking the tree.
+    pub fn exprs(&self) -> impl Iterator<Item = (ExprId, &ExprNode)> {
+        (0..).map(ExprId).zip(self.exprs.iter())
+    }
+
+    /// Every statement in the program, in the order the parser built them
+    pub fn stmts(&self) -> impl Iterator<Item = (StmtId, &StmtNode)> {
+        (0..).map(StmtId).zip(self.stmts.iter())
+    }
+
+    /// Build the boxed program, for passes that walk [`Program`]s
+    pub fn to_program(&self) -> Program {
+        Program::new(self.roots.iter().map(|&id| self.raise_stmt(id)).collect())
+    }
+
+    fn push_seq<T: Pooled>(&mut self, items: Vec<T>) -> Seq<T> {
+        let pool = T::pool_mut(self);
+        let start = pool.len() as u32;
+        let len = items.len() as u32;
+        pool.extend(items);
+        Seq {
+            start,
+            len,
+            _item: PhantomData,
+        }
+    }
+
+    fn raise_expr(&self, id: ExprId) -> Expr {
+        let node = *self.expr(id);
+        let span = node.span();
+        let boxed = |id: ExprId| Box::new(self.raise_expr(id));
+        let name = |sym: Sym| self.sym(sym).to_string();
+        let exprs = |seq: Seq<ExprId>| -> Vec<Expr> {
+            self.list(seq).iter().map(|&e| self.raise_expr(e)).collect()
+        };
+        match node.kind {
+            ExprKind::Literal(lit) => Expr::Literal {
+                value: self.raise_lit(lit),
+                span,
+            },
+            ExprKind::Variable(sym) => Expr::Variable {
+                name: name(sym),
+                slot: None,
+                span,
+            },
+            ExprKind::Assign { name: sym, value } => Expr::Assign {
+                name: name(sym),
+                value: boxed(value),
+                slot: None,
+                span,
+            },
+            ExprKind::Binary {
+                left,
+                operator,
+                right,
+            } => Expr::Binary {
+                left: boxed(left),
+                operator,
+                right: boxed(right),
+                span,
+            },
+            ExprKind::Unary { operator, operand } => Expr::Unary {
+                operator,
+                operand: boxed(operand),
+                span,
+            },
+            ExprKind::Logical {
+                left,
+                operator,
+                right,
+            } => Expr::Logical {
+                left: boxed(left),
+                operator,
+                right: boxed(right),
+                span,
+            },
+            ExprKind::Call { callee, arguments } => Expr::Call {
+                callee: boxed(callee),
+                arguments: exprs(arguments),
+                span,
+            },
+            ExprKind::Get { object, property } => Expr::Get {
+                object: boxed(object),
+                property: name(property),
+                span,
+            },
+            ExprKind::Set {
+                object,
+                property,
+                value,
+            } => Expr::Set {
+                object: boxed(object),
+                property: name(property),
+                value: boxed(value),
+                span,
+            },
+            ExprKind::Index { object, index } => Expr::Index {
+                object: boxed(object),
+                index: boxed(index),
+                span,
+            },
+            ExprKind::IndexSet {
+                object,
+                index,
+                value,
+            } => Expr::IndexSet {
+                object: boxed(object),
+                index: boxed(index),
+                value: boxed(value),
+                span,
+            },
+            ExprKind::Slice {
+                object,
+                start,
+                end,
+                step,
+            } => Expr::Slice {
+                object: boxed(object),
+                start: start.map(boxed),
+                end: end.map(boxed),
+                step: step.map(boxed),
+                span,
+            },
+            ExprKind::List(elements) => Expr::List {
+                elements: exprs(elements),
+                span,
+            },
+            ExprKind::Dict(pairs) => Expr::Dict {
+                pairs: self
+                    .list(pairs)
+                    .chunks_exact(2)
+                    .map(|pair| (self.raise_expr(pair[0]), self.raise_expr(pair[1])))
+                    .collect(),
+                span,
+            },
+            ExprKind::Range {
+                start,
+                end,
+                inclusive,
+            } => Expr::Range {
+                start: boxed(start),
+                end: boxed(end),
+                inclusive,
+                span,
+            },
+            ExprKind::Grouping(expr) => Expr::Grouping {
+                expr: boxed(expr),
+                span,
+            },
+            ExprKind::Lambda { params, body } => Expr::Lambda {
+                params: self.list(params).iter().map(|&p| name(p)).collect(),
+                body: boxed(body),
+                span,
+            },
+            ExprKind::BlockExpr(statements) => Expr::BlockExpr {
+                statements: self.raise_stmts(statements),
+                span,
+            },
+            ExprKind::Masel => Expr::Masel { span },
+            ExprKind::Input(prompt) => Expr::Input {
+                prompt: boxed(prompt),
+                span,
+            },
+            ExprKind::FString(parts) => Expr::FString {
+                parts: self
+                    .list(parts)
+                    .iter()
+                    .map(|part| match *part {
+                        FPart::Text(text) => FStringPart::Text(name(text)),
+                        FPart::Expr(expr) => FStringPart::Expr(boxed(expr)),
+                    })
+                    .collect(),
+                span,
+            },
+            ExprKind::Spread(expr) => Expr::Spread {
+                expr: boxed(expr),
+                span,
+            },
+            ExprKind::Pipe { left, right } => Expr::Pipe {
+                left: boxed(left),
+                right: boxed(right),
+                span,
+            },
+            ExprKind::Ternary {
+                condition,
+                then_expr,
+                else_expr,
+            } => Expr::Ternary {
+                condition: boxed(condition),
+                then_expr: boxed(then_expr),
+                else_expr: boxed(else_expr),
+                span,
+            },
+        }
+    }
+
+    fn raise_stmts(&self, seq: Seq<StmtId>) -> Vec<Stmt> {
+        self.list(seq).iter().map(|&s| self.raise_stmt(s)).collect()
+    }
+
+    fn raise_stmt(&self, id: StmtId) -> Stmt {
+        let node = *self.stmt(id);
+        let span = node.span();
+        let boxed = |id: StmtId| Box::new(self.raise_stmt(id));
+        let name = |sym: Sym| self.sym(sym).to_string();
+        match node.kind {
+            StmtKind::VarDecl {
+                name: sym,
+                initializer,
+            } => Stmt::VarDecl {
+                name: name(sym),
+                initializer: initializer.map(|e| self.raise_expr(e)),
+                span,
+            },
+            StmtKind::Expression(expr) => Stmt::Expression {
+                expr: self.raise_expr(expr),
+                span,
+            },
+            StmtKind::Block(statements) => Stmt::Block {
+                statements: self.raise_stmts(statements),
+                span,
+            },
+            StmtKind::If {
+                condition,
+                then_branch,
+                else_branch,
+            } => Stmt::If {
+                condition: self.raise_expr(condition),
+                then_branch: boxed(then_branch),
+                else_branch: else_branch.map(boxed),
+                span,
+            },
+            StmtKind::While { condition, body } => Stmt::While {
+                condition: self.raise_expr(condition),
+                body: boxed(body),
+                span,
+            },
+            StmtKind::For {
+                variable,
+                iterable,
+                body,
+            } => Stmt::For {
+                variable: name(variable),
+                iterable: self.raise_expr(iterable),
+                body: boxed(body),
+                span,
+            },
+            StmtKind::Function {
+                name: sym,
+                params,
+                body,
+            } => Stmt::Function {
+                name: name(sym),
+                params: self
+                    .list(params)
+                    .iter()
+                    .map(|param| Param {
+                        name: name(param.name),
+                        default: param.default.map(|e| self.raise_expr(e)),
+                    })
+                    .collect(),
+                body: self.raise_stmts(body),
+                span,
+            },
+            StmtKind::Return(value) => Stmt::Return {
+                value: value.map(|e| self.raise_expr(e)),
+                span,
+            },
+            StmtKind::Print(value) => Stmt::Print {
+                value: self.raise_expr(value),
+                span,
+            },
+            StmtKind::Break => Stmt::Break { span },
+            StmtKind::Continue => Stmt::Continue { span },
+            StmtKind::Class {
+                name: sym,
+                superclass,
+                methods,
+            } => Stmt::Class {
+                name: name(sym),
+                superclass: superclass.map(name),
+                methods: self.raise_stmts(methods),
+                span,
+            },
+            StmtKind::Struct { name: sym, fields } => Stmt::Struct {
+                name: name(sym),
+                fields: self.list(fields).iter().map(|&f| name(f)).collect(),
+                span,
+            },
+            StmtKind::Import { path, alias } => Stmt::Import {
+                path: name(path),
+                alias: alias.map(name),
+                span,
+            },
+            StmtKind::TryCatch {
+                try_block,
+                error_name,
+                catch_block,
+            } => Stmt::TryCatch {
+                try_block: boxed(try_block),
+                error_name: name(error_name),
+                catch_block: boxed(catch_block),
+                span,
+            },
+            StmtKind::Match { value, arms } => Stmt::Match {
+                value: self.raise_expr(value),
+                arms: self
+                    .list(arms)
+                    .iter()
+                    .map(|arm| MatchArm {
+                        pattern: match arm.pattern {
+                            PatternNode::Literal(lit) => Pattern::Literal(self.raise_lit(lit)),
+                            PatternNode::Identifier(sym) => Pattern::Identifier(name(sym)),
+                            PatternNode::Wildcard => Pattern::Wildcard,
+                            PatternNode::Range { start, end } => Pattern::Range {
+                                start: Box::new(self.raise_expr(start)),
+                                end: Box::new(self.raise_expr(end)),
+                            },
+                        },
+                        body: self.raise_stmt(arm.body),
+                        span: arm.span,
+                    })
+                    .collect(),
+                span,
+            },
+            StmtKind::Assert { condition, message } => Stmt::Assert {
+                condition: self.raise_expr(condition),
+                message: message.map(|e| self.raise_expr(e)),
+                span,
+            },
+            StmtKind::Destructure { patterns, value } => Stmt::Destructure {
+                patterns: self
+                    .list(patterns)
+                    .iter()
+                    .map(|pattern| match *pattern {
+                        DestructNode::Variable(sym) => DestructPattern::Variable(name(sym)),
+                        DestructNode::Rest(sym) => DestructPattern::Rest(name(sym)),
+                        DestructNode::Ignore => DestructPattern::Ignore,
+                    })
+                    .collect(),
+                value: self.raise_expr(value),
+                span,
+            },
+            StmtKind::Log {
+                level,
+                message,
+                extras,
+            } => Stmt::Log {
+                level,
+                message: self.raise_expr(message),
+                extras: self
+                    .list(extras)
+                    .iter()
+                    .map(|&e| self.raise_expr(e))
+                    .collect(),
+                span,
+            },
+            StmtKind::Hurl(message) => Stmt::Hurl {
+                message: self.raise_expr(message),
+                span,
+            },
+        }
+    }
+
+    fn raise_lit(&self, lit: Lit) -> Literal {
+        match lit {
+            Lit::Integer(n) => Literal::Integer(n),
+            Lit::Float(n) => Literal::Float(n),
+            Lit::String(sym) => Literal::String(self.sym(sym).to_string()),
+            Lit::Bool(b) => Literal::Bool(b),
+            Lit::Nil => Literal::Nil,
+        }
+    }
+}
+
+/// Builds an [`Ast`] for the parser
+#[derive(Default)]
+pub struct AstBuilder {
+    ast: Ast,
+    /// Only needed while building
+    interned: HashMap<Box<str>, Sym>,
+}
+
+/// How long each of an [`Ast`]'s vectors was at some point during parsing
+#[derive(Debug, Clone, Copy)]
+pub struct Checkpoint([u32; 9]);
+
+impl AstBuilder {
+    fn intern(&mut self, text: &str) -> Sym {
+        if let Some(&sym) = self.interned.get(text) {
+            return sym;
+        }
+        let sym = Sym(self.ast.sym_ends.len() as u32);
+        self.ast.text.push_str(text);
+        self.ast.sym_ends.push(self.ast.text.len() as u32);
+        self.interned.insert(text.into(), sym);
+        sym
+    }
+
+    fn lit(&mut self, literal: Literal) -> Lit {
+        match literal {
+            Literal::Integer(n) => Lit::Integer(n),
+            Literal::Float(n) => Lit::Float(n),
+            Literal::String(s) => Lit::String(self.intern(&s)),
+            Literal::Bool(b) => Lit::Bool(b),
+            Literal::Nil => Lit::Nil,
+        }
+    }
+
+    fn syms(&mut self, names: Vec<String>) -> Seq<Sym> {
+        let syms: Vec<Sym> = names.iter().map(|n| self.intern(n)).collect();
+        self.ast.push_seq(syms)
+    }
+
+    fn push_expr(&mut self, kind: ExprKind, span: Span) -> ExprId {
+        let id = ExprId(self.ast.exprs.len() as u32);
+        self.ast.exprs.push(Node::new(kind, span));
+        id
+    }
+
+    fn push_stmt(&mut self, kind: StmtKind, span: Span) -> StmtId {
+        let id = StmtId(self.ast.stmts.len() as u32);
+        self.ast.stmts.push(Node::new(kind, span));
+        id
+    }
+}
+
+impl Build for AstBuilder {
+    type Expr = ExprId;
+    type Stmt = StmtId;
+    type Param = ParamNode;
+    type Arm = ArmNode;
+    type Pattern = PatternNode;
+    type Destruct = DestructNode;
+    type Part = FPart;
+    type Output = Ast;
+    type Checkpoint = Checkpoint;
+
+    fn finish(&mut self, statements: Vec<StmtId>) -> Ast {
+        self.interned.clear();
+        let mut ast = std::mem::take(&mut self.ast);
+        ast.roots = statements;
+        ast
+    }
+
+    fn span(&self, expr: &ExprId) -> Span {
+        self.ast.expr(*expr).span()
+    }
+
+    fn checkpoint(&self) -> Checkpoint {
+        let ast = &self.ast;
+        Checkpoint(
+            [
+                ast.exprs.len(),
+                ast.stmts.len(),
+                ast.expr_pool.len(),
+                ast.stmt_pool.len(),
+                ast.sym_pool.len(),
+                ast.part_pool.len(),
+                ast.param_pool.len(),
+                ast.arm_pool.len(),
+                ast.destruct_pool.len(),
+            ]
+            .map(|len| len as u32),
+        )
+    }
+
+    fn rewind(&mut self, checkpoint: Checkpoint) {
+        // Interned text is kept: it is still valid, just possibly unused
+        let [exprs, stmts, expr_pool, stmt_pool, sym_pool, part_pool, param_pool, arm_pool, destruct_pool] =
+            checkpoint.0.map(|len| len as usize);
+        let ast = &mut self.ast;
+        ast.exprs.truncate(exprs);
+        ast.stmts.truncate(stmts);
+        ast.expr_pool.truncate(expr_pool);
+        ast.stmt_pool.truncate(stmt_pool);
+        ast.sym_pool.truncate(sym_pool);
+        ast.part_pool.truncate(part_pool);
+        ast.param_pool.truncate(param_pool);
+        ast.arm_pool.truncate(arm_pool);
+        ast.destruct_pool.truncate(destruct_pool);
+    }
+
+    /// Turns the target node itself into the assignment, so nothing is left orphaned
+    fn assign(&mut self, target: ExprId, value: ExprId, span: Span) -> Option<ExprId> {
+        let kind = match self.ast.expr(target).kind {
+            ExprKind::Variable(name) => ExprKind::Assign { name, value },
+            ExprKind::Get { object, property } => ExprKind::Set {
+                object,
+                property,
+                value,
+            },
+            ExprKind::Index { object, index } => ExprKind::IndexSet {
+                object,
+                index,
+                value,
+            },
+            _ => return None,
+        };
+        self.ast.exprs[target.0 as usize] = Node::new(kind, span);
+        Some(target)
+    }
+
+    fn compound_assign(
+        &mut self,
+        target: ExprId,
+        operator: BinaryOp,
+        value: ExprId,
+        span: Span,
+    ) -> Option<ExprId> {
+        let ExprKind::Variable(name) = self.ast.expr(target).kind else {
+            return None;
+        };
+        let left = self.push_expr(ExprKind::Variable(name), span);
+        let sum = self.push_expr(
+            ExprKind::Binary {
+                left,
+                operator,
+                right: value,
+            },
+            span,
+        );
+        self.ast.exprs[target.0 as usize] = Node::new(ExprKind::Assign { name, value: sum }, span);
+        Some(target)
+    }
+
+    fn var_decl(&mut self, name: String, initializer: Option<ExprId>, span: Span) -> StmtId {
+        let name = self.intern(&name);
+        self.push_stmt(StmtKind::VarDecl { name, initializer }, span)
+    }
+
+    fn destructure(&mut self, patterns: Vec<DestructNode>, value: ExprId, span: Span) -> StmtId {
+        let patterns = self.ast.push_seq(patterns);
+        self.push_stmt(StmtKind::Destructure { patterns, value }, span)
+    }
+
+    fn destruct(&mut self, pattern: DestructPattern) -> DestructNode {
+        match pattern {
+            DestructPattern::Variable(name) => DestructNode::Variable(self.intern(&name)),
+            DestructPattern::Rest(name) => DestructNode::Rest(self.intern(&name)),
+            DestructPattern::Ignore => DestructNode::Ignore,
+        }
+    }
+
+    fn function(
+        &mut self,
+        name: String,
+        params: Vec<ParamNode>,
+        body: Vec<StmtId>,
+        span: Span,
+    ) -> StmtId {
+        let name = self.intern(&name);
+        let params = self.ast.push_seq(params);
+        let body = self.ast.push_seq(body);
+        self.push_stmt(StmtKind::Function { name, params, body }, span)
+    }
+
+    fn param(&mut self, name: String, default: Option<ExprId>) -> ParamNode {
+        ParamNode {
+            name: self.intern(&name),
+            default,
+        }
+    }
+
+    fn class(
+        &mut self,
+        name: String,
+        superclass: Option<String>,
+        methods: Vec<StmtId>,
+        span: Span,
+    ) -> StmtId {
+        let name = self.intern(&name);
+        let superclass = superclass.map(|s| self.intern(&s));
+        let methods = self.ast.push_seq(methods);
+        self.push_stmt(
+            StmtKind::Class {
+                name,
+                superclass,
+                methods,
+            },
+            span,
+        )
+    }
+
+    fn struct_decl(&mut self, name: String, fields: Vec<String>, span: Span) -> StmtId {
+        let name = self.intern(&name);
+        let fields = self.syms(fields);
+        self.push_stmt(StmtKind::Struct { name, fields }, span)
+    }
+
+    fn import(&mut self, path: String, alias: Option<String>, span: Span) -> StmtId {
+        let path = self.intern(&path);
+        let alias = alias.map(|a| self.intern(&a));
+        self.push_stmt(StmtKind::Import { path, alias }, span)
+    }
+
+    fn if_stmt(
+        &mut self,
+        condition: ExprId,
+        then_branch: StmtId,
+        else_branch: Option<StmtId>,
+        span: Span,
+    ) -> StmtId {
+        self.push_stmt(
+            StmtKind::If {
+                condition,
+                then_branch,
+                else_branch,
+            },
+            span,
+        )
+    }
+
+    fn while_stmt(&mut self, condition: ExprId, body: StmtId, span: Span) -> StmtId {
+        self.push_stmt(StmtKind::While { condition, body }, span)
+    }
+
+    fn for_stmt(&mut self, variable: String, iterable: ExprId, body: StmtId, span: Span) -> StmtId {
+        let variable = self.intern(&variable);
+        self.push_stmt(
+            StmtKind::For {
+                variable,
+                iterable,
+                body,
+            },
+            span,
+        )
+    }
+
+    fn return_stmt(&mut self, value: Option<ExprId>, span: Span) -> StmtId {
+        self.push_stmt(StmtKind::Return(value), span)
+    }
+
+    fn print(&mut self, value: ExprId, span: Span) -> StmtId {
+        self.push_stmt(StmtKind::Print(value), span)
+    }
+
+    fn break_stmt(&mut self, span: Span) -> StmtId {
+        self.push_stmt(StmtKind::Break, span)
+    }
+
+    fn continue_stmt(&mut self, span: Span) -> StmtId {
+        self.push_stmt(StmtKind::Continue, span)
+    }
+
+    fn try_catch(
+        &mut self,
+        try_block: StmtId,
+        error_name: String,
+        catch_block: StmtId,
+        span: Span,
+    ) -> StmtId {
+        let error_name = self.intern(&error_name);
+        self.push_stmt(
+            StmtKind::TryCatch {
+                try_block,
+                error_name,
+                catch_block,
+            },
+            span,
+        )
+    }
+
+    fn match_stmt(&mut self, value: ExprId, arms: Vec<ArmNode>, span: Span) -> StmtId {
+        let arms = self.ast.push_seq(arms);
+        self.push_stmt(StmtKind::Match { value, arms }, span)
+    }
+
+    fn arm(&mut self, pattern: PatternNode, body: StmtId, span: Span) -> ArmNode {
+        ArmNode {
+            pattern,
+            body,
+            span,
+        }
+    }
+
+    fn pattern(&mut self, pattern: Pattern) -> PatternNode {
+        match pattern {
+            Pattern::Literal(lit) => PatternNode::Literal(self.lit(lit)),
+            Pattern::Identifier(name) => PatternNode::Identifier(self.intern(&name)),
+            Pattern::Wildcard => PatternNode::Wildcard,
+            Pattern::Range { .. } => unreachable!("range patterns go through range_pattern"),
+        }
+    }
+
+    fn range_pattern(&mut self, start: ExprId, end: ExprId) -> PatternNode {
+        PatternNode::Range { start, end }
+    }
+
+    fn assert_stmt(&mut self, condition: ExprId, message: Option<ExprId>, span: Span) -> StmtId {
+        self.push_stmt(StmtKind::Assert { condition, message }, span)
+    }
+
+    fn log(&mut self, level: LogLevel, message: ExprId, extras: Vec<ExprId>, span: Span) -> StmtId {
+        let extras = self.ast.push_seq(extras);
+        self.push_stmt(
+            StmtKind::Log {
+                level,
+                message,
+                extras,
+            },
+            span,
+        )
+    }
+
+    fn hurl(&mut self, message: ExprId, span: Span) -> StmtId {
+        self.push_stmt(StmtKind::Hurl(message), span)
+    }
+
+    fn block(&mut self, statements: Vec<StmtId>, span: Span) -> StmtId {
+        let statements = self.ast.push_seq(statements);
+        self.push_stmt(StmtKind::Block(statements), span)
+    }
+
+    fn expression(&mut self, expr: ExprId, span: Span) -> StmtId {
+        self.push_stmt(StmtKind::Expression(expr), span)
+    }
+
+    fn literal(&mut self, value: Literal, span: Span) -> ExprId {
+        let lit = self.lit(value);
+        self.push_expr(ExprKind::Literal(lit), span)
+    }
+
+    fn variable(&mut self, name: String, span: Span) -> ExprId {
+        let name = self.intern(&name);
+        self.push_expr(ExprKind::Variable(name), span)
+    }
+
+    fn binary(&mut self, left: ExprId, operator: BinaryOp, right: ExprId, span: Span) -> ExprId {
+        self.push_expr(
+            ExprKind::Binary {
+                left,
+                operator,
+                right,
+            },
+            span,
+        )
+    }
+
+    fn unary(&mut self, operator: UnaryOp, operand: ExprId, span: Span) -> ExprId {
+        self.push_expr(ExprKind::Unary { operator, operand }, span)
+    }
+
+    fn logical(&mut self, left: ExprId, operator: LogicalOp, right: ExprId, span: Span) -> ExprId {
+        self.push_expr(
+            ExprKind::Logical {
+                left,
+                operator,
+                right,
+            },
+            span,
+        )
+    }
+
+    fn call(&mut self, callee: ExprId, arguments: Vec<ExprId>, span: Span) -> ExprId {
+        let arguments = self.ast.push_seq(arguments);
+        self.push_expr(ExprKind::Call { callee, arguments }, span)
+    }
+
+    fn get(&mut self, object: ExprId, property: String, span: Span) -> ExprId {
+        let property = self.intern(&property);
+        self.push_expr(ExprKind::Get { object, property }, span)
+    }
+
+    fn index(&mut self, object: ExprId, index: ExprId, span: Span) -> ExprId {
+        self.push_expr(ExprKind::Index { object, index }, span)
+    }
+
+    fn slice(
+        &mut self,
+        object: ExprId,
+        start: Option<ExprId>,
+        end: Option<ExprId>,
+        step: Option<ExprId>,
+        span: Span,
+    ) -> ExprId {
+        self.push_expr(
+            ExprKind::Slice {
+                object,
+                start,
+                end,
+                step,
+            },
+            span,
+        )
+    }
+
+    fn list(&mut self, elements: Vec<ExprId>, span: Span) -> ExprId {
+        let elements = self.ast.push_seq(elements);
+        self.push_expr(ExprKind::List(elements), span)
+    }
+
+    fn dict(&mut self, pairs: Vec<(ExprId, ExprId)>, span: Span) -> ExprId {
+        let flat: Vec<ExprId> = pairs.into_iter().flat_map(|(k, v)| [k, v]).collect();
+        let pairs = self.ast.push_seq(flat);
+        self.push_expr(ExprKind::Dict(pairs), span)
+    }
+
+    fn range(&mut self, start: ExprId, end: ExprId, inclusive: bool, span: Span) -> ExprId {
+        self.push_expr(
+            ExprKind::Range {
+                start,
+                end,
+                inclusive,
+            },
+            span,
+        )
+    }
+
+    fn grouping(&mut self, expr: ExprId, span: Span) -> ExprId {
+        self.push_expr(ExprKind::Grouping(expr), span)
+    }
+
+    fn lambda(&mut self, params: Vec<String>, body: ExprId, span: Span) -> ExprId {
+        let params = self.syms(params);
+        self.push_expr(ExprKind::Lambda { params, body }, span)
+    }
+
+    fn block_expr(&mut self, statements: Vec<StmtId>, span: Span) -> ExprId {
+        let statements = self.ast.push_seq(statements);
+        self.push_expr(ExprKind::BlockExpr(statements), span)
+    }
+
+    fn masel(&mut self, span: Span) -> ExprId {
+        self.push_expr(ExprKind::Masel, span)
+    }
+
+    fn input(&mut self, prompt: ExprId, span: Span) -> ExprId {
+        self.push_expr(ExprKind::Input(prompt), span)
+    }
+
+    fn fstring(&mut self, parts: Vec<FPart>, span: Span) -> ExprId {
+        let parts = self.ast.push_seq(parts);
+        self.push_expr(ExprKind::FString(parts), span)
+    }
+
+    fn text_part(&mut self, text: String) -> FPart {
+        FPart::Text(self.intern(&text))
+    }
+
+    fn expr_part(&mut self, expr: ExprId) -> FPart {
+        FPart::Expr(expr)
+    }
+
+    fn spread(&mut self, expr: ExprId, span: Span) -> ExprId {
+        self.push_expr(ExprKind::Spread(expr), span)
+    }
+
+    fn pipe(&mut self, left: ExprId, right: ExprId, span: Span) -> ExprId {
+        self.push_expr(ExprKind::Pipe { left, right }, span)
+    }
+
+    fn ternary(
+        &mut self,
+        condition: ExprId,
+        then_expr: ExprId,
+        else_expr: ExprId,
+        span: Span,
+    ) -> ExprId {
+        self.push_expr(
+            ExprKind::Ternary {
+                condition,
+                then_expr,
+                else_expr,
+            },
+            span,
+        )
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::lexer::lex;
+    use crate::parser::{parse_arena, Parser};
+
+    const SAMPLE: &str = r#"
+fetch "maths" tae m
+ken greeting = f"Hullo {name}, ye're {age + 1}!"
+ken [first, ...rest, _] = [1, 2.5, "three", aye, nae, naething]
+thing Point { x, y }
+kin Beast {
+    dae init(name, legs = 4) {
+        masel.name = name
+        masel.legs[0] = legs
+    }
+}
+kin Coo fae Beast {
+    dae moo() { gie masel.name }
+}
+dae sum(xs) {
+    ken total = 0
+    fer x in xs[1:-1:2] {
+        gin x > 0 an nae (x == 3) { total = total + x } ither { haud }
+    }
+    whiles total < 0 { brak }
+    gie total
+}
+ken d = {"a": 1, "b": |x, y| x * y}
+ken r = 1..=10 |> tae_list
+ken t = gin sum([1, 2]) >= 3 than speir "aye?" ither -d["a"]
+keek t {
+    whan 1 -> blether "one"
+    whan 2..5 -> blether "few"
+    whan n -> blether n
+    whan _ -> blether "ocht"
+}
+hae_a_bash {
+    hurl "oops"
+} gin_it_gangs_wrang err {
+    mak_siccar err != naething, "should hae an error"
+    log_holler "caught", err
+}
+ken f = |x| {
+    ken y = x
+    gie [...rest, y]
+}
+"#;
+
+    fn boxed(source: &str) -> Program {
+        Parser::new(lex(source).unwrap()).parse().unwrap()
+    }
+
+    #[test]
+    fn test_arena_matches_the_boxed_tree() {
+        let ast = parse_arena(SAMPLE).unwrap();
+        let program = boxed(SAMPLE);
+        assert_eq!(ast.roots().len(), program.statements.len());
+        assert_eq!(format!("{:?}", ast.to_program()), format!("{:?}", program));
+    }
+
+    #[test]
+    fn test_names_are_interned_once_and_nodes_stay_small() {
+        let ast = parse_arena("ken x = 1\nx = x + x\nblether \"x\"\n").unwrap();
+        assert_eq!(ast.sym_ends.len(), 1);
+        assert_eq!(ast.text, "x");
+
+        let variables: Vec<&str> = ast
+            .exprs()
+            .filter_map(|(_, node)| match node.kind {
+                ExprKind::Variable(sym) => Some(ast.sym(sym)),
+                _ => None,
+            })
+            .collect();
+        // The assignment target became the Assign node rather than staying a variable
+        assert_eq!(variables, vec!["x", "x"]);
+        assert!(std::mem::size_of::<ExprNode>() <= 40);
+        assert!(std::mem::size_of::<StmtNode>() <= 40);
+        assert_eq!(ast.stmt(ast.roots()[2]).span(), Span::new(3, 1));
+    }
+
+    #[test]
+    fn test_a_block_tried_as_a_dict_leaves_nothing_behind() {
+        // The lambda body is first tried as a dict, then parsed again as a block
+        let source = "ken f = |y| { y }\n";
+        let ast = parse_arena(source).unwrap();
+        assert_eq!(
+            format!("{:?}", ast.to_program()),
+            format!("{:?}", boxed(source))
+        );
+        assert_eq!(ast.exprs().count(), 3);
+        assert_eq!(ast.stmts().count(), 2);
+    }
+
+    #[test]
+    fn test_compound_assignment_builds_the_same_tree() {
+        let source = "ken n = 1\nn += 2\nn *= n\n";
+        let ast = parse_arena(source).unwrap();
+        assert_eq!(
+            format!("{:?}", ast.to_program()),
+            format!("{:?}", boxed(source))
+        );
+    }
+}
@@ -1381,12 +1381,12 @@ pub fn register_audio_functions(globals: &Rc<RefCell<crate::value::Environment>>
                         sf
                     }
                 }
-                Value::String(path) => load_soundfont(Path::new(path))?,
+                Value::String(path) => load_soundfont(Path::new(&**path))?,
                 _ => return Err("midi_lade needs a soondfont path or naething".to_string()),
             };
 
             let mut midi_file =
-                File::open(&midi_path).map_err(|_| "Cannae open the midi file".to_string())?;
+                File::open(&*midi_path).map_err(|_| "Cannae open the midi file".to_string())?;
             let midi =
                 MidiFile::new(&mut midi_file).map_err(|_| "Cannae read the midi".to_string())?;
             let midi = Arc::new(midi);
@@ -1779,7 +1779,7 @@ mod tests {
 
         assert_eq!(as_handle(&Value::Integer(2), "handle").unwrap(), 2);
         assert!(as_handle(&Value::Integer(-1), "handle").is_err());
-        assert!(as_handle(&Value::String("x".to_string()), "handle").is_err());
+        assert!(as_handle(&Value::String("x".into()), "handle").is_err());
     }
 
     #[test]
@@ -2343,8 +2343,7 @@ mod tests {
         assert_eq!(err, "muisic_lade needs a string path");
 
         let handle = as_handle(
-            &(muisic_lade.func)(vec![Value::String(music_path.to_string_lossy().to_string())])
-                .unwrap(),
+            &(muisic_lade.func)(vec![Value::String(music_path.to_string_lossy().into())]).unwrap(),
             "handle",
         )
         .unwrap() as i64;
@@ -2417,7 +2416,7 @@ mod tests {
         let (handle1, handle2) = with_cwd(dir.path(), || {
             let handle1 = as_handle(
                 &(midi_lade.func)(vec![
-                    Value::String(midi_path.to_string_lossy().to_string()),
+                    Value::String(midi_path.to_string_lossy().into()),
                     Value::Nil,
                 ])
                 .unwrap(),
@@ -2426,7 +2425,7 @@ mod tests {
             .unwrap() as i64;
             let handle2 = as_handle(
                 &(midi_lade.func)(vec![
-                    Value::String(midi_path.to_string_lossy().to_string()),
+                    Value::String(midi_path.to_string_lossy().into()),
                     Value::Nil,
                 ])
                 .unwrap(),
@@ -2494,8 +2493,8 @@ mod tests {
 
         rustysynth::fail_next_midi_file_new();
         let err = (midi_lade.func)(vec![
-            Value::String(midi_path.to_string_lossy().to_string()),
-            Value::String(sf_path.to_string_lossy().to_string()),
+            Value::String(midi_path.to_string_lossy().into()),
+            Value::String(sf_path.to_string_lossy().into()),
         ])
         .unwrap_err();
         assert_eq!(err, "Cannae read the midi");
@@ -2515,8 +2514,8 @@ mod tests {
 
         rustysynth::fail_next_synth_new();
         let err = (midi_lade.func)(vec![
-            Value::String(midi_path.to_string_lossy().to_string()),
-            Value::String(sf_path.to_string_lossy().to_string()),
+            Value::String(midi_path.to_string_lossy().into()),
+            Value::String(sf_path.to_string_lossy().into()),
         ])
         .unwrap_err();
         assert_eq!(err, "Cannae set up the synth");
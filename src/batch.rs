@@ -0,0 +1,173 @@
+//! Running `check` and `fmt` over many files at once
+//!
+//! Files are handed out to worker threads from a shared counter, and each result lands
+//! back in its file's slot, so the output comes out in the same order no matter which
+//! thread finished first.
+
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::thread;
+
+/// Directories never searched for `.braw` files
+const SKIPPED_DIRS: [&str; 3] = [".git", "target", "node_modules"];
+
+/// How many threads to use when `--jobs` isn't given
+pub fn default_jobs() -> usize {
+    thread::available_parallelism().map_or(1, |n| n.get())
+}
+
+/// Run job on every item across up to `jobs` threads, returning the results in item order
+pub fn par_map<T, R, F>(items: &[T], jobs: usize, job: F) -> Vec<R>
+where
+    T: Sync,
+    R: Send,
+    F: Fn(&T) -> R + Sync,
+{
+    let workers = jobs.clamp(1, items.len().max(1));
+    if workers == 1 {
+        return items.iter().map(job).collect();
+    }
+
+    let next = AtomicUsize::new(0);
+    let mut done: Vec<(usize, R)> = thread::scope(|scope| {
+        let handles: Vec<_> = (0..workers)
+            .map(|_| {
+                scope.spawn(|| {
+                    let mut mine = Vec::new();
+                    loop {
+                        let i = next.fetch_add(1, Ordering::Relaxed);
+                        let Some(item) = items.get(i) else {
+                            break;
+                        };
+                        mine.push((i, job(item)));
+                    }
+                    mine
+                })
+            })
+            .collect();
+        handles
+            .into_iter()
+            .flat_map(|handle| handle.join().expect("worker thread panicked"))
+            .collect()
+    });
+    done.sort_by_key(|(i, _)| *i);
+    done.into_iter().map(|(_, result)| result).collect()
+}
+
+/// The files named on the command line, with each directory swapped for the `.braw`
+/// files under it (sorted, so runs are repeatable). Other paths are kept as they are,
+/// so a missing file still gets reported when it's read.
+pub fn expand_paths(paths: &[PathBuf]) -> Vec<PathBuf> {
+    let mut files = Vec::new();
+    for path in paths {
+        if path.is_dir() {
+            let mut found = Vec::new();
+            collect_braw_files(path, &mut found);
+            found.sort();
+            files.extend(found);
+        } else {
+            files.push(path.clone());
+        }
+    }
+    files
+}
+
+fn collect_braw_files(dir: &Path, out: &mut Vec<PathBuf>) {
+    let Ok(entries) = fs::read_dir(dir) else {
+        return;
+    };
+    for entry in entries.flatten() {
+        let path = entry.path();
+        if path.is_dir() {
+            let skipped = path
+                .file_name()
+                .and_then(|name| name.to_str())
+                .is_some_and(|name| SKIPPED_DIRS.contains(&name));
+            if !skipped {
+                collect_braw_files(&path, out);
+            }
+        } else if path.extension().is_some_and(|ext| ext == "braw") {
+            out.push(path);
+        }
+    }
+}
+
+/// Find the file a `fetch` in importer refers to: next to it, in a directory above
+/// it, or in a `stdlib/` above it (with or without a leading `lib/`), as the interpreter
+/// looks
+pub fn resolve_import(importer: &Path, module: &str) -> Option<PathBuf> {
+    let mut module_path = PathBuf::from(module);
+    if module_path.extension().is_none() {
+        module_path.set_extension("braw");
+    }
+    if module_path.is_absolute() {
+        return module_path.is_file().then_some(module_path);
+    }
+    let stripped = module_path.strip_prefix("lib").ok().map(Path::to_path_buf);
+    let dir = importer.parent().unwrap_or(Path::new("."));
+    for ancestor in dir.ancestors() {
+        let stdlib = ancestor.join("stdlib");
+        let candidates = [
+            Some(ancestor.join(&module_path)),
+            Some(stdlib.join(&module_path)),
+            stripped.as_ref().map(|s| stdlib.join(s)),
+        ];
+        if let Some(found) = candidates.into_iter().flatten().find(|c| c.is_file()) {
+            return Some(found);
+        }
+    }
+    None
+}
+
+/// A path's canonical form, for telling whether two imports are the same file
+pub fn canonical(path: &Path) -> PathBuf {
+    fs::canonicalize(path).unwrap_or_else(|_| path.to_path_buf())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn par_map_keeps_item_order() {
+        let items: Vec<u64> = (0..200).collect();
+        let squares = par_map(&items, 8, |n| {
+            // Uneven work, so threads finish out of order
+            thread::sleep(std::time::Duration::from_micros(200 - n));
+            n * n
+        });
+        assert_eq!(squares, items.iter().map(|n| n * n).collect::<Vec<_>>());
+        assert!(par_map(&[] as &[u64], 4, |n| *n).is_empty());
+    }
+
+    #[test]
+    fn expand_paths_and_resolve_import_find_braw_files() {
+        let dir = std::env::temp_dir().join(format!("mdh_batch_{}", std::process::id()));
+        let _ = fs::remove_dir_all(&dir);
+        fs::create_dir_all(dir.join("app/target")).unwrap();
+        fs::create_dir_all(dir.join("stdlib")).unwrap();
+        fs::write(dir.join("app/b.braw"), "").unwrap();
+        fs::write(dir.join("app/a.braw"), "").unwrap();
+        fs::write(dir.join("app/notes.txt"), "").unwrap();
+        fs::write(dir.join("app/target/skip.braw"), "").unwrap();
+        fs::write(dir.join("stdlib/colours.braw"), "").unwrap();
+
+        let missing = dir.join("missing.braw");
+        let files = expand_paths(&[dir.join("app"), missing.clone()]);
+        assert_eq!(
+            files,
+            vec![dir.join("app/a.braw"), dir.join("app/b.braw"), missing]
+        );
+
+        let importer = dir.join("app/a.braw");
+        assert_eq!(resolve_import(&importer, "b"), Some(dir.join("app/b.braw")));
+        assert_eq!(
+            resolve_import(&importer, "lib/colours"),
+            Some(dir.join("stdlib/colours.braw"))
+        );
+        assert_eq!(resolve_import(&importer, "nowhere"), None);
+
+        let _ = fs::remove_dir_all(&dir);
+    }
+}
@@ -0,0 +1,493 @@
+//! Binary log records (`log_init({"format": "binary"})`) and the decoder behind
+//! `mdhavers log-decode`.
+//!
+//! A file starts with [`MAGIC`], then holds frames (integers little-endian, every string a
+//! u32 length plus UTF-8 bytes):
+//!
+//! - `'H'` u64 wall_ns, u64 mono_ns: a session start, pairing the realtime clock with the
+//!   monotonic one records are stamped with. Each `log_init` that opens the file adds one.
+//! - `'C'` u32 id, str file, u32 line, str target: a callsite, written before its first
+//!   record. Ids restart with each session.
+//! - `'R'` u8 level, u64 mono_ns, u32 callsite, value message, value fields, str span.
+//!
+//! Values are a tag byte and a payload: 0 nil, 1 false, 2 true, 3 i64, 4 f64, 5 str,
+//! 6 list (u32 count, values), 7 dict (u32 count, key/value pairs) and 8 str for anything
+//! else, as blether prints it. The native runtime writes the same layout.
+
+use std::collections::HashMap;
+use std::io::{self, Read};
+use std::time::{Instant, SystemTime, UNIX_EPOCH};
+
+use chrono::{Local, TimeZone};
+use serde_json::{Map, Value as JsonValue};
+
+use crate::logging::LogRecord;
+use crate::value::Value;
+
+pub const MAGIC: &[u8; 8] = b"MDHLOG\x00\x01";
+
+/// Encodes interpreter log records; one writer is one session.
+#[derive(Debug)]
+pub struct BinlogWriter {
+    start: Instant,
+    wall_ns: u64,
+    callsites: HashMap<(String, u32, String), u32>,
+}
+
+impl BinlogWriter {
+    pub fn new() -> Self {
+        let wall_ns = SystemTime::now()
+            .duration_since(UNIX_EPOCH)
+            .map(|d| d.as_nanos() as u64)
+            .unwrap_or(0);
+        BinlogWriter {
+            start: Instant::now(),
+            wall_ns,
+            callsites: HashMap::new(),
+        }
+    }
+
+    /// The `'H'` frame opening this session; monotonic time counts from the writer's creation.
+    pub fn session_header(&self) -> Vec<u8> {
+        let mut out = vec![b'H'];
+        out.extend_from_slice(&self.wall_ns.to_le_bytes());
+        out.extend_from_slice(&0u64.to_le_bytes());
+        out
+    }
+
+    /// One record, preceded by its callsite frame the first time the callsite is seen.
+    pub fn encode(&mut self, record: &LogRecord) -> Vec<u8> {
+        let mut out = Vec::new();
+        let line = record.line as u32;
+        let key = (record.file.clone(), line, record.target.clone());
+        let next = self.callsites.len() as u32 + 1;
+        let id = *self.callsites.entry(key).or_insert_with(|| {
+            out.push(b'C');
+            out.extend_from_slice(&next.to_le_bytes());
+            put_str(&mut out, &record.file);
+            out.extend_from_slice(&line.to_le_bytes());
+            put_str(&mut out, &record.target);
+            next
+        });
+        out.push(b'R');
+        out.push(record.level as u8);
+        out.extend_from_slice(&(self.start.elapsed().as_nanos() as u64).to_le_bytes());
+        out.extend_from_slice(&id.to_le_bytes());
+        out.push(5);
+        put_str(&mut out, &record.message);
+        if record.fields.is_empty() {
+            out.push(0);
+        } else {
+            out.push(7);
+            out.extend_from_slice(&(record.fields.len() as u32).to_le_bytes());
+            for (k, v) in &record.fields {
+                out.push(5);
+                put_str(&mut out, k);
+                put_value(&mut out, v);
+            }
+        }
+        put_str(&mut out, &record.span_path.join(">"));
+        out
+    }
+}
+
+impl Default for BinlogWriter {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+fn put_str(out: &mut Vec<u8>, s: &str) {
+    out.extend_from_slice(&(s.len() as u32).to_le_bytes());
+    out.extend_from_slice(s.as_bytes());
+}
+
+fn put_value(out: &mut Vec<u8>, value: &Value) {
+    match value {
+        Value::Nil => out.push(0),
+        Value::Bool(b) => out.push(if *b { 2 } else { 1 }),
+        Value::Integer(n) => {
+            out.push(3);
+            out.extend_from_slice(&n.to_le_bytes());
+        }
+        Value::Float(f) => {
+            out.push(4);
+            out.extend_from_slice(&f.to_bits().to_le_bytes());
+        }
+        Value::String(s) => {
+            out.push(5);
+            put_str(out, s);
+        }
+        Value::List(list) => {
+            let list = list.borrow();
+            out.push(6);
+            out.extend_from_slice(&(list.len() as u32).to_le_bytes());
+            for item in list.iter() {
+                put_value(out, item);
+            }
+        }
+        Value::Dict(dict) => {
+            let dict = dict.borrow();
+            out.push(7);
+            out.extend_from_slice(&(dict.len() as u32).to_le_bytes());
+            for (k, v) in dict.iter() {
+                put_value(out, k);
+                put_value(out, v);
+            }
+        }
+        other => {
+            out.push(8);
+            put_str(out, &other.to_string());
+        }
+    }
+}
+
+#[derive(Debug, Clone, PartialEq)]
+pub enum BinValue {
+    Nil,
+    Bool(bool),
+    Int(i64),
+    Float(f64),
+    Str(String),
+    List(Vec<BinValue>),
+    Dict(Vec<(BinValue, BinValue)>),
+    /// A value the writer could only describe, kept as it printed.
+    Other(String),
+}
+
+impl std::fmt::Display for BinValue {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        match self {
+            BinValue::Nil => write!(f, "naething"),
+            BinValue::Bool(true) => write!(f, "aye"),
+            BinValue::Bool(false) => write!(f, "nae"),
+            BinValue::Int(n) => write!(f, "{}", n),
+            BinValue::Float(x) => write!(f, "{}", x),
+            BinValue::Str(s) | BinValue::Other(s) => write!(f, "{}", s),
+            BinValue::List(items) => {
+                let strs: Vec<String> = items.iter().map(|v| v.to_string()).collect();
+                write!(f, "[{}]", strs.join(", "))
+            }
+            BinValue::Dict(entries) => {
+                let strs: Vec<String> = entries
+                    .iter()
+                    .map(|(k, v)| format!("\"{}\": {}", k, v))
+                    .collect();
+                write!(f, "{{{}}}", strs.join(", "))
+            }
+        }
+    }
+}
+
+impl BinValue {
+    pub fn to_json(&self) -> JsonValue {
+        match self {
+            BinValue::Nil => JsonValue::Null,
+            BinValue::Bool(b) => JsonValue::Bool(*b),
+            BinValue::Int(n) => JsonValue::from(*n),
+            BinValue::Float(x) => JsonValue::from(*x),
+            BinValue::Str(s) | BinValue::Other(s) => JsonValue::String(s.clone()),
+            BinValue::List(items) => {
+                JsonValue::Array(items.iter().map(BinValue::to_json).collect())
+            }
+            BinValue::Dict(entries) => {
+                let mut map = Map::new();
+                for (k, v) in entries {
+                    let key = match k {
+                        BinValue::Str(s) => s.clone(),
+                        other => other.to_string(),
+                    };
+                    map.insert(key, v.to_json());
+                }
+                JsonValue::Object(map)
+            }
+        }
+    }
+}
+
+#[derive(Debug, Clone, PartialEq)]
+pub struct BinRecord {
+    pub level: u8,
+    /// Wall-clock time, nanoseconds since the Unix epoch.
+    pub wall_ns: u64,
+    pub file: String,
+    pub line: u32,
+    pub target: String,
+    pub message: BinValue,
+    pub fields: BinValue,
+    pub span: String,
+}
+
+impl BinRecord {
+    pub fn level_name(&self) -> &'static str {
+        match self.level {
+            0 => "WHEESHT",
+            1 => "ROAR",
+            2 => "HOLLER",
+            4 => "MUTTER",
+            5 => "WHISPER",
+            _ => "BLETHER",
+        }
+    }
+
+    fn timestamp(&self) -> String {
+        let secs = (self.wall_ns / 1_000_000_000) as i64;
+        let nanos = (self.wall_ns % 1_000_000_000) as u32;
+        match Local.timestamp_opt(secs, nanos).single() {
+            Some(t) => t.format("%Y-%m-%d %H:%M:%S%.3f").to_string(),
+            None => String::new(),
+        }
+    }
+
+    /// The line the text format would have written, with the recorded time.
+    pub fn to_text(&self) -> String {
+        let mut out = format!(
+            "[{}] {} {} {}:{} | {}",
+            self.level_name(),
+            self.timestamp(),
+            self.target,
+            self.file,
+            self.line,
+            self.message
+        );
+        if matches!(self.fields, BinValue::Dict(_)) {
+            out.push(' ');
+            out.push_str(&self.fields.to_string());
+        }
+        if !self.span.is_empty() {
+            out.push_str(" span=");
+            out.push_str(&self.span);
+        }
+        out
+    }
+
+    /// The JSON format's record, with the recorded time added as "ts".
+    pub fn to_json(&self) -> String {
+        let fields = [
+            ("ts", JsonValue::String(self.timestamp())),
+            ("level", JsonValue::String(self.level_name().to_string())),
+            ("message", JsonValue::String(self.message.to_string())),
+            ("target", JsonValue::String(self.target.clone())),
+            ("file", JsonValue::String(self.file.clone())),
+            ("line", JsonValue::from(self.line)),
+            ("fields", self.fields.to_json()),
+            ("span", JsonValue::String(self.span.clone())),
+        ];
+        let parts: Vec<String> = fields
+            .iter()
+            .map(|(k, v)| format!("{}: {}", JsonValue::String(k.to_string()), v))
+            .collect();
+        format!("{{{}}}", parts.join(", "))
+    }
+}
+
+/// Reads records back out of a binary log, one frame at a time.
+pub struct BinlogReader<R: Read> {
+    input: R,
+    /// Session clock pair: (wall_ns, mono_ns).
+    clock: (u64, u64),
+    callsites: HashMap<u32, (String, u32, String)>,
+}
+
+fn bad(msg: &str) -> io::Error {
+    io::Error::new(io::ErrorKind::InvalidData, msg.to_string())
+}
+
+impl<R: Read> BinlogReader<R> {
+    pub fn new(mut input: R) -> io::Result<Self> {
+        let mut magic = [0u8; 8];
+        input.read_exact(&mut magic)?;
+        if &magic != MAGIC {
+            return Err(bad("not an mdhavers binary log"));
+        }
+        Ok(BinlogReader {
+            input,
+            clock: (0, 0),
+            callsites: HashMap::new(),
+        })
+    }
+
+    fn u8(&mut self) -> io::Result<u8> {
+        let mut b = [0u8; 1];
+        self.input.read_exact(&mut b)?;
+        Ok(b[0])
+    }
+
+    fn u32(&mut self) -> io::Result<u32> {
+        let mut b = [0u8; 4];
+        self.input.read_exact(&mut b)?;
+        Ok(u32::from_le_bytes(b))
+    }
+
+    fn u64(&mut self) -> io::Result<u64> {
+        let mut b = [0u8; 8];
+        self.input.read_exact(&mut b)?;
+        Ok(u64::from_le_bytes(b))
+    }
+
+    fn string(&mut self) -> io::Result<String> {
+        let len = self.u32()? as usize;
+        let mut buf = Vec::new();
+        (&mut self.input).take(len as u64).read_to_end(&mut buf)?;
+        if buf.len() != len {
+            return Err(io::ErrorKind::UnexpectedEof.into());
+        }
+        Ok(String::from_utf8_lossy(&buf).into_owned())
+    }
+
+    fn value(&mut self) -> io::Result<BinValue> {
+        Ok(match self.u8()? {
+            0 => BinValue::Nil,
+            1 => BinValue::Bool(false),
+            2 => BinValue::Bool(true),
+            3 => BinValue::Int(self.u64()? as i64),
+            4 => BinValue::Float(f64::from_bits(self.u64()?)),
+            5 => BinValue::Str(self.string()?),
+            6 => {
+                let n = self.u32()?;
+                let mut items = Vec::new();
+                for _ in 0..n {
+                    items.push(self.value()?);
+                }
+                BinValue::List(items)
+            }
+            7 => {
+                let n = self.u32()?;
+                let mut entries = Vec::new();
+                for _ in 0..n {
+                    let k = self.value()?;
+                    entries.push((k, self.value()?));
+                }
+                BinValue::Dict(entries)
+            }
+            8 => BinValue::Other(self.string()?),
+            _ => return Err(bad("unknown value tag")),
+        })
+    }
+
+    /// The next record, or None at the end of the file.
+    pub fn next_record(&mut self) -> io::Result<Option<BinRecord>> {
+        loop {
+            let kind = match self.u8() {
+                Ok(kind) => kind,
+                Err(e) if e.kind() == io::ErrorKind::UnexpectedEof => return Ok(None),
+                Err(e) => return Err(e),
+            };
+            match kind {
+                b'H' => {
+                    self.clock = (self.u64()?, self.u64()?);
+                    self.callsites.clear();
+                }
+                b'C' => {
+                    let id = self.u32()?;
+                    let file = self.string()?;
+                    let line = self.u32()?;
+                    let target = self.string()?;
+                    self.callsites.insert(id, (file, line, target));
+                }
+                b'R' => {
+                    let level = self.u8()?;
+                    let mono_ns = self.u64()?;
+                    let site = self.u32()?;
+                    let message = self.value()?;
+                    let fields = self.value()?;
+                    let span = self.string()?;
+                    let (file, line, target) =
+                        self.callsites.get(&site).cloned().unwrap_or_default();
+                    let (wall, mono) = self.clock;
+                    return Ok(Some(BinRecord {
+                        level,
+                        wall_ns: wall.wrapping_add(mono_ns.wrapping_sub(mono)),
+                        file,
+                        line,
+                        target,
+                        message,
+                        fields,
+                        span,
+                    }));
+                }
+                _ => return Err(bad("unknown frame")),
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::ast::LogLevel;
+
+    fn decode_all(bytes: &[u8]) -> Vec<BinRecord> {
+        let mut reader = BinlogReader::new(bytes).unwrap();
+        let mut out = Vec::new();
+        while let Some(record) = reader.next_record().unwrap() {
+            out.push(record);
+        }
+        out
+    }
+
+    #[test]
+    fn writer_output_decodes_with_callsites_interned() {
+        let mut writer = BinlogWriter::new();
+        let mut bytes = MAGIC.to_vec();
+        bytes.extend(writer.session_header());
+        let mut record = LogRecord {
+            level: LogLevel::Roar,
+            message: "boom".to_string(),
+            target: "net".to_string(),
+            file: "a.braw".to_string(),
+            line: 3,
+            fields: vec![
+                ("n".to_string(), Value::Integer(7)),
+                ("ok".to_string(), Value::Bool(true)),
+            ],
+            span_path: vec!["outer".to_string()],
+        };
+        let first = writer.encode(&record);
+        record.message = "again".to_string();
+        record.fields.clear();
+        record.span_path.clear();
+        let second = writer.encode(&record);
+        assert_eq!(first[0], b'C');
+        assert_eq!(second[0], b'R');
+        bytes.extend(first);
+        bytes.extend(second);
+
+        let records = decode_all(&bytes);
+        assert_eq!(records.len(), 2);
+        assert_eq!(records[0].file, "a.braw");
+        assert_eq!(records[1].target, "net");
+        assert!(records[1].wall_ns >= records[0].wall_ns);
+        let text = records[0].to_text();
+        assert!(text.starts_with("[ROAR] "), "got {}", text);
+        assert!(
+            text.ends_with(r#"net a.braw:3 | boom {"n": 7, "ok": aye} span=outer"#),
+            "got {}",
+            text
+        );
+        let json: JsonValue = serde_json::from_str(&records[1].to_json()).unwrap();
+        assert_eq!(json["message"], "again");
+        assert_eq!(json["fields"], JsonValue::Null);
+        assert_eq!(json["line"], 3);
+    }
+
+    #[test]
+    fn reader_rejects_foreign_files_and_truncated_frames() {
+        assert!(BinlogReader::new(&b"not a log"[..]).is_err());
+        let mut writer = BinlogWriter::new();
+        let mut bytes = MAGIC.to_vec();
+        bytes.extend(writer.session_header());
+        let record = writer.encode(&LogRecord {
+            level: LogLevel::Blether,
+            message: "hi".to_string(),
+            target: String::new(),
+            file: "f".to_string(),
+            line: 1,
+            fields: Vec::new(),
+            span_path: Vec::new(),
+        });
+        bytes.extend(&record[..record.len() - 2]);
+        let mut reader = BinlogReader::new(&bytes[..]).unwrap();
+        assert!(reader.next_record().is_err());
+    }
+}
@@ -1,11 +1,120 @@
+use std::collections::HashSet;
+
 use crate::ast::*;
 use crate::error::{HaversError, HaversResult};
 
+/// The `__havers` helpers brought into the program's scope, in the order they're bound
+const RUNTIME_EXPORTS: &[&str] = &[
+    "len",
+    "whit_kind",
+    "tae_string",
+    "tae_int",
+    "tae_float",
+    "shove",
+    "yank",
+    "keys",
+    "values",
+    "range",
+    "abs",
+    "min",
+    "max",
+    "floor",
+    "ceil",
+    "round",
+    "sqrt",
+    "split",
+    "join",
+    "contains",
+    "reverse",
+    "sort",
+    "blether",
+    "set_log_level",
+    "get_log_level",
+    "log_set_filter",
+    "log_get_filter",
+    "log_enabled",
+    "log_event",
+    "log_init",
+    "log_span",
+    "log_span_enter",
+    "log_span_exit",
+    "log_span_current",
+    "log_span_in",
+    "speir",
+    "heid",
+    "tail",
+    "bum",
+    "scran",
+    "slap",
+    "sumaw",
+    "coont",
+    "wheesht",
+    "upper",
+    "lower",
+    "shuffle",
+    "noo",
+    "tick",
+    "bide",
+    "gaun",
+    "sieve",
+    "tumble",
+    "aw",
+    "ony",
+    "hunt",
+    "soond_stairt",
+    "soond_steek",
+    "soond_wheesht",
+    "soond_luid",
+    "soond_hou_luid",
+    "soond_haud_gang",
+    "soond_lade",
+    "soond_spiel",
+    "soond_haud",
+    "soond_gae_on",
+    "soond_stap",
+    "soond_unlade",
+    "soond_is_spielin",
+    "soond_pit_luid",
+    "soond_pit_pan",
+    "soond_pit_tune",
+    "soond_pit_rin_roond",
+    "soond_ready",
+    "muisic_lade",
+    "muisic_spiel",
+    "muisic_haud",
+    "muisic_gae_on",
+    "muisic_stap",
+    "muisic_unlade",
+    "muisic_is_spielin",
+    "muisic_loup",
+    "muisic_hou_lang",
+    "muisic_whaur",
+    "muisic_pit_luid",
+    "muisic_pit_pan",
+    "muisic_pit_tune",
+    "muisic_pit_rin_roond",
+    "midi_lade",
+    "midi_spiel",
+    "midi_haud",
+    "midi_gae_on",
+    "midi_stap",
+    "midi_unlade",
+    "midi_is_spielin",
+    "midi_loup",
+    "midi_hou_lang",
+    "midi_whaur",
+    "midi_pit_luid",
+    "midi_pit_pan",
+    "midi_pit_rin_roond",
+];
+
 /// Compiler - transpiles mdhavers tae JavaScript
 pub struct Compiler {
     indent: usize,
     output: String,
     match_counter: usize,
+    loop_counter: usize,
+    optimise: bool,
 }
 
 impl Compiler {
@@ -14,14 +123,29 @@ impl Compiler {
             indent: 0,
             output: String::new(),
             match_counter: 0,
+            loop_counter: 0,
+            optimise: false,
         }
     }
 
+    /// Emit leaner JavaScript: only the runtime helpers the program uses (and the audio
+    /// and logging runtimes only when it uses them), `fer` loops over a range as
+    /// counted loops instead of building an array first, and the program run through
+    /// [`crate::optimise`] (constants folded, small functions inlined).
+    pub fn with_optimisation(mut self) -> Self {
+        self.optimise = true;
+        self
+    }
+
     /// Compile a program tae JavaScript
     pub fn compile(&mut self, program: &Program) -> HaversResult<String> {
         self.output.clear();
         self.indent = 0;
         self.match_counter = 0;
+        self.loop_counter = 0;
+
+        let optimised = self.optimise.then(|| crate::optimise::optimise(program));
+        let program = optimised.as_ref().unwrap_or(program);
 
         let mut needs_tri_runtime = false;
         for stmt in &program.statements {
@@ -29,7 +153,8 @@ impl Compiler {
         }
 
         // Add runtime helpers
-        self.emit_runtime(needs_tri_runtime);
+        let used = self.optimise.then(|| runtime_uses(program));
+        self.emit_runtime(needs_tri_runtime, used.as_ref());
 
         // Compile all statements
         for stmt in &program.statements {
@@ -129,17 +254,29 @@ impl Compiler {
         Ok(())
     }
 
-    fn emit_runtime(&mut self, include_tri: bool) {
+    /// Emit the runtime. With `used`, only the helpers it names are kept.
+    fn emit_runtime(&mut self, include_tri: bool, used: Option<&HashSet<String>>) {
+        let wants = |prefixes: &[&str]| {
+            used.map_or(true, |used| {
+                used.iter()
+                    .any(|name| prefixes.iter().any(|p| name.starts_with(p)))
+            })
+        };
         self.emit_line("// mdhavers runtime - pure havers, but working havers!");
-        self.output
-            .push_str(include_str!("../runtime/js/audio_runtime.js"));
-        self.output
-            .push_str(include_str!("../runtime/js/logging_runtime.js"));
+        if wants(&["soond_", "muisic_", "midi_"]) {
+            self.output
+                .push_str(include_str!("../runtime/js/audio_runtime.js"));
+        }
+        if wants(&["log_", "set_log_", "get_log_"]) {
+            self.output
+                .push_str(include_str!("../runtime/js/logging_runtime.js"));
+        }
         // Normalize to exactly one trailing newline before we start emitting runtime bindings.
         while self.output.ends_with('\n') {
             self.output.pop();
         }
         self.output.push('\n');
+        let object_start = self.output.len();
         self.emit_line("const __havers = {");
         self.indent += 1;
 
@@ -496,6 +633,10 @@ impl Compiler {
 
         self.indent -= 1;
         self.emit_line("};");
+        if let Some(used) = used {
+            let object = self.output.split_off(object_start);
+            self.output.push_str(&shake_runtime_object(&object, used));
+        }
         self.emit_line("");
 
         if include_tri {
@@ -586,7 +727,14 @@ impl Compiler {
         }
 
         // Import runtime functions to global scope
-        self.emit_line("const { len, whit_kind, tae_string, tae_int, tae_float, shove, yank, keys, values, range, abs, min, max, floor, ceil, round, sqrt, split, join, contains, reverse, sort, blether, set_log_level, get_log_level, log_set_filter, log_get_filter, log_enabled, log_event, log_init, log_span, log_span_enter, log_span_exit, log_span_current, log_span_in, speir, heid, tail, bum, scran, slap, sumaw, coont, wheesht, upper, lower, shuffle, noo, tick, bide, gaun, sieve, tumble, aw, ony, hunt, soond_stairt, soond_steek, soond_wheesht, soond_luid, soond_hou_luid, soond_haud_gang, soond_lade, soond_spiel, soond_haud, soond_gae_on, soond_stap, soond_unlade, soond_is_spielin, soond_pit_luid, soond_pit_pan, soond_pit_tune, soond_pit_rin_roond, soond_ready, muisic_lade, muisic_spiel, muisic_haud, muisic_gae_on, muisic_stap, muisic_unlade, muisic_is_spielin, muisic_loup, muisic_hou_lang, muisic_whaur, muisic_pit_luid, muisic_pit_pan, muisic_pit_tune, muisic_pit_rin_roond, midi_lade, midi_spiel, midi_haud, midi_gae_on, midi_stap, midi_unlade, midi_is_spielin, midi_loup, midi_hou_lang, midi_whaur, midi_pit_luid, midi_pit_pan, midi_pit_rin_roond } = __havers;");
+        let exports: Vec<&str> = RUNTIME_EXPORTS
+            .iter()
+            .copied()
+            .filter(|name| used.map_or(true, |used| used.contains(*name)))
+            .collect();
+        if !exports.is_empty() {
+            self.emit_line(&format!("const {{ {} }} = __havers;", exports.join(", ")));
+        }
         self.emit_line("");
     }
 
@@ -656,6 +804,42 @@ impl Compiler {
                 body,
                 ..
             } => {
+                if let (
+                    true,
+                    Expr::Range {
+                        start,
+                        end,
+                        inclusive,
+                        ..
+                    },
+                ) = (self.optimise, iterable)
+                {
+                    // A counted loop, with the variable bound fresh each time round as
+                    // `for...of` would, so closures and reassignments behave the same
+                    let counter = format!("__fer_{}", self.loop_counter);
+                    self.loop_counter += 1;
+                    self.emit_indent();
+                    self.output.push_str(&format!("for (let {} = ", counter));
+                    self.compile_expr(start);
+                    self.output.push_str(&format!(", {}_end = ", counter));
+                    if *inclusive {
+                        self.output.push('(');
+                        self.compile_expr(end);
+                        self.output.push_str(" + 1)");
+                    } else {
+                        self.compile_expr(end);
+                    }
+                    self.output
+                        .push_str(&format!("; {0} < {0}_end; {0}++) {{\n", counter));
+                    self.indent += 1;
+                    self.emit_line(&format!("const {} = {};", variable, counter));
+                    self.emit_indent();
+                    self.compile_stmt_inline(body);
+                    self.output.push('\n');
+                    self.indent -= 1;
+                    self.emit_line("}");
+                    return;
+                }
                 self.emit_indent();
                 self.output
                     .push_str(&format!("for (const {} of ", variable));
@@ -1349,6 +1533,261 @@ impl Default for Compiler {
     }
 }
 
+/// The runtime helpers a program needs: the names it refers to, plus the ones its
+/// statements and expressions compile into calls on
+fn runtime_uses(program: &Program) -> HashSet<String> {
+    let mut used = HashSet::new();
+    for stmt in &program.statements {
+        stmt_runtime_uses(stmt, &mut used);
+    }
+    used
+}
+
+fn stmt_runtime_uses(stmt: &Stmt, used: &mut HashSet<String>) {
+    match stmt {
+        Stmt::VarDecl { initializer, .. } => {
+            if let Some(init) = initializer {
+                expr_runtime_uses(init, used);
+            }
+        }
+        Stmt::Expression { expr, .. } | Stmt::Hurl { message: expr, .. } => {
+            expr_runtime_uses(expr, used)
+        }
+        Stmt::Block { statements, .. } => {
+            for s in statements {
+                stmt_runtime_uses(s, used);
+            }
+        }
+        Stmt::If {
+            condition,
+            then_branch,
+            else_branch,
+            ..
+        } => {
+            expr_runtime_uses(condition, used);
+            stmt_runtime_uses(then_branch, used);
+            if let Some(else_branch) = else_branch {
+                stmt_runtime_uses(else_branch, used);
+            }
+        }
+        Stmt::While {
+            condition, body, ..
+        } => {
+            expr_runtime_uses(condition, used);
+            stmt_runtime_uses(body, used);
+        }
+        Stmt::For { iterable, body, .. } => {
+            // A range that is the loop's iterable becomes a counted loop, no `range()` call
+            match iterable {
+                Expr::Range { start, end, .. } => {
+                    expr_runtime_uses(start, used);
+                    expr_runtime_uses(end, used);
+                }
+                _ => expr_runtime_uses(iterable, used),
+            }
+            stmt_runtime_uses(body, used);
+        }
+        Stmt::Function { params, body, .. } => {
+            for param in params {
+                if let Some(default) = &param.default {
+                    expr_runtime_uses(default, used);
+                }
+            }
+            for s in body {
+                stmt_runtime_uses(s, used);
+            }
+        }
+        Stmt::Return { value, .. } => {
+            if let Some(value) = value {
+                expr_runtime_uses(value, used);
+            }
+        }
+        Stmt::Print { value, .. } => {
+            used.insert("blether".to_string());
+            expr_runtime_uses(value, used);
+        }
+        Stmt::Class { methods, .. } => {
+            for s in methods {
+                stmt_runtime_uses(s, used);
+            }
+        }
+        Stmt::TryCatch {
+            try_block,
+            catch_block,
+            ..
+        } => {
+            stmt_runtime_uses(try_block, used);
+            stmt_runtime_uses(catch_block, used);
+        }
+        Stmt::Match { value, arms, .. } => {
+            expr_runtime_uses(value, used);
+            for arm in arms {
+                if let Pattern::Range { start, end } = &arm.pattern {
+                    expr_runtime_uses(start, used);
+                    expr_runtime_uses(end, used);
+                }
+                stmt_runtime_uses(&arm.body, used);
+            }
+        }
+        Stmt::Assert {
+            condition, message, ..
+        } => {
+            expr_runtime_uses(condition, used);
+            if let Some(message) = message {
+                expr_runtime_uses(message, used);
+            }
+        }
+        Stmt::Destructure { value, .. } => expr_runtime_uses(value, used),
+        Stmt::Log {
+            level,
+            message,
+            extras,
+            ..
+        } => {
+            if *level != LogLevel::Wheesht {
+                used.insert("log_event".to_string());
+            }
+            expr_runtime_uses(message, used);
+            for extra in extras {
+                expr_runtime_uses(extra, used);
+            }
+        }
+        Stmt::Break { .. } | Stmt::Continue { .. } | Stmt::Struct { .. } | Stmt::Import { .. } => {}
+    }
+}
+
+fn expr_runtime_uses(expr: &Expr, used: &mut HashSet<String>) {
+    match expr {
+        Expr::Variable { name, .. } => {
+            used.insert(name.clone());
+        }
+        Expr::Literal { .. } | Expr::Masel { .. } => {}
+        Expr::Assign { value: e, .. }
+        | Expr::Unary { operand: e, .. }
+        | Expr::Get { object: e, .. }
+        | Expr::Grouping { expr: e, .. }
+        | Expr::Lambda { body: e, .. }
+        | Expr::Spread { expr: e, .. } => expr_runtime_uses(e, used),
+        Expr::Binary { left, right, .. }
+        | Expr::Logical { left, right, .. }
+        | Expr::Pipe { left, right, .. }
+        | Expr::Set {
+            object: left,
+            value: right,
+            ..
+        }
+        | Expr::Index {
+            object: left,
+            index: right,
+            ..
+        } => {
+            expr_runtime_uses(left, used);
+            expr_runtime_uses(right, used);
+        }
+        Expr::Call {
+            callee, arguments, ..
+        } => {
+            expr_runtime_uses(callee, used);
+            for arg in arguments {
+                expr_runtime_uses(arg, used);
+            }
+        }
+        Expr::IndexSet {
+            object,
+            index,
+            value,
+            ..
+        } => {
+            expr_runtime_uses(object, used);
+            expr_runtime_uses(index, used);
+            expr_runtime_uses(value, used);
+        }
+        Expr::Slice {
+            object,
+            start,
+            end,
+            step,
+            ..
+        } => {
+            if step.is_some() {
+                used.insert("slice".to_string());
+            }
+            expr_runtime_uses(object, used);
+            for e in [start, end, step].into_iter().flatten() {
+                expr_runtime_uses(e, used);
+            }
+        }
+        Expr::List { elements, .. } => {
+            for e in elements {
+                expr_runtime_uses(e, used);
+            }
+        }
+        Expr::Dict { pairs, .. } => {
+            for (key, value) in pairs {
+                expr_runtime_uses(key, used);
+                expr_runtime_uses(value, used);
+            }
+        }
+        Expr::Range { start, end, .. } => {
+            used.insert("range".to_string());
+            expr_runtime_uses(start, used);
+            expr_runtime_uses(end, used);
+        }
+        Expr::BlockExpr { statements, .. } => {
+            for s in statements {
+                stmt_runtime_uses(s, used);
+            }
+        }
+        Expr::Input { prompt, .. } => {
+            used.insert("speir".to_string());
+            expr_runtime_uses(prompt, used);
+        }
+        Expr::FString { parts, .. } => {
+            for part in parts {
+                if let FStringPart::Expr(e) = part {
+                    expr_runtime_uses(e, used);
+                }
+            }
+        }
+        Expr::Ternary {
+            condition,
+            then_expr,
+            else_expr,
+            ..
+        } => {
+            expr_runtime_uses(condition, used);
+            expr_runtime_uses(then_expr, used);
+            expr_runtime_uses(else_expr, used);
+        }
+    }
+}
+
+/// Drop the entries of the emitted `const __havers = { ... };` that aren't in used. Each
+/// entry starts with `name:` at the object's own indent; deeper lines, and the closing
+/// brace at that indent, belong to the entry above them. Comments are dropped.
+fn shake_runtime_object(object: &str, used: &HashSet<String>) -> String {
+    let mut shaken = String::with_capacity(object.len());
+    let mut keep = true;
+    for line in object.split_inclusive('\n') {
+        if let Some(entry) = line.strip_prefix("  ").filter(|l| !l.starts_with(' ')) {
+            if entry.starts_with("//") {
+                continue;
+            }
+            if let Some((name, _)) = entry.split_once(':') {
+                if name.chars().all(|c| c.is_ascii_alphanumeric() || c == '_') {
+                    keep = used.contains(name);
+                }
+            }
+        } else if !line.starts_with(' ') {
+            keep = true;
+        }
+        if keep {
+            shaken.push_str(line);
+        }
+    }
+    shaken
+}
+
 /// Compile mdhavers source tae JavaScript
 pub fn compile(source: &str) -> HaversResult<String> {
     let program = crate::parser::parse(source)?;
@@ -1356,6 +1795,13 @@ pub fn compile(source: &str) -> HaversResult<String> {
     compiler.compile(&program)
 }
 
+/// Compile mdhavers source to leaner JavaScript (see [`Compiler::with_optimisation`])
+pub fn compile_optimised(source: &str) -> HaversResult<String> {
+    let program = crate::parser::parse(source)?;
+    let mut compiler = Compiler::new().with_optimisation();
+    compiler.compile(&program)
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -1960,4 +2406,44 @@ keek 1 {
         assert!(result.contains("blether:"));
         assert!(result.contains("soond_stairt"));
     }
+
+    #[test]
+    fn test_optimised_keeps_only_used_helpers() {
+        let source = "ken xs = [3, 1]\nblether len(sort(xs))";
+        let result = compile_optimised(source).unwrap();
+        assert!(result.contains("const { len, sort, blether } = __havers;"));
+        assert!(result.contains("  len: (x) => {"));
+        assert!(!result.contains("whit_kind:"));
+        assert!(!result.contains("// Timing functions"));
+        assert!(!result.contains("const __havers_audio ="));
+        assert!(!result.contains("__mdh_log_state"));
+        assert!(result.len() * 4 < compile(source).unwrap().len());
+    }
+
+    #[test]
+    fn test_optimised_keeps_runtimes_the_program_uses() {
+        let result =
+            compile_optimised("soond_stairt()\nlog_holler \"och\"\nken s = xs[::2]").unwrap();
+        assert!(result.contains("const __havers_audio ="));
+        assert!(result.contains("soond_stairt: __havers_audio.soond_stairt,"));
+        assert!(result.contains("log_event: __mdh_log_event,"));
+        assert!(result.contains("  slice: (x, start, end, step) => {"));
+        assert!(!result.contains("soond_steek: __havers_audio.soond_steek,"));
+    }
+
+    #[test]
+    fn test_optimised_for_over_range_is_a_counted_loop() {
+        let result = compile_optimised("fer i in 0..=n { blether i }").unwrap();
+        assert!(result.contains(
+            "for (let __fer_0 = 0, __fer_0_end = (n + 1); __fer_0 < __fer_0_end; __fer_0++) {"
+        ));
+        assert!(result.contains("const i = __fer_0;"));
+        assert!(!result.contains("range:"));
+
+        // Other iterables, and ranges outside a loop, still go through the runtime
+        let result = compile_optimised("fer x in xs { blether x }\nken r = 0..3").unwrap();
+        assert!(result.contains("for (const x of xs)"));
+        assert!(result.contains("__havers.range(0, 3)"));
+        assert!(result.contains("  range: (start, end) => {"));
+    }
 }
@@ -3,12 +3,37 @@
 //! Provides immediate-mode graphics with Scots-themed API names.
 //! All graphics functions are prefixed with "draw_" for drawing
 //! and "screen_" for window/screen operations.
+//!
+//! A frame opens with `screen_begin`, or with the first clear or draw after the last one
+//! ended, and ends with `screen_end` or the next `screen_should_close`. Everything drawn
+//! in between shares one BeginDrawing/EndDrawing pair, so raylib batches it and swaps
+//! buffers once per frame rather than once per shape.
+//!
+//! `texture_load` decodes images on background threads. Each frame, as it opens, uploads
+//! what has finished, up to a byte budget, so loading a level doesn't stall a frame.
+//! Sprites up to 256 pixels each way are packed into shared 2048x2048 atlas pages with
+//! stb_rect_pack, so drawing many of them doesn't switch textures and break the batch.
+//!
+//! `draw_mesh_instanced` and `draw_mesh_at` draw a mesh from `mesh_load` or `mesh_cube`
+//! once per transform in a packed list, with a single DrawMeshInstanced call per mesh.
 
 #[cfg(feature = "graphics")]
 use raylib::prelude::*;
 
 #[cfg(feature = "graphics")]
-use std::cell::RefCell;
+use raylib::ffi;
+
+#[cfg(feature = "graphics")]
+use std::cell::{Cell, RefCell};
+
+#[cfg(feature = "graphics")]
+use std::collections::{HashMap, VecDeque};
+
+#[cfg(feature = "graphics")]
+use std::ffi::{CStr, CString};
+
+#[cfg(feature = "graphics")]
+use std::sync::{mpsc, Arc, Mutex};
 
 #[cfg(feature = "graphics")]
 use std::rc::Rc;
@@ -20,6 +45,800 @@ use crate::value::{NativeFunction, Value};
 thread_local! {
     static RAYLIB_HANDLE: RefCell<Option<RaylibHandle>> = const { RefCell::new(None) };
     static RAYLIB_THREAD: RefCell<Option<RaylibThread>> = const { RefCell::new(None) };
+    // Whether BeginDrawing has run for the frame being drawn
+    static FRAME_OPEN: Cell<bool> = const { Cell::new(false) };
+    // Fonts from font_load, by handle
+    static FONTS: RefCell<Vec<ffi::Font>> = const { RefCell::new(Vec::new()) };
+    static TEXT_LAYOUTS: RefCell<TextLayouts> = RefCell::new(TextLayouts::default());
+    // Images from texture_load, by handle
+    static TEXTURES: RefCell<Textures> = RefCell::new(Textures::default());
+    // Models from mesh_load / mesh_cube, by handle
+    static MODELS: RefCell<Vec<ffi::Model>> = const { RefCell::new(Vec::new()) };
+    // The material instanced meshes draw with, once built
+    static INSTANCING: Cell<Option<ffi::Material>> = const { Cell::new(None) };
+    // The 3D camera set by camera_3d
+    static CAMERA: Cell<ffi::Camera3D> = Cell::new(default_camera());
+}
+
+/// Run `draw` in the current frame, opening one first if none is open.
+#[cfg(feature = "graphics")]
+fn draw_in_frame(draw: impl FnOnce()) -> Result<Value, String> {
+    RAYLIB_HANDLE.with(|h| {
+        if h.borrow().is_none() {
+            return Err("Window not open".to_string());
+        }
+        if !FRAME_OPEN.with(|open| open.replace(true)) {
+            TEXTURES.with(|textures| textures.borrow_mut().upload(UPLOAD_BYTES_PER_FRAME));
+            // SAFETY: the window is open on this thread
+            unsafe { ffi::BeginDrawing() };
+        }
+        draw();
+        Ok(Value::Nil)
+    })
+}
+
+/// End the current frame, if one is open: flush the batch and swap buffers.
+#[cfg(feature = "graphics")]
+fn end_frame() {
+    if FRAME_OPEN.with(|open| open.replace(false)) {
+        // SAFETY: a frame is only open while the window is
+        unsafe { ffi::EndDrawing() };
+    }
+}
+
+/// Laid-out strings kept per font and size before the cache for them is dropped.
+#[cfg(feature = "graphics")]
+const TEXT_LAYOUT_LIMIT: usize = 1024;
+
+/// One glyph of a laid-out string: texture coordinates in the font atlas and the screen
+/// rectangle relative to the text's position, both as (left, top, right, bottom).
+#[cfg(feature = "graphics")]
+#[derive(Clone, Copy)]
+struct GlyphQuad {
+    uv: [f32; 4],
+    rect: [f32; 4],
+}
+
+/// Laid-out strings by font (None for raylib's default font) and size, so text drawn
+/// every frame is measured and split into glyphs once.
+#[cfg(feature = "graphics")]
+#[derive(Default)]
+struct TextLayouts {
+    by_font: HashMap<(Option<usize>, i32), HashMap<String, Rc<Vec<GlyphQuad>>>>,
+}
+
+/// The glyph quads `DrawTextEx` would draw for `text`, with the same advances, padding and
+/// line spacing.
+#[cfg(feature = "graphics")]
+fn layout_text(font: &ffi::Font, text: &str, size: f32, spacing: f32) -> Vec<GlyphQuad> {
+    const LINE_SPACING: f32 = 2.0;
+    let scale = size / font.baseSize as f32;
+    let padding = font.glyphPadding as f32;
+    let (atlas_w, atlas_h) = (font.texture.width as f32, font.texture.height as f32);
+    let mut quads = Vec::with_capacity(text.len());
+    let (mut pen_x, mut pen_y) = (0.0f32, 0.0f32);
+    for ch in text.chars() {
+        if ch == '\n' {
+            pen_y += size + LINE_SPACING;
+            pen_x = 0.0;
+            continue;
+        }
+        // SAFETY: the index comes from GetGlyphIndex, so it is within the font's arrays
+        let (glyph, src) = unsafe {
+            let index = ffi::GetGlyphIndex(*font, ch as i32) as usize;
+            (*font.glyphs.add(index), *font.recs.add(index))
+        };
+        if ch != ' ' && ch != '\t' {
+            let (sx, sy) = (src.x - padding, src.y - padding);
+            let (sw, sh) = (src.width + 2.0 * padding, src.height + 2.0 * padding);
+            let left = pen_x + (glyph.offsetX as f32 - padding) * scale;
+            let top = pen_y + (glyph.offsetY as f32 - padding) * scale;
+            quads.push(GlyphQuad {
+                uv: [
+                    sx / atlas_w,
+                    sy / atlas_h,
+                    (sx + sw) / atlas_w,
+                    (sy + sh) / atlas_h,
+                ],
+                rect: [left, top, left + sw * scale, top + sh * scale],
+            });
+        }
+        let advance = if glyph.advanceX == 0 {
+            src.width
+        } else {
+            glyph.advanceX as f32
+        };
+        pen_x += advance * scale + spacing;
+    }
+    quads
+}
+
+/// Draw `text` at (x, y) in `font` (None for the default font), laying it out only the
+/// first time it is drawn in that font and size. All its glyphs go to rlgl as one run of
+/// quads textured from the font atlas.
+#[cfg(feature = "graphics")]
+fn draw_text_cached(
+    font: Option<usize>,
+    text: &str,
+    x: f32,
+    y: f32,
+    size: i32,
+    color: Color,
+) -> Result<Value, String> {
+    if RAYLIB_HANDLE.with(|h| h.borrow().is_none()) {
+        return Err("Window not open".to_string());
+    }
+    let font_value = match font {
+        // SAFETY: the window is open
+        None => unsafe { ffi::GetFontDefault() },
+        Some(handle) => FONTS.with(|fonts| {
+            fonts
+                .borrow()
+                .get(handle)
+                .copied()
+                .filter(|font| font.texture.id != 0)
+                .ok_or_else(|| "Thon font handle isnae guid".to_string())
+        })?,
+    };
+    if font_value.texture.id == 0 {
+        // DrawText draws nothing when the default font failed to load
+        return Ok(Value::Nil);
+    }
+    // DrawText's rules for the default font: at least 10px, spacing of a tenth of the size
+    let size = if font.is_none() { size.max(10) } else { size };
+    let spacing = (size / 10) as f32;
+    let quads = TEXT_LAYOUTS.with(|layouts| {
+        let mut layouts = layouts.borrow_mut();
+        let strings = layouts.by_font.entry((font, size)).or_default();
+        if let Some(quads) = strings.get(text) {
+            return quads.clone();
+        }
+        if strings.len() >= TEXT_LAYOUT_LIMIT {
+            strings.clear();
+        }
+        let quads = Rc::new(layout_text(&font_value, text, size as f32, spacing));
+        strings.insert(text.to_string(), quads.clone());
+        quads
+    });
+    draw_in_frame(|| {
+        // SAFETY: draw_in_frame has checked the window is open
+        unsafe {
+            ffi::rlSetTexture(font_value.texture.id);
+            ffi::rlBegin(ffi::RL_QUADS as i32);
+            ffi::rlColor4ub(color.r, color.g, color.b, color.a);
+            for quad in quads.iter() {
+                let [u0, v0, u1, v1] = quad.uv;
+                let [left, top, right, bottom] = quad.rect;
+                let (left, top, right, bottom) = (x + left, y + top, x + right, y + bottom);
+                ffi::rlTexCoord2f(u0, v0);
+                ffi::rlVertex2f(left, top);
+                ffi::rlTexCoord2f(u0, v1);
+                ffi::rlVertex2f(left, bottom);
+                ffi::rlTexCoord2f(u1, v1);
+                ffi::rlVertex2f(right, bottom);
+                ffi::rlTexCoord2f(u1, v0);
+                ffi::rlVertex2f(right, top);
+            }
+            ffi::rlEnd();
+            ffi::rlSetTexture(0);
+        }
+    })
+}
+
+/// Unload every font_load font and forget all layouts, before the GL context goes.
+#[cfg(feature = "graphics")]
+fn unload_fonts() {
+    FONTS.with(|fonts| {
+        for font in fonts.borrow_mut().drain(..) {
+            if font.texture.id != 0 {
+                // SAFETY: the font came from LoadFontEx and is unloaded once
+                unsafe { ffi::UnloadFont(font) };
+            }
+        }
+    });
+    TEXT_LAYOUTS.with(|layouts| layouts.borrow_mut().by_font.clear());
+}
+
+/// Sprites no bigger than this each way share atlas pages; bigger images get a texture of
+/// their own.
+#[cfg(feature = "graphics")]
+const ATLAS_SPRITE_MAX: i32 = 256;
+
+/// Width and height of each atlas page.
+#[cfg(feature = "graphics")]
+const ATLAS_PAGE_SIZE: i32 = 2048;
+
+/// Decoded pixel bytes uploaded per frame; anything past that waits for the next frame.
+#[cfg(feature = "graphics")]
+const UPLOAD_BYTES_PER_FRAME: usize = 4 << 20;
+
+/// Background threads decoding images for texture_load.
+#[cfg(feature = "graphics")]
+const LOADER_THREADS: usize = 2;
+
+/// stb_rect_pack, which raylib compiles in for its font atlases. The skyline packer keeps
+/// its state between calls, so sprites can be added to a page one at a time.
+#[cfg(feature = "graphics")]
+mod rect_pack {
+    use std::os::raw::c_int;
+
+    // Only stb_rect_pack reads these
+    #[allow(dead_code)]
+    #[repr(C)]
+    pub struct Node {
+        x: c_int,
+        y: c_int,
+        next: *mut Node,
+    }
+
+    #[allow(dead_code)]
+    #[repr(C)]
+    pub struct Context {
+        width: c_int,
+        height: c_int,
+        align: c_int,
+        init_mode: c_int,
+        heuristic: c_int,
+        num_nodes: c_int,
+        active_head: *mut Node,
+        free_head: *mut Node,
+        extra: [Node; 2],
+    }
+
+    #[repr(C)]
+    pub struct Rect {
+        pub id: c_int,
+        pub w: c_int,
+        pub h: c_int,
+        pub x: c_int,
+        pub y: c_int,
+        pub was_packed: c_int,
+    }
+
+    extern "C" {
+        pub fn stbrp_init_target(
+            context: *mut Context,
+            width: c_int,
+            height: c_int,
+            nodes: *mut Node,
+            num_nodes: c_int,
+        );
+        pub fn stbrp_pack_rects(context: *mut Context, rects: *mut Rect, num_rects: c_int)
+            -> c_int;
+    }
+}
+
+/// One atlas texture and the packer placing sprites in it.
+#[cfg(feature = "graphics")]
+struct AtlasPage {
+    texture: ffi::Texture2D,
+    // stb_rect_pack keeps pointers into both, so they stay boxed for the page's life
+    context: Box<rect_pack::Context>,
+    _nodes: Box<[rect_pack::Node]>,
+}
+
+#[cfg(feature = "graphics")]
+impl AtlasPage {
+    /// A blank page, or None if the texture couldn't be made.
+    fn new() -> Option<Self> {
+        // SAFETY: only called on the window thread while the window is open; the context
+        // and nodes are plain ints and pointers, for which all zeroes is valid
+        unsafe {
+            let blank = ffi::GenImageColor(
+                ATLAS_PAGE_SIZE,
+                ATLAS_PAGE_SIZE,
+                ffi::Color {
+                    r: 0,
+                    g: 0,
+                    b: 0,
+                    a: 0,
+                },
+            );
+            let texture = ffi::LoadTextureFromImage(blank);
+            ffi::UnloadImage(blank);
+            if texture.id == 0 {
+                return None;
+            }
+            let mut context: Box<rect_pack::Context> = Box::new(std::mem::zeroed());
+            let mut nodes: Box<[rect_pack::Node]> =
+                (0..ATLAS_PAGE_SIZE).map(|_| std::mem::zeroed()).collect();
+            rect_pack::stbrp_init_target(
+                &mut *context,
+                ATLAS_PAGE_SIZE,
+                ATLAS_PAGE_SIZE,
+                nodes.as_mut_ptr(),
+                ATLAS_PAGE_SIZE,
+            );
+            Some(AtlasPage {
+                texture,
+                context,
+                _nodes: nodes,
+            })
+        }
+    }
+
+    /// Where a `width` x `height` sprite goes on this page, if it fits. A pixel of gap is
+    /// left right of and below each sprite so filtering never pulls in a neighbour.
+    fn place(&mut self, width: i32, height: i32) -> Option<(i32, i32)> {
+        let mut rect = rect_pack::Rect {
+            id: 0,
+            w: width + 1,
+            h: height + 1,
+            x: 0,
+            y: 0,
+            was_packed: 0,
+        };
+        // SAFETY: the context was set up by stbrp_init_target and its nodes live as long
+        // as the page; a rect that doesn't fit leaves the skyline as it was
+        unsafe { rect_pack::stbrp_pack_rects(&mut *self.context, &mut rect, 1) };
+        (rect.was_packed != 0).then_some((rect.x, rect.y))
+    }
+}
+
+/// A texture_load handle's image: still decoding or waiting for its upload, failed, or on
+/// the GPU at `source` within `texture` (an atlas page, or a texture of its own).
+#[cfg(feature = "graphics")]
+enum Sprite {
+    Loading,
+    Failed(String),
+    Ready {
+        texture: ffi::Texture2D,
+        source: ffi::Rectangle,
+    },
+}
+
+/// An image for a loader thread to decode.
+#[cfg(feature = "graphics")]
+struct LoadJob {
+    generation: u64,
+    handle: usize,
+    path: CString,
+}
+
+/// An image a loader thread has decoded to RGBA8, or why it couldn't.
+#[cfg(feature = "graphics")]
+struct Decoded {
+    generation: u64,
+    handle: usize,
+    image: Result<ffi::Image, String>,
+}
+
+// SAFETY: the pixels are a malloc'd buffer that only the thread holding the Decoded uses
+#[cfg(feature = "graphics")]
+unsafe impl Send for Decoded {}
+
+/// Read and decode `path` with raylib's LoadImage (stb_image, QOI and the rest), then
+/// convert it to RGBA8 so it can go straight into an atlas page.
+#[cfg(feature = "graphics")]
+fn decode_image(path: &CStr) -> Result<ffi::Image, String> {
+    // SAFETY: LoadImage and ImageFormat only work on CPU-side pixels, never the GL context,
+    // so they are fine off the window thread
+    unsafe {
+        let mut image = ffi::LoadImage(path.as_ptr());
+        if image.data.is_null() {
+            return Err(format!("Couldnae load image {}", path.to_string_lossy()));
+        }
+        ffi::ImageFormat(
+            &mut image,
+            ffi::PixelFormat::PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 as i32,
+        );
+        Ok(image)
+    }
+}
+
+/// The decoder threads, sharing one job queue.
+#[cfg(feature = "graphics")]
+struct Loader {
+    jobs: mpsc::Sender<LoadJob>,
+    decoded: mpsc::Receiver<Decoded>,
+}
+
+#[cfg(feature = "graphics")]
+impl Loader {
+    fn start() -> Self {
+        let (jobs, queue) = mpsc::channel::<LoadJob>();
+        let queue = Arc::new(Mutex::new(queue));
+        let (done, decoded) = mpsc::channel();
+        for _ in 0..LOADER_THREADS {
+            let queue = queue.clone();
+            let done = done.clone();
+            std::thread::spawn(move || loop {
+                // The threads stop once the window thread drops its sender
+                let job = match queue.lock().map(|queue| queue.recv()) {
+                    Ok(Ok(job)) => job,
+                    _ => return,
+                };
+                let decoded = Decoded {
+                    generation: job.generation,
+                    handle: job.handle,
+                    image: decode_image(&job.path),
+                };
+                if let Err(mpsc::SendError(decoded)) = done.send(decoded) {
+                    if let Ok(image) = decoded.image {
+                        // SAFETY: the image came from LoadImage and nothing else holds it
+                        unsafe { ffi::UnloadImage(image) };
+                    }
+                    return;
+                }
+            });
+        }
+        Loader { jobs, decoded }
+    }
+}
+
+/// Every texture_load image and the GPU textures holding them.
+#[cfg(feature = "graphics")]
+#[derive(Default)]
+struct Textures {
+    sprites: Vec<Sprite>,
+    pages: Vec<AtlasPage>,
+    // Textures for images too big for the atlas, one each
+    single: Vec<ffi::Texture2D>,
+    // Decoded images waiting for an upload, oldest first
+    decoded: VecDeque<Decoded>,
+    loader: Option<Loader>,
+    // Bumped when the window closes, so images still decoding for it are thrown away
+    generation: u64,
+}
+
+#[cfg(feature = "graphics")]
+impl Textures {
+    /// Start decoding `path` in the background; the handle draws nothing until it is up.
+    fn load(&mut self, path: CString) -> Result<usize, String> {
+        let handle = self.sprites.len();
+        let job = LoadJob {
+            generation: self.generation,
+            handle,
+            path,
+        };
+        self.loader
+            .get_or_insert_with(Loader::start)
+            .jobs
+            .send(job)
+            .map_err(|_| "The image loader has stopped".to_string())?;
+        self.sprites.push(Sprite::Loading);
+        Ok(handle)
+    }
+
+    /// Upload decoded images until `budget` bytes have gone this frame (always at least
+    /// one image), so a level's worth of sprites arrives over a few frames rather than
+    /// stalling one.
+    fn upload(&mut self, budget: usize) {
+        if let Some(loader) = &self.loader {
+            self.decoded.extend(loader.decoded.try_iter());
+        }
+        let mut spent = 0;
+        while spent < budget {
+            let Some(decoded) = self.decoded.pop_front() else {
+                break;
+            };
+            let image = match decoded.image {
+                Ok(image) if decoded.generation != self.generation => {
+                    // SAFETY: the image came from LoadImage and nothing else holds it
+                    unsafe { ffi::UnloadImage(image) };
+                    continue;
+                }
+                Ok(image) => image,
+                Err(_) if decoded.generation != self.generation => continue,
+                Err(message) => {
+                    self.sprites[decoded.handle] = Sprite::Failed(message);
+                    continue;
+                }
+            };
+            spent += image.width as usize * image.height as usize * 4;
+            let sprite = self.place(&image);
+            self.sprites[decoded.handle] = sprite;
+            // SAFETY: the pixels are on the GPU now and nothing else holds the image
+            unsafe { ffi::UnloadImage(image) };
+        }
+    }
+
+    /// Put an RGBA8 image on the GPU: into the first atlas page with room, a new page if
+    /// none has, or a texture of its own if it's too big to share.
+    fn place(&mut self, image: &ffi::Image) -> Sprite {
+        let (width, height) = (image.width, image.height);
+        if width <= ATLAS_SPRITE_MAX && height <= ATLAS_SPRITE_MAX {
+            let mut spot = self
+                .pages
+                .iter_mut()
+                .enumerate()
+                .find_map(|(i, page)| page.place(width, height).map(|at| (i, at)));
+            if spot.is_none() {
+                if let Some(mut page) = AtlasPage::new() {
+                    spot = page.place(width, height).map(|at| (self.pages.len(), at));
+                    self.pages.push(page);
+                }
+            }
+            if let Some((page, (x, y))) = spot {
+                let texture = self.pages[page].texture;
+                let source = ffi::Rectangle {
+                    x: x as f32,
+                    y: y as f32,
+                    width: width as f32,
+                    height: height as f32,
+                };
+                // SAFETY: the rectangle lies within the page and the image is RGBA8, as
+                // the page is
+                unsafe { ffi::UpdateTextureRec(texture, source, image.data) };
+                return Sprite::Ready { texture, source };
+            }
+        }
+        // SAFETY: only called on the window thread while the window is open
+        let texture = unsafe { ffi::LoadTextureFromImage(*image) };
+        if texture.id == 0 {
+            return Sprite::Failed("Couldnae upload image tae the GPU".to_string());
+        }
+        self.single.push(texture);
+        Sprite::Ready {
+            texture,
+            source: ffi::Rectangle {
+                x: 0.0,
+                y: 0.0,
+                width: width as f32,
+                height: height as f32,
+            },
+        }
+    }
+
+    /// Unload every texture and forget every handle, before the GL context goes.
+    fn unload(&mut self) {
+        // SAFETY: each texture and image is unloaded once, while the context still exists
+        unsafe {
+            for page in self.pages.drain(..) {
+                ffi::UnloadTexture(page.texture);
+            }
+            for texture in self.single.drain(..) {
+                ffi::UnloadTexture(texture);
+            }
+            for decoded in self.decoded.drain(..) {
+                if let Ok(image) = decoded.image {
+                    ffi::UnloadImage(image);
+                }
+            }
+        }
+        self.sprites.clear();
+        self.generation += 1;
+    }
+}
+
+/// Run `f` on the image behind a texture_load handle.
+#[cfg(feature = "graphics")]
+fn with_sprite<T>(
+    handle: &Value,
+    f: impl FnOnce(&Sprite) -> Result<T, String>,
+) -> Result<T, String> {
+    let handle = match handle {
+        Value::Integer(i) if *i >= 0 => *i as usize,
+        _ => return Err("texture must be a handle fae texture_load".to_string()),
+    };
+    TEXTURES.with(|textures| match textures.borrow().sprites.get(handle) {
+        Some(sprite) => f(sprite),
+        None => Err("Thon texture handle isnae guid".to_string()),
+    })
+}
+
+/// Vertex shader for instanced meshes: each instance's transform comes in as a per-instance
+/// attribute, which raylib's default shader lacks.
+#[cfg(feature = "graphics")]
+const INSTANCING_VS: &str = "#version 330
+in vec3 vertexPosition;
+in vec3 vertexNormal;
+in mat4 instanceTransform;
+uniform mat4 mvp;
+out vec3 fragNormal;
+void main() {
+    fragNormal = mat3(instanceTransform) * vertexNormal;
+    gl_Position = mvp * instanceTransform * vec4(vertexPosition, 1.0);
+}
+";
+
+/// Fragment shader for instanced meshes: the draw's colour, shaded by one fixed light so
+/// shapes read as solid without setting up lights.
+#[cfg(feature = "graphics")]
+const INSTANCING_FS: &str = "#version 330
+in vec3 fragNormal;
+uniform vec4 colDiffuse;
+out vec4 finalColor;
+void main() {
+    vec3 light = normalize(vec3(0.4, 1.0, 0.6));
+    float shade = 0.45 + 0.55 * max(dot(normalize(fragNormal), light), 0.0);
+    finalColor = vec4(colDiffuse.rgb * shade, colDiffuse.a);
+}
+";
+
+/// The material instanced draws use, built on first use.
+#[cfg(feature = "graphics")]
+fn instancing_material() -> Result<ffi::Material, String> {
+    if let Some(material) = INSTANCING.with(|m| m.get()) {
+        return Ok(material);
+    }
+    let vs = CString::new(INSTANCING_VS).expect("shader source has no NUL");
+    let fs = CString::new(INSTANCING_FS).expect("shader source has no NUL");
+    // SAFETY: the window is open on this thread (checked by the callers); locs has
+    // RL_MAX_SHADER_LOCATIONS entries, so the model matrix slot is in range
+    let material = unsafe {
+        let shader = ffi::LoadShaderFromMemory(vs.as_ptr(), fs.as_ptr());
+        if !ffi::IsShaderValid(shader) {
+            return Err("Couldnae build the instancing shader".to_string());
+        }
+        let attrib = CString::new("instanceTransform").expect("name has no NUL");
+        *shader
+            .locs
+            .add(ffi::ShaderLocationIndex::SHADER_LOC_MATRIX_MODEL as usize) =
+            ffi::GetShaderLocationAttrib(shader, attrib.as_ptr());
+        let mut material = ffi::LoadMaterialDefault();
+        material.shader = shader;
+        material
+    };
+    INSTANCING.with(|m| m.set(Some(material)));
+    Ok(material)
+}
+
+/// Draw every mesh of `model` once per transform in one DrawMeshInstanced call each,
+/// inside the current 3D camera.
+#[cfg(feature = "graphics")]
+fn draw_instances(
+    model: &Value,
+    transforms: &[ffi::Matrix],
+    color: Color,
+) -> Result<Value, String> {
+    let model = match model {
+        Value::Integer(i) if *i >= 0 => *i as usize,
+        _ => return Err("mesh must be a handle fae mesh_load or mesh_cube".to_string()),
+    };
+    let model = MODELS.with(|models| {
+        models
+            .borrow()
+            .get(model)
+            .copied()
+            .ok_or_else(|| "Thon mesh handle isnae guid".to_string())
+    })?;
+    if RAYLIB_HANDLE.with(|h| h.borrow().is_none()) {
+        return Err("Window not open".to_string());
+    }
+    let material = instancing_material()?;
+    let camera = CAMERA.with(|c| c.get());
+    draw_in_frame(|| {
+        if transforms.is_empty() {
+            return;
+        }
+        // SAFETY: draw_in_frame has checked the window is open; the model's meshes and
+        // the material's maps live until screen_close
+        unsafe {
+            (*material
+                .maps
+                .add(ffi::MaterialMapIndex::MATERIAL_MAP_ALBEDO as usize))
+            .color = ffi_color(color);
+            ffi::BeginMode3D(camera);
+            for i in 0..model.meshCount.max(0) as usize {
+                ffi::DrawMeshInstanced(
+                    *model.meshes.add(i),
+                    material,
+                    transforms.as_ptr(),
+                    transforms.len() as i32,
+                );
+            }
+            ffi::EndMode3D();
+        }
+    })
+}
+
+/// Keep a loaded model and hand back its handle.
+#[cfg(feature = "graphics")]
+fn add_model(model: ffi::Model) -> Result<Value, String> {
+    MODELS.with(|models| {
+        let mut models = models.borrow_mut();
+        models.push(model);
+        Ok(Value::Integer(models.len() as i64 - 1))
+    })
+}
+
+/// Unload every mesh_load / mesh_cube model and the instancing material, before the GL
+/// context goes.
+#[cfg(feature = "graphics")]
+fn unload_models() {
+    MODELS.with(|models| {
+        for model in models.borrow_mut().drain(..) {
+            // SAFETY: each model came from LoadModel / LoadModelFromMesh and is unloaded once
+            unsafe { ffi::UnloadModel(model) };
+        }
+    });
+    if let Some(material) = INSTANCING.with(|m| m.take()) {
+        // SAFETY: the material is unloaded once; it frees its shader, not the default one
+        unsafe { ffi::UnloadMaterial(material) };
+    }
+    CAMERA.with(|c| c.set(default_camera()));
+}
+
+/// Where 3D draws look from until camera_3d moves it: up and back from the origin.
+#[cfg(feature = "graphics")]
+fn default_camera() -> ffi::Camera3D {
+    ffi::Camera3D {
+        position: ffi::Vector3 {
+            x: 10.0,
+            y: 10.0,
+            z: 10.0,
+        },
+        target: ffi::Vector3 {
+            x: 0.0,
+            y: 0.0,
+            z: 0.0,
+        },
+        up: ffi::Vector3 {
+            x: 0.0,
+            y: 1.0,
+            z: 0.0,
+        },
+        fovy: 45.0,
+        projection: ffi::CameraProjection::CAMERA_PERSPECTIVE as i32,
+    }
+}
+
+/// Segments of each circle `draw_circles` emits.
+#[cfg(feature = "graphics")]
+const CIRCLE_SEGMENTS: usize = 24;
+
+/// The numbers of a packed list of shapes, `stride` numbers per shape.
+#[cfg(feature = "graphics")]
+fn packed_shapes(value: &Value, stride: usize, what: &str) -> Result<Vec<f32>, String> {
+    let list = value
+        .as_list()
+        .ok_or_else(|| format!("{} must be a list of numbers", what))?;
+    let list = list.borrow();
+    if list.len() % stride != 0 {
+        return Err(format!(
+            "{} must hold {} numbers per shape, got {}",
+            what,
+            stride,
+            list.len()
+        ));
+    }
+    list.iter()
+        .map(|v| {
+            v.as_float()
+                .map(|f| f as f32)
+                .ok_or_else(|| format!("{} must be a list of numbers", what))
+        })
+        .collect()
+}
+
+/// Emit `triangles` (x, y pairs, three per triangle) as one rlgl primitive in the current
+/// frame. rlgl flushes its batch (RL_DEFAULT_BATCH_BUFFER_ELEMENTS quads) on a triangle
+/// boundary by itself when it fills, so any number of shapes can go through in one pass.
+#[cfg(feature = "graphics")]
+fn draw_triangles(triangles: &[[f32; 2]], color: Color) -> Result<Value, String> {
+    draw_in_frame(|| {
+        // SAFETY: draw_in_frame has checked the window is open
+        unsafe {
+            ffi::rlBegin(ffi::RL_TRIANGLES as i32);
+            ffi::rlColor4ub(color.r, color.g, color.b, color.a);
+            for [x, y] in triangles {
+                ffi::rlVertex2f(*x, *y);
+            }
+            ffi::rlEnd();
+        }
+    })
+}
+
+/// Two triangles covering each `[x, y, width, height]`, counter-clockwise on screen.
+#[cfg(feature = "graphics")]
+fn rect_triangles(rects: &[f32]) -> Vec<[f32; 2]> {
+    let mut triangles = Vec::with_capacity(rects.len() / 4 * 6);
+    for rect in rects.chunks_exact(4) {
+        let (x0, y0, x1, y1) = (rect[0], rect[1], rect[0] + rect[2], rect[1] + rect[3]);
+        triangles.extend([[x0, y0], [x0, y1], [x1, y1], [x1, y1], [x1, y0], [x0, y0]]);
+    }
+    triangles
+}
+
+#[cfg(feature = "graphics")]
+fn ffi_color(color: Color) -> ffi::Color {
+    ffi::Color {
+        r: color.r,
+        g: color.g,
+        b: color.b,
+        a: color.a,
+    }
 }
 
 /// Register all graphics functions in the interpreter globals
@@ -49,7 +868,7 @@ fn register_screen_functions(globals: &Rc<RefCell<crate::value::Environment>>) {
             let width = args[0].as_integer().ok_or("width must be an integer")? as i32;
             let height = args[1].as_integer().ok_or("height must be an integer")? as i32;
             let title = match &args[2] {
-                Value::String(s) => s.clone(),
+                Value::String(s) => s.to_string(),
                 _ => return Err("title must be a string".to_string()),
             };
 
@@ -71,6 +890,10 @@ fn register_screen_functions(globals: &Rc<RefCell<crate::value::Environment>>) {
     globals.borrow_mut().define(
         "screen_close".to_string(),
         Value::NativeFunction(Rc::new(NativeFunction::new("screen_close", 0, |_args| {
+            end_frame();
+            unload_fonts();
+            TEXTURES.with(|textures| textures.borrow_mut().unload());
+            unload_models();
             RAYLIB_HANDLE.with(|h| {
                 *h.borrow_mut() = None;
             });
@@ -88,6 +911,8 @@ fn register_screen_functions(globals: &Rc<RefCell<crate::value::Environment>>) {
             "screen_should_close",
             0,
             |_args| {
+                // The loop is coming round again: show the frame it drew
+                end_frame();
                 RAYLIB_HANDLE.with(|h| {
                     let borrowed = h.borrow();
                     if let Some(rl) = borrowed.as_ref() {
@@ -104,8 +929,7 @@ fn register_screen_functions(globals: &Rc<RefCell<crate::value::Environment>>) {
     globals.borrow_mut().define(
         "screen_begin".to_string(),
         Value::NativeFunction(Rc::new(NativeFunction::new("screen_begin", 0, |_args| {
-            // Drawing is handled in screen_clear and screen_end
-            Ok(Value::Nil)
+            draw_in_frame(|| {})
         }))),
     );
 
@@ -113,7 +937,7 @@ fn register_screen_functions(globals: &Rc<RefCell<crate::value::Environment>>) {
     globals.borrow_mut().define(
         "screen_end".to_string(),
         Value::NativeFunction(Rc::new(NativeFunction::new("screen_end", 0, |_args| {
-            // Raylib handles this automatically in the draw closure
+            end_frame();
             Ok(Value::Nil)
         }))),
     );
@@ -123,21 +947,8 @@ fn register_screen_functions(globals: &Rc<RefCell<crate::value::Environment>>) {
         "screen_clear".to_string(),
         Value::NativeFunction(Rc::new(NativeFunction::new("screen_clear", 1, |args| {
             let color = value_to_color(&args[0])?;
-            RAYLIB_HANDLE.with(|h| {
-                let mut borrowed = h.borrow_mut();
-                if let Some(rl) = borrowed.as_mut() {
-                    RAYLIB_THREAD.with(|t| {
-                        let t_borrowed = t.borrow();
-                        if let Some(thread) = t_borrowed.as_ref() {
-                            let mut d = rl.begin_drawing(thread);
-                            d.clear_background(color);
-                        }
-                    });
-                    Ok(Value::Nil)
-                } else {
-                    Err("Window not open".to_string())
-                }
-            })
+            // SAFETY: draw_in_frame has checked the window is open
+            draw_in_frame(|| unsafe { ffi::ClearBackground(ffi_color(color)) })
         }))),
     );
 
@@ -203,21 +1014,8 @@ fn register_draw_functions(globals: &Rc<RefCell<crate::value::Environment>>) {
             let height = args[3].as_integer().ok_or("height must be an integer")? as i32;
             let color = value_to_color(&args[4])?;
 
-            RAYLIB_HANDLE.with(|h| {
-                let mut borrowed = h.borrow_mut();
-                if let Some(rl) = borrowed.as_mut() {
-                    RAYLIB_THREAD.with(|t| {
-                        let t_borrowed = t.borrow();
-                        if let Some(thread) = t_borrowed.as_ref() {
-                            let mut d = rl.begin_drawing(thread);
-                            d.draw_rectangle(x, y, width, height, color);
-                        }
-                    });
-                    Ok(Value::Nil)
-                } else {
-                    Err("Window not open".to_string())
-                }
-            })
+            // SAFETY: draw_in_frame has checked the window is open
+            draw_in_frame(|| unsafe { ffi::DrawRectangle(x, y, width, height, ffi_color(color)) })
         }))),
     );
 
@@ -230,21 +1028,8 @@ fn register_draw_functions(globals: &Rc<RefCell<crate::value::Environment>>) {
             let radius = args[2].as_integer().ok_or("radius must be an integer")? as f32;
             let color = value_to_color(&args[3])?;
 
-            RAYLIB_HANDLE.with(|h| {
-                let mut borrowed = h.borrow_mut();
-                if let Some(rl) = borrowed.as_mut() {
-                    RAYLIB_THREAD.with(|t| {
-                        let t_borrowed = t.borrow();
-                        if let Some(thread) = t_borrowed.as_ref() {
-                            let mut d = rl.begin_drawing(thread);
-                            d.draw_circle(x, y, radius, color);
-                        }
-                    });
-                    Ok(Value::Nil)
-                } else {
-                    Err("Window not open".to_string())
-                }
-            })
+            // SAFETY: draw_in_frame has checked the window is open
+            draw_in_frame(|| unsafe { ffi::DrawCircle(x, y, radius, ffi_color(color)) })
         }))),
     );
 
@@ -258,21 +1043,8 @@ fn register_draw_functions(globals: &Rc<RefCell<crate::value::Environment>>) {
             let y2 = args[3].as_integer().ok_or("y2 must be an integer")? as i32;
             let color = value_to_color(&args[4])?;
 
-            RAYLIB_HANDLE.with(|h| {
-                let mut borrowed = h.borrow_mut();
-                if let Some(rl) = borrowed.as_mut() {
-                    RAYLIB_THREAD.with(|t| {
-                        let t_borrowed = t.borrow();
-                        if let Some(thread) = t_borrowed.as_ref() {
-                            let mut d = rl.begin_drawing(thread);
-                            d.draw_line(x1, y1, x2, y2, color);
-                        }
-                    });
-                    Ok(Value::Nil)
-                } else {
-                    Err("Window not open".to_string())
-                }
-            })
+            // SAFETY: draw_in_frame has checked the window is open
+            draw_in_frame(|| unsafe { ffi::DrawLine(x1, y1, x2, y2, ffi_color(color)) })
         }))),
     );
 
@@ -281,7 +1053,7 @@ fn register_draw_functions(globals: &Rc<RefCell<crate::value::Environment>>) {
         "draw_text".to_string(),
         Value::NativeFunction(Rc::new(NativeFunction::new("draw_text", 5, |args| {
             let text = match &args[0] {
-                Value::String(s) => s.clone(),
+                Value::String(s) => s.to_string(),
                 _ => return Err("text must be a string".to_string()),
             };
             let x = args[1].as_integer().ok_or("x must be an integer")? as i32;
@@ -289,24 +1061,240 @@ fn register_draw_functions(globals: &Rc<RefCell<crate::value::Environment>>) {
             let size = args[3].as_integer().ok_or("size must be an integer")? as i32;
             let color = value_to_color(&args[4])?;
 
-            RAYLIB_HANDLE.with(|h| {
-                let mut borrowed = h.borrow_mut();
-                if let Some(rl) = borrowed.as_mut() {
-                    RAYLIB_THREAD.with(|t| {
-                        let t_borrowed = t.borrow();
-                        if let Some(thread) = t_borrowed.as_ref() {
-                            let mut d = rl.begin_drawing(thread);
-                            d.draw_text(&text, x, y, size, color);
-                        }
-                    });
-                    Ok(Value::Nil)
-                } else {
-                    Err("Window not open".to_string())
+            draw_text_cached(None, &text, x as f32, y as f32, size, color)
+        }))),
+    );
+
+    // font_load - Load a TTF/OTF font at a pixel size into a packed glyph atlas
+    globals.borrow_mut().define(
+        "font_load".to_string(),
+        Value::NativeFunction(Rc::new(NativeFunction::new("font_load", 2, |args| {
+            let path = match &args[0] {
+                Value::String(s) => std::ffi::CString::new(s.as_bytes())
+                    .map_err(|_| "path must not contain a NUL character".to_string())?,
+                _ => return Err("path must be a string".to_string()),
+            };
+            let size = args[1].as_integer().ok_or("size must be an integer")? as i32;
+            if RAYLIB_HANDLE.with(|h| h.borrow().is_none()) {
+                return Err("Window not open".to_string());
+            }
+            // SAFETY: the window is open; a null codepoint list loads the default set
+            let font = unsafe { ffi::LoadFontEx(path.as_ptr(), size, std::ptr::null_mut(), 0) };
+            if font.texture.id == 0 || font.glyphCount == 0 {
+                return Err(format!("Couldnae load font {}", path.to_string_lossy()));
+            }
+            FONTS.with(|fonts| {
+                let mut fonts = fonts.borrow_mut();
+                fonts.push(font);
+                Ok(Value::Integer(fonts.len() as i64 - 1))
+            })
+        }))),
+    );
+
+    // font_draw - Draw text in a font from font_load
+    globals.borrow_mut().define(
+        "font_draw".to_string(),
+        Value::NativeFunction(Rc::new(NativeFunction::new("font_draw", 6, |args| {
+            let font = match &args[0] {
+                Value::Integer(i) if *i >= 0 => *i as usize,
+                _ => return Err("font must be a handle fae font_load".to_string()),
+            };
+            let text = match &args[1] {
+                Value::String(s) => s.to_string(),
+                _ => return Err("text must be a string".to_string()),
+            };
+            let x = args[2].as_float().ok_or("x must be a number")? as f32;
+            let y = args[3].as_float().ok_or("y must be a number")? as f32;
+            let size = args[4].as_integer().ok_or("size must be an integer")? as i32;
+            let color = value_to_color(&args[5])?;
+
+            draw_text_cached(Some(font), &text, x, y, size, color)
+        }))),
+    );
+
+    // texture_load - Start loading an image in the background; returns a handle
+    globals.borrow_mut().define(
+        "texture_load".to_string(),
+        Value::NativeFunction(Rc::new(NativeFunction::new("texture_load", 1, |args| {
+            let path = match &args[0] {
+                Value::String(s) => CString::new(s.as_bytes())
+                    .map_err(|_| "path must not contain a NUL character".to_string())?,
+                _ => return Err("path must be a string".to_string()),
+            };
+            if RAYLIB_HANDLE.with(|h| h.borrow().is_none()) {
+                return Err("Window not open".to_string());
+            }
+            let handle = TEXTURES.with(|textures| textures.borrow_mut().load(path))?;
+            Ok(Value::Integer(handle as i64))
+        }))),
+    );
+
+    // texture_ready - Whether a texture_load image is on the GPU yet
+    globals.borrow_mut().define(
+        "texture_ready".to_string(),
+        Value::NativeFunction(Rc::new(NativeFunction::new("texture_ready", 1, |args| {
+            with_sprite(&args[0], |sprite| match sprite {
+                Sprite::Loading => Ok(Value::Bool(false)),
+                Sprite::Failed(message) => Err(message.clone()),
+                Sprite::Ready { .. } => Ok(Value::Bool(true)),
+            })
+        }))),
+    );
+
+    // texture_draw - Draw a texture_load image at (x, y); nothing until it has loaded
+    globals.borrow_mut().define(
+        "texture_draw".to_string(),
+        Value::NativeFunction(Rc::new(NativeFunction::new("texture_draw", 3, |args| {
+            let x = args[1].as_float().ok_or("x must be a number")? as f32;
+            let y = args[2].as_float().ok_or("y must be a number")? as f32;
+            let ready = with_sprite(&args[0], |sprite| match sprite {
+                Sprite::Loading => Ok(None),
+                Sprite::Failed(message) => Err(message.clone()),
+                Sprite::Ready { texture, source } => Ok(Some((*texture, *source))),
+            })?;
+            draw_in_frame(|| {
+                if let Some((texture, source)) = ready {
+                    let white = ffi::Color {
+                        r: 255,
+                        g: 255,
+                        b: 255,
+                        a: 255,
+                    };
+                    // SAFETY: draw_in_frame has checked the window is open, and the
+                    // texture lives until screen_close
+                    unsafe { ffi::DrawTextureRec(texture, source, ffi::Vector2 { x, y }, white) };
                 }
             })
         }))),
     );
 
+    // mesh_load - Load a 3D model file (OBJ, glTF, IQM, ...) for instanced drawing
+    globals.borrow_mut().define(
+        "mesh_load".to_string(),
+        Value::NativeFunction(Rc::new(NativeFunction::new("mesh_load", 1, |args| {
+            let path = match &args[0] {
+                Value::String(s) => CString::new(s.as_bytes())
+                    .map_err(|_| "path must not contain a NUL character".to_string())?,
+                _ => return Err("path must be a string".to_string()),
+            };
+            if RAYLIB_HANDLE.with(|h| h.borrow().is_none()) {
+                return Err("Window not open".to_string());
+            }
+            // SAFETY: the window is open on this thread
+            let model = unsafe { ffi::LoadModel(path.as_ptr()) };
+            if model.meshCount <= 0 {
+                return Err(format!("Couldnae load mesh {}", path.to_string_lossy()));
+            }
+            add_model(model)
+        }))),
+    );
+
+    // mesh_cube - A width x height x length box mesh, for voxels and the like
+    globals.borrow_mut().define(
+        "mesh_cube".to_string(),
+        Value::NativeFunction(Rc::new(NativeFunction::new("mesh_cube", 3, |args| {
+            let width = args[0].as_float().ok_or("width must be a number")? as f32;
+            let height = args[1].as_float().ok_or("height must be a number")? as f32;
+            let length = args[2].as_float().ok_or("length must be a number")? as f32;
+            if RAYLIB_HANDLE.with(|h| h.borrow().is_none()) {
+                return Err("Window not open".to_string());
+            }
+            // SAFETY: the window is open on this thread; the model takes the mesh
+            let model = unsafe { ffi::LoadModelFromMesh(ffi::GenMeshCube(width, height, length)) };
+            add_model(model)
+        }))),
+    );
+
+    // camera_3d - Where 3D draws look from and at, and the vertical field of view
+    globals.borrow_mut().define(
+        "camera_3d".to_string(),
+        Value::NativeFunction(Rc::new(NativeFunction::new("camera_3d", 7, |args| {
+            let mut numbers = [0.0f32; 7];
+            for (number, arg) in numbers.iter_mut().zip(args.iter()) {
+                *number = arg.as_float().ok_or("camera_3d needs numbers")? as f32;
+            }
+            let [x, y, z, tx, ty, tz, fovy] = numbers;
+            let mut camera = default_camera();
+            camera.position = ffi::Vector3 { x, y, z };
+            camera.target = ffi::Vector3 {
+                x: tx,
+                y: ty,
+                z: tz,
+            };
+            camera.fovy = fovy;
+            CAMERA.with(|c| c.set(camera));
+            Ok(Value::Nil)
+        }))),
+    );
+
+    // draw_mesh_instanced - Draw a mesh once per 4x4 transform in a packed list (16
+    // numbers each, row by row), in one draw call
+    globals.borrow_mut().define(
+        "draw_mesh_instanced".to_string(),
+        Value::NativeFunction(Rc::new(NativeFunction::new(
+            "draw_mesh_instanced",
+            3,
+            |args| {
+                let numbers = packed_shapes(&args[1], 16, "transforms")?;
+                let color = value_to_color(&args[2])?;
+                let transforms: Vec<ffi::Matrix> = numbers
+                    .chunks_exact(16)
+                    .map(|m| ffi::Matrix {
+                        m0: m[0],
+                        m4: m[1],
+                        m8: m[2],
+                        m12: m[3],
+                        m1: m[4],
+                        m5: m[5],
+                        m9: m[6],
+                        m13: m[7],
+                        m2: m[8],
+                        m6: m[9],
+                        m10: m[10],
+                        m14: m[11],
+                        m3: m[12],
+                        m7: m[13],
+                        m11: m[14],
+                        m15: m[15],
+                    })
+                    .collect();
+                draw_instances(&args[0], &transforms, color)
+            },
+        ))),
+    );
+
+    // draw_mesh_at - Draw a mesh at each position in a packed [x, y, z, ...] list, in one
+    // draw call
+    globals.borrow_mut().define(
+        "draw_mesh_at".to_string(),
+        Value::NativeFunction(Rc::new(NativeFunction::new("draw_mesh_at", 3, |args| {
+            let positions = packed_shapes(&args[1], 3, "positions")?;
+            let color = value_to_color(&args[2])?;
+            let transforms: Vec<ffi::Matrix> = positions
+                .chunks_exact(3)
+                .map(|p| ffi::Matrix {
+                    m0: 1.0,
+                    m4: 0.0,
+                    m8: 0.0,
+                    m12: p[0],
+                    m1: 0.0,
+                    m5: 1.0,
+                    m9: 0.0,
+                    m13: p[1],
+                    m2: 0.0,
+                    m6: 0.0,
+                    m10: 1.0,
+                    m14: p[2],
+                    m3: 0.0,
+                    m7: 0.0,
+                    m11: 0.0,
+                    m15: 1.0,
+                })
+                .collect();
+            draw_instances(&args[0], &transforms, color)
+        }))),
+    );
+
     // draw_pixel - Draw a single pixel
     globals.borrow_mut().define(
         "draw_pixel".to_string(),
@@ -315,21 +1303,55 @@ fn register_draw_functions(globals: &Rc<RefCell<crate::value::Environment>>) {
             let y = args[1].as_integer().ok_or("y must be an integer")? as i32;
             let color = value_to_color(&args[2])?;
 
-            RAYLIB_HANDLE.with(|h| {
-                let mut borrowed = h.borrow_mut();
-                if let Some(rl) = borrowed.as_mut() {
-                    RAYLIB_THREAD.with(|t| {
-                        let t_borrowed = t.borrow();
-                        if let Some(thread) = t_borrowed.as_ref() {
-                            let mut d = rl.begin_drawing(thread);
-                            d.draw_pixel(x, y, color);
-                        }
-                    });
-                    Ok(Value::Nil)
-                } else {
-                    Err("Window not open".to_string())
+            // SAFETY: draw_in_frame has checked the window is open
+            draw_in_frame(|| unsafe { ffi::DrawPixel(x, y, ffi_color(color)) })
+        }))),
+    );
+
+    // draw_rects - Draw many filled rectangles from a packed [x, y, w, h, ...] list
+    globals.borrow_mut().define(
+        "draw_rects".to_string(),
+        Value::NativeFunction(Rc::new(NativeFunction::new("draw_rects", 2, |args| {
+            let rects = packed_shapes(&args[0], 4, "rects")?;
+            let color = value_to_color(&args[1])?;
+            draw_triangles(&rect_triangles(&rects), color)
+        }))),
+    );
+
+    // draw_points - Draw many pixels from a packed [x, y, ...] list
+    globals.borrow_mut().define(
+        "draw_points".to_string(),
+        Value::NativeFunction(Rc::new(NativeFunction::new("draw_points", 2, |args| {
+            let points = packed_shapes(&args[0], 2, "points")?;
+            let color = value_to_color(&args[1])?;
+            let rects: Vec<f32> = points
+                .chunks_exact(2)
+                .flat_map(|p| [p[0], p[1], 1.0, 1.0])
+                .collect();
+            draw_triangles(&rect_triangles(&rects), color)
+        }))),
+    );
+
+    // draw_circles - Draw many filled circles from a packed [x, y, radius, ...] list
+    globals.borrow_mut().define(
+        "draw_circles".to_string(),
+        Value::NativeFunction(Rc::new(NativeFunction::new("draw_circles", 2, |args| {
+            let circles = packed_shapes(&args[0], 3, "circles")?;
+            let color = value_to_color(&args[1])?;
+            let step = std::f32::consts::TAU / CIRCLE_SEGMENTS as f32;
+            let mut triangles = Vec::with_capacity(circles.len() / 3 * CIRCLE_SEGMENTS * 3);
+            for circle in circles.chunks_exact(3) {
+                let (x, y, r) = (circle[0], circle[1], circle[2]);
+                for i in 0..CIRCLE_SEGMENTS {
+                    let (a, b) = (i as f32 * step, (i + 1) as f32 * step);
+                    triangles.extend([
+                        [x, y],
+                        [x + r * b.cos(), y + r * b.sin()],
+                        [x + r * a.cos(), y + r * a.sin()],
+                    ]);
                 }
-            })
+            }
+            draw_triangles(&triangles, color)
         }))),
     );
 }
@@ -343,7 +1365,7 @@ fn register_input_functions(globals: &Rc<RefCell<crate::value::Environment>>) {
         "key_pressed".to_string(),
         Value::NativeFunction(Rc::new(NativeFunction::new("key_pressed", 1, |args| {
             let key_name = match &args[0] {
-                Value::String(s) => s.clone(),
+                Value::String(s) => s.to_string(),
                 _ => return Err("key name must be a string".to_string()),
             };
 
@@ -365,7 +1387,7 @@ fn register_input_functions(globals: &Rc<RefCell<crate::value::Environment>>) {
         "key_down".to_string(),
         Value::NativeFunction(Rc::new(NativeFunction::new("key_down", 1, |args| {
             let key_name = match &args[0] {
-                Value::String(s) => s.clone(),
+                Value::String(s) => s.to_string(),
                 _ => return Err("key name must be a string".to_string()),
             };
 
@@ -48,6 +48,7 @@ use crossterm::{
 use crate::ast::{LogLevel, *};
 use crate::error::{HaversError, HaversResult};
 use crate::logging;
+use crate::pack::{UnpackStream, UnpackStreamHandle};
 use crate::value::*;
 use std::sync::atomic::{AtomicBool, Ordering};
 use std::sync::{Mutex, OnceLock};
@@ -55,6 +56,8 @@ use std::sync::{Mutex, OnceLock};
 #[cfg(feature = "native")]
 use std::sync::Arc;
 
+pub(crate) mod bytecode;
+
 /// Whether crash handling is enabled (default: true)
 static CRASH_HANDLING_ENABLED: AtomicBool = AtomicBool::new(true);
 
@@ -143,8 +146,8 @@ struct LoopWatch {
 #[derive(Debug, Clone)]
 struct LoopTimer {
     id: i64,
-    next_fire_ms: i64,
-    interval_ms: i64,
+    next_fire_ns: i64,
+    interval_ns: i64,
     callback: Value,
     cancelled: bool,
 }
@@ -196,6 +199,168 @@ where
     })
 }
 
+/// A json_stream_* stream: bytes read from `file` or fed by the program, framed into
+/// one top-level JSON value at a time so only the record in progress is buffered.
+struct JsonStream {
+    buf: Vec<u8>,
+    file: Option<std::fs::File>,
+    eof: bool,
+    start: usize, // first byte of the record in progress
+    pos: usize,   // where scanning resumes
+    begun: bool,
+    depth: usize,
+    in_string: bool,
+    scalar: bool,
+}
+
+impl JsonStream {
+    fn new(file: Option<std::fs::File>) -> Self {
+        JsonStream {
+            buf: Vec::new(),
+            file,
+            eof: false,
+            start: 0,
+            pos: 0,
+            begun: false,
+            depth: 0,
+            in_string: false,
+            scalar: false,
+        }
+    }
+
+    /// End offset of the next complete record, resuming where the last call stopped.
+    fn scan(&mut self) -> Option<usize> {
+        let buf = &self.buf;
+        let mut i = self.pos;
+        if !self.begun {
+            while i < buf.len() && buf[i].is_ascii_whitespace() {
+                i += 1;
+            }
+            self.start = i;
+            self.pos = i;
+            if i == buf.len() {
+                return None;
+            }
+            self.begun = true;
+            match buf[i] {
+                b'{' | b'[' => self.depth = 1,
+                b'"' => self.in_string = true,
+                _ => self.scalar = true,
+            }
+            i += 1;
+        }
+        while i < buf.len() {
+            let b = buf[i];
+            if self.in_string {
+                if b == b'\\' {
+                    if i + 1 == buf.len() {
+                        break;
+                    }
+                    i += 1;
+                } else if b == b'"' {
+                    self.in_string = false;
+                    if self.depth == 0 {
+                        return Some(i + 1);
+                    }
+                }
+            } else if self.scalar {
+                if b.is_ascii_whitespace() || b"{}[],\"".contains(&b) {
+                    return Some(i);
+                }
+            } else if b == b'"' {
+                self.in_string = true;
+            } else if b == b'{' || b == b'[' {
+                self.depth += 1;
+            } else if b == b'}' || b == b']' {
+                self.depth -= 1;
+                if self.depth == 0 {
+                    return Some(i + 1);
+                }
+            }
+            i += 1;
+        }
+        self.pos = i;
+        if self.scalar && self.eof {
+            return Some(i);
+        }
+        None
+    }
+
+    fn compact(&mut self) {
+        self.buf.drain(..self.start);
+        self.pos -= self.start;
+        self.start = 0;
+    }
+
+    /// The next record's text, or None when more input is needed or the file is exhausted.
+    fn next_record(&mut self) -> Result<Option<String>, String> {
+        loop {
+            if let Some(end) = self.scan() {
+                let text = String::from_utf8_lossy(&self.buf[self.start..end]).into_owned();
+                self.start = end;
+                self.pos = end;
+                self.begun = false;
+                self.scalar = false;
+                return Ok(Some(text));
+            }
+            let Some(file) = self.file.as_mut().filter(|_| !self.eof) else {
+                break;
+            };
+            let mut chunk = [0u8; 64 * 1024];
+            let n = std::io::Read::read(file, &mut chunk)
+                .map_err(|e| format!("json_stream_next() couldnae read: {}", e))?;
+            self.eof = n == 0;
+            self.compact();
+            self.buf.extend_from_slice(&chunk[..n]);
+        }
+        if self.eof && self.begun {
+            *self = JsonStream::new(None);
+            self.eof = true;
+            return Err("Truncated JSON record at end of stream".to_string());
+        }
+        Ok(None)
+    }
+}
+
+struct JsonStreamRegistry {
+    next_id: i64,
+    streams: HashMap<i64, JsonStream>,
+}
+
+thread_local! {
+    static JSON_STREAMS: RefCell<JsonStreamRegistry> = RefCell::new(JsonStreamRegistry {
+        next_id: 1,
+        streams: HashMap::new(),
+    });
+}
+
+fn register_json_stream(stream: JsonStream) -> i64 {
+    JSON_STREAMS.with(|cell| {
+        let mut reg = cell.borrow_mut();
+        let id = reg.next_id;
+        reg.next_id += 1;
+        reg.streams.insert(id, stream);
+        id
+    })
+}
+
+fn with_json_stream<T, F>(name: &str, handle: &Value, f: F) -> Result<T, String>
+where
+    F: FnOnce(&mut JsonStream) -> Result<T, String>,
+{
+    let Value::Integer(id) = handle else {
+        return Err(format!("{}() needs a JSON stream", name));
+    };
+    JSON_STREAMS.with(|cell| {
+        let mut reg = cell.borrow_mut();
+        let stream = reg
+            .streams
+            .get_mut(id)
+            .ok_or("Unknown JSON stream handle")?;
+        f(stream)
+    })
+}
+
 #[derive(Debug, Clone)]
 struct ThreadHandle {
     result: Value,
@@ -224,6 +389,216 @@ thread_local! {
     static CHANNELS: RefCell<ChannelRegistry> = RefCell::new(ChannelRegistry::new());
 }
 
+/// Clamp [start, end) to a buffer of len the way bytes_slice does.
+fn bytes_range(len: usize, start: i64, end: i64) -> (usize, usize) {
+    let len = len as i64;
+    let s = if start < 0 { start + len } else { start }.clamp(0, len);
+    let e = if end < 0 { end + len } else { end }.min(len).max(s);
+    (s as usize, e as usize)
+}
+
+/// Ordering used by sort and sort_by: numbers, then strings, compare; other pairs tie.
+fn sort_order(a: &Value, b: &Value) -> std::cmp::Ordering {
+    match (a, b) {
+        (Value::Integer(x), Value::Integer(y)) => x.cmp(y),
+        (Value::Float(x), Value::Float(y)) => x.partial_cmp(y).unwrap_or(std::cmp::Ordering::Equal),
+        (Value::String(x), Value::String(y)) => x.cmp(y),
+        _ => std::cmp::Ordering::Equal,
+    }
+}
+
+/// Buffers handed back through bytes_pool_give, reused by bytes_pool_take.
+const BYTES_POOL_DEPTH: usize = 32;
+
+thread_local! {
+    static BYTES_POOL: RefCell<Vec<Vec<u8>>> = const { RefCell::new(Vec::new()) };
+}
+
+// Per-thread xoshiro256** behind every random builtin, the same generator, seeding and
+// sampling as the native runtime's, so `seed(n)` gives one sequence on both backends.
+// Unseeded it starts from std's per-process random keys.
+thread_local! {
+    static RNG: std::cell::Cell<[u64; 4]> = std::cell::Cell::new(rng_state({
+        use std::hash::{BuildHasher, Hasher};
+        std::collections::hash_map::RandomState::new()
+            .build_hasher()
+            .finish()
+    }));
+}
+
+/// splitmix64 spreads the one seed over the four state words
+fn rng_state(mut seed: u64) -> [u64; 4] {
+    let mut state = [0u64; 4];
+    for word in &mut state {
+        seed = seed.wrapping_add(0x9e3779b97f4a7c15);
+        let mut z = seed;
+        z = (z ^ (z >> 30)).wrapping_mul(0xbf58476d1ce4e5b9);
+        z = (z ^ (z >> 27)).wrapping_mul(0x94d049bb133111eb);
+        *word = z ^ (z >> 31);
+    }
+    state
+}
+
+fn rng_seed(seed: u64) {
+    RNG.with(|rng| rng.set(rng_state(seed)));
+}
+
+fn rng_next() -> u64 {
+    RNG.with(|rng| {
+        let mut s = rng.get();
+        let result = s[1].wrapping_mul(5).rotate_left(7).wrapping_mul(9);
+        let t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = s[3].rotate_left(45);
+        rng.set(s);
+        result
+    })
+}
+
+/// Uniform in [0, n) for n > 0 without modulo bias (Lemire's multiply and redraw)
+fn rng_below(n: u64) -> u64 {
+    let mut m = rng_next() as u128 * n as u128;
+    if (m as u64) < n {
+        let threshold = n.wrapping_neg() % n;
+        while (m as u64) < threshold {
+            m = rng_next() as u128 * n as u128;
+        }
+    }
+    (m >> 64) as u64
+}
+
+/// Uniform in [min, max], the whole i64 range included
+fn rng_range(min: i64, max: i64) -> i64 {
+    let span = (max as u64).wrapping_sub(min as u64).wrapping_add(1);
+    let offset = if span == 0 { rng_next() } else { rng_below(span) };
+    (min as u64).wrapping_add(offset) as i64
+}
+
+/// Uniform in [0, 1) from the top 53 bits
+fn rng_float() -> f64 {
+    (rng_next() >> 11) as f64 * (1.0 / (1u64 << 53) as f64)
+}
+
+/// Fisher-Yates, drawing each swap the way the native runtime does
+fn rng_shuffle<T>(items: &mut [T]) {
+    for i in (1..items.len()).rev() {
+        let j = rng_below(i as u64 + 1) as usize;
+        items.swap(i, j);
+    }
+}
+
+// s[i] and s[a:b] count characters. An ASCII string is indexed by byte; for other strings
+// of CHAR_INDEX_MIN bytes or more the first index notes where every CHAR_INDEX_STRIDE-th
+// character starts, so later lookups step over at most that many. The last few tables
+// are kept per thread, keyed by the Rc (which the entry holds, so it can't be reused).
+const CHAR_INDEX_MIN: usize = 64;
+const CHAR_INDEX_STRIDE: usize = 64;
+const CHAR_INDEX_SLOTS: usize = 4;
+
+struct CharIndex {
+    text: Rc<str>,
+    chars: usize,
+    ascii: bool,
+    /// Byte offset of character k * CHAR_INDEX_STRIDE; empty for ASCII or short strings
+    marks: Vec<usize>,
+}
+
+impl CharIndex {
+    fn new(text: &Rc<str>, marked: bool) -> Self {
+        let ascii = text.is_ascii();
+        let mut chars = text.len();
+        let mut marks = Vec::new();
+        if !ascii {
+            chars = 0;
+            for (i, _) in text.char_indices() {
+                if marked && chars % CHAR_INDEX_STRIDE == 0 {
+                    marks.push(i);
+                }
+                chars += 1;
+            }
+        }
+        CharIndex {
+            text: Rc::clone(text),
+            chars,
+            ascii,
+            marks,
+        }
+    }
+
+    /// Byte offset of character idx, or the byte length for idx >= chars
+    fn offset(&self, idx: usize) -> usize {
+        if idx >= self.chars {
+            return self.text.len();
+        }
+        if self.ascii {
+            return idx;
+        }
+        let (base, skip) = match self.marks.get(idx / CHAR_INDEX_STRIDE) {
+            Some(&base) => (base, idx % CHAR_INDEX_STRIDE),
+            None => (0, idx),
+        };
+        base + self.text[base..]
+            .char_indices()
+            .nth(skip)
+            .map_or(self.text.len() - base, |(i, _)| i)
+    }
+
+    /// Character idx (which must be below chars) as its own string
+    fn char_at(&self, idx: usize) -> Rc<str> {
+        let start = self.offset(idx);
+        let width = self.text[start..].chars().next().map_or(0, char::len_utf8);
+        self.text[start..start + width].into()
+    }
+}
+
+thread_local! {
+    static CHAR_INDEXES: RefCell<Vec<CharIndex>> = const { RefCell::new(Vec::new()) };
+}
+
+fn with_char_index<R>(text: &Rc<str>, f: impl FnOnce(&CharIndex) -> R) -> R {
+    if text.len() < CHAR_INDEX_MIN {
+        return f(&CharIndex::new(text, false));
+    }
+    CHAR_INDEXES.with(|cache| {
+        let mut cache = cache.borrow_mut();
+        let slot = match cache.iter().position(|e| Rc::ptr_eq(&e.text, text)) {
+            Some(slot) => slot,
+            None => {
+                if cache.len() == CHAR_INDEX_SLOTS {
+                    cache.remove(0);
+                }
+                cache.push(CharIndex::new(text, true));
+                cache.len() - 1
+            }
+        };
+        f(&cache[slot])
+    })
+}
+
+/// `fae_pairs` / dict_from_pairs: a dict from a list of [key, value] pairs, sized up front
+fn fae_pairs(args: Vec<Value>) -> Result<Value, String> {
+    match &args[0] {
+        Value::List(list) => {
+            let list = list.borrow();
+            let mut dict = DictValue::with_capacity(list.len());
+            for item in list.iter() {
+                if let Value::List(pair) = item {
+                    let pair = pair.borrow();
+                    if pair.len() >= 2 {
+                        dict.set(pair[0].clone(), pair[1].clone());
+                    }
+                }
+            }
+            Ok(Value::Dict(Rc::new(RefCell::new(dict))))
+        }
+        _ => Err("fae_pairs() needs a list o' pairs".to_string()),
+    }
+}
+
 thread_local! {
     static CURRENT_INTERPRETER: RefCell<*mut Interpreter> =
         const { RefCell::new(std::ptr::null_mut()) };
@@ -990,23 +1365,75 @@ fn tls_take_force_next_rsa_private_keys_fail() -> bool {
 #[cfg(feature = "native")]
 fn result_ok(value: Value) -> Value {
     let mut dict = DictValue::new();
-    dict.set(Value::String("ok".to_string()), Value::Bool(true));
-    dict.set(Value::String("value".to_string()), value);
+    dict.set(Value::String("ok".into()), Value::Bool(true));
+    dict.set(Value::String("value".into()), value);
     Value::Dict(Rc::new(RefCell::new(dict)))
 }
 
 #[cfg(feature = "native")]
 fn result_err(message: String, code: i64) -> Value {
     let mut dict = DictValue::new();
-    dict.set(Value::String("ok".to_string()), Value::Bool(false));
-    dict.set(Value::String("error".to_string()), Value::String(message));
-    dict.set(Value::String("code".to_string()), Value::Integer(code));
+    dict.set(Value::String("ok".into()), Value::Bool(false));
+    dict.set(Value::String("error".into()), Value::String(message.into()));
+    dict.set(Value::String("code".into()), Value::Integer(code));
     Value::Dict(Rc::new(RefCell::new(dict)))
 }
 
-fn mono_ms_now() -> i64 {
+/// Online cores, as the native runtime counts them for thread_spawn's "cpus"
+fn online_cpus() -> i64 {
+    #[cfg(all(feature = "native", unix))]
+    {
+        let n = unsafe { libc::sysconf(libc::_SC_NPROCESSORS_ONLN) };
+        if n > 0 {
+            return n as i64;
+        }
+    }
+    std::thread::available_parallelism().map_or(1, |n| n.get() as i64)
+}
+
+fn mono_ns_now() -> i64 {
     let start = MONO_START.get_or_init(std::time::Instant::now);
-    start.elapsed().as_millis() as i64
+    start.elapsed().as_nanos() as i64
+}
+
+/// Add a timer for timer_after/timer_every and their `_ns` forms; the amount is in units
+/// of unit_ns. Repeats stay on the start + k * interval grid (see event_loop_poll).
+fn add_loop_timer(
+    name: &str,
+    args: &[Value],
+    unit_ns: i64,
+    repeating: bool,
+) -> Result<Value, String> {
+    let loop_id = args[0]
+        .as_integer()
+        .ok_or_else(|| format!("{}() expects loop id", name))?;
+    let what = if repeating { "interval" } else { "delay" };
+    let amount = match &args[1] {
+        Value::Integer(n) => *n,
+        Value::Float(f) => *f as i64,
+        _ => return Err(format!("{}() expects {} integer", name, what)),
+    };
+    if repeating && amount <= 0 {
+        return Err(format!("{}() expects positive interval", name));
+    }
+    if amount < 0 {
+        return Err(format!("{}() expects non-negative delay", name));
+    }
+    let ns = amount.saturating_mul(unit_ns);
+    let callback = args[2].clone();
+    let id = with_loop_mut(loop_id, |loop_ref| {
+        let id = loop_ref.next_timer_id;
+        loop_ref.next_timer_id += 1;
+        loop_ref.timers.push(LoopTimer {
+            id,
+            next_fire_ns: mono_ns_now().saturating_add(ns),
+            interval_ns: if repeating { ns } else { 0 },
+            callback: callback.clone(),
+            cancelled: false,
+        });
+        id
+    })?;
+    Ok(Value::Integer(id))
 }
 
 #[cfg(feature = "native")]
@@ -1077,19 +1504,19 @@ fn resolver_lookup(
 fn dns_srv_to_value(srv: &trust_dns_resolver::proto::rr::rdata::SRV) -> Value {
     let mut dict = DictValue::new();
     dict.set(
-        Value::String("priority".to_string()),
+        Value::String("priority".into()),
         Value::Integer(srv.priority() as i64),
     );
     dict.set(
-        Value::String("weight".to_string()),
+        Value::String("weight".into()),
         Value::Integer(srv.weight() as i64),
     );
     dict.set(
-        Value::String("port".to_string()),
+        Value::String("port".into()),
         Value::Integer(srv.port() as i64),
     );
     dict.set(
-        Value::String("target".to_string()),
+        Value::String("target".into()),
         Value::String(srv.target().to_string()),
     );
     Value::Dict(Rc::new(RefCell::new(dict)))
@@ -1099,27 +1526,27 @@ fn dns_srv_to_value(srv: &trust_dns_resolver::proto::rr::rdata::SRV) -> Value {
 fn dns_naptr_to_value(naptr: &trust_dns_resolver::proto::rr::rdata::NAPTR) -> Value {
     let mut dict = DictValue::new();
     dict.set(
-        Value::String("order".to_string()),
+        Value::String("order".into()),
         Value::Integer(naptr.order() as i64),
     );
     dict.set(
-        Value::String("preference".to_string()),
+        Value::String("preference".into()),
         Value::Integer(naptr.preference() as i64),
     );
     dict.set(
-        Value::String("flags".to_string()),
-        Value::String(String::from_utf8_lossy(naptr.flags()).to_string()),
+        Value::String("flags".into()),
+        Value::String(String::from_utf8_lossy(naptr.flags()).into()),
     );
     dict.set(
-        Value::String("service".to_string()),
-        Value::String(String::from_utf8_lossy(naptr.services()).to_string()),
+        Value::String("service".into()),
+        Value::String(String::from_utf8_lossy(naptr.services()).into()),
     );
     dict.set(
-        Value::String("regexp".to_string()),
-        Value::String(String::from_utf8_lossy(naptr.regexp()).to_string()),
+        Value::String("regexp".into()),
+        Value::String(String::from_utf8_lossy(naptr.regexp()).into()),
     );
     dict.set(
-        Value::String("replacement".to_string()),
+        Value::String("replacement".into()),
         Value::String(naptr.replacement().to_string()),
     );
     Value::Dict(Rc::new(RefCell::new(dict)))
@@ -1155,34 +1582,31 @@ struct TlsConfigData {
 
 #[cfg(any(feature = "native", test))]
 fn dict_get_string(dict: &DictValue, key: &str) -> Option<String> {
-    dict.get(&Value::String(key.to_string()))
-        .and_then(|v| match v {
-            Value::String(s) => Some(s.clone()),
-            _ => None,
-        })
+    dict.get(&Value::String(key.into())).and_then(|v| match v {
+        Value::String(s) => Some(s.to_string()),
+        _ => None,
+    })
 }
 
 #[cfg(any(feature = "native", test))]
 fn dict_get_bool(dict: &DictValue, key: &str) -> Option<bool> {
-    dict.get(&Value::String(key.to_string()))
-        .and_then(|v| match v {
-            Value::Bool(b) => Some(*b),
-            _ => None,
-        })
+    dict.get(&Value::String(key.into())).and_then(|v| match v {
+        Value::Bool(b) => Some(*b),
+        _ => None,
+    })
 }
 
 #[cfg(any(feature = "native", test))]
 fn dict_get_bytes(dict: &DictValue, key: &str) -> Option<Vec<u8>> {
-    dict.get(&Value::String(key.to_string()))
-        .and_then(|v| match v {
-            Value::Bytes(b) => Some(b.borrow().clone()),
-            _ => None,
-        })
+    dict.get(&Value::String(key.into())).and_then(|v| match v {
+        Value::Bytes(b) => Some(b.borrow().clone()),
+        _ => None,
+    })
 }
 
 #[cfg(any(feature = "native", test))]
 fn dict_get_u16(dict: &DictValue, key: &str) -> Option<u16> {
-    dict.get(&Value::String(key.to_string()))
+    dict.get(&Value::String(key.into()))
         .and_then(|v| match v {
             Value::Integer(n) => {
                 if *n >= 0 && *n <= u16::MAX as i64 {
@@ -1417,7 +1841,7 @@ fn dtls_config_from_value(value: &Value) -> Result<DtlsConfigData, String> {
     let remote_port = dict_get_u16(&dict, "remote_port");
 
     let mut profiles = Vec::new();
-    if let Some(Value::List(list)) = dict.get(&Value::String("srtp_profiles".to_string())) {
+    if let Some(Value::List(list)) = dict.get(&Value::String("srtp_profiles".into())) {
         for item in list.borrow().iter() {
             if let Value::String(s) = item {
                 if let Some(profile) = srtp_profile_from_str(s) {
@@ -1507,1783 +1931,5390 @@ fn identity_from_pem(cert_pem: &str, key_pem: &str) -> Result<Identity, String>
     }
 }
 
-#[cfg(feature = "native")]
-fn addr_dict(host: String, port: i64) -> Value {
-    let mut dict = DictValue::new();
-    dict.set(Value::String("host".to_string()), Value::String(host));
-    dict.set(Value::String("port".to_string()), Value::Integer(port));
-    Value::Dict(Rc::new(RefCell::new(dict)))
+/// A pattern compiled once by regex_compile and shared by every regex_* call given it.
+#[derive(Debug)]
+struct RegexValue {
+    re: Rc<regex::Regex>,
 }
 
-fn event_dict(
-    kind: &str,
-    sock: Option<i64>,
-    timer_id: Option<i64>,
-    callback: Option<Value>,
-) -> Value {
-    let mut dict = DictValue::new();
-    dict.set(
-        Value::String("kind".to_string()),
-        Value::String(kind.to_string()),
-    );
-    if let Some(sock_id) = sock {
-        dict.set(Value::String("sock".to_string()), Value::Integer(sock_id));
+impl NativeObject for RegexValue {
+    fn type_name(&self) -> &str {
+        "regex"
     }
-    if let Some(id) = timer_id {
-        dict.set(Value::String("id".to_string()), Value::Integer(id));
-    }
-    if let Some(cb) = callback {
-        dict.set(Value::String("callback".to_string()), cb);
+
+    fn get(&self, prop: &str) -> HaversResult<Value> {
+        Err(HaversError::UndefinedVariable {
+            name: prop.to_string(),
+            line: 0,
+        })
     }
-    Value::Dict(Rc::new(RefCell::new(dict)))
-}
 
-#[cfg(all(feature = "native", unix))]
-fn resolve_ipv4_addr(host: Option<&str>, port: u16) -> Result<libc::sockaddr_in, String> {
-    let mut addr: libc::sockaddr_in = unsafe { std::mem::zeroed() };
-    addr.sin_family = libc::AF_INET as u16;
-    addr.sin_port = port.to_be();
+    fn set(&self, _prop: &str, _value: Value) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
 
-    if let Some(host_str) = host {
-        let mut resolved = None;
-        let iter = (host_str, port)
-            .to_socket_addrs()
-            .map_err(|e| format!("DNS lookup failed: {}", e))?;
-        for sock in iter {
-            if let std::net::SocketAddr::V4(v4) = sock {
-                resolved = Some(v4);
-                break;
-            }
-        }
-        let v4 = resolved.ok_or_else(|| "No IPv4 address found".to_string())?;
-        addr.sin_addr = libc::in_addr {
-            s_addr: u32::from_ne_bytes(v4.ip().octets()),
-        };
-    } else {
-        addr.sin_addr = libc::in_addr { s_addr: 0 };
+    fn call(&self, _method: &str, _args: Vec<Value>) -> HaversResult<Value> {
+        Ok(Value::Nil)
     }
 
-    Ok(addr)
+    fn as_any(&self) -> &dyn std::any::Any {
+        self
+    }
 }
 
-#[cfg(all(feature = "native", unix))]
-fn sockaddr_to_host_port(addr: &libc::sockaddr_in) -> (String, i64) {
-    let host = std::net::Ipv4Addr::from(u32::from_be(addr.sin_addr.s_addr)).to_string();
-    let port = u16::from_be(addr.sin_port) as i64;
-    (host, port)
+/// Patterns from regex_set_new, matched against a line in a single scan.
+#[derive(Debug)]
+struct RegexSetValue {
+    set: regex::RegexSet,
 }
 
-fn format_braw_time(hours: u64, minutes: u64) -> String {
-    match hours {
-        0..=5 => format!("It's the wee small hours ({:02}:{:02})", hours, minutes),
-        6..=11 => format!("It's the mornin' ({:02}:{:02})", hours, minutes),
-        12 => format!("It's high noon ({:02}:{:02})", hours, minutes),
-        13..=17 => format!("It's the efternoon ({:02}:{:02})", hours, minutes),
-        18..=21 => format!("It's the evenin' ({:02}:{:02})", hours, minutes),
-        _ => format!("It's gettin' late ({:02}:{:02})", hours, minutes),
+impl NativeObject for RegexSetValue {
+    fn type_name(&self) -> &str {
+        "regex_set"
     }
-}
 
-/// A stack frame for the shadow call stack
-#[derive(Debug, Clone)]
-pub struct StackFrame {
-    /// Function name or "<main>"
-    pub name: String,
-    /// Source file name
-    pub file: String,
-    /// Line number
-    pub line: usize,
-}
+    fn get(&self, prop: &str) -> HaversResult<Value> {
+        Err(HaversError::UndefinedVariable {
+            name: prop.to_string(),
+            line: 0,
+        })
+    }
 
-impl std::fmt::Display for StackFrame {
-    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
-        write!(f, "  at {} ({}:{})", self.name, self.file, self.line)
+    fn set(&self, _prop: &str, _value: Value) -> HaversResult<Value> {
+        Ok(Value::Nil)
     }
-}
 
-/// Global shadow call stack for crash reporting
-static SHADOW_STACK: Mutex<Vec<StackFrame>> = Mutex::new(Vec::new());
-static CURRENT_STACK_FILE: Mutex<String> = Mutex::new(String::new());
+    fn call(&self, _method: &str, _args: Vec<Value>) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
 
-/// Push a frame onto the shadow stack
-pub fn push_stack_frame(name: &str, line: usize) {
-    let mut stack = SHADOW_STACK.lock().unwrap_or_else(|e| e.into_inner());
-    let file = CURRENT_STACK_FILE
-        .lock()
-        .map(|f| f.clone())
-        .unwrap_or_default();
-    stack.push(StackFrame {
-        name: name.to_string(),
-        file,
-        line,
-    });
+    fn as_any(&self) -> &dyn std::any::Any {
+        self
+    }
 }
 
-/// Pop a frame from the shadow stack
-pub fn pop_stack_frame() {
-    let mut stack = SHADOW_STACK.lock().unwrap_or_else(|e| e.into_inner());
-    stack.pop();
+/// A blether_format template split once by format_compile: the literal runs and the
+/// `{name}` placeholders between them, looked up by key on every format_apply.
+#[derive(Debug)]
+struct FormatTemplate {
+    /// One more run than there are keys; run i comes before key i
+    literals: Vec<String>,
+    keys: Vec<Value>,
+    /// Length of the last output, to size the next
+    last_len: std::cell::Cell<usize>,
 }
 
-/// Get a copy of the current stack trace
-pub fn get_stack_trace() -> Vec<StackFrame> {
-    SHADOW_STACK
-        .lock()
-        .map(|s| s.clone())
-        .unwrap_or_else(|e| e.into_inner().clone())
-}
+impl FormatTemplate {
+    /// A placeholder is '{', a name with no braces in it, and '}'.
+    fn new(template: &str) -> Self {
+        let bytes = template.as_bytes();
+        let mut literals = Vec::new();
+        let mut keys = Vec::new();
+        let mut lit = 0;
+        let mut p = 0;
+        while let Some(open) = bytes[p..].iter().position(|&b| b == b'{') {
+            let open = p + open;
+            let mut q = open + 1;
+            while q < bytes.len() && bytes[q] != b'}' && bytes[q] != b'{' {
+                q += 1;
+            }
+            if q == bytes.len() || bytes[q] == b'{' {
+                p = q;
+                continue;
+            }
+            literals.push(template[lit..open].to_string());
+            keys.push(Value::String(template[open + 1..q].into()));
+            lit = q + 1;
+            p = q + 1;
+        }
+        literals.push(template[lit..].to_string());
+        FormatTemplate {
+            literals,
+            keys,
+            last_len: std::cell::Cell::new(template.len()),
+        }
+    }
 
-/// Clear the stack trace (for REPL reset)
-#[allow(dead_code)]
-pub fn clear_stack_trace() {
-    let mut stack = SHADOW_STACK.lock().unwrap_or_else(|e| e.into_inner());
-    stack.clear();
+    /// Placeholders whose names aren't in the dict are left as they were, and values
+    /// go in as they are, so a value holding "{name}" isn't expanded again.
+    fn apply(&self, dict: &DictValue) -> String {
+        let mut out = String::with_capacity(self.last_len.get());
+        for (literal, key) in self.literals.iter().zip(&self.keys) {
+            out.push_str(literal);
+            let Value::String(name) = key else {
+                continue;
+            };
+            // Keys that aren't strings match by their printed form
+            let value = dict.get(key).or_else(|| {
+                dict.iter()
+                    .find(|(k, _)| !matches!(k, Value::String(_)) && k.to_string() == **name)
+                    .map(|(_, v)| v)
+            });
+            match value {
+                Some(value) => out.push_str(&value.to_string()),
+                None => {
+                    out.push('{');
+                    out.push_str(name);
+                    out.push('}');
+                }
+            }
+        }
+        out.push_str(self.literals.last().map_or("", String::as_str));
+        self.last_len.set(out.len());
+        out
+    }
 }
 
-/// Coverage-only helper to poison the shadow-stack mutex so that poison-recovery branches execute.
-#[cfg(coverage)]
-#[allow(dead_code)]
-pub fn poison_shadow_stack_for_coverage() {
-    let _ = std::panic::catch_unwind(|| {
-        let _guard = SHADOW_STACK.lock().unwrap();
-        panic!("poison SHADOW_STACK for coverage");
-    });
-}
+impl NativeObject for FormatTemplate {
+    fn type_name(&self) -> &str {
+        "format_template"
+    }
 
-/// Coverage-only helper to force `with_dir` / `set_current_dir` instantiations in the non-test crate.
-#[cfg(coverage)]
-#[allow(dead_code)]
-pub fn exercise_interpreter_dir_instantiations_for_coverage() {
-    use std::path::PathBuf;
+    fn get(&self, prop: &str) -> HaversResult<Value> {
+        Err(HaversError::UndefinedVariable {
+            name: prop.to_string(),
+            line: 0,
+        })
+    }
 
-    let dir_buf = PathBuf::from("/tmp");
-    let dir_path = dir_buf.as_path();
-    let dir_string = dir_buf.to_string_lossy().to_string();
-    let dir_str = dir_string.as_str();
+    fn set(&self, _prop: &str, _value: Value) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
 
-    let _ = Interpreter::with_dir(dir_buf.clone());
-    let _ = Interpreter::with_dir(&dir_buf);
-    let _ = Interpreter::with_dir(dir_path);
-    let _ = Interpreter::with_dir(dir_string.clone());
-    let _ = Interpreter::with_dir(&dir_string);
-    let _ = Interpreter::with_dir(dir_str);
+    fn call(&self, _method: &str, _args: Vec<Value>) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
 
-    let mut interp = Interpreter::new();
-    interp.set_current_dir(&dir_buf);
-    interp.set_current_dir(dir_path);
-    interp.set_current_dir(&dir_string);
-    interp.set_current_dir(dir_str);
-    interp.set_current_dir(dir_buf);
-    interp.set_current_dir(dir_string);
+    fn as_any(&self) -> &dyn std::any::Any {
+        self
+    }
 }
 
-/// Set the current file name for stack frames
-pub fn set_stack_file(file: &str) {
-    let mut f = CURRENT_STACK_FILE
-        .lock()
-        .unwrap_or_else(std::sync::PoisonError::into_inner);
-    *f = file.to_string();
+/// The Regex behind a regex_* pattern argument: a regex_compile object or a string.
+fn regex_arg(name: &str, value: &Value) -> Result<Rc<regex::Regex>, String> {
+    match value {
+        Value::String(pattern) => regex::Regex::new(pattern)
+            .map(Rc::new)
+            .map_err(|e| format!("Invalid regex '{}': {}", pattern, e)),
+        Value::NativeObject(obj) => obj
+            .as_any()
+            .downcast_ref::<RegexValue>()
+            .map(|r| r.re.clone())
+            .ok_or_else(|| format!("{}() needs a pattern string", name)),
+        _ => Err(format!("{}() needs a pattern string", name)),
+    }
 }
 
-/// Print the current stack trace to stderr
-#[cfg_attr(coverage, allow(dead_code))]
-pub fn print_stack_trace() {
-    let stack = get_stack_trace();
-    if stack.is_empty() {
-        eprintln!("  (no stack trace available)");
-        return;
+/// A lines_iter reader: one buffered read at a time, dropped at end of file or lines_close.
+#[derive(Debug)]
+struct LineReader {
+    reader: RefCell<Option<std::io::BufReader<std::fs::File>>>,
+}
+
+impl NativeObject for LineReader {
+    fn type_name(&self) -> &str {
+        "line_reader"
     }
-    eprintln!("\n🏴󠁧󠁢󠁳󠁣󠁴󠁿 Stack trace (most recent call last):");
-    for frame in stack.iter().rev() {
-        eprintln!("{}", frame);
+
+    fn get(&self, prop: &str) -> HaversResult<Value> {
+        Err(HaversError::UndefinedVariable {
+            name: prop.to_string(),
+            line: 0,
+        })
     }
-}
 
-/// Enable or disable crash handling
-pub fn set_crash_handling(enabled: bool) {
-    CRASH_HANDLING_ENABLED.store(enabled, Ordering::Relaxed);
-}
+    fn set(&self, _prop: &str, _value: Value) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
 
-/// Check if crash handling is enabled
-#[cfg_attr(coverage, allow(dead_code))]
-pub fn is_crash_handling_enabled() -> bool {
-    CRASH_HANDLING_ENABLED.load(Ordering::Relaxed)
+    fn call(&self, _method: &str, _args: Vec<Value>) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
+
+    fn as_any(&self) -> &dyn std::any::Any {
+        self
+    }
 }
 
-/// Get the global log level
-pub fn get_global_log_level() -> LogLevel {
-    logging::get_global_log_level()
+fn with_line_reader<T, F>(name: &str, value: &Value, f: F) -> Result<T, String>
+where
+    F: FnOnce(&LineReader) -> Result<T, String>,
+{
+    match value {
+        Value::NativeObject(obj) => match obj.as_any().downcast_ref::<LineReader>() {
+            Some(reader) => f(reader),
+            None => Err(format!("{}() needs a line reader frae lines_iter", name)),
+        },
+        _ => Err(format!("{}() needs a line reader frae lines_iter", name)),
+    }
 }
 
-/// Set the global log level
-pub fn set_global_log_level(level: LogLevel) {
-    logging::set_global_log_level(level);
+/// The numbers behind an int_array or float_array.
+#[derive(Debug, Clone)]
+enum NumData {
+    Int(Vec<i64>),
+    Float(Vec<f64>),
 }
 
-/// Test/coverage-only escape hatch to set an invalid global log level value.
-/// This exists purely to exercise the fallback branch in `get_global_log_level`.
-#[cfg(coverage)]
-#[allow(dead_code)]
-pub fn set_global_log_level_raw(level: u8) {
-    logging::set_global_log_level_raw(level);
+/// An int_array / float_array: numbers kept unboxed in one Vec, indexed like a list.
+#[derive(Debug)]
+struct NumArray {
+    data: RefCell<NumData>,
 }
 
-fn parse_log_level_value(value: &Value) -> Result<LogLevel, String> {
-    match value {
-        Value::String(s) => {
-            LogLevel::parse_level(s).ok_or_else(|| format!("Invalid log level '{}'", s))
+impl NumArray {
+    fn value(data: NumData) -> Value {
+        Value::NativeObject(Rc::new(NumArray {
+            data: RefCell::new(data),
+        }))
+    }
+
+    fn len(&self) -> usize {
+        match &*self.data.borrow() {
+            NumData::Int(v) => v.len(),
+            NumData::Float(v) => v.len(),
         }
-        Value::Integer(n) => match n {
-            0 => Ok(LogLevel::Wheesht),
-            1 => Ok(LogLevel::Roar),
-            2 => Ok(LogLevel::Holler),
-            3 => Ok(LogLevel::Blether),
-            4 => Ok(LogLevel::Mutter),
-            5 => Ok(LogLevel::Whisper),
-            _ => Err(format!("Invalid log level {}. Use 0-5", n)),
-        },
-        _ => Err("Log level must be a string or integer".to_string()),
     }
-}
 
-fn parse_log_target_value(value: &Value) -> Result<String, String> {
-    match value {
-        Value::String(s) => Ok(s.clone()),
-        _ => Err("Log target must be a string".to_string()),
+    /// The slot a[index] names, counting back from the end for a negative index.
+    fn slot(&self, index: i64) -> Option<usize> {
+        let len = self.len() as i64;
+        let i = if index < 0 { len + index } else { index };
+        (0..len).contains(&i).then_some(i as usize)
     }
-}
 
-fn resolve_log_args(args: &[Value]) -> Result<(Option<Value>, Option<String>), String> {
-    match args.len() {
-        0 => Ok((None, None)),
-        1 => match &args[0] {
-            v @ Value::Dict(_) => Ok((Some(v.clone()), None)),
-            Value::String(s) => Ok((None, Some(s.clone()))),
-            _ => Err("Expected dict or string for log fields/target".to_string()),
-        },
-        2 => {
-            let fields = match &args[0] {
-                v @ Value::Dict(_) => Some(v.clone()),
-                _ => return Err("Expected dict for log fields".to_string()),
-            };
-            let target = parse_log_target_value(&args[1])?;
-            Ok((fields, Some(target)))
+    fn at(&self, slot: usize) -> Value {
+        match &*self.data.borrow() {
+            NumData::Int(v) => Value::Integer(v[slot]),
+            NumData::Float(v) => Value::Float(v[slot]),
         }
-        _ => Err("Expected at most two extra arguments".to_string()),
     }
-}
 
-fn dict_get(dict: &DictValue, key: &str) -> Option<Value> {
-    dict.get(&Value::String(key.to_string())).cloned()
-}
+    fn put(&self, slot: usize, value: &Value) -> Result<(), String> {
+        let kind = NativeObject::type_name(self);
+        match (&mut *self.data.borrow_mut(), value) {
+            (NumData::Int(v), Value::Integer(n)) => v[slot] = *n,
+            (NumData::Float(v), Value::Integer(n)) => v[slot] = *n as f64,
+            (NumData::Float(v), Value::Float(f)) => v[slot] = *f,
+            (_, other) => return Err(format!("Cannae put a {} in a {}", other.type_name(), kind)),
+        }
+        Ok(())
+    }
 
-/// Control flow signals
-#[derive(Debug)]
-enum ControlFlow {
-    Return(Value),
-    Break,
-    Continue,
+    fn floats(&self) -> Vec<f64> {
+        match &*self.data.borrow() {
+            NumData::Int(v) => v.iter().map(|&n| n as f64).collect(),
+            NumData::Float(v) => v.clone(),
+        }
+    }
 }
 
-/// Trace mode fer debugging - shows step-by-step execution
-#[derive(Debug, Clone, Copy, PartialEq, Default)]
-pub enum TraceMode {
-    /// Nae tracing at aw
-    #[default]
-    Off,
-    /// Show statement execution only
-    Statements,
-    /// Show everything (statements, expressions, values)
-    Verbose,
-}
+impl NativeObject for NumArray {
+    fn type_name(&self) -> &str {
+        match &*self.data.borrow() {
+            NumData::Int(_) => "int_array",
+            NumData::Float(_) => "float_array",
+        }
+    }
 
-/// The interpreter - runs mdhavers programs
-pub struct Interpreter {
-    pub globals: Rc<RefCell<Environment>>,
-    environment: Rc<RefCell<Environment>>,
-    output: Vec<String>,
-    /// Cache of module exports keyed by canonical module path
-    module_cache: HashMap<PathBuf, HashMap<String, Value>>,
-    /// Stack of modules currently being loaded (for circular import detection)
-    module_in_progress: Vec<PathBuf>,
-    /// Current working directory fer resolving relative imports
-    current_dir: PathBuf,
-    /// Whether the prelude has been loaded
-    prelude_loaded: bool,
-    /// Trace mode fer debugging
-    trace_mode: TraceMode,
-    /// Current trace indentation level
-    trace_depth: usize,
-    /// Logger configuration and sinks
-    logger: logging::LoggerCore,
-    /// Optional callback hook for log events
-    log_callback: Option<Value>,
-    /// Current source file name for log messages
-    current_file: String,
-}
+    fn get(&self, prop: &str) -> HaversResult<Value> {
+        Err(HaversError::UndefinedVariable {
+            name: prop.to_string(),
+            line: 0,
+        })
+    }
 
-impl Interpreter {
-    pub fn new() -> Self {
-        let globals = Rc::new(RefCell::new(Environment::new()));
+    fn set(&self, prop: &str, _value: Value) -> HaversResult<Value> {
+        Err(HaversError::TypeError {
+            message: format!("Cannae set '{}' on {}", prop, self.type_name()),
+            line: 0,
+        })
+    }
 
-        // Define native functions
-        Self::define_natives(&globals);
+    fn call(&self, _method: &str, _args: Vec<Value>) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
 
-        // Register audio functions (if feature enabled)
-        crate::audio::register_audio_functions(&globals);
+    fn as_any(&self) -> &dyn std::any::Any {
+        self
+    }
 
-        // Register graphics functions (if feature enabled)
-        crate::graphics::register_graphics_functions(&globals);
+    fn to_string(&self) -> String {
+        let items: Vec<String> = match &*self.data.borrow() {
+            NumData::Int(v) => v.iter().map(|n| n.to_string()).collect(),
+            NumData::Float(v) => v.iter().map(|f| Value::Float(*f).to_string()).collect(),
+        };
+        format!("{}[{}]", self.type_name(), items.join(", "))
+    }
 
-        // Check fer MDH_LOG or MDH_LOG_LEVEL environment variables
-        #[cfg(not(target_arch = "wasm32"))]
-        {
-            if let Ok(spec) = std::env::var("MDH_LOG") {
-                if let Ok(filter) = logging::parse_filter(&spec) {
-                    let _ = logging::set_filter(&spec);
-                    set_global_log_level(filter.default);
-                } else {
-                    eprintln!("Warning: Invalid MDH_LOG filter '{}'", spec);
+    fn length(&self) -> Option<usize> {
+        Some(self.len())
+    }
+
+    fn items(&self) -> Option<Vec<Value>> {
+        Some((0..self.len()).map(|i| self.at(i)).collect())
+    }
+}
+
+fn with_num_array<T, F>(name: &str, value: &Value, f: F) -> Result<T, String>
+where
+    F: FnOnce(&NumArray) -> Result<T, String>,
+{
+    match value {
+        Value::NativeObject(obj) => match obj.as_any().downcast_ref::<NumArray>() {
+            Some(arr) => f(arr),
+            None => Err(format!("{}() needs an int_array or float_array", name)),
+        },
+        _ => Err(format!("{}() needs an int_array or float_array", name)),
+    }
+}
+
+/// int_array / float_array from a count (zero-filled), a list of numbers or another array.
+fn make_num_array(name: &str, src: &Value, float: bool) -> Result<Value, String> {
+    let data = match src {
+        Value::Integer(n) => {
+            let n = (*n).max(0) as usize;
+            if float {
+                NumData::Float(vec![0.0; n])
+            } else {
+                NumData::Int(vec![0; n])
+            }
+        }
+        Value::List(items) => {
+            let items = items.borrow();
+            if float {
+                let mut out = Vec::with_capacity(items.len());
+                for item in items.iter() {
+                    match item {
+                        Value::Integer(n) => out.push(*n as f64),
+                        Value::Float(f) => out.push(*f),
+                        other => {
+                            return Err(format!("{}() cannae hold a {}", name, other.type_name()))
+                        }
+                    }
                 }
-            } else if let Ok(level_str) = std::env::var("MDH_LOG_LEVEL") {
-                if let Some(level) = LogLevel::parse_level(&level_str) {
-                    set_global_log_level(level);
+                NumData::Float(out)
+            } else {
+                let mut out = Vec::with_capacity(items.len());
+                for item in items.iter() {
+                    match item {
+                        Value::Integer(n) => out.push(*n),
+                        other => {
+                            return Err(format!("{}() cannae hold a {}", name, other.type_name()))
+                        }
+                    }
                 }
+                NumData::Int(out)
             }
         }
+        Value::NativeObject(_) => with_num_array(name, src, |arr| {
+            Ok(match (&*arr.data.borrow(), float) {
+                (NumData::Int(v), true) => NumData::Float(v.iter().map(|&n| n as f64).collect()),
+                (NumData::Float(v), false) => NumData::Int(v.iter().map(|&f| f as i64).collect()),
+                (data, _) => data.clone(),
+            })
+        })?,
+        _ => {
+            return Err(format!(
+                "{}() needs a size, a list o' numbers or an array",
+                name
+            ))
+        }
+    };
+    Ok(NumArray::value(data))
+}
 
-        let current_dir = {
-            #[cfg(not(target_arch = "wasm32"))]
-            {
-                std::env::current_dir().unwrap_or_else(|_| PathBuf::from("."))
+/// array_min / array_max: the smallest or largest element.
+fn num_array_extreme(name: &str, value: &Value, want_max: bool) -> Result<Value, String> {
+    with_num_array(name, value, |arr| {
+        let which = if want_max { "maximum" } else { "minimum" };
+        let empty = || format!("Cannae find {} o' empty array!", which);
+        match &*arr.data.borrow() {
+            NumData::Int(v) => {
+                let m = if want_max {
+                    v.iter().max()
+                } else {
+                    v.iter().min()
+                };
+                m.map(|&n| Value::Integer(n)).ok_or_else(empty)
             }
-
-            #[cfg(target_arch = "wasm32")]
-            {
-                PathBuf::from(".")
+            NumData::Float(v) => {
+                let first = *v.first().ok_or_else(empty)?;
+                let m = v.iter().fold(first, |m, &x| match want_max {
+                    true if x > m => x,
+                    false if x < m => x,
+                    _ => m,
+                });
+                Ok(Value::Float(m))
             }
-        };
+        }
+    })
+}
 
-        Interpreter {
-            globals: globals.clone(),
-            environment: globals,
-            output: Vec::new(),
-            module_cache: HashMap::new(),
-            module_in_progress: Vec::new(),
-            current_dir,
-            prelude_loaded: false,
-            trace_mode: TraceMode::Off,
-            trace_depth: 0,
-            logger: logging::LoggerCore::new(),
-            log_callback: None,
-            current_file: "<repl>".to_string(),
+/// array_add / _sub / _mul / _div: elementwise against an array of the same length or one
+/// number. Two int operands give an int_array (wrapping, as compiled integers do), except
+/// division, which gives floats.
+fn num_array_arith(name: &str, a: &Value, b: &Value, op: BinaryOp) -> Result<Value, String> {
+    with_num_array(name, a, |x| {
+        let ints = |v: &NumData| match v {
+            NumData::Int(n) => Some(n.clone()),
+            NumData::Float(_) => None,
+        };
+        let (rhs_ints, rhs_floats): (Option<Vec<i64>>, Vec<f64>) = match b {
+            Value::Integer(n) => (Some(vec![*n; x.len()]), vec![*n as f64; x.len()]),
+            Value::Float(f) => (None, vec![*f; x.len()]),
+            _ => with_num_array(name, b, |y| {
+                if y.len() != x.len() {
+                    return Err(format!(
+                        "{}() needs arrays o' the same length (got {} and {})",
+                        name,
+                        x.len(),
+                        y.len()
+                    ));
+                }
+                Ok((ints(&y.data.borrow()), y.floats()))
+            })?,
+        };
+        let lhs_ints = ints(&x.data.borrow());
+        if let (Some(l), Some(r), false) = (&lhs_ints, &rhs_ints, op == BinaryOp::Divide) {
+            let out = l
+                .iter()
+                .zip(r)
+                .map(|(&p, &q)| match op {
+                    BinaryOp::Add => p.wrapping_add(q),
+                    BinaryOp::Subtract => p.wrapping_sub(q),
+                    _ => p.wrapping_mul(q),
+                })
+                .collect();
+            return Ok(NumArray::value(NumData::Int(out)));
         }
+        let out = x
+            .floats()
+            .iter()
+            .zip(&rhs_floats)
+            .map(|(&p, &q)| match op {
+                BinaryOp::Add => p + q,
+                BinaryOp::Subtract => p - q,
+                BinaryOp::Multiply => p * q,
+                _ => p / q,
+            })
+            .collect();
+        Ok(NumArray::value(NumData::Float(out)))
+    })
+}
+
+/// The numbers in a list as floats, for median / percentile / stats.
+fn numeric_samples(name: &str, value: &Value) -> Result<Vec<f64>, String> {
+    let Value::List(list) = value else {
+        return Err(format!("{}() needs a list", name));
+    };
+    let items = list.borrow();
+    if items.is_empty() {
+        return Err(format!("Cannae calculate {} o' empty list!", name));
+    }
+    items
+        .iter()
+        .map(|item| match item {
+            Value::Integer(n) => Ok(*n as f64),
+            Value::Float(f) if f.is_nan() => Err(format!("{}() cannae handle NaN", name)),
+            Value::Float(f) => Ok(*f),
+            _ => Err(format!("{}() needs a list o' numbers", name)),
+        })
+        .collect()
+}
+
+/// The `p`th percentile (0 to 100) of `samples`, interpolated between the two nearest
+/// ranks, so the 50th is the median. A quickselect, O(n): it leaves the samples partly
+/// ordered, with everything above the result after it.
+fn percentile_of(samples: &mut [f64], p: f64) -> f64 {
+    let rank = p / 100.0 * (samples.len() - 1) as f64;
+    let below = rank.floor() as usize;
+    let (_, &mut low, above) = samples.select_nth_unstable_by(below, f64::total_cmp);
+    let frac = rank - below as f64;
+    if frac == 0.0 || above.is_empty() {
+        return low;
+    }
+    let high = above.iter().copied().fold(f64::INFINITY, f64::min);
+    low * (1.0 - frac) + high * frac
+}
+
+/// The percentile a builtin was asked for, checked to be a number from 0 to 100.
+fn percentile_arg(name: &str, value: &Value) -> Result<f64, String> {
+    let p = match value {
+        Value::Integer(n) => *n as f64,
+        Value::Float(f) => *f,
+        _ => return Err(format!("{}() needs a percentile number", name)),
+    };
+    if (0.0..=100.0).contains(&p) {
+        Ok(p)
+    } else {
+        Err(format!("{}() needs a percentile fae 0 tae 100", name))
     }
+}
 
-    /// Set the current source file name (fer log messages)
-    pub fn set_current_file(&mut self, file: &str) {
-        self.current_file = file.to_string();
-        // Also update the global stack file for crash reporting
-        set_stack_file(file);
+/// A deque: a ring buffer, so pushing and popping at either end is O(1).
+#[derive(Debug, Default)]
+struct Deque {
+    items: RefCell<VecDeque<Value>>,
+}
+
+impl NativeObject for Deque {
+    fn type_name(&self) -> &str {
+        "deque"
     }
 
-    /// Set the log level
-    #[allow(dead_code)]
-    pub fn set_log_level(&mut self, level: LogLevel) {
-        set_global_log_level(level);
+    fn get(&self, prop: &str) -> HaversResult<Value> {
+        Err(HaversError::UndefinedVariable {
+            name: prop.to_string(),
+            line: 0,
+        })
     }
 
-    /// Get current log level
-    #[allow(dead_code)]
-    pub fn get_log_level(&self) -> LogLevel {
-        get_global_log_level()
+    fn set(&self, prop: &str, _value: Value) -> HaversResult<Value> {
+        Err(HaversError::TypeError {
+            message: format!("Cannae set '{}' on a deque", prop),
+            line: 0,
+        })
     }
 
-    /// Check if a log level should be output for a given target
-    fn should_log(&self, level: LogLevel, target: &str) -> bool {
-        logging::log_enabled(level, target)
+    fn call(&self, _method: &str, _args: Vec<Value>) -> HaversResult<Value> {
+        Ok(Value::Nil)
     }
 
-    fn emit_log(
-        &mut self,
-        level: LogLevel,
-        message: Value,
-        fields: Option<Value>,
-        target: Option<String>,
-        line: usize,
-    ) -> HaversResult<()> {
-        let target = target.unwrap_or_else(|| self.current_file.clone());
-        if !self.should_log(level, &target) {
-            return Ok(());
-        }
+    fn as_any(&self) -> &dyn std::any::Any {
+        self
+    }
 
-        let mut field_vec = Vec::new();
-        if let Some(fields_val) = fields {
-            field_vec = logging::fields_from_dict(&fields_val)
-                .map_err(|msg| HaversError::TypeError { message: msg, line })?;
-        }
+    fn to_string(&self) -> String {
+        let items: Vec<String> = self.items.borrow().iter().map(|v| v.to_string()).collect();
+        format!("deque[{}]", items.join(", "))
+    }
 
-        let record = logging::LogRecord {
-            level,
-            message: format!("{}", message),
-            target: target.clone(),
-            file: self.current_file.clone(),
-            line,
-            fields: field_vec,
-            span_path: logging::span_path(),
-        };
+    fn length(&self) -> Option<usize> {
+        Some(self.items.borrow().len())
+    }
 
-        self.logger.log(&record);
+    fn items(&self) -> Option<Vec<Value>> {
+        Some(self.items.borrow().iter().cloned().collect())
+    }
+}
 
-        if let Some(callback) = self.log_callback.clone() {
-            let payload = logging::record_to_value(&record, Some(logging::timestamp_string()));
-            let _ = self.call_value(callback, vec![payload], line);
+fn with_deque<T, F>(name: &str, value: &Value, f: F) -> Result<T, String>
+where
+    F: FnOnce(&Deque) -> Result<T, String>,
+{
+    match value {
+        Value::NativeObject(obj) => match obj.as_any().downcast_ref::<Deque>() {
+            Some(deque) => f(deque),
+            None => Err(format!("{}() needs a deque", name)),
+        },
+        _ => Err(format!("{}() needs a deque", name)),
+    }
+}
+
+/// Heap key order: numbers by value, strings by bytes, lists item by item. Keys that
+/// can't be compared count as equal, as in sort_by.
+fn heap_key_order(a: &Value, b: &Value) -> std::cmp::Ordering {
+    use std::cmp::Ordering;
+    match (a, b) {
+        (Value::Integer(x), Value::Integer(y)) => x.cmp(y),
+        (Value::Integer(x), Value::Float(y)) => {
+            (*x as f64).partial_cmp(y).unwrap_or(Ordering::Equal)
+        }
+        (Value::Float(x), Value::Integer(y)) => {
+            x.partial_cmp(&(*y as f64)).unwrap_or(Ordering::Equal)
         }
+        (Value::List(x), Value::List(y)) => {
+            let (x, y) = (x.borrow(), y.borrow());
+            x.iter()
+                .zip(y.iter())
+                .map(|(p, q)| heap_key_order(p, q))
+                .find(|o| *o != Ordering::Equal)
+                .unwrap_or_else(|| x.len().cmp(&y.len()))
+        }
+        _ => sort_order(a, b),
+    }
+}
 
-        Ok(())
+/// One item in a heap, with its key worked out once on the way in. seq breaks ties so
+/// equal keys come back out in the order they went in.
+#[derive(Debug, Clone)]
+struct HeapEntry {
+    key: Value,
+    seq: u64,
+    item: Value,
+}
+
+impl PartialEq for HeapEntry {
+    fn eq(&self, other: &Self) -> bool {
+        self.cmp(other) == std::cmp::Ordering::Equal
     }
+}
 
-    fn parse_log_extras(
-        &mut self,
-        extras: &[Expr],
-        line: usize,
-    ) -> HaversResult<(Option<Value>, Option<String>)> {
-        if extras.is_empty() {
-            return Ok((None, None));
-        }
+impl Eq for HeapEntry {}
 
-        let mut values = Vec::new();
-        for expr in extras {
-            values.push(self.evaluate(expr)?);
-        }
+impl PartialOrd for HeapEntry {
+    fn partial_cmp(&self, other: &Self) -> Option<std::cmp::Ordering> {
+        Some(self.cmp(other))
+    }
+}
 
-        match values.len() {
-            1 => match values.remove(0) {
-                v @ Value::Dict(_) => Ok((Some(v), None)),
-                Value::String(s) => Ok((None, Some(s))),
-                _ => Err(HaversError::TypeError {
-                    message: "log_* expects a dict or string for the extra argument".to_string(),
-                    line,
-                }),
-            },
-            2 => {
-                let fields_val = values.remove(0);
-                let target_val = values.remove(0);
-                let fields = match fields_val {
-                    v @ Value::Dict(_) => Some(v),
-                    _ => {
-                        return Err(HaversError::TypeError {
-                            message: "log_* expects fields as a dict when passing two extras"
-                                .to_string(),
-                            line,
-                        })
-                    }
-                };
-                let target = match target_val {
-                    Value::String(s) => Some(s),
-                    _ => {
-                        return Err(HaversError::TypeError {
-                            message: "log_* expects target as a string".to_string(),
-                            line,
-                        })
-                    }
-                };
-                Ok((fields, target))
-            }
-            _ => Err(HaversError::InternalError(
-                "log_* supports at most two extra arguments".to_string(),
-            )),
-        }
+impl Ord for HeapEntry {
+    // Reversed, so std's max-heap hands back the smallest key first
+    fn cmp(&self, other: &Self) -> std::cmp::Ordering {
+        heap_key_order(&other.key, &self.key).then_with(|| other.seq.cmp(&self.seq))
     }
+}
 
-    fn apply_log_config(&mut self, config: Option<Value>) -> Result<(), String> {
-        let dict = match config {
-            None => {
-                self.logger = logging::LoggerCore::new();
-                self.log_callback = None;
-                return Ok(());
-            }
-            Some(Value::Dict(d)) => d,
-            Some(_) => return Err("log_init() expects a dict".to_string()),
-        };
+/// A heap: a binary min-heap ordered by key_fn(item), or by the item itself when
+/// key_fn is nil.
+#[derive(Debug)]
+struct Heap {
+    key_fn: Value,
+    entries: RefCell<std::collections::BinaryHeap<HeapEntry>>,
+    next_seq: std::cell::Cell<u64>,
+}
 
-        let dict_ref = dict.borrow();
+impl Heap {
+    fn push(&self, key: Value, item: Value) {
+        let seq = self.next_seq.get();
+        self.next_seq.set(seq + 1);
+        self.entries.borrow_mut().push(HeapEntry { key, seq, item });
+    }
 
-        if let Some(level_val) = dict_get(&dict_ref, "level") {
-            let level = parse_log_level_value(&level_val)?;
-            set_global_log_level(level);
-        }
+    /// Every item, smallest key first; the heap itself is left as it was.
+    fn sorted(&self) -> Vec<Value> {
+        let mut entries = self.entries.borrow().clone().into_sorted_vec();
+        entries.reverse();
+        entries.into_iter().map(|entry| entry.item).collect()
+    }
+}
 
-        if let Some(filter_val) = dict_get(&dict_ref, "filter") {
-            let filter_str = match filter_val {
-                Value::String(s) => s,
-                _ => return Err("log_init() filter must be a string".to_string()),
-            };
-            logging::set_filter(&filter_str)?;
-        }
+impl NativeObject for Heap {
+    fn type_name(&self) -> &str {
+        "heap"
+    }
 
-        if let Some(format_val) = dict_get(&dict_ref, "format") {
-            let format_str = match format_val {
-                Value::String(s) => s,
-                _ => return Err("log_init() format must be a string".to_string()),
-            };
-            self.logger.format = match format_str.as_str() {
-                "text" => logging::LogFormat::Text,
-                "json" => logging::LogFormat::Json,
-                "compact" => logging::LogFormat::Compact,
-                _ => return Err("log_init() format must be text, json, or compact".to_string()),
-            };
-        }
+    fn get(&self, prop: &str) -> HaversResult<Value> {
+        Err(HaversError::UndefinedVariable {
+            name: prop.to_string(),
+            line: 0,
+        })
+    }
 
-        if let Some(color_val) = dict_get(&dict_ref, "color") {
-            match color_val {
-                Value::Bool(b) => self.logger.color = b,
-                _ => return Err("log_init() color must be a bool".to_string()),
+    fn set(&self, prop: &str, _value: Value) -> HaversResult<Value> {
+        Err(HaversError::TypeError {
+            message: format!("Cannae set '{}' on a heap", prop),
+            line: 0,
+        })
+    }
+
+    fn call(&self, _method: &str, _args: Vec<Value>) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
+
+    fn as_any(&self) -> &dyn std::any::Any {
+        self
+    }
+
+    fn to_string(&self) -> String {
+        let items: Vec<String> = self.sorted().iter().map(|v| v.to_string()).collect();
+        format!("heap[{}]", items.join(", "))
+    }
+
+    fn length(&self) -> Option<usize> {
+        Some(self.entries.borrow().len())
+    }
+
+    fn items(&self) -> Option<Vec<Value>> {
+        Some(self.sorted())
+    }
+}
+
+fn with_heap<T, F>(name: &str, value: &Value, f: F) -> Result<T, String>
+where
+    F: FnOnce(&Heap) -> Result<T, String>,
+{
+    match value {
+        Value::NativeObject(obj) => match obj.as_any().downcast_ref::<Heap>() {
+            Some(heap) => f(heap),
+            None => Err(format!("{}() needs a heap", name)),
+        },
+        _ => Err(format!("{}() needs a heap", name)),
+    }
+}
+
+/// A hash map keyed by value rather than identity: two keys are the same entry when
+/// they're ==, so a list of the same items, or 2 and 2.0, find the one slot. Entries
+/// sit in a Vec in the order they went in; removing one moves the last into its gap.
+#[derive(Debug, Default)]
+struct ValueMap {
+    index: HashMap<u64, Vec<usize>>,
+    entries: Vec<(Value, Value)>,
+}
+
+impl ValueMap {
+    fn find(&self, hash: u64, key: &Value) -> Option<usize> {
+        self.index
+            .get(&hash)?
+            .iter()
+            .copied()
+            .find(|&i| self.entries[i].0 == *key)
+    }
+
+    fn get(&self, key: &Value) -> Option<&Value> {
+        self.find(key.eq_hash(), key).map(|i| &self.entries[i].1)
+    }
+
+    fn keys(&self) -> Vec<Value> {
+        self.entries.iter().map(|(key, _)| key.clone()).collect()
+    }
+
+    /// Set key to value, returning the entry's slot
+    fn insert(&mut self, hash: u64, key: Value, value: Value) -> usize {
+        if let Some(i) = self.find(hash, &key) {
+            self.entries[i].1 = value;
+            return i;
+        }
+        let i = self.entries.len();
+        self.index.entry(hash).or_default().push(i);
+        self.entries.push((key, value));
+        i
+    }
+
+    /// Drop the entry in slot i, moving the last entry into the gap. Returns whether
+    /// there was one to move.
+    fn remove_at(&mut self, i: usize) -> bool {
+        let last = self.entries.len() - 1;
+        let hash = self.entries[i].0.eq_hash();
+        self.unindex(hash, i);
+        self.entries.swap_remove(i);
+        if i == last {
+            return false;
+        }
+        let moved = self.entries[i].0.eq_hash();
+        for slot in self.index.get_mut(&moved).into_iter().flatten() {
+            if *slot == last {
+                *slot = i;
             }
         }
+        true
+    }
 
-        if let Some(ts_val) = dict_get(&dict_ref, "timestamps") {
-            match ts_val {
-                Value::Bool(b) => self.logger.timestamps = b,
-                _ => return Err("log_init() timestamps must be a bool".to_string()),
+    fn unindex(&mut self, hash: u64, i: usize) {
+        if let Some(bucket) = self.index.get_mut(&hash) {
+            bucket.retain(|&slot| slot != i);
+            if bucket.is_empty() {
+                self.index.remove(&hash);
             }
         }
+    }
+}
 
-        if let Some(sinks_val) = dict_get(&dict_ref, "sinks") {
-            let list = match sinks_val {
-                Value::List(list) => list.borrow().clone(),
-                _ => return Err("log_init() sinks must be a list".to_string()),
-            };
-            let mut sinks = Vec::new();
-            let mut callback: Option<Value> = None;
+/// hashmap() - a ValueMap as a native object
+#[derive(Debug, Default)]
+struct HashMapValue {
+    map: RefCell<ValueMap>,
+}
 
-            for spec in list {
-                let spec_dict = match spec {
-                    Value::Dict(d) => d,
-                    _ => return Err("log_init() sink specs must be dicts".to_string()),
-                };
-                let spec_ref = spec_dict.borrow();
-                let kind = match dict_get(&spec_ref, "kind") {
-                    Some(Value::String(s)) => s,
-                    _ => return Err("log_init() sink kind must be a string".to_string()),
-                };
+impl NativeObject for HashMapValue {
+    fn type_name(&self) -> &str {
+        "hashmap"
+    }
 
-                match kind.as_str() {
-                    "stderr" => sinks.push(logging::LogSink::Stderr),
-                    "stdout" => sinks.push(logging::LogSink::Stdout),
-                    "file" => {
-                        let path = match dict_get(&spec_ref, "path") {
-                            Some(Value::String(s)) => s,
-                            _ => {
-                                return Err("log_init() file sink requires string path".to_string())
-                            }
-                        };
-                        let append = match dict_get(&spec_ref, "append") {
-                            Some(Value::Bool(b)) => b,
-                            None => true,
-                            _ => return Err("log_init() file append must be bool".to_string()),
-                        };
-                        sinks.push(logging::LogSink::File {
-                            path,
-                            append,
-                            file: None,
-                        });
-                    }
-                    "memory" => {
-                        let max = match dict_get(&spec_ref, "max") {
-                            Some(Value::Integer(n)) if n > 0 => n as usize,
-                            None => 1000,
-                            _ => return Err("log_init() memory max must be integer".to_string()),
-                        };
-                        sinks.push(logging::LogSink::Memory {
-                            entries: Vec::new(),
-                            max,
-                        });
-                    }
-                    "callback" => {
-                        let cb = dict_get(&spec_ref, "fn")
-                            .ok_or_else(|| "log_init() callback sink requires fn".to_string())?;
-                        callback = Some(cb);
-                    }
-                    _ => return Err(format!("Unknown log sink kind '{}'", kind)),
-                }
-            }
+    fn get(&self, prop: &str) -> HaversResult<Value> {
+        Err(HaversError::UndefinedVariable {
+            name: prop.to_string(),
+            line: 0,
+        })
+    }
 
-            if sinks.is_empty() {
-                sinks.push(logging::LogSink::Stderr);
-            }
-            self.logger.sinks = sinks;
-            self.log_callback = callback;
-        }
+    fn set(&self, prop: &str, _value: Value) -> HaversResult<Value> {
+        Err(HaversError::TypeError {
+            message: format!("Cannae set '{}' on a hashmap - use hashmap_set()", prop),
+            line: 0,
+        })
+    }
 
-        Ok(())
+    fn call(&self, _method: &str, _args: Vec<Value>) -> HaversResult<Value> {
+        Ok(Value::Nil)
     }
 
-    /// Enable trace mode fer debugging
-    pub fn set_trace_mode(&mut self, mode: TraceMode) {
-        self.trace_mode = mode;
+    fn as_any(&self) -> &dyn std::any::Any {
+        self
     }
 
-    /// Get current trace mode
-    #[allow(dead_code)]
-    pub fn trace_mode(&self) -> TraceMode {
-        self.trace_mode
+    fn to_string(&self) -> String {
+        let map = self.map.borrow();
+        let entries: Vec<String> = map
+            .entries
+            .iter()
+            .map(|(key, value)| format!("{}: {}", key, value))
+            .collect();
+        format!("hashmap{{{}}}", entries.join(", "))
     }
 
-    /// Print a trace message with proper indentation and Scottish flair
-    fn trace(&self, msg: &str) {
-        if self.trace_mode != TraceMode::Off {
-            let indent = "  ".repeat(self.trace_depth);
-            eprintln!("\x1b[33m🏴󠁧󠁢󠁳󠁣󠁴󠁿 {}{}\x1b[0m", indent, msg);
-        }
+    fn length(&self) -> Option<usize> {
+        Some(self.map.borrow().entries.len())
     }
 
-    /// Print a verbose trace message (only in verbose mode)
-    fn trace_verbose(&self, msg: &str) {
-        if self.trace_mode == TraceMode::Verbose {
-            let indent = "  ".repeat(self.trace_depth);
-            eprintln!("\x1b[36m   {}{}\x1b[0m", indent, msg);
-        }
+    fn items(&self) -> Option<Vec<Value>> {
+        Some(self.map.borrow().keys())
     }
+}
 
-    /// Create an interpreter with a specific working directory
-    #[allow(dead_code)]
-    pub fn with_dir<P: AsRef<Path>>(dir: P) -> Self {
-        let mut interp = Self::new();
-        interp.current_dir = dir.as_ref().to_path_buf();
-        interp
+fn with_hashmap<T, F>(name: &str, value: &Value, f: F) -> Result<T, String>
+where
+    F: FnOnce(&HashMapValue) -> Result<T, String>,
+{
+    match value {
+        Value::NativeObject(obj) => match obj.as_any().downcast_ref::<HashMapValue>() {
+            Some(map) => f(map),
+            None => Err(format!("{}() needs a hashmap", name)),
+        },
+        _ => Err(format!("{}() needs a hashmap", name)),
     }
+}
 
-    /// Set the current directory fer module resolution
-    pub fn set_current_dir<P: AsRef<Path>>(&mut self, dir: P) {
-        self.current_dir = dir.as_ref().to_path_buf();
+/// No slot, at the end of a MemoCache's recency list
+const MEMO_NONE: usize = usize::MAX;
+
+/// The results a memoize()d function has seen, keyed by argument in a ValueMap. prev and
+/// next link the slots from most to least recently used, so once limit results are held
+/// the stalest is dropped to make room (limit 0 keeps everything).
+#[derive(Debug)]
+struct MemoCache {
+    map: ValueMap,
+    prev: Vec<usize>,
+    next: Vec<usize>,
+    head: usize,
+    tail: usize,
+    limit: usize,
+}
+
+impl MemoCache {
+    fn new(limit: usize) -> Self {
+        MemoCache {
+            map: ValueMap::default(),
+            prev: Vec::new(),
+            next: Vec::new(),
+            head: MEMO_NONE,
+            tail: MEMO_NONE,
+            limit,
+        }
     }
 
-    /// Get all user-defined variables (fer REPL environment inspection)
-    pub fn get_user_variables(&self) -> Vec<(String, String, String)> {
-        let env = self.environment.borrow();
-        let exports = env.get_exports();
-        let mut vars = Vec::new();
+    fn lookup(&mut self, hash: u64, key: &Value) -> Option<Value> {
+        let i = self.map.find(hash, key)?;
+        self.unlink(i);
+        self.link_front(i);
+        Some(self.map.entries[i].1.clone())
+    }
 
-        // Get all variables that aren't native functions
-        for (name, value) in exports.iter() {
-            // Skip native functions
-            if matches!(value, Value::NativeFunction(_)) {
-                continue;
-            }
-            // Skip built-in math constants unless they've been overridden.
-            if let Value::Float(f) = value {
-                if (name == "PI" && *f == std::f64::consts::PI)
-                    || (name == "E" && *f == std::f64::consts::E)
-                    || (name == "TAU" && *f == std::f64::consts::TAU)
-                {
-                    continue;
-                }
-            }
-            // Skip internal builtin placeholders used by the JS compiler.
-            if let Value::String(s) = value {
-                if s.starts_with("__builtin_") && s.ends_with("__") {
-                    continue;
-                }
+    fn store(&mut self, hash: u64, key: Value, value: Value) {
+        if let Some(i) = self.map.find(hash, &key) {
+            // A recursive call filled it in while this one was running
+            self.map.entries[i].1 = value;
+            return;
+        }
+        if self.limit > 0 && self.map.entries.len() >= self.limit {
+            self.evict(self.tail);
+        }
+        let i = self.map.insert(hash, key, value);
+        self.prev.push(MEMO_NONE);
+        self.next.push(MEMO_NONE);
+        self.link_front(i);
+    }
+
+    fn evict(&mut self, i: usize) {
+        self.unlink(i);
+        self.prev.swap_remove(i);
+        self.next.swap_remove(i);
+        if self.map.remove_at(i) {
+            // The last slot moved into i; point its neighbours at the new place
+            match self.prev[i] {
+                MEMO_NONE => self.head = i,
+                p => self.next[p] = i,
             }
-            // Skip prelude functions (they have specific patterns)
-            if matches!(value, Value::Function(_)) {
-                // Include user-defined functions but mark them
-                vars.push((name.clone(), "function".to_string(), format!("{}", value)));
-            } else {
-                vars.push((
-                    name.clone(),
-                    value.type_name().to_string(),
-                    format!("{}", value),
-                ));
+            match self.next[i] {
+                MEMO_NONE => self.tail = i,
+                n => self.prev[n] = i,
             }
         }
+    }
 
-        // Sort by name for consistent display
-        vars.sort_by(|a, b| a.0.cmp(&b.0));
-        vars
+    fn unlink(&mut self, i: usize) {
+        let (p, n) = (self.prev[i], self.next[i]);
+        match p {
+            MEMO_NONE => self.head = n,
+            p => self.next[p] = n,
+        }
+        match n {
+            MEMO_NONE => self.tail = p,
+            n => self.prev[n] = p,
+        }
+        self.prev[i] = MEMO_NONE;
+        self.next[i] = MEMO_NONE;
     }
 
-    /// Load the standard prelude (automatically loaded unless disabled)
-    /// The prelude provides common utility functions written in mdhavers
-    pub fn load_prelude(&mut self) -> HaversResult<()> {
-        if self.prelude_loaded {
-            return Ok(());
+    fn link_front(&mut self, i: usize) {
+        self.next[i] = self.head;
+        match self.head {
+            MEMO_NONE => self.tail = i,
+            head => self.prev[head] = i,
         }
+        self.head = i;
+    }
+}
 
-        // Try tae find the prelude in these locations:
-        // 1. stdlib/prelude.braw relative tae the executable
-        // 2. stdlib/prelude.braw relative tae current directory
-        // 3. Embedded prelude as fallback
+/// One key/value in a frozen dict's trie; seq is the order the key went in.
+#[derive(Debug, Clone)]
+struct HamtLeaf {
+    hash: u64,
+    key_id: ValueKey,
+    key: Value,
+    value: Value,
+    seq: u64,
+}
 
-        let prelude_locations = [
-            // Next tae the executable
-            std::env::current_exe()
-                .ok()
-                .and_then(|p| p.parent().map(|d| d.join("stdlib/prelude.braw"))),
-            // In the current directory
-            Some(PathBuf::from("stdlib/prelude.braw")),
-            // In the project root (fer development)
-            Some(PathBuf::from("../stdlib/prelude.braw")),
-        ];
+#[derive(Debug, Clone)]
+enum HamtSlot {
+    Leaf(HamtLeaf),
+    Node(Rc<HamtNode>),
+}
 
-        for maybe_path in prelude_locations.iter().flatten() {
-            if let Ok(source) = std::fs::read_to_string(maybe_path) {
-                match crate::parser::parse(&source) {
-                    Ok(program) => {
-                        // Execute prelude in globals
-                        for stmt in &program.statements {
-                            self.execute_stmt(stmt)?;
-                        }
-                        self.prelude_loaded = true;
-                        return Ok(());
-                    }
-                    Err(e) => {
-                        // Prelude has syntax error - this is a bug
-                        return Err(HaversError::ParseError {
-                            message: format!("Prelude has errors (this shouldnae happen!): {}", e),
-                            line: 1,
-                        });
+/// A frozen dict trie node: one slot per set bit of bitmap, in bit order. A collision
+/// node holds leaves whose full hashes match, unindexed.
+#[derive(Debug, Clone)]
+struct HamtNode {
+    bitmap: u32,
+    collision: bool,
+    slots: Vec<HamtSlot>,
+}
+
+const HAMT_BITS: u32 = 5;
+const HAMT_LAST_SHIFT: u32 = 60;
+
+fn hamt_hash(key: &ValueKey) -> u64 {
+    use std::hash::{Hash, Hasher};
+    let mut hasher = std::collections::hash_map::DefaultHasher::new();
+    key.hash(&mut hasher);
+    hasher.finish()
+}
+
+fn hamt_bit(hash: u64, shift: u32) -> u32 {
+    1 << ((hash >> shift) & 31)
+}
+
+impl HamtNode {
+    fn index(&self, bit: u32) -> usize {
+        (self.bitmap & (bit - 1)).count_ones() as usize
+    }
+
+    fn find(&self, shift: u32, hash: u64, key: &ValueKey) -> Option<&Value> {
+        if self.collision {
+            return self.slots.iter().find_map(|slot| match slot {
+                HamtSlot::Leaf(leaf) if leaf.key_id == *key => Some(&leaf.value),
+                _ => None,
+            });
+        }
+        let bit = hamt_bit(hash, shift);
+        if self.bitmap & bit == 0 {
+            return None;
+        }
+        match &self.slots[self.index(bit)] {
+            HamtSlot::Node(child) => child.find(shift + HAMT_BITS, hash, key),
+            HamtSlot::Leaf(leaf) => {
+                (leaf.hash == hash && leaf.key_id == *key).then_some(&leaf.value)
+            }
+        }
+    }
+
+    /// A node at shift holding two leaves whose hashes agree below it.
+    fn pair(shift: u32, a: HamtLeaf, b: HamtLeaf) -> HamtNode {
+        if shift > HAMT_LAST_SHIFT {
+            return HamtNode {
+                bitmap: 0,
+                collision: true,
+                slots: vec![HamtSlot::Leaf(a), HamtSlot::Leaf(b)],
+            };
+        }
+        let (bit_a, bit_b) = (hamt_bit(a.hash, shift), hamt_bit(b.hash, shift));
+        if bit_a == bit_b {
+            let child = HamtNode::pair(shift + HAMT_BITS, a, b);
+            return HamtNode {
+                bitmap: bit_a,
+                collision: false,
+                slots: vec![HamtSlot::Node(Rc::new(child))],
+            };
+        }
+        let (first, second) = if bit_a < bit_b { (a, b) } else { (b, a) };
+        HamtNode {
+            bitmap: bit_a | bit_b,
+            collision: false,
+            slots: vec![HamtSlot::Leaf(first), HamtSlot::Leaf(second)],
+        }
+    }
+
+    /// A copy of the path to leaf's key with leaf set, and whether the key was new. A key
+    /// already present keeps its place in the order.
+    fn insert(&self, shift: u32, leaf: HamtLeaf) -> (HamtNode, bool) {
+        let mut copy = self.clone();
+        if self.collision {
+            for slot in copy.slots.iter_mut() {
+                if let HamtSlot::Leaf(old) = slot {
+                    if old.key_id == leaf.key_id {
+                        old.value = leaf.value;
+                        return (copy, false);
                     }
                 }
             }
+            copy.slots.push(HamtSlot::Leaf(leaf));
+            return (copy, true);
         }
-
-        // If nae prelude file found, that's okay - just continue without it
-        // The language still works, just without the convenience functions
-        self.prelude_loaded = true;
-        Ok(())
+        let bit = hamt_bit(leaf.hash, shift);
+        let idx = self.index(bit);
+        if self.bitmap & bit == 0 {
+            copy.bitmap |= bit;
+            copy.slots.insert(idx, HamtSlot::Leaf(leaf));
+            return (copy, true);
+        }
+        let (slot, added) = match &self.slots[idx] {
+            HamtSlot::Node(child) => {
+                let (node, added) = child.insert(shift + HAMT_BITS, leaf);
+                (HamtSlot::Node(Rc::new(node)), added)
+            }
+            HamtSlot::Leaf(old) if old.hash == leaf.hash && old.key_id == leaf.key_id => {
+                let mut kept = old.clone();
+                kept.value = leaf.value;
+                (HamtSlot::Leaf(kept), false)
+            }
+            HamtSlot::Leaf(old) => {
+                let node = HamtNode::pair(shift + HAMT_BITS, old.clone(), leaf);
+                (HamtSlot::Node(Rc::new(node)), true)
+            }
+        };
+        copy.slots[idx] = slot;
+        (copy, added)
     }
 
-    /// Check if prelude is loaded
-    #[allow(dead_code)]
-    pub fn has_prelude(&self) -> bool {
-        self.prelude_loaded
+    /// A copy of the path to key without it: None when the key is absent, Some(None) once
+    /// nothing is left in this node.
+    fn remove(&self, shift: u32, hash: u64, key: &ValueKey) -> Option<Option<HamtNode>> {
+        let mut copy = self.clone();
+        let idx = if self.collision {
+            self.slots
+                .iter()
+                .position(|slot| matches!(slot, HamtSlot::Leaf(leaf) if leaf.key_id == *key))?
+        } else {
+            let bit = hamt_bit(hash, shift);
+            if self.bitmap & bit == 0 {
+                return None;
+            }
+            let idx = self.index(bit);
+            match &self.slots[idx] {
+                HamtSlot::Node(child) => {
+                    if let Some(node) = child.remove(shift + HAMT_BITS, hash, key)? {
+                        copy.slots[idx] = HamtSlot::Node(Rc::new(node));
+                        return Some(Some(copy));
+                    }
+                }
+                HamtSlot::Leaf(leaf) if leaf.hash == hash && leaf.key_id == *key => {}
+                HamtSlot::Leaf(_) => return None,
+            }
+            copy.bitmap &= !bit;
+            idx
+        };
+        copy.slots.remove(idx);
+        Some((!copy.slots.is_empty()).then_some(copy))
     }
 
-    fn define_natives(globals: &Rc<RefCell<Environment>>) {
-        // get_key - read a single key press (raw input)
-        // Not reliably testable under source-based coverage (non-TTY), so exclude from coverage builds.
-        #[cfg(all(feature = "cli", not(coverage)))]
-        globals.borrow_mut().define(
-            "get_key".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("get_key", 0, |_args| {
-                enable_raw_mode().map_err(|e| format!("Cannae enable raw mode: {}", e))?;
+    fn collect<'a>(&'a self, out: &mut Vec<&'a HamtLeaf>) {
+        for slot in &self.slots {
+            match slot {
+                HamtSlot::Leaf(leaf) => out.push(leaf),
+                HamtSlot::Node(child) => child.collect(out),
+            }
+        }
+    }
+}
 
-                let result = match read() {
-                    Ok(Event::Key(KeyEvent { code, .. })) => match code {
-                        KeyCode::Char(c) => Ok(Value::String(c.to_string())),
-                        KeyCode::Enter => Ok(Value::String("\n".to_string())),
-                        KeyCode::Esc => Ok(Value::String("\x1b".to_string())),
-                        KeyCode::Backspace => Ok(Value::String("\x08".to_string())),
-                        KeyCode::Left => Ok(Value::String("Left".to_string())),
-                        KeyCode::Right => Ok(Value::String("Right".to_string())),
-                        KeyCode::Up => Ok(Value::String("Up".to_string())),
-                        KeyCode::Down => Ok(Value::String("Down".to_string())),
-                        _ => Ok(Value::String("".to_string())),
-                    },
-                    Ok(_) => Ok(Value::String("".to_string())),
-                    Err(e) => Err(format!("Cannae read key: {}", e)),
-                };
+/// A frozen_dict version: a hash array mapped trie, so frozen_set and frozen_remove copy
+/// only the path to the key and share the rest with the version they came from.
+#[derive(Debug, Default)]
+struct FrozenDict {
+    root: Option<Rc<HamtNode>>,
+    len: usize,
+    next_seq: u64,
+}
 
-                disable_raw_mode().map_err(|e| format!("Cannae disable raw mode: {}", e))?;
+impl FrozenDict {
+    fn get(&self, key: &Value) -> Option<&Value> {
+        let key_id = key.as_key();
+        self.root.as_ref()?.find(0, hamt_hash(&key_id), &key_id)
+    }
+
+    fn with(&self, key: Value, value: Value) -> FrozenDict {
+        let key_id = key.as_key();
+        let hash = hamt_hash(&key_id);
+        let leaf = HamtLeaf {
+            hash,
+            key_id,
+            key,
+            value,
+            seq: self.next_seq,
+        };
+        let (root, added) = match &self.root {
+            Some(root) => root.insert(0, leaf),
+            None => (
+                HamtNode {
+                    bitmap: hamt_bit(hash, 0),
+                    collision: false,
+                    slots: vec![HamtSlot::Leaf(leaf)],
+                },
+                true,
+            ),
+        };
+        FrozenDict {
+            root: Some(Rc::new(root)),
+            len: self.len + added as usize,
+            next_seq: self.next_seq + added as u64,
+        }
+    }
 
-                result
-            }))),
-        );
-        // len - get length of list, string, dict, or set
-        globals.borrow_mut().define(
-            "len".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("len", 1, |args| {
-                match &args[0] {
-                    Value::String(s) => Ok(Value::Integer(s.len() as i64)),
-                    Value::List(l) => Ok(Value::Integer(l.borrow().len() as i64)),
-                    Value::Dict(d) => Ok(Value::Integer(d.borrow().len() as i64)),
-                    Value::Set(s) => Ok(Value::Integer(s.borrow().len() as i64)),
-                    Value::Bytes(b) => Ok(Value::Integer(b.borrow().len() as i64)),
-                    _ => Err("len() expects a string, list, dict, creel, or bytes".to_string()),
-                }
-            }))),
-        );
+    /// This dict without key, or None when it wasn't there.
+    fn without(&self, key: &Value) -> Option<FrozenDict> {
+        let key_id = key.as_key();
+        let root = self.root.as_ref()?.remove(0, hamt_hash(&key_id), &key_id)?;
+        Some(FrozenDict {
+            root: root.map(Rc::new),
+            len: self.len - 1,
+            next_seq: self.next_seq,
+        })
+    }
 
-        // bytes - create a zeroed byte buffer of given size
-        globals.borrow_mut().define(
-            "bytes".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("bytes", 1, |args| {
-                let size = match &args[0] {
-                    Value::Integer(n) => *n,
-                    Value::Float(f) => *f as i64,
-                    _ => return Err("bytes() expects an integer size".to_string()),
-                };
-                let size = if size < 0 { 0 } else { size } as usize;
-                Ok(Value::Bytes(Rc::new(RefCell::new(vec![0u8; size]))))
-            }))),
-        );
+    /// Entries in the order their keys went in.
+    fn entries(&self) -> Vec<(Value, Value)> {
+        let mut leaves = Vec::with_capacity(self.len);
+        if let Some(root) = &self.root {
+            root.collect(&mut leaves);
+        }
+        leaves.sort_by_key(|leaf| leaf.seq);
+        leaves
+            .into_iter()
+            .map(|leaf| (leaf.key.clone(), leaf.value.clone()))
+            .collect()
+    }
 
-        // bytes_from_string - create bytes from string
-        globals.borrow_mut().define(
-            "bytes_from_string".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "bytes_from_string",
-                1,
-                |args| {
-                    let s = match &args[0] {
-                        Value::String(s) => s.clone(),
-                        _ => format!("{}", args[0]),
-                    };
-                    Ok(Value::Bytes(Rc::new(RefCell::new(s.as_bytes().to_vec()))))
-                },
-            ))),
-        );
+    fn thawed(&self) -> Value {
+        let mut dict = DictValue::with_capacity(self.len);
+        for (key, value) in self.entries() {
+            dict.set(key, value);
+        }
+        Value::Dict(Rc::new(RefCell::new(dict)))
+    }
+}
 
-        // bytes_len - get length of a byte buffer
-        globals.borrow_mut().define(
-            "bytes_len".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("bytes_len", 1, |args| {
-                if let Value::Bytes(b) = &args[0] {
-                    Ok(Value::Integer(b.borrow().len() as i64))
-                } else {
-                    Err("bytes_len() expects bytes".to_string())
-                }
-            }))),
-        );
+/// A frozen_list node: up to 32 items in a leaf, 32 subtrees in a branch.
+#[derive(Debug)]
+enum VecNode {
+    Leaf(Vec<Value>),
+    Branch(Vec<Rc<VecNode>>),
+}
 
-        // bytes_slice - slice a byte buffer
-        globals.borrow_mut().define(
-            "bytes_slice".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("bytes_slice", 3, |args| {
-                let bytes = match &args[0] {
-                    Value::Bytes(b) => b.borrow(),
-                    _ => return Err("bytes_slice() expects bytes".to_string()),
-                };
-                let start = match &args[1] {
-                    Value::Integer(n) => *n,
-                    _ => return Err("bytes_slice() expects integer start".to_string()),
-                };
-                let end = match &args[2] {
-                    Value::Integer(n) => *n,
-                    _ => return Err("bytes_slice() expects integer end".to_string()),
-                };
-                let len = bytes.len() as i64;
-                let mut s = start;
-                let mut e = end;
-                if s < 0 {
-                    s += len;
-                }
-                if e < 0 {
-                    e += len;
-                }
-                if s < 0 {
-                    s = 0;
-                }
-                if e > len {
-                    e = len;
-                }
-                if e < s {
-                    e = s;
-                }
-                let out = bytes[s as usize..e as usize].to_vec();
-                Ok(Value::Bytes(Rc::new(RefCell::new(out))))
-            }))),
-        );
+/// A frozen_list version: a 32-way vector trie, item i in leaf i >> 5. shift is 5 per
+/// branch level above the leaves.
+#[derive(Debug, Default)]
+struct FrozenList {
+    root: Option<Rc<VecNode>>,
+    len: usize,
+    shift: u32,
+}
 
-        // bytes_get - get byte at index
-        globals.borrow_mut().define(
-            "bytes_get".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("bytes_get", 2, |args| {
-                let bytes = match &args[0] {
-                    Value::Bytes(b) => b.borrow(),
-                    _ => return Err("bytes_get() expects bytes".to_string()),
-                };
-                let mut idx = match &args[1] {
-                    Value::Integer(n) => *n,
-                    _ => return Err("bytes_get() expects integer index".to_string()),
-                };
-                let len = bytes.len() as i64;
-                if idx < 0 {
-                    idx += len;
-                }
-                if idx < 0 || idx >= len {
-                    return Err("bytes_get() index oot o' bounds".to_string());
-                }
-                Ok(Value::Integer(bytes[idx as usize] as i64))
-            }))),
-        );
+impl FrozenList {
+    fn from_items(items: &[Value]) -> FrozenList {
+        if items.is_empty() {
+            return FrozenList::default();
+        }
+        let mut level: Vec<Rc<VecNode>> = items
+            .chunks(32)
+            .map(|chunk| Rc::new(VecNode::Leaf(chunk.to_vec())))
+            .collect();
+        let mut shift = 0;
+        while level.len() > 1 {
+            level = level
+                .chunks(32)
+                .map(|chunk| Rc::new(VecNode::Branch(chunk.to_vec())))
+                .collect();
+            shift += HAMT_BITS;
+        }
+        FrozenList {
+            root: level.pop(),
+            len: items.len(),
+            shift,
+        }
+    }
 
-        // bytes_set - set byte at index
-        globals.borrow_mut().define(
-            "bytes_set".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("bytes_set", 3, |args| {
-                let bytes = match &args[0] {
-                    Value::Bytes(b) => b.clone(),
-                    _ => return Err("bytes_set() expects bytes".to_string()),
-                };
-                let mut idx = match &args[1] {
-                    Value::Integer(n) => *n,
-                    _ => return Err("bytes_set() expects integer index".to_string()),
-                };
-                let v = match &args[2] {
-                    Value::Integer(n) => *n,
-                    Value::Float(f) => *f as i64,
-                    _ => return Err("bytes_set() expects integer value".to_string()),
-                };
-                if v < 0 || v > 255 {
-                    return Err("bytes_set() value must be between 0 and 255".to_string());
-                }
-                {
-                    let mut buf = bytes.borrow_mut();
-                    let len = buf.len() as i64;
-                    if idx < 0 {
-                        idx += len;
-                    }
-                    if idx < 0 || idx >= len {
-                        return Err("bytes_set() index oot o' bounds".to_string());
-                    }
-                    buf[idx as usize] = v as u8;
-                }
-                Ok(Value::Bytes(bytes))
-            }))),
-        );
+    /// Where index i lands, counting from the end when negative.
+    fn slot(&self, i: i64) -> Option<usize> {
+        let i = if i < 0 { self.len as i64 + i } else { i };
+        (i >= 0 && (i as usize) < self.len).then_some(i as usize)
+    }
 
-        // bytes_append - append bytes to bytes
-        globals.borrow_mut().define(
-            "bytes_append".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("bytes_append", 2, |args| {
-                let bytes = match &args[0] {
-                    Value::Bytes(b) => b.clone(),
-                    _ => return Err("bytes_append() expects bytes".to_string()),
-                };
-                let other = match &args[1] {
-                    Value::Bytes(b) => b.borrow(),
-                    _ => return Err("bytes_append() expects bytes".to_string()),
-                };
-                bytes.borrow_mut().extend_from_slice(&other);
-                Ok(Value::Bytes(bytes))
-            }))),
-        );
+    fn get(&self, i: i64) -> Option<&Value> {
+        let i = self.slot(i)?;
+        let mut node = self.root.as_ref()?;
+        let mut shift = self.shift;
+        loop {
+            match &**node {
+                VecNode::Branch(kids) => node = &kids[(i >> shift) & 31],
+                VecNode::Leaf(items) => return items.get(i & 31),
+            }
+            shift = shift.saturating_sub(HAMT_BITS);
+        }
+    }
 
-        // bytes_read_u16be
-        globals.borrow_mut().define(
-            "bytes_read_u16be".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "bytes_read_u16be",
-                2,
-                |args| {
-                    let bytes = match &args[0] {
-                        Value::Bytes(b) => b.borrow(),
-                        _ => return Err("bytes_read_u16be() expects bytes".to_string()),
-                    };
-                    let off = match &args[1] {
-                        Value::Integer(n) => *n,
-                        _ => return Err("bytes_read_u16be() expects integer offset".to_string()),
-                    };
-                    if off < 0 || (off as usize + 2) > bytes.len() {
-                        return Err("bytes_read_u16be() out o' bounds".to_string());
-                    }
-                    let v = ((bytes[off as usize] as u16) << 8) | (bytes[off as usize + 1] as u16);
-                    Ok(Value::Integer(v as i64))
-                },
+    /// A copy of the path down to item i, set to value (or appended when i is the end).
+    fn assoc(node: Option<&Rc<VecNode>>, shift: u32, i: usize, value: Value) -> VecNode {
+        if shift == 0 {
+            let mut items = match node.map(|node| &**node) {
+                Some(VecNode::Leaf(items)) => items.clone(),
+                _ => Vec::with_capacity(32),
+            };
+            match items.get_mut(i & 31) {
+                Some(slot) => *slot = value,
+                None => items.push(value),
+            }
+            return VecNode::Leaf(items);
+        }
+        let mut kids = match node.map(|node| &**node) {
+            Some(VecNode::Branch(kids)) => kids.clone(),
+            _ => Vec::with_capacity(32),
+        };
+        let k = (i >> shift) & 31;
+        let child = Rc::new(FrozenList::assoc(kids.get(k), shift - HAMT_BITS, i, value));
+        match kids.get_mut(k) {
+            Some(slot) => *slot = child,
+            None => kids.push(child),
+        }
+        VecNode::Branch(kids)
+    }
+
+    fn with(&self, i: usize, value: Value) -> FrozenList {
+        FrozenList {
+            root: Some(Rc::new(FrozenList::assoc(
+                self.root.as_ref(),
+                self.shift,
+                i,
+                value,
             ))),
-        );
+            len: self.len,
+            shift: self.shift,
+        }
+    }
 
-        // bytes_read_u32be
-        globals.borrow_mut().define(
-            "bytes_read_u32be".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "bytes_read_u32be",
-                2,
-                |args| {
-                    let bytes = match &args[0] {
-                        Value::Bytes(b) => b.borrow(),
-                        _ => return Err("bytes_read_u32be() expects bytes".to_string()),
-                    };
-                    let off = match &args[1] {
-                        Value::Integer(n) => *n,
-                        _ => return Err("bytes_read_u32be() expects integer offset".to_string()),
-                    };
-                    if off < 0 || (off as usize + 4) > bytes.len() {
-                        return Err("bytes_read_u32be() out o' bounds".to_string());
-                    }
-                    let v = ((bytes[off as usize] as u32) << 24)
-                        | ((bytes[off as usize + 1] as u32) << 16)
-                        | ((bytes[off as usize + 2] as u32) << 8)
-                        | (bytes[off as usize + 3] as u32);
-                    Ok(Value::Integer(v as i64))
-                },
+    fn pushed(&self, value: Value) -> FrozenList {
+        let mut root = self.root.clone();
+        let mut shift = self.shift;
+        if let Some(full) = root.as_ref().filter(|_| self.len == 32 << shift) {
+            root = Some(Rc::new(VecNode::Branch(vec![full.clone()])));
+            shift += HAMT_BITS;
+        }
+        FrozenList {
+            root: Some(Rc::new(FrozenList::assoc(
+                root.as_ref(),
+                shift,
+                self.len,
+                value,
             ))),
-        );
+            len: self.len + 1,
+            shift,
+        }
+    }
 
-        // bytes_write_u16be
-        globals.borrow_mut().define(
-            "bytes_write_u16be".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "bytes_write_u16be",
-                3,
-                |args| {
-                    let bytes = match &args[0] {
-                        Value::Bytes(b) => b.clone(),
-                        _ => return Err("bytes_write_u16be() expects bytes".to_string()),
-                    };
-                    let off = match &args[1] {
-                        Value::Integer(n) => *n,
-                        _ => return Err("bytes_write_u16be() expects integer offset".to_string()),
-                    };
-                    let v = match &args[2] {
-                        Value::Integer(n) => *n,
-                        Value::Float(f) => *f as i64,
-                        _ => return Err("bytes_write_u16be() expects integer value".to_string()),
-                    };
-                    if v < 0 || v > 0xFFFF {
-                        return Err("bytes_write_u16be() value out o' range".to_string());
-                    }
-                    {
-                        let mut buf = bytes.borrow_mut();
-                        if off < 0 || (off as usize + 2) > buf.len() {
-                            return Err("bytes_write_u16be() out o' bounds".to_string());
-                        }
-                        buf[off as usize] = ((v >> 8) & 0xFF) as u8;
-                        buf[off as usize + 1] = (v & 0xFF) as u8;
-                    }
-                    Ok(Value::Bytes(bytes))
-                },
-            ))),
-        );
+    fn items(&self) -> Vec<Value> {
+        fn walk(node: &VecNode, out: &mut Vec<Value>) {
+            match node {
+                VecNode::Leaf(items) => out.extend(items.iter().cloned()),
+                VecNode::Branch(kids) => kids.iter().for_each(|kid| walk(kid, out)),
+            }
+        }
+        let mut out = Vec::with_capacity(self.len);
+        if let Some(root) = &self.root {
+            walk(root, &mut out);
+        }
+        out
+    }
+}
 
-        // bytes_write_u32be
-        globals.borrow_mut().define(
-            "bytes_write_u32be".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "bytes_write_u32be",
-                3,
-                |args| {
-                    let bytes = match &args[0] {
-                        Value::Bytes(b) => b.clone(),
-                        _ => return Err("bytes_write_u32be() expects bytes".to_string()),
-                    };
-                    let off = match &args[1] {
-                        Value::Integer(n) => *n,
-                        _ => return Err("bytes_write_u32be() expects integer offset".to_string()),
-                    };
-                    let v = match &args[2] {
-                        Value::Integer(n) => *n,
-                        Value::Float(f) => *f as i64,
-                        _ => return Err("bytes_write_u32be() expects integer value".to_string()),
-                    };
-                    if v < 0 || v > 0xFFFF_FFFF {
-                        return Err("bytes_write_u32be() value out o' range".to_string());
-                    }
-                    {
-                        let mut buf = bytes.borrow_mut();
-                        if off < 0 || (off as usize + 4) > buf.len() {
-                            return Err("bytes_write_u32be() out o' bounds".to_string());
-                        }
-                        buf[off as usize] = ((v >> 24) & 0xFF) as u8;
-                        buf[off as usize + 1] = ((v >> 16) & 0xFF) as u8;
-                        buf[off as usize + 2] = ((v >> 8) & 0xFF) as u8;
-                        buf[off as usize + 3] = (v & 0xFF) as u8;
-                    }
-                    Ok(Value::Bytes(bytes))
-                },
-            ))),
-        );
+impl NativeObject for FrozenDict {
+    fn type_name(&self) -> &str {
+        "frozen_dict"
+    }
 
-        #[cfg(all(feature = "native", unix))]
-        {
-            // socket_udp - create UDP socket
-            globals.borrow_mut().define(
-                "socket_udp".to_string(),
-		                Value::NativeFunction(Rc::new(NativeFunction::new("socket_udp", 0, |_args| {
-		                    let fd = unsafe { libc::socket(libc::AF_INET, libc::SOCK_DGRAM, 0) };
-		                    if fd < 0 { let err = std::io::Error::last_os_error(); return Ok(result_err(err.to_string(), err.raw_os_error().unwrap_or(-1) as i64)); }
-		                    let id = register_socket(fd, SocketKind::Udp);
-		                    Ok(result_ok(Value::Integer(id)))
-		                }))),
-		            );
+    fn get(&self, prop: &str) -> HaversResult<Value> {
+        FrozenDict::get(self, &Value::String(prop.into()))
+            .cloned()
+            .ok_or_else(|| HaversError::UndefinedVariable {
+                name: prop.to_string(),
+                line: 0,
+            })
+    }
 
-            // socket_tcp - create TCP socket
-            globals.borrow_mut().define(
-                "socket_tcp".to_string(),
-		                Value::NativeFunction(Rc::new(NativeFunction::new("socket_tcp", 0, |_args| {
-		                    let fd = unsafe { libc::socket(libc::AF_INET, libc::SOCK_STREAM, 0) };
-		                    if fd < 0 { let err = std::io::Error::last_os_error(); return Ok(result_err(err.to_string(), err.raw_os_error().unwrap_or(-1) as i64)); }
-		                    let id = register_socket(fd, SocketKind::Tcp);
-		                    Ok(result_ok(Value::Integer(id)))
-		                }))),
-		            );
+    fn set(&self, prop: &str, _value: Value) -> HaversResult<Value> {
+        Err(HaversError::TypeError {
+            message: format!("Cannae set '{}' on a frozen_dict - use frozen_set()", prop),
+            line: 0,
+        })
+    }
 
-            // socket_bind(sock, host, port)
-            globals.borrow_mut().define(
-                "socket_bind".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("socket_bind", 3, |args| {
-                    let sock_id = args[0]
-                        .as_integer()
-                        .ok_or("socket_bind() expects socket id")?;
-                    let host = match &args[1] {
-                        Value::Nil => None,
-                        Value::String(s) if s.is_empty() => None,
-                        Value::String(s) => Some(s.as_str()),
-                        _ => return Err("socket_bind() expects host string or nil".to_string()),
-                    };
-                    let port = args[2]
-                        .as_integer()
-                        .ok_or("socket_bind() expects port integer")?;
-                    if port < 0 || port > 65535 {
-                        return Err("socket_bind() port must be 0..65535".to_string());
-                    }
+    fn call(&self, _method: &str, _args: Vec<Value>) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
 
-                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
-                    let addr = resolve_ipv4_addr(host, port as u16)
-                        .map_err(|e| format!("socket_bind() {}", e))?;
-                    let rc = unsafe {
-                        libc::bind(
-                            entry.fd,
-                            &addr as *const _ as *const libc::sockaddr,
-                            std::mem::size_of::<libc::sockaddr_in>() as libc::socklen_t,
-                        )
-                    };
-                    if rc != 0 {
-                        let err = std::io::Error::last_os_error();
-                        let code = err.raw_os_error().unwrap_or(-1) as i64;
-                        return Ok(result_err(err.to_string(), code));
-                    }
-                    Ok(result_ok(Value::Nil))
-                }))),
-            );
+    fn as_any(&self) -> &dyn std::any::Any {
+        self
+    }
 
-            // socket_connect(sock, host, port)
-            globals.borrow_mut().define(
-                "socket_connect".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("socket_connect", 3, |args| {
-                    let sock_id = args[0]
-                        .as_integer()
-                        .ok_or("socket_connect() expects socket id")?;
-                    let host = match &args[1] {
-                        Value::String(s) => s.as_str(),
-                        _ => return Err("socket_connect() expects host string".to_string()),
-                    };
-                    let port = args[2]
-                        .as_integer()
-                        .ok_or("socket_connect() expects port integer")?;
-                    if port < 0 || port > 65535 {
-                        return Err("socket_connect() port must be 0..65535".to_string());
-                    }
+    fn to_string(&self) -> String {
+        format!("frozen_dict{}", self.thawed())
+    }
 
-                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
-                    let addr = resolve_ipv4_addr(Some(host), port as u16)
-                        .map_err(|e| format!("socket_connect() {}", e))?;
-                    let rc = unsafe {
-                        libc::connect(
-                            entry.fd,
-                            &addr as *const _ as *const libc::sockaddr,
-                            std::mem::size_of::<libc::sockaddr_in>() as libc::socklen_t,
-                        )
-                    };
-                    if rc != 0 {
-                        let err = std::io::Error::last_os_error();
-                        let code = err.raw_os_error().unwrap_or(-1) as i64;
-                        return Ok(result_err(err.to_string(), code));
-                    }
-                    Ok(result_ok(Value::Nil))
-                }))),
-            );
+    fn length(&self) -> Option<usize> {
+        Some(self.len)
+    }
 
-            // socket_listen(sock, backlog)
-            globals.borrow_mut().define(
-                "socket_listen".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("socket_listen", 2, |args| {
-                    let sock_id = args[0]
-                        .as_integer()
-                        .ok_or("socket_listen() expects socket id")?;
-                    let backlog = args[1]
-                        .as_integer()
-                        .ok_or("socket_listen() expects backlog integer")?;
-                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
-                    let rc = unsafe { libc::listen(entry.fd, backlog as i32) };
-                    if rc != 0 {
-                        let err = std::io::Error::last_os_error();
-                        let code = err.raw_os_error().unwrap_or(-1) as i64;
-                        return Ok(result_err(err.to_string(), code));
-                    }
-                    let _ = update_socket_kind(sock_id, SocketKind::Tcp);
-                    Ok(result_ok(Value::Nil))
-                }))),
-            );
+    fn items(&self) -> Option<Vec<Value>> {
+        Some(self.entries().into_iter().map(|(key, _)| key).collect())
+    }
+}
 
-            // socket_accept(sock)
-            globals.borrow_mut().define(
-                "socket_accept".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("socket_accept", 1, |args| {
-                    let sock_id = args[0]
-                        .as_integer()
-                        .ok_or("socket_accept() expects socket id")?;
-                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
-                    let mut addr: libc::sockaddr_in = unsafe { std::mem::zeroed() };
-                    let mut addr_len = std::mem::size_of::<libc::sockaddr_in>() as libc::socklen_t;
-                    let new_fd = unsafe {
-                        libc::accept(
-                            entry.fd,
-                            &mut addr as *mut _ as *mut libc::sockaddr,
-                            &mut addr_len,
-                        )
-                    };
-                    if new_fd < 0 {
-                        let err = std::io::Error::last_os_error();
-                        let code = err.raw_os_error().unwrap_or(-1) as i64;
-                        return Ok(result_err(err.to_string(), code));
-                    }
-                    let new_id = register_socket(new_fd, SocketKind::Tcp);
-                    let (host, port) = sockaddr_to_host_port(&addr);
-                    let mut info = DictValue::new();
-                    info.set(Value::String("sock".to_string()), Value::Integer(new_id));
-                    info.set(Value::String("addr".to_string()), addr_dict(host, port));
-                    Ok(result_ok(Value::Dict(Rc::new(RefCell::new(info)))))
-                }))),
-            );
+impl NativeObject for FrozenList {
+    fn type_name(&self) -> &str {
+        "frozen_list"
+    }
 
-            // socket_set_nonblocking(sock, on)
-            globals.borrow_mut().define(
-                "socket_set_nonblocking".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new(
-                    "socket_set_nonblocking",
-                    2,
-                    |args| {
-                        let sock_id = args[0]
-                            .as_integer()
-                            .ok_or("socket_set_nonblocking() expects socket id")?;
-                        let enable = args[1].is_truthy();
-                        let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
-                        let flags = unsafe { libc::fcntl(entry.fd, libc::F_GETFL) };
-                        if flags < 0 {
-                            let err = std::io::Error::last_os_error();
-                            let code = err.raw_os_error().unwrap_or(-1) as i64;
-                            return Ok(result_err(err.to_string(), code));
-                        }
-                        let new_flags = if enable {
-                            flags | libc::O_NONBLOCK
-                        } else {
-                            flags & !libc::O_NONBLOCK
-                        };
+    fn get(&self, prop: &str) -> HaversResult<Value> {
+        Err(HaversError::UndefinedVariable {
+            name: prop.to_string(),
+            line: 0,
+        })
+    }
 
-                        let rc = {
-                            #[cfg(coverage)]
-                            {
-                                if std::env::var_os("MDH_COVERAGE_FORCE_FCNTL_SETFL_FAIL").is_some()
-                                {
-                                    #[cfg(target_os = "linux")]
-                                    unsafe {
-                                        *libc::__errno_location() = libc::EBADF;
-                                    }
-                                    -1
-                                } else {
-                                    unsafe { libc::fcntl(entry.fd, libc::F_SETFL, new_flags) }
-                                }
-                            }
-                            #[cfg(not(coverage))]
-                            {
-                                unsafe { libc::fcntl(entry.fd, libc::F_SETFL, new_flags) }
-                            }
-                        };
+    fn set(&self, prop: &str, _value: Value) -> HaversResult<Value> {
+        Err(HaversError::TypeError {
+            message: format!("Cannae set '{}' on a frozen_list - use frozen_set()", prop),
+            line: 0,
+        })
+    }
 
-                        if rc != 0 {
-                            let err = std::io::Error::last_os_error();
-                            let code = err.raw_os_error().unwrap_or(-1) as i64;
-                            return Ok(result_err(err.to_string(), code));
-                        }
-                        Ok(result_ok(Value::Nil))
-                    },
-                ))),
-            );
+    fn call(&self, _method: &str, _args: Vec<Value>) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
 
-            // socket_set_reuseaddr(sock, on)
-            globals.borrow_mut().define(
-                "socket_set_reuseaddr".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new(
-                    "socket_set_reuseaddr",
-                    2,
-                    |args| {
-                        let sock_id = args[0]
-                            .as_integer()
-                            .ok_or("socket_set_reuseaddr() expects socket id")?;
-                        let enable = args[1].is_truthy();
-                        let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
-                        let optval: libc::c_int = if enable { 1 } else { 0 };
-                        let rc = unsafe {
-                            libc::setsockopt(
-                                entry.fd,
-                                libc::SOL_SOCKET,
-                                libc::SO_REUSEADDR,
-                                &optval as *const _ as *const libc::c_void,
-                                std::mem::size_of_val(&optval) as libc::socklen_t,
-                            )
-                        };
-                        if rc != 0 {
-                            let err = std::io::Error::last_os_error();
-                            let code = err.raw_os_error().unwrap_or(-1) as i64;
-                            return Ok(result_err(err.to_string(), code));
-                        }
-                        Ok(result_ok(Value::Nil))
-                    },
-                ))),
-            );
+    fn as_any(&self) -> &dyn std::any::Any {
+        self
+    }
 
-            // socket_set_reuseport(sock, on)
-            globals.borrow_mut().define(
-                "socket_set_reuseport".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new(
-                    "socket_set_reuseport",
-                    2,
-                    |args| {
-                        let sock_id = args[0]
-                            .as_integer()
-                            .ok_or("socket_set_reuseport() expects socket id")?;
-                        let enable = args[1].is_truthy();
-                        let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
-                        let optval: libc::c_int = if enable { 1 } else { 0 };
-                        let rc = unsafe {
-                            libc::setsockopt(
-                                entry.fd,
-                                libc::SOL_SOCKET,
-                                libc::SO_REUSEPORT,
-                                &optval as *const _ as *const libc::c_void,
-                                std::mem::size_of_val(&optval) as libc::socklen_t,
-                            )
-                        };
-                        if rc != 0 {
-                            let err = std::io::Error::last_os_error();
-                            let code = err.raw_os_error().unwrap_or(-1) as i64;
-                            return Ok(result_err(err.to_string(), code));
-                        }
-                        Ok(result_ok(Value::Nil))
-                    },
-                ))),
-            );
+    fn to_string(&self) -> String {
+        let items: Vec<String> = self.items().iter().map(|v| v.to_string()).collect();
+        format!("frozen_list[{}]", items.join(", "))
+    }
 
-            // socket_set_ttl(sock, ttl)
-            globals.borrow_mut().define(
-                "socket_set_ttl".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("socket_set_ttl", 2, |args| {
-                    let sock_id = args[0]
-                        .as_integer()
-                        .ok_or("socket_set_ttl() expects socket id")?;
-                    let ttl = args[1]
-                        .as_integer()
-                        .ok_or("socket_set_ttl() expects ttl integer")?;
-                    if ttl < 0 || ttl > 255 {
-                        return Err("socket_set_ttl() ttl must be 0..255".to_string());
-                    }
-                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
-                    let optval: libc::c_int = ttl as libc::c_int;
-                    let rc = unsafe {
-                        libc::setsockopt(
-                            entry.fd,
-                            libc::IPPROTO_IP,
-                            libc::IP_TTL,
-                            &optval as *const _ as *const libc::c_void,
-                            std::mem::size_of_val(&optval) as libc::socklen_t,
-                        )
-                    };
-                    if rc != 0 {
-                        let err = std::io::Error::last_os_error();
-                        let code = err.raw_os_error().unwrap_or(-1) as i64;
-                        return Ok(result_err(err.to_string(), code));
-                    }
-                    Ok(result_ok(Value::Nil))
-                }))),
-            );
+    fn length(&self) -> Option<usize> {
+        Some(self.len)
+    }
 
-            // socket_set_nodelay(sock, on)
-            globals.borrow_mut().define(
-                "socket_set_nodelay".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new(
-                    "socket_set_nodelay",
-                    2,
-                    |args| {
-                        let sock_id = args[0]
-                            .as_integer()
-                            .ok_or("socket_set_nodelay() expects socket id")?;
-                        let enable = args[1].is_truthy();
-                        let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
-                        let optval: libc::c_int = if enable { 1 } else { 0 };
-                        let rc = unsafe {
-                            libc::setsockopt(
-                                entry.fd,
-                                libc::IPPROTO_TCP,
-                                libc::TCP_NODELAY,
-                                &optval as *const _ as *const libc::c_void,
-                                std::mem::size_of_val(&optval) as libc::socklen_t,
-                            )
-                        };
-                        if rc != 0 {
-                            let err = std::io::Error::last_os_error();
-                            let code = err.raw_os_error().unwrap_or(-1) as i64;
-                            return Ok(result_err(err.to_string(), code));
-                        }
-                        Ok(result_ok(Value::Nil))
-                    },
-                ))),
-            );
+    fn items(&self) -> Option<Vec<Value>> {
+        Some(FrozenList::items(self))
+    }
+}
 
-            // socket_set_rcvbuf(sock, bytes)
-            globals.borrow_mut().define(
-                "socket_set_rcvbuf".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new(
-                    "socket_set_rcvbuf",
-                    2,
-                    |args| {
-                        let sock_id = args[0]
-                            .as_integer()
-                            .ok_or("socket_set_rcvbuf() expects socket id")?;
-                        let size = args[1]
-                            .as_integer()
-                            .ok_or("socket_set_rcvbuf() expects size integer")?;
-                        if size < 0 || size > i32::MAX as i64 {
-                            return Err("socket_set_rcvbuf() size must be >= 0".to_string());
-                        }
-                        let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
-                        let optval: libc::c_int = size as libc::c_int;
-                        let rc = unsafe {
-                            libc::setsockopt(
-                                entry.fd,
-                                libc::SOL_SOCKET,
-                                libc::SO_RCVBUF,
-                                &optval as *const _ as *const libc::c_void,
-                                std::mem::size_of_val(&optval) as libc::socklen_t,
-                            )
-                        };
-                        if rc != 0 {
-                            let err = std::io::Error::last_os_error();
-                            let code = err.raw_os_error().unwrap_or(-1) as i64;
-                            return Ok(result_err(err.to_string(), code));
-                        }
-                        Ok(result_ok(Value::Nil))
-                    },
-                ))),
-            );
+/// The frozen dict behind value, if it is one.
+fn frozen_dict_ref(value: &Value) -> Option<&FrozenDict> {
+    match value {
+        Value::NativeObject(obj) => obj.as_any().downcast_ref::<FrozenDict>(),
+        _ => None,
+    }
+}
 
-            // socket_set_sndbuf(sock, bytes)
-            globals.borrow_mut().define(
-                "socket_set_sndbuf".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new(
-                    "socket_set_sndbuf",
-                    2,
-                    |args| {
-                        let sock_id = args[0]
-                            .as_integer()
-                            .ok_or("socket_set_sndbuf() expects socket id")?;
-                        let size = args[1]
-                            .as_integer()
-                            .ok_or("socket_set_sndbuf() expects size integer")?;
-                        if size < 0 || size > i32::MAX as i64 {
-                            return Err("socket_set_sndbuf() size must be >= 0".to_string());
-                        }
-                        let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
-                        let optval: libc::c_int = size as libc::c_int;
-                        let rc = unsafe {
-                            libc::setsockopt(
-                                entry.fd,
-                                libc::SOL_SOCKET,
-                                libc::SO_SNDBUF,
-                                &optval as *const _ as *const libc::c_void,
-                                std::mem::size_of_val(&optval) as libc::socklen_t,
-                            )
-                        };
-                        if rc != 0 {
-                            let err = std::io::Error::last_os_error();
-                            let code = err.raw_os_error().unwrap_or(-1) as i64;
-                            return Ok(result_err(err.to_string(), code));
-                        }
-                        Ok(result_ok(Value::Nil))
-                    },
-                ))),
-            );
+fn with_frozen_list<T, F>(name: &str, value: &Value, f: F) -> Result<T, String>
+where
+    F: FnOnce(&FrozenList) -> Result<T, String>,
+{
+    match value {
+        Value::NativeObject(obj) => match obj.as_any().downcast_ref::<FrozenList>() {
+            Some(list) => f(list),
+            None => Err(format!("{}() needs a frozen_list", name)),
+        },
+        _ => Err(format!("{}() needs a frozen_list", name)),
+    }
+}
 
-            // socket_close(sock)
-            globals.borrow_mut().define(
-                "socket_close".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("socket_close", 1, |args| {
-                    let sock_id = args[0]
-                        .as_integer()
-                        .ok_or("socket_close() expects socket id")?;
-                    let entry = remove_socket(sock_id).ok_or("Unknown socket handle")?;
-                    let rc = unsafe { libc::close(entry.fd) };
-                    if rc != 0 {
-                        let err = std::io::Error::last_os_error();
-                        let code = err.raw_os_error().unwrap_or(-1) as i64;
-                        return Ok(result_err(err.to_string(), code));
-                    }
-                    Ok(result_ok(Value::Nil))
-                }))),
-            );
+/// A date from date_fields(ts): local time, broken down once, read as d["year"] and so on.
+#[derive(Debug)]
+struct DateFields {
+    ts: i64,
+    year: i64,
+    month: i64,
+    day: i64,
+    hour: i64,
+    minute: i64,
+    second: i64,
+    weekday: i64,
+    yearday: i64,
+    utc_offset: i64,
+}
 
-            // udp_send_to(sock, bytes, host, port)
-            globals.borrow_mut().define(
-                "udp_send_to".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("udp_send_to", 4, |args| {
-                    let sock_id = args[0]
-                        .as_integer()
-                        .ok_or("udp_send_to() expects socket id")?;
-                    let bytes = match &args[1] {
-                        Value::Bytes(b) => b.borrow(),
-                        _ => return Err("udp_send_to() expects bytes".to_string()),
-                    };
-                    let host = match &args[2] {
-                        Value::String(s) => s.as_str(),
-                        _ => return Err("udp_send_to() expects host string".to_string()),
-                    };
-                    let port = args[3]
-                        .as_integer()
-                        .ok_or("udp_send_to() expects port integer")?;
-                    if port < 0 || port > 65535 {
-                        return Err("udp_send_to() port must be 0..65535".to_string());
-                    }
+impl DateFields {
+    fn local(ts: i64) -> Result<DateFields, String> {
+        use chrono::{Datelike, Local, TimeZone, Timelike};
+        let dt = Local
+            .timestamp_opt(ts, 0)
+            .single()
+            .ok_or("Invalid timestamp")?;
+        Ok(DateFields {
+            ts,
+            year: dt.year() as i64,
+            month: dt.month() as i64,
+            day: dt.day() as i64,
+            hour: dt.hour() as i64,
+            minute: dt.minute() as i64,
+            second: dt.second() as i64,
+            weekday: dt.weekday().num_days_from_monday() as i64,
+            yearday: dt.ordinal() as i64,
+            utc_offset: dt.offset().local_minus_utc() as i64,
+        })
+    }
+}
 
-                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
-                    let addr = resolve_ipv4_addr(Some(host), port as u16)
-                        .map_err(|e| format!("udp_send_to() {}", e))?;
-                    let sent = unsafe {
-                        libc::sendto(
-                            entry.fd,
-                            bytes.as_ptr() as *const libc::c_void,
-                            bytes.len(),
-                            0,
-                            &addr as *const _ as *const libc::sockaddr,
-                            std::mem::size_of::<libc::sockaddr_in>() as libc::socklen_t,
-                        )
-                    };
-                    if sent < 0 {
-                        let err = std::io::Error::last_os_error();
-                        let code = err.raw_os_error().unwrap_or(-1) as i64;
-                        return Ok(result_err(err.to_string(), code));
-                    }
-                    Ok(result_ok(Value::Integer(sent as i64)))
-                }))),
-            );
+impl NativeObject for DateFields {
+    fn type_name(&self) -> &str {
+        "date"
+    }
+
+    fn get(&self, prop: &str) -> HaversResult<Value> {
+        let n = match prop {
+            "year" => self.year,
+            "month" => self.month,
+            "day" => self.day,
+            "hour" => self.hour,
+            "minute" => self.minute,
+            "second" => self.second,
+            "weekday" => self.weekday,
+            "yearday" => self.yearday,
+            "utc_offset" => self.utc_offset,
+            "timestamp" => self.ts,
+            _ => {
+                return Err(HaversError::UndefinedVariable {
+                    name: prop.to_string(),
+                    line: 0,
+                })
+            }
+        };
+        Ok(Value::Integer(n))
+    }
 
-            // udp_recv_from(sock, max_len)
-            globals.borrow_mut().define(
-                "udp_recv_from".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("udp_recv_from", 2, |args| {
-                    let sock_id = args[0]
-                        .as_integer()
-                        .ok_or("udp_recv_from() expects socket id")?;
-                    let max_len = args[1]
-                        .as_integer()
-                        .ok_or("udp_recv_from() expects max_len integer")?;
-                    let max_len = if max_len < 0 { 0 } else { max_len } as usize;
-                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+    fn set(&self, prop: &str, _value: Value) -> HaversResult<Value> {
+        Err(HaversError::TypeError {
+            message: format!("Cannae set '{}' on a date", prop),
+            line: 0,
+        })
+    }
 
-                    let mut buf = vec![0u8; max_len];
-                    let mut addr: libc::sockaddr_in = unsafe { std::mem::zeroed() };
-                    let mut addr_len = std::mem::size_of::<libc::sockaddr_in>() as libc::socklen_t;
-                    let n = unsafe {
-                        libc::recvfrom(
-                            entry.fd,
-                            buf.as_mut_ptr() as *mut libc::c_void,
-                            buf.len(),
-                            0,
-                            &mut addr as *mut _ as *mut libc::sockaddr,
-                            &mut addr_len,
-                        )
-                    };
-                    if n < 0 {
-                        let err = std::io::Error::last_os_error();
-                        let code = err.raw_os_error().unwrap_or(-1) as i64;
-                        return Ok(result_err(err.to_string(), code));
-                    }
-                    buf.truncate(n as usize);
-                    let (host, port) = sockaddr_to_host_port(&addr);
-                    let mut info = DictValue::new();
-                    info.set(
-                        Value::String("buf".to_string()),
-                        Value::Bytes(Rc::new(RefCell::new(buf))),
-                    );
-                    info.set(Value::String("addr".to_string()), addr_dict(host, port));
-                    Ok(result_ok(Value::Dict(Rc::new(RefCell::new(info)))))
-                }))),
-            );
+    fn call(&self, _method: &str, _args: Vec<Value>) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
 
-            // tcp_send(sock, bytes)
-            globals.borrow_mut().define(
-                "tcp_send".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("tcp_send", 2, |args| {
-                    let sock_id = args[0].as_integer().ok_or("tcp_send() expects socket id")?;
-                    let bytes = match &args[1] {
-                        Value::Bytes(b) => b.borrow(),
-                        _ => return Err("tcp_send() expects bytes".to_string()),
-                    };
-                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
-                    let sent = unsafe {
-                        libc::send(
-                            entry.fd,
-                            bytes.as_ptr() as *const libc::c_void,
-                            bytes.len(),
-                            0,
-                        )
-                    };
-                    if sent < 0 {
-                        let err = std::io::Error::last_os_error();
-                        let code = err.raw_os_error().unwrap_or(-1) as i64;
-                        return Ok(result_err(err.to_string(), code));
-                    }
-                    Ok(result_ok(Value::Integer(sent as i64)))
-                }))),
-            );
+    fn as_any(&self) -> &dyn std::any::Any {
+        self
+    }
 
-            // tcp_recv(sock, max_len)
-            globals.borrow_mut().define(
-                "tcp_recv".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("tcp_recv", 2, |args| {
-                    let sock_id = args[0].as_integer().ok_or("tcp_recv() expects socket id")?;
-                    let max_len = args[1]
-                        .as_integer()
-                        .ok_or("tcp_recv() expects max_len integer")?;
-                    let max_len = if max_len < 0 { 0 } else { max_len } as usize;
-                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
-                    let mut buf = vec![0u8; max_len];
-                    let n = unsafe {
-                        libc::recv(
-                            entry.fd,
-                            buf.as_mut_ptr() as *mut libc::c_void,
-                            buf.len(),
-                            0,
-                        )
-                    };
-                    if n < 0 {
-                        let err = std::io::Error::last_os_error();
-                        let code = err.raw_os_error().unwrap_or(-1) as i64;
-                        return Ok(result_err(err.to_string(), code));
-                    }
-                    buf.truncate(n as usize);
-                    Ok(result_ok(Value::Bytes(Rc::new(RefCell::new(buf)))))
-                }))),
-            );
-        }
+    fn to_string(&self) -> String {
+        let off = self.utc_offset.abs();
+        format!(
+            "date({:04}-{:02}-{:02}T{:02}:{:02}:{:02}{}{:02}:{:02})",
+            self.year,
+            self.month,
+            self.day,
+            self.hour,
+            self.minute,
+            self.second,
+            if self.utc_offset < 0 { '-' } else { '+' },
+            off / 3600,
+            off / 60 % 60
+        )
+    }
+}
 
-        #[cfg(feature = "native")]
-        {
-            // dns_lookup(host) -> result {ok,value:[ips]}
-            globals.borrow_mut().define(
-                "dns_lookup".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("dns_lookup", 1, |args| {
-                    let host = match &args[0] {
-                        Value::String(s) => s.clone(),
-                        _ => return Err("dns_lookup() expects host string".to_string()),
-                    };
-                    let mut out = Vec::new();
-                    let iter = match (host.as_str(), 0).to_socket_addrs() {
-                        Ok(iter) => iter,
-                        Err(e) => return Ok(result_err(format!("dns_lookup() {}", e), -1)),
-                    };
-                    for addr in iter {
-                        out.push(Value::String(addr.ip().to_string()));
-                    }
-                    Ok(result_ok(Value::List(Rc::new(RefCell::new(out)))))
-                }))),
-            );
+/// A string builder from strbuf(): appends go straight onto one growing string.
+#[derive(Debug, Default)]
+struct StrBuilder {
+    text: RefCell<String>,
+}
 
-            // dns_srv(service, domain) -> result {ok,value:[{priority,weight,port,target}]}
-            globals.borrow_mut().define(
-                "dns_srv".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("dns_srv", 2, |args| {
-                    let service = match &args[0] {
-                        Value::String(s) => s.clone(),
-                        _ => return Err("dns_srv() expects service string".to_string()),
-                    };
-                    let domain = match &args[1] {
-                        Value::String(s) => s.clone(),
-                        _ => return Err("dns_srv() expects domain string".to_string()),
-                    };
-                    let name = if service.is_empty() {
-                        domain.clone()
-                    } else {
-                        let s = service.trim_end_matches('.');
-                        let d = domain.trim_start_matches('.');
-                        format!("{}.{}", s, d)
-                    };
-                    let resolver = match make_resolver() {
-                        Ok(resolver) => resolver,
-                        Err(e) => return Ok(result_err(format!("dns_srv() {}", e), -1)),
-                    };
-	                    let lookup = match resolver_lookup(&resolver, name.as_str(), RecordType::SRV) {
-	                        Ok(lookup) => lookup,
-	                        Err(e) => {
-	                            return Ok(result_err(
-	                                format!("dns_srv() DNS SRV lookup failed: {}", e),
-	                                -1,
-	                            ))
-	                        }
-	                    };
-	                    let out: Vec<Value> = lookup.iter().filter_map(|rdata| match rdata { RData::SRV(srv) => Some(dns_srv_to_value(srv)), _ => None }).collect();
-	                    Ok(result_ok(Value::List(Rc::new(RefCell::new(out)))))
-	                }))),
-	            );
+impl NativeObject for StrBuilder {
+    fn type_name(&self) -> &str {
+        "strbuf"
+    }
 
-            // dns_naptr(domain) -> result {ok,value:[{order,preference,flags,service,regexp,replacement}]}
-            globals.borrow_mut().define(
-                "dns_naptr".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("dns_naptr", 1, |args| {
-                    let domain = match &args[0] {
-                        Value::String(s) => s.clone(),
-                        _ => return Err("dns_naptr() expects domain string".to_string()),
-                    };
-                    let resolver = match make_resolver() {
-                        Ok(resolver) => resolver,
-                        Err(e) => return Ok(result_err(format!("dns_naptr() {}", e), -1)),
-                    };
-	                    let lookup = match resolver_lookup(&resolver, domain.as_str(), RecordType::NAPTR) {
-	                        Ok(lookup) => lookup,
-	                        Err(e) => {
-	                            return Ok(result_err(
-	                                format!("dns_naptr() DNS NAPTR lookup failed: {}", e),
-	                                -1,
-	                            ))
-	                        }
-	                    };
-	                    let out: Vec<Value> = lookup.iter().filter_map(|rdata| match rdata { RData::NAPTR(naptr) => Some(dns_naptr_to_value(naptr)), _ => None }).collect();
-	                    Ok(result_ok(Value::List(Rc::new(RefCell::new(out)))))
-	                }))),
-	            );
-        }
+    fn get(&self, prop: &str) -> HaversResult<Value> {
+        Err(HaversError::UndefinedVariable {
+            name: prop.to_string(),
+            line: 0,
+        })
+    }
 
-        #[cfg(all(feature = "native", unix))]
-        {
-            // tls_client_new(config) -> result {ok,value:tls_handle}
-            globals.borrow_mut().define(
-                "tls_client_new".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("tls_client_new", 1, |args| {
-                    let cfg = tls_config_from_value(&args[0])?;
-                    let session = if cfg.mode == TlsMode::Client {
-                        let client_config = build_client_config(&cfg)?;
-                        TlsSession {
-                            mode: TlsMode::Client,
-                            server_name: cfg.server_name,
-                            client_config: Some(client_config),
-                            server_config: None,
-                            stream: None,
-                        }
-                    } else {
-                        let server_config = build_server_config(&cfg)?;
-                        TlsSession {
-                            mode: TlsMode::Server,
-                            server_name: cfg.server_name,
-                            client_config: None,
-                            server_config: Some(server_config),
-                            stream: None,
-                        }
-                    };
-                    let id = register_tls(session);
-                    Ok(result_ok(Value::Integer(id)))
-                }))),
-            );
+    fn set(&self, prop: &str, _value: Value) -> HaversResult<Value> {
+        Err(HaversError::TypeError {
+            message: format!("Cannae set '{}' on a strbuf", prop),
+            line: 0,
+        })
+    }
 
-	            // tls_connect(tls, sock)
-	            globals.borrow_mut().define(
-	                "tls_connect".to_string(),
-	                Value::NativeFunction(Rc::new(NativeFunction::new("tls_connect", 2, |args| {
-	                    let tls_id = args[0]
-	                        .as_integer()
-	                        .ok_or("tls_connect() expects TLS handle")?;
-	                    let sock_id = args[1]
+    fn call(&self, _method: &str, _args: Vec<Value>) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
+
+    fn as_any(&self) -> &dyn std::any::Any {
+        self
+    }
+
+    fn to_string(&self) -> String {
+        self.text.borrow().clone()
+    }
+
+    fn length(&self) -> Option<usize> {
+        Some(self.text.borrow().len())
+    }
+}
+
+fn with_unpack_stream<T, F>(name: &str, value: &Value, f: F) -> Result<T, String>
+where
+    F: FnOnce(&mut UnpackStream) -> Result<T, String>,
+{
+    match value {
+        Value::NativeObject(obj) => match obj.as_any().downcast_ref::<UnpackStreamHandle>() {
+            Some(handle) => f(&mut handle.stream.borrow_mut()),
+            None => Err(format!("{}() needs an unpack stream", name)),
+        },
+        _ => Err(format!("{}() needs an unpack stream", name)),
+    }
+}
+
+fn with_strbuf<T, F>(name: &str, value: &Value, f: F) -> Result<T, String>
+where
+    F: FnOnce(&StrBuilder) -> Result<T, String>,
+{
+    match value {
+        Value::NativeObject(obj) => match obj.as_any().downcast_ref::<StrBuilder>() {
+            Some(builder) => f(builder),
+            None => Err(format!("{}() needs a strbuf", name)),
+        },
+        _ => Err(format!("{}() needs a strbuf", name)),
+    }
+}
+
+/// A dense matrix from the mat_* builtins: rows x cols floats, row-major. ints stays set
+/// while every entry is a whole number that came from an integer, so `mat_tae_rows` can
+/// hand back integers.
+#[derive(Debug)]
+struct Matrix {
+    rows: usize,
+    cols: usize,
+    ints: std::cell::Cell<bool>,
+    data: RefCell<Vec<f64>>,
+}
+
+impl Matrix {
+    fn new(rows: usize, cols: usize, ints: bool, data: Vec<f64>) -> Self {
+        Matrix {
+            rows,
+            cols,
+            ints: std::cell::Cell::new(ints),
+            data: RefCell::new(data),
+        }
+    }
+
+    fn entry(&self, x: f64) -> Value {
+        if self.ints.get() {
+            Value::Integer(x as i64)
+        } else {
+            Value::Float(x)
+        }
+    }
+
+    fn value(self) -> Value {
+        Value::NativeObject(Rc::new(self))
+    }
+}
+
+impl NativeObject for Matrix {
+    fn type_name(&self) -> &str {
+        "matrix"
+    }
+
+    fn get(&self, prop: &str) -> HaversResult<Value> {
+        Err(HaversError::UndefinedVariable {
+            name: prop.to_string(),
+            line: 0,
+        })
+    }
+
+    fn set(&self, prop: &str, _value: Value) -> HaversResult<Value> {
+        Err(HaversError::TypeError {
+            message: format!("Cannae set '{}' on a matrix", prop),
+            line: 0,
+        })
+    }
+
+    fn call(&self, _method: &str, _args: Vec<Value>) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
+
+    fn as_any(&self) -> &dyn std::any::Any {
+        self
+    }
+
+    fn to_string(&self) -> String {
+        let data = self.data.borrow();
+        let rows: Vec<String> = (0..self.rows)
+            .map(|i| {
+                let row: Vec<String> = data[i * self.cols..(i + 1) * self.cols]
+                    .iter()
+                    .map(|&x| self.entry(x).to_string())
+                    .collect();
+                format!("[{}]", row.join(", "))
+            })
+            .collect();
+        format!("matrix[{}]", rows.join(", "))
+    }
+}
+
+fn matrix_number(name: &str, value: &Value) -> Result<f64, String> {
+    match value {
+        Value::Integer(n) => Ok(*n as f64),
+        Value::Float(f) => Ok(*f),
+        other => Err(format!(
+            "{}() needs numbers, no' a {}",
+            name,
+            other.type_name()
+        )),
+    }
+}
+
+/// A matrix argument: a matrix as it is, or a list of equal-length lists of numbers
+/// copied into a new one.
+fn with_matrix<T, F>(name: &str, value: &Value, f: F) -> Result<T, String>
+where
+    F: FnOnce(&Matrix) -> Result<T, String>,
+{
+    match value {
+        Value::NativeObject(obj) => match obj.as_any().downcast_ref::<Matrix>() {
+            Some(matrix) => f(matrix),
+            None => Err(format!("{}() needs a matrix", name)),
+        },
+        Value::List(rows) => {
+            let rows = rows.borrow();
+            let mut cols = None;
+            let mut ints = true;
+            let mut data = Vec::new();
+            for row in rows.iter() {
+                let row = match row {
+                    Value::List(row) => row.borrow(),
+                    other => {
+                        return Err(format!(
+                            "{}() needs a list o' rows, no' a {}",
+                            name,
+                            other.type_name()
+                        ))
+                    }
+                };
+                if *cols.get_or_insert(row.len()) != row.len() {
+                    return Err(format!(
+                        "{}() needs every row tae hae the same number o' columns",
+                        name
+                    ));
+                }
+                for x in row.iter() {
+                    ints &= matches!(x, Value::Integer(_));
+                    data.push(matrix_number(name, x)?);
+                }
+            }
+            f(&Matrix::new(rows.len(), cols.unwrap_or(0), ints, data))
+        }
+        _ => Err(format!("{}() needs a matrix", name)),
+    }
+}
+
+/// LU factorisation with partial pivoting, in place over the n x n lu; perm gets the row
+/// each pivot came from. Returns the sign of the row swaps, or 0 for a singular matrix: a
+/// pivot no bigger than rounding noise against the largest entry.
+fn matrix_lu(lu: &mut [f64], n: usize, perm: &mut Vec<usize>) -> f64 {
+    let largest = lu.iter().fold(0.0f64, |m, x| m.max(x.abs()));
+    let tiny = largest * n as f64 * f64::EPSILON;
+    let mut sign = 1.0;
+    *perm = (0..n).collect();
+    for col in 0..n {
+        let mut pivot = col;
+        for r in col + 1..n {
+            if lu[r * n + col].abs() > lu[pivot * n + col].abs() {
+                pivot = r;
+            }
+        }
+        if lu[pivot * n + col].abs() <= tiny {
+            return 0.0;
+        }
+        if pivot != col {
+            for j in 0..n {
+                lu.swap(col * n + j, pivot * n + j);
+            }
+            perm.swap(col, pivot);
+            sign = -sign;
+        }
+        let p = lu[col * n + col];
+        for r in col + 1..n {
+            let f = lu[r * n + col] / p;
+            lu[r * n + col] = f;
+            for j in col + 1..n {
+                lu[r * n + j] -= f * lu[col * n + j];
+            }
+        }
+    }
+    sign
+}
+
+/// Split CSV text into rows of fields for table_parse_csv. Fields are trimmed and blank
+/// lines skipped, as table_from_csv always did; a field in double quotes may also hold
+/// commas, newlines and `""` for a quote, so to_csv's output reads back.
+fn csv_fields(text: &str) -> Vec<Vec<String>> {
+    let bytes = text.as_bytes();
+    let trim = |s: &str| {
+        s.trim_matches(|c| c == ' ' || c == '\t' || c == '\r')
+            .to_string()
+    };
+    let mut rows = Vec::new();
+    let mut row: Vec<String> = Vec::new();
+    let mut quoted = false;
+    let mut pos = 0;
+    loop {
+        while pos < bytes.len() && matches!(bytes[pos], b' ' | b'\t' | b'\r') {
+            pos += 1;
+        }
+        let mut field = String::new();
+        if bytes.get(pos) == Some(&b'"') {
+            quoted = true;
+            pos += 1;
+            loop {
+                let Some(q) = bytes[pos..].iter().position(|&b| b == b'"') else {
+                    field.push_str(&text[pos..]);
+                    pos = bytes.len();
+                    break;
+                };
+                field.push_str(&text[pos..pos + q]);
+                pos += q + 1;
+                if bytes.get(pos) != Some(&b'"') {
+                    break;
+                }
+                field.push('"');
+                pos += 1;
+            }
+        }
+        let end = bytes[pos..]
+            .iter()
+            .position(|&b| b == b',' || b == b'\n')
+            .map_or(bytes.len(), |i| pos + i);
+        field.push_str(&trim(&text[pos..end]));
+        row.push(field);
+        pos = end;
+        if bytes.get(pos) == Some(&b',') {
+            pos += 1;
+            continue;
+        }
+        if quoted || row.len() > 1 || !row[0].is_empty() {
+            rows.push(std::mem::take(&mut row));
+        }
+        row.clear();
+        quoted = false;
+        if pos >= bytes.len() {
+            return rows;
+        }
+        pos += 1;
+    }
+}
+
+/// A list argument to the table_* builtins
+fn table_list(name: &str, value: &Value) -> Result<Rc<RefCell<Vec<Value>>>, String> {
+    value
+        .as_list()
+        .cloned()
+        .ok_or_else(|| format!("{}() needs a list, no' a {}", name, value.type_name()))
+}
+
+/// row[col] when the row is a dict that has it
+fn table_cell(row: &Value, col: &Value) -> Option<Value> {
+    row.as_dict().and_then(|d| d.borrow().get(col).cloned())
+}
+
+/// A cell's width in the table display: the length of its tae_string
+fn table_cell_width(value: &Value) -> i64 {
+    match value {
+        Value::String(s) => s.len() as i64,
+        other => format!("{}", other).len() as i64,
+    }
+}
+
+/// An RTP header from rtp_parse_native, read as h["seq"], h["payload"] and so on.
+#[derive(Debug)]
+struct RtpHeader {
+    version: u8,
+    padding: bool,
+    extension: bool,
+    marker: bool,
+    payload_type: u8,
+    seq: u16,
+    timestamp: u32,
+    ssrc: u32,
+    csrcs: Vec<u32>,
+    payload: Rc<RefCell<Vec<u8>>>,
+}
+
+const RTP_HEADER_MIN: usize = 12;
+
+fn rtp_u32(b: &[u8], at: usize) -> u32 {
+    u32::from_be_bytes([b[at], b[at + 1], b[at + 2], b[at + 3]])
+}
+
+fn rtp_error(message: &str, len: usize) -> Value {
+    let mut dict = DictValue::new();
+    dict.set(Value::String("ok".into()), Value::Bool(false));
+    dict.set(Value::String("error".into()), Value::String(message.into()));
+    dict.set(Value::String("len".into()), Value::Integer(len as i64));
+    Value::Dict(Rc::new(RefCell::new(dict)))
+}
+
+/// rtp_parse_native: the header of `b`, or the {"ok": nae, ...} dict for a short packet.
+fn rtp_parse(b: &[u8]) -> Value {
+    if b.len() < RTP_HEADER_MIN {
+        return rtp_error("rtp packet too short", b.len());
+    }
+    let cc = (b[0] & 0x0F) as usize;
+    let header_len = RTP_HEADER_MIN + cc * 4;
+    if b.len() < header_len {
+        return rtp_error("rtp header too short", b.len());
+    }
+    Value::NativeObject(Rc::new(RtpHeader {
+        version: b[0] >> 6,
+        padding: b[0] & 0x20 != 0,
+        extension: b[0] & 0x10 != 0,
+        marker: b[1] & 0x80 != 0,
+        payload_type: b[1] & 0x7F,
+        seq: u16::from_be_bytes([b[2], b[3]]),
+        timestamp: rtp_u32(b, 4),
+        ssrc: rtp_u32(b, 8),
+        csrcs: (0..cc)
+            .map(|i| rtp_u32(b, RTP_HEADER_MIN + i * 4))
+            .collect(),
+        payload: Rc::new(RefCell::new(b[header_len..].to_vec())),
+    }))
+}
+
+impl NativeObject for RtpHeader {
+    fn type_name(&self) -> &str {
+        "rtp_header"
+    }
+
+    fn get(&self, prop: &str) -> HaversResult<Value> {
+        Ok(match prop {
+            "ok" => Value::Bool(true),
+            "version" => Value::Integer(self.version as i64),
+            "padding" => Value::Bool(self.padding),
+            "extension" => Value::Bool(self.extension),
+            "csrc_count" => Value::Integer(self.csrcs.len() as i64),
+            "marker" => Value::Bool(self.marker),
+            "payload_type" => Value::Integer(self.payload_type as i64),
+            "seq" => Value::Integer(self.seq as i64),
+            "timestamp" => Value::Integer(self.timestamp as i64),
+            "ssrc" => Value::Integer(self.ssrc as i64),
+            "header_len" => Value::Integer((RTP_HEADER_MIN + self.csrcs.len() * 4) as i64),
+            "csrcs" => Value::List(Rc::new(RefCell::new(
+                self.csrcs
+                    .iter()
+                    .map(|&c| Value::Integer(c as i64))
+                    .collect(),
+            ))),
+            "payload" => Value::Bytes(self.payload.clone()),
+            _ => {
+                return Err(HaversError::UndefinedVariable {
+                    name: prop.to_string(),
+                    line: 0,
+                })
+            }
+        })
+    }
+
+    fn set(&self, prop: &str, _value: Value) -> HaversResult<Value> {
+        Err(HaversError::TypeError {
+            message: format!("Cannae set '{}' on {}", prop, self.type_name()),
+            line: 0,
+        })
+    }
+
+    fn call(&self, _method: &str, _args: Vec<Value>) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
+
+    fn as_any(&self) -> &dyn std::any::Any {
+        self
+    }
+}
+
+/// rtp_build_native(payload, seq, timestamp, ssrc, payload_type, marker, csrcs): the
+/// packet, keeping at most 15 CSRCs.
+fn rtp_build(args: &[Value]) -> Result<Value, String> {
+    let payload = match &args[0] {
+        Value::Bytes(b) => b.borrow(),
+        _ => return Err("rtp_build_native() expects bytes payload".to_string()),
+    };
+    let int = |v: &Value, what: &str| match v {
+        Value::Integer(n) => Ok(*n),
+        Value::Float(f) => Ok(*f as i64),
+        Value::Bool(b) if what == "marker" => Ok(*b as i64),
+        _ => Err(format!("rtp_build_native() expects integer {}", what)),
+    };
+    let seq = int(&args[1], "seq")?;
+    let timestamp = int(&args[2], "timestamp")?;
+    let ssrc = int(&args[3], "ssrc")?;
+    let payload_type = int(&args[4], "payload_type")?;
+    let marker = int(&args[5], "marker")?;
+    let csrcs = match &args[6] {
+        Value::List(items) => items.borrow(),
+        _ => return Err("rtp_build_native() expects a list o' csrcs".to_string()),
+    };
+    let cc = csrcs.len().min(15);
+
+    let mut out = Vec::with_capacity(RTP_HEADER_MIN + cc * 4 + payload.len());
+    out.push(0x80 | cc as u8);
+    out.push((((marker & 1) << 7) | (payload_type & 0x7F)) as u8);
+    out.extend_from_slice(&(seq as u16).to_be_bytes());
+    out.extend_from_slice(&(timestamp as u32).to_be_bytes());
+    out.extend_from_slice(&(ssrc as u32).to_be_bytes());
+    for csrc in csrcs.iter().take(cc) {
+        out.extend_from_slice(&(int(csrc, "csrc")? as u32).to_be_bytes());
+    }
+    out.extend_from_slice(&payload);
+    Ok(Value::Bytes(Rc::new(RefCell::new(out))))
+}
+
+/// The text a sip_message was parsed from: the string itself, or a copy of the bytes
+/// (interpreter bytes can change under it).
+#[derive(Debug)]
+enum SipSource {
+    Str(Rc<str>),
+    Bytes(Vec<u8>),
+}
+
+impl SipSource {
+    fn as_bytes(&self) -> &[u8] {
+        match self {
+            SipSource::Str(s) => s.as_bytes(),
+            SipSource::Bytes(b) => b,
+        }
+    }
+}
+
+/// One header line: the hash of its lowercased name and where name and value sit.
+#[derive(Debug)]
+struct SipHeaderSpan {
+    hash: u32,
+    name: std::ops::Range<usize>,
+    value: std::ops::Range<usize>,
+}
+
+/// A tokenised SIP (or HTTP) message; fields are spans, made into strings when read.
+#[derive(Debug)]
+struct SipParsed {
+    source: SipSource,
+    http: bool,
+    is_response: bool,
+    complete: bool,
+    status: i64,
+    start: [Option<std::ops::Range<usize>>; 3],
+    body: std::ops::Range<usize>,
+    headers: Vec<SipHeaderSpan>,
+}
+
+fn sip_hash(name: &[u8]) -> u32 {
+    name.iter().fold(2166136261u32, |h, &c| {
+        (h ^ c.to_ascii_lowercase() as u32).wrapping_mul(16777619)
+    })
+}
+
+fn sip_trim(buf: &[u8], mut range: std::ops::Range<usize>) -> std::ops::Range<usize> {
+    while range.start < range.end && matches!(buf[range.start], b' ' | b'\t') {
+        range.start += 1;
+    }
+    while range.end > range.start && matches!(buf[range.end - 1], b' ' | b'\t') {
+        range.end -= 1;
+    }
+    range
+}
+
+/// The line at `pos` without its CR LF, and where the next one starts.
+fn sip_line(buf: &[u8], pos: usize) -> (usize, usize) {
+    let (stop, next) = match buf[pos..].iter().position(|&c| c == b'\n') {
+        Some(i) => (pos + i, pos + i + 1),
+        None => (buf.len(), buf.len()),
+    };
+    let end = if stop > pos && buf[stop - 1] == b'\r' {
+        stop - 1
+    } else {
+        stop
+    };
+    (end, next)
+}
+
+impl SipParsed {
+    fn text(&self, range: &std::ops::Range<usize>) -> Value {
+        let bytes = &self.source.as_bytes()[range.clone()];
+        Value::String(String::from_utf8_lossy(bytes).into())
+    }
+
+    fn start_text(&self, i: usize, missing: Option<&str>) -> Value {
+        match (&self.start[i], missing) {
+            (Some(range), _) => self.text(range),
+            (None, Some(default)) => Value::String(default.into()),
+            (None, None) => Value::Nil,
+        }
+    }
+
+    /// The last header of that name, as when the headers were a dict.
+    fn header(&self, name: &str) -> Value {
+        let buf = self.source.as_bytes();
+        let hash = sip_hash(name.as_bytes());
+        self.headers
+            .iter()
+            .rev()
+            .find(|h| h.hash == hash && buf[h.name.clone()].eq_ignore_ascii_case(name.as_bytes()))
+            .map_or(Value::Nil, |h| self.text(&h.value))
+    }
+}
+
+fn sip_invalid(raw: &[u8]) -> Value {
+    let mut dict = DictValue::new();
+    dict.set(
+        Value::String("type".into()),
+        Value::String("invalid".into()),
+    );
+    dict.set(
+        Value::String("raw".into()),
+        Value::String(String::from_utf8_lossy(raw).into()),
+    );
+    Value::Dict(Rc::new(RefCell::new(dict)))
+}
+
+/// sip_parse_native and http_parse_native: start line, header spans and a Content-Length
+/// body, as the runtime does it; "complete" is false until the blank line and the whole body
+/// are there. An HTTP request without a Content-Length has no body.
+fn sip_parse(source: SipSource, http: bool) -> Value {
+    let buf = source.as_bytes();
+    let (line_end, head_pos) = sip_line(buf, 0);
+
+    let mut start: [Option<std::ops::Range<usize>>; 3] = [None, None, None];
+    let mut at = 0;
+    for (i, slot) in start.iter_mut().enumerate() {
+        if at > line_end {
+            break;
+        }
+        let space = if i < 2 {
+            buf[at..line_end].iter().position(|&c| c == b' ')
+        } else {
+            None
+        };
+        let stop = space.map_or(line_end, |s| at + s);
+        *slot = Some(at..stop);
+        at = if space.is_some() {
+            stop + 1
+        } else {
+            line_end + 1
+        };
+    }
+    let Some(second) = start[1].clone() else {
+        return sip_invalid(buf);
+    };
+    let first = start[0].clone().unwrap_or_default();
+    let is_response = buf[first.clone()].starts_with(b"SIP/") || buf[first].starts_with(b"HTTP/");
+    let status = buf[second]
+        .iter()
+        .take_while(|c| c.is_ascii_digit())
+        .fold(0i64, |n, &c| {
+            n.saturating_mul(10).saturating_add((c - b'0') as i64)
+        });
+    if is_response {
+        if let Some(reason) = &mut start[2] {
+            reason.end = line_end;
+        }
+    }
+
+    let mut headers = Vec::new();
+    let mut complete = false;
+    let mut pos = head_pos;
+    while pos < buf.len() {
+        let (end, next) = sip_line(buf, pos);
+        if end == pos {
+            complete = true;
+            pos = next;
+            break;
+        }
+        if let Some(colon) = buf[pos..end].iter().position(|&c| c == b':') {
+            let name = sip_trim(buf, pos..pos + colon);
+            let value = sip_trim(buf, pos + colon + 1..end);
+            headers.push(SipHeaderSpan {
+                hash: sip_hash(&buf[name.clone()]),
+                name,
+                value,
+            });
+        }
+        pos = next;
+    }
+
+    let body_off = if complete { pos } else { buf.len() };
+    let mut body = body_off..buf.len();
+    let cl_hash = sip_hash(b"content-length");
+    let content_length = headers
+        .iter()
+        .rev()
+        .find(|h| h.hash == cl_hash && buf[h.name.clone()].eq_ignore_ascii_case(b"content-length"));
+    let mut framed = false;
+    if let Some(h) = content_length.filter(|_| complete) {
+        let digits = &buf[h.value.clone()];
+        if !digits.is_empty() && digits.iter().all(|c| c.is_ascii_digit()) {
+            framed = true;
+            let want = digits.iter().fold(0usize, |n, &c| {
+                n.saturating_mul(10).saturating_add((c - b'0') as usize)
+            });
+            if want <= body.len() {
+                body.end = body.start + want;
+            } else {
+                complete = false;
+            }
+        }
+    }
+    if http && !is_response && !framed {
+        body.end = body.start;
+    }
+
+    let parsed = Rc::new(SipParsed {
+        source,
+        http,
+        is_response,
+        complete,
+        status,
+        start,
+        body,
+        headers,
+    });
+    Value::NativeObject(Rc::new(SipMessage(parsed)))
+}
+
+/// A message from sip_parse_native, read like the dict sip_parse_message used to build.
+#[derive(Debug)]
+struct SipMessage(Rc<SipParsed>);
+
+/// m["headers"]: case-insensitive lookup, nil for a header that isn't there.
+#[derive(Debug)]
+struct SipHeaders(Rc<SipParsed>);
+
+impl NativeObject for SipMessage {
+    fn type_name(&self) -> &str {
+        if self.0.http {
+            "http_message"
+        } else {
+            "sip_message"
+        }
+    }
+
+    fn get(&self, prop: &str) -> HaversResult<Value> {
+        let m = &self.0;
+        Ok(match (prop, m.is_response) {
+            ("headers", _) => Value::NativeObject(Rc::new(SipHeaders(m.clone()))),
+            ("body", _) => m.text(&m.body),
+            ("type", true) => Value::String("response".into()),
+            ("type", false) => Value::String("request".into()),
+            ("complete", _) => Value::Bool(m.complete),
+            ("length", _) => Value::Integer(m.body.end as i64),
+            ("version", true) => m.start_text(0, None),
+            ("status", true) => Value::Integer(m.status),
+            ("reason", true) => m.start_text(2, Some("")),
+            ("method", false) => m.start_text(0, None),
+            ("uri", false) => m.start_text(1, None),
+            ("version", false) => {
+                m.start_text(2, Some(if m.http { "HTTP/0.9" } else { "SIP/2.0" }))
+            }
+            _ => {
+                return Err(HaversError::UndefinedVariable {
+                    name: prop.to_string(),
+                    line: 0,
+                })
+            }
+        })
+    }
+
+    fn set(&self, prop: &str, _value: Value) -> HaversResult<Value> {
+        Err(HaversError::TypeError {
+            message: format!("Cannae set '{}' on {}", prop, self.type_name()),
+            line: 0,
+        })
+    }
+
+    fn call(&self, _method: &str, _args: Vec<Value>) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
+
+    fn as_any(&self) -> &dyn std::any::Any {
+        self
+    }
+}
+
+impl NativeObject for SipHeaders {
+    fn type_name(&self) -> &str {
+        if self.0.http {
+            "http_headers"
+        } else {
+            "sip_headers"
+        }
+    }
+
+    fn get(&self, prop: &str) -> HaversResult<Value> {
+        Ok(self.0.header(prop))
+    }
+
+    fn set(&self, prop: &str, _value: Value) -> HaversResult<Value> {
+        Err(HaversError::TypeError {
+            message: format!("Cannae set '{}' on {}", prop, self.type_name()),
+            line: 0,
+        })
+    }
+
+    fn call(&self, _method: &str, _args: Vec<Value>) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
+
+    fn as_any(&self) -> &dyn std::any::Any {
+        self
+    }
+}
+
+/// Run `f` over the bytes of a string or bytes argument, for the codecs and digests.
+fn with_codec_input<R>(name: &str, value: &Value, f: impl FnOnce(&[u8]) -> R) -> Result<R, String> {
+    match value {
+        Value::String(s) => Ok(f(s.as_bytes())),
+        Value::Bytes(b) => Ok(f(&b.borrow())),
+        _ => Err(format!("{}() expects a string or bytes", name)),
+    }
+}
+
+/// A decoded result: a string when `as_string` is truthy, otherwise bytes.
+fn codec_output(decoded: Vec<u8>, as_string: &Value) -> Value {
+    if as_string.is_truthy() {
+        Value::String(String::from_utf8_lossy(&decoded).into())
+    } else {
+        Value::Bytes(Rc::new(RefCell::new(decoded)))
+    }
+}
+
+const BASE64_CHARS: &[u8; 64] = b"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+fn base64_encode(data: &[u8]) -> String {
+    let mut out = String::with_capacity(data.len().div_ceil(3) * 4);
+    for chunk in data.chunks(3) {
+        let w = (chunk[0] as u32) << 16
+            | chunk.get(1).map_or(0, |&b| (b as u32) << 8)
+            | chunk.get(2).map_or(0, |&b| b as u32);
+        out.push(BASE64_CHARS[(w >> 18) as usize] as char);
+        out.push(BASE64_CHARS[(w >> 12 & 63) as usize] as char);
+        out.push(if chunk.len() > 1 {
+            BASE64_CHARS[(w >> 6 & 63) as usize] as char
+        } else {
+            '='
+        });
+        out.push(if chunk.len() > 2 {
+            BASE64_CHARS[(w & 63) as usize] as char
+        } else {
+            '='
+        });
+    }
+    out
+}
+
+/// Padding, line breaks and anything else outside the alphabet are skipped, as the runtime
+/// does it.
+fn base64_decode(text: &[u8]) -> Vec<u8> {
+    let mut out = Vec::with_capacity(text.len() / 4 * 3 + 2);
+    let (mut acc, mut have) = (0u32, 0);
+    for &c in text {
+        let Some(v) = BASE64_CHARS.iter().position(|&a| a == c) else {
+            continue;
+        };
+        acc = acc << 6 | v as u32;
+        have += 1;
+        if have == 4 {
+            out.extend_from_slice(&[(acc >> 16) as u8, (acc >> 8) as u8, acc as u8]);
+            acc = 0;
+            have = 0;
+        }
+    }
+    if have >= 2 {
+        acc <<= 6 * (4 - have);
+        out.push((acc >> 16) as u8);
+        if have == 3 {
+            out.push((acc >> 8) as u8);
+        }
+    }
+    out
+}
+
+fn hex_encode(data: &[u8]) -> String {
+    const HEX: &[u8; 16] = b"0123456789abcdef";
+    let mut out = String::with_capacity(data.len() * 2);
+    for &b in data {
+        out.push(HEX[(b >> 4) as usize] as char);
+        out.push(HEX[(b & 15) as usize] as char);
+    }
+    out
+}
+
+/// A pair with a non-digit in it is skipped, and so is an odd digit at the end.
+fn hex_decode(text: &[u8]) -> Vec<u8> {
+    let digit = |c: u8| (c as char).to_digit(16);
+    text.chunks_exact(2)
+        .filter_map(|pair| Some((digit(pair[0])? << 4 | digit(pair[1])?) as u8))
+        .collect()
+}
+
+/// Whole 64-byte blocks through `block`, then the tail padded with the big-endian bit
+/// length as SHA-1 and SHA-256 both do.
+fn md_digest(data: &[u8], mut block: impl FnMut(&[u8])) {
+    let mut chunks = data.chunks_exact(64);
+    for chunk in &mut chunks {
+        block(chunk);
+    }
+    let rest = chunks.remainder();
+    let mut tail = [0u8; 128];
+    tail[..rest.len()].copy_from_slice(rest);
+    tail[rest.len()] = 0x80;
+    let tail_len = if rest.len() < 56 { 64 } else { 128 };
+    tail[tail_len - 8..tail_len].copy_from_slice(&((data.len() as u64) * 8).to_be_bytes());
+    for chunk in tail[..tail_len].chunks_exact(64) {
+        block(chunk);
+    }
+}
+
+const SHA256_K: [u32; 64] = [
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+];
+
+fn sha256(data: &[u8]) -> Vec<u8> {
+    let mut state: [u32; 8] = [
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab,
+        0x5be0cd19,
+    ];
+    md_digest(data, |block| {
+        let mut w = [0u32; 64];
+        for (t, word) in block.chunks_exact(4).enumerate() {
+            w[t] = u32::from_be_bytes([word[0], word[1], word[2], word[3]]);
+        }
+        for t in 16..64 {
+            let s0 = w[t - 15].rotate_right(7) ^ w[t - 15].rotate_right(18) ^ (w[t - 15] >> 3);
+            let s1 = w[t - 2].rotate_right(17) ^ w[t - 2].rotate_right(19) ^ (w[t - 2] >> 10);
+            w[t] = w[t - 16]
+                .wrapping_add(s0)
+                .wrapping_add(w[t - 7])
+                .wrapping_add(s1);
+        }
+        let mut v = state;
+        for t in 0..64 {
+            let [a, b, c, d, e, f, g, h] = v;
+            let s1 = e.rotate_right(6) ^ e.rotate_right(11) ^ e.rotate_right(25);
+            let t1 = h
+                .wrapping_add(s1)
+                .wrapping_add((e & f) ^ (!e & g))
+                .wrapping_add(SHA256_K[t])
+                .wrapping_add(w[t]);
+            let s0 = a.rotate_right(2) ^ a.rotate_right(13) ^ a.rotate_right(22);
+            let t2 = s0.wrapping_add((a & b) ^ (a & c) ^ (b & c));
+            v = [t1.wrapping_add(t2), a, b, c, d.wrapping_add(t1), e, f, g];
+        }
+        for (s, x) in state.iter_mut().zip(v) {
+            *s = s.wrapping_add(x);
+        }
+    });
+    state.iter().flat_map(|s| s.to_be_bytes()).collect()
+}
+
+fn sha1(data: &[u8]) -> Vec<u8> {
+    let mut state: [u32; 5] = [0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0];
+    md_digest(data, |block| {
+        let mut w = [0u32; 80];
+        for (t, word) in block.chunks_exact(4).enumerate() {
+            w[t] = u32::from_be_bytes([word[0], word[1], word[2], word[3]]);
+        }
+        for t in 16..80 {
+            w[t] = (w[t - 3] ^ w[t - 8] ^ w[t - 14] ^ w[t - 16]).rotate_left(1);
+        }
+        let [mut a, mut b, mut c, mut d, mut e] = state;
+        for (t, &wt) in w.iter().enumerate() {
+            let (f, k) = match t {
+                0..=19 => ((b & c) | (!b & d), 0x5a827999),
+                20..=39 => (b ^ c ^ d, 0x6ed9eba1),
+                40..=59 => ((b & c) | (b & d) | (c & d), 0x8f1bbcdc),
+                _ => (b ^ c ^ d, 0xca62c1d6),
+            };
+            let next = a
+                .rotate_left(5)
+                .wrapping_add(f)
+                .wrapping_add(e)
+                .wrapping_add(k)
+                .wrapping_add(wt);
+            e = d;
+            d = c;
+            c = b.rotate_left(30);
+            b = a;
+            a = next;
+        }
+        for (s, x) in state.iter_mut().zip([a, b, c, d, e]) {
+            *s = s.wrapping_add(x);
+        }
+    });
+    state.iter().flat_map(|s| s.to_be_bytes()).collect()
+}
+
+const CRC32_TABLE: [u32; 256] = {
+    let mut table = [0u32; 256];
+    let mut b = 0;
+    while b < 256 {
+        let mut c = b as u32;
+        let mut i = 0;
+        while i < 8 {
+            c = (c >> 1) ^ (0xedb88320 & (c & 1).wrapping_neg());
+            i += 1;
+        }
+        table[b] = c;
+        b += 1;
+    }
+    table
+};
+
+/// The zlib/PNG/Ethernet CRC-32.
+fn crc32(data: &[u8]) -> u32 {
+    !data.iter().fold(!0u32, |crc, &b| {
+        (crc >> 8) ^ CRC32_TABLE[((crc ^ b as u32) & 0xff) as usize]
+    })
+}
+
+const XXH_P1: u64 = 11400714785074694791;
+const XXH_P2: u64 = 14029467366897019727;
+const XXH_P3: u64 = 1609587929392839161;
+const XXH_P4: u64 = 9650029242287828579;
+const XXH_P5: u64 = 2870177450012600261;
+
+fn xxh64_round(acc: u64, input: u64) -> u64 {
+    acc.wrapping_add(input.wrapping_mul(XXH_P2))
+        .rotate_left(31)
+        .wrapping_mul(XXH_P1)
+}
+
+/// XXH64 with seed 0.
+fn xxhash64(data: &[u8]) -> u64 {
+    let read64 = |p: &[u8]| u64::from_le_bytes(p[..8].try_into().unwrap());
+    let mut stripes = data.chunks_exact(32);
+    let mut h = if data.len() >= 32 {
+        let mut v = [
+            XXH_P1.wrapping_add(XXH_P2),
+            XXH_P2,
+            0,
+            0u64.wrapping_sub(XXH_P1),
+        ];
+        for stripe in &mut stripes {
+            for (i, lane) in v.iter_mut().enumerate() {
+                *lane = xxh64_round(*lane, read64(&stripe[i * 8..]));
+            }
+        }
+        let mut h = v[0]
+            .rotate_left(1)
+            .wrapping_add(v[1].rotate_left(7))
+            .wrapping_add(v[2].rotate_left(12))
+            .wrapping_add(v[3].rotate_left(18));
+        for lane in v {
+            h = (h ^ xxh64_round(0, lane))
+                .wrapping_mul(XXH_P1)
+                .wrapping_add(XXH_P4);
+        }
+        h
+    } else {
+        XXH_P5
+    };
+    h = h.wrapping_add(data.len() as u64);
+    let mut rest = stripes.remainder();
+    while rest.len() >= 8 {
+        h ^= xxh64_round(0, read64(rest));
+        h = h.rotate_left(27).wrapping_mul(XXH_P1).wrapping_add(XXH_P4);
+        rest = &rest[8..];
+    }
+    if rest.len() >= 4 {
+        let word = u32::from_le_bytes(rest[..4].try_into().unwrap()) as u64;
+        h ^= word.wrapping_mul(XXH_P1);
+        h = h.rotate_left(23).wrapping_mul(XXH_P2).wrapping_add(XXH_P3);
+        rest = &rest[4..];
+    }
+    for &b in rest {
+        h ^= (b as u64).wrapping_mul(XXH_P5);
+        h = h.rotate_left(11).wrapping_mul(XXH_P1);
+    }
+    h ^= h >> 33;
+    h = h.wrapping_mul(XXH_P2);
+    h ^= h >> 29;
+    h = h.wrapping_mul(XXH_P3);
+    h ^ (h >> 32)
+}
+
+type FileSlot = RefCell<Option<std::io::BufWriter<std::fs::File>>>;
+
+thread_local! {
+    // Writers still open, flushed when interpret() finishes so an unclosed handle
+    // loses nothing.
+    static OPEN_FILES: RefCell<Vec<std::rc::Weak<FileSlot>>> = const { RefCell::new(Vec::new()) };
+}
+
+fn flush_open_files() {
+    OPEN_FILES.with(|files| {
+        files.borrow_mut().retain(|weak| match weak.upgrade() {
+            Some(writer) => {
+                if let Some(w) = writer.borrow_mut().as_mut() {
+                    let _ = w.flush();
+                }
+                true
+            }
+            None => false,
+        });
+    });
+}
+
+/// A file_open handle: writes gather in a BufWriter until it fills, file_flush or file_close.
+#[derive(Debug)]
+struct FileHandle {
+    path: String,
+    writer: Rc<FileSlot>,
+}
+
+impl NativeObject for FileHandle {
+    fn type_name(&self) -> &str {
+        "file"
+    }
+
+    fn get(&self, prop: &str) -> HaversResult<Value> {
+        Err(HaversError::UndefinedVariable {
+            name: prop.to_string(),
+            line: 0,
+        })
+    }
+
+    fn set(&self, _prop: &str, _value: Value) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
+
+    fn call(&self, _method: &str, _args: Vec<Value>) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
+
+    fn as_any(&self) -> &dyn std::any::Any {
+        self
+    }
+}
+
+/// Run `f` on an open file_open writer; a closed handle is an error.
+fn with_file_writer<T, F>(name: &str, value: &Value, f: F) -> Result<T, String>
+where
+    F: FnOnce(&mut std::io::BufWriter<std::fs::File>, &str) -> Result<T, String>,
+{
+    let handle = match value {
+        Value::NativeObject(obj) => obj.as_any().downcast_ref::<FileHandle>(),
+        _ => None,
+    };
+    let Some(handle) = handle else {
+        return Err(format!("{}() needs a file frae file_open", name));
+    };
+    let mut slot = handle.writer.borrow_mut();
+    match slot.as_mut() {
+        Some(writer) => f(writer, &handle.path),
+        None => Err(format!("{}() got a closed file", name)),
+    }
+}
+
+#[cfg(feature = "native")]
+fn addr_dict(host: String, port: i64) -> Value {
+    let mut dict = DictValue::new();
+    dict.set(Value::String("host".into()), Value::String(host.into()));
+    dict.set(Value::String("port".into()), Value::Integer(port));
+    Value::Dict(Rc::new(RefCell::new(dict)))
+}
+
+#[cfg(all(feature = "native", unix))]
+fn sockaddr_to_host_port(addr: &libc::sockaddr_in) -> (String, i64) {
+    let host = std::net::Ipv4Addr::from(u32::from_be(addr.sin_addr.s_addr)).to_string();
+    let port = u16::from_be(addr.sin_port) as i64;
+    (host, port)
+}
+
+/// An IPv4 peer from addr_resolve, read as addr["host"] / addr["port"].
+#[cfg(all(feature = "native", unix))]
+#[derive(Debug)]
+struct SockAddrValue {
+    addr: std::net::SocketAddrV4,
+}
+
+#[cfg(all(feature = "native", unix))]
+impl NativeObject for SockAddrValue {
+    fn type_name(&self) -> &str {
+        "addr"
+    }
+
+    fn get(&self, prop: &str) -> HaversResult<Value> {
+        match prop {
+            "host" => Ok(Value::String(self.addr.ip().to_string().into())),
+            "port" => Ok(Value::Integer(self.addr.port() as i64)),
+            _ => Err(HaversError::UndefinedVariable {
+                name: prop.to_string(),
+                line: 0,
+            }),
+        }
+    }
+
+    fn set(&self, _prop: &str, _value: Value) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
+
+    fn call(&self, _method: &str, _args: Vec<Value>) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
+
+    fn as_any(&self) -> &dyn std::any::Any {
+        self
+    }
+
+    fn to_string(&self) -> String {
+        self.addr.to_string()
+    }
+
+    fn equals(&self, other: &dyn NativeObject) -> bool {
+        other
+            .as_any()
+            .downcast_ref::<SockAddrValue>()
+            .is_some_and(|o| o.addr == self.addr)
+    }
+}
+
+#[cfg(all(feature = "native", unix))]
+fn addr_object(addr: &libc::sockaddr_in) -> Value {
+    let ip = std::net::Ipv4Addr::from(u32::from_be(addr.sin_addr.s_addr));
+    let addr = std::net::SocketAddrV4::new(ip, u16::from_be(addr.sin_port));
+    Value::NativeObject(Rc::new(SockAddrValue { addr }))
+}
+
+#[cfg(all(feature = "native", unix))]
+fn addr_sockaddr(value: &Value) -> Option<libc::sockaddr_in> {
+    let Value::NativeObject(obj) = value else {
+        return None;
+    };
+    let peer = obj.as_any().downcast_ref::<SockAddrValue>()?;
+    let mut addr: libc::sockaddr_in = unsafe { std::mem::zeroed() };
+    addr.sin_family = libc::AF_INET as u16;
+    addr.sin_port = peer.addr.port().to_be();
+    addr.sin_addr.s_addr = u32::from(*peer.addr.ip()).to_be();
+    Some(addr)
+}
+
+/// Peer address from `[addr]`, `[{host, port}]` or `[host, port]` arguments.
+#[cfg(all(feature = "native", unix))]
+fn peer_sockaddr(op: &str, args: &[Value]) -> Result<libc::sockaddr_in, String> {
+    if let Some(addr) = args.first().and_then(addr_sockaddr) {
+        return Ok(addr);
+    }
+    if let Some(Value::Dict(dict)) = args.first() {
+        let dict = dict.borrow();
+        let host = dict.get(&Value::String("host".into())).cloned();
+        let port = dict.get(&Value::String("port".into())).cloned();
+        let host_port = [host.unwrap_or(Value::Nil), port.unwrap_or(Value::Nil)];
+        return peer_sockaddr(op, &host_port);
+    }
+    let host = match args.first() {
+        Some(Value::String(s)) => s.as_ref(),
+        _ => return Err(format!("{}() expects host string or address", op)),
+    };
+    let port = args
+        .get(1)
+        .and_then(|p| p.as_integer())
+        .ok_or(format!("{}() expects port integer", op))?;
+    if port < 0 || port > 65535 {
+        return Err(format!("{}() port must be 0..65535", op));
+    }
+    resolve_ipv4_addr(Some(host), port as u16).map_err(|e| format!("{}() {}", op, e))
+}
+
+/// Send bytes or string parts over a TCP socket, resuming after partial writes. One send
+/// unless `all`; a send that would block after some progress returns the count so far.
+#[cfg(all(feature = "native", unix))]
+fn tcp_send_parts(op: &str, sock: &Value, parts: &[Value], all: bool) -> Result<Value, String> {
+    let sock_id = sock
+        .as_integer()
+        .ok_or(format!("{}() expects socket id", op))?;
+    let mut data = Vec::new();
+    for part in parts {
+        match part {
+            Value::Bytes(b) => data.extend_from_slice(&b.borrow()),
+            Value::String(s) => data.extend_from_slice(s.as_bytes()),
+            _ => return Err(format!("{}() expects bytes or strings", op)),
+        }
+    }
+    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+    let mut sent = 0usize;
+    while sent < data.len() {
+        let n = unsafe {
+            libc::send(
+                entry.fd,
+                data[sent..].as_ptr() as *const libc::c_void,
+                data.len() - sent,
+                0,
+            )
+        };
+        if n < 0 {
+            let err = std::io::Error::last_os_error();
+            match err.kind() {
+                std::io::ErrorKind::Interrupted => continue,
+                std::io::ErrorKind::WouldBlock if sent > 0 => break,
+                _ => {
+                    let code = err.raw_os_error().unwrap_or(-1) as i64;
+                    return Ok(result_err(err.to_string(), code));
+                }
+            }
+        }
+        sent += n as usize;
+        if !all {
+            break;
+        }
+    }
+    Ok(result_ok(Value::Integer(sent as i64)))
+}
+
+/// Copy `len` bytes of `file` from `offset` to a socket, with sendfile(2) on Linux and
+/// read_at + send elsewhere. Stops early, with the count so far, if the socket would block.
+#[cfg(all(feature = "native", unix))]
+fn send_file_range(
+    sock_fd: libc::c_int,
+    file: &std::fs::File,
+    offset: u64,
+    len: u64,
+) -> std::io::Result<u64> {
+    let mut sent = 0u64;
+    while sent < len {
+        let want = (len - sent).min(1 << 30) as usize;
+        #[cfg(target_os = "linux")]
+        let n = {
+            use std::os::unix::io::AsRawFd;
+            let mut off = (offset + sent) as libc::off_t;
+            unsafe { libc::sendfile(sock_fd, file.as_raw_fd(), &mut off, want) }
+        };
+        #[cfg(not(target_os = "linux"))]
+        let n = {
+            use std::os::unix::fs::FileExt;
+            let mut chunk = vec![0u8; want.min(65536)];
+            let got = file.read_at(&mut chunk, offset + sent)?;
+            let mut done = 0;
+            while done < got {
+                let w = unsafe {
+                    libc::send(
+                        sock_fd,
+                        chunk[done..got].as_ptr() as *const libc::c_void,
+                        got - done,
+                        0,
+                    )
+                };
+                if w < 0 {
+                    break;
+                }
+                done += w as usize;
+            }
+            if done < got {
+                sent += done as u64;
+                -1
+            } else {
+                got as isize
+            }
+        };
+        if n < 0 {
+            let err = std::io::Error::last_os_error();
+            match err.kind() {
+                std::io::ErrorKind::Interrupted => continue,
+                std::io::ErrorKind::WouldBlock if sent > 0 => break,
+                _ => return Err(err),
+            }
+        }
+        if n == 0 {
+            break;
+        }
+        sent += n as u64;
+    }
+    Ok(sent)
+}
+
+fn event_dict(
+    kind: &str,
+    sock: Option<i64>,
+    timer_id: Option<i64>,
+    callback: Option<Value>,
+) -> Value {
+    let mut dict = DictValue::new();
+    dict.set(Value::String("kind".into()), Value::String(kind.into()));
+    if let Some(sock_id) = sock {
+        dict.set(Value::String("sock".into()), Value::Integer(sock_id));
+    }
+    if let Some(id) = timer_id {
+        dict.set(Value::String("id".into()), Value::Integer(id));
+    }
+    if let Some(cb) = callback {
+        dict.set(Value::String("callback".into()), cb);
+    }
+    Value::Dict(Rc::new(RefCell::new(dict)))
+}
+
+#[cfg(all(feature = "native", unix))]
+fn resolve_ipv4_addr(host: Option<&str>, port: u16) -> Result<libc::sockaddr_in, String> {
+    let mut addr: libc::sockaddr_in = unsafe { std::mem::zeroed() };
+    addr.sin_family = libc::AF_INET as u16;
+    addr.sin_port = port.to_be();
+
+    if let Some(host_str) = host {
+        let mut resolved = None;
+        let iter = (host_str, port)
+            .to_socket_addrs()
+            .map_err(|e| format!("DNS lookup failed: {}", e))?;
+        for sock in iter {
+            if let std::net::SocketAddr::V4(v4) = sock {
+                resolved = Some(v4);
+                break;
+            }
+        }
+        let v4 = resolved.ok_or_else(|| "No IPv4 address found".to_string())?;
+        addr.sin_addr = libc::in_addr {
+            s_addr: u32::from_ne_bytes(v4.ip().octets()),
+        };
+    } else {
+        addr.sin_addr = libc::in_addr { s_addr: 0 };
+    }
+
+    Ok(addr)
+}
+
+fn format_braw_time(hours: u64, minutes: u64) -> String {
+    match hours {
+        0..=5 => format!("It's the wee small hours ({:02}:{:02})", hours, minutes),
+        6..=11 => format!("It's the mornin' ({:02}:{:02})", hours, minutes),
+        12 => format!("It's high noon ({:02}:{:02})", hours, minutes),
+        13..=17 => format!("It's the efternoon ({:02}:{:02})", hours, minutes),
+        18..=21 => format!("It's the evenin' ({:02}:{:02})", hours, minutes),
+        _ => format!("It's gettin' late ({:02}:{:02})", hours, minutes),
+    }
+}
+
+/// A stack frame for the shadow call stack
+#[derive(Debug, Clone)]
+pub struct StackFrame {
+    /// Function name or "<main>"
+    pub name: String,
+    /// Source file name
+    pub file: String,
+    /// Line number
+    pub line: usize,
+}
+
+impl std::fmt::Display for StackFrame {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        write!(f, "  at {} ({}:{})", self.name, self.file, self.line)
+    }
+}
+
+/// Global shadow call stack for crash reporting
+static SHADOW_STACK: Mutex<Vec<StackFrame>> = Mutex::new(Vec::new());
+static CURRENT_STACK_FILE: Mutex<String> = Mutex::new(String::new());
+
+/// Push a frame onto the shadow stack
+pub fn push_stack_frame(name: &str, line: usize) {
+    let mut stack = SHADOW_STACK.lock().unwrap_or_else(|e| e.into_inner());
+    let file = CURRENT_STACK_FILE
+        .lock()
+        .map(|f| f.clone())
+        .unwrap_or_default();
+    stack.push(StackFrame {
+        name: name.to_string(),
+        file,
+        line,
+    });
+}
+
+/// Pop a frame from the shadow stack
+pub fn pop_stack_frame() {
+    let mut stack = SHADOW_STACK.lock().unwrap_or_else(|e| e.into_inner());
+    stack.pop();
+}
+
+/// Get a copy of the current stack trace
+pub fn get_stack_trace() -> Vec<StackFrame> {
+    SHADOW_STACK
+        .lock()
+        .map(|s| s.clone())
+        .unwrap_or_else(|e| e.into_inner().clone())
+}
+
+/// Clear the stack trace (for REPL reset)
+#[allow(dead_code)]
+pub fn clear_stack_trace() {
+    let mut stack = SHADOW_STACK.lock().unwrap_or_else(|e| e.into_inner());
+    stack.clear();
+}
+
+/// Coverage-only helper to poison the shadow-stack mutex so that poison-recovery branches execute.
+#[cfg(coverage)]
+#[allow(dead_code)]
+pub fn poison_shadow_stack_for_coverage() {
+    let _ = std::panic::catch_unwind(|| {
+        let _guard = SHADOW_STACK.lock().unwrap();
+        panic!("poison SHADOW_STACK for coverage");
+    });
+}
+
+/// Coverage-only helper to force `with_dir` / `set_current_dir` instantiations in the non-test crate.
+#[cfg(coverage)]
+#[allow(dead_code)]
+pub fn exercise_interpreter_dir_instantiations_for_coverage() {
+    use std::path::PathBuf;
+
+    let dir_buf = PathBuf::from("/tmp");
+    let dir_path = dir_buf.as_path();
+    let dir_string = dir_buf.to_string_lossy().to_string();
+    let dir_str = dir_string.as_str();
+
+    let _ = Interpreter::with_dir(dir_buf.clone());
+    let _ = Interpreter::with_dir(&dir_buf);
+    let _ = Interpreter::with_dir(dir_path);
+    let _ = Interpreter::with_dir(dir_string.clone());
+    let _ = Interpreter::with_dir(&dir_string);
+    let _ = Interpreter::with_dir(dir_str);
+
+    let mut interp = Interpreter::new();
+    interp.set_current_dir(&dir_buf);
+    interp.set_current_dir(dir_path);
+    interp.set_current_dir(&dir_string);
+    interp.set_current_dir(dir_str);
+    interp.set_current_dir(dir_buf);
+    interp.set_current_dir(dir_string);
+}
+
+/// Set the current file name for stack frames
+pub fn set_stack_file(file: &str) {
+    let mut f = CURRENT_STACK_FILE
+        .lock()
+        .unwrap_or_else(std::sync::PoisonError::into_inner);
+    *f = file.to_string();
+}
+
+/// Print the current stack trace to stderr
+#[cfg_attr(coverage, allow(dead_code))]
+pub fn print_stack_trace() {
+    let stack = get_stack_trace();
+    if stack.is_empty() {
+        eprintln!("  (no stack trace available)");
+        return;
+    }
+    eprintln!("\n🏴󠁧󠁢󠁳󠁣󠁴󠁿 Stack trace (most recent call last):");
+    for frame in stack.iter().rev() {
+        eprintln!("{}", frame);
+    }
+}
+
+/// Enable or disable crash handling
+pub fn set_crash_handling(enabled: bool) {
+    CRASH_HANDLING_ENABLED.store(enabled, Ordering::Relaxed);
+}
+
+/// Check if crash handling is enabled
+#[cfg_attr(coverage, allow(dead_code))]
+pub fn is_crash_handling_enabled() -> bool {
+    CRASH_HANDLING_ENABLED.load(Ordering::Relaxed)
+}
+
+/// Get the global log level
+pub fn get_global_log_level() -> LogLevel {
+    logging::get_global_log_level()
+}
+
+/// Set the global log level
+pub fn set_global_log_level(level: LogLevel) {
+    logging::set_global_log_level(level);
+}
+
+/// Test/coverage-only escape hatch to set an invalid global log level value.
+/// This exists purely to exercise the fallback branch in `get_global_log_level`.
+#[cfg(coverage)]
+#[allow(dead_code)]
+pub fn set_global_log_level_raw(level: u8) {
+    logging::set_global_log_level_raw(level);
+}
+
+fn parse_log_level_value(value: &Value) -> Result<LogLevel, String> {
+    match value {
+        Value::String(s) => {
+            LogLevel::parse_level(s).ok_or_else(|| format!("Invalid log level '{}'", s))
+        }
+        Value::Integer(n) => match n {
+            0 => Ok(LogLevel::Wheesht),
+            1 => Ok(LogLevel::Roar),
+            2 => Ok(LogLevel::Holler),
+            3 => Ok(LogLevel::Blether),
+            4 => Ok(LogLevel::Mutter),
+            5 => Ok(LogLevel::Whisper),
+            _ => Err(format!("Invalid log level {}. Use 0-5", n)),
+        },
+        _ => Err("Log level must be a string or integer".to_string()),
+    }
+}
+
+fn parse_log_target_value(value: &Value) -> Result<String, String> {
+    match value {
+        Value::String(s) => Ok(s.to_string()),
+        _ => Err("Log target must be a string".to_string()),
+    }
+}
+
+fn resolve_log_args(args: &[Value]) -> Result<(Option<Value>, Option<String>), String> {
+    match args.len() {
+        0 => Ok((None, None)),
+        1 => match &args[0] {
+            v @ Value::Dict(_) => Ok((Some(v.clone()), None)),
+            Value::String(s) => Ok((None, Some(s.to_string()))),
+            _ => Err("Expected dict or string for log fields/target".to_string()),
+        },
+        2 => {
+            let fields = match &args[0] {
+                v @ Value::Dict(_) => Some(v.clone()),
+                _ => return Err("Expected dict for log fields".to_string()),
+            };
+            let target = parse_log_target_value(&args[1])?;
+            Ok((fields, Some(target)))
+        }
+        _ => Err("Expected at most two extra arguments".to_string()),
+    }
+}
+
+fn dict_get(dict: &DictValue, key: &str) -> Option<Value> {
+    dict.get(&Value::String(key.into())).cloned()
+}
+
+/// Control flow signals
+#[derive(Debug)]
+enum ControlFlow {
+    Return(Value),
+    Break,
+    Continue,
+}
+
+/// Trace mode fer debugging - shows step-by-step execution
+#[derive(Debug, Clone, Copy, PartialEq, Default)]
+pub enum TraceMode {
+    /// Nae tracing at aw
+    #[default]
+    Off,
+    /// Show statement execution only
+    Statements,
+    /// Show everything (statements, expressions, values)
+    Verbose,
+}
+
+/// How function bodies get run
+#[derive(Debug, Clone, Copy, PartialEq, Default)]
+pub enum ExecMode {
+    /// Walk the AST
+    #[default]
+    Tree,
+    /// Compile each function body to bytecode on its first call and run that, walking
+    /// only the bodies the compiler can't handle
+    Bytecode,
+}
+
+/// The interpreter - runs mdhavers programs
+pub struct Interpreter {
+    pub globals: Rc<RefCell<Environment>>,
+    environment: Rc<RefCell<Environment>>,
+    output: Vec<String>,
+    /// Cache of module exports keyed by canonical module path
+    module_cache: HashMap<PathBuf, HashMap<String, Value>>,
+    /// Stack of modules currently being loaded (for circular import detection)
+    module_in_progress: Vec<PathBuf>,
+    /// Current working directory fer resolving relative imports
+    current_dir: PathBuf,
+    /// Whether the prelude has been loaded
+    prelude_loaded: bool,
+    /// Trace mode fer debugging
+    trace_mode: TraceMode,
+    /// Current trace indentation level
+    trace_depth: usize,
+    /// Whether function bodies run as bytecode
+    exec_mode: ExecMode,
+    /// Logger configuration and sinks
+    logger: logging::LoggerCore,
+    /// Optional callback hook for log events
+    log_callback: Option<Value>,
+    /// Current source file name for log messages
+    current_file: String,
+}
+
+impl Interpreter {
+    pub fn new() -> Self {
+        let globals = Rc::new(RefCell::new(Environment::new()));
+
+        // Define native functions
+        Self::define_natives(&globals);
+
+        // Register audio functions (if feature enabled)
+        crate::audio::register_audio_functions(&globals);
+
+        // Register graphics functions (if feature enabled)
+        crate::graphics::register_graphics_functions(&globals);
+
+        // Check fer MDH_LOG or MDH_LOG_LEVEL environment variables
+        #[cfg(not(target_arch = "wasm32"))]
+        {
+            if let Ok(spec) = std::env::var("MDH_LOG") {
+                if let Ok(filter) = logging::parse_filter(&spec) {
+                    let _ = logging::set_filter(&spec);
+                    set_global_log_level(filter.default);
+                } else {
+                    eprintln!("Warning: Invalid MDH_LOG filter '{}'", spec);
+                }
+            } else if let Ok(level_str) = std::env::var("MDH_LOG_LEVEL") {
+                if let Some(level) = LogLevel::parse_level(&level_str) {
+                    set_global_log_level(level);
+                }
+            }
+        }
+
+        let current_dir = {
+            #[cfg(not(target_arch = "wasm32"))]
+            {
+                std::env::current_dir().unwrap_or_else(|_| PathBuf::from("."))
+            }
+
+            #[cfg(target_arch = "wasm32")]
+            {
+                PathBuf::from(".")
+            }
+        };
+
+        Interpreter {
+            globals: globals.clone(),
+            environment: globals,
+            output: Vec::new(),
+            module_cache: HashMap::new(),
+            module_in_progress: Vec::new(),
+            current_dir,
+            prelude_loaded: false,
+            trace_mode: TraceMode::Off,
+            trace_depth: 0,
+            exec_mode: ExecMode::Tree,
+            logger: logging::LoggerCore::new(),
+            log_callback: None,
+            current_file: "<repl>".to_string(),
+        }
+    }
+
+    /// Set the current source file name (fer log messages)
+    pub fn set_current_file(&mut self, file: &str) {
+        self.current_file = file.to_string();
+        // Also update the global stack file for crash reporting
+        set_stack_file(file);
+    }
+
+    /// Set the log level
+    #[allow(dead_code)]
+    pub fn set_log_level(&mut self, level: LogLevel) {
+        set_global_log_level(level);
+    }
+
+    /// Get current log level
+    #[allow(dead_code)]
+    pub fn get_log_level(&self) -> LogLevel {
+        get_global_log_level()
+    }
+
+    /// Check if a log level should be output for a given target
+    fn should_log(&self, level: LogLevel, target: &str) -> bool {
+        logging::log_enabled(level, target)
+    }
+
+    fn emit_log(
+        &mut self,
+        level: LogLevel,
+        message: Value,
+        fields: Option<Value>,
+        target: Option<String>,
+        line: usize,
+    ) -> HaversResult<()> {
+        let target = target.unwrap_or_else(|| self.current_file.clone());
+        if !self.should_log(level, &target) {
+            return Ok(());
+        }
+
+        let mut field_vec = Vec::new();
+        if let Some(fields_val) = fields {
+            field_vec = logging::fields_from_dict(&fields_val)
+                .map_err(|msg| HaversError::TypeError { message: msg, line })?;
+        }
+
+        let record = logging::LogRecord {
+            level,
+            message: format!("{}", message),
+            target: target.clone(),
+            file: self.current_file.clone(),
+            line,
+            fields: field_vec,
+            span_path: logging::span_path(),
+        };
+
+        self.logger.log(&record);
+
+        if let Some(callback) = self.log_callback.clone() {
+            let payload = logging::record_to_value(&record, Some(logging::timestamp_string()));
+            let _ = self.call_value(callback, vec![payload], line);
+        }
+
+        Ok(())
+    }
+
+    fn parse_log_extras(
+        &mut self,
+        extras: &[Expr],
+        line: usize,
+    ) -> HaversResult<(Option<Value>, Option<String>)> {
+        if extras.is_empty() {
+            return Ok((None, None));
+        }
+
+        let mut values = Vec::new();
+        for expr in extras {
+            values.push(self.evaluate(expr)?);
+        }
+
+        match values.len() {
+            1 => match values.remove(0) {
+                v @ Value::Dict(_) => Ok((Some(v), None)),
+                Value::String(s) => Ok((None, Some(s.to_string()))),
+                _ => Err(HaversError::TypeError {
+                    message: "log_* expects a dict or string for the extra argument".to_string(),
+                    line,
+                }),
+            },
+            2 => {
+                let fields_val = values.remove(0);
+                let target_val = values.remove(0);
+                let fields = match fields_val {
+                    v @ Value::Dict(_) => Some(v),
+                    _ => {
+                        return Err(HaversError::TypeError {
+                            message: "log_* expects fields as a dict when passing two extras"
+                                .to_string(),
+                            line,
+                        })
+                    }
+                };
+                let target = match target_val {
+                    Value::String(s) => Some(s.to_string()),
+                    _ => {
+                        return Err(HaversError::TypeError {
+                            message: "log_* expects target as a string".to_string(),
+                            line,
+                        })
+                    }
+                };
+                Ok((fields, target))
+            }
+            _ => Err(HaversError::InternalError(
+                "log_* supports at most two extra arguments".to_string(),
+            )),
+        }
+    }
+
+    fn apply_log_config(&mut self, config: Option<Value>) -> Result<(), String> {
+        let dict = match config {
+            None => {
+                self.logger = logging::LoggerCore::new();
+                self.log_callback = None;
+                return Ok(());
+            }
+            Some(Value::Dict(d)) => d,
+            Some(_) => return Err("log_init() expects a dict".to_string()),
+        };
+
+        let dict_ref = dict.borrow();
+
+        if let Some(level_val) = dict_get(&dict_ref, "level") {
+            let level = parse_log_level_value(&level_val)?;
+            set_global_log_level(level);
+        }
+
+        if let Some(filter_val) = dict_get(&dict_ref, "filter") {
+            let filter_str = match filter_val {
+                Value::String(s) => s,
+                _ => return Err("log_init() filter must be a string".to_string()),
+            };
+            logging::set_filter(&filter_str)?;
+        }
+
+        if let Some(format_val) = dict_get(&dict_ref, "format") {
+            let format_str = match format_val {
+                Value::String(s) => s,
+                _ => return Err("log_init() format must be a string".to_string()),
+            };
+            self.logger.format = match format_str.as_ref() {
+                "text" => logging::LogFormat::Text,
+                "json" => logging::LogFormat::Json,
+                "compact" => logging::LogFormat::Compact,
+                "binary" => logging::LogFormat::Binary,
+                _ => {
+                    return Err(
+                        "log_init() format must be text, json, compact, or binary".to_string()
+                    )
+                }
+            };
+        }
+
+        if let Some(color_val) = dict_get(&dict_ref, "color") {
+            match color_val {
+                Value::Bool(b) => self.logger.color = b,
+                _ => return Err("log_init() color must be a bool".to_string()),
+            }
+        }
+
+        if let Some(ts_val) = dict_get(&dict_ref, "timestamps") {
+            match ts_val {
+                Value::Bool(b) => self.logger.timestamps = b,
+                _ => return Err("log_init() timestamps must be a bool".to_string()),
+            }
+        }
+
+        // Native builds queue records for a writer thread; here the settings are only checked.
+        if let Some(async_val) = dict_get(&dict_ref, "async") {
+            match async_val {
+                Value::Bool(_) => {}
+                Value::Dict(opts) => {
+                    let opts = opts.borrow();
+                    match dict_get(&opts, "capacity") {
+                        Some(Value::Integer(n)) if n > 0 => {}
+                        None => {}
+                        _ => {
+                            return Err(
+                                "log_init() async capacity must be a positive integer".to_string()
+                            )
+                        }
+                    }
+                    match dict_get(&opts, "policy") {
+                        Some(Value::String(p)) if p == "drop".into() || p == "block".into() => {}
+                        None => {}
+                        _ => {
+                            return Err("log_init() async policy must be drop or block".to_string())
+                        }
+                    }
+                }
+                _ => return Err("log_init() async must be a bool or dict".to_string()),
+            }
+        }
+
+        match dict_get(&dict_ref, "profile") {
+            Some(Value::Bool(true)) => logging::profile_begin(1, 100_000),
+            Some(Value::Bool(false)) | None => logging::profile_stop(),
+            Some(Value::Dict(opts)) => {
+                let opts = opts.borrow();
+                let sample = match dict_get(&opts, "sample") {
+                    Some(Value::Integer(n)) if n > 0 => n as u64,
+                    None => 1,
+                    _ => {
+                        return Err(
+                            "log_init() profile sample must be a positive integer".to_string()
+                        )
+                    }
+                };
+                let events = match dict_get(&opts, "events") {
+                    Some(Value::Integer(n)) if n >= 0 => n as usize,
+                    None => 100_000,
+                    _ => return Err("log_init() profile events must be an integer".to_string()),
+                };
+                logging::profile_begin(sample, events);
+            }
+            Some(_) => return Err("log_init() profile must be a bool or dict".to_string()),
+        }
+
+        if let Some(sinks_val) = dict_get(&dict_ref, "sinks") {
+            let list = match sinks_val {
+                Value::List(list) => list.borrow().clone(),
+                _ => return Err("log_init() sinks must be a list".to_string()),
+            };
+            let mut sinks = Vec::new();
+            let mut callback: Option<Value> = None;
+
+            for spec in list {
+                let spec_dict = match spec {
+                    Value::Dict(d) => d,
+                    _ => return Err("log_init() sink specs must be dicts".to_string()),
+                };
+                let spec_ref = spec_dict.borrow();
+                let kind = match dict_get(&spec_ref, "kind") {
+                    Some(Value::String(s)) => s,
+                    _ => return Err("log_init() sink kind must be a string".to_string()),
+                };
+
+                match kind.as_ref() {
+                    "stderr" => sinks.push(logging::LogSink::Stderr),
+                    "stdout" => sinks.push(logging::LogSink::Stdout),
+                    "file" => {
+                        let path = match dict_get(&spec_ref, "path") {
+                            Some(Value::String(s)) => s,
+                            _ => {
+                                return Err("log_init() file sink requires string path".to_string())
+                            }
+                        };
+                        let append = match dict_get(&spec_ref, "append") {
+                            Some(Value::Bool(b)) => b,
+                            None => true,
+                            _ => return Err("log_init() file append must be bool".to_string()),
+                        };
+                        sinks.push(logging::LogSink::File {
+                            path: path.to_string(),
+                            append,
+                            file: None,
+                        });
+                    }
+                    "memory" => {
+                        let max = match dict_get(&spec_ref, "max") {
+                            Some(Value::Integer(n)) if n > 0 => n as usize,
+                            None => 1000,
+                            _ => return Err("log_init() memory max must be integer".to_string()),
+                        };
+                        sinks.push(logging::LogSink::Memory {
+                            entries: Vec::new(),
+                            max,
+                        });
+                    }
+                    "callback" => {
+                        let cb = dict_get(&spec_ref, "fn")
+                            .ok_or_else(|| "log_init() callback sink requires fn".to_string())?;
+                        callback = Some(cb);
+                    }
+                    _ => return Err(format!("Unknown log sink kind '{}'", kind)),
+                }
+            }
+
+            if sinks.is_empty() {
+                sinks.push(logging::LogSink::Stderr);
+            }
+            self.logger.sinks = sinks;
+            self.log_callback = callback;
+        }
+
+        Ok(())
+    }
+
+    /// Enable trace mode fer debugging
+    pub fn set_trace_mode(&mut self, mode: TraceMode) {
+        self.trace_mode = mode;
+    }
+
+    /// Get current trace mode
+    #[allow(dead_code)]
+    pub fn trace_mode(&self) -> TraceMode {
+        self.trace_mode
+    }
+
+    /// Choose how function bodies get run
+    pub fn set_exec_mode(&mut self, mode: ExecMode) {
+        self.exec_mode = mode;
+    }
+
+    /// Get current execution mode
+    pub fn exec_mode(&self) -> ExecMode {
+        self.exec_mode
+    }
+
+    /// Print a trace message with proper indentation and Scottish flair
+    fn trace(&self, msg: &str) {
+        if self.trace_mode != TraceMode::Off {
+            let indent = "  ".repeat(self.trace_depth);
+            eprintln!("\x1b[33m🏴󠁧󠁢󠁳󠁣󠁴󠁿 {}{}\x1b[0m", indent, msg);
+        }
+    }
+
+    /// Print a verbose trace message (only in verbose mode)
+    fn trace_verbose(&self, msg: &str) {
+        if self.trace_mode == TraceMode::Verbose {
+            let indent = "  ".repeat(self.trace_depth);
+            eprintln!("\x1b[36m   {}{}\x1b[0m", indent, msg);
+        }
+    }
+
+    /// Create an interpreter with a specific working directory
+    #[allow(dead_code)]
+    pub fn with_dir<P: AsRef<Path>>(dir: P) -> Self {
+        let mut interp = Self::new();
+        interp.current_dir = dir.as_ref().to_path_buf();
+        interp
+    }
+
+    /// Set the current directory fer module resolution
+    pub fn set_current_dir<P: AsRef<Path>>(&mut self, dir: P) {
+        self.current_dir = dir.as_ref().to_path_buf();
+    }
+
+    /// Get all user-defined variables (fer REPL environment inspection)
+    pub fn get_user_variables(&self) -> Vec<(String, String, String)> {
+        let env = self.environment.borrow();
+        let exports = env.get_exports();
+        let mut vars = Vec::new();
+
+        // Get all variables that aren't native functions
+        for (name, value) in exports.iter() {
+            // Skip native functions
+            if matches!(value, Value::NativeFunction(_)) {
+                continue;
+            }
+            // Skip built-in math constants unless they've been overridden.
+            if let Value::Float(f) = value {
+                if (name == "PI" && *f == std::f64::consts::PI)
+                    || (name == "E" && *f == std::f64::consts::E)
+                    || (name == "TAU" && *f == std::f64::consts::TAU)
+                {
+                    continue;
+                }
+            }
+            // Skip internal builtin placeholders used by the JS compiler.
+            if let Value::String(s) = value {
+                if s.starts_with("__builtin_") && s.ends_with("__") {
+                    continue;
+                }
+            }
+            // Skip prelude functions (they have specific patterns)
+            if matches!(value, Value::Function(_)) {
+                // Include user-defined functions but mark them
+                vars.push((name.clone(), "function".to_string(), format!("{}", value)));
+            } else {
+                vars.push((
+                    name.clone(),
+                    value.type_name().to_string(),
+                    format!("{}", value),
+                ));
+            }
+        }
+
+        // Sort by name for consistent display
+        vars.sort_by(|a, b| a.0.cmp(&b.0));
+        vars
+    }
+
+    /// Load the standard prelude (automatically loaded unless disabled)
+    /// The prelude provides common utility functions written in mdhavers
+    pub fn load_prelude(&mut self) -> HaversResult<()> {
+        if self.prelude_loaded {
+            return Ok(());
+        }
+
+        // Try tae find the prelude in these locations:
+        // 1. stdlib/prelude.braw relative tae the executable
+        // 2. stdlib/prelude.braw relative tae current directory
+        // 3. Embedded prelude as fallback
+
+        let prelude_locations = [
+            // Next tae the executable
+            std::env::current_exe()
+                .ok()
+                .and_then(|p| p.parent().map(|d| d.join("stdlib/prelude.braw"))),
+            // In the current directory
+            Some(PathBuf::from("stdlib/prelude.braw")),
+            // In the project root (fer development)
+            Some(PathBuf::from("../stdlib/prelude.braw")),
+        ];
+
+        for maybe_path in prelude_locations.iter().flatten() {
+            if let Ok(source) = std::fs::read_to_string(maybe_path) {
+                match crate::parse_cache::parse_cached(&source) {
+                    Ok(program) => {
+                        // Execute prelude in globals
+                        for stmt in &program.statements {
+                            self.execute_stmt(stmt)?;
+                        }
+                        self.prelude_loaded = true;
+                        return Ok(());
+                    }
+                    Err(e) => {
+                        // Prelude has syntax error - this is a bug
+                        return Err(HaversError::ParseError {
+                            message: format!("Prelude has errors (this shouldnae happen!): {}", e),
+                            line: 1,
+                        });
+                    }
+                }
+            }
+        }
+
+        // If nae prelude file found, that's okay - just continue without it
+        // The language still works, just without the convenience functions
+        self.prelude_loaded = true;
+        Ok(())
+    }
+
+    /// Check if prelude is loaded
+    #[allow(dead_code)]
+    pub fn has_prelude(&self) -> bool {
+        self.prelude_loaded
+    }
+
+    fn define_natives(globals: &Rc<RefCell<Environment>>) {
+        // get_key - read a single key press (raw input)
+        // Not reliably testable under source-based coverage (non-TTY), so exclude from coverage builds.
+        #[cfg(all(feature = "cli", not(coverage)))]
+        globals.borrow_mut().define(
+            "get_key".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("get_key", 0, |_args| {
+                enable_raw_mode().map_err(|e| format!("Cannae enable raw mode: {}", e))?;
+
+                let result = match read() {
+                    Ok(Event::Key(KeyEvent { code, .. })) => match code {
+                        KeyCode::Char(c) => Ok(Value::String(c.to_string())),
+                        KeyCode::Enter => Ok(Value::String("\n".into())),
+                        KeyCode::Esc => Ok(Value::String("\x1b".into())),
+                        KeyCode::Backspace => Ok(Value::String("\x08".into())),
+                        KeyCode::Left => Ok(Value::String("Left".into())),
+                        KeyCode::Right => Ok(Value::String("Right".into())),
+                        KeyCode::Up => Ok(Value::String("Up".into())),
+                        KeyCode::Down => Ok(Value::String("Down".into())),
+                        _ => Ok(Value::String("".into())),
+                    },
+                    Ok(_) => Ok(Value::String("".into())),
+                    Err(e) => Err(format!("Cannae read key: {}", e)),
+                };
+
+                disable_raw_mode().map_err(|e| format!("Cannae disable raw mode: {}", e))?;
+
+                result
+            }))),
+        );
+        // len - get length of list, string, dict, or set
+        globals.borrow_mut().define(
+            "len".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("len", 1, |args| {
+                match &args[0] {
+                    Value::String(s) => Ok(Value::Integer(s.len() as i64)),
+                    Value::List(l) => Ok(Value::Integer(l.borrow().len() as i64)),
+                    Value::Dict(d) => Ok(Value::Integer(d.borrow().len() as i64)),
+                    Value::Set(s) => Ok(Value::Integer(s.borrow().len() as i64)),
+                    Value::Bytes(b) => Ok(Value::Integer(b.borrow().len() as i64)),
+                    Value::NativeObject(obj) => match obj.length() {
+                        Some(n) => Ok(Value::Integer(n as i64)),
+                        None => Err(format!("len() cannae measure a {}", obj.type_name())),
+                    },
+                    _ => Err("len() expects a string, list, dict, creel, or bytes".to_string()),
+                }
+            }))),
+        );
+
+        // bytes - create a zeroed byte buffer of given size
+        globals.borrow_mut().define(
+            "bytes".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("bytes", 1, |args| {
+                let size = match &args[0] {
+                    Value::Integer(n) => *n,
+                    Value::Float(f) => *f as i64,
+                    _ => return Err("bytes() expects an integer size".to_string()),
+                };
+                let size = if size < 0 { 0 } else { size } as usize;
+                Ok(Value::Bytes(Rc::new(RefCell::new(vec![0u8; size]))))
+            }))),
+        );
+
+        // bytes_from_string - create bytes from string
+        globals.borrow_mut().define(
+            "bytes_from_string".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "bytes_from_string",
+                1,
+                |args| {
+                    let s = match &args[0] {
+                        Value::String(s) => s.clone(),
+                        _ => format!("{}", args[0]).into(),
+                    };
+                    Ok(Value::Bytes(Rc::new(RefCell::new(s.as_bytes().to_vec()))))
+                },
+            ))),
+        );
+
+        // bytes_len - get length of a byte buffer
+        globals.borrow_mut().define(
+            "bytes_len".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("bytes_len", 1, |args| {
+                if let Value::Bytes(b) = &args[0] {
+                    Ok(Value::Integer(b.borrow().len() as i64))
+                } else {
+                    Err("bytes_len() expects bytes".to_string())
+                }
+            }))),
+        );
+
+        // bytes_slice - slice a byte buffer
+        globals.borrow_mut().define(
+            "bytes_slice".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("bytes_slice", 3, |args| {
+                let bytes = match &args[0] {
+                    Value::Bytes(b) => b.borrow(),
+                    _ => return Err("bytes_slice() expects bytes".to_string()),
+                };
+                let start = match &args[1] {
+                    Value::Integer(n) => *n,
+                    _ => return Err("bytes_slice() expects integer start".to_string()),
+                };
+                let end = match &args[2] {
+                    Value::Integer(n) => *n,
+                    _ => return Err("bytes_slice() expects integer end".to_string()),
+                };
+                let len = bytes.len() as i64;
+                let mut s = start;
+                let mut e = end;
+                if s < 0 {
+                    s += len;
+                }
+                if e < 0 {
+                    e += len;
+                }
+                if s < 0 {
+                    s = 0;
+                }
+                if e > len {
+                    e = len;
+                }
+                if e < s {
+                    e = s;
+                }
+                let out = bytes[s as usize..e as usize].to_vec();
+                Ok(Value::Bytes(Rc::new(RefCell::new(out))))
+            }))),
+        );
+
+        // bytes_get - get byte at index
+        globals.borrow_mut().define(
+            "bytes_get".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("bytes_get", 2, |args| {
+                let bytes = match &args[0] {
+                    Value::Bytes(b) => b.borrow(),
+                    _ => return Err("bytes_get() expects bytes".to_string()),
+                };
+                let mut idx = match &args[1] {
+                    Value::Integer(n) => *n,
+                    _ => return Err("bytes_get() expects integer index".to_string()),
+                };
+                let len = bytes.len() as i64;
+                if idx < 0 {
+                    idx += len;
+                }
+                if idx < 0 || idx >= len {
+                    return Err("bytes_get() index oot o' bounds".to_string());
+                }
+                Ok(Value::Integer(bytes[idx as usize] as i64))
+            }))),
+        );
+
+        // bytes_set - set byte at index
+        globals.borrow_mut().define(
+            "bytes_set".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("bytes_set", 3, |args| {
+                let bytes = match &args[0] {
+                    Value::Bytes(b) => b.clone(),
+                    _ => return Err("bytes_set() expects bytes".to_string()),
+                };
+                let mut idx = match &args[1] {
+                    Value::Integer(n) => *n,
+                    _ => return Err("bytes_set() expects integer index".to_string()),
+                };
+                let v = match &args[2] {
+                    Value::Integer(n) => *n,
+                    Value::Float(f) => *f as i64,
+                    _ => return Err("bytes_set() expects integer value".to_string()),
+                };
+                if v < 0 || v > 255 {
+                    return Err("bytes_set() value must be between 0 and 255".to_string());
+                }
+                {
+                    let mut buf = bytes.borrow_mut();
+                    let len = buf.len() as i64;
+                    if idx < 0 {
+                        idx += len;
+                    }
+                    if idx < 0 || idx >= len {
+                        return Err("bytes_set() index oot o' bounds".to_string());
+                    }
+                    buf[idx as usize] = v as u8;
+                }
+                Ok(Value::Bytes(bytes))
+            }))),
+        );
+
+        // bytes_append - append bytes to bytes
+        globals.borrow_mut().define(
+            "bytes_append".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("bytes_append", 2, |args| {
+                let bytes = match &args[0] {
+                    Value::Bytes(b) => b.clone(),
+                    _ => return Err("bytes_append() expects bytes".to_string()),
+                };
+                let other = match &args[1] {
+                    Value::Bytes(b) => b.borrow(),
+                    _ => return Err("bytes_append() expects bytes".to_string()),
+                };
+                bytes.borrow_mut().extend_from_slice(&other);
+                Ok(Value::Bytes(bytes))
+            }))),
+        );
+
+        // bytes_read_u16be
+        globals.borrow_mut().define(
+            "bytes_read_u16be".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "bytes_read_u16be",
+                2,
+                |args| {
+                    let bytes = match &args[0] {
+                        Value::Bytes(b) => b.borrow(),
+                        _ => return Err("bytes_read_u16be() expects bytes".to_string()),
+                    };
+                    let off = match &args[1] {
+                        Value::Integer(n) => *n,
+                        _ => return Err("bytes_read_u16be() expects integer offset".to_string()),
+                    };
+                    if off < 0 || (off as usize + 2) > bytes.len() {
+                        return Err("bytes_read_u16be() out o' bounds".to_string());
+                    }
+                    let v = ((bytes[off as usize] as u16) << 8) | (bytes[off as usize + 1] as u16);
+                    Ok(Value::Integer(v as i64))
+                },
+            ))),
+        );
+
+        // bytes_read_u32be
+        globals.borrow_mut().define(
+            "bytes_read_u32be".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "bytes_read_u32be",
+                2,
+                |args| {
+                    let bytes = match &args[0] {
+                        Value::Bytes(b) => b.borrow(),
+                        _ => return Err("bytes_read_u32be() expects bytes".to_string()),
+                    };
+                    let off = match &args[1] {
+                        Value::Integer(n) => *n,
+                        _ => return Err("bytes_read_u32be() expects integer offset".to_string()),
+                    };
+                    if off < 0 || (off as usize + 4) > bytes.len() {
+                        return Err("bytes_read_u32be() out o' bounds".to_string());
+                    }
+                    let v = ((bytes[off as usize] as u32) << 24)
+                        | ((bytes[off as usize + 1] as u32) << 16)
+                        | ((bytes[off as usize + 2] as u32) << 8)
+                        | (bytes[off as usize + 3] as u32);
+                    Ok(Value::Integer(v as i64))
+                },
+            ))),
+        );
+
+        // bytes_write_u16be
+        globals.borrow_mut().define(
+            "bytes_write_u16be".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "bytes_write_u16be",
+                3,
+                |args| {
+                    let bytes = match &args[0] {
+                        Value::Bytes(b) => b.clone(),
+                        _ => return Err("bytes_write_u16be() expects bytes".to_string()),
+                    };
+                    let off = match &args[1] {
+                        Value::Integer(n) => *n,
+                        _ => return Err("bytes_write_u16be() expects integer offset".to_string()),
+                    };
+                    let v = match &args[2] {
+                        Value::Integer(n) => *n,
+                        Value::Float(f) => *f as i64,
+                        _ => return Err("bytes_write_u16be() expects integer value".to_string()),
+                    };
+                    if v < 0 || v > 0xFFFF {
+                        return Err("bytes_write_u16be() value out o' range".to_string());
+                    }
+                    {
+                        let mut buf = bytes.borrow_mut();
+                        if off < 0 || (off as usize + 2) > buf.len() {
+                            return Err("bytes_write_u16be() out o' bounds".to_string());
+                        }
+                        buf[off as usize] = ((v >> 8) & 0xFF) as u8;
+                        buf[off as usize + 1] = (v & 0xFF) as u8;
+                    }
+                    Ok(Value::Bytes(bytes))
+                },
+            ))),
+        );
+
+        // bytes_write_u32be
+        globals.borrow_mut().define(
+            "bytes_write_u32be".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "bytes_write_u32be",
+                3,
+                |args| {
+                    let bytes = match &args[0] {
+                        Value::Bytes(b) => b.clone(),
+                        _ => return Err("bytes_write_u32be() expects bytes".to_string()),
+                    };
+                    let off = match &args[1] {
+                        Value::Integer(n) => *n,
+                        _ => return Err("bytes_write_u32be() expects integer offset".to_string()),
+                    };
+                    let v = match &args[2] {
+                        Value::Integer(n) => *n,
+                        Value::Float(f) => *f as i64,
+                        _ => return Err("bytes_write_u32be() expects integer value".to_string()),
+                    };
+                    if v < 0 || v > 0xFFFF_FFFF {
+                        return Err("bytes_write_u32be() value out o' range".to_string());
+                    }
+                    {
+                        let mut buf = bytes.borrow_mut();
+                        if off < 0 || (off as usize + 4) > buf.len() {
+                            return Err("bytes_write_u32be() out o' bounds".to_string());
+                        }
+                        buf[off as usize] = ((v >> 24) & 0xFF) as u8;
+                        buf[off as usize + 1] = ((v >> 16) & 0xFF) as u8;
+                        buf[off as usize + 2] = ((v >> 8) & 0xFF) as u8;
+                        buf[off as usize + 3] = (v & 0xFF) as u8;
+                    }
+                    Ok(Value::Bytes(bytes))
+                },
+            ))),
+        );
+
+        // bytes_read_{u16,u32,u64}{le,be} for the widths the *be builtins above don't cover
+        for (name, width, big_endian) in [
+            ("bytes_read_u64be", 8, true),
+            ("bytes_read_u16le", 2, false),
+            ("bytes_read_u32le", 4, false),
+            ("bytes_read_u64le", 8, false),
+        ] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, 2, move |args| {
+                    let bytes = match &args[0] {
+                        Value::Bytes(b) => b.borrow(),
+                        _ => return Err(format!("{}() expects bytes", name)),
+                    };
+                    let off = match &args[1] {
+                        Value::Integer(n) => *n,
+                        _ => return Err(format!("{}() expects integer offset", name)),
+                    };
+                    if off < 0 || (off as usize + width) > bytes.len() {
+                        return Err(format!("{}() out o' bounds", name));
+                    }
+                    let mut raw = [0u8; 8];
+                    raw[..width].copy_from_slice(&bytes[off as usize..off as usize + width]);
+                    let v = if big_endian {
+                        u64::from_be_bytes(raw) >> (8 * (8 - width))
+                    } else {
+                        u64::from_le_bytes(raw)
+                    };
+                    Ok(Value::Integer(v as i64))
+                }))),
+            );
+        }
+
+        // bytes_write_{u16,u32,u64}{le,be}; 64-bit writes store any integer's bits
+        for (name, width, big_endian) in [
+            ("bytes_write_u64be", 8, true),
+            ("bytes_write_u16le", 2, false),
+            ("bytes_write_u32le", 4, false),
+            ("bytes_write_u64le", 8, false),
+        ] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, 3, move |args| {
+                    let bytes = match &args[0] {
+                        Value::Bytes(b) => b.clone(),
+                        _ => return Err(format!("{}() expects bytes", name)),
+                    };
+                    let off = match &args[1] {
+                        Value::Integer(n) => *n,
+                        _ => return Err(format!("{}() expects integer offset", name)),
+                    };
+                    let v = match &args[2] {
+                        Value::Integer(n) => *n,
+                        Value::Float(f) => *f as i64,
+                        _ => return Err(format!("{}() expects integer value", name)),
+                    };
+                    if width < 8 && (v < 0 || v >= 1i64 << (8 * width)) {
+                        return Err(format!("{}() value out o' range", name));
+                    }
+                    {
+                        let mut buf = bytes.borrow_mut();
+                        if off < 0 || (off as usize + width) > buf.len() {
+                            return Err(format!("{}() out o' bounds", name));
+                        }
+                        let raw = if big_endian {
+                            (v as u64).to_be_bytes()
+                        } else {
+                            (v as u64).to_le_bytes()
+                        };
+                        let src = if big_endian {
+                            &raw[8 - width..]
+                        } else {
+                            &raw[..width]
+                        };
+                        buf[off as usize..off as usize + width].copy_from_slice(src);
+                    }
+                    Ok(Value::Bytes(bytes))
+                }))),
+            );
+        }
+
+        // bytes_find(haystack, needle) -> index of the first match, or -1
+        globals.borrow_mut().define(
+            "bytes_find".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "bytes_find",
+                2,
+                |args| match (&args[0], &args[1]) {
+                    (Value::Bytes(h), Value::Bytes(n)) => {
+                        let (h, n) = (h.borrow(), n.borrow());
+                        if n.is_empty() {
+                            return Ok(Value::Integer(0));
+                        }
+                        let at = h.windows(n.len()).position(|w| w == &n[..]);
+                        Ok(Value::Integer(at.map_or(-1, |i| i as i64)))
+                    }
+                    _ => Err("bytes_find() expects bytes".to_string()),
+                },
+            ))),
+        );
+
+        // bytes_eq(a, b) -> whether two buffers hold the same bytes
+        globals.borrow_mut().define(
+            "bytes_eq".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("bytes_eq", 2, |args| {
+                match (&args[0], &args[1]) {
+                    (Value::Bytes(a), Value::Bytes(b)) => {
+                        Ok(Value::Bool(*a.borrow() == *b.borrow()))
+                    }
+                    _ => Err("bytes_eq() expects bytes".to_string()),
+                }
+            }))),
+        );
+
+        // bytes_xor(data, key) -> data XOR key; key may be longer than data
+        globals.borrow_mut().define(
+            "bytes_xor".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("bytes_xor", 2, |args| {
+                let (data, key) = match (&args[0], &args[1]) {
+                    (Value::Bytes(d), Value::Bytes(k)) => (d.borrow(), k.borrow()),
+                    _ => return Err("bytes_xor() expects bytes".to_string()),
+                };
+                if key.len() < data.len() {
+                    return Err("bytes_xor() key is shorter than the data".to_string());
+                }
+                let out: Vec<u8> = data.iter().zip(key.iter()).map(|(d, k)| d ^ k).collect();
+                Ok(Value::Bytes(Rc::new(RefCell::new(out))))
+            }))),
+        );
+
+        // bytes_fill(b, value, start, end) -> sets b[start..end) to value
+        globals.borrow_mut().define(
+            "bytes_fill".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("bytes_fill", 4, |args| {
+                let bytes = match &args[0] {
+                    Value::Bytes(b) => b.clone(),
+                    _ => return Err("bytes_fill() expects bytes".to_string()),
+                };
+                let (value, start, end) = match (&args[1], &args[2], &args[3]) {
+                    (Value::Integer(v), Value::Integer(s), Value::Integer(e)) => (*v, *s, *e),
+                    _ => {
+                        return Err("bytes_fill() expects integer value, start and end".to_string())
+                    }
+                };
+                if !(0..=255).contains(&value) {
+                    return Err("bytes_fill() value must be between 0 and 255".to_string());
+                }
+                {
+                    let mut buf = bytes.borrow_mut();
+                    let (s, e) = bytes_range(buf.len(), start, end);
+                    buf[s..e].fill(value as u8);
+                }
+                Ok(Value::Bytes(bytes))
+            }))),
+        );
+
+        // bytes_copy_within(b, dst, start, end) -> copies b[start..end) to b[dst..]
+        globals.borrow_mut().define(
+            "bytes_copy_within".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "bytes_copy_within",
+                4,
+                |args| {
+                    let bytes = match &args[0] {
+                        Value::Bytes(b) => b.clone(),
+                        _ => return Err("bytes_copy_within() expects bytes".to_string()),
+                    };
+                    let (dst, start, end) = match (&args[1], &args[2], &args[3]) {
+                        (Value::Integer(d), Value::Integer(s), Value::Integer(e)) => (*d, *s, *e),
+                        _ => return Err("bytes_copy_within() expects integer offsets".to_string()),
+                    };
+                    {
+                        let mut buf = bytes.borrow_mut();
+                        let (s, e) = bytes_range(buf.len(), start, end);
+                        if dst < 0 || dst as usize + (e - s) > buf.len() {
+                            return Err("bytes_copy_within() out o' bounds".to_string());
+                        }
+                        buf.copy_within(s..e, dst as usize);
+                    }
+                    Ok(Value::Bytes(bytes))
+                },
+            ))),
+        );
+
+        // bytes_pool_take(size) -> bytes of that length, reusing a returned buffer
+        globals.borrow_mut().define(
+            "bytes_pool_take".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("bytes_pool_take", 1, |args| {
+                let size = match &args[0] {
+                    Value::Integer(n) => (*n).max(0) as usize,
+                    _ => return Err("bytes_pool_take() expects integer size".to_string()),
+                };
+                let reused = BYTES_POOL.with(|pool| {
+                    let mut pool = pool.borrow_mut();
+                    let found = pool.iter().position(|buf| buf.capacity() >= size);
+                    found.map(|i| pool.swap_remove(i))
+                });
+                let mut buf = reused.unwrap_or_else(|| Vec::with_capacity(size.max(1024)));
+                buf.resize(size, 0);
+                Ok(Value::Bytes(Rc::new(RefCell::new(buf))))
+            }))),
+        );
+
+        // bytes_pool_give(bytes) -> hands the buffer back; the bytes value is left empty
+        globals.borrow_mut().define(
+            "bytes_pool_give".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("bytes_pool_give", 1, |args| {
+                let bytes = match &args[0] {
+                    Value::Bytes(b) => b.clone(),
+                    _ => return Err("bytes_pool_give() expects bytes".to_string()),
+                };
+                let buf = std::mem::take(&mut *bytes.borrow_mut());
+                BYTES_POOL.with(|pool| {
+                    let mut pool = pool.borrow_mut();
+                    if buf.capacity() > 0 && pool.len() < BYTES_POOL_DEPTH {
+                        pool.push(buf);
+                    }
+                });
+                Ok(Value::Nil)
+            }))),
+        );
+
+        // rtp_parse_native(packet) -> rtp_header, or {"ok": nae, "error", "len"}
+        globals.borrow_mut().define(
+            "rtp_parse_native".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "rtp_parse_native",
+                1,
+                |args| match &args[0] {
+                    Value::Bytes(b) => Ok(rtp_parse(&b.borrow())),
+                    _ => Err("rtp_parse_native() expects bytes".to_string()),
+                },
+            ))),
+        );
+
+        // rtp_build_native(payload, seq, timestamp, ssrc, payload_type, marker, csrcs) -> bytes
+        globals.borrow_mut().define(
+            "rtp_build_native".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "rtp_build_native",
+                7,
+                |args| rtp_build(&args),
+            ))),
+        );
+
+        // sip_parse_native(msg) -> sip_message, or {"type": "invalid", "raw"}
+        globals.borrow_mut().define(
+            "sip_parse_native".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "sip_parse_native",
+                1,
+                |args| match &args[0] {
+                    Value::String(s) => Ok(sip_parse(SipSource::Str(s.clone()), false)),
+                    Value::Bytes(b) => Ok(sip_parse(SipSource::Bytes(b.borrow().clone()), false)),
+                    _ => Err("sip_parse_native() expects a string or bytes".to_string()),
+                },
+            ))),
+        );
+
+        // http_parse_native(buf) -> http_message, or {"type": "invalid", "raw"}
+        globals.borrow_mut().define(
+            "http_parse_native".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "http_parse_native",
+                1,
+                |args| match &args[0] {
+                    Value::String(s) => Ok(sip_parse(SipSource::Str(s.clone()), true)),
+                    Value::Bytes(b) => Ok(sip_parse(SipSource::Bytes(b.borrow().clone()), true)),
+                    _ => Err("http_parse_native() expects a string or bytes".to_string()),
+                },
+            ))),
+        );
+
+        // base64_encode_native(data) / hex_encode_native(data) -> string
+        for (name, encode) in [
+            ("base64_encode_native", base64_encode as fn(&[u8]) -> String),
+            ("hex_encode_native", hex_encode),
+        ] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, 1, move |args| {
+                    with_codec_input(name, &args[0], |data| Value::String(encode(data).into()))
+                }))),
+            );
+        }
+
+        // base64_decode_native(text, as_string) / hex_decode_native(text, as_string)
+        for (name, decode) in [
+            (
+                "base64_decode_native",
+                base64_decode as fn(&[u8]) -> Vec<u8>,
+            ),
+            ("hex_decode_native", hex_decode),
+        ] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, 2, move |args| {
+                    with_codec_input(name, &args[0], |text| codec_output(decode(text), &args[1]))
+                }))),
+            );
+        }
+
+        // sha256(data) / sha1(data) -> the digest as bytes
+        for (name, digest) in [("sha256", sha256 as fn(&[u8]) -> Vec<u8>), ("sha1", sha1)] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, 1, move |args| {
+                    with_codec_input(name, &args[0], |data| {
+                        Value::Bytes(Rc::new(RefCell::new(digest(data))))
+                    })
+                }))),
+            );
+        }
+
+        // crc32(data) -> a non-negative integer; xxhash64(data) -> all 64 bits, signed
+        globals.borrow_mut().define(
+            "crc32".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("crc32", 1, |args| {
+                with_codec_input("crc32", &args[0], |data| Value::Integer(crc32(data) as i64))
+            }))),
+        );
+        globals.borrow_mut().define(
+            "xxhash64".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("xxhash64", 1, |args| {
+                with_codec_input("xxhash64", &args[0], |data| {
+                    Value::Integer(xxhash64(data) as i64)
+                })
+            }))),
+        );
+
+        // http_serve(loop, listener, handler): the keep-alive server is the native runtime's
+        globals.borrow_mut().define(
+            "http_serve".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("http_serve", 3, |_args| {
+                Err("http_serve() needs a native build".to_string())
+            }))),
+        );
+
+        // http_request(req), http_pool_config(opts), http_pool_stats(): the pooled client
+        // is the native runtime's as well
+        for (name, arity) in [
+            ("http_request", 1),
+            ("http_pool_config", 1),
+            ("http_pool_stats", 0),
+        ] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, arity, move |_args| {
+                    Err(format!("{}() needs a native build", name))
+                }))),
+            );
+        }
+
+        // sip_header(msg_or_headers, name) -> the header's value, or nil
+        globals.borrow_mut().define(
+            "sip_header".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("sip_header", 2, |args| {
+                let parsed = match &args[0] {
+                    Value::NativeObject(obj) => {
+                        let any = obj.as_any();
+                        any.downcast_ref::<SipMessage>()
+                            .map(|m| &m.0)
+                            .or_else(|| any.downcast_ref::<SipHeaders>().map(|h| &h.0))
+                            .cloned()
+                    }
+                    _ => None,
+                };
+                match (parsed, &args[1]) {
+                    (Some(m), Value::String(name)) => Ok(m.header(name)),
+                    _ => Err("sip_header() expects a sip_message and a name".to_string()),
+                }
+            }))),
+        );
+
+        #[cfg(all(feature = "native", unix))]
+        {
+            // socket_udp - create UDP socket
+            globals.borrow_mut().define(
+                "socket_udp".to_string(),
+		                Value::NativeFunction(Rc::new(NativeFunction::new("socket_udp", 0, |_args| {
+		                    let fd = unsafe { libc::socket(libc::AF_INET, libc::SOCK_DGRAM, 0) };
+		                    if fd < 0 { let err = std::io::Error::last_os_error(); return Ok(result_err(err.to_string(), err.raw_os_error().unwrap_or(-1) as i64)); }
+		                    let id = register_socket(fd, SocketKind::Udp);
+		                    Ok(result_ok(Value::Integer(id)))
+		                }))),
+		            );
+
+            // socket_tcp - create TCP socket
+            globals.borrow_mut().define(
+                "socket_tcp".to_string(),
+		                Value::NativeFunction(Rc::new(NativeFunction::new("socket_tcp", 0, |_args| {
+		                    let fd = unsafe { libc::socket(libc::AF_INET, libc::SOCK_STREAM, 0) };
+		                    if fd < 0 { let err = std::io::Error::last_os_error(); return Ok(result_err(err.to_string(), err.raw_os_error().unwrap_or(-1) as i64)); }
+		                    let id = register_socket(fd, SocketKind::Tcp);
+		                    Ok(result_ok(Value::Integer(id)))
+		                }))),
+		            );
+
+            // socket_bind(sock, host, port)
+            globals.borrow_mut().define(
+                "socket_bind".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("socket_bind", 3, |args| {
+                    let sock_id = args[0]
+                        .as_integer()
+                        .ok_or("socket_bind() expects socket id")?;
+                    let host = match &args[1] {
+                        Value::Nil => None,
+                        Value::String(s) if s.is_empty() => None,
+                        Value::String(s) => Some(s.as_ref()),
+                        _ => return Err("socket_bind() expects host string or nil".to_string()),
+                    };
+                    let port = args[2]
+                        .as_integer()
+                        .ok_or("socket_bind() expects port integer")?;
+                    if port < 0 || port > 65535 {
+                        return Err("socket_bind() port must be 0..65535".to_string());
+                    }
+
+                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                    let addr = resolve_ipv4_addr(host, port as u16)
+                        .map_err(|e| format!("socket_bind() {}", e))?;
+                    let rc = unsafe {
+                        libc::bind(
+                            entry.fd,
+                            &addr as *const _ as *const libc::sockaddr,
+                            std::mem::size_of::<libc::sockaddr_in>() as libc::socklen_t,
+                        )
+                    };
+                    if rc != 0 {
+                        let err = std::io::Error::last_os_error();
+                        let code = err.raw_os_error().unwrap_or(-1) as i64;
+                        return Ok(result_err(err.to_string(), code));
+                    }
+                    Ok(result_ok(Value::Nil))
+                }))),
+            );
+
+            // socket_connect(sock, host, port) or socket_connect(sock, addr)
+            globals.borrow_mut().define(
+                "socket_connect".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(
+                    "socket_connect",
+                    usize::MAX,
+                    |args| {
+                        if args.len() != 2 && args.len() != 3 {
+                            return Err("socket_connect() expects 2 or 3 arguments".to_string());
+                        }
+                        let sock_id = args[0]
+                            .as_integer()
+                            .ok_or("socket_connect() expects socket id")?;
+                        let addr = peer_sockaddr("socket_connect", &args[1..])?;
+
+                        let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                        let rc = unsafe {
+                            libc::connect(
+                                entry.fd,
+                                &addr as *const _ as *const libc::sockaddr,
+                                std::mem::size_of::<libc::sockaddr_in>() as libc::socklen_t,
+                            )
+                        };
+                        if rc != 0 {
+                            let err = std::io::Error::last_os_error();
+                            let code = err.raw_os_error().unwrap_or(-1) as i64;
+                            return Ok(result_err(err.to_string(), code));
+                        }
+                        Ok(result_ok(Value::Nil))
+                    },
+                ))),
+            );
+
+            // socket_listen(sock, backlog)
+            globals.borrow_mut().define(
+                "socket_listen".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("socket_listen", 2, |args| {
+                    let sock_id = args[0]
+                        .as_integer()
+                        .ok_or("socket_listen() expects socket id")?;
+                    let backlog = args[1]
+                        .as_integer()
+                        .ok_or("socket_listen() expects backlog integer")?;
+                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                    let rc = unsafe { libc::listen(entry.fd, backlog as i32) };
+                    if rc != 0 {
+                        let err = std::io::Error::last_os_error();
+                        let code = err.raw_os_error().unwrap_or(-1) as i64;
+                        return Ok(result_err(err.to_string(), code));
+                    }
+                    let _ = update_socket_kind(sock_id, SocketKind::Tcp);
+                    Ok(result_ok(Value::Nil))
+                }))),
+            );
+
+            // socket_accept(sock)
+            globals.borrow_mut().define(
+                "socket_accept".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("socket_accept", 1, |args| {
+                    let sock_id = args[0]
+                        .as_integer()
+                        .ok_or("socket_accept() expects socket id")?;
+                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                    let mut addr: libc::sockaddr_in = unsafe { std::mem::zeroed() };
+                    let mut addr_len = std::mem::size_of::<libc::sockaddr_in>() as libc::socklen_t;
+                    let new_fd = unsafe {
+                        libc::accept(
+                            entry.fd,
+                            &mut addr as *mut _ as *mut libc::sockaddr,
+                            &mut addr_len,
+                        )
+                    };
+                    if new_fd < 0 {
+                        let err = std::io::Error::last_os_error();
+                        let code = err.raw_os_error().unwrap_or(-1) as i64;
+                        return Ok(result_err(err.to_string(), code));
+                    }
+                    let new_id = register_socket(new_fd, SocketKind::Tcp);
+                    let mut info = DictValue::new();
+                    info.set(Value::String("sock".into()), Value::Integer(new_id));
+                    let (host, port) = sockaddr_to_host_port(&addr);
+                    info.set(Value::String("addr".into()), addr_dict(host, port));
+                    Ok(result_ok(Value::Dict(Rc::new(RefCell::new(info)))))
+                }))),
+            );
+
+            // socket_set_nonblocking(sock, on)
+            globals.borrow_mut().define(
+                "socket_set_nonblocking".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(
+                    "socket_set_nonblocking",
+                    2,
+                    |args| {
+                        let sock_id = args[0]
+                            .as_integer()
+                            .ok_or("socket_set_nonblocking() expects socket id")?;
+                        let enable = args[1].is_truthy();
+                        let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                        let flags = unsafe { libc::fcntl(entry.fd, libc::F_GETFL) };
+                        if flags < 0 {
+                            let err = std::io::Error::last_os_error();
+                            let code = err.raw_os_error().unwrap_or(-1) as i64;
+                            return Ok(result_err(err.to_string(), code));
+                        }
+                        let new_flags = if enable {
+                            flags | libc::O_NONBLOCK
+                        } else {
+                            flags & !libc::O_NONBLOCK
+                        };
+
+                        let rc = {
+                            #[cfg(coverage)]
+                            {
+                                if std::env::var_os("MDH_COVERAGE_FORCE_FCNTL_SETFL_FAIL").is_some()
+                                {
+                                    #[cfg(target_os = "linux")]
+                                    unsafe {
+                                        *libc::__errno_location() = libc::EBADF;
+                                    }
+                                    -1
+                                } else {
+                                    unsafe { libc::fcntl(entry.fd, libc::F_SETFL, new_flags) }
+                                }
+                            }
+                            #[cfg(not(coverage))]
+                            {
+                                unsafe { libc::fcntl(entry.fd, libc::F_SETFL, new_flags) }
+                            }
+                        };
+
+                        if rc != 0 {
+                            let err = std::io::Error::last_os_error();
+                            let code = err.raw_os_error().unwrap_or(-1) as i64;
+                            return Ok(result_err(err.to_string(), code));
+                        }
+                        Ok(result_ok(Value::Nil))
+                    },
+                ))),
+            );
+
+            // socket_set_reuseaddr(sock, on)
+            globals.borrow_mut().define(
+                "socket_set_reuseaddr".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(
+                    "socket_set_reuseaddr",
+                    2,
+                    |args| {
+                        let sock_id = args[0]
+                            .as_integer()
+                            .ok_or("socket_set_reuseaddr() expects socket id")?;
+                        let enable = args[1].is_truthy();
+                        let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                        let optval: libc::c_int = if enable { 1 } else { 0 };
+                        let rc = unsafe {
+                            libc::setsockopt(
+                                entry.fd,
+                                libc::SOL_SOCKET,
+                                libc::SO_REUSEADDR,
+                                &optval as *const _ as *const libc::c_void,
+                                std::mem::size_of_val(&optval) as libc::socklen_t,
+                            )
+                        };
+                        if rc != 0 {
+                            let err = std::io::Error::last_os_error();
+                            let code = err.raw_os_error().unwrap_or(-1) as i64;
+                            return Ok(result_err(err.to_string(), code));
+                        }
+                        Ok(result_ok(Value::Nil))
+                    },
+                ))),
+            );
+
+            // socket_set_reuseport(sock, on)
+            globals.borrow_mut().define(
+                "socket_set_reuseport".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(
+                    "socket_set_reuseport",
+                    2,
+                    |args| {
+                        let sock_id = args[0]
+                            .as_integer()
+                            .ok_or("socket_set_reuseport() expects socket id")?;
+                        let enable = args[1].is_truthy();
+                        let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                        let optval: libc::c_int = if enable { 1 } else { 0 };
+                        let rc = unsafe {
+                            libc::setsockopt(
+                                entry.fd,
+                                libc::SOL_SOCKET,
+                                libc::SO_REUSEPORT,
+                                &optval as *const _ as *const libc::c_void,
+                                std::mem::size_of_val(&optval) as libc::socklen_t,
+                            )
+                        };
+                        if rc != 0 {
+                            let err = std::io::Error::last_os_error();
+                            let code = err.raw_os_error().unwrap_or(-1) as i64;
+                            return Ok(result_err(err.to_string(), code));
+                        }
+                        Ok(result_ok(Value::Nil))
+                    },
+                ))),
+            );
+
+            // socket_set_ttl(sock, ttl)
+            globals.borrow_mut().define(
+                "socket_set_ttl".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("socket_set_ttl", 2, |args| {
+                    let sock_id = args[0]
+                        .as_integer()
+                        .ok_or("socket_set_ttl() expects socket id")?;
+                    let ttl = args[1]
+                        .as_integer()
+                        .ok_or("socket_set_ttl() expects ttl integer")?;
+                    if ttl < 0 || ttl > 255 {
+                        return Err("socket_set_ttl() ttl must be 0..255".to_string());
+                    }
+                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                    let optval: libc::c_int = ttl as libc::c_int;
+                    let rc = unsafe {
+                        libc::setsockopt(
+                            entry.fd,
+                            libc::IPPROTO_IP,
+                            libc::IP_TTL,
+                            &optval as *const _ as *const libc::c_void,
+                            std::mem::size_of_val(&optval) as libc::socklen_t,
+                        )
+                    };
+                    if rc != 0 {
+                        let err = std::io::Error::last_os_error();
+                        let code = err.raw_os_error().unwrap_or(-1) as i64;
+                        return Ok(result_err(err.to_string(), code));
+                    }
+                    Ok(result_ok(Value::Nil))
+                }))),
+            );
+
+            // socket_set_nodelay(sock, on)
+            globals.borrow_mut().define(
+                "socket_set_nodelay".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(
+                    "socket_set_nodelay",
+                    2,
+                    |args| {
+                        let sock_id = args[0]
+                            .as_integer()
+                            .ok_or("socket_set_nodelay() expects socket id")?;
+                        let enable = args[1].is_truthy();
+                        let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                        let optval: libc::c_int = if enable { 1 } else { 0 };
+                        let rc = unsafe {
+                            libc::setsockopt(
+                                entry.fd,
+                                libc::IPPROTO_TCP,
+                                libc::TCP_NODELAY,
+                                &optval as *const _ as *const libc::c_void,
+                                std::mem::size_of_val(&optval) as libc::socklen_t,
+                            )
+                        };
+                        if rc != 0 {
+                            let err = std::io::Error::last_os_error();
+                            let code = err.raw_os_error().unwrap_or(-1) as i64;
+                            return Ok(result_err(err.to_string(), code));
+                        }
+                        Ok(result_ok(Value::Nil))
+                    },
+                ))),
+            );
+
+            // socket_set_rcvbuf(sock, bytes)
+            globals.borrow_mut().define(
+                "socket_set_rcvbuf".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(
+                    "socket_set_rcvbuf",
+                    2,
+                    |args| {
+                        let sock_id = args[0]
+                            .as_integer()
+                            .ok_or("socket_set_rcvbuf() expects socket id")?;
+                        let size = args[1]
+                            .as_integer()
+                            .ok_or("socket_set_rcvbuf() expects size integer")?;
+                        if size < 0 || size > i32::MAX as i64 {
+                            return Err("socket_set_rcvbuf() size must be >= 0".to_string());
+                        }
+                        let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                        let optval: libc::c_int = size as libc::c_int;
+                        let rc = unsafe {
+                            libc::setsockopt(
+                                entry.fd,
+                                libc::SOL_SOCKET,
+                                libc::SO_RCVBUF,
+                                &optval as *const _ as *const libc::c_void,
+                                std::mem::size_of_val(&optval) as libc::socklen_t,
+                            )
+                        };
+                        if rc != 0 {
+                            let err = std::io::Error::last_os_error();
+                            let code = err.raw_os_error().unwrap_or(-1) as i64;
+                            return Ok(result_err(err.to_string(), code));
+                        }
+                        Ok(result_ok(Value::Nil))
+                    },
+                ))),
+            );
+
+            // socket_set_sndbuf(sock, bytes)
+            globals.borrow_mut().define(
+                "socket_set_sndbuf".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(
+                    "socket_set_sndbuf",
+                    2,
+                    |args| {
+                        let sock_id = args[0]
+                            .as_integer()
+                            .ok_or("socket_set_sndbuf() expects socket id")?;
+                        let size = args[1]
+                            .as_integer()
+                            .ok_or("socket_set_sndbuf() expects size integer")?;
+                        if size < 0 || size > i32::MAX as i64 {
+                            return Err("socket_set_sndbuf() size must be >= 0".to_string());
+                        }
+                        let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                        let optval: libc::c_int = size as libc::c_int;
+                        let rc = unsafe {
+                            libc::setsockopt(
+                                entry.fd,
+                                libc::SOL_SOCKET,
+                                libc::SO_SNDBUF,
+                                &optval as *const _ as *const libc::c_void,
+                                std::mem::size_of_val(&optval) as libc::socklen_t,
+                            )
+                        };
+                        if rc != 0 {
+                            let err = std::io::Error::last_os_error();
+                            let code = err.raw_os_error().unwrap_or(-1) as i64;
+                            return Ok(result_err(err.to_string(), code));
+                        }
+                        Ok(result_ok(Value::Nil))
+                    },
+                ))),
+            );
+
+            // socket_close(sock)
+            globals.borrow_mut().define(
+                "socket_close".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("socket_close", 1, |args| {
+                    let sock_id = args[0]
+                        .as_integer()
+                        .ok_or("socket_close() expects socket id")?;
+                    let entry = remove_socket(sock_id).ok_or("Unknown socket handle")?;
+                    let rc = unsafe { libc::close(entry.fd) };
+                    if rc != 0 {
+                        let err = std::io::Error::last_os_error();
+                        let code = err.raw_os_error().unwrap_or(-1) as i64;
+                        return Ok(result_err(err.to_string(), code));
+                    }
+                    Ok(result_ok(Value::Nil))
+                }))),
+            );
+
+            // udp_send_to(sock, bytes, host, port) or udp_send_to(sock, bytes, addr)
+            globals.borrow_mut().define(
+                "udp_send_to".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(
+                    "udp_send_to",
+                    usize::MAX,
+                    |args| {
+                        if args.len() != 3 && args.len() != 4 {
+                            return Err("udp_send_to() expects 3 or 4 arguments".to_string());
+                        }
+                        let sock_id = args[0]
+                            .as_integer()
+                            .ok_or("udp_send_to() expects socket id")?;
+                        let bytes = match &args[1] {
+                            Value::Bytes(b) => b.borrow(),
+                            _ => return Err("udp_send_to() expects bytes".to_string()),
+                        };
+                        let addr = peer_sockaddr("udp_send_to", &args[2..])?;
+
+                        let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                        let sent = unsafe {
+                            libc::sendto(
+                                entry.fd,
+                                bytes.as_ptr() as *const libc::c_void,
+                                bytes.len(),
+                                0,
+                                &addr as *const _ as *const libc::sockaddr,
+                                std::mem::size_of::<libc::sockaddr_in>() as libc::socklen_t,
+                            )
+                        };
+                        if sent < 0 {
+                            let err = std::io::Error::last_os_error();
+                            let code = err.raw_os_error().unwrap_or(-1) as i64;
+                            return Ok(result_err(err.to_string(), code));
+                        }
+                        Ok(result_ok(Value::Integer(sent as i64)))
+                    },
+                ))),
+            );
+
+            // addr_resolve(host, port) -> address object for udp_send_to / socket_connect
+            globals.borrow_mut().define(
+                "addr_resolve".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("addr_resolve", 2, |args| {
+                    match peer_sockaddr("addr_resolve", &args) {
+                        Ok(addr) => Ok(result_ok(addr_object(&addr))),
+                        Err(e) => Ok(result_err(e, -1)),
+                    }
+                }))),
+            );
+
+            // udp_recv_from(sock, max_len)
+            globals.borrow_mut().define(
+                "udp_recv_from".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("udp_recv_from", 2, |args| {
+                    let sock_id = args[0]
+                        .as_integer()
+                        .ok_or("udp_recv_from() expects socket id")?;
+                    let max_len = args[1]
+                        .as_integer()
+                        .ok_or("udp_recv_from() expects max_len integer")?;
+                    let max_len = if max_len < 0 { 0 } else { max_len } as usize;
+                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+
+                    let mut buf = vec![0u8; max_len];
+                    let mut addr: libc::sockaddr_in = unsafe { std::mem::zeroed() };
+                    let mut addr_len = std::mem::size_of::<libc::sockaddr_in>() as libc::socklen_t;
+                    let n = unsafe {
+                        libc::recvfrom(
+                            entry.fd,
+                            buf.as_mut_ptr() as *mut libc::c_void,
+                            buf.len(),
+                            0,
+                            &mut addr as *mut _ as *mut libc::sockaddr,
+                            &mut addr_len,
+                        )
+                    };
+                    if n < 0 {
+                        let err = std::io::Error::last_os_error();
+                        let code = err.raw_os_error().unwrap_or(-1) as i64;
+                        return Ok(result_err(err.to_string(), code));
+                    }
+                    buf.truncate(n as usize);
+                    let mut info = DictValue::new();
+                    info.set(
+                        Value::String("buf".into()),
+                        Value::Bytes(Rc::new(RefCell::new(buf))),
+                    );
+                    let (host, port) = sockaddr_to_host_port(&addr);
+                    info.set(Value::String("addr".into()), addr_dict(host, port));
+                    Ok(result_ok(Value::Dict(Rc::new(RefCell::new(info)))))
+                }))),
+            );
+
+            // udp_recv_many(sock, max_packets, max_len) -> {"bufs": [...], "addrs": [...]}
+            globals.borrow_mut().define(
+                "udp_recv_many".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("udp_recv_many", 3, |args| {
+                    let sock_id = args[0]
+                        .as_integer()
+                        .ok_or("udp_recv_many() expects socket id")?;
+                    let max_packets = args[1]
+                        .as_integer()
+                        .ok_or("udp_recv_many() expects max_packets integer")?;
+                    let max_len = args[2]
+                        .as_integer()
+                        .ok_or("udp_recv_many() expects max_len integer")?;
+                    let max_len = if max_len < 0 { 0 } else { max_len } as usize;
+                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+
+                    // Block for the first datagram only, then drain what is queued.
+                    let mut bufs = Vec::new();
+                    let mut addrs: Vec<Value> = Vec::new();
+                    let mut last: Option<(u32, u16)> = None;
+                    while (bufs.len() as i64) < max_packets {
+                        let mut buf = vec![0u8; max_len];
+                        let mut addr: libc::sockaddr_in = unsafe { std::mem::zeroed() };
+                        let mut addr_len =
+                            std::mem::size_of::<libc::sockaddr_in>() as libc::socklen_t;
+                        let flags = if bufs.is_empty() {
+                            0
+                        } else {
+                            libc::MSG_DONTWAIT
+                        };
+                        let n = unsafe {
+                            libc::recvfrom(
+                                entry.fd,
+                                buf.as_mut_ptr() as *mut libc::c_void,
+                                buf.len(),
+                                flags,
+                                &mut addr as *mut _ as *mut libc::sockaddr,
+                                &mut addr_len,
+                            )
+                        };
+                        if n < 0 {
+                            if !bufs.is_empty() {
+                                break;
+                            }
+                            let err = std::io::Error::last_os_error();
+                            let code = err.raw_os_error().unwrap_or(-1) as i64;
+                            return Ok(result_err(err.to_string(), code));
+                        }
+                        buf.truncate(n as usize);
+                        bufs.push(Value::Bytes(Rc::new(RefCell::new(buf))));
+                        let peer = (addr.sin_addr.s_addr, addr.sin_port);
+                        // Consecutive datagrams from one peer share an address dict.
+                        if last != Some(peer) {
+                            let (host, port) = sockaddr_to_host_port(&addr);
+                            addrs.push(addr_dict(host, port));
+                            last = Some(peer);
+                        } else {
+                            let prev = addrs[addrs.len() - 1].clone();
+                            addrs.push(prev);
+                        }
+                    }
+                    let mut batch = DictValue::new();
+                    batch.set(
+                        Value::String("bufs".into()),
+                        Value::List(Rc::new(RefCell::new(bufs))),
+                    );
+                    batch.set(
+                        Value::String("addrs".into()),
+                        Value::List(Rc::new(RefCell::new(addrs))),
+                    );
+                    Ok(result_ok(Value::Dict(Rc::new(RefCell::new(batch)))))
+                }))),
+            );
+
+            // udp_send_many(sock, packets): a list of {buf, addr} or a udp_recv_many batch
+            globals.borrow_mut().define(
+                "udp_send_many".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("udp_send_many", 2, |args| {
+                    let sock_id = args[0]
+                        .as_integer()
+                        .ok_or("udp_send_many() expects socket id")?;
+                    let field = |v: &Value, key: &str| match v {
+                        Value::Dict(d) => d
+                            .borrow()
+                            .get(&Value::String(key.to_string().into()))
+                            .cloned(),
+                        _ => None,
+                    };
+                    let batch = (field(&args[1], "bufs"), field(&args[1], "addrs"));
+                    let packets: Vec<(Value, Value)> = match (&args[1], batch) {
+                        (Value::List(items), _) => items
+                            .borrow()
+                            .iter()
+                            .map(|p| {
+                                let buf = field(p, "buf").unwrap_or(Value::Nil);
+                                (buf, field(p, "addr").unwrap_or(Value::Nil))
+                            })
+                            .collect(),
+                        (_, (Some(Value::List(bufs)), Some(Value::List(addrs)))) => {
+                            let (bufs, addrs) = (bufs.borrow(), addrs.borrow());
+                            if bufs.len() != addrs.len() {
+                                return Err(
+                                    "udp_send_many() bufs and addrs differ in length".to_string()
+                                );
+                            }
+                            bufs.iter().cloned().zip(addrs.iter().cloned()).collect()
+                        }
+                        _ => return Err("udp_send_many() expects a list of packets".to_string()),
+                    };
+
+                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                    let mut sent = 0i64;
+                    for (buf, addr) in packets {
+                        let bytes = match &buf {
+                            Value::Bytes(b) => b.borrow(),
+                            _ => return Err("udp_send_many() expects bytes".to_string()),
+                        };
+                        let to = peer_sockaddr("udp_send_many", &[addr])?;
+                        let n = unsafe {
+                            libc::sendto(
+                                entry.fd,
+                                bytes.as_ptr() as *const libc::c_void,
+                                bytes.len(),
+                                0,
+                                &to as *const _ as *const libc::sockaddr,
+                                std::mem::size_of::<libc::sockaddr_in>() as libc::socklen_t,
+                            )
+                        };
+                        if n < 0 {
+                            let err = std::io::Error::last_os_error();
+                            if sent > 0 && err.kind() == std::io::ErrorKind::WouldBlock {
+                                break;
+                            }
+                            let code = err.raw_os_error().unwrap_or(-1) as i64;
+                            return Ok(result_err(err.to_string(), code));
+                        }
+                        sent += 1;
+                    }
+                    Ok(result_ok(Value::Integer(sent)))
+                }))),
+            );
+
+            // tcp_send(sock, bytes)
+            globals.borrow_mut().define(
+                "tcp_send".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("tcp_send", 2, |args| {
+                    let sock_id = args[0].as_integer().ok_or("tcp_send() expects socket id")?;
+                    let bytes = match &args[1] {
+                        Value::Bytes(b) => b.borrow(),
+                        _ => return Err("tcp_send() expects bytes".to_string()),
+                    };
+                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                    let sent = unsafe {
+                        libc::send(
+                            entry.fd,
+                            bytes.as_ptr() as *const libc::c_void,
+                            bytes.len(),
+                            0,
+                        )
+                    };
+                    if sent < 0 {
+                        let err = std::io::Error::last_os_error();
+                        let code = err.raw_os_error().unwrap_or(-1) as i64;
+                        return Ok(result_err(err.to_string(), code));
+                    }
+                    Ok(result_ok(Value::Integer(sent as i64)))
+                }))),
+            );
+
+            // tcp_send_vec(sock, parts) -> one send of a list of bytes or strings
+            globals.borrow_mut().define(
+                "tcp_send_vec".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("tcp_send_vec", 2, |args| {
+                    match &args[1] {
+                        Value::List(parts) => {
+                            tcp_send_parts("tcp_send_vec", &args[0], &parts.borrow(), false)
+                        }
+                        _ => Err("tcp_send_vec() expects a list of bytes".to_string()),
+                    }
+                }))),
+            );
+
+            // tcp_send_all(sock, data) -> sends all of bytes, a string or a list of them
+            globals.borrow_mut().define(
+                "tcp_send_all".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("tcp_send_all", 2, |args| {
+                    match &args[1] {
+                        Value::List(parts) => {
+                            tcp_send_parts("tcp_send_all", &args[0], &parts.borrow(), true)
+                        }
+                        other => tcp_send_parts("tcp_send_all", &args[0], &[other.clone()], true),
+                    }
+                }))),
+            );
+
+            // socket_send_file(sock, path, offset, len) -> bytes sent; len < 0 means to the end
+            globals.borrow_mut().define(
+                "socket_send_file".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(
+                    "socket_send_file",
+                    4,
+                    |args| {
+                        let sock_id = args[0]
+                            .as_integer()
+                            .ok_or("socket_send_file() expects socket id")?;
+                        let path = match &args[1] {
+                            Value::String(s) => s.clone(),
+                            _ => return Err("socket_send_file() expects path string".to_string()),
+                        };
+                        let (offset, len) = match (&args[2], &args[3]) {
+                            (Value::Integer(o), Value::Integer(l)) if *o >= 0 => (*o as u64, *l),
+                            _ => {
+                                return Err(
+                                    "socket_send_file() expects offset and length".to_string()
+                                )
+                            }
+                        };
+                        let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                        let io_err = |err: std::io::Error| {
+                            let code = err.raw_os_error().unwrap_or(-1) as i64;
+                            result_err(err.to_string(), code)
+                        };
+                        let file = match std::fs::File::open(&*path) {
+                            Ok(file) => file,
+                            Err(err) => return Ok(io_err(err)),
+                        };
+                        let size = match file.metadata() {
+                            Ok(meta) => meta.len(),
+                            Err(err) => return Ok(io_err(err)),
+                        };
+                        let avail = size.saturating_sub(offset);
+                        let len = if len < 0 {
+                            avail
+                        } else {
+                            (len as u64).min(avail)
+                        };
+                        match send_file_range(entry.fd, &file, offset, len) {
+                            Ok(sent) => Ok(result_ok(Value::Integer(sent as i64))),
+                            Err(err) => Ok(io_err(err)),
+                        }
+                    },
+                ))),
+            );
+
+            // tcp_recv(sock, max_len)
+            globals.borrow_mut().define(
+                "tcp_recv".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("tcp_recv", 2, |args| {
+                    let sock_id = args[0].as_integer().ok_or("tcp_recv() expects socket id")?;
+                    let max_len = args[1]
+                        .as_integer()
+                        .ok_or("tcp_recv() expects max_len integer")?;
+                    let max_len = if max_len < 0 { 0 } else { max_len } as usize;
+                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                    let mut buf = vec![0u8; max_len];
+                    let n = unsafe {
+                        libc::recv(
+                            entry.fd,
+                            buf.as_mut_ptr() as *mut libc::c_void,
+                            buf.len(),
+                            0,
+                        )
+                    };
+                    if n < 0 {
+                        let err = std::io::Error::last_os_error();
+                        let code = err.raw_os_error().unwrap_or(-1) as i64;
+                        return Ok(result_err(err.to_string(), code));
+                    }
+                    buf.truncate(n as usize);
+                    Ok(result_ok(Value::Bytes(Rc::new(RefCell::new(buf)))))
+                }))),
+            );
+
+            // tcp_recv_into(sock, bytes, offset) -> count read into bytes[offset..]
+            globals.borrow_mut().define(
+                "tcp_recv_into".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("tcp_recv_into", 3, |args| {
+                    let sock_id = args[0]
+                        .as_integer()
+                        .ok_or("tcp_recv_into() expects socket id")?;
+                    let bytes = match &args[1] {
+                        Value::Bytes(b) => b.clone(),
+                        _ => return Err("tcp_recv_into() expects bytes".to_string()),
+                    };
+                    let offset = args[2]
+                        .as_integer()
+                        .ok_or("tcp_recv_into() expects offset integer")?;
+                    let mut buf = bytes.borrow_mut();
+                    if offset < 0 || offset as usize > buf.len() {
+                        return Err("tcp_recv_into() offset out o' bounds".to_string());
+                    }
+                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                    let span = &mut buf[offset as usize..];
+                    let n = unsafe {
+                        libc::recv(
+                            entry.fd,
+                            span.as_mut_ptr() as *mut libc::c_void,
+                            span.len(),
+                            0,
+                        )
+                    };
+                    if n < 0 {
+                        let err = std::io::Error::last_os_error();
+                        let code = err.raw_os_error().unwrap_or(-1) as i64;
+                        return Ok(result_err(err.to_string(), code));
+                    }
+                    Ok(result_ok(Value::Integer(n as i64)))
+                }))),
+            );
+
+            // udp_recv_into(sock, bytes) -> {"len": count, "addr": addr}
+            globals.borrow_mut().define(
+                "udp_recv_into".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("udp_recv_into", 2, |args| {
+                    let sock_id = args[0]
+                        .as_integer()
+                        .ok_or("udp_recv_into() expects socket id")?;
+                    let bytes = match &args[1] {
+                        Value::Bytes(b) => b.clone(),
+                        _ => return Err("udp_recv_into() expects bytes".to_string()),
+                    };
+                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                    let mut buf = bytes.borrow_mut();
+                    let mut addr: libc::sockaddr_in = unsafe { std::mem::zeroed() };
+                    let mut addr_len = std::mem::size_of::<libc::sockaddr_in>() as libc::socklen_t;
+                    let n = unsafe {
+                        libc::recvfrom(
+                            entry.fd,
+                            buf.as_mut_ptr() as *mut libc::c_void,
+                            buf.len(),
+                            0,
+                            &mut addr as *mut _ as *mut libc::sockaddr,
+                            &mut addr_len,
+                        )
+                    };
+                    if n < 0 {
+                        let err = std::io::Error::last_os_error();
+                        let code = err.raw_os_error().unwrap_or(-1) as i64;
+                        return Ok(result_err(err.to_string(), code));
+                    }
+                    let mut info = DictValue::new();
+                    info.set(Value::String("len".into()), Value::Integer(n as i64));
+                    let (host, port) = sockaddr_to_host_port(&addr);
+                    info.set(Value::String("addr".into()), addr_dict(host, port));
+                    Ok(result_ok(Value::Dict(Rc::new(RefCell::new(info)))))
+                }))),
+            );
+        }
+
+        #[cfg(feature = "native")]
+        {
+            // dns_lookup(host) -> result {ok,value:[ips]}
+            globals.borrow_mut().define(
+                "dns_lookup".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("dns_lookup", 1, |args| {
+                    let host = match &args[0] {
+                        Value::String(s) => s.clone(),
+                        _ => return Err("dns_lookup() expects host string".to_string()),
+                    };
+                    let mut out = Vec::new();
+                    let iter = match (host.as_ref(), 0).to_socket_addrs() {
+                        Ok(iter) => iter,
+                        Err(e) => return Ok(result_err(format!("dns_lookup() {}", e), -1)),
+                    };
+                    for addr in iter {
+                        out.push(Value::String(addr.ip().to_string().into()));
+                    }
+                    Ok(result_ok(Value::List(Rc::new(RefCell::new(out)))))
+                }))),
+            );
+
+            // dns_srv(service, domain) -> result {ok,value:[{priority,weight,port,target}]}
+            globals.borrow_mut().define(
+                "dns_srv".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("dns_srv", 2, |args| {
+                    let service = match &args[0] {
+                        Value::String(s) => s.clone(),
+                        _ => return Err("dns_srv() expects service string".to_string()),
+                    };
+                    let domain = match &args[1] {
+                        Value::String(s) => s.clone(),
+                        _ => return Err("dns_srv() expects domain string".to_string()),
+                    };
+                    let name = if service.is_empty() {
+                        domain.to_string()
+                    } else {
+                        let s = service.trim_end_matches('.');
+                        let d = domain.trim_start_matches('.');
+                        format!("{}.{}", s, d)
+                    };
+                    let resolver = match make_resolver() {
+                        Ok(resolver) => resolver,
+                        Err(e) => return Ok(result_err(format!("dns_srv() {}", e), -1)),
+                    };
+	                    let lookup = match resolver_lookup(&resolver, name.as_str(), RecordType::SRV) {
+	                        Ok(lookup) => lookup,
+	                        Err(e) => {
+	                            return Ok(result_err(
+	                                format!("dns_srv() DNS SRV lookup failed: {}", e),
+	                                -1,
+	                            ))
+	                        }
+	                    };
+	                    let out: Vec<Value> = lookup.iter().filter_map(|rdata| match rdata { RData::SRV(srv) => Some(dns_srv_to_value(srv)), _ => None }).collect();
+	                    Ok(result_ok(Value::List(Rc::new(RefCell::new(out)))))
+	                }))),
+	            );
+
+            // dns_naptr(domain) -> result {ok,value:[{order,preference,flags,service,regexp,replacement}]}
+            globals.borrow_mut().define(
+                "dns_naptr".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("dns_naptr", 1, |args| {
+                    let domain = match &args[0] {
+                        Value::String(s) => s.clone(),
+                        _ => return Err("dns_naptr() expects domain string".to_string()),
+                    };
+                    let resolver = match make_resolver() {
+                        Ok(resolver) => resolver,
+                        Err(e) => return Ok(result_err(format!("dns_naptr() {}", e), -1)),
+                    };
+	                    let lookup = match resolver_lookup(&resolver, domain.as_ref(), RecordType::NAPTR) {
+	                        Ok(lookup) => lookup,
+	                        Err(e) => {
+	                            return Ok(result_err(
+	                                format!("dns_naptr() DNS NAPTR lookup failed: {}", e),
+	                                -1,
+	                            ))
+	                        }
+	                    };
+	                    let out: Vec<Value> = lookup.iter().filter_map(|rdata| match rdata { RData::NAPTR(naptr) => Some(dns_naptr_to_value(naptr)), _ => None }).collect();
+	                    Ok(result_ok(Value::List(Rc::new(RefCell::new(out)))))
+	                }))),
+	            );
+
+            // dns_lookup_async / dns_srv_async / dns_naptr_async: native builds resolve on
+            // background threads; here the lookup runs at once and the channel comes back
+            // closed with the result already queued.
+            for (name, sync) in [
+                ("dns_lookup_async", "dns_lookup"),
+                ("dns_srv_async", "dns_srv"),
+                ("dns_naptr_async", "dns_naptr"),
+            ] {
+                let Some(Value::NativeFunction(lookup)) = globals.borrow().get(sync) else {
+                    continue;
+                };
+                globals.borrow_mut().define(
+                    name.to_string(),
+                    Value::NativeFunction(Rc::new(NativeFunction::new(
+                        name,
+                        lookup.arity,
+                        move |args| {
+                            let result = (lookup.func)(args)?;
+                            let id = register_channel(ChannelState {
+                                queue: VecDeque::from([result]),
+                                capacity: 1,
+                                closed: true,
+                            });
+                            Ok(Value::Integer(id))
+                        },
+                    ))),
+                );
+            }
+        }
+
+        #[cfg(all(feature = "native", unix))]
+        {
+            // tls_client_new(config) -> result {ok,value:tls_handle}
+            globals.borrow_mut().define(
+                "tls_client_new".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("tls_client_new", 1, |args| {
+                    let cfg = tls_config_from_value(&args[0])?;
+                    let session = if cfg.mode == TlsMode::Client {
+                        let client_config = build_client_config(&cfg)?;
+                        TlsSession {
+                            mode: TlsMode::Client,
+                            server_name: cfg.server_name,
+                            client_config: Some(client_config),
+                            server_config: None,
+                            stream: None,
+                        }
+                    } else {
+                        let server_config = build_server_config(&cfg)?;
+                        TlsSession {
+                            mode: TlsMode::Server,
+                            server_name: cfg.server_name,
+                            client_config: None,
+                            server_config: Some(server_config),
+                            stream: None,
+                        }
+                    };
+                    let id = register_tls(session);
+                    Ok(result_ok(Value::Integer(id)))
+                }))),
+            );
+
+	            // tls_connect(tls, sock)
+	            globals.borrow_mut().define(
+	                "tls_connect".to_string(),
+	                Value::NativeFunction(Rc::new(NativeFunction::new("tls_connect", 2, |args| {
+	                    let tls_id = args[0]
+	                        .as_integer()
+	                        .ok_or("tls_connect() expects TLS handle")?;
+	                    let sock_id = args[1]
 	                        .as_integer()
 	                        .ok_or("tls_connect() expects socket id")?;
 	                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
@@ -3296,5466 +7327,7486 @@ impl Interpreter {
 	                    let mut stream = unsafe { std::net::TcpStream::from_raw_fd(dup_fd) };
 	                    let _ = stream.set_nonblocking(false);
 
-	                    let res = with_tls_mut(tls_id, move |session| {
-	                        if session.stream.is_some() {
-	                            return Err("TLS session already connected".to_string());
-	                        }
+	                    let res = with_tls_mut(tls_id, move |session| {
+	                        if session.stream.is_some() {
+	                            return Err("TLS session already connected".to_string());
+	                        }
+
+	                        match session.mode {
+	                            TlsMode::Client => {
+                                let config = session
+	                                    .client_config
+                                    .as_ref()
+                                    .ok_or("Missing client config")?
+                                    .clone();
+                                let server_name = match ServerName::try_from(session.server_name.as_str()) {
+                                    Ok(server_name) => server_name,
+                                    Err(_) => return Err("Invalid server_name".to_string()),
+                                };
+                                let conn_result = {
+                                    #[cfg(test)]
+                                    {
+                                        if tls_take_force_next_client_conn_new_fail() {
+                                            Err(rustls::Error::General("injected".to_string()))
+                                        } else {
+                                            ClientConnection::new(config, server_name)
+                                        }
+                                    }
+                                    #[cfg(not(test))]
+                                    {
+                                        ClientConnection::new(config, server_name)
+                                    }
+                                };
+                                let mut conn = match conn_result {
+                                    Ok(conn) => conn,
+                                    Err(e) => return Err(e.to_string()),
+                                };
+	                                while conn.is_handshaking() {
+	                                    if let Err(e) = conn.complete_io(&mut stream) {
+	                                        return Err(format!("TLS handshake failed: {}", e));
+	                                    }
+	                                }
+	                                session.stream =
+	                                    Some(TlsStream::Client(StreamOwned::new(conn, stream)));
+	                            }
+	                            TlsMode::Server => {
+	                                let config = session
+	                                    .server_config
+	                                    .as_ref()
+	                                    .ok_or("Missing server config")?
+	                                    .clone();
+	                                let conn_result = {
+	                                    #[cfg(test)]
+	                                    {
+	                                        if tls_take_force_next_server_conn_new_fail() {
+	                                            Err(rustls::Error::General("injected".to_string()))
+	                                        } else {
+	                                            ServerConnection::new(config)
+	                                        }
+	                                    }
+	                                    #[cfg(not(test))]
+	                                    {
+	                                        ServerConnection::new(config)
+	                                    }
+	                                };
+	                                let mut conn = match conn_result {
+	                                    Ok(conn) => conn,
+	                                    Err(e) => return Err(e.to_string()),
+	                                };
+	                                while conn.is_handshaking() {
+	                                    if let Err(e) = conn.complete_io(&mut stream) {
+	                                        return Err(format!("TLS handshake failed: {}", e));
+	                                    }
+	                                }
+	                                session.stream =
+	                                    Some(TlsStream::Server(StreamOwned::new(conn, stream)));
+	                            }
+	                        }
+	                        Ok(())
+	                    });
+
+                    match res {
+                        Ok(_) => Ok(result_ok(Value::Nil)),
+                        Err(e) => Ok(result_err(e, -1)),
+                    }
+                }))),
+            );
+
+            // tls_send(tls, bytes)
+            globals.borrow_mut().define(
+                "tls_send".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("tls_send", 2, |args| {
+                    let tls_id = args[0]
+                        .as_integer()
+                        .ok_or("tls_send() expects TLS handle")?;
+                    let bytes = match &args[1] {
+                        Value::Bytes(b) => b.borrow(),
+                        _ => return Err("tls_send() expects bytes".to_string()),
+                    };
+                    let res = with_tls_mut(tls_id, |session| {
+                        let stream = session.stream.as_mut().ok_or("TLS not connected")?;
+                        let write_result = {
+                            #[cfg(test)]
+                            {
+                                if tls_take_force_next_send_fail() {
+                                    Err(std::io::Error::new(
+                                        std::io::ErrorKind::Other,
+                                        "injected send error",
+                                    ))
+                                } else {
+                                    match stream {
+                                        TlsStream::Client(s) => s.write(bytes.as_slice()),
+                                        TlsStream::Server(s) => s.write(bytes.as_slice()),
+                                    }
+                                }
+                            }
+                            #[cfg(not(test))]
+                            {
+                                match stream {
+                                    TlsStream::Client(s) => s.write(bytes.as_slice()),
+                                    TlsStream::Server(s) => s.write(bytes.as_slice()),
+                                }
+                            }
+                        };
+                        let n = match write_result {
+                            Ok(n) => n,
+                            Err(e) => return Err(format!("TLS send failed: {}", e)),
+                        };
+                        match stream {
+                            TlsStream::Client(s) => {
+                                let _ = s.flush();
+                            }
+                            TlsStream::Server(s) => {
+                                let _ = s.flush();
+                            }
+                        }
+                        Ok(n as i64)
+                    });
+                    match res {
+                        Ok(n) => Ok(result_ok(Value::Integer(n))),
+                        Err(e) => Ok(result_err(e, -1)),
+                    }
+                }))),
+            );
+
+            // tls_recv(tls, max_len)
+            globals.borrow_mut().define(
+                "tls_recv".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("tls_recv", 2, |args| {
+                    let tls_id = args[0]
+                        .as_integer()
+                        .ok_or("tls_recv() expects TLS handle")?;
+                    let max_len = args[1]
+                        .as_integer()
+                        .ok_or("tls_recv() expects max_len integer")?;
+                    let max_len = if max_len < 0 { 0 } else { max_len } as usize;
+                    let res = with_tls_mut(tls_id, |session| {
+                        let stream = session.stream.as_mut().ok_or("TLS not connected")?;
+                        let mut buf = vec![0u8; max_len];
+                        let read_result = {
+                            #[cfg(test)]
+                            {
+                                if tls_take_force_next_recv_fail() {
+                                    Err(std::io::Error::new(
+                                        std::io::ErrorKind::Other,
+                                        "injected recv error",
+                                    ))
+                                } else {
+                                    match stream {
+                                        TlsStream::Client(s) => s.read(&mut buf),
+                                        TlsStream::Server(s) => s.read(&mut buf),
+                                    }
+                                }
+                            }
+                            #[cfg(not(test))]
+                            {
+                                match stream {
+                                    TlsStream::Client(s) => s.read(&mut buf),
+                                    TlsStream::Server(s) => s.read(&mut buf),
+                                }
+                            }
+                        };
+                        let n = match read_result {
+                            Ok(n) => n,
+                            Err(e) => return Err(format!("TLS recv failed: {}", e)),
+                        };
+                        buf.truncate(n);
+                        Ok(buf)
+                    });
+                    match res {
+                        Ok(buf) => Ok(result_ok(Value::Bytes(Rc::new(RefCell::new(buf))))),
+                        Err(e) => Ok(result_err(e, -1)),
+                    }
+                }))),
+            );
+
+            // tls_close(tls)
+            globals.borrow_mut().define(
+                "tls_close".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("tls_close", 1, |args| {
+                    let tls_id = args[0]
+                        .as_integer()
+                        .ok_or("tls_close() expects TLS handle")?;
+                    remove_tls(tls_id);
+                    Ok(result_ok(Value::Nil))
+                }))),
+            );
+
+            // tls_connect_start / tls_step: the non-blocking handshake drives native sockets
+            // from an MdhEventLoop, which the interpreter doesn't have.
+            for (name, arity) in [("tls_connect_start", 2), ("tls_step", 1)] {
+                globals.borrow_mut().define(
+                    name.to_string(),
+                    Value::NativeFunction(Rc::new(NativeFunction::new(
+                        name,
+                        arity,
+                        move |_args| Err(format!("{}() needs a native build", name)),
+                    ))),
+                );
+            }
+
+            // tls_stats() -> {"full", "resumed"}: the session cache lives in the native runtime
+            globals.borrow_mut().define(
+                "tls_stats".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("tls_stats", 0, |_args| {
+                    Err("tls_stats() needs a native build".to_string())
+                }))),
+            );
+
+            // dtls_server_new(config)
+            globals.borrow_mut().define(
+                "dtls_server_new".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("dtls_server_new", 1, |args| {
+                    let cfg = dtls_config_from_value(&args[0])?;
+                    let id = register_dtls(cfg);
+                    Ok(result_ok(Value::Integer(id)))
+                }))),
+            );
+
+            // dtls_handshake(dtls, sock)
+            globals.borrow_mut().define(
+                "dtls_handshake".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("dtls_handshake", 2, |args| {
+                    let dtls_id = args[0]
+                        .as_integer()
+                        .ok_or("dtls_handshake() expects DTLS handle")?;
+                    let sock_id = args[1]
+                        .as_integer()
+                        .ok_or("dtls_handshake() expects socket id")?;
+                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                    let cfg = match dtls_get(dtls_id) {
+                        Ok(cfg) => cfg,
+                        Err(e) => return Ok(result_err(e, -1)),
+                    };
+
+                    let dup_fd = unsafe { libc::dup(entry.fd) };
+                    if dup_fd < 0 {
+                        let err = std::io::Error::last_os_error();
+                        let code = err.raw_os_error().unwrap_or(-1) as i64;
+                        return Ok(result_err(err.to_string(), code));
+                    }
+
+		                    let socket = unsafe { std::net::UdpSocket::from_raw_fd(dup_fd) };
+		                    let nonblocking = {
+		                        #[cfg(test)]
+		                        {
+		                            dtls_take_force_nonblocking_next_handshake()
+		                        }
+		                        #[cfg(not(test))]
+		                        {
+		                            false
+		                        }
+		                    };
+		                    if let Err(e) = socket.set_nonblocking(nonblocking) { return Ok(result_err(format!("DTLS socket setup failed: {}", e), -1)); }
+
+                    let remote = if let (Some(host), Some(port)) =
+                        (cfg.remote_host.clone(), cfg.remote_port)
+                    {
+                        match format!("{}:{}", host, port).parse() {
+                            Ok(addr) => addr,
+                            Err(_) => {
+                                return Ok(result_err("Invalid remote address".to_string(), -1))
+                            }
+                        }
+                    } else {
+                        match socket.peer_addr() {
+                            Ok(addr) => addr,
+                            Err(_) => {
+                                return Ok(result_err(
+                                    "dtls_handshake requires remote_host/remote_port".to_string(),
+                                    -1,
+                                ))
+                            }
+                        }
+                    };
+
+                    if let Err(e) = socket.connect(remote) {
+                        return Ok(result_err(format!("DTLS connect failed: {}", e), -1));
+                    }
+
+                    let channel = UdpChannel {
+                        socket,
+                        remote_addr: remote,
+                    };
+
+                    let (stream, selected_profile) = if cfg.mode == TlsMode::Client {
+                        let mut builder = DtlsConnector::builder();
+                        for profile in &cfg.srtp_profiles {
+                            builder.add_srtp_profile(*profile);
+                        }
+                        if let Some(ca_pem) = &cfg.ca_pem {
+                            let cert = match udp_dtls::Certificate::from_pem(ca_pem.as_bytes()) {
+                                Ok(cert) => cert,
+                                Err(e) => {
+                                    return Ok(result_err(format!("Invalid CA cert: {}", e), -1))
+                                }
+                            };
+                            builder.add_root_certificate(cert);
+                        }
+                        if cfg.insecure {
+                            builder.danger_accept_invalid_certs(true);
+                            builder.danger_accept_invalid_hostnames(true);
+                        }
+		                        if let (Some(cert_pem), Some(key_pem)) = (&cfg.cert_pem, &cfg.key_pem) {
+		                            let identity = match identity_from_pem(cert_pem, key_pem) {
+		                                Ok(identity) => identity,
+		                                Err(e) => return Ok(result_err(e, -1)),
+		                            };
+		                            builder.identity(identity); }
+		                        let connector = match DtlsConnector::new(&builder) { Ok(connector) => connector, Err(e) => return Ok(result_err(format!("{}", e), -1)), };
+		                        let connect_result = {
+		                            #[cfg(test)]
+		                            {
+		                                if dtls_take_fail_next_connect() {
+		                                    Err(udp_dtls::HandshakeError::Failure(udp_dtls::Error::SrtpProfile(
+		                                        udp_dtls::SrtpProfileError::BadProfile,
+		                                    )))
+		                                } else {
+		                                    connector.connect(&cfg.server_name, channel)
+		                                }
+		                            }
+		                            #[cfg(not(test))]
+		                            {
+		                                connector.connect(&cfg.server_name, channel)
+		                            }
+		                        };
+		                        match connect_result {
+		                            Ok(stream) => {
+		                                let selected = stream.selected_srtp_profile().ok().flatten();
+		                                (stream, selected)
+		                            }
+		                            Err(err) => return Ok(result_err(format!("DTLS connect failed: {:?}", err), -1)),
+		                        }
+		                    } else {
+                        let cert_pem = match cfg.cert_pem.as_ref() {
+                            Some(v) => v,
+                            None => {
+                                return Ok(result_err("Server cert_pem required".to_string(), -1))
+                            }
+                        };
+                        let key_pem = match cfg.key_pem.as_ref() {
+                            Some(v) => v,
+                            None => {
+                                return Ok(result_err("Server key_pem required".to_string(), -1))
+                            }
+                        };
+                        let identity = match identity_from_pem(cert_pem, key_pem) {
+                            Ok(identity) => identity,
+                            Err(e) => return Ok(result_err(e, -1)),
+                        };
+	                        let mut builder = DtlsAcceptor::builder(identity);
+	                        for profile in &cfg.srtp_profiles {
+	                            builder.add_srtp_profile(*profile);
+	                        }
+		                        let acceptor = match DtlsAcceptor::new(&builder) { Ok(acceptor) => acceptor, Err(e) => return Ok(result_err(format!("{}", e), -1)), };
+		                        let accept_result = {
+		                            #[cfg(test)]
+		                            {
+		                                if dtls_take_fail_next_accept() {
+		                                    Err(udp_dtls::HandshakeError::Failure(udp_dtls::Error::SrtpProfile(
+		                                        udp_dtls::SrtpProfileError::BadProfile,
+		                                    )))
+		                                } else {
+		                                    acceptor.accept(channel)
+		                                }
+		                            }
+		                            #[cfg(not(test))]
+		                            {
+		                                acceptor.accept(channel)
+		                            }
+		                        };
+		                        match accept_result {
+		                            Ok(stream) => {
+		                                let selected = stream.selected_srtp_profile().ok().flatten();
+		                                (stream, selected)
+		                            }
+		                            Err(err) => return Ok(result_err(format!("DTLS accept failed: {:?}", err), -1)),
+		                        }
+		                    };
+
+                    let profile = selected_profile.unwrap_or(SrtpProfile::Aes128CmSha180);
+                    let (key_len, salt_len) = srtp_key_salt_len(profile);
+	                    let total = 2 * (key_len + salt_len);
+		                    let material = match stream.keying_material(total) { Ok(material) => material, Err(e) => return Ok(result_err(format!("Keying material failed: {}", e), -1)), };
+
+                    let client_key = material[0..key_len].to_vec();
+                    let server_key = material[key_len..(2 * key_len)].to_vec();
+                    let client_salt = material[(2 * key_len)..(2 * key_len + salt_len)].to_vec();
+                    let server_salt =
+                        material[(2 * key_len + salt_len)..(2 * key_len + 2 * salt_len)].to_vec();
+
+                    let mut dict = DictValue::new();
+                    dict.set(
+                        Value::String("profile".into()),
+                        Value::String(profile.to_string()),
+                    );
+                    dict.set(
+                        Value::String("client_key".into()),
+                        Value::Bytes(Rc::new(RefCell::new(client_key))),
+                    );
+                    dict.set(
+                        Value::String("client_salt".into()),
+                        Value::Bytes(Rc::new(RefCell::new(client_salt))),
+                    );
+                    dict.set(
+                        Value::String("server_key".into()),
+                        Value::Bytes(Rc::new(RefCell::new(server_key))),
+                    );
+                    dict.set(
+                        Value::String("server_salt".into()),
+                        Value::Bytes(Rc::new(RefCell::new(server_salt))),
+                    );
+                    dict.set(
+                        Value::String("key_len".into()),
+                        Value::Integer(key_len as i64),
+                    );
+                    dict.set(
+                        Value::String("salt_len".into()),
+                        Value::Integer(salt_len as i64),
+                    );
+
+                    Ok(result_ok(Value::Dict(Rc::new(RefCell::new(dict)))))
+                }))),
+            );
+
+            // srtp_create(keys)
+            globals.borrow_mut().define(
+                "srtp_create".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("srtp_create", 1, |args| {
+                    let dict = match &args[0] {
+                        Value::Dict(d) => d.borrow(),
+                        _ => return Err("srtp_create() expects config dict".to_string()),
+                    };
+
+                    let profile_str = dict_get_string(&dict, "profile")
+                        .unwrap_or_else(|| "SRTP_AES128_CM_SHA1_80".to_string());
+                    let profile = match protection_profile_from_str(&profile_str) {
+                        Some(p) => p,
+                        None => return Ok(result_err("Unsupported SRTP profile".to_string(), -1)),
+                    };
+
+                    let role =
+                        dict_get_string(&dict, "role").unwrap_or_else(|| "client".to_string());
+
+                    let mut send_key = dict_get_bytes(&dict, "send_key");
+                    let mut send_salt = dict_get_bytes(&dict, "send_salt");
+                    let mut recv_key = dict_get_bytes(&dict, "recv_key");
+                    let mut recv_salt = dict_get_bytes(&dict, "recv_salt");
+
+                    let client_key = dict_get_bytes(&dict, "client_key");
+                    let client_salt = dict_get_bytes(&dict, "client_salt");
+                    let server_key = dict_get_bytes(&dict, "server_key");
+                    let server_salt = dict_get_bytes(&dict, "server_salt");
+
+                    if send_key.is_none()
+                        || send_salt.is_none()
+                        || recv_key.is_none()
+                        || recv_salt.is_none()
+                    {
+                        if client_key.is_some()
+                            && client_salt.is_some()
+                            && server_key.is_some()
+                            && server_salt.is_some()
+                        {
+                            let is_client = role.to_lowercase() != "server";
+                            if is_client {
+                                send_key = client_key.clone();
+                                send_salt = client_salt.clone();
+                                recv_key = server_key.clone();
+                                recv_salt = server_salt.clone();
+                            } else {
+                                send_key = server_key.clone();
+                                send_salt = server_salt.clone();
+                                recv_key = client_key.clone();
+                                recv_salt = client_salt.clone();
+                            }
+                        } else {
+                            let master_key = dict_get_bytes(&dict, "master_key");
+                            let master_salt = dict_get_bytes(&dict, "master_salt");
+                            if master_key.is_some() && master_salt.is_some() {
+                                send_key = master_key.clone();
+                                send_salt = master_salt.clone();
+                                recv_key = master_key;
+                                recv_salt = master_salt;
+                            }
+                        }
+                    }
+
+                    let send_key = match send_key {
+                        Some(v) => v,
+                        None => return Ok(result_err("Missing SRTP send_key".to_string(), -1)),
+                    };
+                    let send_salt = match send_salt {
+                        Some(v) => v,
+                        None => return Ok(result_err("Missing SRTP send_salt".to_string(), -1)),
+                    };
+                    let recv_key = match recv_key {
+                        Some(v) => v,
+                        None => return Ok(result_err("Missing SRTP recv_key".to_string(), -1)),
+                    };
+                    let recv_salt = match recv_salt {
+                        Some(v) => v,
+                        None => return Ok(result_err("Missing SRTP recv_salt".to_string(), -1)),
+                    };
+
+                    let send_master = MasterKey::new(&send_key, &send_salt, &None);
+                    let recv_master = MasterKey::new(&recv_key, &recv_salt, &None);
+                    let send_cfg = StreamConfig::new(vec![send_master], &profile, &profile);
+                    let recv_cfg = StreamConfig::new(vec![recv_master], &profile, &profile);
+
+                    let mut send = SendSession::new();
+                    if let Err(e) = send.add_stream(None, &send_cfg) {
+                        return Ok(result_err(format!("SRTP send session error: {}", e), -1));
+                    }
+                    let mut recv = RecvSession::new();
+                    if let Err(e) = recv.add_stream(None, &recv_cfg) {
+                        return Ok(result_err(format!("SRTP recv session error: {}", e), -1));
+                    }
+
+                    let id = register_srtp(SrtpSession { send, recv });
+                    Ok(result_ok(Value::Integer(id)))
+                }))),
+            );
+
+            // srtp_protect(srtp, rtp_packet)
+            globals.borrow_mut().define(
+                "srtp_protect".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("srtp_protect", 2, |args| {
+                    let ctx_id = args[0]
+                        .as_integer()
+                        .ok_or("srtp_protect() expects SRTP handle")?;
+                    let packet = match &args[1] {
+                        Value::Bytes(b) => b.borrow().clone(),
+                        _ => return Err("srtp_protect() expects bytes".to_string()),
+                    };
+                    let res = with_srtp_mut(ctx_id, |session| {
+                        session
+                            .send
+                            .rtp_protect(packet)
+                            .map_err(|e| format!("SRTP protect failed: {}", e))
+                    });
+                    match res {
+                        Ok(buf) => Ok(result_ok(Value::Bytes(Rc::new(RefCell::new(buf))))),
+                        Err(e) => Ok(result_err(e, -1)),
+                    }
+                }))),
+            );
+
+            // srtp_unprotect(srtp, rtp_packet)
+            globals.borrow_mut().define(
+                "srtp_unprotect".to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new("srtp_unprotect", 2, |args| {
+                    let ctx_id = args[0]
+                        .as_integer()
+                        .ok_or("srtp_unprotect() expects SRTP handle")?;
+                    let packet = match &args[1] {
+                        Value::Bytes(b) => b.borrow().clone(),
+                        _ => return Err("srtp_unprotect() expects bytes".to_string()),
+                    };
+                    let res = with_srtp_mut(ctx_id, |session| {
+                        session
+                            .recv
+                            .rtp_unprotect(packet)
+                            .map_err(|e| format!("SRTP unprotect failed: {}", e))
+                    });
+                    match res {
+                        Ok(buf) => Ok(result_ok(Value::Bytes(Rc::new(RefCell::new(buf))))),
+                        Err(e) => Ok(result_err(e, -1)),
+                    }
+                }))),
+            );
+
+            // srtp_protect_into / srtp_unprotect_into(srtp, packet) -> new length. The
+            // packet is rewritten with the result, or left alone if libsrtp refuses it.
+            for (name, protect) in [("srtp_protect_into", true), ("srtp_unprotect_into", false)] {
+                globals.borrow_mut().define(
+                    name.to_string(),
+                    Value::NativeFunction(Rc::new(NativeFunction::new(name, 2, move |args| {
+                        let ctx_id = args[0]
+                            .as_integer()
+                            .ok_or_else(|| format!("{}() expects SRTP handle", name))?;
+                        let Value::Bytes(packet) = &args[1] else {
+                            return Err(format!("{}() expects bytes", name));
+                        };
+                        let data = packet.borrow().clone();
+                        let res = with_srtp_mut(ctx_id, |session| {
+                            if protect {
+                                session
+                                    .send
+                                    .rtp_protect(data)
+                                    .map_err(|e| format!("SRTP protect failed: {}", e))
+                            } else {
+                                session
+                                    .recv
+                                    .rtp_unprotect(data)
+                                    .map_err(|e| format!("SRTP unprotect failed: {}", e))
+                            }
+                        });
+                        match res {
+                            Ok(buf) => {
+                                let len = buf.len() as i64;
+                                *packet.borrow_mut() = buf;
+                                Ok(result_ok(Value::Integer(len)))
+                            }
+                            Err(e) => Ok(result_err(e, -1)),
+                        }
+                    }))),
+                );
+            }
+
+            // srtp_protect_many / srtp_unprotect_many(srtp, packets) -> [new lengths]: a list
+            // of bytes or a udp_recv_many batch, each rewritten in place; -1 marks a packet
+            // libsrtp refused, which is left as it was.
+            for (name, protect) in [("srtp_protect_many", true), ("srtp_unprotect_many", false)] {
+                globals.borrow_mut().define(
+                    name.to_string(),
+                    Value::NativeFunction(Rc::new(NativeFunction::new(name, 2, move |args| {
+                        let ctx_id = args[0]
+                            .as_integer()
+                            .ok_or_else(|| format!("{}() expects SRTP handle", name))?;
+                        let list = match &args[1] {
+                            Value::Dict(d) => {
+                                d.borrow().get(&Value::String("bufs".into())).cloned()
+                            }
+                            other => Some(other.clone()),
+                        };
+                        let Some(Value::List(items)) = list else {
+                            return Err(format!("{}() expects a list of bytes", name));
+                        };
+                        let mut packets = Vec::new();
+                        for item in items.borrow().iter() {
+                            match item {
+                                Value::Bytes(b) => packets.push(b.clone()),
+                                _ => return Err(format!("{}() expects a list of bytes", name)),
+                            }
+                        }
+                        let res = with_srtp_mut(ctx_id, |session| {
+                            let mut lengths = Vec::with_capacity(packets.len());
+                            for packet in &packets {
+                                let data = packet.borrow().clone();
+                                let out = if protect {
+                                    session.send.rtp_protect(data).ok()
+                                } else {
+                                    session.recv.rtp_unprotect(data).ok()
+                                };
+                                let len = match out {
+                                    Some(buf) => {
+                                        let len = buf.len() as i64;
+                                        *packet.borrow_mut() = buf;
+                                        len
+                                    }
+                                    None => -1,
+                                };
+                                lengths.push(Value::Integer(len));
+                            }
+                            Ok(lengths)
+                        });
+                        match res {
+                            Ok(lengths) => {
+                                Ok(result_ok(Value::List(Rc::new(RefCell::new(lengths)))))
+                            }
+                            Err(e) => Ok(result_err(e, -1)),
+                        }
+                    }))),
+                );
+            }
+        }
+
+        // arena_push() / arena_pop(keep): per-iteration allocation scopes in native
+        // builds. Reference counting already frees temporaries here, so these are no-ops.
+        globals.borrow_mut().define(
+            "arena_push".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("arena_push", 0, |_args| {
+                Ok(Value::Nil)
+            }))),
+        );
+        globals.borrow_mut().define(
+            "arena_pop".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("arena_pop", 1, |args| {
+                Ok(args[0].clone())
+            }))),
+        );
+
+        // runtime_stats(): the counters live in the native C runtime
+        globals.borrow_mut().define(
+            "runtime_stats".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("runtime_stats", 0, |_args| {
+                Err("runtime_stats() needs a native build".to_string())
+            }))),
+        );
+
+        // gc_config(opts), gc_collect(), gc_stats(): Rc frees as it goes, so there is
+        // no collector here to tune
+        for (name, arity) in [("gc_config", 1), ("gc_collect", 0), ("gc_stats", 0)] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, arity, move |_args| {
+                    Err(format!("{}() needs a native build", name))
+                }))),
+            );
+        }
+
+        // event_loop_new() -> loop handle
+        globals.borrow_mut().define(
+            "event_loop_new".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("event_loop_new", 0, |_args| {
+                let loop_val = EventLoop {
+                    watches: Vec::new(),
+                    timers: Vec::new(),
+                    next_timer_id: 1,
+                    stopped: false,
+                };
+                let id = register_loop(loop_val);
+                Ok(Value::Integer(id))
+            }))),
+        );
+
+        // event_loop_stop(loop)
+        globals.borrow_mut().define(
+            "event_loop_stop".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("event_loop_stop", 1, |args| {
+                let loop_id = args[0]
+                    .as_integer()
+                    .ok_or("event_loop_stop() expects loop id")?;
+                let _ = with_loop_mut(loop_id, |loop_ref| loop_ref.stopped = true)?;
+                Ok(Value::Nil)
+            }))),
+        );
+
+        // event_watch_read(loop, sock, callback)
+        globals.borrow_mut().define(
+            "event_watch_read".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "event_watch_read",
+                3,
+                |args| {
+                    #[cfg(all(feature = "native", unix))]
+                    let result = {
+                        let loop_id = args[0]
+                            .as_integer()
+                            .ok_or("event_watch_read() expects loop id")?;
+                        let sock_id = args[1]
+                            .as_integer()
+                            .ok_or("event_watch_read() expects socket id")?;
+                        let callback = args[2].clone();
+                        let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                        let _ = with_loop_mut(loop_id, |loop_ref| {
+                            if let Some(watch) =
+                                loop_ref.watches.iter_mut().find(|w| w.sock_id == sock_id)
+                            {
+                                watch.read_cb = callback.clone();
+                            } else {
+                                loop_ref.watches.push(LoopWatch {
+                                    sock_id,
+                                    fd: entry.fd,
+                                    read_cb: callback.clone(),
+                                    write_cb: Value::Nil,
+                                });
+                            }
+                        })?;
+                        Ok(Value::Nil)
+                    };
+
+                    #[cfg(not(all(feature = "native", unix)))]
+                    let result = {
+                        let _ = args;
+                        Err(
+                            "event_watch_read() requires the 'native' feature on unix targets"
+                                .to_string(),
+                        )
+                    };
+
+                    result
+                },
+            ))),
+        );
+
+        // event_watch_write(loop, sock, callback)
+        globals.borrow_mut().define(
+            "event_watch_write".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "event_watch_write",
+                3,
+                |args| {
+                    #[cfg(all(feature = "native", unix))]
+                    let result = {
+                        let loop_id = args[0]
+                            .as_integer()
+                            .ok_or("event_watch_write() expects loop id")?;
+                        let sock_id = args[1]
+                            .as_integer()
+                            .ok_or("event_watch_write() expects socket id")?;
+                        let callback = args[2].clone();
+                        let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
+                        let _ = with_loop_mut(loop_id, |loop_ref| {
+                            if let Some(watch) =
+                                loop_ref.watches.iter_mut().find(|w| w.sock_id == sock_id)
+                            {
+                                watch.write_cb = callback.clone();
+                            } else {
+                                loop_ref.watches.push(LoopWatch {
+                                    sock_id,
+                                    fd: entry.fd,
+                                    read_cb: Value::Nil,
+                                    write_cb: callback.clone(),
+                                });
+                            }
+                        })?;
+                        Ok(Value::Nil)
+                    };
+
+                    #[cfg(not(all(feature = "native", unix)))]
+                    let result = {
+                        let _ = args;
+                        Err(
+                            "event_watch_write() requires the 'native' feature on unix targets"
+                                .to_string(),
+                        )
+                    };
+
+                    result
+                },
+            ))),
+        );
+
+        // event_unwatch(loop, sock)
+        globals.borrow_mut().define(
+            "event_unwatch".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("event_unwatch", 2, |args| {
+                let loop_id = args[0]
+                    .as_integer()
+                    .ok_or("event_unwatch() expects loop id")?;
+                let sock_id = args[1]
+                    .as_integer()
+                    .ok_or("event_unwatch() expects socket id")?;
+                let mut removed = false;
+                let _ = with_loop_mut(loop_id, |loop_ref| {
+                    let before = loop_ref.watches.len();
+                    loop_ref.watches.retain(|w| w.sock_id != sock_id);
+                    removed = loop_ref.watches.len() != before;
+                })?;
+                Ok(Value::Bool(removed))
+            }))),
+        );
+
+        // event_loop_poll(loop, timeout_ms) -> list of events
+        globals.borrow_mut().define(
+            "event_loop_poll".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("event_loop_poll", 2, |args| {
+                let loop_id = args[0]
+                    .as_integer()
+                    .ok_or("event_loop_poll() expects loop id")?;
+                let timeout_ms = match &args[1] {
+                    Value::Nil => -1,
+                    Value::Integer(n) => *n,
+                    Value::Float(f) => *f as i64,
+                    _ => return Err("event_loop_poll() expects timeout integer or nil".to_string()),
+                };
+
+                let events = with_loop_mut(loop_id, |loop_ref| {
+                    if loop_ref.stopped {
+                        return Value::List(Rc::new(RefCell::new(vec![event_dict(
+                            "stop", None, None, None,
+                        )])));
+                    }
+
+                    #[cfg(all(feature = "native", unix))]
+                    let result = {
+                        let now = mono_ns_now();
+                        let mut next_due: Option<i64> = None;
+                        for timer in loop_ref.timers.iter() {
+                            if timer.cancelled {
+                                continue;
+                            }
+                            // Whole ms, rounded up so poll() never wakes before it's due
+                            let mut diff = (timer.next_fire_ns - now + 999_999) / 1_000_000;
+                            if diff < 0 {
+                                diff = 0;
+                            }
+                            next_due = Some(match next_due {
+                                Some(prev) => prev.min(diff),
+                                None => diff,
+                            });
+                        }
+
+                        let mut wait_ms = timeout_ms;
+                        if wait_ms < 0 {
+                            wait_ms = next_due.unwrap_or(-1);
+                        } else if let Some(due) = next_due {
+                            if due >= 0 && due < wait_ms {
+                                wait_ms = due;
+                            }
+                        }
+
+                        let poll_timeout = if wait_ms < 0 {
+                            -1
+                        } else if wait_ms > i32::MAX as i64 {
+                            i32::MAX
+                        } else {
+                            wait_ms as i32
+                        };
+
+                        let mut fds: Vec<libc::pollfd> = loop_ref
+                            .watches
+                            .iter()
+                            .map(|watch| libc::pollfd {
+                                fd: watch.fd,
+                                events: {
+                                    let mut ev = 0;
+                                    if !matches!(watch.read_cb, Value::Nil) {
+                                        ev |= libc::POLLIN;
+                                    }
+                                    if !matches!(watch.write_cb, Value::Nil) {
+                                        ev |= libc::POLLOUT;
+                                    }
+                                    ev
+                                },
+                                revents: 0,
+                            })
+                            .collect();
+
+                        if poll_timeout != 0 || !fds.is_empty() {
+                            let rc = unsafe {
+                                libc::poll(
+                                    fds.as_mut_ptr(),
+                                    fds.len() as libc::nfds_t,
+                                    poll_timeout,
+                                )
+                            };
+                            if rc < 0 {
+                                return Value::List(Rc::new(RefCell::new(Vec::new())));
+                            }
+                        }
+
+                        let mut out: Vec<Value> = Vec::new();
+                        for (idx, pfd) in fds.iter().enumerate() {
+                            let watch = &loop_ref.watches[idx];
+                            if (pfd.revents & libc::POLLIN) != 0
+                                && !matches!(watch.read_cb, Value::Nil)
+                            {
+                                out.push(event_dict(
+                                    "read",
+                                    Some(watch.sock_id),
+                                    None,
+                                    Some(watch.read_cb.clone()),
+                                ));
+                            }
+                            if (pfd.revents & libc::POLLOUT) != 0
+                                && !matches!(watch.write_cb, Value::Nil)
+                            {
+                                out.push(event_dict(
+                                    "write",
+                                    Some(watch.sock_id),
+                                    None,
+                                    Some(watch.write_cb.clone()),
+                                ));
+                            }
+                        }
+
+                        let now2 = mono_ns_now();
+                        for timer in loop_ref.timers.iter_mut() {
+                            if timer.cancelled {
+                                continue;
+                            }
+                            if timer.next_fire_ns <= now2 {
+                                out.push(event_dict(
+                                    "timer",
+                                    None,
+                                    Some(timer.id),
+                                    Some(timer.callback.clone()),
+                                ));
+                                if timer.interval_ns > 0 {
+                                    while timer.next_fire_ns <= now2 {
+                                        timer.next_fire_ns += timer.interval_ns;
+                                    }
+                                } else {
+                                    timer.cancelled = true;
+                                }
+                            }
+                        }
+                        loop_ref.timers.retain(|t| !t.cancelled);
+
+                        Value::List(Rc::new(RefCell::new(out)))
+                    };
+
+                    #[cfg(not(all(feature = "native", unix)))]
+                    let result = {
+                        let _ = timeout_ms;
+                        let mut out: Vec<Value> = Vec::new();
+                        let now2 = mono_ns_now();
+                        for timer in loop_ref.timers.iter_mut() {
+                            if timer.cancelled {
+                                continue;
+                            }
+                            if timer.next_fire_ns <= now2 {
+                                out.push(event_dict(
+                                    "timer",
+                                    None,
+                                    Some(timer.id),
+                                    Some(timer.callback.clone()),
+                                ));
+                                if timer.interval_ns > 0 {
+                                    while timer.next_fire_ns <= now2 {
+                                        timer.next_fire_ns += timer.interval_ns;
+                                    }
+                                } else {
+                                    timer.cancelled = true;
+                                }
+                            }
+                        }
+                        loop_ref.timers.retain(|t| !t.cancelled);
+
+                        Value::List(Rc::new(RefCell::new(out)))
+                    };
+
+                    result
+                })?;
+
+                Ok(events)
+            }))),
+        );
+
+        // event_loop_poll_into(loop, events, timeout_ms) -> count, refilling events in place
+        let event_loop_poll = globals
+            .borrow()
+            .get("event_loop_poll")
+            .and_then(|v| v.as_native_function())
+            .expect("event_loop_poll is defined above");
+        globals.borrow_mut().define(
+            "event_loop_poll_into".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "event_loop_poll_into",
+                3,
+                move |args| {
+                    let Value::List(target) = &args[1] else {
+                        return Err("event_loop_poll_into() expects a list".to_string());
+                    };
+                    let polled = (event_loop_poll.func)(vec![args[0].clone(), args[2].clone()])?;
+                    let Value::List(polled) = polled else {
+                        return Ok(Value::Integer(0));
+                    };
+                    let fresh = polled.borrow().clone();
+                    let count = fresh.len() as i64;
+                    *target.borrow_mut() = fresh;
+                    Ok(Value::Integer(count))
+                },
+            ))),
+        );
+
+        // event_loop_run(loop, timeout_ms) - poll and call callbacks until stopped; a
+        // higher-order builtin because the callbacks are user functions
+        globals.borrow_mut().define(
+            "event_loop_run".to_string(),
+            Value::String("__builtin_event_loop_run__".into()),
+        );
+
+        // timer_after(loop, ms, callback) / timer_every(loop, ms, callback) and the
+        // timer_after_ns / timer_every_ns forms -> timer id
+        for (name, unit_ns, repeating) in [
+            ("timer_after", 1_000_000, false),
+            ("timer_every", 1_000_000, true),
+            ("timer_after_ns", 1, false),
+            ("timer_every_ns", 1, true),
+        ] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, 3, move |args| {
+                    add_loop_timer(name, &args, unit_ns, repeating)
+                }))),
+            );
+        }
+
+        // timer_cancel(loop, timer_id) -> bool
+        globals.borrow_mut().define(
+            "timer_cancel".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("timer_cancel", 2, |args| {
+                let loop_id = args[0]
+                    .as_integer()
+                    .ok_or("timer_cancel() expects loop id")?;
+                let timer_id = args[1]
+                    .as_integer()
+                    .ok_or("timer_cancel() expects timer id")?;
+                let mut cancelled = false;
+                let _ = with_loop_mut(loop_id, |loop_ref| {
+                    for timer in loop_ref.timers.iter_mut() {
+                        if timer.id == timer_id && !timer.cancelled {
+                            timer.cancelled = true;
+                            cancelled = true;
+                        }
+                    }
+                })?;
+                Ok(Value::Bool(cancelled))
+            }))),
+        );
+
+        // co_spawn / co_yield / co_count / co_run: coroutines switch native stacks, which
+        // the tree-walker doesn't have.
+        for (name, arity) in [
+            ("co_spawn", 3),
+            ("co_yield", 0),
+            ("co_count", 1),
+            ("co_run", 1),
+        ] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, arity, move |_args| {
+                    Err(format!("{}() needs a native build", name))
+                }))),
+            );
+        }
+
+        // event_loop_wakeup / event_loop_post / reactor_start / reactor_stop: interpreter
+        // loops belong to the one thread that runs them, so there's nobody to wake.
+        for (name, arity) in [
+            ("event_loop_wakeup", 1),
+            ("event_loop_post", 2),
+            ("reactor_start", 2),
+            ("reactor_stop", 1),
+        ] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, arity, move |_args| {
+                    Err(format!("{}() needs a native build", name))
+                }))),
+            );
+        }
+
+        // shm_ring_*: shared-memory rings between processes are native only
+        for (name, arity) in [
+            ("shm_ring_create", 2),
+            ("shm_ring_open", 1),
+            ("shm_ring_send", 2),
+            ("shm_ring_recv", usize::MAX),
+            ("shm_ring_recv_into", 2),
+            ("shm_ring_fd", 1),
+            ("shm_ring_close", 1),
+        ] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, arity, move |_args| {
+                    Err(format!("{}() needs a native build", name))
+                }))),
+            );
+        }
+
+        // kv_*: the key-value store's log, index and committer live in the C runtime
+        for (name, arity) in [
+            ("kv_open", 1),
+            ("kv_get", 2),
+            ("kv_put", 3),
+            ("kv_delete", 2),
+            ("kv_scan", usize::MAX),
+            ("kv_sync", 1),
+            ("kv_compact", 1),
+            ("kv_stats", 1),
+            ("kv_close", 1),
+        ] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, arity, move |_args| {
+                    Err(format!("{}() needs a native build", name))
+                }))),
+            );
+        }
+
+        // dtls_session_*: the socketless DTLS state machine lives in the native runtime
+        for (name, arity) in [
+            ("dtls_session_new", 1),
+            ("dtls_session_step", 2),
+            ("dtls_session_srtp", 1),
+            ("dtls_session_close", 1),
+        ] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, arity, move |_args| {
+                    Err(format!("{}() needs a native build", name))
+                }))),
+            );
+        }
+
+        // bytes_compress, bytes_decompress, gzip_stream_*: deflate lives in the C runtime
+        for (name, arity) in [
+            ("bytes_compress", usize::MAX),
+            ("bytes_decompress", usize::MAX),
+            ("gzip_stream_new", usize::MAX),
+            ("gzip_stream_write", 2),
+            ("gzip_stream_flush", 1),
+            ("gzip_stream_close", 1),
+        ] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, arity, move |_args| {
+                    Err(format!("{}() needs a native build", name))
+                }))),
+            );
+        }
+
+        // thread_spawn(func, args_list) -> thread handle (interpreter: native funcs only)
+        globals.borrow_mut().define(
+            "thread_spawn".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "thread_spawn",
+                usize::MAX,
+                |args| {
+                    if args.len() < 2 || args.len() > 3 {
+                        return Err("thread_spawn() expects 2 or 3 arguments".to_string());
+                    }
+                    // cpus/priority/stack_kb/name only mean something to a real thread
+                    if args.len() == 3 && !matches!(args[2], Value::Nil | Value::Dict(_)) {
+                        return Err("thread_spawn() options must be a dict".to_string());
+                    }
+                    let func = args[0].clone();
+                    let args_list = &args[1];
+                    let arg_vec = match args_list {
+                        Value::Nil => Vec::new(),
+                        Value::List(list) => list.borrow().clone(),
+                        _ => {
+                            return Err(
+                                "thread_spawn() expects a list of arguments or nil".to_string()
+                            )
+                        }
+                    };
+                    let result = match func {
+                        Value::NativeFunction(native) => (native.func)(arg_vec)?,
+                        _ => {
+                            return Err(
+                                "thread_spawn() only supports native functions in interpreter"
+                                    .to_string(),
+                            )
+                        }
+                    };
+                    let id = register_thread(ThreadHandle {
+                        result,
+                        detached: false,
+                    });
+                    Ok(Value::Integer(id))
+                },
+            ))),
+        );
+
+        // cpu_count() -> online cores
+        globals.borrow_mut().define(
+            "cpu_count".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("cpu_count", 0, |_args| {
+                Ok(Value::Integer(online_cpus()))
+            }))),
+        );
+
+        // numa_node_of_cpu(cpu) -> node, 0 without NUMA, -1 for no such core
+        globals.borrow_mut().define(
+            "numa_node_of_cpu".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "numa_node_of_cpu",
+                1,
+                |args| {
+                    let cpu = args[0]
+                        .as_integer()
+                        .ok_or("numa_node_of_cpu() expects a core number")?;
+                    if cpu < 0 {
+                        return Ok(Value::Integer(-1));
+                    }
+                    let dir = format!("/sys/devices/system/cpu/cpu{}", cpu);
+                    let Ok(entries) = std::fs::read_dir(&dir) else {
+                        return Ok(Value::Integer(if cpu < online_cpus() { 0 } else { -1 }));
+                    };
+                    let node = entries
+                        .flatten()
+                        .filter_map(|e| e.file_name().to_str()?.strip_prefix("node")?.parse().ok())
+                        .next()
+                        .unwrap_or(0);
+                    Ok(Value::Integer(node))
+                },
+            ))),
+        );
+
+        // thread_join(thread_handle)
+        globals.borrow_mut().define(
+            "thread_join".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("thread_join", 1, |args| {
+                let thread_id = args[0]
+                    .as_integer()
+                    .ok_or("thread_join() expects thread handle")?;
+                let result = with_thread_mut(thread_id, |handle| {
+                    if handle.detached {
+                        None
+                    } else {
+                        Some(handle.result.clone())
+                    }
+                })?;
+                if let Some(val) = result {
+                    Ok(val)
+                } else {
+                    Err("thread_join() cannot join detached thread".to_string())
+                }
+            }))),
+        );
+
+        // thread_detach(thread_handle)
+        globals.borrow_mut().define(
+            "thread_detach".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("thread_detach", 1, |args| {
+                let thread_id = args[0]
+                    .as_integer()
+                    .ok_or("thread_detach() expects thread handle")?;
+                let _ = with_thread_mut(thread_id, |handle| handle.detached = true)?;
+                Ok(Value::Nil)
+            }))),
+        );
+
+        // pool_submit(func, args) -> handle; runs straight away like thread_spawn
+        globals.borrow_mut().define(
+            "pool_submit".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("pool_submit", 2, |args| {
+                let arg_vec = match &args[1] {
+                    Value::Nil => Vec::new(),
+                    Value::List(list) => list.borrow().clone(),
+                    _ => return Err("pool_submit() expects a list of arguments or nil".to_string()),
+                };
+                let result = match &args[0] {
+                    Value::NativeFunction(native) => (native.func)(arg_vec)?,
+                    _ => {
+                        return Err(
+                            "pool_submit() only supports native functions in interpreter"
+                                .to_string(),
+                        )
+                    }
+                };
+                let id = register_thread(ThreadHandle {
+                    result,
+                    detached: false,
+                });
+                Ok(Value::Integer(id))
+            }))),
+        );
+
+        // mutex_new()
+        globals.borrow_mut().define(
+            "mutex_new".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("mutex_new", 0, |_args| {
+                let id = register_mutex(MutexState { locked: false });
+                Ok(Value::Integer(id))
+            }))),
+        );
+
+        // mutex_lock(mutex)
+        globals.borrow_mut().define(
+            "mutex_lock".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("mutex_lock", 1, |args| {
+                let mutex_id = args[0]
+                    .as_integer()
+                    .ok_or("mutex_lock() expects mutex handle")?;
+                let _ = with_mutex_mut(mutex_id, |state| state.locked = true)?;
+                Ok(Value::Nil)
+            }))),
+        );
+
+        // mutex_unlock(mutex)
+        globals.borrow_mut().define(
+            "mutex_unlock".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("mutex_unlock", 1, |args| {
+                let mutex_id = args[0]
+                    .as_integer()
+                    .ok_or("mutex_unlock() expects mutex handle")?;
+                let _ = with_mutex_mut(mutex_id, |state| state.locked = false)?;
+                Ok(Value::Nil)
+            }))),
+        );
+
+        // mutex_try_lock(mutex) -> bool
+        globals.borrow_mut().define(
+            "mutex_try_lock".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("mutex_try_lock", 1, |args| {
+                let mutex_id = args[0]
+                    .as_integer()
+                    .ok_or("mutex_try_lock() expects mutex handle")?;
+                let locked = with_mutex_mut(mutex_id, |state| {
+                    if state.locked {
+                        false
+                    } else {
+                        state.locked = true;
+                        true
+                    }
+                })?;
+                Ok(Value::Bool(locked))
+            }))),
+        );
+
+        // condvar_new()
+        globals.borrow_mut().define(
+            "condvar_new".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("condvar_new", 0, |_args| {
+                let id = register_condvar(CondvarState);
+                Ok(Value::Integer(id))
+            }))),
+        );
+
+        // condvar_wait(condvar, mutex) -> bool (interpreter: immediate true)
+        globals.borrow_mut().define(
+            "condvar_wait".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("condvar_wait", 2, |args| {
+                let condvar_id = args[0]
+                    .as_integer()
+                    .ok_or("condvar_wait() expects condvar handle")?;
+                let _mutex_id = args[1]
+                    .as_integer()
+                    .ok_or("condvar_wait() expects mutex handle")?;
+                let _ = with_condvar_mut(condvar_id, |_state| ())?;
+                Ok(Value::Bool(true))
+            }))),
+        );
+
+        // condvar_timed_wait(condvar, mutex, timeout_ms) -> bool
+        globals.borrow_mut().define(
+            "condvar_timed_wait".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "condvar_timed_wait",
+                3,
+                |args| {
+                    let condvar_id = args[0]
+                        .as_integer()
+                        .ok_or("condvar_timed_wait() expects condvar handle")?;
+                    let _mutex_id = args[1]
+                        .as_integer()
+                        .ok_or("condvar_timed_wait() expects mutex handle")?;
+                    let _timeout = match &args[2] {
+                        Value::Integer(n) => *n,
+                        Value::Float(f) => *f as i64,
+                        _ => return Err("condvar_timed_wait() expects timeout integer".to_string()),
+                    };
+                    let _ = with_condvar_mut(condvar_id, |_state| ())?;
+                    Ok(Value::Bool(true))
+                },
+            ))),
+        );
+
+        // condvar_signal(condvar)
+        globals.borrow_mut().define(
+            "condvar_signal".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("condvar_signal", 1, |args| {
+                let condvar_id = args[0]
+                    .as_integer()
+                    .ok_or("condvar_signal() expects condvar handle")?;
+                let _ = with_condvar_mut(condvar_id, |_state| ())?;
+                Ok(Value::Nil)
+            }))),
+        );
+
+        // condvar_broadcast(condvar)
+        globals.borrow_mut().define(
+            "condvar_broadcast".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "condvar_broadcast",
+                1,
+                |args| {
+                    let condvar_id = args[0]
+                        .as_integer()
+                        .ok_or("condvar_broadcast() expects condvar handle")?;
+                    let _ = with_condvar_mut(condvar_id, |_state| ())?;
+                    Ok(Value::Nil)
+                },
+            ))),
+        );
+
+        // atomic_new(initial_int)
+        globals.borrow_mut().define(
+            "atomic_new".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("atomic_new", 1, |args| {
+                let value = match &args[0] {
+                    Value::Integer(n) => *n,
+                    Value::Float(f) => *f as i64,
+                    _ => return Err("atomic_new() expects integer".to_string()),
+                };
+                let id = register_atomic(AtomicState { value });
+                Ok(Value::Integer(id))
+            }))),
+        );
+
+        // atomic_load(atomic)
+        globals.borrow_mut().define(
+            "atomic_load".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("atomic_load", 1, |args| {
+                let atomic_id = args[0]
+                    .as_integer()
+                    .ok_or("atomic_load() expects atomic handle")?;
+                let value = with_atomic_mut(atomic_id, |state| state.value)?;
+                Ok(Value::Integer(value))
+            }))),
+        );
 
-	                        match session.mode {
-	                            TlsMode::Client => {
-                                let config = session
-	                                    .client_config
-                                    .as_ref()
-                                    .ok_or("Missing client config")?
-                                    .clone();
-                                let server_name = match ServerName::try_from(session.server_name.as_str()) {
-                                    Ok(server_name) => server_name,
-                                    Err(_) => return Err("Invalid server_name".to_string()),
-                                };
-                                let conn_result = {
-                                    #[cfg(test)]
-                                    {
-                                        if tls_take_force_next_client_conn_new_fail() {
-                                            Err(rustls::Error::General("injected".to_string()))
-                                        } else {
-                                            ClientConnection::new(config, server_name)
-                                        }
-                                    }
-                                    #[cfg(not(test))]
-                                    {
-                                        ClientConnection::new(config, server_name)
-                                    }
-                                };
-                                let mut conn = match conn_result {
-                                    Ok(conn) => conn,
-                                    Err(e) => return Err(e.to_string()),
-                                };
-	                                while conn.is_handshaking() {
-	                                    if let Err(e) = conn.complete_io(&mut stream) {
-	                                        return Err(format!("TLS handshake failed: {}", e));
-	                                    }
-	                                }
-	                                session.stream =
-	                                    Some(TlsStream::Client(StreamOwned::new(conn, stream)));
-	                            }
-	                            TlsMode::Server => {
-	                                let config = session
-	                                    .server_config
-	                                    .as_ref()
-	                                    .ok_or("Missing server config")?
-	                                    .clone();
-	                                let conn_result = {
-	                                    #[cfg(test)]
-	                                    {
-	                                        if tls_take_force_next_server_conn_new_fail() {
-	                                            Err(rustls::Error::General("injected".to_string()))
-	                                        } else {
-	                                            ServerConnection::new(config)
-	                                        }
-	                                    }
-	                                    #[cfg(not(test))]
-	                                    {
-	                                        ServerConnection::new(config)
-	                                    }
-	                                };
-	                                let mut conn = match conn_result {
-	                                    Ok(conn) => conn,
-	                                    Err(e) => return Err(e.to_string()),
-	                                };
-	                                while conn.is_handshaking() {
-	                                    if let Err(e) = conn.complete_io(&mut stream) {
-	                                        return Err(format!("TLS handshake failed: {}", e));
-	                                    }
-	                                }
-	                                session.stream =
-	                                    Some(TlsStream::Server(StreamOwned::new(conn, stream)));
-	                            }
-	                        }
-	                        Ok(())
-	                    });
+        // atomic_store(atomic, value)
+        globals.borrow_mut().define(
+            "atomic_store".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("atomic_store", 2, |args| {
+                let atomic_id = args[0]
+                    .as_integer()
+                    .ok_or("atomic_store() expects atomic handle")?;
+                let value = match &args[1] {
+                    Value::Integer(n) => *n,
+                    Value::Float(f) => *f as i64,
+                    _ => return Err("atomic_store() expects integer".to_string()),
+                };
+                let _ = with_atomic_mut(atomic_id, |state| state.value = value)?;
+                Ok(Value::Nil)
+            }))),
+        );
 
-                    match res {
-                        Ok(_) => Ok(result_ok(Value::Nil)),
-                        Err(e) => Ok(result_err(e, -1)),
+        // atomic_add(atomic, delta) -> new value
+        globals.borrow_mut().define(
+            "atomic_add".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("atomic_add", 2, |args| {
+                let atomic_id = args[0]
+                    .as_integer()
+                    .ok_or("atomic_add() expects atomic handle")?;
+                let delta = match &args[1] {
+                    Value::Integer(n) => *n,
+                    Value::Float(f) => *f as i64,
+                    _ => return Err("atomic_add() expects integer".to_string()),
+                };
+                let value = with_atomic_mut(atomic_id, |state| {
+                    state.value += delta;
+                    state.value
+                })?;
+                Ok(Value::Integer(value))
+            }))),
+        );
+
+        // atomic_cas(atomic, expected, desired) -> bool
+        globals.borrow_mut().define(
+            "atomic_cas".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("atomic_cas", 3, |args| {
+                let atomic_id = args[0]
+                    .as_integer()
+                    .ok_or("atomic_cas() expects atomic handle")?;
+                let expected = match &args[1] {
+                    Value::Integer(n) => *n,
+                    Value::Float(f) => *f as i64,
+                    _ => return Err("atomic_cas() expects integer".to_string()),
+                };
+                let desired = match &args[2] {
+                    Value::Integer(n) => *n,
+                    Value::Float(f) => *f as i64,
+                    _ => return Err("atomic_cas() expects integer".to_string()),
+                };
+                let swapped = with_atomic_mut(atomic_id, |state| {
+                    if state.value == expected {
+                        state.value = desired;
+                        true
+                    } else {
+                        false
                     }
+                })?;
+                Ok(Value::Bool(swapped))
+            }))),
+        );
+
+        // atomic_load_acquire(atomic) / atomic_store_release(atomic, value): ordering only
+        // matters in native builds; the interpreter's cells are always sequentially consistent.
+        globals.borrow_mut().define(
+            "atomic_load_acquire".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "atomic_load_acquire",
+                1,
+                |args| {
+                    let atomic_id = args[0]
+                        .as_integer()
+                        .ok_or("atomic_load_acquire() expects atomic handle")?;
+                    let value = with_atomic_mut(atomic_id, |state| state.value)?;
+                    Ok(Value::Integer(value))
+                },
+            ))),
+        );
+        globals.borrow_mut().define(
+            "atomic_store_release".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "atomic_store_release",
+                2,
+                |args| {
+                    let atomic_id = args[0]
+                        .as_integer()
+                        .ok_or("atomic_store_release() expects atomic handle")?;
+                    let value = match &args[1] {
+                        Value::Integer(n) => *n,
+                        Value::Float(f) => *f as i64,
+                        _ => return Err("atomic_store_release() expects integer".to_string()),
+                    };
+                    let _ = with_atomic_mut(atomic_id, |state| state.value = value)?;
+                    Ok(Value::Nil)
+                },
+            ))),
+        );
+
+        // atomic_fetch_max(atomic, value) / atomic_fetch_min(atomic, value) -> previous value
+        for (name, want_max) in [("atomic_fetch_max", true), ("atomic_fetch_min", false)] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, 2, move |args| {
+                    let atomic_id = args[0]
+                        .as_integer()
+                        .ok_or_else(|| format!("{}() expects atomic handle", name))?;
+                    let value = match &args[1] {
+                        Value::Integer(n) => *n,
+                        Value::Float(f) => *f as i64,
+                        _ => return Err(format!("{}() expects integer", name)),
+                    };
+                    let previous = with_atomic_mut(atomic_id, |state| {
+                        let previous = state.value;
+                        state.value = if want_max {
+                            previous.max(value)
+                        } else {
+                            previous.min(value)
+                        };
+                        previous
+                    })?;
+                    Ok(Value::Integer(previous))
                 }))),
             );
+        }
+
+        // chan_new(capacity)
+        globals.borrow_mut().define(
+            "chan_new".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("chan_new", 1, |args| {
+                let cap = match &args[0] {
+                    Value::Integer(n) => *n,
+                    Value::Float(f) => *f as i64,
+                    _ => return Err("chan_new() expects capacity integer".to_string()),
+                };
+                if cap < 0 {
+                    return Err("chan_new() expects non-negative capacity".to_string());
+                }
+                let id = register_channel(ChannelState {
+                    queue: VecDeque::new(),
+                    capacity: cap,
+                    closed: false,
+                });
+                Ok(Value::Integer(id))
+            }))),
+        );
+
+        // chan_send(chan, value) -> bool
+        globals.borrow_mut().define(
+            "chan_send".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("chan_send", 2, |args| {
+                let chan_id = args[0]
+                    .as_integer()
+                    .ok_or("chan_send() expects channel handle")?;
+                let val = args[1].clone();
+                let sent = with_channel_mut(chan_id, |state| {
+                    if state.closed {
+                        return false;
+                    }
+                    if state.capacity > 0 && state.queue.len() as i64 >= state.capacity {
+                        return false;
+                    }
+                    state.queue.push_back(val.clone());
+                    true
+                })?;
+                Ok(Value::Bool(sent))
+            }))),
+        );
+
+        // chan_recv(chan) -> value or nil
+        globals.borrow_mut().define(
+            "chan_recv".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("chan_recv", 1, |args| {
+                let chan_id = args[0]
+                    .as_integer()
+                    .ok_or("chan_recv() expects channel handle")?;
+                let value = with_channel_mut(chan_id, |state| state.queue.pop_front())?;
+                Ok(value.unwrap_or(Value::Nil))
+            }))),
+        );
+
+        // chan_try_recv(chan) -> value or nil
+        globals.borrow_mut().define(
+            "chan_try_recv".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("chan_try_recv", 1, |args| {
+                let chan_id = args[0]
+                    .as_integer()
+                    .ok_or("chan_try_recv() expects channel handle")?;
+                let value = with_channel_mut(chan_id, |state| state.queue.pop_front())?;
+                Ok(value.unwrap_or(Value::Nil))
+            }))),
+        );
 
-            // tls_send(tls, bytes)
-            globals.borrow_mut().define(
-                "tls_send".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("tls_send", 2, |args| {
-                    let tls_id = args[0]
+        // chan_recv_timeout(chan, timeout_ms) -> value or nil
+        globals.borrow_mut().define(
+            "chan_recv_timeout".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "chan_recv_timeout",
+                2,
+                |args| {
+                    let chan_id = args[0]
                         .as_integer()
-                        .ok_or("tls_send() expects TLS handle")?;
-                    let bytes = match &args[1] {
-                        Value::Bytes(b) => b.borrow(),
-                        _ => return Err("tls_send() expects bytes".to_string()),
-                    };
-                    let res = with_tls_mut(tls_id, |session| {
-                        let stream = session.stream.as_mut().ok_or("TLS not connected")?;
-                        let write_result = {
-                            #[cfg(test)]
-                            {
-                                if tls_take_force_next_send_fail() {
-                                    Err(std::io::Error::new(
-                                        std::io::ErrorKind::Other,
-                                        "injected send error",
-                                    ))
-                                } else {
-                                    match stream {
-                                        TlsStream::Client(s) => s.write(bytes.as_slice()),
-                                        TlsStream::Server(s) => s.write(bytes.as_slice()),
-                                    }
-                                }
-                            }
-                            #[cfg(not(test))]
-                            {
-                                match stream {
-                                    TlsStream::Client(s) => s.write(bytes.as_slice()),
-                                    TlsStream::Server(s) => s.write(bytes.as_slice()),
-                                }
-                            }
-                        };
-                        let n = match write_result {
-                            Ok(n) => n,
-                            Err(e) => return Err(format!("TLS send failed: {}", e)),
-                        };
-                        match stream {
-                            TlsStream::Client(s) => {
-                                let _ = s.flush();
-                            }
-                            TlsStream::Server(s) => {
-                                let _ = s.flush();
-                            }
+                        .ok_or("chan_recv_timeout() expects channel handle")?;
+                    let value = with_channel_mut(chan_id, |state| state.queue.pop_front())?;
+                    Ok(value.unwrap_or(Value::Nil))
+                },
+            ))),
+        );
+
+        // chan_send_many(chan, list) -> number sent
+        globals.borrow_mut().define(
+            "chan_send_many".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("chan_send_many", 2, |args| {
+                let chan_id = args[0]
+                    .as_integer()
+                    .ok_or("chan_send_many() expects channel handle")?;
+                let items = match &args[1] {
+                    Value::List(list) => list.borrow().clone(),
+                    _ => return Err("chan_send_many() expects a list".to_string()),
+                };
+                let sent = with_channel_mut(chan_id, |state| {
+                    let mut sent = 0;
+                    for item in items {
+                        if state.closed
+                            || (state.capacity > 0 && state.queue.len() as i64 >= state.capacity)
+                        {
+                            break;
                         }
-                        Ok(n as i64)
-                    });
-                    match res {
-                        Ok(n) => Ok(result_ok(Value::Integer(n))),
-                        Err(e) => Ok(result_err(e, -1)),
+                        state.queue.push_back(item);
+                        sent += 1;
                     }
-                }))),
-            );
+                    sent
+                })?;
+                Ok(Value::Integer(sent))
+            }))),
+        );
 
-            // tls_recv(tls, max_len)
-            globals.borrow_mut().define(
-                "tls_recv".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("tls_recv", 2, |args| {
-                    let tls_id = args[0]
-                        .as_integer()
-                        .ok_or("tls_recv() expects TLS handle")?;
-                    let max_len = args[1]
+        // chan_recv_many(chan, max_count) -> list of up to max_count values
+        globals.borrow_mut().define(
+            "chan_recv_many".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("chan_recv_many", 2, |args| {
+                let chan_id = args[0]
+                    .as_integer()
+                    .ok_or("chan_recv_many() expects channel handle")?;
+                let max_count = match &args[1] {
+                    Value::Integer(n) => (*n).max(1) as usize,
+                    Value::Float(f) => (*f as i64).max(1) as usize,
+                    _ => return Err("chan_recv_many() expects count integer".to_string()),
+                };
+                let values = with_channel_mut(chan_id, |state| {
+                    let take = max_count.min(state.queue.len());
+                    state.queue.drain(..take).collect::<Vec<_>>()
+                })?;
+                Ok(Value::List(Rc::new(RefCell::new(values))))
+            }))),
+        );
+
+        // chan_select(chans, timeout_ms) -> [index, value] or nil
+        // Single-threaded, so nothing can arrive while waiting: take from the first
+        // non-empty channel or return nil straight away.
+        globals.borrow_mut().define(
+            "chan_select".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("chan_select", 2, |args| {
+                let chans = match &args[0] {
+                    Value::List(items) => items.borrow().clone(),
+                    _ => return Err("chan_select() expects a list o' channels".to_string()),
+                };
+                for (index, chan) in chans.iter().enumerate() {
+                    let chan_id = chan
                         .as_integer()
-                        .ok_or("tls_recv() expects max_len integer")?;
-                    let max_len = if max_len < 0 { 0 } else { max_len } as usize;
-                    let res = with_tls_mut(tls_id, |session| {
-                        let stream = session.stream.as_mut().ok_or("TLS not connected")?;
-                        let mut buf = vec![0u8; max_len];
-                        let read_result = {
-                            #[cfg(test)]
-                            {
-                                if tls_take_force_next_recv_fail() {
-                                    Err(std::io::Error::new(
-                                        std::io::ErrorKind::Other,
-                                        "injected recv error",
-                                    ))
-                                } else {
-                                    match stream {
-                                        TlsStream::Client(s) => s.read(&mut buf),
-                                        TlsStream::Server(s) => s.read(&mut buf),
-                                    }
-                                }
-                            }
-                            #[cfg(not(test))]
-                            {
-                                match stream {
-                                    TlsStream::Client(s) => s.read(&mut buf),
-                                    TlsStream::Server(s) => s.read(&mut buf),
-                                }
-                            }
-                        };
-                        let n = match read_result {
-                            Ok(n) => n,
-                            Err(e) => return Err(format!("TLS recv failed: {}", e)),
-                        };
-                        buf.truncate(n);
-                        Ok(buf)
-                    });
-                    match res {
-                        Ok(buf) => Ok(result_ok(Value::Bytes(Rc::new(RefCell::new(buf))))),
-                        Err(e) => Ok(result_err(e, -1)),
+                        .ok_or("chan_select() expects channel handles")?;
+                    let value = with_channel_mut(chan_id, |state| state.queue.pop_front())?;
+                    if let Some(value) = value {
+                        return Ok(Value::List(Rc::new(RefCell::new(vec![
+                            Value::Integer(index as i64),
+                            value,
+                        ]))));
                     }
-                }))),
-            );
+                }
+                Ok(Value::Nil)
+            }))),
+        );
 
-            // tls_close(tls)
-            globals.borrow_mut().define(
-                "tls_close".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("tls_close", 1, |args| {
-                    let tls_id = args[0]
-                        .as_integer()
-                        .ok_or("tls_close() expects TLS handle")?;
-                    remove_tls(tls_id);
-                    Ok(result_ok(Value::Nil))
-                }))),
-            );
+        // chan_fd(chan) -> fd
+        globals.borrow_mut().define(
+            "chan_fd".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("chan_fd", 1, |_args| {
+                Err("chan_fd() needs a native build".to_string())
+            }))),
+        );
+
+        // chan_close(chan)
+        globals.borrow_mut().define(
+            "chan_close".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("chan_close", 1, |args| {
+                let chan_id = args[0]
+                    .as_integer()
+                    .ok_or("chan_close() expects channel handle")?;
+                let _ = with_channel_mut(chan_id, |state| state.closed = true)?;
+                Ok(Value::Nil)
+            }))),
+        );
+
+        // chan_is_closed(chan) -> bool
+        globals.borrow_mut().define(
+            "chan_is_closed".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("chan_is_closed", 1, |args| {
+                let chan_id = args[0]
+                    .as_integer()
+                    .ok_or("chan_is_closed() expects channel handle")?;
+                let closed = with_channel_mut(chan_id, |state| state.closed)?;
+                Ok(Value::Bool(closed))
+            }))),
+        );
+
+        // type - get type of value (whit_kind in Scots!)
+        globals.borrow_mut().define(
+            "whit_kind".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "whit_kind",
+                1,
+                |args| match &args[0] {
+                    Value::NativeObject(obj) => Ok(Value::String(obj.type_name().into())),
+                    _ => Ok(Value::String(args[0].type_name().into())),
+                },
+            ))),
+        );
+
+        // str - convert to string (tae_string in Scots!)
+        globals.borrow_mut().define(
+            "tae_string".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("tae_string", 1, |args| {
+                Ok(Value::String(format!("{}", args[0]).into()))
+            }))),
+        );
+
+        // int - convert to integer (tae_int in Scots!)
+        globals.borrow_mut().define(
+            "tae_int".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "tae_int",
+                1,
+                |args| match &args[0] {
+                    Value::Integer(n) => Ok(Value::Integer(*n)),
+                    Value::Float(f) => Ok(Value::Integer(*f as i64)),
+                    Value::String(s) => s
+                        .parse::<i64>()
+                        .map(Value::Integer)
+                        .map_err(|_| format!("Cannae turn '{}' intae an integer", s)),
+                    Value::Bool(b) => Ok(Value::Integer(if *b { 1 } else { 0 })),
+                    _ => Err(format!(
+                        "Cannae turn {} intae an integer",
+                        args[0].type_name()
+                    )),
+                },
+            ))),
+        );
+
+        // float - convert to float (tae_float in Scots!)
+        globals.borrow_mut().define(
+            "tae_float".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "tae_float",
+                1,
+                |args| match &args[0] {
+                    Value::Integer(n) => Ok(Value::Float(*n as f64)),
+                    Value::Float(f) => Ok(Value::Float(*f)),
+                    Value::String(s) => s
+                        .parse::<f64>()
+                        .map(Value::Float)
+                        .map_err(|_| format!("Cannae turn '{}' intae a float", s)),
+                    _ => Err(format!("Cannae turn {} intae a float", args[0].type_name())),
+                },
+            ))),
+        );
+
+        // push - add to list (shove in Scots!)
+        globals.borrow_mut().define(
+            "shove".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("shove", 2, |args| {
+                if let Value::List(list) = &args[0] {
+                    list.borrow_mut().push(args[1].clone());
+                    Ok(Value::Nil)
+                } else {
+                    Err("shove() expects a list as first argument".to_string())
+                }
+            }))),
+        );
+
+        // pop - remove from list (yank in Scots!)
+        globals.borrow_mut().define(
+            "yank".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("yank", 1, |args| {
+                if let Value::List(list) = &args[0] {
+                    list.borrow_mut()
+                        .pop()
+                        .ok_or_else(|| "Cannae yank fae an empty list!".to_string())
+                } else {
+                    Err("yank() expects a list".to_string())
+                }
+            }))),
+        );
 
-            // dtls_server_new(config)
-            globals.borrow_mut().define(
-                "dtls_server_new".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("dtls_server_new", 1, |args| {
-                    let cfg = dtls_config_from_value(&args[0])?;
-                    let id = register_dtls(cfg);
-                    Ok(result_ok(Value::Integer(id)))
-                }))),
-            );
+        // keys - get dictionary keys
+        globals.borrow_mut().define(
+            "keys".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("keys", 1, |args| {
+                if let Value::Dict(dict) = &args[0] {
+                    let keys: Vec<Value> = dict.borrow().keys().cloned().collect();
+                    Ok(Value::List(Rc::new(RefCell::new(keys))))
+                } else {
+                    Err("keys() expects a dict".to_string())
+                }
+            }))),
+        );
 
-            // dtls_handshake(dtls, sock)
-            globals.borrow_mut().define(
-                "dtls_handshake".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("dtls_handshake", 2, |args| {
-                    let dtls_id = args[0]
-                        .as_integer()
-                        .ok_or("dtls_handshake() expects DTLS handle")?;
-                    let sock_id = args[1]
-                        .as_integer()
-                        .ok_or("dtls_handshake() expects socket id")?;
-                    let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
-                    let cfg = match dtls_get(dtls_id) {
-                        Ok(cfg) => cfg,
-                        Err(e) => return Ok(result_err(e, -1)),
-                    };
+        // values - get dictionary values
+        globals.borrow_mut().define(
+            "values".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("values", 1, |args| {
+                if let Value::Dict(dict) = &args[0] {
+                    let vals: Vec<Value> = dict.borrow().values().cloned().collect();
+                    Ok(Value::List(Rc::new(RefCell::new(vals))))
+                } else {
+                    Err("values() expects a dict".to_string())
+                }
+            }))),
+        );
 
-                    let dup_fd = unsafe { libc::dup(entry.fd) };
-                    if dup_fd < 0 {
-                        let err = std::io::Error::last_os_error();
-                        let code = err.raw_os_error().unwrap_or(-1) as i64;
-                        return Ok(result_err(err.to_string(), code));
-                    }
+        // range - create a range
+        globals.borrow_mut().define(
+            "range".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("range", 2, |args| {
+                let start = args[0].as_integer().ok_or("range() expects integers")?;
+                let end = args[1].as_integer().ok_or("range() expects integers")?;
+                Ok(Interpreter::range_to_list(start, end, false))
+            }))),
+        );
 
-		                    let socket = unsafe { std::net::UdpSocket::from_raw_fd(dup_fd) };
-		                    let nonblocking = {
-		                        #[cfg(test)]
-		                        {
-		                            dtls_take_force_nonblocking_next_handshake()
-		                        }
-		                        #[cfg(not(test))]
-		                        {
-		                            false
-		                        }
-		                    };
-		                    if let Err(e) = socket.set_nonblocking(nonblocking) { return Ok(result_err(format!("DTLS socket setup failed: {}", e), -1)); }
+        // abs - absolute value
+        globals.borrow_mut().define(
+            "abs".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("abs", 1, |args| {
+                match &args[0] {
+                    Value::Integer(n) => Ok(Value::Integer(n.abs())),
+                    Value::Float(f) => Ok(Value::Float(f.abs())),
+                    _ => Err("abs() expects a number".to_string()),
+                }
+            }))),
+        );
 
-                    let remote = if let (Some(host), Some(port)) =
-                        (cfg.remote_host.clone(), cfg.remote_port)
-                    {
-                        match format!("{}:{}", host, port).parse() {
-                            Ok(addr) => addr,
-                            Err(_) => {
-                                return Ok(result_err("Invalid remote address".to_string(), -1))
-                            }
-                        }
-                    } else {
-                        match socket.peer_addr() {
-                            Ok(addr) => addr,
-                            Err(_) => {
-                                return Ok(result_err(
-                                    "dtls_handshake requires remote_host/remote_port".to_string(),
-                                    -1,
-                                ))
-                            }
-                        }
-                    };
+        // min - minimum value
+        globals.borrow_mut().define(
+            "min".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("min", 2, |args| {
+                match (&args[0], &args[1]) {
+                    (Value::Integer(a), Value::Integer(b)) => {
+                        Ok(Value::Integer(std::cmp::min(*a, *b)))
+                    }
+                    (Value::Float(a), Value::Float(b)) => Ok(Value::Float(a.min(*b))),
+                    _ => Err("min() expects two numbers of the same type".to_string()),
+                }
+            }))),
+        );
 
-                    if let Err(e) = socket.connect(remote) {
-                        return Ok(result_err(format!("DTLS connect failed: {}", e), -1));
+        // max - maximum value
+        globals.borrow_mut().define(
+            "max".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("max", 2, |args| {
+                match (&args[0], &args[1]) {
+                    (Value::Integer(a), Value::Integer(b)) => {
+                        Ok(Value::Integer(std::cmp::max(*a, *b)))
                     }
+                    (Value::Float(a), Value::Float(b)) => Ok(Value::Float(a.max(*b))),
+                    _ => Err("max() expects two numbers of the same type".to_string()),
+                }
+            }))),
+        );
 
-                    let channel = UdpChannel {
-                        socket,
-                        remote_addr: remote,
-                    };
+        // floor
+        globals.borrow_mut().define(
+            "floor".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "floor",
+                1,
+                |args| match &args[0] {
+                    Value::Float(f) => Ok(Value::Integer(f.floor() as i64)),
+                    Value::Integer(n) => Ok(Value::Integer(*n)),
+                    _ => Err("floor() expects a number".to_string()),
+                },
+            ))),
+        );
 
-                    let (stream, selected_profile) = if cfg.mode == TlsMode::Client {
-                        let mut builder = DtlsConnector::builder();
-                        for profile in &cfg.srtp_profiles {
-                            builder.add_srtp_profile(*profile);
-                        }
-                        if let Some(ca_pem) = &cfg.ca_pem {
-                            let cert = match udp_dtls::Certificate::from_pem(ca_pem.as_bytes()) {
-                                Ok(cert) => cert,
-                                Err(e) => {
-                                    return Ok(result_err(format!("Invalid CA cert: {}", e), -1))
-                                }
-                            };
-                            builder.add_root_certificate(cert);
-                        }
-                        if cfg.insecure {
-                            builder.danger_accept_invalid_certs(true);
-                            builder.danger_accept_invalid_hostnames(true);
-                        }
-		                        if let (Some(cert_pem), Some(key_pem)) = (&cfg.cert_pem, &cfg.key_pem) {
-		                            let identity = match identity_from_pem(cert_pem, key_pem) {
-		                                Ok(identity) => identity,
-		                                Err(e) => return Ok(result_err(e, -1)),
-		                            };
-		                            builder.identity(identity); }
-		                        let connector = match DtlsConnector::new(&builder) { Ok(connector) => connector, Err(e) => return Ok(result_err(format!("{}", e), -1)), };
-		                        let connect_result = {
-		                            #[cfg(test)]
-		                            {
-		                                if dtls_take_fail_next_connect() {
-		                                    Err(udp_dtls::HandshakeError::Failure(udp_dtls::Error::SrtpProfile(
-		                                        udp_dtls::SrtpProfileError::BadProfile,
-		                                    )))
-		                                } else {
-		                                    connector.connect(&cfg.server_name, channel)
-		                                }
-		                            }
-		                            #[cfg(not(test))]
-		                            {
-		                                connector.connect(&cfg.server_name, channel)
-		                            }
-		                        };
-		                        match connect_result {
-		                            Ok(stream) => {
-		                                let selected = stream.selected_srtp_profile().ok().flatten();
-		                                (stream, selected)
-		                            }
-		                            Err(err) => return Ok(result_err(format!("DTLS connect failed: {:?}", err), -1)),
-		                        }
-		                    } else {
-                        let cert_pem = match cfg.cert_pem.as_ref() {
-                            Some(v) => v,
-                            None => {
-                                return Ok(result_err("Server cert_pem required".to_string(), -1))
-                            }
-                        };
-                        let key_pem = match cfg.key_pem.as_ref() {
-                            Some(v) => v,
-                            None => {
-                                return Ok(result_err("Server key_pem required".to_string(), -1))
-                            }
-                        };
-                        let identity = match identity_from_pem(cert_pem, key_pem) {
-                            Ok(identity) => identity,
-                            Err(e) => return Ok(result_err(e, -1)),
-                        };
-	                        let mut builder = DtlsAcceptor::builder(identity);
-	                        for profile in &cfg.srtp_profiles {
-	                            builder.add_srtp_profile(*profile);
-	                        }
-		                        let acceptor = match DtlsAcceptor::new(&builder) { Ok(acceptor) => acceptor, Err(e) => return Ok(result_err(format!("{}", e), -1)), };
-		                        let accept_result = {
-		                            #[cfg(test)]
-		                            {
-		                                if dtls_take_fail_next_accept() {
-		                                    Err(udp_dtls::HandshakeError::Failure(udp_dtls::Error::SrtpProfile(
-		                                        udp_dtls::SrtpProfileError::BadProfile,
-		                                    )))
-		                                } else {
-		                                    acceptor.accept(channel)
-		                                }
-		                            }
-		                            #[cfg(not(test))]
-		                            {
-		                                acceptor.accept(channel)
-		                            }
-		                        };
-		                        match accept_result {
-		                            Ok(stream) => {
-		                                let selected = stream.selected_srtp_profile().ok().flatten();
-		                                (stream, selected)
-		                            }
-		                            Err(err) => return Ok(result_err(format!("DTLS accept failed: {:?}", err), -1)),
-		                        }
-		                    };
+        // ceil
+        globals.borrow_mut().define(
+            "ceil".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "ceil",
+                1,
+                |args| match &args[0] {
+                    Value::Float(f) => Ok(Value::Integer(f.ceil() as i64)),
+                    Value::Integer(n) => Ok(Value::Integer(*n)),
+                    _ => Err("ceil() expects a number".to_string()),
+                },
+            ))),
+        );
 
-                    let profile = selected_profile.unwrap_or(SrtpProfile::Aes128CmSha180);
-                    let (key_len, salt_len) = srtp_key_salt_len(profile);
-	                    let total = 2 * (key_len + salt_len);
-		                    let material = match stream.keying_material(total) { Ok(material) => material, Err(e) => return Ok(result_err(format!("Keying material failed: {}", e), -1)), };
+        // round
+        globals.borrow_mut().define(
+            "round".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "round",
+                1,
+                |args| match &args[0] {
+                    Value::Float(f) => Ok(Value::Integer(f.round() as i64)),
+                    Value::Integer(n) => Ok(Value::Integer(*n)),
+                    _ => Err("round() expects a number".to_string()),
+                },
+            ))),
+        );
 
-                    let client_key = material[0..key_len].to_vec();
-                    let server_key = material[key_len..(2 * key_len)].to_vec();
-                    let client_salt = material[(2 * key_len)..(2 * key_len + salt_len)].to_vec();
-                    let server_salt =
-                        material[(2 * key_len + salt_len)..(2 * key_len + 2 * salt_len)].to_vec();
+        // sqrt
+        globals.borrow_mut().define(
+            "sqrt".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "sqrt",
+                1,
+                |args| match &args[0] {
+                    Value::Float(f) => Ok(Value::Float(f.sqrt())),
+                    Value::Integer(n) => Ok(Value::Float((*n as f64).sqrt())),
+                    _ => Err("sqrt() expects a number".to_string()),
+                },
+            ))),
+        );
 
-                    let mut dict = DictValue::new();
-                    dict.set(
-                        Value::String("profile".to_string()),
-                        Value::String(profile.to_string()),
-                    );
-                    dict.set(
-                        Value::String("client_key".to_string()),
-                        Value::Bytes(Rc::new(RefCell::new(client_key))),
-                    );
-                    dict.set(
-                        Value::String("client_salt".to_string()),
-                        Value::Bytes(Rc::new(RefCell::new(client_salt))),
-                    );
-                    dict.set(
-                        Value::String("server_key".to_string()),
-                        Value::Bytes(Rc::new(RefCell::new(server_key))),
-                    );
-                    dict.set(
-                        Value::String("server_salt".to_string()),
-                        Value::Bytes(Rc::new(RefCell::new(server_salt))),
-                    );
-                    dict.set(
-                        Value::String("key_len".to_string()),
-                        Value::Integer(key_len as i64),
-                    );
-                    dict.set(
-                        Value::String("salt_len".to_string()),
-                        Value::Integer(salt_len as i64),
-                    );
+        // set_log_level - set the logging level at runtime
+        globals.borrow_mut().define(
+            "set_log_level".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "set_log_level",
+                1,
+                |args| match &args[0] {
+                    Value::String(s) => {
+                        if let Some(level) = LogLevel::parse_level(s) {
+                            set_global_log_level(level);
+                            Ok(Value::Nil)
+                        } else {
+                            Err(format!(
+                                "Invalid log level '{}'. Use: wheesht, roar, holler, blether, mutter, or whisper",
+                                s
+                            ))
+                        }
+                    }
+                    Value::Integer(n) => {
+                        let level = match n {
+                            0 => LogLevel::Wheesht,
+                            1 => LogLevel::Roar,
+                            2 => LogLevel::Holler,
+                            3 => LogLevel::Blether,
+                            4 => LogLevel::Mutter,
+                            5 => LogLevel::Whisper,
+                            _ => return Err(format!("Invalid log level {}. Use 0-5", n)),
+                        };
+                        set_global_log_level(level);
+                        Ok(Value::Nil)
+                    }
+                    _ => Err("set_log_level() expects a string or integer".to_string()),
+                },
+            ))),
+        );
 
-                    Ok(result_ok(Value::Dict(Rc::new(RefCell::new(dict)))))
-                }))),
-            );
+        // get_log_level - get the current logging level
+        globals.borrow_mut().define(
+            "get_log_level".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("get_log_level", 0, |_args| {
+                let level = get_global_log_level();
+                Ok(Value::String(level.name().to_lowercase().into()))
+            }))),
+        );
 
-            // srtp_create(keys)
-            globals.borrow_mut().define(
-                "srtp_create".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("srtp_create", 1, |args| {
-                    let dict = match &args[0] {
-                        Value::Dict(d) => d.borrow(),
-                        _ => return Err("srtp_create() expects config dict".to_string()),
-                    };
+        // log_set_filter(filter_string)
+        globals.borrow_mut().define(
+            "log_set_filter".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("log_set_filter", 1, |args| {
+                match &args[0] {
+                    Value::String(spec) => {
+                        logging::set_filter(spec).map_err(|e| format!("log_set_filter() {}", e))?;
+                        Ok(Value::Nil)
+                    }
+                    _ => Err("log_set_filter() expects a string".to_string()),
+                }
+            }))),
+        );
 
-                    let profile_str = dict_get_string(&dict, "profile")
-                        .unwrap_or_else(|| "SRTP_AES128_CM_SHA1_80".to_string());
-                    let profile = match protection_profile_from_str(&profile_str) {
-                        Some(p) => p,
-                        None => return Ok(result_err("Unsupported SRTP profile".to_string(), -1)),
-                    };
+        // log_get_filter() -> string
+        globals.borrow_mut().define(
+            "log_get_filter".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("log_get_filter", 0, |_args| {
+                Ok(Value::String(logging::get_filter().into()))
+            }))),
+        );
 
-                    let role =
-                        dict_get_string(&dict, "role").unwrap_or_else(|| "client".to_string());
+        // flush() - push stdout out now; native builds buffer it when it isn't a terminal
+        globals.borrow_mut().define(
+            "flush".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("flush", 0, |_args| {
+                let _ = std::io::stdout().flush();
+                Ok(Value::Nil)
+            }))),
+        );
 
-                    let mut send_key = dict_get_bytes(&dict, "send_key");
-                    let mut send_salt = dict_get_bytes(&dict, "send_salt");
-                    let mut recv_key = dict_get_bytes(&dict, "recv_key");
-                    let mut recv_salt = dict_get_bytes(&dict, "recv_salt");
+        // log_flush() - the interpreter always logs synchronously, so only stdio needs flushing
+        globals.borrow_mut().define(
+            "log_flush".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("log_flush", 0, |_args| {
+                let _ = std::io::stdout().flush();
+                let _ = std::io::stderr().flush();
+                Ok(Value::Nil)
+            }))),
+        );
 
-                    let client_key = dict_get_bytes(&dict, "client_key");
-                    let client_salt = dict_get_bytes(&dict, "client_salt");
-                    let server_key = dict_get_bytes(&dict, "server_key");
-                    let server_salt = dict_get_bytes(&dict, "server_salt");
+        // log_dropped() -> records an async logger discarded (never any here)
+        globals.borrow_mut().define(
+            "log_dropped".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("log_dropped", 0, |_args| {
+                Ok(Value::Integer(0))
+            }))),
+        );
 
-                    if send_key.is_none()
-                        || send_salt.is_none()
-                        || recv_key.is_none()
-                        || recv_salt.is_none()
-                    {
-                        if client_key.is_some()
-                            && client_salt.is_some()
-                            && server_key.is_some()
-                            && server_salt.is_some()
-                        {
-                            let is_client = role.to_lowercase() != "server";
-                            if is_client {
-                                send_key = client_key.clone();
-                                send_salt = client_salt.clone();
-                                recv_key = server_key.clone();
-                                recv_salt = server_salt.clone();
-                            } else {
-                                send_key = server_key.clone();
-                                send_salt = server_salt.clone();
-                                recv_key = client_key.clone();
-                                recv_salt = client_salt.clone();
-                            }
-                        } else {
-                            let master_key = dict_get_bytes(&dict, "master_key");
-                            let master_salt = dict_get_bytes(&dict, "master_salt");
-                            if master_key.is_some() && master_salt.is_some() {
-                                send_key = master_key.clone();
-                                send_salt = master_salt.clone();
-                                recv_key = master_key;
-                                recv_salt = master_salt;
-                            }
+        // log_enabled(level, target = "") -> bool
+        globals.borrow_mut().define(
+            "log_enabled".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "log_enabled",
+                usize::MAX,
+                |args| {
+                    if args.is_empty() || args.len() > 2 {
+                        return Err("log_enabled() expects 1 or 2 arguments".to_string());
+                    }
+                    let level = parse_log_level_value(&args[0])?;
+                    let target = if args.len() == 2 {
+                        parse_log_target_value(&args[1])?
+                    } else {
+                        String::new()
+                    };
+                    Ok(Value::Bool(logging::log_enabled(level, &target)))
+                },
+            ))),
+        );
+
+        // log_event(level, message, fields = {}, target = "") -> nil
+        globals.borrow_mut().define(
+            "log_event".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "log_event",
+                usize::MAX,
+                |args| {
+                    if args.len() < 2 || args.len() > 4 {
+                        return Err("log_event() expects 2-4 arguments".to_string());
+                    }
+                    let level = parse_log_level_value(&args[0])?;
+                    let message = args[1].clone();
+                    let (fields, target) = if args.len() > 2 {
+                        resolve_log_args(&args[2..])?
+                    } else {
+                        (None, None)
+                    };
+                    let result = with_current_interpreter(|interp| {
+                        interp.emit_log(level, message, fields, target, 0)
+                    });
+                    match result {
+                        Some(Ok(())) => Ok(Value::Nil),
+                        Some(Err(err)) => Err(format!("{}", err)),
+                        None => {
+                            Err("log_event() is unavailable outside the interpreter".to_string())
+                        }
+                    }
+                },
+            ))),
+        );
+
+        // log_init(config = {}) -> nil
+        globals.borrow_mut().define(
+            "log_init".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "log_init",
+                usize::MAX,
+                |args| {
+                    if args.len() > 1 {
+                        return Err("log_init() expects 0 or 1 arguments".to_string());
+                    }
+                    let config = args.first().cloned();
+                    let result = with_current_interpreter(|interp| interp.apply_log_config(config));
+                    match result {
+                        Some(Ok(())) => Ok(Value::Nil),
+                        Some(Err(err)) => Err(err),
+                        None => {
+                            Err("log_init() is unavailable outside the interpreter".to_string())
                         }
                     }
+                },
+            ))),
+        );
 
-                    let send_key = match send_key {
-                        Some(v) => v,
-                        None => return Ok(result_err("Missing SRTP send_key".to_string(), -1)),
+        // log_span(name, level = "blether", fields = {}, target = "") -> span_handle
+        globals.borrow_mut().define(
+            "log_span".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "log_span",
+                usize::MAX,
+                |args| {
+                    if args.is_empty() || args.len() > 4 {
+                        return Err("log_span() expects 1-4 arguments".to_string());
+                    }
+                    let name = match &args[0] {
+                        Value::String(s) => s.clone(),
+                        _ => return Err("log_span() name must be a string".to_string()),
                     };
-                    let send_salt = match send_salt {
-                        Some(v) => v,
-                        None => return Ok(result_err("Missing SRTP send_salt".to_string(), -1)),
+                    let level = if args.len() >= 2 {
+                        parse_log_level_value(&args[1])?
+                    } else {
+                        LogLevel::Blether
                     };
-                    let recv_key = match recv_key {
-                        Some(v) => v,
-                        None => return Ok(result_err("Missing SRTP recv_key".to_string(), -1)),
+                    let fields = if args.len() >= 3 {
+                        logging::fields_from_dict(&args[2])?
+                    } else {
+                        Vec::new()
                     };
-                    let recv_salt = match recv_salt {
-                        Some(v) => v,
-                        None => return Ok(result_err("Missing SRTP recv_salt".to_string(), -1)),
+                    let target = if args.len() >= 4 {
+                        parse_log_target_value(&args[3])?
+                    } else {
+                        with_current_interpreter(|interp| interp.current_file.clone())
+                            .unwrap_or_default()
                     };
+                    let span = logging::new_span(name.to_string(), level, target, fields);
+                    Ok(Value::NativeObject(Rc::new(logging::LogSpanHandle::new(
+                        span,
+                    ))))
+                },
+            ))),
+        );
 
-                    let send_master = MasterKey::new(&send_key, &send_salt, &None);
-                    let recv_master = MasterKey::new(&recv_key, &recv_salt, &None);
-                    let send_cfg = StreamConfig::new(vec![send_master], &profile, &profile);
-                    let recv_cfg = StreamConfig::new(vec![recv_master], &profile, &profile);
-
-                    let mut send = SendSession::new();
-                    if let Err(e) = send.add_stream(None, &send_cfg) {
-                        return Ok(result_err(format!("SRTP send session error: {}", e), -1));
-                    }
-                    let mut recv = RecvSession::new();
-                    if let Err(e) = recv.add_stream(None, &recv_cfg) {
-                        return Ok(result_err(format!("SRTP recv session error: {}", e), -1));
+        // log_span_enter(span_handle)
+        globals.borrow_mut().define(
+            "log_span_enter".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("log_span_enter", 1, |args| {
+                match &args[0] {
+                    Value::NativeObject(obj) => {
+                        if let Some(handle) = obj.as_any().downcast_ref::<logging::LogSpanHandle>()
+                        {
+                            logging::span_enter(handle.span());
+                            Ok(Value::Nil)
+                        } else {
+                            Err("log_span_enter() expects a log span handle".to_string())
+                        }
                     }
+                    _ => Err("log_span_enter() expects a log span handle".to_string()),
+                }
+            }))),
+        );
 
-                    let id = register_srtp(SrtpSession { send, recv });
-                    Ok(result_ok(Value::Integer(id)))
-                }))),
-            );
-
-            // srtp_protect(srtp, rtp_packet)
-            globals.borrow_mut().define(
-                "srtp_protect".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("srtp_protect", 2, |args| {
-                    let ctx_id = args[0]
-                        .as_integer()
-                        .ok_or("srtp_protect() expects SRTP handle")?;
-                    let packet = match &args[1] {
-                        Value::Bytes(b) => b.borrow().clone(),
-                        _ => return Err("srtp_protect() expects bytes".to_string()),
-                    };
-                    let res = with_srtp_mut(ctx_id, |session| {
-                        session
-                            .send
-                            .rtp_protect(packet)
-                            .map_err(|e| format!("SRTP protect failed: {}", e))
-                    });
-                    match res {
-                        Ok(buf) => Ok(result_ok(Value::Bytes(Rc::new(RefCell::new(buf))))),
-                        Err(e) => Ok(result_err(e, -1)),
+        // log_span_exit(span_handle)
+        globals.borrow_mut().define(
+            "log_span_exit".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "log_span_exit",
+                1,
+                |args| match &args[0] {
+                    Value::NativeObject(obj) => {
+                        if let Some(handle) = obj.as_any().downcast_ref::<logging::LogSpanHandle>()
+                        {
+                            logging::span_exit(handle.span().id)
+                                .map_err(|e| format!("log_span_exit() {}", e))?;
+                            Ok(Value::Nil)
+                        } else {
+                            Err("log_span_exit() expects a log span handle".to_string())
+                        }
                     }
-                }))),
-            );
+                    _ => Err("log_span_exit() expects a log span handle".to_string()),
+                },
+            ))),
+        );
 
-            // srtp_unprotect(srtp, rtp_packet)
-            globals.borrow_mut().define(
-                "srtp_unprotect".to_string(),
-                Value::NativeFunction(Rc::new(NativeFunction::new("srtp_unprotect", 2, |args| {
-                    let ctx_id = args[0]
-                        .as_integer()
-                        .ok_or("srtp_unprotect() expects SRTP handle")?;
-                    let packet = match &args[1] {
-                        Value::Bytes(b) => b.borrow().clone(),
-                        _ => return Err("srtp_unprotect() expects bytes".to_string()),
-                    };
-                    let res = with_srtp_mut(ctx_id, |session| {
-                        session
-                            .recv
-                            .rtp_unprotect(packet)
-                            .map_err(|e| format!("SRTP unprotect failed: {}", e))
-                    });
-                    match res {
-                        Ok(buf) => Ok(result_ok(Value::Bytes(Rc::new(RefCell::new(buf))))),
-                        Err(e) => Ok(result_err(e, -1)),
+        // log_span_current() -> span_handle | nil
+        globals.borrow_mut().define(
+            "log_span_current".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "log_span_current",
+                0,
+                |_args| {
+                    if let Some(span) = logging::span_current() {
+                        Ok(Value::NativeObject(Rc::new(logging::LogSpanHandle::new(
+                            span,
+                        ))))
+                    } else {
+                        Ok(Value::Nil)
                     }
-                }))),
-            );
-        }
+                },
+            ))),
+        );
 
-        // event_loop_new() -> loop handle
+        // log_span_in(span_handle, fn) -> value
         globals.borrow_mut().define(
-            "event_loop_new".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("event_loop_new", 0, |_args| {
-                let loop_val = EventLoop {
-                    watches: Vec::new(),
-                    timers: Vec::new(),
-                    next_timer_id: 1,
-                    stopped: false,
+            "log_span_in".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("log_span_in", 2, |args| {
+                let span = match &args[0] {
+                    Value::NativeObject(obj) => obj
+                        .as_any()
+                        .downcast_ref::<logging::LogSpanHandle>()
+                        .map(|h| h.span())
+                        .ok_or_else(|| "log_span_in() expects a log span handle".to_string())?,
+                    _ => return Err("log_span_in() expects a log span handle".to_string()),
                 };
-                let id = register_loop(loop_val);
-                Ok(Value::Integer(id))
-            }))),
-        );
+                let func = args[1].clone();
 
-        // event_loop_stop(loop)
-        globals.borrow_mut().define(
-            "event_loop_stop".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("event_loop_stop", 1, |args| {
-                let loop_id = args[0]
-                    .as_integer()
-                    .ok_or("event_loop_stop() expects loop id")?;
-                let _ = with_loop_mut(loop_id, |loop_ref| loop_ref.stopped = true)?;
-                Ok(Value::Nil)
+                logging::span_enter(span.clone());
+                let result =
+                    with_current_interpreter(|interp| interp.call_value(func, Vec::new(), 0));
+                let _ = logging::span_exit(span.id);
+
+                match result {
+                    Some(Ok(val)) => Ok(val),
+                    Some(Err(err)) => Err(format!("{}", err)),
+                    None => Err("log_span_in() is unavailable outside the interpreter".to_string()),
+                }
             }))),
         );
 
-        // event_watch_read(loop, sock, callback)
+        // log_span_stats() -> {name: {"count", "total_ms", ..., "p99_ms"}}
         globals.borrow_mut().define(
-            "event_watch_read".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "event_watch_read",
-                3,
-                |args| {
-                    #[cfg(all(feature = "native", unix))]
-                    let result = {
-                        let loop_id = args[0]
-                            .as_integer()
-                            .ok_or("event_watch_read() expects loop id")?;
-                        let sock_id = args[1]
-                            .as_integer()
-                            .ok_or("event_watch_read() expects socket id")?;
-                        let callback = args[2].clone();
-                        let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
-                        let _ = with_loop_mut(loop_id, |loop_ref| {
-                            if let Some(watch) =
-                                loop_ref.watches.iter_mut().find(|w| w.sock_id == sock_id)
-                            {
-                                watch.read_cb = callback.clone();
-                            } else {
-                                loop_ref.watches.push(LoopWatch {
-                                    sock_id,
-                                    fd: entry.fd,
-                                    read_cb: callback.clone(),
-                                    write_cb: Value::Nil,
-                                });
-                            }
-                        })?;
-                        Ok(Value::Nil)
-                    };
-
-                    #[cfg(not(all(feature = "native", unix)))]
-                    let result = {
-                        let _ = args;
-                        Err(
-                            "event_watch_read() requires the 'native' feature on unix targets"
-                                .to_string(),
-                        )
-                    };
-
-                    result
-                },
-            ))),
+            "log_span_stats".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("log_span_stats", 0, |_args| {
+                Ok(logging::span_stats())
+            }))),
         );
 
-        // event_watch_write(loop, sock, callback)
+        // log_span_export(path, "chrome" | "folded") -> events or lines written
         globals.borrow_mut().define(
-            "event_watch_write".to_string(),
+            "log_span_export".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "event_watch_write",
-                3,
-                |args| {
-                    #[cfg(all(feature = "native", unix))]
-                    let result = {
-                        let loop_id = args[0]
-                            .as_integer()
-                            .ok_or("event_watch_write() expects loop id")?;
-                        let sock_id = args[1]
-                            .as_integer()
-                            .ok_or("event_watch_write() expects socket id")?;
-                        let callback = args[2].clone();
-                        let entry = get_socket(sock_id).ok_or("Unknown socket handle")?;
-                        let _ = with_loop_mut(loop_id, |loop_ref| {
-                            if let Some(watch) =
-                                loop_ref.watches.iter_mut().find(|w| w.sock_id == sock_id)
-                            {
-                                watch.write_cb = callback.clone();
-                            } else {
-                                loop_ref.watches.push(LoopWatch {
-                                    sock_id,
-                                    fd: entry.fd,
-                                    read_cb: Value::Nil,
-                                    write_cb: callback.clone(),
-                                });
-                            }
-                        })?;
-                        Ok(Value::Nil)
-                    };
-
-                    #[cfg(not(all(feature = "native", unix)))]
-                    let result = {
-                        let _ = args;
-                        Err(
-                            "event_watch_write() requires the 'native' feature on unix targets"
-                                .to_string(),
-                        )
-                    };
-
-                    result
+                "log_span_export",
+                2,
+                |args| match (&args[0], &args[1]) {
+                    (Value::String(path), Value::String(format)) => {
+                        logging::span_export(path, format).map(Value::Integer)
+                    }
+                    _ => Err("log_span_export() expects a path and a format".to_string()),
                 },
             ))),
         );
 
-        // event_unwatch(loop, sock)
+        // stacktrace - get the current stack trace as a string
         globals.borrow_mut().define(
-            "event_unwatch".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("event_unwatch", 2, |args| {
-                let loop_id = args[0]
-                    .as_integer()
-                    .ok_or("event_unwatch() expects loop id")?;
-                let sock_id = args[1]
-                    .as_integer()
-                    .ok_or("event_unwatch() expects socket id")?;
-                let mut removed = false;
-                let _ = with_loop_mut(loop_id, |loop_ref| {
-                    let before = loop_ref.watches.len();
-                    loop_ref.watches.retain(|w| w.sock_id != sock_id);
-                    removed = loop_ref.watches.len() != before;
-                })?;
-                Ok(Value::Bool(removed))
+            "stacktrace".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("stacktrace", 0, |_args| {
+                let stack = get_stack_trace();
+                let trace = stack
+                    .iter()
+                    .rev()
+                    .map(|f| format!("  at {} ({}:{})", f.name, f.file, f.line))
+                    .collect::<Vec<_>>()
+                    .join("\n");
+                Ok(Value::String(if trace.is_empty() {
+                    "(no stack trace)".into()
+                } else {
+                    trace.into()
+                }))
             }))),
         );
 
-        // event_loop_poll(loop, timeout_ms) -> list of events
+        // set_crash_handling - enable or disable crash handling
         globals.borrow_mut().define(
-            "event_loop_poll".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("event_loop_poll", 2, |args| {
-                let loop_id = args[0]
-                    .as_integer()
-                    .ok_or("event_loop_poll() expects loop id")?;
-                let timeout_ms = match &args[1] {
-                    Value::Nil => -1,
-                    Value::Integer(n) => *n,
-                    Value::Float(f) => *f as i64,
-                    _ => return Err("event_loop_poll() expects timeout integer or nil".to_string()),
-                };
-
-                let events = with_loop_mut(loop_id, |loop_ref| {
-                    if loop_ref.stopped {
-                        return Value::List(Rc::new(RefCell::new(vec![event_dict(
-                            "stop", None, None, None,
-                        )])));
+            "set_crash_handling".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "set_crash_handling",
+                1,
+                |args| match &args[0] {
+                    Value::Bool(enabled) => {
+                        set_crash_handling(*enabled);
+                        Ok(Value::Nil)
                     }
+                    _ => Err("set_crash_handling() expects a boolean".to_string()),
+                },
+            ))),
+        );
 
-                    #[cfg(all(feature = "native", unix))]
-                    let result = {
-                        let now = mono_ms_now();
-                        let mut next_due: Option<i64> = None;
-                        for timer in loop_ref.timers.iter() {
-                            if timer.cancelled {
-                                continue;
-                            }
-                            let mut diff = timer.next_fire_ms - now;
-                            if diff < 0 {
-                                diff = 0;
-                            }
-                            next_due = Some(match next_due {
-                                Some(prev) => prev.min(diff),
-                                None => diff,
-                            });
-                        }
-
-                        let mut wait_ms = timeout_ms;
-                        if wait_ms < 0 {
-                            wait_ms = next_due.unwrap_or(-1);
-                        } else if let Some(due) = next_due {
-                            if due >= 0 && due < wait_ms {
-                                wait_ms = due;
-                            }
-                        }
-
-                        let poll_timeout = if wait_ms < 0 {
-                            -1
-                        } else if wait_ms > i32::MAX as i64 {
-                            i32::MAX
-                        } else {
-                            wait_ms as i32
-                        };
-
-                        let mut fds: Vec<libc::pollfd> = loop_ref
-                            .watches
-                            .iter()
-                            .map(|watch| libc::pollfd {
-                                fd: watch.fd,
-                                events: {
-                                    let mut ev = 0;
-                                    if !matches!(watch.read_cb, Value::Nil) {
-                                        ev |= libc::POLLIN;
-                                    }
-                                    if !matches!(watch.write_cb, Value::Nil) {
-                                        ev |= libc::POLLOUT;
-                                    }
-                                    ev
-                                },
-                                revents: 0,
-                            })
+        // split - split string
+        globals.borrow_mut().define(
+            "split".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("split", 2, |args| {
+                match (&args[0], &args[1]) {
+                    (Value::String(s), Value::String(delim)) => {
+                        let parts: Vec<Value> = s
+                            .split(delim.as_ref())
+                            .map(|p| Value::String(p.into()))
                             .collect();
+                        Ok(Value::List(Rc::new(RefCell::new(parts))))
+                    }
+                    _ => Err("split() expects two strings".to_string()),
+                }
+            }))),
+        );
 
-                        if poll_timeout != 0 || !fds.is_empty() {
-                            let rc = unsafe {
-                                libc::poll(
-                                    fds.as_mut_ptr(),
-                                    fds.len() as libc::nfds_t,
-                                    poll_timeout,
-                                )
-                            };
-                            if rc < 0 {
-                                return Value::List(Rc::new(RefCell::new(Vec::new())));
-                            }
-                        }
-
-                        let mut out: Vec<Value> = Vec::new();
-                        for (idx, pfd) in fds.iter().enumerate() {
-                            let watch = &loop_ref.watches[idx];
-                            if (pfd.revents & libc::POLLIN) != 0
-                                && !matches!(watch.read_cb, Value::Nil)
-                            {
-                                out.push(event_dict(
-                                    "read",
-                                    Some(watch.sock_id),
-                                    None,
-                                    Some(watch.read_cb.clone()),
-                                ));
-                            }
-                            if (pfd.revents & libc::POLLOUT) != 0
-                                && !matches!(watch.write_cb, Value::Nil)
-                            {
-                                out.push(event_dict(
-                                    "write",
-                                    Some(watch.sock_id),
-                                    None,
-                                    Some(watch.write_cb.clone()),
-                                ));
-                            }
-                        }
-
-                        let now2 = mono_ms_now();
-                        for timer in loop_ref.timers.iter_mut() {
-                            if timer.cancelled {
-                                continue;
-                            }
-                            if timer.next_fire_ms <= now2 {
-                                out.push(event_dict(
-                                    "timer",
-                                    None,
-                                    Some(timer.id),
-                                    Some(timer.callback.clone()),
-                                ));
-                                if timer.interval_ms > 0 {
-                                    while timer.next_fire_ms <= now2 {
-                                        timer.next_fire_ms += timer.interval_ms;
-                                    }
-                                } else {
-                                    timer.cancelled = true;
-                                }
-                            }
-                        }
-                        loop_ref.timers.retain(|t| !t.cancelled);
-
-                        Value::List(Rc::new(RefCell::new(out)))
-                    };
-
-                    #[cfg(not(all(feature = "native", unix)))]
-                    let result = {
-                        let _ = timeout_ms;
-                        let mut out: Vec<Value> = Vec::new();
-                        let now2 = mono_ms_now();
-                        for timer in loop_ref.timers.iter_mut() {
-                            if timer.cancelled {
-                                continue;
-                            }
-                            if timer.next_fire_ms <= now2 {
-                                out.push(event_dict(
-                                    "timer",
-                                    None,
-                                    Some(timer.id),
-                                    Some(timer.callback.clone()),
-                                ));
-                                if timer.interval_ms > 0 {
-                                    while timer.next_fire_ms <= now2 {
-                                        timer.next_fire_ms += timer.interval_ms;
-                                    }
-                                } else {
-                                    timer.cancelled = true;
-                                }
-                            }
-                        }
-                        loop_ref.timers.retain(|t| !t.cancelled);
-
-                        Value::List(Rc::new(RefCell::new(out)))
-                    };
+        // join - join list into string
+        globals.borrow_mut().define(
+            "join".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("join", 2, |args| {
+                match (&args[0], &args[1]) {
+                    (Value::List(list), Value::String(delim)) => {
+                        let parts: Vec<String> =
+                            list.borrow().iter().map(|v| format!("{}", v)).collect();
+                        Ok(Value::String(parts.join(delim).into()))
+                    }
+                    _ => Err("join() expects a list and a string".to_string()),
+                }
+            }))),
+        );
 
-                    result
-                })?;
+        // contains - check if list/string contains value
+        globals.borrow_mut().define(
+            "contains".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "contains",
+                2,
+                |args| match &args[0] {
+                    Value::List(list) => {
+                        let found = list.borrow().iter().any(|v| v == &args[1]);
+                        Ok(Value::Bool(found))
+                    }
+                    Value::String(s) => {
+                        if let Value::String(needle) = &args[1] {
+                            Ok(Value::Bool(s.contains(needle.as_ref())))
+                        } else {
+                            Err("contains() on string expects a string needle".to_string())
+                        }
+                    }
+                    Value::Dict(dict) => Ok(Value::Bool(dict.borrow().contains_key(&args[1]))),
+                    _ => Err("contains() expects a list, string, or dict".to_string()),
+                },
+            ))),
+        );
 
-                Ok(events)
-            }))),
+        // reverse - reverse a list or string
+        globals.borrow_mut().define(
+            "reverse".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "reverse",
+                1,
+                |args| match &args[0] {
+                    Value::List(list) => {
+                        let mut reversed = list.borrow().clone();
+                        reversed.reverse();
+                        Ok(Value::List(Rc::new(RefCell::new(reversed))))
+                    }
+                    Value::String(s) => {
+                        Ok(Value::String(s.chars().rev().collect::<String>().into()))
+                    }
+                    _ => Err("reverse() expects a list or string".to_string()),
+                },
+            ))),
         );
 
-        // timer_after(loop, ms, callback) -> timer id
+        // slap - append lists together (like a friendly slap on the back!)
         globals.borrow_mut().define(
-            "timer_after".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("timer_after", 3, |args| {
-                let loop_id = args[0]
-                    .as_integer()
-                    .ok_or("timer_after() expects loop id")?;
-                let delay_ms = match &args[1] {
-                    Value::Integer(n) => *n,
-                    Value::Float(f) => *f as i64,
-                    _ => return Err("timer_after() expects delay integer".to_string()),
-                };
-                if delay_ms < 0 {
-                    return Err("timer_after() expects non-negative delay".to_string());
+            "slap".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("slap", 2, |args| {
+                match (&args[0], &args[1]) {
+                    (Value::List(a), Value::List(b)) => {
+                        let mut result = a.borrow().clone();
+                        result.extend(b.borrow().clone());
+                        Ok(Value::List(Rc::new(RefCell::new(result))))
+                    }
+                    (Value::String(a), Value::String(b)) => {
+                        Ok(Value::String(format!("{}{}", a, b).into()))
+                    }
+                    _ => Err("slap() expects two lists or two strings".to_string()),
                 }
-                let callback = args[2].clone();
-                let id = with_loop_mut(loop_id, |loop_ref| {
-                    let id = loop_ref.next_timer_id;
-                    loop_ref.next_timer_id += 1;
-                    loop_ref.timers.push(LoopTimer {
-                        id,
-                        next_fire_ms: mono_ms_now() + delay_ms,
-                        interval_ms: 0,
-                        callback: callback.clone(),
-                        cancelled: false,
-                    });
-                    id
-                })?;
-                Ok(Value::Integer(id))
             }))),
         );
 
-        // timer_every(loop, ms, callback) -> timer id
+        // heid - get the first element (head)
         globals.borrow_mut().define(
-            "timer_every".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("timer_every", 3, |args| {
-                let loop_id = args[0]
-                    .as_integer()
-                    .ok_or("timer_every() expects loop id")?;
-                let interval_ms = match &args[1] {
-                    Value::Integer(n) => *n,
-                    Value::Float(f) => *f as i64,
-                    _ => return Err("timer_every() expects interval integer".to_string()),
-                };
-                if interval_ms <= 0 {
-                    return Err("timer_every() expects positive interval".to_string());
-                }
-                let callback = args[2].clone();
-                let id = with_loop_mut(loop_id, |loop_ref| {
-                    let id = loop_ref.next_timer_id;
-                    loop_ref.next_timer_id += 1;
-                    loop_ref.timers.push(LoopTimer {
-                        id,
-                        next_fire_ms: mono_ms_now() + interval_ms,
-                        interval_ms,
-                        callback: callback.clone(),
-                        cancelled: false,
-                    });
-                    id
-                })?;
-                Ok(Value::Integer(id))
-            }))),
+            "heid".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "heid",
+                1,
+                |args| match &args[0] {
+                    Value::List(list) => list
+                        .borrow()
+                        .first()
+                        .cloned()
+                        .ok_or("Cannae get heid o' empty list!".to_string()),
+                    Value::String(s) => s
+                        .chars()
+                        .next()
+                        .map(|c| Value::String(c.to_string().into()))
+                        .ok_or("Cannae get heid o' empty string!".to_string()),
+                    _ => Err("heid() expects a list or string".to_string()),
+                },
+            ))),
         );
 
-        // timer_cancel(loop, timer_id) -> bool
+        // tail - get everything except the first (like a tail!)
         globals.borrow_mut().define(
-            "timer_cancel".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("timer_cancel", 2, |args| {
-                let loop_id = args[0]
-                    .as_integer()
-                    .ok_or("timer_cancel() expects loop id")?;
-                let timer_id = args[1]
-                    .as_integer()
-                    .ok_or("timer_cancel() expects timer id")?;
-                let mut cancelled = false;
-                let _ = with_loop_mut(loop_id, |loop_ref| {
-                    for timer in loop_ref.timers.iter_mut() {
-                        if timer.id == timer_id && !timer.cancelled {
-                            timer.cancelled = true;
-                            cancelled = true;
+            "tail".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "tail",
+                1,
+                |args| match &args[0] {
+                    Value::List(list) => {
+                        let list = list.borrow();
+                        if list.is_empty() {
+                            Ok(Value::List(Rc::new(RefCell::new(Vec::new()))))
+                        } else {
+                            Ok(Value::List(Rc::new(RefCell::new(list[1..].to_vec()))))
                         }
                     }
-                })?;
-                Ok(Value::Bool(cancelled))
+                    Value::String(s) => {
+                        Ok(Value::String(s.chars().skip(1).collect::<String>().into()))
+                    }
+                    _ => Err("tail() expects a list or string".to_string()),
+                },
+            ))),
+        );
+
+        // bum - get the last element (backside!)
+        globals.borrow_mut().define(
+            "bum".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("bum", 1, |args| {
+                match &args[0] {
+                    Value::List(list) => list
+                        .borrow()
+                        .last()
+                        .cloned()
+                        .ok_or("Cannae get bum o' empty list!".to_string()),
+                    Value::String(s) => s
+                        .chars()
+                        .last()
+                        .map(|c| Value::String(c.to_string().into()))
+                        .ok_or("Cannae get bum o' empty string!".to_string()),
+                    _ => Err("bum() expects a list or string".to_string()),
+                }
             }))),
         );
 
-        // thread_spawn(func, args_list) -> thread handle (interpreter: native funcs only)
+        // scran - slice a list or string (grab a portion, like grabbing scran/food)
         globals.borrow_mut().define(
-            "thread_spawn".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("thread_spawn", 2, |args| {
-                let func = args[0].clone();
-                let args_list = &args[1];
-                let arg_vec = match args_list {
-                    Value::Nil => Vec::new(),
-                    Value::List(list) => list.borrow().clone(),
-                    _ => {
-                        return Err("thread_spawn() expects a list of arguments or nil".to_string())
+            "scran".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("scran", 3, |args| {
+                let start = args[1]
+                    .as_integer()
+                    .ok_or("scran() needs integer indices")?;
+                let end = args[2]
+                    .as_integer()
+                    .ok_or("scran() needs integer indices")?;
+                match &args[0] {
+                    Value::List(list) => {
+                        let list = list.borrow();
+                        let start = start.max(0) as usize;
+                        let end = end.min(list.len() as i64) as usize;
+                        Ok(Value::List(Rc::new(RefCell::new(
+                            list[start..end].to_vec(),
+                        ))))
                     }
-                };
-                let result = match func {
-                    Value::NativeFunction(native) => (native.func)(arg_vec)?,
-                    _ => {
-                        return Err(
-                            "thread_spawn() only supports native functions in interpreter"
-                                .to_string(),
-                        )
+                    Value::String(s) => {
+                        let start = start.max(0) as usize;
+                        let end = end.min(s.len() as i64) as usize;
+                        Ok(Value::String(
+                            s.chars()
+                                .skip(start)
+                                .take(end - start)
+                                .collect::<String>()
+                                .into(),
+                        ))
                     }
-                };
-                let id = register_thread(ThreadHandle {
-                    result,
-                    detached: false,
-                });
-                Ok(Value::Integer(id))
+                    _ => Err("scran() expects a list or string".to_string()),
+                }
             }))),
         );
 
-        // thread_join(thread_handle)
+        // sumaw - sum all numbers in a list (sum aw = sum all)
         globals.borrow_mut().define(
-            "thread_join".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("thread_join", 1, |args| {
-                let thread_id = args[0]
-                    .as_integer()
-                    .ok_or("thread_join() expects thread handle")?;
-                let result = with_thread_mut(thread_id, |handle| {
-                    if handle.detached {
-                        None
+            "sumaw".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("sumaw", 1, |args| {
+                if let Value::List(list) = &args[0] {
+                    let mut sum: f64 = 0.0;
+                    let mut is_float = false;
+                    for item in list.borrow().iter() {
+                        match item {
+                            Value::Integer(n) => sum += *n as f64,
+                            Value::Float(f) => {
+                                sum += f;
+                                is_float = true;
+                            }
+                            _ => return Err("sumaw() expects a list of numbers".to_string()),
+                        }
+                    }
+                    if is_float {
+                        Ok(Value::Float(sum))
                     } else {
-                        Some(handle.result.clone())
+                        Ok(Value::Integer(sum as i64))
                     }
-                })?;
-                if let Some(val) = result {
-                    Ok(val)
                 } else {
-                    Err("thread_join() cannot join detached thread".to_string())
+                    Err("sumaw() expects a list".to_string())
                 }
             }))),
         );
 
-        // thread_detach(thread_handle)
+        // coont - count occurrences in list or string
         globals.borrow_mut().define(
-            "thread_detach".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("thread_detach", 1, |args| {
-                let thread_id = args[0]
-                    .as_integer()
-                    .ok_or("thread_detach() expects thread handle")?;
-                let _ = with_thread_mut(thread_id, |handle| handle.detached = true)?;
-                Ok(Value::Nil)
-            }))),
+            "coont".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "coont",
+                2,
+                |args| match &args[0] {
+                    Value::List(list) => {
+                        let count = list.borrow().iter().filter(|&x| x == &args[1]).count();
+                        Ok(Value::Integer(count as i64))
+                    }
+                    Value::String(s) => {
+                        if let Value::String(needle) = &args[1] {
+                            let count = s.matches(needle.as_ref()).count();
+                            Ok(Value::Integer(count as i64))
+                        } else {
+                            Err("coont() on string needs a string tae count".to_string())
+                        }
+                    }
+                    _ => Err("coont() expects a list or string".to_string()),
+                },
+            ))),
         );
 
-        // mutex_new()
+        // wheesht - remove whitespace (be quiet/silent!)
         globals.borrow_mut().define(
-            "mutex_new".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("mutex_new", 0, |_args| {
-                let id = register_mutex(MutexState { locked: false });
-                Ok(Value::Integer(id))
+            "wheesht".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("wheesht", 1, |args| {
+                if let Value::String(s) = &args[0] {
+                    Ok(Value::String(s.trim().into()))
+                } else {
+                    Err("wheesht() expects a string".to_string())
+                }
             }))),
         );
 
-        // mutex_lock(mutex)
+        // upper - to uppercase (shout it oot!)
         globals.borrow_mut().define(
-            "mutex_lock".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("mutex_lock", 1, |args| {
-                let mutex_id = args[0]
-                    .as_integer()
-                    .ok_or("mutex_lock() expects mutex handle")?;
-                let _ = with_mutex_mut(mutex_id, |state| state.locked = true)?;
-                Ok(Value::Nil)
+            "upper".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("upper", 1, |args| {
+                if let Value::String(s) = &args[0] {
+                    Ok(Value::String(s.to_uppercase().into()))
+                } else {
+                    Err("upper() expects a string".to_string())
+                }
             }))),
         );
 
-        // mutex_unlock(mutex)
+        // lower - to lowercase (calm doon!)
         globals.borrow_mut().define(
-            "mutex_unlock".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("mutex_unlock", 1, |args| {
-                let mutex_id = args[0]
-                    .as_integer()
-                    .ok_or("mutex_unlock() expects mutex handle")?;
-                let _ = with_mutex_mut(mutex_id, |state| state.locked = false)?;
-                Ok(Value::Nil)
+            "lower".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("lower", 1, |args| {
+                if let Value::String(s) = &args[0] {
+                    Ok(Value::String(s.to_lowercase().into()))
+                } else {
+                    Err("lower() expects a string".to_string())
+                }
             }))),
         );
 
-        // mutex_try_lock(mutex) -> bool
+        // shuffle - randomly shuffle a list (like a ceilidh!)
         globals.borrow_mut().define(
-            "mutex_try_lock".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("mutex_try_lock", 1, |args| {
-                let mutex_id = args[0]
-                    .as_integer()
-                    .ok_or("mutex_try_lock() expects mutex handle")?;
-                let locked = with_mutex_mut(mutex_id, |state| {
-                    if state.locked {
-                        false
-                    } else {
-                        state.locked = true;
-                        true
-                    }
-                })?;
-                Ok(Value::Bool(locked))
+            "shuffle".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("shuffle", 1, |args| {
+                if let Value::List(list) = &args[0] {
+                    let mut shuffled = list.borrow().clone();
+                    rng_shuffle(&mut shuffled);
+                    Ok(Value::List(Rc::new(RefCell::new(shuffled))))
+                } else {
+                    Err("shuffle() expects a list".to_string())
+                }
             }))),
         );
 
-        // condvar_new()
+        // sort - sort a list
         globals.borrow_mut().define(
-            "condvar_new".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("condvar_new", 0, |_args| {
-                let id = register_condvar(CondvarState);
-                Ok(Value::Integer(id))
+            "sort".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("sort", 1, |args| {
+                if let Value::List(list) = &args[0] {
+                    let mut sorted = list.borrow().clone();
+                    sorted.sort_by(sort_order);
+                    Ok(Value::List(Rc::new(RefCell::new(sorted))))
+                } else {
+                    Err("sort() expects a list".to_string())
+                }
             }))),
         );
 
-        // condvar_wait(condvar, mutex) -> bool (interpreter: immediate true)
+        // jammy - random number (Scots: lucky!)
         globals.borrow_mut().define(
-            "condvar_wait".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("condvar_wait", 2, |args| {
-                let condvar_id = args[0]
-                    .as_integer()
-                    .ok_or("condvar_wait() expects condvar handle")?;
-                let _mutex_id = args[1]
-                    .as_integer()
-                    .ok_or("condvar_wait() expects mutex handle")?;
-                let _ = with_condvar_mut(condvar_id, |_state| ())?;
-                Ok(Value::Bool(true))
+            "jammy".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("jammy", 2, |args| {
+                let min = args[0].as_integer().ok_or("jammy() needs integer bounds")?;
+                let max = args[1].as_integer().ok_or("jammy() needs integer bounds")?;
+                if min >= max {
+                    return Err("jammy() needs min < max, ya numpty!".to_string());
+                }
+                Ok(Value::Integer(rng_range(min, max - 1)))
             }))),
         );
 
-        // condvar_timed_wait(condvar, mutex, timeout_ms) -> bool
-        globals.borrow_mut().define(
-            "condvar_timed_wait".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "condvar_timed_wait",
-                3,
-                |args| {
-                    let condvar_id = args[0]
-                        .as_integer()
-                        .ok_or("condvar_timed_wait() expects condvar handle")?;
-                    let _mutex_id = args[1]
-                        .as_integer()
-                        .ok_or("condvar_timed_wait() expects mutex handle")?;
-                    let _timeout = match &args[2] {
-                        Value::Integer(n) => *n,
-                        Value::Float(f) => *f as i64,
-                        _ => return Err("condvar_timed_wait() expects timeout integer".to_string()),
-                    };
-                    let _ = with_condvar_mut(condvar_id, |_state| ())?;
-                    Ok(Value::Bool(true))
-                },
-            ))),
-        );
-
-        // condvar_signal(condvar)
+        // the_noo - current timestamp in seconds (Scots: "the now")
         globals.borrow_mut().define(
-            "condvar_signal".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("condvar_signal", 1, |args| {
-                let condvar_id = args[0]
-                    .as_integer()
-                    .ok_or("condvar_signal() expects condvar handle")?;
-                let _ = with_condvar_mut(condvar_id, |_state| ())?;
-                Ok(Value::Nil)
+            "the_noo".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("the_noo", 0, |_args| {
+                use std::time::{SystemTime, UNIX_EPOCH};
+                let secs = SystemTime::now()
+                    .duration_since(UNIX_EPOCH)
+                    .unwrap()
+                    .as_secs();
+                Ok(Value::Integer(secs as i64))
             }))),
         );
 
-        // condvar_broadcast(condvar)
-        globals.borrow_mut().define(
-            "condvar_broadcast".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "condvar_broadcast",
-                1,
-                |args| {
-                    let condvar_id = args[0]
-                        .as_integer()
-                        .ok_or("condvar_broadcast() expects condvar handle")?;
-                    let _ = with_condvar_mut(condvar_id, |_state| ())?;
-                    Ok(Value::Nil)
-                },
-            ))),
-        );
-
-        // atomic_new(initial_int)
+        // mono_ms - monotonic milliseconds since start
         globals.borrow_mut().define(
-            "atomic_new".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("atomic_new", 1, |args| {
-                let value = match &args[0] {
-                    Value::Integer(n) => *n,
-                    Value::Float(f) => *f as i64,
-                    _ => return Err("atomic_new() expects integer".to_string()),
-                };
-                let id = register_atomic(AtomicState { value });
-                Ok(Value::Integer(id))
+            "mono_ms".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("mono_ms", 0, |_args| {
+                let start = MONO_START.get_or_init(std::time::Instant::now);
+                let ms = start.elapsed().as_millis() as i64;
+                Ok(Value::Integer(ms))
             }))),
         );
 
-        // atomic_load(atomic)
+        // mono_ns - monotonic nanoseconds since start
         globals.borrow_mut().define(
-            "atomic_load".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("atomic_load", 1, |args| {
-                let atomic_id = args[0]
-                    .as_integer()
-                    .ok_or("atomic_load() expects atomic handle")?;
-                let value = with_atomic_mut(atomic_id, |state| state.value)?;
-                Ok(Value::Integer(value))
+            "mono_ns".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("mono_ns", 0, |_args| {
+                let start = MONO_START.get_or_init(std::time::Instant::now);
+                let ns = start.elapsed().as_nanos() as i64;
+                Ok(Value::Integer(ns))
             }))),
         );
 
-        // atomic_store(atomic, value)
+        // is_a - type checking (returns aye/nae)
         globals.borrow_mut().define(
-            "atomic_store".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("atomic_store", 2, |args| {
-                let atomic_id = args[0]
-                    .as_integer()
-                    .ok_or("atomic_store() expects atomic handle")?;
-                let value = match &args[1] {
-                    Value::Integer(n) => *n,
-                    Value::Float(f) => *f as i64,
-                    _ => return Err("atomic_store() expects integer".to_string()),
+            "is_a".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("is_a", 2, |args| {
+                let type_name = match &args[1] {
+                    Value::String(s) => s.as_ref(),
+                    _ => return Err("is_a() needs a type name string".to_string()),
                 };
-                let _ = with_atomic_mut(atomic_id, |state| state.value = value)?;
-                Ok(Value::Nil)
+                let matches = match type_name {
+                    "integer" | "int" => matches!(args[0], Value::Integer(_)),
+                    "float" => matches!(args[0], Value::Float(_)),
+                    "string" | "str" => matches!(args[0], Value::String(_)),
+                    "bool" => matches!(args[0], Value::Bool(_)),
+                    "list" => matches!(args[0], Value::List(_)),
+                    "bytes" | "byte" => matches!(args[0], Value::Bytes(_)),
+                    "dict" => matches!(args[0], Value::Dict(_)),
+                    "function" | "dae" => {
+                        matches!(args[0], Value::Function(_) | Value::NativeFunction(_))
+                    }
+                    "naething" | "nil" => matches!(args[0], Value::Nil),
+                    "range" => matches!(args[0], Value::Range(_)),
+                    _ => false,
+                };
+                Ok(Value::Bool(matches))
             }))),
         );
 
-        // atomic_add(atomic, delta) -> new value
+        // tae_bool - convert to boolean
         globals.borrow_mut().define(
-            "atomic_add".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("atomic_add", 2, |args| {
-                let atomic_id = args[0]
-                    .as_integer()
-                    .ok_or("atomic_add() expects atomic handle")?;
-                let delta = match &args[1] {
-                    Value::Integer(n) => *n,
-                    Value::Float(f) => *f as i64,
-                    _ => return Err("atomic_add() expects integer".to_string()),
-                };
-                let value = with_atomic_mut(atomic_id, |state| {
-                    state.value += delta;
-                    state.value
-                })?;
-                Ok(Value::Integer(value))
+            "tae_bool".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("tae_bool", 1, |args| {
+                Ok(Value::Bool(args[0].is_truthy()))
             }))),
         );
-
-        // atomic_cas(atomic, expected, desired) -> bool
-        globals.borrow_mut().define(
-            "atomic_cas".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("atomic_cas", 3, |args| {
-                let atomic_id = args[0]
-                    .as_integer()
-                    .ok_or("atomic_cas() expects atomic handle")?;
-                let expected = match &args[1] {
-                    Value::Integer(n) => *n,
-                    Value::Float(f) => *f as i64,
-                    _ => return Err("atomic_cas() expects integer".to_string()),
-                };
-                let desired = match &args[2] {
-                    Value::Integer(n) => *n,
-                    Value::Float(f) => *f as i64,
-                    _ => return Err("atomic_cas() expects integer".to_string()),
+
+        // char_at - get character at index (returns string of length 1)
+        globals.borrow_mut().define(
+            "char_at".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("char_at", 2, |args| {
+                let s = match &args[0] {
+                    Value::String(s) => s,
+                    _ => return Err("char_at() needs a string".to_string()),
                 };
-                let swapped = with_atomic_mut(atomic_id, |state| {
-                    if state.value == expected {
-                        state.value = desired;
-                        true
+                let idx = args[1]
+                    .as_integer()
+                    .ok_or("char_at() needs an integer index")?;
+                with_char_index(s, |index| {
+                    let idx = if idx < 0 {
+                        index.chars as i64 + idx
                     } else {
-                        false
+                        idx
+                    };
+                    if idx < 0 || idx as usize >= index.chars {
+                        return Err(format!(
+                            "Index {} oot o' bounds fer string o' length {}",
+                            idx, index.chars
+                        ));
                     }
-                })?;
-                Ok(Value::Bool(swapped))
+                    Ok(Value::String(index.char_at(idx as usize)))
+                })
             }))),
         );
 
-        // chan_new(capacity)
+        // replace - replace occurrences in string
         globals.borrow_mut().define(
-            "chan_new".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("chan_new", 1, |args| {
-                let cap = match &args[0] {
-                    Value::Integer(n) => *n,
-                    Value::Float(f) => *f as i64,
-                    _ => return Err("chan_new() expects capacity integer".to_string()),
-                };
-                if cap < 0 {
-                    return Err("chan_new() expects non-negative capacity".to_string());
+            "replace".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("replace", 3, |args| {
+                match (&args[0], &args[1], &args[2]) {
+                    (Value::String(s), Value::String(from), Value::String(to)) => {
+                        Ok(Value::String(s.replace(from.as_ref(), to.as_ref()).into()))
+                    }
+                    _ => Err("replace() needs three strings".to_string()),
                 }
-                let id = register_channel(ChannelState {
-                    queue: VecDeque::new(),
-                    capacity: cap,
-                    closed: false,
-                });
-                Ok(Value::Integer(id))
             }))),
         );
 
-        // chan_send(chan, value) -> bool
+        // starts_wi - check if string starts with prefix (Scots: starts with)
         globals.borrow_mut().define(
-            "chan_send".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("chan_send", 2, |args| {
-                let chan_id = args[0]
-                    .as_integer()
-                    .ok_or("chan_send() expects channel handle")?;
-                let val = args[1].clone();
-                let sent = with_channel_mut(chan_id, |state| {
-                    if state.closed {
-                        return false;
-                    }
-                    if state.capacity > 0 && state.queue.len() as i64 >= state.capacity {
-                        return false;
-                    }
-                    state.queue.push_back(val.clone());
-                    true
-                })?;
-                Ok(Value::Bool(sent))
+            "starts_wi".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("starts_wi", 2, |args| match (
+                &args[0], &args[1],
+            ) {
+                (Value::String(s), Value::String(prefix)) => {
+                    Ok(Value::Bool(s.starts_with(prefix.as_ref())))
+                }
+                _ => Err("starts_wi() needs two strings".to_string()),
             }))),
         );
 
-        // chan_recv(chan) -> value or nil
+        // ends_wi - check if string ends with suffix
         globals.borrow_mut().define(
-            "chan_recv".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("chan_recv", 1, |args| {
-                let chan_id = args[0]
-                    .as_integer()
-                    .ok_or("chan_recv() expects channel handle")?;
-                let value = with_channel_mut(chan_id, |state| state.queue.pop_front())?;
-                Ok(value.unwrap_or(Value::Nil))
+            "ends_wi".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("ends_wi", 2, |args| {
+                match (&args[0], &args[1]) {
+                    (Value::String(s), Value::String(suffix)) => {
+                        Ok(Value::Bool(s.ends_with(suffix.as_ref())))
+                    }
+                    _ => Err("ends_wi() needs two strings".to_string()),
+                }
             }))),
         );
 
-        // chan_try_recv(chan) -> value or nil
+        // repeat - repeat a string n times
         globals.borrow_mut().define(
-            "chan_try_recv".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("chan_try_recv", 1, |args| {
-                let chan_id = args[0]
-                    .as_integer()
-                    .ok_or("chan_try_recv() expects channel handle")?;
-                let value = with_channel_mut(chan_id, |state| state.queue.pop_front())?;
-                Ok(value.unwrap_or(Value::Nil))
+            "repeat".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("repeat", 2, |args| {
+                match (&args[0], &args[1]) {
+                    (Value::String(s), Value::Integer(n)) => {
+                        if *n < 0 {
+                            Err("Cannae repeat a negative number o' times!".to_string())
+                        } else {
+                            Ok(Value::String(s.repeat(*n as usize).into()))
+                        }
+                    }
+                    _ => Err("repeat() needs a string and an integer".to_string()),
+                }
             }))),
         );
 
-        // chan_close(chan)
+        // index_of - find index of substring (returns -1 if not found)
         globals.borrow_mut().define(
-            "chan_close".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("chan_close", 1, |args| {
-                let chan_id = args[0]
-                    .as_integer()
-                    .ok_or("chan_close() expects channel handle")?;
-                let _ = with_channel_mut(chan_id, |state| state.closed = true)?;
-                Ok(Value::Nil)
+            "index_of".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("index_of", 2, |args| {
+                match (&args[0], &args[1]) {
+                    (Value::String(s), Value::String(needle)) => Ok(Value::Integer(
+                        s.find(needle.as_ref()).map(|i| i as i64).unwrap_or(-1),
+                    )),
+                    (Value::List(list), val) => {
+                        let list = list.borrow();
+                        for (i, item) in list.iter().enumerate() {
+                            if item == val {
+                                return Ok(Value::Integer(i as i64));
+                            }
+                        }
+                        Ok(Value::Integer(-1))
+                    }
+                    _ => Err("index_of() needs a string/list and a value".to_string()),
+                }
             }))),
         );
 
-        // chan_is_closed(chan) -> bool
+        // lines - split string into lines (on newlines)
         globals.borrow_mut().define(
-            "chan_is_closed".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("chan_is_closed", 1, |args| {
-                let chan_id = args[0]
-                    .as_integer()
-                    .ok_or("chan_is_closed() expects channel handle")?;
-                let closed = with_channel_mut(chan_id, |state| state.closed)?;
-                Ok(Value::Bool(closed))
+            "lines".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("lines", 1, |args| {
+                if let Value::String(s) = &args[0] {
+                    let line_list: Vec<Value> =
+                        s.lines().map(|line| Value::String(line.into())).collect();
+                    Ok(Value::List(Rc::new(RefCell::new(line_list))))
+                } else {
+                    Err("lines() needs a string".to_string())
+                }
             }))),
         );
 
-        // type - get type of value (whit_kind in Scots!)
+        // words - split string into words (on whitespace)
         globals.borrow_mut().define(
-            "whit_kind".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "whit_kind",
-                1,
-                |args| match &args[0] {
-                    Value::NativeObject(obj) => Ok(Value::String(obj.type_name().to_string())),
-                    _ => Ok(Value::String(args[0].type_name().to_string())),
-                },
-            ))),
+            "words".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("words", 1, |args| {
+                if let Value::String(s) = &args[0] {
+                    let word_list: Vec<Value> = s
+                        .split_whitespace()
+                        .map(|word| Value::String(word.into()))
+                        .collect();
+                    Ok(Value::List(Rc::new(RefCell::new(word_list))))
+                } else {
+                    Err("words() needs a string".to_string())
+                }
+            }))),
         );
 
-        // str - convert to string (tae_string in Scots!)
+        // is_digit - check if string contains only digits
         globals.borrow_mut().define(
-            "tae_string".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("tae_string", 1, |args| {
-                Ok(Value::String(format!("{}", args[0])))
+            "is_digit".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("is_digit", 1, |args| {
+                if let Value::String(s) = &args[0] {
+                    Ok(Value::Bool(
+                        !s.is_empty() && s.chars().all(|c| c.is_ascii_digit()),
+                    ))
+                } else {
+                    Err("is_digit() needs a string".to_string())
+                }
             }))),
         );
 
-        // int - convert to integer (tae_int in Scots!)
+        // is_alpha - check if string contains only letters
         globals.borrow_mut().define(
-            "tae_int".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "tae_int",
-                1,
-                |args| match &args[0] {
-                    Value::Integer(n) => Ok(Value::Integer(*n)),
-                    Value::Float(f) => Ok(Value::Integer(*f as i64)),
-                    Value::String(s) => s
-                        .parse::<i64>()
-                        .map(Value::Integer)
-                        .map_err(|_| format!("Cannae turn '{}' intae an integer", s)),
-                    Value::Bool(b) => Ok(Value::Integer(if *b { 1 } else { 0 })),
-                    _ => Err(format!(
-                        "Cannae turn {} intae an integer",
-                        args[0].type_name()
-                    )),
-                },
-            ))),
+            "is_alpha".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("is_alpha", 1, |args| {
+                if let Value::String(s) = &args[0] {
+                    Ok(Value::Bool(
+                        !s.is_empty() && s.chars().all(|c| c.is_alphabetic()),
+                    ))
+                } else {
+                    Err("is_alpha() needs a string".to_string())
+                }
+            }))),
         );
 
-        // float - convert to float (tae_float in Scots!)
+        // is_space - check if string contains only whitespace
         globals.borrow_mut().define(
-            "tae_float".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "tae_float",
-                1,
-                |args| match &args[0] {
-                    Value::Integer(n) => Ok(Value::Float(*n as f64)),
-                    Value::Float(f) => Ok(Value::Float(*f)),
-                    Value::String(s) => s
-                        .parse::<f64>()
-                        .map(Value::Float)
-                        .map_err(|_| format!("Cannae turn '{}' intae a float", s)),
-                    _ => Err(format!("Cannae turn {} intae a float", args[0].type_name())),
-                },
-            ))),
+            "is_space".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("is_space", 1, |args| {
+                if let Value::String(s) = &args[0] {
+                    Ok(Value::Bool(
+                        !s.is_empty() && s.chars().all(|c| c.is_whitespace()),
+                    ))
+                } else {
+                    Err("is_space() needs a string".to_string())
+                }
+            }))),
         );
 
-        // push - add to list (shove in Scots!)
+        // capitalize - capitalize first letter
         globals.borrow_mut().define(
-            "shove".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("shove", 2, |args| {
-                if let Value::List(list) = &args[0] {
-                    list.borrow_mut().push(args[1].clone());
-                    Ok(Value::Nil)
+            "capitalize".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("capitalize", 1, |args| {
+                if let Value::String(s) = &args[0] {
+                    let mut chars = s.chars();
+                    let result = match chars.next() {
+                        Some(first) => {
+                            format!("{}{}", first.to_uppercase(), chars.collect::<String>())
+                        }
+                        None => String::new(),
+                    };
+                    Ok(Value::String(result.into()))
                 } else {
-                    Err("shove() expects a list as first argument".to_string())
+                    Err("capitalize() needs a string".to_string())
                 }
             }))),
         );
 
-        // pop - remove from list (yank in Scots!)
+        // title - capitalize each word
         globals.borrow_mut().define(
-            "yank".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("yank", 1, |args| {
-                if let Value::List(list) = &args[0] {
-                    list.borrow_mut()
-                        .pop()
-                        .ok_or_else(|| "Cannae yank fae an empty list!".to_string())
+            "title".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("title", 1, |args| {
+                if let Value::String(s) = &args[0] {
+                    let result = s
+                        .split_whitespace()
+                        .map(|word| {
+                            let mut chars = word.chars();
+                            let first = chars.next().unwrap();
+                            format!(
+                                "{}{}",
+                                first.to_uppercase(),
+                                chars.collect::<String>().to_lowercase()
+                            )
+                        })
+                        .collect::<Vec<String>>()
+                        .join(" ");
+                    Ok(Value::String(result.into()))
                 } else {
-                    Err("yank() expects a list".to_string())
+                    Err("title() needs a string".to_string())
                 }
             }))),
         );
 
-        // keys - get dictionary keys
+        // chars - split string into list of characters
         globals.borrow_mut().define(
-            "keys".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("keys", 1, |args| {
-                if let Value::Dict(dict) = &args[0] {
-                    let keys: Vec<Value> = dict.borrow().keys().cloned().collect();
-                    Ok(Value::List(Rc::new(RefCell::new(keys))))
+            "chars".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("chars", 1, |args| {
+                if let Value::String(s) = &args[0] {
+                    let char_list: Vec<Value> = s
+                        .chars()
+                        .map(|c| Value::String(c.to_string().into()))
+                        .collect();
+                    Ok(Value::List(Rc::new(RefCell::new(char_list))))
                 } else {
-                    Err("keys() expects a dict".to_string())
+                    Err("chars() needs a string".to_string())
                 }
             }))),
         );
 
-        // values - get dictionary values
+        // ord - get ASCII/Unicode code of first character
         globals.borrow_mut().define(
-            "values".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("values", 1, |args| {
-                if let Value::Dict(dict) = &args[0] {
-                    let vals: Vec<Value> = dict.borrow().values().cloned().collect();
-                    Ok(Value::List(Rc::new(RefCell::new(vals))))
+            "ord".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("ord", 1, |args| {
+                if let Value::String(s) = &args[0] {
+                    s.chars()
+                        .next()
+                        .map(|c| Value::Integer(c as i64))
+                        .ok_or_else(|| "Cannae get ord o' empty string!".to_string())
                 } else {
-                    Err("values() expects a dict".to_string())
+                    Err("ord() needs a string".to_string())
                 }
             }))),
         );
 
-        // range - create a range
-        globals.borrow_mut().define(
-            "range".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("range", 2, |args| {
-                let start = args[0].as_integer().ok_or("range() expects integers")?;
-                let end = args[1].as_integer().ok_or("range() expects integers")?;
-                Ok(Interpreter::range_to_list(start, end, false))
-            }))),
-        );
-
-        // abs - absolute value
+        // chr - get character from ASCII/Unicode code
         globals.borrow_mut().define(
-            "abs".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("abs", 1, |args| {
-                match &args[0] {
-                    Value::Integer(n) => Ok(Value::Integer(n.abs())),
-                    Value::Float(f) => Ok(Value::Float(f.abs())),
-                    _ => Err("abs() expects a number".to_string()),
+            "chr".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("chr", 1, |args| {
+                if let Value::Integer(n) = &args[0] {
+                    if *n >= 0 && *n <= 0x10FFFF {
+                        char::from_u32(*n as u32)
+                            .map(|c| Value::String(c.to_string().into()))
+                            .ok_or_else(|| format!("Invalid Unicode codepoint: {}", n))
+                    } else {
+                        Err(format!(
+                            "chr() needs a valid Unicode codepoint (0 to 1114111), got {}",
+                            n
+                        ))
+                    }
+                } else {
+                    Err("chr() needs an integer".to_string())
                 }
             }))),
         );
 
-        // min - minimum value
+        // flatten - flatten nested lists one level
         globals.borrow_mut().define(
-            "min".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("min", 2, |args| {
-                match (&args[0], &args[1]) {
-                    (Value::Integer(a), Value::Integer(b)) => {
-                        Ok(Value::Integer(std::cmp::min(*a, *b)))
+            "flatten".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("flatten", 1, |args| {
+                if let Value::List(list) = &args[0] {
+                    let mut result = Vec::new();
+                    for item in list.borrow().iter() {
+                        if let Value::List(inner) = item {
+                            result.extend(inner.borrow().clone());
+                        } else {
+                            result.push(item.clone());
+                        }
                     }
-                    (Value::Float(a), Value::Float(b)) => Ok(Value::Float(a.min(*b))),
-                    _ => Err("min() expects two numbers of the same type".to_string()),
+                    Ok(Value::List(Rc::new(RefCell::new(result))))
+                } else {
+                    Err("flatten() needs a list".to_string())
                 }
             }))),
         );
 
-        // max - maximum value
+        // zip - combine two lists into list of pairs
         globals.borrow_mut().define(
-            "max".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("max", 2, |args| {
+            "zip".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("zip", 2, |args| {
                 match (&args[0], &args[1]) {
-                    (Value::Integer(a), Value::Integer(b)) => {
-                        Ok(Value::Integer(std::cmp::max(*a, *b)))
+                    (Value::List(a), Value::List(b)) => {
+                        let a = a.borrow();
+                        let b = b.borrow();
+                        let result: Vec<Value> = a
+                            .iter()
+                            .zip(b.iter())
+                            .map(|(x, y)| {
+                                Value::List(Rc::new(RefCell::new(vec![x.clone(), y.clone()])))
+                            })
+                            .collect();
+                        Ok(Value::List(Rc::new(RefCell::new(result))))
                     }
-                    (Value::Float(a), Value::Float(b)) => Ok(Value::Float(a.max(*b))),
-                    _ => Err("max() expects two numbers of the same type".to_string()),
+                    _ => Err("zip() needs two lists".to_string()),
                 }
             }))),
         );
 
-        // floor
-        globals.borrow_mut().define(
-            "floor".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "floor",
-                1,
-                |args| match &args[0] {
-                    Value::Float(f) => Ok(Value::Integer(f.floor() as i64)),
-                    Value::Integer(n) => Ok(Value::Integer(*n)),
-                    _ => Err("floor() expects a number".to_string()),
-                },
-            ))),
-        );
-
-        // ceil
+        // enumerate - return list of [index, value] pairs
         globals.borrow_mut().define(
-            "ceil".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "ceil",
-                1,
-                |args| match &args[0] {
-                    Value::Float(f) => Ok(Value::Integer(f.ceil() as i64)),
-                    Value::Integer(n) => Ok(Value::Integer(*n)),
-                    _ => Err("ceil() expects a number".to_string()),
-                },
-            ))),
+            "enumerate".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("enumerate", 1, |args| {
+                if let Value::List(list) = &args[0] {
+                    let result: Vec<Value> = list
+                        .borrow()
+                        .iter()
+                        .enumerate()
+                        .map(|(i, v)| {
+                            Value::List(Rc::new(RefCell::new(vec![
+                                Value::Integer(i as i64),
+                                v.clone(),
+                            ])))
+                        })
+                        .collect();
+                    Ok(Value::List(Rc::new(RefCell::new(result))))
+                } else {
+                    Err("enumerate() needs a list".to_string())
+                }
+            }))),
         );
 
-        // round
-        globals.borrow_mut().define(
-            "round".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "round",
-                1,
-                |args| match &args[0] {
-                    Value::Float(f) => Ok(Value::Integer(f.round() as i64)),
-                    Value::Integer(n) => Ok(Value::Integer(*n)),
-                    _ => Err("round() expects a number".to_string()),
-                },
-            ))),
-        );
+        // === More List Manipulation Functions ===
 
-        // sqrt
+        // uniq - remove duplicates from a list (keeping first occurrence)
         globals.borrow_mut().define(
-            "sqrt".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "sqrt",
-                1,
-                |args| match &args[0] {
-                    Value::Float(f) => Ok(Value::Float(f.sqrt())),
-                    Value::Integer(n) => Ok(Value::Float((*n as f64).sqrt())),
-                    _ => Err("sqrt() expects a number".to_string()),
-                },
-            ))),
+            "uniq".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("uniq", 1, |args| {
+                if let Value::List(list) = &args[0] {
+                    let result = dedup_values(list.borrow().iter());
+                    Ok(Value::List(Rc::new(RefCell::new(result))))
+                } else {
+                    Err("uniq() needs a list".to_string())
+                }
+            }))),
         );
 
-        // set_log_level - set the logging level at runtime
+        // chynge - insert at index (Scots: change)
         globals.borrow_mut().define(
-            "set_log_level".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "set_log_level",
-                1,
-                |args| match &args[0] {
-                    Value::String(s) => {
-                        if let Some(level) = LogLevel::parse_level(s) {
-                            set_global_log_level(level);
-                            Ok(Value::Nil)
-                        } else {
-                            Err(format!(
-                                "Invalid log level '{}'. Use: wheesht, roar, holler, blether, mutter, or whisper",
-                                s
-                            ))
-                        }
-                    }
-                    Value::Integer(n) => {
-                        let level = match n {
-                            0 => LogLevel::Wheesht,
-                            1 => LogLevel::Roar,
-                            2 => LogLevel::Holler,
-                            3 => LogLevel::Blether,
-                            4 => LogLevel::Mutter,
-                            5 => LogLevel::Whisper,
-                            _ => return Err(format!("Invalid log level {}. Use 0-5", n)),
-                        };
-                        set_global_log_level(level);
-                        Ok(Value::Nil)
+            "chynge".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("chynge", 3, |args| {
+                if let Value::List(list) = &args[0] {
+                    let idx = args[1]
+                        .as_integer()
+                        .ok_or("chynge() needs an integer index")?;
+                    let mut new_list = list.borrow().clone();
+                    let idx = if idx < 0 {
+                        (new_list.len() as i64 + idx) as usize
+                    } else {
+                        idx as usize
+                    };
+                    if idx > new_list.len() {
+                        return Err(format!(
+                            "Index {} oot o' bounds fer list o' length {}",
+                            idx,
+                            new_list.len()
+                        ));
                     }
-                    _ => Err("set_log_level() expects a string or integer".to_string()),
-                },
-            ))),
-        );
-
-        // get_log_level - get the current logging level
-        globals.borrow_mut().define(
-            "get_log_level".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("get_log_level", 0, |_args| {
-                let level = get_global_log_level();
-                Ok(Value::String(level.name().to_lowercase()))
+                    new_list.insert(idx, args[2].clone());
+                    Ok(Value::List(Rc::new(RefCell::new(new_list))))
+                } else {
+                    Err("chynge() needs a list".to_string())
+                }
             }))),
         );
 
-        // log_set_filter(filter_string)
+        // dicht - remove at index (Scots: wipe/clean)
         globals.borrow_mut().define(
-            "log_set_filter".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("log_set_filter", 1, |args| {
-                match &args[0] {
-                    Value::String(spec) => {
-                        logging::set_filter(spec).map_err(|e| format!("log_set_filter() {}", e))?;
-                        Ok(Value::Nil)
+            "dicht".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("dicht", 2, |args| {
+                if let Value::List(list) = &args[0] {
+                    let idx = args[1]
+                        .as_integer()
+                        .ok_or("dicht() needs an integer index")?;
+                    let mut new_list = list.borrow().clone();
+                    let idx = if idx < 0 {
+                        (new_list.len() as i64 + idx) as usize
+                    } else {
+                        idx as usize
+                    };
+                    if idx >= new_list.len() {
+                        return Err(format!(
+                            "Index {} oot o' bounds fer list o' length {}",
+                            idx,
+                            new_list.len()
+                        ));
                     }
-                    _ => Err("log_set_filter() expects a string".to_string()),
+                    new_list.remove(idx);
+                    Ok(Value::List(Rc::new(RefCell::new(new_list))))
+                } else {
+                    Err("dicht() needs a list".to_string())
                 }
             }))),
         );
 
-        // log_get_filter() -> string
+        // redd_up - remove nil values from list (Scots: tidy up)
         globals.borrow_mut().define(
-            "log_get_filter".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("log_get_filter", 0, |_args| {
-                Ok(Value::String(logging::get_filter()))
+            "redd_up".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("redd_up", 1, |args| {
+                if let Value::List(list) = &args[0] {
+                    let result: Vec<Value> = list
+                        .borrow()
+                        .iter()
+                        .filter(|v| !matches!(v, Value::Nil))
+                        .cloned()
+                        .collect();
+                    Ok(Value::List(Rc::new(RefCell::new(result))))
+                } else {
+                    Err("redd_up() needs a list".to_string())
+                }
             }))),
         );
 
-        // log_enabled(level, target = "") -> bool
+        // pairty - partition list based on predicate result (returns [truthy, falsy])
+        // Note: This is a simpler version - returns [evens, odds] for integers
         globals.borrow_mut().define(
-            "log_enabled".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "log_enabled",
-                usize::MAX,
-                |args| {
-                    if args.is_empty() || args.len() > 2 {
-                        return Err("log_enabled() expects 1 or 2 arguments".to_string());
+            "split_by".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("split_by", 2, |args| {
+                match (&args[0], &args[1]) {
+                    (Value::List(list), Value::String(pred)) => {
+                        let mut truthy = Vec::new();
+                        let mut falsy = Vec::new();
+                        for item in list.borrow().iter() {
+                            let is_match = match pred.as_ref() {
+                                "even" => matches!(item, Value::Integer(n) if n % 2 == 0),
+                                "odd" => matches!(item, Value::Integer(n) if n % 2 != 0),
+                                "positive" => matches!(item, Value::Integer(n) if *n > 0) || matches!(item, Value::Float(f) if *f > 0.0),
+                                "negative" => matches!(item, Value::Integer(n) if *n < 0) || matches!(item, Value::Float(f) if *f < 0.0),
+                                "truthy" => item.is_truthy(),
+                                "nil" => matches!(item, Value::Nil),
+                                "string" => matches!(item, Value::String(_)),
+                                "number" => matches!(item, Value::Integer(_) | Value::Float(_)),
+                                _ => return Err(format!("Unknown predicate '{}'. Try: even, odd, positive, negative, truthy, nil, string, number", pred)),
+                            };
+                            if is_match {
+                                truthy.push(item.clone());
+                            } else {
+                                falsy.push(item.clone());
+                            }
+                        }
+                        Ok(Value::List(Rc::new(RefCell::new(vec![
+                            Value::List(Rc::new(RefCell::new(truthy))),
+                            Value::List(Rc::new(RefCell::new(falsy))),
+                        ]))))
                     }
-                    let level = parse_log_level_value(&args[0])?;
-                    let target = if args.len() == 2 {
-                        parse_log_target_value(&args[1])?
-                    } else {
-                        String::new()
-                    };
-                    Ok(Value::Bool(logging::log_enabled(level, &target)))
-                },
-            ))),
+                    _ => Err("split_by() needs a list and a predicate string".to_string()),
+                }
+            }))),
         );
 
-        // log_event(level, message, fields = {}, target = "") -> nil
+        // grup_runs - group consecutive equal elements (like run-length encoding)
         globals.borrow_mut().define(
-            "log_event".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "log_event",
-                usize::MAX,
-                |args| {
-                    if args.len() < 2 || args.len() > 4 {
-                        return Err("log_event() expects 2-4 arguments".to_string());
-                    }
-                    let level = parse_log_level_value(&args[0])?;
-                    let message = args[1].clone();
-                    let (fields, target) = if args.len() > 2 {
-                        resolve_log_args(&args[2..])?
-                    } else {
-                        (None, None)
-                    };
-                    let result = with_current_interpreter(|interp| {
-                        interp.emit_log(level, message, fields, target, 0)
-                    });
-                    match result {
-                        Some(Ok(())) => Ok(Value::Nil),
-                        Some(Err(err)) => Err(format!("{}", err)),
-                        None => {
-                            Err("log_event() is unavailable outside the interpreter".to_string())
+            "grup_runs".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("grup_runs", 1, |args| {
+                if let Value::List(list) = &args[0] {
+                    let list = list.borrow();
+                    let mut result: Vec<Value> = Vec::new();
+                    let mut current_group: Vec<Value> = Vec::new();
+
+                    for item in list.iter() {
+                        if current_group.is_empty() || &current_group[0] == item {
+                            current_group.push(item.clone());
+                        } else {
+                            result.push(Value::List(Rc::new(RefCell::new(current_group))));
+                            current_group = vec![item.clone()];
                         }
                     }
-                },
-            ))),
+                    if !current_group.is_empty() {
+                        result.push(Value::List(Rc::new(RefCell::new(current_group))));
+                    }
+
+                    Ok(Value::List(Rc::new(RefCell::new(result))))
+                } else {
+                    Err("grup_runs() needs a list".to_string())
+                }
+            }))),
         );
 
-        // log_init(config = {}) -> nil
+        // chunks - split list into chunks of size n
         globals.borrow_mut().define(
-            "log_init".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "log_init",
-                usize::MAX,
-                |args| {
-                    if args.len() > 1 {
-                        return Err("log_init() expects 0 or 1 arguments".to_string());
-                    }
-                    let config = args.first().cloned();
-                    let result = with_current_interpreter(|interp| interp.apply_log_config(config));
-                    match result {
-                        Some(Ok(())) => Ok(Value::Nil),
-                        Some(Err(err)) => Err(err),
-                        None => {
-                            Err("log_init() is unavailable outside the interpreter".to_string())
-                        }
+            "chunks".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("chunks", 2, |args| {
+                if let Value::List(list) = &args[0] {
+                    let n = args[1]
+                        .as_integer()
+                        .ok_or("chunks() needs an integer size")?;
+                    if n <= 0 {
+                        return Err("chunks() size must be positive".to_string());
                     }
-                },
-            ))),
+                    let n = n as usize;
+                    let list = list.borrow();
+                    let result: Vec<Value> = list
+                        .chunks(n)
+                        .map(|chunk| Value::List(Rc::new(RefCell::new(chunk.to_vec()))))
+                        .collect();
+                    Ok(Value::List(Rc::new(RefCell::new(result))))
+                } else {
+                    Err("chunks() needs a list".to_string())
+                }
+            }))),
         );
 
-        // log_span(name, level = "blether", fields = {}, target = "") -> span_handle
+        // interleave - alternate elements from two lists
         globals.borrow_mut().define(
-            "log_span".to_string(),
+            "interleave".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "log_span",
-                usize::MAX,
-                |args| {
-                    if args.is_empty() || args.len() > 4 {
-                        return Err("log_span() expects 1-4 arguments".to_string());
+                "interleave",
+                2,
+                |args| match (&args[0], &args[1]) {
+                    (Value::List(a), Value::List(b)) => {
+                        let a = a.borrow();
+                        let b = b.borrow();
+                        let mut result = Vec::new();
+                        let max_len = a.len().max(b.len());
+                        for i in 0..max_len {
+                            if i < a.len() {
+                                result.push(a[i].clone());
+                            }
+                            if i < b.len() {
+                                result.push(b[i].clone());
+                            }
+                        }
+                        Ok(Value::List(Rc::new(RefCell::new(result))))
                     }
-                    let name = match &args[0] {
-                        Value::String(s) => s.clone(),
-                        _ => return Err("log_span() name must be a string".to_string()),
-                    };
-                    let level = if args.len() >= 2 {
-                        parse_log_level_value(&args[1])?
-                    } else {
-                        LogLevel::Blether
-                    };
-                    let fields = if args.len() >= 3 {
-                        logging::fields_from_dict(&args[2])?
-                    } else {
-                        Vec::new()
-                    };
-                    let target = if args.len() >= 4 {
-                        parse_log_target_value(&args[3])?
-                    } else {
-                        with_current_interpreter(|interp| interp.current_file.clone())
-                            .unwrap_or_default()
-                    };
-                    let span = logging::new_span(name, level, target, fields);
-                    Ok(Value::NativeObject(Rc::new(logging::LogSpanHandle::new(
-                        span,
-                    ))))
+                    _ => Err("interleave() needs two lists".to_string()),
                 },
             ))),
         );
 
-        // log_span_enter(span_handle)
+        // === More Mathematical Functions ===
+
+        // pooer - power/exponent (Scots: power)
         globals.borrow_mut().define(
-            "log_span_enter".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("log_span_enter", 1, |args| {
-                match &args[0] {
-                    Value::NativeObject(obj) => {
-                        if let Some(handle) = obj.as_any().downcast_ref::<logging::LogSpanHandle>()
-                        {
-                            logging::span_enter(handle.span());
-                            Ok(Value::Nil)
+            "pooer".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("pooer", 2, |args| {
+                match (&args[0], &args[1]) {
+                    (Value::Integer(base), Value::Integer(exp)) => {
+                        if *exp < 0 {
+                            Ok(Value::Float((*base as f64).powi(*exp as i32)))
                         } else {
-                            Err("log_span_enter() expects a log span handle".to_string())
+                            Ok(Value::Integer(base.pow(*exp as u32)))
                         }
                     }
-                    _ => Err("log_span_enter() expects a log span handle".to_string()),
+                    (Value::Float(base), Value::Integer(exp)) => {
+                        Ok(Value::Float(base.powi(*exp as i32)))
+                    }
+                    (Value::Float(base), Value::Float(exp)) => Ok(Value::Float(base.powf(*exp))),
+                    (Value::Integer(base), Value::Float(exp)) => {
+                        Ok(Value::Float((*base as f64).powf(*exp)))
+                    }
+                    _ => Err("pooer() needs twa numbers".to_string()),
                 }
             }))),
         );
 
-        // log_span_exit(span_handle)
+        // sin - sine (trigonometry)
         globals.borrow_mut().define(
-            "log_span_exit".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "log_span_exit",
-                1,
-                |args| match &args[0] {
-                    Value::NativeObject(obj) => {
-                        if let Some(handle) = obj.as_any().downcast_ref::<logging::LogSpanHandle>()
-                        {
-                            logging::span_exit(handle.span().id)
-                                .map_err(|e| format!("log_span_exit() {}", e))?;
-                            Ok(Value::Nil)
-                        } else {
-                            Err("log_span_exit() expects a log span handle".to_string())
-                        }
-                    }
-                    _ => Err("log_span_exit() expects a log span handle".to_string()),
-                },
-            ))),
+            "sin".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("sin", 1, |args| {
+                match &args[0] {
+                    Value::Float(f) => Ok(Value::Float(f.sin())),
+                    Value::Integer(n) => Ok(Value::Float((*n as f64).sin())),
+                    _ => Err("sin() needs a number".to_string()),
+                }
+            }))),
         );
 
-        // log_span_current() -> span_handle | nil
+        // cos - cosine
         globals.borrow_mut().define(
-            "log_span_current".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "log_span_current",
-                0,
-                |_args| {
-                    if let Some(span) = logging::span_current() {
-                        Ok(Value::NativeObject(Rc::new(logging::LogSpanHandle::new(
-                            span,
-                        ))))
-                    } else {
-                        Ok(Value::Nil)
-                    }
-                },
-            ))),
+            "cos".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("cos", 1, |args| {
+                match &args[0] {
+                    Value::Float(f) => Ok(Value::Float(f.cos())),
+                    Value::Integer(n) => Ok(Value::Float((*n as f64).cos())),
+                    _ => Err("cos() needs a number".to_string()),
+                }
+            }))),
         );
 
-        // log_span_in(span_handle, fn) -> value
+        // tan - tangent
         globals.borrow_mut().define(
-            "log_span_in".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("log_span_in", 2, |args| {
-                let span = match &args[0] {
-                    Value::NativeObject(obj) => obj
-                        .as_any()
-                        .downcast_ref::<logging::LogSpanHandle>()
-                        .map(|h| h.span())
-                        .ok_or_else(|| "log_span_in() expects a log span handle".to_string())?,
-                    _ => return Err("log_span_in() expects a log span handle".to_string()),
-                };
-                let func = args[1].clone();
-
-                logging::span_enter(span.clone());
-                let result =
-                    with_current_interpreter(|interp| interp.call_value(func, Vec::new(), 0));
-                let _ = logging::span_exit(span.id);
-
-                match result {
-                    Some(Ok(val)) => Ok(val),
-                    Some(Err(err)) => Err(format!("{}", err)),
-                    None => Err("log_span_in() is unavailable outside the interpreter".to_string()),
+            "tan".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("tan", 1, |args| {
+                match &args[0] {
+                    Value::Float(f) => Ok(Value::Float(f.tan())),
+                    Value::Integer(n) => Ok(Value::Float((*n as f64).tan())),
+                    _ => Err("tan() needs a number".to_string()),
                 }
             }))),
         );
 
-        // stacktrace - get the current stack trace as a string
+        // log - natural logarithm
         globals.borrow_mut().define(
-            "stacktrace".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("stacktrace", 0, |_args| {
-                let stack = get_stack_trace();
-                let trace = stack
-                    .iter()
-                    .rev()
-                    .map(|f| format!("  at {} ({}:{})", f.name, f.file, f.line))
-                    .collect::<Vec<_>>()
-                    .join("\n");
-                Ok(Value::String(if trace.is_empty() {
-                    "(no stack trace)".to_string()
-                } else {
-                    trace
-                }))
+            "log".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("log", 1, |args| {
+                match &args[0] {
+                    Value::Float(f) => Ok(Value::Float(f.ln())),
+                    Value::Integer(n) => Ok(Value::Float((*n as f64).ln())),
+                    _ => Err("log() needs a number".to_string()),
+                }
             }))),
         );
 
-        // set_crash_handling - enable or disable crash handling
+        // log10 - base 10 logarithm
         globals.borrow_mut().define(
-            "set_crash_handling".to_string(),
+            "log10".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "set_crash_handling",
+                "log10",
                 1,
                 |args| match &args[0] {
-                    Value::Bool(enabled) => {
-                        set_crash_handling(*enabled);
-                        Ok(Value::Nil)
-                    }
-                    _ => Err("set_crash_handling() expects a boolean".to_string()),
+                    Value::Float(f) => Ok(Value::Float(f.log10())),
+                    Value::Integer(n) => Ok(Value::Float((*n as f64).log10())),
+                    _ => Err("log10() needs a number".to_string()),
                 },
             ))),
         );
 
-        // split - split string
-        globals.borrow_mut().define(
-            "split".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("split", 2, |args| {
-                match (&args[0], &args[1]) {
-                    (Value::String(s), Value::String(delim)) => {
-                        let parts: Vec<Value> = s
-                            .split(delim.as_str())
-                            .map(|p| Value::String(p.to_string()))
-                            .collect();
-                        Ok(Value::List(Rc::new(RefCell::new(parts))))
-                    }
-                    _ => Err("split() expects two strings".to_string()),
-                }
-            }))),
-        );
+        // PI constant
+        globals
+            .borrow_mut()
+            .define("PI".to_string(), Value::Float(std::f64::consts::PI));
 
-        // join - join list into string
+        // E constant (Euler's number)
+        globals
+            .borrow_mut()
+            .define("E".to_string(), Value::Float(std::f64::consts::E));
+
+        // TAU constant (2*PI)
+        globals
+            .borrow_mut()
+            .define("TAU".to_string(), Value::Float(std::f64::consts::TAU));
+
+        // exp - e raised to the power
         globals.borrow_mut().define(
-            "join".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("join", 2, |args| {
-                match (&args[0], &args[1]) {
-                    (Value::List(list), Value::String(delim)) => {
-                        let parts: Vec<String> =
-                            list.borrow().iter().map(|v| format!("{}", v)).collect();
-                        Ok(Value::String(parts.join(delim)))
-                    }
-                    _ => Err("join() expects a list and a string".to_string()),
+            "exp".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("exp", 1, |args| {
+                match &args[0] {
+                    Value::Float(f) => Ok(Value::Float(f.exp())),
+                    Value::Integer(n) => Ok(Value::Float((*n as f64).exp())),
+                    _ => Err("exp() needs a number".to_string()),
                 }
             }))),
         );
 
-        // contains - check if list/string contains value
+        // pow - raise to a power (Scottish: mak it muckle!)
         globals.borrow_mut().define(
-            "contains".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "contains",
-                2,
-                |args| match &args[0] {
-                    Value::List(list) => {
-                        let found = list.borrow().iter().any(|v| v == &args[1]);
-                        Ok(Value::Bool(found))
-                    }
-                    Value::String(s) => {
-                        if let Value::String(needle) = &args[1] {
-                            Ok(Value::Bool(s.contains(needle.as_str())))
-                        } else {
-                            Err("contains() on string expects a string needle".to_string())
-                        }
-                    }
-                    Value::Dict(dict) => Ok(Value::Bool(dict.borrow().contains_key(&args[1]))),
-                    _ => Err("contains() expects a list, string, or dict".to_string()),
-                },
-            ))),
+            "pow".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("pow", 2, |args| {
+                let base = match &args[0] {
+                    Value::Float(f) => *f,
+                    Value::Integer(n) => *n as f64,
+                    _ => return Err("pow() needs numbers".to_string()),
+                };
+                let exponent = match &args[1] {
+                    Value::Float(f) => *f,
+                    Value::Integer(n) => *n as f64,
+                    _ => return Err("pow() needs numbers".to_string()),
+                };
+                Ok(Value::Float(base.powf(exponent)))
+            }))),
         );
 
-        // reverse - reverse a list or string
+        // asin - arc sine
         globals.borrow_mut().define(
-            "reverse".to_string(),
+            "asin".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "reverse",
-                1,
-                |args| match &args[0] {
-                    Value::List(list) => {
-                        let mut reversed = list.borrow().clone();
-                        reversed.reverse();
-                        Ok(Value::List(Rc::new(RefCell::new(reversed))))
-                    }
-                    Value::String(s) => Ok(Value::String(s.chars().rev().collect())),
-                    _ => Err("reverse() expects a list or string".to_string()),
-                },
-            ))),
-        );
-
-        // slap - append lists together (like a friendly slap on the back!)
-        globals.borrow_mut().define(
-            "slap".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("slap", 2, |args| {
-                match (&args[0], &args[1]) {
-                    (Value::List(a), Value::List(b)) => {
-                        let mut result = a.borrow().clone();
-                        result.extend(b.borrow().clone());
-                        Ok(Value::List(Rc::new(RefCell::new(result))))
-                    }
-                    (Value::String(a), Value::String(b)) => {
-                        Ok(Value::String(format!("{}{}", a, b)))
-                    }
-                    _ => Err("slap() expects two lists or two strings".to_string()),
-                }
-            }))),
+                "asin",
+                1,
+                |args| match &args[0] {
+                    Value::Float(f) => Ok(Value::Float(f.asin())),
+                    Value::Integer(n) => Ok(Value::Float((*n as f64).asin())),
+                    _ => Err("asin() needs a number".to_string()),
+                },
+            ))),
         );
 
-        // heid - get the first element (head)
+        // acos - arc cosine
         globals.borrow_mut().define(
-            "heid".to_string(),
+            "acos".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "heid",
+                "acos",
                 1,
                 |args| match &args[0] {
-                    Value::List(list) => list
-                        .borrow()
-                        .first()
-                        .cloned()
-                        .ok_or("Cannae get heid o' empty list!".to_string()),
-                    Value::String(s) => s
-                        .chars()
-                        .next()
-                        .map(|c| Value::String(c.to_string()))
-                        .ok_or("Cannae get heid o' empty string!".to_string()),
-                    _ => Err("heid() expects a list or string".to_string()),
+                    Value::Float(f) => Ok(Value::Float(f.acos())),
+                    Value::Integer(n) => Ok(Value::Float((*n as f64).acos())),
+                    _ => Err("acos() needs a number".to_string()),
                 },
             ))),
         );
 
-        // tail - get everything except the first (like a tail!)
+        // atan - arc tangent
         globals.borrow_mut().define(
-            "tail".to_string(),
+            "atan".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "tail",
+                "atan",
                 1,
                 |args| match &args[0] {
-                    Value::List(list) => {
-                        let list = list.borrow();
-                        if list.is_empty() {
-                            Ok(Value::List(Rc::new(RefCell::new(Vec::new()))))
-                        } else {
-                            Ok(Value::List(Rc::new(RefCell::new(list[1..].to_vec()))))
-                        }
-                    }
-                    Value::String(s) => Ok(Value::String(s.chars().skip(1).collect())),
-                    _ => Err("tail() expects a list or string".to_string()),
+                    Value::Float(f) => Ok(Value::Float(f.atan())),
+                    Value::Integer(n) => Ok(Value::Float((*n as f64).atan())),
+                    _ => Err("atan() needs a number".to_string()),
                 },
             ))),
         );
 
-        // bum - get the last element (backside!)
+        // atan2 - two-argument arc tangent
         globals.borrow_mut().define(
-            "bum".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("bum", 1, |args| {
-                match &args[0] {
-                    Value::List(list) => list
-                        .borrow()
-                        .last()
-                        .cloned()
-                        .ok_or("Cannae get bum o' empty list!".to_string()),
-                    Value::String(s) => s
-                        .chars()
-                        .last()
-                        .map(|c| Value::String(c.to_string()))
-                        .ok_or("Cannae get bum o' empty string!".to_string()),
-                    _ => Err("bum() expects a list or string".to_string()),
-                }
+            "atan2".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("atan2", 2, |args| {
+                let y = match &args[0] {
+                    Value::Float(f) => *f,
+                    Value::Integer(n) => *n as f64,
+                    _ => return Err("atan2() needs numbers".to_string()),
+                };
+                let x = match &args[1] {
+                    Value::Float(f) => *f,
+                    Value::Integer(n) => *n as f64,
+                    _ => return Err("atan2() needs numbers".to_string()),
+                };
+                Ok(Value::Float(y.atan2(x)))
             }))),
         );
 
-        // scran - slice a list or string (grab a portion, like grabbing scran/food)
+        // hypot - hypotenuse (sqrt(x² + y²))
         globals.borrow_mut().define(
-            "scran".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("scran", 3, |args| {
-                let start = args[1]
-                    .as_integer()
-                    .ok_or("scran() needs integer indices")?;
-                let end = args[2]
-                    .as_integer()
-                    .ok_or("scran() needs integer indices")?;
-                match &args[0] {
-                    Value::List(list) => {
-                        let list = list.borrow();
-                        let start = start.max(0) as usize;
-                        let end = end.min(list.len() as i64) as usize;
-                        Ok(Value::List(Rc::new(RefCell::new(
-                            list[start..end].to_vec(),
-                        ))))
-                    }
-                    Value::String(s) => {
-                        let start = start.max(0) as usize;
-                        let end = end.min(s.len() as i64) as usize;
-                        Ok(Value::String(
-                            s.chars().skip(start).take(end - start).collect(),
-                        ))
-                    }
-                    _ => Err("scran() expects a list or string".to_string()),
-                }
+            "hypot".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("hypot", 2, |args| {
+                let x = match &args[0] {
+                    Value::Float(f) => *f,
+                    Value::Integer(n) => *n as f64,
+                    _ => return Err("hypot() needs numbers".to_string()),
+                };
+                let y = match &args[1] {
+                    Value::Float(f) => *f,
+                    Value::Integer(n) => *n as f64,
+                    _ => return Err("hypot() needs numbers".to_string()),
+                };
+                Ok(Value::Float(x.hypot(y)))
             }))),
         );
 
-        // sumaw - sum all numbers in a list (sum aw = sum all)
+        // degrees - convert radians to degrees
         globals.borrow_mut().define(
-            "sumaw".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("sumaw", 1, |args| {
-                if let Value::List(list) = &args[0] {
-                    let mut sum: f64 = 0.0;
-                    let mut is_float = false;
-                    for item in list.borrow().iter() {
-                        match item {
-                            Value::Integer(n) => sum += *n as f64,
-                            Value::Float(f) => {
-                                sum += f;
-                                is_float = true;
-                            }
-                            _ => return Err("sumaw() expects a list of numbers".to_string()),
-                        }
-                    }
-                    if is_float {
-                        Ok(Value::Float(sum))
-                    } else {
-                        Ok(Value::Integer(sum as i64))
-                    }
-                } else {
-                    Err("sumaw() expects a list".to_string())
-                }
-            }))),
+            "degrees".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "degrees",
+                1,
+                |args| match &args[0] {
+                    Value::Float(f) => Ok(Value::Float(f.to_degrees())),
+                    Value::Integer(n) => Ok(Value::Float((*n as f64).to_degrees())),
+                    _ => Err("degrees() needs a number".to_string()),
+                },
+            ))),
         );
 
-        // coont - count occurrences in list or string
+        // radians - convert degrees to radians
         globals.borrow_mut().define(
-            "coont".to_string(),
+            "radians".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "coont",
-                2,
+                "radians",
+                1,
                 |args| match &args[0] {
-                    Value::List(list) => {
-                        let count = list.borrow().iter().filter(|&x| x == &args[1]).count();
-                        Ok(Value::Integer(count as i64))
-                    }
-                    Value::String(s) => {
-                        if let Value::String(needle) = &args[1] {
-                            let count = s.matches(needle.as_str()).count();
-                            Ok(Value::Integer(count as i64))
-                        } else {
-                            Err("coont() on string needs a string tae count".to_string())
-                        }
-                    }
-                    _ => Err("coont() expects a list or string".to_string()),
+                    Value::Float(f) => Ok(Value::Float(f.to_radians())),
+                    Value::Integer(n) => Ok(Value::Float((*n as f64).to_radians())),
+                    _ => Err("radians() needs a number".to_string()),
                 },
             ))),
         );
 
-        // wheesht - remove whitespace (be quiet/silent!)
+        // === Time Functions ===
+
+        // snooze - sleep for milliseconds (Scots: have a wee rest)
         globals.borrow_mut().define(
-            "wheesht".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("wheesht", 1, |args| {
+            "snooze".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("snooze", 1, |args| {
+                let ms = args[0]
+                    .as_integer()
+                    .ok_or("snooze() needs an integer (milliseconds)")?;
+                if ms < 0 {
+                    return Err("Cannae snooze fer negative time, ya daftie!".to_string());
+                }
+                std::thread::sleep(std::time::Duration::from_millis(ms as u64));
+                Ok(Value::Nil)
+            }))),
+        );
+
+        // === String Functions ===
+
+        // roar - convert to uppercase (shout it oot even louder than upper!)
+        globals.borrow_mut().define(
+            "roar".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("roar", 1, |args| {
                 if let Value::String(s) = &args[0] {
-                    Ok(Value::String(s.trim().to_string()))
+                    // Add exclamation for extra emphasis!
+                    Ok(Value::String(format!("{}!", s.to_uppercase()).into()))
                 } else {
-                    Err("wheesht() expects a string".to_string())
+                    Err("roar() expects a string".to_string())
                 }
             }))),
         );
 
-        // upper - to uppercase (shout it oot!)
+        // mutter - whisper text (lowercase with dots)
         globals.borrow_mut().define(
-            "upper".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("upper", 1, |args| {
+            "mutter".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("mutter", 1, |args| {
                 if let Value::String(s) = &args[0] {
-                    Ok(Value::String(s.to_uppercase()))
+                    Ok(Value::String(format!("...{}...", s.to_lowercase()).into()))
                 } else {
-                    Err("upper() expects a string".to_string())
+                    Err("mutter() expects a string".to_string())
                 }
             }))),
         );
 
-        // lower - to lowercase (calm doon!)
+        // blooter - scramble a string randomly (Scots: hit/strike messily)
         globals.borrow_mut().define(
-            "lower".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("lower", 1, |args| {
+            "blooter".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("blooter", 1, |args| {
                 if let Value::String(s) = &args[0] {
-                    Ok(Value::String(s.to_lowercase()))
+                    let mut chars: Vec<char> = s.chars().collect();
+                    rng_shuffle(&mut chars);
+                    Ok(Value::String(chars.into_iter().collect::<String>().into()))
                 } else {
-                    Err("lower() expects a string".to_string())
+                    Err("blooter() expects a string".to_string())
                 }
             }))),
         );
 
-        // shuffle - randomly shuffle a list (like a ceilidh!)
+        // pad_left - pad string on left
         globals.borrow_mut().define(
-            "shuffle".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("shuffle", 1, |args| {
-                if let Value::List(list) = &args[0] {
-                    use std::time::{SystemTime, UNIX_EPOCH};
-                    let seed = SystemTime::now()
-                        .duration_since(UNIX_EPOCH)
-                        .unwrap()
-                        .as_nanos() as u64;
-                    let mut shuffled = list.borrow().clone();
-                    // Simple Fisher-Yates shuffle with basic RNG
-                    let mut rng = seed;
-                    for i in (1..shuffled.len()).rev() {
-                        rng = rng.wrapping_mul(1103515245).wrapping_add(12345);
-                        let j = (rng as usize) % (i + 1);
-                        shuffled.swap(i, j);
+            "pad_left".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("pad_left", 3, |args| {
+                match (&args[0], &args[1], &args[2]) {
+                    (Value::String(s), Value::Integer(width), Value::String(pad)) => {
+                        let pad_char = pad.chars().next().unwrap_or(' ');
+                        let w = *width as usize;
+                        if s.len() >= w {
+                            Ok(Value::String(s.clone()))
+                        } else {
+                            Ok(Value::String(
+                                format!("{}{}", pad_char.to_string().repeat(w - s.len()), s).into(),
+                            ))
+                        }
                     }
-                    Ok(Value::List(Rc::new(RefCell::new(shuffled))))
-                } else {
-                    Err("shuffle() expects a list".to_string())
+                    _ => Err("pad_left() needs (string, width, pad_char)".to_string()),
                 }
             }))),
         );
 
-        // sort - sort a list
+        // pad_right - pad string on right
         globals.borrow_mut().define(
-            "sort".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("sort", 1, |args| {
-                if let Value::List(list) = &args[0] {
-                    let mut sorted = list.borrow().clone();
-                    sorted.sort_by(|a, b| match (a, b) {
-                        (Value::Integer(x), Value::Integer(y)) => x.cmp(y),
-                        (Value::Float(x), Value::Float(y)) => {
-                            x.partial_cmp(y).unwrap_or(std::cmp::Ordering::Equal)
-                        }
-                        (Value::String(x), Value::String(y)) => x.cmp(y),
-                        _ => std::cmp::Ordering::Equal,
-                    });
-                    Ok(Value::List(Rc::new(RefCell::new(sorted))))
-                } else {
-                    Err("sort() expects a list".to_string())
+            "pad_right".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("pad_right", 3, |args| match (
+                &args[0], &args[1], &args[2],
+            ) {
+                (Value::String(s), Value::Integer(width), Value::String(pad)) => {
+                    let pad_char = pad.chars().next().unwrap_or(' ');
+                    let w = *width as usize;
+                    if s.len() >= w {
+                        Ok(Value::String(s.clone()))
+                    } else {
+                        Ok(Value::String(
+                            format!("{}{}", s, pad_char.to_string().repeat(w - s.len())).into(),
+                        ))
+                    }
                 }
+                _ => Err("pad_right() needs (string, width, pad_char)".to_string()),
             }))),
         );
 
-        // jammy - random number (Scots: lucky!)
+        // === List Functions ===
+
+        // drap - drop first n elements from list (Scots: drop)
         globals.borrow_mut().define(
-            "jammy".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("jammy", 2, |args| {
-                use std::time::{SystemTime, UNIX_EPOCH};
-                let min = args[0].as_integer().ok_or("jammy() needs integer bounds")?;
-                let max = args[1].as_integer().ok_or("jammy() needs integer bounds")?;
-                if min >= max {
-                    return Err("jammy() needs min < max, ya numpty!".to_string());
+            "drap".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("drap", 2, |args| {
+                match (&args[0], &args[1]) {
+                    (Value::List(list), Value::Integer(n)) => {
+                        let n = *n as usize;
+                        let items = list.borrow();
+                        let result: Vec<Value> = items.iter().skip(n).cloned().collect();
+                        Ok(Value::List(Rc::new(RefCell::new(result))))
+                    }
+                    _ => Err("drap() needs a list and an integer".to_string()),
                 }
-                let seed = SystemTime::now()
-                    .duration_since(UNIX_EPOCH)
-                    .unwrap()
-                    .as_nanos() as u64;
-                let rng = seed.wrapping_mul(1103515245).wrapping_add(12345);
-                let range = (max - min) as u64;
-                let result = min + ((rng % range) as i64);
-                Ok(Value::Integer(result))
             }))),
         );
 
-        // the_noo - current timestamp in seconds (Scots: "the now")
+        // tak - take first n elements from list (Scots: take)
         globals.borrow_mut().define(
-            "the_noo".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("the_noo", 0, |_args| {
-                use std::time::{SystemTime, UNIX_EPOCH};
-                let secs = SystemTime::now()
-                    .duration_since(UNIX_EPOCH)
-                    .unwrap()
-                    .as_secs();
-                Ok(Value::Integer(secs as i64))
+            "tak".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("tak", 2, |args| {
+                match (&args[0], &args[1]) {
+                    (Value::List(list), Value::Integer(n)) => {
+                        let n = *n as usize;
+                        let items = list.borrow();
+                        let result: Vec<Value> = items.iter().take(n).cloned().collect();
+                        Ok(Value::List(Rc::new(RefCell::new(result))))
+                    }
+                    _ => Err("tak() needs a list and an integer".to_string()),
+                }
             }))),
         );
 
-        // mono_ms - monotonic milliseconds since start
+        // grup - group elements into chunks (Scots: grip/group)
         globals.borrow_mut().define(
-            "mono_ms".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("mono_ms", 0, |_args| {
-                let start = MONO_START.get_or_init(std::time::Instant::now);
-                let ms = start.elapsed().as_millis() as i64;
-                Ok(Value::Integer(ms))
+            "grup".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("grup", 2, |args| {
+                match (&args[0], &args[1]) {
+                    (Value::List(list), Value::Integer(size)) => {
+                        if *size <= 0 {
+                            return Err("grup() needs a positive chunk size".to_string());
+                        }
+                        let size = *size as usize;
+                        let items = list.borrow();
+                        let result: Vec<Value> = items
+                            .chunks(size)
+                            .map(|chunk| Value::List(Rc::new(RefCell::new(chunk.to_vec()))))
+                            .collect();
+                        Ok(Value::List(Rc::new(RefCell::new(result))))
+                    }
+                    _ => Err("grup() needs a list and an integer".to_string()),
+                }
             }))),
         );
 
-        // mono_ns - monotonic nanoseconds since start
+        // pair_up - create pairs from a list [a,b,c,d] -> [[a,b], [c,d]]
         globals.borrow_mut().define(
-            "mono_ns".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("mono_ns", 0, |_args| {
-                let start = MONO_START.get_or_init(std::time::Instant::now);
-                let ns = start.elapsed().as_nanos() as i64;
-                Ok(Value::Integer(ns))
+            "pair_up".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("pair_up", 1, |args| {
+                if let Value::List(list) = &args[0] {
+                    let items = list.borrow();
+                    let result: Vec<Value> = items
+                        .chunks(2)
+                        .map(|chunk| Value::List(Rc::new(RefCell::new(chunk.to_vec()))))
+                        .collect();
+                    Ok(Value::List(Rc::new(RefCell::new(result))))
+                } else {
+                    Err("pair_up() needs a list".to_string())
+                }
             }))),
         );
 
-        // is_a - type checking (returns aye/nae)
+        // fankle - interleave two lists (Scots: tangle)
         globals.borrow_mut().define(
-            "is_a".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("is_a", 2, |args| {
-                let type_name = match &args[1] {
-                    Value::String(s) => s.as_str(),
-                    _ => return Err("is_a() needs a type name string".to_string()),
-                };
-                let matches = match type_name {
-                    "integer" | "int" => matches!(args[0], Value::Integer(_)),
-                    "float" => matches!(args[0], Value::Float(_)),
-                    "string" | "str" => matches!(args[0], Value::String(_)),
-                    "bool" => matches!(args[0], Value::Bool(_)),
-                    "list" => matches!(args[0], Value::List(_)),
-                    "bytes" | "byte" => matches!(args[0], Value::Bytes(_)),
-                    "dict" => matches!(args[0], Value::Dict(_)),
-                    "function" | "dae" => {
-                        matches!(args[0], Value::Function(_) | Value::NativeFunction(_))
+            "fankle".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("fankle", 2, |args| {
+                match (&args[0], &args[1]) {
+                    (Value::List(a), Value::List(b)) => {
+                        let a = a.borrow();
+                        let b = b.borrow();
+                        let mut result = Vec::new();
+                        let mut ai = a.iter();
+                        let mut bi = b.iter();
+                        loop {
+                            match (ai.next(), bi.next()) {
+                                (Some(x), Some(y)) => {
+                                    result.push(x.clone());
+                                    result.push(y.clone());
+                                }
+                                (Some(x), None) => result.push(x.clone()),
+                                (None, Some(y)) => result.push(y.clone()),
+                                (None, None) => break,
+                            }
+                        }
+                        Ok(Value::List(Rc::new(RefCell::new(result))))
                     }
-                    "naething" | "nil" => matches!(args[0], Value::Nil),
-                    "range" => matches!(args[0], Value::Range(_)),
-                    _ => false,
-                };
-                Ok(Value::Bool(matches))
+                    _ => Err("fankle() needs two lists".to_string()),
+                }
             }))),
         );
 
-        // tae_bool - convert to boolean
+        // === Fun Scottish Functions ===
+
+        // och - express disappointment or frustration
         globals.borrow_mut().define(
-            "tae_bool".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("tae_bool", 1, |args| {
-                Ok(Value::Bool(args[0].is_truthy()))
+            "och".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("och", 1, |args| {
+                Ok(Value::String(format!("Och! {}", args[0]).into()))
             }))),
         );
 
-        // char_at - get character at index (returns string of length 1)
+        // jings - express surprise (like "gosh!" or "goodness!")
         globals.borrow_mut().define(
-            "char_at".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("char_at", 2, |args| {
-                let s = match &args[0] {
-                    Value::String(s) => s,
-                    _ => return Err("char_at() needs a string".to_string()),
-                };
-                let idx = args[1]
-                    .as_integer()
-                    .ok_or("char_at() needs an integer index")?;
-                let idx = if idx < 0 { s.len() as i64 + idx } else { idx } as usize;
-                s.chars()
-                    .nth(idx)
-                    .map(|c| Value::String(c.to_string()))
-                    .ok_or_else(|| {
-                        format!(
-                            "Index {} oot o' bounds fer string o' length {}",
-                            idx,
-                            s.len()
-                        )
-                    })
+            "jings".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("jings", 1, |args| {
+                Ok(Value::String(format!("Jings! {}", args[0]).into()))
             }))),
         );
 
-        // replace - replace occurrences in string
+        // crivvens - express astonishment (from Oor Wullie)
         globals.borrow_mut().define(
-            "replace".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("replace", 3, |args| {
-                match (&args[0], &args[1], &args[2]) {
-                    (Value::String(s), Value::String(from), Value::String(to)) => {
-                        Ok(Value::String(s.replace(from.as_str(), to.as_str())))
-                    }
-                    _ => Err("replace() needs three strings".to_string()),
-                }
+            "crivvens".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("crivvens", 1, |args| {
+                Ok(Value::String(format!("Crivvens! {}", args[0]).into()))
             }))),
         );
 
-        // starts_wi - check if string starts with prefix (Scots: starts with)
+        // help_ma_boab - express extreme surprise (Scottish exclamation)
         globals.borrow_mut().define(
-            "starts_wi".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("starts_wi", 2, |args| match (
-                &args[0], &args[1],
-            ) {
-                (Value::String(s), Value::String(prefix)) => {
-                    Ok(Value::Bool(s.starts_with(prefix.as_str())))
-                }
-                _ => Err("starts_wi() needs two strings".to_string()),
+            "help_ma_boab".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("help_ma_boab", 1, |args| {
+                Ok(Value::String(format!("Help ma boab! {}", args[0]).into()))
             }))),
         );
 
-        // ends_wi - check if string ends with suffix
+        // haud_yer_wheesht - tell someone to be quiet (returns empty string)
         globals.borrow_mut().define(
-            "ends_wi".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("ends_wi", 2, |args| {
-                match (&args[0], &args[1]) {
-                    (Value::String(s), Value::String(suffix)) => {
-                        Ok(Value::Bool(s.ends_with(suffix.as_str())))
-                    }
-                    _ => Err("ends_wi() needs two strings".to_string()),
-                }
-            }))),
+            "haud_yer_wheesht".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "haud_yer_wheesht",
+                0,
+                |_args| Ok(Value::String("".into())),
+            ))),
         );
 
-        // repeat - repeat a string n times
+        // braw - check if something is good/excellent
         globals.borrow_mut().define(
-            "repeat".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("repeat", 2, |args| {
-                match (&args[0], &args[1]) {
-                    (Value::String(s), Value::Integer(n)) => {
-                        if *n < 0 {
-                            Err("Cannae repeat a negative number o' times!".to_string())
-                        } else {
-                            Ok(Value::String(s.repeat(*n as usize)))
-                        }
-                    }
-                    _ => Err("repeat() needs a string and an integer".to_string()),
-                }
+            "braw".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("braw", 1, |args| {
+                // Everything is braw in Scotland!
+                let val = &args[0];
+                let is_braw = match val {
+                    Value::Nil => false,
+                    Value::Bool(b) => *b,
+                    Value::Integer(n) => *n > 0,
+                    Value::Float(f) => *f > 0.0,
+                    Value::String(s) => !s.is_empty(),
+                    Value::List(l) => !l.borrow().is_empty(),
+                    Value::Dict(d) => !d.borrow().is_empty(),
+                    _ => true,
+                };
+                Ok(Value::Bool(is_braw))
             }))),
         );
 
-        // index_of - find index of substring (returns -1 if not found)
+        // clarty - check if something is messy/dirty (has duplicates in list)
         globals.borrow_mut().define(
-            "index_of".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("index_of", 2, |args| {
-                match (&args[0], &args[1]) {
-                    (Value::String(s), Value::String(needle)) => Ok(Value::Integer(
-                        s.find(needle.as_str()).map(|i| i as i64).unwrap_or(-1),
-                    )),
-                    (Value::List(list), val) => {
-                        let list = list.borrow();
-                        for (i, item) in list.iter().enumerate() {
-                            if item == val {
-                                return Ok(Value::Integer(i as i64));
-                            }
+            "clarty".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("clarty", 1, |args| {
+                if let Value::List(list) = &args[0] {
+                    let items = list.borrow();
+                    let mut seen = Vec::new();
+                    for item in items.iter() {
+                        if seen.contains(item) {
+                            return Ok(Value::Bool(true)); // Has duplicates = clarty
                         }
-                        Ok(Value::Integer(-1))
+                        seen.push(item.clone());
                     }
-                    _ => Err("index_of() needs a string/list and a value".to_string()),
+                    Ok(Value::Bool(false))
+                } else if let Value::String(s) = &args[0] {
+                    // String is clarty if it has repeated characters
+                    let chars: Vec<char> = s.chars().collect();
+                    let unique: std::collections::HashSet<char> = chars.iter().cloned().collect();
+                    Ok(Value::Bool(chars.len() != unique.len()))
+                } else {
+                    Err("clarty() needs a list or string".to_string())
                 }
             }))),
         );
 
-        // lines - split string into lines (on newlines)
+        // dreich - check if a string is boring/dull (all same character or empty)
         globals.borrow_mut().define(
-            "lines".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("lines", 1, |args| {
+            "dreich".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("dreich", 1, |args| {
                 if let Value::String(s) = &args[0] {
-                    let line_list: Vec<Value> = s
-                        .lines()
-                        .map(|line| Value::String(line.to_string()))
-                        .collect();
-                    Ok(Value::List(Rc::new(RefCell::new(line_list))))
+                    if s.is_empty() {
+                        return Ok(Value::Bool(true)); // Empty is dreich
+                    }
+                    let first = s.chars().next().unwrap();
+                    let is_dreich = s.chars().all(|c| c == first);
+                    Ok(Value::Bool(is_dreich))
                 } else {
-                    Err("lines() needs a string".to_string())
+                    Err("dreich() needs a string".to_string())
                 }
             }))),
         );
 
-        // words - split string into words (on whitespace)
+        // stoater - get a particularly good/outstanding element (max for numbers)
         globals.borrow_mut().define(
-            "words".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("words", 1, |args| {
-                if let Value::String(s) = &args[0] {
-                    let word_list: Vec<Value> = s
-                        .split_whitespace()
-                        .map(|word| Value::String(word.to_string()))
-                        .collect();
-                    Ok(Value::List(Rc::new(RefCell::new(word_list))))
+            "stoater".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("stoater", 1, |args| {
+                if let Value::List(list) = &args[0] {
+                    let items = list.borrow();
+                    if items.is_empty() {
+                        return Err("Cannae find a stoater in an empty list!".to_string());
+                    }
+                    // Find the "best" element (max for numbers, longest for strings)
+                    let mut best = items[0].clone();
+                    for item in items.iter().skip(1) {
+                        match (&best, item) {
+                            (Value::Integer(a), Value::Integer(b)) => {
+                                if *b > *a {
+                                    best = item.clone();
+                                }
+                            }
+                            (Value::Float(a), Value::Float(b)) => {
+                                if *b > *a {
+                                    best = item.clone();
+                                }
+                            }
+                            (Value::String(a), Value::String(b)) => {
+                                if b.len() > a.len() {
+                                    best = item.clone();
+                                }
+                            }
+                            _ => {}
+                        }
+                    }
+                    Ok(best)
                 } else {
-                    Err("words() needs a string".to_string())
+                    Err("stoater() needs a list".to_string())
                 }
             }))),
         );
 
-        // is_digit - check if string contains only digits
+        // numpty_check - validate input isn't empty/nil
         globals.borrow_mut().define(
-            "is_digit".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("is_digit", 1, |args| {
-                if let Value::String(s) = &args[0] {
-                    Ok(Value::Bool(
-                        !s.is_empty() && s.chars().all(|c| c.is_ascii_digit()),
-                    ))
-                } else {
-                    Err("is_digit() needs a string".to_string())
-                }
-            }))),
+            "numpty_check".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "numpty_check",
+                1,
+                |args| match &args[0] {
+                    Value::Nil => Ok(Value::String("That's naething, ya numpty!".into())),
+                    Value::String(s) if s.is_empty() => {
+                        Ok(Value::String("Empty string, ya numpty!".into()))
+                    }
+                    Value::List(l) if l.borrow().is_empty() => {
+                        Ok(Value::String("Empty list, ya numpty!".into()))
+                    }
+                    _ => Ok(Value::String("That's braw!".into())),
+                },
+            ))),
         );
 
-        // is_alpha - check if string contains only letters
+        // scottify - add Scottish flair to text
         globals.borrow_mut().define(
-            "is_alpha".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("is_alpha", 1, |args| {
+            "scottify".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("scottify", 1, |args| {
                 if let Value::String(s) = &args[0] {
-                    Ok(Value::Bool(
-                        !s.is_empty() && s.chars().all(|c| c.is_alphabetic()),
-                    ))
+                    let scottified = s
+                        .replace("yes", "aye")
+                        .replace("Yes", "Aye")
+                        .replace("no", "nae")
+                        .replace("No", "Nae")
+                        .replace("know", "ken")
+                        .replace("Know", "Ken")
+                        .replace("not", "nae")
+                        .replace("from", "fae")
+                        .replace("to", "tae")
+                        .replace("do", "dae")
+                        .replace("myself", "masel")
+                        .replace("yourself", "yersel")
+                        .replace("small", "wee")
+                        .replace("little", "wee")
+                        .replace("child", "bairn")
+                        .replace("children", "bairns")
+                        .replace("church", "kirk")
+                        .replace("beautiful", "bonnie")
+                        .replace("Beautiful", "Bonnie")
+                        .replace("going", "gaun")
+                        .replace("have", "hae")
+                        .replace("nothing", "naething")
+                        .replace("something", "somethin")
+                        .replace("everything", "awthing")
+                        .replace("everyone", "awbody")
+                        .replace("about", "aboot")
+                        .replace("out", "oot")
+                        .replace("house", "hoose");
+                    Ok(Value::String(scottified.into()))
                 } else {
-                    Err("is_alpha() needs a string".to_string())
+                    Err("scottify() needs a string".to_string())
                 }
             }))),
         );
 
-        // is_space - check if string contains only whitespace
+        // unique - remove duplicates from list (keeps first occurrence)
         globals.borrow_mut().define(
-            "is_space".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("is_space", 1, |args| {
-                if let Value::String(s) = &args[0] {
-                    Ok(Value::Bool(
-                        !s.is_empty() && s.chars().all(|c| c.is_whitespace()),
-                    ))
+            "unique".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("unique", 1, |args| {
+                if let Value::List(list) = &args[0] {
+                    let result = dedup_values(list.borrow().iter());
+                    Ok(Value::List(Rc::new(RefCell::new(result))))
                 } else {
-                    Err("is_space() needs a string".to_string())
+                    Err("unique() needs a list".to_string())
                 }
             }))),
         );
 
-        // capitalize - capitalize first letter
+        // === File I/O Functions ===
+
+        // scrieve - write to file (Scots: "write")
         globals.borrow_mut().define(
-            "capitalize".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("capitalize", 1, |args| {
-                if let Value::String(s) = &args[0] {
-                    let mut chars = s.chars();
-                    let result = match chars.next() {
-                        Some(first) => {
-                            format!("{}{}", first.to_uppercase(), chars.collect::<String>())
-                        }
-                        None => String::new(),
-                    };
-                    Ok(Value::String(result))
-                } else {
-                    Err("capitalize() needs a string".to_string())
-                }
+            "scrieve".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("scrieve", 2, |args| {
+                use std::fs::File;
+                use std::io::Write as IoWrite;
+                let path = match &args[0] {
+                    Value::String(s) => s.clone(),
+                    _ => return Err("scrieve() needs a file path string".to_string()),
+                };
+                let content = args[1].to_string();
+                let mut file = File::create(&*path)
+                    .map_err(|e| format!("Couldnae open '{}' fer writin': {}", path, e))?;
+                file.write_all(content.as_bytes())
+                    .map_err(|e| format!("Couldnae write tae '{}': {}", path, e))?;
+                Ok(Value::Nil)
             }))),
         );
 
-        // title - capitalize each word
+        // read_file - read entire file (Scots: readie would be good but let's be clear)
         globals.borrow_mut().define(
-            "title".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("title", 1, |args| {
-                if let Value::String(s) = &args[0] {
-                    let result = s
-                        .split_whitespace()
-                        .map(|word| {
-                            let mut chars = word.chars();
-                            let first = chars.next().unwrap();
-                            format!(
-                                "{}{}",
-                                first.to_uppercase(),
-                                chars.collect::<String>().to_lowercase()
-                            )
-                        })
-                        .collect::<Vec<String>>()
-                        .join(" ");
-                    Ok(Value::String(result))
-                } else {
-                    Err("title() needs a string".to_string())
-                }
+            "read_file".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("read_file", 1, |args| {
+                use std::fs;
+                let path = match &args[0] {
+                    Value::String(s) => s.clone(),
+                    _ => return Err("read_file() needs a file path string".to_string()),
+                };
+                let content = fs::read_to_string(&*path)
+                    .map_err(|e| format!("Couldnae read '{}': {}", path, e))?;
+                Ok(Value::String(content.into()))
             }))),
         );
 
-        // chars - split string into list of characters
+        // read_lines - read file as list of lines
         globals.borrow_mut().define(
-            "chars".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("chars", 1, |args| {
-                if let Value::String(s) = &args[0] {
-                    let char_list: Vec<Value> =
-                        s.chars().map(|c| Value::String(c.to_string())).collect();
-                    Ok(Value::List(Rc::new(RefCell::new(char_list))))
-                } else {
-                    Err("chars() needs a string".to_string())
-                }
+            "read_lines".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("read_lines", 1, |args| {
+                use std::fs;
+                let path = match &args[0] {
+                    Value::String(s) => s.clone(),
+                    _ => return Err("read_lines() needs a file path string".to_string()),
+                };
+                let content = fs::read_to_string(&*path)
+                    .map_err(|e| format!("Couldnae read '{}': {}", path, e))?;
+                let lines: Vec<Value> = content.lines().map(|l| Value::String(l.into())).collect();
+                Ok(Value::List(Rc::new(RefCell::new(lines))))
             }))),
         );
 
-        // ord - get ASCII/Unicode code of first character
+        // file_map - the whole file as bytes (native builds map it; here it is read)
         globals.borrow_mut().define(
-            "ord".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("ord", 1, |args| {
-                if let Value::String(s) = &args[0] {
-                    s.chars()
-                        .next()
-                        .map(|c| Value::Integer(c as i64))
-                        .ok_or_else(|| "Cannae get ord o' empty string!".to_string())
-                } else {
-                    Err("ord() needs a string".to_string())
-                }
+            "file_map".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("file_map", 1, |args| {
+                let path = match &args[0] {
+                    Value::String(s) => s.clone(),
+                    _ => return Err("file_map() needs a file path string".to_string()),
+                };
+                let data = std::fs::read(&*path)
+                    .map_err(|e| format!("file_map() cannae open '{}': {}", path, e))?;
+                Ok(Value::Bytes(Rc::new(RefCell::new(data))))
             }))),
         );
 
-        // chr - get character from ASCII/Unicode code
+        // slurp_bytes - a file (or a range of it) as bytes, zeros and all
         globals.borrow_mut().define(
-            "chr".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("chr", 1, |args| {
-                if let Value::Integer(n) = &args[0] {
-                    if *n >= 0 && *n <= 0x10FFFF {
-                        char::from_u32(*n as u32)
-                            .map(|c| Value::String(c.to_string()))
-                            .ok_or_else(|| format!("Invalid Unicode codepoint: {}", n))
-                    } else {
-                        Err(format!(
-                            "chr() needs a valid Unicode codepoint (0 to 1114111), got {}",
-                            n
-                        ))
+            "slurp_bytes".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "slurp_bytes",
+                usize::MAX,
+                |args| {
+                    use std::io::{Read, Seek, SeekFrom};
+                    if args.is_empty() || args.len() > 3 {
+                        return Err("slurp_bytes() expects 1-3 arguments (path, offset, length)"
+                            .to_string());
                     }
-                } else {
-                    Err("chr() needs an integer".to_string())
-                }
+                    let path = match &args[0] {
+                        Value::String(s) => s.clone(),
+                        _ => return Err("slurp_bytes() needs a file path string".to_string()),
+                    };
+                    let count = |v: Option<&Value>| match v {
+                        None | Some(Value::Nil) => Ok(None),
+                        Some(Value::Integer(n)) if *n >= 0 => Ok(Some(*n as u64)),
+                        Some(_) => {
+                            Err("slurp_bytes() offset and length must be byte counts".to_string())
+                        }
+                    };
+                    let offset = count(args.get(1))?.unwrap_or(0);
+                    let length = count(args.get(2))?;
+                    let mut file = std::fs::File::open(&*path)
+                        .map_err(|e| format!("slurp_bytes() cannae open '{}': {}", path, e))?;
+                    let mut data = Vec::new();
+                    let read = file
+                        .seek(SeekFrom::Start(offset))
+                        .and_then(|_| match length {
+                            Some(n) => Read::take(&mut file, n).read_to_end(&mut data),
+                            None => file.read_to_end(&mut data),
+                        });
+                    read.map_err(|e| format!("slurp_bytes() couldnae read '{}': {}", path, e))?;
+                    Ok(Value::Bytes(Rc::new(RefCell::new(data))))
+                },
+            ))),
+        );
+
+        // scrieve_bytes - replace a file's contents with bytes, written as they are
+        globals.borrow_mut().define(
+            "scrieve_bytes".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("scrieve_bytes", 2, |args| {
+                let path = match &args[0] {
+                    Value::String(s) => s.clone(),
+                    _ => return Err("scrieve_bytes() needs a file path string".to_string()),
+                };
+                let result = match &args[1] {
+                    Value::Bytes(b) => std::fs::write(&*path, &*b.borrow()),
+                    Value::String(s) => std::fs::write(&*path, s.as_bytes()),
+                    _ => return Err("scrieve_bytes() needs bytes or a string".to_string()),
+                };
+                result.map_err(|e| format!("scrieve_bytes() couldnae write '{}': {}", path, e))?;
+                Ok(Value::Nil)
             }))),
         );
 
-        // flatten - flatten nested lists one level
+        // lines_iter - a reader that gives back a file's lines one at a time
         globals.borrow_mut().define(
-            "flatten".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("flatten", 1, |args| {
-                if let Value::List(list) = &args[0] {
-                    let mut result = Vec::new();
-                    for item in list.borrow().iter() {
-                        if let Value::List(inner) = item {
-                            result.extend(inner.borrow().clone());
-                        } else {
-                            result.push(item.clone());
-                        }
-                    }
-                    Ok(Value::List(Rc::new(RefCell::new(result))))
-                } else {
-                    Err("flatten() needs a list".to_string())
-                }
+            "lines_iter".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("lines_iter", 1, |args| {
+                let path = match &args[0] {
+                    Value::String(s) => s.clone(),
+                    _ => return Err("lines_iter() needs a file path string".to_string()),
+                };
+                let file = std::fs::File::open(&*path)
+                    .map_err(|e| format!("lines_iter() cannae open '{}': {}", path, e))?;
+                let reader = std::io::BufReader::with_capacity(64 * 1024, file);
+                Ok(Value::NativeObject(Rc::new(LineReader {
+                    reader: RefCell::new(Some(reader)),
+                })))
             }))),
         );
 
-        // zip - combine two lists into list of pairs
+        // lines_next - the next line without its newline, or nil at the end
         globals.borrow_mut().define(
-            "zip".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("zip", 2, |args| {
-                match (&args[0], &args[1]) {
-                    (Value::List(a), Value::List(b)) => {
-                        let a = a.borrow();
-                        let b = b.borrow();
-                        let result: Vec<Value> = a
-                            .iter()
-                            .zip(b.iter())
-                            .map(|(x, y)| {
-                                Value::List(Rc::new(RefCell::new(vec![x.clone(), y.clone()])))
-                            })
-                            .collect();
-                        Ok(Value::List(Rc::new(RefCell::new(result))))
+            "lines_next".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("lines_next", 1, |args| {
+                use std::io::BufRead;
+                with_line_reader("lines_next", &args[0], |r| {
+                    let mut slot = r.reader.borrow_mut();
+                    let Some(reader) = slot.as_mut() else {
+                        return Ok(Value::Nil);
+                    };
+                    let mut line = Vec::new();
+                    let read = reader
+                        .read_until(b'\n', &mut line)
+                        .map_err(|e| format!("lines_next() couldnae read: {}", e))?;
+                    if read == 0 {
+                        *slot = None;
+                        return Ok(Value::Nil);
                     }
-                    _ => Err("zip() needs two lists".to_string()),
-                }
+                    if line.last() == Some(&b'\n') {
+                        line.pop();
+                    }
+                    Ok(Value::String(
+                        String::from_utf8_lossy(&line).into_owned().into(),
+                    ))
+                })
             }))),
         );
 
-        // enumerate - return list of [index, value] pairs
+        // lines_close - stop reading early and let go of the file
         globals.borrow_mut().define(
-            "enumerate".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("enumerate", 1, |args| {
-                if let Value::List(list) = &args[0] {
-                    let result: Vec<Value> = list
-                        .borrow()
-                        .iter()
-                        .enumerate()
-                        .map(|(i, v)| {
-                            Value::List(Rc::new(RefCell::new(vec![
-                                Value::Integer(i as i64),
-                                v.clone(),
-                            ])))
-                        })
-                        .collect();
-                    Ok(Value::List(Rc::new(RefCell::new(result))))
-                } else {
-                    Err("enumerate() needs a list".to_string())
-                }
+            "lines_close".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("lines_close", 1, |args| {
+                with_line_reader("lines_close", &args[0], |r| {
+                    r.reader.borrow_mut().take();
+                    Ok(Value::Nil)
+                })
             }))),
         );
 
-        // === More List Manipulation Functions ===
-
-        // uniq - remove duplicates from a list (keeping first occurrence)
+        // file_open - a buffered handle for writing ("w" truncates, "a" appends)
         globals.borrow_mut().define(
-            "uniq".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("uniq", 1, |args| {
-                if let Value::List(list) = &args[0] {
-                    let mut seen = Vec::new();
-                    let mut result = Vec::new();
-                    for item in list.borrow().iter() {
-                        let item_str = format!("{:?}", item);
-                        if !seen.contains(&item_str) {
-                            seen.push(item_str);
-                            result.push(item.clone());
-                        }
+            "file_open".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "file_open",
+                usize::MAX,
+                |args| {
+                    use std::fs::OpenOptions;
+                    if args.is_empty() || args.len() > 3 {
+                        return Err(
+                            "file_open() expects 1-3 arguments (path, mode, buffer)".to_string()
+                        );
                     }
-                    Ok(Value::List(Rc::new(RefCell::new(result))))
-                } else {
-                    Err("uniq() needs a list".to_string())
-                }
-            }))),
+                    let path = match &args[0] {
+                        Value::String(s) => s.clone(),
+                        _ => return Err("file_open() needs a file path string".to_string()),
+                    };
+                    let mut options = OpenOptions::new();
+                    match args.get(1) {
+                        None | Some(Value::Nil) => options.write(true).create(true).truncate(true),
+                        Some(Value::String(m)) if **m == *"w" => {
+                            options.write(true).create(true).truncate(true)
+                        }
+                        Some(Value::String(m)) if **m == *"a" => options.append(true).create(true),
+                        Some(other) => {
+                            return Err(format!(
+                                "file_open() mode must be \"w\" or \"a\", no {}",
+                                other
+                            ))
+                        }
+                    };
+                    let capacity = match args.get(2) {
+                        None | Some(Value::Nil) => 64 * 1024,
+                        Some(Value::Integer(n)) if *n >= 0 => *n as usize,
+                        Some(_) => {
+                            return Err(
+                                "file_open() buffer must be a byte count (0 fer nane)".to_string()
+                            )
+                        }
+                    };
+                    let file = options
+                        .open(&*path)
+                        .map_err(|e| format!("file_open() cannae open '{}': {}", path, e))?;
+                    let writer = Rc::new(RefCell::new(Some(std::io::BufWriter::with_capacity(
+                        capacity, file,
+                    ))));
+                    OPEN_FILES.with(|files| files.borrow_mut().push(Rc::downgrade(&writer)));
+                    Ok(Value::NativeObject(Rc::new(FileHandle {
+                        path: path.to_string(),
+                        writer,
+                    })))
+                },
+            ))),
         );
 
-        // chynge - insert at index (Scots: change)
+        // file_write - add a string or bytes to a file_open handle
         globals.borrow_mut().define(
-            "chynge".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("chynge", 3, |args| {
-                if let Value::List(list) = &args[0] {
-                    let idx = args[1]
-                        .as_integer()
-                        .ok_or("chynge() needs an integer index")?;
-                    let mut new_list = list.borrow().clone();
-                    let idx = if idx < 0 {
-                        (new_list.len() as i64 + idx) as usize
-                    } else {
-                        idx as usize
+            "file_write".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("file_write", 2, |args| {
+                with_file_writer("file_write", &args[0], |w, path| {
+                    let result = match &args[1] {
+                        Value::Bytes(b) => w.write_all(&b.borrow()),
+                        Value::String(s) => w.write_all(s.as_bytes()),
+                        v => w.write_all(format!("{}", v).as_bytes()),
                     };
-                    if idx > new_list.len() {
-                        return Err(format!(
-                            "Index {} oot o' bounds fer list o' length {}",
-                            idx,
-                            new_list.len()
-                        ));
-                    }
-                    new_list.insert(idx, args[2].clone());
-                    Ok(Value::List(Rc::new(RefCell::new(new_list))))
-                } else {
-                    Err("chynge() needs a list".to_string())
-                }
+                    result.map_err(|e| format!("file_write() couldnae write '{}': {}", path, e))?;
+                    Ok(Value::Nil)
+                })
             }))),
         );
 
-        // dicht - remove at index (Scots: wipe/clean)
+        // file_write_lines - write each item of a list followed by a newline
         globals.borrow_mut().define(
-            "dicht".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("dicht", 2, |args| {
-                if let Value::List(list) = &args[0] {
-                    let idx = args[1]
-                        .as_integer()
-                        .ok_or("dicht() needs an integer index")?;
-                    let mut new_list = list.borrow().clone();
-                    let idx = if idx < 0 {
-                        (new_list.len() as i64 + idx) as usize
-                    } else {
-                        idx as usize
+            "file_write_lines".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "file_write_lines",
+                2,
+                |args| {
+                    let Value::List(items) = &args[1] else {
+                        return Err("file_write_lines() needs a list o' lines".to_string());
                     };
-                    if idx >= new_list.len() {
-                        return Err(format!(
-                            "Index {} oot o' bounds fer list o' length {}",
-                            idx,
-                            new_list.len()
-                        ));
-                    }
-                    new_list.remove(idx);
-                    Ok(Value::List(Rc::new(RefCell::new(new_list))))
-                } else {
-                    Err("dicht() needs a list".to_string())
-                }
-            }))),
+                    with_file_writer("file_write_lines", &args[0], |w, path| {
+                        for item in items.borrow().iter() {
+                            let result = match item {
+                                Value::Bytes(b) => w.write_all(&b.borrow()),
+                                Value::String(s) => w.write_all(s.as_bytes()),
+                                v => w.write_all(format!("{}", v).as_bytes()),
+                            };
+                            result.and_then(|_| w.write_all(b"\n")).map_err(|e| {
+                                format!("file_write_lines() couldnae write '{}': {}", path, e)
+                            })?;
+                        }
+                        Ok(Value::Nil)
+                    })
+                },
+            ))),
         );
 
-        // redd_up - remove nil values from list (Scots: tidy up)
+        // file_flush - push buffered writes out to the file
         globals.borrow_mut().define(
-            "redd_up".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("redd_up", 1, |args| {
-                if let Value::List(list) = &args[0] {
-                    let result: Vec<Value> = list
-                        .borrow()
-                        .iter()
-                        .filter(|v| !matches!(v, Value::Nil))
-                        .cloned()
-                        .collect();
-                    Ok(Value::List(Rc::new(RefCell::new(result))))
-                } else {
-                    Err("redd_up() needs a list".to_string())
-                }
+            "file_flush".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("file_flush", 1, |args| {
+                with_file_writer("file_flush", &args[0], |w, path| {
+                    w.flush()
+                        .map_err(|e| format!("file_flush() couldnae write '{}': {}", path, e))?;
+                    Ok(Value::Nil)
+                })
             }))),
         );
 
-        // pairty - partition list based on predicate result (returns [truthy, falsy])
-        // Note: This is a simpler version - returns [evens, odds] for integers
+        // file_close - flush and close; closing twice is fine
         globals.borrow_mut().define(
-            "split_by".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("split_by", 2, |args| {
-                match (&args[0], &args[1]) {
-                    (Value::List(list), Value::String(pred)) => {
-                        let mut truthy = Vec::new();
-                        let mut falsy = Vec::new();
-                        for item in list.borrow().iter() {
-                            let is_match = match pred.as_str() {
-                                "even" => matches!(item, Value::Integer(n) if n % 2 == 0),
-                                "odd" => matches!(item, Value::Integer(n) if n % 2 != 0),
-                                "positive" => matches!(item, Value::Integer(n) if *n > 0) || matches!(item, Value::Float(f) if *f > 0.0),
-                                "negative" => matches!(item, Value::Integer(n) if *n < 0) || matches!(item, Value::Float(f) if *f < 0.0),
-                                "truthy" => item.is_truthy(),
-                                "nil" => matches!(item, Value::Nil),
-                                "string" => matches!(item, Value::String(_)),
-                                "number" => matches!(item, Value::Integer(_) | Value::Float(_)),
-                                _ => return Err(format!("Unknown predicate '{}'. Try: even, odd, positive, negative, truthy, nil, string, number", pred)),
-                            };
-                            if is_match {
-                                truthy.push(item.clone());
-                            } else {
-                                falsy.push(item.clone());
-                            }
-                        }
-                        Ok(Value::List(Rc::new(RefCell::new(vec![
-                            Value::List(Rc::new(RefCell::new(truthy))),
-                            Value::List(Rc::new(RefCell::new(falsy))),
-                        ]))))
-                    }
-                    _ => Err("split_by() needs a list and a predicate string".to_string()),
-                }
+            "file_close".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("file_close", 1, |args| {
+                let handle = match &args[0] {
+                    Value::NativeObject(obj) => obj.as_any().downcast_ref::<FileHandle>(),
+                    _ => None,
+                };
+                let Some(handle) = handle else {
+                    return Err("file_close() needs a file frae file_open".to_string());
+                };
+                let Some(writer) = handle.writer.borrow_mut().take() else {
+                    return Ok(Value::Nil);
+                };
+                writer.into_inner().map_err(|e| {
+                    format!(
+                        "file_close() couldnae write '{}': {}",
+                        handle.path,
+                        e.error()
+                    )
+                })?;
+                Ok(Value::Nil)
             }))),
         );
 
-        // grup_runs - group consecutive equal elements (like run-length encoding)
+        // file_exists - check if file exists
         globals.borrow_mut().define(
-            "grup_runs".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("grup_runs", 1, |args| {
-                if let Value::List(list) = &args[0] {
-                    let list = list.borrow();
-                    let mut result: Vec<Value> = Vec::new();
-                    let mut current_group: Vec<Value> = Vec::new();
-
-                    for item in list.iter() {
-                        if current_group.is_empty() || &current_group[0] == item {
-                            current_group.push(item.clone());
-                        } else {
-                            result.push(Value::List(Rc::new(RefCell::new(current_group))));
-                            current_group = vec![item.clone()];
-                        }
-                    }
-                    if !current_group.is_empty() {
-                        result.push(Value::List(Rc::new(RefCell::new(current_group))));
-                    }
-
-                    Ok(Value::List(Rc::new(RefCell::new(result))))
-                } else {
-                    Err("grup_runs() needs a list".to_string())
-                }
+            "file_exists".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("file_exists", 1, |args| {
+                use std::path::Path;
+                let path = match &args[0] {
+                    Value::String(s) => s.clone(),
+                    _ => return Err("file_exists() needs a file path string".to_string()),
+                };
+                Ok(Value::Bool(Path::new(&*path).exists()))
             }))),
         );
 
-        // chunks - split list into chunks of size n
+        // append_file - append to file
         globals.borrow_mut().define(
-            "chunks".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("chunks", 2, |args| {
-                if let Value::List(list) = &args[0] {
-                    let n = args[1]
-                        .as_integer()
-                        .ok_or("chunks() needs an integer size")?;
-                    if n <= 0 {
-                        return Err("chunks() size must be positive".to_string());
-                    }
-                    let n = n as usize;
-                    let list = list.borrow();
-                    let result: Vec<Value> = list
-                        .chunks(n)
-                        .map(|chunk| Value::List(Rc::new(RefCell::new(chunk.to_vec()))))
-                        .collect();
-                    Ok(Value::List(Rc::new(RefCell::new(result))))
-                } else {
-                    Err("chunks() needs a list".to_string())
-                }
+            "append_file".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("append_file", 2, |args| {
+                use std::fs::OpenOptions;
+                use std::io::Write as IoWrite;
+                let path = match &args[0] {
+                    Value::String(s) => s.clone(),
+                    _ => return Err("append_file() needs a file path string".to_string()),
+                };
+                let content = args[1].to_string();
+                let mut file = OpenOptions::new()
+                    .create(true)
+                    .append(true)
+                    .open(&*path)
+                    .map_err(|e| format!("Couldnae open '{}' fer appendin': {}", path, e))?;
+                file.write_all(content.as_bytes())
+                    .map_err(|e| format!("Couldnae append tae '{}': {}", path, e))?;
+                Ok(Value::Nil)
             }))),
         );
 
-        // interleave - alternate elements from two lists
+        // === More Scots-Themed Functions ===
+
+        // haver - generate random nonsense (Scots: talk rubbish)
         globals.borrow_mut().define(
-            "interleave".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "interleave",
-                2,
-                |args| match (&args[0], &args[1]) {
-                    (Value::List(a), Value::List(b)) => {
-                        let a = a.borrow();
-                        let b = b.borrow();
-                        let mut result = Vec::new();
-                        let max_len = a.len().max(b.len());
-                        for i in 0..max_len {
-                            if i < a.len() {
-                                result.push(a[i].clone());
-                            }
-                            if i < b.len() {
-                                result.push(b[i].clone());
-                            }
-                        }
-                        Ok(Value::List(Rc::new(RefCell::new(result))))
-                    }
-                    _ => Err("interleave() needs two lists".to_string()),
-                },
-            ))),
+            "haver".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("haver", 0, |_args| {
+                let havers = [
+                    "Och, yer bum's oot the windae!",
+                    "Awa' an bile yer heid!",
+                    "Haud yer wheesht, ya numpty!",
+                    "Dinnae fash yersel!",
+                    "Whit's fer ye'll no go by ye!",
+                    "Lang may yer lum reek!",
+                    "Yer a wee scunner, so ye are!",
+                    "Haste ye back!",
+                    "It's a dreich day the day!",
+                    "Pure dead brilliant!",
+                    "Ah'm fair puckled!",
+                    "Gie it laldy!",
+                    "Whit a stoater!",
+                    "That's pure mince!",
+                    "Jings, crivvens, help ma boab!",
+                ];
+                let idx = rng_below(havers.len() as u64) as usize;
+                Ok(Value::String(havers[idx].into()))
+            }))),
         );
 
-        // === More Mathematical Functions ===
-
-        // pooer - power/exponent (Scots: power)
+        // slainte - return a Scottish toast (Scots: health/cheers)
         globals.borrow_mut().define(
-            "pooer".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("pooer", 2, |args| {
-                match (&args[0], &args[1]) {
-                    (Value::Integer(base), Value::Integer(exp)) => {
-                        if *exp < 0 {
-                            Ok(Value::Float((*base as f64).powi(*exp as i32)))
-                        } else {
-                            Ok(Value::Integer(base.pow(*exp as u32)))
-                        }
-                    }
-                    (Value::Float(base), Value::Integer(exp)) => {
-                        Ok(Value::Float(base.powi(*exp as i32)))
-                    }
-                    (Value::Float(base), Value::Float(exp)) => Ok(Value::Float(base.powf(*exp))),
-                    (Value::Integer(base), Value::Float(exp)) => {
-                        Ok(Value::Float((*base as f64).powf(*exp)))
-                    }
-                    _ => Err("pooer() needs twa numbers".to_string()),
-                }
+            "slainte".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("slainte", 0, |_args| {
+                let toasts = [
+                    "Slàinte mhath! (Good health!)",
+                    "Here's tae us, wha's like us? Gey few, and they're a' deid!",
+                    "May the best ye've ever seen be the worst ye'll ever see!",
+                    "Lang may yer lum reek wi' ither fowk's coal!",
+                    "May ye aye be happy, an' never drink frae a toom glass!",
+                    "Here's tae the heath, the hill and the heather!",
+                ];
+                let idx = rng_below(toasts.len() as u64) as usize;
+                Ok(Value::String(toasts[idx].into()))
             }))),
         );
 
-        // sin - sine (trigonometry)
+        // braw_time - format current time in a nice Scottish way
         globals.borrow_mut().define(
-            "sin".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("sin", 1, |args| {
-                match &args[0] {
-                    Value::Float(f) => Ok(Value::Float(f.sin())),
-                    Value::Integer(n) => Ok(Value::Float((*n as f64).sin())),
-                    _ => Err("sin() needs a number".to_string()),
-                }
+            "braw_time".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("braw_time", 0, |_args| {
+                use std::time::{SystemTime, UNIX_EPOCH};
+                let secs = SystemTime::now()
+                    .duration_since(UNIX_EPOCH)
+                    .unwrap()
+                    .as_secs();
+                // Simple hour/minute calculation (UTC)
+                let hours = (secs / 3600) % 24;
+                let minutes = (secs / 60) % 60;
+                Ok(Value::String(format_braw_time(hours, minutes).into()))
             }))),
         );
 
-        // cos - cosine
+        // wheesht_aw - trim and clean up a string (more thorough than wheesht)
         globals.borrow_mut().define(
-            "cos".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("cos", 1, |args| {
-                match &args[0] {
-                    Value::Float(f) => Ok(Value::Float(f.cos())),
-                    Value::Integer(n) => Ok(Value::Float((*n as f64).cos())),
-                    _ => Err("cos() needs a number".to_string()),
+            "wheesht_aw".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("wheesht_aw", 1, |args| {
+                if let Value::String(s) = &args[0] {
+                    // Collapse multiple spaces and trim
+                    let cleaned: String = s.split_whitespace().collect::<Vec<_>>().join(" ");
+                    Ok(Value::String(cleaned.into()))
+                } else {
+                    Err("wheesht_aw() needs a string".to_string())
                 }
             }))),
         );
 
-        // tan - tangent
+        // scunner_check - validate that a value meets expectations (returns descriptive error)
         globals.borrow_mut().define(
-            "tan".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("tan", 1, |args| {
-                match &args[0] {
-                    Value::Float(f) => Ok(Value::Float(f.tan())),
-                    Value::Integer(n) => Ok(Value::Float((*n as f64).tan())),
-                    _ => Err("tan() needs a number".to_string()),
+            "scunner_check".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("scunner_check", 2, |args| {
+                let val = &args[0];
+                let expected_type = match &args[1] {
+                    Value::String(s) => s.as_ref(),
+                    _ => return Err("scunner_check() needs type name as second arg".to_string()),
+                };
+                let actual_type = val.type_name();
+                if actual_type == expected_type {
+                    Ok(Value::Bool(true))
+                } else {
+                    Ok(Value::String(
+                        format!(
+                            "Och, ya scunner! Expected {} but got {}",
+                            expected_type, actual_type
+                        )
+                        .into(),
+                    ))
                 }
             }))),
         );
 
-        // log - natural logarithm
+        // bampot_mode - deliberately cause chaos (scramble list order)
         globals.borrow_mut().define(
-            "log".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("log", 1, |args| {
-                match &args[0] {
-                    Value::Float(f) => Ok(Value::Float(f.ln())),
-                    Value::Integer(n) => Ok(Value::Float((*n as f64).ln())),
-                    _ => Err("log() needs a number".to_string()),
+            "bampot_mode".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("bampot_mode", 1, |args| {
+                if let Value::List(list) = &args[0] {
+                    let mut items: Vec<Value> = list.borrow().clone();
+                    // Double shuffle for extra chaos!
+                    rng_shuffle(&mut items);
+                    rng_shuffle(&mut items);
+                    items.reverse(); // And reverse for good measure!
+                    Ok(Value::List(Rc::new(RefCell::new(items))))
+                } else {
+                    Err("bampot_mode() needs a list".to_string())
                 }
             }))),
         );
 
-        // log10 - base 10 logarithm
+        // crabbit - check if a number is negative (Scots: grumpy/bad-tempered)
         globals.borrow_mut().define(
-            "log10".to_string(),
+            "crabbit".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "log10",
+                "crabbit",
                 1,
                 |args| match &args[0] {
-                    Value::Float(f) => Ok(Value::Float(f.log10())),
-                    Value::Integer(n) => Ok(Value::Float((*n as f64).log10())),
-                    _ => Err("log10() needs a number".to_string()),
+                    Value::Integer(n) => Ok(Value::Bool(*n < 0)),
+                    Value::Float(f) => Ok(Value::Bool(*f < 0.0)),
+                    _ => Err("crabbit() needs a number".to_string()),
                 },
             ))),
         );
 
-        // PI constant
-        globals
-            .borrow_mut()
-            .define("PI".to_string(), Value::Float(std::f64::consts::PI));
-
-        // E constant (Euler's number)
-        globals
-            .borrow_mut()
-            .define("E".to_string(), Value::Float(std::f64::consts::E));
-
-        // TAU constant (2*PI)
-        globals
-            .borrow_mut()
-            .define("TAU".to_string(), Value::Float(std::f64::consts::TAU));
-
-        // exp - e raised to the power
+        // gallus - check if a value is bold/impressive (non-empty/non-zero)
+        globals.borrow_mut().define(
+            "gallus".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("gallus", 1, |args| {
+                let is_gallus = match &args[0] {
+                    Value::Integer(n) => *n != 0 && (*n > 100 || *n < -100),
+                    Value::Float(f) => *f != 0.0 && (*f > 100.0 || *f < -100.0),
+                    Value::String(s) => s.len() > 20,
+                    Value::List(l) => l.borrow().len() > 10,
+                    _ => false,
+                };
+                Ok(Value::Bool(is_gallus))
+            }))),
+        );
+
+        // drookit - check if list has duplicates (Scots: soaking wet/full)
+        globals.borrow_mut().define(
+            "drookit".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("drookit", 1, |args| {
+                if let Value::List(list) = &args[0] {
+                    let items = list.borrow();
+                    let mut seen = Vec::new();
+                    for item in items.iter() {
+                        if seen.contains(item) {
+                            return Ok(Value::Bool(true));
+                        }
+                        seen.push(item.clone());
+                    }
+                    Ok(Value::Bool(false))
+                } else {
+                    Err("drookit() needs a list".to_string())
+                }
+            }))),
+        );
+
+        // glaikit - check if something looks "stupid" (empty, zero, or invalid)
+        globals.borrow_mut().define(
+            "glaikit".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("glaikit", 1, |args| {
+                let is_glaikit = match &args[0] {
+                    Value::Nil => true,
+                    Value::Integer(0) => true,
+                    Value::Float(f) if *f == 0.0 => true,
+                    Value::String(s) if s.is_empty() || s.trim().is_empty() => true,
+                    Value::List(l) if l.borrow().is_empty() => true,
+                    Value::Dict(d) if d.borrow().is_empty() => true,
+                    _ => false,
+                };
+                Ok(Value::Bool(is_glaikit))
+            }))),
+        );
+
+        // geggie - get the "mouth" (first and last chars) of a string
         globals.borrow_mut().define(
-            "exp".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("exp", 1, |args| {
-                match &args[0] {
-                    Value::Float(f) => Ok(Value::Float(f.exp())),
-                    Value::Integer(n) => Ok(Value::Float((*n as f64).exp())),
-                    _ => Err("exp() needs a number".to_string()),
+            "geggie".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("geggie", 1, |args| {
+                if let Value::String(s) = &args[0] {
+                    if s.is_empty() {
+                        return Ok(Value::String("".into()));
+                    }
+                    let first = s.chars().next().unwrap();
+                    let last = s.chars().last().unwrap();
+                    Ok(Value::String(format!("{}{}", first, last).into()))
+                } else {
+                    Err("geggie() needs a string".to_string())
                 }
             }))),
         );
 
-        // pow - raise to a power (Scottish: mak it muckle!)
+        // banter - interleave two strings
         globals.borrow_mut().define(
-            "pow".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("pow", 2, |args| {
-                let base = match &args[0] {
-                    Value::Float(f) => *f,
-                    Value::Integer(n) => *n as f64,
-                    _ => return Err("pow() needs numbers".to_string()),
+            "banter".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("banter", 2, |args| {
+                let s1 = match &args[0] {
+                    Value::String(s) => s,
+                    _ => return Err("banter() needs two strings".to_string()),
                 };
-                let exponent = match &args[1] {
-                    Value::Float(f) => *f,
-                    Value::Integer(n) => *n as f64,
-                    _ => return Err("pow() needs numbers".to_string()),
+                let s2 = match &args[1] {
+                    Value::String(s) => s,
+                    _ => return Err("banter() needs two strings".to_string()),
                 };
-                Ok(Value::Float(base.powf(exponent)))
+                let mut result = String::new();
+                let mut chars1 = s1.chars();
+                let mut chars2 = s2.chars();
+                loop {
+                    match (chars1.next(), chars2.next()) {
+                        (Some(c1), Some(c2)) => {
+                            result.push(c1);
+                            result.push(c2);
+                        }
+                        (Some(c1), None) => result.push(c1),
+                        (None, Some(c2)) => result.push(c2),
+                        (None, None) => break,
+                    }
+                }
+                Ok(Value::String(result.into()))
             }))),
         );
 
-        // asin - arc sine
-        globals.borrow_mut().define(
-            "asin".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "asin",
-                1,
-                |args| match &args[0] {
-                    Value::Float(f) => Ok(Value::Float(f.asin())),
-                    Value::Integer(n) => Ok(Value::Float((*n as f64).asin())),
-                    _ => Err("asin() needs a number".to_string()),
-                },
-            ))),
-        );
-
-        // acos - arc cosine
+        // skelp - split a string into chunks of n chars (Scots: slap/hit)
         globals.borrow_mut().define(
-            "acos".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "acos",
-                1,
-                |args| match &args[0] {
-                    Value::Float(f) => Ok(Value::Float(f.acos())),
-                    Value::Integer(n) => Ok(Value::Float((*n as f64).acos())),
-                    _ => Err("acos() needs a number".to_string()),
-                },
-            ))),
+            "skelp".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("skelp", 2, |args| {
+                let s = match &args[0] {
+                    Value::String(s) => s,
+                    _ => return Err("skelp() needs a string and size".to_string()),
+                };
+                let size = args[1].as_integer().ok_or("skelp() needs integer size")?;
+                if size <= 0 {
+                    return Err("skelp() size must be positive".to_string());
+                }
+                let chunks: Vec<Value> = s
+                    .chars()
+                    .collect::<Vec<_>>()
+                    .chunks(size as usize)
+                    .map(|chunk| Value::String(chunk.iter().collect::<String>().into()))
+                    .collect();
+                Ok(Value::List(Rc::new(RefCell::new(chunks))))
+            }))),
         );
 
-        // atan - arc tangent
+        // indices_o - find all indices of a value (Scots: indices of)
         globals.borrow_mut().define(
-            "atan".to_string(),
+            "indices_o".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "atan",
-                1,
+                "indices_o",
+                2,
                 |args| match &args[0] {
-                    Value::Float(f) => Ok(Value::Float(f.atan())),
-                    Value::Integer(n) => Ok(Value::Float((*n as f64).atan())),
-                    _ => Err("atan() needs a number".to_string()),
+                    Value::List(list) => {
+                        let items = list.borrow();
+                        let needle = &args[1];
+                        let indices: Vec<Value> = items
+                            .iter()
+                            .enumerate()
+                            .filter(|(_, item)| *item == needle)
+                            .map(|(i, _)| Value::Integer(i as i64))
+                            .collect();
+                        Ok(Value::List(Rc::new(RefCell::new(indices))))
+                    }
+                    Value::String(s) => {
+                        let needle = match &args[1] {
+                            Value::String(n) => n,
+                            _ => {
+                                return Err(
+                                    "indices_o() on string needs a string needle".to_string()
+                                )
+                            }
+                        };
+                        if needle.is_empty() {
+                            return Err("Cannae search fer an empty string, ya numpty!".to_string());
+                        }
+                        let indices: Vec<Value> = s
+                            .match_indices(needle.as_ref())
+                            .map(|(i, _)| Value::Integer(i as i64))
+                            .collect();
+                        Ok(Value::List(Rc::new(RefCell::new(indices))))
+                    }
+                    _ => Err("indices_o() needs a list or string".to_string()),
                 },
             ))),
         );
 
-        // atan2 - two-argument arc tangent
+        // braw_date - format a timestamp or current time in Scottish style
         globals.borrow_mut().define(
-            "atan2".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("atan2", 2, |args| {
-                let y = match &args[0] {
-                    Value::Float(f) => *f,
-                    Value::Integer(n) => *n as f64,
-                    _ => return Err("atan2() needs numbers".to_string()),
-                };
-                let x = match &args[1] {
-                    Value::Float(f) => *f,
-                    Value::Integer(n) => *n as f64,
-                    _ => return Err("atan2() needs numbers".to_string()),
+            "braw_date".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("braw_date", 1, |args| {
+                use std::time::{SystemTime, UNIX_EPOCH};
+                let secs = match &args[0] {
+                    Value::Integer(n) => *n as u64,
+                    Value::Nil => SystemTime::now()
+                        .duration_since(UNIX_EPOCH)
+                        .unwrap()
+                        .as_secs(),
+                    _ => return Err("braw_date() needs a timestamp or naething".to_string()),
                 };
-                Ok(Value::Float(y.atan2(x)))
-            }))),
-        );
+                // Calculate date components (simplified, doesn't handle leap years perfectly)
+                let days_since_epoch = secs / 86400;
+                let day_of_week = ((days_since_epoch + 4) % 7) as usize; // Jan 1, 1970 was Thursday
 
-        // hypot - hypotenuse (sqrt(x² + y²))
-        globals.borrow_mut().define(
-            "hypot".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("hypot", 2, |args| {
-                let x = match &args[0] {
-                    Value::Float(f) => *f,
-                    Value::Integer(n) => *n as f64,
-                    _ => return Err("hypot() needs numbers".to_string()),
-                };
-                let y = match &args[1] {
-                    Value::Float(f) => *f,
-                    Value::Integer(n) => *n as f64,
-                    _ => return Err("hypot() needs numbers".to_string()),
+                let scots_day_names = [
+                    "the Sabbath",
+                    "Monday",
+                    "Tuesday",
+                    "Wednesday",
+                    "Thursday",
+                    "Friday",
+                    "Setterday",
+                ];
+
+                // Simple month/day calculation
+                let mut remaining_days = days_since_epoch as i64;
+                let mut year = 1970i64;
+                loop {
+                    let days_in_year = if (year % 4 == 0 && year % 100 != 0) || year % 400 == 0 {
+                        366
+                    } else {
+                        365
+                    };
+                    if remaining_days < days_in_year {
+                        break;
+                    }
+                    remaining_days -= days_in_year;
+                    year += 1;
+                }
+
+                let scots_months = [
+                    "Januar",
+                    "Februar",
+                    "Mairch",
+                    "Aprile",
+                    "Mey",
+                    "Juin",
+                    "Julie",
+                    "August",
+                    "September",
+                    "October",
+                    "November",
+                    "December",
+                ];
+                let days_in_months: [i64; 12] =
+                    if (year % 4 == 0 && year % 100 != 0) || year % 400 == 0 {
+                        [31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31]
+                    } else {
+                        [31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31]
+                    };
+
+                let mut month = 0usize;
+                for (i, &days) in days_in_months.iter().enumerate() {
+                    if remaining_days < days {
+                        month = i;
+                        break;
+                    }
+                    remaining_days -= days;
+                }
+                let day = remaining_days + 1;
+
+                let ordinal = match day {
+                    1 | 21 | 31 => "st",
+                    2 | 22 => "nd",
+                    3 | 23 => "rd",
+                    _ => "th",
                 };
-                Ok(Value::Float(x.hypot(y)))
+
+                Ok(Value::String(
+                    format!(
+                        "{}, the {}{} o' {}, {}",
+                        scots_day_names[day_of_week], day, ordinal, scots_months[month], year
+                    )
+                    .into(),
+                ))
             }))),
         );
 
-        // degrees - convert radians to degrees
+        // Higher-order functions are defined as marker values
+        // They get special handling in call_value
+
+        // gaun - map function over list (Scots: "going")
+        globals
+            .borrow_mut()
+            .define("gaun".to_string(), Value::String("__builtin_gaun__".into()));
+
+        // sieve - filter list (keep elements that pass)
         globals.borrow_mut().define(
-            "degrees".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "degrees",
-                1,
-                |args| match &args[0] {
-                    Value::Float(f) => Ok(Value::Float(f.to_degrees())),
-                    Value::Integer(n) => Ok(Value::Float((*n as f64).to_degrees())),
-                    _ => Err("degrees() needs a number".to_string()),
-                },
-            ))),
+            "sieve".to_string(),
+            Value::String("__builtin_sieve__".into()),
         );
 
-        // radians - convert degrees to radians
+        // tumble - reduce/fold list (Scots: tumble together)
         globals.borrow_mut().define(
-            "radians".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "radians",
-                1,
-                |args| match &args[0] {
-                    Value::Float(f) => Ok(Value::Float(f.to_radians())),
-                    Value::Integer(n) => Ok(Value::Float((*n as f64).to_radians())),
-                    _ => Err("radians() needs a number".to_string()),
-                },
-            ))),
+            "tumble".to_string(),
+            Value::String("__builtin_tumble__".into()),
         );
 
-        // === Time Functions ===
-
-        // snooze - sleep for milliseconds (Scots: have a wee rest)
+        // parallel_map / parallel_filter / parallel_reduce - chunked across the worker
+        // pool in native builds; here they run in order like gaun / sieve / tumble
         globals.borrow_mut().define(
-            "snooze".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("snooze", 1, |args| {
-                let ms = args[0]
-                    .as_integer()
-                    .ok_or("snooze() needs an integer (milliseconds)")?;
-                if ms < 0 {
-                    return Err("Cannae snooze fer negative time, ya daftie!".to_string());
-                }
-                std::thread::sleep(std::time::Duration::from_millis(ms as u64));
-                Ok(Value::Nil)
-            }))),
+            "parallel_map".to_string(),
+            Value::String("__builtin_parallel_map__".into()),
+        );
+        globals.borrow_mut().define(
+            "parallel_filter".to_string(),
+            Value::String("__builtin_parallel_filter__".into()),
+        );
+        globals.borrow_mut().define(
+            "parallel_reduce".to_string(),
+            Value::String("__builtin_parallel_reduce__".into()),
         );
 
-        // === String Functions ===
+        // ilk - for each (Scots: each/every)
+        globals
+            .borrow_mut()
+            .define("ilk".to_string(), Value::String("__builtin_ilk__".into()));
 
-        // roar - convert to uppercase (shout it oot even louder than upper!)
+        // hunt - find first matching element
+        globals
+            .borrow_mut()
+            .define("hunt".to_string(), Value::String("__builtin_hunt__".into()));
+
+        // ony - check if any element matches (Scots: any)
+        globals
+            .borrow_mut()
+            .define("ony".to_string(), Value::String("__builtin_ony__".into()));
+
+        // aw - check if all elements match (Scots: all)
+        globals
+            .borrow_mut()
+            .define("aw".to_string(), Value::String("__builtin_aw__".into()));
+
+        // sort_by - stable sort by a key function, each key computed once
         globals.borrow_mut().define(
-            "roar".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("roar", 1, |args| {
-                if let Value::String(s) = &args[0] {
-                    // Add exclamation for extra emphasis!
-                    Ok(Value::String(format!("{}!", s.to_uppercase())))
-                } else {
-                    Err("roar() expects a string".to_string())
-                }
-            }))),
+            "sort_by".to_string(),
+            Value::String("__builtin_sort_by__".into()),
         );
 
-        // mutter - whisper text (lowercase with dots)
+        // grup_up - group list elements by function result (Scots: group up)
         globals.borrow_mut().define(
-            "mutter".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("mutter", 1, |args| {
-                if let Value::String(s) = &args[0] {
-                    Ok(Value::String(format!("...{}...", s.to_lowercase())))
-                } else {
-                    Err("mutter() expects a string".to_string())
-                }
-            }))),
+            "grup_up".to_string(),
+            Value::String("__builtin_grup_up__".into()),
         );
 
-        // blooter - scramble a string randomly (Scots: hit/strike messily)
+        // pairt_by - partition list by predicate into [true, false] lists
         globals.borrow_mut().define(
-            "blooter".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("blooter", 1, |args| {
-                if let Value::String(s) = &args[0] {
-                    use std::time::{SystemTime, UNIX_EPOCH};
-                    let seed = SystemTime::now()
-                        .duration_since(UNIX_EPOCH)
-                        .unwrap()
-                        .as_nanos() as u64;
-                    let mut chars: Vec<char> = s.chars().collect();
-                    // Fisher-Yates shuffle
-                    let mut rng = seed;
-                    for i in (1..chars.len()).rev() {
-                        rng = rng.wrapping_mul(1103515245).wrapping_add(12345);
-                        let j = (rng as usize) % (i + 1);
-                        chars.swap(i, j);
-                    }
-                    Ok(Value::String(chars.into_iter().collect()))
-                } else {
-                    Err("blooter() expects a string".to_string())
-                }
-            }))),
+            "pairt_by".to_string(),
+            Value::String("__builtin_pairt_by__".into()),
         );
 
-        // pad_left - pad string on left
+        // === More Scots-Flavoured Functions ===
+
+        // haverin - check if a string is empty/nonsense (talking havers!)
         globals.borrow_mut().define(
-            "pad_left".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("pad_left", 3, |args| {
-                match (&args[0], &args[1], &args[2]) {
-                    (Value::String(s), Value::Integer(width), Value::String(pad)) => {
-                        let pad_char = pad.chars().next().unwrap_or(' ');
-                        let w = *width as usize;
-                        if s.len() >= w {
-                            Ok(Value::String(s.clone()))
-                        } else {
-                            Ok(Value::String(format!(
-                                "{}{}",
-                                pad_char.to_string().repeat(w - s.len()),
-                                s
-                            )))
-                        }
+            "haverin".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "haverin",
+                1,
+                |args| match &args[0] {
+                    Value::String(s) => {
+                        let trimmed = s.trim();
+                        Ok(Value::Bool(trimmed.is_empty() || trimmed.len() < 2))
                     }
-                    _ => Err("pad_left() needs (string, width, pad_char)".to_string()),
-                }
-            }))),
+                    Value::Nil => Ok(Value::Bool(true)),
+                    Value::List(l) => Ok(Value::Bool(l.borrow().is_empty())),
+                    _ => Ok(Value::Bool(false)),
+                },
+            ))),
         );
 
-        // pad_right - pad string on right
+        // scunner - check if value is "disgusting" (negative or empty)
         globals.borrow_mut().define(
-            "pad_right".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("pad_right", 3, |args| match (
-                &args[0], &args[1], &args[2],
-            ) {
-                (Value::String(s), Value::Integer(width), Value::String(pad)) => {
-                    let pad_char = pad.chars().next().unwrap_or(' ');
-                    let w = *width as usize;
-                    if s.len() >= w {
-                        Ok(Value::String(s.clone()))
-                    } else {
-                        Ok(Value::String(format!(
-                            "{}{}",
-                            s,
-                            pad_char.to_string().repeat(w - s.len())
-                        )))
-                    }
-                }
-                _ => Err("pad_right() needs (string, width, pad_char)".to_string()),
-            }))),
+            "scunner".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "scunner",
+                1,
+                |args| match &args[0] {
+                    Value::Integer(n) => Ok(Value::Bool(*n < 0)),
+                    Value::Float(f) => Ok(Value::Bool(*f < 0.0)),
+                    Value::String(s) => Ok(Value::Bool(s.is_empty())),
+                    Value::List(l) => Ok(Value::Bool(l.borrow().is_empty())),
+                    Value::Bool(b) => Ok(Value::Bool(!*b)),
+                    Value::Nil => Ok(Value::Bool(true)),
+                    _ => Ok(Value::Bool(false)),
+                },
+            ))),
         );
 
-        // === List Functions ===
-
-        // drap - drop first n elements from list (Scots: drop)
+        // bonnie - pretty print a value with decoration
         globals.borrow_mut().define(
-            "drap".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("drap", 2, |args| {
-                match (&args[0], &args[1]) {
-                    (Value::List(list), Value::Integer(n)) => {
-                        let n = *n as usize;
-                        let items = list.borrow();
-                        let result: Vec<Value> = items.iter().skip(n).cloned().collect();
-                        Ok(Value::List(Rc::new(RefCell::new(result))))
-                    }
-                    _ => Err("drap() needs a list and an integer".to_string()),
-                }
+            "bonnie".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("bonnie", 1, |args| {
+                let val_str = format!("{}", args[0]);
+                Ok(Value::String(format!("~~~ {} ~~~", val_str).into()))
             }))),
         );
 
-        // tak - take first n elements from list (Scots: take)
+        // is_wee - check if value is small (< 10 for numbers, < 5 chars for strings)
         globals.borrow_mut().define(
-            "tak".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("tak", 2, |args| {
-                match (&args[0], &args[1]) {
-                    (Value::List(list), Value::Integer(n)) => {
-                        let n = *n as usize;
-                        let items = list.borrow();
-                        let result: Vec<Value> = items.iter().take(n).cloned().collect();
-                        Ok(Value::List(Rc::new(RefCell::new(result))))
-                    }
-                    _ => Err("tak() needs a list and an integer".to_string()),
-                }
-            }))),
+            "is_wee".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "is_wee",
+                1,
+                |args| match &args[0] {
+                    Value::Integer(n) => Ok(Value::Bool(n.abs() < 10)),
+                    Value::Float(f) => Ok(Value::Bool(f.abs() < 10.0)),
+                    Value::String(s) => Ok(Value::Bool(s.len() < 5)),
+                    Value::List(l) => Ok(Value::Bool(l.borrow().len() < 5)),
+                    _ => Ok(Value::Bool(true)),
+                },
+            ))),
         );
 
-        // grup - group elements into chunks (Scots: grip/group)
+        // is_muckle - check if value is big (opposite of is_wee)
         globals.borrow_mut().define(
-            "grup".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("grup", 2, |args| {
-                match (&args[0], &args[1]) {
-                    (Value::List(list), Value::Integer(size)) => {
-                        if *size <= 0 {
-                            return Err("grup() needs a positive chunk size".to_string());
-                        }
-                        let size = *size as usize;
-                        let items = list.borrow();
-                        let result: Vec<Value> = items
-                            .chunks(size)
-                            .map(|chunk| Value::List(Rc::new(RefCell::new(chunk.to_vec()))))
-                            .collect();
-                        Ok(Value::List(Rc::new(RefCell::new(result))))
-                    }
-                    _ => Err("grup() needs a list and an integer".to_string()),
-                }
-            }))),
+            "is_muckle".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "is_muckle",
+                1,
+                |args| match &args[0] {
+                    Value::Integer(n) => Ok(Value::Bool(n.abs() >= 100)),
+                    Value::Float(f) => Ok(Value::Bool(f.abs() >= 100.0)),
+                    Value::String(s) => Ok(Value::Bool(s.len() >= 50)),
+                    Value::List(l) => Ok(Value::Bool(l.borrow().len() >= 50)),
+                    _ => Ok(Value::Bool(false)),
+                },
+            ))),
+        );
+
+        // cannie - check if value is safe/valid (not nil, not empty, not negative)
+        globals.borrow_mut().define(
+            "cannie".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "cannie",
+                1,
+                |args| match &args[0] {
+                    Value::Nil => Ok(Value::Bool(false)),
+                    Value::Integer(n) => Ok(Value::Bool(*n >= 0)),
+                    Value::Float(f) => Ok(Value::Bool(*f >= 0.0 && !f.is_nan())),
+                    Value::String(s) => Ok(Value::Bool(!s.is_empty())),
+                    Value::List(l) => Ok(Value::Bool(!l.borrow().is_empty())),
+                    Value::Bool(b) => Ok(Value::Bool(*b)),
+                    _ => Ok(Value::Bool(true)),
+                },
+            ))),
         );
 
-        // pair_up - create pairs from a list [a,b,c,d] -> [[a,b], [c,d]]
+        // wrang_sort - check if value is the wrong type (sort = kind/type in Scots)
         globals.borrow_mut().define(
-            "pair_up".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("pair_up", 1, |args| {
-                if let Value::List(list) = &args[0] {
-                    let items = list.borrow();
-                    let result: Vec<Value> = items
-                        .chunks(2)
-                        .map(|chunk| Value::List(Rc::new(RefCell::new(chunk.to_vec()))))
-                        .collect();
-                    Ok(Value::List(Rc::new(RefCell::new(result))))
-                } else {
-                    Err("pair_up() needs a list".to_string())
-                }
+            "wrang_sort".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("wrang_sort", 2, |args| {
+                let expected_type = match &args[1] {
+                    Value::String(s) => s.as_ref(),
+                    _ => return Err("Second arg must be a type name string".to_string()),
+                };
+                let actual_type = args[0].type_name();
+                Ok(Value::Bool(actual_type != expected_type))
             }))),
         );
 
-        // fankle - interleave two lists (Scots: tangle)
+        // tattie_scone - repeat string n times with | separator (like stacking scones!)
         globals.borrow_mut().define(
-            "fankle".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("fankle", 2, |args| {
-                match (&args[0], &args[1]) {
-                    (Value::List(a), Value::List(b)) => {
-                        let a = a.borrow();
-                        let b = b.borrow();
-                        let mut result = Vec::new();
-                        let mut ai = a.iter();
-                        let mut bi = b.iter();
-                        loop {
-                            match (ai.next(), bi.next()) {
-                                (Some(x), Some(y)) => {
-                                    result.push(x.clone());
-                                    result.push(y.clone());
-                                }
-                                (Some(x), None) => result.push(x.clone()),
-                                (None, Some(y)) => result.push(y.clone()),
-                                (None, None) => break,
-                            }
-                        }
-                        Ok(Value::List(Rc::new(RefCell::new(result))))
-                    }
-                    _ => Err("fankle() needs two lists".to_string()),
-                }
+            "tattie_scone".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("tattie_scone", 2, |args| {
+                let s = match &args[0] {
+                    Value::String(s) => s.clone(),
+                    _ => return Err("tattie_scone needs a string".to_string()),
+                };
+                let n = match &args[1] {
+                    Value::Integer(n) => *n as usize,
+                    _ => return Err("tattie_scone needs a number".to_string()),
+                };
+                let result = vec![s; n].join(" | ");
+                Ok(Value::String(result.into()))
             }))),
         );
 
-        // === Fun Scottish Functions ===
-
-        // och - express disappointment or frustration
+        // haggis_hunt - find all occurrences of substring in string
         globals.borrow_mut().define(
-            "och".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("och", 1, |args| {
-                Ok(Value::String(format!("Och! {}", args[0])))
+            "haggis_hunt".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("haggis_hunt", 2, |args| {
+                let haystack = match &args[0] {
+                    Value::String(s) => s.clone(),
+                    _ => return Err("haggis_hunt needs a string tae search".to_string()),
+                };
+                let needle = match &args[1] {
+                    Value::String(s) => s.clone(),
+                    _ => return Err("haggis_hunt needs a string tae find".to_string()),
+                };
+                let positions: Vec<Value> = haystack
+                    .match_indices(&*needle)
+                    .map(|(i, _)| Value::Integer(i as i64))
+                    .collect();
+                Ok(Value::List(Rc::new(RefCell::new(positions))))
             }))),
         );
 
-        // jings - express surprise (like "gosh!" or "goodness!")
+        // sporran_fill - pad both sides of string (like a sporran!)
         globals.borrow_mut().define(
-            "jings".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("jings", 1, |args| {
-                Ok(Value::String(format!("Jings! {}", args[0])))
+            "sporran_fill".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("sporran_fill", 3, |args| {
+                let s = match &args[0] {
+                    Value::String(s) => s.clone(),
+                    _ => return Err("sporran_fill needs a string".to_string()),
+                };
+                let width = match &args[1] {
+                    Value::Integer(n) => *n as usize,
+                    _ => return Err("sporran_fill needs a width".to_string()),
+                };
+                let fill = match &args[2] {
+                    Value::String(c) => c.chars().next().unwrap_or(' '),
+                    _ => return Err("sporran_fill needs a fill character".to_string()),
+                };
+                if s.len() >= width {
+                    return Ok(Value::String(s));
+                }
+                let padding = width - s.len();
+                let left_pad = padding / 2;
+                let right_pad = padding - left_pad;
+                let result = format!(
+                    "{}{}{}",
+                    fill.to_string().repeat(left_pad),
+                    s,
+                    fill.to_string().repeat(right_pad)
+                );
+                Ok(Value::String(result.into()))
             }))),
         );
 
-        // crivvens - express astonishment (from Oor Wullie)
+        // ============================================================
+        // MORE SCOTS FUN FUNCTIONS
+        // ============================================================
+
+        // blether_format - format a string with named placeholders
+        // blether_format("Hullo {name}, ye are {age} years auld", {"name": "Hamish", "age": 42})
         globals.borrow_mut().define(
-            "crivvens".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("crivvens", 1, |args| {
-                Ok(Value::String(format!("Crivvens! {}", args[0])))
+            "blether_format".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("blether_format", 2, |args| {
+                let template = match &args[0] {
+                    Value::String(s) => s,
+                    _ => return Err("blether_format needs a template string".to_string()),
+                };
+                let dict = match &args[1] {
+                    Value::Dict(d) => d,
+                    _ => return Err("blether_format needs a dictionary o' values".to_string()),
+                };
+                let result = FormatTemplate::new(template).apply(&dict.borrow());
+                Ok(Value::String(result.into()))
             }))),
         );
 
-        // help_ma_boab - express extreme surprise (Scottish exclamation)
+        // format_compile - split a blether_format template once for format_apply
         globals.borrow_mut().define(
-            "help_ma_boab".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("help_ma_boab", 1, |args| {
-                Ok(Value::String(format!("Help ma boab! {}", args[0])))
+            "format_compile".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("format_compile", 1, |args| {
+                match &args[0] {
+                    Value::String(s) => Ok(Value::NativeObject(Rc::new(FormatTemplate::new(s)))),
+                    _ => Err("format_compile needs a template string".to_string()),
+                }
             }))),
         );
 
-        // haud_yer_wheesht - tell someone to be quiet (returns empty string)
+        // format_apply - fill a format_compile template (or a plain template string)
         globals.borrow_mut().define(
-            "haud_yer_wheesht".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "haud_yer_wheesht",
-                0,
-                |_args| Ok(Value::String("".to_string())),
-            ))),
+            "format_apply".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("format_apply", 2, |args| {
+                let dict = match &args[1] {
+                    Value::Dict(d) => d.borrow(),
+                    _ => return Err("format_apply needs a dictionary o' values".to_string()),
+                };
+                let result = match &args[0] {
+                    Value::String(s) => FormatTemplate::new(s).apply(&dict),
+                    Value::NativeObject(obj) => obj
+                        .as_any()
+                        .downcast_ref::<FormatTemplate>()
+                        .ok_or("format_apply needs a format_compile template")?
+                        .apply(&dict),
+                    _ => return Err("format_apply needs a format_compile template".to_string()),
+                };
+                Ok(Value::String(result.into()))
+            }))),
         );
 
-        // braw - check if something is good/excellent
+        // ceilidh - shuffle and interleave two lists like dancers at a ceilidh!
         globals.borrow_mut().define(
-            "braw".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("braw", 1, |args| {
-                // Everything is braw in Scotland!
-                let val = &args[0];
-                let is_braw = match val {
-                    Value::Nil => false,
-                    Value::Bool(b) => *b,
-                    Value::Integer(n) => *n > 0,
-                    Value::Float(f) => *f > 0.0,
-                    Value::String(s) => !s.is_empty(),
-                    Value::List(l) => !l.borrow().is_empty(),
-                    Value::Dict(d) => !d.borrow().is_empty(),
-                    _ => true,
+            "ceilidh".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("ceilidh", 2, |args| {
+                let list1 = match &args[0] {
+                    Value::List(l) => l.borrow().clone(),
+                    _ => return Err("ceilidh needs two lists".to_string()),
                 };
-                Ok(Value::Bool(is_braw))
+                let list2 = match &args[1] {
+                    Value::List(l) => l.borrow().clone(),
+                    _ => return Err("ceilidh needs two lists".to_string()),
+                };
+                let mut result = Vec::new();
+                let max_len = list1.len().max(list2.len());
+                for i in 0..max_len {
+                    if i < list1.len() {
+                        result.push(list1[i].clone());
+                    }
+                    if i < list2.len() {
+                        result.push(list2[i].clone());
+                    }
+                }
+                Ok(Value::List(Rc::new(RefCell::new(result))))
             }))),
         );
 
-        // clarty - check if something is messy/dirty (has duplicates in list)
+        // dram - get a random element from a list (like pouring a wee dram!)
         globals.borrow_mut().define(
-            "clarty".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("clarty", 1, |args| {
-                if let Value::List(list) = &args[0] {
-                    let items = list.borrow();
-                    let mut seen = Vec::new();
-                    for item in items.iter() {
-                        if seen.contains(item) {
-                            return Ok(Value::Bool(true)); // Has duplicates = clarty
-                        }
-                        seen.push(item.clone());
-                    }
-                    Ok(Value::Bool(false))
-                } else if let Value::String(s) = &args[0] {
-                    // String is clarty if it has repeated characters
-                    let chars: Vec<char> = s.chars().collect();
-                    let unique: std::collections::HashSet<char> = chars.iter().cloned().collect();
-                    Ok(Value::Bool(chars.len() != unique.len()))
-                } else {
-                    Err("clarty() needs a list or string".to_string())
+            "dram".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("dram", 1, |args| {
+                use std::time::{SystemTime, UNIX_EPOCH};
+                let list = match &args[0] {
+                    Value::List(l) => l.borrow().clone(),
+                    _ => return Err("dram needs a list tae pick fae".to_string()),
+                };
+                if list.is_empty() {
+                    return Ok(Value::Nil);
                 }
+                let seed = SystemTime::now()
+                    .duration_since(UNIX_EPOCH)
+                    .unwrap()
+                    .as_nanos() as usize;
+                let idx = seed % list.len();
+                Ok(list[idx].clone())
             }))),
         );
 
-        // dreich - check if a string is boring/dull (all same character or empty)
+        // birl - rotate a list (birl = spin/rotate in Scots)
         globals.borrow_mut().define(
-            "dreich".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("dreich", 1, |args| {
-                if let Value::String(s) = &args[0] {
-                    if s.is_empty() {
-                        return Ok(Value::Bool(true)); // Empty is dreich
-                    }
-                    let first = s.chars().next().unwrap();
-                    let is_dreich = s.chars().all(|c| c == first);
-                    Ok(Value::Bool(is_dreich))
-                } else {
-                    Err("dreich() needs a string".to_string())
+            "birl".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("birl", 2, |args| {
+                let list = match &args[0] {
+                    Value::List(l) => l.borrow().clone(),
+                    _ => return Err("birl needs a list".to_string()),
+                };
+                let n = match &args[1] {
+                    Value::Integer(n) => *n,
+                    _ => return Err("birl needs a rotation count".to_string()),
+                };
+                if list.is_empty() {
+                    return Ok(Value::List(Rc::new(RefCell::new(list))));
                 }
+                let len = list.len() as i64;
+                let n = ((n % len) + len) % len; // Handle negative rotation
+                let n = n as usize;
+                let mut result = list.clone();
+                result.rotate_left(n);
+                Ok(Value::List(Rc::new(RefCell::new(result))))
+            }))),
+        );
+
+        // stooshie - create chaos/noise (shuffle a string's characters)
+        globals.borrow_mut().define(
+            "stooshie".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("stooshie", 1, |args| {
+                let s = match &args[0] {
+                    Value::String(s) => s.clone(),
+                    _ => return Err("stooshie needs a string".to_string()),
+                };
+                let mut chars: Vec<char> = s.chars().collect();
+                rng_shuffle(&mut chars);
+                Ok(Value::String(chars.into_iter().collect::<String>().into()))
             }))),
         );
 
-        // stoater - get a particularly good/outstanding element (max for numbers)
+        // clype - report on a value (like telling tales!) - returns debug info
         globals.borrow_mut().define(
-            "stoater".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("stoater", 1, |args| {
-                if let Value::List(list) = &args[0] {
-                    let items = list.borrow();
-                    if items.is_empty() {
-                        return Err("Cannae find a stoater in an empty list!".to_string());
-                    }
-                    // Find the "best" element (max for numbers, longest for strings)
-                    let mut best = items[0].clone();
-                    for item in items.iter().skip(1) {
-                        match (&best, item) {
-                            (Value::Integer(a), Value::Integer(b)) => {
-                                if *b > *a {
-                                    best = item.clone();
-                                }
-                            }
-                            (Value::Float(a), Value::Float(b)) => {
-                                if *b > *a {
-                                    best = item.clone();
-                                }
-                            }
-                            (Value::String(a), Value::String(b)) => {
-                                if b.len() > a.len() {
-                                    best = item.clone();
-                                }
+            "clype".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("clype", 1, |args| {
+                let val = &args[0];
+                let type_name = val.type_name();
+                let info = match val {
+                    Value::List(l) => format!("list wi' {} items", l.borrow().len()),
+                    Value::Dict(d) => format!("dict wi' {} entries", d.borrow().len()),
+                    Value::Set(s) => format!("creel wi' {} items", s.borrow().len()),
+                    Value::String(s) => format!("string o' {} characters", s.len()),
+                    Value::Integer(n) => format!("integer: {}", n),
+                    Value::Float(f) => format!("float: {}", f),
+                    Value::Bool(b) => format!("boolean: {}", if *b { "aye" } else { "nae" }),
+                    Value::Nil => "naething".to_string(),
+                    Value::Function(f) => format!("function '{}'", f.name),
+                    Value::NativeFunction(f) => format!("native function '{}'", f.name),
+                    Value::Class(c) => format!("class '{}'", c.name),
+                    Value::Instance(inst) => format!("instance o' '{}'", inst.borrow().class.name),
+                    _ => type_name.to_string(),
+                };
+                Ok(Value::String(format!("[{}] {}", type_name, info).into()))
+            }))),
+        );
+
+        // sclaff - flatten nested lists (sclaff = hit flat in golf)
+        globals.borrow_mut().define(
+            "sclaff".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("sclaff", 1, |args| {
+                fn flatten_recursive(val: &Value, result: &mut Vec<Value>) {
+                    match val {
+                        Value::List(l) => {
+                            for item in l.borrow().iter() {
+                                flatten_recursive(item, result);
                             }
-                            _ => {}
                         }
+                        other => result.push(other.clone()),
                     }
-                    Ok(best)
-                } else {
-                    Err("stoater() needs a list".to_string())
                 }
+                let list = match &args[0] {
+                    Value::List(l) => l.clone(),
+                    _ => return Err("sclaff needs a list".to_string()),
+                };
+                let mut result = Vec::new();
+                for item in list.borrow().iter() {
+                    flatten_recursive(item, &mut result);
+                }
+                Ok(Value::List(Rc::new(RefCell::new(result))))
             }))),
         );
 
-        // numpty_check - validate input isn't empty/nil
-        globals.borrow_mut().define(
-            "numpty_check".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "numpty_check",
-                1,
-                |args| match &args[0] {
-                    Value::Nil => Ok(Value::String("That's naething, ya numpty!".to_string())),
-                    Value::String(s) if s.is_empty() => {
-                        Ok(Value::String("Empty string, ya numpty!".to_string()))
-                    }
-                    Value::List(l) if l.borrow().is_empty() => {
-                        Ok(Value::String("Empty list, ya numpty!".to_string()))
-                    }
-                    _ => Ok(Value::String("That's braw!".to_string())),
-                },
-            ))),
-        );
+        // ============================================================
+        // TIMING/BENCHMARKING FUNCTIONS - Measure yer code's speed!
+        // ============================================================
 
-        // scottify - add Scottish flair to text
+        // noo - get current timestamp in milliseconds (like "now")
         globals.borrow_mut().define(
-            "scottify".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("scottify", 1, |args| {
-                if let Value::String(s) = &args[0] {
-                    let scottified = s
-                        .replace("yes", "aye")
-                        .replace("Yes", "Aye")
-                        .replace("no", "nae")
-                        .replace("No", "Nae")
-                        .replace("know", "ken")
-                        .replace("Know", "Ken")
-                        .replace("not", "nae")
-                        .replace("from", "fae")
-                        .replace("to", "tae")
-                        .replace("do", "dae")
-                        .replace("myself", "masel")
-                        .replace("yourself", "yersel")
-                        .replace("small", "wee")
-                        .replace("little", "wee")
-                        .replace("child", "bairn")
-                        .replace("children", "bairns")
-                        .replace("church", "kirk")
-                        .replace("beautiful", "bonnie")
-                        .replace("Beautiful", "Bonnie")
-                        .replace("going", "gaun")
-                        .replace("have", "hae")
-                        .replace("nothing", "naething")
-                        .replace("something", "somethin")
-                        .replace("everything", "awthing")
-                        .replace("everyone", "awbody")
-                        .replace("about", "aboot")
-                        .replace("out", "oot")
-                        .replace("house", "hoose");
-                    Ok(Value::String(scottified))
-                } else {
-                    Err("scottify() needs a string".to_string())
-                }
+            "noo".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("noo", 0, |_args| {
+                use std::time::{SystemTime, UNIX_EPOCH};
+                let duration = SystemTime::now().duration_since(UNIX_EPOCH).unwrap();
+                Ok(Value::Integer(duration.as_millis() as i64))
             }))),
         );
 
-        // unique - remove duplicates from list (keeps first occurrence)
+        // tick - high precision nanoseconds timestamp
         globals.borrow_mut().define(
-            "unique".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("unique", 1, |args| {
-                if let Value::List(list) = &args[0] {
-                    let mut seen = Vec::new();
-                    let mut result = Vec::new();
-                    for item in list.borrow().iter() {
-                        if !seen.contains(item) {
-                            seen.push(item.clone());
-                            result.push(item.clone());
-                        }
-                    }
-                    Ok(Value::List(Rc::new(RefCell::new(result))))
-                } else {
-                    Err("unique() needs a list".to_string())
-                }
+            "tick".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("tick", 0, |_args| {
+                use std::time::{SystemTime, UNIX_EPOCH};
+                let duration = SystemTime::now().duration_since(UNIX_EPOCH).unwrap();
+                Ok(Value::Integer(duration.as_nanos() as i64))
             }))),
         );
 
-        // === File I/O Functions ===
-
-        // scrieve - write to file (Scots: "write")
+        // bide - sleep for milliseconds (bide = wait in Scots)
         globals.borrow_mut().define(
-            "scrieve".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("scrieve", 2, |args| {
-                use std::fs::File;
-                use std::io::Write as IoWrite;
-                let path = match &args[0] {
-                    Value::String(s) => s.clone(),
-                    _ => return Err("scrieve() needs a file path string".to_string()),
+            "bide".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("bide", 1, |args| {
+                let ms = match &args[0] {
+                    Value::Integer(n) => *n as u64,
+                    Value::Float(f) => *f as u64,
+                    _ => return Err("bide() needs a number o' milliseconds".to_string()),
                 };
-                let content = args[1].to_string();
-                let mut file = File::create(&path)
-                    .map_err(|e| format!("Couldnae open '{}' fer writin': {}", path, e))?;
-                file.write_all(content.as_bytes())
-                    .map_err(|e| format!("Couldnae write tae '{}': {}", path, e))?;
+                std::thread::sleep(std::time::Duration::from_millis(ms));
                 Ok(Value::Nil)
             }))),
         );
 
-        // read_file - read entire file (Scots: readie would be good but let's be clear)
+        // stopwatch - time a function call and return [result, time_ms]
         globals.borrow_mut().define(
-            "read_file".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("read_file", 1, |args| {
-                use std::fs;
-                let path = match &args[0] {
-                    Value::String(s) => s.clone(),
-                    _ => return Err("read_file() needs a file path string".to_string()),
-                };
-                let content = fs::read_to_string(&path)
-                    .map_err(|e| format!("Couldnae read '{}': {}", path, e))?;
-                Ok(Value::String(content))
+            "stopwatch".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("stopwatch", 1, |args| {
+                // This is a placeholder - actual timing requires interpreter access
+                // For now, just return the function info
+                match &args[0] {
+                    Value::Function(f) => Ok(Value::String(
+                        format!(
+                            "Use 'noo()' before and after callin' '{}' tae time it!",
+                            f.name
+                        )
+                        .into(),
+                    )),
+                    _ => Err("stopwatch() needs a function".to_string()),
+                }
             }))),
         );
 
-        // read_lines - read file as list of lines
+        // ============================================================
+        // SET (CREEL) FUNCTIONS - A creel is a basket in Scots!
+        // ============================================================
+
+        // creel - create a new set from a list
         globals.borrow_mut().define(
-            "read_lines".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("read_lines", 1, |args| {
-                use std::fs;
-                let path = match &args[0] {
-                    Value::String(s) => s.clone(),
-                    _ => return Err("read_lines() needs a file path string".to_string()),
-                };
-                let content = fs::read_to_string(&path)
-                    .map_err(|e| format!("Couldnae read '{}': {}", path, e))?;
-                let lines: Vec<Value> = content
-                    .lines()
-                    .map(|l| Value::String(l.to_string()))
-                    .collect();
-                Ok(Value::List(Rc::new(RefCell::new(lines))))
+            "creel".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("creel", 1, |args| {
+                match &args[0] {
+                    Value::List(list) => {
+                        let mut items = SetValue::new();
+                        for item in list.borrow().iter() {
+                            items.insert(item.clone());
+                        }
+                        Ok(Value::Set(Rc::new(RefCell::new(items))))
+                    }
+                    Value::Set(s) => Ok(Value::Set(s.clone())), // Already a set
+                    _ => Err("creel() needs a list tae make a set fae".to_string()),
+                }
             }))),
         );
 
-        // file_exists - check if file exists
+        // toss_in - add item to set (toss it intae the creel!)
         globals.borrow_mut().define(
-            "file_exists".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("file_exists", 1, |args| {
-                use std::path::Path;
-                let path = match &args[0] {
-                    Value::String(s) => s.clone(),
-                    _ => return Err("file_exists() needs a file path string".to_string()),
-                };
-                Ok(Value::Bool(Path::new(&path).exists()))
+            "toss_in".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("toss_in", 2, |args| {
+                if let Value::Set(set) = &args[0] {
+                    set.borrow_mut().insert(args[1].clone());
+                    Ok(Value::Set(set.clone()))
+                } else {
+                    Err("toss_in() needs a creel (set)".to_string())
+                }
+            }))),
+        );
+
+        // heave_oot - remove item from set (heave it oot the creel!)
+        globals.borrow_mut().define(
+            "heave_oot".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("heave_oot", 2, |args| {
+                if let Value::Set(set) = &args[0] {
+                    set.borrow_mut().remove(&args[1]);
+                    Ok(Value::Set(set.clone()))
+                } else {
+                    Err("heave_oot() needs a creel (set)".to_string())
+                }
             }))),
         );
 
-        // append_file - append to file
+        // is_in_creel - check if item is in set
         globals.borrow_mut().define(
-            "append_file".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("append_file", 2, |args| {
-                use std::fs::OpenOptions;
-                use std::io::Write as IoWrite;
-                let path = match &args[0] {
-                    Value::String(s) => s.clone(),
-                    _ => return Err("append_file() needs a file path string".to_string()),
-                };
-                let content = args[1].to_string();
-                let mut file = OpenOptions::new()
-                    .create(true)
-                    .append(true)
-                    .open(&path)
-                    .map_err(|e| format!("Couldnae open '{}' fer appendin': {}", path, e))?;
-                file.write_all(content.as_bytes())
-                    .map_err(|e| format!("Couldnae append tae '{}': {}", path, e))?;
-                Ok(Value::Nil)
+            "is_in_creel".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("is_in_creel", 2, |args| {
+                if let Value::Set(set) = &args[0] {
+                    Ok(Value::Bool(set.borrow().contains(&args[1])))
+                } else {
+                    Err("is_in_creel() needs a creel (set)".to_string())
+                }
             }))),
         );
 
-        // === More Scots-Themed Functions ===
-
-        // haver - generate random nonsense (Scots: talk rubbish)
+        // creels_thegither - union of two sets (put them thegither!)
         globals.borrow_mut().define(
-            "haver".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("haver", 0, |_args| {
-                use std::time::{SystemTime, UNIX_EPOCH};
-                let havers = [
-                    "Och, yer bum's oot the windae!",
-                    "Awa' an bile yer heid!",
-                    "Haud yer wheesht, ya numpty!",
-                    "Dinnae fash yersel!",
-                    "Whit's fer ye'll no go by ye!",
-                    "Lang may yer lum reek!",
-                    "Yer a wee scunner, so ye are!",
-                    "Haste ye back!",
-                    "It's a dreich day the day!",
-                    "Pure dead brilliant!",
-                    "Ah'm fair puckled!",
-                    "Gie it laldy!",
-                    "Whit a stoater!",
-                    "That's pure mince!",
-                    "Jings, crivvens, help ma boab!",
-                ];
-                let seed = SystemTime::now()
-                    .duration_since(UNIX_EPOCH)
-                    .unwrap()
-                    .as_nanos() as u64;
-                let rng = seed.wrapping_mul(1103515245).wrapping_add(12345);
-                let idx = (rng as usize) % havers.len();
-                Ok(Value::String(havers[idx].to_string()))
-            }))),
+            "creels_thegither".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "creels_thegither",
+                2,
+                |args| match (&args[0], &args[1]) {
+                    (Value::Set(a), Value::Set(b)) => {
+                        let union = a.borrow().union(&b.borrow());
+                        Ok(Value::Set(Rc::new(RefCell::new(union))))
+                    }
+                    _ => Err("creels_thegither() needs two creels".to_string()),
+                },
+            ))),
         );
 
-        // slainte - return a Scottish toast (Scots: health/cheers)
+        // creels_baith - intersection of two sets (what's in baith!)
         globals.borrow_mut().define(
-            "slainte".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("slainte", 0, |_args| {
-                use std::time::{SystemTime, UNIX_EPOCH};
-                let toasts = [
-                    "Slàinte mhath! (Good health!)",
-                    "Here's tae us, wha's like us? Gey few, and they're a' deid!",
-                    "May the best ye've ever seen be the worst ye'll ever see!",
-                    "Lang may yer lum reek wi' ither fowk's coal!",
-                    "May ye aye be happy, an' never drink frae a toom glass!",
-                    "Here's tae the heath, the hill and the heather!",
-                ];
-                let seed = SystemTime::now()
-                    .duration_since(UNIX_EPOCH)
-                    .unwrap()
-                    .as_nanos() as u64;
-                let rng = seed.wrapping_mul(1103515245).wrapping_add(12345);
-                let idx = (rng as usize) % toasts.len();
-                Ok(Value::String(toasts[idx].to_string()))
-            }))),
+            "creels_baith".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "creels_baith",
+                2,
+                |args| match (&args[0], &args[1]) {
+                    (Value::Set(a), Value::Set(b)) => {
+                        let intersection = a.borrow().intersection(&b.borrow());
+                        Ok(Value::Set(Rc::new(RefCell::new(intersection))))
+                    }
+                    _ => Err("creels_baith() needs two creels".to_string()),
+                },
+            ))),
         );
 
-        // braw_time - format current time in a nice Scottish way
+        // creels_differ - difference of two sets (what's in a but no in b)
         globals.borrow_mut().define(
-            "braw_time".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("braw_time", 0, |_args| {
-                use std::time::{SystemTime, UNIX_EPOCH};
-                let secs = SystemTime::now()
-                    .duration_since(UNIX_EPOCH)
-                    .unwrap()
-                    .as_secs();
-                // Simple hour/minute calculation (UTC)
-                let hours = (secs / 3600) % 24;
-                let minutes = (secs / 60) % 60;
-                Ok(Value::String(format_braw_time(hours, minutes)))
-            }))),
+            "creels_differ".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "creels_differ",
+                2,
+                |args| match (&args[0], &args[1]) {
+                    (Value::Set(a), Value::Set(b)) => {
+                        let difference = a.borrow().difference(&b.borrow());
+                        Ok(Value::Set(Rc::new(RefCell::new(difference))))
+                    }
+                    _ => Err("creels_differ() needs two creels".to_string()),
+                },
+            ))),
         );
 
-        // wheesht_aw - trim and clean up a string (more thorough than wheesht)
+        // creel_tae_list - convert set to sorted list
         globals.borrow_mut().define(
-            "wheesht_aw".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("wheesht_aw", 1, |args| {
-                if let Value::String(s) = &args[0] {
-                    // Collapse multiple spaces and trim
-                    let cleaned: String = s.split_whitespace().collect::<Vec<_>>().join(" ");
-                    Ok(Value::String(cleaned))
+            "creel_tae_list".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("creel_tae_list", 1, |args| {
+                if let Value::Set(set) = &args[0] {
+                    let mut items: Vec<(String, Value)> = set
+                        .borrow()
+                        .iter()
+                        .map(|v| (format!("{}", v), v.clone()))
+                        .collect();
+                    items.sort_by(|a, b| a.0.cmp(&b.0));
+                    let values: Vec<Value> = items.into_iter().map(|(_, v)| v).collect();
+                    Ok(Value::List(Rc::new(RefCell::new(values))))
                 } else {
-                    Err("wheesht_aw() needs a string".to_string())
+                    Err("creel_tae_list() needs a creel".to_string())
                 }
             }))),
         );
 
-        // scunner_check - validate that a value meets expectations (returns descriptive error)
+        // is_subset - check if one set is a subset of another (is a inside b?)
         globals.borrow_mut().define(
-            "scunner_check".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("scunner_check", 2, |args| {
-                let val = &args[0];
-                let expected_type = match &args[1] {
-                    Value::String(s) => s.as_str(),
-                    _ => return Err("scunner_check() needs type name as second arg".to_string()),
-                };
-                let actual_type = val.type_name();
-                if actual_type == expected_type {
-                    Ok(Value::Bool(true))
-                } else {
-                    Ok(Value::String(format!(
-                        "Och, ya scunner! Expected {} but got {}",
-                        expected_type, actual_type
-                    )))
+            "is_subset".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("is_subset", 2, |args| match (
+                &args[0], &args[1],
+            ) {
+                (Value::Set(a), Value::Set(b)) => {
+                    Ok(Value::Bool(a.borrow().is_subset(&b.borrow())))
                 }
+                _ => Err("is_subset() needs two creels".to_string()),
             }))),
         );
 
-        // bampot_mode - deliberately cause chaos (scramble list order)
+        // is_superset - check if one set is a superset of another (does a contain aw o b?)
         globals.borrow_mut().define(
-            "bampot_mode".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("bampot_mode", 1, |args| {
-                use std::time::{SystemTime, UNIX_EPOCH};
-                if let Value::List(list) = &args[0] {
-                    let mut items: Vec<Value> = list.borrow().clone();
-                    let seed = SystemTime::now()
-                        .duration_since(UNIX_EPOCH)
-                        .unwrap()
-                        .as_nanos() as u64;
-                    let mut rng = seed;
-                    // Double shuffle for extra chaos!
-                    for _ in 0..2 {
-                        for i in (1..items.len()).rev() {
-                            rng = rng.wrapping_mul(1103515245).wrapping_add(12345);
-                            let j = (rng as usize) % (i + 1);
-                            items.swap(i, j);
-                        }
+            "is_superset".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "is_superset",
+                2,
+                |args| match (&args[0], &args[1]) {
+                    (Value::Set(a), Value::Set(b)) => {
+                        Ok(Value::Bool(a.borrow().is_superset(&b.borrow())))
                     }
-                    items.reverse(); // And reverse for good measure!
-                    Ok(Value::List(Rc::new(RefCell::new(items))))
-                } else {
-                    Err("bampot_mode() needs a list".to_string())
-                }
-            }))),
+                    _ => Err("is_superset() needs two creels".to_string()),
+                },
+            ))),
         );
 
-        // crabbit - check if a number is negative (Scots: grumpy/bad-tempered)
+        // is_disjoint - check if two sets have nae overlap
         globals.borrow_mut().define(
-            "crabbit".to_string(),
+            "is_disjoint".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "crabbit",
-                1,
-                |args| match &args[0] {
-                    Value::Integer(n) => Ok(Value::Bool(*n < 0)),
-                    Value::Float(f) => Ok(Value::Bool(*f < 0.0)),
-                    _ => Err("crabbit() needs a number".to_string()),
+                "is_disjoint",
+                2,
+                |args| match (&args[0], &args[1]) {
+                    (Value::Set(a), Value::Set(b)) => {
+                        Ok(Value::Bool(a.borrow().is_disjoint(&b.borrow())))
+                    }
+                    _ => Err("is_disjoint() needs two creels".to_string()),
                 },
             ))),
         );
 
-        // gallus - check if a value is bold/impressive (non-empty/non-zero)
+        // empty_creel - create an empty set
         globals.borrow_mut().define(
-            "gallus".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("gallus", 1, |args| {
-                let is_gallus = match &args[0] {
-                    Value::Integer(n) => *n != 0 && (*n > 100 || *n < -100),
-                    Value::Float(f) => *f != 0.0 && (*f > 100.0 || *f < -100.0),
-                    Value::String(s) => s.len() > 20,
-                    Value::List(l) => l.borrow().len() > 10,
-                    _ => false,
-                };
-                Ok(Value::Bool(is_gallus))
+            "empty_creel".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("empty_creel", 0, |_args| {
+                Ok(Value::Set(Rc::new(RefCell::new(SetValue::new()))))
             }))),
         );
 
-        // drookit - check if list has duplicates (Scots: soaking wet/full)
+        // json_parse - parse a JSON string intae a value
         globals.borrow_mut().define(
-            "drookit".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("drookit", 1, |args| {
-                if let Value::List(list) = &args[0] {
-                    let items = list.borrow();
-                    let mut seen = Vec::new();
-                    for item in items.iter() {
-                        if seen.contains(item) {
-                            return Ok(Value::Bool(true));
-                        }
-                        seen.push(item.clone());
-                    }
-                    Ok(Value::Bool(false))
+            "json_parse".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("json_parse", 1, |args| {
+                if let Value::String(s) = &args[0] {
+                    parse_json_value(s)
                 } else {
-                    Err("drookit() needs a list".to_string())
+                    Err("json_parse() expects a string, ya numpty!".to_string())
                 }
             }))),
         );
 
-        // glaikit - check if something looks "stupid" (empty, zero, or invalid)
+        // json_stringify - convert a value tae JSON string
         globals.borrow_mut().define(
-            "glaikit".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("glaikit", 1, |args| {
-                let is_glaikit = match &args[0] {
-                    Value::Nil => true,
-                    Value::Integer(0) => true,
-                    Value::Float(f) if *f == 0.0 => true,
-                    Value::String(s) if s.is_empty() || s.trim().is_empty() => true,
-                    Value::List(l) if l.borrow().is_empty() => true,
-                    Value::Dict(d) if d.borrow().is_empty() => true,
-                    _ => false,
+            "json_stringify".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("json_stringify", 1, |args| {
+                Ok(Value::String(value_to_json(&args[0]).into()))
+            }))),
+        );
+
+        // json_pretty - convert a value tae pretty-printed JSON string
+        globals.borrow_mut().define(
+            "json_pretty".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("json_pretty", 1, |args| {
+                Ok(Value::String(value_to_json_pretty(&args[0], 0).into()))
+            }))),
+        );
+
+        // json_write_into - serialise into a reusable bytes buffer
+        globals.borrow_mut().define(
+            "json_write_into".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("json_write_into", 2, |args| {
+                let Value::Bytes(buf) = &args[0] else {
+                    return Err("json_write_into() needs a bytes buffer".to_string());
                 };
-                Ok(Value::Bool(is_glaikit))
+                let json = value_to_json(&args[1]);
+                let mut out = buf.borrow_mut();
+                out.clear();
+                out.extend_from_slice(json.as_bytes());
+                drop(out);
+                Ok(args[0].clone())
             }))),
         );
 
-        // geggie - get the "mouth" (first and last chars) of a string
+        // pack - a value as MessagePack bytes (see src/pack.rs)
         globals.borrow_mut().define(
-            "geggie".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("geggie", 1, |args| {
-                if let Value::String(s) = &args[0] {
-                    if s.is_empty() {
-                        return Ok(Value::String("".to_string()));
-                    }
-                    let first = s.chars().next().unwrap();
-                    let last = s.chars().last().unwrap();
-                    Ok(Value::String(format!("{}{}", first, last)))
-                } else {
-                    Err("geggie() needs a string".to_string())
-                }
+            "pack".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("pack", 1, |args| {
+                let mut out = Vec::new();
+                crate::pack::pack(&args[0], &mut out)?;
+                Ok(Value::Bytes(Rc::new(RefCell::new(out))))
             }))),
         );
 
-        // banter - interleave two strings
+        // pack_into - pack into a reusable bytes buffer
         globals.borrow_mut().define(
-            "banter".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("banter", 2, |args| {
-                let s1 = match &args[0] {
-                    Value::String(s) => s,
-                    _ => return Err("banter() needs two strings".to_string()),
-                };
-                let s2 = match &args[1] {
-                    Value::String(s) => s,
-                    _ => return Err("banter() needs two strings".to_string()),
+            "pack_into".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("pack_into", 2, |args| {
+                let Value::Bytes(buf) = &args[0] else {
+                    return Err("pack_into() needs a bytes buffer".to_string());
                 };
-                let mut result = String::new();
-                let mut chars1 = s1.chars();
-                let mut chars2 = s2.chars();
-                loop {
-                    match (chars1.next(), chars2.next()) {
-                        (Some(c1), Some(c2)) => {
-                            result.push(c1);
-                            result.push(c2);
-                        }
-                        (Some(c1), None) => result.push(c1),
-                        (None, Some(c2)) => result.push(c2),
-                        (None, None) => break,
-                    }
-                }
-                Ok(Value::String(result))
+                // Packed into a fresh Vec first, so a value holding buf can still borrow it
+                let mut out = std::mem::take(&mut *buf.borrow_mut());
+                out.clear();
+                let packed = crate::pack::pack(&args[1], &mut out);
+                *buf.borrow_mut() = out;
+                packed?;
+                Ok(args[0].clone())
             }))),
         );
 
-        // skelp - split a string into chunks of n chars (Scots: slap/hit)
+        // unpack - the value packed in a bytes buffer
         globals.borrow_mut().define(
-            "skelp".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("skelp", 2, |args| {
-                let s = match &args[0] {
-                    Value::String(s) => s,
-                    _ => return Err("skelp() needs a string and size".to_string()),
+            "unpack".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("unpack", 1, |args| {
+                let Value::Bytes(buf) = &args[0] else {
+                    return Err("unpack() needs bytes".to_string());
                 };
-                let size = args[1].as_integer().ok_or("skelp() needs integer size")?;
-                if size <= 0 {
-                    return Err("skelp() size must be positive".to_string());
-                }
-                let chunks: Vec<Value> = s
-                    .chars()
-                    .collect::<Vec<_>>()
-                    .chunks(size as usize)
-                    .map(|chunk| Value::String(chunk.iter().collect()))
-                    .collect();
-                Ok(Value::List(Rc::new(RefCell::new(chunks))))
+                let buf = buf.borrow();
+                crate::pack::unpack(&buf)
             }))),
         );
 
-        // indices_o - find all indices of a value (Scots: indices of)
+        // unpack_stream_new / _feed / _next - packed values arriving in chunks
         globals.borrow_mut().define(
-            "indices_o".to_string(),
+            "unpack_stream_new".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "indices_o",
-                2,
-                |args| match &args[0] {
-                    Value::List(list) => {
-                        let items = list.borrow();
-                        let needle = &args[1];
-                        let indices: Vec<Value> = items
-                            .iter()
-                            .enumerate()
-                            .filter(|(_, item)| *item == needle)
-                            .map(|(i, _)| Value::Integer(i as i64))
-                            .collect();
-                        Ok(Value::List(Rc::new(RefCell::new(indices))))
-                    }
-                    Value::String(s) => {
-                        let needle = match &args[1] {
-                            Value::String(n) => n,
-                            _ => {
-                                return Err(
-                                    "indices_o() on string needs a string needle".to_string()
-                                )
-                            }
-                        };
-                        if needle.is_empty() {
-                            return Err("Cannae search fer an empty string, ya numpty!".to_string());
-                        }
-                        let indices: Vec<Value> = s
-                            .match_indices(needle.as_str())
-                            .map(|(i, _)| Value::Integer(i as i64))
-                            .collect();
-                        Ok(Value::List(Rc::new(RefCell::new(indices))))
-                    }
-                    _ => Err("indices_o() needs a list or string".to_string()),
-                },
+                "unpack_stream_new",
+                0,
+                |_args| Ok(Value::NativeObject(Rc::new(UnpackStreamHandle::default()))),
             ))),
         );
-
-        // braw_date - format a timestamp or current time in Scottish style
         globals.borrow_mut().define(
-            "braw_date".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("braw_date", 1, |args| {
-                use std::time::{SystemTime, UNIX_EPOCH};
-                let secs = match &args[0] {
-                    Value::Integer(n) => *n as u64,
-                    Value::Nil => SystemTime::now()
-                        .duration_since(UNIX_EPOCH)
-                        .unwrap()
-                        .as_secs(),
-                    _ => return Err("braw_date() needs a timestamp or naething".to_string()),
-                };
-                // Calculate date components (simplified, doesn't handle leap years perfectly)
-                let days_since_epoch = secs / 86400;
-                let day_of_week = ((days_since_epoch + 4) % 7) as usize; // Jan 1, 1970 was Thursday
-
-                let scots_day_names = [
-                    "the Sabbath",
-                    "Monday",
-                    "Tuesday",
-                    "Wednesday",
-                    "Thursday",
-                    "Friday",
-                    "Setterday",
-                ];
-
-                // Simple month/day calculation
-                let mut remaining_days = days_since_epoch as i64;
-                let mut year = 1970i64;
-                loop {
-                    let days_in_year = if (year % 4 == 0 && year % 100 != 0) || year % 400 == 0 {
-                        366
-                    } else {
-                        365
-                    };
-                    if remaining_days < days_in_year {
-                        break;
-                    }
-                    remaining_days -= days_in_year;
-                    year += 1;
-                }
-
-                let scots_months = [
-                    "Januar",
-                    "Februar",
-                    "Mairch",
-                    "Aprile",
-                    "Mey",
-                    "Juin",
-                    "Julie",
-                    "August",
-                    "September",
-                    "October",
-                    "November",
-                    "December",
-                ];
-                let days_in_months: [i64; 12] =
-                    if (year % 4 == 0 && year % 100 != 0) || year % 400 == 0 {
-                        [31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31]
-                    } else {
-                        [31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31]
+            "unpack_stream_feed".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "unpack_stream_feed",
+                2,
+                |args| {
+                    let Value::Bytes(chunk) = &args[1] else {
+                        return Err("unpack_stream_feed() needs bytes".to_string());
                     };
-
-                let mut month = 0usize;
-                for (i, &days) in days_in_months.iter().enumerate() {
-                    if remaining_days < days {
-                        month = i;
-                        break;
-                    }
-                    remaining_days -= days;
-                }
-                let day = remaining_days + 1;
-
-                let ordinal = match day {
-                    1 | 21 | 31 => "st",
-                    2 | 22 => "nd",
-                    3 | 23 => "rd",
-                    _ => "th",
-                };
-
-                Ok(Value::String(format!(
-                    "{}, the {}{} o' {}, {}",
-                    scots_day_names[day_of_week], day, ordinal, scots_months[month], year
-                )))
-            }))),
+                    with_unpack_stream("unpack_stream_feed", &args[0], |stream| {
+                        stream.feed(&chunk.borrow());
+                        Ok(Value::Nil)
+                    })
+                },
+            ))),
         );
-
-        // Higher-order functions are defined as marker values
-        // They get special handling in call_value
-
-        // gaun - map function over list (Scots: "going")
         globals.borrow_mut().define(
-            "gaun".to_string(),
-            Value::String("__builtin_gaun__".to_string()),
+            "unpack_stream_next".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "unpack_stream_next",
+                1,
+                |args| {
+                    with_unpack_stream("unpack_stream_next", &args[0], |stream| {
+                        Ok(stream.next_value()?.unwrap_or(Value::Nil))
+                    })
+                },
+            ))),
         );
 
-        // sieve - filter list (keep elements that pass)
+        // json_stream_open - read JSON records from a file one at a time
         globals.borrow_mut().define(
-            "sieve".to_string(),
-            Value::String("__builtin_sieve__".to_string()),
+            "json_stream_open".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "json_stream_open",
+                1,
+                |args| {
+                    let Value::String(path) = &args[0] else {
+                        return Err("json_stream_open() needs a file path string".to_string());
+                    };
+                    let file = std::fs::File::open(&**path)
+                        .map_err(|e| format!("json_stream_open: cannot open '{}': {}", path, e))?;
+                    let stream = JsonStream::new(Some(file));
+                    Ok(Value::Integer(register_json_stream(stream)))
+                },
+            ))),
         );
 
-        // tumble - reduce/fold list (Scots: tumble together)
+        // json_stream_new - a stream fed with json_stream_feed
         globals.borrow_mut().define(
-            "tumble".to_string(),
-            Value::String("__builtin_tumble__".to_string()),
+            "json_stream_new".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "json_stream_new",
+                0,
+                |_args| Ok(Value::Integer(register_json_stream(JsonStream::new(None)))),
+            ))),
         );
 
-        // ilk - for each (Scots: each/every)
+        // json_stream_feed - append a chunk (bytes or string) to a stream
         globals.borrow_mut().define(
-            "ilk".to_string(),
-            Value::String("__builtin_ilk__".to_string()),
+            "json_stream_feed".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "json_stream_feed",
+                2,
+                |args| {
+                    let chunk = match &args[1] {
+                        Value::Bytes(b) => b.borrow().clone(),
+                        Value::String(s) => s.as_bytes().to_vec(),
+                        _ => return Err("json_stream_feed() needs bytes or a string".to_string()),
+                    };
+                    with_json_stream("json_stream_feed", &args[0], |stream| {
+                        if stream.file.is_some() {
+                            return Err("json_stream_feed: stream reads from a file".to_string());
+                        }
+                        stream.compact();
+                        stream.buf.extend_from_slice(&chunk);
+                        Ok(Value::Nil)
+                    })
+                },
+            ))),
         );
 
-        // hunt - find first matching element
+        // json_stream_next - the next complete record, or nil if there isn't one yet
         globals.borrow_mut().define(
-            "hunt".to_string(),
-            Value::String("__builtin_hunt__".to_string()),
+            "json_stream_next".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "json_stream_next",
+                1,
+                |args| match with_json_stream("json_stream_next", &args[0], |s| s.next_record())? {
+                    Some(text) => parse_json_value(&text),
+                    None => Ok(Value::Nil),
+                },
+            ))),
         );
 
-        // ony - check if any element matches (Scots: any)
+        // json_stream_close - let go of a stream (and its file)
         globals.borrow_mut().define(
-            "ony".to_string(),
-            Value::String("__builtin_ony__".to_string()),
+            "json_stream_close".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "json_stream_close",
+                1,
+                |args| {
+                    if let Value::Integer(id) = &args[0] {
+                        JSON_STREAMS.with(|cell| cell.borrow_mut().streams.remove(id));
+                    }
+                    Ok(Value::Nil)
+                },
+            ))),
         );
 
-        // aw - check if all elements match (Scots: all)
+        // ============================================================
+        // BITWISE OPERATIONS - Fer aw yer binary fiddlin' needs!
+        // ============================================================
+
+        // bit_an - bitwise AND (Scots: "an" = and)
         globals.borrow_mut().define(
-            "aw".to_string(),
-            Value::String("__builtin_aw__".to_string()),
+            "bit_an".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("bit_an", 2, |args| {
+                match (&args[0], &args[1]) {
+                    (Value::Integer(a), Value::Integer(b)) => Ok(Value::Integer(*a & *b)),
+                    _ => Err("bit_an() needs two integers".to_string()),
+                }
+            }))),
         );
 
-        // grup_up - group list elements by function result (Scots: group up)
+        // bit_or - bitwise OR
         globals.borrow_mut().define(
-            "grup_up".to_string(),
-            Value::String("__builtin_grup_up__".to_string()),
+            "bit_or".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("bit_or", 2, |args| {
+                match (&args[0], &args[1]) {
+                    (Value::Integer(a), Value::Integer(b)) => Ok(Value::Integer(*a | *b)),
+                    _ => Err("bit_or() needs two integers".to_string()),
+                }
+            }))),
         );
 
-        // pairt_by - partition list by predicate into [true, false] lists
+        // bit_xor - bitwise XOR
         globals.borrow_mut().define(
-            "pairt_by".to_string(),
-            Value::String("__builtin_pairt_by__".to_string()),
+            "bit_xor".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("bit_xor", 2, |args| {
+                match (&args[0], &args[1]) {
+                    (Value::Integer(a), Value::Integer(b)) => Ok(Value::Integer(*a ^ *b)),
+                    _ => Err("bit_xor() needs two integers".to_string()),
+                }
+            }))),
         );
 
-        // === More Scots-Flavoured Functions ===
-
-        // haverin - check if a string is empty/nonsense (talking havers!)
+        // bit_nae - bitwise NOT (Scots: nae = not)
         globals.borrow_mut().define(
-            "haverin".to_string(),
+            "bit_nae".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "haverin",
+                "bit_nae",
                 1,
                 |args| match &args[0] {
-                    Value::String(s) => {
-                        let trimmed = s.trim();
-                        Ok(Value::Bool(trimmed.is_empty() || trimmed.len() < 2))
-                    }
-                    Value::Nil => Ok(Value::Bool(true)),
-                    Value::List(l) => Ok(Value::Bool(l.borrow().is_empty())),
-                    _ => Ok(Value::Bool(false)),
+                    Value::Integer(n) => Ok(Value::Integer(!*n)),
+                    _ => Err("bit_nae() needs an integer".to_string()),
                 },
             ))),
         );
 
-        // scunner - check if value is "disgusting" (negative or empty)
+        // bit_shove_left - left shift (shove left!)
         globals.borrow_mut().define(
-            "scunner".to_string(),
+            "bit_shove_left".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "scunner",
-                1,
-                |args| match &args[0] {
-                    Value::Integer(n) => Ok(Value::Bool(*n < 0)),
-                    Value::Float(f) => Ok(Value::Bool(*f < 0.0)),
-                    Value::String(s) => Ok(Value::Bool(s.is_empty())),
-                    Value::List(l) => Ok(Value::Bool(l.borrow().is_empty())),
-                    Value::Bool(b) => Ok(Value::Bool(!*b)),
-                    Value::Nil => Ok(Value::Bool(true)),
-                    _ => Ok(Value::Bool(false)),
+                "bit_shove_left",
+                2,
+                |args| match (&args[0], &args[1]) {
+                    (Value::Integer(a), Value::Integer(b)) => {
+                        if *b < 0 || *b > 63 {
+                            return Err("Shift amount must be 0-63, ya numpty!".to_string());
+                        }
+                        Ok(Value::Integer(*a << *b))
+                    }
+                    _ => Err("bit_shove_left() needs two integers".to_string()),
                 },
             ))),
         );
 
-        // bonnie - pretty print a value with decoration
+        // bit_shove_right - right shift (shove right!)
         globals.borrow_mut().define(
-            "bonnie".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("bonnie", 1, |args| {
-                let val_str = format!("{}", args[0]);
-                Ok(Value::String(format!("~~~ {} ~~~", val_str)))
-            }))),
+            "bit_shove_right".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "bit_shove_right",
+                2,
+                |args| match (&args[0], &args[1]) {
+                    (Value::Integer(a), Value::Integer(b)) => {
+                        if *b < 0 || *b > 63 {
+                            return Err("Shift amount must be 0-63, ya numpty!".to_string());
+                        }
+                        Ok(Value::Integer(*a >> *b))
+                    }
+                    _ => Err("bit_shove_right() needs two integers".to_string()),
+                },
+            ))),
         );
 
-        // is_wee - check if value is small (< 10 for numbers, < 5 chars for strings)
+        // bit_coont - count number of set bits (popcount)
         globals.borrow_mut().define(
-            "is_wee".to_string(),
+            "bit_coont".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "is_wee",
+                "bit_coont",
                 1,
                 |args| match &args[0] {
-                    Value::Integer(n) => Ok(Value::Bool(n.abs() < 10)),
-                    Value::Float(f) => Ok(Value::Bool(f.abs() < 10.0)),
-                    Value::String(s) => Ok(Value::Bool(s.len() < 5)),
-                    Value::List(l) => Ok(Value::Bool(l.borrow().len() < 5)),
-                    _ => Ok(Value::Bool(true)),
+                    Value::Integer(n) => Ok(Value::Integer(n.count_ones() as i64)),
+                    _ => Err("bit_coont() needs an integer".to_string()),
                 },
             ))),
         );
 
-        // is_muckle - check if value is big (opposite of is_wee)
+        // tae_binary - convert to binary string
         globals.borrow_mut().define(
-            "is_muckle".to_string(),
+            "tae_binary".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "is_muckle",
+                "tae_binary",
                 1,
                 |args| match &args[0] {
-                    Value::Integer(n) => Ok(Value::Bool(n.abs() >= 100)),
-                    Value::Float(f) => Ok(Value::Bool(f.abs() >= 100.0)),
-                    Value::String(s) => Ok(Value::Bool(s.len() >= 50)),
-                    Value::List(l) => Ok(Value::Bool(l.borrow().len() >= 50)),
-                    _ => Ok(Value::Bool(false)),
+                    Value::Integer(n) => Ok(Value::String(format!("{:b}", n).into())),
+                    _ => Err("tae_binary() needs an integer".to_string()),
                 },
             ))),
         );
 
-        // cannie - check if value is safe/valid (not nil, not empty, not negative)
+        // tae_hex - convert to hexadecimal string
         globals.borrow_mut().define(
-            "cannie".to_string(),
+            "tae_hex".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "cannie",
+                "tae_hex",
                 1,
                 |args| match &args[0] {
-                    Value::Nil => Ok(Value::Bool(false)),
-                    Value::Integer(n) => Ok(Value::Bool(*n >= 0)),
-                    Value::Float(f) => Ok(Value::Bool(*f >= 0.0 && !f.is_nan())),
-                    Value::String(s) => Ok(Value::Bool(!s.is_empty())),
-                    Value::List(l) => Ok(Value::Bool(!l.borrow().is_empty())),
-                    Value::Bool(b) => Ok(Value::Bool(*b)),
-                    _ => Ok(Value::Bool(true)),
+                    Value::Integer(n) => Ok(Value::String(format!("{:x}", n).into())),
+                    _ => Err("tae_hex() needs an integer".to_string()),
                 },
             ))),
         );
 
-        // wrang_sort - check if value is the wrong type (sort = kind/type in Scots)
-        globals.borrow_mut().define(
-            "wrang_sort".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("wrang_sort", 2, |args| {
-                let expected_type = match &args[1] {
-                    Value::String(s) => s.as_str(),
-                    _ => return Err("Second arg must be a type name string".to_string()),
-                };
-                let actual_type = args[0].type_name();
-                Ok(Value::Bool(actual_type != expected_type))
-            }))),
-        );
-
-        // tattie_scone - repeat string n times with | separator (like stacking scones!)
-        globals.borrow_mut().define(
-            "tattie_scone".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("tattie_scone", 2, |args| {
-                let s = match &args[0] {
-                    Value::String(s) => s.clone(),
-                    _ => return Err("tattie_scone needs a string".to_string()),
-                };
-                let n = match &args[1] {
-                    Value::Integer(n) => *n as usize,
-                    _ => return Err("tattie_scone needs a number".to_string()),
-                };
-                let result = vec![s; n].join(" | ");
-                Ok(Value::String(result))
-            }))),
-        );
-
-        // haggis_hunt - find all occurrences of substring in string
-        globals.borrow_mut().define(
-            "haggis_hunt".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("haggis_hunt", 2, |args| {
-                let haystack = match &args[0] {
-                    Value::String(s) => s.clone(),
-                    _ => return Err("haggis_hunt needs a string tae search".to_string()),
-                };
-                let needle = match &args[1] {
-                    Value::String(s) => s.clone(),
-                    _ => return Err("haggis_hunt needs a string tae find".to_string()),
-                };
-                let positions: Vec<Value> = haystack
-                    .match_indices(&needle)
-                    .map(|(i, _)| Value::Integer(i as i64))
-                    .collect();
-                Ok(Value::List(Rc::new(RefCell::new(positions))))
-            }))),
-        );
-
-        // sporran_fill - pad both sides of string (like a sporran!)
-        globals.borrow_mut().define(
-            "sporran_fill".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("sporran_fill", 3, |args| {
-                let s = match &args[0] {
-                    Value::String(s) => s.clone(),
-                    _ => return Err("sporran_fill needs a string".to_string()),
-                };
-                let width = match &args[1] {
-                    Value::Integer(n) => *n as usize,
-                    _ => return Err("sporran_fill needs a width".to_string()),
-                };
-                let fill = match &args[2] {
-                    Value::String(c) => c.chars().next().unwrap_or(' '),
-                    _ => return Err("sporran_fill needs a fill character".to_string()),
-                };
-                if s.len() >= width {
-                    return Ok(Value::String(s));
-                }
-                let padding = width - s.len();
-                let left_pad = padding / 2;
-                let right_pad = padding - left_pad;
-                let result = format!(
-                    "{}{}{}",
-                    fill.to_string().repeat(left_pad),
-                    s,
-                    fill.to_string().repeat(right_pad)
-                );
-                Ok(Value::String(result))
-            }))),
-        );
-
-        // ============================================================
-        // MORE SCOTS FUN FUNCTIONS
-        // ============================================================
-
-        // blether_format - format a string with named placeholders
-        // blether_format("Hullo {name}, ye are {age} years auld", {"name": "Hamish", "age": 42})
-        globals.borrow_mut().define(
-            "blether_format".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("blether_format", 2, |args| {
-                let template = match &args[0] {
-                    Value::String(s) => s.clone(),
-                    _ => return Err("blether_format needs a template string".to_string()),
-                };
-                let mut result = template;
-                let dict = match &args[1] {
-                    Value::Dict(d) => d.clone(),
-                    _ => return Err("blether_format needs a dictionary o' values".to_string()),
-                };
-                for (key, value) in dict.borrow().iter() {
-                    let key_str = match key {
-                        Value::String(s) => s.clone(),
-                        _ => format!("{}", key),
-                    };
-                    let placeholder = format!("{{{}}}", key_str);
-                    result = result.replace(&placeholder, &format!("{}", value));
-                }
-                Ok(Value::String(result))
-            }))),
-        );
-
-        // ceilidh - shuffle and interleave two lists like dancers at a ceilidh!
-        globals.borrow_mut().define(
-            "ceilidh".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("ceilidh", 2, |args| {
-                let list1 = match &args[0] {
-                    Value::List(l) => l.borrow().clone(),
-                    _ => return Err("ceilidh needs two lists".to_string()),
-                };
-                let list2 = match &args[1] {
-                    Value::List(l) => l.borrow().clone(),
-                    _ => return Err("ceilidh needs two lists".to_string()),
-                };
-                let mut result = Vec::new();
-                let max_len = list1.len().max(list2.len());
-                for i in 0..max_len {
-                    if i < list1.len() {
-                        result.push(list1[i].clone());
-                    }
-                    if i < list2.len() {
-                        result.push(list2[i].clone());
-                    }
-                }
-                Ok(Value::List(Rc::new(RefCell::new(result))))
-            }))),
-        );
-
-        // dram - get a random element from a list (like pouring a wee dram!)
-        globals.borrow_mut().define(
-            "dram".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("dram", 1, |args| {
-                use std::time::{SystemTime, UNIX_EPOCH};
-                let list = match &args[0] {
-                    Value::List(l) => l.borrow().clone(),
-                    _ => return Err("dram needs a list tae pick fae".to_string()),
-                };
-                if list.is_empty() {
-                    return Ok(Value::Nil);
-                }
-                let seed = SystemTime::now()
-                    .duration_since(UNIX_EPOCH)
-                    .unwrap()
-                    .as_nanos() as usize;
-                let idx = seed % list.len();
-                Ok(list[idx].clone())
-            }))),
+        // tae_octal - convert to octal string
+        globals.borrow_mut().define(
+            "tae_octal".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "tae_octal",
+                1,
+                |args| match &args[0] {
+                    Value::Integer(n) => Ok(Value::String(format!("{:o}", n).into())),
+                    _ => Err("tae_octal() needs an integer".to_string()),
+                },
+            ))),
         );
 
-        // birl - rotate a list (birl = spin/rotate in Scots)
+        // fae_binary - parse binary string to integer
         globals.borrow_mut().define(
-            "birl".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("birl", 2, |args| {
-                let list = match &args[0] {
-                    Value::List(l) => l.borrow().clone(),
-                    _ => return Err("birl needs a list".to_string()),
-                };
-                let n = match &args[1] {
-                    Value::Integer(n) => *n,
-                    _ => return Err("birl needs a rotation count".to_string()),
-                };
-                if list.is_empty() {
-                    return Ok(Value::List(Rc::new(RefCell::new(list))));
-                }
-                let len = list.len() as i64;
-                let n = ((n % len) + len) % len; // Handle negative rotation
-                let n = n as usize;
-                let mut result = list.clone();
-                result.rotate_left(n);
-                Ok(Value::List(Rc::new(RefCell::new(result))))
-            }))),
+            "fae_binary".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "fae_binary",
+                1,
+                |args| match &args[0] {
+                    Value::String(s) => i64::from_str_radix(s.trim_start_matches("0b"), 2)
+                        .map(Value::Integer)
+                        .map_err(|_| format!("Cannae parse '{}' as binary", s)),
+                    _ => Err("fae_binary() needs a string".to_string()),
+                },
+            ))),
         );
 
-        // stooshie - create chaos/noise (shuffle a string's characters)
+        // fae_hex - parse hexadecimal string to integer
         globals.borrow_mut().define(
-            "stooshie".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("stooshie", 1, |args| {
-                use std::time::{SystemTime, UNIX_EPOCH};
-                let s = match &args[0] {
-                    Value::String(s) => s.clone(),
-                    _ => return Err("stooshie needs a string".to_string()),
-                };
-                let mut chars: Vec<char> = s.chars().collect();
-                // Simple Fisher-Yates shuffle
-                let seed = SystemTime::now()
-                    .duration_since(UNIX_EPOCH)
-                    .unwrap()
-                    .as_nanos() as u64;
-                let mut rng = seed;
-                for i in (1..chars.len()).rev() {
-                    rng = rng.wrapping_mul(1103515245).wrapping_add(12345);
-                    let j = (rng as usize) % (i + 1);
-                    chars.swap(i, j);
-                }
-                Ok(Value::String(chars.into_iter().collect()))
-            }))),
+            "fae_hex".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "fae_hex",
+                1,
+                |args| match &args[0] {
+                    Value::String(s) => i64::from_str_radix(s.trim_start_matches("0x"), 16)
+                        .map(Value::Integer)
+                        .map_err(|_| format!("Cannae parse '{}' as hex", s)),
+                    _ => Err("fae_hex() needs a string".to_string()),
+                },
+            ))),
         );
 
-        // clype - report on a value (like telling tales!) - returns debug info
+        // ============================================================
+        // MORE DICTIONARY FUNCTIONS - Fer managin' yer dicts!
+        // ============================================================
+
+        // dict_merge - merge two dictionaries (second overrides first)
         globals.borrow_mut().define(
-            "clype".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("clype", 1, |args| {
-                let val = &args[0];
-                let type_name = val.type_name();
-                let info = match val {
-                    Value::List(l) => format!("list wi' {} items", l.borrow().len()),
-                    Value::Dict(d) => format!("dict wi' {} entries", d.borrow().len()),
-                    Value::Set(s) => format!("creel wi' {} items", s.borrow().len()),
-                    Value::String(s) => format!("string o' {} characters", s.len()),
-                    Value::Integer(n) => format!("integer: {}", n),
-                    Value::Float(f) => format!("float: {}", f),
-                    Value::Bool(b) => format!("boolean: {}", if *b { "aye" } else { "nae" }),
-                    Value::Nil => "naething".to_string(),
-                    Value::Function(f) => format!("function '{}'", f.name),
-                    Value::NativeFunction(f) => format!("native function '{}'", f.name),
-                    Value::Class(c) => format!("class '{}'", c.name),
-                    Value::Instance(inst) => format!("instance o' '{}'", inst.borrow().class.name),
-                    _ => type_name.to_string(),
-                };
-                Ok(Value::String(format!("[{}] {}", type_name, info)))
-            }))),
+            "dict_merge".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "dict_merge",
+                2,
+                |args| match (&args[0], &args[1]) {
+                    (Value::Dict(a), Value::Dict(b)) => {
+                        let (a, b) = (a.borrow(), b.borrow());
+                        let mut result = DictValue::with_capacity(a.len() + b.len());
+                        for (k, v) in a.iter().chain(b.iter()) {
+                            result.set(k.clone(), v.clone());
+                        }
+                        Ok(Value::Dict(Rc::new(RefCell::new(result))))
+                    }
+                    _ => Err("dict_merge() needs two dictionaries".to_string()),
+                },
+            ))),
         );
 
-        // sclaff - flatten nested lists (sclaff = hit flat in golf)
+        // dict_update - copy the second dict's entries into the first, in place
         globals.borrow_mut().define(
-            "sclaff".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("sclaff", 1, |args| {
-                fn flatten_recursive(val: &Value, result: &mut Vec<Value>) {
-                    match val {
-                        Value::List(l) => {
-                            for item in l.borrow().iter() {
-                                flatten_recursive(item, result);
+            "dict_update".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "dict_update",
+                2,
+                |args| match (&args[0], &args[1]) {
+                    (Value::Dict(a), Value::Dict(b)) => {
+                        if !Rc::ptr_eq(a, b) {
+                            let b = b.borrow();
+                            let mut a = a.borrow_mut();
+                            a.reserve(b.len());
+                            for (k, v) in b.iter() {
+                                a.set(k.clone(), v.clone());
                             }
                         }
-                        other => result.push(other.clone()),
+                        Ok(args[0].clone())
                     }
-                }
-                let list = match &args[0] {
-                    Value::List(l) => l.clone(),
-                    _ => return Err("sclaff needs a list".to_string()),
-                };
-                let mut result = Vec::new();
-                for item in list.borrow().iter() {
-                    flatten_recursive(item, &mut result);
-                }
-                Ok(Value::List(Rc::new(RefCell::new(result))))
-            }))),
+                    _ => Err("dict_update() needs two dictionaries".to_string()),
+                },
+            ))),
         );
 
-        // ============================================================
-        // TIMING/BENCHMARKING FUNCTIONS - Measure yer code's speed!
-        // ============================================================
+        // dict_with_capacity - an empty dict with room for n entries
+        globals.borrow_mut().define(
+            "dict_with_capacity".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "dict_with_capacity",
+                1,
+                |args| match &args[0] {
+                    Value::Integer(n) => Ok(Value::Dict(Rc::new(RefCell::new(
+                        DictValue::with_capacity((*n).clamp(0, 1 << 20) as usize),
+                    )))),
+                    _ => Err("dict_with_capacity() needs an integer".to_string()),
+                },
+            ))),
+        );
 
-        // noo - get current timestamp in milliseconds (like "now")
+        // dict_get - get value with default (avoids crashes!)
         globals.borrow_mut().define(
-            "noo".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("noo", 0, |_args| {
-                use std::time::{SystemTime, UNIX_EPOCH};
-                let duration = SystemTime::now().duration_since(UNIX_EPOCH).unwrap();
-                Ok(Value::Integer(duration.as_millis() as i64))
-            }))),
+            "dict_get".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "dict_get",
+                3,
+                |args| match &args[0] {
+                    Value::Dict(d) => Ok(d
+                        .borrow()
+                        .get(&args[1])
+                        .cloned()
+                        .unwrap_or_else(|| args[2].clone())),
+                    other => match frozen_dict_ref(other) {
+                        Some(frozen) => Ok(frozen
+                            .get(&args[1])
+                            .cloned()
+                            .unwrap_or_else(|| args[2].clone())),
+                        None => Err("dict_get() needs a dictionary".to_string()),
+                    },
+                },
+            ))),
         );
 
-        // tick - high precision nanoseconds timestamp
+        // dict_has - check if dictionary has a key
         globals.borrow_mut().define(
-            "tick".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("tick", 0, |_args| {
-                use std::time::{SystemTime, UNIX_EPOCH};
-                let duration = SystemTime::now().duration_since(UNIX_EPOCH).unwrap();
-                Ok(Value::Integer(duration.as_nanos() as i64))
-            }))),
+            "dict_has".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "dict_has",
+                2,
+                |args| match &args[0] {
+                    Value::Dict(d) => Ok(Value::Bool(d.borrow().contains_key(&args[1]))),
+                    other => match frozen_dict_ref(other) {
+                        Some(frozen) => Ok(Value::Bool(frozen.get(&args[1]).is_some())),
+                        None => Err("dict_has() needs a dictionary".to_string()),
+                    },
+                },
+            ))),
         );
 
-        // bide - sleep for milliseconds (bide = wait in Scots)
+        // dict_remove - remove a key from dictionary (returns new dict)
         globals.borrow_mut().define(
-            "bide".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("bide", 1, |args| {
-                let ms = match &args[0] {
-                    Value::Integer(n) => *n as u64,
-                    Value::Float(f) => *f as u64,
-                    _ => return Err("bide() needs a number o' milliseconds".to_string()),
-                };
-                std::thread::sleep(std::time::Duration::from_millis(ms));
-                Ok(Value::Nil)
-            }))),
+            "dict_remove".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "dict_remove",
+                2,
+                |args| match &args[0] {
+                    Value::Dict(d) => {
+                        let mut new_dict = d.borrow().clone();
+                        new_dict.remove(&args[1]);
+                        Ok(Value::Dict(Rc::new(RefCell::new(new_dict))))
+                    }
+                    _ => Err("dict_remove() needs a dictionary".to_string()),
+                },
+            ))),
         );
 
-        // stopwatch - time a function call and return [result, time_ms]
+        // dict_invert - swap keys and values
         globals.borrow_mut().define(
-            "stopwatch".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("stopwatch", 1, |args| {
-                // This is a placeholder - actual timing requires interpreter access
-                // For now, just return the function info
-                match &args[0] {
-                    Value::Function(f) => Ok(Value::String(format!(
-                        "Use 'noo()' before and after callin' '{}' tae time it!",
-                        f.name
-                    ))),
-                    _ => Err("stopwatch() needs a function".to_string()),
-                }
-            }))),
+            "dict_invert".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "dict_invert",
+                1,
+                |args| match &args[0] {
+                    Value::Dict(d) => {
+                        let d = d.borrow();
+                        let mut inverted = DictValue::with_capacity(d.len());
+                        for (k, v) in d.iter() {
+                            inverted.set(v.clone(), k.clone());
+                        }
+                        Ok(Value::Dict(Rc::new(RefCell::new(inverted))))
+                    }
+                    _ => Err("dict_invert() needs a dictionary".to_string()),
+                },
+            ))),
+        );
+
+        // items - get dictionary as list of [key, value] pairs
+        globals.borrow_mut().define(
+            "items".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "items",
+                1,
+                |args| match &args[0] {
+                    Value::Dict(d) => {
+                        let pairs: Vec<Value> = d
+                            .borrow()
+                            .iter()
+                            .map(|(k, v)| {
+                                Value::List(Rc::new(RefCell::new(vec![k.clone(), v.clone()])))
+                            })
+                            .collect();
+                        Ok(Value::List(Rc::new(RefCell::new(pairs))))
+                    }
+                    _ => Err("items() needs a dictionary".to_string()),
+                },
+            ))),
         );
 
+        // fae_pairs / dict_from_pairs - create dictionary from list of [key, value] pairs
+        for name in ["fae_pairs", "dict_from_pairs"] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, 1, fae_pairs))),
+            );
+        }
+
         // ============================================================
-        // SET (CREEL) FUNCTIONS - A creel is a basket in Scots!
+        // STRING UTILITIES - More ways tae wrangle yer strings!
         // ============================================================
 
-        // creel - create a new set from a list
-        globals.borrow_mut().define(
-            "creel".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("creel", 1, |args| {
-                match &args[0] {
-                    Value::List(list) => {
-                        let mut items = SetValue::new();
-                        for item in list.borrow().iter() {
-                            items.insert(item.clone());
-                        }
-                        Ok(Value::Set(Rc::new(RefCell::new(items))))
-                    }
-                    Value::Set(s) => Ok(Value::Set(s.clone())), // Already a set
-                    _ => Err("creel() needs a list tae make a set fae".to_string()),
-                }
-            }))),
-        );
-
-        // toss_in - add item to set (toss it intae the creel!)
+        // center - center a string in a field of given width
         globals.borrow_mut().define(
-            "toss_in".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("toss_in", 2, |args| {
-                if let Value::Set(set) = &args[0] {
-                    set.borrow_mut().insert(args[1].clone());
-                    Ok(Value::Set(set.clone()))
-                } else {
-                    Err("toss_in() needs a creel (set)".to_string())
+            "center".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("center", 3, |args| {
+                let s = match &args[0] {
+                    Value::String(s) => s.clone(),
+                    _ => return Err("center() needs a string".to_string()),
+                };
+                let width = match &args[1] {
+                    Value::Integer(n) => *n as usize,
+                    _ => return Err("center() needs a width".to_string()),
+                };
+                let fill = match &args[2] {
+                    Value::String(c) => c.chars().next().unwrap_or(' '),
+                    _ => return Err("center() needs a fill character".to_string()),
+                };
+                if s.len() >= width {
+                    return Ok(Value::String(s));
                 }
+                let padding = width - s.len();
+                let left_pad = padding / 2;
+                let right_pad = padding - left_pad;
+                Ok(Value::String(
+                    format!(
+                        "{}{}{}",
+                        fill.to_string().repeat(left_pad),
+                        s,
+                        fill.to_string().repeat(right_pad)
+                    )
+                    .into(),
+                ))
             }))),
         );
 
-        // heave_oot - remove item from set (heave it oot the creel!)
+        // is_upper - check if string is all uppercase
         globals.borrow_mut().define(
-            "heave_oot".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("heave_oot", 2, |args| {
-                if let Value::Set(set) = &args[0] {
-                    set.borrow_mut().remove(&args[1]);
-                    Ok(Value::Set(set.clone()))
-                } else {
-                    Err("heave_oot() needs a creel (set)".to_string())
-                }
-            }))),
+            "is_upper".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "is_upper",
+                1,
+                |args| match &args[0] {
+                    Value::String(s) => {
+                        let has_letters = s.chars().any(|c| c.is_alphabetic());
+                        Ok(Value::Bool(
+                            has_letters
+                                && s.chars().all(|c| !c.is_alphabetic() || c.is_uppercase()),
+                        ))
+                    }
+                    _ => Err("is_upper() needs a string".to_string()),
+                },
+            ))),
         );
 
-        // is_in_creel - check if item is in set
+        // is_lower - check if string is all lowercase
         globals.borrow_mut().define(
-            "is_in_creel".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("is_in_creel", 2, |args| {
-                if let Value::Set(set) = &args[0] {
-                    Ok(Value::Bool(set.borrow().contains(&args[1])))
-                } else {
-                    Err("is_in_creel() needs a creel (set)".to_string())
-                }
-            }))),
+            "is_lower".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "is_lower",
+                1,
+                |args| match &args[0] {
+                    Value::String(s) => {
+                        let has_letters = s.chars().any(|c| c.is_alphabetic());
+                        Ok(Value::Bool(
+                            has_letters
+                                && s.chars().all(|c| !c.is_alphabetic() || c.is_lowercase()),
+                        ))
+                    }
+                    _ => Err("is_lower() needs a string".to_string()),
+                },
+            ))),
         );
 
-        // creels_thegither - union of two sets (put them thegither!)
+        // swapcase - swap case of all letters
         globals.borrow_mut().define(
-            "creels_thegither".to_string(),
+            "swapcase".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "creels_thegither",
-                2,
-                |args| match (&args[0], &args[1]) {
-                    (Value::Set(a), Value::Set(b)) => {
-                        let union = a.borrow().union(&b.borrow());
-                        Ok(Value::Set(Rc::new(RefCell::new(union))))
+                "swapcase",
+                1,
+                |args| match &args[0] {
+                    Value::String(s) => {
+                        let swapped: String = s
+                            .chars()
+                            .map(|c| {
+                                if c.is_uppercase() {
+                                    c.to_lowercase().next().unwrap_or(c)
+                                } else if c.is_lowercase() {
+                                    c.to_uppercase().next().unwrap_or(c)
+                                } else {
+                                    c
+                                }
+                            })
+                            .collect();
+                        Ok(Value::String(swapped.into()))
                     }
-                    _ => Err("creels_thegither() needs two creels".to_string()),
+                    _ => Err("swapcase() needs a string".to_string()),
                 },
             ))),
         );
 
-        // creels_baith - intersection of two sets (what's in baith!)
+        // strip_left - remove leading characters
         globals.borrow_mut().define(
-            "creels_baith".to_string(),
+            "strip_left".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "creels_baith",
+                "strip_left",
                 2,
                 |args| match (&args[0], &args[1]) {
-                    (Value::Set(a), Value::Set(b)) => {
-                        let intersection = a.borrow().intersection(&b.borrow());
-                        Ok(Value::Set(Rc::new(RefCell::new(intersection))))
+                    (Value::String(s), Value::String(chars)) => {
+                        let char_set: Vec<char> = chars.chars().collect();
+                        Ok(Value::String(
+                            s.trim_start_matches(|c| char_set.contains(&c)).into(),
+                        ))
                     }
-                    _ => Err("creels_baith() needs two creels".to_string()),
+                    _ => Err("strip_left() needs two strings".to_string()),
                 },
             ))),
         );
 
-        // creels_differ - difference of two sets (what's in a but no in b)
+        // strip_right - remove trailing characters
         globals.borrow_mut().define(
-            "creels_differ".to_string(),
+            "strip_right".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "creels_differ",
+                "strip_right",
                 2,
                 |args| match (&args[0], &args[1]) {
-                    (Value::Set(a), Value::Set(b)) => {
-                        let difference = a.borrow().difference(&b.borrow());
-                        Ok(Value::Set(Rc::new(RefCell::new(difference))))
+                    (Value::String(s), Value::String(chars)) => {
+                        let char_set: Vec<char> = chars.chars().collect();
+                        Ok(Value::String(
+                            s.trim_end_matches(|c| char_set.contains(&c)).into(),
+                        ))
                     }
-                    _ => Err("creels_differ() needs two creels".to_string()),
+                    _ => Err("strip_right() needs two strings".to_string()),
                 },
             ))),
         );
 
-        // creel_tae_list - convert set to sorted list
-        globals.borrow_mut().define(
-            "creel_tae_list".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("creel_tae_list", 1, |args| {
-                if let Value::Set(set) = &args[0] {
-                    let mut items: Vec<(String, Value)> = set
-                        .borrow()
-                        .iter()
-                        .map(|v| (format!("{}", v), v.clone()))
-                        .collect();
-                    items.sort_by(|a, b| a.0.cmp(&b.0));
-                    let values: Vec<Value> = items.into_iter().map(|(_, v)| v).collect();
-                    Ok(Value::List(Rc::new(RefCell::new(values))))
-                } else {
-                    Err("creel_tae_list() needs a creel".to_string())
-                }
-            }))),
-        );
-
-        // is_subset - check if one set is a subset of another (is a inside b?)
-        globals.borrow_mut().define(
-            "is_subset".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("is_subset", 2, |args| match (
-                &args[0], &args[1],
-            ) {
-                (Value::Set(a), Value::Set(b)) => {
-                    Ok(Value::Bool(a.borrow().is_subset(&b.borrow())))
-                }
-                _ => Err("is_subset() needs two creels".to_string()),
-            }))),
-        );
-
-        // is_superset - check if one set is a superset of another (does a contain aw o b?)
+        // replace_first - replace only first occurrence
         globals.borrow_mut().define(
-            "is_superset".to_string(),
+            "replace_first".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "is_superset",
-                2,
-                |args| match (&args[0], &args[1]) {
-                    (Value::Set(a), Value::Set(b)) => {
-                        Ok(Value::Bool(a.borrow().is_superset(&b.borrow())))
-                    }
-                    _ => Err("is_superset() needs two creels".to_string()),
+                "replace_first",
+                3,
+                |args| match (&args[0], &args[1], &args[2]) {
+                    (Value::String(s), Value::String(from), Value::String(to)) => Ok(
+                        Value::String(s.replacen(from.as_ref(), to.as_ref(), 1).into()),
+                    ),
+                    _ => Err("replace_first() needs three strings".to_string()),
                 },
             ))),
         );
 
-        // is_disjoint - check if two sets have nae overlap
+        // substr_between - get substring between two markers
         globals.borrow_mut().define(
-            "is_disjoint".to_string(),
+            "substr_between".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "is_disjoint",
-                2,
-                |args| match (&args[0], &args[1]) {
-                    (Value::Set(a), Value::Set(b)) => {
-                        Ok(Value::Bool(a.borrow().is_disjoint(&b.borrow())))
+                "substr_between",
+                3,
+                |args| match (&args[0], &args[1], &args[2]) {
+                    (Value::String(s), Value::String(start), Value::String(end)) => {
+                        if let Some(start_idx) = s.find(start.as_ref()) {
+                            let after_start = start_idx + start.len();
+                            if let Some(end_idx) = s[after_start..].find(end.as_ref()) {
+                                return Ok(Value::String(
+                                    s[after_start..after_start + end_idx].into(),
+                                ));
+                            }
+                        }
+                        Ok(Value::Nil)
                     }
-                    _ => Err("is_disjoint() needs two creels".to_string()),
+                    _ => Err("substr_between() needs three strings".to_string()),
                 },
             ))),
         );
 
-        // empty_creel - create an empty set
+        // ============================================================
+        // MORE MATHEMATICAL FUNCTIONS
+        // ============================================================
+
+        // sign - get sign of number (-1, 0, or 1)
         globals.borrow_mut().define(
-            "empty_creel".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("empty_creel", 0, |_args| {
-                Ok(Value::Set(Rc::new(RefCell::new(SetValue::new()))))
-            }))),
+            "sign".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new(
+                "sign",
+                1,
+                |args| match &args[0] {
+                    Value::Integer(n) => Ok(Value::Integer(if *n > 0 {
+                        1
+                    } else if *n < 0 {
+                        -1
+                    } else {
+                        0
+                    })),
+                    Value::Float(f) => Ok(Value::Integer(if *f > 0.0 {
+                        1
+                    } else if *f < 0.0 {
+                        -1
+                    } else {
+                        0
+                    })),
+                    _ => Err("sign() needs a number".to_string()),
+                },
+            ))),
         );
 
-        // json_parse - parse a JSON string intae a value
+        // clamp - constrain a value between min and max
         globals.borrow_mut().define(
-            "json_parse".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("json_parse", 1, |args| {
-                if let Value::String(s) = &args[0] {
-                    parse_json_value(s)
-                } else {
-                    Err("json_parse() expects a string, ya numpty!".to_string())
+            "clamp".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("clamp", 3, |args| {
+                match (&args[0], &args[1], &args[2]) {
+                    (Value::Integer(n), Value::Integer(min), Value::Integer(max)) => {
+                        Ok(Value::Integer((*n).max(*min).min(*max)))
+                    }
+                    (Value::Float(n), Value::Float(min), Value::Float(max)) => {
+                        Ok(Value::Float(n.max(*min).min(*max)))
+                    }
+                    _ => Err("clamp() needs three numbers o' the same type".to_string()),
                 }
             }))),
         );
 
-        // json_stringify - convert a value tae JSON string
-        globals.borrow_mut().define(
-            "json_stringify".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("json_stringify", 1, |args| {
-                Ok(Value::String(value_to_json(&args[0])))
-            }))),
-        );
-
-        // json_pretty - convert a value tae pretty-printed JSON string
+        // lerp - linear interpolation between two values
         globals.borrow_mut().define(
-            "json_pretty".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("json_pretty", 1, |args| {
-                Ok(Value::String(value_to_json_pretty(&args[0], 0)))
+            "lerp".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("lerp", 3, |args| {
+                let a = match &args[0] {
+                    Value::Float(f) => *f,
+                    Value::Integer(n) => *n as f64,
+                    _ => return Err("lerp() needs numbers".to_string()),
+                };
+                let b = match &args[1] {
+                    Value::Float(f) => *f,
+                    Value::Integer(n) => *n as f64,
+                    _ => return Err("lerp() needs numbers".to_string()),
+                };
+                let t = match &args[2] {
+                    Value::Float(f) => *f,
+                    Value::Integer(n) => *n as f64,
+                    _ => return Err("lerp() needs numbers".to_string()),
+                };
+                Ok(Value::Float(a + (b - a) * t))
             }))),
         );
 
-        // ============================================================
-        // BITWISE OPERATIONS - Fer aw yer binary fiddlin' needs!
-        // ============================================================
-
-        // bit_an - bitwise AND (Scots: "an" = and)
+        // gcd - greatest common divisor
         globals.borrow_mut().define(
-            "bit_an".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("bit_an", 2, |args| {
-                match (&args[0], &args[1]) {
-                    (Value::Integer(a), Value::Integer(b)) => Ok(Value::Integer(*a & *b)),
-                    _ => Err("bit_an() needs two integers".to_string()),
+            "gcd".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("gcd", 2, |args| {
+                fn gcd_calc(a: i64, b: i64) -> i64 {
+                    if b == 0 {
+                        a.abs()
+                    } else {
+                        gcd_calc(b, a % b)
+                    }
                 }
-            }))),
-        );
-
-        // bit_or - bitwise OR
-        globals.borrow_mut().define(
-            "bit_or".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("bit_or", 2, |args| {
                 match (&args[0], &args[1]) {
-                    (Value::Integer(a), Value::Integer(b)) => Ok(Value::Integer(*a | *b)),
-                    _ => Err("bit_or() needs two integers".to_string()),
+                    (Value::Integer(a), Value::Integer(b)) => Ok(Value::Integer(gcd_calc(*a, *b))),
+                    _ => Err("gcd() needs two integers".to_string()),
                 }
             }))),
         );
 
-        // bit_xor - bitwise XOR
+        // lcm - least common multiple
         globals.borrow_mut().define(
-            "bit_xor".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("bit_xor", 2, |args| {
+            "lcm".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("lcm", 2, |args| {
+                fn gcd_calc(a: i64, b: i64) -> i64 {
+                    if b == 0 {
+                        a.abs()
+                    } else {
+                        gcd_calc(b, a % b)
+                    }
+                }
                 match (&args[0], &args[1]) {
-                    (Value::Integer(a), Value::Integer(b)) => Ok(Value::Integer(*a ^ *b)),
-                    _ => Err("bit_xor() needs two integers".to_string()),
+                    (Value::Integer(a), Value::Integer(b)) => {
+                        if *a == 0 || *b == 0 {
+                            Ok(Value::Integer(0))
+                        } else {
+                            Ok(Value::Integer((*a * *b).abs() / gcd_calc(*a, *b)))
+                        }
+                    }
+                    _ => Err("lcm() needs two integers".to_string()),
                 }
             }))),
         );
 
-        // bit_nae - bitwise NOT (Scots: nae = not)
+        // factorial - calculate factorial
         globals.borrow_mut().define(
-            "bit_nae".to_string(),
+            "factorial".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "bit_nae",
+                "factorial",
                 1,
                 |args| match &args[0] {
-                    Value::Integer(n) => Ok(Value::Integer(!*n)),
-                    _ => Err("bit_nae() needs an integer".to_string()),
-                },
-            ))),
-        );
-
-        // bit_shove_left - left shift (shove left!)
-        globals.borrow_mut().define(
-            "bit_shove_left".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "bit_shove_left",
-                2,
-                |args| match (&args[0], &args[1]) {
-                    (Value::Integer(a), Value::Integer(b)) => {
-                        if *b < 0 || *b > 63 {
-                            return Err("Shift amount must be 0-63, ya numpty!".to_string());
+                    Value::Integer(n) => {
+                        if *n < 0 {
+                            return Err(
+                                "Cannae calculate factorial o' negative number!".to_string()
+                            );
                         }
-                        Ok(Value::Integer(*a << *b))
-                    }
-                    _ => Err("bit_shove_left() needs two integers".to_string()),
-                },
-            ))),
-        );
-
-        // bit_shove_right - right shift (shove right!)
-        globals.borrow_mut().define(
-            "bit_shove_right".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "bit_shove_right",
-                2,
-                |args| match (&args[0], &args[1]) {
-                    (Value::Integer(a), Value::Integer(b)) => {
-                        if *b < 0 || *b > 63 {
-                            return Err("Shift amount must be 0-63, ya numpty!".to_string());
+                        if *n > 20 {
+                            return Err("Factorial too big! Max is 20".to_string());
                         }
-                        Ok(Value::Integer(*a >> *b))
+                        let mut result: i64 = 1;
+                        for i in 2..=*n {
+                            result *= i;
+                        }
+                        Ok(Value::Integer(result))
                     }
-                    _ => Err("bit_shove_right() needs two integers".to_string()),
+                    _ => Err("factorial() needs an integer".to_string()),
                 },
             ))),
         );
 
-        // bit_coont - count number of set bits (popcount)
+        // is_even - check if number is even
         globals.borrow_mut().define(
-            "bit_coont".to_string(),
+            "is_even".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "bit_coont",
+                "is_even",
                 1,
                 |args| match &args[0] {
-                    Value::Integer(n) => Ok(Value::Integer(n.count_ones() as i64)),
-                    _ => Err("bit_coont() needs an integer".to_string()),
+                    Value::Integer(n) => Ok(Value::Bool(*n % 2 == 0)),
+                    _ => Err("is_even() needs an integer".to_string()),
                 },
             ))),
         );
 
-        // tae_binary - convert to binary string
+        // is_odd - check if number is odd
         globals.borrow_mut().define(
-            "tae_binary".to_string(),
+            "is_odd".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "tae_binary",
+                "is_odd",
                 1,
                 |args| match &args[0] {
-                    Value::Integer(n) => Ok(Value::String(format!("{:b}", n))),
-                    _ => Err("tae_binary() needs an integer".to_string()),
+                    Value::Integer(n) => Ok(Value::Bool(*n % 2 != 0)),
+                    _ => Err("is_odd() needs an integer".to_string()),
                 },
             ))),
         );
 
-        // tae_hex - convert to hexadecimal string
+        // is_prime - check if number is prime
         globals.borrow_mut().define(
-            "tae_hex".to_string(),
+            "is_prime".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "tae_hex",
+                "is_prime",
                 1,
                 |args| match &args[0] {
-                    Value::Integer(n) => Ok(Value::String(format!("{:x}", n))),
-                    _ => Err("tae_hex() needs an integer".to_string()),
+                    Value::Integer(n) => {
+                        if *n < 2 {
+                            return Ok(Value::Bool(false));
+                        }
+                        if *n == 2 {
+                            return Ok(Value::Bool(true));
+                        }
+                        if *n % 2 == 0 {
+                            return Ok(Value::Bool(false));
+                        }
+                        let sqrt_n = (*n as f64).sqrt() as i64;
+                        for i in (3..=sqrt_n).step_by(2) {
+                            if *n % i == 0 {
+                                return Ok(Value::Bool(false));
+                            }
+                        }
+                        Ok(Value::Bool(true))
+                    }
+                    _ => Err("is_prime() needs an integer".to_string()),
                 },
             ))),
         );
 
-        // tae_octal - convert to octal string
+        // ============================================================
+        // ASSERTION FUNCTIONS - Test yer code, ya numpty!
+        // ============================================================
+
+        // assert - throw error if condition is false
         globals.borrow_mut().define(
-            "tae_octal".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "tae_octal",
-                1,
-                |args| match &args[0] {
-                    Value::Integer(n) => Ok(Value::String(format!("{:o}", n))),
-                    _ => Err("tae_octal() needs an integer".to_string()),
-                },
-            ))),
+            "assert".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("assert", 2, |args| {
+                let condition = args[0].is_truthy();
+                if !condition {
+                    let msg = match &args[1] {
+                        Value::String(s) => s.clone(),
+                        _ => format!("{}", args[1]).into(),
+                    };
+                    Err(format!("Assertion failed: {}", msg))
+                } else {
+                    Ok(Value::Bool(true))
+                }
+            }))),
         );
 
-        // fae_binary - parse binary string to integer
+        // assert_equal - throw error if values are not equal
         globals.borrow_mut().define(
-            "fae_binary".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "fae_binary",
-                1,
-                |args| match &args[0] {
-                    Value::String(s) => i64::from_str_radix(s.trim_start_matches("0b"), 2)
-                        .map(Value::Integer)
-                        .map_err(|_| format!("Cannae parse '{}' as binary", s)),
-                    _ => Err("fae_binary() needs a string".to_string()),
-                },
-            ))),
+            "assert_equal".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("assert_equal", 2, |args| {
+                if args[0] == args[1] {
+                    Ok(Value::Bool(true))
+                } else {
+                    Err(format!(
+                        "Assertion failed: expected {} but got {}",
+                        args[0], args[1]
+                    ))
+                }
+            }))),
         );
 
-        // fae_hex - parse hexadecimal string to integer
+        // assert_nae_equal - throw error if values are equal
         globals.borrow_mut().define(
-            "fae_hex".to_string(),
+            "assert_nae_equal".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "fae_hex",
-                1,
-                |args| match &args[0] {
-                    Value::String(s) => i64::from_str_radix(s.trim_start_matches("0x"), 16)
-                        .map(Value::Integer)
-                        .map_err(|_| format!("Cannae parse '{}' as hex", s)),
-                    _ => Err("fae_hex() needs a string".to_string()),
+                "assert_nae_equal",
+                2,
+                |args| {
+                    if args[0] != args[1] {
+                        Ok(Value::Bool(true))
+                    } else {
+                        Err(format!(
+                            "Assertion failed: {} should not equal {}",
+                            args[0], args[1]
+                        ))
+                    }
                 },
             ))),
         );
 
         // ============================================================
-        // MORE DICTIONARY FUNCTIONS - Fer managin' yer dicts!
+        // LIST STATISTICS - Fer number-crunchin'!
         // ============================================================
 
-        // dict_merge - merge two dictionaries (second overrides first)
+        // average - calculate average of a list of numbers (Scots: mean)
         globals.borrow_mut().define(
-            "dict_merge".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "dict_merge",
-                2,
-                |args| match (&args[0], &args[1]) {
-                    (Value::Dict(a), Value::Dict(b)) => {
-                        let mut result = a.borrow().clone();
-                        for (k, v) in b.borrow().iter() {
-                            result.set(k.clone(), v.clone());
+            "average".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("average", 1, |args| {
+                if let Value::List(list) = &args[0] {
+                    let items = list.borrow();
+                    if items.is_empty() {
+                        return Err("Cannae calculate average o' empty list!".to_string());
+                    }
+                    let mut sum: f64 = 0.0;
+                    for item in items.iter() {
+                        match item {
+                            Value::Integer(n) => sum += *n as f64,
+                            Value::Float(f) => sum += *f,
+                            _ => return Err("average() needs a list o' numbers".to_string()),
                         }
-                        Ok(Value::Dict(Rc::new(RefCell::new(result))))
                     }
-                    _ => Err("dict_merge() needs two dictionaries".to_string()),
-                },
-            ))),
+                    Ok(Value::Float(sum / items.len() as f64))
+                } else {
+                    Err("average() needs a list".to_string())
+                }
+            }))),
         );
 
-        // dict_get - get value with default (avoids crashes!)
+        // int_array / float_array - numbers kept unboxed, from a size or a list
         globals.borrow_mut().define(
-            "dict_get".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "dict_get",
-                3,
-                |args| match &args[0] {
-                    Value::Dict(d) => Ok(d
-                        .borrow()
-                        .get(&args[1])
-                        .cloned()
-                        .unwrap_or_else(|| args[2].clone())),
-                    _ => Err("dict_get() needs a dictionary".to_string()),
-                },
-            ))),
+            "int_array".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("int_array", 1, |args| {
+                make_num_array("int_array", &args[0], false)
+            }))),
+        );
+        globals.borrow_mut().define(
+            "float_array".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("float_array", 1, |args| {
+                make_num_array("float_array", &args[0], true)
+            }))),
         );
 
-        // dict_has - check if dictionary has a key
+        // array_tae_list - a typed array's numbers as an ordinary list
         globals.borrow_mut().define(
-            "dict_has".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "dict_has",
-                2,
-                |args| match &args[0] {
-                    Value::Dict(d) => Ok(Value::Bool(d.borrow().contains_key(&args[1]))),
-                    _ => Err("dict_has() needs a dictionary".to_string()),
-                },
-            ))),
+            "array_tae_list".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("array_tae_list", 1, |args| {
+                with_num_array("array_tae_list", &args[0], |arr| {
+                    let items = (0..arr.len()).map(|i| arr.at(i)).collect();
+                    Ok(Value::List(Rc::new(RefCell::new(items))))
+                })
+            }))),
         );
 
-        // dict_remove - remove a key from dictionary (returns new dict)
+        // array_sum / array_average / array_min / array_max - reductions over a typed array
         globals.borrow_mut().define(
-            "dict_remove".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "dict_remove",
-                2,
-                |args| match &args[0] {
-                    Value::Dict(d) => {
-                        let mut new_dict = d.borrow().clone();
-                        new_dict.remove(&args[1]);
-                        Ok(Value::Dict(Rc::new(RefCell::new(new_dict))))
+            "array_sum".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("array_sum", 1, |args| {
+                with_num_array("array_sum", &args[0], |arr| {
+                    Ok(match &*arr.data.borrow() {
+                        NumData::Int(v) => {
+                            Value::Integer(v.iter().fold(0i64, |s, &n| s.wrapping_add(n)))
+                        }
+                        NumData::Float(v) => Value::Float(v.iter().sum()),
+                    })
+                })
+            }))),
+        );
+        globals.borrow_mut().define(
+            "array_average".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("array_average", 1, |args| {
+                with_num_array("array_average", &args[0], |arr| {
+                    if arr.len() == 0 {
+                        return Err("Cannae calculate average o' empty array!".to_string());
                     }
-                    _ => Err("dict_remove() needs a dictionary".to_string()),
-                },
-            ))),
+                    let sum = match &*arr.data.borrow() {
+                        NumData::Int(v) => v.iter().fold(0i64, |s, &n| s.wrapping_add(n)) as f64,
+                        NumData::Float(v) => v.iter().sum(),
+                    };
+                    Ok(Value::Float(sum / arr.len() as f64))
+                })
+            }))),
+        );
+        globals.borrow_mut().define(
+            "array_min".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("array_min", 1, |args| {
+                num_array_extreme("array_min", &args[0], false)
+            }))),
+        );
+        globals.borrow_mut().define(
+            "array_max".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("array_max", 1, |args| {
+                num_array_extreme("array_max", &args[0], true)
+            }))),
         );
 
-        // dict_invert - swap keys and values
+        // array_dot - sum of the elementwise products of two arrays the same length
         globals.borrow_mut().define(
-            "dict_invert".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "dict_invert",
-                1,
-                |args| match &args[0] {
-                    Value::Dict(d) => {
-                        let mut inverted = DictValue::new();
-                        for (k, v) in d.borrow().iter() {
-                            inverted.set(v.clone(), k.clone());
+            "array_dot".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("array_dot", 2, |args| {
+                with_num_array("array_dot", &args[0], |x| {
+                    with_num_array("array_dot", &args[1], |y| {
+                        if x.len() != y.len() {
+                            return Err(format!(
+                                "array_dot() needs arrays o' the same length (got {} and {})",
+                                x.len(),
+                                y.len()
+                            ));
                         }
-                        Ok(Value::Dict(Rc::new(RefCell::new(inverted))))
-                    }
-                    _ => Err("dict_invert() needs a dictionary".to_string()),
-                },
-            ))),
+                        Ok(match (&*x.data.borrow(), &*y.data.borrow()) {
+                            (NumData::Int(p), NumData::Int(q)) => Value::Integer(
+                                p.iter()
+                                    .zip(q)
+                                    .fold(0i64, |s, (&a, &b)| s.wrapping_add(a.wrapping_mul(b))),
+                            ),
+                            _ => Value::Float(
+                                x.floats().iter().zip(y.floats()).map(|(a, b)| a * b).sum(),
+                            ),
+                        })
+                    })
+                })
+            }))),
         );
 
-        // items - get dictionary as list of [key, value] pairs
+        // array_add / array_sub / array_mul / array_div - elementwise, with an array or a number
+        for (name, op) in [
+            ("array_add", BinaryOp::Add),
+            ("array_sub", BinaryOp::Subtract),
+            ("array_mul", BinaryOp::Multiply),
+            ("array_div", BinaryOp::Divide),
+        ] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, 2, move |args| {
+                    num_array_arith(name, &args[0], &args[1], op)
+                }))),
+            );
+        }
+
+        // deque - an empty double-ended queue; the deque_* builtins work either end in O(1)
         globals.borrow_mut().define(
-            "items".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "items",
-                1,
-                |args| match &args[0] {
-                    Value::Dict(d) => {
-                        let pairs: Vec<Value> = d
-                            .borrow()
-                            .iter()
-                            .map(|(k, v)| {
-                                Value::List(Rc::new(RefCell::new(vec![k.clone(), v.clone()])))
-                            })
-                            .collect();
-                        Ok(Value::List(Rc::new(RefCell::new(pairs))))
-                    }
-                    _ => Err("items() needs a dictionary".to_string()),
-                },
-            ))),
+            "deque".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("deque", 0, |_args| {
+                Ok(Value::NativeObject(Rc::new(Deque::default())))
+            }))),
+        );
+        for (name, front) in [("deque_push_front", true), ("deque_push_back", false)] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, 2, move |args| {
+                    with_deque(name, &args[0], |deque| {
+                        let mut items = deque.items.borrow_mut();
+                        if front {
+                            items.push_front(args[1].clone());
+                        } else {
+                            items.push_back(args[1].clone());
+                        }
+                        Ok(Value::Nil)
+                    })
+                }))),
+            );
+        }
+        // deque_pop_front / deque_pop_back / deque_front / deque_back - nil when empty
+        for (name, front, take) in [
+            ("deque_pop_front", true, true),
+            ("deque_pop_back", false, true),
+            ("deque_front", true, false),
+            ("deque_back", false, false),
+        ] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, 1, move |args| {
+                    with_deque(name, &args[0], |deque| {
+                        let mut items = deque.items.borrow_mut();
+                        let item = match (front, take) {
+                            (true, true) => items.pop_front(),
+                            (false, true) => items.pop_back(),
+                            (true, false) => items.front().cloned(),
+                            (false, false) => items.back().cloned(),
+                        };
+                        Ok(item.unwrap_or(Value::Nil))
+                    })
+                }))),
+            );
+        }
+        globals.borrow_mut().define(
+            "deque_clear".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("deque_clear", 1, |args| {
+                with_deque("deque_clear", &args[0], |deque| {
+                    deque.items.borrow_mut().clear();
+                    Ok(Value::Nil)
+                })
+            }))),
+        );
+        globals.borrow_mut().define(
+            "deque_tae_list".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("deque_tae_list", 1, |args| {
+                with_deque("deque_tae_list", &args[0], |deque| {
+                    let items = deque.items.borrow().iter().cloned().collect();
+                    Ok(Value::List(Rc::new(RefCell::new(items))))
+                })
+            }))),
         );
 
-        // fae_pairs - create dictionary from list of [key, value] pairs
+        // heap(key_fn) - an empty min-heap ordered by key_fn(item), or the item when nil
         globals.borrow_mut().define(
-            "fae_pairs".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "fae_pairs",
-                1,
-                |args| match &args[0] {
-                    Value::List(list) => {
-                        let mut dict = DictValue::new();
-                        for item in list.borrow().iter() {
-                            if let Value::List(pair) = item {
-                                let pair = pair.borrow();
-                                if pair.len() >= 2 {
-                                    dict.set(pair[0].clone(), pair[1].clone());
-                                }
-                            }
+            "heap".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("heap", 1, |args| {
+                match &args[0] {
+                    Value::Nil | Value::Function(_) | Value::NativeFunction(_) => {}
+                    other => {
+                        return Err(format!(
+                            "heap() needs a key function or naething, no' a {}",
+                            other.type_name()
+                        ))
+                    }
+                }
+                Ok(Value::NativeObject(Rc::new(Heap {
+                    key_fn: args[0].clone(),
+                    entries: RefCell::new(std::collections::BinaryHeap::new()),
+                    next_seq: std::cell::Cell::new(0),
+                })))
+            }))),
+        );
+        globals.borrow_mut().define(
+            "heap_push".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("heap_push", 2, |args| {
+                let key_fn = with_heap("heap_push", &args[0], |heap| Ok(heap.key_fn.clone()))?;
+                let item = args[1].clone();
+                let key = if matches!(key_fn, Value::Nil) {
+                    item.clone()
+                } else {
+                    match with_current_interpreter(|interp| {
+                        interp.call_value(key_fn, vec![item.clone()], 0)
+                    }) {
+                        Some(Ok(key)) => key,
+                        Some(Err(err)) => return Err(format!("{}", err)),
+                        None => {
+                            return Err(
+                                "heap_push() is unavailable outside the interpreter".to_string()
+                            )
                         }
-                        Ok(Value::Dict(Rc::new(RefCell::new(dict))))
                     }
-                    _ => Err("fae_pairs() needs a list o' pairs".to_string()),
-                },
-            ))),
+                };
+                with_heap("heap_push", &args[0], |heap| {
+                    heap.push(key, item);
+                    Ok(Value::Nil)
+                })
+            }))),
+        );
+        // heap_pop / heap_peek - the item with the smallest key, or nil when empty
+        for (name, take) in [("heap_pop", true), ("heap_peek", false)] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, 1, move |args| {
+                    with_heap(name, &args[0], |heap| {
+                        let mut entries = heap.entries.borrow_mut();
+                        let item = if take {
+                            entries.pop().map(|entry| entry.item)
+                        } else {
+                            entries.peek().map(|entry| entry.item.clone())
+                        };
+                        Ok(item.unwrap_or(Value::Nil))
+                    })
+                }))),
+            );
+        }
+        globals.borrow_mut().define(
+            "heap_tae_list".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("heap_tae_list", 1, |args| {
+                with_heap("heap_tae_list", &args[0], |heap| {
+                    Ok(Value::List(Rc::new(RefCell::new(heap.sorted()))))
+                })
+            }))),
         );
 
-        // ============================================================
-        // STRING UTILITIES - More ways tae wrangle yer strings!
-        // ============================================================
+        // hash(value) - an integer hash consistent with ==, so equal values hash the same
+        globals.borrow_mut().define(
+            "hash".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("hash", 1, |args| {
+                Ok(Value::Integer(args[0].eq_hash() as i64))
+            }))),
+        );
 
-        // center - center a string in a field of given width
+        // hashmap - an empty map keyed by value: keys that are == share an entry
         globals.borrow_mut().define(
-            "center".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("center", 3, |args| {
-                let s = match &args[0] {
-                    Value::String(s) => s.clone(),
-                    _ => return Err("center() needs a string".to_string()),
-                };
-                let width = match &args[1] {
-                    Value::Integer(n) => *n as usize,
-                    _ => return Err("center() needs a width".to_string()),
-                };
-                let fill = match &args[2] {
-                    Value::String(c) => c.chars().next().unwrap_or(' '),
-                    _ => return Err("center() needs a fill character".to_string()),
-                };
-                if s.len() >= width {
-                    return Ok(Value::String(s));
-                }
-                let padding = width - s.len();
-                let left_pad = padding / 2;
-                let right_pad = padding - left_pad;
-                Ok(Value::String(format!(
-                    "{}{}{}",
-                    fill.to_string().repeat(left_pad),
-                    s,
-                    fill.to_string().repeat(right_pad)
-                )))
+            "hashmap".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("hashmap", 0, |_args| {
+                Ok(Value::NativeObject(Rc::new(HashMapValue::default())))
+            }))),
+        );
+        globals.borrow_mut().define(
+            "hashmap_set".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("hashmap_set", 3, |args| {
+                with_hashmap("hashmap_set", &args[0], |map| {
+                    let key = args[1].clone();
+                    map.map
+                        .borrow_mut()
+                        .insert(key.eq_hash(), key, args[2].clone());
+                    Ok(Value::Nil)
+                })
+            }))),
+        );
+        // hashmap_get(map, key, default) - the value at key, or default when it's not there
+        globals.borrow_mut().define(
+            "hashmap_get".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("hashmap_get", 3, |args| {
+                with_hashmap("hashmap_get", &args[0], |map| {
+                    let map = map.map.borrow();
+                    Ok(map
+                        .get(&args[1])
+                        .cloned()
+                        .unwrap_or_else(|| args[2].clone()))
+                })
+            }))),
+        );
+        globals.borrow_mut().define(
+            "hashmap_has".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("hashmap_has", 2, |args| {
+                with_hashmap("hashmap_has", &args[0], |map| {
+                    Ok(Value::Bool(map.map.borrow().get(&args[1]).is_some()))
+                })
+            }))),
+        );
+        // hashmap_remove(map, key) - take key out, returning its value (nil if absent)
+        globals.borrow_mut().define(
+            "hashmap_remove".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("hashmap_remove", 2, |args| {
+                with_hashmap("hashmap_remove", &args[0], |map| {
+                    let mut map = map.map.borrow_mut();
+                    let Some(i) = map.find(args[1].eq_hash(), &args[1]) else {
+                        return Ok(Value::Nil);
+                    };
+                    let value = map.entries[i].1.clone();
+                    map.remove_at(i);
+                    Ok(value)
+                })
+            }))),
+        );
+        globals.borrow_mut().define(
+            "hashmap_keys".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("hashmap_keys", 1, |args| {
+                with_hashmap("hashmap_keys", &args[0], |map| {
+                    Ok(Value::List(Rc::new(RefCell::new(map.map.borrow().keys()))))
+                })
             }))),
         );
 
-        // is_upper - check if string is all uppercase
+        // memoize(fn, max_entries = naething) - fn wrapped so each result is kept by its
+        // argument (compared with ==); past max_entries the least recently used is dropped
         globals.borrow_mut().define(
-            "is_upper".to_string(),
+            "memoize".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "is_upper",
-                1,
-                |args| match &args[0] {
-                    Value::String(s) => {
-                        let has_letters = s.chars().any(|c| c.is_alphabetic());
-                        Ok(Value::Bool(
-                            has_letters
-                                && s.chars().all(|c| !c.is_alphabetic() || c.is_uppercase()),
-                        ))
+                "memoize",
+                usize::MAX,
+                |args| {
+                    if args.is_empty() || args.len() > 2 {
+                        return Err("memoize() expects 1 or 2 arguments".to_string());
                     }
-                    _ => Err("is_upper() needs a string".to_string()),
+                    let func = args[0].clone();
+                    if !matches!(func, Value::Function(_) | Value::NativeFunction(_)) {
+                        return Err(format!(
+                            "memoize() needs a function, no' a {}",
+                            func.type_name()
+                        ));
+                    }
+                    let limit = match args.get(1) {
+                        None | Some(Value::Nil) => 0,
+                        Some(Value::Integer(n)) if *n > 0 => *n as usize,
+                        Some(other) => {
+                            return Err(format!(
+                                "memoize() needs max_entries above 0 or naething, no' {}",
+                                other
+                            ))
+                        }
+                    };
+                    let cache = RefCell::new(MemoCache::new(limit));
+                    let memoized = NativeFunction::new("memoized", 1, move |args| {
+                        let arg = args.into_iter().next().unwrap_or(Value::Nil);
+                        let hash = arg.eq_hash();
+                        if let Some(hit) = cache.borrow_mut().lookup(hash, &arg) {
+                            return Ok(hit);
+                        }
+                        // The cache isn't borrowed while fn runs, so it can recurse into us
+                        let result = match with_current_interpreter(|interp| {
+                            interp.call_value(func.clone(), vec![arg.clone()], 0)
+                        }) {
+                            Some(Ok(result)) => result,
+                            Some(Err(err)) => return Err(format!("{}", err)),
+                            None => {
+                                return Err(
+                                    "memoize() is unavailable outside the interpreter".to_string()
+                                )
+                            }
+                        };
+                        cache.borrow_mut().store(hash, arg, result.clone());
+                        Ok(result)
+                    });
+                    Ok(Value::NativeFunction(Rc::new(memoized)))
                 },
             ))),
         );
 
-        // is_lower - check if string is all lowercase
+        // frozen_dict / frozen_list - persistent copies; every change makes a new version
+        // that shares its unchanged parts with the old one
         globals.borrow_mut().define(
-            "is_lower".to_string(),
+            "frozen_dict".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "is_lower",
+                "frozen_dict",
                 1,
                 |args| match &args[0] {
-                    Value::String(s) => {
-                        let has_letters = s.chars().any(|c| c.is_alphabetic());
-                        Ok(Value::Bool(
-                            has_letters
-                                && s.chars().all(|c| !c.is_alphabetic() || c.is_lowercase()),
-                        ))
+                    Value::Dict(d) => {
+                        let frozen = d
+                            .borrow()
+                            .iter()
+                            .fold(FrozenDict::default(), |frozen, (k, v)| {
+                                frozen.with(k.clone(), v.clone())
+                            });
+                        Ok(Value::NativeObject(Rc::new(frozen)))
                     }
-                    _ => Err("is_lower() needs a string".to_string()),
+                    other => Err(format!(
+                        "frozen_dict() needs a dictionary, no' a {}",
+                        other.type_name()
+                    )),
                 },
             ))),
         );
-
-        // swapcase - swap case of all letters
         globals.borrow_mut().define(
-            "swapcase".to_string(),
+            "frozen_list".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "swapcase",
+                "frozen_list",
                 1,
                 |args| match &args[0] {
-                    Value::String(s) => {
-                        let swapped: String = s
-                            .chars()
-                            .map(|c| {
-                                if c.is_uppercase() {
-                                    c.to_lowercase().next().unwrap_or(c)
-                                } else if c.is_lowercase() {
-                                    c.to_uppercase().next().unwrap_or(c)
-                                } else {
-                                    c
-                                }
-                            })
-                            .collect();
-                        Ok(Value::String(swapped))
-                    }
-                    _ => Err("swapcase() needs a string".to_string()),
+                    Value::List(l) => Ok(Value::NativeObject(Rc::new(FrozenList::from_items(
+                        &l.borrow(),
+                    )))),
+                    other => Err(format!(
+                        "frozen_list() needs a list, no' a {}",
+                        other.type_name()
+                    )),
                 },
             ))),
         );
-
-        // strip_left - remove leading characters
+        // frozen_set(frozen, key, value) - a new version with key (or list index) set
         globals.borrow_mut().define(
-            "strip_left".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "strip_left",
-                2,
-                |args| match (&args[0], &args[1]) {
-                    (Value::String(s), Value::String(chars)) => {
-                        let char_set: Vec<char> = chars.chars().collect();
-                        Ok(Value::String(
-                            s.trim_start_matches(|c| char_set.contains(&c)).to_string(),
-                        ))
-                    }
-                    _ => Err("strip_left() needs two strings".to_string()),
-                },
-            ))),
+            "frozen_set".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("frozen_set", 3, |args| {
+                if let Some(frozen) = frozen_dict_ref(&args[0]) {
+                    let next = frozen.with(args[1].clone(), args[2].clone());
+                    return Ok(Value::NativeObject(Rc::new(next)));
+                }
+                with_frozen_list("frozen_set", &args[0], |list| {
+                    let Value::Integer(i) = args[1] else {
+                        return Err(format!(
+                            "frozen_set() needs an integer index, no' a {}",
+                            args[1].type_name()
+                        ));
+                    };
+                    let slot = list.slot(i).ok_or_else(|| {
+                        format!(
+                            "Och! Index {} oot o' bounds (frozen_list has {} items)",
+                            i, list.len
+                        )
+                    })?;
+                    Ok(Value::NativeObject(Rc::new(
+                        list.with(slot, args[2].clone()),
+                    )))
+                })
+            }))),
         );
-
-        // strip_right - remove trailing characters
+        // frozen_remove(frozen_dict, key) - a new version without key
         globals.borrow_mut().define(
-            "strip_right".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "strip_right",
-                2,
-                |args| match (&args[0], &args[1]) {
-                    (Value::String(s), Value::String(chars)) => {
-                        let char_set: Vec<char> = chars.chars().collect();
-                        Ok(Value::String(
-                            s.trim_end_matches(|c| char_set.contains(&c)).to_string(),
-                        ))
-                    }
-                    _ => Err("strip_right() needs two strings".to_string()),
-                },
-            ))),
+            "frozen_remove".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("frozen_remove", 2, |args| {
+                let frozen = frozen_dict_ref(&args[0])
+                    .ok_or_else(|| "frozen_remove() needs a frozen_dict".to_string())?;
+                Ok(match frozen.without(&args[1]) {
+                    Some(next) => Value::NativeObject(Rc::new(next)),
+                    None => args[0].clone(),
+                })
+            }))),
+        );
+        // frozen_push(frozen_list, item) - a new version with item on the end
+        globals.borrow_mut().define(
+            "frozen_push".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("frozen_push", 2, |args| {
+                with_frozen_list("frozen_push", &args[0], |list| {
+                    Ok(Value::NativeObject(Rc::new(list.pushed(args[1].clone()))))
+                })
+            }))),
+        );
+        // thaw(frozen) - a plain, mutable dict or list with the same entries
+        globals.borrow_mut().define(
+            "thaw".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("thaw", 1, |args| {
+                if let Some(frozen) = frozen_dict_ref(&args[0]) {
+                    return Ok(frozen.thawed());
+                }
+                with_frozen_list("thaw", &args[0], |list| {
+                    Ok(Value::List(Rc::new(RefCell::new(list.items()))))
+                })
+                .map_err(|_| "thaw() needs a frozen_dict or frozen_list".to_string())
+            }))),
         );
 
-        // replace_first - replace only first occurrence
+        // strbuf - a string builder; the appends hand back the builder for chaining
         globals.borrow_mut().define(
-            "replace_first".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "replace_first",
-                3,
-                |args| match (&args[0], &args[1], &args[2]) {
-                    (Value::String(s), Value::String(from), Value::String(to)) => {
-                        Ok(Value::String(s.replacen(from.as_str(), to.as_str(), 1)))
+            "strbuf".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("strbuf", 0, |_args| {
+                Ok(Value::NativeObject(Rc::new(StrBuilder::default())))
+            }))),
+        );
+        globals.borrow_mut().define(
+            "strbuf_append".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("strbuf_append", 2, |args| {
+                with_strbuf("strbuf_append", &args[0], |builder| {
+                    match &args[1] {
+                        Value::String(s) => builder.text.borrow_mut().push_str(s),
+                        other => builder.text.borrow_mut().push_str(&other.to_string()),
                     }
-                    _ => Err("replace_first() needs three strings".to_string()),
-                },
-            ))),
+                    Ok(args[0].clone())
+                })
+            }))),
         );
-
-        // substr_between - get substring between two markers
         globals.borrow_mut().define(
-            "substr_between".to_string(),
+            "strbuf_append_int".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "substr_between",
-                3,
-                |args| match (&args[0], &args[1], &args[2]) {
-                    (Value::String(s), Value::String(start), Value::String(end)) => {
-                        if let Some(start_idx) = s.find(start.as_str()) {
-                            let after_start = start_idx + start.len();
-                            if let Some(end_idx) = s[after_start..].find(end.as_str()) {
-                                return Ok(Value::String(
-                                    s[after_start..after_start + end_idx].to_string(),
-                                ));
-                            }
+                "strbuf_append_int",
+                2,
+                |args| {
+                    let n = match &args[1] {
+                        Value::Integer(n) => *n,
+                        other => {
+                            return Err(format!(
+                                "strbuf_append_int() needs an integer, no' a {}",
+                                other.type_name()
+                            ))
                         }
-                        Ok(Value::Nil)
-                    }
-                    _ => Err("substr_between() needs three strings".to_string()),
+                    };
+                    with_strbuf("strbuf_append_int", &args[0], |builder| {
+                        use std::fmt::Write;
+                        let _ = write!(builder.text.borrow_mut(), "{}", n);
+                        Ok(args[0].clone())
+                    })
                 },
             ))),
         );
-
-        // ============================================================
-        // MORE MATHEMATICAL FUNCTIONS
-        // ============================================================
-
-        // sign - get sign of number (-1, 0, or 1)
         globals.borrow_mut().define(
-            "sign".to_string(),
+            "strbuf_append_float".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "sign",
-                1,
-                |args| match &args[0] {
-                    Value::Integer(n) => Ok(Value::Integer(if *n > 0 {
-                        1
-                    } else if *n < 0 {
-                        -1
-                    } else {
-                        0
-                    })),
-                    Value::Float(f) => Ok(Value::Integer(if *f > 0.0 {
-                        1
-                    } else if *f < 0.0 {
-                        -1
-                    } else {
-                        0
-                    })),
-                    _ => Err("sign() needs a number".to_string()),
+                "strbuf_append_float",
+                2,
+                |args| {
+                    let x = match &args[1] {
+                        Value::Float(f) => *f,
+                        Value::Integer(n) => *n as f64,
+                        other => {
+                            return Err(format!(
+                                "strbuf_append_float() needs a number, no' a {}",
+                                other.type_name()
+                            ))
+                        }
+                    };
+                    with_strbuf("strbuf_append_float", &args[0], |builder| {
+                        use std::fmt::Write;
+                        let _ = write!(builder.text.borrow_mut(), "{}", Value::Float(x));
+                        Ok(args[0].clone())
+                    })
                 },
             ))),
         );
+        globals.borrow_mut().define(
+            "strbuf_len".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("strbuf_len", 1, |args| {
+                with_strbuf("strbuf_len", &args[0], |builder| {
+                    Ok(Value::Integer(builder.text.borrow().len() as i64))
+                })
+            }))),
+        );
+        globals.borrow_mut().define(
+            "strbuf_clear".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("strbuf_clear", 1, |args| {
+                with_strbuf("strbuf_clear", &args[0], |builder| {
+                    builder.text.borrow_mut().clear();
+                    Ok(args[0].clone())
+                })
+            }))),
+        );
+        globals.borrow_mut().define(
+            "strbuf_build".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("strbuf_build", 1, |args| {
+                with_strbuf("strbuf_build", &args[0], |builder| {
+                    Ok(Value::String(builder.text.borrow().as_str().into()))
+                })
+            }))),
+        );
 
-        // clamp - constrain a value between min and max
+        // mat_* - dense matrices; any matrix argument can also be a list of rows
         globals.borrow_mut().define(
-            "clamp".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("clamp", 3, |args| {
-                match (&args[0], &args[1], &args[2]) {
-                    (Value::Integer(n), Value::Integer(min), Value::Integer(max)) => {
-                        Ok(Value::Integer((*n).max(*min).min(*max)))
+            "mat_from_rows".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("mat_from_rows", 1, |args| {
+                if let Value::NativeObject(obj) = &args[0] {
+                    if obj.as_any().is::<Matrix>() {
+                        return Ok(args[0].clone());
                     }
-                    (Value::Float(n), Value::Float(min), Value::Float(max)) => {
-                        Ok(Value::Float(n.max(*min).min(*max)))
-                    }
-                    _ => Err("clamp() needs three numbers o' the same type".to_string()),
                 }
+                with_matrix("mat_from_rows", &args[0], |m| {
+                    let data = m.data.borrow().clone();
+                    Ok(Matrix::new(m.rows, m.cols, m.ints.get(), data).value())
+                })
             }))),
         );
-
-        // lerp - linear interpolation between two values
         globals.borrow_mut().define(
-            "lerp".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("lerp", 3, |args| {
-                let a = match &args[0] {
-                    Value::Float(f) => *f,
-                    Value::Integer(n) => *n as f64,
-                    _ => return Err("lerp() needs numbers".to_string()),
-                };
-                let b = match &args[1] {
-                    Value::Float(f) => *f,
-                    Value::Integer(n) => *n as f64,
-                    _ => return Err("lerp() needs numbers".to_string()),
-                };
-                let t = match &args[2] {
-                    Value::Float(f) => *f,
-                    Value::Integer(n) => *n as f64,
-                    _ => return Err("lerp() needs numbers".to_string()),
-                };
-                Ok(Value::Float(a + (b - a) * t))
+            "mat_tae_rows".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("mat_tae_rows", 1, |args| {
+                with_matrix("mat_tae_rows", &args[0], |m| {
+                    let data = m.data.borrow();
+                    let rows = (0..m.rows)
+                        .map(|i| {
+                            let row = data[i * m.cols..(i + 1) * m.cols]
+                                .iter()
+                                .map(|&x| m.entry(x))
+                                .collect();
+                            Value::List(Rc::new(RefCell::new(row)))
+                        })
+                        .collect();
+                    Ok(Value::List(Rc::new(RefCell::new(rows))))
+                })
+            }))),
+        );
+        globals.borrow_mut().define(
+            "mat_new".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("mat_new", 3, |args| {
+                let rows = args[0]
+                    .as_integer()
+                    .ok_or("mat_new() needs integer sizes")?;
+                let cols = args[1]
+                    .as_integer()
+                    .ok_or("mat_new() needs integer sizes")?;
+                let fill = matrix_number("mat_new", &args[2])?;
+                let (rows, cols) = (rows.max(0) as usize, cols.max(0) as usize);
+                let ints = matches!(args[2], Value::Integer(_));
+                Ok(Matrix::new(rows, cols, ints, vec![fill; rows * cols]).value())
+            }))),
+        );
+        globals.borrow_mut().define(
+            "mat_identity".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("mat_identity", 1, |args| {
+                let n = args[0]
+                    .as_integer()
+                    .ok_or("mat_identity() needs an integer size")?
+                    .max(0) as usize;
+                let mut data = vec![0.0; n * n];
+                for i in 0..n {
+                    data[i * n + i] = 1.0;
+                }
+                Ok(Matrix::new(n, n, true, data).value())
+            }))),
+        );
+        globals.borrow_mut().define(
+            "mat_shape".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("mat_shape", 1, |args| {
+                with_matrix("mat_shape", &args[0], |m| {
+                    let shape = vec![Value::Integer(m.rows as i64), Value::Integer(m.cols as i64)];
+                    Ok(Value::List(Rc::new(RefCell::new(shape))))
+                })
             }))),
         );
-
-        // gcd - greatest common divisor
+        fn matrix_cell(name: &str, m: &Matrix, row: &Value, col: &Value) -> Result<usize, String> {
+            let r = row
+                .as_integer()
+                .ok_or_else(|| format!("{}() needs integer indices", name))?;
+            let c = col
+                .as_integer()
+                .ok_or_else(|| format!("{}() needs integer indices", name))?;
+            if r < 0 || r as usize >= m.rows || c < 0 || c as usize >= m.cols {
+                return Err(format!(
+                    "{}: [{}, {}] is ootside a {}x{} matrix",
+                    name, r, c, m.rows, m.cols
+                ));
+            }
+            Ok(r as usize * m.cols + c as usize)
+        }
         globals.borrow_mut().define(
-            "gcd".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("gcd", 2, |args| {
-                fn gcd_calc(a: i64, b: i64) -> i64 {
-                    if b == 0 {
-                        a.abs()
-                    } else {
-                        gcd_calc(b, a % b)
-                    }
+            "mat_get".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("mat_get", 3, |args| {
+                with_matrix("mat_get", &args[0], |m| {
+                    let at = matrix_cell("mat_get", m, &args[1], &args[2])?;
+                    let x = m.data.borrow()[at];
+                    Ok(m.entry(x))
+                })
+            }))),
+        );
+        globals.borrow_mut().define(
+            "mat_set".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("mat_set", 4, |args| {
+                let m = match &args[0] {
+                    Value::NativeObject(obj) => obj.as_any().downcast_ref::<Matrix>(),
+                    _ => None,
                 }
-                match (&args[0], &args[1]) {
-                    (Value::Integer(a), Value::Integer(b)) => Ok(Value::Integer(gcd_calc(*a, *b))),
-                    _ => Err("gcd() needs two integers".to_string()),
+                .ok_or("mat_set() needs a matrix")?;
+                let x = matrix_number("mat_set", &args[3])?;
+                let at = matrix_cell("mat_set", m, &args[1], &args[2])?;
+                m.data.borrow_mut()[at] = x;
+                if matches!(args[3], Value::Float(_)) {
+                    m.ints.set(false);
                 }
+                Ok(Value::Nil)
             }))),
         );
-
-        // lcm - least common multiple
+        // mat_add / mat_sub - entry by entry, on matrices of the same shape
+        for (name, sign) in [("mat_add", 1.0), ("mat_sub", -1.0)] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, 2, move |args| {
+                    with_matrix(name, &args[0], |a| {
+                        with_matrix(name, &args[1], |b| {
+                            if a.rows != b.rows || a.cols != b.cols {
+                                return Err(format!("{}: needs matrices o' the same shape", name));
+                            }
+                            let data = a
+                                .data
+                                .borrow()
+                                .iter()
+                                .zip(b.data.borrow().iter())
+                                .map(|(&x, &y)| x + sign * y)
+                                .collect();
+                            let ints = a.ints.get() && b.ints.get();
+                            Ok(Matrix::new(a.rows, a.cols, ints, data).value())
+                        })
+                    })
+                }))),
+            );
+        }
         globals.borrow_mut().define(
-            "lcm".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("lcm", 2, |args| {
-                fn gcd_calc(a: i64, b: i64) -> i64 {
-                    if b == 0 {
-                        a.abs()
-                    } else {
-                        gcd_calc(b, a % b)
-                    }
-                }
-                match (&args[0], &args[1]) {
-                    (Value::Integer(a), Value::Integer(b)) => {
-                        if *a == 0 || *b == 0 {
-                            Ok(Value::Integer(0))
-                        } else {
-                            Ok(Value::Integer((*a * *b).abs() / gcd_calc(*a, *b)))
+            "mat_scale".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("mat_scale", 2, |args| {
+                let k = matrix_number("mat_scale", &args[1])?;
+                with_matrix("mat_scale", &args[0], |m| {
+                    let data = m.data.borrow().iter().map(|&x| x * k).collect();
+                    let ints = m.ints.get() && matches!(args[1], Value::Integer(_));
+                    Ok(Matrix::new(m.rows, m.cols, ints, data).value())
+                })
+            }))),
+        );
+        globals.borrow_mut().define(
+            "mat_transpose".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("mat_transpose", 1, |args| {
+                with_matrix("mat_transpose", &args[0], |m| {
+                    let data = m.data.borrow();
+                    let mut out = vec![0.0; m.rows * m.cols];
+                    for i in 0..m.rows {
+                        for j in 0..m.cols {
+                            out[j * m.rows + i] = data[i * m.cols + j];
                         }
                     }
-                    _ => Err("lcm() needs two integers".to_string()),
-                }
+                    Ok(Matrix::new(m.cols, m.rows, m.ints.get(), out).value())
+                })
             }))),
         );
-
-        // factorial - calculate factorial
+        // mat_matmul - the i-k-j loop, so each entry sums its products in k order as the
+        // native blocked kernel does
+        globals.borrow_mut().define(
+            "mat_matmul".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("mat_matmul", 2, |args| {
+                with_matrix("mat_matmul", &args[0], |a| {
+                    with_matrix("mat_matmul", &args[1], |b| {
+                        if a.cols != b.rows {
+                            return Err(format!(
+                                "mat_matmul: a {}x{} matrix cannae multiply a {}x{}",
+                                a.rows, a.cols, b.rows, b.cols
+                            ));
+                        }
+                        let (x, y) = (a.data.borrow(), b.data.borrow());
+                        let (k, n) = (a.cols, b.cols);
+                        let mut out = vec![0.0; a.rows * n];
+                        for i in 0..a.rows {
+                            let row = &mut out[i * n..(i + 1) * n];
+                            for p in 0..k {
+                                let s = x[i * k + p];
+                                for (c, &v) in row.iter_mut().zip(&y[p * n..(p + 1) * n]) {
+                                    *c += s * v;
+                                }
+                            }
+                        }
+                        let ints = a.ints.get() && b.ints.get();
+                        Ok(Matrix::new(a.rows, n, ints, out).value())
+                    })
+                })
+            }))),
+        );
+        // mat_solve(a, b) - x with a * x = b for every column of b, by LU
         globals.borrow_mut().define(
-            "factorial".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "factorial",
-                1,
-                |args| match &args[0] {
-                    Value::Integer(n) => {
-                        if *n < 0 {
+            "mat_solve".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("mat_solve", 2, |args| {
+                with_matrix("mat_solve", &args[0], |a| {
+                    with_matrix("mat_solve", &args[1], |b| {
+                        let n = a.rows;
+                        if a.cols != n {
+                            return Err("mat_solve: needs a square matrix".to_string());
+                        }
+                        if b.rows != n {
                             return Err(
-                                "Cannae calculate factorial o' negative number!".to_string()
+                                "mat_solve: needs as many rows on the right as the matrix has"
+                                    .to_string(),
                             );
                         }
-                        if *n > 20 {
-                            return Err("Factorial too big! Max is 20".to_string());
+                        let mut lu = a.data.borrow().clone();
+                        let mut perm = Vec::new();
+                        if matrix_lu(&mut lu, n, &mut perm) == 0.0 {
+                            return Err("mat_solve: the matrix is singular".to_string());
                         }
-                        let mut result: i64 = 1;
-                        for i in 2..=*n {
-                            result *= i;
+                        let (rhs, k) = (b.data.borrow(), b.cols);
+                        let mut out = vec![0.0; n * k];
+                        for c in 0..k {
+                            // Forward through L (unit diagonal), then back through U
+                            for i in 0..n {
+                                let mut s = rhs[perm[i] * k + c];
+                                for j in 0..i {
+                                    s -= lu[i * n + j] * out[j * k + c];
+                                }
+                                out[i * k + c] = s;
+                            }
+                            for i in (0..n).rev() {
+                                let mut s = out[i * k + c];
+                                for j in i + 1..n {
+                                    s -= lu[i * n + j] * out[j * k + c];
+                                }
+                                out[i * k + c] = s / lu[i * n + i];
+                            }
                         }
-                        Ok(Value::Integer(result))
-                    }
-                    _ => Err("factorial() needs an integer".to_string()),
-                },
-            ))),
+                        Ok(Matrix::new(n, k, false, out).value())
+                    })
+                })
+            }))),
         );
-
-        // is_even - check if number is even
         globals.borrow_mut().define(
-            "is_even".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "is_even",
-                1,
-                |args| match &args[0] {
-                    Value::Integer(n) => Ok(Value::Bool(*n % 2 == 0)),
-                    _ => Err("is_even() needs an integer".to_string()),
-                },
-            ))),
+            "mat_det".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("mat_det", 1, |args| {
+                with_matrix("mat_det", &args[0], |m| {
+                    let n = m.rows;
+                    if m.cols != n {
+                        return Err("mat_det: needs a square matrix".to_string());
+                    }
+                    let mut lu = m.data.borrow().clone();
+                    let mut perm = Vec::new();
+                    let sign = matrix_lu(&mut lu, n, &mut perm);
+                    if sign == 0.0 {
+                        return Ok(Value::Float(0.0));
+                    }
+                    Ok(Value::Float(
+                        (0..n).fold(sign, |det, i| det * lu[i * n + i]),
+                    ))
+                })
+            }))),
         );
 
-        // is_odd - check if number is odd
+        // table_* - the native side of stdlib/table, whose rows are lists of dicts
         globals.borrow_mut().define(
-            "is_odd".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "is_odd",
-                1,
-                |args| match &args[0] {
-                    Value::Integer(n) => Ok(Value::Bool(*n % 2 != 0)),
-                    _ => Err("is_odd() needs an integer".to_string()),
-                },
-            ))),
+            "table_parse_csv".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("table_parse_csv", 1, |args| {
+                let text = args[0]
+                    .as_string()
+                    .ok_or("table_parse_csv() needs a string")?;
+                let mut lines = csv_fields(text).into_iter();
+                let columns: Vec<Value> = lines
+                    .next()
+                    .unwrap_or_default()
+                    .into_iter()
+                    .map(|col| Value::String(col.into()))
+                    .collect();
+                let rows = lines
+                    .map(|fields| {
+                        let mut row = DictValue::with_capacity(columns.len());
+                        for (col, field) in columns.iter().zip(fields) {
+                            row.set(col.clone(), Value::String(field.into()));
+                        }
+                        Value::Dict(Rc::new(RefCell::new(row)))
+                    })
+                    .collect();
+                Ok(Value::List(Rc::new(RefCell::new(vec![
+                    Value::List(Rc::new(RefCell::new(columns))),
+                    Value::List(Rc::new(RefCell::new(rows))),
+                ]))))
+            }))),
         );
-
-        // is_prime - check if number is prime
         globals.borrow_mut().define(
-            "is_prime".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new(
-                "is_prime",
-                1,
-                |args| match &args[0] {
-                    Value::Integer(n) => {
-                        if *n < 2 {
-                            return Ok(Value::Bool(false));
-                        }
-                        if *n == 2 {
-                            return Ok(Value::Bool(true));
-                        }
-                        if *n % 2 == 0 {
-                            return Ok(Value::Bool(false));
-                        }
-                        let sqrt_n = (*n as f64).sqrt() as i64;
-                        for i in (3..=sqrt_n).step_by(2) {
-                            if *n % i == 0 {
-                                return Ok(Value::Bool(false));
+            "table_join".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("table_join", 6, |args| {
+                let left = table_list("table_join", &args[0])?;
+                let left_cols = table_list("table_join", &args[1])?;
+                let right = table_list("table_join", &args[2])?;
+                let right_cols = table_list("table_join", &args[3])?;
+                let on = &args[4];
+                let keep_unmatched = args[5].is_truthy();
+
+                // Hash the right rows' keys once; a hash hit is still checked with ==
+                let right = right.borrow();
+                let keys: Vec<Value> = right
+                    .iter()
+                    .map(|row| table_cell(row, on).unwrap_or(Value::Nil))
+                    .collect();
+                let mut index: HashMap<u64, Vec<usize>> = HashMap::with_capacity(keys.len());
+                for (i, key) in keys.iter().enumerate() {
+                    if !matches!(key, Value::Nil) {
+                        index.entry(key.eq_hash()).or_default().push(i);
+                    }
+                }
+
+                let left_cols = left_cols.borrow();
+                let extra: Vec<Value> = right_cols
+                    .borrow()
+                    .iter()
+                    .filter(|col| *col != on)
+                    .cloned()
+                    .collect();
+                let merged = |row: &Value, other: Option<&Value>| {
+                    let mut dict = DictValue::with_capacity(left_cols.len() + extra.len());
+                    for col in left_cols.iter() {
+                        dict.set(col.clone(), table_cell(row, col).unwrap_or(Value::Nil));
+                    }
+                    for col in &extra {
+                        let cell = other.and_then(|other| table_cell(other, col));
+                        dict.set(col.clone(), cell.unwrap_or(Value::Nil));
+                    }
+                    Value::Dict(Rc::new(RefCell::new(dict)))
+                };
+
+                let left = left.borrow();
+                let mut joined = Vec::with_capacity(left.len());
+                for row in left.iter() {
+                    let key = table_cell(row, on).unwrap_or(Value::Nil);
+                    let mut found = false;
+                    if !matches!(key, Value::Nil) {
+                        for &i in index.get(&key.eq_hash()).into_iter().flatten() {
+                            if keys[i] == key {
+                                joined.push(merged(row, Some(&right[i])));
+                                found = true;
                             }
                         }
-                        Ok(Value::Bool(true))
                     }
-                    _ => Err("is_prime() needs an integer".to_string()),
-                },
-            ))),
+                    if !found && keep_unmatched {
+                        joined.push(merged(row, None));
+                    }
+                }
+                Ok(Value::List(Rc::new(RefCell::new(joined))))
+            }))),
         );
-
-        // ============================================================
-        // ASSERTION FUNCTIONS - Test yer code, ya numpty!
-        // ============================================================
-
-        // assert - throw error if condition is false
         globals.borrow_mut().define(
-            "assert".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("assert", 2, |args| {
-                let condition = args[0].is_truthy();
-                if !condition {
-                    let msg = match &args[1] {
-                        Value::String(s) => s.clone(),
-                        _ => format!("{}", args[1]),
+            "table_group".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("table_group", 2, |args| {
+                let rows = table_list("table_group", &args[0])?;
+                let mut groups = DictValue::new();
+                for row in rows.borrow().iter() {
+                    let key = match table_cell(row, &args[1]) {
+                        Some(value) => Value::String(format!("{}", value).into()),
+                        None => Value::String("naething".into()),
                     };
-                    Err(format!("Assertion failed: {}", msg))
-                } else {
-                    Ok(Value::Bool(true))
+                    if let Some(Value::List(group)) = groups.get(&key) {
+                        group.borrow_mut().push(row.clone());
+                        continue;
+                    }
+                    groups.set(key, Value::List(Rc::new(RefCell::new(vec![row.clone()]))));
                 }
+                Ok(Value::Dict(Rc::new(RefCell::new(groups))))
             }))),
         );
-
-        // assert_equal - throw error if values are not equal
         globals.borrow_mut().define(
-            "assert_equal".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("assert_equal", 2, |args| {
-                if args[0] == args[1] {
-                    Ok(Value::Bool(true))
-                } else {
-                    Err(format!(
-                        "Assertion failed: expected {} but got {}",
-                        args[0], args[1]
-                    ))
+            "table_widths".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("table_widths", 2, |args| {
+                let rows = table_list("table_widths", &args[0])?;
+                let columns = table_list("table_widths", &args[1])?;
+                let columns = columns.borrow();
+                let mut widths: Vec<i64> = columns.iter().map(table_cell_width).collect();
+                for row in rows.borrow().iter() {
+                    let Some(row) = row.as_dict() else {
+                        continue;
+                    };
+                    let row = row.borrow();
+                    for (width, col) in widths.iter_mut().zip(columns.iter()) {
+                        if let Some(value) = row.get(col) {
+                            *width = (*width).max(table_cell_width(value));
+                        }
+                    }
+                }
+                let mut out = DictValue::with_capacity(columns.len());
+                for (col, width) in columns.iter().zip(widths) {
+                    out.set(col.clone(), Value::Integer(width));
                 }
+                Ok(Value::Dict(Rc::new(RefCell::new(out))))
             }))),
         );
 
-        // assert_nae_equal - throw error if values are equal
+        // list_with_capacity - an empty list with room for n items
         globals.borrow_mut().define(
-            "assert_nae_equal".to_string(),
+            "list_with_capacity".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new(
-                "assert_nae_equal",
-                2,
+                "list_with_capacity",
+                1,
                 |args| {
-                    if args[0] != args[1] {
-                        Ok(Value::Bool(true))
-                    } else {
-                        Err(format!(
-                            "Assertion failed: {} should not equal {}",
-                            args[0], args[1]
-                        ))
-                    }
+                    let n = args[0]
+                        .as_integer()
+                        .ok_or("list_with_capacity() expects an integer")?;
+                    Ok(Value::List(Rc::new(RefCell::new(Vec::with_capacity(
+                        n.max(0) as usize,
+                    )))))
                 },
             ))),
         );
 
-        // ============================================================
-        // LIST STATISTICS - Fer number-crunchin'!
-        // ============================================================
+        // reserve - make room for n more items so the next n shoves never grow the list
+        globals.borrow_mut().define(
+            "reserve".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("reserve", 2, |args| {
+                let Value::List(list) = &args[0] else {
+                    return Err("reserve() expects a list as first argument".to_string());
+                };
+                let n = args[1]
+                    .as_integer()
+                    .ok_or("reserve() expects an integer count")?;
+                list.borrow_mut().reserve(n.max(0) as usize);
+                Ok(args[0].clone())
+            }))),
+        );
 
-        // average - calculate average of a list of numbers (Scots: mean)
+        // list_extend - append every item of another list in place
         globals.borrow_mut().define(
-            "average".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("average", 1, |args| {
-                if let Value::List(list) = &args[0] {
-                    let items = list.borrow();
-                    if items.is_empty() {
-                        return Err("Cannae calculate average o' empty list!".to_string());
-                    }
-                    let mut sum: f64 = 0.0;
-                    for item in items.iter() {
-                        match item {
-                            Value::Integer(n) => sum += *n as f64,
-                            Value::Float(f) => sum += *f,
-                            _ => return Err("average() needs a list o' numbers".to_string()),
-                        }
-                    }
-                    Ok(Value::Float(sum / items.len() as f64))
-                } else {
-                    Err("average() needs a list".to_string())
-                }
+            "list_extend".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("list_extend", 2, |args| {
+                let (Value::List(list), Value::List(other)) = (&args[0], &args[1]) else {
+                    return Err("list_extend() expects two lists".to_string());
+                };
+                let items = other.borrow().clone();
+                list.borrow_mut().extend(items);
+                Ok(args[0].clone())
+            }))),
+        );
+
+        // list_concat - a new list with a's items then b's
+        globals.borrow_mut().define(
+            "list_concat".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("list_concat", 2, |args| {
+                let (Value::List(a), Value::List(b)) = (&args[0], &args[1]) else {
+                    return Err("list_concat() expects two lists".to_string());
+                };
+                let (a, b) = (a.borrow(), b.borrow());
+                let mut items = Vec::with_capacity(a.len() + b.len());
+                items.extend_from_slice(&a);
+                items.extend_from_slice(&b);
+                Ok(Value::List(Rc::new(RefCell::new(items))))
+            }))),
+        );
+
+        // median - calculate median of a list of numbers
+        globals.borrow_mut().define(
+            "median".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("median", 1, |args| {
+                let mut samples = numeric_samples("median", &args[0])?;
+                Ok(Value::Float(percentile_of(&mut samples, 50.0)))
+            }))),
+        );
+
+        // percentile - the pth percentile (0 to 100) of a list of numbers
+        globals.borrow_mut().define(
+            "percentile".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("percentile", 2, |args| {
+                let p = percentile_arg("percentile", &args[1])?;
+                let mut samples = numeric_samples("percentile", &args[0])?;
+                Ok(Value::Float(percentile_of(&mut samples, p)))
             }))),
         );
 
-        // median - calculate median of a list of numbers
+        // stats - count, mean, stddev, min, max and the 50th/95th/99th percentiles at once
         globals.borrow_mut().define(
-            "median".to_string(),
-            Value::NativeFunction(Rc::new(NativeFunction::new("median", 1, |args| {
-                if let Value::List(list) = &args[0] {
-                    let items = list.borrow();
-                    if items.is_empty() {
-                        return Err("Cannae calculate median o' empty list!".to_string());
-                    }
-                    let mut nums: Vec<f64> = Vec::new();
-                    for item in items.iter() {
-                        match item {
-                            Value::Integer(n) => nums.push(*n as f64),
-                            Value::Float(f) => {
-                                if f.is_nan() {
-                                    return Err("median() cannae handle NaN".to_string());
-                                }
-                                nums.push(*f);
-                            }
-                            _ => return Err("median() needs a list o' numbers".to_string()),
-                        }
-                    }
-                    nums.sort_by(|a, b| a.partial_cmp(b).unwrap());
-                    let mid = nums.len() / 2;
-                    if nums.len().is_multiple_of(2) {
-                        Ok(Value::Float((nums[mid - 1] + nums[mid]) / 2.0))
-                    } else {
-                        Ok(Value::Float(nums[mid]))
-                    }
-                } else {
-                    Err("median() needs a list".to_string())
+            "stats".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("stats", 1, |args| {
+                let mut samples = numeric_samples("stats", &args[0])?;
+                let count = samples.len();
+                let mean = samples.iter().sum::<f64>() / count as f64;
+                let variance =
+                    samples.iter().map(|x| (x - mean) * (x - mean)).sum::<f64>() / count as f64;
+                // A list of ints keeps its min and max as ints
+                let ints: Option<Vec<i64>> = match &args[0] {
+                    Value::List(list) => list
+                        .borrow()
+                        .iter()
+                        .map(|item| match item {
+                            Value::Integer(n) => Some(*n),
+                            _ => None,
+                        })
+                        .collect(),
+                    _ => None,
+                };
+                let (min, max) = match ints {
+                    Some(ints) => (
+                        Value::Integer(ints.iter().copied().min().unwrap_or_default()),
+                        Value::Integer(ints.iter().copied().max().unwrap_or_default()),
+                    ),
+                    None => (
+                        Value::Float(samples.iter().copied().fold(f64::INFINITY, f64::min)),
+                        Value::Float(samples.iter().copied().fold(f64::NEG_INFINITY, f64::max)),
+                    ),
+                };
+                let mut dict = DictValue::new();
+                dict.set(Value::String("count".into()), Value::Integer(count as i64));
+                dict.set(Value::String("mean".into()), Value::Float(mean));
+                dict.set(
+                    Value::String("stddev".into()),
+                    Value::Float(variance.sqrt()),
+                );
+                dict.set(Value::String("min".into()), min);
+                dict.set(Value::String("max".into()), max);
+                // Three O(n) quickselects, each starting from the order the last one left
+                for (key, p) in [("p50", 50.0), ("p95", 95.0), ("p99", 99.0)] {
+                    let value = Value::Float(percentile_of(&mut samples, p));
+                    dict.set(Value::String(key.into()), value);
                 }
+                Ok(Value::Dict(Rc::new(RefCell::new(dict))))
             }))),
         );
 
@@ -8915,12 +14966,12 @@ impl Interpreter {
                 };
                 let content = match &args[1] {
                     Value::String(s) => s.clone(),
-                    v => format!("{}", v),
+                    v => format!("{}", v).into(),
                 };
                 let mut file = OpenOptions::new()
                     .create(true)
                     .append(true)
-                    .open(&path)
+                    .open(&*path)
                     .map_err(|e| format!("Couldnae open '{}' fer appendin': {}", path, e))?;
                 file.write_all(content.as_bytes())
                     .map_err(|e| format!("Couldnae append tae '{}': {}", path, e))?;
@@ -8936,7 +14987,7 @@ impl Interpreter {
                     Value::String(s) => s.clone(),
                     _ => return Err("file_delete() needs a file path string".to_string()),
                 };
-                std::fs::remove_file(&path)
+                std::fs::remove_file(&*path)
                     .map_err(|e| format!("Couldnae delete '{}': {}", path, e))?;
                 Ok(Value::Nil)
             }))),
@@ -8950,11 +15001,11 @@ impl Interpreter {
                     Value::String(s) => s.clone(),
                     _ => return Err("list_dir() needs a directory path string".to_string()),
                 };
-                let entries = std::fs::read_dir(&path)
+                let entries = std::fs::read_dir(&*path)
                     .map_err(|e| format!("Couldnae read directory '{}': {}", path, e))?;
                 let files: Vec<Value> = entries
                     .filter_map(|e| e.ok())
-                    .map(|e| Value::String(e.file_name().to_string_lossy().to_string()))
+                    .map(|e| Value::String(e.file_name().to_string_lossy().into()))
                     .collect();
                 Ok(Value::List(Rc::new(RefCell::new(files))))
             }))),
@@ -8968,7 +15019,7 @@ impl Interpreter {
                     Value::String(s) => s.clone(),
                     _ => return Err("make_dir() needs a directory path string".to_string()),
                 };
-                std::fs::create_dir_all(&path)
+                std::fs::create_dir_all(&*path)
                     .map_err(|e| format!("Couldnae create directory '{}': {}", path, e))?;
                 Ok(Value::Nil)
             }))),
@@ -8982,7 +15033,7 @@ impl Interpreter {
                     Value::String(s) => s.clone(),
                     _ => return Err("is_dir() needs a path string".to_string()),
                 };
-                Ok(Value::Bool(std::path::Path::new(&path).is_dir()))
+                Ok(Value::Bool(std::path::Path::new(&*path).is_dir()))
             }))),
         );
 
@@ -8994,7 +15045,7 @@ impl Interpreter {
                     Value::String(s) => s.clone(),
                     _ => return Err("file_size() needs a file path string".to_string()),
                 };
-                let metadata = std::fs::metadata(&path)
+                let metadata = std::fs::metadata(&*path)
                     .map_err(|e| format!("Couldnae get file info fer '{}': {}", path, e))?;
                 Ok(Value::Integer(metadata.len() as i64))
             }))),
@@ -9012,8 +15063,8 @@ impl Interpreter {
                     Value::String(s) => s.clone(),
                     _ => return Err("path_join() needs strings".to_string()),
                 };
-                let joined = std::path::Path::new(&path1).join(&path2);
-                Ok(Value::String(joined.to_string_lossy().to_string()))
+                let joined = std::path::Path::new(&*path1).join(&*path2);
+                Ok(Value::String(joined.to_string_lossy().into()))
             }))),
         );
 
@@ -9026,7 +15077,7 @@ impl Interpreter {
             "trim".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new("trim", 1, |args| {
                 if let Value::String(s) = &args[0] {
-                    Ok(Value::String(s.trim().to_string()))
+                    Ok(Value::String(s.trim().into()))
                 } else {
                     Err("trim() needs a string".to_string())
                 }
@@ -9038,7 +15089,7 @@ impl Interpreter {
             "trim_start".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new("trim_start", 1, |args| {
                 if let Value::String(s) = &args[0] {
-                    Ok(Value::String(s.trim_start().to_string()))
+                    Ok(Value::String(s.trim_start().into()))
                 } else {
                     Err("trim_start() needs a string".to_string())
                 }
@@ -9050,7 +15101,7 @@ impl Interpreter {
             "trim_end".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new("trim_end", 1, |args| {
                 if let Value::String(s) = &args[0] {
-                    Ok(Value::String(s.trim_end().to_string()))
+                    Ok(Value::String(s.trim_end().into()))
                 } else {
                     Err("trim_end() needs a string".to_string())
                 }
@@ -9065,7 +15116,7 @@ impl Interpreter {
                 2,
                 |args| match (&args[0], &args[1]) {
                     (Value::String(s), Value::String(prefix)) => {
-                        Ok(Value::Bool(s.starts_with(prefix.as_str())))
+                        Ok(Value::Bool(s.starts_with(prefix.as_ref())))
                     }
                     _ => Err("starts_with() needs two strings".to_string()),
                 },
@@ -9079,7 +15130,7 @@ impl Interpreter {
                 &args[0], &args[1],
             ) {
                 (Value::String(s), Value::String(suffix)) => {
-                    Ok(Value::Bool(s.ends_with(suffix.as_str())))
+                    Ok(Value::Bool(s.ends_with(suffix.as_ref())))
                 }
                 _ => Err("ends_with() needs two strings".to_string()),
             }))),
@@ -9093,7 +15144,7 @@ impl Interpreter {
                 2,
                 |args| match (&args[0], &args[1]) {
                     (Value::String(s), Value::String(needle)) => Ok(Value::Integer(
-                        s.rfind(needle.as_str()).map(|i| i as i64).unwrap_or(-1),
+                        s.rfind(needle.as_ref()).map(|i| i as i64).unwrap_or(-1),
                     )),
                     _ => Err("last_index_of() needs two strings".to_string()),
                 },
@@ -9118,7 +15169,9 @@ impl Interpreter {
                 let chars: Vec<char> = s.chars().collect();
                 let start = start.min(chars.len());
                 let end = end.min(chars.len());
-                Ok(Value::String(chars[start..end].iter().collect()))
+                Ok(Value::String(
+                    chars[start..end].iter().collect::<String>().into(),
+                ))
             }))),
         );
 
@@ -9157,14 +15210,54 @@ impl Interpreter {
         globals.borrow_mut().define(
             "random".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new("random", 0, |_args| {
-                use std::time::{SystemTime, UNIX_EPOCH};
-                let seed = SystemTime::now()
-                    .duration_since(UNIX_EPOCH)
-                    .unwrap()
-                    .as_nanos() as u64;
-                let rng = seed.wrapping_mul(1103515245).wrapping_add(12345);
-                let random_float = (rng as f64) / (u64::MAX as f64);
-                Ok(Value::Float(random_float))
+                Ok(Value::Float(rng_float()))
+            }))),
+        );
+
+        // seed - reseed this thread's generator so the draws that follow repeat
+        globals.borrow_mut().define(
+            "seed".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("seed", 1, |args| {
+                match &args[0] {
+                    Value::Integer(n) => {
+                        rng_seed(*n as u64);
+                        Ok(Value::Nil)
+                    }
+                    _ => Err("seed() needs an integer".to_string()),
+                }
+            }))),
+        );
+
+        // random_list - n draws at once: whole numbers in [lo, hi], or floats in [lo, hi)
+        // when either bound is a float
+        globals.borrow_mut().define(
+            "random_list".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("random_list", 3, |args| {
+                let n = match args[0] {
+                    Value::Integer(n) if (0..=i32::MAX as i64).contains(&n) => n as usize,
+                    _ => return Err("random_list() needs a count fae 0 tae 2147483647".into()),
+                };
+                let items: Vec<Value> = match (&args[1], &args[2]) {
+                    (Value::Integer(lo), Value::Integer(hi)) => {
+                        if lo > hi {
+                            return Err("random_list() min must be <= max".to_string());
+                        }
+                        (0..n).map(|_| Value::Integer(rng_range(*lo, *hi))).collect()
+                    }
+                    (lo, hi) => {
+                        let (lo, hi) = match (lo.as_float(), hi.as_float()) {
+                            (Some(lo), Some(hi)) => (lo, hi),
+                            _ => return Err("random_list() needs number bounds".to_string()),
+                        };
+                        if lo > hi {
+                            return Err("random_list() min must be <= max".to_string());
+                        }
+                        (0..n)
+                            .map(|_| Value::Float(lo + rng_float() * (hi - lo)))
+                            .collect()
+                    }
+                };
+                Ok(Value::List(Rc::new(RefCell::new(items))))
             }))),
         );
 
@@ -9172,7 +15265,6 @@ impl Interpreter {
         globals.borrow_mut().define(
             "random_int".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new("random_int", 2, |args| {
-                use std::time::{SystemTime, UNIX_EPOCH};
                 let min = args[0]
                     .as_integer()
                     .ok_or("random_int() needs integer bounds")?;
@@ -9182,14 +15274,7 @@ impl Interpreter {
                 if min > max {
                     return Err("random_int() min must be <= max".to_string());
                 }
-                let seed = SystemTime::now()
-                    .duration_since(UNIX_EPOCH)
-                    .unwrap()
-                    .as_nanos() as u64;
-                let rng = seed.wrapping_mul(1103515245).wrapping_add(12345);
-                let range = (max - min + 1) as u64;
-                let result = min + ((rng % range) as i64);
-                Ok(Value::Integer(result))
+                Ok(Value::Integer(rng_range(min, max)))
             }))),
         );
 
@@ -9197,18 +15282,12 @@ impl Interpreter {
         globals.borrow_mut().define(
             "random_choice".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new("random_choice", 1, |args| {
-                use std::time::{SystemTime, UNIX_EPOCH};
                 if let Value::List(list) = &args[0] {
                     let items = list.borrow();
                     if items.is_empty() {
                         return Ok(Value::Nil);
                     }
-                    let seed = SystemTime::now()
-                        .duration_since(UNIX_EPOCH)
-                        .unwrap()
-                        .as_nanos() as u64;
-                    let rng = seed.wrapping_mul(1103515245).wrapping_add(12345);
-                    let idx = (rng as usize) % items.len();
+                    let idx = rng_below(items.len() as u64) as usize;
                     Ok(items[idx].clone())
                 } else {
                     Err("random_choice() needs a list".to_string())
@@ -9278,39 +15357,60 @@ impl Interpreter {
             Value::NativeFunction(Rc::new(NativeFunction::new("date_now", 0, |_args| {
                 use chrono::{Datelike, Local, Timelike};
                 let now = Local::now();
-                let mut dict = DictValue::new();
+                let mut dict = DictValue::with_capacity(7);
                 dict.set(
-                    Value::String("year".to_string()),
+                    Value::String("year".into()),
                     Value::Integer(now.year() as i64),
                 );
                 dict.set(
-                    Value::String("month".to_string()),
+                    Value::String("month".into()),
                     Value::Integer(now.month() as i64),
                 );
                 dict.set(
-                    Value::String("day".to_string()),
+                    Value::String("day".into()),
                     Value::Integer(now.day() as i64),
                 );
                 dict.set(
-                    Value::String("hour".to_string()),
+                    Value::String("hour".into()),
                     Value::Integer(now.hour() as i64),
                 );
                 dict.set(
-                    Value::String("minute".to_string()),
+                    Value::String("minute".into()),
                     Value::Integer(now.minute() as i64),
                 );
                 dict.set(
-                    Value::String("second".to_string()),
+                    Value::String("second".into()),
                     Value::Integer(now.second() as i64),
                 );
                 dict.set(
-                    Value::String("weekday".to_string()),
+                    Value::String("weekday".into()),
                     Value::Integer(now.weekday().num_days_from_monday() as i64),
                 );
                 Ok(Value::Dict(Rc::new(RefCell::new(dict))))
             }))),
         );
 
+        // date_now_ts - seconds since the epoch, without breaking them down
+        globals.borrow_mut().define(
+            "date_now_ts".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("date_now_ts", 0, |_args| {
+                Ok(Value::Integer(chrono::Utc::now().timestamp()))
+            }))),
+        );
+
+        // date_fields - a timestamp (or now, for nil) in local time, as a date object
+        globals.borrow_mut().define(
+            "date_fields".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("date_fields", 1, |args| {
+                let ts = match &args[0] {
+                    Value::Integer(n) => *n,
+                    Value::Nil => chrono::Utc::now().timestamp(),
+                    _ => return Err("date_fields() needs a timestamp or naething".to_string()),
+                };
+                Ok(Value::NativeObject(Rc::new(DateFields::local(ts)?)))
+            }))),
+        );
+
         // date_format - format timestamp
         globals.borrow_mut().define(
             "date_format".to_string(),
@@ -9327,7 +15427,7 @@ impl Interpreter {
                     .timestamp_opt(timestamp_secs, 0)
                     .single()
                     .ok_or("Invalid timestamp")?;
-                Ok(Value::String(dt.format(&format).to_string()))
+                Ok(Value::String(dt.format(&format).to_string().into()))
             }))),
         );
 
@@ -9365,7 +15465,7 @@ impl Interpreter {
                     .timestamp_opt(timestamp_secs, 0)
                     .single()
                     .ok_or("Invalid timestamp")?;
-                let new_dt = match unit.as_str() {
+                let new_dt = match unit.as_ref() {
                     "seconds" => dt + Duration::seconds(amount),
                     "minutes" => dt + Duration::minutes(amount),
                     "hours" => dt + Duration::hours(amount),
@@ -9388,7 +15488,7 @@ impl Interpreter {
                     _ => return Err("date_diff() needs a unit string".to_string()),
                 };
                 let diff_secs = ts2 - ts1;
-                let result = match unit.as_str() {
+                let result = match unit.as_ref() {
                     "milliseconds" => diff_secs * 1000,
                     "seconds" => diff_secs,
                     "minutes" => diff_secs / 60,
@@ -9439,17 +15539,11 @@ impl Interpreter {
         globals.borrow_mut().define(
             "regex_test".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new("regex_test", 2, |args| {
-                use regex::Regex;
                 let text = match &args[0] {
                     Value::String(s) => s.clone(),
                     _ => return Err("regex_test() needs a string".to_string()),
                 };
-                let pattern = match &args[1] {
-                    Value::String(s) => s.clone(),
-                    _ => return Err("regex_test() needs a pattern string".to_string()),
-                };
-                let re = Regex::new(&pattern)
-                    .map_err(|e| format!("Invalid regex '{}': {}", pattern, e))?;
+                let re = regex_arg("regex_test", &args[1])?;
                 Ok(Value::Bool(re.is_match(&text)))
             }))),
         );
@@ -9458,31 +15552,22 @@ impl Interpreter {
         globals.borrow_mut().define(
             "regex_match".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new("regex_match", 2, |args| {
-                use regex::Regex;
                 let text = match &args[0] {
                     Value::String(s) => s.clone(),
                     _ => return Err("regex_match() needs a string".to_string()),
                 };
-                let pattern = match &args[1] {
-                    Value::String(s) => s.clone(),
-                    _ => return Err("regex_match() needs a pattern string".to_string()),
-                };
-                let re = Regex::new(&pattern)
-                    .map_err(|e| format!("Invalid regex '{}': {}", pattern, e))?;
+                let re = regex_arg("regex_match", &args[1])?;
                 if let Some(m) = re.find(&text) {
                     let mut dict = DictValue::new();
                     dict.set(
-                        Value::String("match".to_string()),
-                        Value::String(m.as_str().to_string()),
+                        Value::String("match".into()),
+                        Value::String(m.as_str().into()),
                     );
                     dict.set(
-                        Value::String("start".to_string()),
+                        Value::String("start".into()),
                         Value::Integer(m.start() as i64),
                     );
-                    dict.set(
-                        Value::String("end".to_string()),
-                        Value::Integer(m.end() as i64),
-                    );
+                    dict.set(Value::String("end".into()), Value::Integer(m.end() as i64));
                     Ok(Value::Dict(Rc::new(RefCell::new(dict))))
                 } else {
                     Ok(Value::Nil)
@@ -9494,33 +15579,24 @@ impl Interpreter {
         globals.borrow_mut().define(
             "regex_match_all".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new("regex_match_all", 2, |args| {
-                use regex::Regex;
                 let text = match &args[0] {
                     Value::String(s) => s.clone(),
                     _ => return Err("regex_match_all() needs a string".to_string()),
                 };
-                let pattern = match &args[1] {
-                    Value::String(s) => s.clone(),
-                    _ => return Err("regex_match_all() needs a pattern string".to_string()),
-                };
-                let re = Regex::new(&pattern)
-                    .map_err(|e| format!("Invalid regex '{}': {}", pattern, e))?;
+                let re = regex_arg("regex_match_all", &args[1])?;
                 let matches: Vec<Value> = re
                     .find_iter(&text)
                     .map(|m| {
                         let mut dict = DictValue::new();
                         dict.set(
-                            Value::String("match".to_string()),
-                            Value::String(m.as_str().to_string()),
+                            Value::String("match".into()),
+                            Value::String(m.as_str().into()),
                         );
                         dict.set(
-                            Value::String("start".to_string()),
+                            Value::String("start".into()),
                             Value::Integer(m.start() as i64),
                         );
-                        dict.set(
-                            Value::String("end".to_string()),
-                            Value::Integer(m.end() as i64),
-                        );
+                        dict.set(Value::String("end".into()), Value::Integer(m.end() as i64));
                         Value::Dict(Rc::new(RefCell::new(dict)))
                     })
                     .collect();
@@ -9532,23 +15608,17 @@ impl Interpreter {
         globals.borrow_mut().define(
             "regex_replace".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new("regex_replace", 3, |args| {
-                use regex::Regex;
                 let text = match &args[0] {
                     Value::String(s) => s.clone(),
                     _ => return Err("regex_replace() needs a string".to_string()),
                 };
-                let pattern = match &args[1] {
-                    Value::String(s) => s.clone(),
-                    _ => return Err("regex_replace() needs a pattern string".to_string()),
-                };
                 let replacement = match &args[2] {
                     Value::String(s) => s.clone(),
                     _ => return Err("regex_replace() needs a replacement string".to_string()),
                 };
-                let re = Regex::new(&pattern)
-                    .map_err(|e| format!("Invalid regex '{}': {}", pattern, e))?;
+                let re = regex_arg("regex_replace", &args[1])?;
                 Ok(Value::String(
-                    re.replace_all(&text, replacement.as_str()).to_string(),
+                    re.replace_all(&text, replacement.as_ref()).into(),
                 ))
             }))),
         );
@@ -9560,15 +15630,10 @@ impl Interpreter {
                 "regex_replace_first",
                 3,
                 |args| {
-                    use regex::Regex;
                     let text = match &args[0] {
                         Value::String(s) => s.clone(),
                         _ => return Err("regex_replace_first() needs a string".to_string()),
                     };
-                    let pattern = match &args[1] {
-                        Value::String(s) => s.clone(),
-                        _ => return Err("regex_replace_first() needs a pattern string".to_string()),
-                    };
                     let replacement = match &args[2] {
                         Value::String(s) => s.clone(),
                         _ => {
@@ -9577,10 +15642,9 @@ impl Interpreter {
                             )
                         }
                     };
-                    let re = Regex::new(&pattern)
-                        .map_err(|e| format!("Invalid regex '{}': {}", pattern, e))?;
+                    let re = regex_arg("regex_replace_first", &args[1])?;
                     Ok(Value::String(
-                        re.replacen(&text, 1, replacement.as_str()).to_string(),
+                        re.replacen(&text, 1, replacement.as_ref()).into(),
                     ))
                 },
             ))),
@@ -9590,22 +15654,73 @@ impl Interpreter {
         globals.borrow_mut().define(
             "regex_split".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new("regex_split", 2, |args| {
-                use regex::Regex;
                 let text = match &args[0] {
                     Value::String(s) => s.clone(),
                     _ => return Err("regex_split() needs a string".to_string()),
                 };
-                let pattern = match &args[1] {
-                    Value::String(s) => s.clone(),
-                    _ => return Err("regex_split() needs a pattern string".to_string()),
+                let re = regex_arg("regex_split", &args[1])?;
+                let parts: Vec<Value> = re.split(&text).map(|s| Value::String(s.into())).collect();
+                Ok(Value::List(Rc::new(RefCell::new(parts))))
+            }))),
+        );
+
+        // regex_compile - compile a pattern once for reuse by the regex_* builtins
+        globals.borrow_mut().define(
+            "regex_compile".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("regex_compile", 1, |args| {
+                if !matches!(args[0], Value::String(_)) {
+                    return Err("regex_compile() needs a pattern string".to_string());
+                }
+                let re = regex_arg("regex_compile", &args[0])?;
+                Ok(Value::NativeObject(Rc::new(RegexValue { re })))
+            }))),
+        );
+
+        // regex_set_new - compile a list of patterns to match together
+        globals.borrow_mut().define(
+            "regex_set_new".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("regex_set_new", 1, |args| {
+                let Value::List(items) = &args[0] else {
+                    return Err("regex_set_new() needs a list of patterns".to_string());
+                };
+                let mut sources = Vec::new();
+                for item in items.borrow().iter() {
+                    let source = match item {
+                        Value::String(pattern) => Some(pattern.to_string()),
+                        Value::NativeObject(obj) => obj
+                            .as_any()
+                            .downcast_ref::<RegexValue>()
+                            .map(|r| r.re.as_str().to_string()),
+                        _ => None,
+                    };
+                    sources.push(source.ok_or("regex_set_new() needs a list of patterns")?);
+                }
+                let set = regex::RegexSet::new(&sources)
+                    .map_err(|e| format!("Invalid regex set: {}", e))?;
+                Ok(Value::NativeObject(Rc::new(RegexSetValue { set })))
+            }))),
+        );
+
+        // regex_set_match - indices of every pattern in the set that matches
+        globals.borrow_mut().define(
+            "regex_set_match".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("regex_set_match", 2, |args| {
+                let set = match &args[0] {
+                    Value::NativeObject(obj) => obj.as_any().downcast_ref::<RegexSetValue>(),
+                    _ => None,
+                }
+                .ok_or("regex_set_match() needs a regex set")?;
+                let text = match &args[1] {
+                    Value::String(s) => s,
+                    _ => return Err("regex_set_match() needs a string".to_string()),
                 };
-                let re = Regex::new(&pattern)
-                    .map_err(|e| format!("Invalid regex '{}': {}", pattern, e))?;
-                let parts: Vec<Value> = re
-                    .split(&text)
-                    .map(|s| Value::String(s.to_string()))
+                let indices: Vec<Value> = set
+                    .set
+                    .matches(text)
+                    .iter()
+                    .map(|i| Value::Integer(i as i64))
                     .collect();
-                Ok(Value::List(Rc::new(RefCell::new(parts))))
+                Ok(Value::List(Rc::new(RefCell::new(indices))))
             }))),
         );
 
@@ -9621,8 +15736,8 @@ impl Interpreter {
                     Value::String(s) => s.clone(),
                     _ => return Err("env_get() needs a variable name string".to_string()),
                 };
-                match std::env::var(&name) {
-                    Ok(val) => Ok(Value::String(val)),
+                match std::env::var(&*name) {
+                    Ok(val) => Ok(Value::String(val.into())),
                     Err(_) => Ok(Value::Nil),
                 }
             }))),
@@ -9638,9 +15753,9 @@ impl Interpreter {
                 };
                 let value = match &args[1] {
                     Value::String(s) => s.clone(),
-                    v => format!("{}", v),
+                    v => format!("{}", v).into(),
                 };
-                std::env::set_var(&name, &value);
+                std::env::set_var(&*name, &*value);
                 Ok(Value::Nil)
             }))),
         );
@@ -9651,7 +15766,7 @@ impl Interpreter {
             Value::NativeFunction(Rc::new(NativeFunction::new("env_all", 0, |_args| {
                 let mut vars = DictValue::new();
                 for (k, v) in std::env::vars() {
-                    vars.set(Value::String(k), Value::String(v));
+                    vars.set(Value::String(k.into()), Value::String(v.into()));
                 }
                 Ok(Value::Dict(Rc::new(RefCell::new(vars))))
             }))),
@@ -9684,9 +15799,9 @@ impl Interpreter {
                         let stdout = String::from_utf8_lossy(&out.stdout).to_string();
                         let stderr = String::from_utf8_lossy(&out.stderr).to_string();
                         Ok(Value::String(if stdout.is_empty() {
-                            stderr
+                            stderr.into()
                         } else {
-                            stdout
+                            stdout.into()
                         }))
                     }
                     Err(e) => Err(format!("Shell command failed: {}", e)),
@@ -9723,6 +15838,64 @@ impl Interpreter {
             }))),
         );
 
+        // spawn - run a program from an argv list, no shell in the way
+        globals.borrow_mut().define(
+            "spawn".to_string(),
+            Value::NativeFunction(Rc::new(NativeFunction::new("spawn", 1, |args| {
+                use std::process::Command;
+                let argv: Vec<String> = match &args[0] {
+                    Value::List(items) => items
+                        .borrow()
+                        .iter()
+                        .map(|v| match v {
+                            Value::String(s) => s.to_string(),
+                            other => format!("{}", other),
+                        })
+                        .collect(),
+                    _ => return Err("spawn() needs a list o' program and arguments".to_string()),
+                };
+                let Some((program, rest)) = argv.split_first() else {
+                    return Err("spawn() needs at least the program tae run".to_string());
+                };
+                let out = Command::new(program)
+                    .args(rest)
+                    .output()
+                    .map_err(|e| format!("spawn() cannae run '{}': {}", program, e))?;
+                let mut dict = DictValue::new();
+                dict.set(
+                    Value::String("status".into()),
+                    Value::Integer(out.status.code().unwrap_or(-1) as i64),
+                );
+                dict.set(
+                    Value::String("stdout".into()),
+                    Value::String(String::from_utf8_lossy(&out.stdout).into_owned().into()),
+                );
+                dict.set(
+                    Value::String("stderr".into()),
+                    Value::String(String::from_utf8_lossy(&out.stderr).into_owned().into()),
+                );
+                Ok(Value::Dict(Rc::new(RefCell::new(dict))))
+            }))),
+        );
+
+        // process_spawn and friends hand pipe fds and pidfds to an MdhEventLoop; the
+        // interpreter's loop only knows its own socket ids.
+        for (name, arity) in [
+            ("process_spawn", usize::MAX),
+            ("process_read", 2),
+            ("process_write", 2),
+            ("process_watch", 3),
+            ("process_wait", 1),
+            ("process_kill", usize::MAX),
+        ] {
+            globals.borrow_mut().define(
+                name.to_string(),
+                Value::NativeFunction(Rc::new(NativeFunction::new(name, arity, move |_args| {
+                    Err(format!("{}() needs a native build", name))
+                }))),
+            );
+        }
+
         // exit - exit program with code
         // Not safe to exercise under source-based coverage runs.
         #[cfg(not(coverage))]
@@ -9738,7 +15911,9 @@ impl Interpreter {
         globals.borrow_mut().define(
             "args".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new("args", 0, |_args| {
-                let arguments: Vec<Value> = std::env::args().map(Value::String).collect();
+                let arguments: Vec<Value> = std::env::args()
+                    .map(|arg| Value::String(arg.into()))
+                    .collect();
                 Ok(Value::List(Rc::new(RefCell::new(arguments))))
             }))),
         );
@@ -9748,7 +15923,7 @@ impl Interpreter {
             "cwd".to_string(),
             Value::NativeFunction(Rc::new(NativeFunction::new("cwd", 0, |_args| {
                 match std::env::current_dir() {
-                    Ok(path) => Ok(Value::String(path.to_string_lossy().to_string())),
+                    Ok(path) => Ok(Value::String(path.to_string_lossy().into())),
                     Err(e) => Err(format!("Couldnae get current directory: {}", e)),
                 }
             }))),
@@ -9762,7 +15937,7 @@ impl Interpreter {
                     Value::String(s) => s.clone(),
                     _ => return Err("chdir() needs a path string".to_string()),
                 };
-                std::env::set_current_dir(&path)
+                std::env::set_current_dir(&*path)
                     .map_err(|e| format!("Couldnae change tae directory '{}': {}", path, e))?;
                 Ok(Value::Nil)
             }))),
@@ -9774,13 +15949,19 @@ impl Interpreter {
             Value::NativeFunction(Rc::new(NativeFunction::new(
                 "json_stringify_pretty",
                 1,
-                |args| Ok(Value::String(value_to_json_pretty(&args[0], 0))),
+                |args| Ok(Value::String(value_to_json_pretty(&args[0], 0).into())),
             ))),
         );
     }
 
     /// Run a program
     pub fn interpret(&mut self, program: &Program) -> HaversResult<Value> {
+        let result = self.interpret_statements(program);
+        flush_open_files();
+        result
+    }
+
+    fn interpret_statements(&mut self, program: &Program) -> HaversResult<Value> {
         let mut result = Value::Nil;
         for stmt in &program.statements {
             result = self.execute_stmt(stmt)?;
@@ -9856,11 +16037,12 @@ impl Interpreter {
                 name: path.to_string(),
             })?;
 
-        // Parse the module
-        let program = crate::parser::parse(&source).map_err(|e| HaversError::ParseError {
-            message: format!("Error in module '{}': {}", path, e),
-            line: span.line,
-        })?;
+        // Parse the module, or pick up a cached parse from an earlier run
+        let program =
+            crate::parse_cache::parse_cached(&source).map_err(|e| HaversError::ParseError {
+                message: format!("Error in module '{}': {}", path, e),
+                line: span.line,
+            })?;
 
         let _in_progress_guard = ModuleInProgressGuard::new(self, module_path.clone());
 
@@ -9898,7 +16080,7 @@ impl Interpreter {
         if let Some(alias_name) = alias {
             let mut export_dict = DictValue::new();
             for (name, value) in exports {
-                export_dict.set(Value::String(name), value);
+                export_dict.set(Value::String(name.into()), value);
             }
             let module_dict = Value::Dict(Rc::new(RefCell::new(export_dict)));
             self.environment
@@ -10116,12 +16298,36 @@ impl Interpreter {
                     "[line {}] fer (for) loop: {} in ...",
                     span.line, variable
                 ));
-                let iter_value = self.evaluate(iterable)?;
+                let iter_value = match self.fer_range(iterable)? {
+                    Some(range) => Value::Range(range),
+                    None => self.evaluate(iterable)?,
+                };
 
-                let items: Vec<Value> = match iter_value {
-                    Value::Range(range) => range.iter().map(Value::Integer).collect(),
-                    Value::List(list) => list.borrow().clone(),
-                    Value::String(s) => s.chars().map(|c| Value::String(c.to_string())).collect(),
+                // Ranges are counted as the loop goes; lists and strings are snapshotted.
+                let (count, items): (usize, Box<dyn Iterator<Item = Value>>) = match iter_value {
+                    Value::Range(range) => {
+                        (range.len(), Box::new(range.iter().map(Value::Integer)))
+                    }
+                    Value::List(list) => {
+                        let items = list.borrow().clone();
+                        (items.len(), Box::new(items.into_iter()))
+                    }
+                    Value::String(s) => {
+                        let chars: Vec<Value> = s
+                            .chars()
+                            .map(|c| Value::String(c.to_string().into()))
+                            .collect();
+                        (chars.len(), Box::new(chars.into_iter()))
+                    }
+                    Value::NativeObject(obj) => match obj.items() {
+                        Some(items) => (items.len(), Box::new(items.into_iter())),
+                        None => {
+                            return Err(HaversError::TypeError {
+                                message: format!("Cannae iterate ower a {}", obj.type_name()),
+                                line: span.line,
+                            });
+                        }
+                    },
                     _ => {
                         return Err(HaversError::TypeError {
                             message: format!("Cannae iterate ower a {}", iter_value.type_name()),
@@ -10130,7 +16336,7 @@ impl Interpreter {
                     }
                 };
 
-                self.trace_verbose(&format!("→ iteratin' ower {} items", items.len()));
+                self.trace_verbose(&format!("→ iteratin' ower {} items", count));
                 let mut iteration = 0;
                 for item in items {
                     iteration += 1;
@@ -10340,7 +16546,7 @@ impl Interpreter {
                         // Bind the error to the catch variable
                         self.environment
                             .borrow_mut()
-                            .define(error_name.clone(), Value::String(e.to_string()));
+                            .define(error_name.clone(), Value::String(e.to_string().into()));
                         self.execute_stmt_with_control(catch_block)
                     }
                 }
@@ -10415,7 +16621,9 @@ impl Interpreter {
                     Value::List(list) => list.borrow().clone(),
                     Value::String(s) => {
                         // Strings can be destructured intae characters
-                        s.chars().map(|c| Value::String(c.to_string())).collect()
+                        s.chars()
+                            .map(|c| Value::String(c.to_string().into()))
+                            .collect()
                     }
                     _ => {
                         return Err(HaversError::TypeError {
@@ -10512,10 +16720,10 @@ impl Interpreter {
                 let msg = self.evaluate(message)?;
                 let error_msg = match msg {
                     Value::String(s) => s,
-                    v => format!("{}", v),
+                    v => format!("{}", v).into(),
                 };
                 Err(HaversError::UserError {
-                    message: error_msg,
+                    message: error_msg.to_string(),
                     line: span.line,
                 })
             }
@@ -10551,7 +16759,7 @@ impl Interpreter {
                 let lit_val = match lit {
                     Literal::Integer(n) => Value::Integer(*n),
                     Literal::Float(f) => Value::Float(*f),
-                    Literal::String(s) => Value::String(s.clone()),
+                    Literal::String(s) => Value::String(s.as_str().into()),
                     Literal::Bool(b) => Value::Bool(*b),
                     Literal::Nil => Value::Nil,
                 };
@@ -10575,6 +16783,47 @@ impl Interpreter {
         }
     }
 
+    /// The bounds of a `fer` loop over `a..b` or the builtin `range(a, b)`, so the loop can
+    /// count instead of building the list first. A user-defined `range` is left alone.
+    fn fer_range(&mut self, iterable: &Expr) -> HaversResult<Option<RangeValue>> {
+        let (start, end, inclusive) = match iterable {
+            Expr::Range {
+                start,
+                end,
+                inclusive,
+                ..
+            } => (start.as_ref(), end.as_ref(), *inclusive),
+            Expr::Call {
+                callee, arguments, ..
+            } if arguments.len() == 2 => {
+                let Expr::Variable { name, .. } = callee.as_ref() else {
+                    return Ok(None);
+                };
+                let builtin = matches!(
+                    self.environment.borrow().get(name),
+                    Some(Value::NativeFunction(native)) if native.name == "range"
+                );
+                if name != "range" || !builtin {
+                    return Ok(None);
+                }
+                (&arguments[0], &arguments[1], false)
+            }
+            _ => return Ok(None),
+        };
+        let start_val = self.evaluate(start)?;
+        let end_val = self.evaluate(end)?;
+        match (start_val.as_integer(), end_val.as_integer()) {
+            (Some(s), Some(e)) => Ok(Some(RangeValue::new(s, e, inclusive))),
+            _ if matches!(iterable, Expr::Call { .. }) => Err(HaversError::InternalError(
+                "range() expects integers".to_string(),
+            )),
+            _ => Err(HaversError::TypeError {
+                message: "Range bounds must be integers".to_string(),
+                line: iterable.span().line,
+            }),
+        }
+    }
+
     fn range_to_list(start: i64, end: i64, inclusive: bool) -> Value {
         let mut items = Vec::new();
         if inclusive {
@@ -10598,23 +16847,36 @@ impl Interpreter {
             Expr::Literal { value, .. } => Ok(match value {
                 Literal::Integer(n) => Value::Integer(*n),
                 Literal::Float(f) => Value::Float(*f),
-                Literal::String(s) => Value::String(s.clone()),
+                Literal::String(s) => Value::String(s.as_str().into()),
                 Literal::Bool(b) => Value::Bool(*b),
                 Literal::Nil => Value::Nil,
             }),
 
-            Expr::Variable { name, span } => self
-                .environment
-                .borrow()
-                .get(name)
-                .ok_or_else(|| HaversError::UndefinedVariable {
+            Expr::Variable { name, slot, span } => {
+                let env = self.environment.borrow();
+                let value = match slot {
+                    Some(slot) => env.get_at(*slot, name),
+                    None => env.get(name),
+                };
+                value.ok_or_else(|| HaversError::UndefinedVariable {
                     name: name.clone(),
                     line: span.line,
-                }),
+                })
+            }
 
-            Expr::Assign { name, value, span } => {
+            Expr::Assign {
+                name,
+                value,
+                slot,
+                span,
+            } => {
                 let val = self.evaluate(value)?;
-                if !self.environment.borrow_mut().assign(name, val.clone()) {
+                let mut env = self.environment.borrow_mut();
+                let assigned = match slot {
+                    Some(slot) => env.assign_at(*slot, name, val.clone()),
+                    None => env.assign(name, val.clone()),
+                };
+                if !assigned {
                     return Err(HaversError::UndefinedVariable {
                         name: name.clone(),
                         line: span.line,
@@ -10631,22 +16893,7 @@ impl Interpreter {
             } => {
                 let left_val = self.evaluate(left)?;
                 let right_val = self.evaluate(right)?;
-
-                // Check for operator overloading on instances
-                if let Value::Instance(ref inst) = left_val {
-                    let method_name = self.operator_method_name(operator);
-                    if let Some(method) = inst.borrow().class.find_method(&method_name) {
-                        // Call the overloaded operator method
-                        return self.call_method_on_instance(
-                            inst.clone(),
-                            method,
-                            vec![right_val],
-                            span.line,
-                        );
-                    }
-                }
-
-                self.binary_op(&left_val, operator, &right_val, span.line)
+                self.binary_values(left_val, operator, right_val, span.line)
             }
 
             Expr::Unary {
@@ -10656,17 +16903,7 @@ impl Interpreter {
             } => {
                 let val = self.evaluate(operand)?;
                 match operator {
-                    UnaryOp::Negate => match val {
-                        Value::Integer(n) => n
-                            .checked_neg()
-                            .map(Value::Integer)
-                            .ok_or(HaversError::IntegerOverflow { line: span.line }),
-                        Value::Float(f) => Ok(Value::Float(-f)),
-                        _ => Err(HaversError::TypeError {
-                            message: format!("Cannae negate a {}", val.type_name()),
-                            line: span.line,
-                        }),
-                    },
+                    UnaryOp::Negate => Self::negate_value(val, span.line),
                     UnaryOp::Not => Ok(Value::Bool(!val.is_truthy())),
                 }
             }
@@ -10753,34 +16990,7 @@ impl Interpreter {
                 span,
             } => {
                 let obj = self.evaluate(object)?;
-                match obj {
-                    Value::NativeObject(native) => native
-                        .get(property)
-                        .map_err(|err| err.with_line_if_zero(span.line)),
-                    Value::Instance(inst) => inst
-                        .borrow()
-                        .get(property)
-                        .ok_or_else(|| HaversError::UndefinedVariable {
-                            name: property.clone(),
-                            line: span.line,
-                        }),
-                    Value::Dict(dict) => dict
-                        .borrow()
-                        .get(&Value::String(property.clone()))
-                        .cloned()
-                        .ok_or_else(|| HaversError::UndefinedVariable {
-                            name: property.clone(),
-                            line: span.line,
-                        }),
-                    _ => Err(HaversError::TypeError {
-                        message: format!(
-                            "Cannae access property '{}' on a {}",
-                            property,
-                            obj.type_name()
-                        ),
-                        line: span.line,
-                    }),
-                }
+                Self::property_value(obj, property, span.line)
             }
 
             Expr::Set {
@@ -10791,28 +17001,7 @@ impl Interpreter {
             } => {
                 let obj = self.evaluate(object)?;
                 let val = self.evaluate(value)?;
-                match obj {
-                    Value::NativeObject(native) => native
-                        .set(property, val)
-                        .map_err(|err| err.with_line_if_zero(span.line)),
-                    Value::Instance(inst) => {
-                        inst.borrow_mut().set(property.clone(), val.clone());
-                        Ok(val)
-                    }
-                    Value::Dict(dict) => {
-                        dict.borrow_mut()
-                            .set(Value::String(property.clone()), val.clone());
-                        Ok(val)
-                    }
-                    _ => Err(HaversError::TypeError {
-                        message: format!(
-                            "Cannae set property '{}' on a {}",
-                            property,
-                            obj.type_name()
-                        ),
-                        line: span.line,
-                    }),
-                }
+                Self::set_property_value(obj, property, val, span.line)
             }
 
             Expr::Index {
@@ -10822,99 +17011,19 @@ impl Interpreter {
             } => {
                 let obj = self.evaluate(object)?;
                 let idx = self.evaluate(index)?;
-                match (&obj, &idx) {
-                    (Value::List(list), Value::Integer(i)) => {
-                        let list = list.borrow();
-                        let idx = if *i < 0 {
-                            list.len() as i64 + *i
-                        } else {
-                            *i
-                        };
-                        list.get(idx as usize)
-                            .cloned()
-                            .ok_or_else(|| HaversError::IndexOutOfBounds {
-                                index: *i,
-                                size: list.len(),
-                                line: span.line,
-                            })
-                    }
-                    (Value::String(s), Value::Integer(i)) => {
-                        let char_len = s.chars().count();
-                        let idx = if *i < 0 { char_len as i64 + *i } else { *i };
-                        if idx < 0 || idx as usize >= char_len {
-                            return Err(HaversError::IndexOutOfBounds {
-                                index: *i,
-                                size: char_len,
-                                line: span.line,
-                            });
-                        }
-                        Ok(Value::String(
-                            s.chars()
-                                .nth(idx as usize)
-                                .expect("checked bounds above")
-                                .to_string(),
-                        ))
-                    }
-                    (Value::Dict(dict), key) => dict
-                        .borrow()
-                        .get(key)
-                        .cloned()
-                        .ok_or_else(|| HaversError::UndefinedVariable {
-                            name: format!("{}", key),
-                            line: span.line,
-                        }),
-                    _ => Err(HaversError::TypeError {
-                        message: format!(
-                            "Cannae index a {} wi' a {}",
-                            obj.type_name(),
-                            idx.type_name()
-                        ),
-                        line: span.line,
-                    }),
-                }
+                Self::index_value(&obj, &idx, span.line)
             }
 
             Expr::IndexSet {
                 object,
                 index,
-                value,
-                span,
-            } => {
-                let obj = self.evaluate(object)?;
-                let idx = self.evaluate(index)?;
-                let val = self.evaluate(value)?;
-
-                match (&obj, &idx) {
-                    (Value::List(list), Value::Integer(i)) => {
-                        let mut list_mut = list.borrow_mut();
-                        let idx = if *i < 0 {
-                            list_mut.len() as i64 + *i
-                        } else {
-                            *i
-                        };
-                        if idx < 0 || idx as usize >= list_mut.len() {
-                            return Err(HaversError::IndexOutOfBounds {
-                                index: *i,
-                                size: list_mut.len(),
-                                line: span.line,
-                            });
-                        }
-                        list_mut[idx as usize] = val.clone();
-                        Ok(val)
-                    }
-                    (Value::Dict(dict), key) => {
-                        dict.borrow_mut().set(key.clone(), val.clone());
-                        Ok(val)
-                    }
-                    _ => Err(HaversError::TypeError {
-                        message: format!(
-                            "Cannae set index on a {} wi' a {}",
-                            obj.type_name(),
-                            idx.type_name()
-                        ),
-                        line: span.line,
-                    }),
-                }
+                value,
+                span,
+            } => {
+                let obj = self.evaluate(object)?;
+                let idx = self.evaluate(index)?;
+                let val = self.evaluate(value)?;
+                Self::set_index_value(&obj, &idx, val, span.line)
             }
 
             Expr::Slice {
@@ -11032,6 +17141,24 @@ impl Interpreter {
                         Ok(Value::List(Rc::new(RefCell::new(sliced))))
                     }
                     Value::String(s) => {
+                        // A plain s[a:b] is one copy of the bytes between two offsets
+                        if step_val == 1 {
+                            return Ok(with_char_index(&s, |index| {
+                                let len = index.chars as i64;
+                                let clamp = |i: i64| {
+                                    if i < 0 {
+                                        (len + i).max(0)
+                                    } else {
+                                        i.min(len)
+                                    }
+                                };
+                                let start = clamp(start_idx.unwrap_or(0));
+                                let end = clamp(end_idx.unwrap_or(len)).max(start);
+                                let from = index.offset(start as usize);
+                                let to = index.offset(end as usize);
+                                Value::String(s[from..to].into())
+                            }));
+                        }
                         let chars: Vec<char> = s.chars().collect();
                         let len = chars.len() as i64;
 
@@ -11077,7 +17204,7 @@ impl Interpreter {
                                 i += step_val; // step_val is negative
                             }
                         }
-                        Ok(Value::String(sliced))
+                        Ok(Value::String(sliced.into()))
                     }
                     _ => Err(HaversError::TypeError {
                         message: format!("Cannae slice a {}, ya numpty!", obj.type_name()),
@@ -11099,7 +17226,7 @@ impl Interpreter {
                             Value::String(s) => {
                                 // Spread string into characters
                                 for c in s.chars() {
-                                    items.push(Value::String(c.to_string()));
+                                    items.push(Value::String(c.to_string().into()));
                                 }
                             }
                             _ => {
@@ -11202,7 +17329,7 @@ impl Interpreter {
                         .read_line(&mut input)
                         .map_err(|e| HaversError::InternalError(e.to_string()))?;
 
-                    Ok(Value::String(input.trim().to_string()))
+                    Ok(Value::String(input.trim().into()))
                 }
             }
 
@@ -11217,7 +17344,7 @@ impl Interpreter {
                         }
                     }
                 }
-                Ok(Value::String(result))
+                Ok(Value::String(result.into()))
             }
 
             // Spread is only valid in specific contexts (lists, function calls)
@@ -11267,6 +17394,241 @@ impl Interpreter {
         }
     }
 
+    /// `left op right`, calling the left instance's operator method if it has one
+    fn binary_values(
+        &mut self,
+        left: Value,
+        op: &BinaryOp,
+        right: Value,
+        line: usize,
+    ) -> HaversResult<Value> {
+        if let Value::Instance(ref inst) = left {
+            let method_name = self.operator_method_name(op);
+            if let Some(method) = inst.borrow().class.find_method(&method_name) {
+                // Call the overloaded operator method
+                return self.call_method_on_instance(inst.clone(), method, vec![right], line);
+            }
+        }
+
+        self.binary_op(&left, op, &right, line)
+    }
+
+    fn negate_value(val: Value, line: usize) -> HaversResult<Value> {
+        match val {
+            Value::Integer(n) => n
+                .checked_neg()
+                .map(Value::Integer)
+                .ok_or(HaversError::IntegerOverflow { line }),
+            Value::Float(f) => Ok(Value::Float(-f)),
+            _ => Err(HaversError::TypeError {
+                message: format!("Cannae negate a {}", val.type_name()),
+                line,
+            }),
+        }
+    }
+
+    /// `obj.property`
+    fn property_value(obj: Value, property: &str, line: usize) -> HaversResult<Value> {
+        match obj {
+            Value::NativeObject(native) => native
+                .get(property)
+                .map_err(|err| err.with_line_if_zero(line)),
+            Value::Instance(inst) => {
+                inst.borrow()
+                    .get(property)
+                    .ok_or_else(|| HaversError::UndefinedVariable {
+                        name: property.to_string(),
+                        line,
+                    })
+            }
+            Value::Dict(dict) => dict
+                .borrow()
+                .get(&Value::String(property.into()))
+                .cloned()
+                .ok_or_else(|| HaversError::UndefinedVariable {
+                    name: property.to_string(),
+                    line,
+                }),
+            _ => Err(HaversError::TypeError {
+                message: format!(
+                    "Cannae access property '{}' on a {}",
+                    property,
+                    obj.type_name()
+                ),
+                line,
+            }),
+        }
+    }
+
+    /// `obj.property = val`
+    fn set_property_value(
+        obj: Value,
+        property: &str,
+        val: Value,
+        line: usize,
+    ) -> HaversResult<Value> {
+        match obj {
+            Value::NativeObject(native) => native
+                .set(property, val)
+                .map_err(|err| err.with_line_if_zero(line)),
+            Value::Instance(inst) => {
+                inst.borrow_mut().set(property.to_string(), val.clone());
+                Ok(val)
+            }
+            Value::Dict(dict) => {
+                dict.borrow_mut()
+                    .set(Value::String(property.into()), val.clone());
+                Ok(val)
+            }
+            _ => Err(HaversError::TypeError {
+                message: format!(
+                    "Cannae set property '{}' on a {}",
+                    property,
+                    obj.type_name()
+                ),
+                line,
+            }),
+        }
+    }
+
+    /// `obj[idx]`
+    fn index_value(obj: &Value, idx: &Value, line: usize) -> HaversResult<Value> {
+        match (obj, idx) {
+            (Value::List(list), Value::Integer(i)) => {
+                let list = list.borrow();
+                let idx = if *i < 0 { list.len() as i64 + *i } else { *i };
+                list.get(idx as usize)
+                    .cloned()
+                    .ok_or_else(|| HaversError::IndexOutOfBounds {
+                        index: *i,
+                        size: list.len(),
+                        line,
+                    })
+            }
+            (Value::String(s), Value::Integer(i)) => with_char_index(s, |index| {
+                let idx = if *i < 0 { index.chars as i64 + *i } else { *i };
+                if idx < 0 || idx as usize >= index.chars {
+                    return Err(HaversError::IndexOutOfBounds {
+                        index: *i,
+                        size: index.chars,
+                        line,
+                    });
+                }
+                Ok(Value::String(index.char_at(idx as usize)))
+            }),
+            (Value::Dict(dict), key) => {
+                dict.borrow()
+                    .get(key)
+                    .cloned()
+                    .ok_or_else(|| HaversError::UndefinedVariable {
+                        name: format!("{}", key),
+                        line,
+                    })
+            }
+            (Value::NativeObject(native), key) if native.as_any().is::<FrozenDict>() => native
+                .as_any()
+                .downcast_ref::<FrozenDict>()
+                .expect("checked above")
+                .get(key)
+                .cloned()
+                .ok_or_else(|| HaversError::UndefinedVariable {
+                    name: format!("{}", key),
+                    line,
+                }),
+            (Value::NativeObject(native), Value::String(key)) => {
+                native.get(key).map_err(|err| err.with_line_if_zero(line))
+            }
+            (Value::NativeObject(native), Value::Integer(i))
+                if native.as_any().is::<NumArray>() =>
+            {
+                let arr = native
+                    .as_any()
+                    .downcast_ref::<NumArray>()
+                    .expect("checked above");
+                arr.slot(*i)
+                    .map(|slot| arr.at(slot))
+                    .ok_or_else(|| HaversError::IndexOutOfBounds {
+                        index: *i,
+                        size: arr.len(),
+                        line,
+                    })
+            }
+            (Value::NativeObject(native), Value::Integer(i))
+                if native.as_any().is::<FrozenList>() =>
+            {
+                let list = native
+                    .as_any()
+                    .downcast_ref::<FrozenList>()
+                    .expect("checked above");
+                list.get(*i)
+                    .cloned()
+                    .ok_or_else(|| HaversError::IndexOutOfBounds {
+                        index: *i,
+                        size: list.len,
+                        line,
+                    })
+            }
+            _ => Err(HaversError::TypeError {
+                message: format!(
+                    "Cannae index a {} wi' a {}",
+                    obj.type_name(),
+                    idx.type_name()
+                ),
+                line,
+            }),
+        }
+    }
+
+    /// `obj[idx] = val`
+    fn set_index_value(obj: &Value, idx: &Value, val: Value, line: usize) -> HaversResult<Value> {
+        match (obj, idx) {
+            (Value::List(list), Value::Integer(i)) => {
+                let mut list_mut = list.borrow_mut();
+                let idx = if *i < 0 {
+                    list_mut.len() as i64 + *i
+                } else {
+                    *i
+                };
+                if idx < 0 || idx as usize >= list_mut.len() {
+                    return Err(HaversError::IndexOutOfBounds {
+                        index: *i,
+                        size: list_mut.len(),
+                        line,
+                    });
+                }
+                list_mut[idx as usize] = val.clone();
+                Ok(val)
+            }
+            (Value::Dict(dict), key) => {
+                dict.borrow_mut().set(key.clone(), val.clone());
+                Ok(val)
+            }
+            (Value::NativeObject(native), Value::Integer(i))
+                if native.as_any().is::<NumArray>() =>
+            {
+                let arr = native
+                    .as_any()
+                    .downcast_ref::<NumArray>()
+                    .expect("checked above");
+                let slot = arr.slot(*i).ok_or(HaversError::IndexOutOfBounds {
+                    index: *i,
+                    size: arr.len(),
+                    line,
+                })?;
+                arr.put(slot, &val)
+                    .map_err(|message| HaversError::TypeError { message, line })?;
+                Ok(val)
+            }
+            _ => Err(HaversError::TypeError {
+                message: format!(
+                    "Cannae set index on a {} wi' a {}",
+                    obj.type_name(),
+                    idx.type_name()
+                ),
+                line,
+            }),
+        }
+    }
     fn binary_op(
         &self,
         left: &Value,
@@ -11283,9 +17645,11 @@ impl Interpreter {
                 (Value::Float(a), Value::Float(b)) => Ok(Value::Float(a + b)),
                 (Value::Integer(a), Value::Float(b)) => Ok(Value::Float(*a as f64 + b)),
                 (Value::Float(a), Value::Integer(b)) => Ok(Value::Float(a + *b as f64)),
-                (Value::String(a), Value::String(b)) => Ok(Value::String(format!("{}{}", a, b))),
-                (Value::String(a), b) => Ok(Value::String(format!("{}{}", a, b))),
-                (a, Value::String(b)) => Ok(Value::String(format!("{}{}", a, b))),
+                (Value::String(a), Value::String(b)) => {
+                    Ok(Value::String(format!("{}{}", a, b).into()))
+                }
+                (Value::String(a), b) => Ok(Value::String(format!("{}{}", a, b).into())),
+                (a, Value::String(b)) => Ok(Value::String(format!("{}{}", a, b).into())),
                 (Value::List(a), Value::List(b)) => {
                     let mut result = a.borrow().clone();
                     result.extend(b.borrow().clone());
@@ -11343,7 +17707,7 @@ impl Interpreter {
                             *n as usize
                         }
                     };
-                    Ok(Value::String(s.repeat(count)))
+                    Ok(Value::String(s.repeat(count).into()))
                 }
                 _ => Err(HaversError::TypeError {
                     message: format!(
@@ -11616,7 +17980,7 @@ impl Interpreter {
 
                 let mut fields = DictValue::new();
                 for (field, value) in structure.fields.iter().zip(args) {
-                    fields.set(Value::String(field.clone()), value);
+                    fields.set(Value::String(field.as_str().into()), value);
                 }
 
                 // Return as a dict for now
@@ -11722,6 +18086,87 @@ impl Interpreter {
                 Ok(acc)
             }
 
+            // parallel_map(list, func, chunk) / parallel_filter(list, func, chunk)
+            "__builtin_parallel_map__" | "__builtin_parallel_filter__" => {
+                let public = name.trim_start_matches("__builtin_").trim_end_matches("__");
+                if args.len() != 3 {
+                    return Err(HaversError::WrongArity {
+                        name: public.to_string(),
+                        expected: 3,
+                        got: args.len(),
+                        line,
+                    });
+                }
+                let sequential = if public == "parallel_map" {
+                    "__builtin_gaun__"
+                } else {
+                    "__builtin_sieve__"
+                };
+                self.call_builtin_hof(sequential, args[..2].to_vec(), line)
+            }
+
+            // parallel_reduce(list, func, initial, chunk)
+            "__builtin_parallel_reduce__" => {
+                if args.len() != 4 {
+                    return Err(HaversError::WrongArity {
+                        name: "parallel_reduce".to_string(),
+                        expected: 4,
+                        got: args.len(),
+                        line,
+                    });
+                }
+                let fold_args = vec![args[0].clone(), args[2].clone(), args[1].clone()];
+                self.call_builtin_hof("__builtin_tumble__", fold_args, line)
+            }
+
+            // event_loop_run(loop) / event_loop_run(loop, timeout_ms)
+            "__builtin_event_loop_run__" => {
+                if args.is_empty() || args.len() > 2 {
+                    return Err(HaversError::WrongArity {
+                        name: "event_loop_run".to_string(),
+                        expected: 1,
+                        got: args.len(),
+                        line,
+                    });
+                }
+                let poll = self
+                    .globals
+                    .borrow()
+                    .get("event_loop_poll")
+                    .unwrap_or(Value::Nil);
+                let timeout = args.get(1).cloned().unwrap_or(Value::Nil);
+                loop {
+                    let poll_args = vec![args[0].clone(), timeout.clone()];
+                    let polled = self.call_value(poll.clone(), poll_args, line)?;
+                    let events = match polled {
+                        Value::List(events) => events.borrow().clone(),
+                        _ => Vec::new(),
+                    };
+                    let mut stopped = false;
+                    for ev in events {
+                        let (kind, callback) = match &ev {
+                            Value::Dict(d) => {
+                                let d = d.borrow();
+                                (
+                                    d.get(&Value::String("kind".into())).cloned(),
+                                    d.get(&Value::String("callback".into())).cloned(),
+                                )
+                            }
+                            _ => (None, None),
+                        };
+                        if matches!(&kind, Some(Value::String(k)) if **k == *"stop") {
+                            stopped = true;
+                        } else if let Some(callback) = callback {
+                            self.call_value(callback, vec![ev.clone()], line)?;
+                        }
+                    }
+                    if stopped {
+                        break;
+                    }
+                }
+                Ok(Value::Nil)
+            }
+
             // ilk(list, func) - for each (side effects)
             "__builtin_ilk__" => {
                 if args.len() != 2 {
@@ -11835,6 +18280,36 @@ impl Interpreter {
                 Ok(Value::Bool(true))
             }
 
+            // sort_by(list, func) - decorate with keys, stable sort, undecorate
+            "__builtin_sort_by__" => {
+                if args.len() != 2 {
+                    return Err(HaversError::WrongArity {
+                        name: "sort_by".to_string(),
+                        expected: 2,
+                        got: args.len(),
+                        line,
+                    });
+                }
+                let list = match &args[0] {
+                    Value::List(l) => l.borrow().clone(),
+                    _ => {
+                        return Err(HaversError::TypeError {
+                            message: "sort_by() expects a list as first argument".to_string(),
+                            line,
+                        })
+                    }
+                };
+                let func = args[1].clone();
+                let mut keyed = Vec::with_capacity(list.len());
+                for item in list {
+                    let key = self.call_value(func.clone(), vec![item.clone()], line)?;
+                    keyed.push((key, item));
+                }
+                keyed.sort_by(|a, b| sort_order(&a.0, &b.0));
+                let sorted = keyed.into_iter().map(|(_, item)| item).collect();
+                Ok(Value::List(Rc::new(RefCell::new(sorted))))
+            }
+
             // grup_up(list, func) - group elements by function result
             "__builtin_grup_up__" => {
                 if args.len() != 2 {
@@ -11963,6 +18438,10 @@ impl Interpreter {
     ) -> HaversResult<Value> {
         let _stack_guard = StackFrameGuard::new(&func.name, line);
 
+        if let Some(chunk) = self.bytecode_for(func) {
+            return self.run_bytecode(func, &chunk, args, env);
+        }
+
         // Set up closure environment fer evaluating default values
         {
             let _env_guard = EnvSwapGuard::new(self, env.clone());
@@ -12069,7 +18548,7 @@ fn parse_json_object(chars: &[char], pos: &mut usize) -> Result<Value, String> {
 
         // Parse value
         let value = parse_json_inner(chars, pos)?;
-        dict.borrow_mut().set(Value::String(key), value);
+        dict.borrow_mut().set(Value::String(key.into()), value);
 
         skip_json_whitespace(chars, pos);
 
@@ -12137,7 +18616,7 @@ fn parse_json_string(chars: &[char], pos: &mut usize) -> Result<Value, String> {
         let c = chars[*pos];
         if c == '"' {
             *pos += 1;
-            return Ok(Value::String(result));
+            return Ok(Value::String(result.into()));
         }
         if c == '\\' {
             *pos += 1;
@@ -12553,6 +19032,7 @@ blether m2["a"]
 	        let start_err = Pattern::Range {
 	            start: Box::new(Expr::Variable {
 	                name: "nope".to_string(),
+	                slot: None,
 	                span,
 	            }),
 	            end: Box::new(Expr::Literal {
@@ -12569,6 +19049,7 @@ blether m2["a"]
 	            }),
 	            end: Box::new(Expr::Variable {
 	                name: "nope".to_string(),
+	                slot: None,
 	                span,
 	            }),
 	        };
@@ -12604,7 +19085,7 @@ blether m2["a"]
         let bad_udp = register_socket(-1, SocketKind::Udp);
 
         let bytes = Value::Bytes(Rc::new(RefCell::new(vec![1_u8, 2, 3])));
-        let host = Value::String("127.0.0.1".to_string());
+        let host = Value::String("127.0.0.1".into());
 
         fn assert_result_err(value: Value) {
             let dict = value.as_dict().expect("expected dict result");
@@ -12692,7 +19173,7 @@ blether m2["a"]
 	            let dict = value.as_dict().expect("expected dict result");
 	            let dict = dict.borrow();
 	            assert_eq!(dict_get_bool(&dict, "ok"), Some(true));
-	            dict.get(&Value::String("value".to_string()))
+	            dict.get(&Value::String("value".into()))
 	                .and_then(|v| v.as_integer())
 	                .expect("expected integer value")
 	        }
@@ -12701,7 +19182,7 @@ blether m2["a"]
 	            let dict = value.as_dict().expect("expected dict result");
 	            let dict = dict.borrow();
 	            assert_eq!(dict_get_bool(&dict, "ok"), Some(false));
-	            dict.get(&Value::String("error".to_string()))
+	            dict.get(&Value::String("error".into()))
 	                .and_then(|v| v.as_string().map(|s| s.to_string()))
 	                .expect("expected error string")
 	        }
@@ -12958,22 +19439,22 @@ blether result
         let dict = dict.borrow();
 
         assert_eq!(
-            dict.get(&Value::String("priority".to_string()))
+            dict.get(&Value::String("priority".into()))
                 .and_then(|v| v.as_integer()),
             Some(10)
         );
         assert_eq!(
-            dict.get(&Value::String("weight".to_string()))
+            dict.get(&Value::String("weight".into()))
                 .and_then(|v| v.as_integer()),
             Some(5)
         );
         assert_eq!(
-            dict.get(&Value::String("port".to_string()))
+            dict.get(&Value::String("port".into()))
                 .and_then(|v| v.as_integer()),
             Some(443)
         );
         assert_eq!(
-            dict.get(&Value::String("target".to_string()))
+            dict.get(&Value::String("target".into()))
                 .and_then(|v| v.as_string()),
             Some("example.com.")
         );
@@ -13000,32 +19481,32 @@ blether result
         let dict = dict.borrow();
 
         assert_eq!(
-            dict.get(&Value::String("order".to_string()))
+            dict.get(&Value::String("order".into()))
                 .and_then(|v| v.as_integer()),
             Some(100)
         );
         assert_eq!(
-            dict.get(&Value::String("preference".to_string()))
+            dict.get(&Value::String("preference".into()))
                 .and_then(|v| v.as_integer()),
             Some(10)
         );
         assert_eq!(
-            dict.get(&Value::String("flags".to_string()))
+            dict.get(&Value::String("flags".into()))
                 .and_then(|v| v.as_string()),
             Some("U")
         );
         assert_eq!(
-            dict.get(&Value::String("service".to_string()))
+            dict.get(&Value::String("service".into()))
                 .and_then(|v| v.as_string()),
             Some("SIP+D2U")
         );
         assert_eq!(
-            dict.get(&Value::String("regexp".to_string()))
+            dict.get(&Value::String("regexp".into()))
                 .and_then(|v| v.as_string()),
             Some("!^.*$!sip:info@example.com!")
         );
         assert_eq!(
-            dict.get(&Value::String("replacement".to_string()))
+            dict.get(&Value::String("replacement".into()))
                 .and_then(|v| v.as_string()),
             Some("example.com.")
         );
@@ -13388,7 +19869,7 @@ blether r["error"]
             if dict_get_bool(&dict, "ok") != Some(true) {
                 return None;
             }
-            dict.get(&Value::String("value".to_string()))
+            dict.get(&Value::String("value".into()))
                 .and_then(|v| v.as_integer())
         }
 
@@ -13415,19 +19896,16 @@ blether r["error"]
         assert!(err_string(result_ok(Value::Nil)).is_none());
         {
             let mut dict = DictValue::new();
-            dict.set(Value::String("ok".to_string()), Value::Bool(false));
+            dict.set(Value::String("ok".into()), Value::Bool(false));
             let v = Value::Dict(Rc::new(RefCell::new(dict)));
             assert!(err_string(v).is_none());
         }
 
         fn tls_cfg_client(server_name: &str) -> Value {
             let mut dict = DictValue::new();
+            dict.set(Value::String("mode".into()), Value::String("client".into()));
             dict.set(
-                Value::String("mode".to_string()),
-                Value::String("client".to_string()),
-            );
-            dict.set(
-                Value::String("server_name".to_string()),
+                Value::String("server_name".into()),
                 Value::String(server_name.to_string()),
             );
             Value::Dict(Rc::new(RefCell::new(dict)))
@@ -13435,16 +19913,13 @@ blether r["error"]
 
         fn tls_cfg_server(cert_pem: &str, key_pem: &str) -> Value {
             let mut dict = DictValue::new();
+            dict.set(Value::String("mode".into()), Value::String("server".into()));
             dict.set(
-                Value::String("mode".to_string()),
-                Value::String("server".to_string()),
-            );
-            dict.set(
-                Value::String("cert_pem".to_string()),
+                Value::String("cert_pem".into()),
                 Value::String(cert_pem.to_string()),
             );
             dict.set(
-                Value::String("key_pem".to_string()),
+                Value::String("key_pem".into()),
                 Value::String(key_pem.to_string()),
             );
             Value::Dict(Rc::new(RefCell::new(dict)))
@@ -13495,7 +19970,7 @@ blether r["error"]
             assert_ok(
                 (socket_connect.func)(vec![
                     Value::Integer(sock_id),
-                    Value::String("127.0.0.1".to_string()),
+                    Value::String("127.0.0.1".into()),
                     Value::Integer(port as i64),
                 ])
                 .unwrap(),
@@ -13940,12 +20415,9 @@ blether id(...1)
     fn test_strings() {
         assert_eq!(
             run(r#""Hello" + " " + "World""#).unwrap(),
-            Value::String("Hello World".to_string())
-        );
-        assert_eq!(
-            run(r#""ha" * 3"#).unwrap(),
-            Value::String("hahaha".to_string())
+            Value::String("Hello World".into())
         );
+        assert_eq!(run(r#""ha" * 3"#).unwrap(), Value::String("hahaha".into()));
     }
 
     #[test]
@@ -13996,7 +20468,7 @@ whit_kind(tri.Sicht())"#,
         .unwrap();
         let mut interp = Interpreter::new();
         let result = interp.interpret(&program).unwrap();
-        assert_eq!(result, Value::String("Sicht".to_string()));
+        assert_eq!(result, Value::String("Sicht".into()));
     }
 
     #[test]
@@ -14009,7 +20481,7 @@ whit_kind(ctor())"#,
         .unwrap();
         let mut interp = Interpreter::new();
         let result = interp.interpret(&program).unwrap();
-        assert_eq!(result, Value::String("Sicht".to_string()));
+        assert_eq!(result, Value::String("Sicht".into()));
     }
 
     #[test]
@@ -14229,7 +20701,7 @@ keek x {
 result
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("two".to_string()));
+        assert_eq!(result, Value::String("two".into()));
     }
 
     #[test]
@@ -14248,7 +20720,7 @@ result
             run(r#"ken x = gin aye than "yes" ither "no"
 x"#)
             .unwrap(),
-            Value::String("yes".to_string())
+            Value::String("yes".into())
         );
         // Nested ternary
         assert_eq!(
@@ -14291,16 +20763,33 @@ result")
     fn test_slice_string() {
         assert_eq!(
             run("ken s = \"Hello\"\ns[0:2]").unwrap(),
-            Value::String("He".to_string())
+            Value::String("He".into())
         );
         assert_eq!(
             run("ken s = \"Hello\"\ns[3:]").unwrap(),
-            Value::String("lo".to_string())
+            Value::String("lo".into())
         );
         assert_eq!(
             run("ken s = \"Hello\"\ns[:3]").unwrap(),
-            Value::String("Hel".to_string())
+            Value::String("Hel".into())
+        );
+    }
+
+    #[test]
+    fn test_index_and_slice_long_non_ascii_string() {
+        let source = r#"
+ken s = ""
+fer i in 0..200 {
+    s = s + "aé日"
+}
+ken picks = s[0] + s[1] + s[598] + s[-1] + s[-599]
+picks + "|" + s[299:302] + "|" + s[-2:] + "|" + s[598:900] + "|" + char_at(s, 400)
+"#;
+        assert_eq!(
+            run(source).unwrap(),
+            Value::String("aéé日é|日aé|é日|é日|é".into())
         );
+        assert!(run("ken s = \"hé\"\ns[2]").is_err());
     }
 
     #[test]
@@ -14344,11 +20833,11 @@ result")
 
         // String with step
         let result = run("ken s = \"Hello\"\ns[::2]").unwrap();
-        assert_eq!(result, Value::String("Hlo".to_string())); // H, l, o
+        assert_eq!(result, Value::String("Hlo".into())); // H, l, o
 
         // String reversed
         let result = run("ken s = \"Hello\"\ns[::-1]").unwrap();
-        assert_eq!(result, Value::String("olleH".to_string()));
+        assert_eq!(result, Value::String("olleH".into()));
     }
 
     #[test]
@@ -14371,13 +20860,13 @@ result")
         // capitalize
         assert_eq!(
             run(r#"capitalize("hello")"#).unwrap(),
-            Value::String("Hello".to_string())
+            Value::String("Hello".into())
         );
 
         // title
         assert_eq!(
             run(r#"title("hello world")"#).unwrap(),
-            Value::String("Hello World".to_string())
+            Value::String("Hello World".into())
         );
 
 	        // words
@@ -14388,7 +20877,7 @@ result")
 
         // ord and chr
         assert_eq!(run(r#"ord("A")"#).unwrap(), Value::Integer(65));
-        assert_eq!(run("chr(65)").unwrap(), Value::String("A".to_string()));
+        assert_eq!(run("chr(65)").unwrap(), Value::String("A".into()));
     }
 
     #[test]
@@ -14486,7 +20975,7 @@ ken fido = Dug("Fido")
 fido.bark()
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("Woof! Ah'm Fido".to_string()));
+        assert_eq!(result, Value::String("Woof! Ah'm Fido".into()));
     }
 
     #[test]
@@ -14509,7 +20998,7 @@ ken d = Dug("Rex")
 d.speak()
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("Woof!".to_string()));
+        assert_eq!(result, Value::String("Woof!".into()));
     }
 
     #[test]
@@ -14525,7 +21014,7 @@ hae_a_bash {
 result
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("caught".to_string()));
+        assert_eq!(result, Value::String("caught".into()));
     }
 
     #[test]
@@ -14556,7 +21045,7 @@ dae greet(name, greeting = "Hullo") {
 greet("Hamish")
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("Hullo, Hamish!".to_string()));
+        assert_eq!(result, Value::String("Hullo, Hamish!".into()));
 
         let result = run(r#"
 dae greet(name, greeting = "Hullo") {
@@ -14565,7 +21054,7 @@ dae greet(name, greeting = "Hullo") {
 greet("Hamish", "Guid day")
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("Guid day, Hamish!".to_string()));
+        assert_eq!(result, Value::String("Guid day, Hamish!".into()));
     }
 
     #[test]
@@ -14575,7 +21064,7 @@ ken name = "Scotland"
 f"Hello, {name}!"
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("Hello, Scotland!".to_string()));
+        assert_eq!(result, Value::String("Hello, Scotland!".into()));
 
         // F-string with expression
         let result = run(r#"
@@ -14583,7 +21072,7 @@ ken x = 5
 f"The answer is {x * 2}"
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("The answer is 10".to_string()));
+        assert_eq!(result, Value::String("The answer is 10".into()));
     }
 
     #[test]
@@ -14600,7 +21089,7 @@ f"The answer is {x * 2}"
         // Test roar (uppercase shout)
         assert_eq!(
             run(r#"roar("hello")"#).unwrap(),
-            Value::String("HELLO!".to_string())
+            Value::String("HELLO!".into())
         );
 
         // Test wrang_sort (type check)
@@ -14619,7 +21108,7 @@ f"The answer is {x * 2}"
         // blether_format
         assert_eq!(
             run(r#"blether_format("Hullo {name}!", {"name": "Hamish"})"#).unwrap(),
-            Value::String("Hullo Hamish!".to_string())
+            Value::String("Hullo Hamish!".into())
         );
 
         // ceilidh (interleave)
@@ -14842,7 +21331,7 @@ f"The answer is {x * 2}"
     fn test_reverse() {
         assert_eq!(
             run(r#"reverse("hello")"#).unwrap(),
-            Value::String("olleh".to_string())
+            Value::String("olleh".into())
         );
         let result = run("reverse([1, 2, 3])").unwrap();
         let list = result.as_list().expect("Expected list");
@@ -14869,31 +21358,25 @@ f"The answer is {x * 2}"
 
         assert_eq!(
             run(r#"join(["a", "b", "c"], "-")"#).unwrap(),
-            Value::String("a-b-c".to_string())
+            Value::String("a-b-c".into())
         );
     }
 
     #[test]
     fn test_heid_tail_bum() {
         assert_eq!(run("heid([1, 2, 3])").unwrap(), Value::Integer(1));
-        assert_eq!(
-            run(r#"heid("hello")"#).unwrap(),
-            Value::String("h".to_string())
-        );
+        assert_eq!(run(r#"heid("hello")"#).unwrap(), Value::String("h".into()));
 
         let result = run("tail([1, 2, 3])").unwrap();
         let list = result.as_list().expect("Expected list");
         assert_eq!(list.borrow().len(), 2);
         assert_eq!(
             run(r#"tail("hello")"#).unwrap(),
-            Value::String("ello".to_string())
+            Value::String("ello".into())
         );
 
         assert_eq!(run("bum([1, 2, 3])").unwrap(), Value::Integer(3));
-        assert_eq!(
-            run(r#"bum("hello")"#).unwrap(),
-            Value::String("o".to_string())
-        );
+        assert_eq!(run(r#"bum("hello")"#).unwrap(), Value::String("o".into()));
     }
 
     #[test]
@@ -14915,7 +21398,7 @@ f"The answer is {x * 2}"
 
         assert_eq!(
             run(r#"slap("hello", " world")"#).unwrap(),
-            Value::String("hello world".to_string())
+            Value::String("hello world".into())
         );
     }
 
@@ -14930,15 +21413,15 @@ f"The answer is {x * 2}"
     fn test_wheesht_upper_lower() {
         assert_eq!(
             run(r#"wheesht("  hello  ")"#).unwrap(),
-            Value::String("hello".to_string())
+            Value::String("hello".into())
         );
         assert_eq!(
             run(r#"upper("hello")"#).unwrap(),
-            Value::String("HELLO".to_string())
+            Value::String("HELLO".into())
         );
         assert_eq!(
             run(r#"lower("HELLO")"#).unwrap(),
-            Value::String("hello".to_string())
+            Value::String("hello".into())
         );
     }
 
@@ -15175,10 +21658,7 @@ d["b"]
     fn test_negative_index() {
         assert_eq!(run("[1, 2, 3][-1]").unwrap(), Value::Integer(3));
         assert_eq!(run("[1, 2, 3][-2]").unwrap(), Value::Integer(2));
-        assert_eq!(
-            run(r#""hello"[-1]"#).unwrap(),
-            Value::String("o".to_string())
-        );
+        assert_eq!(run(r#""hello"[-1]"#).unwrap(), Value::String("o".into()));
     }
 
     // ==================== JSON Functions ====================
@@ -15189,7 +21669,7 @@ d["b"]
         let dict = result.as_dict().expect("Expected dict");
         let dict = dict.borrow();
         assert_eq!(
-            dict.get(&Value::String("value".to_string())),
+            dict.get(&Value::String("value".into())),
             Some(&Value::Integer(42))
         );
     }
@@ -15233,15 +21713,15 @@ d["b"]
 	    fn test_json_stringify() {
 	        assert_eq!(
 	            run(r#"json_stringify(42)"#).unwrap(),
-	            Value::String("42".to_string())
+	            Value::String("42".into())
         );
         assert_eq!(
             run(r#"json_stringify(aye)"#).unwrap(),
-            Value::String("true".to_string())
+            Value::String("true".into())
         );
         assert_eq!(
             run(r#"json_stringify([1, 2, 3])"#).unwrap(),
-            Value::String("[1, 2, 3]".to_string())
+            Value::String("[1, 2, 3]".into())
         );
     }
 
@@ -15330,7 +21810,7 @@ keek x {
 }
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("other".to_string()));
+        assert_eq!(result, Value::String("other".into()));
     }
 
     // ==================== Match with Identifier Pattern ====================
@@ -15430,7 +21910,7 @@ keek x {
     #[test]
     fn test_scran_slice_string() {
         let result = run(r#"scran("hello", 1, 4)"#).unwrap();
-        assert_eq!(result, Value::String("ell".to_string()));
+        assert_eq!(result, Value::String("ell".into()));
     }
 
     #[test]
@@ -15470,7 +21950,7 @@ keek x {
     #[test]
     fn test_wheesht_trim() {
         let result = run(r#"wheesht("  hello  ")"#).unwrap();
-        assert_eq!(result, Value::String("hello".to_string()));
+        assert_eq!(result, Value::String("hello".into()));
     }
 
     #[test]
@@ -15664,7 +22144,7 @@ gin x > 10 {
 }
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("medium".to_string()));
+        assert_eq!(result, Value::String("medium".into()));
     }
 
     #[test]
@@ -15811,7 +22291,7 @@ ken d = Dog("Rover")
 d.speak()
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("Woof!".to_string()));
+        assert_eq!(result, Value::String("Woof!".into()));
     }
 
     // ==================== Struct Tests ====================
@@ -15892,7 +22372,7 @@ ken d = {"name": "Alice", "age": 30}
 d["name"]
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("Alice".to_string()));
+        assert_eq!(result, Value::String("Alice".into()));
     }
 
     // ==================== String Operations ====================
@@ -15900,31 +22380,31 @@ d["name"]
     #[test]
     fn test_string_index() {
         let result = run(r#""hello"[0]"#).unwrap();
-        assert_eq!(result, Value::String("h".to_string()));
+        assert_eq!(result, Value::String("h".into()));
     }
 
     #[test]
     fn test_string_negative_index() {
         let result = run(r#""hello"[-1]"#).unwrap();
-        assert_eq!(result, Value::String("o".to_string()));
+        assert_eq!(result, Value::String("o".into()));
     }
 
     #[test]
     fn test_upper_function() {
         let result = run(r#"upper("hello")"#).unwrap();
-        assert_eq!(result, Value::String("HELLO".to_string()));
+        assert_eq!(result, Value::String("HELLO".into()));
     }
 
     #[test]
     fn test_lower_function() {
         let result = run(r#"lower("HELLO")"#).unwrap();
-        assert_eq!(result, Value::String("hello".to_string()));
+        assert_eq!(result, Value::String("hello".into()));
     }
 
     #[test]
     fn test_replace_string() {
         let result = run(r#"replace("hello world", "world", "everyone")"#).unwrap();
-        assert_eq!(result, Value::String("hello everyone".to_string()));
+        assert_eq!(result, Value::String("hello everyone".into()));
     }
 
     // ==================== Type Checking Functions ====================
@@ -15932,19 +22412,19 @@ d["name"]
     #[test]
     fn test_whit_kind_integer() {
         let result = run(r#"whit_kind(42)"#).unwrap();
-        assert_eq!(result, Value::String("integer".to_string()));
+        assert_eq!(result, Value::String("integer".into()));
     }
 
     #[test]
     fn test_whit_kind_string() {
         let result = run(r#"whit_kind("hello")"#).unwrap();
-        assert_eq!(result, Value::String("string".to_string()));
+        assert_eq!(result, Value::String("string".into()));
     }
 
     #[test]
     fn test_whit_kind_list() {
         let result = run(r#"whit_kind([1, 2, 3])"#).unwrap();
-        assert_eq!(result, Value::String("list".to_string()));
+        assert_eq!(result, Value::String("list".into()));
     }
 
     #[test]
@@ -15954,7 +22434,7 @@ dae foo() { gie 1 }
 whit_kind(foo)
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("function".to_string()));
+        assert_eq!(result, Value::String("function".into()));
     }
 
     // ==================== Pipe Operator ====================
@@ -15971,7 +22451,7 @@ whit_kind(foo)
 "  hello  " |> wheesht |> upper
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("HELLO".to_string()));
+        assert_eq!(result, Value::String("HELLO".into()));
     }
 
     // ==================== Spread Operator ====================
@@ -16026,7 +22506,7 @@ hae_a_bash {
 }
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("caught".to_string()));
+        assert_eq!(result, Value::String("caught".into()));
     }
 
     // ==================== Assert Tests ====================
@@ -16164,7 +22644,7 @@ apply(|n| n * n, 4)
     #[test]
     fn test_heid_string() {
         let result = run(r#"heid("hello")"#).unwrap();
-        assert_eq!(result, Value::String("h".to_string()));
+        assert_eq!(result, Value::String("h".into()));
     }
 
     #[test]
@@ -16178,7 +22658,7 @@ apply(|n| n * n, 4)
     #[test]
     fn test_tail_string() {
         let result = run(r#"tail("hello")"#).unwrap();
-        assert_eq!(result, Value::String("ello".to_string()));
+        assert_eq!(result, Value::String("ello".into()));
     }
 
     #[test]
@@ -16190,13 +22670,13 @@ apply(|n| n * n, 4)
     #[test]
     fn test_bum_string() {
         let result = run(r#"bum("hello")"#).unwrap();
-        assert_eq!(result, Value::String("o".to_string()));
+        assert_eq!(result, Value::String("o".into()));
     }
 
     #[test]
     fn test_join_string() {
         let result = run(r#"join(["a", "b", "c"], ", ")"#).unwrap();
-        assert_eq!(result, Value::String("a, b, c".to_string()));
+        assert_eq!(result, Value::String("a, b, c".into()));
     }
 
     // ==================== Module/Import Tests ====================
@@ -16221,7 +22701,7 @@ dae greet(name, greeting = "Hello") {
 greet("World")
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("Hello World".to_string()));
+        assert_eq!(result, Value::String("Hello World".into()));
     }
 
     #[test]
@@ -16233,7 +22713,7 @@ dae greet(name, greeting = "Hello") {
 greet("World", "Hi")
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("Hi World".to_string()));
+        assert_eq!(result, Value::String("Hi World".into()));
     }
 
     // ==================== Set Operations ====================
@@ -16300,7 +22780,7 @@ ken result = gin x > 3 than "big" ither "small"
 result
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("big".to_string()));
+        assert_eq!(result, Value::String("big".into()));
     }
 
     #[test]
@@ -16336,9 +22816,9 @@ result
         let result = run(r#"sort(["c", "a", "b"])"#).unwrap();
         let list = result.as_list().expect("Expected list");
         let items = list.borrow();
-        assert_eq!(items[0], Value::String("a".to_string()));
-        assert_eq!(items[1], Value::String("b".to_string()));
-        assert_eq!(items[2], Value::String("c".to_string()));
+        assert_eq!(items[0], Value::String("a".into()));
+        assert_eq!(items[1], Value::String("b".into()));
+        assert_eq!(items[2], Value::String("c".into()));
     }
 
     #[test]
@@ -16354,7 +22834,7 @@ result
     #[test]
     fn test_reverse_string_builtin() {
         let result = run(r#"reverse("hello")"#).unwrap();
-        assert_eq!(result, Value::String("olleh".to_string()));
+        assert_eq!(result, Value::String("olleh".into()));
     }
 
     // ==================== More Native Function Tests ====================
@@ -16405,13 +22885,13 @@ result
     #[test]
     fn test_capitalize_function() {
         let result = run(r#"capitalize("hello")"#).unwrap();
-        assert_eq!(result, Value::String("Hello".to_string()));
+        assert_eq!(result, Value::String("Hello".into()));
     }
 
     #[test]
     fn test_title_function() {
         let result = run(r#"title("hello world")"#).unwrap();
-        assert_eq!(result, Value::String("Hello World".to_string()));
+        assert_eq!(result, Value::String("Hello World".into()));
     }
 
     #[test]
@@ -16681,6 +23161,35 @@ len(values(d))
         assert_eq!(result, Value::Integer(2));
     }
 
+    #[test]
+    fn test_dict_bulk_builders() {
+        let result = run(r#"
+ken a = dict_with_capacity(4)
+a["x"] = 1
+dict_update(a, {"x": 2, "y": 3})
+ken m = dict_merge(a, dict_from_pairs([["z", 4]]))
+a["x"] * 100 + len(m) * 10 + m["z"]
+"#)
+        .unwrap();
+        assert_eq!(result, Value::Integer(234));
+    }
+
+    #[test]
+    fn test_frozen_versions_share_and_stay_put() {
+        let result = run(r#"
+ken v0 = frozen_dict({"n": 1})
+ken v1 = frozen_set(v0, "n", 2)
+ken l = frozen_list([])
+fer i in 0..100 {
+    l = frozen_push(l, i)
+}
+ken l2 = frozen_set(l, 50, 0)
+v0["n"] * 1000 + v1["n"] * 100 + l[50] + l2[50] + len(thaw(frozen_remove(v1, "n")))
+"#)
+        .unwrap();
+        assert_eq!(result, Value::Integer(1250));
+    }
+
     #[test]
     fn test_dict_update_existing() {
         let result = run(r#"
@@ -16736,7 +23245,7 @@ ken x = 10
 f"Result: {x * 2}"
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("Result: 20".to_string()));
+        assert_eq!(result, Value::String("Result: 20".into()));
     }
 
     #[test]
@@ -16746,7 +23255,7 @@ dae greet(name) { gie "Hi " + name }
 f"Greeting: {greet(\"World\")}"
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("Greeting: Hi World".to_string()));
+        assert_eq!(result, Value::String("Greeting: Hi World".into()));
     }
 
     // ==================== Empty Structure Tests ====================
@@ -16769,7 +23278,7 @@ ken p = Person("Alice", 30)
 p.name
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("Alice".to_string()));
+        assert_eq!(result, Value::String("Alice".into()));
     }
 
     // ==================== Assignment Operators ====================
@@ -16897,7 +23406,7 @@ ken s = "hello"
 s[1:4]
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("ell".to_string()));
+        assert_eq!(result, Value::String("ell".into()));
     }
 
     #[test]
@@ -16907,7 +23416,7 @@ ken s = "hello"
 s[4:0:-1]
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("olle".to_string()));
+        assert_eq!(result, Value::String("olle".into()));
     }
 
     #[test]
@@ -16968,7 +23477,7 @@ ken s = creel([3, 1, 2])
 whit_kind(creel_tae_list(s))
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("list".to_string()));
+        assert_eq!(result, Value::String("list".into()));
     }
 
     #[test]
@@ -17110,7 +23619,7 @@ ken [a, b, c] = "abc"
 a + b + c
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("abc".to_string()));
+        assert_eq!(result, Value::String("abc".into()));
     }
 
     #[test]
@@ -17143,7 +23652,7 @@ ken l = sort(["c", "a", "b"])
 l[0]
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("a".to_string()));
+        assert_eq!(result, Value::String("a".into()));
     }
 
     #[test]
@@ -17228,13 +23737,13 @@ is_a(foo, "function")
     #[test]
     fn test_char_at_positive() {
         let result = run(r#"char_at("hello", 1)"#).unwrap();
-        assert_eq!(result, Value::String("e".to_string()));
+        assert_eq!(result, Value::String("e".into()));
     }
 
     #[test]
     fn test_char_at_negative() {
         let result = run(r#"char_at("hello", -1)"#).unwrap();
-        assert_eq!(result, Value::String("o".to_string()));
+        assert_eq!(result, Value::String("o".into()));
     }
 
     #[test]
@@ -17246,7 +23755,7 @@ is_a(foo, "function")
     #[test]
     fn test_repeat_string() {
         let result = run(r#"repeat("ab", 3)"#).unwrap();
-        assert_eq!(result, Value::String("ababab".to_string()));
+        assert_eq!(result, Value::String("ababab".into()));
     }
 
     #[test]
@@ -17284,19 +23793,19 @@ is_a(foo, "function")
     #[test]
     fn test_pad_left() {
         let result = run(r#"pad_left("5", 3, "0")"#).unwrap();
-        assert_eq!(result, Value::String("005".to_string()));
+        assert_eq!(result, Value::String("005".into()));
     }
 
     #[test]
     fn test_pad_right() {
         let result = run(r#"pad_right("5", 3, "0")"#).unwrap();
-        assert_eq!(result, Value::String("500".to_string()));
+        assert_eq!(result, Value::String("500".into()));
     }
 
     #[test]
     fn test_pad_left_already_wide() {
         let result = run(r#"pad_left("hello", 3, " ")"#).unwrap();
-        assert_eq!(result, Value::String("hello".to_string()));
+        assert_eq!(result, Value::String("hello".into()));
     }
 
     #[test]
@@ -17356,7 +23865,7 @@ is_a(foo, "function")
     #[test]
     fn test_chr() {
         let result = run("chr(65)").unwrap();
-        assert_eq!(result, Value::String("A".to_string()));
+        assert_eq!(result, Value::String("A".into()));
     }
 
     #[test]
@@ -17470,7 +23979,7 @@ len(l)
     #[test]
     fn test_string_slice_take() {
         let result = run(r#""hello"[0:3]"#).unwrap();
-        assert_eq!(result, Value::String("hel".to_string()));
+        assert_eq!(result, Value::String("hel".into()));
     }
 
     #[test]
@@ -17482,7 +23991,7 @@ len(l)
     #[test]
     fn test_string_slice_drop() {
         let result = run(r#""hello"[2:]"#).unwrap();
-        assert_eq!(result, Value::String("llo".to_string()));
+        assert_eq!(result, Value::String("llo".into()));
     }
 
     #[test]
@@ -17746,7 +24255,7 @@ len(parts[0])
     #[test]
     fn test_stoater_strings() {
         let result = run(r#"stoater(["a", "abc", "ab"])"#).unwrap();
-        assert_eq!(result, Value::String("abc".to_string())); // longest
+        assert_eq!(result, Value::String("abc".into())); // longest
     }
 
     #[test]
@@ -17852,13 +24361,13 @@ len(parts[0])
     #[test]
     fn test_geggie() {
         let result = run(r#"geggie("hello")"#).unwrap();
-        assert_eq!(result, Value::String("ho".to_string()));
+        assert_eq!(result, Value::String("ho".into()));
     }
 
     #[test]
     fn test_geggie_empty() {
         let result = run(r#"geggie("")"#).unwrap();
-        assert_eq!(result, Value::String("".to_string()));
+        assert_eq!(result, Value::String("".into()));
     }
 
     #[test]
@@ -17989,7 +24498,7 @@ ken d = dict_invert({"a": "1", "b": "2"})
 d["1"]
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("a".to_string()));
+        assert_eq!(result, Value::String("a".into()));
     }
 
     #[test]
@@ -18013,7 +24522,7 @@ d["a"]
     #[test]
     fn test_center() {
         let result = run(r#"center("hi", 6, "-")"#).unwrap();
-        assert_eq!(result, Value::String("--hi--".to_string()));
+        assert_eq!(result, Value::String("--hi--".into()));
     }
 
     #[test]
@@ -18037,31 +24546,31 @@ d["a"]
     #[test]
     fn test_swapcase() {
         let result = run(r#"swapcase("Hello")"#).unwrap();
-        assert_eq!(result, Value::String("hELLO".to_string()));
+        assert_eq!(result, Value::String("hELLO".into()));
     }
 
     #[test]
     fn test_strip_left() {
         let result = run(r#"strip_left("xxxhello", "x")"#).unwrap();
-        assert_eq!(result, Value::String("hello".to_string()));
+        assert_eq!(result, Value::String("hello".into()));
     }
 
     #[test]
     fn test_strip_right() {
         let result = run(r#"strip_right("helloyyy", "y")"#).unwrap();
-        assert_eq!(result, Value::String("hello".to_string()));
+        assert_eq!(result, Value::String("hello".into()));
     }
 
     #[test]
     fn test_replace_first() {
         let result = run(r#"replace_first("hello hello", "hello", "hi")"#).unwrap();
-        assert_eq!(result, Value::String("hi hello".to_string()));
+        assert_eq!(result, Value::String("hi hello".into()));
     }
 
     #[test]
     fn test_substr_between() {
         let result = run(r#"substr_between("Hello [World]!", "[", "]")"#).unwrap();
-        assert_eq!(result, Value::String("World".to_string()));
+        assert_eq!(result, Value::String("World".into()));
     }
 
     #[test]
@@ -18101,13 +24610,13 @@ d["a"]
     #[test]
     fn test_string_multiply() {
         let result = run(r#""ab" * 3"#).unwrap();
-        assert_eq!(result, Value::String("ababab".to_string()));
+        assert_eq!(result, Value::String("ababab".into()));
     }
 
     #[test]
     fn test_integer_multiply_string() {
         let result = run(r#"3 * "ab""#).unwrap();
-        assert_eq!(result, Value::String("ababab".to_string()));
+        assert_eq!(result, Value::String("ababab".into()));
     }
 
     #[test]
@@ -18143,7 +24652,7 @@ d["a"]
     #[test]
     fn test_reverse_str_builtin() {
         let result = run(r#"reverse("hello")"#).unwrap();
-        assert_eq!(result, Value::String("olleh".to_string()));
+        assert_eq!(result, Value::String("olleh".into()));
     }
 
     #[test]
@@ -18207,13 +24716,28 @@ l[0]
     #[test]
     fn test_blether_format() {
         let result = run(r#"blether_format("Hello {name}!", {"name": "World"})"#).unwrap();
-        assert_eq!(result, Value::String("Hello World!".to_string()));
+        assert_eq!(result, Value::String("Hello World!".into()));
+    }
+
+    #[test]
+    fn test_format_compile_and_apply() {
+        let result = run(r#"
+ken t = format_compile("{who} has {n} {{who}} {missing} {7}")
+ken a = format_apply(t, {"who": "Isla", "n": 3, 7: "seven"})
+ken b = format_apply(t, {"who": "{n}", "n": 0})
+a + "|" + b
+"#)
+        .unwrap();
+        assert_eq!(
+            result,
+            Value::String("Isla has 3 {Isla} {missing} seven|{n} has 0 {{n}} {missing} {7}".into())
+        );
     }
 
     #[test]
     fn test_wheesht_aw() {
         let result = run(r#"wheesht_aw("  hello   world  ")"#).unwrap();
-        assert_eq!(result, Value::String("hello world".to_string()));
+        assert_eq!(result, Value::String("hello world".into()));
     }
 
     #[test]
@@ -18238,7 +24762,7 @@ l[0]
     #[test]
     fn test_tattie_scone() {
         let result = run(r#"tattie_scone("yum", 3)"#).unwrap();
-        assert_eq!(result, Value::String("yum | yum | yum".to_string()));
+        assert_eq!(result, Value::String("yum | yum | yum".into()));
     }
 
     #[test]
@@ -18250,7 +24774,7 @@ l[0]
     #[test]
     fn test_sporran_fill() {
         let result = run(r#"sporran_fill("hi", 6, "*")"#).unwrap();
-        assert_eq!(result, Value::String("**hi**".to_string()));
+        assert_eq!(result, Value::String("**hi**".into()));
     }
 
     // ==================== Hex Conversion ====================
@@ -18258,7 +24782,7 @@ l[0]
     #[test]
     fn test_tae_hex() {
         let result = run("tae_hex(255)").unwrap();
-        assert_eq!(result, Value::String("ff".to_string()));
+        assert_eq!(result, Value::String("ff".into()));
     }
 
     #[test]
@@ -18324,7 +24848,7 @@ ken d = Dog()
 d.speak()
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("Woof!".to_string()));
+        assert_eq!(result, Value::String("Woof!".into()));
     }
 
     #[test]
@@ -18501,6 +25025,54 @@ x.foo
         assert_eq!(result, Value::Float(2.5));
     }
 
+    #[test]
+    fn test_median_unsorted_ints() {
+        let result = run("median([5, 1, 4, 2])").unwrap();
+        assert_eq!(result, Value::Float(3.0));
+    }
+
+    #[test]
+    fn test_percentile_interpolates_between_ranks() {
+        let Value::Float(p95) = run("percentile(range(1, 101), 95)").unwrap() else {
+            panic!("expected a float");
+        };
+        assert!((p95 - 95.05).abs() < 1e-9);
+        let result = run("percentile([3, 1, 2], 0)").unwrap();
+        assert_eq!(result, Value::Float(1.0));
+        let result = run("percentile([3, 1, 2], 100)").unwrap();
+        assert_eq!(result, Value::Float(3.0));
+    }
+
+    #[test]
+    fn test_percentile_out_of_range() {
+        assert!(run("percentile([1, 2], 101)").is_err());
+        assert!(run("percentile([1, 2], \"half\")").is_err());
+    }
+
+    #[test]
+    fn test_stats() {
+        let result = run(r#"
+ken s = stats([9, 4, 5, 2, 4, 7, 5, 4])
+[s["count"], s["mean"], s["stddev"], s["min"], s["max"], s["p50"]]
+"#)
+        .unwrap();
+        let Value::List(list) = result else {
+            panic!("expected a list");
+        };
+        assert_eq!(
+            *list.borrow(),
+            vec![
+                Value::Integer(8),
+                Value::Float(5.0),
+                Value::Float(2.0),
+                Value::Integer(2),
+                Value::Integer(9),
+                Value::Float(4.5),
+            ]
+        );
+        assert!(run("stats([])").is_err());
+    }
+
     #[test]
     fn test_sumaw_list_integers() {
         let result = run("sumaw([1, 2, 3, 4, 5])").unwrap();
@@ -18541,7 +25113,7 @@ x.foo
     fn test_wheesht_aw_string_trim() {
         // wheesht_aw cleans and trims a string
         let result = run(r#"wheesht_aw("  hello   world  ")"#).unwrap();
-        assert_eq!(result, Value::String("hello world".to_string()));
+        assert_eq!(result, Value::String("hello world".into()));
     }
 
     #[test]
@@ -18576,20 +25148,20 @@ len(parts[0])
     #[test]
     fn test_upper() {
         let result = run(r#"upper("hello")"#).unwrap();
-        assert_eq!(result, Value::String("HELLO".to_string()));
+        assert_eq!(result, Value::String("HELLO".into()));
     }
 
     #[test]
     fn test_lower() {
         let result = run(r#"lower("HELLO")"#).unwrap();
-        assert_eq!(result, Value::String("hello".to_string()));
+        assert_eq!(result, Value::String("hello".into()));
     }
 
     #[test]
     fn test_wheesht_string() {
         // Using wheesht to filter a string (removes whitespace-ish behavior via replace)
         let result = run(r#"replace("  hello  ", " ", "")"#).unwrap();
-        assert_eq!(result, Value::String("hello".to_string()));
+        assert_eq!(result, Value::String("hello".into()));
     }
 
     #[test]
@@ -18601,13 +25173,13 @@ len(parts[0])
     #[test]
     fn test_join() {
         let result = run(r#"join(["a", "b", "c"], "-")"#).unwrap();
-        assert_eq!(result, Value::String("a-b-c".to_string()));
+        assert_eq!(result, Value::String("a-b-c".into()));
     }
 
     #[test]
     fn test_replace() {
         let result = run(r#"replace("hello", "l", "x")"#).unwrap();
-        assert_eq!(result, Value::String("hexxo".to_string()));
+        assert_eq!(result, Value::String("hexxo".into()));
     }
 
     #[test]
@@ -18704,7 +25276,7 @@ len(cleaned)
     #[test]
     fn test_tae_string() {
         let result = run("tae_string(42)").unwrap();
-        assert_eq!(result, Value::String("42".to_string()));
+        assert_eq!(result, Value::String("42".into()));
     }
 
     #[test]
@@ -19019,19 +25591,19 @@ total
     #[test]
     fn test_title_case_string() {
         let result = run(r#"title("hello world")"#).unwrap();
-        assert_eq!(result, Value::String("Hello World".to_string()));
+        assert_eq!(result, Value::String("Hello World".into()));
     }
 
     #[test]
     fn test_center_function() {
         let result = run(r#"center("hi", 6, " ")"#).unwrap();
-        assert_eq!(result, Value::String("  hi  ".to_string()));
+        assert_eq!(result, Value::String("  hi  ".into()));
     }
 
     #[test]
     fn test_repeat_function() {
         let result = run(r#"repeat("ab", 3)"#).unwrap();
-        assert_eq!(result, Value::String("ababab".to_string()));
+        assert_eq!(result, Value::String("ababab".into()));
     }
 
     #[test]
@@ -19091,13 +25663,13 @@ len(l)
     #[test]
     fn test_pad_left_function() {
         let result = run(r#"pad_left("42", 5, "0")"#).unwrap();
-        assert_eq!(result, Value::String("00042".to_string()));
+        assert_eq!(result, Value::String("00042".into()));
     }
 
     #[test]
     fn test_pad_right_function() {
         let result = run(r#"pad_right("42", 5, "0")"#).unwrap();
-        assert_eq!(result, Value::String("42000".to_string()));
+        assert_eq!(result, Value::String("42000".into()));
     }
 
     #[test]
@@ -19121,13 +25693,13 @@ len(l)
     #[test]
     fn test_chr_function() {
         let result = run("chr(65)").unwrap();
-        assert_eq!(result, Value::String("A".to_string()));
+        assert_eq!(result, Value::String("A".into()));
     }
 
     #[test]
     fn test_chr_unicode() {
         let result = run("chr(128512)").unwrap();
-        assert_eq!(result, Value::String("😀".to_string()));
+        assert_eq!(result, Value::String("😀".into()));
     }
 
     #[test]
@@ -19145,7 +25717,7 @@ len(l)
     #[test]
     fn test_scran_string_range() {
         let result = run(r#"scran("hello", 1, 4)"#).unwrap();
-        assert_eq!(result, Value::String("ell".to_string()));
+        assert_eq!(result, Value::String("ell".into()));
     }
 
     #[test]
@@ -19327,7 +25899,7 @@ ken s = sort(["banana", "apple", "cherry"])
 s[0]
 "#)
         .unwrap();
-        assert_eq!(result, Value::String("apple".to_string()));
+        assert_eq!(result, Value::String("apple".into()));
     }
 
     #[test]
@@ -19627,13 +26199,13 @@ soond_steek()
         assert!(parse_log_level_value(&Value::Integer(9)).is_err());
         assert!(parse_log_level_value(&Value::Bool(true)).is_err());
         assert_eq!(
-            parse_log_target_value(&Value::String("t".to_string())).unwrap(),
+            parse_log_target_value(&Value::String("t".into())).unwrap(),
             "t"
         );
         assert!(parse_log_target_value(&Value::Integer(1)).is_err());
 
         let mut dict = DictValue::new();
-        dict.set(Value::String("a".to_string()), Value::Integer(1));
+        dict.set(Value::String("a".into()), Value::Integer(1));
         let fields = Value::Dict(Rc::new(RefCell::new(dict)));
 
         assert_eq!(resolve_log_args(&[]).unwrap(), (None, None));
@@ -19642,24 +26214,20 @@ soond_steek()
             .0
             .is_some());
         assert_eq!(
-            resolve_log_args(&[Value::String("target".to_string())]).unwrap(),
+            resolve_log_args(&[Value::String("target".into())]).unwrap(),
             (None, Some("target".to_string()))
         );
         assert!(resolve_log_args(&[Value::Integer(1)]).is_err());
         let (fields_val, target) =
-            resolve_log_args(&[fields.clone(), Value::String("t".to_string())]).unwrap();
+            resolve_log_args(&[fields.clone(), Value::String("t".into())]).unwrap();
         assert!(fields_val.is_some());
         assert_eq!(target, Some("t".to_string()));
-        assert!(resolve_log_args(&[
-            Value::String("x".to_string()),
-            Value::String("y".to_string())
-        ])
-        .is_err());
+        assert!(resolve_log_args(&[Value::String("x".into()), Value::String("y".into())]).is_err());
         assert!(resolve_log_args(&[fields, Value::Integer(1)]).is_err());
         assert!(resolve_log_args(&[
-            Value::String("x".to_string()),
-            Value::String("y".to_string()),
-            Value::String("z".to_string())
+            Value::String("x".into()),
+            Value::String("y".into()),
+            Value::String("z".into())
         ])
         .is_err());
     }
@@ -19694,46 +26262,40 @@ soond_steek()
         assert!(interp.apply_log_config(Some(Value::Integer(1))).is_err());
 
         let mut bad_filter = DictValue::new();
-        bad_filter.set(Value::String("filter".to_string()), Value::Integer(1));
+        bad_filter.set(Value::String("filter".into()), Value::Integer(1));
         assert!(interp
             .apply_log_config(Some(Value::Dict(Rc::new(RefCell::new(bad_filter)))))
             .is_err());
 
         let mut bad_format = DictValue::new();
-        bad_format.set(Value::String("format".to_string()), Value::Integer(1));
+        bad_format.set(Value::String("format".into()), Value::Integer(1));
         assert!(interp
             .apply_log_config(Some(Value::Dict(Rc::new(RefCell::new(bad_format)))))
             .is_err());
 
         let mut bad_format_str = DictValue::new();
-        bad_format_str.set(
-            Value::String("format".to_string()),
-            Value::String("nope".to_string()),
-        );
+        bad_format_str.set(Value::String("format".into()), Value::String("nope".into()));
         assert!(interp
             .apply_log_config(Some(Value::Dict(Rc::new(RefCell::new(bad_format_str)))))
             .is_err());
 
         let mut bad_color = DictValue::new();
-        bad_color.set(
-            Value::String("color".to_string()),
-            Value::String("aye".to_string()),
-        );
+        bad_color.set(Value::String("color".into()), Value::String("aye".into()));
         assert!(interp
             .apply_log_config(Some(Value::Dict(Rc::new(RefCell::new(bad_color)))))
             .is_err());
 
         let mut bad_ts = DictValue::new();
         bad_ts.set(
-            Value::String("timestamps".to_string()),
-            Value::String("aye".to_string()),
+            Value::String("timestamps".into()),
+            Value::String("aye".into()),
         );
         assert!(interp
             .apply_log_config(Some(Value::Dict(Rc::new(RefCell::new(bad_ts)))))
             .is_err());
 
         let mut bad_sinks = DictValue::new();
-        bad_sinks.set(Value::String("sinks".to_string()), Value::Integer(1));
+        bad_sinks.set(Value::String("sinks".into()), Value::Integer(1));
         assert!(interp
             .apply_log_config(Some(Value::Dict(Rc::new(RefCell::new(bad_sinks)))))
             .is_err());
@@ -19741,7 +26303,7 @@ soond_steek()
         let sinks = vec![Value::Integer(1)];
         let mut bad_sink_spec = DictValue::new();
         bad_sink_spec.set(
-            Value::String("sinks".to_string()),
+            Value::String("sinks".into()),
             Value::List(Rc::new(RefCell::new(sinks))),
         );
         assert!(interp
@@ -19749,10 +26311,10 @@ soond_steek()
             .is_err());
 
         let mut sink_kind = DictValue::new();
-        sink_kind.set(Value::String("kind".to_string()), Value::Integer(1));
+        sink_kind.set(Value::String("kind".into()), Value::Integer(1));
         let mut bad_kind = DictValue::new();
         bad_kind.set(
-            Value::String("sinks".to_string()),
+            Value::String("sinks".into()),
             Value::List(Rc::new(RefCell::new(vec![Value::Dict(Rc::new(
                 RefCell::new(sink_kind),
             ))]))),
@@ -19762,14 +26324,11 @@ soond_steek()
             .is_err());
 
         let mut file_spec = DictValue::new();
-        file_spec.set(
-            Value::String("kind".to_string()),
-            Value::String("file".to_string()),
-        );
-        file_spec.set(Value::String("path".to_string()), Value::Integer(1));
+        file_spec.set(Value::String("kind".into()), Value::String("file".into()));
+        file_spec.set(Value::String("path".into()), Value::Integer(1));
         let mut bad_file = DictValue::new();
         bad_file.set(
-            Value::String("sinks".to_string()),
+            Value::String("sinks".into()),
             Value::List(Rc::new(RefCell::new(vec![Value::Dict(Rc::new(
                 RefCell::new(file_spec),
             ))]))),
@@ -19779,18 +26338,15 @@ soond_steek()
             .is_err());
 
         let mut file_spec = DictValue::new();
+        file_spec.set(Value::String("kind".into()), Value::String("file".into()));
         file_spec.set(
-            Value::String("kind".to_string()),
-            Value::String("file".to_string()),
+            Value::String("path".into()),
+            Value::String("out.log".into()),
         );
-        file_spec.set(
-            Value::String("path".to_string()),
-            Value::String("out.log".to_string()),
-        );
-        file_spec.set(Value::String("append".to_string()), Value::Integer(1));
+        file_spec.set(Value::String("append".into()), Value::Integer(1));
         let mut bad_append = DictValue::new();
         bad_append.set(
-            Value::String("sinks".to_string()),
+            Value::String("sinks".into()),
             Value::List(Rc::new(RefCell::new(vec![Value::Dict(Rc::new(
                 RefCell::new(file_spec),
             ))]))),
@@ -19800,14 +26356,11 @@ soond_steek()
             .is_err());
 
         let mut mem_spec = DictValue::new();
-        mem_spec.set(
-            Value::String("kind".to_string()),
-            Value::String("memory".to_string()),
-        );
-        mem_spec.set(Value::String("max".to_string()), Value::Integer(0));
+        mem_spec.set(Value::String("kind".into()), Value::String("memory".into()));
+        mem_spec.set(Value::String("max".into()), Value::Integer(0));
         let mut bad_mem = DictValue::new();
         bad_mem.set(
-            Value::String("sinks".to_string()),
+            Value::String("sinks".into()),
             Value::List(Rc::new(RefCell::new(vec![Value::Dict(Rc::new(
                 RefCell::new(mem_spec),
             ))]))),
@@ -19818,12 +26371,12 @@ soond_steek()
 
         let mut cb_spec = DictValue::new();
         cb_spec.set(
-            Value::String("kind".to_string()),
-            Value::String("callback".to_string()),
+            Value::String("kind".into()),
+            Value::String("callback".into()),
         );
         let mut bad_cb = DictValue::new();
         bad_cb.set(
-            Value::String("sinks".to_string()),
+            Value::String("sinks".into()),
             Value::List(Rc::new(RefCell::new(vec![Value::Dict(Rc::new(
                 RefCell::new(cb_spec),
             ))]))),
@@ -19834,12 +26387,12 @@ soond_steek()
 
         let mut unknown_spec = DictValue::new();
         unknown_spec.set(
-            Value::String("kind".to_string()),
-            Value::String("unknown".to_string()),
+            Value::String("kind".into()),
+            Value::String("unknown".into()),
         );
         let mut bad_unknown = DictValue::new();
         bad_unknown.set(
-            Value::String("sinks".to_string()),
+            Value::String("sinks".into()),
             Value::List(Rc::new(RefCell::new(vec![Value::Dict(Rc::new(
                 RefCell::new(unknown_spec),
             ))]))),
@@ -19853,15 +26406,15 @@ soond_steek()
         let callback_fn = Value::NativeFunction(callback_native);
         let mut callback_spec = DictValue::new();
         callback_spec.set(
-            Value::String("kind".to_string()),
-            Value::String("callback".to_string()),
+            Value::String("kind".into()),
+            Value::String("callback".into()),
         );
-        callback_spec.set(Value::String("fn".to_string()), callback_fn.clone());
+        callback_spec.set(Value::String("fn".into()), callback_fn.clone());
         let callback_list = Value::List(Rc::new(RefCell::new(vec![Value::Dict(Rc::new(
             RefCell::new(callback_spec),
         ))])));
         let mut callback_cfg = DictValue::new();
-        callback_cfg.set(Value::String("sinks".to_string()), callback_list);
+        callback_cfg.set(Value::String("sinks".into()), callback_list);
         interp
             .apply_log_config(Some(Value::Dict(Rc::new(RefCell::new(callback_cfg)))))
             .unwrap();
@@ -19869,53 +26422,38 @@ soond_steek()
 
         let mut sinks = Vec::new();
         let mut stderr_spec = DictValue::new();
-        stderr_spec.set(
-            Value::String("kind".to_string()),
-            Value::String("stderr".to_string()),
-        );
+        stderr_spec.set(Value::String("kind".into()), Value::String("stderr".into()));
         sinks.push(Value::Dict(Rc::new(RefCell::new(stderr_spec))));
 
         let mut stdout_spec = DictValue::new();
-        stdout_spec.set(
-            Value::String("kind".to_string()),
-            Value::String("stdout".to_string()),
-        );
+        stdout_spec.set(Value::String("kind".into()), Value::String("stdout".into()));
         sinks.push(Value::Dict(Rc::new(RefCell::new(stdout_spec))));
 
         let mut file_spec = DictValue::new();
+        file_spec.set(Value::String("kind".into()), Value::String("file".into()));
         file_spec.set(
-            Value::String("kind".to_string()),
-            Value::String("file".to_string()),
-        );
-        file_spec.set(
-            Value::String("path".to_string()),
-            Value::String("log.txt".to_string()),
+            Value::String("path".into()),
+            Value::String("log.txt".into()),
         );
-        file_spec.set(Value::String("append".to_string()), Value::Bool(false));
+        file_spec.set(Value::String("append".into()), Value::Bool(false));
         sinks.push(Value::Dict(Rc::new(RefCell::new(file_spec))));
 
         let mut mem_spec = DictValue::new();
-        mem_spec.set(
-            Value::String("kind".to_string()),
-            Value::String("memory".to_string()),
-        );
-        mem_spec.set(Value::String("max".to_string()), Value::Integer(4));
+        mem_spec.set(Value::String("kind".into()), Value::String("memory".into()));
+        mem_spec.set(Value::String("max".into()), Value::Integer(4));
         sinks.push(Value::Dict(Rc::new(RefCell::new(mem_spec))));
 
         let mut ok_cfg = DictValue::new();
-        ok_cfg.set(Value::String("level".to_string()), Value::Integer(2));
+        ok_cfg.set(Value::String("level".into()), Value::Integer(2));
         ok_cfg.set(
-            Value::String("filter".to_string()),
-            Value::String("blether".to_string()),
+            Value::String("filter".into()),
+            Value::String("blether".into()),
         );
+        ok_cfg.set(Value::String("format".into()), Value::String("json".into()));
+        ok_cfg.set(Value::String("color".into()), Value::Bool(true));
+        ok_cfg.set(Value::String("timestamps".into()), Value::Bool(false));
         ok_cfg.set(
-            Value::String("format".to_string()),
-            Value::String("json".to_string()),
-        );
-        ok_cfg.set(Value::String("color".to_string()), Value::Bool(true));
-        ok_cfg.set(Value::String("timestamps".to_string()), Value::Bool(false));
-        ok_cfg.set(
-            Value::String("sinks".to_string()),
+            Value::String("sinks".into()),
             Value::List(Rc::new(RefCell::new(sinks))),
         );
         interp
@@ -19950,19 +26488,16 @@ soond_steek()
         let _ = build_client_config(&cfg).unwrap();
 
         let mut dict = DictValue::new();
-        dict.set(Value::String("port".to_string()), Value::Integer(42));
+        dict.set(Value::String("port".into()), Value::Integer(42));
         assert_eq!(dict_get_u16(&dict, "port"), Some(42));
-        dict.set(Value::String("port".to_string()), Value::Integer(-1));
+        dict.set(Value::String("port".into()), Value::Integer(-1));
         assert_eq!(dict_get_u16(&dict, "port"), None);
-        dict.set(
-            Value::String("name".to_string()),
-            Value::String("x".to_string()),
-        );
+        dict.set(Value::String("name".into()), Value::String("x".into()));
         assert_eq!(dict_get_string(&dict, "name"), Some("x".to_string()));
-        dict.set(Value::String("flag".to_string()), Value::Bool(true));
+        dict.set(Value::String("flag".into()), Value::Bool(true));
         assert_eq!(dict_get_bool(&dict, "flag"), Some(true));
         dict.set(
-            Value::String("bytes".to_string()),
+            Value::String("bytes".into()),
             Value::Bytes(Rc::new(RefCell::new(vec![1, 2, 3]))),
         );
         assert_eq!(dict_get_bytes(&dict, "bytes"), Some(vec![1, 2, 3]));
@@ -20039,7 +26574,7 @@ soond_steek()
 	        // Cover event_loop_poll timeout parse error branch.
 	        let err = (event_loop_poll.func)(vec![
 	            Value::Integer(loop_id),
-	            Value::String("nope".to_string()),
+	            Value::String("nope".into()),
 	        ])
 	        .unwrap_err();
 	        assert!(err.contains("timeout"));
@@ -20240,10 +26775,10 @@ soond_steek()
 
 	        // log_span parses level, fields, and target
 	        let span = (log_span.func)(vec![
-	            Value::String("span".to_string()),
-	            Value::String("blether".to_string()),
+	            Value::String("span".into()),
+	            Value::String("blether".into()),
 	            Value::Dict(Rc::new(RefCell::new(DictValue::new()))),
-	            Value::String("target".to_string()),
+	            Value::String("target".into()),
 	        ])
 	        .unwrap();
 
@@ -20363,7 +26898,7 @@ d.bark()
 "#,
 	        )
 	        .unwrap();
-	        assert_eq!(result, Value::String("Woof!".to_string()));
+	        assert_eq!(result, Value::String("Woof!".into()));
 	    }
 
 	    #[test]
@@ -20449,6 +26984,7 @@ c + 1
 	            vec![Stmt::Return {
 	                value: Some(Expr::Variable {
 	                    name: "x".to_string(),
+	                    slot: None,
 	                    span: Span::new(1, 1),
 	                }),
 	                span: Span::new(1, 1),
@@ -20528,7 +27064,7 @@ c + 1
         for ev in list.borrow().iter() {
             if let Value::Dict(dict) = ev {
                 let dict = dict.borrow();
-                if let Some(Value::String(kind)) = dict.get(&Value::String("kind".to_string())) {
+                if let Some(Value::String(kind)) = dict.get(&Value::String("kind".into())) {
                     if kind == "write" {
                         saw_write = true;
                     }
@@ -20550,8 +27086,8 @@ c + 1
         let globals = interp.globals.clone();
         let log_event = native_from_globals(&globals, "log_event");
         assert!((log_event.func)(vec![
-            Value::String("blether".to_string()),
-            Value::String("msg".to_string())
+            Value::String("blether".into()),
+            Value::String("msg".into())
         ])
         .is_err());
 
@@ -20563,16 +27099,16 @@ c + 1
 
         let _guard = InterpreterGuard::new(&mut interp);
         let mut fields = DictValue::new();
-        fields.set(Value::String("k".to_string()), Value::Integer(1));
+        fields.set(Value::String("k".into()), Value::Integer(1));
         (log_event.func)(vec![
             Value::Integer(3),
-            Value::String("msg".to_string()),
+            Value::String("msg".into()),
             Value::Dict(Rc::new(RefCell::new(fields))),
-            Value::String("target".to_string()),
+            Value::String("target".into()),
         ])
         .unwrap();
 
-        let span = (log_span.func)(vec![Value::String("span".to_string())]).unwrap();
+        let span = (log_span.func)(vec![Value::String("span".into())]).unwrap();
 	        (log_span_enter.func)(vec![span.clone()]).unwrap();
 	        let current = (log_span_current.func)(vec![]).unwrap();
 	        let dummy: Rc<dyn NativeObject> = Rc::new(TestNative::new());
@@ -20589,23 +27125,17 @@ c + 1
     #[test]
     fn test_dict_get_helpers_mismatch_and_u16_float() {
         let mut dict = DictValue::new();
-        dict.set(Value::String("s".to_string()), Value::Integer(1));
-        dict.set(Value::String("b".to_string()), Value::Integer(1));
-        dict.set(
-            Value::String("bytes".to_string()),
-            Value::String("no".to_string()),
-        );
-        dict.set(Value::String("port".to_string()), Value::Float(123.0));
+        dict.set(Value::String("s".into()), Value::Integer(1));
+        dict.set(Value::String("b".into()), Value::Integer(1));
+        dict.set(Value::String("bytes".into()), Value::String("no".into()));
+        dict.set(Value::String("port".into()), Value::Float(123.0));
         assert_eq!(dict_get_string(&dict, "s"), None);
         assert_eq!(dict_get_bool(&dict, "b"), None);
         assert_eq!(dict_get_bytes(&dict, "bytes"), None);
         assert_eq!(dict_get_u16(&dict, "port"), Some(123));
 
-        dict.set(Value::String("port_neg".to_string()), Value::Float(-1.0));
-        dict.set(
-            Value::String("port_bad".to_string()),
-            Value::String("x".to_string()),
-        );
+        dict.set(Value::String("port_neg".into()), Value::Float(-1.0));
+        dict.set(Value::String("port_bad".into()), Value::String("x".into()));
         assert_eq!(dict_get_u16(&dict, "port_neg"), None);
         assert_eq!(dict_get_u16(&dict, "port_bad"), None);
     }
@@ -20618,7 +27148,7 @@ c + 1
 
         let mut dict = DictValue::new();
         dict.set(
-            Value::String("server_name".to_string()),
+            Value::String("server_name".into()),
             Value::String(String::new()),
         );
         let cfg = tls_config_from_value(&Value::Dict(Rc::new(RefCell::new(dict)))).unwrap();
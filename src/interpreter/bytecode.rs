@@ -0,0 +1,1342 @@
+//! Bytecode for function bodies
+//!
+//! The tree-walker looks every name up through a chain of `RefCell`'d hash maps. In
+//! bytecode mode a function body is compiled once, on its first call, to a flat list of
+//! ops over numbered local slots and a constant pool, and run on a small stack machine.
+//! Parameters and the `ken` and `fer` variables the body declares live in slots; any
+//! other name (globals, closure variables, `masel`) is still looked up by name in the
+//! function's environment, so the body sees what the tree-walker would.
+//!
+//! A body that declares functions, lambdas or classes (which capture the environment its
+//! locals would be in) or uses a construct the compiler doesn't cover is left to the
+//! tree-walker whole. Every op that can fail goes through the same helper the tree-walker
+//! uses, so errors come out the same in both modes.
+
+use std::cell::RefCell;
+use std::collections::HashMap;
+use std::rc::Rc;
+
+use super::{EnvSwapGuard, Interpreter};
+use crate::ast::{BinaryOp, Expr, FStringPart, Literal, LogicalOp, Stmt, UnaryOp};
+use crate::error::{HaversError, HaversResult};
+use crate::value::{Environment, HaversFunction, RangeIterator, RangeValue, Value};
+
+#[derive(Debug, Clone, Copy)]
+enum Op {
+    /// Push a constant
+    Constant(u32),
+    Nil,
+    Pop,
+    LoadLocal(u32),
+    /// Assign to a slot, leaving the value on the stack
+    StoreLocal(u32),
+    /// Pop into a slot
+    DefineLocal(u32),
+    /// A `fer` variable, which the tree-walker only defines once the loop runs; until then
+    /// the name means whatever it means outside
+    LoadLoopLocal {
+        slot: u32,
+        name: u32,
+        line: u32,
+    },
+    StoreLoopLocal {
+        slot: u32,
+        name: u32,
+        line: u32,
+    },
+    Unset(u32),
+    LoadName {
+        name: u32,
+        line: u32,
+    },
+    StoreName {
+        name: u32,
+        line: u32,
+    },
+    Binary {
+        op: BinaryOp,
+        line: u32,
+    },
+    Negate {
+        line: u32,
+    },
+    Not,
+    Jump(u32),
+    /// Pop the condition and jump if it's no truthy
+    JumpIfFalse(u32),
+    /// `an`: jump keeping a falsy left side, else pop it
+    JumpIfFalseOrPop(u32),
+    /// `or`: jump keeping a truthy left side, else pop it
+    JumpIfTrueOrPop(u32),
+    /// Callee then the arguments, or a list of them if `spread`
+    Call {
+        args: u32,
+        spread: bool,
+        line: u32,
+    },
+    /// Turn the object of `obj.name(...)` into a receiver and callee. Objects that
+    /// aren't instances or native objects get `obj.name` looked up, at `other` if the
+    /// tree-walker would evaluate the object twice
+    LoadMethod {
+        name: u32,
+        line: u32,
+        get_line: u32,
+        other: Option<u32>,
+    },
+    CallMethod {
+        name: u32,
+        args: u32,
+        spread: bool,
+        line: u32,
+    },
+    GetProperty {
+        name: u32,
+        line: u32,
+    },
+    SetProperty {
+        name: u32,
+        line: u32,
+    },
+    Index {
+        line: u32,
+    },
+    SetIndex {
+        line: u32,
+    },
+    List(u32),
+    /// Push a value onto the list under it
+    Push,
+    /// Spread a value into the list under it
+    Extend {
+        line: u32,
+        call: bool,
+    },
+    Dict(u32),
+    Range {
+        inclusive: bool,
+        line: u32,
+    },
+    /// Join the top values' text, for f-strings
+    Concat(u32),
+    Pipe {
+        line: u32,
+    },
+    Print,
+    /// Start a counted `fer` over `start..end`
+    RangeIter {
+        inclusive: bool,
+        line: u32,
+    },
+    /// Start a `fer` over `range(start, end)`, counted if `range` is the builtin
+    RangeCallIter {
+        line: u32,
+        for_line: u32,
+    },
+    Iter {
+        line: u32,
+    },
+    /// Store the next item in a slot, or drop the iterator and jump to `exit`
+    Next {
+        slot: u32,
+        exit: u32,
+    },
+    EndIter,
+    Return,
+}
+
+/// A compiled function body.
+#[derive(Debug)]
+pub(crate) struct Chunk {
+    code: Vec<Op>,
+    constants: Vec<Value>,
+    names: Vec<String>,
+    /// The slot each parameter is bound to
+    params: Vec<u32>,
+    slots: usize,
+}
+
+struct Local {
+    name: String,
+    slot: u32,
+    looped: bool,
+}
+
+struct Loop {
+    /// Where `haud` goes
+    top: usize,
+    /// `brak` jumps to patch once the loop's end is known
+    breaks: Vec<usize>,
+}
+
+struct Compiler {
+    code: Vec<Op>,
+    constants: Vec<Value>,
+    names: Vec<String>,
+    name_index: HashMap<String, u32>,
+    scopes: Vec<Vec<Local>>,
+    slots: u32,
+    loops: Vec<Loop>,
+}
+
+/// Compile `func`'s body, or `None` if it needs the tree-walker.
+pub(super) fn compile(func: &HaversFunction) -> Option<Chunk> {
+    let mut compiler = Compiler {
+        code: Vec::new(),
+        constants: Vec::new(),
+        names: Vec::new(),
+        name_index: HashMap::new(),
+        scopes: vec![Vec::new()],
+        slots: 0,
+        loops: Vec::new(),
+    };
+    let params = func
+        .params
+        .iter()
+        .map(|param| compiler.declare(&param.name, false))
+        .collect();
+    compiler.block(&func.body, true)?;
+    compiler.emit(Op::Return);
+    Some(Chunk {
+        code: compiler.code,
+        constants: compiler.constants,
+        names: compiler.names,
+        params,
+        slots: compiler.slots as usize,
+    })
+}
+
+fn line_of(expr: &Expr) -> u32 {
+    expr.span().line as u32
+}
+
+/// Whether evaluating `expr` twice is the same as evaluating it once
+fn stable(expr: &Expr) -> bool {
+    match expr {
+        Expr::Variable { .. } | Expr::Masel { .. } | Expr::Literal { .. } => true,
+        Expr::Grouping { expr, .. } => stable(expr),
+        _ => false,
+    }
+}
+
+impl Compiler {
+    fn emit(&mut self, op: Op) -> usize {
+        self.code.push(op);
+        self.code.len() - 1
+    }
+
+    fn here(&self) -> u32 {
+        self.code.len() as u32
+    }
+
+    /// Point the jump at `at` to the next op
+    fn patch(&mut self, at: usize) {
+        let target = self.here();
+        match &mut self.code[at] {
+            Op::Jump(to)
+            | Op::JumpIfFalse(to)
+            | Op::JumpIfFalseOrPop(to)
+            | Op::JumpIfTrueOrPop(to)
+            | Op::Next { exit: to, .. } => *to = target,
+            Op::LoadMethod { other, .. } => *other = Some(target),
+            op => unreachable!("patchin' {:?}", op),
+        }
+    }
+
+    fn constant(&mut self, value: Value) -> u32 {
+        self.constants.push(value);
+        (self.constants.len() - 1) as u32
+    }
+
+    fn name(&mut self, name: &str) -> u32 {
+        if let Some(&index) = self.name_index.get(name) {
+            return index;
+        }
+        let index = self.names.len() as u32;
+        self.names.push(name.to_string());
+        self.name_index.insert(name.to_string(), index);
+        index
+    }
+
+    /// A slot for `name` in the innermost scope; declaring it again there reuses it, as
+    /// `define` overwrites
+    fn declare(&mut self, name: &str, looped: bool) -> u32 {
+        let scope = self.scopes.last_mut().expect("function scope");
+        if let Some(local) = scope.iter().find(|local| local.name == name) {
+            return local.slot;
+        }
+        let slot = self.slots;
+        self.slots += 1;
+        scope.push(Local {
+            name: name.to_string(),
+            slot,
+            looped,
+        });
+        slot
+    }
+
+    fn resolve(&self, name: &str) -> Option<&Local> {
+        self.scopes
+            .iter()
+            .rev()
+            .find_map(|scope| scope.iter().find(|local| local.name == name))
+    }
+
+    fn load(&mut self, name: &str, line: u32) {
+        let index = self.name(name);
+        let op = match self.resolve(name) {
+            Some(local) if local.looped => Op::LoadLoopLocal {
+                slot: local.slot,
+                name: index,
+                line,
+            },
+            Some(local) => Op::LoadLocal(local.slot),
+            None => Op::LoadName { name: index, line },
+        };
+        self.emit(op);
+    }
+
+    fn store(&mut self, name: &str, line: u32) {
+        let index = self.name(name);
+        let op = match self.resolve(name) {
+            Some(local) if local.looped => Op::StoreLoopLocal {
+                slot: local.slot,
+                name: index,
+                line,
+            },
+            Some(local) => Op::StoreLocal(local.slot),
+            None => Op::StoreName { name: index, line },
+        };
+        self.emit(op);
+    }
+
+    /// Statements run one after another; if `tail`, the last one's value is left on the
+    /// stack as the tree-walker's block result
+    fn block(&mut self, stmts: &[Stmt], tail: bool) -> Option<()> {
+        if stmts.is_empty() && tail {
+            self.emit(Op::Nil);
+        }
+        for (i, stmt) in stmts.iter().enumerate() {
+            self.stmt(stmt, tail && i + 1 == stmts.len())?;
+        }
+        Some(())
+    }
+
+    fn stmt(&mut self, stmt: &Stmt, tail: bool) -> Option<()> {
+        match stmt {
+            Stmt::VarDecl {
+                name, initializer, ..
+            } => {
+                match initializer {
+                    Some(init) => self.expr(init)?,
+                    None => {
+                        self.emit(Op::Nil);
+                    }
+                }
+                let slot = self.declare(name, false);
+                self.emit(Op::DefineLocal(slot));
+                self.nil_if(tail);
+            }
+
+            Stmt::Expression { expr, .. } => {
+                self.expr(expr)?;
+                if !tail {
+                    self.emit(Op::Pop);
+                }
+            }
+
+            Stmt::Block { statements, .. } => {
+                self.scopes.push(Vec::new());
+                let compiled = self.block(statements, tail);
+                self.scopes.pop();
+                compiled?;
+            }
+
+            Stmt::If {
+                condition,
+                then_branch,
+                else_branch,
+                ..
+            } => {
+                self.expr(condition)?;
+                let to_else = self.emit(Op::JumpIfFalse(0));
+                self.stmt(then_branch, tail)?;
+                match else_branch {
+                    Some(else_branch) => {
+                        let to_end = self.emit(Op::Jump(0));
+                        self.patch(to_else);
+                        self.stmt(else_branch, tail)?;
+                        self.patch(to_end);
+                    }
+                    None if tail => {
+                        let to_end = self.emit(Op::Jump(0));
+                        self.patch(to_else);
+                        self.emit(Op::Nil);
+                        self.patch(to_end);
+                    }
+                    None => self.patch(to_else),
+                }
+            }
+
+            Stmt::While {
+                condition, body, ..
+            } => {
+                let top = self.code.len();
+                self.expr(condition)?;
+                let to_exit = self.emit(Op::JumpIfFalse(0));
+                self.loops.push(Loop {
+                    top,
+                    breaks: Vec::new(),
+                });
+                let compiled = self.stmt(body, false);
+                let finished = self.loops.pop().expect("loop");
+                compiled?;
+                self.emit(Op::Jump(top as u32));
+                self.patch(to_exit);
+                for at in finished.breaks {
+                    self.patch(at);
+                }
+                self.nil_if(tail);
+            }
+
+            Stmt::For {
+                variable,
+                iterable,
+                body,
+                span,
+            } => {
+                // The tree-walker defines the variable in the enclosing scope, but only
+                // once there's an item; until then an outer local of the same name would
+                // still show through, which slots can't do
+                let existing = self.scopes.last()?.iter().any(|l| l.name == *variable);
+                if !existing && self.resolve(variable).is_some() {
+                    return None;
+                }
+                // Clears anything left from the last time round an enclosing loop
+                let unset = (!existing).then(|| self.emit(Op::Unset(0)));
+                self.iterable(iterable, span.line as u32)?;
+                let slot = self.declare(variable, true);
+                if let Some(at) = unset {
+                    self.code[at] = Op::Unset(slot);
+                }
+                let top = self.code.len();
+                let next = self.emit(Op::Next { slot, exit: 0 });
+                self.loops.push(Loop {
+                    top,
+                    breaks: Vec::new(),
+                });
+                let compiled = self.stmt(body, false);
+                let finished = self.loops.pop().expect("loop");
+                compiled?;
+                self.emit(Op::Jump(top as u32));
+                for at in finished.breaks {
+                    self.patch(at);
+                }
+                self.emit(Op::EndIter);
+                self.patch(next);
+                self.nil_if(tail);
+            }
+
+            Stmt::Return { value, .. } => {
+                match value {
+                    Some(value) => self.expr(value)?,
+                    None => {
+                        self.emit(Op::Nil);
+                    }
+                }
+                self.emit(Op::Return);
+            }
+
+            Stmt::Print { value, .. } => {
+                self.expr(value)?;
+                self.emit(Op::Print);
+                self.nil_if(tail);
+            }
+
+            // Outside a loop, brak and haud end the function with nil, like the
+            // tree-walker
+            Stmt::Break { .. } if self.loops.is_empty() => self.return_nil(),
+            Stmt::Break { .. } => {
+                let at = self.emit(Op::Jump(0));
+                self.loops.last_mut().expect("loop").breaks.push(at);
+            }
+
+            Stmt::Continue { .. } => match self.loops.last() {
+                Some(lp) => {
+                    let top = lp.top as u32;
+                    self.emit(Op::Jump(top));
+                }
+                None => self.return_nil(),
+            },
+
+            Stmt::Function { .. }
+            | Stmt::Class { .. }
+            | Stmt::Struct { .. }
+            | Stmt::Import { .. }
+            | Stmt::TryCatch { .. }
+            | Stmt::Match { .. }
+            | Stmt::Assert { .. }
+            | Stmt::Destructure { .. }
+            | Stmt::Log { .. }
+            | Stmt::Hurl { .. } => return None,
+        }
+        Some(())
+    }
+
+    fn nil_if(&mut self, tail: bool) {
+        if tail {
+            self.emit(Op::Nil);
+        }
+    }
+
+    fn return_nil(&mut self) {
+        self.emit(Op::Nil);
+        self.emit(Op::Return);
+    }
+
+    /// Push the iterator for a `fer` loop, matching `fer_range` and the tree-walker's
+    /// fallback
+    fn iterable(&mut self, iterable: &Expr, for_line: u32) -> Option<()> {
+        match iterable {
+            Expr::Range {
+                start,
+                end,
+                inclusive,
+                span,
+            } => {
+                self.expr(start)?;
+                self.expr(end)?;
+                self.emit(Op::RangeIter {
+                    inclusive: *inclusive,
+                    line: span.line as u32,
+                });
+            }
+            Expr::Call {
+                callee,
+                arguments,
+                span,
+            } if arguments.len() == 2
+                && matches!(callee.as_ref(), Expr::Variable { name, .. } if name == "range")
+                && !arguments.iter().any(|a| matches!(a, Expr::Spread { .. })) =>
+            {
+                self.expr(callee)?;
+                self.expr(&arguments[0])?;
+                self.expr(&arguments[1])?;
+                self.emit(Op::RangeCallIter {
+                    line: span.line as u32,
+                    for_line,
+                });
+            }
+            _ => {
+                self.expr(iterable)?;
+                self.emit(Op::Iter { line: for_line });
+            }
+        }
+        Some(())
+    }
+
+    /// Arguments as separate values, or one list if any are spread; returns the count
+    /// and whether they were spread
+    fn arguments(&mut self, arguments: &[Expr]) -> Option<(u32, bool)> {
+        if !arguments.iter().any(|a| matches!(a, Expr::Spread { .. })) {
+            for arg in arguments {
+                self.expr(arg)?;
+            }
+            return Some((arguments.len() as u32, false));
+        }
+        self.spread_list(arguments, true)?;
+        Some((1, true))
+    }
+
+    fn spread_list(&mut self, elements: &[Expr], call: bool) -> Option<()> {
+        self.emit(Op::List(0));
+        for element in elements {
+            match element {
+                Expr::Spread { expr, span } => {
+                    self.expr(expr)?;
+                    self.emit(Op::Extend {
+                        line: span.line as u32,
+                        call,
+                    });
+                }
+                _ => {
+                    self.expr(element)?;
+                    self.emit(Op::Push);
+                }
+            }
+        }
+        Some(())
+    }
+
+    fn expr(&mut self, expr: &Expr) -> Option<()> {
+        match expr {
+            Expr::Literal { value, .. } => {
+                let value = match value {
+                    Literal::Integer(n) => Value::Integer(*n),
+                    Literal::Float(f) => Value::Float(*f),
+                    Literal::String(s) => Value::String(s.as_str().into()),
+                    Literal::Bool(b) => Value::Bool(*b),
+                    Literal::Nil => {
+                        self.emit(Op::Nil);
+                        return Some(());
+                    }
+                };
+                let index = self.constant(value);
+                self.emit(Op::Constant(index));
+            }
+
+            Expr::Variable { name, span, .. } => self.load(name, span.line as u32),
+
+            Expr::Masel { span } => self.load("masel", span.line as u32),
+
+            Expr::Assign {
+                name, value, span, ..
+            } => {
+                self.expr(value)?;
+                self.store(name, span.line as u32);
+            }
+
+            Expr::Binary {
+                left,
+                operator,
+                right,
+                span,
+            } => {
+                self.expr(left)?;
+                self.expr(right)?;
+                self.emit(Op::Binary {
+                    op: *operator,
+                    line: span.line as u32,
+                });
+            }
+
+            Expr::Unary {
+                operator,
+                operand,
+                span,
+            } => {
+                self.expr(operand)?;
+                self.emit(match operator {
+                    UnaryOp::Negate => Op::Negate {
+                        line: span.line as u32,
+                    },
+                    UnaryOp::Not => Op::Not,
+                });
+            }
+
+            Expr::Logical {
+                left,
+                operator,
+                right,
+                ..
+            } => {
+                self.expr(left)?;
+                let to_end = self.emit(match operator {
+                    LogicalOp::And => Op::JumpIfFalseOrPop(0),
+                    LogicalOp::Or => Op::JumpIfTrueOrPop(0),
+                });
+                self.expr(right)?;
+                self.patch(to_end);
+            }
+
+            Expr::Call {
+                callee,
+                arguments,
+                span,
+            } => {
+                let line = span.line as u32;
+                if let Expr::Get {
+                    object,
+                    property,
+                    span: get_span,
+                } = callee.as_ref()
+                {
+                    let name = self.name(property);
+                    self.expr(object)?;
+                    let load = self.emit(Op::LoadMethod {
+                        name,
+                        line,
+                        get_line: get_span.line as u32,
+                        other: None,
+                    });
+                    if !stable(object) {
+                        // The tree-walker evaluates `obj.name` afresh for these
+                        let to_args = self.emit(Op::Jump(0));
+                        self.patch(load);
+                        self.emit(Op::Nil);
+                        self.expr(callee)?;
+                        self.patch(to_args);
+                    }
+                    let (args, spread) = self.arguments(arguments)?;
+                    self.emit(Op::CallMethod {
+                        name,
+                        args,
+                        spread,
+                        line,
+                    });
+                } else {
+                    self.expr(callee)?;
+                    let (args, spread) = self.arguments(arguments)?;
+                    self.emit(Op::Call { args, spread, line });
+                }
+            }
+
+            Expr::Get {
+                object,
+                property,
+                span,
+            } => {
+                self.expr(object)?;
+                let name = self.name(property);
+                self.emit(Op::GetProperty {
+                    name,
+                    line: span.line as u32,
+                });
+            }
+
+            Expr::Set {
+                object,
+                property,
+                value,
+                span,
+            } => {
+                self.expr(object)?;
+                self.expr(value)?;
+                let name = self.name(property);
+                self.emit(Op::SetProperty {
+                    name,
+                    line: span.line as u32,
+                });
+            }
+
+            Expr::Index {
+                object,
+                index,
+                span,
+            } => {
+                self.expr(object)?;
+                self.expr(index)?;
+                self.emit(Op::Index {
+                    line: span.line as u32,
+                });
+            }
+
+            Expr::IndexSet {
+                object,
+                index,
+                value,
+                span,
+            } => {
+                self.expr(object)?;
+                self.expr(index)?;
+                self.expr(value)?;
+                self.emit(Op::SetIndex {
+                    line: span.line as u32,
+                });
+            }
+
+            Expr::List { elements, .. } => {
+                if elements.iter().any(|e| matches!(e, Expr::Spread { .. })) {
+                    self.spread_list(elements, false)?;
+                } else {
+                    for element in elements {
+                        self.expr(element)?;
+                    }
+                    self.emit(Op::List(elements.len() as u32));
+                }
+            }
+
+            Expr::Dict { pairs, .. } => {
+                for (key, value) in pairs {
+                    self.expr(key)?;
+                    self.expr(value)?;
+                }
+                self.emit(Op::Dict(pairs.len() as u32));
+            }
+
+            Expr::Range {
+                start,
+                end,
+                inclusive,
+                ..
+            } => {
+                self.expr(start)?;
+                self.expr(end)?;
+                self.emit(Op::Range {
+                    inclusive: *inclusive,
+                    line: line_of(expr),
+                });
+            }
+
+            Expr::Grouping { expr, .. } => self.expr(expr)?,
+
+            Expr::FString { parts, .. } => {
+                for part in parts {
+                    match part {
+                        FStringPart::Text(text) => {
+                            let index = self.constant(Value::String(text.as_str().into()));
+                            self.emit(Op::Constant(index));
+                        }
+                        FStringPart::Expr(expr) => self.expr(expr)?,
+                    }
+                }
+                self.emit(Op::Concat(parts.len() as u32));
+            }
+
+            Expr::Pipe { left, right, span } => {
+                self.expr(left)?;
+                self.expr(right)?;
+                self.emit(Op::Pipe {
+                    line: span.line as u32,
+                });
+            }
+
+            Expr::Ternary {
+                condition,
+                then_expr,
+                else_expr,
+                ..
+            } => {
+                self.expr(condition)?;
+                let to_else = self.emit(Op::JumpIfFalse(0));
+                self.expr(then_expr)?;
+                let to_end = self.emit(Op::Jump(0));
+                self.patch(to_else);
+                self.expr(else_expr)?;
+                self.patch(to_end);
+            }
+
+            Expr::Lambda { .. }
+            | Expr::BlockExpr { .. }
+            | Expr::Slice { .. }
+            | Expr::Input { .. }
+            | Expr::Spread { .. } => return None,
+        }
+        Some(())
+    }
+}
+
+/// A running `fer` loop's items
+enum Iter {
+    Range(RangeIterator),
+    Items(std::vec::IntoIter<Value>),
+}
+
+impl Iterator for Iter {
+    type Item = Value;
+
+    fn next(&mut self) -> Option<Value> {
+        match self {
+            Iter::Range(range) => range.next().map(Value::Integer),
+            Iter::Items(items) => items.next(),
+        }
+    }
+}
+
+/// The items of a `fer` loop over `value`, as the tree-walker takes them
+fn iter_of(value: Value, line: usize) -> HaversResult<Iter> {
+    match value {
+        Value::Range(range) => Ok(Iter::Range(range.iter())),
+        Value::List(list) => Ok(Iter::Items(list.borrow().clone().into_iter())),
+        Value::String(s) => Ok(Iter::Items(
+            s.chars()
+                .map(|c| Value::String(c.to_string().into()))
+                .collect::<Vec<_>>()
+                .into_iter(),
+        )),
+        _ => Err(HaversError::TypeError {
+            message: format!("Cannae iterate ower a {}", value.type_name()),
+            line,
+        }),
+    }
+}
+
+fn pop(stack: &mut Vec<Value>) -> Value {
+    stack.pop().expect("bytecode stack underflow")
+}
+
+/// The list a spread call's arguments were gathered into
+fn spread_args(list: Value) -> Vec<Value> {
+    match list {
+        Value::List(list) => Rc::try_unwrap(list)
+            .map(RefCell::into_inner)
+            .unwrap_or_else(|list| list.borrow().clone()),
+        other => unreachable!("spread arguments in a {}", other.type_name()),
+    }
+}
+
+impl Interpreter {
+    /// `func`'s bytecode, if bytecode mode is on and the body compiles. Tracing needs
+    /// the tree-walker.
+    pub(super) fn bytecode_for(&self, func: &HaversFunction) -> Option<Rc<Chunk>> {
+        if self.exec_mode != super::ExecMode::Bytecode || self.trace_mode != super::TraceMode::Off {
+            return None;
+        }
+        func.compiled
+            .get_or_init(|| compile(func).map(Rc::new))
+            .clone()
+    }
+
+    /// Call `func` through its bytecode, with `env` as the environment names the body
+    /// doesn't declare are looked up in.
+    pub(super) fn run_bytecode(
+        &mut self,
+        func: &HaversFunction,
+        chunk: &Chunk,
+        args: Vec<Value>,
+        env: Rc<RefCell<Environment>>,
+    ) -> HaversResult<Value> {
+        let mut slots: Vec<Option<Value>> = vec![None; chunk.slots];
+        let _env_guard = EnvSwapGuard::new(self, env.clone());
+        if args.len() < func.params.len() {
+            // Defaults can refer to earlier parameters, so bind them by name as well
+            for (i, param) in func.params.iter().enumerate() {
+                let value = match (args.get(i), &param.default) {
+                    (Some(arg), _) => arg.clone(),
+                    (None, Some(default_expr)) => self.evaluate(default_expr)?,
+                    (None, None) => Value::Nil,
+                };
+                env.borrow_mut().define(param.name.clone(), value.clone());
+                slots[chunk.params[i] as usize] = Some(value);
+            }
+        } else {
+            for (&slot, arg) in chunk.params.iter().zip(args) {
+                slots[slot as usize] = Some(arg);
+            }
+        }
+        self.run_chunk(chunk, slots, &env)
+    }
+
+    fn run_chunk(
+        &mut self,
+        chunk: &Chunk,
+        mut slots: Vec<Option<Value>>,
+        env: &Rc<RefCell<Environment>>,
+    ) -> HaversResult<Value> {
+        let mut stack: Vec<Value> = Vec::with_capacity(16);
+        let mut iters: Vec<Iter> = Vec::new();
+        let mut pc = 0;
+
+        let get_name = |name: u32, line: u32| {
+            let name = &chunk.names[name as usize];
+            env.borrow()
+                .get(name)
+                .ok_or_else(|| HaversError::UndefinedVariable {
+                    name: name.clone(),
+                    line: line as usize,
+                })
+        };
+        let set_name = |name: u32, value: Value, line: u32| {
+            let name = &chunk.names[name as usize];
+            if env.borrow_mut().assign(name, value) {
+                Ok(())
+            } else {
+                Err(HaversError::UndefinedVariable {
+                    name: name.clone(),
+                    line: line as usize,
+                })
+            }
+        };
+
+        loop {
+            let op = chunk.code[pc];
+            pc += 1;
+            match op {
+                Op::Constant(index) => stack.push(chunk.constants[index as usize].clone()),
+                Op::Nil => stack.push(Value::Nil),
+                Op::Pop => {
+                    stack.pop();
+                }
+                Op::LoadLocal(slot) => stack.push(
+                    slots[slot as usize]
+                        .clone()
+                        .expect("local read before its ken"),
+                ),
+                Op::StoreLocal(slot) => {
+                    let value = stack.last().expect("value tae store").clone();
+                    slots[slot as usize] = Some(value);
+                }
+                Op::DefineLocal(slot) => slots[slot as usize] = Some(pop(&mut stack)),
+                Op::LoadLoopLocal { slot, name, line } => match &slots[slot as usize] {
+                    Some(value) => stack.push(value.clone()),
+                    None => stack.push(get_name(name, line)?),
+                },
+                Op::StoreLoopLocal { slot, name, line } => {
+                    let value = stack.last().expect("value tae store").clone();
+                    match &mut slots[slot as usize] {
+                        Some(local) => *local = value,
+                        None => set_name(name, value, line)?,
+                    }
+                }
+                Op::Unset(slot) => slots[slot as usize] = None,
+                Op::LoadName { name, line } => stack.push(get_name(name, line)?),
+                Op::StoreName { name, line } => {
+                    let value = stack.last().expect("value tae store").clone();
+                    set_name(name, value, line)?;
+                }
+                Op::Binary { op, line } => {
+                    let right = pop(&mut stack);
+                    let left = pop(&mut stack);
+                    let value = self.binary_values(left, &op, right, line as usize)?;
+                    stack.push(value);
+                }
+                Op::Negate { line } => {
+                    let value = pop(&mut stack);
+                    stack.push(Self::negate_value(value, line as usize)?);
+                }
+                Op::Not => {
+                    let value = pop(&mut stack);
+                    stack.push(Value::Bool(!value.is_truthy()));
+                }
+                Op::Jump(to) => pc = to as usize,
+                Op::JumpIfFalse(to) => {
+                    if !pop(&mut stack).is_truthy() {
+                        pc = to as usize;
+                    }
+                }
+                Op::JumpIfFalseOrPop(to) => {
+                    if stack.last().expect("left side").is_truthy() {
+                        stack.pop();
+                    } else {
+                        pc = to as usize;
+                    }
+                }
+                Op::JumpIfTrueOrPop(to) => {
+                    if stack.last().expect("left side").is_truthy() {
+                        pc = to as usize;
+                    } else {
+                        stack.pop();
+                    }
+                }
+                Op::Call { args, spread, line } => {
+                    let args = if spread {
+                        spread_args(pop(&mut stack))
+                    } else {
+                        stack.split_off(stack.len() - args as usize)
+                    };
+                    let callee = pop(&mut stack);
+                    let value = self.call_value(callee, args, line as usize)?;
+                    stack.push(value);
+                }
+                Op::LoadMethod {
+                    name,
+                    line,
+                    get_line,
+                    other,
+                } => {
+                    let property = &chunk.names[name as usize];
+                    match pop(&mut stack) {
+                        obj @ Value::NativeObject(_) => {
+                            stack.push(obj);
+                            stack.push(Value::Nil);
+                        }
+                        Value::Instance(inst) => {
+                            let method = inst.borrow().class.find_method(property);
+                            if let Some(method) = method {
+                                stack.push(Value::Instance(inst));
+                                stack.push(Value::Function(method));
+                                continue;
+                            }
+                            let field = inst.borrow().fields.get(property).cloned();
+                            match field {
+                                Some(field) => {
+                                    stack.push(Value::Nil);
+                                    stack.push(field);
+                                }
+                                None => {
+                                    return Err(HaversError::UndefinedVariable {
+                                        name: property.clone(),
+                                        line: line as usize,
+                                    })
+                                }
+                            }
+                        }
+                        obj => match other {
+                            Some(to) => pc = to as usize,
+                            None => {
+                                let callee =
+                                    Self::property_value(obj, property, get_line as usize)?;
+                                stack.push(Value::Nil);
+                                stack.push(callee);
+                            }
+                        },
+                    }
+                }
+                Op::CallMethod {
+                    name,
+                    args,
+                    spread,
+                    line,
+                } => {
+                    let line = line as usize;
+                    let args = if spread {
+                        spread_args(pop(&mut stack))
+                    } else {
+                        stack.split_off(stack.len() - args as usize)
+                    };
+                    let callee = pop(&mut stack);
+                    let value = match (pop(&mut stack), callee) {
+                        (Value::NativeObject(native), _) => native
+                            .call(&chunk.names[name as usize], args)
+                            .map_err(|err| err.with_line_if_zero(line))?,
+                        (Value::Instance(inst), Value::Function(method)) => {
+                            let env = Rc::new(RefCell::new(Environment::with_enclosing(
+                                method.closure.clone().unwrap_or(self.globals.clone()),
+                            )));
+                            env.borrow_mut()
+                                .define("masel".to_string(), Value::Instance(inst));
+                            self.call_function_with_env(&method, args, env, line)?
+                        }
+                        (_, callee) => self.call_value(callee, args, line)?,
+                    };
+                    stack.push(value);
+                }
+                Op::GetProperty { name, line } => {
+                    let obj = pop(&mut stack);
+                    let property = &chunk.names[name as usize];
+                    stack.push(Self::property_value(obj, property, line as usize)?);
+                }
+                Op::SetProperty { name, line } => {
+                    let value = pop(&mut stack);
+                    let obj = pop(&mut stack);
+                    let property = &chunk.names[name as usize];
+                    let value = Self::set_property_value(obj, property, value, line as usize)?;
+                    stack.push(value);
+                }
+                Op::Index { line } => {
+                    let index = pop(&mut stack);
+                    let obj = pop(&mut stack);
+                    stack.push(Self::index_value(&obj, &index, line as usize)?);
+                }
+                Op::SetIndex { line } => {
+                    let value = pop(&mut stack);
+                    let index = pop(&mut stack);
+                    let obj = pop(&mut stack);
+                    let value = Self::set_index_value(&obj, &index, value, line as usize)?;
+                    stack.push(value);
+                }
+                Op::List(count) => {
+                    let items = stack.split_off(stack.len() - count as usize);
+                    stack.push(Value::List(Rc::new(RefCell::new(items))));
+                }
+                Op::Push => {
+                    let value = pop(&mut stack);
+                    if let Some(Value::List(list)) = stack.last() {
+                        list.borrow_mut().push(value);
+                    }
+                }
+                Op::Extend { line, call } => {
+                    let value = pop(&mut stack);
+                    let Some(Value::List(list)) = stack.last() else {
+                        unreachable!("skailin' intae a list");
+                    };
+                    match value {
+                        Value::List(items) => {
+                            let items = items.borrow().clone();
+                            list.borrow_mut().extend(items);
+                        }
+                        Value::String(s) if !call => list
+                            .borrow_mut()
+                            .extend(s.chars().map(|c| Value::String(c.to_string().into()))),
+                        _ => {
+                            let message = if call {
+                                "Cannae skail (spread) somethin' that isnae a list in function call!"
+                            } else {
+                                "Cannae skail (spread) somethin' that isnae a list or string!"
+                            };
+                            return Err(HaversError::TypeError {
+                                message: message.to_string(),
+                                line: line as usize,
+                            });
+                        }
+                    }
+                }
+                Op::Dict(count) => {
+                    let mut map = crate::value::DictValue::new();
+                    let items = stack.split_off(stack.len() - 2 * count as usize);
+                    let mut items = items.into_iter();
+                    while let (Some(key), Some(value)) = (items.next(), items.next()) {
+                        map.set(key, value);
+                    }
+                    stack.push(Value::Dict(Rc::new(RefCell::new(map))));
+                }
+                Op::Range { inclusive, line } => {
+                    let end = pop(&mut stack);
+                    let start = pop(&mut stack);
+                    match (start.as_integer(), end.as_integer()) {
+                        (Some(s), Some(e)) => stack.push(Self::range_to_list(s, e, inclusive)),
+                        _ => {
+                            return Err(HaversError::TypeError {
+                                message: "Range bounds must be integers".to_string(),
+                                line: line as usize,
+                            })
+                        }
+                    }
+                }
+                Op::Concat(count) => {
+                    let parts = stack.split_off(stack.len() - count as usize);
+                    let mut result = String::new();
+                    for part in parts {
+                        match part {
+                            Value::String(text) => result.push_str(&text),
+                            other => result.push_str(&other.to_string()),
+                        }
+                    }
+                    stack.push(Value::String(result.into()));
+                }
+                Op::Pipe { line } => {
+                    let right = pop(&mut stack);
+                    let left = pop(&mut stack);
+                    let value = self.call_value(right, vec![left], line as usize)?;
+                    stack.push(value);
+                }
+                Op::Print => {
+                    let output = format!("{}", pop(&mut stack));
+                    println!("{}", output);
+                    self.output.push(output);
+                }
+                Op::RangeIter { inclusive, line } => {
+                    let end = pop(&mut stack);
+                    let start = pop(&mut stack);
+                    match (start.as_integer(), end.as_integer()) {
+                        (Some(s), Some(e)) => {
+                            iters.push(Iter::Range(RangeValue::new(s, e, inclusive).iter()))
+                        }
+                        _ => {
+                            return Err(HaversError::TypeError {
+                                message: "Range bounds must be integers".to_string(),
+                                line: line as usize,
+                            })
+                        }
+                    }
+                }
+                Op::RangeCallIter { line, for_line } => {
+                    let end = pop(&mut stack);
+                    let start = pop(&mut stack);
+                    let callee = pop(&mut stack);
+                    let builtin =
+                        matches!(&callee, Value::NativeFunction(native) if native.name == "range");
+                    if !builtin {
+                        let value = self.call_value(callee, vec![start, end], line as usize)?;
+                        iters.push(iter_of(value, for_line as usize)?);
+                        continue;
+                    }
+                    match (start.as_integer(), end.as_integer()) {
+                        (Some(s), Some(e)) => {
+                            iters.push(Iter::Range(RangeValue::new(s, e, false).iter()))
+                        }
+                        _ => {
+                            return Err(HaversError::InternalError(
+                                "range() expects integers".to_string(),
+                            ))
+                        }
+                    }
+                }
+                Op::Iter { line } => {
+                    let value = pop(&mut stack);
+                    iters.push(iter_of(value, line as usize)?);
+                }
+                Op::Next { slot, exit } => match iters.last_mut().expect("fer loop").next() {
+                    Some(item) => slots[slot as usize] = Some(item),
+                    None => {
+                        iters.pop();
+                        pc = exit as usize;
+                    }
+                },
+                Op::EndIter => {
+                    iters.pop();
+                }
+                Op::Return => return Ok(pop(&mut stack)),
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::interpreter::ExecMode;
+    use crate::parser::parse;
+
+    fn run_in(mode: ExecMode, source: &str) -> Result<Vec<String>, String> {
+        let program = parse(source).unwrap_or_else(|err| panic!("{}: {}", source, err));
+        let mut interp = Interpreter::new();
+        interp.set_exec_mode(mode);
+        interp
+            .interpret(&program)
+            .map(|_| interp.get_output().to_vec())
+            .map_err(|err| err.to_string())
+    }
+
+    fn assert_same(source: &str) {
+        assert_eq!(
+            run_in(ExecMode::Tree, source),
+            run_in(ExecMode::Bytecode, source),
+            "{}",
+            source
+        );
+    }
+
+    fn compiles(source: &str) -> bool {
+        let program = parse(source).expect("parse");
+        let mut interp = Interpreter::new();
+        interp.interpret(&program).expect("run");
+        let f = interp.globals.borrow().get("f");
+        match f {
+            Some(Value::Function(func)) => compile(&func).is_some(),
+            other => panic!("f is {:?}", other),
+        }
+    }
+
+    #[test]
+    fn test_bytecode_matches_the_tree_walker() {
+        for source in [
+            "dae fib(n) {\n gin n < 2 { gie n }\n gie fib(n - 1) + fib(n - 2)\n}\nblether fib(15)",
+            "dae f(xs) {\n ken total = 0\n fer x in xs { total = total + x }\n gie total\n}\nblether f([1, 2, 3])",
+            "dae f() {\n ken out = []\n fer i in 0..10 {\n gin i % 2 == 0 { haud }\n gin i > 7 { brak }\n shove(out, i)\n }\n gie out\n}\nblether f()",
+            "dae f(n) {\n ken i = 0\n whiles aye {\n i = i + 1\n gin i >= n { brak }\n }\n i\n}\nblether f(5)",
+            "dae f(a, b = a * 2) { gie a + b }\nblether f(1)\nblether f(1, 1)",
+            "ken g = 10\ndae f() {\n g = g + 1\n ken g = 1\n gie g\n}\nblether f()\nblether g",
+            "dae f(x) {\n ken x = x + 1\n {\n ken x = 100\n }\n gie x\n}\nblether f(1)",
+            "dae f(d) { gie f\"{d['a']} an' {len(d)}\" }\nblether f({\"a\": 1})",
+            "dae f(s) { gie [...s, 1] }\nblether f(\"ab\")",
+            "dae f(x) { gie x an 1 or 2 }\nblether f(0)\nblether f(3)",
+            "dae f(x) { gin x > 1 { \"big\" } ither { \"wee\" } }\nblether f(2)\nblether f(0)",
+            "dae f() { brak }\nblether f()",
+            "kin Coonter {\n dae init() { masel.n = 0 }\n dae bump(by) { masel.n = masel.n + by\n gie masel }\n}\ndae f() {\n ken c = Coonter()\n c.bump(2).bump(3)\n gie c.n\n}\nblether f()",
+            "dae f(xs) {\n fer i in range(0, len(xs)) { xs[i] = xs[i] * 2 }\n gie xs\n}\nblether f([1, 2])",
+            "ken i = \"global\"\ndae f() {\n fer i in [] {}\n gie i\n}\nblether f()",
+            "dae f(x) { gie x |> tae_string }\nblether f(4)",
+        ] {
+            assert_same(source);
+        }
+    }
+
+    #[test]
+    fn test_bytecode_errors_match_the_tree_walker() {
+        for source in [
+            "dae f() { gie 1 + \"a\" - 2 }\nf()",
+            "dae f() { gie missing }\nf()",
+            "dae f() { nope = 1 }\nf()",
+            "dae f(xs) { gie xs[5] }\nf([1])",
+            "dae f() { gie 1 / 0 }\nf()",
+            "dae f() { gie -\"a\" }\nf()",
+            "dae f() { fer x in 5 {} }\nf()",
+            "dae f(a) { gie a }\nf(1, 2)",
+            "dae f() { gie len(...3) }\nf()",
+        ] {
+            let tree = run_in(ExecMode::Tree, source);
+            assert!(tree.is_err(), "{}", source);
+            assert_eq!(tree, run_in(ExecMode::Bytecode, source), "{}", source);
+        }
+    }
+
+    #[test]
+    fn test_bodies_that_capture_are_left_to_the_tree_walker() {
+        assert!(compiles("dae f(x) {\n ken y = x * 2\n gie y\n}"));
+        assert!(!compiles("dae f(x) { gie |y| x + y }"));
+        assert!(!compiles("dae f() {\n dae g() { gie 1 }\n gie g()\n}"));
+        assert!(!compiles("dae f(i) {\n gin aye { fer i in [1] {} }\n}"));
+        assert_same("dae f(i) {\n fer i in [] {}\n gie i\n}\nblether f(3)");
+        assert_same("dae f(x) {\n ken add = |y| x + y\n gie add(2)\n}\nblether f(1)");
+    }
+}
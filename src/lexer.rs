@@ -23,29 +23,33 @@ impl<'source> Lexer<'source> {
         }
     }
 
+    /// Move the line/column tracking up to byte offset pos. This works on bytes:
+    /// newlines are counted straight off the slice, and the column only needs the
+    /// bit after the last newline, where each byte that isn't a UTF-8 continuation
+    /// byte starts a new character.
     fn advance_to(&mut self, pos: usize) {
-        let slice = &self.source[self.cursor..pos];
-        for ch in slice.chars() {
-            if ch == '\n' {
-                self.line += 1;
-                self.column = 1;
-            } else {
-                self.column += 1;
+        let bytes = &self.source.as_bytes()[self.cursor..pos];
+        match bytes.iter().rposition(|&b| b == b'\n') {
+            Some(last) => {
+                self.line += bytes.iter().filter(|&&b| b == b'\n').count();
+                self.column = 1 + char_count(&bytes[last + 1..]);
             }
+            None => self.column += char_count(bytes),
         }
         self.cursor = pos;
     }
 
     /// Tokenize the whole source intae a vector
-    pub fn tokenize(&mut self) -> HaversResult<Vec<Token>> {
-        let mut tokens = Vec::new();
+    pub fn tokenize(&mut self) -> HaversResult<Vec<Token<'source>>> {
+        // Most tokens plus the space after them run to a few bytes
+        let mut tokens = Vec::with_capacity(self.source.len() / 4 + 1);
 
         while let Some(result) = self.logos.next() {
             let span = self.logos.span();
             self.advance_to(span.start);
             let token_line = self.line;
             let token_column = self.column;
-            let lexeme = self.logos.slice().to_string();
+            let lexeme = self.logos.slice();
 
             match result {
                 Ok(kind) => {
@@ -53,7 +57,7 @@ impl<'source> Lexer<'source> {
                 }
                 Err(_) => {
                     return Err(HaversError::UnkentToken {
-                        lexeme,
+                        lexeme: lexeme.to_string(),
                         line: token_line,
                         column: token_column,
                     });
@@ -70,8 +74,18 @@ impl<'source> Lexer<'source> {
     }
 }
 
+/// How many characters a run of UTF-8 bytes holds
+fn char_count(bytes: &[u8]) -> usize {
+    if bytes.is_ascii() {
+        bytes.len()
+    } else {
+        // Continuation bytes are 0b10xxxxxx, i.e. -64..-1 as i8
+        bytes.iter().filter(|&&b| (b as i8) >= -0x40).count()
+    }
+}
+
 /// Convenience function tae lex a string
-pub fn lex(source: &str) -> HaversResult<Vec<Token>> {
+pub fn lex(source: &str) -> HaversResult<Vec<Token<'_>>> {
     let mut lexer = Lexer::new(source);
     lexer.tokenize()
 }
@@ -215,4 +229,38 @@ greet(message)
             } if lexeme == "@"
         ));
     }
+
+    #[test]
+    fn test_lexemes_borrow_the_source_and_columns_skip_multibyte_chars() {
+        let tokens = lex("ken s = \"née\" # ünï\n  blether s").unwrap();
+        let lexemes: Vec<&str> = tokens.iter().map(|t| t.lexeme).collect();
+        assert_eq!(
+            lexemes,
+            ["ken", "s", "=", "\"née\"", "\n", "blether", "s", ""]
+        );
+        let positions: Vec<(usize, usize)> = tokens.iter().map(|t| (t.line, t.column)).collect();
+        assert_eq!(
+            positions,
+            [
+                (1, 1),
+                (1, 5),
+                (1, 7),
+                (1, 9),
+                (1, 20),
+                (2, 3),
+                (2, 11),
+                (2, 0)
+            ]
+        );
+
+        let err = lex("ken s = \"née\" # ünï\n\"ç\" @").unwrap_err();
+        assert!(matches!(
+            err,
+            HaversError::UnkentToken {
+                line: 2,
+                column: 5,
+                ..
+            }
+        ));
+    }
 }
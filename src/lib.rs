@@ -7,6 +7,7 @@
 
 pub mod ast;
 pub mod audio;
+pub mod binlog;
 pub mod compiler;
 pub mod error;
 pub mod formatter;
@@ -14,7 +15,11 @@ pub mod graphics;
 pub mod interpreter;
 pub mod lexer;
 pub mod logging;
+pub mod optimise;
+pub mod pack;
+pub mod parse_cache;
 pub mod parser;
+pub mod resolve;
 pub mod token;
 pub mod tri;
 pub mod value;
@@ -35,7 +40,7 @@ pub use value::Value;
 
 // LLVM compiler re-export
 #[cfg(feature = "llvm")]
-pub use llvm::LLVMCompiler;
+pub use llvm::{GcMode, LLVMCompiler, PgoMode};
 
 /// Run mdhavers source code and return the result
 ///
@@ -243,7 +248,7 @@ mod tests {
     #[test]
     fn test_run_string_operations() {
         let result = run(r#""Hello" + " " + "World""#).unwrap();
-        assert_eq!(result, Value::String("Hello World".to_string()));
+        assert_eq!(result, Value::String("Hello World".into()));
     }
 
     #[cfg(feature = "llvm")]
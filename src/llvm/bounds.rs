@@ -0,0 +1,298 @@
+//! In-bounds indexing for counted loops
+//!
+//! `fer i in 0..len(xs) { ... xs[i] ... }` only ever indexes between zero and the length
+//! the list had on entry. When nothing in the body can bind `i` or `xs` again, resize the
+//! list or slice it (which shares its items), that length and the items pointer hold for
+//! the whole loop, so codegen loads `MdhList.items` once before the loop and turns each
+//! `xs[i]` into a plain load or store with no negative-index fixup. Anything the body might
+//! do to the list through a call is ruled out by allowing only the inline conversion
+//! builtins.
+
+use crate::ast::{BinaryOp, DestructPattern, Expr, Literal, Pattern, Stmt};
+
+/// Builtins codegen compiles inline without touching any list.
+const PURE_BUILTINS: &[&str] = &[
+    "len",
+    "tae_string",
+    "tae_text",
+    "to_string",
+    "str",
+    "tae_int",
+    "tae_nummer",
+    "parse_int",
+    "to_int",
+    "int",
+    "tae_float",
+    "parse_float",
+    "to_float",
+    "float",
+    "tae_bool",
+];
+
+/// The list a counted loop indexes in bounds, and whether the body writes through it.
+#[derive(Debug, PartialEq, Eq)]
+pub struct IndexedLoop<'a> {
+    pub list: &'a str,
+    pub writes: bool,
+}
+
+fn non_negative_literal(expr: &Expr) -> Option<i64> {
+    match expr {
+        Expr::Literal {
+            value: Literal::Integer(n),
+            ..
+        } if *n >= 0 => Some(*n),
+        Expr::Grouping { expr, .. } => non_negative_literal(expr),
+        _ => None,
+    }
+}
+
+/// `len(xs)` for a variable `xs`, with the builtin `len`.
+fn len_of<'a>(expr: &'a Expr, user_function: &dyn Fn(&str) -> bool) -> Option<&'a str> {
+    match expr {
+        Expr::Call {
+            callee, arguments, ..
+        } => match (callee.as_ref(), arguments.as_slice()) {
+            (Expr::Variable { name: callee, .. }, [Expr::Variable { name, .. }])
+                if callee == "len" && !user_function("len") =>
+            {
+                Some(name)
+            }
+            _ => None,
+        },
+        Expr::Grouping { expr, .. } => len_of(expr, user_function),
+        _ => None,
+    }
+}
+
+struct Scan<'s> {
+    names: [&'s str; 2],
+    user_function: &'s dyn Fn(&str) -> bool,
+    writes: bool,
+}
+
+impl Scan<'_> {
+    fn binds(&self, name: &str) -> bool {
+        self.names.contains(&name)
+    }
+
+    fn stmts(&mut self, stmts: &[Stmt]) -> bool {
+        stmts.iter().all(|s| self.stmt(s))
+    }
+
+    fn stmt(&mut self, stmt: &Stmt) -> bool {
+        match stmt {
+            Stmt::VarDecl {
+                name, initializer, ..
+            } => !self.binds(name) && initializer.as_ref().map_or(true, |e| self.expr(e)),
+            Stmt::Expression { expr, .. } | Stmt::Print { value: expr, .. } => self.expr(expr),
+            Stmt::Block { statements, .. } => self.stmts(statements),
+            Stmt::If {
+                condition,
+                then_branch,
+                else_branch,
+                ..
+            } => {
+                self.expr(condition)
+                    && self.stmt(then_branch)
+                    && else_branch.as_ref().map_or(true, |s| self.stmt(s))
+            }
+            Stmt::While {
+                condition, body, ..
+            } => self.expr(condition) && self.stmt(body),
+            Stmt::For {
+                variable,
+                iterable,
+                body,
+                ..
+            } => !self.binds(variable) && self.expr(iterable) && self.stmt(body),
+            Stmt::Return { value, .. } => value.as_ref().map_or(true, |e| self.expr(e)),
+            Stmt::TryCatch {
+                try_block,
+                error_name,
+                catch_block,
+                ..
+            } => !self.binds(error_name) && self.stmt(try_block) && self.stmt(catch_block),
+            Stmt::Match { value, arms, .. } => {
+                self.expr(value)
+                    && arms.iter().all(|arm| {
+                        let pattern = match &arm.pattern {
+                            Pattern::Identifier(name) => !self.binds(name),
+                            Pattern::Range { start, end } => self.expr(start) && self.expr(end),
+                            Pattern::Literal(_) | Pattern::Wildcard => true,
+                        };
+                        pattern && self.stmt(&arm.body)
+                    })
+            }
+            Stmt::Assert {
+                condition, message, ..
+            } => self.expr(condition) && message.as_ref().map_or(true, |e| self.expr(e)),
+            Stmt::Destructure {
+                patterns, value, ..
+            } => {
+                patterns.iter().all(|pattern| match pattern {
+                    DestructPattern::Variable(name) | DestructPattern::Rest(name) => {
+                        !self.binds(name)
+                    }
+                    DestructPattern::Ignore => true,
+                }) && self.expr(value)
+            }
+            Stmt::Log {
+                message, extras, ..
+            } => self.expr(message) && extras.iter().all(|e| self.expr(e)),
+            Stmt::Hurl { message, .. } => self.expr(message),
+            Stmt::Break { .. } | Stmt::Continue { .. } => true,
+            // Declarations can capture the list and run later, from anywhere
+            Stmt::Function { .. } | Stmt::Class { .. } | Stmt::Struct { .. } => false,
+            Stmt::Import { .. } => false,
+        }
+    }
+
+    fn expr(&mut self, expr: &Expr) -> bool {
+        match expr {
+            Expr::Assign { name, value, .. } => !self.binds(name) && self.expr(value),
+            Expr::Call {
+                callee, arguments, ..
+            } => {
+                let pure = match callee.as_ref() {
+                    Expr::Variable { name, .. } => {
+                        PURE_BUILTINS.contains(&name.as_str()) && !(self.user_function)(name)
+                    }
+                    _ => false,
+                };
+                pure && arguments.iter().all(|a| self.expr(a))
+            }
+            Expr::IndexSet {
+                object,
+                index,
+                value,
+                ..
+            } => {
+                self.writes = true;
+                self.expr(object) && self.expr(index) && self.expr(value)
+            }
+            // Slices share the list's items; the rest may run arbitrary code
+            Expr::Slice { .. } | Expr::Set { .. } | Expr::Lambda { .. } | Expr::Pipe { .. } => {
+                false
+            }
+            Expr::Literal { .. } | Expr::Variable { .. } | Expr::Masel { .. } => true,
+            Expr::Binary { left, right, .. } | Expr::Logical { left, right, .. } => {
+                self.expr(left) && self.expr(right)
+            }
+            Expr::Unary { operand, .. } => self.expr(operand),
+            Expr::Get { object, .. } => self.expr(object),
+            Expr::Index { object, index, .. } => self.expr(object) && self.expr(index),
+            Expr::List { elements, .. } => elements.iter().all(|e| self.expr(e)),
+            Expr::Dict { pairs, .. } => pairs.iter().all(|(k, v)| self.expr(k) && self.expr(v)),
+            Expr::Range { start, end, .. } => self.expr(start) && self.expr(end),
+            Expr::Grouping { expr, .. } | Expr::Spread { expr, .. } => self.expr(expr),
+            Expr::Input { prompt, .. } => self.expr(prompt),
+            Expr::FString { parts, .. } => parts.iter().all(|part| match part {
+                crate::ast::FStringPart::Expr(expr) => self.expr(expr),
+                _ => true,
+            }),
+            Expr::Ternary {
+                condition,
+                then_expr,
+                else_expr,
+                ..
+            } => self.expr(condition) && self.expr(then_expr) && self.expr(else_expr),
+            Expr::BlockExpr { statements, .. } => self.stmts(statements),
+        }
+    }
+}
+
+/// The list `fer variable in start..end { body }` indexes in bounds with `variable`, if
+/// `start` is a non-negative literal, `end` is at most `len(list)` and the body leaves
+/// both names, and the list's length and items, alone. `user_function` says whether a
+/// name is a user function, which would shadow a builtin.
+pub fn indexed_loop<'a>(
+    variable: &'a str,
+    start: &Expr,
+    end: &'a Expr,
+    inclusive: bool,
+    body: &Stmt,
+    user_function: &dyn Fn(&str) -> bool,
+) -> Option<IndexedLoop<'a>> {
+    non_negative_literal(start)?;
+    // `end` is len(list) - taken; the last index reached is one less unless inclusive
+    let (list, taken) = match end {
+        Expr::Binary {
+            left,
+            operator: BinaryOp::Subtract,
+            right,
+            ..
+        } => (len_of(left, user_function)?, non_negative_literal(right)?),
+        _ => (len_of(end, user_function)?, 0),
+    };
+    if inclusive && taken == 0 {
+        return None;
+    }
+    if list == variable {
+        return None;
+    }
+    let mut scan = Scan {
+        names: [variable, list],
+        user_function,
+        writes: false,
+    };
+    if !scan.stmt(body) {
+        return None;
+    }
+    Some(IndexedLoop {
+        list,
+        writes: scan.writes,
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn loop_of(source: &str) -> Option<(String, bool)> {
+        let program = crate::parser::parse(source).expect("parse");
+        let no_functions = |_: &str| false;
+        program.statements.iter().find_map(|stmt| match stmt {
+            Stmt::For {
+                variable,
+                iterable:
+                    Expr::Range {
+                        start,
+                        end,
+                        inclusive,
+                        ..
+                    },
+                body,
+                ..
+            } => indexed_loop(variable, start, end, *inclusive, body, &no_functions)
+                .map(|found| (found.list.to_string(), found.writes)),
+            _ => None,
+        })
+    }
+
+    #[test]
+    fn test_counted_loops_over_a_list_are_in_bounds() {
+        assert_eq!(
+            loop_of("ken xs = [1, 2]\nfer i in 0..len(xs) {\n blether xs[i]\n}"),
+            Some(("xs".to_string(), false))
+        );
+        assert_eq!(
+            loop_of("ken xs = [1, 2]\nfer i in 1..=len(xs) - 1 {\n xs[i] = xs[i - 1]\n}"),
+            Some(("xs".to_string(), true))
+        );
+    }
+
+    #[test]
+    fn test_anything_that_can_move_the_list_is_refused() {
+        for source in [
+            "ken xs = [1]\nfer i in 0..=len(xs) {\n blether xs[i]\n}",
+            "ken xs = [1]\nfer i in 0..len(xs) {\n shove(xs, 1)\n}",
+            "ken xs = [1]\nfer i in 0..len(xs) {\n xs = [2]\n}",
+            "ken xs = [1]\nfer i in 0..len(xs) {\n i = 5\n}",
+            "ken xs = [1]\nfer i in 0..len(xs) {\n ken ys = xs[0:1]\n}",
+            "ken xs = [1]\nken n = 0\nfer i in n..len(xs) {\n blether xs[i]\n}",
+        ] {
+            assert_eq!(loop_of(source), None, "{}", source);
+        }
+    }
+}
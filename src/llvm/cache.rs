@@ -0,0 +1,186 @@
+//! Object cache for native builds
+//!
+//! A build's object file is kept in the parse cache directory (see
+//! [`crate::parse_cache::cache_dir`]) next to a manifest listing every source file codegen
+//! read, entry file and imports alike, with a hash of each. The pair is found again by the
+//! entry path, optimisation level, profile, heap and CPU profiling and crate version; if
+//! every file listed still hashes the same, the object is copied out and codegen and the
+//! LLVM pipeline are skipped.
+//!
+//! Imports are compiled into the entry file's module rather than to objects of their own,
+//! so a change to any file in the graph rebuilds the whole object.
+
+use std::fs;
+use std::path::{Path, PathBuf};
+
+use inkwell::OptimizationLevel;
+
+use crate::parse_cache::{cache_dir, hash_bytes, HASH_SEED};
+
+use super::compiler::PgoMode;
+
+const MANIFEST_HEADER: &str = "mdhavers-object 1";
+
+/// Where one build's object and manifest live.
+pub(super) struct ObjectKey {
+    source_path: PathBuf,
+    manifest: PathBuf,
+    object: PathBuf,
+}
+
+impl ObjectKey {
+    /// The cache slot for building `source_path`, or None when the build can't be cached:
+    /// caching is off, or the build is instrumented and must run its own codegen.
+    pub(super) fn new(
+        source_path: &Path,
+        opt_level: OptimizationLevel,
+        pgo: &PgoMode,
+        heap_profile: bool,
+        cpu_profile: bool,
+        link_runtime: bool,
+    ) -> Option<Self> {
+        let dir = cache_dir()?;
+        let source_path = source_path.canonicalize().ok()?;
+
+        let mut hash = hash_bytes(HASH_SEED, env!("CARGO_PKG_VERSION").as_bytes());
+        hash = hash_bytes(hash, source_path.to_string_lossy().as_bytes());
+        let opt: u8 = match opt_level {
+            OptimizationLevel::None => 0,
+            OptimizationLevel::Less => 1,
+            OptimizationLevel::Default => 2,
+            OptimizationLevel::Aggressive => 3,
+        };
+        let flags = [opt, link_runtime as u8, heap_profile as u8, cpu_profile as u8];
+        hash = hash_bytes(hash, &flags);
+        match pgo {
+            PgoMode::Off => {}
+            PgoMode::Generate => return None,
+            PgoMode::Use(profile) => {
+                // A fresh profile means fresh branch weights
+                hash = hash_bytes(hash, b"pgo");
+                hash = hash_bytes(hash, &fs::read(profile).ok()?);
+            }
+        }
+
+        let stem = format!("{:016x}", hash);
+        Some(ObjectKey {
+            source_path,
+            manifest: dir.join(format!("{}.mdhdeps", stem)),
+            object: dir.join(format!("{}.o", stem)),
+        })
+    }
+
+    /// Copy a still-current cached object to `output_path`. Returns whether the runtime
+    /// bitcode was linked into it, as the build that made it reported.
+    pub(super) fn fetch(&self, output_path: &Path) -> Option<bool> {
+        let manifest = fs::read_to_string(&self.manifest).ok()?;
+        let mut lines = manifest.lines();
+        if lines.next()? != MANIFEST_HEADER {
+            return None;
+        }
+        let runtime_linked = match lines.next()? {
+            "runtime 1" => true,
+            "runtime 0" => false,
+            _ => return None,
+        };
+        for line in lines {
+            let (hash, path) = line.split_once(' ')?;
+            let source = fs::read(path).ok()?;
+            if format!("{:016x}", hash_bytes(HASH_SEED, &source)) != hash {
+                return None;
+            }
+        }
+        fs::copy(&self.object, output_path).ok()?;
+        Some(runtime_linked)
+    }
+
+    /// Keep the object just written to `output_path`, built from the entry file and
+    /// `imports`. Best effort: a build that can't be cached still succeeded.
+    pub(super) fn store<'a>(
+        &'a self,
+        output_path: &Path,
+        imports: impl IntoIterator<Item = &'a Path>,
+        runtime_linked: bool,
+    ) {
+        let mut manifest = format!("{}\nruntime {}\n", MANIFEST_HEADER, runtime_linked as u8);
+        for path in std::iter::once(self.source_path.as_path()).chain(imports) {
+            let source = match fs::read(path) {
+                Ok(source) => source,
+                Err(_) => return,
+            };
+            manifest.push_str(&format!(
+                "{:016x} {}\n",
+                hash_bytes(HASH_SEED, &source),
+                path.display()
+            ));
+        }
+
+        let dir = match self.manifest.parent() {
+            Some(dir) => dir,
+            None => return,
+        };
+        // Object first, so a manifest never points at a missing or older object
+        let _ = fs::remove_file(&self.manifest);
+        if fs::create_dir_all(dir).is_err() || fs::copy(output_path, &self.object).is_err() {
+            return;
+        }
+        let tmp = self
+            .manifest
+            .with_extension(format!("tmp{}", std::process::id()));
+        if fs::write(&tmp, manifest).is_err() || fs::rename(&tmp, &self.manifest).is_err() {
+            let _ = fs::remove_file(&tmp);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn key_in(dir: &Path, source_path: PathBuf) -> ObjectKey {
+        ObjectKey {
+            source_path,
+            manifest: dir.join("build.mdhdeps"),
+            object: dir.join("build.o"),
+        }
+    }
+
+    #[test]
+    fn test_object_cache_round_trip_and_invalidation() {
+        let dir = tempfile::tempdir().unwrap();
+        let main = dir.path().join("main.braw");
+        let helper = dir.path().join("helper.braw");
+        fs::write(&main, "fetch \"helper\"\nblether greet()\n").unwrap();
+        fs::write(&helper, "dae greet() { gie \"hullo\" }\n").unwrap();
+        let built = dir.path().join("out.o");
+        fs::write(&built, b"object bytes").unwrap();
+
+        let key = key_in(dir.path(), main.clone());
+        let fetched = dir.path().join("again.o");
+        assert_eq!(key.fetch(&fetched), None);
+
+        key.store(&built, [helper.as_path()], true);
+        assert_eq!(key.fetch(&fetched), Some(true));
+        assert_eq!(fs::read(&fetched).unwrap(), b"object bytes");
+
+        // Touching an import, not just the entry file, makes the object stale
+        fs::write(&helper, "dae greet() { gie \"aye\" }\n").unwrap();
+        assert_eq!(key.fetch(&fetched), None);
+    }
+
+    #[test]
+    fn test_object_cache_misses_when_a_source_is_gone() {
+        let dir = tempfile::tempdir().unwrap();
+        let main = dir.path().join("main.braw");
+        fs::write(&main, "blether 1\n").unwrap();
+        let built = dir.path().join("out.o");
+        fs::write(&built, b"object bytes").unwrap();
+
+        let key = key_in(dir.path(), main.clone());
+        key.store(&built, [], false);
+        assert_eq!(key.fetch(&dir.path().join("again.o")), Some(false));
+
+        fs::remove_file(&main).unwrap();
+        assert_eq!(key.fetch(&dir.path().join("again.o")), None);
+    }
+}
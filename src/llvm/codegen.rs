@@ -17,6 +17,7 @@
 
 use std::collections::{HashMap, HashSet};
 use std::path::{Path, PathBuf};
+use std::rc::Rc;
 
 use inkwell::attributes::{Attribute, AttributeLoc};
 use inkwell::basic_block::BasicBlock;
@@ -25,7 +26,8 @@ use inkwell::context::Context;
 use inkwell::module::{Linkage, Module};
 use inkwell::types::BasicMetadataTypeEnum;
 use inkwell::values::{
-    BasicMetadataValueEnum, BasicValue, BasicValueEnum, FunctionValue, IntValue, PointerValue,
+    BasicMetadataValueEnum, BasicValue, BasicValueEnum, FunctionValue, InstructionOpcode, IntValue,
+    PointerValue, StructValue,
 };
 use inkwell::AddressSpace;
 use inkwell::IntPredicate;
@@ -35,8 +37,15 @@ use crate::ast::{
     Program, Span, Stmt, UnaryOp,
 };
 use crate::error::HaversError;
-
-use super::types::{MdhTypes, ValueTag};
+use crate::optimise;
+
+use super::heapprof::{self, HeapSites};
+use super::tailcall;
+use super::traces::FrameTable;
+use super::types::{
+    MdhTypes, ValueTag, DICT_ENTRY_SIZE, DICT_HEADER_SIZE, DICT_INDEX_MIN, DICT_TAIL_SIZE,
+    JMP_BUF_SIZE, STRING_HEADER_SIZE, STRING_MAGIC, STRING_MAGIC_OFFSET,
+};
 
 // Coverage note: llvm-cov counts each `*_or_else(|| ...)` closure as a separate function.
 // In this file, those closures are effectively unreachable in normal compilation (they only
@@ -64,11 +73,49 @@ struct LoopContext<'ctx> {
     continue_block: BasicBlock<'ctx>,
 }
 
+/// A list a counted loop indexes in bounds with its variable (see bounds.rs)
+struct IndexedList<'ctx> {
+    list: String,
+    /// `MdhList.items`, loaded (and unshared, if the body writes) before the loop
+    items: PointerValue<'ctx>,
+    /// The loop counter, which always equals the loop variable
+    counter: PointerValue<'ctx>,
+}
+
+/// A clone of a top-level function for concrete argument types (infer::specialize)
+struct Specialization<'ctx> {
+    name: String,
+    /// Int or Float where the argument is passed unboxed, Unknown for an MdhValue
+    params: Vec<VarType>,
+    /// Int or Float when every return is that unboxed number, else Unknown (an MdhValue)
+    returns: VarType,
+    locals: HashMap<String, VarType>,
+    function: FunctionValue<'ctx>,
+}
+
+/// Clones made of any one function, each for a different tuple of argument types
+const MAX_SPECIALIZATIONS: usize = 4;
+
+/// A registered class and the global its instances' headers point at. The global is
+/// `{ i8* name, i8* vtable }`; the vtable is filled in once every call site has asked
+/// for its slot (see `emit_class_tables`).
+struct ClassTable<'ctx> {
+    name: String,
+    name_ptr: PointerValue<'ctx>,
+    table: inkwell::values::GlobalValue<'ctx>,
+    /// Its own methods by name (not inherited ones)
+    methods: HashMap<String, FunctionValue<'ctx>>,
+    /// Index of the class it's declared `fae`, whose methods it inherits
+    parent: Option<usize>,
+}
+
 /// Libc functions we use
 #[allow(dead_code)]
 struct LibcFunctions<'ctx> {
     printf: FunctionValue<'ctx>,
     malloc: FunctionValue<'ctx>,
+    /// Pointer-free allocation (string bodies); never scanned by the collector
+    malloc_atomic: FunctionValue<'ctx>,
     realloc: FunctionValue<'ctx>,
     strlen: FunctionValue<'ctx>,
     strcpy: FunctionValue<'ctx>,
@@ -116,6 +163,7 @@ struct LibcFunctions<'ctx> {
     bytes_new: FunctionValue<'ctx>,
     bytes_from_string: FunctionValue<'ctx>,
     bytes_len: FunctionValue<'ctx>,
+    value_len: FunctionValue<'ctx>,
     bytes_slice: FunctionValue<'ctx>,
     bytes_get: FunctionValue<'ctx>,
     bytes_set: FunctionValue<'ctx>,
@@ -124,6 +172,19 @@ struct LibcFunctions<'ctx> {
     bytes_read_u32be: FunctionValue<'ctx>,
     bytes_write_u16be: FunctionValue<'ctx>,
     bytes_write_u32be: FunctionValue<'ctx>,
+    bytes_read_u16le: FunctionValue<'ctx>,
+    bytes_read_u32le: FunctionValue<'ctx>,
+    bytes_read_u64be: FunctionValue<'ctx>,
+    bytes_read_u64le: FunctionValue<'ctx>,
+    bytes_write_u16le: FunctionValue<'ctx>,
+    bytes_write_u32le: FunctionValue<'ctx>,
+    bytes_write_u64be: FunctionValue<'ctx>,
+    bytes_write_u64le: FunctionValue<'ctx>,
+    bytes_find: FunctionValue<'ctx>,
+    bytes_eq: FunctionValue<'ctx>,
+    bytes_xor: FunctionValue<'ctx>,
+    bytes_fill: FunctionValue<'ctx>,
+    bytes_copy_within: FunctionValue<'ctx>,
     mono_ms: FunctionValue<'ctx>,
     mono_ns: FunctionValue<'ctx>,
     // Audio runtime functions
@@ -188,33 +249,114 @@ struct LibcFunctions<'ctx> {
     socket_close: FunctionValue<'ctx>,
     udp_send_to: FunctionValue<'ctx>,
     udp_recv_from: FunctionValue<'ctx>,
+    udp_recv_many: FunctionValue<'ctx>,
+    udp_send_many: FunctionValue<'ctx>,
+    addr_resolve: FunctionValue<'ctx>,
     tcp_send: FunctionValue<'ctx>,
+    tcp_send_vec: FunctionValue<'ctx>,
+    tcp_send_all: FunctionValue<'ctx>,
+    socket_send_file: FunctionValue<'ctx>,
     tcp_recv: FunctionValue<'ctx>,
+    tcp_recv_into: FunctionValue<'ctx>,
+    udp_recv_into: FunctionValue<'ctx>,
+    bytes_pool_take: FunctionValue<'ctx>,
+    bytes_pool_give: FunctionValue<'ctx>,
+    base64_encode_native: FunctionValue<'ctx>,
+    base64_decode_native: FunctionValue<'ctx>,
+    hex_encode_native: FunctionValue<'ctx>,
+    hex_decode_native: FunctionValue<'ctx>,
+    sha256: FunctionValue<'ctx>,
+    sha1: FunctionValue<'ctx>,
+    crc32: FunctionValue<'ctx>,
+    xxhash64: FunctionValue<'ctx>,
     dns_lookup: FunctionValue<'ctx>,
     dns_srv: FunctionValue<'ctx>,
     dns_naptr: FunctionValue<'ctx>,
+    dns_lookup_async: FunctionValue<'ctx>,
+    dns_srv_async: FunctionValue<'ctx>,
+    dns_naptr_async: FunctionValue<'ctx>,
     tls_client_new: FunctionValue<'ctx>,
     tls_connect: FunctionValue<'ctx>,
+    tls_connect_start: FunctionValue<'ctx>,
+    tls_step: FunctionValue<'ctx>,
     tls_send: FunctionValue<'ctx>,
     tls_recv: FunctionValue<'ctx>,
     tls_close: FunctionValue<'ctx>,
+    tls_stats: FunctionValue<'ctx>,
     dtls_server_new: FunctionValue<'ctx>,
     dtls_handshake: FunctionValue<'ctx>,
+    dtls_session_new: FunctionValue<'ctx>,
+    dtls_session_step: FunctionValue<'ctx>,
+    dtls_session_srtp: FunctionValue<'ctx>,
+    dtls_session_close: FunctionValue<'ctx>,
     srtp_create: FunctionValue<'ctx>,
     srtp_protect: FunctionValue<'ctx>,
     srtp_unprotect: FunctionValue<'ctx>,
+    srtp_protect_into: FunctionValue<'ctx>,
+    srtp_unprotect_into: FunctionValue<'ctx>,
+    srtp_protect_many: FunctionValue<'ctx>,
+    srtp_unprotect_many: FunctionValue<'ctx>,
+    rtp_parse_native: FunctionValue<'ctx>,
+    rtp_build_native: FunctionValue<'ctx>,
+    sip_parse_native: FunctionValue<'ctx>,
+    sip_header: FunctionValue<'ctx>,
     event_loop_new: FunctionValue<'ctx>,
     event_loop_stop: FunctionValue<'ctx>,
     event_watch_read: FunctionValue<'ctx>,
     event_watch_write: FunctionValue<'ctx>,
     event_unwatch: FunctionValue<'ctx>,
     event_loop_poll: FunctionValue<'ctx>,
+    event_loop_poll_into: FunctionValue<'ctx>,
+    event_loop_run: FunctionValue<'ctx>,
     timer_after: FunctionValue<'ctx>,
     timer_every: FunctionValue<'ctx>,
     timer_cancel: FunctionValue<'ctx>,
+    timer_after_ns: FunctionValue<'ctx>,
+    timer_every_ns: FunctionValue<'ctx>,
+    co_spawn: FunctionValue<'ctx>,
+    co_yield: FunctionValue<'ctx>,
+    co_count: FunctionValue<'ctx>,
+    co_run: FunctionValue<'ctx>,
+    event_loop_wakeup: FunctionValue<'ctx>,
+    event_loop_post: FunctionValue<'ctx>,
+    reactor_start: FunctionValue<'ctx>,
+    reactor_stop: FunctionValue<'ctx>,
+    shm_ring_create: FunctionValue<'ctx>,
+    shm_ring_open: FunctionValue<'ctx>,
+    shm_ring_send: FunctionValue<'ctx>,
+    shm_ring_recv: FunctionValue<'ctx>,
+    shm_ring_recv_into: FunctionValue<'ctx>,
+    shm_ring_fd: FunctionValue<'ctx>,
+    shm_ring_close: FunctionValue<'ctx>,
+    kv_open: FunctionValue<'ctx>,
+    kv_get: FunctionValue<'ctx>,
+    kv_put: FunctionValue<'ctx>,
+    kv_delete: FunctionValue<'ctx>,
+    kv_scan: FunctionValue<'ctx>,
+    kv_sync: FunctionValue<'ctx>,
+    kv_compact: FunctionValue<'ctx>,
+    kv_stats: FunctionValue<'ctx>,
+    kv_close: FunctionValue<'ctx>,
+    http_parse_native: FunctionValue<'ctx>,
+    http_serve: FunctionValue<'ctx>,
+    http_request: FunctionValue<'ctx>,
+    http_pool_config: FunctionValue<'ctx>,
+    http_pool_stats: FunctionValue<'ctx>,
+    arena_push: FunctionValue<'ctx>,
+    arena_pop: FunctionValue<'ctx>,
+    runtime_stats: FunctionValue<'ctx>,
+    gc_config: FunctionValue<'ctx>,
+    gc_collect: FunctionValue<'ctx>,
+    gc_stats: FunctionValue<'ctx>,
     thread_spawn: FunctionValue<'ctx>,
+    cpu_count: FunctionValue<'ctx>,
+    numa_node_of_cpu: FunctionValue<'ctx>,
     thread_join: FunctionValue<'ctx>,
     thread_detach: FunctionValue<'ctx>,
+    pool_submit: FunctionValue<'ctx>,
+    parallel_map: FunctionValue<'ctx>,
+    parallel_filter: FunctionValue<'ctx>,
+    parallel_reduce: FunctionValue<'ctx>,
     mutex_new: FunctionValue<'ctx>,
     mutex_lock: FunctionValue<'ctx>,
     mutex_unlock: FunctionValue<'ctx>,
@@ -229,10 +371,19 @@ struct LibcFunctions<'ctx> {
     atomic_store: FunctionValue<'ctx>,
     atomic_add: FunctionValue<'ctx>,
     atomic_cas: FunctionValue<'ctx>,
+    atomic_load_acquire: FunctionValue<'ctx>,
+    atomic_store_release: FunctionValue<'ctx>,
+    atomic_fetch_max: FunctionValue<'ctx>,
+    atomic_fetch_min: FunctionValue<'ctx>,
     chan_new: FunctionValue<'ctx>,
     chan_send: FunctionValue<'ctx>,
     chan_recv: FunctionValue<'ctx>,
     chan_try_recv: FunctionValue<'ctx>,
+    chan_recv_timeout: FunctionValue<'ctx>,
+    chan_send_many: FunctionValue<'ctx>,
+    chan_recv_many: FunctionValue<'ctx>,
+    chan_select: FunctionValue<'ctx>,
+    chan_fd: FunctionValue<'ctx>,
     chan_close: FunctionValue<'ctx>,
     chan_is_closed: FunctionValue<'ctx>,
     key_not_found: FunctionValue<'ctx>,
@@ -240,6 +391,9 @@ struct LibcFunctions<'ctx> {
     random: FunctionValue<'ctx>,
     jammy: FunctionValue<'ctx>,
     random_int: FunctionValue<'ctx>,
+    random_float: FunctionValue<'ctx>,
+    seed: FunctionValue<'ctx>,
+    random_list: FunctionValue<'ctx>,
     term_width: FunctionValue<'ctx>,
     term_height: FunctionValue<'ctx>,
     // Dict/Creel runtime functions
@@ -268,7 +422,21 @@ struct LibcFunctions<'ctx> {
     scrieve: FunctionValue<'ctx>,
     scrieve_append: FunctionValue<'ctx>,
     lines: FunctionValue<'ctx>,
+    file_map: FunctionValue<'ctx>,
+    lines_iter: FunctionValue<'ctx>,
+    lines_next: FunctionValue<'ctx>,
+    lines_close: FunctionValue<'ctx>,
+    file_open: FunctionValue<'ctx>,
+    file_write: FunctionValue<'ctx>,
+    file_write_lines: FunctionValue<'ctx>,
+    file_flush: FunctionValue<'ctx>,
+    file_close: FunctionValue<'ctx>,
+    slurp_bytes: FunctionValue<'ctx>,
+    scrieve_bytes: FunctionValue<'ctx>,
     words: FunctionValue<'ctx>,
+    split: FunctionValue<'ctx>,
+    str_char_at: FunctionValue<'ctx>,
+    str_char_count: FunctionValue<'ctx>,
     // Environment/system runtime functions
     set_args: FunctionValue<'ctx>,
     args: FunctionValue<'ctx>,
@@ -280,6 +448,13 @@ struct LibcFunctions<'ctx> {
     path_join: FunctionValue<'ctx>,
     shell: FunctionValue<'ctx>,
     shell_status: FunctionValue<'ctx>,
+    spawn: FunctionValue<'ctx>,
+    process_spawn: FunctionValue<'ctx>,
+    process_read: FunctionValue<'ctx>,
+    process_write: FunctionValue<'ctx>,
+    process_watch: FunctionValue<'ctx>,
+    process_wait: FunctionValue<'ctx>,
+    process_kill: FunctionValue<'ctx>,
     // Date/time runtime functions
     date_now: FunctionValue<'ctx>,
     date_format: FunctionValue<'ctx>,
@@ -287,6 +462,8 @@ struct LibcFunctions<'ctx> {
     date_add: FunctionValue<'ctx>,
     date_diff: FunctionValue<'ctx>,
     braw_date: FunctionValue<'ctx>,
+    date_now_ts: FunctionValue<'ctx>,
+    date_fields: FunctionValue<'ctx>,
     // Regex runtime functions
     regex_test: FunctionValue<'ctx>,
     regex_match: FunctionValue<'ctx>,
@@ -294,10 +471,31 @@ struct LibcFunctions<'ctx> {
     regex_replace: FunctionValue<'ctx>,
     regex_replace_first: FunctionValue<'ctx>,
     regex_split: FunctionValue<'ctx>,
+    regex_compile: FunctionValue<'ctx>,
+    regex_set_new: FunctionValue<'ctx>,
+    regex_set_match: FunctionValue<'ctx>,
     // JSON runtime functions
     json_parse: FunctionValue<'ctx>,
     json_stringify: FunctionValue<'ctx>,
     json_pretty: FunctionValue<'ctx>,
+    json_write_into: FunctionValue<'ctx>,
+    json_stream_open: FunctionValue<'ctx>,
+    json_stream_new: FunctionValue<'ctx>,
+    json_stream_feed: FunctionValue<'ctx>,
+    json_stream_next: FunctionValue<'ctx>,
+    json_stream_close: FunctionValue<'ctx>,
+    pack: FunctionValue<'ctx>,
+    pack_into: FunctionValue<'ctx>,
+    unpack: FunctionValue<'ctx>,
+    unpack_stream_new: FunctionValue<'ctx>,
+    unpack_stream_feed: FunctionValue<'ctx>,
+    unpack_stream_next: FunctionValue<'ctx>,
+    bytes_compress: FunctionValue<'ctx>,
+    bytes_decompress: FunctionValue<'ctx>,
+    gzip_stream_new: FunctionValue<'ctx>,
+    gzip_stream_write: FunctionValue<'ctx>,
+    gzip_stream_flush: FunctionValue<'ctx>,
+    gzip_stream_close: FunctionValue<'ctx>,
     // Misc parity helpers
     is_a: FunctionValue<'ctx>,
     wrang_sort: FunctionValue<'ctx>,
@@ -348,6 +546,9 @@ struct LibcFunctions<'ctx> {
     tattie_scone: FunctionValue<'ctx>,
     haggis_hunt: FunctionValue<'ctx>,
     blether_format: FunctionValue<'ctx>,
+    blether_format_at: FunctionValue<'ctx>,
+    format_compile: FunctionValue<'ctx>,
+    format_apply: FunctionValue<'ctx>,
     bampot_mode: FunctionValue<'ctx>,
     // Logging/Debug runtime functions
     get_log_level: FunctionValue<'ctx>,
@@ -356,11 +557,15 @@ struct LibcFunctions<'ctx> {
     log_enabled: FunctionValue<'ctx>,
     log_set_filter: FunctionValue<'ctx>,
     log_get_filter: FunctionValue<'ctx>,
+    log_flush: FunctionValue<'ctx>,
+    log_dropped: FunctionValue<'ctx>,
     log_span_begin: FunctionValue<'ctx>,
     log_span_enter: FunctionValue<'ctx>,
     log_span_exit: FunctionValue<'ctx>,
     log_span_current: FunctionValue<'ctx>,
     log_span_in: FunctionValue<'ctx>,
+    log_span_stats: FunctionValue<'ctx>,
+    log_span_export: FunctionValue<'ctx>,
     log_init: FunctionValue<'ctx>,
     // Scots builtin runtime functions
     slainte: FunctionValue<'ctx>,
@@ -389,13 +594,83 @@ struct LibcFunctions<'ctx> {
     replace_first: FunctionValue<'ctx>,
     unique: FunctionValue<'ctx>,
     average: FunctionValue<'ctx>,
+    int_array: FunctionValue<'ctx>,
+    float_array: FunctionValue<'ctx>,
+    array_tae_list: FunctionValue<'ctx>,
+    array_sum: FunctionValue<'ctx>,
+    array_average: FunctionValue<'ctx>,
+    array_min: FunctionValue<'ctx>,
+    array_max: FunctionValue<'ctx>,
+    array_dot: FunctionValue<'ctx>,
+    array_add: FunctionValue<'ctx>,
+    array_sub: FunctionValue<'ctx>,
+    array_mul: FunctionValue<'ctx>,
+    array_div: FunctionValue<'ctx>,
+    deque_new: FunctionValue<'ctx>,
+    deque_push_back: FunctionValue<'ctx>,
+    deque_push_front: FunctionValue<'ctx>,
+    deque_pop_front: FunctionValue<'ctx>,
+    deque_pop_back: FunctionValue<'ctx>,
+    deque_front: FunctionValue<'ctx>,
+    deque_back: FunctionValue<'ctx>,
+    deque_clear: FunctionValue<'ctx>,
+    deque_tae_list: FunctionValue<'ctx>,
+    heap_new: FunctionValue<'ctx>,
+    heap_push: FunctionValue<'ctx>,
+    heap_pop: FunctionValue<'ctx>,
+    heap_peek: FunctionValue<'ctx>,
+    heap_tae_list: FunctionValue<'ctx>,
+    native_iter_list: FunctionValue<'ctx>,
+    hash: FunctionValue<'ctx>,
+    hashmap_new: FunctionValue<'ctx>,
+    hashmap_set: FunctionValue<'ctx>,
+    hashmap_get: FunctionValue<'ctx>,
+    hashmap_has: FunctionValue<'ctx>,
+    hashmap_remove: FunctionValue<'ctx>,
+    hashmap_keys: FunctionValue<'ctx>,
+    memoize: FunctionValue<'ctx>,
+    frozen_dict_new: FunctionValue<'ctx>,
+    frozen_list_new: FunctionValue<'ctx>,
+    frozen_set: FunctionValue<'ctx>,
+    frozen_remove: FunctionValue<'ctx>,
+    frozen_push: FunctionValue<'ctx>,
+    thaw: FunctionValue<'ctx>,
+    mat_from_rows: FunctionValue<'ctx>,
+    mat_tae_rows: FunctionValue<'ctx>,
+    mat_new: FunctionValue<'ctx>,
+    mat_identity: FunctionValue<'ctx>,
+    mat_shape: FunctionValue<'ctx>,
+    mat_get: FunctionValue<'ctx>,
+    mat_set: FunctionValue<'ctx>,
+    mat_add: FunctionValue<'ctx>,
+    mat_sub: FunctionValue<'ctx>,
+    mat_scale: FunctionValue<'ctx>,
+    mat_transpose: FunctionValue<'ctx>,
+    mat_matmul: FunctionValue<'ctx>,
+    mat_solve: FunctionValue<'ctx>,
+    mat_det: FunctionValue<'ctx>,
+    table_parse_csv: FunctionValue<'ctx>,
+    table_join: FunctionValue<'ctx>,
+    table_group: FunctionValue<'ctx>,
+    table_widths: FunctionValue<'ctx>,
+    strbuf_new: FunctionValue<'ctx>,
+    strbuf_append: FunctionValue<'ctx>,
+    strbuf_append_int: FunctionValue<'ctx>,
+    strbuf_append_float: FunctionValue<'ctx>,
+    strbuf_len: FunctionValue<'ctx>,
+    strbuf_clear: FunctionValue<'ctx>,
+    strbuf_build: FunctionValue<'ctx>,
+    list_with_capacity: FunctionValue<'ctx>,
+    reserve: FunctionValue<'ctx>,
+    list_extend: FunctionValue<'ctx>,
+    list_concat: FunctionValue<'ctx>,
     chynge: FunctionValue<'ctx>,
     // Testing runtime functions
     assert_fn: FunctionValue<'ctx>,
     skip: FunctionValue<'ctx>,
     stacktrace: FunctionValue<'ctx>,
+    hurl_stacktrace: FunctionValue<'ctx>,
     // Exceptions (try/catch/hurl)
-    jmp_buf_size: FunctionValue<'ctx>,
     try_push: FunctionValue<'ctx>,
     try_pop: FunctionValue<'ctx>,
     setjmp: FunctionValue<'ctx>,
@@ -404,6 +679,8 @@ struct LibcFunctions<'ctx> {
     // Additional Scots runtime functions
     muckle: FunctionValue<'ctx>,
     median: FunctionValue<'ctx>,
+    percentile: FunctionValue<'ctx>,
+    list_stats: FunctionValue<'ctx>,
     is_space: FunctionValue<'ctx>,
     is_digit: FunctionValue<'ctx>,
     wheesht_aw: FunctionValue<'ctx>,
@@ -416,6 +693,10 @@ struct LibcFunctions<'ctx> {
     speir: FunctionValue<'ctx>,
     // Generic print function for complex types
     blether: FunctionValue<'ctx>,
+    blether_str: FunctionValue<'ctx>,
+    blether_int: FunctionValue<'ctx>,
+    blether_float: FunctionValue<'ctx>,
+    flush: FunctionValue<'ctx>,
     // List operations
     list_push: FunctionValue<'ctx>,
     list_contains: FunctionValue<'ctx>,
@@ -424,8 +705,10 @@ struct LibcFunctions<'ctx> {
     list_min: FunctionValue<'ctx>,
     list_max: FunctionValue<'ctx>,
     list_sort: FunctionValue<'ctx>,
+    list_sort_by_keys: FunctionValue<'ctx>,
     list_uniq: FunctionValue<'ctx>,
     list_slice: FunctionValue<'ctx>,
+    list_unshare: FunctionValue<'ctx>,
     // Dict operations
     dict_keys: FunctionValue<'ctx>,
     dict_values: FunctionValue<'ctx>,
@@ -433,6 +716,8 @@ struct LibcFunctions<'ctx> {
     dict_get: FunctionValue<'ctx>,
     dict_get_default: FunctionValue<'ctx>,
     dict_merge: FunctionValue<'ctx>,
+    dict_update: FunctionValue<'ctx>,
+    dict_sized: FunctionValue<'ctx>,
     dict_remove: FunctionValue<'ctx>,
     dict_invert: FunctionValue<'ctx>,
     fae_pairs: FunctionValue<'ctx>,
@@ -473,10 +758,9 @@ struct ImportBindings<'ctx> {
     functions: HashSet<String>,
     classes: HashSet<String>,
     function_bindings: HashMap<String, FunctionValue<'ctx>>,
-    function_defaults: HashMap<String, Vec<Option<Expr>>>,
+    function_defaults: HashMap<String, Rc<[Option<Expr>]>>,
     function_captures: HashMap<String, Vec<String>>,
-    class_bindings: HashMap<String, inkwell::values::GlobalValue<'ctx>>,
-    class_method_bindings: HashMap<String, Vec<(String, FunctionValue<'ctx>)>>,
+    class_bindings: HashMap<String, usize>,
 }
 
 /// Character class for string classification functions
@@ -515,7 +799,8 @@ pub struct CodeGen<'ctx> {
     string_len_shadows: HashMap<String, PointerValue<'ctx>>,
 
     /// Shadow capacity storage for string variables (optimization)
-    /// Stores the allocated buffer capacity for in-place appending
+    /// Two i64 slots: the allocated buffer capacity for in-place appending, and the buffer
+    /// it belongs to (the capacity only counts while the variable still holds that buffer)
     string_cap_shadows: HashMap<String, PointerValue<'ctx>>,
 
     /// Shadow pointer storage for list variables (optimization)
@@ -530,21 +815,46 @@ pub struct CodeGen<'ctx> {
     /// Inferred types for variables (for optimization)
     var_types: HashMap<String, VarType>,
 
+    /// Variables of the body being compiled proven always int or always float (infer.rs);
+    /// only these keep an Int or Float entry in `var_types`
+    numeric_locals: HashMap<String, VarType>,
+
     /// Track which class a variable holds (for method dispatch)
     variable_class_types: HashMap<String, String>,
 
     /// User-defined functions
     functions: HashMap<String, FunctionValue<'ctx>>,
 
-    /// Default parameter values for functions (name -> vec of optional exprs)
-    function_defaults: HashMap<String, Vec<Option<Expr>>>,
+    /// Default parameter values for functions (name -> optional expr per parameter); shared,
+    /// so a call site padding its arguments doesn't copy the expressions
+    function_defaults: HashMap<String, Rc<[Option<Expr>]>>,
 
     /// Captured variables for closures/nested functions (func_name -> [var_name])
     function_captures: HashMap<String, Vec<String>>,
 
+    /// The lambda last compiled, and the lambdas variables were declared with (keyed by the
+    /// variable's storage), so a call through such a variable can go straight to its lambda
+    last_lambda: Option<FunctionValue<'ctx>>,
+    known_lambdas: HashMap<PointerValue<'ctx>, FunctionValue<'ctx>>,
+
+    /// Top-level functions that may be cloned for the argument types of a call site
+    specializable: HashMap<String, (FunctionValue<'ctx>, Vec<crate::ast::Param>, Vec<Stmt>)>,
+
+    /// Clones of those functions, in the order call sites asked for them
+    specializations: Vec<Specialization<'ctx>>,
+
+    /// Unboxed type the function being compiled returns (Unknown: an MdhValue)
+    return_type: VarType,
+
     /// Loop context stack for break/continue
     loop_stack: Vec<LoopContext<'ctx>>,
 
+    /// Counted loops in progress whose variable indexes a list in bounds, by loop variable
+    indexed_loops: HashMap<String, IndexedList<'ctx>>,
+
+    /// One key string per instance field name, so a key can be recognised by its pointer
+    instance_keys: HashMap<String, PointerValue<'ctx>>,
+
     /// Track if we're in a hot loop body (skip MdhValue stores)
     in_loop_body: bool,
 
@@ -563,11 +873,14 @@ pub struct CodeGen<'ctx> {
     /// Counter for generating unique import prefixes
     import_unique_counter: usize,
 
-    /// Class definitions: name -> global variable holding class data pointer
-    classes: HashMap<String, inkwell::values::GlobalValue<'ctx>>,
+    /// Class definitions: name -> index of the class in `class_tables`
+    classes: HashMap<String, usize>,
 
-    /// Class method tables: class_name -> [(method_name, function)]
-    class_methods: HashMap<String, Vec<(String, FunctionValue<'ctx>)>>,
+    /// Every class registered, in order; re-registered classes (isolated imports) get a new one
+    class_tables: Vec<ClassTable<'ctx>>,
+
+    /// Vtable slot of each (method name, argument count) a dynamically dispatched call uses
+    method_slots: HashMap<(String, usize), u32>,
 
     /// Current 'masel' value (set during method execution)
     current_masel: Option<PointerValue<'ctx>>,
@@ -577,6 +890,13 @@ pub struct CodeGen<'ctx> {
 
     /// Source file path for resolving imports
     source_path: Option<PathBuf>,
+    /// Statement sites of a heap- or CPU-profiled build (see heapprof.rs); None when off
+    profile_sites: Option<HeapSites>,
+    /// Where each user function was defined, for stack traces (see traces.rs)
+    frames: FrameTable,
+    /// Functions whose catch block is being compiled; `stacktrace()` directly inside one
+    /// reads the trace of the error it caught
+    catch_functions: Vec<FunctionValue<'ctx>>,
 
     /// Imported modules (to avoid duplicate imports)
     imported_modules: HashSet<PathBuf>,
@@ -588,13 +908,9 @@ pub struct CodeGen<'ctx> {
     import_alias_functions: HashMap<String, HashMap<String, FunctionValue<'ctx>>>,
 
     /// Format strings for printf
-    fmt_int: inkwell::values::GlobalValue<'ctx>,
-    fmt_float: inkwell::values::GlobalValue<'ctx>,
-    fmt_string: inkwell::values::GlobalValue<'ctx>,
     fmt_true: inkwell::values::GlobalValue<'ctx>,
     fmt_false: inkwell::values::GlobalValue<'ctx>,
     fmt_nil: inkwell::values::GlobalValue<'ctx>,
-    fmt_newline: inkwell::values::GlobalValue<'ctx>,
 }
 
 impl<'ctx> CodeGen<'ctx> {
@@ -620,13 +936,9 @@ impl<'ctx> CodeGen<'ctx> {
         let libc = Self::declare_libc_functions(&module, context, &types);
 
         // Create format strings
-        let fmt_int = Self::create_global_string(&module, context, "%lld", "fmt_int");
-        let fmt_float = Self::create_global_string(&module, context, "%g", "fmt_float");
-        let fmt_string = Self::create_global_string(&module, context, "%s", "fmt_string");
         let fmt_true = Self::create_global_string(&module, context, "aye", "fmt_true");
         let fmt_false = Self::create_global_string(&module, context, "nae", "fmt_false");
         let fmt_nil = Self::create_global_string(&module, context, "naething", "fmt_nil");
-        let fmt_newline = Self::create_global_string(&module, context, "\n", "fmt_newline");
 
         CodeGen {
             context,
@@ -643,11 +955,19 @@ impl<'ctx> CodeGen<'ctx> {
             list_ptr_shadows: HashMap::new(),
             boxed_vars: HashSet::new(),
             var_types: HashMap::new(),
+            numeric_locals: HashMap::new(),
             variable_class_types: HashMap::new(),
             functions: HashMap::new(),
             function_defaults: HashMap::new(),
             function_captures: HashMap::new(),
+            last_lambda: None,
+            known_lambdas: HashMap::new(),
+            specializable: HashMap::new(),
+            specializations: Vec::new(),
+            return_type: VarType::Unknown,
             loop_stack: Vec::new(),
+            indexed_loops: HashMap::new(),
+            instance_keys: HashMap::new(),
             in_loop_body: false,
             try_depth: 0,
             in_user_function: false,
@@ -655,21 +975,21 @@ impl<'ctx> CodeGen<'ctx> {
             pipe_tmp_counter: 0,
             import_unique_counter: 0,
             classes: HashMap::new(),
-            class_methods: HashMap::new(),
+            class_tables: Vec::new(),
+            method_slots: HashMap::new(),
             current_masel: None,
             current_class: None,
             source_path: None,
+            profile_sites: None,
+            frames: FrameTable::default(),
+            catch_functions: Vec::new(),
             imported_modules: HashSet::new(),
             import_alias_exports: HashMap::new(),
             import_alias_bindings: HashMap::new(),
             import_alias_functions: HashMap::new(),
-            fmt_int,
-            fmt_float,
-            fmt_string,
             fmt_true,
             fmt_false,
             fmt_nil,
-            fmt_newline,
         }
     }
 
@@ -808,13 +1128,21 @@ impl<'ctx> CodeGen<'ctx> {
         let printf_type = i32_type.fn_type(&[i8_ptr.into()], true);
         let printf = module.add_function("printf", printf_type, Some(Linkage::External));
 
-        // malloc(size_t) -> void*
+        // Heap allocation goes through the GC entry points so generated code's
+        // lists, dicts and strings are visible to the collector. The stub
+        // build maps these straight onto malloc/realloc/strdup.
+
+        // GC_malloc(size_t) -> void*
         let malloc_type = i8_ptr.fn_type(&[i64_type.into()], false);
-        let malloc = module.add_function("malloc", malloc_type, Some(Linkage::External));
+        let malloc = module.add_function("GC_malloc", malloc_type, Some(Linkage::External));
 
-        // realloc(void*, size_t) -> void*
+        // GC_malloc_atomic(size_t) -> void* (no pointers inside)
+        let malloc_atomic =
+            module.add_function("GC_malloc_atomic", malloc_type, Some(Linkage::External));
+
+        // GC_realloc(void*, size_t) -> void*
         let realloc_type = i8_ptr.fn_type(&[i8_ptr.into(), i64_type.into()], false);
-        let realloc = module.add_function("realloc", realloc_type, Some(Linkage::External));
+        let realloc = module.add_function("GC_realloc", realloc_type, Some(Linkage::External));
 
         // strlen(const char*) -> size_t
         let strlen_type = i64_type.fn_type(&[i8_ptr.into()], false);
@@ -867,17 +1195,19 @@ impl<'ctx> CodeGen<'ctx> {
         let clock_gettime =
             module.add_function("clock_gettime", clock_gettime_type, Some(Linkage::External));
 
-        // nanosleep(const struct timespec*, struct timespec*) -> int
+        // __mdh_nanosleep(const struct timespec*, struct timespec*) -> int: nanosleep, or a
+        // timer wait when called from inside a coroutine
         let nanosleep_type = i32_type.fn_type(&[i8_ptr.into(), i8_ptr.into()], false);
-        let nanosleep = module.add_function("nanosleep", nanosleep_type, Some(Linkage::External));
+        let nanosleep =
+            module.add_function("__mdh_nanosleep", nanosleep_type, Some(Linkage::External));
 
         // fgets(char* buf, int size, FILE* stream) -> char*
         let fgets_type = i8_ptr.fn_type(&[i8_ptr.into(), i32_type.into(), i8_ptr.into()], false);
         let fgets = module.add_function("fgets", fgets_type, Some(Linkage::External));
 
-        // strdup(const char*) -> char* (allocates a copy)
+        // GC_strdup(const char*) -> char* (allocates a copy)
         let strdup_type = i8_ptr.fn_type(&[i8_ptr.into()], false);
-        let strdup = module.add_function("strdup", strdup_type, Some(Linkage::External));
+        let strdup = module.add_function("GC_strdup", strdup_type, Some(Linkage::External));
 
         // rand() -> int
         let rand_type = i32_type.fn_type(&[], false);
@@ -1123,6 +1453,9 @@ impl<'ctx> CodeGen<'ctx> {
         let bytes_len =
             module.add_function("__mdh_bytes_len", bytes_len_type, Some(Linkage::External));
 
+        // __mdh_len(MdhValue) -> i64, for lengths len() does not read inline
+        let value_len = module.add_function("__mdh_len", bytes_len_type, Some(Linkage::External));
+
         // __mdh_bytes_slice(MdhValue, MdhValue, MdhValue) -> MdhValue
         let bytes_slice_type = types.value_type.fn_type(
             &[
@@ -1217,6 +1550,103 @@ impl<'ctx> CodeGen<'ctx> {
             Some(Linkage::External),
         );
 
+        // __mdh_bytes_read_u16le(MdhValue, MdhValue) -> MdhValue
+        let bytes_read_u16le = module.add_function(
+            "__mdh_bytes_read_u16le",
+            bytes_read_u16be_type,
+            Some(Linkage::External),
+        );
+
+        // __mdh_bytes_read_u32le(MdhValue, MdhValue) -> MdhValue
+        let bytes_read_u32le = module.add_function(
+            "__mdh_bytes_read_u32le",
+            bytes_read_u16be_type,
+            Some(Linkage::External),
+        );
+
+        // __mdh_bytes_read_u64be(MdhValue, MdhValue) -> MdhValue
+        let bytes_read_u64be = module.add_function(
+            "__mdh_bytes_read_u64be",
+            bytes_read_u16be_type,
+            Some(Linkage::External),
+        );
+
+        // __mdh_bytes_read_u64le(MdhValue, MdhValue) -> MdhValue
+        let bytes_read_u64le = module.add_function(
+            "__mdh_bytes_read_u64le",
+            bytes_read_u16be_type,
+            Some(Linkage::External),
+        );
+
+        // __mdh_bytes_write_u16le(MdhValue, MdhValue, MdhValue) -> MdhValue
+        let bytes_write_u16le = module.add_function(
+            "__mdh_bytes_write_u16le",
+            bytes_write_u32be_type,
+            Some(Linkage::External),
+        );
+
+        // __mdh_bytes_write_u32le(MdhValue, MdhValue, MdhValue) -> MdhValue
+        let bytes_write_u32le = module.add_function(
+            "__mdh_bytes_write_u32le",
+            bytes_write_u32be_type,
+            Some(Linkage::External),
+        );
+
+        // __mdh_bytes_write_u64be(MdhValue, MdhValue, MdhValue) -> MdhValue
+        let bytes_write_u64be = module.add_function(
+            "__mdh_bytes_write_u64be",
+            bytes_write_u32be_type,
+            Some(Linkage::External),
+        );
+
+        // __mdh_bytes_write_u64le(MdhValue, MdhValue, MdhValue) -> MdhValue
+        let bytes_write_u64le = module.add_function(
+            "__mdh_bytes_write_u64le",
+            bytes_write_u32be_type,
+            Some(Linkage::External),
+        );
+
+        // __mdh_bytes_find(MdhValue, MdhValue) -> MdhValue
+        let bytes_find = module.add_function(
+            "__mdh_bytes_find",
+            bytes_read_u16be_type,
+            Some(Linkage::External),
+        );
+
+        // __mdh_bytes_eq(MdhValue, MdhValue) -> MdhValue
+        let bytes_eq = module.add_function(
+            "__mdh_bytes_eq",
+            bytes_read_u16be_type,
+            Some(Linkage::External),
+        );
+
+        // __mdh_bytes_xor(MdhValue, MdhValue) -> MdhValue
+        let bytes_xor = module.add_function(
+            "__mdh_bytes_xor",
+            bytes_read_u16be_type,
+            Some(Linkage::External),
+        );
+
+        // __mdh_bytes_fill(MdhValue, MdhValue, MdhValue, MdhValue) -> MdhValue
+        let bytes_fill_type = types.value_type.fn_type(
+            &[
+                types.value_type.into(),
+                types.value_type.into(),
+                types.value_type.into(),
+                types.value_type.into(),
+            ],
+            false,
+        );
+        let bytes_fill =
+            module.add_function("__mdh_bytes_fill", bytes_fill_type, Some(Linkage::External));
+
+        // __mdh_bytes_copy_within(MdhValue, MdhValue, MdhValue, MdhValue) -> MdhValue
+        let bytes_copy_within = module.add_function(
+            "__mdh_bytes_copy_within",
+            bytes_fill_type,
+            Some(Linkage::External),
+        );
+
         // __mdh_mono_ms() -> MdhValue
         let mono_ms_type = types.value_type.fn_type(&[], false);
         let mono_ms = module.add_function("__mdh_mono_ms", mono_ms_type, Some(Linkage::External));
@@ -1455,15 +1885,91 @@ impl<'ctx> CodeGen<'ctx> {
             socket_2_type,
             Some(Linkage::External),
         );
+        let udp_recv_many = module.add_function(
+            "__mdh_udp_recv_many",
+            socket_3_type,
+            Some(Linkage::External),
+        );
+        let udp_send_many = module.add_function(
+            "__mdh_udp_send_many",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let addr_resolve =
+            module.add_function("__mdh_addr_resolve", socket_2_type, Some(Linkage::External));
         let tcp_send =
             module.add_function("__mdh_tcp_send", socket_2_type, Some(Linkage::External));
+        let tcp_send_vec =
+            module.add_function("__mdh_tcp_send_vec", socket_2_type, Some(Linkage::External));
+        let tcp_send_all =
+            module.add_function("__mdh_tcp_send_all", socket_2_type, Some(Linkage::External));
+        let socket_send_file = module.add_function(
+            "__mdh_socket_send_file",
+            socket_4_type,
+            Some(Linkage::External),
+        );
         let tcp_recv =
             module.add_function("__mdh_tcp_recv", socket_2_type, Some(Linkage::External));
+        let tcp_recv_into = module.add_function(
+            "__mdh_tcp_recv_into",
+            socket_3_type,
+            Some(Linkage::External),
+        );
+        let udp_recv_into = module.add_function(
+            "__mdh_udp_recv_into",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let bytes_pool_take = module.add_function(
+            "__mdh_bytes_pool_take",
+            socket_1_type,
+            Some(Linkage::External),
+        );
+        let bytes_pool_give = module.add_function(
+            "__mdh_bytes_pool_give",
+            socket_1_type,
+            Some(Linkage::External),
+        );
+        // Codecs take (data) or (text, as_string); digests take (data)
+        let base64_encode_native = module.add_function(
+            "__mdh_base64_encode",
+            socket_1_type,
+            Some(Linkage::External),
+        );
+        let base64_decode_native = module.add_function(
+            "__mdh_base64_decode",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let hex_encode_native =
+            module.add_function("__mdh_hex_encode", socket_1_type, Some(Linkage::External));
+        let hex_decode_native =
+            module.add_function("__mdh_hex_decode", socket_2_type, Some(Linkage::External));
+        let sha256 = module.add_function("__mdh_sha256", socket_1_type, Some(Linkage::External));
+        let sha1 = module.add_function("__mdh_sha1", socket_1_type, Some(Linkage::External));
+        let crc32 = module.add_function("__mdh_crc32", socket_1_type, Some(Linkage::External));
+        let xxhash64 =
+            module.add_function("__mdh_xxhash64", socket_1_type, Some(Linkage::External));
         let dns_lookup =
             module.add_function("__mdh_dns_lookup", socket_1_type, Some(Linkage::External));
         let dns_srv = module.add_function("__mdh_dns_srv", socket_2_type, Some(Linkage::External));
         let dns_naptr =
             module.add_function("__mdh_dns_naptr", socket_1_type, Some(Linkage::External));
+        let dns_lookup_async = module.add_function(
+            "__mdh_dns_lookup_async",
+            socket_1_type,
+            Some(Linkage::External),
+        );
+        let dns_srv_async = module.add_function(
+            "__mdh_dns_srv_async",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let dns_naptr_async = module.add_function(
+            "__mdh_dns_naptr_async",
+            socket_1_type,
+            Some(Linkage::External),
+        );
         let tls_client_new = module.add_function(
             "__mdh_tls_client_new",
             socket_1_type,
@@ -1471,12 +1977,21 @@ impl<'ctx> CodeGen<'ctx> {
         );
         let tls_connect =
             module.add_function("__mdh_tls_connect", socket_2_type, Some(Linkage::External));
+        let tls_connect_start = module.add_function(
+            "__mdh_tls_connect_start",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let tls_step =
+            module.add_function("__mdh_tls_step", socket_1_type, Some(Linkage::External));
         let tls_send =
             module.add_function("__mdh_tls_send", socket_2_type, Some(Linkage::External));
         let tls_recv =
             module.add_function("__mdh_tls_recv", socket_2_type, Some(Linkage::External));
         let tls_close =
             module.add_function("__mdh_tls_close", socket_1_type, Some(Linkage::External));
+        let tls_stats =
+            module.add_function("__mdh_tls_stats", socket_0_type, Some(Linkage::External));
         let dtls_server_new = module.add_function(
             "__mdh_dtls_server_new",
             socket_1_type,
@@ -1487,6 +2002,26 @@ impl<'ctx> CodeGen<'ctx> {
             socket_2_type,
             Some(Linkage::External),
         );
+        let dtls_session_new = module.add_function(
+            "__mdh_dtls_session_new",
+            socket_1_type,
+            Some(Linkage::External),
+        );
+        let dtls_session_step = module.add_function(
+            "__mdh_dtls_session_step",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let dtls_session_srtp = module.add_function(
+            "__mdh_dtls_session_srtp",
+            socket_1_type,
+            Some(Linkage::External),
+        );
+        let dtls_session_close = module.add_function(
+            "__mdh_dtls_session_close",
+            socket_1_type,
+            Some(Linkage::External),
+        );
         let srtp_create =
             module.add_function("__mdh_srtp_create", socket_1_type, Some(Linkage::External));
         let srtp_protect =
@@ -1496,6 +2031,49 @@ impl<'ctx> CodeGen<'ctx> {
             socket_2_type,
             Some(Linkage::External),
         );
+        let srtp_protect_into = module.add_function(
+            "__mdh_srtp_protect_into",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let srtp_unprotect_into = module.add_function(
+            "__mdh_srtp_unprotect_into",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let srtp_protect_many = module.add_function(
+            "__mdh_srtp_protect_many",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let srtp_unprotect_many = module.add_function(
+            "__mdh_srtp_unprotect_many",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+
+        // __mdh_rtp_parse_native(packet), __mdh_rtp_build_native(payload, seq, timestamp,
+        // ssrc, payload_type, marker, csrcs)
+        let rtp_parse_native = module.add_function(
+            "__mdh_rtp_parse_native",
+            socket_1_type,
+            Some(Linkage::External),
+        );
+        let rtp_build_native = module.add_function(
+            "__mdh_rtp_build_native",
+            types
+                .value_type
+                .fn_type(&[types.value_type.into(); 7], false),
+            Some(Linkage::External),
+        );
+        // __mdh_sip_parse_native(msg), __mdh_sip_header(msg, name)
+        let sip_parse_native = module.add_function(
+            "__mdh_sip_parse_native",
+            socket_1_type,
+            Some(Linkage::External),
+        );
+        let sip_header =
+            module.add_function("__mdh_sip_header", socket_2_type, Some(Linkage::External));
 
         let event_loop_new = module.add_function(
             "__mdh_event_loop_new",
@@ -1527,15 +2105,157 @@ impl<'ctx> CodeGen<'ctx> {
             socket_2_type,
             Some(Linkage::External),
         );
+        let event_loop_poll_into = module.add_function(
+            "__mdh_event_loop_poll_into",
+            socket_3_type,
+            Some(Linkage::External),
+        );
+        let event_loop_run = module.add_function(
+            "__mdh_event_loop_run",
+            socket_2_type,
+            Some(Linkage::External),
+        );
         let timer_after =
             module.add_function("__mdh_timer_after", socket_3_type, Some(Linkage::External));
         let timer_every =
             module.add_function("__mdh_timer_every", socket_3_type, Some(Linkage::External));
         let timer_cancel =
             module.add_function("__mdh_timer_cancel", socket_2_type, Some(Linkage::External));
-
-        let thread_spawn =
-            module.add_function("__mdh_thread_spawn", socket_2_type, Some(Linkage::External));
+        let timer_after_ns = module.add_function(
+            "__mdh_timer_after_ns",
+            socket_3_type,
+            Some(Linkage::External),
+        );
+        let timer_every_ns = module.add_function(
+            "__mdh_timer_every_ns",
+            socket_3_type,
+            Some(Linkage::External),
+        );
+        // __mdh_co_spawn(loop, func, args), __mdh_co_yield(), __mdh_co_count(loop),
+        // __mdh_co_run(loop)
+        let co_spawn =
+            module.add_function("__mdh_co_spawn", socket_3_type, Some(Linkage::External));
+        let co_yield =
+            module.add_function("__mdh_co_yield", socket_0_type, Some(Linkage::External));
+        let co_count =
+            module.add_function("__mdh_co_count", socket_1_type, Some(Linkage::External));
+        let co_run = module.add_function("__mdh_co_run", socket_1_type, Some(Linkage::External));
+        // __mdh_event_loop_wakeup(loop), __mdh_event_loop_post(loop, callback),
+        // __mdh_reactor_start(opts, setup), __mdh_reactor_stop(reactors)
+        let event_loop_wakeup = module.add_function(
+            "__mdh_event_loop_wakeup",
+            socket_1_type,
+            Some(Linkage::External),
+        );
+        let event_loop_post = module.add_function(
+            "__mdh_event_loop_post",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let reactor_start = module.add_function(
+            "__mdh_reactor_start",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let reactor_stop =
+            module.add_function("__mdh_reactor_stop", socket_1_type, Some(Linkage::External));
+        // __mdh_shm_ring_*: rings shared with other processes
+        let shm_ring_create = module.add_function(
+            "__mdh_shm_ring_create",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let shm_ring_open = module.add_function(
+            "__mdh_shm_ring_open",
+            socket_1_type,
+            Some(Linkage::External),
+        );
+        let shm_ring_send = module.add_function(
+            "__mdh_shm_ring_send",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let shm_ring_recv = module.add_function(
+            "__mdh_shm_ring_recv",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let shm_ring_recv_into = module.add_function(
+            "__mdh_shm_ring_recv_into",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let shm_ring_fd =
+            module.add_function("__mdh_shm_ring_fd", socket_1_type, Some(Linkage::External));
+        let shm_ring_close = module.add_function(
+            "__mdh_shm_ring_close",
+            socket_1_type,
+            Some(Linkage::External),
+        );
+        // __mdh_kv_*: the embedded key-value store
+        let kv_open = module.add_function("__mdh_kv_open", socket_1_type, Some(Linkage::External));
+        let kv_get = module.add_function("__mdh_kv_get", socket_2_type, Some(Linkage::External));
+        let kv_put = module.add_function("__mdh_kv_put", socket_3_type, Some(Linkage::External));
+        let kv_delete =
+            module.add_function("__mdh_kv_delete", socket_2_type, Some(Linkage::External));
+        let kv_scan = module.add_function("__mdh_kv_scan", socket_4_type, Some(Linkage::External));
+        let kv_sync = module.add_function("__mdh_kv_sync", socket_1_type, Some(Linkage::External));
+        let kv_compact =
+            module.add_function("__mdh_kv_compact", socket_1_type, Some(Linkage::External));
+        let kv_stats =
+            module.add_function("__mdh_kv_stats", socket_1_type, Some(Linkage::External));
+        let kv_close =
+            module.add_function("__mdh_kv_close", socket_1_type, Some(Linkage::External));
+        // __mdh_http_parse_native(buf), __mdh_http_serve(loop, listener, handler)
+        let http_parse_native = module.add_function(
+            "__mdh_http_parse_native",
+            socket_1_type,
+            Some(Linkage::External),
+        );
+        let http_serve =
+            module.add_function("__mdh_http_serve", socket_3_type, Some(Linkage::External));
+        // __mdh_http_request(req), __mdh_http_pool_config(opts), __mdh_http_pool_stats()
+        let http_request =
+            module.add_function("__mdh_http_request", socket_1_type, Some(Linkage::External));
+        let http_pool_config = module.add_function(
+            "__mdh_http_pool_config",
+            socket_1_type,
+            Some(Linkage::External),
+        );
+        let http_pool_stats = module.add_function(
+            "__mdh_http_pool_stats",
+            socket_0_type,
+            Some(Linkage::External),
+        );
+        let arena_push =
+            module.add_function("__mdh_arena_push", socket_0_type, Some(Linkage::External));
+        let arena_pop =
+            module.add_function("__mdh_arena_pop", socket_1_type, Some(Linkage::External));
+        let runtime_stats = module.add_function(
+            "__mdh_runtime_stats",
+            socket_0_type,
+            Some(Linkage::External),
+        );
+        let gc_config =
+            module.add_function("__mdh_gc_config", socket_1_type, Some(Linkage::External));
+        let gc_collect =
+            module.add_function("__mdh_gc_collect", socket_0_type, Some(Linkage::External));
+        let gc_stats =
+            module.add_function("__mdh_gc_stats", socket_0_type, Some(Linkage::External));
+
+        // thread_spawn(func, args, opts?) always goes through the options form
+        let thread_spawn = module.add_function(
+            "__mdh_thread_spawn_opts",
+            socket_3_type,
+            Some(Linkage::External),
+        );
+        let cpu_count =
+            module.add_function("__mdh_cpu_count", socket_0_type, Some(Linkage::External));
+        let numa_node_of_cpu = module.add_function(
+            "__mdh_numa_node_of_cpu",
+            socket_1_type,
+            Some(Linkage::External),
+        );
         let thread_join =
             module.add_function("__mdh_thread_join", socket_1_type, Some(Linkage::External));
         let thread_detach = module.add_function(
@@ -1543,6 +2263,20 @@ impl<'ctx> CodeGen<'ctx> {
             socket_1_type,
             Some(Linkage::External),
         );
+        let pool_submit =
+            module.add_function("__mdh_pool_submit", socket_2_type, Some(Linkage::External));
+        let parallel_map =
+            module.add_function("__mdh_parallel_map", socket_3_type, Some(Linkage::External));
+        let parallel_filter = module.add_function(
+            "__mdh_parallel_filter",
+            socket_3_type,
+            Some(Linkage::External),
+        );
+        let parallel_reduce = module.add_function(
+            "__mdh_parallel_reduce",
+            socket_4_type,
+            Some(Linkage::External),
+        );
 
         let mutex_new =
             module.add_function("__mdh_mutex_new", socket_0_type, Some(Linkage::External));
@@ -1586,6 +2320,26 @@ impl<'ctx> CodeGen<'ctx> {
             module.add_function("__mdh_atomic_add", socket_2_type, Some(Linkage::External));
         let atomic_cas =
             module.add_function("__mdh_atomic_cas", socket_3_type, Some(Linkage::External));
+        let atomic_load_acquire = module.add_function(
+            "__mdh_atomic_load_acquire",
+            socket_1_type,
+            Some(Linkage::External),
+        );
+        let atomic_store_release = module.add_function(
+            "__mdh_atomic_store_release",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let atomic_fetch_max = module.add_function(
+            "__mdh_atomic_fetch_max",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let atomic_fetch_min = module.add_function(
+            "__mdh_atomic_fetch_min",
+            socket_2_type,
+            Some(Linkage::External),
+        );
 
         let chan_new =
             module.add_function("__mdh_chan_new", socket_1_type, Some(Linkage::External));
@@ -1598,6 +2352,24 @@ impl<'ctx> CodeGen<'ctx> {
             socket_1_type,
             Some(Linkage::External),
         );
+        let chan_recv_timeout = module.add_function(
+            "__mdh_chan_recv_timeout",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let chan_send_many = module.add_function(
+            "__mdh_chan_send_many",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let chan_recv_many = module.add_function(
+            "__mdh_chan_recv_many",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let chan_select =
+            module.add_function("__mdh_chan_select", socket_2_type, Some(Linkage::External));
+        let chan_fd = module.add_function("__mdh_chan_fd", socket_1_type, Some(Linkage::External));
         let chan_close =
             module.add_function("__mdh_chan_close", socket_1_type, Some(Linkage::External));
         let chan_is_closed = module.add_function(
@@ -1634,6 +2406,27 @@ impl<'ctx> CodeGen<'ctx> {
         let random_int =
             module.add_function("__mdh_random_int", random_val_type, Some(Linkage::External));
 
+        // __mdh_random_float() -> MdhValue (float in [0, 1))
+        let random_float = module.add_function(
+            "__mdh_random_float",
+            types.value_type.fn_type(&[], false),
+            Some(Linkage::External),
+        );
+
+        // __mdh_seed(n) -> MdhValue (nil), reseed this thread's generator
+        let seed = module.add_function(
+            "__mdh_seed",
+            types.value_type.fn_type(&[types.value_type.into()], false),
+            Some(Linkage::External),
+        );
+
+        // __mdh_random_list(n, lo, hi) -> MdhValue (list of n draws)
+        let random_list = module.add_function(
+            "__mdh_random_list",
+            types.value_type.fn_type(&[types.value_type.into(); 3], false),
+            Some(Linkage::External),
+        );
+
         // __mdh_term_width() -> MdhValue
         let term_size_type = types.value_type.fn_type(&[], false);
         let term_width =
@@ -1788,11 +2581,57 @@ impl<'ctx> CodeGen<'ctx> {
         // __mdh_lines(path) -> MdhValue (list)
         let lines_type = types.value_type.fn_type(&[types.value_type.into()], false);
         let lines = module.add_function("__mdh_lines", lines_type, Some(Linkage::External));
+        let file_map = module.add_function("__mdh_file_map", lines_type, Some(Linkage::External));
+        let lines_iter =
+            module.add_function("__mdh_lines_iter", lines_type, Some(Linkage::External));
+        let lines_next =
+            module.add_function("__mdh_lines_next", lines_type, Some(Linkage::External));
+        let lines_close =
+            module.add_function("__mdh_lines_close", lines_type, Some(Linkage::External));
+
+        // __mdh_file_open(path, mode, buffer) -> MdhValue (file handle)
+        let file_open =
+            module.add_function("__mdh_file_open", socket_3_type, Some(Linkage::External));
+        let file_write =
+            module.add_function("__mdh_file_write", scrieve_type, Some(Linkage::External));
+        let file_write_lines = module.add_function(
+            "__mdh_file_write_lines",
+            scrieve_type,
+            Some(Linkage::External),
+        );
+        let file_flush =
+            module.add_function("__mdh_file_flush", lines_type, Some(Linkage::External));
+        let file_close =
+            module.add_function("__mdh_file_close", lines_type, Some(Linkage::External));
+
+        // __mdh_slurp_bytes(path, offset, length) -> MdhValue (bytes)
+        let slurp_bytes =
+            module.add_function("__mdh_slurp_bytes", socket_3_type, Some(Linkage::External));
+        let scrieve_bytes =
+            module.add_function("__mdh_scrieve_bytes", scrieve_type, Some(Linkage::External));
 
         // __mdh_words(str) -> MdhValue (list)
         let words_type = types.value_type.fn_type(&[types.value_type.into()], false);
         let words = module.add_function("__mdh_words", words_type, Some(Linkage::External));
 
+        // __mdh_split(str, delim) -> MdhValue (list)
+        let split = module.add_function("__mdh_split", scrieve_type, Some(Linkage::External));
+
+        // __mdh_str_char_at(str, index) -> MdhValue (string), __mdh_str_char_count(str) -> i64
+        let str_char_at_type = types
+            .value_type
+            .fn_type(&[types.value_type.into(), i64_type.into()], false);
+        let str_char_at = module.add_function(
+            "__mdh_str_char_at",
+            str_char_at_type,
+            Some(Linkage::External),
+        );
+        let str_char_count = module.add_function(
+            "__mdh_str_char_count",
+            bytes_len_type,
+            Some(Linkage::External),
+        );
+
         // Environment/system functions
         let i8_ptr_ptr = i8_ptr.ptr_type(AddressSpace::default());
 
@@ -1842,6 +2681,26 @@ impl<'ctx> CodeGen<'ctx> {
         let shell_status =
             module.add_function("__mdh_shell_status", shell_type, Some(Linkage::External));
 
+        // __mdh_spawn(argv) -> MdhValue (dict: status, stdout, stderr)
+        let spawn = module.add_function("__mdh_spawn", shell_type, Some(Linkage::External));
+
+        // Child processes for the event loop: pipes are plain fds, exits arrive as events
+        let process_spawn =
+            module.add_function("__mdh_process_spawn", scrieve_type, Some(Linkage::External));
+        let process_read =
+            module.add_function("__mdh_process_read", scrieve_type, Some(Linkage::External));
+        let process_write =
+            module.add_function("__mdh_process_write", scrieve_type, Some(Linkage::External));
+        let process_watch = module.add_function(
+            "__mdh_process_watch",
+            socket_3_type,
+            Some(Linkage::External),
+        );
+        let process_wait =
+            module.add_function("__mdh_process_wait", shell_type, Some(Linkage::External));
+        let process_kill =
+            module.add_function("__mdh_process_kill", scrieve_type, Some(Linkage::External));
+
         // Date/time functions
         let date_now_type = types.value_type.fn_type(&[], false);
         let date_now =
@@ -1877,6 +2736,10 @@ impl<'ctx> CodeGen<'ctx> {
         let braw_date_type = types.value_type.fn_type(&[types.value_type.into()], false);
         let braw_date =
             module.add_function("__mdh_braw_date", braw_date_type, Some(Linkage::External));
+        let date_now_ts =
+            module.add_function("__mdh_date_now_ts", date_now_type, Some(Linkage::External));
+        let date_fields =
+            module.add_function("__mdh_date_fields", braw_date_type, Some(Linkage::External));
 
         // Regex functions
         let regex_2_type = types
@@ -1893,6 +2756,21 @@ impl<'ctx> CodeGen<'ctx> {
         );
         let regex_split =
             module.add_function("__mdh_regex_split", regex_2_type, Some(Linkage::External));
+        let regex_compile = module.add_function(
+            "__mdh_regex_compile",
+            socket_1_type,
+            Some(Linkage::External),
+        );
+        let regex_set_new = module.add_function(
+            "__mdh_regex_set_new",
+            socket_1_type,
+            Some(Linkage::External),
+        );
+        let regex_set_match = module.add_function(
+            "__mdh_regex_set_match",
+            regex_2_type,
+            Some(Linkage::External),
+        );
 
         let regex_3_type = types.value_type.fn_type(
             &[
@@ -1918,6 +2796,90 @@ impl<'ctx> CodeGen<'ctx> {
             module.add_function("__mdh_json_stringify", json_1_type, Some(Linkage::External));
         let json_pretty =
             module.add_function("__mdh_json_pretty", json_1_type, Some(Linkage::External));
+        let json_write_into = module.add_function(
+            "__mdh_json_write_into",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let json_stream_open = module.add_function(
+            "__mdh_json_stream_open",
+            json_1_type,
+            Some(Linkage::External),
+        );
+        let json_stream_new = module.add_function(
+            "__mdh_json_stream_new",
+            socket_0_type,
+            Some(Linkage::External),
+        );
+        let json_stream_feed = module.add_function(
+            "__mdh_json_stream_feed",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let json_stream_next = module.add_function(
+            "__mdh_json_stream_next",
+            json_1_type,
+            Some(Linkage::External),
+        );
+        let json_stream_close = module.add_function(
+            "__mdh_json_stream_close",
+            json_1_type,
+            Some(Linkage::External),
+        );
+
+        // Binary pack: pack/unpack go to __mdh_pack_bytes/__mdh_unpack_bytes
+        let pack = module.add_function("__mdh_pack_bytes", json_1_type, Some(Linkage::External));
+        let pack_into =
+            module.add_function("__mdh_pack_into", socket_2_type, Some(Linkage::External));
+        let unpack =
+            module.add_function("__mdh_unpack_bytes", json_1_type, Some(Linkage::External));
+        let unpack_stream_new = module.add_function(
+            "__mdh_unpack_stream_new",
+            socket_0_type,
+            Some(Linkage::External),
+        );
+        let unpack_stream_feed = module.add_function(
+            "__mdh_unpack_stream_feed",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let unpack_stream_next = module.add_function(
+            "__mdh_unpack_stream_next",
+            json_1_type,
+            Some(Linkage::External),
+        );
+
+        // Compression (deflate codecs vendored with raylib)
+        let bytes_compress = module.add_function(
+            "__mdh_bytes_compress",
+            socket_3_type,
+            Some(Linkage::External),
+        );
+        let bytes_decompress = module.add_function(
+            "__mdh_bytes_decompress",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let gzip_stream_new = module.add_function(
+            "__mdh_gzip_stream_new",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let gzip_stream_write = module.add_function(
+            "__mdh_gzip_stream_write",
+            socket_2_type,
+            Some(Linkage::External),
+        );
+        let gzip_stream_flush = module.add_function(
+            "__mdh_gzip_stream_flush",
+            json_1_type,
+            Some(Linkage::External),
+        );
+        let gzip_stream_close = module.add_function(
+            "__mdh_gzip_stream_close",
+            json_1_type,
+            Some(Linkage::External),
+        );
 
         // Misc parity helpers
         let is_a_type = types
@@ -2067,6 +3029,30 @@ impl<'ctx> CodeGen<'ctx> {
             two_arg_value_type,
             Some(Linkage::External),
         );
+        // __mdh_blether_format_at(site*, template, dict) -> MdhValue, for literal templates
+        let blether_format_at_type = types.value_type.fn_type(
+            &[
+                types.value_type.ptr_type(AddressSpace::default()).into(),
+                types.value_type.into(),
+                types.value_type.into(),
+            ],
+            false,
+        );
+        let blether_format_at = module.add_function(
+            "__mdh_blether_format_at",
+            blether_format_at_type,
+            Some(Linkage::External),
+        );
+        let format_compile = module.add_function(
+            "__mdh_format_compile",
+            types.value_type.fn_type(&[types.value_type.into()], false),
+            Some(Linkage::External),
+        );
+        let format_apply = module.add_function(
+            "__mdh_format_apply",
+            two_arg_value_type,
+            Some(Linkage::External),
+        );
 
         // Logging/Debug functions
         // __mdh_get_log_level() -> MdhValue (int)
@@ -2123,6 +3109,16 @@ impl<'ctx> CodeGen<'ctx> {
             log_get_filter_type,
             Some(Linkage::External),
         );
+        let log_flush = module.add_function(
+            "__mdh_log_flush",
+            log_get_filter_type,
+            Some(Linkage::External),
+        );
+        let log_dropped = module.add_function(
+            "__mdh_log_dropped",
+            log_get_filter_type,
+            Some(Linkage::External),
+        );
 
         let log_span_begin_type = types.value_type.fn_type(
             &[
@@ -2168,6 +3164,16 @@ impl<'ctx> CodeGen<'ctx> {
             log_span_in_type,
             Some(Linkage::External),
         );
+        let log_span_stats = module.add_function(
+            "__mdh_log_span_stats",
+            log_span_current_type,
+            Some(Linkage::External),
+        );
+        let log_span_export = module.add_function(
+            "__mdh_log_span_export",
+            log_span_in_type,
+            Some(Linkage::External),
+        );
 
         let log_init_type = types.value_type.fn_type(&[types.value_type.into()], false);
         let log_init =
@@ -2337,6 +3343,189 @@ impl<'ctx> CodeGen<'ctx> {
         let average_type = types.value_type.fn_type(&[types.value_type.into()], false);
         let average = module.add_function("__mdh_average", average_type, Some(Linkage::External));
 
+        // int_array / float_array and their reductions and elementwise ops (array, other)
+        let int_array =
+            module.add_function("__mdh_int_array", average_type, Some(Linkage::External));
+        let float_array =
+            module.add_function("__mdh_float_array", average_type, Some(Linkage::External));
+        let array_tae_list = module.add_function(
+            "__mdh_array_tae_list",
+            average_type,
+            Some(Linkage::External),
+        );
+        let array_sum =
+            module.add_function("__mdh_array_sum", average_type, Some(Linkage::External));
+        let array_average =
+            module.add_function("__mdh_array_average", average_type, Some(Linkage::External));
+        let array_min =
+            module.add_function("__mdh_array_min", average_type, Some(Linkage::External));
+        let array_max =
+            module.add_function("__mdh_array_max", average_type, Some(Linkage::External));
+        let array_pair_type = types
+            .value_type
+            .fn_type(&[types.value_type.into(), types.value_type.into()], false);
+        let array_dot =
+            module.add_function("__mdh_array_dot", array_pair_type, Some(Linkage::External));
+        let array_add =
+            module.add_function("__mdh_array_add", array_pair_type, Some(Linkage::External));
+        let array_sub =
+            module.add_function("__mdh_array_sub", array_pair_type, Some(Linkage::External));
+        let array_mul =
+            module.add_function("__mdh_array_mul", array_pair_type, Some(Linkage::External));
+        let array_div =
+            module.add_function("__mdh_array_div", array_pair_type, Some(Linkage::External));
+
+        // deque / heap: the collection is always the first argument
+        let deque_new = module.add_function(
+            "__mdh_deque_new",
+            types.value_type.fn_type(&[], false),
+            Some(Linkage::External),
+        );
+        let deque_push_back =
+            module.add_function("__mdh_deque_push_back", array_pair_type, Some(Linkage::External));
+        let deque_push_front =
+            module.add_function("__mdh_deque_push_front", array_pair_type, Some(Linkage::External));
+        let deque_pop_front =
+            module.add_function("__mdh_deque_pop_front", average_type, Some(Linkage::External));
+        let deque_pop_back =
+            module.add_function("__mdh_deque_pop_back", average_type, Some(Linkage::External));
+        let deque_front =
+            module.add_function("__mdh_deque_front", average_type, Some(Linkage::External));
+        let deque_back =
+            module.add_function("__mdh_deque_back", average_type, Some(Linkage::External));
+        let deque_clear =
+            module.add_function("__mdh_deque_clear", average_type, Some(Linkage::External));
+        let deque_tae_list = module.add_function(
+            "__mdh_deque_tae_list",
+            average_type,
+            Some(Linkage::External),
+        );
+        let heap_new = module.add_function("__mdh_heap_new", average_type, Some(Linkage::External));
+        let heap_push =
+            module.add_function("__mdh_heap_push", array_pair_type, Some(Linkage::External));
+        let heap_pop = module.add_function("__mdh_heap_pop", average_type, Some(Linkage::External));
+        let heap_peek =
+            module.add_function("__mdh_heap_peek", average_type, Some(Linkage::External));
+        let heap_tae_list =
+            module.add_function("__mdh_heap_tae_list", average_type, Some(Linkage::External));
+        let native_iter_list = module.add_function(
+            "__mdh_native_iter_list",
+            average_type,
+            Some(Linkage::External),
+        );
+
+        // Hash maps keyed by value, and memoize(fn, max_entries) built on them
+        let hashmap_3_type = types
+            .value_type
+            .fn_type(&[types.value_type.into(); 3], false);
+        let hash = module.add_function("__mdh_hash", average_type, Some(Linkage::External));
+        let hashmap_new = module.add_function(
+            "__mdh_hashmap_new",
+            types.value_type.fn_type(&[], false),
+            Some(Linkage::External),
+        );
+        let hashmap_set =
+            module.add_function("__mdh_hashmap_set", hashmap_3_type, Some(Linkage::External));
+        let hashmap_get =
+            module.add_function("__mdh_hashmap_get", hashmap_3_type, Some(Linkage::External));
+        let hashmap_has = module.add_function(
+            "__mdh_hashmap_has",
+            array_pair_type,
+            Some(Linkage::External),
+        );
+        let hashmap_remove = module.add_function(
+            "__mdh_hashmap_remove",
+            array_pair_type,
+            Some(Linkage::External),
+        );
+        let hashmap_keys =
+            module.add_function("__mdh_hashmap_keys", average_type, Some(Linkage::External));
+        let memoize =
+            module.add_function("__mdh_memoize", array_pair_type, Some(Linkage::External));
+
+        // Frozen (persistent) dicts and lists: every update returns a new version
+        let frozen_dict_new =
+            module.add_function("__mdh_frozen_dict_new", average_type, Some(Linkage::External));
+        let frozen_list_new =
+            module.add_function("__mdh_frozen_list_new", average_type, Some(Linkage::External));
+        let frozen_set = module.add_function(
+            "__mdh_frozen_set",
+            types.value_type.fn_type(&[types.value_type.into(); 3], false),
+            Some(Linkage::External),
+        );
+        let frozen_remove =
+            module.add_function("__mdh_frozen_remove", array_pair_type, Some(Linkage::External));
+        let frozen_push =
+            module.add_function("__mdh_frozen_push", array_pair_type, Some(Linkage::External));
+        let thaw = module.add_function("__mdh_thaw", average_type, Some(Linkage::External));
+
+        // Dense matrices: mat_new/get(a, b, c) and mat_set(m, r, c, v) take more than two
+        let mat_3_type = types.value_type.fn_type(&[types.value_type.into(); 3], false);
+        let mat_4_type = types.value_type.fn_type(&[types.value_type.into(); 4], false);
+        let mat_from_rows = module.add_function("__mdh_mat_from_rows", average_type, Some(Linkage::External));
+        let mat_tae_rows = module.add_function("__mdh_mat_tae_rows", average_type, Some(Linkage::External));
+        let mat_new = module.add_function("__mdh_mat_new", mat_3_type, Some(Linkage::External));
+        let mat_identity = module.add_function("__mdh_mat_identity", average_type, Some(Linkage::External));
+        let mat_shape = module.add_function("__mdh_mat_shape", average_type, Some(Linkage::External));
+        let mat_get = module.add_function("__mdh_mat_get", mat_3_type, Some(Linkage::External));
+        let mat_set = module.add_function("__mdh_mat_set", mat_4_type, Some(Linkage::External));
+        let mat_add =
+            module.add_function("__mdh_mat_add", array_pair_type, Some(Linkage::External));
+        let mat_sub =
+            module.add_function("__mdh_mat_sub", array_pair_type, Some(Linkage::External));
+        let mat_scale =
+            module.add_function("__mdh_mat_scale", array_pair_type, Some(Linkage::External));
+        let mat_transpose =
+            module.add_function("__mdh_mat_transpose", average_type, Some(Linkage::External));
+        let mat_matmul =
+            module.add_function("__mdh_mat_matmul", array_pair_type, Some(Linkage::External));
+        let mat_solve =
+            module.add_function("__mdh_mat_solve", array_pair_type, Some(Linkage::External));
+        let mat_det = module.add_function("__mdh_mat_det", average_type, Some(Linkage::External));
+
+        // Table helpers: table_join(left, left_cols, right, right_cols, on, keep_unmatched)
+        let table_join_type = types.value_type.fn_type(&[types.value_type.into(); 6], false);
+        let table_parse_csv =
+            module.add_function("__mdh_table_parse_csv", average_type, Some(Linkage::External));
+        let table_join =
+            module.add_function("__mdh_table_join", table_join_type, Some(Linkage::External));
+        let table_group =
+            module.add_function("__mdh_table_group", array_pair_type, Some(Linkage::External));
+        let table_widths =
+            module.add_function("__mdh_table_widths", array_pair_type, Some(Linkage::External));
+
+        // String builders
+        let strbuf_new = module.add_function("__mdh_strbuf_new", types.value_type.fn_type(&[], false), Some(Linkage::External));
+        let strbuf_append = module.add_function("__mdh_strbuf_append", array_pair_type, Some(Linkage::External));
+        let strbuf_append_int = module.add_function("__mdh_strbuf_append_int", array_pair_type, Some(Linkage::External));
+        let strbuf_append_float = module.add_function("__mdh_strbuf_append_float", array_pair_type, Some(Linkage::External));
+        let strbuf_len = module.add_function("__mdh_strbuf_len", average_type, Some(Linkage::External));
+        let strbuf_clear = module.add_function("__mdh_strbuf_clear", average_type, Some(Linkage::External));
+        let strbuf_build = module.add_function("__mdh_strbuf_build", average_type, Some(Linkage::External));
+
+        // Bulk list building: list_with_capacity(n), reserve(list, n), list_extend(list, other),
+        // list_concat(a, b)
+        let list_with_capacity = module.add_function(
+            "__mdh_list_with_capacity",
+            average_type,
+            Some(Linkage::External),
+        );
+        let reserve = module.add_function(
+            "__mdh_list_reserve",
+            array_pair_type,
+            Some(Linkage::External),
+        );
+        let list_extend = module.add_function(
+            "__mdh_list_extend",
+            array_pair_type,
+            Some(Linkage::External),
+        );
+        let list_concat = module.add_function(
+            "__mdh_list_concat",
+            array_pair_type,
+            Some(Linkage::External),
+        );
+
         // __mdh_chynge(str, old, new) -> MdhValue (string)
         let chynge_type = types.value_type.fn_type(
             &[
@@ -2363,18 +3552,16 @@ impl<'ctx> CodeGen<'ctx> {
         let stacktrace_type = types.value_type.fn_type(&[], false);
         let stacktrace =
             module.add_function("__mdh_stacktrace", stacktrace_type, Some(Linkage::External));
+        // __mdh_hurl_stacktrace() -> MdhValue (string), the trace of the last hurl
+        let hurl_stacktrace = module.add_function(
+            "__mdh_hurl_stacktrace",
+            stacktrace_type,
+            Some(Linkage::External),
+        );
 
         // Exceptions (try/catch/hurl)
         let i8_ptr_type = context.i8_type().ptr_type(AddressSpace::default());
 
-        // __mdh_jmp_buf_size() -> i64
-        let jmp_buf_size_type = types.i64_type.fn_type(&[], false);
-        let jmp_buf_size = module.add_function(
-            "__mdh_jmp_buf_size",
-            jmp_buf_size_type,
-            Some(Linkage::External),
-        );
-
         // __mdh_try_push(ptr env)
         let try_push_type = types.void_type.fn_type(&[i8_ptr_type.into()], false);
         let try_push =
@@ -2384,9 +3571,9 @@ impl<'ctx> CodeGen<'ctx> {
         let try_pop_type = types.void_type.fn_type(&[], false);
         let try_pop = module.add_function("__mdh_try_pop", try_pop_type, Some(Linkage::External));
 
-        // libc setjmp(env) -> i32 (returns twice)
+        // libc _setjmp(env) -> i32 (returns twice); paired with _longjmp in __mdh_hurl
         let setjmp_type = context.i32_type().fn_type(&[i8_ptr_type.into()], false);
-        let setjmp = module.add_function("setjmp", setjmp_type, Some(Linkage::External));
+        let setjmp = module.add_function("_setjmp", setjmp_type, Some(Linkage::External));
 
         let hurl_type = types.void_type.fn_type(&[types.value_type.into()], false);
         let hurl = module.add_function("__mdh_hurl", hurl_type, Some(Linkage::External));
@@ -2447,6 +3634,18 @@ impl<'ctx> CodeGen<'ctx> {
         let median_type = types.value_type.fn_type(&[types.value_type.into()], false);
         let median = module.add_function("__mdh_median", median_type, Some(Linkage::External));
 
+        // __mdh_percentile(list, p) -> MdhValue (float)
+        let percentile_type = types
+            .value_type
+            .fn_type(&[types.value_type.into(), types.value_type.into()], false);
+        let percentile =
+            module.add_function("__mdh_percentile", percentile_type, Some(Linkage::External));
+
+        // __mdh_list_stats(list) -> MdhValue (dict)
+        let list_stats_type = types.value_type.fn_type(&[types.value_type.into()], false);
+        let list_stats =
+            module.add_function("__mdh_list_stats", list_stats_type, Some(Linkage::External));
+
         // __mdh_is_space(str) -> MdhValue (bool)
         let is_space_type = types.value_type.fn_type(&[types.value_type.into()], false);
         let is_space =
@@ -2495,6 +3694,28 @@ impl<'ctx> CodeGen<'ctx> {
         // __mdh_blether(val) -> void (print any value including lists/dicts)
         let blether_type = void_type.fn_type(&[types.value_type.into()], false);
         let blether = module.add_function("__mdh_blether", blether_type, Some(Linkage::External));
+        // __mdh_blether_str/int/float(x) -> void, the scalar cases written straight out
+        let blether_str = module.add_function(
+            "__mdh_blether_str",
+            void_type.fn_type(&[i8_ptr.into()], false),
+            Some(Linkage::External),
+        );
+        let blether_int = module.add_function(
+            "__mdh_blether_int",
+            void_type.fn_type(&[i64_type.into()], false),
+            Some(Linkage::External),
+        );
+        let blether_float = module.add_function(
+            "__mdh_blether_float",
+            void_type.fn_type(&[types.f64_type.into()], false),
+            Some(Linkage::External),
+        );
+        // __mdh_flush() -> MdhValue (nil), push buffered stdout out
+        let flush = module.add_function(
+            "__mdh_flush",
+            types.value_type.fn_type(&[], false),
+            Some(Linkage::External),
+        );
 
         // __mdh_list_push(list, value) -> void (append value to list)
         let list_push_type =
@@ -2544,6 +3765,16 @@ impl<'ctx> CodeGen<'ctx> {
         let list_sort =
             module.add_function("__mdh_list_sort", list_sort_type, Some(Linkage::External));
 
+        // __mdh_list_sort_by_keys(list, keys) -> MdhValue - stable sort by precomputed keys
+        let list_sort_by_keys_type = types
+            .value_type
+            .fn_type(&[types.value_type.into(), types.value_type.into()], false);
+        let list_sort_by_keys = module.add_function(
+            "__mdh_list_sort_by_keys",
+            list_sort_by_keys_type,
+            Some(Linkage::External),
+        );
+
         // __mdh_list_uniq(list) -> MdhValue - return list with duplicates removed
         let list_uniq_type = types.value_type.fn_type(&[types.value_type.into()], false);
         let list_uniq =
@@ -2557,6 +3788,14 @@ impl<'ctx> CodeGen<'ctx> {
         let list_slice =
             module.add_function("__mdh_list_slice", list_slice_type, Some(Linkage::External));
 
+        // __mdh_list_unshare(MdhList*) -> void - copy items shared with a slice view
+        let list_unshare_type = void_type.fn_type(&[i8_ptr.into()], false);
+        let list_unshare = module.add_function(
+            "__mdh_list_unshare",
+            list_unshare_type,
+            Some(Linkage::External),
+        );
+
         // __mdh_range(start, end, step) -> MdhValue (list)
         let range_type = types
             .value_type
@@ -2622,6 +3861,13 @@ impl<'ctx> CodeGen<'ctx> {
             .fn_type(&[types.value_type.into(), types.value_type.into()], false);
         let dict_merge =
             module.add_function("__mdh_dict_merge", dict_merge_type, Some(Linkage::External));
+        let dict_update =
+            module.add_function("__mdh_dict_update", dict_merge_type, Some(Linkage::External));
+        let dict_sized = module.add_function(
+            "__mdh_dict_sized",
+            types.value_type.fn_type(&[types.value_type.into()], false),
+            Some(Linkage::External),
+        );
 
         let dict_remove_type = types
             .value_type
@@ -2678,6 +3924,7 @@ impl<'ctx> CodeGen<'ctx> {
         LibcFunctions {
             printf,
             malloc,
+            malloc_atomic,
             realloc,
             strlen,
             strcpy,
@@ -2720,6 +3967,7 @@ impl<'ctx> CodeGen<'ctx> {
             bytes_new,
             bytes_from_string,
             bytes_len,
+            value_len,
             bytes_slice,
             bytes_get,
             bytes_set,
@@ -2728,6 +3976,19 @@ impl<'ctx> CodeGen<'ctx> {
             bytes_read_u32be,
             bytes_write_u16be,
             bytes_write_u32be,
+            bytes_read_u16le,
+            bytes_read_u32le,
+            bytes_read_u64be,
+            bytes_read_u64le,
+            bytes_write_u16le,
+            bytes_write_u32le,
+            bytes_write_u64be,
+            bytes_write_u64le,
+            bytes_find,
+            bytes_eq,
+            bytes_xor,
+            bytes_fill,
+            bytes_copy_within,
             mono_ms,
             mono_ns,
             soond_stairt,
@@ -2791,33 +4052,114 @@ impl<'ctx> CodeGen<'ctx> {
             socket_close,
             udp_send_to,
             udp_recv_from,
+            udp_recv_many,
+            udp_send_many,
+            addr_resolve,
             tcp_send,
+            tcp_send_vec,
+            tcp_send_all,
+            socket_send_file,
             tcp_recv,
+            tcp_recv_into,
+            udp_recv_into,
+            bytes_pool_take,
+            bytes_pool_give,
+            base64_encode_native,
+            base64_decode_native,
+            hex_encode_native,
+            hex_decode_native,
+            sha256,
+            sha1,
+            crc32,
+            xxhash64,
             dns_lookup,
             dns_srv,
             dns_naptr,
+            dns_lookup_async,
+            dns_srv_async,
+            dns_naptr_async,
             tls_client_new,
             tls_connect,
+            tls_connect_start,
+            tls_step,
             tls_send,
             tls_recv,
             tls_close,
+            tls_stats,
             dtls_server_new,
             dtls_handshake,
+            dtls_session_new,
+            dtls_session_step,
+            dtls_session_srtp,
+            dtls_session_close,
             srtp_create,
             srtp_protect,
             srtp_unprotect,
+            srtp_protect_into,
+            srtp_unprotect_into,
+            srtp_protect_many,
+            srtp_unprotect_many,
+            rtp_parse_native,
+            rtp_build_native,
+            sip_parse_native,
+            sip_header,
             event_loop_new,
             event_loop_stop,
             event_watch_read,
             event_watch_write,
             event_unwatch,
             event_loop_poll,
+            event_loop_poll_into,
+            event_loop_run,
             timer_after,
             timer_every,
             timer_cancel,
+            timer_after_ns,
+            timer_every_ns,
+            co_spawn,
+            co_yield,
+            co_count,
+            co_run,
+            event_loop_wakeup,
+            event_loop_post,
+            reactor_start,
+            reactor_stop,
+            shm_ring_create,
+            shm_ring_open,
+            shm_ring_send,
+            shm_ring_recv,
+            shm_ring_recv_into,
+            shm_ring_fd,
+            shm_ring_close,
+            kv_open,
+            kv_get,
+            kv_put,
+            kv_delete,
+            kv_scan,
+            kv_sync,
+            kv_compact,
+            kv_stats,
+            kv_close,
+            http_parse_native,
+            http_serve,
+            http_request,
+            http_pool_config,
+            http_pool_stats,
+            arena_push,
+            arena_pop,
+            runtime_stats,
+            gc_config,
+            gc_collect,
+            gc_stats,
             thread_spawn,
+            cpu_count,
+            numa_node_of_cpu,
             thread_join,
             thread_detach,
+            pool_submit,
+            parallel_map,
+            parallel_filter,
+            parallel_reduce,
             mutex_new,
             mutex_lock,
             mutex_unlock,
@@ -2832,10 +4174,19 @@ impl<'ctx> CodeGen<'ctx> {
             atomic_store,
             atomic_add,
             atomic_cas,
+            atomic_load_acquire,
+            atomic_store_release,
+            atomic_fetch_max,
+            atomic_fetch_min,
             chan_new,
             chan_send,
             chan_recv,
             chan_try_recv,
+            chan_recv_timeout,
+            chan_send_many,
+            chan_recv_many,
+            chan_select,
+            chan_fd,
             chan_close,
             chan_is_closed,
             key_not_found,
@@ -2843,6 +4194,9 @@ impl<'ctx> CodeGen<'ctx> {
             random,
             jammy,
             random_int,
+            random_float,
+            seed,
+            random_list,
             term_width,
             term_height,
             empty_dict,
@@ -2869,7 +4223,21 @@ impl<'ctx> CodeGen<'ctx> {
             scrieve,
             scrieve_append,
             lines,
+            file_map,
+            lines_iter,
+            lines_next,
+            lines_close,
+            file_open,
+            file_write,
+            file_write_lines,
+            file_flush,
+            file_close,
+            slurp_bytes,
+            scrieve_bytes,
             words,
+            split,
+            str_char_at,
+            str_char_count,
             set_args,
             args,
             cwd,
@@ -2880,21 +4248,51 @@ impl<'ctx> CodeGen<'ctx> {
             path_join,
             shell,
             shell_status,
+            spawn,
+            process_spawn,
+            process_read,
+            process_write,
+            process_watch,
+            process_wait,
+            process_kill,
             date_now,
             date_format,
             date_parse,
             date_add,
             date_diff,
             braw_date,
+            date_now_ts,
+            date_fields,
             regex_test,
             regex_match,
             regex_match_all,
             regex_replace,
             regex_replace_first,
             regex_split,
+            regex_compile,
+            regex_set_new,
+            regex_set_match,
             json_parse,
             json_stringify,
             json_pretty,
+            json_write_into,
+            json_stream_open,
+            json_stream_new,
+            json_stream_feed,
+            json_stream_next,
+            json_stream_close,
+            pack,
+            pack_into,
+            unpack,
+            unpack_stream_new,
+            unpack_stream_feed,
+            unpack_stream_next,
+            bytes_compress,
+            bytes_decompress,
+            gzip_stream_new,
+            gzip_stream_write,
+            gzip_stream_flush,
+            gzip_stream_close,
             is_a,
             wrang_sort,
             numpty_check,
@@ -2944,6 +4342,9 @@ impl<'ctx> CodeGen<'ctx> {
             tattie_scone,
             haggis_hunt,
             blether_format,
+            blether_format_at,
+            format_compile,
+            format_apply,
             bampot_mode,
             get_log_level,
             set_log_level,
@@ -2951,11 +4352,15 @@ impl<'ctx> CodeGen<'ctx> {
             log_enabled,
             log_set_filter,
             log_get_filter,
+            log_flush,
+            log_dropped,
             log_span_begin,
             log_span_enter,
             log_span_exit,
             log_span_current,
             log_span_in,
+            log_span_stats,
+            log_span_export,
             log_init,
             slainte,
             och,
@@ -2983,11 +4388,81 @@ impl<'ctx> CodeGen<'ctx> {
             replace_first,
             unique,
             average,
+            int_array,
+            float_array,
+            array_tae_list,
+            array_sum,
+            array_average,
+            array_min,
+            array_max,
+            array_dot,
+            array_add,
+            array_sub,
+            array_mul,
+            array_div,
+            deque_new,
+            deque_push_back,
+            deque_push_front,
+            deque_pop_front,
+            deque_pop_back,
+            deque_front,
+            deque_back,
+            deque_clear,
+            deque_tae_list,
+            heap_new,
+            heap_push,
+            heap_pop,
+            heap_peek,
+            heap_tae_list,
+            native_iter_list,
+            hash,
+            hashmap_new,
+            hashmap_set,
+            hashmap_get,
+            hashmap_has,
+            hashmap_remove,
+            hashmap_keys,
+            memoize,
+            frozen_dict_new,
+            frozen_list_new,
+            frozen_set,
+            frozen_remove,
+            frozen_push,
+            thaw,
+            mat_from_rows,
+            mat_tae_rows,
+            mat_new,
+            mat_identity,
+            mat_shape,
+            mat_get,
+            mat_set,
+            mat_add,
+            mat_sub,
+            mat_scale,
+            mat_transpose,
+            mat_matmul,
+            mat_solve,
+            mat_det,
+            table_parse_csv,
+            table_join,
+            table_group,
+            table_widths,
+            strbuf_new,
+            strbuf_append,
+            strbuf_append_int,
+            strbuf_append_float,
+            strbuf_len,
+            strbuf_clear,
+            strbuf_build,
+            list_with_capacity,
+            reserve,
+            list_extend,
+            list_concat,
             chynge,
             assert_fn,
             skip,
             stacktrace,
-            jmp_buf_size,
+            hurl_stacktrace,
             try_push,
             try_pop,
             setjmp,
@@ -2995,6 +4470,8 @@ impl<'ctx> CodeGen<'ctx> {
             get_last_error,
             muckle,
             median,
+            percentile,
+            list_stats,
             is_space,
             is_digit,
             wheesht_aw,
@@ -3005,6 +4482,10 @@ impl<'ctx> CodeGen<'ctx> {
             bit_xor,
             speir,
             blether,
+            blether_str,
+            blether_int,
+            blether_float,
+            flush,
             list_push,
             list_contains,
             list_index_of,
@@ -3012,14 +4493,18 @@ impl<'ctx> CodeGen<'ctx> {
             list_min,
             list_max,
             list_sort,
+            list_sort_by_keys,
             list_uniq,
             list_slice,
+            list_unshare,
             dict_keys,
             dict_values,
             dict_set,
             dict_get,
             dict_get_default,
             dict_merge,
+            dict_update,
+            dict_sized,
             dict_remove,
             dict_invert,
             fae_pairs,
@@ -3072,17 +4557,48 @@ impl<'ctx> CodeGen<'ctx> {
         &self.module
     }
 
+    /// Record the source line of every statement for the heap and CPU profilers
+    pub fn enable_profile_sites(&mut self) {
+        self.profile_sites = Some(HeapSites::default());
+    }
+
+    /// Names of the profilers' statement sites, in id order
+    pub fn profile_site_names(&self) -> &[String] {
+        self.profile_sites.as_ref().map_or(&[], |sites| sites.names())
+    }
+
+    /// Where the user functions compiled so far were defined
+    pub(super) fn frame_table(&self) -> &FrameTable {
+        &self.frames
+    }
+
+    /// The resolved paths of every module imported so far
+    pub fn imported_files(&self) -> impl Iterator<Item = &Path> {
+        self.imported_modules.iter().map(PathBuf::as_path)
+    }
+
     /// Compile a complete program
     pub fn compile(&mut self, program: &Program) -> Result<(), HaversError> {
+        // Constants folded and small functions inlined (see optimise.rs), then self tail
+        // calls run as loops (see tailcall.rs)
+        let program = &tailcall::loop_self_tail_calls(&optimise::optimise(program));
+
         // First pass: declare all functions and store default parameter values
         for stmt in &program.statements {
-            if let Stmt::Function { name, params, .. } = stmt {
+            if let Stmt::Function {
+                name, params, body, ..
+            } = stmt
+            {
                 self.declare_function(name, params.len());
                 // Store default parameter values for call-site substitution
                 let defaults: Vec<Option<Expr>> =
                     params.iter().map(|p| p.default.clone()).collect();
                 if defaults.iter().any(|d| d.is_some()) {
-                    self.function_defaults.insert(name.clone(), defaults);
+                    self.function_defaults.insert(name.clone(), defaults.into());
+                } else {
+                    let function = self.functions[name];
+                    self.specializable
+                        .insert(name.clone(), (function, params.clone(), body.clone()));
                 }
             }
         }
@@ -3148,6 +4664,7 @@ impl<'ctx> CodeGen<'ctx> {
         }
 
         // Compile all statements
+        self.numeric_locals = super::infer::numeric_locals(&[], &program.statements);
         for stmt in &program.statements {
             self.compile_stmt(stmt)?;
         }
@@ -3157,6 +4674,15 @@ impl<'ctx> CodeGen<'ctx> {
             .build_return(Some(&self.types.i32_type.const_int(0, false)))
             .unwrap();
 
+        // Clones asked for while compiling, including by other clones
+        let mut next = 0;
+        while next < self.specializations.len() {
+            self.compile_specialization(next)?;
+            next += 1;
+        }
+        self.add_specialization_guards()?;
+        self.emit_class_tables()?;
+
         Ok(())
     }
 
@@ -3197,7 +4723,7 @@ impl<'ctx> CodeGen<'ctx> {
         }
 
         // Declare all methods (create function signatures)
-        let mut method_list: Vec<(String, FunctionValue<'ctx>)> = Vec::new();
+        let mut method_list: HashMap<String, FunctionValue<'ctx>> = HashMap::new();
         for method in methods {
             if let Stmt::Function {
                 name: method_name,
@@ -3217,24 +4743,49 @@ impl<'ctx> CodeGen<'ctx> {
                 let fn_type = self.types.value_type.fn_type(&param_types, false);
                 let function = self.module.add_function(&func_name, fn_type, None);
                 self.functions.insert(func_name.clone(), function);
-                method_list.push((method_name.clone(), function));
+                method_list.insert(method_name.clone(), function);
 
                 // Store default parameter values for methods
                 let defaults: Vec<Option<Expr>> =
                     params.iter().map(|p| p.default.clone()).collect();
                 if defaults.iter().any(|d| d.is_some()) {
-                    self.function_defaults.insert(func_name, defaults);
+                    self.function_defaults.insert(func_name, defaults.into());
                 }
             }
         }
 
         // Store class and method table
-        self.class_methods.insert(name.to_string(), method_list);
+        self.register_class(name, method_list);
+    }
+
+    /// Record a class's methods, its name string and the class table its instances point at.
+    fn register_class(&mut self, name: &str, method_list: HashMap<String, FunctionValue<'ctx>>) {
         let class_name_global = self
             .builder
             .build_global_string_ptr(name, &format!("class_{}", name))
             .unwrap();
-        self.classes.insert(name.to_string(), class_name_global);
+        self.classes
+            .insert(name.to_string(), self.class_tables.len());
+
+        let table_type = self.class_entry_type();
+        let table = self
+            .module
+            .add_global(table_type, None, &format!("class_{}_table", name));
+        table.set_linkage(Linkage::Internal);
+        table.set_constant(true);
+        // No vtable until emit_class_tables
+        let i8_ptr = self.context.i8_type().ptr_type(AddressSpace::default());
+        let name_ptr = class_name_global.as_pointer_value().const_cast(i8_ptr);
+        table.set_initializer(
+            &table_type.const_named_struct(&[name_ptr.into(), i8_ptr.const_null().into()]),
+        );
+        self.class_tables.push(ClassTable {
+            name: name.to_string(),
+            name_ptr: class_name_global.as_pointer_value(),
+            table,
+            methods: method_list,
+            parent: None,
+        });
     }
 
     // ========== Inline Value Creation ==========
@@ -3396,7 +4947,7 @@ impl<'ctx> CodeGen<'ctx> {
     }
 
     /// Create a dict value: {tag=6, data=ptr as i64}
-    /// Dict memory layout: [i64 count][entry0][entry1]... where entry = [{i8,i64} key][{i8,i64} val]
+    /// Dict memory layout: [i64 count][entry0][entry1]...[tail] where entry = [{i8,i64} key][{i8,i64} val]
     fn make_dict(&self, ptr: PointerValue<'ctx>) -> Result<BasicValueEnum<'ctx>, HaversError> {
         let tag = self
             .types
@@ -3421,7 +4972,7 @@ impl<'ctx> CodeGen<'ctx> {
     }
 
     /// Create an instance value: {tag=9, data=ptr as i64}
-    /// Instance memory layout: [i64 class_name_ptr][i64 field_count][field_entry0][field_entry1]...
+    /// Instance memory layout: [i64 class_table_ptr][i64 field_count][field_entry0][field_entry1]...
     /// where field_entry = [{i8,i64} key (string)][{i8,i64} value]
     fn make_instance(&self, ptr: PointerValue<'ctx>) -> Result<BasicValueEnum<'ctx>, HaversError> {
         let tag = self
@@ -3859,6 +5410,21 @@ impl<'ctx> CodeGen<'ctx> {
                     | BinaryOp::GreaterEqual => {
                         let left_type = self.infer_expr_type(left);
                         let right_type = self.infer_expr_type(right);
+                        if self.float_operands(left, right) {
+                            let l = self.compile_float_expr(left)?;
+                            let r = self.compile_float_expr(right)?;
+                            let pred = match operator {
+                                BinaryOp::Less => inkwell::FloatPredicate::OLT,
+                                BinaryOp::LessEqual => inkwell::FloatPredicate::OLE,
+                                BinaryOp::Greater => inkwell::FloatPredicate::OGT,
+                                _ => inkwell::FloatPredicate::OGE,
+                            };
+                            let result = self
+                                .builder
+                                .build_float_compare(pred, l, r, "fcmp_direct")
+                                .unwrap();
+                            return Ok(Some(result));
+                        }
                         let left_fast = matches!(left_type, VarType::Int | VarType::Bool);
                         let right_fast = matches!(right_type, VarType::Int | VarType::Bool);
                         if !left_fast || !right_fast {
@@ -4150,7 +5716,20 @@ impl<'ctx> CodeGen<'ctx> {
             },
             Expr::List { .. } => VarType::List,
             Expr::Dict { .. } => VarType::Dict,
+            Expr::Unary {
+                operator: UnaryOp::Not,
+                ..
+            } => VarType::Bool,
             Expr::Unary { operand, .. } => self.infer_expr_type(operand),
+            Expr::Grouping { expr, .. } => self.infer_expr_type(expr),
+            Expr::Call {
+                callee, arguments, ..
+            } => match callee.as_ref() {
+                Expr::Variable { name, .. } => self
+                    .find_specialization(name, arguments)
+                    .map_or(VarType::Unknown, |spec| spec.returns),
+                _ => VarType::Unknown,
+            },
             _ => VarType::Unknown,
         }
     }
@@ -4194,6 +5773,12 @@ impl<'ctx> CodeGen<'ctx> {
                 }
             }
 
+            // A clone returning an int hands it back unboxed
+            Expr::Call { .. } => self
+                .compile_unboxed_call(expr, VarType::Int)?
+                .ok()
+                .map(|v| v.into_int_value()),
+
             // Binary operations on integers
             Expr::Binary {
                 left,
@@ -4233,10 +5818,93 @@ impl<'ctx> CodeGen<'ctx> {
                 None
             }
 
+            Expr::Grouping { expr, .. } => self.compile_int_expr(expr),
+
             _ => None,
         }
     }
 
+    /// Both operands known numeric and at least one a float: the arithmetic is float.
+    fn float_operands(&self, left: &Expr, right: &Expr) -> bool {
+        let (lt, rt) = (self.infer_expr_type(left), self.infer_expr_type(right));
+        matches!(
+            (lt, rt),
+            (VarType::Float, VarType::Int | VarType::Float) | (VarType::Int, VarType::Float)
+        )
+    }
+
+    /// Compile an expression `infer_expr_type` types as Int or Float straight to f64: float
+    /// operands stay unboxed through a chain of arithmetic, ints are converted.
+    fn compile_float_expr(
+        &mut self,
+        expr: &Expr,
+    ) -> Result<inkwell::values::FloatValue<'ctx>, HaversError> {
+        match expr {
+            Expr::Literal {
+                value: Literal::Float(f),
+                ..
+            } => return Ok(self.types.f64_type.const_float(*f)),
+            Expr::Grouping { expr, .. } => return self.compile_float_expr(expr),
+            Expr::Binary {
+                left,
+                operator:
+                    op @ (BinaryOp::Add | BinaryOp::Subtract | BinaryOp::Multiply | BinaryOp::Divide),
+                right,
+                ..
+            } if self.float_operands(left, right) => {
+                return self.compile_float_arith(left, *op, right);
+            }
+            Expr::Call { .. } => {
+                if let Some(result) = self.compile_unboxed_call(expr, VarType::Float) {
+                    return Ok(result?.into_float_value());
+                }
+            }
+            _ => {}
+        }
+        if self.infer_expr_type(expr) == VarType::Int {
+            let int_val = match self.compile_int_expr(expr) {
+                Some(int_val) => int_val,
+                None => {
+                    let val = self.compile_expr(expr)?;
+                    self.extract_data(val)?
+                }
+            };
+            return Ok(self
+                .builder
+                .build_signed_int_to_float(int_val, self.types.f64_type, "i2f")
+                .unwrap());
+        }
+        let val = self.compile_expr(expr)?;
+        let data = self.extract_data(val)?;
+        Ok(self
+            .builder
+            .build_bitcast(data, self.types.f64_type, "f64")
+            .unwrap()
+            .into_float_value())
+    }
+
+    fn compile_float_arith(
+        &mut self,
+        left: &Expr,
+        op: BinaryOp,
+        right: &Expr,
+    ) -> Result<inkwell::values::FloatValue<'ctx>, HaversError> {
+        let l = self.compile_float_expr(left)?;
+        let r = self.compile_float_expr(right)?;
+        let result = match op {
+            BinaryOp::Add => self.builder.build_float_add(l, r, "fadd_fast"),
+            BinaryOp::Subtract => self.builder.build_float_sub(l, r, "fsub_fast"),
+            BinaryOp::Multiply => self.builder.build_float_mul(l, r, "fmul_fast"),
+            BinaryOp::Divide => self.builder.build_float_div(l, r, "fdiv_fast"),
+            _ => {
+                return Err(HaversError::CompileError(
+                    "compile_float_arith called with non-arithmetic op".to_string(),
+                ))
+            }
+        };
+        Ok(result.unwrap())
+    }
+
     /// Sync all int shadows back to their MdhValue counterparts
     /// Called at loop exit to ensure variables are up-to-date
     fn sync_all_shadows(&mut self) -> Result<(), HaversError> {
@@ -4481,22 +6149,8 @@ impl<'ctx> CodeGen<'ctx> {
             .unwrap();
 
         // Get lengths
-        let left_len = self
-            .builder
-            .build_call(self.libc.strlen, &[left_ptr.into()], "llen")
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .unwrap()
-            .into_int_value();
-        let right_len = self
-            .builder
-            .build_call(self.libc.strlen, &[right_ptr.into()], "rlen")
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .unwrap()
-            .into_int_value();
+        let left_len = self.build_string_length(left_ptr)?;
+        let right_len = self.build_string_length(right_ptr)?;
 
         // Allocate new string (len1 + len2 + 1)
         let total_len = self
@@ -4510,7 +6164,7 @@ impl<'ctx> CodeGen<'ctx> {
             .unwrap();
         let new_str = self
             .builder
-            .build_call(self.libc.malloc, &[alloc_size.into()], "new_str")
+            .build_call(self.libc.malloc_atomic, &[alloc_size.into()], "new_str")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -6208,7 +7862,8 @@ impl<'ctx> CodeGen<'ctx> {
 
     // ========== Inline Print (blether) ==========
 
-    /// Print a value using printf
+    /// Print a value and a newline: the scalars through the runtime's direct writers, so
+    /// no string value is made for them, and the rest through __mdh_blether
     fn inline_blether(&mut self, val: BasicValueEnum<'ctx>) -> Result<(), HaversError> {
         let tag = self.extract_tag(val).unwrap();
         let data = self.extract_data(val).unwrap();
@@ -6261,7 +7916,7 @@ impl<'ctx> CodeGen<'ctx> {
         self.builder.position_at_end(print_nil);
         let nil_str = self.get_string_ptr(self.fmt_nil);
         self.builder
-            .build_call(self.libc.printf, &[nil_str.into()], "")
+            .build_call(self.libc.blether_str, &[nil_str.into()], "")
             .unwrap();
         self.builder.build_unconditional_branch(print_done).unwrap();
 
@@ -6279,33 +7934,30 @@ impl<'ctx> CodeGen<'ctx> {
             .build_select(is_true, true_str, false_str, "bool_str")
             .unwrap();
         self.builder
-            .build_call(self.libc.printf, &[bool_str.into()], "")
+            .build_call(self.libc.blether_str, &[bool_str.into()], "")
             .unwrap();
         self.builder.build_unconditional_branch(print_done).unwrap();
 
         // Print int
         self.builder.position_at_end(print_int);
-        let int_fmt = self.get_string_ptr(self.fmt_int);
         self.builder
-            .build_call(self.libc.printf, &[int_fmt.into(), data.into()], "")
+            .build_call(self.libc.blether_int, &[data.into()], "")
             .unwrap();
         self.builder.build_unconditional_branch(print_done).unwrap();
 
         // Print float
         self.builder.position_at_end(print_float);
-        let float_fmt = self.get_string_ptr(self.fmt_float);
         let float_val = self
             .builder
             .build_bitcast(data, self.types.f64_type, "f")
             .unwrap();
         self.builder
-            .build_call(self.libc.printf, &[float_fmt.into(), float_val.into()], "")
+            .build_call(self.libc.blether_float, &[float_val.into()], "")
             .unwrap();
         self.builder.build_unconditional_branch(print_done).unwrap();
 
         // Print string
         self.builder.position_at_end(print_string);
-        let str_fmt = self.get_string_ptr(self.fmt_string);
         let str_ptr = self
             .builder
             .build_int_to_ptr(
@@ -6315,33 +7967,18 @@ impl<'ctx> CodeGen<'ctx> {
             )
             .unwrap();
         self.builder
-            .build_call(self.libc.printf, &[str_fmt.into(), str_ptr.into()], "")
+            .build_call(self.libc.blether_str, &[str_ptr.into()], "")
             .unwrap();
         self.builder.build_unconditional_branch(print_done).unwrap();
 
         // Print default (lists, dicts, etc.) - call runtime function
-        // __mdh_blether already prints newline, so jump directly to after_newline
-        let after_newline = self.context.append_basic_block(function, "after_newline");
         self.builder.position_at_end(print_default);
         self.builder
             .build_call(self.libc.blether, &[val.into()], "")
             .unwrap();
-        self.builder
-            .build_unconditional_branch(after_newline)
-            .unwrap();
+        self.builder.build_unconditional_branch(print_done).unwrap();
 
-        // Done - print newline (only for simple types that were handled inline)
         self.builder.position_at_end(print_done);
-        let newline = self.get_string_ptr(self.fmt_newline);
-        self.builder
-            .build_call(self.libc.printf, &[newline.into()], "")
-            .unwrap();
-        self.builder
-            .build_unconditional_branch(after_newline)
-            .unwrap();
-
-        // After newline - continue
-        self.builder.position_at_end(after_newline);
 
         Ok(())
     }
@@ -6444,7 +8081,7 @@ impl<'ctx> CodeGen<'ctx> {
         let buf_size = self.types.i64_type.const_int(32, false);
         let int_buf = self
             .builder
-            .build_call(self.libc.malloc, &[buf_size.into()], "int_buf")
+            .build_call(self.libc.malloc_atomic, &[buf_size.into()], "int_buf")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -6474,7 +8111,7 @@ impl<'ctx> CodeGen<'ctx> {
         self.builder.position_at_end(str_float);
         let float_buf = self
             .builder
-            .build_call(self.libc.malloc, &[buf_size.into()], "float_buf")
+            .build_call(self.libc.malloc_atomic, &[buf_size.into()], "float_buf")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -6572,6 +8209,246 @@ impl<'ctx> CodeGen<'ctx> {
         Ok(result)
     }
 
+    /// Length of a C string: read from the runtime string header when present
+    /// (see `STRING_HEADER_SIZE`), otherwise fall back to strlen.
+    fn build_string_length(
+        &mut self,
+        str_ptr: PointerValue<'ctx>,
+    ) -> Result<IntValue<'ctx>, HaversError> {
+        let function = self.current_function.unwrap();
+        let check_magic = self
+            .context
+            .append_basic_block(function, "strlen_check_magic");
+        let from_header = self.context.append_basic_block(function, "strlen_header");
+        let slow = self.context.append_basic_block(function, "strlen_slow");
+        let done = self.context.append_basic_block(function, "strlen_done");
+
+        let i64_type = self.types.i64_type;
+        let i32_type = self.types.i32_type;
+        let addr = self
+            .builder
+            .build_ptr_to_int(str_ptr, i64_type, "str_addr")
+            .unwrap();
+
+        // Header candidates are 8 mod 16 with the whole header on the same page.
+        let low = self
+            .builder
+            .build_and(addr, i64_type.const_int(15, false), "str_align")
+            .unwrap();
+        let aligned = self
+            .builder
+            .build_int_compare(
+                IntPredicate::EQ,
+                low,
+                i64_type.const_int(8, false),
+                "str_aligned",
+            )
+            .unwrap();
+        let page_off = self
+            .builder
+            .build_and(addr, i64_type.const_int(4095, false), "str_page_off")
+            .unwrap();
+        let in_page = self
+            .builder
+            .build_int_compare(
+                IntPredicate::UGE,
+                page_off,
+                i64_type.const_int(STRING_HEADER_SIZE, false),
+                "str_in_page",
+            )
+            .unwrap();
+        let candidate = self
+            .builder
+            .build_and(aligned, in_page, "str_candidate")
+            .unwrap();
+        self.builder
+            .build_conditional_branch(candidate, check_magic, slow)
+            .unwrap();
+
+        self.builder.position_at_end(check_magic);
+        let magic_addr = self
+            .builder
+            .build_int_add(
+                addr,
+                i64_type.const_int(STRING_MAGIC_OFFSET as u64, true),
+                "str_magic_addr",
+            )
+            .unwrap();
+        let magic_ptr = self
+            .builder
+            .build_int_to_ptr(
+                magic_addr,
+                i32_type.ptr_type(AddressSpace::default()),
+                "str_magic_ptr",
+            )
+            .unwrap();
+        let magic = self
+            .builder
+            .build_load(i32_type, magic_ptr, "str_magic")
+            .unwrap()
+            .into_int_value();
+        let shifted = self
+            .builder
+            .build_right_shift(addr, i64_type.const_int(3, false), false, "str_addr_shr")
+            .unwrap();
+        let addr_bits = self
+            .builder
+            .build_int_truncate(shifted, i32_type, "str_addr_bits")
+            .unwrap();
+        let expected = self
+            .builder
+            .build_xor(
+                addr_bits,
+                i32_type.const_int(STRING_MAGIC as u64, false),
+                "str_expected_magic",
+            )
+            .unwrap();
+        let has_header = self
+            .builder
+            .build_int_compare(IntPredicate::EQ, magic, expected, "str_has_header")
+            .unwrap();
+        self.builder
+            .build_conditional_branch(has_header, from_header, slow)
+            .unwrap();
+
+        self.builder.position_at_end(from_header);
+        let len_addr = self
+            .builder
+            .build_int_sub(
+                addr,
+                i64_type.const_int(STRING_HEADER_SIZE, false),
+                "str_len_addr",
+            )
+            .unwrap();
+        let len_ptr = self
+            .builder
+            .build_int_to_ptr(
+                len_addr,
+                i64_type.ptr_type(AddressSpace::default()),
+                "str_len_ptr",
+            )
+            .unwrap();
+        let header_len = self
+            .builder
+            .build_load(i64_type, len_ptr, "str_header_len")
+            .unwrap()
+            .into_int_value();
+        self.builder.build_unconditional_branch(done).unwrap();
+
+        self.builder.position_at_end(slow);
+        let scanned_len = self
+            .builder
+            .build_call(self.libc.strlen, &[str_ptr.into()], "len")
+            .unwrap()
+            .try_as_basic_value()
+            .left()
+            .unwrap()
+            .into_int_value();
+        self.builder.build_unconditional_branch(done).unwrap();
+
+        self.builder.position_at_end(done);
+        let phi = self.builder.build_phi(i64_type, "str_len").unwrap();
+        phi.add_incoming(&[(&header_len, from_header), (&scanned_len, slow)]);
+        Ok(phi.as_basic_value().into_int_value())
+    }
+
+    /// `len(s)` for a string variable with shadows: use the tracked length without letting the
+    /// buffer escape, so append loops that test `len(s)` stay linear.
+    fn compile_len_from_shadow(
+        &mut self,
+        alloca: PointerValue<'ctx>,
+        len_shadow: PointerValue<'ctx>,
+    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
+        let function = self.current_function.unwrap();
+        let val = self
+            .builder
+            .build_load(self.types.value_type, alloca, "len_var")
+            .unwrap();
+        let string_tag = self
+            .types
+            .i8_type
+            .const_int(ValueTag::String.as_u8() as u64, false);
+        let tag = self.extract_tag(val).unwrap();
+        let is_str = self
+            .builder
+            .build_int_compare(IntPredicate::EQ, tag, string_tag, "len_var_is_str")
+            .unwrap();
+        let shadow_block = self.context.append_basic_block(function, "len_shadow");
+        let generic_block = self.context.append_basic_block(function, "len_generic");
+        let merge = self
+            .context
+            .append_basic_block(function, "len_shadow_merge");
+        self.builder
+            .build_conditional_branch(is_str, shadow_block, generic_block)
+            .unwrap();
+
+        self.builder.position_at_end(shadow_block);
+        let len = self
+            .builder
+            .build_load(self.types.i64_type, len_shadow, "shadow_len")
+            .unwrap()
+            .into_int_value();
+        let shadow_result = self.make_int(len)?;
+        let shadow_end = self.builder.get_insert_block().unwrap();
+        self.builder.build_unconditional_branch(merge).unwrap();
+
+        self.builder.position_at_end(generic_block);
+        let generic_result = self.inline_len(val)?;
+        let generic_end = self.builder.get_insert_block().unwrap();
+        self.builder.build_unconditional_branch(merge).unwrap();
+
+        self.builder.position_at_end(merge);
+        let phi = self
+            .builder
+            .build_phi(self.types.value_type, "len_result")
+            .unwrap();
+        phi.add_incoming(&[(&shadow_result, shadow_end), (&generic_result, generic_end)]);
+        Ok(phi.as_basic_value())
+    }
+
+    /// Store the length of `value` into a string length shadow, or 0 if it is not a string.
+    fn store_string_len_shadow(
+        &mut self,
+        len_shadow: PointerValue<'ctx>,
+        value: BasicValueEnum<'ctx>,
+    ) -> Result<(), HaversError> {
+        let function = self.current_function.unwrap();
+        let zero = self.types.i64_type.const_int(0, false);
+        self.builder.build_store(len_shadow, zero).unwrap();
+
+        let string_tag = self
+            .types
+            .i8_type
+            .const_int(ValueTag::String.as_u8() as u64, false);
+        let tag = self.extract_tag(value).unwrap();
+        let is_str = self
+            .builder
+            .build_int_compare(IntPredicate::EQ, tag, string_tag, "shadow_is_str")
+            .unwrap();
+        let len_block = self.context.append_basic_block(function, "shadow_len");
+        let done = self.context.append_basic_block(function, "shadow_len_done");
+        self.builder
+            .build_conditional_branch(is_str, len_block, done)
+            .unwrap();
+
+        self.builder.position_at_end(len_block);
+        let data = self.extract_data(value).unwrap();
+        let str_ptr = self
+            .builder
+            .build_int_to_ptr(
+                data,
+                self.context.i8_type().ptr_type(AddressSpace::default()),
+                "str_for_len",
+            )
+            .unwrap();
+        let len = self.build_string_length(str_ptr)?;
+        self.builder.build_store(len_shadow, len).unwrap();
+        self.builder.build_unconditional_branch(done).unwrap();
+
+        self.builder.position_at_end(done);
+        Ok(())
+    }
+
     /// Get length of a string (len)
     fn inline_len(
         &mut self,
@@ -6614,14 +8491,7 @@ impl<'ctx> CodeGen<'ctx> {
                 "str",
             )
             .unwrap();
-        let len = self
-            .builder
-            .build_call(self.libc.strlen, &[str_ptr.into()], "len")
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .unwrap()
-            .into_int_value();
+        let len = self.build_string_length(str_ptr)?;
         let string_result = self.make_int(len).unwrap();
         self.builder.build_unconditional_branch(len_merge).unwrap();
         let string_block = self.builder.get_insert_block().unwrap();
@@ -6738,22 +8608,17 @@ impl<'ctx> CodeGen<'ctx> {
         self.builder.build_unconditional_branch(len_merge).unwrap();
         let dict_block = self.builder.get_insert_block().unwrap();
 
-        // Default -> 0
+        // Default -> runtime __mdh_len (typed arrays; type error for the rest)
         self.builder.position_at_end(len_default);
-        let op = self
+        let other_len = self
             .builder
-            .build_global_string_ptr("len", "len_op")
-            .unwrap();
-        let zero_i8 = self.types.i8_type.const_int(0, false);
-        self.builder
-            .build_call(
-                self.libc.type_error,
-                &[op.as_pointer_value().into(), tag.into(), zero_i8.into()],
-                "",
-            )
-            .unwrap();
-        let zero = self.types.i64_type.const_int(0, false);
-        let default_result = self.make_int(zero).unwrap();
+            .build_call(self.libc.value_len, &[val.into()], "other_len")
+            .unwrap()
+            .try_as_basic_value()
+            .left()
+            .unwrap()
+            .into_int_value();
+        let default_result = self.make_int(other_len).unwrap();
         self.builder.build_unconditional_branch(len_merge).unwrap();
         let default_block = self.builder.get_insert_block().unwrap();
 
@@ -7501,6 +9366,64 @@ impl<'ctx> CodeGen<'ctx> {
 
     // ========== Phase 2: List Operations ==========
 
+    /// Items pointer (as i64) of a list about to be written in place. A negative capacity
+    /// means the items are shared with a slice view, so the list takes its own copy first.
+    fn list_items_for_write(
+        &self,
+        list_ptr: PointerValue<'ctx>,
+    ) -> Result<IntValue<'ctx>, HaversError> {
+        let function = self.current_function.unwrap();
+        let cap_ptr = unsafe {
+            self.builder
+                .build_gep(
+                    self.types.i64_type,
+                    list_ptr,
+                    &[self.types.i64_type.const_int(2, false)],
+                    "list_cap_ptr",
+                )
+                .unwrap()
+        };
+        let capacity = self
+            .builder
+            .build_load(self.types.i64_type, cap_ptr, "list_cap")
+            .unwrap()
+            .into_int_value();
+        let is_shared = self
+            .builder
+            .build_int_compare(
+                IntPredicate::SLT,
+                capacity,
+                self.types.i64_type.const_int(0, false),
+                "list_is_shared",
+            )
+            .unwrap();
+        let unshare_block = self.context.append_basic_block(function, "list_unshare");
+        let write_block = self.context.append_basic_block(function, "list_write");
+        self.builder
+            .build_conditional_branch(is_shared, unshare_block, write_block)
+            .unwrap();
+
+        self.builder.position_at_end(unshare_block);
+        let i8_ptr_type = self.context.i8_type().ptr_type(AddressSpace::default());
+        let raw_list = self
+            .builder
+            .build_pointer_cast(list_ptr, i8_ptr_type, "list_raw")
+            .unwrap();
+        self.builder
+            .build_call(self.libc.list_unshare, &[raw_list.into()], "")
+            .unwrap();
+        self.builder
+            .build_unconditional_branch(write_block)
+            .unwrap();
+
+        self.builder.position_at_end(write_block);
+        Ok(self
+            .builder
+            .build_load(self.types.i64_type, list_ptr, "items_ptr_i64")
+            .unwrap()
+            .into_int_value())
+    }
+
     /// Helper to get element pointer at index in a list
     /// Helper to get pointer to list element at given index
     /// MdhList struct layout: { MdhValue *items; int64_t length; int64_t capacity; }
@@ -8074,7 +9997,11 @@ impl<'ctx> CodeGen<'ctx> {
             .unwrap();
         let new_str = self
             .builder
-            .build_call(self.libc.malloc, &[alloc_size.into()], "slap_new_str")
+            .build_call(
+                self.libc.malloc_atomic,
+                &[alloc_size.into()],
+                "slap_new_str",
+            )
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -8308,7 +10235,7 @@ impl<'ctx> CodeGen<'ctx> {
             .unwrap();
         let new_str = self
             .builder
-            .build_call(self.libc.malloc, &[buf_size.into()], "new_str")
+            .build_call(self.libc.malloc_atomic, &[buf_size.into()], "new_str")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -9011,7 +10938,7 @@ impl<'ctx> CodeGen<'ctx> {
         let buf_size = self.builder.build_int_add(len, one, "buf_size").unwrap();
         let result_buf = self
             .builder
-            .build_call(self.libc.malloc, &[buf_size.into()], "upper_buf")
+            .build_call(self.libc.malloc_atomic, &[buf_size.into()], "upper_buf")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -9131,7 +11058,7 @@ impl<'ctx> CodeGen<'ctx> {
         let buf_size = self.builder.build_int_add(len, one, "buf_size").unwrap();
         let result_buf = self
             .builder
-            .build_call(self.libc.malloc, &[buf_size.into()], "lower_buf")
+            .build_call(self.libc.malloc_atomic, &[buf_size.into()], "lower_buf")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -9739,7 +11666,7 @@ impl<'ctx> CodeGen<'ctx> {
 
         let result_buf = self
             .builder
-            .build_call(self.libc.malloc, &[buf_size.into()], "trim_buf")
+            .build_call(self.libc.malloc_atomic, &[buf_size.into()], "trim_buf")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -9869,7 +11796,58 @@ impl<'ctx> CodeGen<'ctx> {
 
     // ========== Statement Compilation ==========
 
+    /// The file name of the source being compiled, for profiles and traces
+    fn source_file_name(&self) -> String {
+        self.source_path
+            .as_deref()
+            .and_then(Path::file_name)
+            .map_or_else(
+                || "?".to_string(),
+                |name| name.to_string_lossy().into_owned(),
+            )
+    }
+
+    /// Record `function` as the user function `name`, defined on `line`, for stack traces
+    fn note_frame(&mut self, function: FunctionValue<'ctx>, name: &str, line: usize) {
+        let file = self.source_file_name();
+        let llvm_name = function.get_name().to_string_lossy().into_owned();
+        self.frames.note(&llvm_name, name, &file, line);
+    }
+
+    /// Point the runtime's profilers at `stmt` before it runs.
+    fn mark_profile_site(&mut self, stmt: &Stmt) {
+        if matches!(
+            stmt,
+            Stmt::Block { .. } | Stmt::Function { .. } | Stmt::Class { .. } | Stmt::Struct { .. }
+        ) {
+            return;
+        }
+        let function = match self.builder.get_insert_block() {
+            Some(block) if block.get_terminator().is_none() => block.get_parent(),
+            _ => None,
+        };
+        let function = match function {
+            Some(function) => function.get_name().to_string_lossy().into_owned(),
+            None => return,
+        };
+        let name = format!("{} ({}:{})", function, self.source_file_name(), stmt.span().line);
+        let id = match self.profile_sites.as_mut() {
+            Some(sites) => sites.id(name),
+            None => return,
+        };
+        let site = heapprof::site_global(self.context, &self.module);
+        self.builder
+            .build_store(
+                site.as_pointer_value(),
+                self.types.i64_type.const_int(id, false),
+            )
+            .unwrap();
+    }
+
     fn compile_stmt(&mut self, stmt: &Stmt) -> Result<(), HaversError> {
+        if self.profile_sites.is_some() {
+            self.mark_profile_site(stmt);
+        }
         match stmt {
             Stmt::VarDecl {
                 name, initializer, ..
@@ -9927,9 +11905,20 @@ impl<'ctx> CodeGen<'ctx> {
                 } else {
                     VarType::Unknown
                 };
+                // A number only counts if no other binding of the name can change its type
+                let var_type = match var_type {
+                    VarType::Int | VarType::Float
+                        if self.numeric_locals.get(name) != Some(&var_type) =>
+                    {
+                        VarType::Unknown
+                    }
+                    other => other,
+                };
                 self.var_types.insert(name.clone(), var_type);
 
-                // Track class type if this is a class instantiation
+                // Track class type if this is a class instantiation; any other value
+                // leaves the variable's class unknown
+                self.variable_class_types.remove(name);
                 if let Some(init) = initializer {
                     if let Expr::Call { callee, .. } = init {
                         if let Expr::Variable {
@@ -10068,6 +12057,14 @@ impl<'ctx> CodeGen<'ctx> {
                     .build_store(alloca, value)
                     .unwrap();
 
+                // A lambda declared straight into the variable: calls through it can try
+                // the lambda directly
+                if let Some(Expr::Lambda { .. }) = initializer {
+                    if let Some(lambda) = self.last_lambda {
+                        self.known_lambdas.insert(alloca, lambda);
+                    }
+                }
+
                 // Create shadow if needed
                 if var_type == VarType::Int && !self.int_shadows.contains_key(name) {
                     let shadow = self.create_entry_block_alloca_i64(&format!("{}_shadow", name));
@@ -10078,12 +12075,17 @@ impl<'ctx> CodeGen<'ctx> {
                     self.int_shadows.insert(name.clone(), shadow);
                 }
 
+                // Redeclaring a tracked string: refresh its length shadow.
+                if let Some(&len_shadow) = self.string_len_shadows.get(name) {
+                    self.store_string_len_shadow(len_shadow, value)?;
+                }
+
 	                // Create string length and capacity shadows if needed
 	                if var_type == VarType::String && !self.string_len_shadows.contains_key(name) {
                     let len_shadow =
                         self.create_entry_block_alloca_i64(&format!("{}_strlen", name));
                     let cap_shadow =
-                        self.create_entry_block_alloca_i64(&format!("{}_strcap", name));
+                        self.create_entry_block_alloca_i64_pair(&format!("{}_strcap", name));
                     // Default: assume empty/externally-owned.
                     let zero = self.types.i64_type.const_int(0, false);
                     self.builder
@@ -10092,6 +12094,8 @@ impl<'ctx> CodeGen<'ctx> {
                     self.builder
                         .build_store(cap_shadow, zero)
                         .unwrap();
+                    let owner_slot = self.string_cap_owner_slot(cap_shadow);
+                    self.builder.build_store(owner_slot, zero).unwrap();
 
 	                    // Calculate initial string length and set initial capacity.
 	                    // Note: `var_type == String` implies `initializer.is_some()` (inferred from the initializer).
@@ -10117,14 +12121,7 @@ impl<'ctx> CodeGen<'ctx> {
 	                            .builder
 	                            .build_int_to_ptr(data, i8_ptr_type, "str_for_len")
 	                            .unwrap();
-	                        let len = self
-	                            .builder
-	                            .build_call(self.libc.strlen, &[str_ptr.into()], "init_strlen")
-	                            .unwrap()
-	                            .try_as_basic_value()
-	                            .left()
-	                            .unwrap()
-	                            .into_int_value();
+	                        let len = self.build_string_length(str_ptr)?;
 	                        self.builder
 	                            .build_store(len_shadow, len)
 	                            .unwrap();
@@ -10181,20 +12178,33 @@ impl<'ctx> CodeGen<'ctx> {
             } => self.compile_for(variable, iterable, body),
 
             Stmt::Function {
-                name, params, body, ..
+                name,
+                params,
+                body,
+                span,
+                ..
             } => {
                 // Ensure function is declared before compiling
                 if !self.functions.contains_key(name) {
                     self.declare_function(name, params.len());
                 }
+                self.note_frame(self.functions[name], name, span.line);
                 self.compile_function(name, params, body)
             }
 
             Stmt::Return { value, .. } => {
-                let ret_val = if let Some(v) = value {
-                    self.compile_expr(v)?
-                } else {
-                    self.make_nil()
+                let ret_val = match (value, self.return_type) {
+                    // A clone proven to return this number returns it unboxed
+                    (Some(v), VarType::Int) => match self.compile_int_expr(v) {
+                        Some(i) => i.into(),
+                        None => {
+                            let val = self.compile_expr(v)?;
+                            self.extract_data(val)?.into()
+                        }
+                    },
+                    (Some(v), VarType::Float) => self.compile_float_expr(v)?.into(),
+                    (Some(v), _) => self.compile_expr(v)?,
+                    (None, _) => self.make_nil(),
                 };
                 self.builder
                     .build_return(Some(&ret_val))
@@ -10228,10 +12238,10 @@ impl<'ctx> CodeGen<'ctx> {
 
             Stmt::Class {
                 name,
-                superclass: _,
+                superclass,
                 methods,
                 ..
-            } => self.compile_class(name, methods),
+            } => self.compile_class(name, superclass.as_deref(), methods),
 
             Stmt::Struct { name, fields, .. } => self.compile_struct_decl(name, fields),
 
@@ -10393,6 +12403,12 @@ impl<'ctx> CodeGen<'ctx> {
                         .builder
                         .build_load(self.types.value_type, alloca, name)
                         .unwrap();
+                    // The value may now be aliased, so the next self-append must not grow this
+                    // buffer in place.
+                    if let Some(&cap_shadow) = self.string_cap_shadows.get(name) {
+                        let zero = self.types.i64_type.const_int(0, false);
+                        self.builder.build_store(cap_shadow, zero).unwrap();
+                    }
                     Ok(val)
                 } else if let Some(&global) = self.globals.get(name) {
                     // Global variable
@@ -10410,166 +12426,43 @@ impl<'ctx> CodeGen<'ctx> {
                     Ok(val)
                 } else if let Some(&func) = self.functions.get(name) {
                     // User-defined function referenced as a value.
-                    // If the function has captures, create a closure cell so calls later can
+                    // If the function has captures, create a closure so calls later can
                     // supply captures automatically (and allow mutable captures via boxing).
-                    let func_ptr = func.as_global_value().as_pointer_value();
-                    let func_int = self
-                        .builder
-                        .build_ptr_to_int(func_ptr, self.types.i64_type, "func_int")
-                        .unwrap();
-
-                    // Build the function MdhValue.
-                    let fn_tag = self
-                        .types
-                        .i8_type
-                        .const_int(ValueTag::Function.as_u8() as u64, false);
-                    let undef = self.types.value_type.get_undef();
-                    let v1 = self
-                        .builder
-                        .build_insert_value(undef, fn_tag, 0, "v1")
-                        .unwrap();
-                    let fn_val = self
-                        .builder
-                        .build_insert_value(v1, func_int, 1, "fn_val")
-                        .unwrap()
-                        .into_struct_value();
-
-                    if let Some(captures) = self.function_captures.get(name).cloned() {
-                        // Ensure captured variables are boxed and capture the boxes (cells).
-                        for cap in &captures {
-                            self.ensure_boxed_variable(cap)?;
-                        }
-
-                        // Closure layout matches call_function_value(): [cap][len][elem...]
-                        // (old inline-list layout used only for closures).
-                        let closure_len = 1 + captures.len(); // fn + captures
-                        let value_size = 16u64;
-                        let header_size = 16u64;
-                        let total_size = header_size + (closure_len as u64) * value_size;
-
-                        let size_val = self.types.i64_type.const_int(total_size, false);
-                        let list_ptr = self
-                            .builder
-                            .build_call(self.libc.malloc, &[size_val.into()], "closure_ptr")
-                            .unwrap()
-                            .try_as_basic_value()
-                            .left()
-                            .unwrap()
-                            .into_pointer_value();
-
-                        // Store capacity and length in header
-                        let i64_ptr_type = self
-                            .types
-                            .i64_type
-                            .ptr_type(inkwell::AddressSpace::default());
-                        let header_ptr = self
-                            .builder
-                            .build_pointer_cast(list_ptr, i64_ptr_type, "header_ptr")
-                            .unwrap();
-                        let cap_val = self.types.i64_type.const_int(closure_len as u64, false);
-                        self.builder.build_store(header_ptr, cap_val).unwrap();
-                        let len_ptr = unsafe {
-                            self.builder
-                                .build_gep(
-                                    self.types.i64_type,
-                                    header_ptr,
-                                    &[self.types.i64_type.const_int(1, false)],
-                                    "len_ptr",
-                                )
-                                .unwrap()
+                    let Some(captures) = self.function_captures.get(name).cloned() else {
+                        return Ok(self.function_value(func).into());
+                    };
+                    // Ensure captured variables are boxed and capture the boxes (cells).
+                    for cap in &captures {
+                        self.ensure_boxed_variable(cap)?;
+                    }
+                    let mut capture_vals = Vec::with_capacity(captures.len());
+                    for (i, cap_name) in captures.iter().enumerate() {
+                        let cap_alloca = match self
+                            .variables
+                            .get(cap_name)
+                            .copied()
+                            .or(self.globals.get(cap_name).copied())
+                        {
+                            Some(a) => a,
+                            None => {
+                                return Err(HaversError::CompileError(format!(
+                                    "Captured variable '{}' not found in scope when closing over '{}'",
+                                    cap_name, name
+                                )));
+                            }
                         };
-                        let len_val = self.types.i64_type.const_int(closure_len as u64, false);
-                        self.builder.build_store(len_ptr, len_val).unwrap();
-
-                        // Store function pointer as first element
-                        let elem0_ptr = unsafe {
+                        capture_vals.push(
                             self.builder
-                                .build_gep(
-                                    self.context.i8_type(),
-                                    list_ptr,
-                                    &[self.types.i64_type.const_int(header_size, false)],
-                                    "elem0_ptr",
-                                )
-                                .unwrap()
-                        };
-                        let elem0_val_ptr = self
-                            .builder
-                            .build_pointer_cast(
-                                elem0_ptr,
-                                self.types.value_type.ptr_type(AddressSpace::default()),
-                                "elem0_val_ptr",
-                            )
-                            .unwrap();
-                        self.builder.build_store(elem0_val_ptr, fn_val).unwrap();
-
-                        // Store captured boxes
-                        for (i, cap_name) in captures.iter().enumerate() {
-                            let cap_alloca = match self
-                                .variables
-                                .get(cap_name)
-                                .copied()
-                                .or(self.globals.get(cap_name).copied())
-                            {
-                                Some(a) => a,
-                                None => {
-                                    return Err(HaversError::CompileError(format!(
-	                                        "Captured variable '{}' not found in scope when closing over '{}'",
-	                                        cap_name, name
-	                                    )));
-                                }
-                            };
-                            let cap_val = self
-                                .builder
                                 .build_load(
                                     self.types.value_type,
                                     cap_alloca,
                                     &format!("cap{}_val", i),
                                 )
-                                .unwrap();
-                            let elem_offset = header_size + ((i + 1) as u64) * value_size;
-                            let elem_ptr = unsafe {
-                                self.builder
-                                    .build_gep(
-                                        self.context.i8_type(),
-                                        list_ptr,
-                                        &[self.types.i64_type.const_int(elem_offset, false)],
-                                        &format!("elem{}_ptr", i + 1),
-                                    )
-                                    .unwrap()
-                            };
-                            let elem_val_ptr = self
-                                .builder
-                                .build_pointer_cast(
-                                    elem_ptr,
-                                    self.types.value_type.ptr_type(AddressSpace::default()),
-                                    &format!("elem{}_val_ptr", i + 1),
-                                )
-                                .unwrap();
-                            self.builder.build_store(elem_val_ptr, cap_val).unwrap();
-                        }
-
-                        // Return closure as Closure value (tag=Closure)
-                        let list_ptr_int = self
-                            .builder
-                            .build_ptr_to_int(list_ptr, self.types.i64_type, "closure_ptr_int")
-                            .unwrap();
-                        let closure_tag = self
-                            .types
-                            .i8_type
-                            .const_int(ValueTag::Closure.as_u8() as u64, false);
-                        let undef2 = self.types.value_type.get_undef();
-                        let c1 = self
-                            .builder
-                            .build_insert_value(undef2, closure_tag, 0, "c1")
-                            .unwrap();
-                        let c2 = self
-                            .builder
-                            .build_insert_value(c1, list_ptr_int, 1, "c2")
-                            .unwrap();
-                        Ok(c2.into_struct_value().into())
-                    } else {
-                        Ok(fn_val.into())
+                                .unwrap(),
+                        );
                     }
+                    let entry = self.closure_entry(func, captures.len());
+                    Ok(self.build_closure(entry, &capture_vals))
                 } else if name == "PI" {
                     // Built-in constant: PI
                     let pi_val = self.context.f64_type().const_float(std::f64::consts::PI);
@@ -10596,6 +12489,9 @@ impl<'ctx> CodeGen<'ctx> {
                     self.import_alias_bindings.remove(name);
                     self.import_alias_functions.remove(name);
                 }
+                // Whatever the variable's class was, it's unknown after this unless the value
+                // is a constructor call (tracked below)
+                self.variable_class_types.remove(name);
                 // Boxed variables store a 1-element list cell. Assignment updates cell[0].
                 if self.boxed_vars.contains(name) {
                     let new_val = self.compile_expr(value)?;
@@ -10685,6 +12581,10 @@ impl<'ctx> CodeGen<'ctx> {
                                         name, len_shadow, cap_shadow, right, rlen,
                                     );
                                 }
+                                // s = s + expr: same growth, with the right side checked at runtime
+                                return self.compile_string_self_append_dynamic(
+                                    name, len_shadow, cap_shadow, right,
+                                );
                             }
                         }
                     }
@@ -10805,25 +12705,7 @@ impl<'ctx> CodeGen<'ctx> {
                                 .build_store(len_shadow, new_len)
                                 .unwrap();
                         } else {
-                            // Compute length with strlen
-                            let data = self.extract_data(val).unwrap();
-                            let i8_ptr_type =
-                                self.context.i8_type().ptr_type(AddressSpace::default());
-                            let str_ptr = self
-                                .builder
-                                .build_int_to_ptr(data, i8_ptr_type, "str_for_len")
-                                .unwrap();
-                            let len = self
-                                .builder
-                                .build_call(self.libc.strlen, &[str_ptr.into()], "new_strlen")
-                                .unwrap()
-                                .try_as_basic_value()
-                                .left()
-                                .unwrap()
-                                .into_int_value();
-                            self.builder
-                                .build_store(len_shadow, len)
-                                .unwrap();
+                            self.store_string_len_shadow(len_shadow, val)?;
                         }
                     }
                     Ok(val)
@@ -11026,6 +12908,17 @@ impl<'ctx> CodeGen<'ctx> {
             }
         }
 
+        // Float fast path: both sides proven numeric, at least one a float
+        if self.float_operands(left, right)
+            && matches!(
+                op,
+                BinaryOp::Add | BinaryOp::Subtract | BinaryOp::Multiply | BinaryOp::Divide
+            )
+        {
+            let result = self.compile_float_arith(left, op, right)?;
+            return self.make_float(result);
+        }
+
         // String fast path for concatenation - skip type checks
         if left_type == VarType::String && right_type == VarType::String {
             if let BinaryOp::Add = op {
@@ -11176,13 +13069,7 @@ impl<'ctx> CodeGen<'ctx> {
                     .unwrap()
                     .into_int_value()
             } else {
-                self.builder
-                    .build_call(self.libc.strlen, &[left_ptr.into()], "llen_fast")
-                    .unwrap()
-                    .try_as_basic_value()
-                    .left()
-                    .unwrap()
-                    .into_int_value()
+                self.build_string_length(left_ptr)?
             }
         } else if let Expr::Literal {
             value: Literal::String(s),
@@ -11191,13 +13078,7 @@ impl<'ctx> CodeGen<'ctx> {
         {
             self.types.i64_type.const_int(s.len() as u64, false)
         } else {
-            self.builder
-                .build_call(self.libc.strlen, &[left_ptr.into()], "llen_fast")
-                .unwrap()
-                .try_as_basic_value()
-                .left()
-                .unwrap()
-                .into_int_value()
+            self.build_string_length(left_ptr)?
         };
 
         // Get right length - use compile-time length for literals
@@ -11214,22 +13095,10 @@ impl<'ctx> CodeGen<'ctx> {
                     .unwrap()
                     .into_int_value()
             } else {
-                self.builder
-                    .build_call(self.libc.strlen, &[right_ptr.into()], "rlen_fast")
-                    .unwrap()
-                    .try_as_basic_value()
-                    .left()
-                    .unwrap()
-                    .into_int_value()
+                self.build_string_length(right_ptr)?
             }
         } else {
-            self.builder
-                .build_call(self.libc.strlen, &[right_ptr.into()], "rlen_fast")
-                .unwrap()
-                .try_as_basic_value()
-                .left()
-                .unwrap()
-                .into_int_value()
+            self.build_string_length(right_ptr)?
         };
 
         // Allocate new string (len1 + len2 + 1)
@@ -11244,7 +13113,11 @@ impl<'ctx> CodeGen<'ctx> {
             .unwrap();
         let new_str = self
             .builder
-            .build_call(self.libc.malloc, &[alloc_size.into()], "new_str_fast")
+            .build_call(
+                self.libc.malloc_atomic,
+                &[alloc_size.into()],
+                "new_str_fast",
+            )
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -11298,7 +13171,6 @@ impl<'ctx> CodeGen<'ctx> {
         right_expr: &Expr,
         right_len: usize,
     ) -> Result<BasicValueEnum<'ctx>, HaversError> {
-        let function = self.current_function.unwrap();
         let i8_ptr_type = self.context.i8_type().ptr_type(AddressSpace::default());
         let right_len_const = self.types.i64_type.const_int(right_len as u64, false);
 
@@ -11310,7 +13182,41 @@ impl<'ctx> CodeGen<'ctx> {
             .build_int_to_ptr(right_data, i8_ptr_type, "right_ptr")
             .unwrap();
 
-        // Load current string pointer, length, and capacity
+        let var_alloca = match self.variables.get(var_name) {
+            Some(a) => *a,
+            None => {
+                return Err(HaversError::CompileError(format!(
+                    "Variable not found: {}",
+                    var_name
+                )));
+            }
+        };
+        self.emit_string_buffer_append(
+            var_alloca,
+            len_shadow,
+            cap_shadow,
+            right_ptr,
+            right_len_const,
+        )
+    }
+
+    /// Optimized `s = s + expr` for a non-literal right side. When both sides are strings
+    /// at runtime the right side is appended into `s`'s own growable buffer; anything else
+    /// goes through the generic `+` and leaves `s` externally owned.
+    fn compile_string_self_append_dynamic(
+        &mut self,
+        var_name: &str,
+        len_shadow: PointerValue<'ctx>,
+        cap_shadow: PointerValue<'ctx>,
+        right_expr: &Expr,
+    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
+        let function = self.current_function.unwrap();
+        let i8_ptr_type = self.context.i8_type().ptr_type(AddressSpace::default());
+
+        // Evaluate the right side first: if it reads `s` the buffer escapes (cap -> 0) and the
+        // append below copies instead of growing a buffer the right side points into.
+        let right_val = self.compile_expr(right_expr)?;
+
         let var_alloca = match self.variables.get(var_name) {
             Some(a) => *a,
             None => {
@@ -11320,6 +13226,94 @@ impl<'ctx> CodeGen<'ctx> {
                 )));
             }
         };
+        let current_val = self
+            .builder
+            .build_load(self.types.value_type, var_alloca, "current_str")
+            .unwrap();
+
+        let string_tag = self
+            .types
+            .i8_type
+            .const_int(ValueTag::String.as_u8() as u64, false);
+        let left_tag = self.extract_tag(current_val).unwrap();
+        let right_tag = self.extract_tag(right_val).unwrap();
+        let left_is_str = self
+            .builder
+            .build_int_compare(IntPredicate::EQ, left_tag, string_tag, "self_is_str")
+            .unwrap();
+        let right_is_str = self
+            .builder
+            .build_int_compare(IntPredicate::EQ, right_tag, string_tag, "rhs_is_str")
+            .unwrap();
+        let both_str = self
+            .builder
+            .build_and(left_is_str, right_is_str, "both_str")
+            .unwrap();
+
+        let append_block = self.context.append_basic_block(function, "self_append_str");
+        let generic_block = self
+            .context
+            .append_basic_block(function, "self_append_generic");
+        let done_block = self
+            .context
+            .append_basic_block(function, "self_append_done");
+        self.builder
+            .build_conditional_branch(both_str, append_block, generic_block)
+            .unwrap();
+
+        self.builder.position_at_end(append_block);
+        let right_data = self.extract_data(right_val).unwrap();
+        let right_ptr = self
+            .builder
+            .build_int_to_ptr(right_data, i8_ptr_type, "right_ptr")
+            .unwrap();
+        let right_len = match right_expr {
+            Expr::Variable { name, .. } if self.string_len_shadows.contains_key(name) => {
+                let rshadow = self.string_len_shadows[name];
+                self.builder
+                    .build_load(self.types.i64_type, rshadow, "rvar_len")
+                    .unwrap()
+                    .into_int_value()
+            }
+            _ => self.build_string_length(right_ptr)?,
+        };
+        let appended = self
+            .emit_string_buffer_append(var_alloca, len_shadow, cap_shadow, right_ptr, right_len)?;
+        let append_end = self.builder.get_insert_block().unwrap();
+        self.builder.build_unconditional_branch(done_block).unwrap();
+
+        self.builder.position_at_end(generic_block);
+        let generic = self.inline_add(current_val, right_val)?;
+        self.builder.build_store(var_alloca, generic).unwrap();
+        let zero = self.types.i64_type.const_int(0, false);
+        self.builder.build_store(cap_shadow, zero).unwrap();
+        self.store_string_len_shadow(len_shadow, generic)?;
+        let generic_end = self.builder.get_insert_block().unwrap();
+        self.builder.build_unconditional_branch(done_block).unwrap();
+
+        self.builder.position_at_end(done_block);
+        let phi = self
+            .builder
+            .build_phi(self.types.value_type, "self_append_result")
+            .unwrap();
+        phi.add_incoming(&[(&appended, append_end), (&generic, generic_end)]);
+        Ok(phi.as_basic_value())
+    }
+
+    /// Append `right_len` bytes at `right_ptr` to the string in `var_alloca`, growing the
+    /// variable's own buffer (tracked by `cap_shadow`, 0 = not owned) geometrically.
+    fn emit_string_buffer_append(
+        &mut self,
+        var_alloca: PointerValue<'ctx>,
+        len_shadow: PointerValue<'ctx>,
+        cap_shadow: PointerValue<'ctx>,
+        right_ptr: PointerValue<'ctx>,
+        right_len: IntValue<'ctx>,
+    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
+        let function = self.current_function.unwrap();
+        let i8_ptr_type = self.context.i8_type().ptr_type(AddressSpace::default());
+
+        // Load current string pointer, length, and capacity
         let current_val = self
             .builder
             .build_load(self.types.value_type, var_alloca, "current_str")
@@ -11330,21 +13324,59 @@ impl<'ctx> CodeGen<'ctx> {
             .build_int_to_ptr(current_data, i8_ptr_type, "current_ptr")
             .unwrap();
 
-        let old_len = self
+        let shadow_cap = self
+            .builder
+            .build_load(self.types.i64_type, cap_shadow, "shadow_cap")
+            .unwrap()
+            .into_int_value();
+        // The capacity only applies while the variable still holds the buffer it was recorded
+        // for; anything else that wrote the variable leaves it externally owned.
+        let owner_slot = self.string_cap_owner_slot(cap_shadow);
+        let owner = self
+            .builder
+            .build_load(self.types.i64_type, owner_slot, "strcap_owner_addr")
+            .unwrap()
+            .into_int_value();
+        let is_owner = self
+            .builder
+            .build_int_compare(IntPredicate::EQ, owner, current_data, "owns_buf")
+            .unwrap();
+
+        // Only trust the length shadow for our own buffer; recount a foreign value once.
+        let shadow_len = self
             .builder
-            .build_load(self.types.i64_type, len_shadow, "old_len")
+            .build_load(self.types.i64_type, len_shadow, "shadow_len")
             .unwrap()
             .into_int_value();
+        let owned_block = self.builder.get_insert_block().unwrap();
+        let recount_block = self.context.append_basic_block(function, "str_recount");
+        let len_known = self.context.append_basic_block(function, "str_len_known");
+        self.builder
+            .build_conditional_branch(is_owner, len_known, recount_block)
+            .unwrap();
+        self.builder.position_at_end(recount_block);
+        let counted_len = self.build_string_length(current_ptr)?;
+        let recount_end = self.builder.get_insert_block().unwrap();
+        self.builder.build_unconditional_branch(len_known).unwrap();
+        self.builder.position_at_end(len_known);
+        let old_len_phi = self
+            .builder
+            .build_phi(self.types.i64_type, "old_len")
+            .unwrap();
+        old_len_phi.add_incoming(&[(&shadow_len, owned_block), (&counted_len, recount_end)]);
+        let old_len = old_len_phi.as_basic_value().into_int_value();
+
+        let zero_cap = self.types.i64_type.const_int(0, false);
         let old_cap = self
             .builder
-            .build_load(self.types.i64_type, cap_shadow, "old_cap")
+            .build_select(is_owner, shadow_cap, zero_cap, "old_cap")
             .unwrap()
             .into_int_value();
 
         // Compute new length
         let new_len = self
             .builder
-            .build_int_add(old_len, right_len_const, "new_len")
+            .build_int_add(old_len, right_len, "new_len")
             .unwrap();
         let one = self.types.i64_type.const_int(1, false);
         let new_len_plus_one = self
@@ -11352,15 +13384,6 @@ impl<'ctx> CodeGen<'ctx> {
             .build_int_add(new_len, one, "new_size")
             .unwrap();
 
-        // Use an alloca to store the working buffer pointer
-        let buf_ptr_alloca = self
-            .builder
-            .build_alloca(i8_ptr_type, "buf_ptr_alloca")
-            .unwrap();
-        self.builder
-            .build_store(buf_ptr_alloca, current_ptr)
-            .unwrap();
-
         // Check if we need to grow: new_len + 1 > capacity?
         let needs_grow = self
             .builder
@@ -11370,6 +13393,7 @@ impl<'ctx> CodeGen<'ctx> {
         let grow_block = self.context.append_basic_block(function, "str_grow");
         let append_block = self.context.append_basic_block(function, "str_append");
 
+        let no_grow_block = self.builder.get_insert_block().unwrap();
         self.builder
             .build_conditional_branch(needs_grow, grow_block, append_block)
             .unwrap();
@@ -11422,7 +13446,7 @@ impl<'ctx> CodeGen<'ctx> {
         self.builder.position_at_end(malloc_block);
         let malloc_result = self
             .builder
-            .build_call(self.libc.malloc, &[new_cap.into()], "new_buf")
+            .build_call(self.libc.malloc_atomic, &[new_cap.into()], "new_buf")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -11436,9 +13460,6 @@ impl<'ctx> CodeGen<'ctx> {
                 "",
             )
             .unwrap();
-        self.builder
-            .build_store(buf_ptr_alloca, malloc_result)
-            .unwrap();
         self.builder.build_unconditional_branch(after_grow).unwrap();
 
         // REALLOC PATH: extend existing buffer
@@ -11455,13 +13476,21 @@ impl<'ctx> CodeGen<'ctx> {
             .left()
             .unwrap()
             .into_pointer_value();
-        self.builder
-            .build_store(buf_ptr_alloca, realloc_result)
-            .unwrap();
         self.builder.build_unconditional_branch(after_grow).unwrap();
 
         // AFTER GROW: update capacity and continue to append
         self.builder.position_at_end(after_grow);
+        let grown_buf = self.builder.build_phi(i8_ptr_type, "grown_buf").unwrap();
+        grown_buf.add_incoming(&[
+            (&malloc_result, malloc_block),
+            (&realloc_result, realloc_block),
+        ]);
+        let grown_ptr = grown_buf.as_basic_value().into_pointer_value();
+        let grown_addr = self
+            .builder
+            .build_ptr_to_int(grown_ptr, self.types.i64_type, "grown_addr")
+            .unwrap();
+        self.builder.build_store(owner_slot, grown_addr).unwrap();
         self.builder.build_store(cap_shadow, new_cap).unwrap();
         self.builder
             .build_unconditional_branch(append_block)
@@ -11469,11 +13498,9 @@ impl<'ctx> CodeGen<'ctx> {
 
         // APPEND PATH: copy the right string to the buffer
         self.builder.position_at_end(append_block);
-        let final_buf = self
-            .builder
-            .build_load(i8_ptr_type, buf_ptr_alloca, "final_buf")
-            .unwrap()
-            .into_pointer_value();
+        let final_buf_phi = self.builder.build_phi(i8_ptr_type, "final_buf").unwrap();
+        final_buf_phi.add_incoming(&[(&current_ptr, no_grow_block), (&grown_ptr, after_grow)]);
+        let final_buf = final_buf_phi.as_basic_value().into_pointer_value();
 
         // Calculate destination offset
         let dest_ptr = unsafe {
@@ -11485,7 +13512,7 @@ impl<'ctx> CodeGen<'ctx> {
         // Copy right string (including null terminator)
         let right_len_plus_one = self
             .builder
-            .build_int_add(right_len_const, one, "rlen_plus_one")
+            .build_int_add(right_len, one, "rlen_plus_one")
             .unwrap();
         self.builder
             .build_call(
@@ -12065,6 +14092,15 @@ impl<'ctx> CodeGen<'ctx> {
                             "len expects 1 argument".to_string(),
                         ));
                     }
+                    if let Expr::Variable { name, .. } = &args[0] {
+                        if let (Some(&alloca), Some(&len_shadow)) =
+                            (self.variables.get(name), self.string_len_shadows.get(name))
+                        {
+                            if self.string_cap_shadows.contains_key(name) {
+                                return self.compile_len_from_shadow(alloca, len_shadow);
+                            }
+                        }
+                    }
                     return self.compile_expr(&args[0]).and_then(|arg| self.inline_len(arg));
                 }
                 "bytes" | "bytes_new" => {
@@ -12172,6 +14208,123 @@ impl<'ctx> CodeGen<'ctx> {
                         "bytes_write_u32be returned void",
                     );
                 }
+                "bytes_read_u16le" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.bytes_read_u16le,
+                        args,
+                        2,
+                        "bytes_read_u16le",
+                        "bytes_read_u16le returned void",
+                    );
+                }
+                "bytes_read_u32le" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.bytes_read_u32le,
+                        args,
+                        2,
+                        "bytes_read_u32le",
+                        "bytes_read_u32le returned void",
+                    );
+                }
+                "bytes_read_u64be" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.bytes_read_u64be,
+                        args,
+                        2,
+                        "bytes_read_u64be",
+                        "bytes_read_u64be returned void",
+                    );
+                }
+                "bytes_read_u64le" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.bytes_read_u64le,
+                        args,
+                        2,
+                        "bytes_read_u64le",
+                        "bytes_read_u64le returned void",
+                    );
+                }
+                "bytes_write_u16le" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.bytes_write_u16le,
+                        args,
+                        3,
+                        "bytes_write_u16le",
+                        "bytes_write_u16le returned void",
+                    );
+                }
+                "bytes_write_u32le" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.bytes_write_u32le,
+                        args,
+                        3,
+                        "bytes_write_u32le",
+                        "bytes_write_u32le returned void",
+                    );
+                }
+                "bytes_write_u64be" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.bytes_write_u64be,
+                        args,
+                        3,
+                        "bytes_write_u64be",
+                        "bytes_write_u64be returned void",
+                    );
+                }
+                "bytes_write_u64le" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.bytes_write_u64le,
+                        args,
+                        3,
+                        "bytes_write_u64le",
+                        "bytes_write_u64le returned void",
+                    );
+                }
+                "bytes_find" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.bytes_find,
+                        args,
+                        2,
+                        "bytes_find",
+                        "bytes_find returned void",
+                    );
+                }
+                "bytes_eq" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.bytes_eq,
+                        args,
+                        2,
+                        "bytes_eq",
+                        "bytes_eq returned void",
+                    );
+                }
+                "bytes_xor" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.bytes_xor,
+                        args,
+                        2,
+                        "bytes_xor",
+                        "bytes_xor returned void",
+                    );
+                }
+                "bytes_fill" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.bytes_fill,
+                        args,
+                        4,
+                        "bytes_fill",
+                        "bytes_fill returned void",
+                    );
+                }
+                "bytes_copy_within" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.bytes_copy_within,
+                        args,
+                        4,
+                        "bytes_copy_within",
+                        "bytes_copy_within returned void",
+                    );
+                }
                 // Network builtins
                 "socket_udp" => {
                     return self.compile_runtime_call_value_with_arity(
@@ -12201,9 +14354,17 @@ impl<'ctx> CodeGen<'ctx> {
                     );
                 }
                 "socket_connect" => {
+                    // socket_connect(sock, host, port) or socket_connect(sock, addr)
+                    let mut connect_args = args.to_vec();
+                    if connect_args.len() == 2 {
+                        connect_args.push(Expr::Literal {
+                            value: Literal::Nil,
+                            span: Span::new(0, 0),
+                        });
+                    }
                     return self.compile_runtime_call_value_with_arity(
                         self.libc.socket_connect,
-                        args,
+                        &connect_args,
                         3,
                         "socket_connect",
                         "socket_connect returned void",
@@ -12300,9 +14461,17 @@ impl<'ctx> CodeGen<'ctx> {
                     );
                 }
                 "udp_send_to" => {
+                    // udp_send_to(sock, buf, host, port) or udp_send_to(sock, buf, addr)
+                    let mut send_args = args.to_vec();
+                    if send_args.len() == 3 {
+                        send_args.push(Expr::Literal {
+                            value: Literal::Nil,
+                            span: Span::new(0, 0),
+                        });
+                    }
                     return self.compile_runtime_call_value_with_arity(
                         self.libc.udp_send_to,
-                        args,
+                        &send_args,
                         4,
                         "udp_send_to",
                         "udp_send_to returned void",
@@ -12317,6 +14486,33 @@ impl<'ctx> CodeGen<'ctx> {
                         "udp_recv_from returned void",
                     );
                 }
+                "udp_recv_many" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.udp_recv_many,
+                        args,
+                        3,
+                        "udp_recv_many",
+                        "udp_recv_many returned void",
+                    );
+                }
+                "udp_send_many" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.udp_send_many,
+                        args,
+                        2,
+                        "udp_send_many",
+                        "udp_send_many returned void",
+                    );
+                }
+                "addr_resolve" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.addr_resolve,
+                        args,
+                        2,
+                        "addr_resolve",
+                        "addr_resolve returned void",
+                    );
+                }
                 "tcp_send" => {
                     return self.compile_runtime_call_value_with_arity(
                         self.libc.tcp_send,
@@ -12326,6 +14522,33 @@ impl<'ctx> CodeGen<'ctx> {
                         "tcp_send returned void",
                     );
                 }
+                "tcp_send_vec" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.tcp_send_vec,
+                        args,
+                        2,
+                        "tcp_send_vec",
+                        "tcp_send_vec returned void",
+                    );
+                }
+                "tcp_send_all" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.tcp_send_all,
+                        args,
+                        2,
+                        "tcp_send_all",
+                        "tcp_send_all returned void",
+                    );
+                }
+                "socket_send_file" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.socket_send_file,
+                        args,
+                        4,
+                        "socket_send_file",
+                        "socket_send_file returned void",
+                    );
+                }
                 "tcp_recv" => {
                     return self.compile_runtime_call_value_with_arity(
                         self.libc.tcp_recv,
@@ -12335,6 +14558,105 @@ impl<'ctx> CodeGen<'ctx> {
                         "tcp_recv returned void",
                     );
                 }
+                "tcp_recv_into" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.tcp_recv_into,
+                        args,
+                        3,
+                        "tcp_recv_into",
+                        "tcp_recv_into returned void",
+                    );
+                }
+                "udp_recv_into" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.udp_recv_into,
+                        args,
+                        2,
+                        "udp_recv_into",
+                        "udp_recv_into returned void",
+                    );
+                }
+                "bytes_pool_take" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.bytes_pool_take,
+                        args,
+                        1,
+                        "bytes_pool_take",
+                        "bytes_pool_take returned void",
+                    );
+                }
+                "bytes_pool_give" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.bytes_pool_give,
+                        args,
+                        1,
+                        "bytes_pool_give",
+                        "bytes_pool_give returned void",
+                    );
+                }
+                "base64_encode_native" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.base64_encode_native,
+                        args,
+                        1,
+                        "base64_encode_native",
+                        "base64_encode_native returned void",
+                    );
+                }
+                "base64_decode_native" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.base64_decode_native,
+                        args,
+                        2,
+                        "base64_decode_native",
+                        "base64_decode_native returned void",
+                    );
+                }
+                "hex_encode_native" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.hex_encode_native,
+                        args,
+                        1,
+                        "hex_encode_native",
+                        "hex_encode_native returned void",
+                    );
+                }
+                "hex_decode_native" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.hex_decode_native,
+                        args,
+                        2,
+                        "hex_decode_native",
+                        "hex_decode_native returned void",
+                    );
+                }
+                "sha1" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.sha1,
+                        args,
+                        1,
+                        "sha1",
+                        "sha1 returned void",
+                    );
+                }
+                "crc32" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.crc32,
+                        args,
+                        1,
+                        "crc32",
+                        "crc32 returned void",
+                    );
+                }
+                "xxhash64" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.xxhash64,
+                        args,
+                        1,
+                        "xxhash64",
+                        "xxhash64 returned void",
+                    );
+                }
                 "dns_lookup" => {
                     return self.compile_runtime_call_value_with_arity(
                         self.libc.dns_lookup,
@@ -12362,6 +14684,33 @@ impl<'ctx> CodeGen<'ctx> {
                         "dns_naptr returned void",
                     );
                 }
+                "dns_lookup_async" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.dns_lookup_async,
+                        args,
+                        1,
+                        "dns_lookup_async",
+                        "dns_lookup_async returned void",
+                    );
+                }
+                "dns_srv_async" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.dns_srv_async,
+                        args,
+                        2,
+                        "dns_srv_async",
+                        "dns_srv_async returned void",
+                    );
+                }
+                "dns_naptr_async" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.dns_naptr_async,
+                        args,
+                        1,
+                        "dns_naptr_async",
+                        "dns_naptr_async returned void",
+                    );
+                }
                 "tls_client_new" => {
                     return self.compile_runtime_call_value_with_arity(
                         self.libc.tls_client_new,
@@ -12380,6 +14729,24 @@ impl<'ctx> CodeGen<'ctx> {
                         "tls_connect returned void",
                     );
                 }
+                "tls_connect_start" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.tls_connect_start,
+                        args,
+                        2,
+                        "tls_connect_start",
+                        "tls_connect_start returned void",
+                    );
+                }
+                "tls_step" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.tls_step,
+                        args,
+                        1,
+                        "tls_step",
+                        "tls_step returned void",
+                    );
+                }
                 "tls_send" => {
                     return self.compile_runtime_call_value_with_arity(
                         self.libc.tls_send,
@@ -12407,6 +14774,15 @@ impl<'ctx> CodeGen<'ctx> {
                         "tls_close returned void",
                     );
                 }
+                "tls_stats" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.tls_stats,
+                        args,
+                        0,
+                        "tls_stats",
+                        "tls_stats returned void",
+                    );
+                }
                 "dtls_server_new" => {
                     return self.compile_runtime_call_value_with_arity(
                         self.libc.dtls_server_new,
@@ -12425,6 +14801,42 @@ impl<'ctx> CodeGen<'ctx> {
                         "dtls_handshake returned void",
                     );
                 }
+                "dtls_session_new" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.dtls_session_new,
+                        args,
+                        1,
+                        "dtls_session_new",
+                        "dtls_session_new returned void",
+                    );
+                }
+                "dtls_session_step" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.dtls_session_step,
+                        args,
+                        2,
+                        "dtls_session_step",
+                        "dtls_session_step returned void",
+                    );
+                }
+                "dtls_session_srtp" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.dtls_session_srtp,
+                        args,
+                        1,
+                        "dtls_session_srtp",
+                        "dtls_session_srtp returned void",
+                    );
+                }
+                "dtls_session_close" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.dtls_session_close,
+                        args,
+                        1,
+                        "dtls_session_close",
+                        "dtls_session_close returned void",
+                    );
+                }
                 "srtp_create" => {
                     return self.compile_runtime_call_value_with_arity(
                         self.libc.srtp_create,
@@ -12452,6 +14864,78 @@ impl<'ctx> CodeGen<'ctx> {
                         "srtp_unprotect returned void",
                     );
                 }
+                "srtp_protect_into" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.srtp_protect_into,
+                        args,
+                        2,
+                        "srtp_protect_into",
+                        "srtp_protect_into returned void",
+                    );
+                }
+                "srtp_unprotect_into" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.srtp_unprotect_into,
+                        args,
+                        2,
+                        "srtp_unprotect_into",
+                        "srtp_unprotect_into returned void",
+                    );
+                }
+                "srtp_protect_many" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.srtp_protect_many,
+                        args,
+                        2,
+                        "srtp_protect_many",
+                        "srtp_protect_many returned void",
+                    );
+                }
+                "srtp_unprotect_many" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.srtp_unprotect_many,
+                        args,
+                        2,
+                        "srtp_unprotect_many",
+                        "srtp_unprotect_many returned void",
+                    );
+                }
+                "rtp_parse_native" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.rtp_parse_native,
+                        args,
+                        1,
+                        "rtp_parse_native",
+                        "rtp_parse_native returned void",
+                    );
+                }
+                "rtp_build_native" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.rtp_build_native,
+                        args,
+                        7,
+                        "rtp_build_native",
+                        "rtp_build_native returned void",
+                    );
+                }
+                "sip_parse_native" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.sip_parse_native,
+                        args,
+                        1,
+                        "sip_parse_native",
+                        "sip_parse_native returned void",
+                    );
+                }
+                "sip_header" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.sip_header,
+                        args,
+                        2,
+                        "sip_header",
+                        "sip_header returned void",
+                    );
+                }
                 "event_loop_new" => {
                     return self.compile_runtime_call_value_with_arity(
                         self.libc.event_loop_new,
@@ -12506,6 +14990,32 @@ impl<'ctx> CodeGen<'ctx> {
                         "event_loop_poll returned void",
                     );
                 }
+                "event_loop_poll_into" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.event_loop_poll_into,
+                        args,
+                        3,
+                        "event_loop_poll_into",
+                        "event_loop_poll_into returned void",
+                    );
+                }
+                "event_loop_run" => {
+                    // event_loop_run(loop) or event_loop_run(loop, timeout_ms)
+                    let mut run_args = args.to_vec();
+                    if run_args.len() == 1 {
+                        run_args.push(Expr::Literal {
+                            value: Literal::Nil,
+                            span: Span::new(0, 0),
+                        });
+                    }
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.event_loop_run,
+                        &run_args,
+                        2,
+                        "event_loop_run",
+                        "event_loop_run returned void",
+                    );
+                }
                 "timer_after" => {
                     return self.compile_runtime_call_value_with_arity(
                         self.libc.timer_after,
@@ -12533,15 +15043,398 @@ impl<'ctx> CodeGen<'ctx> {
                         "timer_cancel returned void",
                     );
                 }
-                "thread_spawn" => {
+                "timer_after_ns" => {
                     return self.compile_runtime_call_value_with_arity(
-                        self.libc.thread_spawn,
+                        self.libc.timer_after_ns,
+                        args,
+                        3,
+                        "timer_after_ns",
+                        "timer_after_ns returned void",
+                    );
+                }
+                "timer_every_ns" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.timer_every_ns,
+                        args,
+                        3,
+                        "timer_every_ns",
+                        "timer_every_ns returned void",
+                    );
+                }
+                "co_spawn" => {
+                    // co_spawn(loop, func) or co_spawn(loop, func, args)
+                    let mut spawn_args = args.to_vec();
+                    if spawn_args.len() == 2 {
+                        spawn_args.push(Expr::Literal {
+                            value: Literal::Nil,
+                            span: Span::new(0, 0),
+                        });
+                    }
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.co_spawn,
+                        &spawn_args,
+                        3,
+                        "co_spawn",
+                        "co_spawn returned void",
+                    );
+                }
+                "co_yield" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.co_yield,
+                        args,
+                        0,
+                        "co_yield",
+                        "co_yield returned void",
+                    );
+                }
+                "co_count" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.co_count,
+                        args,
+                        1,
+                        "co_count",
+                        "co_count returned void",
+                    );
+                }
+                "co_run" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.co_run,
+                        args,
+                        1,
+                        "co_run",
+                        "co_run returned void",
+                    );
+                }
+                "event_loop_wakeup" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.event_loop_wakeup,
+                        args,
+                        1,
+                        "event_loop_wakeup",
+                        "event_loop_wakeup returned void",
+                    );
+                }
+                "event_loop_post" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.event_loop_post,
                         args,
                         2,
+                        "event_loop_post",
+                        "event_loop_post returned void",
+                    );
+                }
+                "reactor_start" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.reactor_start,
+                        args,
+                        2,
+                        "reactor_start",
+                        "reactor_start returned void",
+                    );
+                }
+                "reactor_stop" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.reactor_stop,
+                        args,
+                        1,
+                        "reactor_stop",
+                        "reactor_stop returned void",
+                    );
+                }
+                "http_parse_native" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.http_parse_native,
+                        args,
+                        1,
+                        "http_parse_native",
+                        "http_parse_native returned void",
+                    );
+                }
+                "http_serve" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.http_serve,
+                        args,
+                        3,
+                        "http_serve",
+                        "http_serve returned void",
+                    );
+                }
+                "http_request" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.http_request,
+                        args,
+                        1,
+                        "http_request",
+                        "http_request returned void",
+                    );
+                }
+                "http_pool_config" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.http_pool_config,
+                        args,
+                        1,
+                        "http_pool_config",
+                        "http_pool_config returned void",
+                    );
+                }
+                "http_pool_stats" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.http_pool_stats,
+                        args,
+                        0,
+                        "http_pool_stats",
+                        "http_pool_stats returned void",
+                    );
+                }
+                "arena_push" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.arena_push,
+                        args,
+                        0,
+                        "arena_push",
+                        "arena_push returned void",
+                    );
+                }
+                "arena_pop" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.arena_pop,
+                        args,
+                        1,
+                        "arena_pop",
+                        "arena_pop returned void",
+                    );
+                }
+                "runtime_stats" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.runtime_stats,
+                        args,
+                        0,
+                        "runtime_stats",
+                        "runtime_stats returned void",
+                    );
+                }
+                "gc_config" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.gc_config,
+                        args,
+                        1,
+                        "gc_config",
+                        "gc_config returned void",
+                    );
+                }
+                "gc_collect" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.gc_collect,
+                        args,
+                        0,
+                        "gc_collect",
+                        "gc_collect returned void",
+                    );
+                }
+                "gc_stats" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.gc_stats,
+                        args,
+                        0,
+                        "gc_stats",
+                        "gc_stats returned void",
+                    );
+                }
+                "thread_spawn" => {
+                    // thread_spawn(func, args) or thread_spawn(func, args, opts)
+                    let mut spawn_args = args.to_vec();
+                    if spawn_args.len() == 2 {
+                        spawn_args.push(Expr::Literal {
+                            value: Literal::Nil,
+                            span: Span::new(0, 0),
+                        });
+                    }
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.thread_spawn,
+                        &spawn_args,
+                        3,
                         "thread_spawn",
                         "thread_spawn returned void",
                     );
                 }
+                "cpu_count" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.cpu_count,
+                        args,
+                        0,
+                        "cpu_count",
+                        "cpu_count returned void",
+                    );
+                }
+                "shm_ring_create" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.shm_ring_create,
+                        args,
+                        2,
+                        "shm_ring_create",
+                        "shm_ring_create returned void",
+                    );
+                }
+                "shm_ring_open" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.shm_ring_open,
+                        args,
+                        1,
+                        "shm_ring_open",
+                        "shm_ring_open returned void",
+                    );
+                }
+                "shm_ring_send" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.shm_ring_send,
+                        args,
+                        2,
+                        "shm_ring_send",
+                        "shm_ring_send returned void",
+                    );
+                }
+                "shm_ring_recv" => {
+                    // shm_ring_recv(ring) waits; shm_ring_recv(ring, timeout_ms) gives up
+                    let mut recv_args = args.to_vec();
+                    if recv_args.len() == 1 {
+                        recv_args.push(Expr::Literal {
+                            value: Literal::Nil,
+                            span: Span::new(0, 0),
+                        });
+                    }
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.shm_ring_recv,
+                        &recv_args,
+                        2,
+                        "shm_ring_recv",
+                        "shm_ring_recv returned void",
+                    );
+                }
+                "shm_ring_recv_into" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.shm_ring_recv_into,
+                        args,
+                        2,
+                        "shm_ring_recv_into",
+                        "shm_ring_recv_into returned void",
+                    );
+                }
+                "shm_ring_fd" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.shm_ring_fd,
+                        args,
+                        1,
+                        "shm_ring_fd",
+                        "shm_ring_fd returned void",
+                    );
+                }
+                "shm_ring_close" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.shm_ring_close,
+                        args,
+                        1,
+                        "shm_ring_close",
+                        "shm_ring_close returned void",
+                    );
+                }
+                "kv_open" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.kv_open,
+                        args,
+                        1,
+                        "kv_open",
+                        "kv_open returned void",
+                    );
+                }
+                "kv_get" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.kv_get,
+                        args,
+                        2,
+                        "kv_get",
+                        "kv_get returned void",
+                    );
+                }
+                "kv_put" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.kv_put,
+                        args,
+                        3,
+                        "kv_put",
+                        "kv_put returned void",
+                    );
+                }
+                "kv_delete" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.kv_delete,
+                        args,
+                        2,
+                        "kv_delete",
+                        "kv_delete returned void",
+                    );
+                }
+                "kv_scan" => {
+                    // kv_scan(db, from?, to?, limit?): a bound left out is open
+                    let mut scan_args = args.to_vec();
+                    while scan_args.len() < 4 && !scan_args.is_empty() {
+                        scan_args.push(Expr::Literal {
+                            value: Literal::Nil,
+                            span: Span::new(0, 0),
+                        });
+                    }
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.kv_scan,
+                        &scan_args,
+                        4,
+                        "kv_scan",
+                        "kv_scan returned void",
+                    );
+                }
+                "kv_sync" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.kv_sync,
+                        args,
+                        1,
+                        "kv_sync",
+                        "kv_sync returned void",
+                    );
+                }
+                "kv_compact" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.kv_compact,
+                        args,
+                        1,
+                        "kv_compact",
+                        "kv_compact returned void",
+                    );
+                }
+                "kv_stats" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.kv_stats,
+                        args,
+                        1,
+                        "kv_stats",
+                        "kv_stats returned void",
+                    );
+                }
+                "kv_close" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.kv_close,
+                        args,
+                        1,
+                        "kv_close",
+                        "kv_close returned void",
+                    );
+                }
+                "numa_node_of_cpu" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.numa_node_of_cpu,
+                        args,
+                        1,
+                        "numa_node_of_cpu",
+                        "numa_node_of_cpu returned void",
+                    );
+                }
                 "thread_join" => {
                     return self.compile_runtime_call_value_with_arity(
                         self.libc.thread_join,
@@ -12560,6 +15453,42 @@ impl<'ctx> CodeGen<'ctx> {
                         "thread_detach returned void",
                     );
                 }
+                "pool_submit" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.pool_submit,
+                        args,
+                        2,
+                        "pool_submit",
+                        "pool_submit returned void",
+                    );
+                }
+                "parallel_map" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.parallel_map,
+                        args,
+                        3,
+                        "parallel_map",
+                        "parallel_map returned void",
+                    );
+                }
+                "parallel_filter" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.parallel_filter,
+                        args,
+                        3,
+                        "parallel_filter",
+                        "parallel_filter returned void",
+                    );
+                }
+                "parallel_reduce" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.parallel_reduce,
+                        args,
+                        4,
+                        "parallel_reduce",
+                        "parallel_reduce returned void",
+                    );
+                }
                 "mutex_new" => {
                     return self.compile_runtime_call_value_with_arity(
                         self.libc.mutex_new,
@@ -12686,6 +15615,42 @@ impl<'ctx> CodeGen<'ctx> {
                         "atomic_cas returned void",
                     );
                 }
+                "atomic_load_acquire" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.atomic_load_acquire,
+                        args,
+                        1,
+                        "atomic_load_acquire",
+                        "atomic_load_acquire returned void",
+                    );
+                }
+                "atomic_store_release" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.atomic_store_release,
+                        args,
+                        2,
+                        "atomic_store_release",
+                        "atomic_store_release returned void",
+                    );
+                }
+                "atomic_fetch_max" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.atomic_fetch_max,
+                        args,
+                        2,
+                        "atomic_fetch_max",
+                        "atomic_fetch_max returned void",
+                    );
+                }
+                "atomic_fetch_min" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.atomic_fetch_min,
+                        args,
+                        2,
+                        "atomic_fetch_min",
+                        "atomic_fetch_min returned void",
+                    );
+                }
                 "chan_new" => {
                     return self.compile_runtime_call_value_with_arity(
                         self.libc.chan_new,
@@ -12722,6 +15687,51 @@ impl<'ctx> CodeGen<'ctx> {
                         "chan_try_recv returned void",
                     );
                 }
+                "chan_recv_timeout" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.chan_recv_timeout,
+                        args,
+                        2,
+                        "chan_recv_timeout",
+                        "chan_recv_timeout returned void",
+                    );
+                }
+                "chan_send_many" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.chan_send_many,
+                        args,
+                        2,
+                        "chan_send_many",
+                        "chan_send_many returned void",
+                    );
+                }
+                "chan_recv_many" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.chan_recv_many,
+                        args,
+                        2,
+                        "chan_recv_many",
+                        "chan_recv_many returned void",
+                    );
+                }
+                "chan_select" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.chan_select,
+                        args,
+                        2,
+                        "chan_select",
+                        "chan_select returned void",
+                    );
+                }
+                "chan_fd" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.chan_fd,
+                        args,
+                        1,
+                        "chan_fd",
+                        "chan_fd returned void",
+                    );
+                }
                 "chan_close" => {
                     return self.compile_runtime_call_value_with_arity(
                         self.libc.chan_close,
@@ -13194,11 +16204,8 @@ impl<'ctx> CodeGen<'ctx> {
                         let empty_end = self.builder.get_insert_block().unwrap();
 
                         self.builder.position_at_end(nonempty_block);
-                        let one = self.types.i64_type.const_int(1, false);
-                        let last_idx = self
-                            .builder
-                            .build_int_sub(str_len, one, "scran_last_idx")
-                            .unwrap();
+                        // -1 is the last character, however many bytes it takes
+                        let last_idx = self.types.i64_type.const_int((-1i64) as u64, true);
                         let last_idx_val = self.make_int(last_idx).unwrap();
                         let last_char = self.inline_char_at(obj_arg, last_idx_val)?;
                         self.builder.build_unconditional_branch(done_block).unwrap();
@@ -13586,6 +16593,135 @@ impl<'ctx> CodeGen<'ctx> {
                         "lines returned void",
                     );
                 }
+                "file_map" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.file_map,
+                        args,
+                        1,
+                        "file_map",
+                        "file_map returned void",
+                    );
+                }
+                "lines_iter" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.lines_iter,
+                        args,
+                        1,
+                        "lines_iter",
+                        "lines_iter returned void",
+                    );
+                }
+                "lines_next" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.lines_next,
+                        args,
+                        1,
+                        "lines_next",
+                        "lines_next returned void",
+                    );
+                }
+                "lines_close" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.lines_close,
+                        args,
+                        1,
+                        "lines_close",
+                        "lines_close returned void",
+                    );
+                }
+                "file_open" => {
+                    if args.is_empty() || args.len() > 3 {
+                        return Err(HaversError::CompileError(
+                            "file_open expects 1-3 arguments (path, mode, buffer)".to_string(),
+                        ));
+                    }
+                    let path = self.compile_expr(&args[0])?;
+                    let mode = if args.len() >= 2 {
+                        self.compile_expr(&args[1])?
+                    } else {
+                        self.make_nil()
+                    };
+                    let buffer = if args.len() >= 3 {
+                        self.compile_expr(&args[2])?
+                    } else {
+                        self.make_nil()
+                    };
+                    return self.build_call_basic_value(
+                        self.libc.file_open,
+                        &[path.into(), mode.into(), buffer.into()],
+                        "file_open_result",
+                        "file_open returned void",
+                    );
+                }
+                "file_write" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.file_write,
+                        args,
+                        2,
+                        "file_write",
+                        "file_write returned void",
+                    );
+                }
+                "file_write_lines" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.file_write_lines,
+                        args,
+                        2,
+                        "file_write_lines",
+                        "file_write_lines returned void",
+                    );
+                }
+                "file_flush" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.file_flush,
+                        args,
+                        1,
+                        "file_flush",
+                        "file_flush returned void",
+                    );
+                }
+                "file_close" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.file_close,
+                        args,
+                        1,
+                        "file_close",
+                        "file_close returned void",
+                    );
+                }
+                "slurp_bytes" => {
+                    if args.is_empty() || args.len() > 3 {
+                        return Err(HaversError::CompileError(
+                            "slurp_bytes expects 1-3 arguments (path, offset, length)".to_string(),
+                        ));
+                    }
+                    let path = self.compile_expr(&args[0])?;
+                    let offset = if args.len() >= 2 {
+                        self.compile_expr(&args[1])?
+                    } else {
+                        self.make_nil()
+                    };
+                    let length = if args.len() >= 3 {
+                        self.compile_expr(&args[2])?
+                    } else {
+                        self.make_nil()
+                    };
+                    return self.build_call_basic_value(
+                        self.libc.slurp_bytes,
+                        &[path.into(), offset.into(), length.into()],
+                        "slurp_bytes_result",
+                        "slurp_bytes returned void",
+                    );
+                }
+                "scrieve_bytes" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.scrieve_bytes,
+                        args,
+                        2,
+                        "scrieve_bytes",
+                        "scrieve_bytes returned void",
+                    );
+                }
                 "words" => {
                     return self.compile_runtime_call_value_with_arity_call_name(
                         self.libc.words,
@@ -13687,6 +16823,89 @@ impl<'ctx> CodeGen<'ctx> {
                         "shell_status returned void",
                     );
                 }
+                "spawn" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.spawn,
+                        args,
+                        1,
+                        "spawn",
+                        "spawn returned void",
+                    );
+                }
+                "process_spawn" => {
+                    if args.is_empty() || args.len() > 2 {
+                        return Err(HaversError::CompileError(
+                            "process_spawn expects 1-2 arguments (argv, opts)".to_string(),
+                        ));
+                    }
+                    let argv = self.compile_expr(&args[0])?;
+                    let opts = if args.len() >= 2 {
+                        self.compile_expr(&args[1])?
+                    } else {
+                        self.make_nil()
+                    };
+                    return self.build_call_basic_value(
+                        self.libc.process_spawn,
+                        &[argv.into(), opts.into()],
+                        "process_spawn_result",
+                        "process_spawn returned void",
+                    );
+                }
+                "process_read" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.process_read,
+                        args,
+                        2,
+                        "process_read",
+                        "process_read returned void",
+                    );
+                }
+                "process_write" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.process_write,
+                        args,
+                        2,
+                        "process_write",
+                        "process_write returned void",
+                    );
+                }
+                "process_watch" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.process_watch,
+                        args,
+                        3,
+                        "process_watch",
+                        "process_watch returned void",
+                    );
+                }
+                "process_wait" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.process_wait,
+                        args,
+                        1,
+                        "process_wait",
+                        "process_wait returned void",
+                    );
+                }
+                "process_kill" => {
+                    if args.is_empty() || args.len() > 2 {
+                        return Err(HaversError::CompileError(
+                            "process_kill expects 1-2 arguments (proc, signal)".to_string(),
+                        ));
+                    }
+                    let proc = self.compile_expr(&args[0])?;
+                    let sig = if args.len() >= 2 {
+                        self.compile_expr(&args[1])?
+                    } else {
+                        self.make_nil()
+                    };
+                    return self.build_call_basic_value(
+                        self.libc.process_kill,
+                        &[proc.into(), sig.into()],
+                        "process_kill_result",
+                        "process_kill returned void",
+                    );
+                }
                 // Date/time builtins
                 "date_now" => {
                     return self.compile_runtime_call_value_with_arity_call_name(
@@ -13748,6 +16967,26 @@ impl<'ctx> CodeGen<'ctx> {
                         "braw_date returned void",
                     );
                 }
+                "date_now_ts" => {
+                    return self.compile_runtime_call_value_with_arity_call_name(
+                        self.libc.date_now_ts,
+                        args,
+                        0,
+                        "date_now_ts",
+                        "date_now_ts_result",
+                        "date_now_ts returned void",
+                    );
+                }
+                "date_fields" => {
+                    return self.compile_runtime_call_value_with_arity_call_name(
+                        self.libc.date_fields,
+                        args,
+                        1,
+                        "date_fields",
+                        "date_fields_result",
+                        "date_fields returned void",
+                    );
+                }
                 // Regex builtins
                 "regex_test" => {
                     return self.compile_runtime_call_value_with_arity_call_name(
@@ -13819,6 +17058,51 @@ impl<'ctx> CodeGen<'ctx> {
                         )
                     });
                 }
+                "regex_compile" => {
+                    if args.len() != 1 {
+                        return Err(HaversError::CompileError(
+                            "regex_compile expects 1 argument".to_string(),
+                        ));
+                    }
+                    return self.compile_metadata_args(args).and_then(|call_args| {
+                        self.build_call_basic_value(
+                            self.libc.regex_compile,
+                            &call_args,
+                            "regex_compile_result",
+                            "regex_compile returned void",
+                        )
+                    });
+                }
+                "regex_set_new" => {
+                    if args.len() != 1 {
+                        return Err(HaversError::CompileError(
+                            "regex_set_new expects 1 argument".to_string(),
+                        ));
+                    }
+                    return self.compile_metadata_args(args).and_then(|call_args| {
+                        self.build_call_basic_value(
+                            self.libc.regex_set_new,
+                            &call_args,
+                            "regex_set_new_result",
+                            "regex_set_new returned void",
+                        )
+                    });
+                }
+                "regex_set_match" => {
+                    if args.len() != 2 {
+                        return Err(HaversError::CompileError(
+                            "regex_set_match expects 2 arguments".to_string(),
+                        ));
+                    }
+                    return self.compile_metadata_args(args).and_then(|call_args| {
+                        self.build_call_basic_value(
+                            self.libc.regex_set_match,
+                            &call_args,
+                            "regex_set_match_result",
+                            "regex_set_match returned void",
+                        )
+                    });
+                }
                 // Misc parity helpers
                 "is_a" => {
                     return self.compile_runtime_call_value_with_arity_call_name(
@@ -14163,6 +17447,33 @@ impl<'ctx> CodeGen<'ctx> {
                         "log_get_filter returned void",
                     );
                 }
+                "flush" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.flush,
+                        args,
+                        0,
+                        "flush",
+                        "flush returned void",
+                    );
+                }
+                "log_flush" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.log_flush,
+                        args,
+                        0,
+                        "log_flush",
+                        "log_flush returned void",
+                    );
+                }
+                "log_dropped" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.log_dropped,
+                        args,
+                        0,
+                        "log_dropped",
+                        "log_dropped returned void",
+                    );
+                }
                 "log_event" => {
                     if args.len() < 2 || args.len() > 4 {
                         return Err(HaversError::CompileError(
@@ -14284,6 +17595,24 @@ impl<'ctx> CodeGen<'ctx> {
                         "log_span_in returned void",
                     );
                 }
+                "log_span_stats" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.log_span_stats,
+                        args,
+                        0,
+                        "log_span_stats",
+                        "log_span_stats returned void",
+                    );
+                }
+                "log_span_export" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.log_span_export,
+                        args,
+                        2,
+                        "log_span_export",
+                        "log_span_export returned void",
+                    );
+                }
                 // Scots builtins
                 "slainte" => {
                     return self.compile_runtime_call_value_with_arity_call_name(
@@ -14381,887 +17710,1563 @@ impl<'ctx> CodeGen<'ctx> {
                         "average returned void",
                     );
                 }
-                "chynge" | "replace" => {
-                    if args.len() != 3 {
-                        return Err(HaversError::CompileError(
-                            "chynge/replace expects 3 arguments (str, old, new)".to_string(),
-                        ));
-                    }
-                    let str_val = self.compile_expr(&args[0])?;
-                    let old_val = self.compile_expr(&args[1])?;
-                    let new_val = self.compile_expr(&args[2])?;
-                    let result = self
-                        .builder
-                        .build_call(
-                            self.libc.chynge,
-                            &[str_val.into(), old_val.into(), new_val.into()],
-                            "chynge_result",
-                        )
-                        .unwrap()
-                        .try_as_basic_value()
-                        .left()
-                        .compile_ok_or("chynge returned void").unwrap();
-                    return Ok(result);
+                "int_array" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.int_array,
+                        args,
+                        1,
+                        "int_array",
+                        "int_array returned void",
+                    );
                 }
-                // Testing builtins
-                "assert" => {
-                    // Interpreter: assert(condition, msg) -> aye (or aborts).
-                    if args.len() != 2 {
-                        return Err(HaversError::CompileError(
-                            "assert expects 2 arguments".to_string(),
-                        ));
-                    }
-                    let cond = self.compile_expr(&args[0])?;
-                    let msg = self.compile_expr(&args[1])?;
-
-                    let truthy = self.is_truthy(cond).unwrap();
-                    let cond_bool = self.make_bool(truthy).unwrap();
-                    let msg_str = self.inline_tae_string(msg)?;
-
-                    let _ = self
-                        .builder
-                        .build_call(
-                            self.libc.assert_fn,
-                            &[cond_bool.into(), msg_str.into()],
-                            "assert_call",
-                        )
-                        .unwrap()
-                        .try_as_basic_value()
-                        .left()
-                        .compile_ok_or("assert returned void").unwrap();
-                    let one = self.types.i64_type.const_int(1, false);
-                    return self.make_bool(one);
+                "float_array" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.float_array,
+                        args,
+                        1,
+                        "float_array",
+                        "float_array returned void",
+                    );
                 }
-                "skip" => {
-                    if args.len() != 1 {
-                        return Err(HaversError::CompileError(
-                            "skip expects 1 argument".to_string(),
-                        ));
-                    }
-                    let reason = self.compile_expr(&args[0])?;
-                    let result = self
-                        .builder
-                        .build_call(self.libc.skip, &[reason.into()], "skip_result")
-                        .unwrap()
-                        .try_as_basic_value()
-                        .left()
-                        .compile_ok_or("skip returned void").unwrap();
-                    return Ok(result);
+                "array_tae_list" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.array_tae_list,
+                        args,
+                        1,
+                        "array_tae_list",
+                        "array_tae_list returned void",
+                    );
                 }
-                "stacktrace" => {
-                    let result = self
-                        .builder
-                        .build_call(self.libc.stacktrace, &[], "stacktrace_result")
-                        .unwrap()
-                        .try_as_basic_value()
-                        .left()
-                        .compile_ok_or("stacktrace returned void").unwrap();
-                    return Ok(result);
+                "array_sum" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.array_sum,
+                        args,
+                        1,
+                        "array_sum",
+                        "array_sum returned void",
+                    );
                 }
-                // Additional Scots aliases
-                "scots_greetin" => {
-                    // Return an error message string (Scots for "complaint")
-                    let global = Self::create_global_string(
-                        &self.module,
-                        self.context,
-                        "Och, something went wrang!",
-                        "scots_err_msg",
+                "array_average" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.array_average,
+                        args,
+                        1,
+                        "array_average",
+                        "array_average returned void",
                     );
-                    let str_ptr = self.get_string_ptr(global);
-                    return self.make_string(str_ptr);
                 }
-                "poetry_seed" => {
-                    // Random seed
-                    let min = self.types.i64_type.const_int(0, false);
-                    let max = self.types.i64_type.const_int(i64::MAX as u64, false);
-                    return self.build_call_basic_value(
-                        self.libc.random,
-                        &[min.into(), max.into()],
-                        "seed_result",
-                        "random returned void",
+                "array_min" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.array_min,
+                        args,
+                        1,
+                        "array_min",
+                        "array_min returned void",
                     );
                 }
-                "braw_time" => {
-                    return self.compile_runtime_call_value_with_arity_call_name(
-                        self.libc.braw_time,
+                "array_max" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.array_max,
+                        args,
+                        1,
+                        "array_max",
+                        "array_max returned void",
+                    );
+                }
+                "array_dot" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.array_dot,
+                        args,
+                        2,
+                        "array_dot",
+                        "array_dot returned void",
+                    );
+                }
+                "array_add" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.array_add,
+                        args,
+                        2,
+                        "array_add",
+                        "array_add returned void",
+                    );
+                }
+                "array_sub" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.array_sub,
+                        args,
+                        2,
+                        "array_sub",
+                        "array_sub returned void",
+                    );
+                }
+                "array_mul" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.array_mul,
+                        args,
+                        2,
+                        "array_mul",
+                        "array_mul returned void",
+                    );
+                }
+                "array_div" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.array_div,
+                        args,
+                        2,
+                        "array_div",
+                        "array_div returned void",
+                    );
+                }
+                "deque" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.deque_new,
                         args,
                         0,
-                        "braw_time",
-                        "braw_time_result",
-                        "braw_time returned void",
+                        "deque",
+                        "deque returned void",
                     );
                 }
-                // Additional builtins
-                "read_file" => {
-                    // Alias for slurp
-                    return self.compile_runtime_call_value_with_arity_call_name(
-                        self.libc.slurp,
+                "deque_push_back" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.deque_push_back,
+                        args,
+                        2,
+                        "deque_push_back",
+                        "deque_push_back returned void",
+                    );
+                }
+                "deque_push_front" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.deque_push_front,
+                        args,
+                        2,
+                        "deque_push_front",
+                        "deque_push_front returned void",
+                    );
+                }
+                "deque_pop_front" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.deque_pop_front,
                         args,
                         1,
-                        "read_file",
-                        "read_file_result",
-                        "slurp returned void",
+                        "deque_pop_front",
+                        "deque_pop_front returned void",
                     );
                 }
-                "muckle" => {
-                    if args.len() == 1 {
-                        // muckle([list]) - maximum of list elements
-                        return self.compile_metadata_args(args).and_then(|call_args| {
-                            self.build_call_basic_value(
-                                self.libc.list_max,
-                                &call_args,
-                                "list_max_result",
-                                "list_max returned void",
-                            )
-                        });
-                    }
-                    if args.len() == 2 {
-                        return self.compile_metadata_args(args).and_then(|call_args| {
-                            self.build_call_basic_value(
-                                self.libc.muckle,
-                                &call_args,
-                                "muckle_result",
-                                "muckle returned void",
-                            )
-                        });
-                    }
-                    return Err(HaversError::CompileError(
-                        "muckle expects 1 or 2 arguments".to_string(),
-                    ));
+                "deque_pop_back" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.deque_pop_back,
+                        args,
+                        1,
+                        "deque_pop_back",
+                        "deque_pop_back returned void",
+                    );
                 }
-                "median" => {
-                    return self.compile_runtime_call_value_with_arity_call_name(
-                        self.libc.median,
+                "deque_front" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.deque_front,
                         args,
                         1,
-                        "median",
-                        "median_result",
-                        "median returned void",
+                        "deque_front",
+                        "deque_front returned void",
                     );
                 }
-                "is_space" => {
-                    return self.compile_runtime_call_value_with_arity_call_name(
-                        self.libc.is_space,
+                "deque_back" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.deque_back,
                         args,
                         1,
-                        "is_space",
-                        "is_space_result",
-                        "is_space returned void",
+                        "deque_back",
+                        "deque_back returned void",
                     );
                 }
-                // is_digit now handled by inline_is_char_class later in the match
-                "wheesht_aw" => {
-                    return self.compile_runtime_call_value_with_arity_call_name(
-                        self.libc.wheesht_aw,
+                "deque_clear" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.deque_clear,
                         args,
                         1,
-                        "wheesht_aw",
-                        "wheesht_aw_result",
-                        "wheesht_aw returned void",
+                        "deque_clear",
+                        "deque_clear returned void",
                     );
                 }
-                "dicht" | "remove_at" => {
-                    if args.len() != 2 {
-                        return Err(HaversError::CompileError(
-                            "dicht expects 2 arguments (list, index)".to_string(),
-                        ));
-                    }
-                    return self.compile_metadata_args(args).and_then(|call_args| {
-                        self.build_call_basic_value(
-                            self.libc.dicht,
-                            &call_args,
-                            "dicht_result",
-                            "dicht returned void",
-                        )
-                    });
+                "deque_tae_list" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.deque_tae_list,
+                        args,
+                        1,
+                        "deque_tae_list",
+                        "deque_tae_list returned void",
+                    );
                 }
-                "bonnie" | "pretty" => {
-                    return self.compile_runtime_call_value_with_arity_call_name(
-                        self.libc.bonnie,
+                "frozen_dict" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.frozen_dict_new,
                         args,
                         1,
-                        "bonnie",
-                        "bonnie_result",
-                        "bonnie returned void",
+                        "frozen_dict",
+                        "frozen_dict returned void",
                     );
                 }
-                "deck" | "shuffle" | "mince" => {
-                    return self.compile_runtime_call_value_with_arity_call_name(
-                        self.libc.shuffle,
+                "frozen_list" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.frozen_list_new,
                         args,
                         1,
-                        "shuffle",
-                        "shuffle_result",
-                        "shuffle returned void",
+                        "frozen_list",
+                        "frozen_list returned void",
                     );
                 }
-                "choice" => {
-                    if args.len() != 1 {
-                        return Err(HaversError::CompileError(
-                            "choice expects 1 argument (list)".to_string(),
-                        ));
-                    }
-                    let list_val = self.compile_expr(&args[0])?;
-                    let list_data = self.extract_data(list_val).unwrap();
-                    let list_len = self.get_list_length(list_data).unwrap();
-
-                    let zero = self.types.i64_type.const_int(0, false);
-                    let is_empty = self
-                        .builder
-                        .build_int_compare(IntPredicate::EQ, list_len, zero, "choice_empty")
-                        .unwrap();
-
-                    let function = self.current_function.unwrap();
-                    let empty_block = self.context.append_basic_block(function, "choice_empty");
-                    let nonempty_block =
-                        self.context.append_basic_block(function, "choice_nonempty");
-                    let merge = self.context.append_basic_block(function, "choice_merge");
-
-                    self.builder
-                        .build_conditional_branch(is_empty, empty_block, nonempty_block)
-                        .unwrap();
-
-                    self.builder.position_at_end(empty_block);
-                    let empty_val = self.make_nil();
-                    self.builder.build_unconditional_branch(merge).unwrap();
-                    let empty_end = self.builder.get_insert_block().unwrap();
-
-                    self.builder.position_at_end(nonempty_block);
-                    let elem_ptr = self.get_list_element_ptr(list_data, zero).unwrap();
-                    let elem = self
-                        .builder
-                        .build_load(self.types.value_type, elem_ptr, "choice_elem")
-                        .unwrap();
-                    self.builder.build_unconditional_branch(merge).unwrap();
-                    let nonempty_end = self.builder.get_insert_block().unwrap();
-
-                    self.builder.position_at_end(merge);
-                    let phi = self
-                        .builder
-                        .build_phi(self.types.value_type, "choice_result")
-                        .unwrap();
-                    phi.add_incoming(&[(&empty_val, empty_end), (&elem, nonempty_end)]);
-                    return Ok(phi.as_basic_value());
+                "frozen_set" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.frozen_set,
+                        args,
+                        3,
+                        "frozen_set",
+                        "frozen_set returned void",
+                    );
                 }
-                "sample" => {
-                    if args.len() != 2 {
-                        return Err(HaversError::CompileError(
-                            "sample expects 2 arguments (list, n)".to_string(),
-                        ));
-                    }
-                    let list_val = self.compile_expr(&args[0])?;
-                    let n_val = self.compile_expr(&args[1])?;
-                    let list_data = self.extract_data(list_val).unwrap();
-                    let list_len = self.get_list_length(list_data).unwrap();
-                    let n_raw = self.extract_data(n_val).unwrap();
-
-                    let zero = self.types.i64_type.const_int(0, false);
-                    let n_lt0 = self
-                        .builder
-                        .build_int_compare(IntPredicate::SLT, n_raw, zero, "sample_n_lt0")
-                        .unwrap();
-                    let n_nonneg = self
-                        .builder
-                        .build_select(n_lt0, zero, n_raw, "sample_n_nonneg")
-                        .unwrap()
-                        .into_int_value();
-                    let n_gt_len = self
-                        .builder
-                        .build_int_compare(IntPredicate::UGT, n_nonneg, list_len, "sample_n_gt_len")
-                        .unwrap();
-                    let end = self
-                        .builder
-                        .build_select(n_gt_len, list_len, n_nonneg, "sample_end")
-                        .unwrap()
-                        .into_int_value();
-
-                    let start_val = self.make_int(zero).unwrap();
-                    let end_val = self.make_int(end).unwrap();
-                    return self.inline_scran(list_val, start_val, end_val);
+                "frozen_remove" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.frozen_remove,
+                        args,
+                        2,
+                        "frozen_remove",
+                        "frozen_remove returned void",
+                    );
                 }
-                "bit_an" | "bit_and" => {
-                    if args.len() != 2 {
-                        return Err(HaversError::CompileError(
-                            "bit_and expects 2 arguments".to_string(),
-                        ));
-                    }
-                    let a = self.compile_expr(&args[0])?;
-                    let b = self.compile_expr(&args[1])?;
-                    let result = self
-                        .builder
-                        .build_call(self.libc.bit_and, &[a.into(), b.into()], "bit_and_result")
-                        .unwrap()
-                        .try_as_basic_value()
-                        .left()
-                        .compile_ok_or("bit_and returned void").unwrap();
-                    return Ok(result);
+                "frozen_push" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.frozen_push,
+                        args,
+                        2,
+                        "frozen_push",
+                        "frozen_push returned void",
+                    );
                 }
-                "bit_or" => {
-                    if args.len() != 2 {
-                        return Err(HaversError::CompileError(
-                            "bit_or expects 2 arguments".to_string(),
-                        ));
-                    }
-                    let a = self.compile_expr(&args[0])?;
-                    let b = self.compile_expr(&args[1])?;
-                    let result = self
-                        .builder
-                        .build_call(self.libc.bit_or, &[a.into(), b.into()], "bit_or_result")
-                        .unwrap()
-                        .try_as_basic_value()
-                        .left()
-                        .compile_ok_or("bit_or returned void").unwrap();
-                    return Ok(result);
+                "thaw" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.thaw,
+                        args,
+                        1,
+                        "thaw",
+                        "thaw returned void",
+                    );
                 }
-                "bit_xor" => {
-                    if args.len() != 2 {
-                        return Err(HaversError::CompileError(
-                            "bit_xor expects 2 arguments".to_string(),
-                        ));
-                    }
-                    return self.compile_runtime_call_value_with_arity_call_name(
-                        self.libc.bit_xor,
+                "mat_from_rows" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.mat_from_rows,
+                        args,
+                        1,
+                        "mat_from_rows",
+                        "mat_from_rows returned void",
+                    );
+                }
+                "mat_tae_rows" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.mat_tae_rows,
+                        args,
+                        1,
+                        "mat_tae_rows",
+                        "mat_tae_rows returned void",
+                    );
+                }
+                "mat_new" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.mat_new,
+                        args,
+                        3,
+                        "mat_new",
+                        "mat_new returned void",
+                    );
+                }
+                "mat_identity" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.mat_identity,
+                        args,
+                        1,
+                        "mat_identity",
+                        "mat_identity returned void",
+                    );
+                }
+                "mat_shape" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.mat_shape,
+                        args,
+                        1,
+                        "mat_shape",
+                        "mat_shape returned void",
+                    );
+                }
+                "mat_get" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.mat_get,
+                        args,
+                        3,
+                        "mat_get",
+                        "mat_get returned void",
+                    );
+                }
+                "mat_set" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.mat_set,
+                        args,
+                        4,
+                        "mat_set",
+                        "mat_set returned void",
+                    );
+                }
+                "mat_add" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.mat_add,
                         args,
                         2,
-                        "bit_xor",
-                        "bit_xor_result",
-                        "bit_xor returned void",
+                        "mat_add",
+                        "mat_add returned void",
                     );
                 }
-                // Misc Scots aliases
-                "scots_farewell" | "scots_exclaim" => {
-                    // These just return nil - they're exclamations or placeholders
-                    return Ok(self.make_nil());
+                "mat_sub" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.mat_sub,
+                        args,
+                        2,
+                        "mat_sub",
+                        "mat_sub returned void",
+                    );
                 }
-                "blether_format" => {
-                    return self.compile_runtime_call_value_with_arity_call_name(
-                        self.libc.blether_format,
+                "mat_scale" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.mat_scale,
                         args,
                         2,
-                        "blether_format",
-                        "blether_format_result",
-                        "blether_format returned void",
+                        "mat_scale",
+                        "mat_scale returned void",
                     );
                 }
-                "read_lines" => {
-                    // Alias for lines
-                    return self.compile_runtime_call_value_with_arity_call_name(
-                        self.libc.lines,
+                "mat_transpose" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.mat_transpose,
                         args,
                         1,
-                        "read_lines",
-                        "read_lines_result",
-                        "lines returned void",
+                        "mat_transpose",
+                        "mat_transpose returned void",
                     );
                 }
-                "append_file" => {
-                    return self.compile_runtime_call_value_with_arity_call_name(
-                        self.libc.scrieve_append,
+                "mat_matmul" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.mat_matmul,
                         args,
                         2,
-                        "append_file",
-                        "append_file_result",
-                        "scrieve_append returned void",
+                        "mat_matmul",
+                        "mat_matmul returned void",
                     );
                 }
-                "minaw" => {
-                    // Minimum of list
-                    return self.compile_runtime_call_value_with_arity_call_name(
-                        self.libc.list_min,
+                "mat_solve" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.mat_solve,
+                        args,
+                        2,
+                        "mat_solve",
+                        "mat_solve returned void",
+                    );
+                }
+                "mat_det" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.mat_det,
                         args,
                         1,
-                        "minaw",
-                        "minaw_result",
-                        "list_min returned void",
+                        "mat_det",
+                        "mat_det returned void",
                     );
                 }
-                "is_wee" => {
-                    return self.compile_runtime_call_value_with_arity_call_name(
-                        self.libc.is_wee,
+                "table_parse_csv" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.table_parse_csv,
                         args,
                         1,
-                        "is_wee",
-                        "is_wee_result",
-                        "is_wee returned void",
+                        "table_parse_csv",
+                        "table_parse_csv returned void",
                     );
                 }
-                "is_even" => {
-                    // Check if number is even
-                    if args.len() != 1 {
-                        return Err(HaversError::CompileError(
-                            "is_even expects 1 argument".to_string(),
-                        ));
-                    }
-                    let n = self.compile_expr(&args[0])?;
-                    let data = self.extract_data(n).unwrap();
-                    let two = self.types.i64_type.const_int(2, false);
-                    let rem = self
-                        .builder
-                        .build_int_signed_rem(data, two, "is_even_rem")
-                        .unwrap();
-                    let zero = self.types.i64_type.const_int(0, false);
-                    let is_even = self
-                        .builder
-                        .build_int_compare(inkwell::IntPredicate::EQ, rem, zero, "is_even_cmp")
-                        .unwrap();
-                    let is_even_i64 = self
-                        .builder
-                        .build_int_z_extend(is_even, self.types.i64_type, "is_even_i64")
-                        .unwrap();
-                    return self.make_bool(is_even_i64);
+                "table_join" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.table_join,
+                        args,
+                        6,
+                        "table_join",
+                        "table_join returned void",
+                    );
                 }
-                "bit_nae" | "bit_not" => {
-                    // Bitwise NOT
-                    if args.len() != 1 {
-                        return Err(HaversError::CompileError(
-                            "bit_not expects 1 argument".to_string(),
-                        ));
-                    }
-                    let n = self.compile_expr(&args[0])?;
-                    let data = self.extract_data(n).unwrap();
-                    let not_val = self.builder.build_not(data, "bit_not").unwrap();
-                    return self.make_int(not_val);
+                "table_group" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.table_group,
+                        args,
+                        2,
+                        "table_group",
+                        "table_group returned void",
+                    );
                 }
-                // Global test variables - return reasonable defaults
-                "__current_suite" => {
-                    let global = Self::create_global_string(
-                        &self.module,
-                        self.context,
-                        "",
-                        "current_suite_default",
+                "table_widths" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.table_widths,
+                        args,
+                        2,
+                        "table_widths",
+                        "table_widths returned void",
                     );
-                    let str_ptr = self.get_string_ptr(global);
-                    return self.make_string(str_ptr);
                 }
-                "_tick_counter" | "_msg_counter" | "_verbose" | "__prop_passed" => {
-                    let zero = self.types.i64_type.const_int(0, false);
-                    return self.make_int(zero);
+                "strbuf" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.strbuf_new,
+                        args,
+                        0,
+                        "strbuf",
+                        "strbuf returned void",
+                    );
                 }
-                "_global_bus" | "_global_logger" => {
-                    // Return nil for global objects
-                    return Ok(self.make_nil());
+                "strbuf_append" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.strbuf_append,
+                        args,
+                        2,
+                        "strbuf_append",
+                        "strbuf_append returned void",
+                    );
                 }
-                // More missing builtins
-                "maxaw" => {
-                    // Maximum of list
-                    if args.len() != 1 {
-                        return Err(HaversError::CompileError(
-                            "maxaw expects 1 argument".to_string(),
-                        ));
-                    }
-                    let list = self.compile_expr(&args[0])?;
-                    let result = self
-                        .builder
-                        .build_call(self.libc.list_max, &[list.into()], "maxaw_result")
-                        .unwrap()
-                        .try_as_basic_value()
-                        .left()
-                        .compile_ok_or("list_max returned void").unwrap();
-                    return Ok(result);
+                "strbuf_append_int" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.strbuf_append_int,
+                        args,
+                        2,
+                        "strbuf_append_int",
+                        "strbuf_append_int returned void",
+                    );
                 }
-                "is_odd" => {
-                    // Check if number is odd
-                    if args.len() != 1 {
-                        return Err(HaversError::CompileError(
-                            "is_odd expects 1 argument".to_string(),
-                        ));
-                    }
-                    let n = self.compile_expr(&args[0])?;
-                    let data = self.extract_data(n).unwrap();
-                    let two = self.types.i64_type.const_int(2, false);
-                    let rem = self
-                        .builder
-                        .build_int_signed_rem(data, two, "is_odd_rem")
-                        .unwrap();
-                    let zero = self.types.i64_type.const_int(0, false);
-                    let is_odd = self
-                        .builder
-                        .build_int_compare(inkwell::IntPredicate::NE, rem, zero, "is_odd_cmp")
-                        .unwrap();
-                    let is_odd_i64 = self
-                        .builder
-                        .build_int_z_extend(is_odd, self.types.i64_type, "is_odd_i64")
-                        .unwrap();
-                    return self.make_bool(is_odd_i64);
+                "strbuf_append_float" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.strbuf_append_float,
+                        args,
+                        2,
+                        "strbuf_append_float",
+                        "strbuf_append_float returned void",
+                    );
                 }
-                "is_muckle" => {
-                    if args.len() != 1 {
-                        return Err(HaversError::CompileError(
-                            "is_muckle expects 1 argument".to_string(),
-                        ));
-                    }
-                    let val = self.compile_expr(&args[0])?;
-                    let result = self
-                        .builder
-                        .build_call(self.libc.is_muckle, &[val.into()], "is_muckle_result")
-                        .unwrap()
-                        .try_as_basic_value()
-                        .left()
-                        .compile_ok_or("is_muckle returned void").unwrap();
-                    return Ok(result);
+                "strbuf_len" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.strbuf_len,
+                        args,
+                        1,
+                        "strbuf_len",
+                        "strbuf_len returned void",
+                    );
                 }
-                "capitalize" => {
-                    if args.len() != 1 {
+                "strbuf_clear" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.strbuf_clear,
+                        args,
+                        1,
+                        "strbuf_clear",
+                        "strbuf_clear returned void",
+                    );
+                }
+                "strbuf_build" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.strbuf_build,
+                        args,
+                        1,
+                        "strbuf_build",
+                        "strbuf_build returned void",
+                    );
+                }
+                "heap" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.heap_new,
+                        args,
+                        1,
+                        "heap",
+                        "heap returned void",
+                    );
+                }
+                "heap_push" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.heap_push,
+                        args,
+                        2,
+                        "heap_push",
+                        "heap_push returned void",
+                    );
+                }
+                "heap_pop" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.heap_pop,
+                        args,
+                        1,
+                        "heap_pop",
+                        "heap_pop returned void",
+                    );
+                }
+                "heap_peek" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.heap_peek,
+                        args,
+                        1,
+                        "heap_peek",
+                        "heap_peek returned void",
+                    );
+                }
+                "heap_tae_list" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.heap_tae_list,
+                        args,
+                        1,
+                        "heap_tae_list",
+                        "heap_tae_list returned void",
+                    );
+                }
+                "hash" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.hash,
+                        args,
+                        1,
+                        "hash",
+                        "hash returned void",
+                    );
+                }
+                "hashmap" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.hashmap_new,
+                        args,
+                        0,
+                        "hashmap",
+                        "hashmap returned void",
+                    );
+                }
+                "hashmap_set" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.hashmap_set,
+                        args,
+                        3,
+                        "hashmap_set",
+                        "hashmap_set returned void",
+                    );
+                }
+                "hashmap_get" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.hashmap_get,
+                        args,
+                        3,
+                        "hashmap_get",
+                        "hashmap_get returned void",
+                    );
+                }
+                "hashmap_has" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.hashmap_has,
+                        args,
+                        2,
+                        "hashmap_has",
+                        "hashmap_has returned void",
+                    );
+                }
+                "hashmap_remove" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.hashmap_remove,
+                        args,
+                        2,
+                        "hashmap_remove",
+                        "hashmap_remove returned void",
+                    );
+                }
+                "hashmap_keys" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.hashmap_keys,
+                        args,
+                        1,
+                        "hashmap_keys",
+                        "hashmap_keys returned void",
+                    );
+                }
+                "list_with_capacity" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.list_with_capacity,
+                        args,
+                        1,
+                        "list_with_capacity",
+                        "list_with_capacity returned void",
+                    );
+                }
+                "reserve" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.reserve,
+                        args,
+                        2,
+                        "reserve",
+                        "reserve returned void",
+                    );
+                }
+                "list_extend" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.list_extend,
+                        args,
+                        2,
+                        "list_extend",
+                        "list_extend returned void",
+                    );
+                }
+                "list_concat" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.list_concat,
+                        args,
+                        2,
+                        "list_concat",
+                        "list_concat returned void",
+                    );
+                }
+                "chynge" | "replace" => {
+                    if args.len() != 3 {
                         return Err(HaversError::CompileError(
-                            "capitalize expects 1 argument".to_string(),
+                            "chynge/replace expects 3 arguments (str, old, new)".to_string(),
                         ));
                     }
-                    let s = self.compile_expr(&args[0])?;
+                    let str_val = self.compile_expr(&args[0])?;
+                    let old_val = self.compile_expr(&args[1])?;
+                    let new_val = self.compile_expr(&args[2])?;
                     let result = self
                         .builder
-                        .build_call(self.libc.capitalize, &[s.into()], "capitalize_result")
+                        .build_call(
+                            self.libc.chynge,
+                            &[str_val.into(), old_val.into(), new_val.into()],
+                            "chynge_result",
+                        )
                         .unwrap()
                         .try_as_basic_value()
                         .left()
-                        .compile_ok_or("capitalize returned void").unwrap();
+                        .compile_ok_or("chynge returned void").unwrap();
                     return Ok(result);
                 }
-                "bit_shove_left" | "bit_shift_left" => {
-                    // Bitwise left shift
+                // Testing builtins
+                "assert" => {
+                    // Interpreter: assert(condition, msg) -> aye (or aborts).
                     if args.len() != 2 {
                         return Err(HaversError::CompileError(
-                            "bit_shift_left expects 2 arguments".to_string(),
-                        ));
-                    }
-                    let a = self.compile_expr(&args[0])?;
-                    let b = self.compile_expr(&args[1])?;
-                    let data_a = self.extract_data(a).unwrap();
-                    let data_b = self.extract_data(b).unwrap();
-                    let shifted = self
-                        .builder
-                        .build_left_shift(data_a, data_b, "bit_shl")
-                        .unwrap();
-                    return self.make_int(shifted);
-                }
-                "help_ma_boab" => {
-                    if args.len() != 1 {
-                        return Err(HaversError::CompileError(
-                            "help_ma_boab expects 1 argument".to_string(),
+                            "assert expects 2 arguments".to_string(),
                         ));
                     }
-                    let msg = self.compile_expr(&args[0])?;
-                    let result = self
+                    let cond = self.compile_expr(&args[0])?;
+                    let msg = self.compile_expr(&args[1])?;
+
+                    let truthy = self.is_truthy(cond).unwrap();
+                    let cond_bool = self.make_bool(truthy).unwrap();
+                    let msg_str = self.inline_tae_string(msg)?;
+
+                    let _ = self
                         .builder
-                        .build_call(self.libc.help_ma_boab, &[msg.into()], "help_ma_boab_result")
+                        .build_call(
+                            self.libc.assert_fn,
+                            &[cond_bool.into(), msg_str.into()],
+                            "assert_call",
+                        )
                         .unwrap()
                         .try_as_basic_value()
                         .left()
-                        .compile_ok_or("help_ma_boab returned void").unwrap();
-                    return Ok(result);
+                        .compile_ok_or("assert returned void").unwrap();
+                    let one = self.types.i64_type.const_int(1, false);
+                    return self.make_bool(one);
                 }
-                "banter" => {
-                    if args.len() != 2 {
+                "skip" => {
+                    if args.len() != 1 {
                         return Err(HaversError::CompileError(
-                            "banter expects 2 arguments".to_string(),
+                            "skip expects 1 argument".to_string(),
                         ));
                     }
-                    let a = self.compile_expr(&args[0])?;
-                    let b = self.compile_expr(&args[1])?;
+                    let reason = self.compile_expr(&args[0])?;
                     let result = self
                         .builder
-                        .build_call(self.libc.banter, &[a.into(), b.into()], "banter_result")
+                        .build_call(self.libc.skip, &[reason.into()], "skip_result")
                         .unwrap()
                         .try_as_basic_value()
                         .left()
-                        .compile_ok_or("banter returned void").unwrap();
+                        .compile_ok_or("skip returned void").unwrap();
                     return Ok(result);
                 }
-                "clype" => {
-                    if args.len() != 1 {
-                        return Err(HaversError::CompileError(
-                            "clype expects 1 argument".to_string(),
-                        ));
-                    }
-                    let val = self.compile_expr(&args[0])?;
+                "stacktrace" => {
+                    let in_catch = self.catch_functions.last().copied() == self.current_function;
+                    let runtime_fn = if in_catch {
+                        self.libc.hurl_stacktrace
+                    } else {
+                        self.libc.stacktrace
+                    };
                     let result = self
                         .builder
-                        .build_call(self.libc.clype, &[val.into()], "clype_result")
+                        .build_call(runtime_fn, &[], "stacktrace_result")
                         .unwrap()
                         .try_as_basic_value()
                         .left()
-                        .compile_ok_or("clype returned void").unwrap();
+                        .compile_ok_or("stacktrace returned void").unwrap();
                     return Ok(result);
                 }
-                "spy" => {
-                    // Debug helper placeholder
-                    return Ok(self.make_nil());
-                }
-                "upper" | "heich" => {
-                    if args.len() != 1 {
-                        return Err(HaversError::CompileError(
-                            "upper expects 1 argument".to_string(),
-                        ));
-                    }
-                    let arg = self.compile_expr(&args[0])?;
-                    return self.inline_upper(arg);
+                // Additional Scots aliases
+                "scots_greetin" => {
+                    // Return an error message string (Scots for "complaint")
+                    let global = Self::create_global_string(
+                        &self.module,
+                        self.context,
+                        "Och, something went wrang!",
+                        "scots_err_msg",
+                    );
+                    let str_ptr = self.get_string_ptr(global);
+                    return self.make_string(str_ptr);
                 }
-                "lower" | "laich" => {
-                    if args.len() != 1 {
-                        return Err(HaversError::CompileError(
-                            "lower expects 1 argument".to_string(),
-                        ));
-                    }
-                    let arg = self.compile_expr(&args[0])?;
-                    return self.inline_lower(arg);
+                "poetry_seed" => {
+                    // Random seed
+                    let min = self.types.i64_type.const_int(0, false);
+                    let max = self.types.i64_type.const_int(i64::MAX as u64, false);
+                    return self.build_call_basic_value(
+                        self.libc.random,
+                        &[min.into(), max.into()],
+                        "seed_result",
+                        "random returned void",
+                    );
                 }
-                "wheesht" | "trim" | "sneck" => {
-                    if args.len() != 1 {
-                        return Err(HaversError::CompileError(
-                            "wheesht/trim expects 1 argument".to_string(),
-                        ));
+                "braw_time" => {
+                    return self.compile_runtime_call_value_with_arity_call_name(
+                        self.libc.braw_time,
+                        args,
+                        0,
+                        "braw_time",
+                        "braw_time_result",
+                        "braw_time returned void",
+                    );
+                }
+                // Additional builtins
+                "read_file" => {
+                    // Alias for slurp
+                    return self.compile_runtime_call_value_with_arity_call_name(
+                        self.libc.slurp,
+                        args,
+                        1,
+                        "read_file",
+                        "read_file_result",
+                        "slurp returned void",
+                    );
+                }
+                "muckle" => {
+                    if args.len() == 1 {
+                        // muckle([list]) - maximum of list elements
+                        return self.compile_metadata_args(args).and_then(|call_args| {
+                            self.build_call_basic_value(
+                                self.libc.list_max,
+                                &call_args,
+                                "list_max_result",
+                                "list_max returned void",
+                            )
+                        });
                     }
-                    let arg_ty = self.infer_expr_type(&args[0]);
-                    let arg = self.compile_expr(&args[0])?;
-                    if arg_ty == VarType::List {
-                        return self.inline_wheesht_list(arg);
+                    if args.len() == 2 {
+                        return self.compile_metadata_args(args).and_then(|call_args| {
+                            self.build_call_basic_value(
+                                self.libc.muckle,
+                                &call_args,
+                                "muckle_result",
+                                "muckle returned void",
+                            )
+                        });
                     }
-                    return self.inline_wheesht(arg);
+                    return Err(HaversError::CompileError(
+                        "muckle expects 1 or 2 arguments".to_string(),
+                    ));
                 }
-                "ltrim" | "trim_left" | "trim_start" | "lstrip" => {
-                    // ltrim(str) - trim leading whitespace
-                    if args.len() != 1 {
-                        return Err(HaversError::CompileError(
-                            "ltrim expects 1 argument".to_string(),
-                        ));
-                    }
-                    let arg = self.compile_expr(&args[0])?;
-                    let result = self
-                        .builder
-                        .build_call(self.libc.ltrim, &[arg.into()], "ltrim_result")
-                        .unwrap()
-                        .try_as_basic_value()
-                        .left()
-                        .compile_ok_or("ltrim returned void").unwrap();
-                    return Ok(result);
+                "median" => {
+                    return self.compile_runtime_call_value_with_arity_call_name(
+                        self.libc.median,
+                        args,
+                        1,
+                        "median",
+                        "median_result",
+                        "median returned void",
+                    );
                 }
-                "rtrim" | "trim_right" | "trim_end" | "rstrip" => {
-                    // rtrim(str) - trim trailing whitespace
-                    if args.len() != 1 {
-                        return Err(HaversError::CompileError(
-                            "rtrim expects 1 argument".to_string(),
-                        ));
-                    }
-                    let arg = self.compile_expr(&args[0])?;
-                    let result = self
-                        .builder
-                        .build_call(self.libc.rtrim, &[arg.into()], "rtrim_result")
-                        .unwrap()
-                        .try_as_basic_value()
-                        .left()
-                        .compile_ok_or("rtrim returned void").unwrap();
-                    return Ok(result);
+                "percentile" => {
+                    return self.compile_runtime_call_value_with_arity_call_name(
+                        self.libc.percentile,
+                        args,
+                        2,
+                        "percentile",
+                        "percentile_result",
+                        "percentile returned void",
+                    );
                 }
-                "count_str" | "str_count" | "count_char" => {
+                "stats" => {
+                    return self.compile_runtime_call_value_with_arity_call_name(
+                        self.libc.list_stats,
+                        args,
+                        1,
+                        "stats",
+                        "stats_result",
+                        "stats returned void",
+                    );
+                }
+                "is_space" => {
+                    return self.compile_runtime_call_value_with_arity_call_name(
+                        self.libc.is_space,
+                        args,
+                        1,
+                        "is_space",
+                        "is_space_result",
+                        "is_space returned void",
+                    );
+                }
+                // is_digit now handled by inline_is_char_class later in the match
+                "wheesht_aw" => {
+                    return self.compile_runtime_call_value_with_arity_call_name(
+                        self.libc.wheesht_aw,
+                        args,
+                        1,
+                        "wheesht_aw",
+                        "wheesht_aw_result",
+                        "wheesht_aw returned void",
+                    );
+                }
+                "dicht" | "remove_at" => {
                     if args.len() != 2 {
                         return Err(HaversError::CompileError(
-                            "count_str expects 2 arguments (string, substring)".to_string(),
+                            "dicht expects 2 arguments (list, index)".to_string(),
                         ));
                     }
-                    let str_arg = self.compile_expr(&args[0])?;
-                    let sub_arg = self.compile_expr(&args[1])?;
-                    return self.inline_coont(str_arg, sub_arg);
+                    return self.compile_metadata_args(args).and_then(|call_args| {
+                        self.build_call_basic_value(
+                            self.libc.dicht,
+                            &call_args,
+                            "dicht_result",
+                            "dicht returned void",
+                        )
+                    });
                 }
-                "coont" | "count" => {
-                    // coont(x) -> len(x)
-                    // coont(list, value) / count(list, value) -> count occurrences
-                    // coont(str, substr) / count(str, substr) -> count substring occurrences
-                    if args.len() == 1 {
-                        let arg = self.compile_expr(&args[0])?;
-                        return self.inline_len(arg);
-                    }
-                    if args.len() != 2 {
+                "bonnie" | "pretty" => {
+                    return self.compile_runtime_call_value_with_arity_call_name(
+                        self.libc.bonnie,
+                        args,
+                        1,
+                        "bonnie",
+                        "bonnie_result",
+                        "bonnie returned void",
+                    );
+                }
+                "deck" | "shuffle" | "mince" => {
+                    return self.compile_runtime_call_value_with_arity_call_name(
+                        self.libc.shuffle,
+                        args,
+                        1,
+                        "shuffle",
+                        "shuffle_result",
+                        "shuffle returned void",
+                    );
+                }
+                "choice" => {
+                    if args.len() != 1 {
                         return Err(HaversError::CompileError(
-                            "coont/count expects 1-2 arguments".to_string(),
+                            "choice expects 1 argument (list)".to_string(),
                         ));
                     }
+                    let list_val = self.compile_expr(&args[0])?;
+                    let list_data = self.extract_data(list_val).unwrap();
+                    let list_len = self.get_list_length(list_data).unwrap();
 
-                    let container_val = self.compile_expr(&args[0])?;
-                    let needle_val = self.compile_expr(&args[1])?;
-                    let tag = self.extract_tag(container_val).unwrap();
-
-                    let function = self.current_function.unwrap();
-                    let list_block = self.context.append_basic_block(function, "coont_list");
-                    let str_block = self.context.append_basic_block(function, "coont_str");
-                    let other_block = self.context.append_basic_block(function, "coont_other");
-                    let merge_block = self.context.append_basic_block(function, "coont_merge");
-
-                    let list_tag = self
-                        .types
-                        .i8_type
-                        .const_int(ValueTag::List.as_u8() as u64, false);
-                    let str_tag = self
-                        .types
-                        .i8_type
-                        .const_int(ValueTag::String.as_u8() as u64, false);
-
-                    let is_list = self
-                        .builder
-                        .build_int_compare(IntPredicate::EQ, tag, list_tag, "is_list")
-                        .unwrap();
-                    let is_str = self
+                    let zero = self.types.i64_type.const_int(0, false);
+                    let is_empty = self
                         .builder
-                        .build_int_compare(IntPredicate::EQ, tag, str_tag, "is_str")
+                        .build_int_compare(IntPredicate::EQ, list_len, zero, "choice_empty")
                         .unwrap();
 
-                    let check_str = self.context.append_basic_block(function, "coont_check_str");
-                    self.builder
-                        .build_conditional_branch(is_list, list_block, check_str)
-                        .unwrap();
+                    let function = self.current_function.unwrap();
+                    let empty_block = self.context.append_basic_block(function, "choice_empty");
+                    let nonempty_block =
+                        self.context.append_basic_block(function, "choice_nonempty");
+                    let merge = self.context.append_basic_block(function, "choice_merge");
 
-                    self.builder.position_at_end(check_str);
                     self.builder
-                        .build_conditional_branch(is_str, str_block, other_block)
+                        .build_conditional_branch(is_empty, empty_block, nonempty_block)
                         .unwrap();
 
-                    // List: count_val(list, value)
-                    self.builder.position_at_end(list_block);
-                    let list_res = self
+                    self.builder.position_at_end(empty_block);
+                    let empty_val = self.make_nil();
+                    self.builder.build_unconditional_branch(merge).unwrap();
+                    let empty_end = self.builder.get_insert_block().unwrap();
+
+                    self.builder.position_at_end(nonempty_block);
+                    let elem_ptr = self.get_list_element_ptr(list_data, zero).unwrap();
+                    let elem = self
                         .builder
-                        .build_call(
-                            self.libc.count_val,
-                            &[container_val.into(), needle_val.into()],
-                            "count_val_res",
-                        )
-                        .unwrap()
-                        .try_as_basic_value()
-                        .left()
-                        .compile_ok_or("count_val returned void").unwrap();
-                    self.builder
-                        .build_unconditional_branch(merge_block)
+                        .build_load(self.types.value_type, elem_ptr, "choice_elem")
                         .unwrap();
-                    let list_end = self.builder.get_insert_block().unwrap();
+                    self.builder.build_unconditional_branch(merge).unwrap();
+                    let nonempty_end = self.builder.get_insert_block().unwrap();
 
-                    // String: coont(str, substr)
-                    self.builder.position_at_end(str_block);
-                    let str_res = self.inline_coont(container_val, needle_val)?;
-                    self.builder
-                        .build_unconditional_branch(merge_block)
+                    self.builder.position_at_end(merge);
+                    let phi = self
+                        .builder
+                        .build_phi(self.types.value_type, "choice_result")
                         .unwrap();
-                    let str_end = self.builder.get_insert_block().unwrap();
+                    phi.add_incoming(&[(&empty_val, empty_end), (&elem, nonempty_end)]);
+                    return Ok(phi.as_basic_value());
+                }
+                "sample" => {
+                    if args.len() != 2 {
+                        return Err(HaversError::CompileError(
+                            "sample expects 2 arguments (list, n)".to_string(),
+                        ));
+                    }
+                    let list_val = self.compile_expr(&args[0])?;
+                    let n_val = self.compile_expr(&args[1])?;
+                    let list_data = self.extract_data(list_val).unwrap();
+                    let list_len = self.get_list_length(list_data).unwrap();
+                    let n_raw = self.extract_data(n_val).unwrap();
 
-                    // Other: return 0
-                    self.builder.position_at_end(other_block);
-                    let zero = self.make_int(self.types.i64_type.const_int(0, false)).unwrap();
-                    self.builder
-                        .build_unconditional_branch(merge_block)
+                    let zero = self.types.i64_type.const_int(0, false);
+                    let n_lt0 = self
+                        .builder
+                        .build_int_compare(IntPredicate::SLT, n_raw, zero, "sample_n_lt0")
                         .unwrap();
-                    let other_end = self.builder.get_insert_block().unwrap();
-
-                    self.builder.position_at_end(merge_block);
-                    let phi = self
+                    let n_nonneg = self
                         .builder
-                        .build_phi(self.types.value_type, "coont_result")
+                        .build_select(n_lt0, zero, n_raw, "sample_n_nonneg")
+                        .unwrap()
+                        .into_int_value();
+                    let n_gt_len = self
+                        .builder
+                        .build_int_compare(IntPredicate::UGT, n_nonneg, list_len, "sample_n_gt_len")
                         .unwrap();
-                    phi.add_incoming(&[
-                        (&list_res, list_end),
-                        (&str_res, str_end),
-                        (&zero, other_end),
-                    ]);
-                    return Ok(phi.as_basic_value());
+                    let end = self
+                        .builder
+                        .build_select(n_gt_len, list_len, n_nonneg, "sample_end")
+                        .unwrap()
+                        .into_int_value();
+
+                    let start_val = self.make_int(zero).unwrap();
+                    let end_val = self.make_int(end).unwrap();
+                    return self.inline_scran(list_val, start_val, end_val);
                 }
-                // Phase 4: Type & Utility functions
-                "whit_kind" => {
-                    if args.len() != 1 {
+                "bit_an" | "bit_and" => {
+                    if args.len() != 2 {
                         return Err(HaversError::CompileError(
-                            "whit_kind expects 1 argument".to_string(),
+                            "bit_and expects 2 arguments".to_string(),
                         ));
                     }
-                    let arg = self.compile_expr(&args[0])?;
+                    let a = self.compile_expr(&args[0])?;
+                    let b = self.compile_expr(&args[1])?;
                     let result = self
                         .builder
-                        .build_call(self.libc.type_of, &[arg.into()], "type_of_result")
+                        .build_call(self.libc.bit_and, &[a.into(), b.into()], "bit_and_result")
                         .unwrap()
                         .try_as_basic_value()
                         .left()
-                        .compile_ok_or("type_of returned void").unwrap();
+                        .compile_ok_or("bit_and returned void").unwrap();
                     return Ok(result);
                 }
-                "range" => {
+                "bit_or" => {
                     if args.len() != 2 {
                         return Err(HaversError::CompileError(
-                            "range expects 2 arguments".to_string(),
+                            "bit_or expects 2 arguments".to_string(),
                         ));
                     }
-                    let start = self.compile_expr(&args[0])?;
-                    let end = self.compile_expr(&args[1])?;
-                    let step = self.types.i64_type.const_int(1, false);
-                    // Use runtime function
-                    let start_i64 = self.coerce_i64(start, "range")?;
-                    let end_i64 = self.coerce_i64(end, "range")?;
+                    let a = self.compile_expr(&args[0])?;
+                    let b = self.compile_expr(&args[1])?;
                     let result = self
                         .builder
-                        .build_call(
-                            self.libc.range,
-                            &[start_i64.into(), end_i64.into(), step.into()],
-                            "range_result",
-                        )
+                        .build_call(self.libc.bit_or, &[a.into(), b.into()], "bit_or_result")
                         .unwrap()
                         .try_as_basic_value()
                         .left()
-                        .compile_ok_or("range returned void").unwrap();
+                        .compile_ok_or("bit_or returned void").unwrap();
                     return Ok(result);
                 }
-                // Phase 5: Timing functions
-                "noo" => {
-                    if !args.is_empty() {
+                "bit_xor" => {
+                    if args.len() != 2 {
                         return Err(HaversError::CompileError(
-                            "noo expects 0 arguments".to_string(),
+                            "bit_xor expects 2 arguments".to_string(),
                         ));
                     }
-                    return self.inline_noo();
+                    return self.compile_runtime_call_value_with_arity_call_name(
+                        self.libc.bit_xor,
+                        args,
+                        2,
+                        "bit_xor",
+                        "bit_xor_result",
+                        "bit_xor returned void",
+                    );
                 }
-                "tick" => {
-                    if !args.is_empty() {
+                // Misc Scots aliases
+                "scots_farewell" | "scots_exclaim" => {
+                    // These just return nil - they're exclamations or placeholders
+                    return Ok(self.make_nil());
+                }
+                "blether_format" => {
+                    // A literal template is compiled once, into a slot of its own
+                    if let [Expr::Literal {
+                        value: Literal::String(_),
+                        ..
+                    }, _] = args
+                    {
+                        let template = self.compile_expr(&args[0])?;
+                        let dict = self.compile_expr(&args[1])?;
+                        let site =
+                            self.module
+                                .add_global(self.types.value_type, None, "format_site");
+                        site.set_linkage(Linkage::Internal);
+                        site.set_initializer(&self.types.value_type.const_zero());
+                        return self.build_call_basic_value(
+                            self.libc.blether_format_at,
+                            &[site.as_pointer_value().into(), template.into(), dict.into()],
+                            "blether_format_result",
+                            "blether_format returned void",
+                        );
+                    }
+                    return self.compile_runtime_call_value_with_arity_call_name(
+                        self.libc.blether_format,
+                        args,
+                        2,
+                        "blether_format",
+                        "blether_format_result",
+                        "blether_format returned void",
+                    );
+                }
+                "format_compile" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.format_compile,
+                        args,
+                        1,
+                        "format_compile",
+                        "format_compile returned void",
+                    );
+                }
+                "format_apply" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.format_apply,
+                        args,
+                        2,
+                        "format_apply",
+                        "format_apply returned void",
+                    );
+                }
+                "read_lines" => {
+                    // Alias for lines
+                    return self.compile_runtime_call_value_with_arity_call_name(
+                        self.libc.lines,
+                        args,
+                        1,
+                        "read_lines",
+                        "read_lines_result",
+                        "lines returned void",
+                    );
+                }
+                "append_file" => {
+                    return self.compile_runtime_call_value_with_arity_call_name(
+                        self.libc.scrieve_append,
+                        args,
+                        2,
+                        "append_file",
+                        "append_file_result",
+                        "scrieve_append returned void",
+                    );
+                }
+                "minaw" => {
+                    // Minimum of list
+                    return self.compile_runtime_call_value_with_arity_call_name(
+                        self.libc.list_min,
+                        args,
+                        1,
+                        "minaw",
+                        "minaw_result",
+                        "list_min returned void",
+                    );
+                }
+                "is_wee" => {
+                    return self.compile_runtime_call_value_with_arity_call_name(
+                        self.libc.is_wee,
+                        args,
+                        1,
+                        "is_wee",
+                        "is_wee_result",
+                        "is_wee returned void",
+                    );
+                }
+                "is_even" => {
+                    // Check if number is even
+                    if args.len() != 1 {
                         return Err(HaversError::CompileError(
-                            "tick expects 0 arguments".to_string(),
+                            "is_even expects 1 argument".to_string(),
                         ));
                     }
-                    return self.inline_tick();
+                    let n = self.compile_expr(&args[0])?;
+                    let data = self.extract_data(n).unwrap();
+                    let two = self.types.i64_type.const_int(2, false);
+                    let rem = self
+                        .builder
+                        .build_int_signed_rem(data, two, "is_even_rem")
+                        .unwrap();
+                    let zero = self.types.i64_type.const_int(0, false);
+                    let is_even = self
+                        .builder
+                        .build_int_compare(inkwell::IntPredicate::EQ, rem, zero, "is_even_cmp")
+                        .unwrap();
+                    let is_even_i64 = self
+                        .builder
+                        .build_int_z_extend(is_even, self.types.i64_type, "is_even_i64")
+                        .unwrap();
+                    return self.make_bool(is_even_i64);
                 }
-                "mono_ms" => {
-                    if !args.is_empty() {
+                "bit_nae" | "bit_not" => {
+                    // Bitwise NOT
+                    if args.len() != 1 {
                         return Err(HaversError::CompileError(
-                            "mono_ms expects 0 arguments".to_string(),
+                            "bit_not expects 1 argument".to_string(),
                         ));
                     }
-                    let result = self
-                        .builder
-                        .build_call(self.libc.mono_ms, &[], "mono_ms")
-                        .unwrap()
-                        .try_as_basic_value()
-                        .left()
-                        .compile_ok_or("mono_ms returned void").unwrap();
-                    return Ok(result);
+                    let n = self.compile_expr(&args[0])?;
+                    let data = self.extract_data(n).unwrap();
+                    let not_val = self.builder.build_not(data, "bit_not").unwrap();
+                    return self.make_int(not_val);
                 }
-                "mono_ns" => {
-                    if !args.is_empty() {
+                // Global test variables - return reasonable defaults
+                "__current_suite" => {
+                    let global = Self::create_global_string(
+                        &self.module,
+                        self.context,
+                        "",
+                        "current_suite_default",
+                    );
+                    let str_ptr = self.get_string_ptr(global);
+                    return self.make_string(str_ptr);
+                }
+                "_tick_counter" | "_msg_counter" | "_verbose" | "__prop_passed" => {
+                    let zero = self.types.i64_type.const_int(0, false);
+                    return self.make_int(zero);
+                }
+                "_global_bus" | "_global_logger" => {
+                    // Return nil for global objects
+                    return Ok(self.make_nil());
+                }
+                // More missing builtins
+                "maxaw" => {
+                    // Maximum of list
+                    if args.len() != 1 {
                         return Err(HaversError::CompileError(
-                            "mono_ns expects 0 arguments".to_string(),
+                            "maxaw expects 1 argument".to_string(),
                         ));
                     }
+                    let list = self.compile_expr(&args[0])?;
                     let result = self
                         .builder
-                        .build_call(self.libc.mono_ns, &[], "mono_ns")
+                        .build_call(self.libc.list_max, &[list.into()], "maxaw_result")
                         .unwrap()
                         .try_as_basic_value()
                         .left()
-                        .compile_ok_or("mono_ns returned void").unwrap();
+                        .compile_ok_or("list_max returned void").unwrap();
                     return Ok(result);
                 }
-                "time" | "time_now" => {
-                    if !args.is_empty() {
+                "is_odd" => {
+                    // Check if number is odd
+                    if args.len() != 1 {
                         return Err(HaversError::CompileError(
-                            "time/time_now expects 0 arguments".to_string(),
+                            "is_odd expects 1 argument".to_string(),
                         ));
                     }
-                    // Use noo() semantics (milliseconds since epoch) for now.
-                    return self.inline_noo();
-                }
-                "timestamp_millis" => {
-                    if !args.is_empty() {
-                        return Err(HaversError::CompileError(
-                            "timestamp_millis expects 0 arguments".to_string(),
-                        ));
+                    let n = self.compile_expr(&args[0])?;
+                    let data = self.extract_data(n).unwrap();
+                    let two = self.types.i64_type.const_int(2, false);
+                    let rem = self
+                        .builder
+                        .build_int_signed_rem(data, two, "is_odd_rem")
+                        .unwrap();
+                    let zero = self.types.i64_type.const_int(0, false);
+                    let is_odd = self
+                        .builder
+                        .build_int_compare(inkwell::IntPredicate::NE, rem, zero, "is_odd_cmp")
+                        .unwrap();
+                    let is_odd_i64 = self
+                        .builder
+                        .build_int_z_extend(is_odd, self.types.i64_type, "is_odd_i64")
+                        .unwrap();
+                    return self.make_bool(is_odd_i64);
+                }
+                "is_muckle" => {
+                    if args.len() != 1 {
+                        return Err(HaversError::CompileError(
+                            "is_muckle expects 1 argument".to_string(),
+                        ));
+                    }
+                    let val = self.compile_expr(&args[0])?;
+                    let result = self
+                        .builder
+                        .build_call(self.libc.is_muckle, &[val.into()], "is_muckle_result")
+                        .unwrap()
+                        .try_as_basic_value()
+                        .left()
+                        .compile_ok_or("is_muckle returned void").unwrap();
+                    return Ok(result);
+                }
+                "capitalize" => {
+                    if args.len() != 1 {
+                        return Err(HaversError::CompileError(
+                            "capitalize expects 1 argument".to_string(),
+                        ));
+                    }
+                    let s = self.compile_expr(&args[0])?;
+                    let result = self
+                        .builder
+                        .build_call(self.libc.capitalize, &[s.into()], "capitalize_result")
+                        .unwrap()
+                        .try_as_basic_value()
+                        .left()
+                        .compile_ok_or("capitalize returned void").unwrap();
+                    return Ok(result);
+                }
+                "bit_shove_left" | "bit_shift_left" => {
+                    // Bitwise left shift
+                    if args.len() != 2 {
+                        return Err(HaversError::CompileError(
+                            "bit_shift_left expects 2 arguments".to_string(),
+                        ));
+                    }
+                    let a = self.compile_expr(&args[0])?;
+                    let b = self.compile_expr(&args[1])?;
+                    let data_a = self.extract_data(a).unwrap();
+                    let data_b = self.extract_data(b).unwrap();
+                    let shifted = self
+                        .builder
+                        .build_left_shift(data_a, data_b, "bit_shl")
+                        .unwrap();
+                    return self.make_int(shifted);
+                }
+                "help_ma_boab" => {
+                    if args.len() != 1 {
+                        return Err(HaversError::CompileError(
+                            "help_ma_boab expects 1 argument".to_string(),
+                        ));
+                    }
+                    let msg = self.compile_expr(&args[0])?;
+                    let result = self
+                        .builder
+                        .build_call(self.libc.help_ma_boab, &[msg.into()], "help_ma_boab_result")
+                        .unwrap()
+                        .try_as_basic_value()
+                        .left()
+                        .compile_ok_or("help_ma_boab returned void").unwrap();
+                    return Ok(result);
+                }
+                "banter" => {
+                    if args.len() != 2 {
+                        return Err(HaversError::CompileError(
+                            "banter expects 2 arguments".to_string(),
+                        ));
+                    }
+                    let a = self.compile_expr(&args[0])?;
+                    let b = self.compile_expr(&args[1])?;
+                    let result = self
+                        .builder
+                        .build_call(self.libc.banter, &[a.into(), b.into()], "banter_result")
+                        .unwrap()
+                        .try_as_basic_value()
+                        .left()
+                        .compile_ok_or("banter returned void").unwrap();
+                    return Ok(result);
+                }
+                "clype" => {
+                    if args.len() != 1 {
+                        return Err(HaversError::CompileError(
+                            "clype expects 1 argument".to_string(),
+                        ));
+                    }
+                    let val = self.compile_expr(&args[0])?;
+                    let result = self
+                        .builder
+                        .build_call(self.libc.clype, &[val.into()], "clype_result")
+                        .unwrap()
+                        .try_as_basic_value()
+                        .left()
+                        .compile_ok_or("clype returned void").unwrap();
+                    return Ok(result);
+                }
+                "spy" => {
+                    // Debug helper placeholder
+                    return Ok(self.make_nil());
+                }
+                "upper" | "heich" => {
+                    if args.len() != 1 {
+                        return Err(HaversError::CompileError(
+                            "upper expects 1 argument".to_string(),
+                        ));
+                    }
+                    let arg = self.compile_expr(&args[0])?;
+                    return self.inline_upper(arg);
+                }
+                "lower" | "laich" => {
+                    if args.len() != 1 {
+                        return Err(HaversError::CompileError(
+                            "lower expects 1 argument".to_string(),
+                        ));
+                    }
+                    let arg = self.compile_expr(&args[0])?;
+                    return self.inline_lower(arg);
+                }
+                "wheesht" | "trim" | "sneck" => {
+                    if args.len() != 1 {
+                        return Err(HaversError::CompileError(
+                            "wheesht/trim expects 1 argument".to_string(),
+                        ));
+                    }
+                    let arg_ty = self.infer_expr_type(&args[0]);
+                    let arg = self.compile_expr(&args[0])?;
+                    if arg_ty == VarType::List {
+                        return self.inline_wheesht_list(arg);
+                    }
+                    return self.inline_wheesht(arg);
+                }
+                "ltrim" | "trim_left" | "trim_start" | "lstrip" => {
+                    // ltrim(str) - trim leading whitespace
+                    if args.len() != 1 {
+                        return Err(HaversError::CompileError(
+                            "ltrim expects 1 argument".to_string(),
+                        ));
+                    }
+                    let arg = self.compile_expr(&args[0])?;
+                    let result = self
+                        .builder
+                        .build_call(self.libc.ltrim, &[arg.into()], "ltrim_result")
+                        .unwrap()
+                        .try_as_basic_value()
+                        .left()
+                        .compile_ok_or("ltrim returned void").unwrap();
+                    return Ok(result);
+                }
+                "rtrim" | "trim_right" | "trim_end" | "rstrip" => {
+                    // rtrim(str) - trim trailing whitespace
+                    if args.len() != 1 {
+                        return Err(HaversError::CompileError(
+                            "rtrim expects 1 argument".to_string(),
+                        ));
+                    }
+                    let arg = self.compile_expr(&args[0])?;
+                    let result = self
+                        .builder
+                        .build_call(self.libc.rtrim, &[arg.into()], "rtrim_result")
+                        .unwrap()
+                        .try_as_basic_value()
+                        .left()
+                        .compile_ok_or("rtrim returned void").unwrap();
+                    return Ok(result);
+                }
+                "count_str" | "str_count" | "count_char" => {
+                    if args.len() != 2 {
+                        return Err(HaversError::CompileError(
+                            "count_str expects 2 arguments (string, substring)".to_string(),
+                        ));
+                    }
+                    let str_arg = self.compile_expr(&args[0])?;
+                    let sub_arg = self.compile_expr(&args[1])?;
+                    return self.inline_coont(str_arg, sub_arg);
+                }
+                "coont" | "count" => {
+                    // coont(x) -> len(x)
+                    // coont(list, value) / count(list, value) -> count occurrences
+                    // coont(str, substr) / count(str, substr) -> count substring occurrences
+                    if args.len() == 1 {
+                        let arg = self.compile_expr(&args[0])?;
+                        return self.inline_len(arg);
+                    }
+                    if args.len() != 2 {
+                        return Err(HaversError::CompileError(
+                            "coont/count expects 1-2 arguments".to_string(),
+                        ));
+                    }
+
+                    let container_val = self.compile_expr(&args[0])?;
+                    let needle_val = self.compile_expr(&args[1])?;
+                    let tag = self.extract_tag(container_val).unwrap();
+
+                    let function = self.current_function.unwrap();
+                    let list_block = self.context.append_basic_block(function, "coont_list");
+                    let str_block = self.context.append_basic_block(function, "coont_str");
+                    let other_block = self.context.append_basic_block(function, "coont_other");
+                    let merge_block = self.context.append_basic_block(function, "coont_merge");
+
+                    let list_tag = self
+                        .types
+                        .i8_type
+                        .const_int(ValueTag::List.as_u8() as u64, false);
+                    let str_tag = self
+                        .types
+                        .i8_type
+                        .const_int(ValueTag::String.as_u8() as u64, false);
+
+                    let is_list = self
+                        .builder
+                        .build_int_compare(IntPredicate::EQ, tag, list_tag, "is_list")
+                        .unwrap();
+                    let is_str = self
+                        .builder
+                        .build_int_compare(IntPredicate::EQ, tag, str_tag, "is_str")
+                        .unwrap();
+
+                    let check_str = self.context.append_basic_block(function, "coont_check_str");
+                    self.builder
+                        .build_conditional_branch(is_list, list_block, check_str)
+                        .unwrap();
+
+                    self.builder.position_at_end(check_str);
+                    self.builder
+                        .build_conditional_branch(is_str, str_block, other_block)
+                        .unwrap();
+
+                    // List: count_val(list, value)
+                    self.builder.position_at_end(list_block);
+                    let list_res = self
+                        .builder
+                        .build_call(
+                            self.libc.count_val,
+                            &[container_val.into(), needle_val.into()],
+                            "count_val_res",
+                        )
+                        .unwrap()
+                        .try_as_basic_value()
+                        .left()
+                        .compile_ok_or("count_val returned void").unwrap();
+                    self.builder
+                        .build_unconditional_branch(merge_block)
+                        .unwrap();
+                    let list_end = self.builder.get_insert_block().unwrap();
+
+                    // String: coont(str, substr)
+                    self.builder.position_at_end(str_block);
+                    let str_res = self.inline_coont(container_val, needle_val)?;
+                    self.builder
+                        .build_unconditional_branch(merge_block)
+                        .unwrap();
+                    let str_end = self.builder.get_insert_block().unwrap();
+
+                    // Other: return 0
+                    self.builder.position_at_end(other_block);
+                    let zero = self.make_int(self.types.i64_type.const_int(0, false)).unwrap();
+                    self.builder
+                        .build_unconditional_branch(merge_block)
+                        .unwrap();
+                    let other_end = self.builder.get_insert_block().unwrap();
+
+                    self.builder.position_at_end(merge_block);
+                    let phi = self
+                        .builder
+                        .build_phi(self.types.value_type, "coont_result")
+                        .unwrap();
+                    phi.add_incoming(&[
+                        (&list_res, list_end),
+                        (&str_res, str_end),
+                        (&zero, other_end),
+                    ]);
+                    return Ok(phi.as_basic_value());
+                }
+                // Phase 4: Type & Utility functions
+                "whit_kind" => {
+                    if args.len() != 1 {
+                        return Err(HaversError::CompileError(
+                            "whit_kind expects 1 argument".to_string(),
+                        ));
+                    }
+                    let arg = self.compile_expr(&args[0])?;
+                    let result = self
+                        .builder
+                        .build_call(self.libc.type_of, &[arg.into()], "type_of_result")
+                        .unwrap()
+                        .try_as_basic_value()
+                        .left()
+                        .compile_ok_or("type_of returned void").unwrap();
+                    return Ok(result);
+                }
+                "range" => {
+                    if args.len() != 2 {
+                        return Err(HaversError::CompileError(
+                            "range expects 2 arguments".to_string(),
+                        ));
+                    }
+                    let start = self.compile_expr(&args[0])?;
+                    let end = self.compile_expr(&args[1])?;
+                    let step = self.types.i64_type.const_int(1, false);
+                    // Use runtime function
+                    let start_i64 = self.coerce_i64(start, "range")?;
+                    let end_i64 = self.coerce_i64(end, "range")?;
+                    let result = self
+                        .builder
+                        .build_call(
+                            self.libc.range,
+                            &[start_i64.into(), end_i64.into(), step.into()],
+                            "range_result",
+                        )
+                        .unwrap()
+                        .try_as_basic_value()
+                        .left()
+                        .compile_ok_or("range returned void").unwrap();
+                    return Ok(result);
+                }
+                // Phase 5: Timing functions
+                "noo" => {
+                    if !args.is_empty() {
+                        return Err(HaversError::CompileError(
+                            "noo expects 0 arguments".to_string(),
+                        ));
+                    }
+                    return self.inline_noo();
+                }
+                "tick" => {
+                    if !args.is_empty() {
+                        return Err(HaversError::CompileError(
+                            "tick expects 0 arguments".to_string(),
+                        ));
+                    }
+                    return self.inline_tick();
+                }
+                "mono_ms" => {
+                    if !args.is_empty() {
+                        return Err(HaversError::CompileError(
+                            "mono_ms expects 0 arguments".to_string(),
+                        ));
+                    }
+                    let result = self
+                        .builder
+                        .build_call(self.libc.mono_ms, &[], "mono_ms")
+                        .unwrap()
+                        .try_as_basic_value()
+                        .left()
+                        .compile_ok_or("mono_ms returned void").unwrap();
+                    return Ok(result);
+                }
+                "mono_ns" => {
+                    if !args.is_empty() {
+                        return Err(HaversError::CompileError(
+                            "mono_ns expects 0 arguments".to_string(),
+                        ));
+                    }
+                    let result = self
+                        .builder
+                        .build_call(self.libc.mono_ns, &[], "mono_ns")
+                        .unwrap()
+                        .try_as_basic_value()
+                        .left()
+                        .compile_ok_or("mono_ns returned void").unwrap();
+                    return Ok(result);
+                }
+                "time" | "time_now" => {
+                    if !args.is_empty() {
+                        return Err(HaversError::CompileError(
+                            "time/time_now expects 0 arguments".to_string(),
+                        ));
+                    }
+                    // Use noo() semantics (milliseconds since epoch) for now.
+                    return self.inline_noo();
+                }
+                "timestamp_millis" => {
+                    if !args.is_empty() {
+                        return Err(HaversError::CompileError(
+                            "timestamp_millis expects 0 arguments".to_string(),
+                        ));
                     }
                     return self.inline_noo();
                 }
@@ -15411,7 +19416,18 @@ impl<'ctx> CodeGen<'ctx> {
                     }
                     let str_arg = self.compile_expr(&args[0])?;
                     let delim_arg = self.compile_expr(&args[1])?;
-                    return self.inline_split(str_arg, delim_arg);
+                    let result = self
+                        .builder
+                        .build_call(
+                            self.libc.split,
+                            &[str_arg.into(), delim_arg.into()],
+                            "split_result",
+                        )
+                        .unwrap()
+                        .try_as_basic_value()
+                        .left()
+                        .compile_ok_or("split returned void").unwrap();
+                    return Ok(result);
                 }
                 "join" | "jyne" => {
                     if args.len() != 2 {
@@ -15440,6 +19456,30 @@ impl<'ctx> CodeGen<'ctx> {
                         .compile_ok_or("list_sort returned void").unwrap();
                     return Ok(result);
                 }
+                "sort_by" => {
+                    // sort_by(list, key_fn) - map the keys once, then a stable sort on them
+                    if args.len() != 2 {
+                        return Err(HaversError::CompileError(
+                            "sort_by expects 2 arguments (list, function)".to_string(),
+                        ));
+                    }
+                    let list_arg = self.compile_expr(&args[0])?;
+                    let func_arg = self.compile_expr(&args[1])?;
+                    let keys = self.inline_gaun(list_arg, func_arg)?;
+                    let result = self
+                        .builder
+                        .build_call(
+                            self.libc.list_sort_by_keys,
+                            &[list_arg.into(), keys.into()],
+                            "sort_by_result",
+                        )
+                        .unwrap()
+                        .try_as_basic_value()
+                        .left()
+                        .compile_ok_or("list_sort_by_keys returned void")
+                        .unwrap();
+                    return Ok(result);
+                }
                 // Phase 6: Higher-order functions
                 "gaun" | "map" => {
                     if args.len() != 2 {
@@ -15884,6 +19924,24 @@ impl<'ctx> CodeGen<'ctx> {
                     }
                     return self.inline_randfloat();
                 }
+                "seed" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.seed,
+                        args,
+                        1,
+                        "seed",
+                        "seed returned void",
+                    );
+                }
+                "random_list" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.random_list,
+                        args,
+                        3,
+                        "random_list",
+                        "random_list returned void",
+                    );
+                }
                 "rand" => {
                     // rand() - random integer between 0 and 1_000_000
                     // rand(min, max) - random integer in [min, max]
@@ -16671,7 +20729,14 @@ impl<'ctx> CodeGen<'ctx> {
                         .unwrap();
 
                     self.builder.position_at_end(dict_block);
-                    let dict_res = self.inline_dict_merge(a, b)?;
+                    let dict_res = self
+                        .builder
+                        .build_call(self.libc.dict_merge, &[a.into(), b.into()], "ceilidh_dict_res")
+                        .unwrap()
+                        .try_as_basic_value()
+                        .left()
+                        .compile_ok_or("dict_merge returned void")
+                        .unwrap();
                     self.builder
                         .build_unconditional_branch(merge_block)
                         .unwrap();
@@ -17262,6 +21327,208 @@ impl<'ctx> CodeGen<'ctx> {
                         .compile_ok_or("json_pretty returned void").unwrap();
                     return Ok(result);
                 }
+                "json_write_into" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.json_write_into,
+                        args,
+                        2,
+                        "json_write_into",
+                        "json_write_into returned void",
+                    );
+                }
+                "json_stream_open" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.json_stream_open,
+                        args,
+                        1,
+                        "json_stream_open",
+                        "json_stream_open returned void",
+                    );
+                }
+                "json_stream_new" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.json_stream_new,
+                        args,
+                        0,
+                        "json_stream_new",
+                        "json_stream_new returned void",
+                    );
+                }
+                "json_stream_feed" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.json_stream_feed,
+                        args,
+                        2,
+                        "json_stream_feed",
+                        "json_stream_feed returned void",
+                    );
+                }
+                "json_stream_next" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.json_stream_next,
+                        args,
+                        1,
+                        "json_stream_next",
+                        "json_stream_next returned void",
+                    );
+                }
+                "json_stream_close" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.json_stream_close,
+                        args,
+                        1,
+                        "json_stream_close",
+                        "json_stream_close returned void",
+                    );
+                }
+                "pack" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.pack,
+                        args,
+                        1,
+                        "pack",
+                        "pack returned void",
+                    );
+                }
+                "pack_into" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.pack_into,
+                        args,
+                        2,
+                        "pack_into",
+                        "pack_into returned void",
+                    );
+                }
+                "unpack" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.unpack,
+                        args,
+                        1,
+                        "unpack",
+                        "unpack returned void",
+                    );
+                }
+                "unpack_stream_new" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.unpack_stream_new,
+                        args,
+                        0,
+                        "unpack_stream_new",
+                        "unpack_stream_new returned void",
+                    );
+                }
+                "unpack_stream_feed" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.unpack_stream_feed,
+                        args,
+                        2,
+                        "unpack_stream_feed",
+                        "unpack_stream_feed returned void",
+                    );
+                }
+                "unpack_stream_next" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.unpack_stream_next,
+                        args,
+                        1,
+                        "unpack_stream_next",
+                        "unpack_stream_next returned void",
+                    );
+                }
+                "bytes_compress" => {
+                    if args.is_empty() || args.len() > 3 {
+                        return Err(HaversError::CompileError(
+                            "bytes_compress expects 1-3 arguments (data, level, format)"
+                                .to_string(),
+                        ));
+                    }
+                    let data = self.compile_expr(&args[0])?;
+                    let level = if args.len() >= 2 {
+                        self.compile_expr(&args[1])?
+                    } else {
+                        self.make_nil()
+                    };
+                    let format = if args.len() >= 3 {
+                        self.compile_expr(&args[2])?
+                    } else {
+                        self.make_nil()
+                    };
+                    return self.build_call_basic_value(
+                        self.libc.bytes_compress,
+                        &[data.into(), level.into(), format.into()],
+                        "bytes_compress_result",
+                        "bytes_compress returned void",
+                    );
+                }
+                "bytes_decompress" => {
+                    if args.is_empty() || args.len() > 2 {
+                        return Err(HaversError::CompileError(
+                            "bytes_decompress expects 1-2 arguments (data, format)".to_string(),
+                        ));
+                    }
+                    let data = self.compile_expr(&args[0])?;
+                    let format = if args.len() >= 2 {
+                        self.compile_expr(&args[1])?
+                    } else {
+                        self.make_nil()
+                    };
+                    return self.build_call_basic_value(
+                        self.libc.bytes_decompress,
+                        &[data.into(), format.into()],
+                        "bytes_decompress_result",
+                        "bytes_decompress returned void",
+                    );
+                }
+                "gzip_stream_new" => {
+                    if args.len() > 2 {
+                        return Err(HaversError::CompileError(
+                            "gzip_stream_new expects 0-2 arguments (sink, level)".to_string(),
+                        ));
+                    }
+                    let sink = if !args.is_empty() {
+                        self.compile_expr(&args[0])?
+                    } else {
+                        self.make_nil()
+                    };
+                    let level = if args.len() >= 2 {
+                        self.compile_expr(&args[1])?
+                    } else {
+                        self.make_nil()
+                    };
+                    return self.build_call_basic_value(
+                        self.libc.gzip_stream_new,
+                        &[sink.into(), level.into()],
+                        "gzip_stream_new_result",
+                        "gzip_stream_new returned void",
+                    );
+                }
+                "gzip_stream_write" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.gzip_stream_write,
+                        args,
+                        2,
+                        "gzip_stream_write",
+                        "gzip_stream_write returned void",
+                    );
+                }
+                "gzip_stream_flush" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.gzip_stream_flush,
+                        args,
+                        1,
+                        "gzip_stream_flush",
+                        "gzip_stream_flush returned void",
+                    );
+                }
+                "gzip_stream_close" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.gzip_stream_close,
+                        args,
+                        1,
+                        "gzip_stream_close",
+                        "gzip_stream_close returned void",
+                    );
+                }
                 "template_render" => {
                     // template_render(template, ctx) - render template with context (placeholder)
                     if args.len() != 2 {
@@ -17411,9 +21678,22 @@ impl<'ctx> CodeGen<'ctx> {
                 | "screen_clear"
                 | "draw_pixel"
                 | "draw_rect"
+                | "draw_rects"
+                | "draw_points"
                 | "draw_circle"
+                | "draw_circles"
                 | "draw_line"
                 | "draw_text"
+                | "font_load"
+                | "font_draw"
+                | "texture_load"
+                | "texture_ready"
+                | "texture_draw"
+                | "mesh_load"
+                | "mesh_cube"
+                | "camera_3d"
+                | "draw_mesh_instanced"
+                | "draw_mesh_at"
                 | "screen_update"
                 | "get_mouse_x"
                 | "get_mouse_y"
@@ -20026,8 +24306,23 @@ impl<'ctx> CodeGen<'ctx> {
                     return Ok(self.make_nil());
                 }
                 "memoize" | "cache" => {
-                    // Memoization (placeholder: return nil)
-                    return Ok(self.make_nil());
+                    // memoize(fn) keeps every result, like `memoize(fn, naething)`
+                    if args.len() == 1 {
+                        let func = self.compile_expr(&args[0])?;
+                        return self.build_call_basic_value(
+                            self.libc.memoize,
+                            &[func.into(), self.make_nil().into()],
+                            "memoize",
+                            "memoize returned void",
+                        );
+                    }
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.memoize,
+                        args,
+                        2,
+                        "memoize",
+                        "memoize returned void",
+                    );
                 }
                 "identity" | "id" => {
                     // Identity function - return argument as-is
@@ -20052,6 +24347,15 @@ impl<'ctx> CodeGen<'ctx> {
                     // Debouncing (placeholder: return nil)
                     return Ok(self.make_nil());
                 }
+                "dict_with_capacity" => {
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.dict_sized,
+                        args,
+                        1,
+                        "dict_with_capacity",
+                        "dict_with_capacity returned void",
+                    );
+                }
                 "fae_pairs" | "from_pairs" | "dict_from_pairs" => {
                     if args.len() != 1 {
                         return Err(HaversError::CompileError(
@@ -20125,7 +24429,7 @@ impl<'ctx> CodeGen<'ctx> {
                     let buf_size = self.types.i64_type.const_int(2, false);
                     let buf = self
                         .builder
-                        .build_call(self.libc.malloc, &[buf_size.into()], "char_buf")
+                        .build_call(self.libc.malloc_atomic, &[buf_size.into()], "char_buf")
                         .unwrap()
                         .try_as_basic_value()
                         .left()
@@ -20158,7 +24462,18 @@ impl<'ctx> CodeGen<'ctx> {
                     }
                     let str_arg = self.compile_expr(&args[0])?;
                     let delim = self.compile_string_literal("\n").unwrap();
-                    return self.inline_split(str_arg, delim);
+                    let result = self
+                        .builder
+                        .build_call(
+                            self.libc.split,
+                            &[str_arg.into(), delim.into()],
+                            "split_lines_result",
+                        )
+                        .unwrap()
+                        .try_as_basic_value()
+                        .left()
+                        .compile_ok_or("split returned void").unwrap();
+                    return Ok(result);
                 }
                 "split_words" => {
                     // split_words(str) - split string into words
@@ -20204,8 +24519,13 @@ impl<'ctx> CodeGen<'ctx> {
                     return self.compile_string_literal("");
                 }
                 "hash_sha256" | "sha256" => {
-                    // SHA256 hash (placeholder: return empty string)
-                    return self.compile_string_literal("");
+                    return self.compile_runtime_call_value_with_arity(
+                        self.libc.sha256,
+                        args,
+                        1,
+                        "sha256",
+                        "sha256 returned void",
+                    );
                 }
                 "center" | "centre" | "center_text" | "pad_center" => {
                     // center(str, width) - center string
@@ -20557,11 +24877,23 @@ impl<'ctx> CodeGen<'ctx> {
                     return Ok(self.make_nil());
                 }
                 "update" | "dict_update" => {
-                    // update(dict1, dict2) - merge dicts (placeholder: return first)
-                    if !args.is_empty() {
-                        return self.compile_expr(&args[0]);
+                    // update(dict, other) - copy other's entries into dict; the block may move,
+                    // so a dict held in a variable is stored back
+                    let result = self.compile_runtime_call_value_with_arity(
+                        self.libc.dict_update,
+                        args,
+                        2,
+                        "dict_update",
+                        "dict_update returned void",
+                    )?;
+                    if let Expr::Variable { name, .. } = &args[0] {
+                        if let Some(&ptr) = self.variables.get(name) {
+                            self.builder.build_store(ptr, result).unwrap();
+                        } else if let Some(&ptr) = self.globals.get(name) {
+                            self.builder.build_store(ptr, result).unwrap();
+                        }
                     }
-                    return Ok(self.make_nil());
+                    return Ok(result);
                 }
                 "setdefault" | "get_or_set" => {
                     // setdefault(dict, key, default) - get or set default (placeholder: return nil)
@@ -21198,10 +25530,13 @@ impl<'ctx> CodeGen<'ctx> {
 
             // Check if it's a variable containing a function value (lambda)
             if let Some(&var_ptr) = self.variables.get(name) {
-                let func_val = self
+                let mut func_val = self
                     .builder
                     .build_load(self.types.value_type, var_ptr, "func_val")
                     .unwrap();
+                if self.boxed_vars.contains(name) {
+                    func_val = self.box_get(func_val)?;
+                }
 
                 // Compile arguments
                 let mut compiled_args: Vec<BasicValueEnum<'ctx>> = Vec::new();
@@ -21209,6 +25544,9 @@ impl<'ctx> CodeGen<'ctx> {
                     compiled_args.push(self.compile_expr(arg)?);
                 }
 
+                if let Some(&lambda) = self.known_lambdas.get(&var_ptr) {
+                    return self.call_known_lambda(func_val, lambda, &compiled_args);
+                }
                 return self.call_function_value(func_val, &compiled_args);
             }
         }
@@ -21355,6 +25693,27 @@ impl<'ctx> CodeGen<'ctx> {
         {
             return self.compile_for_range(variable, start, end, *inclusive, body);
         }
+        // The builtin range(a, b) is a counted loop too; no list is built for it.
+        if let Expr::Call {
+            callee, arguments, ..
+        } = iterable
+        {
+            if let Expr::Variable { name, .. } = callee.as_ref() {
+                if name == "range"
+                    && arguments.len() == 2
+                    && !self.classes.contains_key(name)
+                    && !self.functions.contains_key(name)
+                {
+                    return self.compile_for_range(
+                        variable,
+                        &arguments[0],
+                        &arguments[1],
+                        false,
+                        body,
+                    );
+                }
+            }
+        }
         // For-each loop over list or string (runtime check)
         self.compile_for_iterable(variable, iterable, body)
     }
@@ -21367,8 +25726,12 @@ impl<'ctx> CodeGen<'ctx> {
     ) -> Result<(), HaversError> {
         let function = self.current_function.unwrap();
 
-        // Compile the iterable and check its type
-        let iter_val = self.compile_expr(iterable)?;
+        // Compile the iterable and check its type; nothing can reach a literal's list but
+        // the loop, so it goes on the stack
+        let iter_val = match Self::scratch_list_elements(iterable) {
+            Some(elements) => self.compile_scratch_list(elements)?,
+            None => self.compile_expr(iterable)?,
+        };
         let iter_tag = self.extract_tag(iter_val).unwrap();
         let iter_data = self.extract_data(iter_val).unwrap();
 
@@ -21380,20 +25743,63 @@ impl<'ctx> CodeGen<'ctx> {
             .unwrap();
 
         let for_string_block = self.context.append_basic_block(function, "for_string");
+        let for_check_native = self
+            .context
+            .append_basic_block(function, "for_check_native");
+        let for_native_block = self.context.append_basic_block(function, "for_native");
         let for_list_block = self.context.append_basic_block(function, "for_list");
         let after_block = self.context.append_basic_block(function, "for_after");
 
         self.builder
-            .build_conditional_branch(is_string, for_string_block, for_list_block)
+            .build_conditional_branch(is_string, for_string_block, for_check_native)
             .unwrap();
 
         // String iteration
         self.builder.position_at_end(for_string_block);
         self.compile_for_string_impl(variable, iter_data, body, after_block)?;
 
+        // Native collections (deques, heaps, typed arrays) are walked as a list snapshot
+        self.builder.position_at_end(for_check_native);
+        let native_tag = self
+            .types
+            .i8_type
+            .const_int(ValueTag::NativeObject.as_u8() as u64, false);
+        let is_native = self
+            .builder
+            .build_int_compare(IntPredicate::EQ, iter_tag, native_tag, "is_native")
+            .unwrap();
+        self.builder
+            .build_conditional_branch(is_native, for_native_block, for_list_block)
+            .unwrap();
+        self.builder.position_at_end(for_native_block);
+        let snapshot = self
+            .builder
+            .build_call(
+                self.libc.native_iter_list,
+                &[iter_val.into()],
+                "for_snapshot",
+            )
+            .unwrap()
+            .try_as_basic_value()
+            .left()
+            .unwrap();
+        let snapshot_data = self.extract_data(snapshot).unwrap();
+        self.builder
+            .build_unconditional_branch(for_list_block)
+            .unwrap();
+
         // List iteration
         self.builder.position_at_end(for_list_block);
-        self.compile_for_list_impl(variable, iter_data, body, after_block)?;
+        let list_data = self
+            .builder
+            .build_phi(self.types.i64_type, "for_list_data")
+            .unwrap();
+        list_data.add_incoming(&[
+            (&iter_data, for_check_native),
+            (&snapshot_data, for_native_block),
+        ]);
+        let list_data = list_data.as_basic_value().into_int_value();
+        self.compile_for_list_impl(variable, list_data, body, after_block)?;
 
         // After loop
         self.builder.position_at_end(after_block);
@@ -21416,10 +25822,11 @@ impl<'ctx> CodeGen<'ctx> {
             .build_int_to_ptr(str_data, i8_ptr_type, "str_ptr")
             .unwrap();
 
-        // Get string length via strlen
+        // Loop over characters, not bytes
+        let str_val = self.make_string(str_ptr).unwrap();
         let str_len = self
             .builder
-            .build_call(self.libc.strlen, &[str_ptr.into()], "str_len")
+            .build_call(self.libc.str_char_count, &[str_val.into()], "str_len")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -21464,46 +25871,9 @@ impl<'ctx> CodeGen<'ctx> {
             .build_conditional_branch(cmp, body_block, after_block)
             .unwrap();
 
-        // Body: extract character at idx and create single-char string
+        // Body: fetch the character at idx (ASCII ones come back without allocating)
         self.builder.position_at_end(body_block);
-        let char_ptr = unsafe {
-            self.builder
-                .build_gep(self.context.i8_type(), str_ptr, &[idx], "char_ptr")
-                .unwrap()
-        };
-        let char_val = self
-            .builder
-            .build_load(self.context.i8_type(), char_ptr, "char_val")
-            .unwrap()
-            .into_int_value();
-
-        // Create single-char null-terminated string
-        let two = self.types.i64_type.const_int(2, false);
-        let char_str_ptr = self
-            .builder
-            .build_call(self.libc.malloc, &[two.into()], "char_str")
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .unwrap()
-            .into_pointer_value();
-        self.builder.build_store(char_str_ptr, char_val).unwrap();
-        let null_pos = unsafe {
-            self.builder
-                .build_gep(
-                    self.context.i8_type(),
-                    char_str_ptr,
-                    &[self.types.i64_type.const_int(1, false)],
-                    "null_pos",
-                )
-                .unwrap()
-        };
-        self.builder
-            .build_store(null_pos, self.context.i8_type().const_int(0, false))
-            .unwrap();
-
-        // Create MdhValue for the char string
-        let char_str_val = self.make_string(char_str_ptr).unwrap();
+        let char_str_val = self.compile_string_index(str_val, idx)?;
         self.builder.build_store(var_alloca, char_str_val).unwrap();
 
         // Compile body
@@ -21680,11 +26050,18 @@ impl<'ctx> CodeGen<'ctx> {
         let start_data = self.coerce_i64(start_val, "range")?;
         let end_data = self.coerce_i64(end_val, "range")?;
 
-        // Create loop variable
+        // Create loop variable. It is always an int here; it stays typed as one unless
+        // the body assigns it something else.
         let var_alloca = self.create_entry_block_alloca(variable);
         let start_mdh = self.make_int(start_data).unwrap();
         self.builder.build_store(var_alloca, start_mdh).unwrap();
         self.variables.insert(variable.to_string(), var_alloca);
+        self.int_shadows.remove(variable);
+        let var_type = match self.numeric_locals.get(variable) {
+            Some(VarType::Int) => VarType::Int,
+            _ => VarType::Unknown,
+        };
+        self.var_types.insert(variable.to_string(), var_type);
 
         // Create counter
         let counter_alloca = self
@@ -21695,6 +26072,13 @@ impl<'ctx> CodeGen<'ctx> {
             .build_store(counter_alloca, start_data)
             .unwrap();
 
+        // A list the body indexes in bounds gets its items loaded here, once
+        let indexed = self.indexed_list(variable, start, end, inclusive, body, counter_alloca)?;
+        let saved_indexed = match indexed {
+            Some(indexed) => Some(self.indexed_loops.insert(variable.to_string(), indexed)),
+            None => None,
+        };
+
         let loop_block = self.context.append_basic_block(function, "for_loop");
         let body_block = self.context.append_basic_block(function, "for_body");
         let incr_block = self.context.append_basic_block(function, "for_incr");
@@ -21760,10 +26144,116 @@ impl<'ctx> CodeGen<'ctx> {
         self.builder.build_unconditional_branch(loop_block).unwrap();
 
         self.loop_stack.pop();
+        match saved_indexed {
+            Some(Some(outer)) => {
+                self.indexed_loops.insert(variable.to_string(), outer);
+            }
+            Some(None) => {
+                self.indexed_loops.remove(variable);
+            }
+            None => {}
+        }
         self.builder.position_at_end(after_block);
         Ok(())
     }
 
+    /// The list `fer variable in start..end` indexes in bounds, with its items loaded at
+    /// the current point (the loop preheader).
+    fn indexed_list(
+        &mut self,
+        variable: &str,
+        start: &Expr,
+        end: &Expr,
+        inclusive: bool,
+        body: &Stmt,
+        counter: PointerValue<'ctx>,
+    ) -> Result<Option<IndexedList<'ctx>>, HaversError> {
+        let user_function =
+            |name: &str| self.functions.contains_key(name) || self.classes.contains_key(name);
+        let Some(found) =
+            super::bounds::indexed_loop(variable, start, end, inclusive, body, &user_function)
+        else {
+            return Ok(None);
+        };
+        let list = found.list.to_string();
+        let writes = found.writes;
+        let list_expr = Expr::Variable {
+            name: list.clone(),
+            slot: None,
+            span: start.span(),
+        };
+        if self.infer_expr_type(&list_expr) != VarType::List {
+            return Ok(None);
+        }
+
+        let list_data = match self.list_ptr_shadows.get(&list) {
+            Some(&shadow) => self
+                .builder
+                .build_load(self.types.i64_type, shadow, "list_ptr_shadow_hoist")
+                .unwrap()
+                .into_int_value(),
+            None => {
+                let list_val = self.compile_expr(&list_expr)?;
+                self.extract_data(list_val).unwrap()
+            }
+        };
+        let i64_ptr_type = self.types.i64_type.ptr_type(AddressSpace::default());
+        let list_ptr = self
+            .builder
+            .build_int_to_ptr(list_data, i64_ptr_type, "list_ptr_hoist")
+            .unwrap();
+        // Writes need the list's own items; unsharing them here covers the whole loop
+        let items_as_i64 = if writes {
+            self.list_items_for_write(list_ptr)?
+        } else {
+            self.builder
+                .build_load(self.types.i64_type, list_ptr, "items_ptr_i64_hoist")
+                .unwrap()
+                .into_int_value()
+        };
+        let value_ptr_type = self.types.value_type.ptr_type(AddressSpace::default());
+        let items = self
+            .builder
+            .build_int_to_ptr(items_as_i64, value_ptr_type, "items_ptr_hoist")
+            .unwrap();
+        Ok(Some(IndexedList {
+            list,
+            items,
+            counter,
+        }))
+    }
+
+    /// The element `object[index]` addresses when a loop in progress has proven the index
+    /// in bounds for the list.
+    fn indexed_element(&self, object: &Expr, index: &Expr) -> Option<PointerValue<'ctx>> {
+        let (Expr::Variable { name: list, .. }, Expr::Variable { name: variable, .. }) =
+            (object, index)
+        else {
+            return None;
+        };
+        let indexed = self.indexed_loops.get(variable)?;
+        if &indexed.list != list {
+            return None;
+        }
+        let index = self
+            .builder
+            .build_load(self.types.i64_type, indexed.counter, "indexed_idx")
+            .unwrap()
+            .into_int_value();
+        // SAFETY: the loop keeps the counter within the list's unchanged length
+        let elem_ptr = unsafe {
+            self.builder
+                .build_in_bounds_gep(
+                    self.types.value_type,
+                    indexed.items,
+                    &[index],
+                    "indexed_elem_ptr",
+                )
+                .unwrap()
+        };
+        Some(elem_ptr)
+    }
+
     fn compile_function(
         &mut self,
         name: &str,
@@ -21775,7 +26265,27 @@ impl<'ctx> CodeGen<'ctx> {
             .get(name)
             .copied()
             .expect("Function not declared");
+        self.compile_function_into(function, name, params, body, None)
+    }
 
+    /// Compile clone `index` of `specializations`.
+    fn compile_specialization(&mut self, index: usize) -> Result<(), HaversError> {
+        let spec = &self.specializations[index];
+        let (function, name) = (spec.function, spec.name.clone());
+        let (_, params, body) = self.specializable[&name].clone();
+        self.compile_function_into(function, &name, &params, &body, Some(index))
+    }
+
+    /// Compile a user function's body into `function`: the function itself, or clone
+    /// `specialization` of it, whose numeric parameters and return are unboxed.
+    fn compile_function_into(
+        &mut self,
+        function: FunctionValue<'ctx>,
+        name: &str,
+        params: &[crate::ast::Param],
+        body: &[Stmt],
+        specialization: Option<usize>,
+    ) -> Result<(), HaversError> {
         let entry = self.context.append_basic_block(function, "entry");
 
         let saved_function = self.current_function;
@@ -21787,6 +26297,20 @@ impl<'ctx> CodeGen<'ctx> {
         let saved_string_len_shadows = std::mem::take(&mut self.string_len_shadows);
         let saved_string_cap_shadows = std::mem::take(&mut self.string_cap_shadows);
         let saved_boxed_vars = std::mem::take(&mut self.boxed_vars);
+        let param_names: Vec<String> = params.iter().map(|p| p.name.clone()).collect();
+        let (locals, param_types, returns) = match specialization {
+            Some(index) => {
+                let spec = &self.specializations[index];
+                (spec.locals.clone(), spec.params.clone(), spec.returns)
+            }
+            None => (
+                super::infer::numeric_locals(&param_names, body),
+                vec![VarType::Unknown; params.len()],
+                VarType::Unknown,
+            ),
+        };
+        let saved_numeric_locals = std::mem::replace(&mut self.numeric_locals, locals);
+        let saved_return_type = std::mem::replace(&mut self.return_type, returns);
         let saved_masel = self.current_masel;
         let saved_in_user_function = self.in_user_function;
 
@@ -21823,14 +26347,24 @@ impl<'ctx> CodeGen<'ctx> {
         }
 
         // Set up user parameters (after captures). Don't create shadows until we know boxing.
-        for (i, param) in params.iter().enumerate() {
+        // A clone's unboxed parameters are boxed once here, and typed if they stay numbers.
+        for (i, (param, &param_type)) in params.iter().zip(&param_types).enumerate() {
             let param_val = function
                 .get_nth_param((capture_count + i) as u32)
                 .compile_ok_or("Missing parameter")?;
+            let param_val = match param_type {
+                VarType::Int => self.make_int(param_val.into_int_value())?,
+                VarType::Float => self.make_float(param_val.into_float_value())?,
+                _ => param_val,
+            };
             let alloca = self.create_entry_block_alloca(&param.name);
             self.builder.build_store(alloca, param_val).unwrap();
             self.variables.insert(param.name.clone(), alloca);
-            self.var_types.insert(param.name.clone(), VarType::Unknown);
+            let var_type = match self.numeric_locals.get(&param.name) {
+                Some(&proven) if proven == param_type => proven,
+                _ => VarType::Unknown,
+            };
+            self.var_types.insert(param.name.clone(), var_type);
         }
 
         // Predeclare locals so nested-function capture discovery can see them.
@@ -21872,26 +26406,6 @@ impl<'ctx> CodeGen<'ctx> {
         // Mark all captured locals/params as boxed in this scope (locals will be boxed at decl).
         self.boxed_vars.extend(captured_in_body);
 
-        // Create optimistic i64 shadows for non-boxed user parameters.
-        for param in params {
-            if self.boxed_vars.contains(&param.name) {
-                continue;
-            }
-            let shadow = self.create_entry_block_alloca_i64(&format!("{}_shadow", param.name));
-            let alloca = self.variables.get(&param.name).copied().unwrap();
-            let val = self
-                .builder
-                .build_load(
-                    self.types.value_type,
-                    alloca,
-                    &format!("{}_param", param.name),
-                )
-                .unwrap();
-            let data = self.extract_data(val).unwrap();
-            self.builder.build_store(shadow, data).unwrap();
-            self.int_shadows.insert(param.name.clone(), shadow);
-        }
-
         // Compile body
         for stmt in body {
             self.compile_stmt(stmt)?;
@@ -21906,7 +26420,7 @@ impl<'ctx> CodeGen<'ctx> {
             }
         }
 
-        // Add implicit return if needed
+        // Add implicit return if needed (a clone returning a number ends in a `gie`)
         if self
             .builder
             .get_insert_block()
@@ -21914,7 +26428,11 @@ impl<'ctx> CodeGen<'ctx> {
             .get_terminator()
             .is_none()
         {
-            self.builder.build_return(Some(&self.make_nil())).unwrap();
+            if self.return_type == VarType::Unknown {
+                self.builder.build_return(Some(&self.make_nil())).unwrap();
+            } else {
+                self.builder.build_unreachable().unwrap();
+            }
         }
 
         // Restore state - all shadow maps to prevent cross-function leakage
@@ -21926,6 +26444,8 @@ impl<'ctx> CodeGen<'ctx> {
         self.string_len_shadows = saved_string_len_shadows;
         self.string_cap_shadows = saved_string_cap_shadows;
         self.boxed_vars = saved_boxed_vars;
+        self.numeric_locals = saved_numeric_locals;
+        self.return_type = saved_return_type;
         self.in_user_function = saved_in_user_function;
         self.current_masel = saved_masel;
 
@@ -22092,6 +26612,37 @@ impl<'ctx> CodeGen<'ctx> {
         builder.build_alloca(self.types.i64_type, name).unwrap()
     }
 
+    /// Two consecutive i64 slots in the entry block (used for string capacity shadows).
+    fn create_entry_block_alloca_i64_pair(&self, name: &str) -> PointerValue<'ctx> {
+        let function = self.current_function.unwrap();
+        let entry = function.get_first_basic_block().unwrap();
+
+        let builder = self.context.create_builder();
+        match entry.get_first_instruction() {
+            Some(instr) => builder.position_before(&instr),
+            None => builder.position_at_end(entry),
+        }
+
+        let two = self.types.i64_type.const_int(2, false);
+        builder
+            .build_array_alloca(self.types.i64_type, two, name)
+            .unwrap()
+    }
+
+    /// Second slot of a string capacity shadow: the address of the buffer the capacity is for.
+    fn string_cap_owner_slot(&self, cap_shadow: PointerValue<'ctx>) -> PointerValue<'ctx> {
+        unsafe {
+            self.builder
+                .build_gep(
+                    self.types.i64_type,
+                    cap_shadow,
+                    &[self.types.i64_type.const_int(1, false)],
+                    "strcap_owner",
+                )
+                .unwrap()
+        }
+    }
+
     /// Compile a list expression: allocate MdhList struct and store elements
     /// Must match runtime layout: struct MdhList { MdhValue *items; int64_t length; int64_t capacity; }
     fn compile_list(&mut self, elements: &[Expr]) -> Result<BasicValueEnum<'ctx>, HaversError> {
@@ -22223,6 +26774,79 @@ impl<'ctx> CodeGen<'ctx> {
         self.make_list(list_ptr)
     }
 
+    /// The elements of a list literal that can live on the stack: it has elements and no
+    /// spreads. Callers only ask for literals in places the list cannot escape from.
+    fn scratch_list_elements(expr: &Expr) -> Option<&[Expr]> {
+        match expr {
+            Expr::List { elements, .. }
+                if !elements.is_empty()
+                    && !elements.iter().any(|e| matches!(e, Expr::Spread { .. })) =>
+            {
+                Some(elements)
+            }
+            _ => None,
+        }
+    }
+
+    /// Compile a list literal that never escapes the statement using it (a `fer` iterable,
+    /// or the value of a destructure without a rest pattern) into entry-block stack slots
+    /// instead of the GC heap. The collector scans the stack, so the elements stay alive.
+    fn compile_scratch_list(
+        &mut self,
+        elements: &[Expr],
+    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
+        let function = self.current_function.unwrap();
+        let entry = function.get_first_basic_block().unwrap();
+        let entry_builder = self.context.create_builder();
+        match entry.get_first_instruction() {
+            Some(instr) => entry_builder.position_before(&instr),
+            None => entry_builder.position_at_end(entry),
+        }
+        let len = self.types.i64_type.const_int(elements.len() as u64, false);
+        let items_ptr = entry_builder
+            .build_array_alloca(self.types.value_type, len, "scratch_items")
+            .unwrap();
+        let three = self.types.i64_type.const_int(3, false);
+        let list_ptr = entry_builder
+            .build_array_alloca(self.types.i64_type, three, "scratch_list")
+            .unwrap();
+
+        for (i, elem) in elements.iter().enumerate() {
+            let compiled = self.compile_expr(elem)?;
+            let elem_ptr = unsafe {
+                self.builder
+                    .build_gep(
+                        self.types.value_type,
+                        items_ptr,
+                        &[self.types.i64_type.const_int(i as u64, false)],
+                        &format!("scratch_elem_{}", i),
+                    )
+                    .unwrap()
+            };
+            self.builder.build_store(elem_ptr, compiled).unwrap();
+        }
+
+        // MdhList { items, length, capacity }, full to capacity
+        let items_int = self
+            .builder
+            .build_ptr_to_int(items_ptr, self.types.i64_type, "scratch_items_int")
+            .unwrap();
+        for (i, field) in [items_int, len, len].into_iter().enumerate() {
+            let field_ptr = unsafe {
+                self.builder
+                    .build_gep(
+                        self.types.i64_type,
+                        list_ptr,
+                        &[self.types.i64_type.const_int(i as u64, false)],
+                        "scratch_field",
+                    )
+                    .unwrap()
+            };
+            self.builder.build_store(field_ptr, field).unwrap();
+        }
+        self.make_list(list_ptr)
+    }
+
     /// Compile a list literal that contains spread expressions
     /// Uses runtime index tracking to handle dynamic element counts
     /// Layout: struct MdhList { MdhValue* items, i64 length, i64 capacity } = 24 bytes
@@ -22522,7 +27146,7 @@ impl<'ctx> CodeGen<'ctx> {
                     let two = self.types.i64_type.const_int(2, false);
                     let char_str_ptr = self
                         .builder
-                        .build_call(self.libc.malloc, &[two.into()], "char_str")
+                        .build_call(self.libc.malloc_atomic, &[two.into()], "char_str")
                         .unwrap()
                         .try_as_basic_value()
                         .left()
@@ -22614,7 +27238,7 @@ impl<'ctx> CodeGen<'ctx> {
     }
 
     /// Compile a dict literal expression: {key1: value1, key2: value2, ...}
-    /// Dict memory layout: [i64 count][entry0][entry1]... where entry = [{i8,i64} key][{i8,i64} val]
+    /// Dict memory layout: [i64 count][entry0][entry1]...[tail] where entry = [{i8,i64} key][{i8,i64} val]
     fn compile_dict(
         &mut self,
         pairs: &[(Expr, Expr)],
@@ -22631,9 +27255,10 @@ impl<'ctx> CodeGen<'ctx> {
         }
 
         // Calculate memory size: 8 bytes for count + count * 32 bytes for entries (16 bytes key + 16 bytes value)
-        let entry_size = 32u64; // 16 bytes for key + 16 bytes for value
-        let header_size = 8u64; // sizeof(i64) for count
-        let total_size = header_size + (count as u64) * entry_size;
+        // + 16 bytes for the runtime-owned tail slot (hash index)
+        let entry_size = DICT_ENTRY_SIZE;
+        let header_size = DICT_HEADER_SIZE;
+        let total_size = header_size + (count as u64) * entry_size + DICT_TAIL_SIZE;
 
         // Allocate memory
         let size_val = self.types.i64_type.const_int(total_size, false);
@@ -22735,6 +27360,35 @@ impl<'ctx> CodeGen<'ctx> {
                 .unwrap();
         }
 
+        // Clear the tail slot so the runtime sees "no index yet"
+        let tail_offset = self
+            .types
+            .i64_type
+            .const_int((count as u64) * entry_size, false);
+        let tail_ptr = unsafe {
+            self.builder
+                .build_gep(
+                    self.context.i8_type(),
+                    self.builder
+                        .build_pointer_cast(entries_base, i8_ptr_type, "entries_i8")
+                        .unwrap(),
+                    &[tail_offset],
+                    "dict_tail",
+                )
+                .unwrap()
+        };
+        let tail_typed_ptr = self
+            .builder
+            .build_pointer_cast(
+                tail_ptr,
+                self.types.value_type.ptr_type(AddressSpace::default()),
+                "dict_tail_ptr",
+            )
+            .unwrap();
+        self.builder
+            .build_store(tail_typed_ptr, self.make_nil())
+            .unwrap();
+
         // Return the dict as a tagged value
         self.make_dict(raw_ptr)
     }
@@ -22750,6 +27404,13 @@ impl<'ctx> CodeGen<'ctx> {
         let obj_type = self.infer_expr_type(object);
         let idx_type = self.infer_expr_type(index);
 
+        if let Some(elem_ptr) = self.indexed_element(object, index) {
+            return Ok(self
+                .builder
+                .build_load(self.types.value_type, elem_ptr, "indexed_elem")
+                .unwrap());
+        }
+
         if obj_type == VarType::List && idx_type == VarType::Int {
             // Fast path - compile_list_index_fast handles shadow lookup internally
             return self.compile_list_index_fast(object, index);
@@ -22770,6 +27431,8 @@ impl<'ctx> CodeGen<'ctx> {
         let dict_block = self.context.append_basic_block(function, "index_dict");
         let check_string_block = self.context.append_basic_block(function, "check_string");
         let string_block = self.context.append_basic_block(function, "index_string");
+        let check_native_block = self.context.append_basic_block(function, "check_native");
+        let native_block = self.context.append_basic_block(function, "index_native");
         let type_error_block = self
             .context
             .append_basic_block(function, "index_type_error");
@@ -22832,668 +27495,97 @@ impl<'ctx> CodeGen<'ctx> {
             .build_int_compare(IntPredicate::EQ, obj_tag, string_tag, "is_string")
             .unwrap();
         self.builder
-            .build_conditional_branch(is_string, string_block, type_error_block)
+            .build_conditional_branch(is_string, string_block, check_native_block)
             .unwrap();
 
         // String indexing (return character as string) - use index as integer
         self.builder.position_at_end(string_block);
         let idx_data_str = self.extract_data(idx_val).unwrap();
-        let string_result = self.compile_string_index(obj_data, idx_data_str)?;
+        let string_result = self.compile_string_index(obj_val, idx_data_str)?;
         let string_bb = self.builder.get_insert_block().unwrap();
         self.builder
             .build_unconditional_branch(merge_block)
             .unwrap();
 
-        // Type error for unsupported indexing
-        self.builder.position_at_end(type_error_block);
-        let op = self
-            .builder
-            .build_global_string_ptr("index", "index_op")
-            .unwrap();
-        self.builder
-            .build_call(
-                self.libc.type_error,
-                &[op.as_pointer_value().into(), obj_tag.into(), idx_tag.into()],
-                "",
-            )
-            .unwrap();
-        let err_result = self.make_nil();
-        let err_bb = self.builder.get_insert_block().unwrap();
-        self.builder
-            .build_unconditional_branch(merge_block)
-            .unwrap();
-
-        // Merge
-        self.builder.position_at_end(merge_block);
-        let phi = self
-            .builder
-            .build_phi(self.types.value_type, "index_result")
-            .unwrap();
-        phi.add_incoming(&[
-            (&list_result, list_bb),
-            (&dict_result, dict_bb),
-            (&string_result, string_bb),
-            (&err_result, err_bb),
-        ]);
-
-        Ok(phi.as_basic_value())
-    }
-
-    /// Helper for list indexing
-    /// MdhList struct layout: { MdhValue *items; int64_t length; int64_t capacity; }
-    fn compile_list_index(
-        &self,
-        list_data: IntValue<'ctx>,
-        index: IntValue<'ctx>,
-    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
-        // Convert data to pointer to MdhList struct
-        let i64_ptr_type = self.types.i64_type.ptr_type(AddressSpace::default());
-        let list_ptr = self
-            .builder
-            .build_int_to_ptr(list_data, i64_ptr_type, "list_ptr")
-            .unwrap();
-
-        // Load items pointer from offset 0
-        let items_ptr_as_i64 = self
-            .builder
-            .build_load(self.types.i64_type, list_ptr, "items_ptr_i64")
-            .unwrap()
-            .into_int_value();
-
-        // Get length pointer (at offset 1)
-        let len_ptr = unsafe {
-            self.builder
-                .build_gep(
-                    self.types.i64_type,
-                    list_ptr,
-                    &[self.types.i64_type.const_int(1, false)],
-                    "len_ptr",
-                )
-                .unwrap()
-        };
-
-        // Load length
-        let length = self
-            .builder
-            .build_load(self.types.i64_type, len_ptr, "list_len")
-            .unwrap()
-            .into_int_value();
-
-        // Handle negative indices: if index < 0, index = length + index
-        let zero = self.types.i64_type.const_int(0, false);
-        let is_negative = self
-            .builder
-            .build_int_compare(inkwell::IntPredicate::SLT, index, zero, "is_negative")
-            .unwrap();
-
-        let adjusted_index = self
-            .builder
-            .build_int_add(length, index, "adjusted")
-            .unwrap();
-
-        let final_index = self
-            .builder
-            .build_select(is_negative, adjusted_index, index, "final_index")
-            .unwrap()
-            .into_int_value();
-
-        // Convert items pointer to MdhValue pointer
-        let value_ptr_type = self.types.value_type.ptr_type(AddressSpace::default());
-        let items_ptr = self
-            .builder
-            .build_int_to_ptr(items_ptr_as_i64, value_ptr_type, "items_ptr")
-            .unwrap();
-
-        // Get pointer to the indexed element
-        let elem_ptr = unsafe {
-            self.builder
-                .build_gep(self.types.value_type, items_ptr, &[final_index], "elem_ptr")
-                .unwrap()
-        };
-
-        // Load and return the element
-        let result = self
-            .builder
-            .build_load(self.types.value_type, elem_ptr, "elem_val")
-            .unwrap();
-
-        Ok(result)
-    }
-
-    /// Fast path for list indexing when types are known at compile time
-    /// Skips type checking, negative index handling, and uses direct pointer arithmetic
-    /// MdhList struct layout: { MdhValue *items; int64_t length; int64_t capacity; }
-    fn compile_list_index_fast(
-        &mut self,
-        object: &Expr,
-        index: &Expr,
-    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
-        // Try to get list data from shadow (fastest path - avoids loading full MdhValue)
-        let list_data = if let Expr::Variable { name, .. } = object {
-            if let Some(&shadow) = self.list_ptr_shadows.get(name) {
-                // Load raw pointer from shadow
-                self.builder
-                    .build_load(self.types.i64_type, shadow, "list_ptr_shadow_rd")
-                    .unwrap()
-                    .into_int_value()
-            } else {
-                let obj_val = self.compile_expr(object)?;
-                self.extract_data(obj_val).unwrap()
-            }
-        } else {
-            let obj_val = self.compile_expr(object)?;
-            self.extract_data(obj_val).unwrap()
-        };
-
-        // Get index as i64 directly (use shadow if available)
-        let idx_i64 = if let Some(i) = self.compile_int_expr(index) {
-            i
-        } else {
-            let idx_val = self.compile_expr(index)?;
-            self.extract_data(idx_val).unwrap()
-        };
-
-        // Convert data to pointer to MdhList struct
-        let i64_ptr_type = self.types.i64_type.ptr_type(AddressSpace::default());
-        let list_ptr = self
-            .builder
-            .build_int_to_ptr(list_data, i64_ptr_type, "list_ptr_fast")
-            .unwrap();
-
-        // Load items pointer from offset 0
-        let items_ptr_as_i64 = self
-            .builder
-            .build_load(self.types.i64_type, list_ptr, "items_ptr_i64_fast")
-            .unwrap()
-            .into_int_value();
-
-        // Get length pointer (at offset 1) for negative index handling
-        let len_ptr = unsafe {
-            self.builder
-                .build_gep(
-                    self.types.i64_type,
-                    list_ptr,
-                    &[self.types.i64_type.const_int(1, false)],
-                    "len_ptr_fast",
-                )
-                .unwrap()
-        };
-
-        let length = self
-            .builder
-            .build_load(self.types.i64_type, len_ptr, "list_len_fast")
-            .unwrap()
-            .into_int_value();
-
-        // Handle negative indices: if index < 0, index = length + index
-        let zero = self.types.i64_type.const_int(0, false);
-        let is_negative = self
-            .builder
-            .build_int_compare(
-                inkwell::IntPredicate::SLT,
-                idx_i64,
-                zero,
-                "is_negative_fast",
-            )
-            .unwrap();
-
-        let adjusted_index = self
-            .builder
-            .build_int_add(length, idx_i64, "adjusted_fast")
-            .unwrap();
-
-        let final_index = self
-            .builder
-            .build_select(is_negative, adjusted_index, idx_i64, "final_index_fast")
-            .unwrap()
-            .into_int_value();
-
-        // Convert items pointer to MdhValue pointer
-        let value_ptr_type = self.types.value_type.ptr_type(AddressSpace::default());
-        let items_ptr = self
-            .builder
-            .build_int_to_ptr(items_ptr_as_i64, value_ptr_type, "items_ptr_fast")
-            .unwrap();
-
-        // Get pointer to the indexed element
-        let elem_ptr = unsafe {
-            self.builder
-                .build_gep(
-                    self.types.value_type,
-                    items_ptr,
-                    &[final_index],
-                    "elem_ptr_fast",
-                )
-                .unwrap()
-        };
-
-        // Load and return the element
-        let result = self
-            .builder
-            .build_load(self.types.value_type, elem_ptr, "elem_val_fast")
-            .unwrap();
-
-        Ok(result)
-    }
-
-    /// Helper for dict indexing - searches for key and returns corresponding value
-    /// Dict layout: [i64 count][entry0][entry1]... where entry = [{i8,i64} key][{i8,i64} val]
-    fn compile_dict_index(
-        &mut self,
-        dict_data: IntValue<'ctx>,
-        key_val: BasicValueEnum<'ctx>,
-    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
-        let function = self.current_function.unwrap();
-
-        // Convert dict data to pointer
-        let i8_ptr_type = self.context.i8_type().ptr_type(AddressSpace::default());
-        let i64_ptr_type = self.types.i64_type.ptr_type(AddressSpace::default());
-        let dict_ptr = self
-            .builder
-            .build_int_to_ptr(dict_data, i8_ptr_type, "dict_ptr")
-            .unwrap();
-
-        // Get dict count
-        let count_ptr = self
-            .builder
-            .build_pointer_cast(dict_ptr, i64_ptr_type, "count_ptr")
-            .unwrap();
-        let dict_count = self
-            .builder
-            .build_load(self.types.i64_type, count_ptr, "dict_count")
-            .unwrap()
-            .into_int_value();
-
-        // Extract key tag and data for comparison
-        let key_tag = self.extract_tag(key_val).unwrap();
-        let key_data = self.extract_data(key_val).unwrap();
-
-        // Allocate result pointer and found flag
-        let result_ptr = self
-            .builder
-            .build_alloca(self.types.value_type, "result_ptr")
-            .unwrap();
-        self.builder
-            .build_store(result_ptr, self.make_nil())
-            .unwrap();
-
-        let found_ptr = self
-            .builder
-            .build_alloca(self.context.bool_type(), "dict_key_found")
-            .unwrap();
-        self.builder
-            .build_store(found_ptr, self.context.bool_type().const_int(0, false))
-            .unwrap();
-
-        // Loop through entries to find matching key
-        let zero = self.types.i64_type.const_int(0, false);
-        let one = self.types.i64_type.const_int(1, false);
-        let header_size = self.types.i64_type.const_int(8, false); // sizeof(i64) for count
-        let entry_size = self.types.i64_type.const_int(32, false);
-        let value_offset_in_entry = self.types.i64_type.const_int(16, false);
-
-        let idx_ptr = self
-            .builder
-            .build_alloca(self.types.i64_type, "idx")
-            .unwrap();
-        self.builder.build_store(idx_ptr, zero).unwrap();
-
-        let loop_block = self
-            .context
-            .append_basic_block(function, "dict_lookup_loop");
-        let body_block = self
-            .context
-            .append_basic_block(function, "dict_lookup_body");
-        let found_block = self.context.append_basic_block(function, "dict_found");
-        let continue_block = self.context.append_basic_block(function, "dict_continue");
-        let done_block = self
-            .context
-            .append_basic_block(function, "dict_lookup_done");
-
-        self.builder.build_unconditional_branch(loop_block).unwrap();
-        self.builder.position_at_end(loop_block);
-
-        let idx = self
-            .builder
-            .build_load(self.types.i64_type, idx_ptr, "idx_val")
-            .unwrap()
-            .into_int_value();
-        let done_cond = self
-            .builder
-            .build_int_compare(IntPredicate::UGE, idx, dict_count, "done")
-            .unwrap();
-        self.builder
-            .build_conditional_branch(done_cond, done_block, body_block)
-            .unwrap();
-
-        self.builder.position_at_end(body_block);
-
-        // Get entry key from dict
-        let dict_entry_offset = self
-            .builder
-            .build_int_add(
-                header_size,
-                self.builder
-                    .build_int_mul(idx, entry_size, "entry_mul")
-                    .unwrap(),
-                "entry_offset",
-            )
-            .unwrap();
-        let dict_key_ptr = unsafe {
-            self.builder
-                .build_gep(
-                    self.context.i8_type(),
-                    dict_ptr,
-                    &[dict_entry_offset],
-                    "dict_key_ptr",
-                )
-                .unwrap()
-        };
-        let key_value_ptr = self
-            .builder
-            .build_pointer_cast(
-                dict_key_ptr,
-                self.types.value_type.ptr_type(AddressSpace::default()),
-                "key_value_ptr",
-            )
-            .unwrap();
-        let entry_key = self
-            .builder
-            .build_load(self.types.value_type, key_value_ptr, "entry_key")
-            .unwrap();
-
-        // Compare keys - check both tag and data match
-        let entry_key_tag = self.extract_tag(entry_key).unwrap();
-        let entry_key_data = self.extract_data(entry_key).unwrap();
-
-        let tags_match = self
-            .builder
-            .build_int_compare(IntPredicate::EQ, key_tag, entry_key_tag, "tags_match")
-            .unwrap();
-
-        // For strings, compare by content (strcmp), not pointer equality.
-        let string_tag = self
+        // Native objects (e.g. socket addresses) take string keys like properties
+        self.builder.position_at_end(check_native_block);
+        let native_tag = self
             .types
             .i8_type
-            .const_int(ValueTag::String.as_u8() as u64, false);
-        let is_string = self
-            .builder
-            .build_int_compare(IntPredicate::EQ, key_tag, string_tag, "is_string_key")
-            .unwrap();
-
-        let data_match = self
-            .builder
-            .build_int_compare(IntPredicate::EQ, key_data, entry_key_data, "data_match")
-            .unwrap();
-
-        let eq_str_block = self.context.append_basic_block(function, "dict_key_eq_str");
-        let eq_other_block = self
-            .context
-            .append_basic_block(function, "dict_key_eq_other");
-        let eq_merge_block = self
-            .context
-            .append_basic_block(function, "dict_key_eq_merge");
-
-        self.builder
-            .build_conditional_branch(is_string, eq_str_block, eq_other_block)
-            .unwrap();
-
-        // String compare branch
-        self.builder.position_at_end(eq_str_block);
-        let i8_ptr_type = self.context.i8_type().ptr_type(AddressSpace::default());
-        let key_ptr = self
-            .builder
-            .build_int_to_ptr(key_data, i8_ptr_type, "key_ptr")
-            .unwrap();
-        let entry_key_ptr = self
-            .builder
-            .build_int_to_ptr(entry_key_data, i8_ptr_type, "entry_key_ptr")
-            .unwrap();
-        let cmp = self
-            .builder
-            .build_call(
-                self.libc.strcmp,
-                &[key_ptr.into(), entry_key_ptr.into()],
-                "cmp",
-            )
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .unwrap()
-            .into_int_value();
-        let str_eq = self
-            .builder
-            .build_int_compare(
-                IntPredicate::EQ,
-                cmp,
-                self.types.i32_type.const_int(0, false),
-                "str_eq",
-            )
-            .unwrap();
-        self.builder
-            .build_unconditional_branch(eq_merge_block)
-            .unwrap();
-        let eq_str_end = self.builder.get_insert_block().unwrap();
-
-        // Non-string branch
-        self.builder.position_at_end(eq_other_block);
-        self.builder
-            .build_unconditional_branch(eq_merge_block)
-            .unwrap();
-        let eq_other_end = self.builder.get_insert_block().unwrap();
-
-        // Merge data-equality result
-        self.builder.position_at_end(eq_merge_block);
-        let data_eq_phi = self
-            .builder
-            .build_phi(self.context.bool_type(), "key_data_eq")
-            .unwrap();
-        data_eq_phi.add_incoming(&[(&str_eq, eq_str_end), (&data_match, eq_other_end)]);
-        let data_eq = data_eq_phi.as_basic_value().into_int_value();
-
-        let keys_match = self
-            .builder
-            .build_and(tags_match, data_eq, "keys_match")
-            .unwrap();
-
-        self.builder
-            .build_conditional_branch(keys_match, found_block, continue_block)
-            .unwrap();
-
-        // Found - get the value
-        self.builder.position_at_end(found_block);
-        let dict_value_offset = self
-            .builder
-            .build_int_add(dict_entry_offset, value_offset_in_entry, "value_offset")
-            .unwrap();
-        let dict_value_ptr = unsafe {
-            self.builder
-                .build_gep(
-                    self.context.i8_type(),
-                    dict_ptr,
-                    &[dict_value_offset],
-                    "dict_value_ptr",
-                )
-                .unwrap()
-        };
-        let value_ptr = self
-            .builder
-            .build_pointer_cast(
-                dict_value_ptr,
-                self.types.value_type.ptr_type(AddressSpace::default()),
-                "value_ptr",
-            )
-            .unwrap();
-        let found_val = self
-            .builder
-            .build_load(self.types.value_type, value_ptr, "found_val")
-            .unwrap();
-        self.builder.build_store(result_ptr, found_val).unwrap();
-        self.builder
-            .build_store(found_ptr, self.context.bool_type().const_int(1, false))
-            .unwrap();
-        self.builder.build_unconditional_branch(done_block).unwrap();
-
-        // Continue loop
-        self.builder.position_at_end(continue_block);
-        let next_idx = self.builder.build_int_add(idx, one, "next_idx").unwrap();
-        self.builder.build_store(idx_ptr, next_idx).unwrap();
-        self.builder.build_unconditional_branch(loop_block).unwrap();
-
-        // Done - if missing, throw; otherwise return result (may be naething).
-        self.builder.position_at_end(done_block);
-        let found = self
-            .builder
-            .build_load(self.context.bool_type(), found_ptr, "dict_found")
-            .unwrap()
-            .into_int_value();
-
-        let ok_block = self.context.append_basic_block(function, "dict_lookup_ok");
-        let missing_block = self
-            .context
-            .append_basic_block(function, "dict_lookup_missing");
-        self.builder
-            .build_conditional_branch(found, ok_block, missing_block)
-            .unwrap();
-
-        self.builder.position_at_end(missing_block);
-        self.builder
-            .build_call(self.libc.key_not_found, &[key_val.into()], "")
-            .unwrap();
-        self.builder.build_unreachable().unwrap();
-
-        self.builder.position_at_end(ok_block);
-        let result = self
-            .builder
-            .build_load(self.types.value_type, result_ptr, "dict_result")
-            .unwrap();
-        Ok(result)
-    }
-
-    /// Compile an index set expression: list[index] = value or dict[key] = value
-    /// MdhList struct layout: { MdhValue *items; int64_t length; int64_t capacity; }
-    fn compile_index_set(
-        &mut self,
-        object: &Expr,
-        index: &Expr,
-        value: &Expr,
-    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
-        if let Expr::Variable { name, .. } = object {
-            if self.import_alias_exports.contains_key(name) {
-                self.import_alias_exports.remove(name);
-                self.import_alias_bindings.remove(name);
-                self.import_alias_functions.remove(name);
-            }
-        }
-        // Fast path: if we know the object is a list and index is an int,
-        // skip type checking and negative index handling
-        let obj_type = self.infer_expr_type(object);
-        let idx_type = self.infer_expr_type(index);
-
-        if obj_type == VarType::List && idx_type == VarType::Int {
-            return self.compile_list_index_set_fast(object, index, value);
-        }
-
-        // Dict assignment: use runtime function __mdh_dict_set
-        if obj_type == VarType::Dict {
-            return self.compile_dict_index_set(object, index, value);
-        }
-
-        // Compile the object, index, and value
-        let obj_val = self.compile_expr(object)?;
-        let idx_val = self.compile_expr(index)?;
-        let new_val = self.compile_expr(value)?;
-        let idx_tag = self.extract_tag(idx_val).unwrap();
-
-        // Check at runtime if this is a dict - if so, use dict_set
-        let obj_tag = self.extract_tag(obj_val).unwrap();
-        let dict_tag = self.types.i8_type.const_int(6, false); // MDH_TAG_DICT = 6
-        let is_dict = self
+            .const_int(ValueTag::NativeObject.as_u8() as u64, false);
+        let is_native = self
             .builder
-            .build_int_compare(inkwell::IntPredicate::EQ, obj_tag, dict_tag, "is_dict")
+            .build_int_compare(IntPredicate::EQ, obj_tag, native_tag, "is_native")
             .unwrap();
-
-        let function = self.current_function.unwrap();
-        let dict_block = self.context.append_basic_block(function, "set_dict");
-        let check_list_block = self.context.append_basic_block(function, "set_check_list");
-        let list_block = self.context.append_basic_block(function, "set_list");
-        let type_error_block = self.context.append_basic_block(function, "set_type_error");
-        let merge_block = self.context.append_basic_block(function, "set_merge");
-
         self.builder
-            .build_conditional_branch(is_dict, dict_block, check_list_block)
+            .build_conditional_branch(is_native, native_block, type_error_block)
             .unwrap();
 
-        // Dict branch: use __mdh_dict_set
-        self.builder.position_at_end(dict_block);
-        let dict_result = self
+        self.builder.position_at_end(native_block);
+        let native_result = self
             .builder
             .build_call(
-                self.libc.dict_set,
-                &[obj_val.into(), idx_val.into(), new_val.into()],
-                "dict_set_result",
+                self.libc.native_get,
+                &[obj_val.into(), idx_val.into()],
+                "index_native_get",
             )
             .unwrap()
             .try_as_basic_value()
             .left()
-            .compile_ok_or("dict_set returned void").unwrap();
-
-        // Update the variable/field with the new dict (dict_set returns a new dict since it may reallocate)
-            match object {
-                Expr::Variable { name, .. } => {
-                    if let Some(&ptr) = self.variables.get(name) {
-                        self.builder
-                            .build_store(ptr, dict_result)
-                            .unwrap();
-                    }
-                }
-                Expr::Get {
-                    object: inner_obj,
-                    property,
-                ..
-            } => {
-                // Field access like masel.data - need to store updated dict back to the field
-                let instance_val = self.compile_expr(inner_obj)?;
-                self.compile_instance_set_field(instance_val, property, dict_result)?;
-            }
-            _ => {
-                // For other expressions we can't store back
-            }
-        }
-
+            .compile_ok_or("native_get returned void")?;
+        let native_bb = self.builder.get_insert_block().unwrap();
         self.builder
             .build_unconditional_branch(merge_block)
             .unwrap();
-        let dict_end = self.builder.get_insert_block().unwrap();
 
-        // Check list tag
-        self.builder.position_at_end(check_list_block);
-        let list_tag = self
-            .types
-            .i8_type
-            .const_int(ValueTag::List.as_u8() as u64, false);
-        let is_list = self
+        // Type error for unsupported indexing
+        self.builder.position_at_end(type_error_block);
+        let op = self
             .builder
-            .build_int_compare(IntPredicate::EQ, obj_tag, list_tag, "is_list")
+            .build_global_string_ptr("index", "index_op")
             .unwrap();
         self.builder
-            .build_conditional_branch(is_list, list_block, type_error_block)
+            .build_call(
+                self.libc.type_error,
+                &[op.as_pointer_value().into(), obj_tag.into(), idx_tag.into()],
+                "",
+            )
+            .unwrap();
+        let err_result = self.make_nil();
+        let err_bb = self.builder.get_insert_block().unwrap();
+        self.builder
+            .build_unconditional_branch(merge_block)
             .unwrap();
 
-        // List branch: continue with original list handling
-        self.builder.position_at_end(list_block);
-
-        // Extract the object's data (pointer to MdhList struct)
-        let obj_data = self.extract_data(obj_val).unwrap();
+        // Merge
+        self.builder.position_at_end(merge_block);
+        let phi = self
+            .builder
+            .build_phi(self.types.value_type, "index_result")
+            .unwrap();
+        phi.add_incoming(&[
+            (&list_result, list_bb),
+            (&dict_result, dict_bb),
+            (&string_result, string_bb),
+            (&native_result, native_bb),
+            (&err_result, err_bb),
+        ]);
 
-        // Extract the index (assume it's an integer)
-        let idx_data = self.extract_data(idx_val).unwrap();
+        Ok(phi.as_basic_value())
+    }
 
-        // Convert list data to pointer to MdhList struct
+    /// Helper for list indexing
+    /// MdhList struct layout: { MdhValue *items; int64_t length; int64_t capacity; }
+    fn compile_list_index(
+        &self,
+        list_data: IntValue<'ctx>,
+        index: IntValue<'ctx>,
+    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
+        // Convert data to pointer to MdhList struct
         let i64_ptr_type = self.types.i64_type.ptr_type(AddressSpace::default());
         let list_ptr = self
             .builder
-            .build_int_to_ptr(obj_data, i64_ptr_type, "list_ptr")
+            .build_int_to_ptr(list_data, i64_ptr_type, "list_ptr")
             .unwrap();
 
         // Load items pointer from offset 0
@@ -23503,7 +27595,7 @@ impl<'ctx> CodeGen<'ctx> {
             .unwrap()
             .into_int_value();
 
-        // Get length pointer at offset 1
+        // Get length pointer (at offset 1)
         let len_ptr = unsafe {
             self.builder
                 .build_gep(
@@ -23515,7 +27607,7 @@ impl<'ctx> CodeGen<'ctx> {
                 .unwrap()
         };
 
-        // Load length for bounds checking and negative index handling
+        // Load length
         let length = self
             .builder
             .build_load(self.types.i64_type, len_ptr, "list_len")
@@ -23526,17 +27618,17 @@ impl<'ctx> CodeGen<'ctx> {
         let zero = self.types.i64_type.const_int(0, false);
         let is_negative = self
             .builder
-            .build_int_compare(inkwell::IntPredicate::SLT, idx_data, zero, "is_negative")
+            .build_int_compare(inkwell::IntPredicate::SLT, index, zero, "is_negative")
             .unwrap();
 
         let adjusted_index = self
             .builder
-            .build_int_add(length, idx_data, "adjusted")
+            .build_int_add(length, index, "adjusted")
             .unwrap();
 
         let final_index = self
             .builder
-            .build_select(is_negative, adjusted_index, idx_data, "final_index")
+            .build_select(is_negative, adjusted_index, index, "final_index")
             .unwrap()
             .into_int_value();
 
@@ -23554,99 +27646,29 @@ impl<'ctx> CodeGen<'ctx> {
                 .unwrap()
         };
 
-        // Store the new value at that location
-        self.builder
-            .build_store(elem_ptr, new_val)
-            .unwrap();
-
-        self.builder
-            .build_unconditional_branch(merge_block)
-            .unwrap();
-        let list_end = self.builder.get_insert_block().unwrap();
-
-        // Type error branch
-        self.builder.position_at_end(type_error_block);
-        let op = self
-            .builder
-            .build_global_string_ptr("index_set", "index_set_op")
-            .unwrap();
-        self.builder
-            .build_call(
-                self.libc.type_error,
-                &[op.as_pointer_value().into(), obj_tag.into(), idx_tag.into()],
-                "",
-            )
-            .unwrap();
-        let err_val = self.make_nil();
-        self.builder
-            .build_unconditional_branch(merge_block)
-            .unwrap();
-        let err_end = self.builder.get_insert_block().unwrap();
-
-        // Merge block
-        self.builder.position_at_end(merge_block);
-        let phi = self
+        // Load and return the element
+        let result = self
             .builder
-            .build_phi(self.types.value_type, "set_result")
+            .build_load(self.types.value_type, elem_ptr, "elem_val")
             .unwrap();
-        phi.add_incoming(&[
-            (&new_val, dict_end),
-            (&new_val, list_end),
-            (&err_val, err_end),
-        ]);
-        // Return the value that was set (for chained assignments)
-        Ok(phi.as_basic_value())
-    }
-
-    /// Compile dict[key] = value using runtime function
-    fn compile_dict_index_set(
-        &mut self,
-        object: &Expr,
-        index: &Expr,
-        value: &Expr,
-    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
-        let obj_val = self.compile_expr(object)?;
-        let idx_val = self.compile_expr(index)?;
-        let new_val = self.compile_expr(value)?;
-
-        let dict_result = self
-            .builder
-            .build_call(
-                self.libc.dict_set,
-                &[obj_val.into(), idx_val.into(), new_val.into()],
-                "dict_set_result",
-            )
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .compile_ok_or("dict_set returned void").unwrap();
-
-        // Update local variable binding when possible (dict_set returns a new dict since it may reallocate).
-        // For other expressions we can't store back - the update is lost.
-        if let Expr::Variable { name, .. } = object {
-            if let Some(&ptr) = self.variables.get(name) {
-                self.builder
-                    .build_store(ptr, dict_result)
-                    .unwrap(); }
-        }
 
-        Ok(new_val)
+        Ok(result)
     }
 
-    /// Fast path for list index assignment when types are known at compile time
+    /// Fast path for list indexing when types are known at compile time
+    /// Skips type checking, negative index handling, and uses direct pointer arithmetic
     /// MdhList struct layout: { MdhValue *items; int64_t length; int64_t capacity; }
-    fn compile_list_index_set_fast(
+    fn compile_list_index_fast(
         &mut self,
         object: &Expr,
         index: &Expr,
-        value: &Expr,
     ) -> Result<BasicValueEnum<'ctx>, HaversError> {
         // Try to get list data from shadow (fastest path - avoids loading full MdhValue)
         let list_data = if let Expr::Variable { name, .. } = object {
             if let Some(&shadow) = self.list_ptr_shadows.get(name) {
                 // Load raw pointer from shadow
                 self.builder
-                    .build_load(self.types.i64_type, shadow, "list_ptr_shadow")
+                    .build_load(self.types.i64_type, shadow, "list_ptr_shadow_rd")
                     .unwrap()
                     .into_int_value()
             } else {
@@ -23670,57 +27692,62 @@ impl<'ctx> CodeGen<'ctx> {
         let i64_ptr_type = self.types.i64_type.ptr_type(AddressSpace::default());
         let list_ptr = self
             .builder
-            .build_int_to_ptr(list_data, i64_ptr_type, "list_ptr_set_fast")
+            .build_int_to_ptr(list_data, i64_ptr_type, "list_ptr_fast")
             .unwrap();
 
-        // Load length from MdhList offset 1 for negative index handling
+        // Load items pointer from offset 0
+        let items_ptr_as_i64 = self
+            .builder
+            .build_load(self.types.i64_type, list_ptr, "items_ptr_i64_fast")
+            .unwrap()
+            .into_int_value();
+
+        // Get length pointer (at offset 1) for negative index handling
         let len_ptr = unsafe {
             self.builder
                 .build_gep(
                     self.types.i64_type,
                     list_ptr,
                     &[self.types.i64_type.const_int(1, false)],
-                    "len_ptr_set_fast",
+                    "len_ptr_fast",
                 )
                 .unwrap()
         };
+
         let length = self
             .builder
-            .build_load(self.types.i64_type, len_ptr, "list_len_set_fast")
+            .build_load(self.types.i64_type, len_ptr, "list_len_fast")
             .unwrap()
             .into_int_value();
 
-        // Handle negative indices: final_index = (idx < 0) ? (len + idx) : idx
-        let zero_i64 = self.types.i64_type.const_int(0, false);
+        // Handle negative indices: if index < 0, index = length + index
+        let zero = self.types.i64_type.const_int(0, false);
         let is_negative = self
             .builder
-            .build_int_compare(IntPredicate::SLT, idx_i64, zero_i64, "idx_is_negative")
+            .build_int_compare(
+                inkwell::IntPredicate::SLT,
+                idx_i64,
+                zero,
+                "is_negative_fast",
+            )
             .unwrap();
+
         let adjusted_index = self
             .builder
-            .build_int_add(length, idx_i64, "idx_adjusted")
+            .build_int_add(length, idx_i64, "adjusted_fast")
             .unwrap();
-        let final_index = self
-            .builder
-            .build_select(is_negative, adjusted_index, idx_i64, "idx_final")
-            .unwrap()
-            .into_int_value();
 
-        // Load items pointer from offset 0
-        let items_ptr_as_i64 = self
+        let final_index = self
             .builder
-            .build_load(self.types.i64_type, list_ptr, "items_ptr_i64_set")
+            .build_select(is_negative, adjusted_index, idx_i64, "final_index_fast")
             .unwrap()
             .into_int_value();
 
-        // Compile the value to store
-        let new_val = self.compile_expr(value)?;
-
         // Convert items pointer to MdhValue pointer
         let value_ptr_type = self.types.value_type.ptr_type(AddressSpace::default());
         let items_ptr = self
             .builder
-            .build_int_to_ptr(items_ptr_as_i64, value_ptr_type, "items_ptr_set")
+            .build_int_to_ptr(items_ptr_as_i64, value_ptr_type, "items_ptr_fast")
             .unwrap();
 
         // Get pointer to the indexed element
@@ -23730,1220 +27757,1013 @@ impl<'ctx> CodeGen<'ctx> {
                     self.types.value_type,
                     items_ptr,
                     &[final_index],
-                    "elem_ptr_set_fast",
+                    "elem_ptr_fast",
                 )
                 .unwrap()
         };
 
-        // Store the new value at that location
-        self.builder
-            .build_store(elem_ptr, new_val)
+        // Load and return the element
+        let result = self
+            .builder
+            .build_load(self.types.value_type, elem_ptr, "elem_val_fast")
             .unwrap();
 
-        // Return the value that was set
-        Ok(new_val)
+        Ok(result)
     }
 
-    /// Helper for string indexing (return single character as string)
-    fn compile_string_index(
-        &self,
-        str_data: IntValue<'ctx>,
-        index: IntValue<'ctx>,
+    /// Helper for dict indexing - searches for key and returns corresponding value
+    /// Dict layout: [i64 count][entry0][entry1]... where entry = [{i8,i64} key][{i8,i64} val]
+    fn compile_dict_index(
+        &mut self,
+        dict_data: IntValue<'ctx>,
+        key_val: BasicValueEnum<'ctx>,
     ) -> Result<BasicValueEnum<'ctx>, HaversError> {
-        // Convert data to string pointer
-        let i8_ptr_type = self.context.i8_type().ptr_type(AddressSpace::default());
-        let str_ptr = self
-            .builder
-            .build_int_to_ptr(str_data, i8_ptr_type, "str_ptr")
-            .unwrap();
-
-        // Get string length
-        let length = self
-            .builder
-            .build_call(self.libc.strlen, &[str_ptr.into()], "str_len")
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .compile_ok_or("strlen returned void").unwrap()
-            .into_int_value();
+        let function = self.current_function.unwrap();
 
-        // Handle negative indices
-        let zero = self.types.i64_type.const_int(0, false);
-        let is_negative = self
+        // Convert dict data to pointer
+        let i8_ptr_type = self.context.i8_type().ptr_type(AddressSpace::default());
+        let i64_ptr_type = self.types.i64_type.ptr_type(AddressSpace::default());
+        let dict_ptr = self
             .builder
-            .build_int_compare(inkwell::IntPredicate::SLT, index, zero, "is_negative")
+            .build_int_to_ptr(dict_data, i8_ptr_type, "dict_ptr")
             .unwrap();
 
-        let adjusted_index = self
+        // Get dict count
+        let count_ptr = self
             .builder
-            .build_int_add(length, index, "adjusted")
+            .build_pointer_cast(dict_ptr, i64_ptr_type, "count_ptr")
             .unwrap();
-
-        let final_index = self
+        let dict_count = self
             .builder
-            .build_select(is_negative, adjusted_index, index, "final_index")
+            .build_load(self.types.i64_type, count_ptr, "dict_count")
             .unwrap()
             .into_int_value();
 
-        // Allocate 2 bytes for the new string (char + null terminator)
-        let two = self.types.i64_type.const_int(2, false);
-        let new_str = self
-            .builder
-            .build_call(self.libc.malloc, &[two.into()], "char_str")
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .compile_ok_or("malloc returned void").unwrap()
-            .into_pointer_value();
-
-        // Get pointer to the character
-        let char_ptr = unsafe {
-            self.builder
-                .build_gep(self.context.i8_type(), str_ptr, &[final_index], "char_ptr")
-                .unwrap()
-        };
+        // Extract key tag and data for comparison
+        let key_tag = self.extract_tag(key_val).unwrap();
+        let key_data = self.extract_data(key_val).unwrap();
 
-        // Load the character
-        let char_val = self
+        // Allocate result pointer and found flag
+        let result_ptr = self
             .builder
-            .build_load(self.context.i8_type(), char_ptr, "char_val")
-            .unwrap();
-
-        // Store the character in new string
-        self.builder
-            .build_store(new_str, char_val)
+            .build_alloca(self.types.value_type, "result_ptr")
             .unwrap();
-
-        // Store null terminator
-        let null_ptr = unsafe {
-            self.builder
-                .build_gep(
-                    self.context.i8_type(),
-                    new_str,
-                    &[self.types.i64_type.const_int(1, false)],
-                    "null_ptr",
-                )
-                .unwrap()
-        };
-        let null_byte = self.context.i8_type().const_int(0, false);
         self.builder
-            .build_store(null_ptr, null_byte)
-            .unwrap();
-
-        // Return as string value
-        self.make_string(new_str)
-    }
-
-    // ===== Phase 5: Timing functions =====
-
-    /// noo() - Returns current time in milliseconds since epoch (CLOCK_REALTIME)
-    fn inline_noo(&mut self) -> Result<BasicValueEnum<'ctx>, HaversError> {
-        // Create struct timespec { i64 tv_sec; i64 tv_nsec; } on stack
-        let timespec_type = self.context.struct_type(
-            &[self.types.i64_type.into(), self.types.i64_type.into()],
-            false,
-        );
-
-        let timespec_ptr = self
-            .builder
-            .build_alloca(timespec_type, "timespec")
+            .build_store(result_ptr, self.make_nil())
             .unwrap();
 
-        // CLOCK_REALTIME = 0
-        let clock_id = self.context.i32_type().const_int(0, false);
-
-        // Cast timespec_ptr to i8* for clock_gettime
-        let timespec_i8_ptr = self
+        // Large dicts go through the runtime's hash index; small ones use the inline scan below.
+        let inline_block = self.context.append_basic_block(function, "dict_lookup_inline");
+        let indexed_block = self.context.append_basic_block(function, "dict_lookup_indexed");
+        let indexed_done_block = self
+            .context
+            .append_basic_block(function, "dict_lookup_indexed_done");
+        let is_large = self
             .builder
-            .build_pointer_cast(
-                timespec_ptr,
-                self.context.i8_type().ptr_type(AddressSpace::default()),
-                "timespec_i8_ptr",
+            .build_int_compare(
+                IntPredicate::UGE,
+                dict_count,
+                self.types.i64_type.const_int(DICT_INDEX_MIN, false),
+                "dict_is_large",
             )
             .unwrap();
-
-        // Call clock_gettime(CLOCK_REALTIME, &ts)
         self.builder
-            .build_call(
-                self.libc.clock_gettime,
-                &[clock_id.into(), timespec_i8_ptr.into()],
-                "clock_result",
-            )
+            .build_conditional_branch(is_large, indexed_block, inline_block)
             .unwrap();
 
-        // Read tv_sec
-        let sec_ptr = self
-            .builder
-            .build_struct_gep(timespec_type, timespec_ptr, 0, "sec_ptr")
-            .unwrap();
-        let tv_sec = self
+        self.builder.position_at_end(indexed_block);
+        let dict_val = self.make_dict(dict_ptr)?;
+        let indexed_val = self
             .builder
-            .build_load(self.types.i64_type, sec_ptr, "tv_sec")
+            .build_call(
+                self.libc.dict_get,
+                &[dict_val.into(), key_val.into()],
+                "dict_get_indexed",
+            )
             .unwrap()
-            .into_int_value();
-
-        // Read tv_nsec
-        let nsec_ptr = self
-            .builder
-            .build_struct_gep(timespec_type, timespec_ptr, 1, "nsec_ptr")
+            .try_as_basic_value()
+            .left()
+            .compile_ok_or("dict_get returned void")?;
+        self.builder.build_store(result_ptr, indexed_val).unwrap();
+        self.builder
+            .build_unconditional_branch(indexed_done_block)
             .unwrap();
-        let tv_nsec = self
-            .builder
-            .build_load(self.types.i64_type, nsec_ptr, "tv_nsec")
-            .unwrap()
-            .into_int_value();
 
-        // Convert to milliseconds: (tv_sec * 1000) + (tv_nsec / 1_000_000)
-        let thousand = self.types.i64_type.const_int(1000, false);
-        let million = self.types.i64_type.const_int(1_000_000, false);
+        self.builder.position_at_end(inline_block);
 
-        let sec_ms = self
-            .builder
-            .build_int_mul(tv_sec, thousand, "sec_ms")
-            .unwrap();
-        let nsec_ms = self
-            .builder
-            .build_int_signed_div(tv_nsec, million, "nsec_ms")
-            .unwrap();
-        let total_ms = self
+        let found_ptr = self
             .builder
-            .build_int_add(sec_ms, nsec_ms, "total_ms")
+            .build_alloca(self.context.bool_type(), "dict_key_found")
             .unwrap();
-
-        self.make_int(total_ms)
-    }
-
-    /// tick() - Returns time in nanoseconds since epoch (CLOCK_REALTIME)
-    fn inline_tick(&mut self) -> Result<BasicValueEnum<'ctx>, HaversError> {
-        // Create struct timespec { i64 tv_sec; i64 tv_nsec; } on stack
-        let timespec_type = self.context.struct_type(
-            &[self.types.i64_type.into(), self.types.i64_type.into()],
-            false,
-        );
-
-        let timespec_ptr = self
-            .builder
-            .build_alloca(timespec_type, "timespec")
+        self.builder
+            .build_store(found_ptr, self.context.bool_type().const_int(0, false))
             .unwrap();
 
-        // CLOCK_REALTIME = 0 (match interpreter's SystemTime)
-        let clock_id = self.context.i32_type().const_int(0, false);
+        // Loop through entries to find matching key
+        let zero = self.types.i64_type.const_int(0, false);
+        let one = self.types.i64_type.const_int(1, false);
+        let header_size = self.types.i64_type.const_int(8, false); // sizeof(i64) for count
+        let entry_size = self.types.i64_type.const_int(32, false);
+        let value_offset_in_entry = self.types.i64_type.const_int(16, false);
 
-        // Cast timespec_ptr to i8* for clock_gettime
-        let timespec_i8_ptr = self
+        let idx_ptr = self
             .builder
-            .build_pointer_cast(
-                timespec_ptr,
-                self.context.i8_type().ptr_type(AddressSpace::default()),
-                "timespec_i8_ptr",
-            )
+            .build_alloca(self.types.i64_type, "idx")
             .unwrap();
+        self.builder.build_store(idx_ptr, zero).unwrap();
 
-        // Call clock_gettime(CLOCK_REALTIME, &ts)
-        self.builder
-            .build_call(
-                self.libc.clock_gettime,
-                &[clock_id.into(), timespec_i8_ptr.into()],
-                "clock_result",
-            )
-            .unwrap();
+        let loop_block = self
+            .context
+            .append_basic_block(function, "dict_lookup_loop");
+        let body_block = self
+            .context
+            .append_basic_block(function, "dict_lookup_body");
+        let found_block = self.context.append_basic_block(function, "dict_found");
+        let continue_block = self.context.append_basic_block(function, "dict_continue");
+        let done_block = self
+            .context
+            .append_basic_block(function, "dict_lookup_done");
 
-        // Read tv_sec
-        let sec_ptr = self
-            .builder
-            .build_struct_gep(timespec_type, timespec_ptr, 0, "sec_ptr")
-            .unwrap();
-        let tv_sec = self
-            .builder
-            .build_load(self.types.i64_type, sec_ptr, "tv_sec")
-            .unwrap()
-            .into_int_value();
+        self.builder.build_unconditional_branch(loop_block).unwrap();
+        self.builder.position_at_end(loop_block);
 
-        // Read tv_nsec
-        let nsec_ptr = self
-            .builder
-            .build_struct_gep(timespec_type, timespec_ptr, 1, "nsec_ptr")
-            .unwrap();
-        let tv_nsec = self
+        let idx = self
             .builder
-            .build_load(self.types.i64_type, nsec_ptr, "tv_nsec")
+            .build_load(self.types.i64_type, idx_ptr, "idx_val")
             .unwrap()
             .into_int_value();
-
-        // Convert to nanoseconds: (tv_sec * 1_000_000_000) + tv_nsec
-        let billion = self.types.i64_type.const_int(1_000_000_000, false);
-        let sec_ns = self
+        let done_cond = self
             .builder
-            .build_int_mul(tv_sec, billion, "sec_ns")
+            .build_int_compare(IntPredicate::UGE, idx, dict_count, "done")
             .unwrap();
-        let total_ns = self
-            .builder
-            .build_int_add(sec_ns, tv_nsec, "total_ns")
+        self.builder
+            .build_conditional_branch(done_cond, done_block, body_block)
             .unwrap();
 
-        self.make_int(total_ns)
-    }
-
-    /// bide(ms) - Sleep for specified milliseconds
-    fn inline_bide(
-        &mut self,
-        ms_val: BasicValueEnum<'ctx>,
-    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
-        // Extract the integer value from the tagged value
-        let ms_struct = ms_val.into_struct_value();
-        let ms = self
-            .builder
-            .build_extract_value(ms_struct, 1, "ms_data")
-            .unwrap()
-            .into_int_value();
-
-        // Create struct timespec { i64 tv_sec; i64 tv_nsec; } on stack
-        let timespec_type = self.context.struct_type(
-            &[self.types.i64_type.into(), self.types.i64_type.into()],
-            false,
-        );
-
-        let req_ptr = self.builder.build_alloca(timespec_type, "req").unwrap();
-
-        // Convert ms to seconds and nanoseconds
-        // tv_sec = ms / 1000
-        // tv_nsec = (ms % 1000) * 1_000_000
-        let thousand = self.types.i64_type.const_int(1000, false);
-        let million = self.types.i64_type.const_int(1_000_000, false);
+        self.builder.position_at_end(body_block);
 
-        let tv_sec = self
+        // Get entry key from dict
+        let dict_entry_offset = self
             .builder
-            .build_int_signed_div(ms, thousand, "tv_sec")
+            .build_int_add(
+                header_size,
+                self.builder
+                    .build_int_mul(idx, entry_size, "entry_mul")
+                    .unwrap(),
+                "entry_offset",
+            )
             .unwrap();
-        let ms_remainder = self
+        let dict_key_ptr = unsafe {
+            self.builder
+                .build_gep(
+                    self.context.i8_type(),
+                    dict_ptr,
+                    &[dict_entry_offset],
+                    "dict_key_ptr",
+                )
+                .unwrap()
+        };
+        let key_value_ptr = self
             .builder
-            .build_int_signed_rem(ms, thousand, "ms_remainder")
+            .build_pointer_cast(
+                dict_key_ptr,
+                self.types.value_type.ptr_type(AddressSpace::default()),
+                "key_value_ptr",
+            )
             .unwrap();
-        let tv_nsec = self
+        let entry_key = self
             .builder
-            .build_int_mul(ms_remainder, million, "tv_nsec")
+            .build_load(self.types.value_type, key_value_ptr, "entry_key")
             .unwrap();
 
-        // Store tv_sec and tv_nsec
-        let sec_ptr = self
+        // Compare keys - check both tag and data match
+        let entry_key_tag = self.extract_tag(entry_key).unwrap();
+        let entry_key_data = self.extract_data(entry_key).unwrap();
+
+        let tags_match = self
             .builder
-            .build_struct_gep(timespec_type, req_ptr, 0, "sec_ptr")
+            .build_int_compare(IntPredicate::EQ, key_tag, entry_key_tag, "tags_match")
             .unwrap();
-        self.builder.build_store(sec_ptr, tv_sec).unwrap();
 
-        let nsec_ptr = self
+        // For strings, compare by content (strcmp), not pointer equality.
+        let string_tag = self
+            .types
+            .i8_type
+            .const_int(ValueTag::String.as_u8() as u64, false);
+        let is_string = self
             .builder
-            .build_struct_gep(timespec_type, req_ptr, 1, "nsec_ptr")
+            .build_int_compare(IntPredicate::EQ, key_tag, string_tag, "is_string_key")
             .unwrap();
-        self.builder.build_store(nsec_ptr, tv_nsec).unwrap();
 
-        // Cast req_ptr to i8* for nanosleep
-        let req_i8_ptr = self
+        let data_match = self
             .builder
-            .build_pointer_cast(
-                req_ptr,
-                self.context.i8_type().ptr_type(AddressSpace::default()),
-                "req_i8_ptr",
-            )
+            .build_int_compare(IntPredicate::EQ, key_data, entry_key_data, "data_match")
             .unwrap();
 
-        // Pass null for the second argument (remaining time)
-        let null = self
+        let eq_str_block = self.context.append_basic_block(function, "dict_key_eq_str");
+        let eq_other_block = self
             .context
-            .i8_type()
-            .ptr_type(AddressSpace::default())
-            .const_null();
+            .append_basic_block(function, "dict_key_eq_other");
+        let eq_merge_block = self
+            .context
+            .append_basic_block(function, "dict_key_eq_merge");
 
-        // Call nanosleep(&req, NULL)
         self.builder
-            .build_call(
-                self.libc.nanosleep,
-                &[req_i8_ptr.into(), null.into()],
-                "sleep_result",
-            )
+            .build_conditional_branch(is_string, eq_str_block, eq_other_block)
             .unwrap();
 
-        // Return nil
-        Ok(self.make_nil())
-    }
-
-    // ===== Extra: String operations =====
-
-    /// split(str, delimiter) - Split string into list of strings
-    fn inline_split(
-        &mut self,
-        str_val: BasicValueEnum<'ctx>,
-        delim_val: BasicValueEnum<'ctx>,
-    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
-        let function = self.current_function.unwrap();
-
-        // Extract string pointers
-        let str_struct = str_val.into_struct_value();
-        let str_data = self
-            .builder
-            .build_extract_value(str_struct, 1, "str_data")
-            .unwrap()
-            .into_int_value();
+        // String compare branch
+        self.builder.position_at_end(eq_str_block);
         let i8_ptr_type = self.context.i8_type().ptr_type(AddressSpace::default());
-        let str_ptr = self
+        let key_ptr = self
             .builder
-            .build_int_to_ptr(str_data, i8_ptr_type, "str_ptr")
+            .build_int_to_ptr(key_data, i8_ptr_type, "key_ptr")
             .unwrap();
-
-        let delim_struct = delim_val.into_struct_value();
-        let delim_data = self
-            .builder
-            .build_extract_value(delim_struct, 1, "delim_data")
-            .unwrap()
-            .into_int_value();
-        let delim_ptr = self
+        let entry_key_ptr = self
             .builder
-            .build_int_to_ptr(delim_data, i8_ptr_type, "delim_ptr")
+            .build_int_to_ptr(entry_key_data, i8_ptr_type, "entry_key_ptr")
             .unwrap();
-
-        // Get delimiter length
-        let delim_len = self
+        let cmp = self
             .builder
-            .build_call(self.libc.strlen, &[delim_ptr.into()], "delim_len")
+            .build_call(
+                self.libc.strcmp,
+                &[key_ptr.into(), entry_key_ptr.into()],
+                "cmp",
+            )
             .unwrap()
             .try_as_basic_value()
             .left()
             .unwrap()
             .into_int_value();
-
-        // Get string length
-        let str_len = self
+        let str_eq = self
             .builder
-            .build_call(self.libc.strlen, &[str_ptr.into()], "str_len")
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .unwrap()
-            .into_int_value();
+            .build_int_compare(
+                IntPredicate::EQ,
+                cmp,
+                self.types.i32_type.const_int(0, false),
+                "str_eq",
+            )
+            .unwrap();
+        self.builder
+            .build_unconditional_branch(eq_merge_block)
+            .unwrap();
+        let eq_str_end = self.builder.get_insert_block().unwrap();
 
-        // Handle empty delimiter - return list with single element (the whole string)
-        // This prevents infinite loop when delimiter is ""
-        let zero = self.types.i64_type.const_int(0, false);
-        let one = self.types.i64_type.const_int(1, false);
-        let delim_is_empty = self
+        // Non-string branch
+        self.builder.position_at_end(eq_other_block);
+        self.builder
+            .build_unconditional_branch(eq_merge_block)
+            .unwrap();
+        let eq_other_end = self.builder.get_insert_block().unwrap();
+
+        // Merge data-equality result
+        self.builder.position_at_end(eq_merge_block);
+        let data_eq_phi = self
             .builder
-            .build_int_compare(IntPredicate::EQ, delim_len, zero, "delim_empty")
+            .build_phi(self.context.bool_type(), "key_data_eq")
             .unwrap();
+        data_eq_phi.add_incoming(&[(&str_eq, eq_str_end), (&data_match, eq_other_end)]);
+        let data_eq = data_eq_phi.as_basic_value().into_int_value();
 
-        // Check if delimiter is single character (fast path)
-        let delim_is_single = self
+        let keys_match = self
             .builder
-            .build_int_compare(IntPredicate::EQ, delim_len, one, "delim_single")
+            .build_and(tags_match, data_eq, "keys_match")
             .unwrap();
 
-        let empty_delim_block = self.context.append_basic_block(function, "empty_delim");
-        let single_char_block = self
-            .context
-            .append_basic_block(function, "single_char_split");
-        let normal_split_block = self.context.append_basic_block(function, "normal_split");
-        let merge_block = self.context.append_basic_block(function, "split_merge");
+        self.builder
+            .build_conditional_branch(keys_match, found_block, continue_block)
+            .unwrap();
 
-        // Branch: empty -> empty_delim, otherwise check for single char
+        // Found - get the value
+        self.builder.position_at_end(found_block);
+        let dict_value_offset = self
+            .builder
+            .build_int_add(dict_entry_offset, value_offset_in_entry, "value_offset")
+            .unwrap();
+        let dict_value_ptr = unsafe {
+            self.builder
+                .build_gep(
+                    self.context.i8_type(),
+                    dict_ptr,
+                    &[dict_value_offset],
+                    "dict_value_ptr",
+                )
+                .unwrap()
+        };
+        let value_ptr = self
+            .builder
+            .build_pointer_cast(
+                dict_value_ptr,
+                self.types.value_type.ptr_type(AddressSpace::default()),
+                "value_ptr",
+            )
+            .unwrap();
+        let found_val = self
+            .builder
+            .build_load(self.types.value_type, value_ptr, "found_val")
+            .unwrap();
+        self.builder.build_store(result_ptr, found_val).unwrap();
         self.builder
-            .build_conditional_branch(delim_is_empty, empty_delim_block, single_char_block)
+            .build_store(found_ptr, self.context.bool_type().const_int(1, false))
             .unwrap();
+        self.builder.build_unconditional_branch(done_block).unwrap();
 
-        // Single-char check: if single -> fast byte scan, else -> normal strstr path
-        self.builder.position_at_end(single_char_block);
+        // Continue loop
+        self.builder.position_at_end(continue_block);
+        let next_idx = self.builder.build_int_add(idx, one, "next_idx").unwrap();
+        self.builder.build_store(idx_ptr, next_idx).unwrap();
+        self.builder.build_unconditional_branch(loop_block).unwrap();
 
-        // Get the delimiter byte for single-char case
-        let delim_byte = self
+        // Done - if missing, throw; otherwise return result (may be naething).
+        self.builder.position_at_end(done_block);
+        let found = self
             .builder
-            .build_load(self.context.i8_type(), delim_ptr, "delim_byte")
+            .build_load(self.context.bool_type(), found_ptr, "dict_found")
             .unwrap()
             .into_int_value();
 
-        // Create blocks for single-char fast path
-        let sc_count_block = self.context.append_basic_block(function, "sc_count_loop");
-        let sc_count_body = self.context.append_basic_block(function, "sc_count_body");
-        let sc_count_done = self.context.append_basic_block(function, "sc_count_done");
-        let sc_split_block = self.context.append_basic_block(function, "sc_split_loop");
-        let sc_split_body = self.context.append_basic_block(function, "sc_split_body");
-        let sc_split_found = self.context.append_basic_block(function, "sc_split_found");
-        let sc_split_done = self.context.append_basic_block(function, "sc_split_done");
-
+        let ok_block = self.context.append_basic_block(function, "dict_lookup_ok");
+        let missing_block = self
+            .context
+            .append_basic_block(function, "dict_lookup_missing");
         self.builder
-            .build_conditional_branch(delim_is_single, sc_count_block, normal_split_block)
+            .build_conditional_branch(found, ok_block, missing_block)
             .unwrap();
 
-        // === SINGLE-CHAR FAST PATH ===
-        // Phase 1: Count delimiters to know exact list size
-        self.builder.position_at_end(sc_count_block);
-        let sc_i_ptr = self
-            .builder
-            .build_alloca(self.types.i64_type, "sc_i")
-            .unwrap();
-        let sc_count_ptr = self
-            .builder
-            .build_alloca(self.types.i64_type, "sc_count")
+        self.builder.position_at_end(missing_block);
+        self.builder
+            .build_call(self.libc.key_not_found, &[key_val.into()], "")
             .unwrap();
-        let sc_one = self.types.i64_type.const_int(1, false);
-        self.builder.build_store(sc_i_ptr, zero).unwrap();
-        self.builder.build_store(sc_count_ptr, zero).unwrap();
+        self.builder.build_unreachable().unwrap();
+
+        self.builder.position_at_end(ok_block);
         self.builder
-            .build_unconditional_branch(sc_count_body)
+            .build_unconditional_branch(indexed_done_block)
             .unwrap();
 
-        // Count loop condition check
-        self.builder.position_at_end(sc_count_body);
-        let sc_i = self
+        self.builder.position_at_end(indexed_done_block);
+        let result = self
             .builder
-            .build_load(self.types.i64_type, sc_i_ptr, "sc_i_val")
-            .unwrap()
-            .into_int_value();
-        let sc_at_end = self
+            .build_load(self.types.value_type, result_ptr, "dict_result")
+            .unwrap();
+        Ok(result)
+    }
+
+    /// Compile an index set expression: list[index] = value or dict[key] = value
+    /// MdhList struct layout: { MdhValue *items; int64_t length; int64_t capacity; }
+    fn compile_index_set(
+        &mut self,
+        object: &Expr,
+        index: &Expr,
+        value: &Expr,
+    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
+        if let Expr::Variable { name, .. } = object {
+            if self.import_alias_exports.contains_key(name) {
+                self.import_alias_exports.remove(name);
+                self.import_alias_bindings.remove(name);
+                self.import_alias_functions.remove(name);
+            }
+        }
+        // Fast path: if we know the object is a list and index is an int,
+        // skip type checking and negative index handling
+        let obj_type = self.infer_expr_type(object);
+        let idx_type = self.infer_expr_type(index);
+
+        if let Some(elem_ptr) = self.indexed_element(object, index) {
+            let new_val = self.compile_expr(value)?;
+            self.builder.build_store(elem_ptr, new_val).unwrap();
+            return Ok(new_val);
+        }
+
+        if obj_type == VarType::List && idx_type == VarType::Int {
+            return self.compile_list_index_set_fast(object, index, value);
+        }
+
+        // Dict assignment: use runtime function __mdh_dict_set
+        if obj_type == VarType::Dict {
+            return self.compile_dict_index_set(object, index, value);
+        }
+
+        // Compile the object, index, and value
+        let obj_val = self.compile_expr(object)?;
+        let idx_val = self.compile_expr(index)?;
+        let new_val = self.compile_expr(value)?;
+        let idx_tag = self.extract_tag(idx_val).unwrap();
+
+        // Check at runtime if this is a dict - if so, use dict_set
+        let obj_tag = self.extract_tag(obj_val).unwrap();
+        let dict_tag = self.types.i8_type.const_int(6, false); // MDH_TAG_DICT = 6
+        let is_dict = self
             .builder
-            .build_int_compare(IntPredicate::UGE, sc_i, str_len, "sc_at_end")
+            .build_int_compare(inkwell::IntPredicate::EQ, obj_tag, dict_tag, "is_dict")
             .unwrap();
 
-        // Create a block for the loop body work
-        let sc_count_work = self.context.append_basic_block(function, "sc_count_work");
+        let function = self.current_function.unwrap();
+        let dict_block = self.context.append_basic_block(function, "set_dict");
+        let check_list_block = self.context.append_basic_block(function, "set_check_list");
+        let list_block = self.context.append_basic_block(function, "set_list");
+        let check_native_block = self
+            .context
+            .append_basic_block(function, "set_check_native");
+        let native_block = self.context.append_basic_block(function, "set_native");
+        let type_error_block = self.context.append_basic_block(function, "set_type_error");
+        let merge_block = self.context.append_basic_block(function, "set_merge");
+
         self.builder
-            .build_conditional_branch(sc_at_end, sc_count_done, sc_count_work)
+            .build_conditional_branch(is_dict, dict_block, check_list_block)
             .unwrap();
 
-        // Loop body: check char and update count
-        self.builder.position_at_end(sc_count_work);
-        let sc_char_ptr = unsafe {
-            self.builder
-                .build_gep(self.context.i8_type(), str_ptr, &[sc_i], "sc_char_ptr")
-                .unwrap()
-        };
-        let sc_char = self
+        // Dict branch: use __mdh_dict_set
+        self.builder.position_at_end(dict_block);
+        let dict_result = self
             .builder
-            .build_load(self.context.i8_type(), sc_char_ptr, "sc_char")
+            .build_call(
+                self.libc.dict_set,
+                &[obj_val.into(), idx_val.into(), new_val.into()],
+                "dict_set_result",
+            )
             .unwrap()
-            .into_int_value();
-        let sc_is_delim = self
-            .builder
-            .build_int_compare(IntPredicate::EQ, sc_char, delim_byte, "sc_is_delim")
+            .try_as_basic_value()
+            .left()
+            .compile_ok_or("dict_set returned void").unwrap();
+
+        // Update the variable/field with the new dict (dict_set returns a new dict since it may reallocate)
+            match object {
+                Expr::Variable { name, .. } => {
+                    if let Some(&ptr) = self.variables.get(name) {
+                        self.builder
+                            .build_store(ptr, dict_result)
+                            .unwrap();
+                    }
+                }
+                Expr::Get {
+                    object: inner_obj,
+                    property,
+                ..
+            } => {
+                // Field access like masel.data - need to store updated dict back to the field
+                let instance_val = self.compile_expr(inner_obj)?;
+                self.compile_instance_set_field(instance_val, property, dict_result)?;
+            }
+            _ => {
+                // For other expressions we can't store back
+            }
+        }
+
+        self.builder
+            .build_unconditional_branch(merge_block)
             .unwrap();
+        let dict_end = self.builder.get_insert_block().unwrap();
 
-        // Increment count if delimiter
-        let sc_curr_count = self
-            .builder
-            .build_load(self.types.i64_type, sc_count_ptr, "sc_curr_count")
-            .unwrap()
-            .into_int_value();
-        let sc_new_count = self
+        // Check list tag
+        self.builder.position_at_end(check_list_block);
+        let list_tag = self
+            .types
+            .i8_type
+            .const_int(ValueTag::List.as_u8() as u64, false);
+        let is_list = self
             .builder
-            .build_int_add(sc_curr_count, sc_one, "sc_new_count")
+            .build_int_compare(IntPredicate::EQ, obj_tag, list_tag, "is_list")
             .unwrap();
-        let sc_count_to_store = self
-            .builder
-            .build_select(sc_is_delim, sc_new_count, sc_curr_count, "sc_count_sel")
-            .unwrap()
-            .into_int_value();
         self.builder
-            .build_store(sc_count_ptr, sc_count_to_store)
+            .build_conditional_branch(is_list, list_block, check_native_block)
             .unwrap();
 
-        // Increment i and loop back
-        let sc_next_i = self
+        // Native objects (typed arrays) store through __mdh_native_set
+        self.builder.position_at_end(check_native_block);
+        let native_tag = self
+            .types
+            .i8_type
+            .const_int(ValueTag::NativeObject.as_u8() as u64, false);
+        let is_native = self
             .builder
-            .build_int_add(sc_i, sc_one, "sc_next_i")
+            .build_int_compare(IntPredicate::EQ, obj_tag, native_tag, "is_native")
             .unwrap();
-        self.builder.build_store(sc_i_ptr, sc_next_i).unwrap();
         self.builder
-            .build_unconditional_branch(sc_count_body)
+            .build_conditional_branch(is_native, native_block, type_error_block)
             .unwrap();
 
-        // Count done - allocate list with exact size (count + 1 elements)
-        self.builder.position_at_end(sc_count_done);
-        let sc_final_count = self
-            .builder
-            .build_load(self.types.i64_type, sc_count_ptr, "sc_final_count")
-            .unwrap()
-            .into_int_value();
-        let sc_list_len = self
-            .builder
-            .build_int_add(sc_final_count, sc_one, "sc_list_len")
+        self.builder.position_at_end(native_block);
+        self.builder
+            .build_call(
+                self.libc.native_set,
+                &[obj_val.into(), idx_val.into(), new_val.into()],
+                "index_native_set",
+            )
+            .unwrap();
+        self.builder
+            .build_unconditional_branch(merge_block)
             .unwrap();
+        let native_end = self.builder.get_insert_block().unwrap();
+
+        // List branch: continue with original list handling
+        self.builder.position_at_end(list_block);
 
-        // Use allocate_list which creates proper MdhList struct
-        let sc_list_ptr = self.allocate_list(sc_list_len).unwrap();
+        // Extract the object's data (pointer to MdhList struct)
+        let obj_data = self.extract_data(obj_val).unwrap();
+
+        // Extract the index (assume it's an integer)
+        let idx_data = self.extract_data(idx_val).unwrap();
 
-        // Get items pointer for storing elements
+        // Convert list data to pointer to MdhList struct
         let i64_ptr_type = self.types.i64_type.ptr_type(AddressSpace::default());
-        let sc_list_i64_ptr = self
+        let list_ptr = self
             .builder
-            .build_pointer_cast(sc_list_ptr, i64_ptr_type, "sc_list_i64_ptr")
+            .build_int_to_ptr(obj_data, i64_ptr_type, "list_ptr")
             .unwrap();
-        let sc_items_ptr_i64 = self
+
+        // Load items pointer from offset 0 (unsharing it from any slice view)
+        let items_ptr_as_i64 = self.list_items_for_write(list_ptr)?;
+
+        // Get length pointer at offset 1
+        let len_ptr = unsafe {
+            self.builder
+                .build_gep(
+                    self.types.i64_type,
+                    list_ptr,
+                    &[self.types.i64_type.const_int(1, false)],
+                    "len_ptr",
+                )
+                .unwrap()
+        };
+
+        // Load length for bounds checking and negative index handling
+        let length = self
             .builder
-            .build_load(self.types.i64_type, sc_list_i64_ptr, "sc_items_ptr_i64")
+            .build_load(self.types.i64_type, len_ptr, "list_len")
             .unwrap()
             .into_int_value();
-        let value_ptr_type = self.types.value_type.ptr_type(AddressSpace::default());
-        let sc_items_ptr = self
-            .builder
-            .build_int_to_ptr(sc_items_ptr_i64, value_ptr_type, "sc_items_ptr")
-            .unwrap();
 
-        // Phase 2: Split and fill list
-        let sc_pos_ptr = self
-            .builder
-            .build_alloca(self.types.i64_type, "sc_pos")
-            .unwrap();
-        let sc_elem_idx_ptr = self
+        // Handle negative indices: if index < 0, index = length + index
+        let zero = self.types.i64_type.const_int(0, false);
+        let is_negative = self
             .builder
-            .build_alloca(self.types.i64_type, "sc_elem_idx")
+            .build_int_compare(inkwell::IntPredicate::SLT, idx_data, zero, "is_negative")
             .unwrap();
-        let sc_token_start_ptr = self
+
+        let adjusted_index = self
             .builder
-            .build_alloca(self.types.i64_type, "sc_token_start")
-            .unwrap();
-        self.builder.build_store(sc_pos_ptr, zero).unwrap();
-        self.builder.build_store(sc_elem_idx_ptr, zero).unwrap();
-        self.builder.build_store(sc_token_start_ptr, zero).unwrap();
-        self.builder
-            .build_unconditional_branch(sc_split_body)
+            .build_int_add(length, idx_data, "adjusted")
             .unwrap();
 
-        // Split loop - check if we've reached end
-        self.builder.position_at_end(sc_split_body);
-        let sc_pos = self
+        let final_index = self
             .builder
-            .build_load(self.types.i64_type, sc_pos_ptr, "sc_pos_val")
+            .build_select(is_negative, adjusted_index, idx_data, "final_index")
             .unwrap()
             .into_int_value();
-        let sc_split_end_cmp = self
+
+        // Convert items pointer to MdhValue pointer
+        let value_ptr_type = self.types.value_type.ptr_type(AddressSpace::default());
+        let items_ptr = self
             .builder
-            .build_int_compare(IntPredicate::UGE, sc_pos, str_len, "sc_split_end_cmp")
-            .unwrap();
-        self.builder
-            .build_conditional_branch(sc_split_end_cmp, sc_split_done, sc_split_block)
+            .build_int_to_ptr(items_ptr_as_i64, value_ptr_type, "items_ptr")
             .unwrap();
 
-        // Check current char for delimiter
-        self.builder.position_at_end(sc_split_block);
-        let sc_char_ptr2 = unsafe {
+        // Get pointer to the indexed element
+        let elem_ptr = unsafe {
             self.builder
-                .build_gep(self.context.i8_type(), str_ptr, &[sc_pos], "sc_char_ptr2")
+                .build_gep(self.types.value_type, items_ptr, &[final_index], "elem_ptr")
                 .unwrap()
         };
-        let sc_char2 = self
-            .builder
-            .build_load(self.context.i8_type(), sc_char_ptr2, "sc_char2")
-            .unwrap()
-            .into_int_value();
-        let sc_is_delim2 = self
-            .builder
-            .build_int_compare(IntPredicate::EQ, sc_char2, delim_byte, "sc_is_delim2")
-            .unwrap();
 
-        // Advance position
-        let sc_next_pos = self
-            .builder
-            .build_int_add(sc_pos, sc_one, "sc_next_pos")
+        // Store the new value at that location
+        self.builder
+            .build_store(elem_ptr, new_val)
             .unwrap();
-        self.builder.build_store(sc_pos_ptr, sc_next_pos).unwrap();
 
         self.builder
-            .build_conditional_branch(sc_is_delim2, sc_split_found, sc_split_body)
+            .build_unconditional_branch(merge_block)
             .unwrap();
+        let list_end = self.builder.get_insert_block().unwrap();
 
-        // Found delimiter - emit token
-        // Note: We need to recalculate position since sc_pos was an SSA value in another block
-        // The delimiter position is (current_pos - 1) since we already incremented
-        self.builder.position_at_end(sc_split_found);
-        let sc_curr_pos = self
-            .builder
-            .build_load(self.types.i64_type, sc_pos_ptr, "sc_curr_pos")
-            .unwrap()
-            .into_int_value();
-        let sc_delim_pos = self
+        // Type error branch
+        self.builder.position_at_end(type_error_block);
+        let op = self
             .builder
-            .build_int_sub(sc_curr_pos, sc_one, "sc_delim_pos")
+            .build_global_string_ptr("index_set", "index_set_op")
             .unwrap();
-        let sc_token_start = self
-            .builder
-            .build_load(self.types.i64_type, sc_token_start_ptr, "sc_ts")
-            .unwrap()
-            .into_int_value();
-        let sc_token_len = self
-            .builder
-            .build_int_sub(sc_delim_pos, sc_token_start, "sc_token_len")
+        self.builder
+            .build_call(
+                self.libc.type_error,
+                &[op.as_pointer_value().into(), obj_tag.into(), idx_tag.into()],
+                "",
+            )
+            .unwrap();
+        let err_val = self.make_nil();
+        self.builder
+            .build_unconditional_branch(merge_block)
             .unwrap();
+        let err_end = self.builder.get_insert_block().unwrap();
 
-        // Allocate token string
-        let sc_token_size = self
+        // Merge block
+        self.builder.position_at_end(merge_block);
+        let phi = self
             .builder
-            .build_int_add(sc_token_len, sc_one, "sc_token_size")
+            .build_phi(self.types.value_type, "set_result")
             .unwrap();
-        let sc_token_ptr = self
+        phi.add_incoming(&[
+            (&new_val, dict_end),
+            (&new_val, list_end),
+            (&new_val, native_end),
+            (&err_val, err_end),
+        ]);
+        // Return the value that was set (for chained assignments)
+        Ok(phi.as_basic_value())
+    }
+
+    /// Compile dict[key] = value using runtime function
+    fn compile_dict_index_set(
+        &mut self,
+        object: &Expr,
+        index: &Expr,
+        value: &Expr,
+    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
+        let obj_val = self.compile_expr(object)?;
+        let idx_val = self.compile_expr(index)?;
+        let new_val = self.compile_expr(value)?;
+
+        let dict_result = self
             .builder
-            .build_call(self.libc.malloc, &[sc_token_size.into()], "sc_token_ptr")
+            .build_call(
+                self.libc.dict_set,
+                &[obj_val.into(), idx_val.into(), new_val.into()],
+                "dict_set_result",
+            )
             .unwrap()
             .try_as_basic_value()
             .left()
-            .unwrap()
-            .into_pointer_value();
+            .compile_ok_or("dict_set returned void").unwrap();
 
-        // Copy token
-        let sc_src_ptr = unsafe {
-            self.builder
-                .build_gep(
-                    self.context.i8_type(),
-                    str_ptr,
-                    &[sc_token_start],
-                    "sc_src_ptr",
-                )
-                .unwrap()
+        // Update local variable binding when possible (dict_set returns a new dict since it may reallocate).
+        // For other expressions we can't store back - the update is lost.
+        if let Expr::Variable { name, .. } = object {
+            if let Some(&ptr) = self.variables.get(name) {
+                self.builder
+                    .build_store(ptr, dict_result)
+                    .unwrap(); }
+        }
+
+        Ok(new_val)
+    }
+
+    /// Fast path for list index assignment when types are known at compile time
+    /// MdhList struct layout: { MdhValue *items; int64_t length; int64_t capacity; }
+    fn compile_list_index_set_fast(
+        &mut self,
+        object: &Expr,
+        index: &Expr,
+        value: &Expr,
+    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
+        // Try to get list data from shadow (fastest path - avoids loading full MdhValue)
+        let list_data = if let Expr::Variable { name, .. } = object {
+            if let Some(&shadow) = self.list_ptr_shadows.get(name) {
+                // Load raw pointer from shadow
+                self.builder
+                    .build_load(self.types.i64_type, shadow, "list_ptr_shadow")
+                    .unwrap()
+                    .into_int_value()
+            } else {
+                let obj_val = self.compile_expr(object)?;
+                self.extract_data(obj_val).unwrap()
+            }
+        } else {
+            let obj_val = self.compile_expr(object)?;
+            self.extract_data(obj_val).unwrap()
         };
-        self.builder
-            .build_call(
-                self.libc.memcpy,
-                &[sc_token_ptr.into(), sc_src_ptr.into(), sc_token_len.into()],
-                "",
-            )
-            .unwrap();
 
-        // Null terminate
-        let sc_token_end = unsafe {
-            self.builder
-                .build_gep(
-                    self.context.i8_type(),
-                    sc_token_ptr,
-                    &[sc_token_len],
-                    "sc_token_end",
-                )
-                .unwrap()
+        // Get index as i64 directly (use shadow if available)
+        let idx_i64 = if let Some(i) = self.compile_int_expr(index) {
+            i
+        } else {
+            let idx_val = self.compile_expr(index)?;
+            self.extract_data(idx_val).unwrap()
         };
-        self.builder
-            .build_store(sc_token_end, self.context.i8_type().const_int(0, false))
-            .unwrap();
 
-        // Create string value
-        let sc_token_value = self.make_string(sc_token_ptr).unwrap();
-
-        // Store in list using items pointer
-        let sc_elem_idx = self
+        // Convert data to pointer to MdhList struct
+        let i64_ptr_type = self.types.i64_type.ptr_type(AddressSpace::default());
+        let list_ptr = self
             .builder
-            .build_load(self.types.i64_type, sc_elem_idx_ptr, "sc_elem_idx_val")
-            .unwrap()
-            .into_int_value();
-        let sc_elem_ptr = unsafe {
+            .build_int_to_ptr(list_data, i64_ptr_type, "list_ptr_set_fast")
+            .unwrap();
+
+        // Load length from MdhList offset 1 for negative index handling
+        let len_ptr = unsafe {
             self.builder
                 .build_gep(
-                    self.types.value_type,
-                    sc_items_ptr,
-                    &[sc_elem_idx],
-                    "sc_elem_ptr",
+                    self.types.i64_type,
+                    list_ptr,
+                    &[self.types.i64_type.const_int(1, false)],
+                    "len_ptr_set_fast",
                 )
                 .unwrap()
         };
-        self.builder
-            .build_store(sc_elem_ptr, sc_token_value)
-            .unwrap();
-
-        // Update token start and element index
-        // sc_curr_pos is already the position after the delimiter
-        self.builder
-            .build_store(sc_token_start_ptr, sc_curr_pos)
-            .unwrap();
-        let sc_next_elem = self
-            .builder
-            .build_int_add(sc_elem_idx, sc_one, "sc_next_elem")
-            .unwrap();
-        self.builder
-            .build_store(sc_elem_idx_ptr, sc_next_elem)
-            .unwrap();
-
-        self.builder
-            .build_unconditional_branch(sc_split_body)
-            .unwrap();
-
-        // Split done - add final token
-        self.builder.position_at_end(sc_split_done);
-        let sc_final_start = self
+        let length = self
             .builder
-            .build_load(self.types.i64_type, sc_token_start_ptr, "sc_final_start")
+            .build_load(self.types.i64_type, len_ptr, "list_len_set_fast")
             .unwrap()
             .into_int_value();
-        let sc_final_len = self
-            .builder
-            .build_int_sub(str_len, sc_final_start, "sc_final_len")
-            .unwrap();
 
-        // Allocate final token
-        let sc_final_size = self
+        // Handle negative indices: final_index = (idx < 0) ? (len + idx) : idx
+        let zero_i64 = self.types.i64_type.const_int(0, false);
+        let is_negative = self
             .builder
-            .build_int_add(sc_final_len, sc_one, "sc_final_size")
+            .build_int_compare(IntPredicate::SLT, idx_i64, zero_i64, "idx_is_negative")
             .unwrap();
-        let sc_final_ptr = self
+        let adjusted_index = self
             .builder
-            .build_call(self.libc.malloc, &[sc_final_size.into()], "sc_final_ptr")
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .unwrap()
-            .into_pointer_value();
-
-        // Copy final token
-        let sc_final_src = unsafe {
-            self.builder
-                .build_gep(
-                    self.context.i8_type(),
-                    str_ptr,
-                    &[sc_final_start],
-                    "sc_final_src",
-                )
-                .unwrap()
-        };
-        self.builder
-            .build_call(
-                self.libc.memcpy,
-                &[
-                    sc_final_ptr.into(),
-                    sc_final_src.into(),
-                    sc_final_len.into(),
-                ],
-                "",
-            )
-            .unwrap();
-
-        // Null terminate
-        let sc_final_end = unsafe {
-            self.builder
-                .build_gep(
-                    self.context.i8_type(),
-                    sc_final_ptr,
-                    &[sc_final_len],
-                    "sc_final_end",
-                )
-                .unwrap()
-        };
-        self.builder
-            .build_store(sc_final_end, self.context.i8_type().const_int(0, false))
+            .build_int_add(length, idx_i64, "idx_adjusted")
             .unwrap();
-
-        // Create final string value
-        let sc_final_value = self.make_string(sc_final_ptr).unwrap();
-
-        // Store final in list using items pointer
-        let sc_final_idx = self
+        let final_index = self
             .builder
-            .build_load(self.types.i64_type, sc_elem_idx_ptr, "sc_final_idx")
+            .build_select(is_negative, adjusted_index, idx_i64, "idx_final")
             .unwrap()
             .into_int_value();
-        let sc_final_elem = unsafe {
-            self.builder
-                .build_gep(
-                    self.types.value_type,
-                    sc_items_ptr,
-                    &[sc_final_idx],
-                    "sc_final_elem",
-                )
-                .unwrap()
-        };
-        self.builder
-            .build_store(sc_final_elem, sc_final_value)
-            .unwrap();
 
-        // Create result and branch to merge
-        let sc_result = self.make_list(sc_list_ptr).unwrap();
-        self.builder
-            .build_unconditional_branch(merge_block)
-            .unwrap();
-        let sc_split_end_block = self.builder.get_insert_block().unwrap();
+        // Compile the value to store
+        let new_val = self.compile_expr(value)?;
 
-        // Empty delimiter case: return list containing the original string
-        self.builder.position_at_end(empty_delim_block);
-        let one_elem_list = self.allocate_list(self.types.i64_type.const_int(1, false)).unwrap();
-        let i64_ptr_type = self.types.i64_type.ptr_type(AddressSpace::default());
-        let one_len_ptr = self
+        // Load items pointer from offset 0 (after the value, which may slice or grow the list)
+        let items_ptr_as_i64 = self.list_items_for_write(list_ptr)?;
+
+        // Convert items pointer to MdhValue pointer
+        let value_ptr_type = self.types.value_type.ptr_type(AddressSpace::default());
+        let items_ptr = self
             .builder
-            .build_pointer_cast(one_elem_list, i64_ptr_type, "one_len_ptr")
-            .unwrap();
-        self.builder
-            .build_store(one_len_ptr, self.types.i64_type.const_int(1, false))
+            .build_int_to_ptr(items_ptr_as_i64, value_ptr_type, "items_ptr_set")
             .unwrap();
-        // Store original string as element 0
-        let header_size_const = self.types.i64_type.const_int(16, false);
-        let elem_ptr_empty = unsafe {
+
+        // Get pointer to the indexed element
+        let elem_ptr = unsafe {
             self.builder
                 .build_gep(
-                    self.context.i8_type(),
-                    one_elem_list,
-                    &[header_size_const],
-                    "elem_ptr_empty",
+                    self.types.value_type,
+                    items_ptr,
+                    &[final_index],
+                    "elem_ptr_set_fast",
                 )
                 .unwrap()
         };
-        let value_ptr_empty = self
-            .builder
-            .build_pointer_cast(
-                elem_ptr_empty,
-                self.types.value_type.ptr_type(AddressSpace::default()),
-                "value_ptr_empty",
-            )
-            .unwrap();
-        self.builder.build_store(value_ptr_empty, str_val).unwrap();
-        let empty_result = self.make_list(one_elem_list).unwrap();
+
+        // Store the new value at that location
         self.builder
-            .build_unconditional_branch(merge_block)
+            .build_store(elem_ptr, new_val)
             .unwrap();
-        let empty_delim_end = self.builder.get_insert_block().unwrap();
-
-        // Normal split case
-        self.builder.position_at_end(normal_split_block);
 
-        // Allocate list with space for up to 100 elements initially
-        // List format: [i64 length][value elem0][value elem1]...
-        let header_size = self.types.i64_type.const_int(16, false);
-        let elem_size = self.types.i64_type.const_int(16, false);
-        let max_elems = self.types.i64_type.const_int(100, false);
-        let initial_size = self
-            .builder
-            .build_int_add(
-                header_size,
-                self.builder
-                    .build_int_mul(max_elems, elem_size, "elems_size")
-                    .unwrap(),
-                "initial_size",
-            )
-            .unwrap();
+        // Return the value that was set
+        Ok(new_val)
+    }
 
-        let list_ptr = self
+    /// Helper for string indexing (return single character as string)
+    fn compile_string_index(
+        &self,
+        str_val: BasicValueEnum<'ctx>,
+        index: IntValue<'ctx>,
+    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
+        // The runtime counts characters, not bytes, and hurls on a bad index
+        Ok(self
             .builder
-            .build_call(self.libc.malloc, &[initial_size.into()], "list_ptr")
+            .build_call(self.libc.str_char_at, &[str_val.into(), index.into()], "str_char")
             .unwrap()
             .try_as_basic_value()
             .left()
-            .unwrap()
-            .into_pointer_value();
+            .compile_ok_or("str_char_at returned void").unwrap())
+    }
 
-        // Initialize length to 0
-        let i64_ptr_type = self.types.i64_type.ptr_type(AddressSpace::default());
-        let len_ptr = self
-            .builder
-            .build_pointer_cast(list_ptr, i64_ptr_type, "len_ptr")
-            .unwrap();
-        self.builder
-            .build_store(len_ptr, self.types.i64_type.const_int(0, false))
-            .unwrap();
+    // ===== Phase 5: Timing functions =====
 
-        // Allocate counters on stack
-        let pos_ptr = self
+    /// noo() - Returns current time in milliseconds since epoch (CLOCK_REALTIME)
+    fn inline_noo(&mut self) -> Result<BasicValueEnum<'ctx>, HaversError> {
+        // Create struct timespec { i64 tv_sec; i64 tv_nsec; } on stack
+        let timespec_type = self.context.struct_type(
+            &[self.types.i64_type.into(), self.types.i64_type.into()],
+            false,
+        );
+
+        let timespec_ptr = self
             .builder
-            .build_alloca(self.types.i64_type, "pos")
+            .build_alloca(timespec_type, "timespec")
             .unwrap();
-        let count_ptr = self
+
+        // CLOCK_REALTIME = 0
+        let clock_id = self.context.i32_type().const_int(0, false);
+
+        // Cast timespec_ptr to i8* for clock_gettime
+        let timespec_i8_ptr = self
             .builder
-            .build_alloca(self.types.i64_type, "count")
-            .unwrap();
-        self.builder
-            .build_store(pos_ptr, self.types.i64_type.const_int(0, false))
+            .build_pointer_cast(
+                timespec_ptr,
+                self.context.i8_type().ptr_type(AddressSpace::default()),
+                "timespec_i8_ptr",
+            )
             .unwrap();
+
+        // Call clock_gettime(CLOCK_REALTIME, &ts)
         self.builder
-            .build_store(count_ptr, self.types.i64_type.const_int(0, false))
+            .build_call(
+                self.libc.clock_gettime,
+                &[clock_id.into(), timespec_i8_ptr.into()],
+                "clock_result",
+            )
             .unwrap();
 
-        // Store list_ptr in an alloca so we can read it in the loop
-        let list_ptr_alloca = self
+        // Read tv_sec
+        let sec_ptr = self
             .builder
-            .build_alloca(i8_ptr_type, "list_ptr_alloca")
+            .build_struct_gep(timespec_type, timespec_ptr, 0, "sec_ptr")
             .unwrap();
-        self.builder.build_store(list_ptr_alloca, list_ptr).unwrap();
-
-        // Loop to find delimiters and split
-        let loop_block = self.context.append_basic_block(function, "split_loop");
-        let found_block = self.context.append_basic_block(function, "split_found");
-        let not_found_block = self.context.append_basic_block(function, "split_not_found");
-        let add_token_block = self.context.append_basic_block(function, "add_token");
-        let done_block = self.context.append_basic_block(function, "split_done");
-
-        self.builder.build_unconditional_branch(loop_block).unwrap();
-        self.builder.position_at_end(loop_block);
-
-        // Get current position
-        let pos = self
+        let tv_sec = self
             .builder
-            .build_load(self.types.i64_type, pos_ptr, "pos_val")
+            .build_load(self.types.i64_type, sec_ptr, "tv_sec")
             .unwrap()
             .into_int_value();
 
-        // Check if we've reached end of string
-        let at_end = self
+        // Read tv_nsec
+        let nsec_ptr = self
             .builder
-            .build_int_compare(IntPredicate::UGE, pos, str_len, "at_end")
-            .unwrap();
-        self.builder
-            .build_conditional_branch(at_end, done_block, found_block)
+            .build_struct_gep(timespec_type, timespec_ptr, 1, "nsec_ptr")
             .unwrap();
-
-        // Search for delimiter starting at current position
-        self.builder.position_at_end(found_block);
-        let search_ptr = unsafe {
-            self.builder
-                .build_gep(self.context.i8_type(), str_ptr, &[pos], "search_ptr")
-                .unwrap()
-        };
-        let found_ptr = self
+        let tv_nsec = self
             .builder
-            .build_call(
-                self.libc.strstr,
-                &[search_ptr.into(), delim_ptr.into()],
-                "found_ptr",
-            )
-            .unwrap()
-            .try_as_basic_value()
-            .left()
+            .build_load(self.types.i64_type, nsec_ptr, "tv_nsec")
             .unwrap()
-            .into_pointer_value();
+            .into_int_value();
 
-        let null = i8_ptr_type.const_null();
-        let is_found = self
+        // Convert to milliseconds: (tv_sec * 1000) + (tv_nsec / 1_000_000)
+        let thousand = self.types.i64_type.const_int(1000, false);
+        let million = self.types.i64_type.const_int(1_000_000, false);
+
+        let sec_ms = self
             .builder
-            .build_int_compare(IntPredicate::NE, found_ptr, null, "is_found")
-            .unwrap();
-        self.builder
-            .build_conditional_branch(is_found, add_token_block, not_found_block)
+            .build_int_mul(tv_sec, thousand, "sec_ms")
             .unwrap();
-
-        // Found delimiter - add token from pos to found_ptr
-        self.builder.position_at_end(add_token_block);
-        let found_as_int = self
+        let nsec_ms = self
             .builder
-            .build_ptr_to_int(found_ptr, self.types.i64_type, "found_int")
+            .build_int_signed_div(tv_nsec, million, "nsec_ms")
             .unwrap();
-        let search_as_int = self
+        let total_ms = self
             .builder
-            .build_ptr_to_int(search_ptr, self.types.i64_type, "search_int")
+            .build_int_add(sec_ms, nsec_ms, "total_ms")
             .unwrap();
-        let token_len = self
+
+        self.make_int(total_ms)
+    }
+
+    /// tick() - Returns time in nanoseconds since epoch (CLOCK_REALTIME)
+    fn inline_tick(&mut self) -> Result<BasicValueEnum<'ctx>, HaversError> {
+        // Create struct timespec { i64 tv_sec; i64 tv_nsec; } on stack
+        let timespec_type = self.context.struct_type(
+            &[self.types.i64_type.into(), self.types.i64_type.into()],
+            false,
+        );
+
+        let timespec_ptr = self
             .builder
-            .build_int_sub(found_as_int, search_as_int, "token_len")
+            .build_alloca(timespec_type, "timespec")
             .unwrap();
 
-        // Allocate and copy token
-        let token_alloc_size = self
+        // CLOCK_REALTIME = 0 (match interpreter's SystemTime)
+        let clock_id = self.context.i32_type().const_int(0, false);
+
+        // Cast timespec_ptr to i8* for clock_gettime
+        let timespec_i8_ptr = self
             .builder
-            .build_int_add(
-                token_len,
-                self.types.i64_type.const_int(1, false),
-                "alloc_size",
+            .build_pointer_cast(
+                timespec_ptr,
+                self.context.i8_type().ptr_type(AddressSpace::default()),
+                "timespec_i8_ptr",
             )
             .unwrap();
-        let token_ptr = self
-            .builder
-            .build_call(self.libc.malloc, &[token_alloc_size.into()], "token_ptr")
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .unwrap()
-            .into_pointer_value();
 
-        // Copy token bytes
+        // Call clock_gettime(CLOCK_REALTIME, &ts)
         self.builder
             .build_call(
-                self.libc.memcpy,
-                &[token_ptr.into(), search_ptr.into(), token_len.into()],
-                "copy_token",
+                self.libc.clock_gettime,
+                &[clock_id.into(), timespec_i8_ptr.into()],
+                "clock_result",
             )
             .unwrap();
 
-        // Null-terminate
-        let token_end = unsafe {
-            self.builder
-                .build_gep(self.context.i8_type(), token_ptr, &[token_len], "token_end")
-                .unwrap()
-        };
-        self.builder
-            .build_store(token_end, self.context.i8_type().const_int(0, false))
+        // Read tv_sec
+        let sec_ptr = self
+            .builder
+            .build_struct_gep(timespec_type, timespec_ptr, 0, "sec_ptr")
             .unwrap();
-
-        // Create string value and add to list
-        let token_value = self.make_string(token_ptr).unwrap();
-
-        // Get current count and list pointer
-        let count = self
+        let tv_sec = self
             .builder
-            .build_load(self.types.i64_type, count_ptr, "count_val")
+            .build_load(self.types.i64_type, sec_ptr, "tv_sec")
             .unwrap()
             .into_int_value();
-        let current_list_ptr = self
-            .builder
-            .build_load(i8_ptr_type, list_ptr_alloca, "current_list")
-            .unwrap()
-            .into_pointer_value();
 
-        // Calculate element offset: 8 + count * 16
-        let elem_offset = self
-            .builder
-            .build_int_add(
-                header_size,
-                self.builder
-                    .build_int_mul(count, elem_size, "elem_mul")
-                    .unwrap(),
-                "elem_offset",
-            )
-            .unwrap();
-        let elem_ptr = unsafe {
-            self.builder
-                .build_gep(
-                    self.context.i8_type(),
-                    current_list_ptr,
-                    &[elem_offset],
-                    "elem_ptr",
-                )
-                .unwrap()
-        };
-        let value_ptr = self
+        // Read tv_nsec
+        let nsec_ptr = self
             .builder
-            .build_pointer_cast(
-                elem_ptr,
-                self.types.value_type.ptr_type(AddressSpace::default()),
-                "value_ptr",
-            )
+            .build_struct_gep(timespec_type, timespec_ptr, 1, "nsec_ptr")
             .unwrap();
-        self.builder.build_store(value_ptr, token_value).unwrap();
-
-        // Increment count
-        let new_count = self
+        let tv_nsec = self
             .builder
-            .build_int_add(count, self.types.i64_type.const_int(1, false), "new_count")
-            .unwrap();
-        self.builder.build_store(count_ptr, new_count).unwrap();
+            .build_load(self.types.i64_type, nsec_ptr, "tv_nsec")
+            .unwrap()
+            .into_int_value();
 
-        // Update position to after delimiter
-        let new_pos = self
+        // Convert to nanoseconds: (tv_sec * 1_000_000_000) + tv_nsec
+        let billion = self.types.i64_type.const_int(1_000_000_000, false);
+        let sec_ns = self
             .builder
-            .build_int_add(pos, token_len, "after_token")
+            .build_int_mul(tv_sec, billion, "sec_ns")
             .unwrap();
-        let new_pos = self
+        let total_ns = self
             .builder
-            .build_int_add(new_pos, delim_len, "after_delim")
+            .build_int_add(sec_ns, tv_nsec, "total_ns")
             .unwrap();
-        self.builder.build_store(pos_ptr, new_pos).unwrap();
 
-        self.builder.build_unconditional_branch(loop_block).unwrap();
-
-        // Not found - add rest of string as final token
-        self.builder.position_at_end(not_found_block);
-        let rest_ptr = unsafe {
-            self.builder
-                .build_gep(self.context.i8_type(), str_ptr, &[pos], "rest_ptr")
-                .unwrap()
-        };
+        self.make_int(total_ns)
+    }
 
-        // Duplicate the rest of the string
-        let rest_copy = self
+    /// bide(ms) - Sleep for specified milliseconds
+    fn inline_bide(
+        &mut self,
+        ms_val: BasicValueEnum<'ctx>,
+    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
+        // Extract the integer value from the tagged value
+        let ms_struct = ms_val.into_struct_value();
+        let ms = self
             .builder
-            .build_call(self.libc.strdup, &[rest_ptr.into()], "rest_copy")
-            .unwrap()
-            .try_as_basic_value()
-            .left()
+            .build_extract_value(ms_struct, 1, "ms_data")
             .unwrap()
-            .into_pointer_value();
+            .into_int_value();
 
-        let rest_value = self.make_string(rest_copy).unwrap();
+        // Create struct timespec { i64 tv_sec; i64 tv_nsec; } on stack
+        let timespec_type = self.context.struct_type(
+            &[self.types.i64_type.into(), self.types.i64_type.into()],
+            false,
+        );
 
-        // Get current count and list pointer for final add
-        let final_count = self
-            .builder
-            .build_load(self.types.i64_type, count_ptr, "final_count")
-            .unwrap()
-            .into_int_value();
-        let final_list_ptr = self
-            .builder
-            .build_load(i8_ptr_type, list_ptr_alloca, "final_list")
-            .unwrap()
-            .into_pointer_value();
+        let req_ptr = self.builder.build_alloca(timespec_type, "req").unwrap();
 
-        // Add rest to list
-        let final_offset = self
+        // Convert ms to seconds and nanoseconds
+        // tv_sec = ms / 1000
+        // tv_nsec = (ms % 1000) * 1_000_000
+        let thousand = self.types.i64_type.const_int(1000, false);
+        let million = self.types.i64_type.const_int(1_000_000, false);
+
+        let tv_sec = self
             .builder
-            .build_int_add(
-                header_size,
-                self.builder
-                    .build_int_mul(final_count, elem_size, "final_mul")
-                    .unwrap(),
-                "final_offset",
-            )
+            .build_int_signed_div(ms, thousand, "tv_sec")
             .unwrap();
-        let final_elem_ptr = unsafe {
-            self.builder
-                .build_gep(
-                    self.context.i8_type(),
-                    final_list_ptr,
-                    &[final_offset],
-                    "final_elem_ptr",
-                )
-                .unwrap()
-        };
-        let final_value_ptr = self
+        let ms_remainder = self
             .builder
-            .build_pointer_cast(
-                final_elem_ptr,
-                self.types.value_type.ptr_type(AddressSpace::default()),
-                "final_value_ptr",
-            )
+            .build_int_signed_rem(ms, thousand, "ms_remainder")
             .unwrap();
-        self.builder
-            .build_store(final_value_ptr, rest_value)
+        let tv_nsec = self
+            .builder
+            .build_int_mul(ms_remainder, million, "tv_nsec")
             .unwrap();
 
-        // Update count
-        let total_count = self
+        // Store tv_sec and tv_nsec
+        let sec_ptr = self
             .builder
-            .build_int_add(
-                final_count,
-                self.types.i64_type.const_int(1, false),
-                "total_count",
-            )
+            .build_struct_gep(timespec_type, req_ptr, 0, "sec_ptr")
             .unwrap();
-        self.builder.build_store(count_ptr, total_count).unwrap();
-
-        self.builder.build_unconditional_branch(done_block).unwrap();
+        self.builder.build_store(sec_ptr, tv_sec).unwrap();
 
-        // Done - set length and return list
-        self.builder.position_at_end(done_block);
-        let done_list_ptr = self
-            .builder
-            .build_load(i8_ptr_type, list_ptr_alloca, "done_list")
-            .unwrap()
-            .into_pointer_value();
-        let done_count = self
+        let nsec_ptr = self
             .builder
-            .build_load(self.types.i64_type, count_ptr, "done_count")
-            .unwrap()
-            .into_int_value();
+            .build_struct_gep(timespec_type, req_ptr, 1, "nsec_ptr")
+            .unwrap();
+        self.builder.build_store(nsec_ptr, tv_nsec).unwrap();
 
-        // Store final length
-        let done_len_ptr = self
+        // Cast req_ptr to i8* for nanosleep
+        let req_i8_ptr = self
             .builder
-            .build_pointer_cast(done_list_ptr, i64_ptr_type, "done_len_ptr")
+            .build_pointer_cast(
+                req_ptr,
+                self.context.i8_type().ptr_type(AddressSpace::default()),
+                "req_i8_ptr",
+            )
             .unwrap();
-        self.builder.build_store(done_len_ptr, done_count).unwrap();
 
-        // Create list value for normal case
-        let normal_result = self.make_list(done_list_ptr).unwrap();
+        // Pass null for the second argument (remaining time)
+        let null = self
+            .context
+            .i8_type()
+            .ptr_type(AddressSpace::default())
+            .const_null();
+
+        // Call nanosleep(&req, NULL)
         self.builder
-            .build_unconditional_branch(merge_block)
+            .build_call(
+                self.libc.nanosleep,
+                &[req_i8_ptr.into(), null.into()],
+                "sleep_result",
+            )
             .unwrap();
-        let normal_split_end = self.builder.get_insert_block().unwrap();
 
-        // Merge block - use phi to select result
-        self.builder.position_at_end(merge_block);
-        let phi = self
-            .builder
-            .build_phi(self.types.value_type, "split_result")
-            .unwrap();
-        phi.add_incoming(&[
-            (&empty_result, empty_delim_end),
-            (&sc_result, sc_split_end_block),
-            (&normal_result, normal_split_end),
-        ]);
-        Ok(phi.as_basic_value())
+        // Return nil
+        Ok(self.make_nil())
     }
 
+    // ===== Extra: String operations =====
+
     /// join(list, delimiter) - Join list elements with delimiter
     fn inline_join(
         &mut self,
@@ -25167,7 +28987,7 @@ impl<'ctx> CodeGen<'ctx> {
 
         let result_buf = self
             .builder
-            .build_call(self.libc.malloc, &[alloc_size.into()], "result_buf")
+            .build_call(self.libc.malloc_atomic, &[alloc_size.into()], "result_buf")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -25792,6 +29612,63 @@ impl<'ctx> CodeGen<'ctx> {
         }
     }
 
+    /// Collect the names a statement declares for itself: `ken`, `fer`, catch, match and
+    /// destructure bindings, imports and nested functions, in any nested block.
+    fn collect_declared_names(&self, stmt: &Stmt, names: &mut HashSet<String>) {
+        match stmt {
+            Stmt::VarDecl { name, .. } | Stmt::Function { name, .. } => {
+                names.insert(name.clone());
+            }
+            Stmt::Import {
+                alias: Some(alias), ..
+            } => {
+                names.insert(alias.clone());
+            }
+            Stmt::Block { statements, .. } => {
+                for s in statements {
+                    self.collect_declared_names(s, names);
+                }
+            }
+            Stmt::If {
+                then_branch,
+                else_branch,
+                ..
+            } => {
+                self.collect_declared_names(then_branch, names);
+                if let Some(else_stmt) = else_branch {
+                    self.collect_declared_names(else_stmt, names);
+                }
+            }
+            Stmt::While { body, .. } => self.collect_declared_names(body, names),
+            Stmt::For { variable, body, .. } => {
+                names.insert(variable.clone());
+                self.collect_declared_names(body, names);
+            }
+            Stmt::TryCatch {
+                try_block,
+                error_name,
+                catch_block,
+                ..
+            } => {
+                names.insert(error_name.clone());
+                self.collect_declared_names(try_block, names);
+                self.collect_declared_names(catch_block, names);
+            }
+            Stmt::Match { arms, .. } => {
+                for arm in arms {
+                    self.collect_pattern_bindings(&arm.pattern, names);
+                    self.collect_declared_names(&arm.body, names);
+                }
+            }
+            Stmt::Destructure { patterns, .. } => {
+                for pattern in patterns {
+                    self.add_destruct_pattern_bindings(pattern, names);
+                }
+            }
+            _ => {}
+        }
+    }
+
     /// Add destructure pattern bindings
     fn add_destruct_pattern_bindings(
         &self,
@@ -25811,9 +29688,10 @@ impl<'ctx> CodeGen<'ctx> {
 
     /// Compile a lambda expression into an LLVM function and return a function pointer value
     ///
-    /// For closures (lambdas that capture outer variables), we create a "fat closure"
-    /// represented as a list: [fn_ptr, captured_val1, captured_val2, ...]
-    /// The function signature includes the captured variables as extra leading parameters.
+    /// A lambda that captures outer variables becomes a closure: its env block holds the
+    /// function and the captured values ([fn, capture1, capture2, ...], see `build_closure`),
+    /// and the function takes a pointer to that block as a hidden first parameter. Captures
+    /// are read from the env where the body uses them rather than unpacked at every call.
     fn compile_lambda(
         &mut self,
         params: &[String],
@@ -25859,14 +29737,17 @@ impl<'ctx> CodeGen<'ctx> {
             }
         }
 
-        // Create function type: captured vars first, then regular params
-        // (capture1, capture2, ..., param1, param2, ...) -> value
-        let total_params = captures.len() + params.len();
-        let param_types: Vec<BasicMetadataTypeEnum> = (0..total_params)
-            .map(|_| self.types.value_type.into())
-            .collect();
+        // Create function type: the env pointer (closures only), then regular params
+        let mut param_types: Vec<BasicMetadataTypeEnum> = Vec::new();
+        if !captures.is_empty() {
+            let env_ptr_type = self.context.i8_type().ptr_type(AddressSpace::default());
+            param_types.push(env_ptr_type.into());
+        }
+        let value_type = BasicMetadataTypeEnum::from(self.types.value_type);
+        param_types.extend(params.iter().map(|_| value_type));
         let fn_type = self.types.value_type.fn_type(&param_types, false);
         let lambda_fn = self.module.add_function(&lambda_name, fn_type, None);
+        self.note_frame(lambda_fn, "<lambda>", body.span().line);
 
         // Save current state
         let saved_function = self.current_function;
@@ -25877,6 +29758,11 @@ impl<'ctx> CodeGen<'ctx> {
         let saved_string_len_shadows = self.string_len_shadows.clone();
         let saved_string_cap_shadows = self.string_cap_shadows.clone();
         let saved_boxed_vars = self.boxed_vars.clone();
+        let saved_numeric_locals = std::mem::replace(
+            &mut self.numeric_locals,
+            super::infer::numeric_locals_in_expr(params, body),
+        );
+        let saved_return_type = std::mem::replace(&mut self.return_type, VarType::Unknown);
         let saved_block = self.builder.get_insert_block();
         let saved_masel = self.current_masel;
 
@@ -25895,32 +29781,53 @@ impl<'ctx> CodeGen<'ctx> {
         self.boxed_vars.clear();
         self.current_masel = None;
 
-        // Bind captured variables (they come first in the parameter list)
-        for (i, capture_name) in captures.iter().enumerate() {
-            let alloca = self
-                .builder
-                .build_alloca(self.types.value_type, capture_name)
-                .unwrap();
-            let param_val = lambda_fn.get_nth_param(i as u32).unwrap();
-            self.builder.build_store(alloca, param_val).unwrap();
-            self.variables.insert(capture_name.clone(), alloca);
+        // Captured variables live in the env: each name is bound to its slot, so a read
+        // loads it there (the slot holds the variable's box, or `masel` itself). A name the
+        // body declares again gets a copy for the call instead, so the new binding can't
+        // leak into the env and the closure's later calls.
+        let param_offset = usize::from(!captures.is_empty());
+        if !captures.is_empty() {
+            let mut declared = HashSet::new();
+            if let Expr::BlockExpr { statements, .. } = body {
+                for stmt in statements {
+                    self.collect_declared_names(stmt, &mut declared);
+                }
+            }
+            let env = lambda_fn
+                .get_first_param()
+                .compile_ok_or("Missing closure env")?
+                .into_pointer_value();
+            for (i, capture_name) in captures.iter().enumerate() {
+                let mut slot = self.closure_slot_ptr(env, (i + 1) as u64, capture_name);
+                if declared.contains(capture_name) {
+                    let captured = self
+                        .builder
+                        .build_load(self.types.value_type, slot, capture_name)
+                        .unwrap();
+                    slot = self
+                        .builder
+                        .build_alloca(self.types.value_type, capture_name)
+                        .unwrap();
+                    self.builder.build_store(slot, captured).unwrap();
+                }
+                self.variables.insert(capture_name.clone(), slot);
 
-            // If this is the captured 'masel', set current_masel so Expr::Masel works
-            if capture_name == "masel" {
-                self.current_masel = Some(alloca);
-            } else {
-                self.boxed_vars.insert(capture_name.clone());
+                // If this is the captured 'masel', set current_masel so Expr::Masel works
+                if capture_name == "masel" {
+                    self.current_masel = Some(slot);
+                } else {
+                    self.boxed_vars.insert(capture_name.clone());
+                }
             }
         }
 
-        // Create allocas for regular parameters (after captures)
-        let capture_count = captures.len();
+        // Create allocas for regular parameters (after the env)
         for (i, param_name) in params.iter().enumerate() {
             let alloca = self
                 .builder
                 .build_alloca(self.types.value_type, param_name)
                 .unwrap();
-            let param_val = lambda_fn.get_nth_param((capture_count + i) as u32).unwrap();
+            let param_val = lambda_fn.get_nth_param((param_offset + i) as u32).unwrap();
             self.builder.build_store(alloca, param_val).unwrap();
             self.variables.insert(param_name.clone(), alloca);
         }
@@ -25957,6 +29864,8 @@ impl<'ctx> CodeGen<'ctx> {
         self.string_len_shadows = saved_string_len_shadows;
         self.string_cap_shadows = saved_string_cap_shadows;
         self.boxed_vars = saved_boxed_vars;
+        self.numeric_locals = saved_numeric_locals;
+        self.return_type = saved_return_type;
         self.current_masel = saved_masel;
         if let Some(block) = saved_block {
             self.builder.position_at_end(block);
@@ -25964,15 +29873,27 @@ impl<'ctx> CodeGen<'ctx> {
 
         // Register lambda as a callable function
         self.functions.insert(lambda_name.clone(), lambda_fn);
+        self.last_lambda = Some(lambda_fn);
 
-        // Track captures for this lambda
-        if !captures.is_empty() {
-            self.function_captures
-                .insert(lambda_name.clone(), captures.clone());
+        if captures.is_empty() {
+            // Simple lambda - just return function value
+            return Ok(self.function_value(lambda_fn).into());
         }
+        let capture_vals: Vec<BasicValueEnum<'ctx>> = capture_allocas
+            .iter()
+            .enumerate()
+            .map(|(i, alloca)| {
+                self.builder
+                    .build_load(self.types.value_type, *alloca, &format!("cap{}_closure", i))
+                    .unwrap()
+            })
+            .collect();
+        Ok(self.build_closure(lambda_fn, &capture_vals))
+    }
 
-        // Create function pointer value
-        let fn_ptr = lambda_fn.as_global_value().as_pointer_value();
+    /// A Function-tagged value pointing at `function`.
+    fn function_value(&self, function: FunctionValue<'ctx>) -> StructValue<'ctx> {
+        let fn_ptr = function.as_global_value().as_pointer_value();
         let fn_ptr_int = self
             .builder
             .build_ptr_to_int(fn_ptr, self.types.i64_type, "fn_ptr_int")
@@ -25986,142 +29907,334 @@ impl<'ctx> CodeGen<'ctx> {
             .builder
             .build_insert_value(undef, fn_tag, 0, "v1")
             .unwrap();
-        let fn_val = self
-            .builder
+        self.builder
             .build_insert_value(v1, fn_ptr_int, 1, "fn_val")
             .unwrap()
-            .into_struct_value();
+            .into_struct_value()
+    }
 
-        // If there are captures, create a closure list: [fn_ptr, capture1, capture2, ...]
-        // Tag=Closure for captured lambdas (treated as function values)
-        if captures.is_empty() {
-            // Simple lambda - just return function value
-            Ok(fn_val.into())
-        } else {
-            // Create a closure list containing fn pointer and captured values
-            // Use our compile_list mechanism but manually build the list
-            let closure_len = 1 + captures.len(); // fn_ptr + captures
-            let value_size = 16u64;
-            let header_size = 16u64;
-            let total_size = header_size + (closure_len as u64) * value_size;
-
-            let size_val = self.types.i64_type.const_int(total_size, false);
-            let list_ptr = self
-                .builder
-                .build_call(self.libc.malloc, &[size_val.into()], "closure_ptr")
+    /// Slot `index` of a closure env; slot 0 holds the function and the captures follow.
+    fn closure_slot_ptr(
+        &self,
+        env: PointerValue<'ctx>,
+        index: u64,
+        name: &str,
+    ) -> PointerValue<'ctx> {
+        let offset = 16 + index * 16; // past the [capacity, length] header
+        let slot = unsafe {
+            self.builder
+                .build_gep(
+                    self.context.i8_type(),
+                    env,
+                    &[self.types.i64_type.const_int(offset, false)],
+                    &format!("{}_slot", name),
+                )
                 .unwrap()
-                .try_as_basic_value()
-                .left()
+        };
+        self.builder
+            .build_pointer_cast(
+                slot,
+                self.types.value_type.ptr_type(AddressSpace::default()),
+                &format!("{}_slot_ptr", name),
+            )
+            .unwrap()
+    }
+
+    /// Allocate a closure env for `function` and its captured values and return it as a
+    /// Closure value. The env keeps the list header (capacity, length) the runtime reads, and
+    /// `function` must take a pointer to the env ahead of its own parameters.
+    fn build_closure(
+        &mut self,
+        function: FunctionValue<'ctx>,
+        captures: &[BasicValueEnum<'ctx>],
+    ) -> BasicValueEnum<'ctx> {
+        let closure_len = 1 + captures.len() as u64; // fn + captures
+        let size_val = self.types.i64_type.const_int(16 + closure_len * 16, false);
+        let env = self
+            .builder
+            .build_call(self.libc.malloc, &[size_val.into()], "closure_ptr")
+            .unwrap()
+            .try_as_basic_value()
+            .left()
+            .unwrap()
+            .into_pointer_value();
+
+        // Store capacity and length in header
+        let header_ptr = self
+            .builder
+            .build_pointer_cast(
+                env,
+                self.types.i64_type.ptr_type(AddressSpace::default()),
+                "header_ptr",
+            )
+            .unwrap();
+        let len_val = self.types.i64_type.const_int(closure_len, false);
+        self.builder.build_store(header_ptr, len_val).unwrap();
+        let len_ptr = unsafe {
+            self.builder
+                .build_gep(
+                    self.types.i64_type,
+                    header_ptr,
+                    &[self.types.i64_type.const_int(1, false)],
+                    "len_ptr",
+                )
                 .unwrap()
-                .into_pointer_value();
+        };
+        self.builder.build_store(len_ptr, len_val).unwrap();
+
+        let fn_val = self.function_value(function);
+        let fn_slot = self.closure_slot_ptr(env, 0, "fn");
+        self.builder.build_store(fn_slot, fn_val).unwrap();
+        for (i, capture) in captures.iter().enumerate() {
+            let slot = self.closure_slot_ptr(env, (i + 1) as u64, &format!("cap{}", i));
+            self.builder.build_store(slot, *capture).unwrap();
+        }
 
-            // Store capacity and length in header
-            let i64_ptr_type = self
-                .types
-                .i64_type
-                .ptr_type(inkwell::AddressSpace::default());
-            let header_ptr = self
-                .builder
-                .build_pointer_cast(list_ptr, i64_ptr_type, "header_ptr")
-                .unwrap();
-            let capacity_val = self.types.i64_type.const_int(closure_len as u64, false);
-            self.builder.build_store(header_ptr, capacity_val).unwrap();
-            let len_ptr = unsafe {
-                self.builder
-                    .build_gep(
-                        self.types.i64_type,
-                        header_ptr,
-                        &[self.types.i64_type.const_int(1, false)],
-                        "len_ptr",
-                    )
-                    .unwrap()
-            };
-            let len_val = self.types.i64_type.const_int(closure_len as u64, false);
-            self.builder.build_store(len_ptr, len_val).unwrap();
+        let env_int = self
+            .builder
+            .build_ptr_to_int(env, self.types.i64_type, "closure_ptr_int")
+            .unwrap();
+        let closure_tag = self
+            .types
+            .i8_type
+            .const_int(ValueTag::Closure.as_u8() as u64, false);
+        let c1 = self
+            .builder
+            .build_insert_value(self.types.value_type.get_undef(), closure_tag, 0, "c1")
+            .unwrap();
+        self.builder
+            .build_insert_value(c1, env_int, 1, "c2")
+            .unwrap()
+            .into_struct_value()
+            .into()
+    }
 
-            // Store function pointer as first element
-            let elem0_offset = header_size;
-            let elem0_ptr = unsafe {
-                self.builder
-                    .build_gep(
-                        self.context.i8_type(),
-                        list_ptr,
-                        &[self.types.i64_type.const_int(elem0_offset, false)],
-                        "elem0_ptr",
-                    )
-                    .unwrap()
-            };
-            let elem0_val_ptr = self
+    /// The env-taking entry of a named function that captures `capture_count` variables.
+    /// Direct calls pass the captures as leading arguments; a closure made from the function
+    /// points here instead, and this loads them from the env and calls through.
+    fn closure_entry(
+        &mut self,
+        function: FunctionValue<'ctx>,
+        capture_count: usize,
+    ) -> FunctionValue<'ctx> {
+        let entry_name = format!("{}.env", function.get_name().to_string_lossy());
+        if let Some(existing) = self.module.get_function(&entry_name) {
+            return existing;
+        }
+        let user_params = (function.count_params() as usize).saturating_sub(capture_count);
+        let env_ptr_type = self.context.i8_type().ptr_type(AddressSpace::default());
+        let mut param_types: Vec<BasicMetadataTypeEnum> = vec![env_ptr_type.into()];
+        let value_type = BasicMetadataTypeEnum::from(self.types.value_type);
+        param_types.extend((0..user_params).map(|_| value_type));
+        let fn_type = self.types.value_type.fn_type(&param_types, false);
+        let entry = self
+            .module
+            .add_function(&entry_name, fn_type, Some(Linkage::Internal));
+
+        let saved_block = self.builder.get_insert_block();
+        let block = self.context.append_basic_block(entry, "entry");
+        self.builder.position_at_end(block);
+        let env = entry.get_first_param().unwrap().into_pointer_value();
+        let mut args: Vec<BasicMetadataValueEnum> = Vec::new();
+        for i in 0..capture_count {
+            let slot = self.closure_slot_ptr(env, (i + 1) as u64, &format!("cap{}", i));
+            let capture = self
                 .builder
-                .build_pointer_cast(
-                    elem0_ptr,
-                    self.types
-                        .value_type
-                        .ptr_type(inkwell::AddressSpace::default()),
-                    "elem0_val_ptr",
-                )
+                .build_load(self.types.value_type, slot, &format!("cap{}", i))
                 .unwrap();
-            self.builder.build_store(elem0_val_ptr, fn_val).unwrap();
+            args.push(capture.into());
+        }
+        for i in 0..user_params {
+            args.push(entry.get_nth_param((1 + i) as u32).unwrap().into());
+        }
+        let call = self.builder.build_call(function, &args, "call").unwrap();
+        call.set_tail_call(true);
+        let result = call.try_as_basic_value().left().unwrap();
+        self.builder.build_return(Some(&result)).unwrap();
+        if let Some(block) = saved_block {
+            self.builder.position_at_end(block);
+        }
+        entry
+    }
 
-            // Store captured values
-            for (i, capture_alloca) in capture_allocas.iter().enumerate() {
-                let capture_val = self
+    /// Call a closure given its env (the Closure value's data): `function` directly when the
+    /// caller knows it, otherwise whatever the env's slot 0 holds.
+    fn build_env_call(
+        &mut self,
+        env_data: IntValue<'ctx>,
+        function: Option<FunctionValue<'ctx>>,
+        args: &[BasicValueEnum<'ctx>],
+    ) -> BasicValueEnum<'ctx> {
+        let env_ptr_type = self.context.i8_type().ptr_type(AddressSpace::default());
+        let env = self
+            .builder
+            .build_int_to_ptr(env_data, env_ptr_type, "env")
+            .unwrap();
+        let mut call_args: Vec<BasicMetadataValueEnum> = vec![env.into()];
+        call_args.extend(args.iter().map(|a| BasicMetadataValueEnum::from(*a)));
+        let call = match function {
+            Some(function) => self
+                .builder
+                .build_call(function, &call_args, "closure_result"),
+            None => {
+                let fn_slot = self.closure_slot_ptr(env, 0, "fn");
+                let fn_val = self
                     .builder
-                    .build_load(
-                        self.types.value_type,
-                        *capture_alloca,
-                        &format!("cap{}_closure", i),
-                    )
-                    .unwrap();
-                let elem_offset = header_size + ((i + 1) as u64) * value_size;
-                let elem_ptr = unsafe {
-                    self.builder
-                        .build_gep(
-                            self.context.i8_type(),
-                            list_ptr,
-                            &[self.types.i64_type.const_int(elem_offset, false)],
-                            &format!("elem{}_ptr", i + 1),
-                        )
-                        .unwrap()
-                };
-                let elem_val_ptr = self
+                    .build_load(self.types.value_type, fn_slot, "fn_in_closure")
+                    .unwrap()
+                    .into_struct_value();
+                let fn_data = self
+                    .builder
+                    .build_extract_value(fn_val, 1, "fn_data_closure")
+                    .unwrap()
+                    .into_int_value();
+                let mut param_types: Vec<BasicMetadataTypeEnum> = vec![env_ptr_type.into()];
+                let value_type = BasicMetadataTypeEnum::from(self.types.value_type);
+                param_types.extend(args.iter().map(|_| value_type));
+                let fn_type = self.types.value_type.fn_type(&param_types, false);
+                let fn_ptr = self
                     .builder
-                    .build_pointer_cast(
-                        elem_ptr,
-                        self.types
-                            .value_type
-                            .ptr_type(inkwell::AddressSpace::default()),
-                        &format!("elem{}_val_ptr", i + 1),
+                    .build_int_to_ptr(
+                        fn_data,
+                        fn_type.ptr_type(AddressSpace::default()),
+                        "closure_fn_ptr",
                     )
                     .unwrap();
-                self.builder.build_store(elem_val_ptr, capture_val).unwrap();
+                self.builder
+                    .build_indirect_call(fn_type, fn_ptr, &call_args, "closure_result")
             }
+        };
+        call.unwrap().try_as_basic_value().left().unwrap()
+    }
 
-            // Return closure as Closure value (tag=Closure)
-            let list_ptr_int = self
-                .builder
-                .build_ptr_to_int(list_ptr, self.types.i64_type, "closure_ptr_int")
-                .unwrap();
-            let closure_tag = self
-                .types
-                .i8_type
-                .const_int(ValueTag::Closure.as_u8() as u64, false);
-            let undef2 = self.types.value_type.get_undef();
-            let c1 = self
+    /// Call `func_val`, a variable last assigned the lambda `lambda`. While it still holds
+    /// that lambda (the function pointers match) the call is a direct one LLVM can inline;
+    /// anything else goes through `call_function_value`.
+    fn call_known_lambda(
+        &mut self,
+        func_val: BasicValueEnum<'ctx>,
+        lambda: FunctionValue<'ctx>,
+        args: &[BasicValueEnum<'ctx>],
+    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
+        let is_closure = lambda
+            .get_first_param()
+            .is_some_and(|param| param.is_pointer_value());
+        if lambda.count_params() as usize != args.len() + usize::from(is_closure) {
+            return self.call_function_value(func_val, args);
+        }
+        let function = self.current_function.unwrap();
+        let func_struct = func_val.into_struct_value();
+        let tag = self
+            .builder
+            .build_extract_value(func_struct, 0, "func_tag")
+            .unwrap()
+            .into_int_value();
+        let data = self
+            .builder
+            .build_extract_value(func_struct, 1, "func_data")
+            .unwrap()
+            .into_int_value();
+        let expected_tag = if is_closure {
+            ValueTag::Closure
+        } else {
+            ValueTag::Function
+        };
+        let tag_ok = self
+            .builder
+            .build_int_compare(
+                IntPredicate::EQ,
+                tag,
+                self.types
+                    .i8_type
+                    .const_int(expected_tag.as_u8() as u64, false),
+                "lambda_tag_ok",
+            )
+            .unwrap();
+
+        let check_block = self.context.append_basic_block(function, "lambda_check");
+        let direct_block = self.context.append_basic_block(function, "lambda_direct");
+        let generic_block = self.context.append_basic_block(function, "lambda_generic");
+        let merge_block = self.context.append_basic_block(function, "lambda_merge");
+        self.builder
+            .build_conditional_branch(tag_ok, check_block, generic_block)
+            .unwrap();
+
+        self.builder.position_at_end(check_block);
+        let current = if is_closure {
+            let env = self
                 .builder
-                .build_insert_value(undef2, closure_tag, 0, "c1")
+                .build_int_to_ptr(
+                    data,
+                    self.context.i8_type().ptr_type(AddressSpace::default()),
+                    "env",
+                )
                 .unwrap();
-            let c2 = self
+            let fn_slot = self.closure_slot_ptr(env, 0, "fn");
+            let fn_val = self
                 .builder
-                .build_insert_value(c1, list_ptr_int, 1, "c2")
-                .unwrap();
-            Ok(c2.into_struct_value().into())
-        }
+                .build_load(self.types.value_type, fn_slot, "fn_in_closure")
+                .unwrap()
+                .into_struct_value();
+            self.builder
+                .build_extract_value(fn_val, 1, "fn_data_closure")
+                .unwrap()
+                .into_int_value()
+        } else {
+            data
+        };
+        let lambda_int = self
+            .builder
+            .build_ptr_to_int(
+                lambda.as_global_value().as_pointer_value(),
+                self.types.i64_type,
+                "lambda_int",
+            )
+            .unwrap();
+        let same = self
+            .builder
+            .build_int_compare(IntPredicate::EQ, current, lambda_int, "same_lambda")
+            .unwrap();
+        self.builder
+            .build_conditional_branch(same, direct_block, generic_block)
+            .unwrap();
+
+        self.builder.position_at_end(direct_block);
+        let direct_result = if is_closure {
+            self.build_env_call(data, Some(lambda), args)
+        } else {
+            let call_args: Vec<BasicMetadataValueEnum> = args.iter().map(|a| (*a).into()).collect();
+            self.builder
+                .build_call(lambda, &call_args, "lambda_result")
+                .unwrap()
+                .try_as_basic_value()
+                .left()
+                .unwrap()
+        };
+        self.builder
+            .build_unconditional_branch(merge_block)
+            .unwrap();
+        let direct_end = self.builder.get_insert_block().unwrap();
+
+        self.builder.position_at_end(generic_block);
+        let generic_result = self.call_function_value(func_val, args)?;
+        self.builder
+            .build_unconditional_branch(merge_block)
+            .unwrap();
+        let generic_end = self.builder.get_insert_block().unwrap();
+
+        self.builder.position_at_end(merge_block);
+        let phi = self
+            .builder
+            .build_phi(self.types.value_type, "lambda_call")
+            .unwrap();
+        phi.add_incoming(&[(&direct_result, direct_end), (&generic_result, generic_end)]);
+        Ok(phi.as_basic_value())
     }
 
     /// Helper to call a function value with arguments
     ///
-    /// Handles both simple functions (tag=Function) and closures (tag=Closure, list with fn+captures)
+    /// Handles both simple functions (tag=Function) and closures (tag=Closure, whose env
+    /// holds the function and its captures; see `build_closure`)
     fn call_function_value(
         &mut self,
         func_val: BasicValueEnum<'ctx>,
@@ -26250,282 +30363,18 @@ impl<'ctx> CodeGen<'ctx> {
             .unwrap();
         self.builder.build_unreachable().unwrap();
 
-        // Closure call - extract fn_ptr and captures from the list
+        // Closure call - the function is in slot 0 of the env and takes the env first
         self.builder.position_at_end(closure_block);
-        let list_data = self
-            .builder
-            .build_extract_value(func_struct, 1, "list_data")
-            .unwrap()
-            .into_int_value();
-        let i8_ptr_type = self.context.i8_type().ptr_type(AddressSpace::default());
-        let list_ptr = self
-            .builder
-            .build_int_to_ptr(list_data, i8_ptr_type, "list_ptr")
-            .unwrap();
-
-        // Get closure length (number of captures + 1 for fn_ptr)
-        let i64_ptr_type = self.types.i64_type.ptr_type(AddressSpace::default());
-        let header_ptr = self
-            .builder
-            .build_pointer_cast(list_ptr, i64_ptr_type, "header_ptr")
-            .unwrap();
-        let len_ptr = unsafe {
-            self.builder
-                .build_gep(
-                    self.types.i64_type,
-                    header_ptr,
-                    &[self.types.i64_type.const_int(1, false)],
-                    "len_ptr",
-                )
-                .unwrap()
-        };
-        let closure_len = self
-            .builder
-            .build_load(self.types.i64_type, len_ptr, "closure_len")
-            .unwrap()
-            .into_int_value();
-
-        // Calculate number of captures
-        let one = self.types.i64_type.const_int(1, false);
-        let num_captures = self
-            .builder
-            .build_int_sub(closure_len, one, "num_captures")
-            .unwrap();
-
-        // Extract fn_ptr from first element
-        let header_size = 16u64;
-        let value_size = 16u64;
-        let elem0_ptr = unsafe {
-            self.builder
-                .build_gep(
-                    self.context.i8_type(),
-                    list_ptr,
-                    &[self.types.i64_type.const_int(header_size, false)],
-                    "elem0_ptr",
-                )
-                .unwrap()
-        };
-        let elem0_val_ptr = self
+        let env_data = self
             .builder
-            .build_pointer_cast(
-                elem0_ptr,
-                self.types.value_type.ptr_type(AddressSpace::default()),
-                "elem0_val_ptr",
-            )
-            .unwrap();
-        let fn_val_in_closure = self
-            .builder
-            .build_load(self.types.value_type, elem0_val_ptr, "fn_in_closure")
-            .unwrap()
-            .into_struct_value();
-        let fn_data_in_closure = self
-            .builder
-            .build_extract_value(fn_val_in_closure, 1, "fn_data_closure")
+            .build_extract_value(func_struct, 1, "env_data")
             .unwrap()
             .into_int_value();
-
-        // We need to handle variable number of captures at runtime
-        // For simplicity, support up to 4 captures statically (can be extended)
-        // Build all possible call sites and branch to the right one based on num_captures
-
-        // For now, let's handle common cases: 0-4 captures
-        // Create blocks for each case
-        let case0_block = self.context.append_basic_block(function, "closure_0");
-        let case1_block = self.context.append_basic_block(function, "closure_1");
-        let case2_block = self.context.append_basic_block(function, "closure_2");
-        let case3_block = self.context.append_basic_block(function, "closure_3");
-        let default_block = self.context.append_basic_block(function, "closure_default");
-
-        // Switch on num_captures
-        let zero = self.types.i64_type.const_int(0, false);
-        let is_0 = self
-            .builder
-            .build_int_compare(IntPredicate::EQ, num_captures, zero, "is_0")
-            .unwrap();
-
-        self.builder
-            .build_conditional_branch(is_0, case0_block, case1_block)
-            .unwrap();
-
-        // Case 0: no captures (shouldn't happen for closures but handle it)
-        self.builder.position_at_end(case0_block);
-        let fn_type0 = self.types.value_type.fn_type(&param_types, false);
-        let fn_ptr0 = self
-            .builder
-            .build_int_to_ptr(fn_data_in_closure, fn_ptr_type, "fn_ptr0")
-            .unwrap();
-        let result0 = self
-            .builder
-            .build_indirect_call(fn_type0, fn_ptr0, &call_args, "result0")
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .unwrap();
+        let closure_result = self.build_env_call(env_data, None, args);
         self.builder
             .build_unconditional_branch(merge_block)
             .unwrap();
-        let case0_end = self.builder.get_insert_block().unwrap();
-
-        // Case 1: 1 capture
-        self.builder.position_at_end(case1_block);
-        let is_1 = self
-            .builder
-            .build_int_compare(IntPredicate::EQ, num_captures, one, "is_1")
-            .unwrap();
-        self.builder
-            .build_conditional_branch(is_1, default_block, case2_block)
-            .unwrap();
-
-        // Case 2: >= 2 captures, go to case3_block (handles 2+ captures)
-        self.builder.position_at_end(case2_block);
-        // For num_captures >= 2, we use the 2-capture handler
-        self.builder
-            .build_unconditional_branch(case3_block)
-            .unwrap();
-
-        // Now handle each case with correct number of captures
-        // Default block: 1 capture
-        self.builder.position_at_end(default_block);
-
-        // Load capture 1
-        let cap1_offset = header_size + value_size;
-        let cap1_ptr = unsafe {
-            self.builder
-                .build_gep(
-                    self.context.i8_type(),
-                    list_ptr,
-                    &[self.types.i64_type.const_int(cap1_offset, false)],
-                    "cap1_ptr",
-                )
-                .unwrap()
-        };
-        let cap1_val_ptr = self
-            .builder
-            .build_pointer_cast(
-                cap1_ptr,
-                self.types.value_type.ptr_type(AddressSpace::default()),
-                "cap1_val_ptr",
-            )
-            .unwrap();
-        let cap1 = self
-            .builder
-            .build_load(self.types.value_type, cap1_val_ptr, "cap1")
-            .unwrap();
-
-        // Build args with 1 capture prepended
-        let mut closure_args1: Vec<BasicMetadataValueEnum> = Vec::new();
-        closure_args1.push(cap1.into());
-        for arg in args {
-            closure_args1.push((*arg).into());
-        }
-
-        // Create function type with 1 capture + args
-        let closure_param_count1 = 1 + args.len();
-        let closure_param_types1: Vec<BasicMetadataTypeEnum> = (0..closure_param_count1)
-            .map(|_| self.types.value_type.into())
-            .collect();
-        let closure_fn_type1 = self.types.value_type.fn_type(&closure_param_types1, false);
-        let closure_fn_ptr_type1 = closure_fn_type1.ptr_type(AddressSpace::default());
-        let closure_fn_ptr1 = self
-            .builder
-            .build_int_to_ptr(fn_data_in_closure, closure_fn_ptr_type1, "closure_fn_ptr1")
-            .unwrap();
-
-        let result1 = self
-            .builder
-            .build_indirect_call(closure_fn_type1, closure_fn_ptr1, &closure_args1, "result1")
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .unwrap();
-        self.builder
-            .build_unconditional_branch(merge_block)
-            .unwrap();
-        let case1_end = self.builder.get_insert_block().unwrap();
-
-        // Case 3: 2 captures
-        self.builder.position_at_end(case3_block);
-
-        // Load capture 1 again (we're in a different block)
-        let cap1_ptr_2 = unsafe {
-            self.builder
-                .build_gep(
-                    self.context.i8_type(),
-                    list_ptr,
-                    &[self.types.i64_type.const_int(cap1_offset, false)],
-                    "cap1_ptr_2",
-                )
-                .unwrap()
-        };
-        let cap1_val_ptr_2 = self
-            .builder
-            .build_pointer_cast(
-                cap1_ptr_2,
-                self.types.value_type.ptr_type(AddressSpace::default()),
-                "cap1_val_ptr_2",
-            )
-            .unwrap();
-        let cap1_2 = self
-            .builder
-            .build_load(self.types.value_type, cap1_val_ptr_2, "cap1_2")
-            .unwrap();
-
-        // Load capture 2
-        let cap2_offset = header_size + 2 * value_size;
-        let cap2_ptr = unsafe {
-            self.builder
-                .build_gep(
-                    self.context.i8_type(),
-                    list_ptr,
-                    &[self.types.i64_type.const_int(cap2_offset, false)],
-                    "cap2_ptr",
-                )
-                .unwrap()
-        };
-        let cap2_val_ptr = self
-            .builder
-            .build_pointer_cast(
-                cap2_ptr,
-                self.types.value_type.ptr_type(AddressSpace::default()),
-                "cap2_val_ptr",
-            )
-            .unwrap();
-        let cap2 = self
-            .builder
-            .build_load(self.types.value_type, cap2_val_ptr, "cap2")
-            .unwrap();
-
-        // Build args with 2 captures prepended
-        let mut closure_args2: Vec<BasicMetadataValueEnum> = Vec::new();
-        closure_args2.push(cap1_2.into());
-        closure_args2.push(cap2.into());
-        for arg in args {
-            closure_args2.push((*arg).into());
-        }
-
-        // Create function type with 2 captures + args
-        let closure_param_count2 = 2 + args.len();
-        let closure_param_types2: Vec<BasicMetadataTypeEnum> = (0..closure_param_count2)
-            .map(|_| self.types.value_type.into())
-            .collect();
-        let closure_fn_type2 = self.types.value_type.fn_type(&closure_param_types2, false);
-        let closure_fn_ptr_type2 = closure_fn_type2.ptr_type(AddressSpace::default());
-        let closure_fn_ptr2 = self
-            .builder
-            .build_int_to_ptr(fn_data_in_closure, closure_fn_ptr_type2, "closure_fn_ptr2")
-            .unwrap();
-
-        let result2 = self
-            .builder
-            .build_indirect_call(closure_fn_type2, closure_fn_ptr2, &closure_args2, "result2")
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .unwrap();
-        self.builder
-            .build_unconditional_branch(merge_block)
-            .unwrap();
-        let case2_end = self.builder.get_insert_block().unwrap();
+        let closure_end = self.builder.get_insert_block().unwrap();
 
         // Merge results
         self.builder.position_at_end(merge_block);
@@ -26535,9 +30384,7 @@ impl<'ctx> CodeGen<'ctx> {
             .unwrap();
         phi.add_incoming(&[
             (&simple_result, simple_end),
-            (&result0, case0_end),
-            (&result1, case1_end),
-            (&result2, case2_end),
+            (&closure_result, closure_end),
             (&native_result, native_end),
         ]);
 
@@ -28888,6 +32735,7 @@ impl<'ctx> CodeGen<'ctx> {
 
                 let tmp_expr = Expr::Variable {
                     name: tmp_name.clone(),
+                    slot: None,
                     span: *span,
                 };
                 let synthetic_call = Expr::Call {
@@ -28921,6 +32769,7 @@ impl<'ctx> CodeGen<'ctx> {
 
                 let tmp_expr = Expr::Variable {
                     name: tmp_name.clone(),
+                    slot: None,
                     span: *span,
                 };
                 let mut new_args = Vec::with_capacity(arguments.len() + 1);
@@ -28954,7 +32803,7 @@ impl<'ctx> CodeGen<'ctx> {
     fn collect_import_exports(&mut self, path: &str) -> Result<Vec<String>, HaversError> {
         let import_path = self.resolve_import_path(path)?;
         let source = std::fs::read_to_string(&import_path).unwrap();
-        let program = crate::parser::parse(&source)?;
+        let program = crate::parse_cache::parse_cached(&source)?;
         Ok(Self::collect_module_exports(&program))
     }
 
@@ -28987,6 +32836,7 @@ impl<'ctx> CodeGen<'ctx> {
             let key = self.compile_string_literal(name).unwrap();
             let var_expr = Expr::Variable {
                 name: name.clone(),
+                slot: None,
                 span: Span::new(0, 0),
             };
             let value = self.compile_expr(&var_expr)?;
@@ -29054,7 +32904,6 @@ impl<'ctx> CodeGen<'ctx> {
             function_defaults: self.function_defaults.clone(),
             function_captures: self.function_captures.clone(),
             class_bindings: self.classes.clone(),
-            class_method_bindings: self.class_methods.clone(),
         }
     }
 
@@ -29063,7 +32912,6 @@ impl<'ctx> CodeGen<'ctx> {
         self.function_defaults = before.function_defaults.clone();
         self.function_captures = before.function_captures.clone();
         self.classes = before.class_bindings.clone();
-        self.class_methods = before.class_method_bindings.clone();
     }
 
     fn hide_imported_exports(&mut self, exports: &[String], before: &ImportBindings<'ctx>) {
@@ -29079,7 +32927,6 @@ impl<'ctx> CodeGen<'ctx> {
             }
             if !before.classes.contains(name) {
                 self.classes.remove(name);
-                self.class_methods.remove(name);
             }
             self.var_types.remove(name);
             self.variable_class_types.remove(name);
@@ -29143,7 +32990,8 @@ impl<'ctx> CodeGen<'ctx> {
         // Read and parse the imported file
         let source = std::fs::read_to_string(&import_path).map_err(Self::llvm_compile_error)?;
 
-        let program = crate::parser::parse(&source)?;
+        let program = crate::parse_cache::parse_cached(&source)?;
+        let program = tailcall::loop_self_tail_calls(&optimise::optimise(&program));
 
         // First pass: Handle nested imports, declare functions, pre-register classes
         for stmt in &program.statements {
@@ -29191,17 +33039,35 @@ impl<'ctx> CodeGen<'ctx> {
             }
         }
 
-        // Second pass: Compile function bodies and classes
+        // Second pass: Compile function bodies and classes, as the imported file
+        let saved_path = self.source_path.replace(import_path.clone());
+        let compiled = self.compile_import_bodies(&program);
+        self.source_path = saved_path;
+        compiled
+    }
+
+    /// Compile the function bodies and classes of an imported module
+    fn compile_import_bodies(&mut self, program: &Program) -> Result<(), HaversError> {
         for stmt in &program.statements {
             match stmt {
                 Stmt::Function {
-                    name, params, body, ..
+                    name,
+                    params,
+                    body,
+                    span,
+                    ..
                 } => {
                     // Compile the function body
+                    self.note_frame(self.functions[name], name, span.line);
                     self.compile_function(name, params, body)?;
                 }
-                Stmt::Class { name, methods, .. } => {
-                    self.compile_class(name, methods)?;
+                Stmt::Class {
+                    name,
+                    superclass,
+                    methods,
+                    ..
+                } => {
+                    self.compile_class(name, superclass.as_deref(), methods)?;
                 }
                 _ => {
                     // Skip - already handled or not needed
@@ -29327,12 +33193,277 @@ impl<'ctx> CodeGen<'ctx> {
         )))
     }
 
+    /// `expr`'s type when it is certainly an int or a float, else Unknown. Stricter than
+    /// `infer_expr_type`, which calls a float mixed with anything a float.
+    fn proven_number(&self, expr: &Expr) -> VarType {
+        match expr {
+            _ if self.infer_expr_type(expr) == VarType::Int => VarType::Int,
+            Expr::Literal {
+                value: Literal::Float(_),
+                ..
+            } => VarType::Float,
+            Expr::Variable { name, .. } if self.var_types.get(name) == Some(&VarType::Float) => {
+                VarType::Float
+            }
+            Expr::Grouping { expr, .. }
+            | Expr::Unary {
+                operator: UnaryOp::Negate,
+                operand: expr,
+                ..
+            } => self.proven_number(expr),
+            Expr::Binary {
+                left,
+                operator: BinaryOp::Add | BinaryOp::Subtract | BinaryOp::Multiply | BinaryOp::Divide,
+                right,
+                ..
+            } => match (self.proven_number(left), self.proven_number(right)) {
+                (VarType::Int | VarType::Float, VarType::Int | VarType::Float) => VarType::Float,
+                _ => VarType::Unknown,
+            },
+            Expr::Call { .. } => self.infer_expr_type(expr),
+            _ => VarType::Unknown,
+        }
+    }
+
+    /// Argument types a call to `name` could be specialised for, if `name` still names a
+    /// top-level function that can be cloned.
+    fn specialization_signature(&self, name: &str, args: &[Expr]) -> Option<Vec<VarType>> {
+        let (generic, params, _) = self.specializable.get(name)?;
+        if self.classes.contains_key(name)
+            || self.functions.get(name) != Some(generic)
+            || args.len() != params.len()
+            || args.iter().any(|a| matches!(a, Expr::Spread { .. }))
+        {
+            return None;
+        }
+        let types: Vec<VarType> = args.iter().map(|a| self.proven_number(a)).collect();
+        types
+            .iter()
+            .any(|t| *t != VarType::Unknown)
+            .then_some(types)
+    }
+
+    /// The clone of `name` already made for these arguments.
+    fn find_specialization(&self, name: &str, args: &[Expr]) -> Option<&Specialization<'ctx>> {
+        let types = self.specialization_signature(name, args)?;
+        self.specializations
+            .iter()
+            .find(|spec| spec.name == name && spec.params == types)
+    }
+
+    /// The clone of `name` for these arguments, declared now if this is the first call
+    /// site to ask for it; it is compiled after `main`.
+    fn specialization_for(&mut self, name: &str, args: &[Expr]) -> Option<usize> {
+        let types = self.specialization_signature(name, args)?;
+        if let Some(index) = self
+            .specializations
+            .iter()
+            .position(|spec| spec.name == name && spec.params == types)
+        {
+            return Some(index);
+        }
+        let clones = self.specializations.iter().filter(|s| s.name == name);
+        if clones.count() >= MAX_SPECIALIZATIONS {
+            return None;
+        }
+        let (_, params, body) = &self.specializable[name];
+        let names: Vec<String> = params.iter().map(|p| p.name.clone()).collect();
+        let (locals, returns) = super::infer::specialize(name, &names, &types, body)?;
+
+        let param_types: Vec<BasicMetadataTypeEnum> = types
+            .iter()
+            .map(|t| match t {
+                VarType::Int => self.types.i64_type.into(),
+                VarType::Float => self.types.f64_type.into(),
+                _ => self.types.value_type.into(),
+            })
+            .collect();
+        let fn_type = match returns {
+            VarType::Int => self.types.i64_type.fn_type(&param_types, false),
+            VarType::Float => self.types.f64_type.fn_type(&param_types, false),
+            _ => self.types.value_type.fn_type(&param_types, false),
+        };
+        let suffix: String = types
+            .iter()
+            .map(|t| match t {
+                VarType::Int => 'i',
+                VarType::Float => 'f',
+                _ => 'v',
+            })
+            .collect();
+        let function = self.module.add_function(
+            &format!("{}.{}", name, suffix),
+            fn_type,
+            Some(Linkage::Internal),
+        );
+        self.specializations.push(Specialization {
+            name: name.to_string(),
+            params: types,
+            returns,
+            locals,
+            function,
+        });
+        Some(self.specializations.len() - 1)
+    }
+
+    /// Call clone `index` with `args`, which have its parameter types; the result is
+    /// unboxed if the clone's return is.
+    fn call_specialization(
+        &mut self,
+        index: usize,
+        args: &[Expr],
+    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
+        let function = self.specializations[index].function;
+        let types = self.specializations[index].params.clone();
+        let mut compiled_args: Vec<BasicMetadataValueEnum> = Vec::with_capacity(args.len());
+        for (arg, param_type) in args.iter().zip(types) {
+            let value: BasicMetadataValueEnum = match param_type {
+                VarType::Int => match self.compile_int_expr(arg) {
+                    Some(i) => i.into(),
+                    None => {
+                        let val = self.compile_expr(arg)?;
+                        self.extract_data(val)?.into()
+                    }
+                },
+                VarType::Float => self.compile_float_expr(arg)?.into(),
+                _ => self.compile_expr(arg)?.into(),
+            };
+            compiled_args.push(value);
+        }
+        let call_site = self
+            .builder
+            .build_call(function, &compiled_args, "spec_call")
+            .unwrap();
+        call_site.set_tail_call(true);
+        Ok(call_site.try_as_basic_value().left().unwrap())
+    }
+
+    /// A call to a clone returning a `returns` number, compiled without boxing the result.
+    fn compile_unboxed_call(
+        &mut self,
+        expr: &Expr,
+        returns: VarType,
+    ) -> Option<Result<BasicValueEnum<'ctx>, HaversError>> {
+        let Expr::Call {
+            callee, arguments, ..
+        } = expr
+        else {
+            return None;
+        };
+        let Expr::Variable { name, .. } = callee.as_ref() else {
+            return None;
+        };
+        if self.find_specialization(name, arguments)?.returns != returns {
+            return None;
+        }
+        let index = self.specialization_for(name, arguments)?;
+        Some(self.call_specialization(index, arguments))
+    }
+
+    /// Box a clone's result if it came back unboxed.
+    fn box_specialized(
+        &self,
+        value: BasicValueEnum<'ctx>,
+        returns: VarType,
+    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
+        match returns {
+            VarType::Int => self.make_int(value.into_int_value()),
+            VarType::Float => self.make_float(value.into_float_value()),
+            _ => Ok(value),
+        }
+    }
+
+    /// Give each function that has clones a guard at entry sending calls whose arguments
+    /// turn out to have a clone's types (from call sites that could not prove them) to that
+    /// clone, falling back to the generic body otherwise.
+    fn add_specialization_guards(&mut self) -> Result<(), HaversError> {
+        for index in 0..self.specializations.len() {
+            let spec = &self.specializations[index];
+            let (clone, returns, types) = (spec.function, spec.returns, spec.params.clone());
+            let generic = self.specializable[&spec.name].0;
+            let Some(entry) = generic.get_first_basic_block() else {
+                continue;
+            };
+            let guard = self.context.prepend_basic_block(entry, "spec_guard");
+            let call_block = self.context.append_basic_block(generic, "spec_call");
+
+            // Allocas must stay in the entry block, where mem2reg promotes them
+            self.builder.position_at_end(guard);
+            while let Some(inst) = entry.get_first_instruction() {
+                if inst.get_opcode() != InstructionOpcode::Alloca {
+                    break;
+                }
+                inst.remove_from_basic_block();
+                self.builder.insert_instruction(&inst, None);
+            }
+
+            let mut matches = self.context.bool_type().const_int(1, false);
+            let mut args: Vec<BasicMetadataValueEnum> = Vec::with_capacity(types.len());
+            for (i, param_type) in types.iter().enumerate() {
+                let param = generic
+                    .get_nth_param(i as u32)
+                    .compile_ok_or("Missing parameter")?;
+                let tag = match param_type {
+                    VarType::Int => ValueTag::Int,
+                    VarType::Float => ValueTag::Float,
+                    _ => {
+                        args.push(param.into());
+                        continue;
+                    }
+                };
+                let is_tag = self
+                    .builder
+                    .build_int_compare(
+                        IntPredicate::EQ,
+                        self.extract_tag(param)?,
+                        self.types.i8_type.const_int(tag.as_u8() as u64, false),
+                        "spec_arg_tag",
+                    )
+                    .unwrap();
+                matches = self
+                    .builder
+                    .build_and(matches, is_tag, "spec_args")
+                    .unwrap();
+                let data = self.extract_data(param)?;
+                args.push(if tag == ValueTag::Int {
+                    data.into()
+                } else {
+                    self.builder
+                        .build_bitcast(data, self.types.f64_type, "spec_arg_f64")
+                        .unwrap()
+                        .into()
+                });
+            }
+            self.builder
+                .build_conditional_branch(matches, call_block, entry)
+                .unwrap();
+
+            self.builder.position_at_end(call_block);
+            let call_site = self.builder.build_call(clone, &args, "spec_call").unwrap();
+            call_site.set_tail_call(true);
+            let result = call_site.try_as_basic_value().left().unwrap();
+            let result = self.box_specialized(result, returns)?;
+            self.builder.build_return(Some(&result)).unwrap();
+        }
+        Ok(())
+    }
+
     fn compile_user_function_call(
         &mut self,
         func_name: &str,
         func: FunctionValue<'ctx>,
         args: &[Expr],
     ) -> Result<BasicValueEnum<'ctx>, HaversError> {
+        let specialization = match self.specializable.get(func_name) {
+            Some(&(generic, _, _)) if generic == func => self.specialization_for(func_name, args),
+            _ => None,
+        };
+        if let Some(index) = specialization {
+            let returns = self.specializations[index].returns;
+            let result = self.call_specialization(index, args)?;
+            return self.box_specialized(result, returns);
+        }
+
         let mut compiled_args: Vec<BasicMetadataValueEnum> = Vec::new();
 
         // Check if any argument is a spread expression
@@ -29523,9 +33654,8 @@ impl<'ctx> CodeGen<'ctx> {
     }
 
     /// Compile try/catch statement
-    /// For now, this uses a simplified implementation that just executes the try block.
-    /// The catch block becomes unreachable code - proper error handling would require
-    /// setjmp/longjmp or landing pads for C++ exceptions.
+    /// The handler is a `_setjmp` buffer pushed on the runtime's per-thread try stack;
+    /// `__mdh_hurl` `_longjmp`s back into it and the catch block reads the last error.
     fn compile_try_catch(
         &mut self,
         try_block: &Stmt,
@@ -29541,18 +33671,18 @@ impl<'ctx> CodeGen<'ctx> {
 
         // Allocate jmp_buf storage and register it with the runtime.
         // IMPORTANT: setjmp must occur in the same stack frame that remains active until longjmp.
-        let jmp_size = self
-            .builder
-            .build_call(self.libc.jmp_buf_size, &[], "jmp_buf_size")
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .compile_ok_or("jmp_buf_size returned void").unwrap()
-            .into_int_value();
-        let jmp_buf = self
-            .builder
-            .build_array_alloca(self.context.i8_type(), jmp_size, "jmp_buf")
-            .unwrap();
+        // The buffer is a fixed-size entry-block slot (the runtime checks jmp_buf fits), so
+        // entering a try costs no size query and no stack growth per loop iteration.
+        let jmp_buf = {
+            let entry = function.get_first_basic_block().unwrap();
+            let entry_builder = self.context.create_builder();
+            match entry.get_first_instruction() {
+                Some(instr) => entry_builder.position_before(&instr),
+                None => entry_builder.position_at_end(entry),
+            }
+            let jmp_buf_type = self.context.i8_type().array_type(JMP_BUF_SIZE);
+            entry_builder.build_alloca(jmp_buf_type, "jmp_buf").unwrap()
+        };
         if let Some(inst) = jmp_buf.as_instruction_value() {
             let _ = inst.set_alignment(16);
         }
@@ -29560,7 +33690,8 @@ impl<'ctx> CodeGen<'ctx> {
             .build_call(self.libc.try_push, &[jmp_buf.into()], "")
             .unwrap();
 
-        // setjmp returns 0 initially, and nonzero when resuming from a hurl
+        // _setjmp returns 0 initially, and nonzero when resuming from a hurl. Unlike setjmp it
+        // does not save the signal mask, so the non-throwing path makes no syscall.
         let status = self
             .builder
             .build_call(self.libc.setjmp, &[jmp_buf.into()], "try_status")
@@ -29637,21 +33768,27 @@ impl<'ctx> CodeGen<'ctx> {
         self.builder.build_store(error_alloca, err_val).unwrap();
         self.variables.insert(error_name.to_string(), error_alloca);
 
-        if let Stmt::Block { statements, .. } = catch_block {
-            for stmt in statements {
-                self.compile_stmt(stmt)?;
-                if self
-                    .builder
-                    .get_insert_block()
-                    .and_then(|b| b.get_terminator())
-                    .is_some()
-                {
-                    break;
+        self.catch_functions.push(function);
+        let catch_compile_result = (|| {
+            if let Stmt::Block { statements, .. } = catch_block {
+                for stmt in statements {
+                    self.compile_stmt(stmt)?;
+                    if self
+                        .builder
+                        .get_insert_block()
+                        .and_then(|b| b.get_terminator())
+                        .is_some()
+                    {
+                        break;
+                    }
                 }
+            } else {
+                self.compile_stmt(catch_block)?;
             }
-        } else {
-            self.compile_stmt(catch_block)?;
-        }
+            Ok::<(), HaversError>(())
+        })();
+        self.catch_functions.pop();
+        catch_compile_result?;
 
         // Restore previous binding
         if let Some(old) = saved_error_binding {
@@ -29794,7 +33931,14 @@ impl<'ctx> CodeGen<'ctx> {
         patterns: &[DestructPattern],
         value: &Expr,
     ) -> Result<(), HaversError> {
-        let list_val = self.compile_expr(value)?;
+        // A rest pattern may share the items, otherwise only the names see the elements
+        let has_rest = patterns
+            .iter()
+            .any(|p| matches!(p, DestructPattern::Rest(_)));
+        let list_val = match Self::scratch_list_elements(value) {
+            Some(elements) if !has_rest => self.compile_scratch_list(elements)?,
+            _ => self.compile_expr(value)?,
+        };
 
         // Get list struct pointer
         // MdhList format: { items_ptr: *MdhValue, length: i64, capacity: i64 }
@@ -30490,8 +34634,139 @@ impl<'ctx> CodeGen<'ctx> {
     }
 
     /// Get a field from an instance
-    /// Instance layout: [i64 class_name_ptr][i64 field_count][field_entry0][field_entry1]...
+    /// Instance layout: [i64 class_table_ptr][i64 field_count][field_entry0][field_entry1]...
     /// where field_entry = [{i8,i64} key (string)][{i8,i64} value]
+    /// The interned key every instance field called `name` is stored under.
+    fn instance_field_key(&mut self, name: &str) -> PointerValue<'ctx> {
+        if let Some(&key) = self.instance_keys.get(name) {
+            return key;
+        }
+        let key = self
+            .builder
+            .build_global_string_ptr(name, "field_key")
+            .unwrap()
+            .as_pointer_value();
+        self.instance_keys.insert(name.to_string(), key);
+        key
+    }
+
+    /// A field access site's inline cache: the slot it last found its field at.
+    fn instance_field_cache(&self) -> PointerValue<'ctx> {
+        let cache = self
+            .module
+            .add_global(self.types.i64_type, None, "field_cache");
+        cache.set_linkage(Linkage::Internal);
+        cache.set_initializer(&self.types.i64_type.const_zero());
+        cache.as_pointer_value()
+    }
+
+    /// Check the cached slot of a field access. Instances of a class get their fields in
+    /// the order its `init` sets them, so the slot mostly holds across instances; it is
+    /// only taken when it is in range and its key is the interned key for the field. On a
+    /// hit returns a pointer to the slot's value, otherwise branches to `miss`.
+    fn instance_cached_slot(
+        &mut self,
+        instance_ptr: PointerValue<'ctx>,
+        field_count: IntValue<'ctx>,
+        cache: PointerValue<'ctx>,
+        key: PointerValue<'ctx>,
+        miss: BasicBlock<'ctx>,
+    ) -> PointerValue<'ctx> {
+        let function = self.current_function.unwrap();
+        let probe_block = self
+            .context
+            .append_basic_block(function, "field_cache_probe");
+        let hit_block = self.context.append_basic_block(function, "field_cache_hit");
+
+        let slot = self
+            .builder
+            .build_load(self.types.i64_type, cache, "cached_slot")
+            .unwrap()
+            .into_int_value();
+        let in_range = self
+            .builder
+            .build_int_compare(IntPredicate::ULT, slot, field_count, "cached_in_range")
+            .unwrap();
+        self.builder
+            .build_conditional_branch(in_range, probe_block, miss)
+            .unwrap();
+
+        // Entry `slot` starts at 16 + slot * 32; the key's string pointer is 8 bytes in
+        self.builder.position_at_end(probe_block);
+        let entry_offset = self
+            .builder
+            .build_int_add(
+                self.types.i64_type.const_int(16, false),
+                self.builder
+                    .build_int_mul(slot, self.types.i64_type.const_int(32, false), "cached_mul")
+                    .unwrap(),
+                "cached_offset",
+            )
+            .unwrap();
+        let key_data_offset = self
+            .builder
+            .build_int_add(
+                entry_offset,
+                self.types.i64_type.const_int(8, false),
+                "cached_key_offset",
+            )
+            .unwrap();
+        let key_data_ptr = unsafe {
+            self.builder
+                .build_gep(
+                    self.context.i8_type(),
+                    instance_ptr,
+                    &[key_data_offset],
+                    "cached_key_ptr",
+                )
+                .unwrap()
+        };
+        let key_data_ptr = self
+            .builder
+            .build_pointer_cast(
+                key_data_ptr,
+                self.types.i64_type.ptr_type(AddressSpace::default()),
+                "cached_key_i64",
+            )
+            .unwrap();
+        let key_data = self
+            .builder
+            .build_load(self.types.i64_type, key_data_ptr, "cached_key")
+            .unwrap()
+            .into_int_value();
+        let key_int = self
+            .builder
+            .build_ptr_to_int(key, self.types.i64_type, "field_key_int")
+            .unwrap();
+        let same_key = self
+            .builder
+            .build_int_compare(IntPredicate::EQ, key_data, key_int, "cached_same_key")
+            .unwrap();
+        self.builder
+            .build_conditional_branch(same_key, hit_block, miss)
+            .unwrap();
+
+        self.builder.position_at_end(hit_block);
+        let value_offset = self
+            .builder
+            .build_int_add(
+                entry_offset,
+                self.types.i64_type.const_int(16, false),
+                "cached_value_offset",
+            )
+            .unwrap();
+        unsafe {
+            self.builder
+                .build_gep(
+                    self.context.i8_type(),
+                    instance_ptr,
+                    &[value_offset],
+                    "cached_value",
+                )
+                .unwrap()
+        }
+    }
+
     fn compile_instance_get_field(
         &mut self,
         instance_val: BasicValueEnum<'ctx>,
@@ -30514,7 +34789,7 @@ impl<'ctx> CodeGen<'ctx> {
             .build_int_to_ptr(instance_data, i8_ptr_type, "instance_ptr")
             .unwrap();
 
-        // Skip class name pointer (8 bytes) to get to field count
+        // Skip class table pointer (8 bytes) to get to field count
         let field_count_offset = self.types.i64_type.const_int(8, false);
         let field_count_ptr = unsafe {
             self.builder
@@ -30536,16 +34811,12 @@ impl<'ctx> CodeGen<'ctx> {
             .unwrap()
             .into_int_value();
 
-        // Create field name as a global string for comparison
-        let field_name_global = self
-            .builder
-            .build_global_string_ptr(field_name, "field_name")
-            .unwrap();
+        let field_name_global = self.instance_field_key(field_name);
 
         // Loop through fields to find matching name
         let zero = self.types.i64_type.const_int(0, false);
         let one = self.types.i64_type.const_int(1, false);
-        let header_size = self.types.i64_type.const_int(16, false); // class_name_ptr + field_count
+        let header_size = self.types.i64_type.const_int(16, false); // class_table_ptr + field_count
         let entry_size = self.types.i64_type.const_int(32, false); // 16 bytes key + 16 bytes value
         let value_offset_in_entry = self.types.i64_type.const_int(16, false);
 
@@ -30571,7 +34842,30 @@ impl<'ctx> CodeGen<'ctx> {
             .append_basic_block(function, "get_field_continue");
         let done_block = self.context.append_basic_block(function, "get_field_done");
 
-        self.builder.build_unconditional_branch(loop_block).unwrap();
+        // Inline cache: the slot this site last found the field at
+        let cache = self.instance_field_cache();
+        let cached = self.instance_cached_slot(
+            instance_ptr,
+            field_count,
+            cache,
+            field_name_global,
+            loop_block,
+        );
+        let cached_ptr = self
+            .builder
+            .build_pointer_cast(
+                cached,
+                self.types.value_type.ptr_type(AddressSpace::default()),
+                "cached_value_ptr",
+            )
+            .unwrap();
+        let cached_val = self
+            .builder
+            .build_load(self.types.value_type, cached_ptr, "cached_val")
+            .unwrap();
+        self.builder.build_store(result_ptr, cached_val).unwrap();
+        self.builder.build_unconditional_branch(done_block).unwrap();
+
         self.builder.position_at_end(loop_block);
 
         let idx = self
@@ -30639,10 +34933,7 @@ impl<'ctx> CodeGen<'ctx> {
             .builder
             .build_call(
                 self.libc.strstr,
-                &[
-                    entry_key_str.into(),
-                    field_name_global.as_pointer_value().into(),
-                ],
+                &[entry_key_str.into(), field_name_global.into()],
                 "cmp_result",
             )
             .unwrap()
@@ -30669,11 +34960,7 @@ impl<'ctx> CodeGen<'ctx> {
         // Also check string lengths are equal
         let field_name_len = self
             .builder
-            .build_call(
-                self.libc.strlen,
-                &[field_name_global.as_pointer_value().into()],
-                "field_len",
-            )
+            .build_call(self.libc.strlen, &[field_name_global.into()], "field_len")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -30729,6 +35016,7 @@ impl<'ctx> CodeGen<'ctx> {
             .build_load(self.types.value_type, value_typed_ptr, "found_val")
             .unwrap();
         self.builder.build_store(result_ptr, found_val).unwrap();
+        self.builder.build_store(cache, idx).unwrap();
         self.builder.build_unconditional_branch(done_block).unwrap();
 
         // Continue loop
@@ -30793,11 +35081,7 @@ impl<'ctx> CodeGen<'ctx> {
             .unwrap()
             .into_int_value();
 
-        // Create field name as a global string
-        let field_name_global = self
-            .builder
-            .build_global_string_ptr(field_name, "field_name_set")
-            .unwrap();
+        let field_name_global = self.instance_field_key(field_name);
 
         // Loop through fields to find existing field or add new
         let zero = self.types.i64_type.const_int(0, false);
@@ -30829,7 +35113,25 @@ impl<'ctx> CodeGen<'ctx> {
         let add_block = self.context.append_basic_block(function, "set_field_add");
         let done_block = self.context.append_basic_block(function, "set_field_done");
 
-        self.builder.build_unconditional_branch(loop_block).unwrap();
+        let cache = self.instance_field_cache();
+        let cached = self.instance_cached_slot(
+            instance_ptr,
+            field_count,
+            cache,
+            field_name_global,
+            loop_block,
+        );
+        let cached_ptr = self
+            .builder
+            .build_pointer_cast(
+                cached,
+                self.types.value_type.ptr_type(AddressSpace::default()),
+                "cached_value_ptr",
+            )
+            .unwrap();
+        self.builder.build_store(cached_ptr, value).unwrap();
+        self.builder.build_unconditional_branch(done_block).unwrap();
+
         self.builder.position_at_end(loop_block);
 
         let idx = self
@@ -30896,10 +35198,7 @@ impl<'ctx> CodeGen<'ctx> {
             .builder
             .build_call(
                 self.libc.strstr,
-                &[
-                    entry_key_str.into(),
-                    field_name_global.as_pointer_value().into(),
-                ],
+                &[entry_key_str.into(), field_name_global.into()],
                 "cmp_result",
             )
             .unwrap()
@@ -30924,11 +35223,7 @@ impl<'ctx> CodeGen<'ctx> {
 
         let field_name_len = self
             .builder
-            .build_call(
-                self.libc.strlen,
-                &[field_name_global.as_pointer_value().into()],
-                "field_len",
-            )
+            .build_call(self.libc.strlen, &[field_name_global.into()], "field_len")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -30980,6 +35275,7 @@ impl<'ctx> CodeGen<'ctx> {
             )
             .unwrap();
         self.builder.build_store(value_typed_ptr, value).unwrap();
+        self.builder.build_store(cache, idx).unwrap();
         self.builder
             .build_store(found_flag, self.types.bool_type.const_int(1, false))
             .unwrap();
@@ -31074,23 +35370,12 @@ impl<'ctx> CodeGen<'ctx> {
                 "new_key_typed_ptr",
             )
             .unwrap();
-        // Create string key value
-        let key_str = self
-            .builder
-            .build_call(
-                self.libc.strdup,
-                &[field_name_global.as_pointer_value().into()],
-                "key_str_dup",
-            )
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .unwrap()
-            .into_pointer_value();
-        let key_val = self.make_string(key_str).unwrap();
+        // The interned key, so cached slots can be checked by pointer
+        let key_val = self.make_string(field_name_global).unwrap();
         self.builder
             .build_store(new_key_typed_ptr, key_val)
             .unwrap();
+        self.builder.build_store(cache, field_count).unwrap();
 
         // Store value
         let new_value_offset = self
@@ -31134,7 +35419,12 @@ impl<'ctx> CodeGen<'ctx> {
     }
 
     /// Compile a class definition
-    fn compile_class(&mut self, name: &str, methods: &[Stmt]) -> Result<(), HaversError> {
+    fn compile_class(
+        &mut self,
+        name: &str,
+        superclass: Option<&str>,
+        methods: &[Stmt],
+    ) -> Result<(), HaversError> {
         // Save the current builder position (we're in main or another function)
         let saved_block = self.builder.get_insert_block();
         let saved_function = self.current_function;
@@ -31148,7 +35438,7 @@ impl<'ctx> CodeGen<'ctx> {
         // First pass: declare all methods (create function signatures).
         // This allows methods to call each other regardless of definition order.
         if !already_registered {
-            let mut method_list: Vec<(String, FunctionValue<'ctx>)> = Vec::new();
+            let mut method_list: HashMap<String, FunctionValue<'ctx>> = HashMap::new();
             for method in methods {
                 let Stmt::Function {
                     name: method_name,
@@ -31165,21 +35455,20 @@ impl<'ctx> CodeGen<'ctx> {
                 let fn_type = self.types.value_type.fn_type(&param_types, false);
                 let function = self.module.add_function(&func_name, fn_type, None);
                 self.functions.insert(func_name.clone(), function);
-                method_list.push((method_name.clone(), function));
+                method_list.insert(method_name.clone(), function);
 
                 // Store default parameter values for methods.
                 let defaults: Vec<Option<Expr>> = params.iter().map(|p| p.default.clone()).collect();
-                if defaults.iter().any(|d| d.is_some()) { self.function_defaults.insert(func_name, defaults); }
+                if defaults.iter().any(|d| d.is_some()) { self.function_defaults.insert(func_name, defaults.into()); }
             }
 
             // Store method table and class name early so methods can be looked up.
-            self.class_methods
-                .insert(name.to_string(), method_list.clone());
-            let class_name_global = self
-                .builder
-                .build_global_string_ptr(name, &format!("class_{}", name))
-                .unwrap();
-            self.classes.insert(name.to_string(), class_name_global);
+            self.register_class(name, method_list);
+        }
+        // Its vtable inherits whatever it doesn't define from the class it's declared `fae`
+        if let Some(&index) = self.classes.get(name) {
+            self.class_tables[index].parent =
+                superclass.and_then(|parent| self.classes.get(parent).copied());
         }
 
         // Second pass: define all methods (compile function bodies).
@@ -31188,8 +35477,12 @@ impl<'ctx> CodeGen<'ctx> {
                 name: method_name,
                 params,
                 body,
+                span,
                 ..
             } = method else { continue; };
+            if let Some(&function) = self.functions.get(&format!("{}_{}", name, method_name)) {
+                self.note_frame(function, &format!("{}.{}", name, method_name), span.line);
+            }
             self.compile_method_body(name, method_name, params, body)?;
         }
 
@@ -31226,6 +35519,12 @@ impl<'ctx> CodeGen<'ctx> {
         let old_string_cap_shadows = std::mem::take(&mut self.string_cap_shadows);
         let old_var_types = std::mem::take(&mut self.var_types);
         let old_boxed_vars = std::mem::take(&mut self.boxed_vars);
+        let param_names: Vec<String> = params.iter().map(|p| p.name.clone()).collect();
+        let old_numeric_locals = std::mem::replace(
+            &mut self.numeric_locals,
+            super::infer::numeric_locals(&param_names, body),
+        );
+        let old_return_type = std::mem::replace(&mut self.return_type, VarType::Unknown);
         let old_masel = self.current_masel;
         let old_in_user_function = self.in_user_function;
 
@@ -31334,6 +35633,8 @@ impl<'ctx> CodeGen<'ctx> {
         self.string_cap_shadows = old_string_cap_shadows;
         self.var_types = old_var_types;
         self.boxed_vars = old_boxed_vars;
+        self.numeric_locals = old_numeric_locals;
+        self.return_type = old_return_type;
         self.current_masel = old_masel;
         self.in_user_function = old_in_user_function;
 
@@ -31346,9 +35647,9 @@ impl<'ctx> CodeGen<'ctx> {
         class_name: &str,
         args: &[Expr],
     ) -> Result<BasicValueEnum<'ctx>, HaversError> {
-        // Allocate instance memory: [class_name_ptr][field_count=0]
+        // Allocate instance memory: [class_table_ptr][field_count=0]
         // Start with just header, fields will be added by init method
-        let header_size = self.types.i64_type.const_int(16, false); // class_name_ptr + field_count
+        let header_size = self.types.i64_type.const_int(16, false); // class_table_ptr + field_count
         let instance_ptr = self
             .builder
             .build_call(self.libc.malloc, &[header_size.into()], "instance_alloc")
@@ -31360,22 +35661,22 @@ impl<'ctx> CodeGen<'ctx> {
 
         let i64_ptr_type = self.types.i64_type.ptr_type(AddressSpace::default());
 
-        // Store class name pointer
-        let class_name_global = match self.classes.get(class_name) { Some(g) => g, None => return Err(HaversError::CompileError(format!("Unknown class: {class_name}"))), };
-        let class_name_ptr_slot = self
+        // Store the class table pointer; it doubles as the class's id
+        let class_table = match self.class_table(class_name) { Some(t) => t, None => return Err(HaversError::CompileError(format!("Unknown class: {class_name}"))), };
+        let class_table_slot = self
             .builder
-            .build_pointer_cast(instance_ptr, i64_ptr_type, "class_name_slot")
+            .build_pointer_cast(instance_ptr, i64_ptr_type, "class_table_slot")
             .unwrap();
-        let class_name_int = self
+        let class_table_int = self
             .builder
             .build_ptr_to_int(
-                class_name_global.as_pointer_value(),
+                class_table.as_pointer_value(),
                 self.types.i64_type,
-                "class_name_int",
+                "class_table_int",
             )
             .unwrap();
         self.builder
-            .build_store(class_name_ptr_slot, class_name_int)
+            .build_store(class_table_slot, class_table_int)
             .unwrap();
 
         // Store field count = 0
@@ -31552,93 +35853,92 @@ impl<'ctx> CodeGen<'ctx> {
         method_name: &str,
         arg_vals: &[BasicValueEnum<'ctx>],
     ) -> Result<BasicValueEnum<'ctx>, HaversError> {
-        // Try to find the method - track both the function and the func_name for defaults
-        let mut found_method: Option<(FunctionValue<'ctx>, String)> = None;
-
-        // If we're currently compiling a class, check if method is from current class first
-        if let Some(ref current_class) = self.current_class.clone() {
-            let func_name = format!("{}_{}", current_class, method_name);
-            if let Some(&func) = self.functions.get(&func_name) {
-                found_method = Some((func, func_name));
-            }
-        }
-
-        // Check if we know the variable's class type (static type tracking)
-        if found_method.is_none() {
-            if let Expr::Variable { name: var_name, .. } = object {
-                if let Some(class_name) = self.variable_class_types.get(var_name).cloned() {
-                    let func_name = format!("{}_{}", class_name, method_name);
-                    if let Some(&func) = self.functions.get(&func_name) {
-                        found_method = Some((func, func_name));
-                    }
-                }
+        // The receiver's class is most likely known for `masel` inside a class, or a variable
+        // last set from a constructor call. But `masel` could be a subclass's instance, and a
+        // loop or branch can have changed the variable since: call the method directly
+        // behind a check of the instance's class table, and dispatch through the table
+        // when it fails
+        let known_class = match object {
+            Expr::Masel { .. } => self.current_class.clone(),
+            Expr::Variable { name: var_name, .. } => {
+                self.variable_class_types.get(var_name).cloned()
             }
-        }
+            _ => None,
+        };
+        let known = known_class.and_then(|class_name| {
+            let func_name = format!("{}_{}", class_name, method_name);
+            let method_func = *self.functions.get(&func_name)?;
+            Some((method_func, func_name, self.class_table(&class_name)?))
+        });
+        let Some((method_func, func_name, table)) = known else {
+            return self.compile_dynamic_method_call(instance, method_name, arg_vals);
+        };
 
-        // Fallback: Check in class_methods table (prefer methods with matching arg count)
-        // Method has masel + args, so expected_params = arg_vals.len() + 1
-        let expected_param_count = arg_vals.len() + 1;
-        if found_method.is_none() {
-            let mut best_match: Option<(FunctionValue<'ctx>, String)> = None;
-            for (class_name, methods) in self.class_methods.clone().iter() {
-                for (name, func) in methods {
-                    if name == method_name {
-                        let func_name = format!("{}_{}", class_name, method_name);
-                        let func_param_count = func.count_params() as usize;
-                        // Prefer exact match
-                        if func_param_count == expected_param_count {
-                            found_method = Some((*func, func_name));
-                            break;
-                        } else if best_match.is_none() {
-                            // Keep first match as fallback
-                            best_match = Some((*func, func_name));
-                        }
-                    }
-                }
-                if found_method.is_some() {
-                    break;
-                }
-            }
-            if found_method.is_none() {
-                found_method = best_match;
-            }
-        }
+        let function = self.current_function.unwrap();
+        let check_block = self
+            .context
+            .append_basic_block(function, "method_class_check");
+        let direct_block = self.context.append_basic_block(function, "method_direct");
+        let dispatch_block = self.context.append_basic_block(function, "method_dispatch");
+        let merge_block = self
+            .context
+            .append_basic_block(function, "method_call_merge");
 
-        // Also check directly in functions map with class prefixes (prefer matching arg count)
-        if found_method.is_none() {
-            let mut best_match: Option<(FunctionValue<'ctx>, String)> = None;
-            for class_name in self.classes.clone().keys() {
-                let func_name = format!("{}_{}", class_name, method_name);
-                if let Some(&func) = self.functions.get(&func_name) {
-                    let func_param_count = func.count_params() as usize;
-                    if func_param_count == expected_param_count {
-                        found_method = Some((func, func_name));
-                        break;
-                    } else if best_match.is_none() {
-                        best_match = Some((func, func_name));
-                    }
-                }
-            }
-            if found_method.is_none() {
-                found_method = best_match;
-            }
-        }
+        let is_instance = self.is_instance_value(instance);
+        self.builder
+            .build_conditional_branch(is_instance, check_block, dispatch_block)
+            .unwrap();
 
-        // If no method found, try callable field pattern (e.g., masel.callback() where callback is a stored lambda)
-        if found_method.is_none() {
-            // Try to get the field value from the instance and call it
-            let field_val = self.compile_instance_get_field(instance, method_name)?;
+        self.builder.position_at_end(check_block);
+        let class_id = self.instance_class_id(instance);
+        let table_int = self
+            .builder
+            .build_ptr_to_int(
+                table.as_pointer_value(),
+                self.types.i64_type,
+                "known_class_id",
+            )
+            .unwrap();
+        let same_class = self
+            .builder
+            .build_int_compare(IntPredicate::EQ, class_id, table_int, "is_known_class")
+            .unwrap();
+        self.builder
+            .build_conditional_branch(same_class, direct_block, dispatch_block)
+            .unwrap();
 
-            // Build call arguments (without instance since this is a field call, not method call)
-            let field_call_args: Vec<BasicMetadataValueEnum> =
-                arg_vals.iter().map(|v| (*v).into()).collect();
+        self.builder.position_at_end(direct_block);
+        let direct_res =
+            self.compile_static_method_call(instance, method_func, &func_name, arg_vals)?;
+        self.builder
+            .build_unconditional_branch(merge_block)
+            .unwrap();
+        let direct_end = self.builder.get_insert_block().unwrap();
 
-            // Call the field value as a function using the runtime's call mechanism
-            return self.call_callable_value(field_val, &field_call_args);
-        }
+        self.builder.position_at_end(dispatch_block);
+        let dispatch_res = self.compile_dynamic_method_call(instance, method_name, arg_vals)?;
+        self.builder
+            .build_unconditional_branch(merge_block)
+            .unwrap();
+        let dispatch_end = self.builder.get_insert_block().unwrap();
 
-        let (method_func, func_name) = match found_method { Some(v) => v, None => return Err(HaversError::CompileError(format!("Method '{method_name}' not found"))), };
+        self.builder.position_at_end(merge_block);
+        let phi = self
+            .builder
+            .build_phi(self.types.value_type, "method_call_result")
+            .unwrap();
+        phi.add_incoming(&[(&direct_res, direct_end), (&dispatch_res, dispatch_end)]);
+        Ok(phi.as_basic_value())
+    }
 
+    /// Call a method whose function is known, padding missing arguments with its defaults.
+    fn compile_static_method_call(
+        &mut self,
+        instance: BasicValueEnum<'ctx>,
+        method_func: FunctionValue<'ctx>,
+        func_name: &str,
+        arg_vals: &[BasicValueEnum<'ctx>],
+    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
         // Build call arguments: instance first, then regular args
         let mut call_args: Vec<BasicMetadataValueEnum> = vec![instance.into()];
         for arg in arg_vals {
@@ -31649,7 +35949,7 @@ impl<'ctx> CodeGen<'ctx> {
         // Note: method_func has self as first param, so expected is count_params() and call_args includes instance
         let expected_param_count = method_func.count_params() as usize;
         if call_args.len() < expected_param_count {
-            if let Some(defaults) = self.function_defaults.get(&func_name).cloned() {
+            if let Some(defaults) = self.function_defaults.get(func_name).cloned() {
                 // defaults[i] corresponds to the i-th method parameter (excluding self)
                 // call_args[0] is instance, so call_args.len()-1 is the number of actual args
                 let actual_args_without_self = call_args.len() - 1;
@@ -31681,6 +35981,455 @@ impl<'ctx> CodeGen<'ctx> {
         Ok(result)
     }
 
+    /// The class table of the class `class_name` names in this scope.
+    fn class_table(&self, class_name: &str) -> Option<inkwell::values::GlobalValue<'ctx>> {
+        let &index = self.classes.get(class_name)?;
+        Some(self.class_tables[index].table)
+    }
+
+    /// `{ i8*, i8* }`: a class table (name, vtable), and each vtable entry (class table, method).
+    fn class_entry_type(&self) -> inkwell::types::StructType<'ctx> {
+        let i8_ptr = self.context.i8_type().ptr_type(AddressSpace::default());
+        self.context
+            .struct_type(&[i8_ptr.into(), i8_ptr.into()], false)
+    }
+
+    fn is_instance_value(&self, value: BasicValueEnum<'ctx>) -> IntValue<'ctx> {
+        let tag = self.extract_tag(value).unwrap();
+        let instance_tag = self
+            .types
+            .i8_type
+            .const_int(ValueTag::Instance.as_u8() as u64, false);
+        self.builder
+            .build_int_compare(IntPredicate::EQ, tag, instance_tag, "is_instance")
+            .unwrap()
+    }
+
+    /// The first header word of an instance: its class table's address, used as the class id.
+    fn instance_class_id(&self, instance: BasicValueEnum<'ctx>) -> IntValue<'ctx> {
+        let data = self.extract_data(instance).unwrap();
+        let header = self
+            .builder
+            .build_int_to_ptr(
+                data,
+                self.types.i64_type.ptr_type(AddressSpace::default()),
+                "instance_header",
+            )
+            .unwrap();
+        self.builder
+            .build_load(self.types.i64_type, header, "class_id")
+            .unwrap()
+            .into_int_value()
+    }
+
+    /// Call a method on a receiver of unknown class. Each site caches the vtable entry it
+    /// last called; the entry names its class, so a receiver of the same class calls the
+    /// cached method straight away. Otherwise the entry is read from the receiver's vtable at
+    /// the slot for this method name and argument count. A receiver that isn't an instance,
+    /// or whose class has no such method, has the method looked up as a callable field.
+    fn compile_dynamic_method_call(
+        &mut self,
+        instance: BasicValueEnum<'ctx>,
+        method_name: &str,
+        arg_vals: &[BasicValueEnum<'ctx>],
+    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
+        let function = self.current_function.unwrap();
+        let i8_ptr = self.context.i8_type().ptr_type(AddressSpace::default());
+        let entry_type = self.class_entry_type();
+        let entry_ptr_type = entry_type.ptr_type(AddressSpace::default());
+
+        let next_slot = self.method_slots.len() as u32;
+        let slot = *self
+            .method_slots
+            .entry((method_name.to_string(), arg_vals.len()))
+            .or_insert(next_slot);
+
+        let probe_block = self
+            .context
+            .append_basic_block(function, "method_cache_probe");
+        let hit_block = self
+            .context
+            .append_basic_block(function, "method_cache_hit");
+        let miss_block = self
+            .context
+            .append_basic_block(function, "method_cache_miss");
+        let fill_block = self
+            .context
+            .append_basic_block(function, "method_cache_fill");
+        let call_block = self.context.append_basic_block(function, "method_vcall");
+        let field_block = self
+            .context
+            .append_basic_block(function, "method_field_call");
+        let merge_block = self
+            .context
+            .append_basic_block(function, "method_vcall_merge");
+
+        let is_instance = self.is_instance_value(instance);
+        self.builder
+            .build_conditional_branch(is_instance, probe_block, field_block)
+            .unwrap();
+
+        // The cache starts at an entry whose class is null, which no instance has
+        self.builder.position_at_end(probe_block);
+        let class_id = self.instance_class_id(instance);
+        let cache = self.method_call_cache(entry_type);
+        let cached_entry = self
+            .builder
+            .build_load(i8_ptr, cache, "cached_entry")
+            .unwrap()
+            .into_pointer_value();
+        let cached_entry = self
+            .builder
+            .build_pointer_cast(cached_entry, entry_ptr_type, "cached_entry_ptr")
+            .unwrap();
+        let cached_class_ptr = self
+            .builder
+            .build_struct_gep(entry_type, cached_entry, 0, "cached_class_ptr")
+            .unwrap();
+        let cached_class = self
+            .builder
+            .build_load(i8_ptr, cached_class_ptr, "cached_class")
+            .unwrap()
+            .into_pointer_value();
+        let cached_class = self
+            .builder
+            .build_ptr_to_int(cached_class, self.types.i64_type, "cached_class_id")
+            .unwrap();
+        let same_class = self
+            .builder
+            .build_int_compare(
+                IntPredicate::EQ,
+                cached_class,
+                class_id,
+                "method_cache_same",
+            )
+            .unwrap();
+        self.builder
+            .build_conditional_branch(same_class, hit_block, miss_block)
+            .unwrap();
+
+        self.builder.position_at_end(hit_block);
+        let cached_method_ptr = self
+            .builder
+            .build_struct_gep(entry_type, cached_entry, 1, "cached_method_ptr")
+            .unwrap();
+        let cached_method = self
+            .builder
+            .build_load(i8_ptr, cached_method_ptr, "cached_method")
+            .unwrap()
+            .into_pointer_value();
+        self.builder.build_unconditional_branch(call_block).unwrap();
+
+        // Class table: { name, vtable }; the entry is vtable[slot]
+        self.builder.position_at_end(miss_block);
+        let table = self
+            .builder
+            .build_int_to_ptr(class_id, entry_ptr_type, "class_table")
+            .unwrap();
+        let vtable_ptr = self
+            .builder
+            .build_struct_gep(entry_type, table, 1, "vtable_ptr")
+            .unwrap();
+        let vtable = self
+            .builder
+            .build_load(i8_ptr, vtable_ptr, "vtable")
+            .unwrap()
+            .into_pointer_value();
+        let vtable = self
+            .builder
+            .build_pointer_cast(vtable, entry_ptr_type, "vtable_entries")
+            .unwrap();
+        let slot_entry = unsafe {
+            self.builder
+                .build_gep(
+                    entry_type,
+                    vtable,
+                    &[self.types.i64_type.const_int(slot as u64, false)],
+                    "vtable_entry",
+                )
+                .unwrap()
+        };
+        let slot_method_ptr = self
+            .builder
+            .build_struct_gep(entry_type, slot_entry, 1, "vtable_method_ptr")
+            .unwrap();
+        let slot_method = self
+            .builder
+            .build_load(i8_ptr, slot_method_ptr, "vtable_method")
+            .unwrap()
+            .into_pointer_value();
+        let no_method = self
+            .builder
+            .build_is_null(slot_method, "vtable_no_method")
+            .unwrap();
+        self.builder
+            .build_conditional_branch(no_method, field_block, fill_block)
+            .unwrap();
+
+        self.builder.position_at_end(fill_block);
+        let slot_entry_i8 = self
+            .builder
+            .build_pointer_cast(slot_entry, i8_ptr, "vtable_entry_i8")
+            .unwrap();
+        self.builder.build_store(cache, slot_entry_i8).unwrap();
+        self.builder.build_unconditional_branch(call_block).unwrap();
+
+        // Every vtable entry takes the instance and exactly this site's arguments
+        self.builder.position_at_end(call_block);
+        let method = self.builder.build_phi(i8_ptr, "method_ptr").unwrap();
+        method.add_incoming(&[(&cached_method, hit_block), (&slot_method, fill_block)]);
+        let param_types: Vec<BasicMetadataTypeEnum> = (0..=arg_vals.len())
+            .map(|_| self.types.value_type.into())
+            .collect();
+        let fn_type = self.types.value_type.fn_type(&param_types, false);
+        let method_fn = self
+            .builder
+            .build_pointer_cast(
+                method.as_basic_value().into_pointer_value(),
+                fn_type.ptr_type(AddressSpace::default()),
+                "method_fn",
+            )
+            .unwrap();
+        let mut call_args: Vec<BasicMetadataValueEnum> = vec![instance.into()];
+        call_args.extend(arg_vals.iter().map(|v| BasicMetadataValueEnum::from(*v)));
+        let vcall_res = self
+            .builder
+            .build_indirect_call(fn_type, method_fn, &call_args, "vcall_result")
+            .unwrap()
+            .try_as_basic_value()
+            .left()
+            .unwrap_or(self.make_nil());
+        self.builder
+            .build_unconditional_branch(merge_block)
+            .unwrap();
+        let call_end = self.builder.get_insert_block().unwrap();
+
+        // Callable field pattern (e.g., masel.callback() where callback is a stored lambda)
+        self.builder.position_at_end(field_block);
+        let field_val = self.compile_instance_get_field(instance, method_name)?;
+        let field_call_args: Vec<BasicMetadataValueEnum> =
+            arg_vals.iter().map(|v| (*v).into()).collect();
+        let field_res = self.call_callable_value(field_val, &field_call_args)?;
+        self.builder
+            .build_unconditional_branch(merge_block)
+            .unwrap();
+        let field_end = self.builder.get_insert_block().unwrap();
+
+        self.builder.position_at_end(merge_block);
+        let phi = self
+            .builder
+            .build_phi(self.types.value_type, "vcall_merge")
+            .unwrap();
+        phi.add_incoming(&[(&vcall_res, call_end), (&field_res, field_end)]);
+        Ok(phi.as_basic_value())
+    }
+
+    /// A method call site's inline cache: a pointer to the vtable entry it last called,
+    /// starting at the shared entry with no class.
+    fn method_call_cache(
+        &self,
+        entry_type: inkwell::types::StructType<'ctx>,
+    ) -> PointerValue<'ctx> {
+        let i8_ptr = self.context.i8_type().ptr_type(AddressSpace::default());
+        let empty = match self.module.get_global("method_cache_empty") {
+            Some(g) => g,
+            None => {
+                let g = self
+                    .module
+                    .add_global(entry_type, None, "method_cache_empty");
+                g.set_linkage(Linkage::Internal);
+                g.set_constant(true);
+                g.set_initializer(&entry_type.const_zero());
+                g
+            }
+        };
+        let cache = self.module.add_global(i8_ptr, None, "method_cache");
+        cache.set_linkage(Linkage::Internal);
+        cache.set_initializer(&empty.as_pointer_value().const_cast(i8_ptr));
+        cache.as_pointer_value()
+    }
+
+    /// The method `method_name` of the class at `index` in `class_tables`, or the nearest
+    /// of its parents that has one, with the name of the class defining it.
+    fn class_table_method(
+        &self,
+        index: usize,
+        method_name: &str,
+    ) -> Option<(String, FunctionValue<'ctx>)> {
+        let mut table = &self.class_tables[index];
+        // A parent chain can only be as long as the number of classes, bar a cycle
+        for _ in 0..self.class_tables.len() {
+            if let Some(&func) = table.methods.get(method_name) {
+                return Some((table.name.clone(), func));
+            }
+            table = &self.class_tables[table.parent?];
+        }
+        None
+    }
+
+    /// Fill in every class table and its vtable, once all call sites have their slots. A
+    /// class method taking more parameters than a slot's argument count gets a thunk that
+    /// pads the rest with its defaults (or nil), as a direct call would.
+    fn emit_class_tables(&mut self) -> Result<(), HaversError> {
+        let i8_ptr = self.context.i8_type().ptr_type(AddressSpace::default());
+        let entry_type = self.class_entry_type();
+        let mut slots = vec![(String::new(), 0usize); self.method_slots.len()];
+        for ((name, argc), &slot) in &self.method_slots {
+            slots[slot as usize] = (name.clone(), *argc);
+        }
+
+        // One thunk per method and argument count, shared with subclasses
+        let mut thunks: HashMap<(String, usize), FunctionValue<'ctx>> = HashMap::new();
+        for index in 0..self.class_tables.len() {
+            let (class_name, name_ptr, table) = {
+                let t = &self.class_tables[index];
+                (t.name.clone(), t.name_ptr, t.table)
+            };
+            let mut entries = Vec::with_capacity(slots.len());
+            for (method_name, argc) in &slots {
+                let target = match self.class_table_method(index, method_name) {
+                    Some((_, func)) if func.count_params() as usize == argc + 1 => Some(func),
+                    Some((owner, func)) if func.count_params() as usize > argc + 1 => {
+                        let key = (func.get_name().to_string_lossy().into_owned(), *argc);
+                        let thunk = match thunks.get(&key) {
+                            Some(&thunk) => thunk,
+                            None => {
+                                let thunk =
+                                    self.method_default_thunk(&owner, method_name, func, *argc)?;
+                                thunks.insert(key, thunk);
+                                thunk
+                            }
+                        };
+                        Some(thunk)
+                    }
+                    _ => None,
+                };
+                let method = match target {
+                    Some(func) => func.as_global_value().as_pointer_value().const_cast(i8_ptr),
+                    None => i8_ptr.const_null(),
+                };
+                entries.push(entry_type.const_named_struct(&[
+                    table.as_pointer_value().const_cast(i8_ptr).into(),
+                    method.into(),
+                ]));
+            }
+
+            let vtable = if entries.is_empty() {
+                i8_ptr.const_null()
+            } else {
+                let vtable = self.module.add_global(
+                    entry_type.array_type(entries.len() as u32),
+                    None,
+                    &format!("class_{}_vtable", class_name),
+                );
+                vtable.set_linkage(Linkage::Internal);
+                vtable.set_constant(true);
+                vtable.set_initializer(&entry_type.const_array(&entries));
+                vtable.as_pointer_value().const_cast(i8_ptr)
+            };
+            table.set_initializer(
+                &entry_type
+                    .const_named_struct(&[name_ptr.const_cast(i8_ptr).into(), vtable.into()]),
+            );
+        }
+        Ok(())
+    }
+
+    /// A vtable entry for `method_name` called with `argc` arguments when the method takes
+    /// more: it passes them on and fills the rest from the method's defaults.
+    fn method_default_thunk(
+        &mut self,
+        class_name: &str,
+        method_name: &str,
+        func: FunctionValue<'ctx>,
+        argc: usize,
+    ) -> Result<FunctionValue<'ctx>, HaversError> {
+        let func_name = format!("{}_{}", class_name, method_name);
+        let param_types: Vec<BasicMetadataTypeEnum> =
+            (0..=argc).map(|_| self.types.value_type.into()).collect();
+        let fn_type = self.types.value_type.fn_type(&param_types, false);
+        let thunk = self.module.add_function(
+            &format!("{}_with_{}", func_name, argc),
+            fn_type,
+            Some(Linkage::Internal),
+        );
+
+        // Defaults are compiled in the thunk's own scope, with `masel` bound to the instance
+        let saved_block = self.builder.get_insert_block();
+        let old_function = self.current_function.replace(thunk);
+        let old_variables = std::mem::take(&mut self.variables);
+        let old_int_shadows = std::mem::take(&mut self.int_shadows);
+        let old_list_ptr_shadows = std::mem::take(&mut self.list_ptr_shadows);
+        let old_string_len_shadows = std::mem::take(&mut self.string_len_shadows);
+        let old_string_cap_shadows = std::mem::take(&mut self.string_cap_shadows);
+        let old_var_types = std::mem::take(&mut self.var_types);
+        let old_boxed_vars = std::mem::take(&mut self.boxed_vars);
+        let old_numeric_locals = std::mem::take(&mut self.numeric_locals);
+        let old_class = self.current_class.replace(class_name.to_string());
+        let old_masel = self.current_masel;
+        let old_in_user_function = std::mem::replace(&mut self.in_user_function, true);
+
+        let entry = self.context.append_basic_block(thunk, "entry");
+        self.builder.position_at_end(entry);
+        let masel_alloca = self
+            .builder
+            .build_alloca(self.types.value_type, "masel")
+            .unwrap();
+        self.builder
+            .build_store(masel_alloca, thunk.get_nth_param(0).unwrap())
+            .unwrap();
+        self.current_masel = Some(masel_alloca);
+        self.variables.insert("masel".to_string(), masel_alloca);
+
+        let mut call_args: Vec<BasicMetadataValueEnum> =
+            thunk.get_param_iter().map(|p| p.into()).collect();
+        let defaults = self
+            .function_defaults
+            .get(&func_name)
+            .cloned()
+            .unwrap_or_else(|| Rc::from(Vec::new()));
+        let mut result = Ok(());
+        for i in argc..(func.count_params() as usize - 1) {
+            match defaults.get(i) {
+                Some(Some(default_expr)) => match self.compile_expr(default_expr) {
+                    Ok(v) => call_args.push(v.into()),
+                    Err(e) => {
+                        result = Err(e);
+                        break;
+                    }
+                },
+                _ => call_args.push(self.make_nil().into()),
+            }
+        }
+        if result.is_ok() {
+            let ret = self
+                .builder
+                .build_call(func, &call_args, "method_result")
+                .unwrap()
+                .try_as_basic_value()
+                .left()
+                .unwrap_or(self.make_nil());
+            self.builder.build_return(Some(&ret)).unwrap();
+        }
+
+        self.current_function = old_function;
+        self.variables = old_variables;
+        self.int_shadows = old_int_shadows;
+        self.list_ptr_shadows = old_list_ptr_shadows;
+        self.string_len_shadows = old_string_len_shadows;
+        self.string_cap_shadows = old_string_cap_shadows;
+        self.var_types = old_var_types;
+        self.boxed_vars = old_boxed_vars;
+        self.numeric_locals = old_numeric_locals;
+        self.current_class = old_class;
+        self.current_masel = old_masel;
+        self.in_user_function = old_in_user_function;
+        if let Some(block) = saved_block {
+            self.builder.position_at_end(block);
+        }
+        result.map(|_| thunk)
+    }
+
     /// Call a value that is expected to be callable (a function/lambda stored in a field)
     fn call_callable_value(
         &mut self,
@@ -31736,24 +36485,14 @@ impl<'ctx> CodeGen<'ctx> {
         Ok(result)
     }
 
-    /// randfloat() - random float in [0, 1)
+    /// randfloat() - random float in [0, 1), all 53 bits of it
     fn inline_randfloat(&mut self) -> Result<BasicValueEnum<'ctx>, HaversError> {
-        // Use __mdh_random to get an integer in [0, 1_000_000) and scale.
-        let zero = self.make_int(self.types.i64_type.const_int(0, false)).unwrap();
-        let million = self.make_int(self.types.i64_type.const_int(1_000_000, false)).unwrap();
-        let n_val = self.inline_jammy(zero, million)?;
-        let n = self.extract_data(n_val).unwrap();
-
-        let n_f = self
-            .builder
-            .build_signed_int_to_float(n, self.types.f64_type, "randfloat_n")
-            .unwrap();
-        let denom = self.types.f64_type.const_float(1_000_000.0);
-        let frac = self
-            .builder
-            .build_float_div(n_f, denom, "randfloat")
-            .unwrap();
-        self.make_float(frac)
+        self.build_call_basic_value(
+            self.libc.random_float,
+            &[],
+            "randfloat",
+            "random_float returned void",
+        )
     }
 
     /// get_key() - read a single key press from terminal
@@ -31848,7 +36587,7 @@ impl<'ctx> CodeGen<'ctx> {
         let two = self.types.i64_type.const_int(2, false);
         let new_str = self
             .builder
-            .build_call(self.libc.malloc, &[two.into()], "chr_str")
+            .build_call(self.libc.malloc_atomic, &[two.into()], "chr_str")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -31882,48 +36621,8 @@ impl<'ctx> CodeGen<'ctx> {
         str_val: BasicValueEnum<'ctx>,
         idx_val: BasicValueEnum<'ctx>,
     ) -> Result<BasicValueEnum<'ctx>, HaversError> {
-        let str_data = self.extract_data(str_val).unwrap();
         let idx_data = self.extract_data(idx_val).unwrap();
-
-        let i8_ptr = self.context.i8_type().ptr_type(AddressSpace::default());
-        let str_ptr = self
-            .builder
-            .build_int_to_ptr(str_data, i8_ptr, "str_ptr")
-            .unwrap();
-        let char_ptr = unsafe {
-            self.builder
-                .build_gep(self.context.i8_type(), str_ptr, &[idx_data], "char_ptr")
-                .unwrap()
-        };
-
-        // Allocate 2 bytes for single char + null terminator
-        let two = self.types.i64_type.const_int(2, false);
-        let new_str = self
-            .builder
-            .build_call(self.libc.malloc, &[two.into()], "char_str")
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .unwrap()
-            .into_pointer_value();
-
-        let char_val = self
-            .builder
-            .build_load(self.context.i8_type(), char_ptr, "char_val")
-            .unwrap();
-        self.builder.build_store(new_str, char_val).unwrap();
-
-        let one = self.types.i64_type.const_int(1, false);
-        let null_ptr = unsafe {
-            self.builder
-                .build_gep(self.context.i8_type(), new_str, &[one], "null_ptr")
-                .unwrap()
-        };
-        self.builder
-            .build_store(null_ptr, self.context.i8_type().const_int(0, false))
-            .unwrap();
-
-        self.make_string(new_str)
+        self.compile_string_index(str_val, idx_data)
     }
 
     /// substr/scance(str, start, end) - substring by byte indices [start, end)
@@ -32016,7 +36715,7 @@ impl<'ctx> CodeGen<'ctx> {
 
         let buf = self
             .builder
-            .build_call(self.libc.malloc, &[buf_size.into()], "substr_buf")
+            .build_call(self.libc.malloc_atomic, &[buf_size.into()], "substr_buf")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -32130,7 +36829,7 @@ impl<'ctx> CodeGen<'ctx> {
         let two = self.types.i64_type.const_int(2, false);
         let new_str = self
             .builder
-            .build_call(self.libc.malloc, &[two.into()], "new_char_str")
+            .build_call(self.libc.malloc_atomic, &[two.into()], "new_char_str")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -32212,7 +36911,7 @@ impl<'ctx> CodeGen<'ctx> {
         // Allocate result
         let result_ptr = self
             .builder
-            .build_call(self.libc.malloc, &[total_size.into()], "result_ptr")
+            .build_call(self.libc.malloc_atomic, &[total_size.into()], "result_ptr")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -32662,7 +37361,7 @@ impl<'ctx> CodeGen<'ctx> {
 
         let buf = self
             .builder
-            .build_call(self.libc.malloc, &[buf_size.into()], "sb_buf")
+            .build_call(self.libc.malloc_atomic, &[buf_size.into()], "sb_buf")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -33606,7 +38305,7 @@ impl<'ctx> CodeGen<'ctx> {
             .unwrap();
         let new_str = self
             .builder
-            .build_call(self.libc.malloc, &[alloc_size.into()], "new_str")
+            .build_call(self.libc.malloc_atomic, &[alloc_size.into()], "new_str")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -33718,7 +38417,7 @@ impl<'ctx> CodeGen<'ctx> {
         let str_alloc = self.builder.build_int_add(count, one, "str_alloc").unwrap();
         let new_str2 = self
             .builder
-            .build_call(self.libc.malloc, &[str_alloc.into()], "new_str_loop")
+            .build_call(self.libc.malloc_atomic, &[str_alloc.into()], "new_str_loop")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -34311,252 +39010,6 @@ impl<'ctx> CodeGen<'ctx> {
         Ok(result_list)
     }
 
-    /// Merge two dictionaries into a new dict (d2 overrides d1 on duplicate keys).
-    /// Dict memory layout: [i64 count][entry0][entry1]... where entry = [MdhValue key][MdhValue val]
-    fn inline_dict_merge(
-        &mut self,
-        d1_val: BasicValueEnum<'ctx>,
-        d2_val: BasicValueEnum<'ctx>,
-    ) -> Result<BasicValueEnum<'ctx>, HaversError> {
-        let d1_data = self.extract_data(d1_val).unwrap();
-        let d2_data = self.extract_data(d2_val).unwrap();
-
-        let i64_ptr_type = self.types.i64_type.ptr_type(AddressSpace::default());
-        let value_ptr_type = self.types.value_type.ptr_type(AddressSpace::default());
-
-        let d1_ptr = self
-            .builder
-            .build_int_to_ptr(d1_data, i64_ptr_type, "d1_ptr")
-            .unwrap();
-        let d2_ptr = self
-            .builder
-            .build_int_to_ptr(d2_data, i64_ptr_type, "d2_ptr")
-            .unwrap();
-
-        let count1 = self
-            .builder
-            .build_load(self.types.i64_type, d1_ptr, "d1_count")
-            .unwrap()
-            .into_int_value();
-        let count2 = self
-            .builder
-            .build_load(self.types.i64_type, d2_ptr, "d2_count")
-            .unwrap()
-            .into_int_value();
-
-        // entries start immediately after count (8 bytes)
-        let one_i64 = self.types.i64_type.const_int(1, false);
-        let d1_entries_i64 = unsafe {
-            self.builder
-                .build_gep(self.types.i64_type, d1_ptr, &[one_i64], "d1_entries_i64")
-                .unwrap()
-        };
-        let d2_entries_i64 = unsafe {
-            self.builder
-                .build_gep(self.types.i64_type, d2_ptr, &[one_i64], "d2_entries_i64")
-                .unwrap()
-        };
-        let d1_entries = self
-            .builder
-            .build_pointer_cast(d1_entries_i64, value_ptr_type, "d1_entries")
-            .unwrap();
-        let d2_entries = self
-            .builder
-            .build_pointer_cast(d2_entries_i64, value_ptr_type, "d2_entries")
-            .unwrap();
-
-        // merged accumulator lives in an alloca because dict_set may return a new pointer.
-        let merged_alloca = self
-            .builder
-            .build_alloca(self.types.value_type, "merged_alloca")
-            .unwrap();
-        let merged0 = self
-            .builder
-            .build_call(self.libc.empty_dict, &[], "merged0")
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .compile_ok_or("empty_dict returned void").unwrap();
-        self.builder.build_store(merged_alloca, merged0).unwrap();
-
-        let function = self.current_function.unwrap();
-        let zero = self.types.i64_type.const_int(0, false);
-        let one = self.types.i64_type.const_int(1, false);
-        let two = self.types.i64_type.const_int(2, false);
-
-        // ===== Loop over d1 entries =====
-        let i1_ptr = self
-            .builder
-            .build_alloca(self.types.i64_type, "i1")
-            .unwrap();
-        self.builder.build_store(i1_ptr, zero).unwrap();
-        let loop1 = self
-            .context
-            .append_basic_block(function, "dict_merge_loop1");
-        let body1 = self
-            .context
-            .append_basic_block(function, "dict_merge_body1");
-        let done1 = self
-            .context
-            .append_basic_block(function, "dict_merge_done1");
-        self.builder.build_unconditional_branch(loop1).unwrap();
-
-        self.builder.position_at_end(loop1);
-        let i1 = self
-            .builder
-            .build_load(self.types.i64_type, i1_ptr, "i1_val")
-            .unwrap()
-            .into_int_value();
-        let c1 = self
-            .builder
-            .build_int_compare(IntPredicate::ULT, i1, count1, "i1_lt")
-            .unwrap();
-        self.builder
-            .build_conditional_branch(c1, body1, done1)
-            .unwrap();
-
-        self.builder.position_at_end(body1);
-        let entry_idx = self.builder.build_int_mul(i1, two, "entry_idx").unwrap();
-        let key_ptr = unsafe {
-            self.builder
-                .build_gep(
-                    self.types.value_type,
-                    d1_entries,
-                    &[entry_idx],
-                    "d1_key_ptr",
-                )
-                .unwrap()
-        };
-        let key = self
-            .builder
-            .build_load(self.types.value_type, key_ptr, "d1_key")
-            .unwrap();
-        let val_idx = self
-            .builder
-            .build_int_add(entry_idx, one, "val_idx")
-            .unwrap();
-        let val_ptr = unsafe {
-            self.builder
-                .build_gep(self.types.value_type, d1_entries, &[val_idx], "d1_val_ptr")
-                .unwrap()
-        };
-        let value = self
-            .builder
-            .build_load(self.types.value_type, val_ptr, "d1_val")
-            .unwrap();
-
-        let merged_cur = self
-            .builder
-            .build_load(self.types.value_type, merged_alloca, "merged_cur1")
-            .unwrap();
-        let merged_new = self
-            .builder
-            .build_call(
-                self.libc.dict_set,
-                &[merged_cur.into(), key.into(), value.into()],
-                "merged_set1",
-            )
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .unwrap();
-        self.builder.build_store(merged_alloca, merged_new).unwrap();
-        let next_i1 = self.builder.build_int_add(i1, one, "next_i1").unwrap();
-        self.builder.build_store(i1_ptr, next_i1).unwrap();
-        self.builder.build_unconditional_branch(loop1).unwrap();
-
-        // ===== Loop over d2 entries =====
-        self.builder.position_at_end(done1);
-        let i2_ptr = self
-            .builder
-            .build_alloca(self.types.i64_type, "i2")
-            .unwrap();
-        self.builder.build_store(i2_ptr, zero).unwrap();
-        let loop2 = self
-            .context
-            .append_basic_block(function, "dict_merge_loop2");
-        let body2 = self
-            .context
-            .append_basic_block(function, "dict_merge_body2");
-        let done2 = self
-            .context
-            .append_basic_block(function, "dict_merge_done2");
-        self.builder.build_unconditional_branch(loop2).unwrap();
-
-        self.builder.position_at_end(loop2);
-        let i2 = self
-            .builder
-            .build_load(self.types.i64_type, i2_ptr, "i2_val")
-            .unwrap()
-            .into_int_value();
-        let c2 = self
-            .builder
-            .build_int_compare(IntPredicate::ULT, i2, count2, "i2_lt")
-            .unwrap();
-        self.builder
-            .build_conditional_branch(c2, body2, done2)
-            .unwrap();
-
-        self.builder.position_at_end(body2);
-        let entry2_idx = self.builder.build_int_mul(i2, two, "entry2_idx").unwrap();
-        let key2_ptr = unsafe {
-            self.builder
-                .build_gep(
-                    self.types.value_type,
-                    d2_entries,
-                    &[entry2_idx],
-                    "d2_key_ptr",
-                )
-                .unwrap()
-        };
-        let key2 = self
-            .builder
-            .build_load(self.types.value_type, key2_ptr, "d2_key")
-            .unwrap();
-        let val2_idx = self
-            .builder
-            .build_int_add(entry2_idx, one, "val2_idx")
-            .unwrap();
-        let val2_ptr = unsafe {
-            self.builder
-                .build_gep(self.types.value_type, d2_entries, &[val2_idx], "d2_val_ptr")
-                .unwrap()
-        };
-        let value2 = self
-            .builder
-            .build_load(self.types.value_type, val2_ptr, "d2_val")
-            .unwrap();
-
-        let merged_cur2 = self
-            .builder
-            .build_load(self.types.value_type, merged_alloca, "merged_cur2")
-            .unwrap();
-        let merged_new2 = self
-            .builder
-            .build_call(
-                self.libc.dict_set,
-                &[merged_cur2.into(), key2.into(), value2.into()],
-                "merged_set2",
-            )
-            .unwrap()
-            .try_as_basic_value()
-            .left()
-            .unwrap();
-        self.builder
-            .build_store(merged_alloca, merged_new2)
-            .unwrap();
-        let next_i2 = self.builder.build_int_add(i2, one, "next_i2").unwrap();
-        self.builder.build_store(i2_ptr, next_i2).unwrap();
-        self.builder.build_unconditional_branch(loop2).unwrap();
-
-        self.builder.position_at_end(done2);
-        let merged_final = self
-            .builder
-            .build_load(self.types.value_type, merged_alloca, "merged_final")
-            .unwrap();
-        Ok(merged_final)
-    }
-
     /// pad_left/pad_right - pad string to given width
     fn inline_pad(
         &mut self,
@@ -34630,7 +39083,7 @@ impl<'ctx> CodeGen<'ctx> {
             .unwrap();
         let new_ptr = self
             .builder
-            .build_call(self.libc.malloc, &[alloc_size.into()], "padded_str")
+            .build_call(self.libc.malloc_atomic, &[alloc_size.into()], "padded_str")
             .unwrap()
             .try_as_basic_value()
             .left()
@@ -35018,9 +39471,9 @@ impl<'ctx> CodeGen<'ctx> {
 
         codegen.preregister_class("C2", &methods);
         assert!(codegen
-            .class_methods
+            .classes
             .get("C2")
-            .is_some_and(|m| m.is_empty()));
+            .is_some_and(|&index| codegen.class_tables[index].methods.is_empty()));
     }
 
     #[test]
@@ -35175,6 +39628,7 @@ impl<'ctx> CodeGen<'ctx> {
         codegen.var_types.insert("x".to_string(), VarType::Int);
         let expr = Expr::Variable {
             name: "x".to_string(),
+            slot: None,
             span: Span::new(1, 1),
         };
         let result = codegen.compile_int_expr(&expr);
@@ -35202,6 +39656,7 @@ impl<'ctx> CodeGen<'ctx> {
             name: "y".to_string(),
             initializer: Some(Expr::Variable {
                 name: "x".to_string(),
+                slot: None,
                 span: Span::new(1, 1),
             }),
             span: Span::new(1, 1),
@@ -35237,6 +39692,7 @@ impl<'ctx> CodeGen<'ctx> {
                 value: Literal::Integer(1),
                 span,
             }),
+            slot: None,
             span,
         };
         let _ = codegen.compile_expr(&expr).expect("compile assign");
@@ -35380,6 +39836,7 @@ impl<'ctx> CodeGen<'ctx> {
 
         let expr = Expr::Variable {
             name: "x".to_string(),
+            slot: None,
             span: Span::new(1, 1),
         };
         let _ = codegen.compile_expr(&expr).expect("compile expr");
@@ -35404,6 +39861,7 @@ impl<'ctx> CodeGen<'ctx> {
 
         let expr = Expr::Variable {
             name: "x".to_string(),
+            slot: None,
             span: Span::new(1, 1),
         };
         let _ = codegen.compile_expr(&expr).expect("compile expr");
@@ -35427,6 +39885,7 @@ impl<'ctx> CodeGen<'ctx> {
 
         let expr = Expr::Variable {
             name: "g".to_string(),
+            slot: None,
             span: Span::new(1, 1),
         };
         let _ = codegen.compile_expr(&expr).expect("compile expr");
@@ -35455,6 +39914,7 @@ impl<'ctx> CodeGen<'ctx> {
 
         let expr = Expr::Variable {
             name: "f".to_string(),
+            slot: None,
             span: Span::new(1, 1),
         };
         let err = codegen
@@ -35485,6 +39945,7 @@ impl<'ctx> CodeGen<'ctx> {
                 value: Literal::Integer(1),
                 span: Span::new(1, 1),
             }),
+            slot: None,
             span: Span::new(1, 1),
         };
 
@@ -35517,6 +39978,7 @@ impl<'ctx> CodeGen<'ctx> {
                 value: Literal::Integer(2),
                 span: Span::new(1, 1),
             }),
+            slot: None,
             span: Span::new(1, 1),
         };
 
@@ -35550,6 +40012,7 @@ impl<'ctx> CodeGen<'ctx> {
             value: Box::new(Expr::Binary {
                 left: Box::new(Expr::Variable {
                     name: "s".to_string(),
+                    slot: None,
                     span: Span::new(1, 1),
                 }),
                 operator: BinaryOp::Add,
@@ -35559,6 +40022,7 @@ impl<'ctx> CodeGen<'ctx> {
                 }),
                 span: Span::new(1, 1),
             }),
+            slot: None,
             span: Span::new(1, 1),
         };
 
@@ -35608,12 +40072,14 @@ impl<'ctx> CodeGen<'ctx> {
         let expr = Expr::Call {
             callee: Box::new(Expr::Variable {
                 name: "stopwatch".to_string(),
+                slot: None,
                 span,
             }),
             arguments: vec![Expr::Lambda {
                 params: vec!["x".to_string()],
                 body: Box::new(Expr::Variable {
                     name: "x".to_string(),
+                    slot: None,
                     span,
                 }),
                 span,
@@ -35644,10 +40110,12 @@ impl<'ctx> CodeGen<'ctx> {
         let expr = Expr::Call {
             callee: Box::new(Expr::Variable {
                 name: "stopwatch".to_string(),
+                slot: None,
                 span,
             }),
             arguments: vec![Expr::Variable {
                 name: "named".to_string(),
+                slot: None,
                 span,
             }],
             span,
@@ -35697,10 +40165,12 @@ impl<'ctx> CodeGen<'ctx> {
         let span = Span::new(1, 1);
         let left = Expr::Variable {
             name: "a".to_string(),
+            slot: None,
             span,
         };
         let right = Expr::Variable {
             name: "b".to_string(),
+            slot: None,
             span,
         };
 
@@ -35726,6 +40196,7 @@ impl<'ctx> CodeGen<'ctx> {
         let span = Span::new(1, 1);
         let left = Expr::Variable {
             name: "a".to_string(),
+            slot: None,
             span,
         };
         let right = Expr::Grouping {
@@ -35818,6 +40289,7 @@ impl<'ctx> CodeGen<'ctx> {
             callee: Box::new(Expr::Get {
                 object: Box::new(Expr::Variable {
                     name: "m".to_string(),
+                    slot: None,
                     span,
                 }),
                 property: "foo".to_string(),
@@ -35863,6 +40335,7 @@ impl<'ctx> CodeGen<'ctx> {
             callee: Box::new(Expr::Get {
                 object: Box::new(Expr::Variable {
                     name: "m".to_string(),
+                    slot: None,
                     span,
                 }),
                 property: "foo".to_string(),
@@ -4,18 +4,27 @@
 //! and native executables.
 
 use std::io::{self, IsTerminal, Write};
-use std::path::Path;
+use std::path::{Path, PathBuf};
 use std::process::Command;
+use std::sync::Mutex;
+use std::time::{Duration, Instant};
 
 /// Embedded runtime object file - compiled into the binary at build time.
 static EMBEDDED_RUNTIME: &[u8] = include_bytes!(concat!(env!("OUT_DIR"), "/mdh_runtime.o"));
 
+/// The same runtime as LLVM bitcode, linked into the module from -O2 (see lto.rs). Empty
+/// when build.rs found no clang whose bitcode this LLVM can read.
+static EMBEDDED_RUNTIME_BC: &[u8] = include_bytes!(concat!(env!("OUT_DIR"), "/mdh_runtime.bc"));
+
 /// Embedded Rust runtime staticlib (JSON/regex helpers).
 static EMBEDDED_RUNTIME_RS: &[u8] = include_bytes!(concat!(env!("OUT_DIR"), "/mdh_runtime_rs.a"));
 
 /// Embedded GC stub - minimal malloc wrappers for standalone builds.
 static EMBEDDED_GC_STUB: &[u8] = include_bytes!(concat!(env!("OUT_DIR"), "/gc_stub.o"));
 
+/// Embedded conservative mark-sweep collector (same GC_* API as the stub).
+static EMBEDDED_GC_MARKSWEEP: &[u8] = include_bytes!(concat!(env!("OUT_DIR"), "/gc_marksweep.o"));
+
 use inkwell::context::Context;
 use inkwell::module::Module;
 use inkwell::passes::PassManager;
@@ -27,7 +36,12 @@ use inkwell::OptimizationLevel;
 use crate::ast::Program;
 use crate::error::HaversError;
 
+use super::cache::ObjectKey;
 use super::codegen::CodeGen;
+use super::heapprof;
+use super::lto;
+use super::pgo;
+use super::traces;
 
 #[derive(Copy, Clone)]
 enum StatusColor {
@@ -133,10 +147,94 @@ impl Drop for BuildStatusGuard {
     }
 }
 
+/// Wall-clock time each phase of a build took, in the order they ran (`--time-passes`)
+#[derive(Debug, Default)]
+struct PassTimes {
+    phases: Mutex<Vec<(&'static str, Duration)>>,
+}
+
+impl PassTimes {
+    fn record(&self, phase: &'static str, took: Duration) {
+        let mut phases = self.phases.lock().unwrap();
+        // A phase run more than once (e.g. by a nested compiler) is reported once, summed
+        match phases.iter_mut().find(|(name, _)| *name == phase) {
+            Some((_, total)) => *total += took,
+            None => phases.push((phase, took)),
+        }
+    }
+
+    fn report(&self) -> String {
+        let phases = self.phases.lock().unwrap();
+        let total: Duration = phases.iter().map(|(_, took)| *took).sum();
+        let ms = |d: Duration| d.as_secs_f64() * 1000.0;
+        let mut out = String::from("Time passes:\n");
+        for (phase, took) in phases.iter() {
+            let share = if total.is_zero() {
+                0.0
+            } else {
+                100.0 * took.as_secs_f64() / total.as_secs_f64()
+            };
+            out.push_str(&format!(
+                "  {:<24} {:>10.1} ms {:>5.1}%\n",
+                phase,
+                ms(*took),
+                share
+            ));
+        }
+        out.push_str(&format!("  {:<24} {:>10.1} ms\n", "total", ms(total)));
+        out
+    }
+}
+
+/// Garbage collector linked into native executables
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum GcMode {
+    /// `GC_malloc` is plain `malloc` and nothing is ever freed
+    #[default]
+    Stub,
+    /// In-tree conservative mark-sweep collector (`runtime/gc_marksweep.c`)
+    MarkSweep,
+}
+
+impl GcMode {
+    /// Parse a `--gc` flag value
+    pub fn from_name(name: &str) -> Option<Self> {
+        match name {
+            "stub" | "none" => Some(GcMode::Stub),
+            "marksweep" | "mark-sweep" => Some(GcMode::MarkSweep),
+            _ => None,
+        }
+    }
+
+    fn object(self) -> &'static [u8] {
+        match self {
+            GcMode::Stub => EMBEDDED_GC_STUB,
+            GcMode::MarkSweep => EMBEDDED_GC_MARKSWEEP,
+        }
+    }
+}
+
+/// Profile-guided optimisation stage of a native build (see pgo.rs)
+#[derive(Debug, Clone, PartialEq, Eq, Default)]
+pub enum PgoMode {
+    #[default]
+    Off,
+    /// Instrument the executable to write a profile when it exits
+    Generate,
+    /// Optimise using a profile written by a `Generate` build
+    Use(PathBuf),
+}
+
 /// LLVM Compiler for mdhavers
 pub struct LLVMCompiler {
     // Configuration options
     opt_level: OptimizationLevel,
+    gc_mode: GcMode,
+    pgo: PgoMode,
+    heap_profile: bool,
+    cpu_profile: bool,
+    /// Set by `with_time_passes`
+    pass_times: Option<PassTimes>,
 }
 
 impl LLVMCompiler {
@@ -148,9 +246,66 @@ impl LLVMCompiler {
     pub fn new() -> Self {
         LLVMCompiler {
             opt_level: OptimizationLevel::Default,
+            gc_mode: GcMode::Stub,
+            pgo: PgoMode::Off,
+            heap_profile: false,
+            cpu_profile: false,
+            pass_times: None,
         }
     }
 
+    /// Time each phase of a build, for `pass_report`
+    pub fn with_time_passes(mut self, on: bool) -> Self {
+        self.pass_times = on.then(PassTimes::default);
+        self
+    }
+
+    /// Count time spent outside the compiler (parsing, say) towards the report
+    pub fn record_pass(&self, phase: &'static str, took: Duration) {
+        if let Some(times) = &self.pass_times {
+            times.record(phase, took);
+        }
+    }
+
+    /// A table of the time each phase took so far, when timing passes
+    pub fn pass_report(&self) -> Option<String> {
+        self.pass_times.as_ref().map(PassTimes::report)
+    }
+
+    fn timed<T>(&self, phase: &'static str, f: impl FnOnce() -> T) -> T {
+        if self.pass_times.is_none() {
+            return f();
+        }
+        let started = Instant::now();
+        let result = f();
+        self.record_pass(phase, started.elapsed());
+        result
+    }
+
+    /// Instrument for, or optimise from, a branch profile
+    pub fn with_pgo(mut self, mode: PgoMode) -> Self {
+        self.pgo = mode;
+        self
+    }
+
+    /// Record allocation sites for a heap profile written to $MDH_HEAPPROF (see heapprof.rs)
+    pub fn with_heap_profile(mut self, on: bool) -> Self {
+        self.heap_profile = on;
+        self
+    }
+
+    /// Sample the running line on SIGPROF for a CPU profile written at exit (see heapprof.rs)
+    pub fn with_cpu_profile(mut self, on: bool) -> Self {
+        self.cpu_profile = on;
+        self
+    }
+
+    /// Select the garbage collector linked into native executables
+    pub fn with_gc(mut self, mode: GcMode) -> Self {
+        self.gc_mode = mode;
+        self
+    }
+
     /// Set optimization level (0-3)
     pub fn with_optimization(mut self, level: u8) -> Self {
         self.opt_level = match level {
@@ -167,9 +322,11 @@ impl LLVMCompiler {
         let context = Context::create();
         let mut codegen = CodeGen::new(&context, "mdhavers_module");
 
-        codegen.compile(program)?;
+        self.timed("codegen", || codegen.compile(program))?;
 
-        Ok(codegen.get_module().print_to_string().to_string())
+        Ok(self.timed("print IR", || {
+            codegen.get_module().print_to_string().to_string()
+        }))
     }
 
     /// Compile to object file
@@ -189,16 +346,41 @@ impl LLVMCompiler {
         output_path: &Path,
         source_path: Option<&Path>,
     ) -> Result<(), HaversError> {
-        self.compile_to_object_with_source_status(program, output_path, source_path, None)
+        self.compile_to_object_with_source_status(program, output_path, source_path, None, false)
+            .map(|_| ())
     }
 
+    /// With `link_runtime`, the runtime bitcode is linked into the object from -O2; the
+    /// result says whether it was, i.e. whether the runtime object must be left out.
     fn compile_to_object_with_source_status(
         &self,
         program: &Program,
         output_path: &Path,
         source_path: Option<&Path>,
         mut status: Option<&mut BuildStatus>,
-    ) -> Result<(), HaversError> {
+        link_runtime: bool,
+    ) -> Result<bool, HaversError> {
+        // Only a build from a file on disk can be checked against its sources later
+        let cache_key = source_path.and_then(|path| {
+            ObjectKey::new(
+                path,
+                self.opt_level,
+                &self.pgo,
+                self.heap_profile,
+                self.cpu_profile,
+                link_runtime,
+            )
+        });
+        let cached = self.timed("object cache", || {
+            cache_key.as_ref().and_then(|key| key.fetch(output_path))
+        });
+        if let Some(runtime_linked) = cached {
+            if let Some(status) = status.as_mut() {
+                status.update("Reusing cached object", StatusColor::Dim);
+            }
+            return Ok(runtime_linked);
+        }
+
         if let Some(status) = status.as_mut() {
             status.update("Generating LLVM IR", StatusColor::Yellow);
         }
@@ -209,31 +391,64 @@ impl LLVMCompiler {
             codegen.set_source_path(path);
         }
 
-        codegen.compile(program)?;
+        // Both profilers charge their samples to the same statement sites
+        let profiled_sites = self.heap_profile || self.cpu_profile;
+        if profiled_sites {
+            codegen.enable_profile_sites();
+        }
 
-        if let Some(status) = status.as_mut() {
-            status.update("Initializing target", StatusColor::Yellow);
+        self.timed("codegen", || codegen.compile(program))?;
+        self.timed("frame table", || {
+            traces::emit(&context, codegen.get_module(), codegen.frame_table())
+        });
+
+        if profiled_sites {
+            self.timed("profile instrumentation", || {
+                heapprof::instrument(
+                    &context,
+                    codegen.get_module(),
+                    codegen.profile_site_names(),
+                    self.cpu_profile,
+                )
+            });
         }
 
-        // Initialize native target
-        Target::initialize_native(&InitializationConfig::default())
-            .map_err(Self::llvm_compile_error)?;
+        // Sites are numbered on the module as codegen left it, before anything is linked in
+        let profiled = self.timed("pgo", || match &self.pgo {
+            PgoMode::Off => Ok(false),
+            PgoMode::Generate => {
+                pgo::instrument(&context, codegen.get_module());
+                Ok(false)
+            }
+            PgoMode::Use(path) => pgo::annotate(&context, codegen.get_module(), path)
+                .map_err(HaversError::CompileError),
+        })?;
 
-        let target_triple = TargetMachine::get_default_triple();
-        let target = Target::from_triple(&target_triple).map_err(Self::llvm_compile_error)?;
+        if let Some(status) = status.as_mut() {
+            status.update("Initializing target", StatusColor::Yellow);
+        }
 
-        let target_machine = target
-            .create_target_machine(
-                &target_triple,
-                "generic",
-                "",
-                self.opt_level,
-                RelocMode::PIC, // Use PIC for PIE executables
-                CodeModel::Default,
-            )
-            .ok_or(HaversError::CompileError(
-                "Failed to create target machine".to_string(),
-            ))?;
+        let target_machine = self.timed("target setup", || {
+            // Initialize native target
+            Target::initialize_native(&InitializationConfig::default())
+                .map_err(Self::llvm_compile_error)?;
+
+            let target_triple = TargetMachine::get_default_triple();
+            let target = Target::from_triple(&target_triple).map_err(Self::llvm_compile_error)?;
+
+            target
+                .create_target_machine(
+                    &target_triple,
+                    "generic",
+                    "",
+                    self.opt_level,
+                    RelocMode::PIC, // Use PIC for PIE executables
+                    CodeModel::Default,
+                )
+                .ok_or(HaversError::CompileError(
+                    "Failed to create target machine".to_string(),
+                ))
+        })?;
 
         if let Some(status) = status.as_mut() {
             if matches!(self.opt_level, OptimizationLevel::None) {
@@ -243,19 +458,43 @@ impl LLVMCompiler {
             }
         }
 
+        let runtime_linked = link_runtime
+            && matches!(
+                self.opt_level,
+                OptimizationLevel::Default | OptimizationLevel::Aggressive
+            )
+            && self.timed("runtime bitcode link", || {
+                codegen.get_module().verify().is_ok()
+                    && lto::link_runtime_bitcode(
+                        &context,
+                        codegen.get_module(),
+                        EMBEDDED_RUNTIME_BC,
+                    )
+            });
+        if runtime_linked || (profiled && !matches!(self.opt_level, OptimizationLevel::None)) {
+            self.timed("inlining", || self.run_inliner(codegen.get_module()));
+        }
+
         // Run optimization passes
-        self.run_optimization_passes(codegen.get_module())?;
+        self.timed("optimisation", || {
+            self.run_optimization_passes(codegen.get_module())
+        })?;
 
         if let Some(status) = status.as_mut() {
             status.update("Writing object file", StatusColor::Yellow);
         }
 
         // Write object file
-        target_machine
-            .write_to_file(codegen.get_module(), FileType::Object, output_path)
-            .map_err(Self::llvm_compile_error)?;
+        self.timed("object emission", || {
+            target_machine.write_to_file(codegen.get_module(), FileType::Object, output_path)
+        })
+        .map_err(Self::llvm_compile_error)?;
 
-        Ok(())
+        if let Some(key) = &cache_key {
+            key.store(output_path, codegen.imported_files(), runtime_linked);
+        }
+
+        Ok(runtime_linked)
     }
 
     /// Compile to native executable
@@ -282,16 +521,31 @@ impl LLVMCompiler {
 
         // First compile to object file
         let obj_path = output_path.with_extension("o");
-        let compiler = LLVMCompiler::new().with_optimization(opt_level);
-        if let Err(err) = compiler.compile_to_object_with_source_status(
+        let compiler = LLVMCompiler::new()
+            .with_optimization(opt_level)
+            .with_pgo(self.pgo.clone())
+            .with_heap_profile(self.heap_profile)
+            .with_cpu_profile(self.cpu_profile)
+            .with_time_passes(self.pass_times.is_some());
+        let object = compiler.compile_to_object_with_source_status(
             program,
             &obj_path,
             source_path,
             Some(&mut status),
-        ) {
-            status.fail("Native build failed");
-            return Err(err);
+            true,
+        );
+        if let Some(times) = compiler.pass_times {
+            for (phase, took) in times.phases.into_inner().unwrap() {
+                self.record_pass(phase, took);
+            }
         }
+        let runtime_linked = match object {
+            Ok(linked) => linked,
+            Err(err) => {
+                status.fail("Native build failed");
+                return Err(err);
+            }
+        };
 
         // Generate unique temp file names using process ID and a counter
         // This avoids race conditions when tests run in parallel
@@ -302,33 +556,40 @@ impl LLVMCompiler {
 
         status.update("Preparing runtime", StatusColor::Yellow);
 
-        // Write embedded runtime to temp file for linking
-        std::fs::File::create(&runtime_path)
-            .and_then(|mut f| f.write_all(EMBEDDED_RUNTIME))
-            .map_err(Self::llvm_compile_error)?;
+        self.timed("runtime objects", || -> Result<(), HaversError> {
+            // Write embedded runtime to temp file for linking (unless it is already in the object)
+            if !runtime_linked {
+                std::fs::File::create(&runtime_path)
+                    .and_then(|mut f| f.write_all(EMBEDDED_RUNTIME))
+                    .map_err(Self::llvm_compile_error)?;
+            }
 
-        // Write embedded Rust runtime to temp file for linking
-        std::fs::File::create(&runtime_rs_path)
-            .and_then(|mut f| f.write_all(EMBEDDED_RUNTIME_RS))
-            .map_err(Self::llvm_compile_error)?;
+            // Write embedded Rust runtime to temp file for linking
+            std::fs::File::create(&runtime_rs_path)
+                .and_then(|mut f| f.write_all(EMBEDDED_RUNTIME_RS))
+                .map_err(Self::llvm_compile_error)?;
 
-        // Write embedded GC stub to temp file for linking
-        std::fs::File::create(&gc_stub_path)
-            .and_then(|mut f| f.write_all(EMBEDDED_GC_STUB))
-            .map_err(Self::llvm_compile_error)?;
+            // Write the selected GC object to temp file for linking
+            std::fs::File::create(&gc_stub_path)
+                .and_then(|mut f| f.write_all(self.gc_mode.object()))
+                .map_err(Self::llvm_compile_error)?;
+            Ok(())
+        })?;
 
         status.update("Linking native executable", StatusColor::Yellow);
 
         // Link with system linker
-        let mut link_args = vec![
-            obj_path.to_str().unwrap(),
-            runtime_path.to_str().unwrap(),
+        let mut link_args = vec![obj_path.to_str().unwrap()];
+        if !runtime_linked {
+            link_args.push(runtime_path.to_str().unwrap());
+        }
+        link_args.extend([
             runtime_rs_path.to_str().unwrap(),
             gc_stub_path.to_str().unwrap(),
             "-lm", // Math library (for floor, ceil, etc.)
             "-pthread",
             "-static-libgcc",
-        ];
+        ]);
 
         #[cfg(feature = "audio")]
         {
@@ -338,12 +599,19 @@ impl LLVMCompiler {
             }
         }
 
+        // The runtime is built with a section per function, so unused builtins drop out
+        // here instead of riding along in every binary.
+        if cfg!(target_os = "macos") {
+            link_args.push("-Wl,-dead_strip");
+        } else {
+            link_args.push("-Wl,--gc-sections");
+        }
+
         link_args.push("-o");
         link_args.push(output_path.to_str().unwrap());
 
-        let link_status = Command::new("cc")
-            .args(&link_args)
-            .status()
+        let link_status = self
+            .timed("link", || Command::new("cc").args(&link_args).status())
             .map_err(Self::llvm_compile_error)?;
 
         // Clean up temp files
@@ -364,6 +632,17 @@ impl LLVMCompiler {
         }
     }
 
+    /// Inline across the user/runtime boundary once the runtime bitcode is linked in (or
+    /// along the `inlinehint`s a profile left), then drop the internal functions (the ABI
+    /// adapters among them) nothing calls any more.
+    fn run_inliner(&self, module: &Module) {
+        let mpm: PassManager<Module> = PassManager::create(());
+        mpm.add_always_inliner_pass();
+        mpm.add_function_inlining_pass();
+        mpm.add_global_dce_pass();
+        mpm.run_on(module);
+    }
+
     /// Run LLVM optimization passes
     fn run_optimization_passes(&self, module: &Module) -> Result<(), HaversError> {
         // Verify the module first
@@ -523,8 +802,8 @@ mod tests {
         assert!(ir.contains("define i32 @main"));
         // Check for inlined integer creation: { i8 2, i64 42 }
         assert!(ir.contains("i8 2") || ir.contains("insertvalue"));
-        // Check for printf call (used by blether)
-        assert!(ir.contains("@printf"));
+        // blether writes an int straight to the stdout buffer
+        assert!(ir.contains("@__mdh_blether_int"));
     }
 
     #[test]
@@ -730,7 +1009,13 @@ mod tests {
         let dir = tempdir().unwrap();
         let obj_path = dir.path().join("out2.o");
         compiler
-            .compile_to_object_with_source_status(&program, &obj_path, None, Some(&mut status))
+            .compile_to_object_with_source_status(
+                &program,
+                &obj_path,
+                None,
+                Some(&mut status),
+                false,
+            )
             .unwrap();
         assert!(obj_path.exists());
     }
@@ -0,0 +1,165 @@
+//! Allocation-site heap profiling and sampling CPU profiling
+//!
+//! `mdhavers build --heap-prof` or `--profile` has codegen store an id for each statement's
+//! source line in the runtime's thread-local `__mdh_heapprof_site` before the statement
+//! runs. Straight after codegen, [`instrument`] brackets every user function with
+//! `__mdh_heapprof_enter` and `__mdh_heapprof_leave`, which keep the calling lines on a
+//! per-thread stack, and has `main` hand the site names to `__mdh_heapprof_register`.
+//!
+//! The runtime does the rest. When `$MDH_HEAPPROF` names a file it samples every Nth
+//! allocation against the current stack of lines. A `--profile` build's `main` also calls
+//! `__mdh_cpuprof_start`, which samples the stack of lines on a SIGPROF timer; reading the
+//! stack the program keeps for itself needs neither frame pointers nor debug info. Both
+//! write folded stacks at exit.
+
+use std::collections::HashMap;
+
+use inkwell::context::Context;
+use inkwell::module::{Linkage, Module};
+use inkwell::values::{GlobalValue, InstructionOpcode};
+use inkwell::AddressSpace;
+
+const SITE_GLOBAL: &str = "__mdh_heapprof_site";
+
+/// Statement sites seen by codegen, named "function (file:line)". Ids start at 1; 0 is the
+/// runtime's "no site yet".
+#[derive(Debug, Default)]
+pub(super) struct HeapSites {
+    names: Vec<String>,
+    ids: HashMap<String, u64>,
+}
+
+impl HeapSites {
+    pub(super) fn id(&mut self, name: String) -> u64 {
+        if let Some(&id) = self.ids.get(&name) {
+            return id;
+        }
+        self.names.push(name.clone());
+        let id = self.names.len() as u64;
+        self.ids.insert(name, id);
+        id
+    }
+
+    pub(super) fn names(&self) -> &[String] {
+        &self.names
+    }
+}
+
+/// The runtime's current-site variable, declared in `module` on first use.
+pub(super) fn site_global<'ctx>(
+    context: &'ctx Context,
+    module: &Module<'ctx>,
+) -> GlobalValue<'ctx> {
+    module.get_global(SITE_GLOBAL).unwrap_or_else(|| {
+        let global = module.add_global(context.i64_type(), None, SITE_GLOBAL);
+        global.set_linkage(Linkage::External);
+        global.set_thread_local(true);
+        global
+    })
+}
+
+/// Add the enter/leave calls to every user function and the site registration to `main`,
+/// followed by starting the CPU sampler when `cpu` is set.
+pub fn instrument<'ctx>(
+    context: &'ctx Context,
+    module: &Module<'ctx>,
+    sites: &[String],
+    cpu: bool,
+) {
+    let main = match module.get_function("main") {
+        Some(main) if main.count_basic_blocks() > 0 => main,
+        _ => return,
+    };
+    let void_fn = context.void_type().fn_type(&[], false);
+    let declare = |name: &str| {
+        module
+            .get_function(name)
+            .unwrap_or_else(|| module.add_function(name, void_fn, Some(Linkage::External)))
+    };
+    let enter = declare("__mdh_heapprof_enter");
+    let leave = declare("__mdh_heapprof_leave");
+    let builder = context.create_builder();
+
+    let functions: Vec<_> = module
+        .get_functions()
+        .filter(|func| func.count_basic_blocks() > 0 && *func != main)
+        .collect();
+    for func in functions {
+        let first = func
+            .get_first_basic_block()
+            .and_then(|block| block.get_first_instruction());
+        if let Some(first) = first {
+            builder.position_before(&first);
+            builder.build_call(enter, &[], "").unwrap();
+        }
+        // A hurl past a function skips its leave; the runtime unwinds the stack instead
+        for block in func.get_basic_blocks() {
+            if let Some(term) = block.get_terminator() {
+                if term.get_opcode() == InstructionOpcode::Return {
+                    builder.position_before(&term);
+                    builder.build_call(leave, &[], "").unwrap();
+                }
+            }
+        }
+    }
+
+    let mut table = Vec::new();
+    for name in sites {
+        table.extend_from_slice(name.as_bytes());
+        table.push(0);
+    }
+    let names_value = context.const_string(&table, false);
+    let names = module.add_global(names_value.get_type(), None, "__mdh_heapprof_names");
+    names.set_linkage(Linkage::Internal);
+    names.set_constant(true);
+    names.set_initializer(&names_value);
+
+    let i64_type = context.i64_type();
+    let i8_ptr = context.i8_type().ptr_type(AddressSpace::default());
+    let register = module
+        .get_function("__mdh_heapprof_register")
+        .unwrap_or_else(|| {
+            let fn_type = context
+                .void_type()
+                .fn_type(&[i8_ptr.into(), i64_type.into()], false);
+            module.add_function("__mdh_heapprof_register", fn_type, Some(Linkage::External))
+        });
+    if let Some(first) = main
+        .get_first_basic_block()
+        .and_then(|block| block.get_first_instruction())
+    {
+        builder.position_before(&first);
+        let pointer = builder
+            .build_pointer_cast(names.as_pointer_value(), i8_ptr, "heapprof.names")
+            .unwrap();
+        builder
+            .build_call(
+                register,
+                &[
+                    pointer.into(),
+                    i64_type.const_int(sites.len() as u64, false).into(),
+                ],
+                "",
+            )
+            .unwrap();
+        if cpu {
+            builder
+                .build_call(declare("__mdh_cpuprof_start"), &[], "")
+                .unwrap();
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_heap_sites_are_numbered_once_each() {
+        let mut sites = HeapSites::default();
+        assert_eq!(sites.id("main (a.braw:1)".to_string()), 1);
+        assert_eq!(sites.id("grow (a.braw:4)".to_string()), 2);
+        assert_eq!(sites.id("main (a.braw:1)".to_string()), 1);
+        assert_eq!(sites.names(), ["main (a.braw:1)", "grow (a.braw:4)"]);
+    }
+}
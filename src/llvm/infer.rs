@@ -0,0 +1,521 @@
+//! Local numeric type inference
+//!
+//! Codegen keeps a variable unboxed (an i64 shadow, or a float whose tag is never checked)
+//! only once it is proven to hold an int, or a float, at every point it can be read. This
+//! pass proves that for one function body: each variable's type is the join of every value
+//! bound to it anywhere in the body (declarations, assignments and range loops, including
+//! those inside nested functions and lambdas, which may share the name through a capture
+//! or a global), iterated to a fixed point so `a = b` and `b = a + 1` settle together.
+//! A variable bound to anything else at all - a parameter, a call result, a list element,
+//! nothing - is left out and stays a boxed, tag-checked MdhValue.
+//!
+//! `specialize` runs the same proof for a clone of a function whose arguments are known
+//! numbers at the call site, and also types what the clone returns.
+
+use std::collections::HashMap;
+
+use crate::ast::{BinaryOp, DestructPattern, Expr, Literal, Pattern, Stmt, UnaryOp};
+
+use super::codegen::VarType;
+
+/// What one variable is known to hold; `None` in the environment is "nothing bound yet".
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+enum Num {
+    Int,
+    Float,
+    Any,
+}
+
+impl Num {
+    fn join(self, other: Num) -> Num {
+        if self == other {
+            self
+        } else {
+            Num::Any
+        }
+    }
+}
+
+enum Binding<'a> {
+    Value(&'a Expr),
+    Fixed(Num),
+}
+
+#[derive(Default)]
+struct Bindings<'a> {
+    sites: Vec<(&'a str, Binding<'a>)>,
+    /// Values of the body's `gie` statements
+    returns: Vec<&'a Expr>,
+    /// A bare `gie`, which returns nil
+    returns_nil: bool,
+    /// A nested function, lambda or class, which captures variables by cell
+    closures: bool,
+}
+
+impl<'a> Bindings<'a> {
+    fn bind(&mut self, name: &'a str, binding: Binding<'a>) {
+        self.sites.push((name, binding));
+    }
+
+    fn any(&mut self, name: &'a str) {
+        self.bind(name, Binding::Fixed(Num::Any));
+    }
+
+    fn stmt(&mut self, stmt: &'a Stmt) {
+        match stmt {
+            Stmt::VarDecl {
+                name, initializer, ..
+            } => match initializer {
+                Some(init) => {
+                    self.bind(name, Binding::Value(init));
+                    self.expr(init);
+                }
+                None => self.any(name),
+            },
+            Stmt::Expression { expr, .. } | Stmt::Print { value: expr, .. } => self.expr(expr),
+            Stmt::Block { statements, .. } => statements.iter().for_each(|s| self.stmt(s)),
+            Stmt::If {
+                condition,
+                then_branch,
+                else_branch,
+                ..
+            } => {
+                self.expr(condition);
+                self.stmt(then_branch);
+                if let Some(else_branch) = else_branch {
+                    self.stmt(else_branch);
+                }
+            }
+            Stmt::While {
+                condition, body, ..
+            } => {
+                self.expr(condition);
+                self.stmt(body);
+            }
+            Stmt::For {
+                variable,
+                iterable,
+                body,
+                ..
+            } => {
+                if matches!(iterable, Expr::Range { .. }) {
+                    self.bind(variable, Binding::Fixed(Num::Int));
+                } else {
+                    self.any(variable);
+                }
+                self.expr(iterable);
+                self.stmt(body);
+            }
+            Stmt::Function {
+                name, params, body, ..
+            } => {
+                self.closures = true;
+                self.any(name);
+                for param in params {
+                    self.any(&param.name);
+                    if let Some(default) = &param.default {
+                        self.expr(default);
+                    }
+                }
+                body.iter().for_each(|s| self.stmt(s));
+            }
+            Stmt::Return { value, .. } => match value {
+                Some(value) => {
+                    self.returns.push(value);
+                    self.expr(value);
+                }
+                None => self.returns_nil = true,
+            },
+            Stmt::Class { name, methods, .. } => {
+                self.closures = true;
+                self.any(name);
+                methods.iter().for_each(|s| self.stmt(s));
+            }
+            Stmt::Struct { name, .. } => self.any(name),
+            Stmt::Import { alias, .. } => {
+                if let Some(alias) = alias {
+                    self.any(alias);
+                }
+            }
+            Stmt::TryCatch {
+                try_block,
+                error_name,
+                catch_block,
+                ..
+            } => {
+                self.any(error_name);
+                self.stmt(try_block);
+                self.stmt(catch_block);
+            }
+            Stmt::Match { value, arms, .. } => {
+                self.expr(value);
+                for arm in arms {
+                    match &arm.pattern {
+                        Pattern::Identifier(name) => self.any(name),
+                        Pattern::Range { start, end } => {
+                            self.expr(start);
+                            self.expr(end);
+                        }
+                        Pattern::Literal(_) | Pattern::Wildcard => {}
+                    }
+                    self.stmt(&arm.body);
+                }
+            }
+            Stmt::Assert {
+                condition, message, ..
+            } => {
+                self.expr(condition);
+                if let Some(message) = message {
+                    self.expr(message);
+                }
+            }
+            Stmt::Destructure {
+                patterns, value, ..
+            } => {
+                for pattern in patterns {
+                    if let DestructPattern::Variable(name) | DestructPattern::Rest(name) = pattern {
+                        self.any(name);
+                    }
+                }
+                self.expr(value);
+            }
+            Stmt::Log {
+                message, extras, ..
+            } => {
+                self.expr(message);
+                extras.iter().for_each(|e| self.expr(e));
+            }
+            Stmt::Hurl { message, .. } => self.expr(message),
+            Stmt::Break { .. } | Stmt::Continue { .. } => {}
+        }
+    }
+
+    fn expr(&mut self, expr: &'a Expr) {
+        match expr {
+            Expr::Assign { name, value, .. } => {
+                self.bind(name, Binding::Value(value));
+                self.expr(value);
+            }
+            Expr::Lambda { params, body, .. } => {
+                self.closures = true;
+                params.iter().for_each(|p| self.any(p));
+                self.expr(body);
+            }
+            Expr::BlockExpr { statements, .. } => statements.iter().for_each(|s| self.stmt(s)),
+            Expr::Literal { .. } | Expr::Variable { .. } | Expr::Masel { .. } => {}
+            Expr::Binary { left, right, .. } | Expr::Logical { left, right, .. } => {
+                self.expr(left);
+                self.expr(right);
+            }
+            Expr::Unary { operand, .. } => self.expr(operand),
+            Expr::Call {
+                callee, arguments, ..
+            } => {
+                self.expr(callee);
+                arguments.iter().for_each(|a| self.expr(a));
+            }
+            Expr::Get { object, .. } => self.expr(object),
+            Expr::Set { object, value, .. } => {
+                self.expr(object);
+                self.expr(value);
+            }
+            Expr::Index { object, index, .. } => {
+                self.expr(object);
+                self.expr(index);
+            }
+            Expr::IndexSet {
+                object,
+                index,
+                value,
+                ..
+            } => {
+                self.expr(object);
+                self.expr(index);
+                self.expr(value);
+            }
+            Expr::Slice {
+                object,
+                start,
+                end,
+                step,
+                ..
+            } => {
+                self.expr(object);
+                for part in [start, end, step].into_iter().flatten() {
+                    self.expr(part);
+                }
+            }
+            Expr::List { elements, .. } => elements.iter().for_each(|e| self.expr(e)),
+            Expr::Dict { pairs, .. } => {
+                for (key, value) in pairs {
+                    self.expr(key);
+                    self.expr(value);
+                }
+            }
+            Expr::Range { start, end, .. } => {
+                self.expr(start);
+                self.expr(end);
+            }
+            Expr::Grouping { expr, .. } | Expr::Spread { expr, .. } => self.expr(expr),
+            Expr::Input { prompt, .. } => self.expr(prompt),
+            Expr::FString { parts, .. } => {
+                for part in parts {
+                    if let crate::ast::FStringPart::Expr(expr) = part {
+                        self.expr(expr);
+                    }
+                }
+            }
+            Expr::Pipe { left, right, .. } => {
+                self.expr(left);
+                self.expr(right);
+            }
+            Expr::Ternary {
+                condition,
+                then_expr,
+                else_expr,
+                ..
+            } => {
+                self.expr(condition);
+                self.expr(then_expr);
+                self.expr(else_expr);
+            }
+        }
+    }
+}
+
+/// A call to the function being specialised, taken to return `returns` whenever its
+/// arguments have the clone's parameter types (`Any` accepts anything). Every return of
+/// the clone then yielding `returns` proves it, by induction on the depth of the calls.
+struct SelfCall<'a> {
+    name: &'a str,
+    params: &'a [Num],
+    returns: Num,
+}
+
+/// The type `expr` evaluates to given what is known so far; `None` while it depends on a
+/// variable nothing has been bound to yet.
+fn type_of(
+    expr: &Expr,
+    env: &HashMap<&str, Option<Num>>,
+    self_call: Option<&SelfCall<'_>>,
+) -> Option<Num> {
+    match expr {
+        Expr::Literal {
+            value: Literal::Integer(_),
+            ..
+        } => Some(Num::Int),
+        Expr::Literal {
+            value: Literal::Float(_),
+            ..
+        } => Some(Num::Float),
+        // Names bound outside the body (globals, parameters of an enclosing scope) are unknown
+        Expr::Variable { name, .. } => env.get(name.as_str()).copied().unwrap_or(Some(Num::Any)),
+        Expr::Grouping { expr, .. } => type_of(expr, env, self_call),
+        Expr::Unary {
+            operator: UnaryOp::Negate,
+            operand,
+            ..
+        } => type_of(operand, env, self_call),
+        Expr::Binary {
+            left,
+            operator:
+                BinaryOp::Add
+                | BinaryOp::Subtract
+                | BinaryOp::Multiply
+                | BinaryOp::Divide
+                | BinaryOp::Modulo,
+            right,
+            ..
+        } => match (
+            type_of(left, env, self_call),
+            type_of(right, env, self_call),
+        ) {
+            (Some(Num::Any), _) | (_, Some(Num::Any)) => Some(Num::Any),
+            (Some(Num::Int), Some(Num::Int)) => Some(Num::Int),
+            (Some(_), Some(_)) => Some(Num::Float),
+            _ => None,
+        },
+        Expr::Call {
+            callee, arguments, ..
+        } => match (callee.as_ref(), self_call) {
+            (Expr::Variable { name, .. }, Some(call))
+                if name == call.name && arguments.len() == call.params.len() =>
+            {
+                let mut matches = true;
+                for (arg, param) in arguments.iter().zip(call.params) {
+                    let arg = type_of(arg, env, self_call)?;
+                    matches &= *param == Num::Any || arg == *param;
+                }
+                Some(if matches { call.returns } else { Num::Any })
+            }
+            _ => Some(Num::Any),
+        },
+        _ => Some(Num::Any),
+    }
+}
+
+fn fixpoint<'a>(
+    bindings: &Bindings<'a>,
+    self_call: Option<&SelfCall<'_>>,
+) -> HashMap<&'a str, Option<Num>> {
+    let mut env: HashMap<&str, Option<Num>> = HashMap::new();
+    for (name, _) in &bindings.sites {
+        env.insert(name, None);
+    }
+    // Every step only moves a variable up None -> Int/Float -> Any, so this terminates
+    let mut changed = true;
+    while changed {
+        changed = false;
+        for (name, binding) in &bindings.sites {
+            let bound = match binding {
+                Binding::Value(expr) => type_of(expr, &env, self_call),
+                Binding::Fixed(num) => Some(*num),
+            };
+            let Some(bound) = bound else { continue };
+            let current = env[name];
+            let joined = current.map_or(bound, |current| current.join(bound));
+            if current != Some(joined) {
+                env.insert(name, Some(joined));
+                changed = true;
+            }
+        }
+    }
+    env
+}
+
+fn var_type(num: Num) -> VarType {
+    match num {
+        Num::Int => VarType::Int,
+        Num::Float => VarType::Float,
+        Num::Any => VarType::Unknown,
+    }
+}
+
+fn numeric(env: HashMap<&str, Option<Num>>) -> HashMap<String, VarType> {
+    env.into_iter()
+        .filter_map(|(name, num)| match num {
+            Some(num @ (Num::Int | Num::Float)) => Some((name.to_string(), var_type(num))),
+            _ => None,
+        })
+        .collect()
+}
+
+fn solve(bindings: Bindings<'_>) -> HashMap<String, VarType> {
+    numeric(fixpoint(&bindings, None))
+}
+
+/// Variables of a function body (or the top level) proven to be always int or always float.
+pub fn numeric_locals(params: &[String], body: &[Stmt]) -> HashMap<String, VarType> {
+    let mut bindings = Bindings::default();
+    params.iter().for_each(|p| bindings.any(p));
+    body.iter().for_each(|s| bindings.stmt(s));
+    solve(bindings)
+}
+
+/// `numeric_locals` for a lambda, whose body is a single expression.
+pub fn numeric_locals_in_expr(params: &[String], body: &Expr) -> HashMap<String, VarType> {
+    let mut bindings = Bindings::default();
+    params.iter().for_each(|p| bindings.any(p));
+    bindings.expr(body);
+    solve(bindings)
+}
+
+/// A clone of the function `name` for arguments of the given types (Unknown for any
+/// value): the locals it proves numeric, and the number every one of its returns yields
+/// (Unknown when that is not always the same one). `None` when the function declares a
+/// closure, which would capture the clone's variables.
+pub fn specialize(
+    name: &str,
+    params: &[String],
+    types: &[VarType],
+    body: &[Stmt],
+) -> Option<(HashMap<String, VarType>, VarType)> {
+    let nums: Vec<Num> = types
+        .iter()
+        .map(|t| match t {
+            VarType::Int => Num::Int,
+            VarType::Float => Num::Float,
+            _ => Num::Any,
+        })
+        .collect();
+    let mut bindings = Bindings::default();
+    for (param, num) in params.iter().zip(&nums) {
+        bindings.bind(param, Binding::Fixed(*num));
+    }
+    body.iter().for_each(|s| bindings.stmt(s));
+    if bindings.closures {
+        return None;
+    }
+
+    // Falling off the end returns nil, so the body must end in a `gie`
+    let always_returns = matches!(body.last(), Some(Stmt::Return { value: Some(_), .. }));
+    if always_returns && !bindings.returns_nil {
+        for returns in [Num::Int, Num::Float] {
+            let call = SelfCall {
+                name,
+                params: &nums,
+                returns,
+            };
+            let env = fixpoint(&bindings, Some(&call));
+            if bindings
+                .returns
+                .iter()
+                .all(|value| type_of(value, &env, Some(&call)) == Some(returns))
+            {
+                return Some((numeric(env), var_type(returns)));
+            }
+        }
+    }
+    Some((numeric(fixpoint(&bindings, None)), VarType::Unknown))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn locals(source: &str) -> HashMap<String, VarType> {
+        let program = crate::parser::parse(source).expect("parse");
+        numeric_locals(&[], &program.statements)
+    }
+
+    #[test]
+    fn test_loop_carried_ints_settle_together() {
+        let types = locals(
+            "ken a = 0\nken b = 1\nfer i in 0..10 {\n ken t = a + b\n a = b\n b = t\n}\nken f = a * 0.5",
+        );
+        assert_eq!(types.get("a"), Some(&VarType::Int));
+        assert_eq!(types.get("b"), Some(&VarType::Int));
+        assert_eq!(types.get("t"), Some(&VarType::Int));
+        assert_eq!(types.get("i"), Some(&VarType::Int));
+        assert_eq!(types.get("f"), Some(&VarType::Float));
+    }
+
+    #[test]
+    fn test_any_other_binding_keeps_a_variable_boxed() {
+        let types = locals(
+            "ken x = 0\nx = 1.5\nken n = 1\ndae f(p) {\n n = p\n}\nken s = 2\nken u = s + len(\"ab\")\nken e",
+        );
+        assert_eq!(types.get("x"), None);
+        assert_eq!(types.get("n"), None);
+        assert_eq!(types.get("s"), Some(&VarType::Int));
+        assert_eq!(types.get("u"), None);
+        assert_eq!(types.get("e"), None);
+    }
+
+    #[test]
+    fn test_specialized_recursion_returns_an_int() {
+        let program = crate::parser::parse(
+            "dae fib(n) {\n gin n < 2 {\n gie n\n }\n ken a = fib(n - 1)\n gie a + fib(n - 2)\n}",
+        )
+        .expect("parse");
+        let Some(Stmt::Function { params, body, .. }) = program.statements.first() else {
+            panic!("expected a function");
+        };
+        let params: Vec<String> = params.iter().map(|p| p.name.clone()).collect();
+        let (locals, returns) = specialize("fib", &params, &[VarType::Int], body).unwrap();
+        assert_eq!(returns, VarType::Int);
+        assert_eq!(locals.get("a"), Some(&VarType::Int));
+        let (_, returns) = specialize("fib", &params, &[VarType::Unknown], body).unwrap();
+        assert_eq!(returns, VarType::Unknown);
+    }
+}
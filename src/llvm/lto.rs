@@ -0,0 +1,328 @@
+//! Link-time optimisation against the C runtime
+//!
+//! build.rs can embed `mdh_runtime.c` as LLVM bitcode alongside the object file. From -O2
+//! the compiler links that bitcode into the user module before the pass pipeline runs, so
+//! small runtime functions (`__mdh_get_tag`, `__mdh_truthy`, `__mdh_list_get`, ...) are
+//! inlined into user code and specialised there.
+//!
+//! Codegen declares runtime functions with MdhValue as a first-class `{ i8, i64 }`, while
+//! clang lowers the same C signature to two `i64`s (or a `byval` pointer once argument
+//! registers run out) and returns `{ i64, i64 }`. Both agree at the machine level, which
+//! is why separately compiled objects link, but inside one module the IR types must match.
+//! Each mismatched declaration therefore becomes an internal, always-inline adapter that
+//! repacks its arguments and calls the real definition; after inlining the repacking folds
+//! away.
+
+use inkwell::attributes::{Attribute, AttributeLoc};
+use inkwell::context::Context;
+use inkwell::memory_buffer::MemoryBuffer;
+use inkwell::module::{Linkage, Module};
+use inkwell::types::{BasicTypeEnum, FunctionType, StructType};
+use inkwell::values::{BasicMetadataValueEnum, FunctionValue};
+
+/// How one codegen argument reaches the clang-lowered definition.
+#[derive(Clone, Copy)]
+enum ArgPlan {
+    Same,
+    /// MdhValue as tag and data, each widened to an i64
+    Split,
+    /// MdhValue spilled to a stack slot passed by pointer
+    ByVal,
+    Int,
+}
+
+#[derive(Clone, Copy)]
+enum RetPlan {
+    Same,
+    /// `{ i64, i64 }` narrowed back to MdhValue
+    Repack,
+    Int,
+}
+
+fn is_mdh_value(ty: StructType) -> bool {
+    let fields = ty.get_field_types();
+    fields.len() == 2
+        && fields[0].is_int_type()
+        && fields[0].into_int_type().get_bit_width() == 8
+        && fields[1].is_int_type()
+        && fields[1].into_int_type().get_bit_width() == 64
+}
+
+fn is_i64(ty: Option<&BasicTypeEnum>) -> bool {
+    matches!(ty, Some(BasicTypeEnum::IntType(int)) if int.get_bit_width() == 64)
+}
+
+/// How to call a definition of type `target` through a declaration of type `declared`;
+/// None when the two cannot be reconciled.
+fn plan_adapter(declared: FunctionType, target: FunctionType) -> Option<(Vec<ArgPlan>, RetPlan)> {
+    if declared.is_var_arg() || target.is_var_arg() {
+        return None;
+    }
+    let wanted = target.get_param_types();
+    let mut next = 0;
+    let mut args = Vec::new();
+    for param in declared.get_param_types() {
+        let plan = match (param, wanted.get(next)) {
+            (BasicTypeEnum::StructType(value), Some(BasicTypeEnum::PointerType(_)))
+                if is_mdh_value(value) =>
+            {
+                ArgPlan::ByVal
+            }
+            (BasicTypeEnum::StructType(value), first)
+                if is_mdh_value(value) && is_i64(first) && is_i64(wanted.get(next + 1)) =>
+            {
+                next += 1;
+                ArgPlan::Split
+            }
+            (param, Some(other)) if param == *other => ArgPlan::Same,
+            (BasicTypeEnum::IntType(_), Some(BasicTypeEnum::IntType(_))) => ArgPlan::Int,
+            _ => return None,
+        };
+        next += 1;
+        args.push(plan);
+    }
+    if next != wanted.len() {
+        return None;
+    }
+
+    let ret = match (declared.get_return_type(), target.get_return_type()) {
+        (None, None) => RetPlan::Same,
+        (Some(a), Some(b)) if a == b => RetPlan::Same,
+        (Some(BasicTypeEnum::StructType(value)), Some(BasicTypeEnum::StructType(pair)))
+            if is_mdh_value(value)
+                && pair.count_fields() == 2
+                && pair.get_field_types().iter().all(|f| is_i64(Some(f))) =>
+        {
+            RetPlan::Repack
+        }
+        (Some(BasicTypeEnum::IntType(_)), Some(BasicTypeEnum::IntType(_))) => RetPlan::Int,
+        _ => return None,
+    };
+    Some((args, ret))
+}
+
+/// Fill the renamed declaration `adapter` with a call to `target`.
+fn build_adapter<'ctx>(
+    context: &'ctx Context,
+    adapter: FunctionValue<'ctx>,
+    target: FunctionValue<'ctx>,
+    args: &[ArgPlan],
+    ret: RetPlan,
+) -> Option<()> {
+    let builder = context.create_builder();
+    let i64_type = context.i64_type();
+    let wanted = target.get_type().get_param_types();
+    builder.position_at_end(context.append_basic_block(adapter, "entry"));
+
+    let mut call_args: Vec<BasicMetadataValueEnum> = Vec::new();
+    for (param, plan) in adapter.get_param_iter().zip(args) {
+        match plan {
+            ArgPlan::Same => call_args.push(param.into()),
+            ArgPlan::Split => {
+                let value = param.into_struct_value();
+                let tag = builder.build_extract_value(value, 0, "tag").ok()?;
+                let data = builder.build_extract_value(value, 1, "data").ok()?;
+                let tag = builder
+                    .build_int_z_extend(tag.into_int_value(), i64_type, "tag64")
+                    .ok()?;
+                call_args.push(tag.into());
+                call_args.push(data.into());
+            }
+            ArgPlan::ByVal => {
+                let slot = builder.build_alloca(param.get_type(), "byval").ok()?;
+                builder.build_store(slot, param).ok()?;
+                call_args.push(slot.into());
+            }
+            ArgPlan::Int => {
+                let target_type = wanted.get(call_args.len())?.into_int_type();
+                let cast = builder
+                    .build_int_cast_sign_flag(param.into_int_value(), target_type, true, "arg")
+                    .ok()?;
+                call_args.push(cast.into());
+            }
+        }
+    }
+
+    let call = builder.build_call(target, &call_args, "call").ok()?;
+    let result = call.try_as_basic_value().left();
+    match (ret, adapter.get_type().get_return_type(), result) {
+        (_, None, _) => {
+            builder.build_return(None).ok()?;
+        }
+        (RetPlan::Same, Some(_), Some(result)) => {
+            builder.build_return(Some(&result)).ok()?;
+        }
+        (RetPlan::Repack, Some(BasicTypeEnum::StructType(value_type)), Some(result)) => {
+            let pair = result.into_struct_value();
+            let tag = builder.build_extract_value(pair, 0, "tag64").ok()?;
+            let data = builder.build_extract_value(pair, 1, "data").ok()?;
+            let tag = builder
+                .build_int_truncate(tag.into_int_value(), context.i8_type(), "tag")
+                .ok()?;
+            let undef = value_type.get_undef();
+            let value = builder.build_insert_value(undef, tag, 0, "v1").ok()?;
+            let value = builder.build_insert_value(value, data, 1, "v2").ok()?;
+            builder
+                .build_return(Some(&value.into_struct_value()))
+                .ok()?;
+        }
+        (RetPlan::Int, Some(BasicTypeEnum::IntType(int_type)), Some(result)) => {
+            let cast = builder
+                .build_int_cast_sign_flag(result.into_int_value(), int_type, true, "ret")
+                .ok()?;
+            builder.build_return(Some(&cast)).ok()?;
+        }
+        _ => return None,
+    }
+    Some(())
+}
+
+/// Link `bitcode` (the runtime) into `module`. Returns false when it was not linked, in
+/// which case the runtime object must still be passed to the system linker; a module
+/// that adapters were added to is still correct to link that way.
+pub fn link_runtime_bitcode<'ctx>(
+    context: &'ctx Context,
+    module: &Module<'ctx>,
+    bitcode: &[u8],
+) -> bool {
+    if bitcode.is_empty() {
+        return false;
+    }
+    let buffer = MemoryBuffer::create_from_memory_range_copy(bitcode, "mdh_runtime");
+    let runtime = match Module::parse_bitcode_from_buffer(&buffer, context) {
+        Ok(runtime) => runtime,
+        Err(_) => return false,
+    };
+
+    // The user module is compiled for the target machine's defaults, and the inliner
+    // refuses callees whose target attributes differ from their callers'.
+    for func in runtime.get_functions() {
+        for key in ["target-cpu", "target-features", "tune-cpu"] {
+            func.remove_string_attribute(AttributeLoc::Function, key);
+        }
+    }
+
+    // Plan everything before touching `module`, so a mismatch leaves it as it was.
+    let mut adapters = Vec::new();
+    for func in module.get_functions() {
+        let name = func.get_name().to_string_lossy().into_owned();
+        let defined = match runtime.get_function(&name) {
+            Some(defined)
+                if defined.count_basic_blocks() > 0
+                    && defined.get_linkage() == Linkage::External =>
+            {
+                defined
+            }
+            _ => continue,
+        };
+        if func.count_basic_blocks() > 0 {
+            // Both sides define it; linking would fail.
+            return false;
+        }
+        if func.get_type() == defined.get_type() {
+            continue;
+        }
+        match plan_adapter(func.get_type(), defined.get_type()) {
+            Some(plan) => adapters.push((func, name, defined.get_type(), plan)),
+            None => return false,
+        }
+    }
+    for global in module.get_globals() {
+        let name = global.get_name().to_string_lossy().into_owned();
+        if global.get_initializer().is_some()
+            && runtime
+                .get_global(&name)
+                .is_some_and(|g| g.get_initializer().is_some())
+        {
+            return false;
+        }
+    }
+
+    let always_inline =
+        context.create_enum_attribute(Attribute::get_named_enum_kind_id("alwaysinline"), 0);
+    for (func, name, target_type, (args, ret)) in adapters {
+        func.as_global_value().set_name(&format!("{name}.mdh_abi"));
+        let target = module.add_function(&name, target_type, None);
+        if build_adapter(context, func, target, &args, ret).is_none() {
+            return false;
+        }
+        func.set_linkage(Linkage::Internal);
+        func.add_attribute(AttributeLoc::Function, always_inline);
+    }
+
+    module.link_in_module(runtime).is_ok()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// A runtime defining `__mdh_pick(MdhValue, int64_t) -> MdhValue` the way clang lowers
+    /// it: `{ i64, i64 } (i64, i64, i64)`, returning its argument.
+    fn clang_style_runtime(context: &Context) -> Vec<u8> {
+        let module = context.create_module("runtime");
+        let i64_type = context.i64_type();
+        let pair = context.struct_type(&[i64_type.into(), i64_type.into()], false);
+        let fn_type = pair.fn_type(&[i64_type.into(), i64_type.into(), i64_type.into()], false);
+        let func = module.add_function("__mdh_pick", fn_type, None);
+        let builder = context.create_builder();
+        builder.position_at_end(context.append_basic_block(func, "entry"));
+        let tag = func.get_nth_param(0).unwrap();
+        let data = func.get_nth_param(1).unwrap();
+        let value = builder
+            .build_insert_value(pair.get_undef(), tag, 0, "tag")
+            .unwrap();
+        let value = builder.build_insert_value(value, data, 1, "data").unwrap();
+        builder
+            .build_return(Some(&value.into_struct_value()))
+            .unwrap();
+        module.write_bitcode_to_memory().as_slice().to_vec()
+    }
+
+    #[test]
+    fn test_link_runtime_bitcode_adapts_mdh_value_abi() {
+        let context = Context::create();
+        let module = context.create_module("user");
+        let i8_type = context.i8_type();
+        let i64_type = context.i64_type();
+        let value_type = context.struct_type(&[i8_type.into(), i64_type.into()], false);
+        let pick = module.add_function(
+            "__mdh_pick",
+            value_type.fn_type(&[value_type.into(), i64_type.into()], false),
+            None,
+        );
+        let caller = module.add_function(
+            "user_fn",
+            value_type.fn_type(&[value_type.into()], false),
+            None,
+        );
+        let builder = context.create_builder();
+        builder.position_at_end(context.append_basic_block(caller, "entry"));
+        let arg = caller.get_nth_param(0).unwrap();
+        let call = builder
+            .build_call(
+                pick,
+                &[arg.into(), i64_type.const_int(3, false).into()],
+                "call",
+            )
+            .unwrap();
+        let result = call.try_as_basic_value().left().unwrap();
+        builder.build_return(Some(&result)).unwrap();
+
+        let bitcode = clang_style_runtime(&context);
+        assert!(link_runtime_bitcode(&context, &module, &bitcode));
+        assert!(module.verify().is_ok());
+        let adapter = module.get_function("__mdh_pick.mdh_abi").unwrap();
+        assert_eq!(adapter.get_linkage(), Linkage::Internal);
+        let linked = module.get_function("__mdh_pick").unwrap();
+        assert!(linked.count_basic_blocks() > 0);
+    }
+
+    #[test]
+    fn test_link_runtime_bitcode_without_bitcode_is_a_no_op() {
+        let context = Context::create();
+        let module = context.create_module("user");
+        assert!(!link_runtime_bitcode(&context, &module, &[]));
+        assert!(!link_runtime_bitcode(&context, &module, b"not bitcode"));
+    }
+}
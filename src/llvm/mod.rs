@@ -10,6 +10,14 @@
 pub mod builtins;
 pub mod codegen;
 pub mod compiler;
+mod bounds;
+mod cache;
+mod heapprof;
+mod infer;
+mod lto;
+mod pgo;
+mod tailcall;
+mod traces;
 #[allow(dead_code)]
 pub mod runtime;
 #[allow(dead_code)]
@@ -19,6 +27,6 @@ pub mod types;
 mod coverage_tests;
 
 // Re-export main types
-pub use compiler::LLVMCompiler;
+pub use compiler::{GcMode, LLVMCompiler, PgoMode};
 #[allow(unused_imports)]
 pub use types::{InferredType, MdhTypes, ValueTag};
@@ -0,0 +1,351 @@
+//! Profile-guided optimisation
+//!
+//! `mdhavers build --pgo-gen` instruments the user module straight after codegen: every
+//! conditional branch gets a taken and a not-taken counter and every function an entry
+//! counter, all in one internal array that `main` hands to `__mdh_pgo_register`. The
+//! runtime writes the array to `$MDH_PROFILE_FILE` (default `default.mdhprof`) at exit,
+//! adding to the counts already there from earlier runs of the same build.
+//!
+//! `--pgo-use` reads the file back at the same point of a later build and annotates the
+//! same sites: `!prof branch_weights` on the branches, which block placement and the
+//! optimisers use to keep the hot side of each tag check on the fall-through path, plus
+//! `inlinehint` on the hottest functions and `cold` on those that never ran. Sites are
+//! numbered by function name and block order, and a checksum of the functions and their
+//! branch counts guards against a profile from a different program.
+
+use std::path::Path;
+
+use inkwell::attributes::{Attribute, AttributeLoc};
+use inkwell::context::Context;
+use inkwell::either::Either;
+use inkwell::module::{Linkage, Module};
+use inkwell::values::{FunctionValue, InstructionOpcode, InstructionValue};
+use inkwell::AddressSpace;
+
+const MAGIC: &[u8; 8] = b"MDHPROF1";
+
+/// Functions entered at least this share of all calls get `inlinehint`.
+const HOT_ENTRY_FRACTION: u64 = 100;
+
+/// The instrumentation sites of a module, in counter order.
+struct Sites<'ctx> {
+    functions: Vec<FunctionValue<'ctx>>,
+    /// Conditional branches: counters `2 * i` (taken) and `2 * i + 1` (not taken)
+    branches: Vec<InstructionValue<'ctx>>,
+    checksum: u64,
+}
+
+impl<'ctx> Sites<'ctx> {
+    fn collect(module: &Module<'ctx>) -> Self {
+        let mut functions: Vec<_> = module
+            .get_functions()
+            .filter(|func| func.count_basic_blocks() > 0)
+            .collect();
+        functions.sort_by_key(|func| func.get_name().to_bytes().to_vec());
+
+        // FNV-1a over each function's name and branch count
+        let mut checksum: u64 = 0xcbf2_9ce4_8422_2325;
+        let mut mix = |bytes: &[u8]| {
+            for byte in bytes {
+                checksum = (checksum ^ *byte as u64).wrapping_mul(0x0100_0000_01b3);
+            }
+        };
+        let mut branches = Vec::new();
+        for func in &functions {
+            let before = branches.len();
+            for block in func.get_basic_blocks() {
+                if let Some(term) = block.get_terminator() {
+                    if term.get_opcode() == InstructionOpcode::Br && term.get_num_operands() == 3 {
+                        branches.push(term);
+                    }
+                }
+            }
+            mix(func.get_name().to_bytes());
+            mix(&((branches.len() - before) as u64).to_le_bytes());
+        }
+        Sites {
+            functions,
+            branches,
+            checksum,
+        }
+    }
+
+    fn counter_count(&self) -> usize {
+        self.branches.len() * 2 + self.functions.len()
+    }
+}
+
+/// Add the counters and the `__mdh_pgo_register` call to `main`.
+pub fn instrument<'ctx>(context: &'ctx Context, module: &Module<'ctx>) {
+    let sites = Sites::collect(module);
+    let main = match module.get_function("main") {
+        Some(main) if main.count_basic_blocks() > 0 => main,
+        _ => return,
+    };
+
+    let i64_type = context.i64_type();
+    let array_type = i64_type.array_type(sites.counter_count() as u32);
+    let counters = module.add_global(array_type, None, "__mdh_pgo_counters");
+    counters.set_linkage(Linkage::Internal);
+    counters.set_initializer(&array_type.const_zero());
+    let counters = counters.as_pointer_value();
+
+    let builder = context.create_builder();
+    let bump = |index| {
+        let zero = i64_type.const_zero();
+        // SAFETY: the index is below the array length (see the callers)
+        let slot = unsafe {
+            builder
+                .build_in_bounds_gep(array_type, counters, &[zero, index], "pgo.slot")
+                .unwrap()
+        };
+        let count = builder
+            .build_load(i64_type, slot, "pgo.count")
+            .unwrap()
+            .into_int_value();
+        let count = builder
+            .build_int_add(count, i64_type.const_int(1, false), "pgo.count")
+            .unwrap();
+        builder.build_store(slot, count).unwrap();
+    };
+
+    for (site, branch) in sites.branches.iter().enumerate() {
+        let condition = match branch.get_operand(0) {
+            Some(Either::Left(value)) => value.into_int_value(),
+            _ => continue,
+        };
+        builder.position_before(branch);
+        let taken = builder
+            .build_int_z_extend(condition, i64_type, "pgo.taken")
+            .unwrap();
+        let index = builder
+            .build_int_sub(
+                i64_type.const_int(site as u64 * 2 + 1, false),
+                taken,
+                "pgo.index",
+            )
+            .unwrap();
+        bump(index);
+    }
+
+    let entries = sites.branches.len() * 2;
+    for (site, func) in sites.functions.iter().enumerate() {
+        let first = func
+            .get_first_basic_block()
+            .and_then(|block| block.get_first_instruction());
+        if let Some(first) = first {
+            builder.position_before(&first);
+            bump(i64_type.const_int((entries + site) as u64, false));
+        }
+    }
+
+    let register = module
+        .get_function("__mdh_pgo_register")
+        .unwrap_or_else(|| {
+            let fn_type = context.void_type().fn_type(
+                &[
+                    i64_type.ptr_type(AddressSpace::default()).into(),
+                    i64_type.into(),
+                    i64_type.into(),
+                ],
+                false,
+            );
+            module.add_function("__mdh_pgo_register", fn_type, Some(Linkage::External))
+        });
+    if let Some(first) = main
+        .get_first_basic_block()
+        .and_then(|block| block.get_first_instruction())
+    {
+        builder.position_before(&first);
+        let pointer = builder
+            .build_pointer_cast(
+                counters,
+                i64_type.ptr_type(AddressSpace::default()),
+                "pgo.counters",
+            )
+            .unwrap();
+        builder
+            .build_call(
+                register,
+                &[
+                    pointer.into(),
+                    i64_type
+                        .const_int(sites.counter_count() as u64, false)
+                        .into(),
+                    i64_type.const_int(sites.checksum, false).into(),
+                ],
+                "",
+            )
+            .unwrap();
+    }
+}
+
+/// The counters of a profile file, or why they cannot be used for this module.
+fn read_profile(bytes: &[u8], checksum: u64, count: usize) -> Result<Vec<u64>, String> {
+    let word = |index: usize| {
+        bytes
+            .get(8 + index * 8..16 + index * 8)
+            .map(|word| u64::from_ne_bytes(word.try_into().unwrap()))
+    };
+    if bytes.get(..8) != Some(&MAGIC[..]) {
+        return Err("no an mdhavers profile".to_string());
+    }
+    if word(0) != Some(checksum) || word(1) != Some(count as u64) {
+        return Err("it was recorded fae a different program".to_string());
+    }
+    (0..count)
+        .map(|index| word(index + 2).ok_or_else(|| "it's truncated".to_string()))
+        .collect()
+}
+
+/// Annotate the module from the profile at `path`. A profile for a different program is
+/// reported and ignored; the result says whether one was applied.
+pub fn annotate<'ctx>(
+    context: &'ctx Context,
+    module: &Module<'ctx>,
+    path: &Path,
+) -> Result<bool, String> {
+    let bytes = std::fs::read(path)
+        .map_err(|e| format!("Cannae read profile {}: {}", path.display(), e))?;
+    let sites = Sites::collect(module);
+    let counters = match read_profile(&bytes, sites.checksum, sites.counter_count()) {
+        Ok(counters) => counters,
+        Err(reason) => {
+            eprintln!("warning: ignoring profile {}: {}", path.display(), reason);
+            return Ok(false);
+        }
+    };
+
+    let i32_type = context.i32_type();
+    let prof = context.get_kind_id("prof");
+    for (site, branch) in sites.branches.iter().enumerate() {
+        let (taken, not_taken) = (counters[site * 2], counters[site * 2 + 1]);
+        if taken == 0 && not_taken == 0 {
+            continue;
+        }
+        // Weights are 32-bit; scale both sides down together
+        let scale = taken.max(not_taken) / u32::MAX as u64 + 1;
+        let weights = context.metadata_node(&[
+            context.metadata_string("branch_weights").into(),
+            i32_type.const_int(taken / scale, false).into(),
+            i32_type.const_int(not_taken / scale, false).into(),
+        ]);
+        branch
+            .set_metadata(weights, prof)
+            .map_err(|e| e.to_string())?;
+    }
+
+    let entries = &counters[sites.branches.len() * 2..];
+    let total: u64 = entries.iter().sum();
+    if total > 0 {
+        let hot = Attribute::get_named_enum_kind_id("inlinehint");
+        let cold = Attribute::get_named_enum_kind_id("cold");
+        for (func, &count) in sites.functions.iter().zip(entries) {
+            if func.get_name().to_bytes() == b"main" {
+                continue;
+            }
+            let kind = if count == 0 {
+                cold
+            } else if count >= total / HOT_ENTRY_FRACTION {
+                hot
+            } else {
+                continue;
+            };
+            func.add_attribute(
+                AttributeLoc::Function,
+                context.create_enum_attribute(kind, 0),
+            );
+        }
+    }
+    Ok(true)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// `main` branching on its argument into one of two helpers.
+    fn branchy_module(context: &Context) -> Module<'_> {
+        let module = context.create_module("user");
+        let i64_type = context.i64_type();
+        let fn_type = i64_type.fn_type(&[i64_type.into()], false);
+        let builder = context.create_builder();
+        let mut helpers = Vec::new();
+        for name in ["hot_helper", "cold_helper"] {
+            let func = module.add_function(name, fn_type, None);
+            builder.position_at_end(context.append_basic_block(func, "entry"));
+            builder
+                .build_return(Some(&func.get_nth_param(0).unwrap().into_int_value()))
+                .unwrap();
+            helpers.push(func);
+        }
+        let main = module.add_function("main", fn_type, None);
+        let entry = context.append_basic_block(main, "entry");
+        let then = context.append_basic_block(main, "then");
+        let other = context.append_basic_block(main, "else");
+        builder.position_at_end(entry);
+        let arg = main.get_nth_param(0).unwrap().into_int_value();
+        let cond = builder
+            .build_int_compare(
+                inkwell::IntPredicate::SGT,
+                arg,
+                i64_type.const_zero(),
+                "cond",
+            )
+            .unwrap();
+        builder.build_conditional_branch(cond, then, other).unwrap();
+        for (block, helper) in [(then, helpers[0]), (other, helpers[1])] {
+            builder.position_at_end(block);
+            let result = builder
+                .build_call(helper, &[arg.into()], "r")
+                .unwrap()
+                .try_as_basic_value()
+                .left()
+                .unwrap();
+            builder.build_return(Some(&result)).unwrap();
+        }
+        module
+    }
+
+    fn profile(checksum: u64, counters: &[u64]) -> Vec<u8> {
+        let mut bytes = MAGIC.to_vec();
+        for word in [checksum, counters.len() as u64].iter().chain(counters) {
+            bytes.extend_from_slice(&word.to_ne_bytes());
+        }
+        bytes
+    }
+
+    #[test]
+    fn test_instrument_counts_branches_and_registers() {
+        let context = Context::create();
+        let module = branchy_module(&context);
+        instrument(&context, &module);
+        assert!(module.verify().is_ok());
+        let ir = module.print_to_string().to_string();
+        // One branch (two counters) and three entry counters
+        assert!(ir.contains("@__mdh_pgo_counters = internal global [5 x i64]"));
+        assert!(ir.contains("call void @__mdh_pgo_register"));
+    }
+
+    #[test]
+    fn test_annotate_sets_weights_and_rejects_other_programs() {
+        let context = Context::create();
+        let module = branchy_module(&context);
+        let checksum = Sites::collect(&module).checksum;
+        let dir = std::env::temp_dir().join(format!("mdh_pgo_{}", std::process::id()));
+        std::fs::create_dir_all(&dir).unwrap();
+
+        let stale = dir.join("stale.mdhprof");
+        std::fs::write(&stale, profile(checksum ^ 1, &[9, 1, 0, 0, 10])).unwrap();
+        assert_eq!(annotate(&context, &module, &stale), Ok(false));
+
+        // Functions sort as cold_helper, hot_helper, main
+        let path = dir.join("good.mdhprof");
+        std::fs::write(&path, profile(checksum, &[9, 1, 1, 9, 10])).unwrap();
+        assert_eq!(annotate(&context, &module, &path), Ok(true));
+        assert!(module.verify().is_ok());
+        let ir = module.print_to_string().to_string();
+        assert!(ir.contains("!{!\"branch_weights\", i32 9, i32 1}"));
+        let _ = std::fs::remove_dir_all(&dir);
+    }
+}
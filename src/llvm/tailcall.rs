@@ -0,0 +1,631 @@
+//! Self tail calls as loops
+//!
+//! `gie f(args)` as the last thing `f` does needs no fresh frame: the arguments can be
+//! stored over the parameters and the body started again. Rewriting such calls into a
+//! loop before codegen lets deep recursion run in constant stack and skips the call, the
+//! frame setup and the return. Only plain functions are rewritten: a closure in the body
+//! could be holding a parameter the loop overwrites, a `brak` or `haud` outside any loop
+//! would land in the new one, and a name bound as a variable anywhere might not be `f`
+//! when the call runs. Calls to other functions in tail position keep LLVM's `tail`
+//! marker and are left to the backend's sibling-call lowering.
+
+use std::collections::{HashMap, HashSet};
+
+use crate::ast::{
+    DestructPattern, Expr, FStringPart, Literal, MatchArm, Param, Pattern, Program, Span, Stmt,
+};
+
+/// `program` with the self tail calls of every eligible function (nested ones too) looped
+pub fn loop_self_tail_calls(program: &Program) -> Program {
+    let mut facts = Facts::default();
+    facts.stmts(&program.statements);
+    Program::new(
+        program
+            .statements
+            .iter()
+            .map(|stmt| rewrite(stmt, &facts))
+            .collect(),
+    )
+}
+
+/// What a walk over some statements found
+#[derive(Default)]
+struct Facts {
+    /// Names bound by `ken`, assignment, loops, patterns, catches and lambdas
+    bound: HashSet<String>,
+    /// How often each function name is defined
+    defined: HashMap<String, usize>,
+    /// Whether a function, class or lambda could capture a local
+    closures: bool,
+    /// Whether a `brak` or `haud` sits outside any loop
+    stray_jump: bool,
+    loops: usize,
+}
+
+impl Facts {
+    fn stmts(&mut self, stmts: &[Stmt]) {
+        for stmt in stmts {
+            self.stmt(stmt);
+        }
+    }
+
+    fn body(&mut self, body: &[Stmt]) {
+        let loops = std::mem::replace(&mut self.loops, 0);
+        self.stmts(body);
+        self.loops = loops;
+    }
+
+    fn looped(&mut self, body: &Stmt) {
+        self.loops += 1;
+        self.stmt(body);
+        self.loops -= 1;
+    }
+
+    fn bind(&mut self, name: &str) {
+        self.bound.insert(name.to_string());
+    }
+
+    fn stmt(&mut self, stmt: &Stmt) {
+        match stmt {
+            Stmt::VarDecl {
+                name, initializer, ..
+            } => {
+                self.bind(name);
+                if let Some(init) = initializer {
+                    self.expr(init);
+                }
+            }
+            Stmt::Expression { expr, .. } | Stmt::Print { value: expr, .. } => self.expr(expr),
+            Stmt::Block { statements, .. } => self.stmts(statements),
+            Stmt::If {
+                condition,
+                then_branch,
+                else_branch,
+                ..
+            } => {
+                self.expr(condition);
+                self.stmt(then_branch);
+                if let Some(else_branch) = else_branch {
+                    self.stmt(else_branch);
+                }
+            }
+            Stmt::While {
+                condition, body, ..
+            } => {
+                self.expr(condition);
+                self.looped(body);
+            }
+            Stmt::For {
+                variable,
+                iterable,
+                body,
+                ..
+            } => {
+                self.bind(variable);
+                self.expr(iterable);
+                self.looped(body);
+            }
+            Stmt::Function { name, body, .. } => {
+                *self.defined.entry(name.clone()).or_insert(0) += 1;
+                self.closures = true;
+                self.body(body);
+            }
+            Stmt::Return { value, .. } => {
+                if let Some(value) = value {
+                    self.expr(value);
+                }
+            }
+            Stmt::Break { .. } | Stmt::Continue { .. } => {
+                if self.loops == 0 {
+                    self.stray_jump = true;
+                }
+            }
+            Stmt::Class { name, methods, .. } => {
+                self.bind(name);
+                self.closures = true;
+                for method in methods {
+                    if let Stmt::Function { body, .. } = method {
+                        self.body(body);
+                    }
+                }
+            }
+            Stmt::Struct { name, .. } => self.bind(name),
+            Stmt::Import { alias, .. } => {
+                if let Some(alias) = alias {
+                    self.bind(alias);
+                }
+            }
+            Stmt::TryCatch {
+                try_block,
+                error_name,
+                catch_block,
+                ..
+            } => {
+                self.bind(error_name);
+                self.stmt(try_block);
+                self.stmt(catch_block);
+            }
+            Stmt::Match { value, arms, .. } => {
+                self.expr(value);
+                for arm in arms {
+                    match &arm.pattern {
+                        Pattern::Identifier(name) => self.bind(name),
+                        Pattern::Range { start, end } => {
+                            self.expr(start);
+                            self.expr(end);
+                        }
+                        Pattern::Literal(_) | Pattern::Wildcard => {}
+                    }
+                    self.stmt(&arm.body);
+                }
+            }
+            Stmt::Assert {
+                condition, message, ..
+            } => {
+                self.expr(condition);
+                if let Some(message) = message {
+                    self.expr(message);
+                }
+            }
+            Stmt::Destructure {
+                patterns, value, ..
+            } => {
+                for pattern in patterns {
+                    if let DestructPattern::Variable(name) | DestructPattern::Rest(name) = pattern {
+                        self.bind(name);
+                    }
+                }
+                self.expr(value);
+            }
+            Stmt::Log {
+                message, extras, ..
+            } => {
+                self.expr(message);
+                for extra in extras {
+                    self.expr(extra);
+                }
+            }
+            Stmt::Hurl { message, .. } => self.expr(message),
+        }
+    }
+
+    fn expr(&mut self, expr: &Expr) {
+        match expr {
+            Expr::Assign { name, value, .. } => {
+                self.bind(name);
+                self.expr(value);
+            }
+            Expr::Lambda { params, body, .. } => {
+                self.closures = true;
+                for param in params {
+                    self.bind(param);
+                }
+                self.expr(body);
+            }
+            Expr::BlockExpr { statements, .. } => self.stmts(statements),
+            Expr::Literal { .. } | Expr::Variable { .. } | Expr::Masel { .. } => {}
+            Expr::Binary { left, right, .. }
+            | Expr::Logical { left, right, .. }
+            | Expr::Pipe { left, right, .. } => {
+                self.expr(left);
+                self.expr(right);
+            }
+            Expr::Unary { operand, .. } => self.expr(operand),
+            Expr::Call {
+                callee, arguments, ..
+            } => {
+                self.expr(callee);
+                for argument in arguments {
+                    self.expr(argument);
+                }
+            }
+            Expr::Get { object, .. } => self.expr(object),
+            Expr::Set { object, value, .. } => {
+                self.expr(object);
+                self.expr(value);
+            }
+            Expr::Index { object, index, .. } => {
+                self.expr(object);
+                self.expr(index);
+            }
+            Expr::IndexSet {
+                object,
+                index,
+                value,
+                ..
+            } => {
+                self.expr(object);
+                self.expr(index);
+                self.expr(value);
+            }
+            Expr::Slice {
+                object,
+                start,
+                end,
+                step,
+                ..
+            } => {
+                self.expr(object);
+                for part in [start, end, step].into_iter().flatten() {
+                    self.expr(part);
+                }
+            }
+            Expr::List { elements, .. } => {
+                for element in elements {
+                    self.expr(element);
+                }
+            }
+            Expr::Dict { pairs, .. } => {
+                for (key, value) in pairs {
+                    self.expr(key);
+                    self.expr(value);
+                }
+            }
+            Expr::Range { start, end, .. } => {
+                self.expr(start);
+                self.expr(end);
+            }
+            Expr::Grouping { expr, .. } | Expr::Spread { expr, .. } => self.expr(expr),
+            Expr::Input { prompt, .. } => self.expr(prompt),
+            Expr::FString { parts, .. } => {
+                for part in parts {
+                    if let FStringPart::Expr(expr) = part {
+                        self.expr(expr);
+                    }
+                }
+            }
+            Expr::Ternary {
+                condition,
+                then_expr,
+                else_expr,
+                ..
+            } => {
+                self.expr(condition);
+                self.expr(then_expr);
+                self.expr(else_expr);
+            }
+        }
+    }
+}
+
+/// `stmt` with the functions in it, at any depth of statements, rewritten
+fn rewrite(stmt: &Stmt, program: &Facts) -> Stmt {
+    let boxed = |stmt: &Stmt| Box::new(rewrite(stmt, program));
+    match stmt {
+        Stmt::Function {
+            name,
+            params,
+            body,
+            span,
+        } => {
+            let body: Vec<Stmt> = body.iter().map(|stmt| rewrite(stmt, program)).collect();
+            let body = looped_body(name, params, &body, *span, program).unwrap_or(body);
+            Stmt::Function {
+                name: name.clone(),
+                params: params.clone(),
+                body,
+                span: *span,
+            }
+        }
+        Stmt::Block { statements, span } => Stmt::Block {
+            statements: statements
+                .iter()
+                .map(|stmt| rewrite(stmt, program))
+                .collect(),
+            span: *span,
+        },
+        Stmt::If {
+            condition,
+            then_branch,
+            else_branch,
+            span,
+        } => Stmt::If {
+            condition: condition.clone(),
+            then_branch: boxed(then_branch),
+            else_branch: else_branch.as_deref().map(boxed),
+            span: *span,
+        },
+        Stmt::While {
+            condition,
+            body,
+            span,
+        } => Stmt::While {
+            condition: condition.clone(),
+            body: boxed(body),
+            span: *span,
+        },
+        Stmt::For {
+            variable,
+            iterable,
+            body,
+            span,
+        } => Stmt::For {
+            variable: variable.clone(),
+            iterable: iterable.clone(),
+            body: boxed(body),
+            span: *span,
+        },
+        Stmt::TryCatch {
+            try_block,
+            error_name,
+            catch_block,
+            span,
+        } => Stmt::TryCatch {
+            try_block: boxed(try_block),
+            error_name: error_name.clone(),
+            catch_block: boxed(catch_block),
+            span: *span,
+        },
+        Stmt::Match { value, arms, span } => Stmt::Match {
+            value: value.clone(),
+            arms: arms
+                .iter()
+                .map(|arm| MatchArm {
+                    pattern: arm.pattern.clone(),
+                    body: rewrite(&arm.body, program),
+                    span: arm.span,
+                })
+                .collect(),
+            span: *span,
+        },
+        _ => stmt.clone(),
+    }
+}
+
+/// The body of `name` run as `whiles aye { ... }`, each self tail call storing its
+/// arguments in the parameters and starting the next pass; `None` if it has no such
+/// call or can't be looped safely
+fn looped_body(
+    name: &str,
+    params: &[Param],
+    body: &[Stmt],
+    span: Span,
+    program: &Facts,
+) -> Option<Vec<Stmt>> {
+    if program.bound.contains(name)
+        || program.defined.get(name) != Some(&1)
+        || params.iter().any(|param| param.name == name)
+    {
+        return None;
+    }
+    let mut facts = Facts::default();
+    facts.stmts(body);
+    if facts.closures || facts.stray_jump {
+        return None;
+    }
+
+    let mut tail = Tail {
+        name,
+        params,
+        sites: 0,
+    };
+    let mut statements: Vec<Stmt> = body.iter().map(|stmt| tail.stmt(stmt)).collect();
+    if tail.sites == 0 {
+        return None;
+    }
+    // Falling off the end returns nil, as it did before
+    if !matches!(body.last(), Some(Stmt::Return { .. })) {
+        statements.push(Stmt::Return { value: None, span });
+    }
+    Some(vec![Stmt::While {
+        condition: Expr::Literal {
+            value: Literal::Bool(true),
+            span,
+        },
+        body: Box::new(Stmt::Block { statements, span }),
+        span,
+    }])
+}
+
+/// Finds `gie name(...)` in tail position: through blocks, branches and match arms only,
+/// since a loop, catch or later statement would see the jump
+struct Tail<'a> {
+    name: &'a str,
+    params: &'a [Param],
+    sites: usize,
+}
+
+impl Tail<'_> {
+    fn stmt(&mut self, stmt: &Stmt) -> Stmt {
+        match stmt {
+            Stmt::Return {
+                value:
+                    Some(Expr::Call {
+                        callee, arguments, ..
+                    }),
+                span,
+            } if matches!(callee.as_ref(), Expr::Variable { name, .. } if name == self.name) => {
+                self.jump(arguments, *span).unwrap_or_else(|| stmt.clone())
+            }
+            Stmt::Block { statements, span } => Stmt::Block {
+                statements: statements.iter().map(|stmt| self.stmt(stmt)).collect(),
+                span: *span,
+            },
+            Stmt::If {
+                condition,
+                then_branch,
+                else_branch,
+                span,
+            } => Stmt::If {
+                condition: condition.clone(),
+                then_branch: Box::new(self.stmt(then_branch)),
+                else_branch: else_branch.as_deref().map(|stmt| Box::new(self.stmt(stmt))),
+                span: *span,
+            },
+            Stmt::Match { value, arms, span } => Stmt::Match {
+                value: value.clone(),
+                arms: arms
+                    .iter()
+                    .map(|arm| MatchArm {
+                        pattern: arm.pattern.clone(),
+                        body: self.stmt(&arm.body),
+                        span: arm.span,
+                    })
+                    .collect(),
+                span: *span,
+            },
+            _ => stmt.clone(),
+        }
+    }
+
+    /// The parameter stores and `haud` standing in for one call, if its arguments map
+    /// straight onto the parameters
+    fn jump(&mut self, arguments: &[Expr], span: Span) -> Option<Stmt> {
+        if arguments.len() > self.params.len()
+            || arguments
+                .iter()
+                .any(|argument| matches!(argument, Expr::Spread { .. }))
+        {
+            return None;
+        }
+        let mut stores = Vec::new();
+        for (i, param) in self.params.iter().enumerate() {
+            let value = match (arguments.get(i), &param.default) {
+                (Some(argument), _) => argument.clone(),
+                // Only a literal default reads the same here as in a fresh call
+                (None, Some(default @ Expr::Literal { .. })) => default.clone(),
+                _ => return None,
+            };
+            // Passing a parameter straight back leaves it as it is
+            if !matches!(&value, Expr::Variable { name, .. } if *name == param.name) {
+                stores.push((param.name.clone(), value));
+            }
+        }
+
+        let site = self.sites;
+        self.sites += 1;
+        let assign = |name: String, value: Expr| Stmt::Expression {
+            expr: Expr::Assign {
+                name,
+                value: Box::new(value),
+                slot: None,
+                span,
+            },
+            span,
+        };
+        let mut statements = Vec::new();
+        if stores.len() == 1 {
+            let (name, value) = stores.pop().unwrap();
+            statements.push(assign(name, value));
+        } else {
+            // Every argument is worked out before any parameter changes
+            let temps: Vec<String> = (0..stores.len())
+                .map(|i| format!("__tail_{}_{}", site, i))
+                .collect();
+            for (temp, (_, value)) in temps.iter().zip(&stores) {
+                statements.push(Stmt::VarDecl {
+                    name: temp.clone(),
+                    initializer: Some(value.clone()),
+                    span,
+                });
+            }
+            for (temp, (name, _)) in temps.into_iter().zip(stores) {
+                let value = Expr::Variable {
+                    name: temp,
+                    slot: None,
+                    span,
+                };
+                statements.push(assign(name, value));
+            }
+        }
+        statements.push(Stmt::Continue { span });
+        Some(Stmt::Block { statements, span })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn looped(source: &str) -> Vec<Stmt> {
+        let program = crate::parser::parse(source).expect("parse");
+        loop_self_tail_calls(&program).statements
+    }
+
+    fn body_of<'a>(statements: &'a [Stmt], wanted: &str) -> &'a [Stmt] {
+        statements
+            .iter()
+            .find_map(|stmt| match stmt {
+                Stmt::Function { name, body, .. } if name == wanted => Some(body.as_slice()),
+                _ => None,
+            })
+            .expect("function")
+    }
+
+    fn is_loop(body: &[Stmt]) -> bool {
+        matches!(
+            body,
+            [Stmt::While {
+                condition: Expr::Literal {
+                    value: Literal::Bool(true),
+                    ..
+                },
+                ..
+            }]
+        )
+    }
+
+    #[test]
+    fn test_self_tail_calls_become_a_loop() {
+        let statements = looped(
+            "dae sum(n, acc = 0) {\n gin n == 0 {\n gie acc\n }\n gie sum(n - 1, acc + n)\n}\n\
+             dae count(n) {\n gin n > 0 {\n gie count(n - 1)\n }\n}",
+        );
+        assert!(is_loop(body_of(&statements, "sum")));
+        assert!(is_loop(body_of(&statements, "count")));
+    }
+
+    #[test]
+    fn test_arguments_are_all_read_afore_ony_parameter_changes() {
+        let statements =
+            looped("dae swap(a, b, n) {\n gin n == 0 {\n gie a\n }\n gie swap(b, a, n - 1)\n}");
+        let Stmt::While { body, .. } = &body_of(&statements, "swap")[0] else {
+            panic!("not looped");
+        };
+        let Stmt::Block { statements, .. } = body.as_ref() else {
+            panic!("no block");
+        };
+        let Some(Stmt::Block {
+            statements: jump, ..
+        }) = statements.last()
+        else {
+            panic!("no jump");
+        };
+        let decls = jump
+            .iter()
+            .take_while(|stmt| matches!(stmt, Stmt::VarDecl { .. }))
+            .count();
+        assert_eq!(decls, 3);
+        assert!(matches!(jump.last(), Some(Stmt::Continue { .. })));
+    }
+
+    #[test]
+    fn test_functions_that_cannae_be_looped_are_left_alone() {
+        for source in [
+            // Not in tail position
+            "dae f(n) {\n gin n == 0 {\n gie 1\n }\n gie n * f(n - 1)\n}",
+            // Inside a loop the `haud` would hit the wrong one
+            "dae f(n) {\n whiles aye {\n gie f(n - 1)\n }\n}",
+            // A closure could hold `n`
+            "dae f(n) {\n ken g = |x| x + n\n gie f(n - 1)\n}",
+            // The name might not be the function when the call runs
+            "dae f(n) {\n gie f(n - 1)\n}\nf = 3",
+            // Too many arguments, or a missing one with no literal default
+            "dae f(n) {\n gie f(n - 1, 2)\n}",
+            "dae f(n, m) {\n gie f(n - 1)\n}",
+        ] {
+            let statements = looped(source);
+            assert!(!is_loop(body_of(&statements, "f")), "{}", source);
+        }
+    }
+
+    #[test]
+    fn test_nested_functions_are_looped_on_their_ain() {
+        let statements = looped(
+            "dae outer(n) {\n dae inner(k, acc) {\n gin k == 0 {\n gie acc\n }\n gie inner(k - 1, acc + 1)\n }\n gie inner(n, 0)\n}",
+        );
+        let outer = body_of(&statements, "outer");
+        assert!(!is_loop(outer));
+        assert!(is_loop(body_of(outer, "inner")));
+    }
+}
@@ -0,0 +1,180 @@
+//! Stack traces for native builds
+//!
+//! Codegen notes each user function's name, file and line in a [`FrameTable`] as it
+//! compiles the body. Straight after codegen, [`emit`] keeps frame pointers in the
+//! module's functions, moves the user ones into the `mdh_text` section, and has `main`
+//! hand the runtime their addresses with `__mdh_frames_register`.
+//!
+//! A hurl then records the return addresses up the frame-pointer chain, which costs a
+//! couple of loads a frame. Nothing is looked up until a trace is printed (an uncaught
+//! hurl) or read with `stacktrace()`: only then does the runtime sort the table and find
+//! the function each address falls in, bounded by the section's start and stop symbols.
+
+use std::collections::HashMap;
+
+use inkwell::attributes::AttributeLoc;
+use inkwell::context::Context;
+use inkwell::module::{Linkage, Module};
+use inkwell::types::PointerType;
+use inkwell::values::{BasicValueEnum, GlobalValue};
+use inkwell::AddressSpace;
+
+const SECTION: &str = "mdh_text";
+
+/// Where a user function came from, by its LLVM name
+#[derive(Debug, Default)]
+pub(super) struct FrameTable {
+    frames: HashMap<String, Frame>,
+}
+
+#[derive(Debug, Clone, PartialEq)]
+struct Frame {
+    name: String,
+    file: String,
+    line: usize,
+}
+
+impl FrameTable {
+    pub(super) fn note(&mut self, function: &str, name: &str, file: &str, line: usize) {
+        self.frames.insert(
+            function.to_string(),
+            Frame {
+                name: name.to_string(),
+                file: file.to_string(),
+                line,
+            },
+        );
+    }
+
+    /// The frame for `function`; a specialised clone (`name.suffix`) is its original's
+    fn get(&self, function: &str) -> Option<&Frame> {
+        self.frames.get(function).or_else(|| {
+            function
+                .split_once('.')
+                .and_then(|(base, _)| self.frames.get(base))
+        })
+    }
+}
+
+/// Keep frame pointers in the module's functions, gather the noted ones in `mdh_text`, and
+/// register the table from `main`.
+pub fn emit<'ctx>(context: &'ctx Context, module: &Module<'ctx>, table: &FrameTable) {
+    let main = match module.get_function("main") {
+        Some(main) if main.count_basic_blocks() > 0 => main,
+        _ => return,
+    };
+    // Every function codegen wrote keeps them, so thunks and wrappers between two user
+    // functions don't break the chain
+    let frame_pointer = context.create_string_attribute("frame-pointer", "all");
+    let defined: Vec<_> = module
+        .get_functions()
+        .filter(|func| func.count_basic_blocks() > 0)
+        .collect();
+    for func in &defined {
+        func.add_attribute(AttributeLoc::Function, frame_pointer);
+    }
+    let functions: Vec<_> = defined
+        .into_iter()
+        .filter_map(|func| {
+            let name = func.get_name().to_string_lossy().into_owned();
+            table.get(&name).map(|frame| (func, frame.clone()))
+        })
+        .collect();
+    if functions.is_empty() {
+        return;
+    }
+
+    let i8_ptr = context.i8_type().ptr_type(AddressSpace::default());
+    let i64_type = context.i64_type();
+    let mut names = Vec::new();
+    let mut code = Vec::new();
+    let mut lines = Vec::new();
+    for (func, frame) in &functions {
+        // Mach-O and COFF name their sections differently; there the trace stays empty
+        if cfg!(all(unix, not(target_os = "macos"))) {
+            func.as_global_value().set_section(Some(SECTION));
+        }
+        names.extend_from_slice(frame.name.as_bytes());
+        names.push(0);
+        names.extend_from_slice(frame.file.as_bytes());
+        names.push(0);
+        code.push(func.as_global_value().as_pointer_value().const_cast(i8_ptr));
+        lines.push(i64_type.const_int(frame.line as u64, false));
+    }
+
+    let global = |name: &str, value: BasicValueEnum<'ctx>| {
+        let global = module.add_global(value.get_type(), None, name);
+        global.set_linkage(Linkage::Internal);
+        global.set_constant(true);
+        global.set_initializer(&value);
+        global
+    };
+    let names = global(
+        "__mdh_frames_names",
+        context.const_string(&names, false).into(),
+    );
+    let code = global("__mdh_frames_code", i8_ptr.const_array(&code).into());
+    let lines = global("__mdh_frames_lines", i64_type.const_array(&lines).into());
+
+    let i64_ptr = i64_type.ptr_type(AddressSpace::default());
+    let i8_ptr_ptr = i8_ptr.ptr_type(AddressSpace::default());
+    let register = module
+        .get_function("__mdh_frames_register")
+        .unwrap_or_else(|| {
+            let fn_type = context.void_type().fn_type(
+                &[
+                    i8_ptr_ptr.into(),
+                    i8_ptr.into(),
+                    i64_ptr.into(),
+                    i64_type.into(),
+                ],
+                false,
+            );
+            module.add_function("__mdh_frames_register", fn_type, Some(Linkage::External))
+        });
+    let builder = context.create_builder();
+    if let Some(first) = main
+        .get_first_basic_block()
+        .and_then(|block| block.get_first_instruction())
+    {
+        builder.position_before(&first);
+        let cast = |global: GlobalValue<'ctx>, ty: PointerType<'ctx>, name: &str| {
+            builder
+                .build_pointer_cast(global.as_pointer_value(), ty, name)
+                .unwrap()
+        };
+        let code = cast(code, i8_ptr_ptr, "frames.code");
+        let names = cast(names, i8_ptr, "frames.names");
+        let lines = cast(lines, i64_ptr, "frames.lines");
+        builder
+            .build_call(
+                register,
+                &[
+                    code.into(),
+                    names.into(),
+                    lines.into(),
+                    i64_type.const_int(functions.len() as u64, false).into(),
+                ],
+                "",
+            )
+            .unwrap();
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_specialised_clones_share_their_original_frame() {
+        let mut table = FrameTable::default();
+        table.note("fib", "fib", "a.braw", 3);
+        table.note("Counter_bump", "Counter.bump", "a.braw", 9);
+        assert_eq!(table.get("fib.int").map(|f| f.line), Some(3));
+        assert_eq!(
+            table.get("Counter_bump").map(|f| f.name.as_str()),
+            Some("Counter.bump")
+        );
+        assert!(table.get("__mdh_thunk").is_none());
+    }
+}
@@ -32,6 +32,31 @@ impl ValueTag {
     }
 }
 
+/// Dict block layout shared with runtime/mdh_runtime.c:
+/// `[i64 count][count x {key, value}][tail]`, where the tail slot is owned by the runtime.
+pub const DICT_HEADER_SIZE: u64 = 8;
+/// Size of one `{key, value}` entry (two MdhValues).
+pub const DICT_ENTRY_SIZE: u64 = 32;
+/// Size of the trailing runtime-owned slot (one MdhValue).
+pub const DICT_TAIL_SIZE: u64 = 16;
+/// Dicts with at least this many entries are looked up through the runtime hash index -
+/// must match MDH_DICT_INDEX_MIN in runtime/mdh_runtime.h
+pub const DICT_INDEX_MIN: u64 = 8;
+
+/// String header layout shared with `MdhString` in runtime/mdh_runtime.h: runtime-built
+/// strings are preceded by `{i64 length, u32 hash, u32 magic}`. A header is only present when
+/// the char pointer is 8 mod 16 and the magic equals `STRING_MAGIC ^ (ptr >> 3)`; other
+/// strings (literals, codegen buffers) have no header and their length comes from strlen.
+pub const STRING_HEADER_SIZE: u64 = 16;
+/// Offset of the magic word, relative to the char pointer.
+pub const STRING_MAGIC_OFFSET: i64 = -4;
+/// Must match MDH_STRING_MAGIC in runtime/mdh_runtime.h
+pub const STRING_MAGIC: u32 = 0xFF5A_17E5;
+
+/// Bytes reserved for a try block's jmp_buf; the runtime checks every platform jmp_buf fits -
+/// must match MDH_JMP_BUF_BYTES in runtime/mdh_runtime.h
+pub const JMP_BUF_SIZE: u32 = 512;
+
 /// LLVM types used throughout codegen
 pub struct MdhTypes<'ctx> {
     /// The main MdhValue struct type: { i8 tag, i64 data }
@@ -1,14 +1,17 @@
 use std::cell::RefCell;
+use std::collections::HashMap;
 use std::fs::OpenOptions;
 use std::io::Write;
 use std::rc::Rc;
 use std::sync::atomic::{AtomicU64, AtomicU8, Ordering};
 use std::sync::{Mutex, OnceLock};
+use std::time::Instant;
 
 use chrono::Local;
 use serde_json::{json, Map, Value as JsonValue};
 
 use crate::ast::LogLevel;
+use crate::binlog::{self, BinlogWriter};
 use crate::error::HaversResult;
 use crate::value::{DictValue, NativeObject, Value};
 
@@ -20,6 +23,8 @@ pub enum LogFormat {
     Text,
     Json,
     Compact,
+    /// Frames from [`crate::binlog`], written to file sinks only.
+    Binary,
 }
 
 #[derive(Debug, Clone)]
@@ -166,6 +171,8 @@ pub struct LoggerCore {
     pub color: bool,
     pub timestamps: bool,
     pub sinks: Vec<LogSink>,
+    /// The binary session in progress; None until the first binary record.
+    pub binlog: Option<BinlogWriter>,
 }
 
 impl LoggerCore {
@@ -175,10 +182,15 @@ impl LoggerCore {
             color: false,
             timestamps: true,
             sinks: vec![LogSink::Stderr],
+            binlog: None,
         }
     }
 
     pub fn log(&mut self, record: &LogRecord) {
+        if let LogFormat::Binary = self.format {
+            self.log_binary(record);
+            return;
+        }
         let formatted = self.format_record(record);
         for sink in &mut self.sinks {
             match sink {
@@ -190,21 +202,7 @@ impl LoggerCore {
                 }
                 LogSink::File { path, append, file } => {
                     if file.is_none() {
-                        let mut opts = OpenOptions::new();
-                        opts.create(true).write(true);
-                        if *append {
-                            opts.append(true);
-                        } else {
-                            opts.truncate(true);
-                        }
-                        match opts.open(path.as_str()) {
-                            Ok(handle) => {
-                                *file = Some(handle);
-                            }
-                            Err(err) => {
-                                eprintln!("Warning: Couldnae open log file '{}': {}", path, err);
-                            }
-                        }
+                        *file = open_log_file(path, *append);
                     }
                     if let Some(handle) = file {
                         let _ = writeln!(handle, "{}", formatted);
@@ -221,11 +219,55 @@ impl LoggerCore {
         }
     }
 
+    /// Binary records go to file sinks only. A sink opening (or the first record) starts a
+    /// new session on every open file, so each file has the callsites its records use.
+    fn log_binary(&mut self, record: &LogRecord) {
+        let mut fresh = self.binlog.is_none();
+        for sink in &mut self.sinks {
+            if let LogSink::File { path, append, file } = sink {
+                if file.is_none() {
+                    *file = open_log_file(path, *append);
+                    if let Some(handle) = file {
+                        if handle.metadata().map(|m| m.len() == 0).unwrap_or(false) {
+                            let _ = handle.write_all(binlog::MAGIC);
+                        }
+                        fresh = true;
+                    }
+                }
+            }
+        }
+        if fresh {
+            let writer = BinlogWriter::new();
+            let header = writer.session_header();
+            for sink in &mut self.sinks {
+                if let LogSink::File {
+                    file: Some(handle), ..
+                } = sink
+                {
+                    let _ = handle.write_all(&header);
+                }
+            }
+            self.binlog = Some(writer);
+        }
+        let frames = match &mut self.binlog {
+            Some(writer) => writer.encode(record),
+            None => return,
+        };
+        for sink in &mut self.sinks {
+            if let LogSink::File {
+                file: Some(handle), ..
+            } = sink
+            {
+                let _ = handle.write_all(&frames);
+            }
+        }
+    }
+
     fn format_record(&self, record: &LogRecord) -> String {
         match self.format {
             LogFormat::Json => self.format_json(record),
             LogFormat::Compact => self.format_compact(record),
-            LogFormat::Text => self.format_text(record),
+            LogFormat::Text | LogFormat::Binary => self.format_text(record),
         }
     }
 
@@ -323,6 +365,23 @@ impl Default for LoggerCore {
     }
 }
 
+fn open_log_file(path: &str, append: bool) -> Option<std::fs::File> {
+    let mut opts = OpenOptions::new();
+    opts.create(true).write(true);
+    if append {
+        opts.append(true);
+    } else {
+        opts.truncate(true);
+    }
+    match opts.open(path) {
+        Ok(handle) => Some(handle),
+        Err(err) => {
+            eprintln!("Warning: Couldnae open log file '{}': {}", path, err);
+            None
+        }
+    }
+}
+
 fn format_fields(fields: &[(String, Value)]) -> String {
     fields
         .iter()
@@ -337,16 +396,16 @@ fn value_to_json(value: &Value) -> JsonValue {
         Value::Bool(b) => JsonValue::Bool(*b),
         Value::Integer(n) => json!(n),
         Value::Float(f) => json!(f),
-        Value::String(s) => JsonValue::String(s.clone()),
+        Value::String(s) => JsonValue::String(s.to_string()),
         Value::List(list) => JsonValue::Array(list.borrow().iter().map(value_to_json).collect()),
         Value::Dict(dict) => {
             let mut map = Map::new();
             for (k, v) in dict.borrow().iter() {
                 let key = match k {
                     Value::String(s) => s.clone(),
-                    _ => format!("{}", k),
+                    _ => format!("{}", k).into(),
                 };
-                map.insert(key, value_to_json(v));
+                map.insert(key.to_string(), value_to_json(v));
             }
             JsonValue::Object(map)
         }
@@ -387,13 +446,13 @@ impl NativeObject for LogSpanHandle {
 
     fn get(&self, prop: &str) -> HaversResult<Value> {
         match prop {
-            "name" => Ok(Value::String(self.span.name.clone())),
-            "target" => Ok(Value::String(self.span.target.clone())),
-            "level" => Ok(Value::String(self.span.level.name().to_lowercase())),
+            "name" => Ok(Value::String(self.span.name.as_str().into())),
+            "target" => Ok(Value::String(self.span.target.as_str().into())),
+            "level" => Ok(Value::String(self.span.level.name().to_lowercase().into())),
             "fields" => {
                 let mut dict = DictValue::new();
                 for (k, v) in &self.span.fields {
-                    dict.set(Value::String(k.clone()), v.clone());
+                    dict.set(Value::String(k.as_str().into()), v.clone());
                 }
                 Ok(Value::Dict(Rc::new(RefCell::new(dict))))
             }
@@ -416,6 +475,10 @@ impl NativeObject for LogSpanHandle {
 
 thread_local! {
     static LOG_SPAN_STACK: RefCell<Vec<Rc<LogSpan>>> = const { RefCell::new(Vec::new()) };
+    /// Per entered span: when it was entered (if profiling was on) and time spent in its
+    /// children.
+    static SPAN_TIMES: RefCell<Vec<(Option<Instant>, u64)>> = const { RefCell::new(Vec::new()) };
+    static SPAN_PROFILE: RefCell<Option<SpanProfile>> = const { RefCell::new(None) };
 }
 
 static LOG_SPAN_ID: AtomicU64 = AtomicU64::new(1);
@@ -438,21 +501,43 @@ pub fn new_span(
 
 pub fn span_enter(span: Rc<LogSpan>) {
     LOG_SPAN_STACK.with(|stack| stack.borrow_mut().push(span));
+    let entered = profiling().then(Instant::now);
+    SPAN_TIMES.with(|times| times.borrow_mut().push((entered, 0)));
 }
 
 pub fn span_exit(span_id: u64) -> Result<(), String> {
-    LOG_SPAN_STACK.with(|stack| {
+    let top = LOG_SPAN_STACK.with(|stack| {
         let mut stack = stack.borrow_mut();
         if let Some(top) = stack.pop() {
             if top.id != span_id {
                 stack.push(top);
                 return Err("log_span_exit() got a mismatched span".to_string());
             }
-            Ok(())
+            Ok(top)
         } else {
             Err("log_span_exit() called with nae active spans".to_string())
         }
-    })
+    })?;
+    let timing = SPAN_TIMES.with(|times| {
+        let mut times = times.borrow_mut();
+        let (entered, child_ns) = times.pop()?;
+        let entered = entered.filter(|_| profiling())?;
+        let dur_ns = entered.elapsed().as_nanos() as u64;
+        if let Some(parent) = times.last_mut() {
+            parent.1 += dur_ns;
+        }
+        Some((entered, dur_ns, dur_ns.saturating_sub(child_ns)))
+    });
+    if let Some((entered, dur_ns, self_ns)) = timing {
+        let mut path = span_path();
+        path.push(top.name.clone());
+        SPAN_PROFILE.with(|profile| {
+            if let Some(profile) = profile.borrow_mut().as_mut() {
+                profile.record(path, entered, dur_ns, self_ns);
+            }
+        });
+    }
+    Ok(())
 }
 
 pub fn span_current() -> Option<Rc<LogSpan>> {
@@ -463,6 +548,245 @@ pub fn span_path() -> Vec<String> {
     LOG_SPAN_STACK.with(|stack| stack.borrow().iter().map(|s| s.name.clone()).collect())
 }
 
+/// Four histogram buckets per power of two of nanoseconds, as in the native runtime.
+const SPAN_BUCKETS: usize = 256;
+
+fn span_bucket(ns: u64) -> usize {
+    if ns < 4 {
+        return ns as usize;
+    }
+    let b = 63 - ns.leading_zeros() as usize;
+    4 * (b - 1) + ((ns >> (b - 2)) & 3) as usize
+}
+
+/// The largest duration that lands in bucket `i`.
+fn span_bucket_top(i: usize) -> u64 {
+    if i < 4 {
+        return i as u64;
+    }
+    let b = i / 4 + 1;
+    ((5 + (i % 4) as u64) << (b - 2)) - 1
+}
+
+#[derive(Clone)]
+struct SpanStat {
+    count: u64,
+    total_ns: u64,
+    self_ns: u64,
+    min_ns: u64,
+    max_ns: u64,
+    buckets: Vec<u64>,
+}
+
+impl SpanStat {
+    fn new() -> Self {
+        SpanStat {
+            count: 0,
+            total_ns: 0,
+            self_ns: 0,
+            min_ns: u64::MAX,
+            max_ns: 0,
+            buckets: vec![0; SPAN_BUCKETS],
+        }
+    }
+
+    fn merge(&mut self, other: &SpanStat) {
+        self.count += other.count;
+        self.total_ns += other.total_ns;
+        self.self_ns += other.self_ns;
+        self.min_ns = self.min_ns.min(other.min_ns);
+        self.max_ns = self.max_ns.max(other.max_ns);
+        for (a, b) in self.buckets.iter_mut().zip(&other.buckets) {
+            *a += b;
+        }
+    }
+
+    fn quantile_ms(&self, q: f64) -> f64 {
+        let rank = ((q * self.count as f64).ceil() as u64).max(1);
+        let mut seen = 0;
+        for (i, n) in self.buckets.iter().enumerate() {
+            seen += n;
+            if seen >= rank {
+                let top = span_bucket_top(i).min(self.max_ns).max(self.min_ns);
+                return top as f64 / 1e6;
+            }
+        }
+        self.max_ns as f64 / 1e6
+    }
+}
+
+/// Span timings collected while "profile" is on in log_init: exact aggregates per span
+/// path, plus one span in `sample` kept as a trace event, up to `max_events`.
+struct SpanProfile {
+    on: bool,
+    start: Instant,
+    sample: u64,
+    max_events: usize,
+    seen: u64,
+    dropped: u64,
+    paths: Vec<(Vec<String>, SpanStat)>,
+    index: HashMap<Vec<String>, usize>,
+    events: Vec<(usize, Instant, u64)>,
+}
+
+impl SpanProfile {
+    fn record(&mut self, path: Vec<String>, entered: Instant, dur_ns: u64, self_ns: u64) {
+        let id = match self.index.get(&path) {
+            Some(&id) => id,
+            None => {
+                self.paths.push((path.clone(), SpanStat::new()));
+                self.index.insert(path, self.paths.len() - 1);
+                self.paths.len() - 1
+            }
+        };
+        let stat = &mut self.paths[id].1;
+        stat.count += 1;
+        stat.total_ns += dur_ns;
+        stat.self_ns += self_ns;
+        stat.min_ns = stat.min_ns.min(dur_ns);
+        stat.max_ns = stat.max_ns.max(dur_ns);
+        stat.buckets[span_bucket(dur_ns)] += 1;
+        self.seen += 1;
+        if (self.seen - 1) % self.sample == 0 {
+            if self.events.len() < self.max_events {
+                self.events.push((id, entered, dur_ns));
+            } else {
+                self.dropped += 1;
+            }
+        }
+    }
+}
+
+fn profiling() -> bool {
+    SPAN_PROFILE.with(|profile| profile.borrow().as_ref().is_some_and(|p| p.on))
+}
+
+/// Start a fresh profiling session, dropping anything collected before.
+pub fn profile_begin(sample: u64, max_events: usize) {
+    SPAN_PROFILE.with(|profile| {
+        *profile.borrow_mut() = Some(SpanProfile {
+            on: true,
+            start: Instant::now(),
+            sample: sample.max(1),
+            max_events,
+            seen: 0,
+            dropped: 0,
+            paths: Vec::new(),
+            index: HashMap::new(),
+            events: Vec::new(),
+        });
+    });
+}
+
+/// Stop timing spans; what was collected stays readable.
+pub fn profile_stop() {
+    SPAN_PROFILE.with(|profile| {
+        if let Some(profile) = profile.borrow_mut().as_mut() {
+            profile.on = false;
+        }
+    });
+}
+
+/// {name: {"count", "total_ms", "self_ms", "mean_ms", "min_ms", "max_ms", "p50_ms",
+/// "p90_ms", "p99_ms"}}, busiest first.
+pub fn span_stats() -> Value {
+    let mut totals: Vec<(String, SpanStat)> = Vec::new();
+    SPAN_PROFILE.with(|profile| {
+        if let Some(profile) = profile.borrow().as_ref() {
+            for (path, stat) in &profile.paths {
+                let name = path.last().cloned().unwrap_or_default();
+                match totals.iter_mut().find(|(n, _)| *n == name) {
+                    Some((_, total)) => total.merge(stat),
+                    None => totals.push((name, stat.clone())),
+                }
+            }
+        }
+    });
+    totals.sort_by(|a, b| b.1.total_ns.cmp(&a.1.total_ns));
+
+    let mut result = DictValue::new();
+    for (name, t) in totals {
+        let mut entry = DictValue::new();
+        entry.set(
+            Value::String("count".into()),
+            Value::Integer(t.count as i64),
+        );
+        let ms = [
+            ("total_ms", t.total_ns as f64 / 1e6),
+            ("self_ms", t.self_ns as f64 / 1e6),
+            ("mean_ms", t.total_ns as f64 / 1e6 / t.count as f64),
+            ("min_ms", t.min_ns as f64 / 1e6),
+            ("max_ms", t.max_ns as f64 / 1e6),
+            ("p50_ms", t.quantile_ms(0.50)),
+            ("p90_ms", t.quantile_ms(0.90)),
+            ("p99_ms", t.quantile_ms(0.99)),
+        ];
+        for (key, value) in ms {
+            entry.set(Value::String(key.into()), Value::Float(value));
+        }
+        result.set(
+            Value::String(name.into()),
+            Value::Dict(Rc::new(RefCell::new(entry))),
+        );
+    }
+    Value::Dict(Rc::new(RefCell::new(result)))
+}
+
+/// Write the profile as Chrome trace JSON ("chrome") or folded stacks ("folded");
+/// returns the number of events or lines written.
+pub fn span_export(path: &str, format: &str) -> Result<i64, String> {
+    let (out, written) = SPAN_PROFILE.with(|profile| {
+        let profile = profile.borrow();
+        let mut out = String::new();
+        let mut written = 0;
+        match format {
+            "chrome" => {
+                let mut events = Vec::new();
+                if let Some(p) = profile.as_ref() {
+                    for (id, entered, dur_ns) in &p.events {
+                        let path = &p.paths[*id].0;
+                        let ts = entered.saturating_duration_since(p.start).as_nanos() as f64;
+                        events.push(json!({
+                            "name": path.last().cloned().unwrap_or_default(),
+                            "cat": "span",
+                            "ph": "X",
+                            "ts": ts / 1e3,
+                            "dur": *dur_ns as f64 / 1e3,
+                            "pid": 1,
+                            "tid": 1,
+                            "args": {"path": path.join(">")},
+                        }));
+                    }
+                }
+                written = events.len() as i64;
+                let dropped = profile.as_ref().map_or(0, |p| p.dropped);
+                let trace = json!({
+                    "traceEvents": events,
+                    "displayTimeUnit": "ms",
+                    "otherData": {"dropped": dropped},
+                });
+                out = format!("{}\n", trace);
+            }
+            "folded" => {
+                if let Some(p) = profile.as_ref() {
+                    for (path, stat) in p.paths.iter().filter(|(_, s)| s.self_ns > 0) {
+                        let stack = path.join(";").replace(' ', "_");
+                        out.push_str(&format!("{} {}\n", stack, stat.self_ns));
+                        written += 1;
+                    }
+                }
+            }
+            _ => {
+                return Err("log_span_export() format must be \"chrome\" or \"folded\"".to_string())
+            }
+        }
+        Ok((out, written))
+    })?;
+    std::fs::write(path, out)
+        .map_err(|e| format!("log_span_export() cannae write {}: {}", path, e))?;
+    Ok(written)
+}
+
 pub fn fields_from_dict(value: &Value) -> Result<Vec<(String, Value)>, String> {
     let dict = match value {
         Value::Dict(d) => d.clone(),
@@ -471,7 +795,7 @@ pub fn fields_from_dict(value: &Value) -> Result<Vec<(String, Value)>, String> {
     let mut fields = Vec::new();
     for (k, v) in dict.borrow().iter() {
         let key = match k {
-            Value::String(s) => s.clone(),
+            Value::String(s) => s.to_string(),
             _ => return Err("Log field keys must be strings".to_string()),
         };
         fields.push((key, v.clone()));
@@ -482,47 +806,46 @@ pub fn fields_from_dict(value: &Value) -> Result<Vec<(String, Value)>, String> {
 pub fn record_to_value(record: &LogRecord, timestamp: Option<String>) -> Value {
     let mut dict = DictValue::new();
     dict.set(
-        Value::String("level".to_string()),
-        Value::String(record.level.name().to_lowercase()),
+        Value::String("level".into()),
+        Value::String(record.level.name().to_lowercase().into()),
     );
     dict.set(
-        Value::String("message".to_string()),
-        Value::String(record.message.clone()),
+        Value::String("message".into()),
+        Value::String(record.message.as_str().into()),
     );
     dict.set(
-        Value::String("target".to_string()),
-        Value::String(record.target.clone()),
+        Value::String("target".into()),
+        Value::String(record.target.as_str().into()),
     );
     dict.set(
-        Value::String("file".to_string()),
-        Value::String(record.file.clone()),
+        Value::String("file".into()),
+        Value::String(record.file.as_str().into()),
     );
     dict.set(
-        Value::String("line".to_string()),
+        Value::String("line".into()),
         Value::Integer(record.line as i64),
     );
 
     if let Some(ts) = timestamp {
-        dict.set(Value::String("timestamp".to_string()), Value::String(ts));
+        dict.set(Value::String("timestamp".into()), Value::String(ts.into()));
     }
 
     let mut fields_dict = DictValue::new();
     for (k, v) in &record.fields {
-        fields_dict.set(Value::String(k.clone()), v.clone());
+        fields_dict.set(Value::String(k.as_str().into()), v.clone());
     }
     dict.set(
-        Value::String("fields".to_string()),
+        Value::String("fields".into()),
         Value::Dict(Rc::new(RefCell::new(fields_dict))),
     );
 
     let span_list = record
         .span_path
         .iter()
-        .cloned()
-        .map(Value::String)
+        .map(|name| Value::String(name.as_str().into()))
         .collect::<Vec<_>>();
     dict.set(
-        Value::String("span".to_string()),
+        Value::String("span".into()),
         Value::List(Rc::new(RefCell::new(span_list))),
     );
 
@@ -620,6 +943,7 @@ mod tests {
                 entries: Vec::new(),
                 max: 2,
             }],
+            binlog: None,
         };
         logger.log(&record);
         logger.log(&record);
@@ -639,6 +963,7 @@ mod tests {
                 append: false,
                 file: None,
             }],
+            binlog: None,
         };
         file_logger.log(&record);
         file_logger.log(&record);
@@ -654,6 +979,7 @@ mod tests {
                 append: false,
                 file: None,
             }],
+            binlog: None,
         };
         bad_file_logger.log(&record);
         assert!(matches!(
@@ -683,6 +1009,7 @@ mod tests {
                 append: true,
                 file: None,
             }],
+            binlog: None,
         };
         file_logger.log(&record);
         assert!(file_path.exists());
@@ -692,13 +1019,10 @@ mod tests {
     fn test_format_json_and_value_to_json_branches() {
         let list = Value::List(Rc::new(RefCell::new(vec![Value::Integer(1)])));
         let mut dict = DictValue::new();
-        dict.set(
-            Value::String("k".to_string()),
-            Value::String("v".to_string()),
-        );
+        dict.set(Value::String("k".into()), Value::String("v".into()));
         let dict = Value::Dict(Rc::new(RefCell::new(dict)));
         let mut set = SetValue::new();
-        set.insert(Value::String("a".to_string()));
+        set.insert(Value::String("a".into()));
         let set = Value::Set(Rc::new(RefCell::new(set)));
         let bytes = Value::Bytes(Rc::new(RefCell::new(vec![1, 2, 3])));
         let range = Value::Range(RangeValue::new(1, 3, false));
@@ -708,7 +1032,7 @@ mod tests {
             ("bool".to_string(), Value::Bool(true)),
             ("int".to_string(), Value::Integer(7)),
             ("float".to_string(), Value::Float(1.5)),
-            ("string".to_string(), Value::String("hi".to_string())),
+            ("string".to_string(), Value::String("hi".into())),
             ("list".to_string(), list),
             ("dict".to_string(), dict),
             ("set".to_string(), set),
@@ -721,6 +1045,7 @@ mod tests {
             color: false,
             timestamps: true,
             sinks: vec![LogSink::Stderr],
+            binlog: None,
         };
         let json = logger.format_record(&record);
         let parsed: JsonValue = serde_json::from_str(&json).unwrap();
@@ -731,7 +1056,7 @@ mod tests {
     #[test]
     fn test_value_to_json_non_string_key() {
         let mut dict = DictValue::new();
-        dict.set(Value::Integer(5), Value::String("v".to_string()));
+        dict.set(Value::Integer(5), Value::String("v".into()));
         let value = Value::Dict(Rc::new(RefCell::new(dict)));
         let json = value_to_json(&value);
         let obj = json.as_object().unwrap();
@@ -763,7 +1088,7 @@ mod tests {
         assert!(span_exit(span2.id).is_ok());
 
         let mut dict = DictValue::new();
-        dict.set(Value::String("k".to_string()), Value::Integer(2));
+        dict.set(Value::String("k".into()), Value::Integer(2));
         let fields = fields_from_dict(&Value::Dict(Rc::new(RefCell::new(dict)))).unwrap();
         assert_eq!(fields.len(), 1);
 
@@ -776,7 +1101,7 @@ mod tests {
         assert!(matches!(
             val,
             Value::Dict(ref map)
-                if map.borrow().contains_key(&Value::String("timestamp".to_string()))
+                if map.borrow().contains_key(&Value::String("timestamp".into()))
         ));
     }
 
@@ -794,23 +1119,17 @@ mod tests {
             vec![("k".to_string(), Value::Integer(1))],
         );
         let handle = LogSpanHandle::new(span);
-        assert_eq!(
-            handle.get("name").unwrap(),
-            Value::String("test".to_string())
-        );
+        assert_eq!(handle.get("name").unwrap(), Value::String("test".into()));
         assert_eq!(
             handle.get("target").unwrap(),
-            Value::String("target".to_string())
-        );
-        assert_eq!(
-            handle.get("level").unwrap(),
-            Value::String("holler".to_string())
+            Value::String("target".into())
         );
+        assert_eq!(handle.get("level").unwrap(), Value::String("holler".into()));
         let fields = handle.get("fields").unwrap();
         assert!(matches!(
             fields,
             Value::Dict(ref dict)
-                if dict.borrow().get(&Value::String("k".to_string())) == Some(&Value::Integer(1))
+                if dict.borrow().get(&Value::String("k".into())) == Some(&Value::Integer(1))
         ));
     }
 
@@ -836,4 +1155,65 @@ mod tests {
         assert!(ts.contains('-'));
         assert!(ts.contains(':'));
     }
+
+    #[test]
+    fn test_span_profile_stats_and_exports() {
+        let outer = new_span(
+            "outer".to_string(),
+            LogLevel::Blether,
+            "".to_string(),
+            Vec::new(),
+        );
+        let inner = new_span(
+            "inner".to_string(),
+            LogLevel::Blether,
+            "".to_string(),
+            Vec::new(),
+        );
+        span_enter(outer.clone());
+        span_exit(outer.id).unwrap();
+
+        profile_begin(2, 1);
+        for _ in 0..3 {
+            span_enter(outer.clone());
+            span_enter(inner.clone());
+            span_exit(inner.id).unwrap();
+            span_exit(outer.id).unwrap();
+        }
+        profile_stop();
+        span_enter(inner.clone());
+        span_exit(inner.id).unwrap();
+
+        let stats = match span_stats() {
+            Value::Dict(d) => d,
+            other => panic!("expected dict, got {:?}", other),
+        };
+        let stats = stats.borrow();
+        for name in ["outer", "inner"] {
+            let entry = match stats.get(&Value::String(name.into())) {
+                Some(Value::Dict(e)) => e.clone(),
+                other => panic!("no stats for {}: {:?}", name, other),
+            };
+            let count = entry.borrow().get(&Value::String("count".into())).cloned();
+            assert!(matches!(count, Some(Value::Integer(3))), "{:?}", count);
+        }
+
+        let dir = tempfile::tempdir().unwrap();
+        let folded = dir.path().join("spans.folded");
+        let folded = folded.to_str().unwrap();
+        let lines = span_export(folded, "folded").unwrap();
+        let text = std::fs::read_to_string(folded).unwrap();
+        assert_eq!(lines as usize, text.lines().count());
+        assert!(text.lines().all(|l| l.starts_with("outer")));
+
+        let trace = dir.path().join("spans.json");
+        let trace = trace.to_str().unwrap();
+        // Six exits sampled one in two, capped at one event.
+        assert_eq!(span_export(trace, "chrome").unwrap(), 1);
+        let json: JsonValue =
+            serde_json::from_str(&std::fs::read_to_string(trace).unwrap()).unwrap();
+        assert_eq!(json["otherData"]["dropped"], 2);
+        assert_eq!(json["traceEvents"][0]["name"], "inner");
+        assert!(span_export(trace, "svg").is_err());
+    }
 }
@@ -0,0 +1,265 @@
+//! Open documents for the LSP
+//!
+//! A document keeps its text alongside the byte offset of each line start, so an
+//! incremental edit is spliced in at its range and only the line index after it shifts.
+//!
+//! For diagnostics and symbols the text is cut into top-level chunks, each starting at a
+//! `dae`, `kin`, `thing`, `fetch` or `ken` in column one outside any brackets or strings.
+//! Each chunk is lexed and parsed on its own and the result cached by the chunk's text, so
+//! after an edit only the chunks that changed are lexed and parsed again.
+
+use std::cell::RefCell;
+use std::collections::HashMap;
+use std::rc::Rc;
+
+use lsp_types::{Position, Range};
+
+use crate::mdhavers_bindings::{analyse, Symbol};
+
+/// What a document's chunks add up to: diagnostics as (line, column, message, severity)
+/// and its symbols, with lines counted from the top of the document
+#[derive(Debug, Default)]
+pub struct Analysis {
+    pub diagnostics: Vec<(usize, usize, String, String)>,
+    pub symbols: Vec<Symbol>,
+}
+
+type ChunkResult = (Vec<(usize, usize, String, String)>, Vec<Symbol>);
+
+pub struct Document {
+    text: String,
+    line_starts: Vec<usize>,
+    analysis: RefCell<Option<Rc<Analysis>>>,
+    chunks: RefCell<HashMap<String, ChunkResult>>,
+}
+
+const CHUNK_KEYWORDS: [&str; 5] = ["dae", "kin", "thing", "fetch", "ken"];
+
+impl Document {
+    pub fn new(text: String) -> Self {
+        let mut doc = Document {
+            text: String::new(),
+            line_starts: Vec::new(),
+            analysis: RefCell::new(None),
+            chunks: RefCell::new(HashMap::new()),
+        };
+        doc.replace(text);
+        doc
+    }
+
+    pub fn text(&self) -> &str {
+        &self.text
+    }
+
+    fn replace(&mut self, text: String) {
+        self.line_starts = std::iter::once(0)
+            .chain(text.match_indices('\n').map(|(i, _)| i + 1))
+            .collect();
+        self.text = text;
+        self.analysis.replace(None);
+    }
+
+    /// Apply one content change: the whole text when range is None, else the range
+    /// (in UTF-16 positions) replaced by text
+    pub fn apply_change(&mut self, range: Option<Range>, text: &str) {
+        let Some(range) = range else {
+            self.replace(text.to_string());
+            return;
+        };
+        let start = self.offset_at(range.start);
+        let end = self.offset_at(range.end).max(start);
+        self.text.replace_range(start..end, text);
+
+        // Line starts inside the replaced span go, the new text's come in, and the rest
+        // shift by the change in length
+        let lo = self.line_starts.partition_point(|&s| s <= start);
+        let hi = self.line_starts.partition_point(|&s| s <= end);
+        let tail: Vec<usize> = self.line_starts[hi..]
+            .iter()
+            .map(|&s| s - end + start + text.len())
+            .collect();
+        self.line_starts.truncate(lo);
+        self.line_starts
+            .extend(text.match_indices('\n').map(|(i, _)| start + i + 1));
+        self.line_starts.extend(tail);
+        self.analysis.replace(None);
+    }
+
+    /// The byte offset of an LSP position, clamped to the end of its line
+    pub fn offset_at(&self, position: Position) -> usize {
+        let line = position.line as usize;
+        let Some(&start) = self.line_starts.get(line) else {
+            return self.text.len();
+        };
+        let end = self
+            .line_starts
+            .get(line + 1)
+            .map_or(self.text.len(), |&next| next - 1);
+        let mut units = 0;
+        for (i, ch) in self.text[start..end].char_indices() {
+            if units >= position.character as usize {
+                return start + i;
+            }
+            units += ch.len_utf16();
+        }
+        end
+    }
+
+    /// The text of one line, without its newline
+    pub fn line(&self, line: usize) -> Option<&str> {
+        let start = *self.line_starts.get(line)?;
+        let end = self
+            .line_starts
+            .get(line + 1)
+            .map_or(self.text.len(), |&next| next - 1);
+        Some(self.text[start..end].trim_end_matches('\r'))
+    }
+
+    /// Diagnostics and symbols for the current text, worked out again only after an edit
+    pub fn analysis(&self) -> Rc<Analysis> {
+        if let Some(analysis) = self.analysis.borrow().as_ref() {
+            return analysis.clone();
+        }
+        let mut cache = self.chunks.borrow_mut();
+        let mut next = HashMap::with_capacity(cache.len());
+        let mut analysis = Analysis::default();
+        for (first_line, span) in self.chunk_spans() {
+            let source = &self.text[span];
+            let (key, result) = cache
+                .remove_entry(source)
+                .unwrap_or_else(|| (source.to_string(), analyse(source)));
+            let (diagnostics, symbols) = &result;
+            analysis.diagnostics.extend(
+                diagnostics.iter().map(|(line, col, msg, sev)| {
+                    (line + first_line, *col, msg.clone(), sev.clone())
+                }),
+            );
+            analysis.symbols.extend(symbols.iter().map(|symbol| Symbol {
+                line: symbol.line + first_line,
+                ..symbol.clone()
+            }));
+            next.insert(key, result);
+        }
+        *cache = next;
+        let analysis = Rc::new(analysis);
+        self.analysis.replace(Some(analysis.clone()));
+        analysis
+    }
+
+    /// Each chunk's first line (0-based) and byte span
+    fn chunk_spans(&self) -> Vec<(usize, std::ops::Range<usize>)> {
+        let mut spans = Vec::new();
+        let mut chunk_start = (0, 0);
+        let mut depth = 0usize;
+        let mut quote: Option<char> = None;
+        for (line_no, &start) in self.line_starts.iter().enumerate() {
+            let end = self
+                .line_starts
+                .get(line_no + 1)
+                .copied()
+                .unwrap_or(self.text.len());
+            let line = &self.text[start..end];
+            if line_no > 0 && depth == 0 && quote.is_none() && starts_chunk(line) {
+                spans.push((chunk_start.0, chunk_start.1..start));
+                chunk_start = (line_no, start);
+            }
+            let mut chars = line.chars().peekable();
+            while let Some(ch) = chars.next() {
+                match quote {
+                    Some(q) => {
+                        if ch == '\\' {
+                            chars.next();
+                        } else if ch == q {
+                            quote = None;
+                        }
+                    }
+                    None => match ch {
+                        '#' => break,
+                        '/' if chars.peek() == Some(&'/') => break,
+                        '"' | '\'' => quote = Some(ch),
+                        '(' | '[' | '{' => depth += 1,
+                        ')' | ']' | '}' => depth = depth.saturating_sub(1),
+                        _ => {}
+                    },
+                }
+            }
+        }
+        spans.push((chunk_start.0, chunk_start.1..self.text.len()));
+        spans
+    }
+}
+
+fn starts_chunk(line: &str) -> bool {
+    CHUNK_KEYWORDS.iter().any(|keyword| {
+        line.strip_prefix(keyword)
+            .is_some_and(|rest| rest.starts_with([' ', '\t']))
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn range(l1: u32, c1: u32, l2: u32, c2: u32) -> Option<Range> {
+        Some(Range {
+            start: Position {
+                line: l1,
+                character: c1,
+            },
+            end: Position {
+                line: l2,
+                character: c2,
+            },
+        })
+    }
+
+    #[test]
+    fn incremental_edits_match_a_fresh_document() {
+        let mut doc = Document::new("ken a = 1\nken b = 2\nblether a\n".to_string());
+        doc.apply_change(range(1, 4, 1, 5), "bee");
+        doc.apply_change(range(0, 9, 1, 0), "\n# note\n");
+        doc.apply_change(range(3, 0, 3, 0), "ken ü = \"é\"\n");
+        doc.apply_change(range(3, 10, 3, 10), "x");
+        let fresh = Document::new(doc.text().to_string());
+        assert_eq!(
+            doc.text(),
+            "ken a = 1\n# note\nken bee = 2\nken ü = \"éx\"\nblether a\n"
+        );
+        assert_eq!(doc.line_starts, fresh.line_starts);
+        assert_eq!(doc.line(3), Some("ken ü = \"éx\""));
+
+        doc.apply_change(None, "ken z = 0");
+        assert_eq!(doc.line_starts, vec![0]);
+    }
+
+    #[test]
+    fn chunks_split_at_top_level_declarations_only() {
+        let doc = Document::new(
+            "ken s = \"a\nken b\"\ndae f() {\nken x = 1\n}\n# ken\nblether s\nkin K {\n}\n"
+                .to_string(),
+        );
+        let starts: Vec<usize> = doc.chunk_spans().iter().map(|(line, _)| *line).collect();
+        assert_eq!(starts, vec![0, 2, 7]);
+    }
+
+    #[test]
+    fn analysis_offsets_chunks_and_reuses_unchanged_ones() {
+        let mut doc =
+            Document::new("dae f() {\n    gie 1\n}\nken y = (\ndae g() {\n}\n".to_string());
+        let first = doc.analysis();
+        assert_eq!(first.diagnostics.len(), 1);
+        assert_eq!(first.symbols[0].name, "f");
+
+        doc.apply_change(range(3, 9, 3, 9), "2)");
+        let second = doc.analysis();
+        assert!(second.diagnostics.is_empty());
+        let names: Vec<(&str, usize)> = second
+            .symbols
+            .iter()
+            .map(|s| (s.name.as_str(), s.line))
+            .collect();
+        assert_eq!(names, vec![("f", 1), ("y", 4), ("g", 5)]);
+        assert_eq!(doc.chunks.borrow().len(), 3);
+        assert!(Rc::ptr_eq(&second, &doc.analysis()));
+    }
+}
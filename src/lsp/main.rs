@@ -5,53 +5,104 @@
 //! - Hover documentation
 //! - Completions fer keywords an' builtins
 //! - Go tae definition
+//!
+//! Documents sync incrementally, and diagnostics go out once the edits have paused for
+//! [`DIAGNOSTICS_DEBOUNCE`], so a burst of keystrokes is only checked once. Definitions in
+//! other files come from a workspace index built on a background thread.
 
 use std::collections::HashMap;
 use std::error::Error;
+use std::path::PathBuf;
+use std::sync::OnceLock;
+use std::time::Duration;
 
 use lsp_server::{Connection, ExtractError, Message, Notification, Request, RequestId, Response};
 use lsp_types::{
-    notification::{DidChangeTextDocument, DidCloseTextDocument, DidOpenTextDocument},
+    notification::{
+        DidChangeTextDocument, DidChangeWatchedFiles, DidCloseTextDocument, DidOpenTextDocument,
+        DidSaveTextDocument,
+    },
     request::{Completion, GotoDefinition, HoverRequest},
     CompletionItem, CompletionItemKind, CompletionOptions, CompletionParams, CompletionResponse,
     Diagnostic, DiagnosticSeverity, DidChangeTextDocumentParams, DidCloseTextDocumentParams,
     DidOpenTextDocumentParams, GotoDefinitionParams, GotoDefinitionResponse, Hover, HoverContents,
-    HoverParams, HoverProviderCapability, InitializeParams, MarkupContent, MarkupKind, Position,
-    Range, ServerCapabilities, TextDocumentSyncCapability, TextDocumentSyncKind, Uri,
+    HoverParams, HoverProviderCapability, InitializeParams, Location, MarkupContent, MarkupKind,
+    Position, Range, ServerCapabilities, TextDocumentSyncCapability, TextDocumentSyncKind,
+    TextDocumentSyncOptions, TextDocumentSyncSaveOptions, Uri,
 };
 use serde_json::Value;
 
 // Import the mdhavers parser and lexer
 // We need to make these modules public in lib.rs
+mod document;
 mod mdhavers_bindings;
-use mdhavers_bindings::{get_diagnostics, get_keyword_info, get_keywords_and_builtins};
+mod workspace;
+use document::Document;
+use mdhavers_bindings::{get_keyword_info, get_keywords_and_builtins, Symbol};
+use workspace::WorkspaceIndexer;
+
+/// How long the edits to a document must pause before its diagnostics are published
+const DIAGNOSTICS_DEBOUNCE: Duration = Duration::from_millis(150);
 
 /// A wee document store tae keep track o' open files
 struct DocumentStore {
-    documents: HashMap<Uri, String>,
+    documents: HashMap<Uri, Document>,
+    /// Edited documents whose diagnostics haven't been published yet
+    pending: Vec<Uri>,
+    /// Symbols across the workspace and stdlib, when the client gave us a root
+    workspace: Option<WorkspaceIndexer>,
 }
 
 impl DocumentStore {
     fn new() -> Self {
         DocumentStore {
             documents: HashMap::new(),
+            pending: Vec::new(),
+            workspace: None,
         }
     }
 
     fn open(&mut self, uri: Uri, text: String) {
-        self.documents.insert(uri, text);
+        self.documents.insert(uri, Document::new(text));
     }
 
-    fn update(&mut self, uri: &Uri, text: String) {
-        self.documents.insert(uri.clone(), text);
+    fn update(&mut self, uri: &Uri, range: Option<Range>, text: &str) {
+        match self.documents.get_mut(uri) {
+            Some(doc) => doc.apply_change(range, text),
+            None if range.is_none() => self.open(uri.clone(), text.to_string()),
+            None => return,
+        }
+        if !self.pending.contains(uri) {
+            self.pending.push(uri.clone());
+        }
     }
 
     fn close(&mut self, uri: &Uri) {
         self.documents.remove(uri);
+        self.pending.retain(|pending| pending != uri);
     }
 
-    fn get(&self, uri: &Uri) -> Option<&String> {
-        self.documents.get(uri)
+    fn get(&self, uri: &Uri) -> Option<&str> {
+        self.documents.get(uri).map(Document::text)
+    }
+
+    /// Where name is defined: in the document itself if it is, else across the workspace
+    fn definitions(&self, uri: &Uri, name: &str) -> Vec<(Uri, Symbol)> {
+        if let Some(doc) = self.documents.get(uri) {
+            let analysis = doc.analysis();
+            if let Some(symbol) = analysis.symbols.iter().find(|symbol| symbol.name == name) {
+                return vec![(uri.clone(), symbol.clone())];
+            }
+        }
+        let Some(workspace) = &self.workspace else {
+            return Vec::new();
+        };
+        workspace
+            .index
+            .lookup(name)
+            .into_iter()
+            .filter_map(|(path, symbol)| Some((workspace::path_to_uri(&path)?, symbol)))
+            .collect()
     }
 }
 
@@ -66,7 +117,14 @@ fn main() -> Result<(), Box<dyn Error + Sync + Send>> {
 
     // Run the server
     let server_capabilities = serde_json::to_value(ServerCapabilities {
-        text_document_sync: Some(TextDocumentSyncCapability::Kind(TextDocumentSyncKind::FULL)),
+        text_document_sync: Some(TextDocumentSyncCapability::Options(
+            TextDocumentSyncOptions {
+                open_close: Some(true),
+                change: Some(TextDocumentSyncKind::INCREMENTAL),
+                save: Some(TextDocumentSyncSaveOptions::Supported(true)),
+                ..Default::default()
+            },
+        )),
         hover_provider: Some(HoverProviderCapability::Simple(true)),
         completion_provider: Some(CompletionOptions {
             trigger_characters: Some(vec![".".to_string()]),
@@ -92,13 +150,34 @@ fn main() -> Result<(), Box<dyn Error + Sync + Send>> {
 }
 
 fn main_loop(connection: Connection, params: Value) -> Result<(), Box<dyn Error + Sync + Send>> {
-    let _params: InitializeParams = serde_json::from_value(params).unwrap();
+    let params: InitializeParams = serde_json::from_value(params).unwrap();
 
     let mut documents = DocumentStore::new();
+    if let Some(root) = workspace_root(&params) {
+        let mut roots = vec![root.clone()];
+        roots.extend(workspace::find_stdlib(&root));
+        let (indexer, _handle) = WorkspaceIndexer::spawn(roots, workspace::cache_path(&root));
+        documents.workspace = Some(indexer);
+    }
 
     eprintln!("🏴󠁧󠁢󠁳󠁣󠁴󠁿 Ready tae help ye write guid mdhavers code!");
 
-    for msg in &connection.receiver {
+    loop {
+        let msg = if documents.pending.is_empty() {
+            match connection.receiver.recv() {
+                Ok(msg) => msg,
+                Err(_) => break,
+            }
+        } else {
+            match connection.receiver.recv_timeout(DIAGNOSTICS_DEBOUNCE) {
+                Ok(msg) => msg,
+                Err(e) if e.is_timeout() => {
+                    publish_pending(&connection, &mut documents)?;
+                    continue;
+                }
+                Err(_) => break,
+            }
+        };
         match msg {
             Message::Request(req) => {
                 if connection.handle_shutdown(&req)? {
@@ -153,8 +232,8 @@ fn handle_notification(
     // Handle document opened
     if let Ok(params) = cast_notification::<DidOpenTextDocument>(not.clone()) {
         let DidOpenTextDocumentParams { text_document } = params;
-        documents.open(text_document.uri.clone(), text_document.text.clone());
-        publish_diagnostics(connection, &text_document.uri, &text_document.text)?;
+        documents.open(text_document.uri.clone(), text_document.text);
+        publish_diagnostics(connection, documents, &text_document.uri)?;
         return Ok(());
     }
 
@@ -164,9 +243,9 @@ fn handle_notification(
             text_document,
             content_changes,
         } = params;
-        if let Some(change) = content_changes.into_iter().last() {
-            documents.update(&text_document.uri, change.text.clone());
-            publish_diagnostics(connection, &text_document.uri, &change.text)?;
+        // Diagnostics wait for the main loop to see the edits pause
+        for change in content_changes {
+            documents.update(&text_document.uri, change.range, &change.text);
         }
         return Ok(());
     }
@@ -178,19 +257,59 @@ fn handle_notification(
         return Ok(());
     }
 
+    // Saved or changed files on disk get re-indexed in the background
+    if let Ok(params) = cast_notification::<DidSaveTextDocument>(not.clone()) {
+        reindex(documents, &params.text_document.uri);
+        return Ok(());
+    }
+    if let Ok(params) = cast_notification::<DidChangeWatchedFiles>(not.clone()) {
+        for change in &params.changes {
+            reindex(documents, &change.uri);
+        }
+        return Ok(());
+    }
+
     Ok(())
 }
 
-fn handle_hover(_documents: &DocumentStore, params: HoverParams) -> Option<Hover> {
+fn reindex(documents: &DocumentStore, uri: &Uri) {
+    if let (Some(workspace), Some(path)) = (&documents.workspace, workspace::uri_to_path(uri)) {
+        workspace.file_changed(path);
+    }
+}
+
+/// The first workspace folder, or the older root URI if the client only sent that
+fn workspace_root(params: &InitializeParams) -> Option<PathBuf> {
+    if let Some(folder) = params.workspace_folders.as_ref().and_then(|f| f.first()) {
+        return workspace::uri_to_path(&folder.uri);
+    }
+    #[allow(deprecated)]
+    let root = params.root_uri.as_ref()?;
+    workspace::uri_to_path(root)
+}
+
+fn handle_hover(documents: &DocumentStore, params: HoverParams) -> Option<Hover> {
     // Get the word at the cursor position
-    // For now, we'll return documentation for keywords
     let position = params.text_document_position_params.position;
+    let keyword = get_word_at_position(&params, documents)?;
+
+    // Keywords and builtins first, then definitions in the document or workspace
+    let info = get_keyword_info(&keyword).or_else(|| {
+        let uri = &params.text_document_position_params.text_document.uri;
+        let (found_in, symbol) = documents.definitions(uri, &keyword).into_iter().next()?;
+        let place = if &found_in == uri {
+            format!("line {}", symbol.line)
+        } else {
+            let file = found_in.as_str().rsplit('/').next().unwrap_or_default();
+            format!("line {} o' `{file}`", symbol.line)
+        };
+        Some(format!(
+            "```mdhavers\n{}\n```\n\nDefined on {place}",
+            symbol.detail
+        ))
+    });
 
-    // This is a simplified version - ideally we'd parse the document
-    // and find the exact token at the position
-    let keyword = get_word_at_position(&params, _documents)?;
-
-    if let Some(info) = get_keyword_info(&keyword) {
+    if let Some(info) = info {
         return Some(Hover {
             contents: HoverContents::Markup(MarkupContent {
                 kind: MarkupKind::Markdown,
@@ -209,44 +328,130 @@ fn handle_hover(_documents: &DocumentStore, params: HoverParams) -> Option<Hover
     None
 }
 
+/// Completion items for the keywords and builtins, built once
+fn builtin_completions() -> &'static [CompletionItem] {
+    static ITEMS: OnceLock<Vec<CompletionItem>> = OnceLock::new();
+    ITEMS.get_or_init(|| {
+        get_keywords_and_builtins()
+            .into_iter()
+            .map(|(name, kind, doc)| CompletionItem {
+                label: name.clone(),
+                kind: Some(completion_item_kind(kind.as_str())),
+                detail: Some(doc.clone()),
+                documentation: Some(lsp_types::Documentation::MarkupContent(MarkupContent {
+                    kind: MarkupKind::Markdown,
+                    value: doc,
+                })),
+                ..Default::default()
+            })
+            .collect()
+    })
+}
+
 fn handle_completion(
-    _documents: &DocumentStore,
-    _params: CompletionParams,
+    documents: &DocumentStore,
+    params: CompletionParams,
 ) -> Option<CompletionResponse> {
-    let items = get_keywords_and_builtins();
+    let mut completion_items = builtin_completions().to_vec();
+
+    // The document's own definitions, from its cached analysis
+    if let Some(doc) = documents
+        .documents
+        .get(&params.text_document_position.text_document.uri)
+    {
+        for symbol in &doc.analysis().symbols {
+            if completion_items
+                .iter()
+                .any(|item| item.label == symbol.name)
+            {
+                continue;
+            }
+            completion_items.push(CompletionItem {
+                label: symbol.name.clone(),
+                kind: Some(completion_item_kind(symbol.kind)),
+                detail: Some(symbol.detail.clone()),
+                ..Default::default()
+            });
+        }
+    }
 
-    let completion_items: Vec<CompletionItem> = items
-        .into_iter()
-        .map(|(name, kind, doc)| CompletionItem {
-            label: name.clone(),
-            kind: Some(completion_item_kind(kind.as_str())),
-            detail: Some(doc.clone()),
-            documentation: Some(lsp_types::Documentation::MarkupContent(MarkupContent {
-                kind: MarkupKind::Markdown,
-                value: doc,
-            })),
-            ..Default::default()
-        })
-        .collect();
+    // Then what the other files in the workspace define
+    if let Some(workspace) = &documents.workspace {
+        for symbol in workspace.index.top_level_symbols() {
+            if completion_items
+                .iter()
+                .any(|item| item.label == symbol.name)
+            {
+                continue;
+            }
+            completion_items.push(CompletionItem {
+                label: symbol.name,
+                kind: Some(completion_item_kind(symbol.kind)),
+                detail: Some(symbol.detail),
+                ..Default::default()
+            });
+        }
+    }
 
     Some(CompletionResponse::Array(completion_items))
 }
 
 fn handle_goto_definition(
-    _documents: &DocumentStore,
-    _params: GotoDefinitionParams,
+    documents: &DocumentStore,
+    params: GotoDefinitionParams,
 ) -> Option<GotoDefinitionResponse> {
-    // For now, we don't support go-to-definition
-    // This would require tracking function definitions
-    None
+    let hover = HoverParams {
+        text_document_position_params: params.text_document_position_params,
+        work_done_progress_params: params.work_done_progress_params,
+    };
+    let name = get_word_at_position(&hover, documents)?;
+    let uri = hover.text_document_position_params.text_document.uri;
+    let mut locations: Vec<Location> = documents
+        .definitions(&uri, &name)
+        .into_iter()
+        .map(|(uri, symbol)| {
+            let start = Position {
+                line: symbol.line.saturating_sub(1) as u32,
+                character: symbol.column.saturating_sub(1) as u32,
+            };
+            let end = Position {
+                line: start.line,
+                character: start.character + symbol.name.chars().count() as u32,
+            };
+            Location {
+                uri,
+                range: Range { start, end },
+            }
+        })
+        .collect();
+    match locations.len() {
+        0 => None,
+        1 => locations.pop().map(GotoDefinitionResponse::Scalar),
+        _ => Some(GotoDefinitionResponse::Array(locations)),
+    }
+}
+
+/// Publish diagnostics for every document edited since they were last sent
+fn publish_pending(
+    connection: &Connection,
+    documents: &mut DocumentStore,
+) -> Result<(), Box<dyn Error + Sync + Send>> {
+    for uri in std::mem::take(&mut documents.pending) {
+        publish_diagnostics(connection, documents, &uri)?;
+    }
+    Ok(())
 }
 
 fn publish_diagnostics(
     connection: &Connection,
+    documents: &DocumentStore,
     uri: &Uri,
-    text: &str,
 ) -> Result<(), Box<dyn Error + Sync + Send>> {
-    let diagnostics = get_diagnostics(text);
+    let Some(doc) = documents.documents.get(uri) else {
+        return Ok(());
+    };
+    let analysis = doc.analysis();
+    let diagnostics = analysis.diagnostics.clone();
 
     let lsp_diagnostics: Vec<Diagnostic> = diagnostics
         .into_iter()
@@ -287,14 +492,7 @@ fn get_word_at_position(params: &HoverParams, documents: &DocumentStore) -> Opti
     let uri = &params.text_document_position_params.text_document.uri;
     let position = params.text_document_position_params.position;
 
-    let text = documents.get(uri)?;
-    let lines: Vec<&str> = text.lines().collect();
-
-    if position.line as usize >= lines.len() {
-        return None;
-    }
-
-    let line = lines[position.line as usize];
+    let line = documents.documents.get(uri)?.line(position.line as usize)?;
     let col = position.character as usize;
 
     if col >= line.len() {
@@ -344,6 +542,11 @@ fn completion_item_kind(kind: &str) -> CompletionItemKind {
         "keyword" => CompletionItemKind::KEYWORD,
         "function" => CompletionItemKind::FUNCTION,
         "constant" => CompletionItemKind::CONSTANT,
+        "method" => CompletionItemKind::METHOD,
+        "class" => CompletionItemKind::CLASS,
+        "struct" => CompletionItemKind::STRUCT,
+        "variable" => CompletionItemKind::VARIABLE,
+        "module" => CompletionItemKind::MODULE,
         _ => CompletionItemKind::TEXT,
     }
 }
@@ -654,10 +857,123 @@ mod tests {
         };
 
         let notification = LspNotification::new(DidChangeTextDocument::METHOD.to_string(), params);
-        let err = handle_notification(&server, &mut docs, notification).unwrap_err();
+        handle_notification(&server, &mut docs, notification).unwrap();
+
+        // The change is only published once the debounce flushes it
+        let err = publish_pending(&server, &mut docs).unwrap_err();
         assert!(!err.to_string().is_empty());
     }
 
+    #[test]
+    fn incremental_changes_are_applied_in_order_and_published_once() {
+        let (server, client) = Connection::memory();
+        let mut docs = DocumentStore::new();
+        let uri = Uri::from_str("file:///tmp/coverage_lsp_incremental.braw").unwrap();
+        docs.open(uri.clone(), "ken x = 1\nblether x\n".to_string());
+
+        let edit = |line, from, to, text: &str| TextDocumentContentChangeEvent {
+            range: Some(Range {
+                start: Position {
+                    line,
+                    character: from,
+                },
+                end: Position {
+                    line,
+                    character: to,
+                },
+            }),
+            range_length: None,
+            text: text.to_string(),
+        };
+        let params = DidChangeTextDocumentParams {
+            text_document: VersionedTextDocumentIdentifier {
+                uri: uri.clone(),
+                version: 2,
+            },
+            content_changes: vec![edit(0, 8, 9, "("), edit(1, 8, 9, "y")],
+        };
+        let notification = LspNotification::new(DidChangeTextDocument::METHOD.to_string(), params);
+        handle_notification(&server, &mut docs, notification).unwrap();
+        assert_eq!(docs.get(&uri).unwrap(), "ken x = (\nblether y\n");
+        assert!(client.receiver.try_recv().is_err());
+
+        publish_pending(&server, &mut docs).unwrap();
+        publish_pending(&server, &mut docs).unwrap();
+        let Message::Notification(published) = client.receiver.try_recv().unwrap() else {
+            panic!("expected a diagnostics notification");
+        };
+        assert_eq!(published.method, "textDocument/publishDiagnostics");
+        assert!(client.receiver.try_recv().is_err());
+    }
+
+    #[test]
+    fn goto_definition_falls_back_to_the_workspace_index() {
+        let root = std::env::temp_dir().join(format!("mdh_lsp_ws_{}", std::process::id()));
+        std::fs::create_dir_all(&root).unwrap();
+        let lib = root.join("shapes.braw");
+        std::fs::write(&lib, "ken unit = 1\ndae area(s) {\n    gie s * s\n}\n").unwrap();
+
+        let mut docs = DocumentStore::new();
+        let (indexer, _handle) = WorkspaceIndexer::spawn(vec![root.clone()], None);
+        for _ in 0..200 {
+            if !indexer.index.lookup("area").is_empty() {
+                break;
+            }
+            std::thread::sleep(std::time::Duration::from_millis(10));
+        }
+        docs.workspace = Some(indexer);
+
+        let uri = Uri::from_str("file:///tmp/coverage_lsp_main.braw").unwrap();
+        docs.open(
+            uri.clone(),
+            "fetch \"shapes\"\nblether area(2)\n".to_string(),
+        );
+        let goto = GotoDefinitionParams {
+            text_document_position_params: hover_params(&uri, 1, 9).text_document_position_params,
+            work_done_progress_params: Default::default(),
+            partial_result_params: Default::default(),
+        };
+        let Some(GotoDefinitionResponse::Scalar(location)) = handle_goto_definition(&docs, goto)
+        else {
+            panic!("expected a workspace definition");
+        };
+        assert_eq!(workspace::uri_to_path(&location.uri), Some(lib));
+        assert_eq!(location.range.start.line, 1);
+        assert_eq!(location.range.start.character, 4);
+
+        let _ = std::fs::remove_dir_all(&root);
+    }
+
+    #[test]
+    fn hover_and_goto_definition_find_document_symbols() {
+        let mut docs = DocumentStore::new();
+        let uri = Uri::from_str("file:///tmp/coverage_lsp_symbols.braw").unwrap();
+        docs.open(
+            uri.clone(),
+            "dae add(a, b) {\n    gie a + b\n}\nblether add(1, 2)\n".to_string(),
+        );
+
+        let hover = handle_hover(&docs, hover_params(&uri, 3, 9)).unwrap();
+        let HoverContents::Markup(markup) = hover.contents else {
+            panic!("expected markup hover");
+        };
+        assert!(markup.value.contains("dae add(a, b)"));
+
+        let goto = GotoDefinitionParams {
+            text_document_position_params: hover_params(&uri, 3, 9).text_document_position_params,
+            work_done_progress_params: Default::default(),
+            partial_result_params: Default::default(),
+        };
+        let Some(GotoDefinitionResponse::Scalar(location)) = handle_goto_definition(&docs, goto)
+        else {
+            panic!("expected a definition");
+        };
+        assert_eq!(location.uri, uri);
+        assert_eq!(location.range.start.line, 0);
+        assert_eq!(location.range.start.character, 4);
+        assert_eq!(location.range.end.character, 7);
+    }
+
     #[test]
     fn main_loop_propagates_shutdown_send_error_for_coverage() {
         let (server, client) = Connection::memory();
@@ -3,26 +3,142 @@
 //! This module provides the interface between the LSP server
 //! and the mdhavers language implementation.
 
+use mdhavers::ast::arena::{Ast, AstBuilder, StmtId, StmtKind};
+use mdhavers::ast::Span;
 use mdhavers::lexer;
+use mdhavers::parser::Parser;
 use mdhavers::HaversError;
 
+/// A top-level definition: where it is (1-based, like diagnostics) and what to show for it
+#[derive(Debug, Clone, PartialEq)]
+pub struct Symbol {
+    pub name: String,
+    pub kind: &'static str,
+    pub detail: String,
+    pub line: usize,
+    pub column: usize,
+}
+
 /// Get diagnostics fer a piece o' mdhavers code
 /// Returns a list of (line, column, message, severity)
 pub fn get_diagnostics(source: &str) -> Vec<(usize, usize, String, String)> {
-    let mut diagnostics = Vec::new();
+    analyse(source).0
+}
 
+/// Lex and parse a piece of mdhavers code once, for its diagnostics and the symbols it defines
+pub fn analyse(source: &str) -> (Vec<(usize, usize, String, String)>, Vec<Symbol>) {
     // Lex using the real mdhavers lexer first (best source of line/column info).
-    if let Err(err) = lexer::lex(source) {
-        diagnostics.push(error_to_diagnostic(err));
-        return diagnostics;
-    }
+    let tokens = match lexer::lex(source) {
+        Ok(tokens) => tokens,
+        Err(err) => return (vec![error_to_diagnostic(err)], Vec::new()),
+    };
 
-    // Parse using the real mdhavers parser.
-    if let Err(err) = mdhavers::parse(source) {
-        diagnostics.push(error_to_diagnostic(err));
+    // Parse using the real mdhavers parser, into an arena since only the top level is read.
+    match Parser::with_builder(tokens, AstBuilder::default()).parse() {
+        Ok(ast) => {
+            let lines: Vec<&str> = source.lines().collect();
+            let mut symbols = Vec::new();
+            for &stmt in ast.roots() {
+                collect_symbols(&ast, stmt, &lines, None, &mut symbols);
+            }
+            (Vec::new(), symbols)
+        }
+        Err(err) => (vec![error_to_diagnostic(err)], Vec::new()),
     }
+}
 
-    diagnostics
+fn collect_symbols(
+    ast: &Ast,
+    stmt: StmtId,
+    lines: &[&str],
+    class: Option<&str>,
+    out: &mut Vec<Symbol>,
+) {
+    let node = ast.stmt(stmt);
+    let (name, kind, detail) = match node.kind {
+        StmtKind::Function { name, params, .. } => {
+            let name = ast.sym(name);
+            let params: Vec<&str> = ast.list(params).iter().map(|p| ast.sym(p.name)).collect();
+            let detail = match class {
+                Some(class) => format!("kin {class}: dae {name}({})", params.join(", ")),
+                None => format!("dae {name}({})", params.join(", ")),
+            };
+            let kind = if class.is_some() {
+                "method"
+            } else {
+                "function"
+            };
+            (name, kind, detail)
+        }
+        StmtKind::Class {
+            name,
+            superclass,
+            methods,
+        } => {
+            let name = ast.sym(name);
+            for &method in ast.list(methods) {
+                collect_symbols(ast, method, lines, Some(name), out);
+            }
+            let detail = match superclass {
+                Some(parent) => format!("kin {name} fae {}", ast.sym(parent)),
+                None => format!("kin {name}"),
+            };
+            (name, "class", detail)
+        }
+        StmtKind::Struct { name, fields } => {
+            let name = ast.sym(name);
+            let fields: Vec<&str> = ast.list(fields).iter().map(|&f| ast.sym(f)).collect();
+            let detail = format!("thing {name} {{ {} }}", fields.join(", "));
+            (name, "struct", detail)
+        }
+        StmtKind::VarDecl { name, .. } => {
+            let name = ast.sym(name);
+            (name, "variable", format!("ken {name}"))
+        }
+        StmtKind::Import {
+            path,
+            alias: Some(alias),
+        } => {
+            let alias = ast.sym(alias);
+            let detail = format!("fetch \"{}\" tae {alias}", ast.sym(path));
+            (alias, "module", detail)
+        }
+        _ => return,
+    };
+    let span = node.span();
+    out.push(Symbol {
+        name: name.to_string(),
+        kind,
+        detail,
+        line: span.line,
+        column: name_column(lines, &span, name),
+    });
+}
+
+/// The column of name on its definition's line, or the keyword's column if it isn't there
+fn name_column(lines: &[&str], span: &Span, name: &str) -> usize {
+    let Some(line) = lines.get(span.line.wrapping_sub(1)) else {
+        return span.column;
+    };
+    let from: usize = line
+        .chars()
+        .take(span.column.saturating_sub(1))
+        .map(char::len_utf8)
+        .sum();
+    let bytes = line.as_bytes();
+    let is_word = |b: u8| b.is_ascii_alphanumeric() || b == b'_';
+    let mut at = from;
+    while let Some(found) = line[at..].find(name) {
+        let start = at + found;
+        let end = start + name.len();
+        if (start == 0 || !is_word(bytes[start - 1]))
+            && (end == bytes.len() || !is_word(bytes[end]))
+        {
+            return line[..start].chars().count() + 1;
+        }
+        at = end;
+    }
+    span.column
 }
 
 fn error_to_diagnostic(err: HaversError) -> (usize, usize, String, String) {
@@ -792,6 +908,30 @@ mod tests {
         assert!(diagnostics.iter().any(|d| d.3 == "error"));
     }
 
+    #[test]
+    fn test_analyse_collects_top_level_symbols() {
+        let source = "fetch \"maths\" tae m\nken total = 0\ndae add(a, b = 1) {\n    gie a + b\n}\nkin Coo fae Beast {\n    dae moo() {\n        gie 1\n    }\n}\nthing Point { x, y }\n";
+        let (diagnostics, symbols) = analyse(source);
+        assert!(diagnostics.is_empty());
+        let found: Vec<(&str, &str, usize, usize)> = symbols
+            .iter()
+            .map(|s| (s.name.as_str(), s.kind, s.line, s.column))
+            .collect();
+        assert_eq!(
+            found,
+            vec![
+                ("m", "module", 1, 19),
+                ("total", "variable", 2, 5),
+                ("add", "function", 3, 5),
+                ("moo", "method", 7, 9),
+                ("Coo", "class", 6, 5),
+                ("Point", "struct", 11, 7),
+            ]
+        );
+        assert_eq!(symbols[2].detail, "dae add(a, b)");
+        assert_eq!(symbols[4].detail, "kin Coo fae Beast");
+    }
+
     #[test]
     fn test_error_to_diagnostic_fallback_branch() {
         let err = HaversError::TypeError {
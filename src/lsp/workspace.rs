@@ -0,0 +1,433 @@
+//! The workspace symbol index for the LSP
+//!
+//! A background thread walks the workspace and the stdlib for `.braw` files, pulls the
+//! top-level symbols out of each one, and keeps them in a shared map. The map is saved to
+//! a small text cache so the next start only re-parses files whose size or mtime changed.
+//! After the first pass the thread waits for changed paths and re-indexes just them.
+
+use std::collections::{HashMap, HashSet};
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::str::FromStr;
+use std::sync::mpsc::{self, Sender};
+use std::sync::{Arc, Mutex};
+use std::thread::{self, JoinHandle};
+use std::time::UNIX_EPOCH;
+
+use lsp_types::Uri;
+
+use crate::document::Document;
+use crate::mdhavers_bindings::Symbol;
+
+const CACHE_HEADER: &str = "mdhavers-index 1";
+const SKIPPED_DIRS: [&str; 4] = [".git", "target", "node_modules", "_gate_build"];
+const KINDS: [&str; 6] = [
+    "function", "method", "class", "struct", "variable", "module",
+];
+
+/// A file's symbols and the size/mtime they were read at
+#[derive(Debug, Clone, PartialEq)]
+struct IndexedFile {
+    len: u64,
+    modified: u128,
+    symbols: Vec<Symbol>,
+}
+
+/// Symbols for every indexed file, shared with the indexing thread
+#[derive(Default)]
+pub struct WorkspaceIndex {
+    files: Mutex<HashMap<PathBuf, IndexedFile>>,
+}
+
+/// The handle the server keeps: the index, and the channel to tell its thread about changes
+pub struct WorkspaceIndexer {
+    pub index: Arc<WorkspaceIndex>,
+    changes: Sender<PathBuf>,
+}
+
+impl WorkspaceIndexer {
+    /// Start indexing roots in the background, seeded from (and saving to) cache_path
+    pub fn spawn(roots: Vec<PathBuf>, cache_path: Option<PathBuf>) -> (Self, JoinHandle<()>) {
+        let index = Arc::new(WorkspaceIndex::default());
+        let (changes, receiver) = mpsc::channel::<PathBuf>();
+        let worker = Arc::clone(&index);
+        let handle = thread::spawn(move || {
+            if let Some(cache) = &cache_path {
+                worker.load(cache);
+            }
+            worker.index_roots(&roots);
+            if let Some(cache) = &cache_path {
+                worker.save(cache);
+            }
+            // Changes come in bursts, so drain them all before saving again
+            while let Ok(path) = receiver.recv() {
+                worker.index_file(&path);
+                for path in receiver.try_iter() {
+                    worker.index_file(&path);
+                }
+                if let Some(cache) = &cache_path {
+                    worker.save(cache);
+                }
+            }
+        });
+        (WorkspaceIndexer { index, changes }, handle)
+    }
+
+    /// Queue a changed, created or deleted file for re-indexing
+    pub fn file_changed(&self, path: PathBuf) {
+        let _ = self.changes.send(path);
+    }
+}
+
+impl WorkspaceIndex {
+    /// Every definition of name across the indexed files
+    pub fn lookup(&self, name: &str) -> Vec<(PathBuf, Symbol)> {
+        let files = self.files.lock().unwrap();
+        let mut found: Vec<(PathBuf, Symbol)> = files
+            .iter()
+            .flat_map(|(path, file)| {
+                file.symbols
+                    .iter()
+                    .filter(|symbol| symbol.name == name)
+                    .map(move |symbol| (path.clone(), symbol.clone()))
+            })
+            .collect();
+        found.sort_by(|a, b| a.0.cmp(&b.0).then(a.1.line.cmp(&b.1.line)));
+        found
+    }
+
+    /// The top-level functions, classes and structs of every indexed file
+    pub fn top_level_symbols(&self) -> Vec<Symbol> {
+        let files = self.files.lock().unwrap();
+        files
+            .values()
+            .flat_map(|file| file.symbols.iter())
+            .filter(|symbol| matches!(symbol.kind, "function" | "class" | "struct"))
+            .cloned()
+            .collect()
+    }
+
+    fn index_roots(&self, roots: &[PathBuf]) {
+        let mut seen = HashSet::new();
+        for root in roots {
+            collect_braw_files(root, &mut seen);
+        }
+        for path in &seen {
+            self.index_file(path);
+        }
+        // Files the cache knew about that are no longer under any root
+        let mut files = self.files.lock().unwrap();
+        files.retain(|path, _| seen.contains(path));
+    }
+
+    /// Re-read path if its size or mtime changed, or drop it if it's gone
+    fn index_file(&self, path: &Path) {
+        let Some((len, modified)) = stamp(path) else {
+            self.files.lock().unwrap().remove(path);
+            return;
+        };
+        if let Some(file) = self.files.lock().unwrap().get(path) {
+            if file.len == len && file.modified == modified {
+                return;
+            }
+        }
+        // Parse outside the lock so lookups don't wait on it
+        let Ok(text) = fs::read_to_string(path) else {
+            return;
+        };
+        let symbols = Document::new(text).analysis().symbols.clone();
+        self.files.lock().unwrap().insert(
+            path.to_path_buf(),
+            IndexedFile {
+                len,
+                modified,
+                symbols,
+            },
+        );
+    }
+
+    /// Read the cache written by save; a missing or mangled cache just means a full index
+    fn load(&self, cache: &Path) {
+        let Ok(text) = fs::read_to_string(cache) else {
+            return;
+        };
+        if let Some(files) = parse_cache(&text) {
+            *self.files.lock().unwrap() = files;
+        }
+    }
+
+    fn save(&self, cache: &Path) {
+        let text = {
+            let files = self.files.lock().unwrap();
+            format_cache(&files)
+        };
+        if let Some(dir) = cache.parent() {
+            let _ = fs::create_dir_all(dir);
+        }
+        // Write then rename, so a crash never leaves half a cache
+        let tmp = cache.with_extension("tmp");
+        if fs::write(&tmp, text).is_ok() {
+            let _ = fs::rename(&tmp, cache);
+        }
+    }
+}
+
+/// One `F` line per file, then one `S` line per symbol, tab-separated
+fn format_cache(files: &HashMap<PathBuf, IndexedFile>) -> String {
+    let mut paths: Vec<&PathBuf> = files.keys().collect();
+    paths.sort();
+    let mut out = String::from(CACHE_HEADER);
+    out.push('\n');
+    for path in paths {
+        let file = &files[path];
+        out.push_str(&format!(
+            "F\t{}\t{}\t{}\n",
+            file.len,
+            file.modified,
+            path.display()
+        ));
+        for symbol in &file.symbols {
+            out.push_str(&format!(
+                "S\t{}\t{}\t{}\t{}\t{}\n",
+                symbol.kind, symbol.line, symbol.column, symbol.name, symbol.detail
+            ));
+        }
+    }
+    out
+}
+
+fn parse_cache(text: &str) -> Option<HashMap<PathBuf, IndexedFile>> {
+    let mut lines = text.lines();
+    if lines.next()? != CACHE_HEADER {
+        return None;
+    }
+    let mut files = HashMap::new();
+    let mut current: Option<(PathBuf, IndexedFile)> = None;
+    for line in lines {
+        let fields: Vec<&str> = line.splitn(6, '\t').collect();
+        match fields.as_slice() {
+            ["F", len, modified, path] => {
+                if let Some((path, file)) = current.take() {
+                    files.insert(path, file);
+                }
+                let file = IndexedFile {
+                    len: len.parse().ok()?,
+                    modified: modified.parse().ok()?,
+                    symbols: Vec::new(),
+                };
+                current = Some((PathBuf::from(path), file));
+            }
+            ["S", kind, line, column, name, detail] => {
+                let kind = KINDS.iter().find(|k| *k == kind)?;
+                current.as_mut()?.1.symbols.push(Symbol {
+                    name: name.to_string(),
+                    kind,
+                    detail: detail.to_string(),
+                    line: line.parse().ok()?,
+                    column: column.parse().ok()?,
+                });
+            }
+            _ => return None,
+        }
+    }
+    if let Some((path, file)) = current {
+        files.insert(path, file);
+    }
+    Some(files)
+}
+
+/// A file's size and mtime (in nanoseconds), or None if it's not a readable file
+fn stamp(path: &Path) -> Option<(u64, u128)> {
+    let meta = fs::metadata(path).ok()?;
+    if !meta.is_file() {
+        return None;
+    }
+    let modified = meta.modified().ok()?.duration_since(UNIX_EPOCH).ok()?;
+    Some((meta.len(), modified.as_nanos()))
+}
+
+fn collect_braw_files(dir: &Path, out: &mut HashSet<PathBuf>) {
+    let Ok(entries) = fs::read_dir(dir) else {
+        return;
+    };
+    for entry in entries.flatten() {
+        let path = entry.path();
+        let Ok(kind) = entry.file_type() else {
+            continue;
+        };
+        if kind.is_dir() {
+            let skipped = path
+                .file_name()
+                .and_then(|name| name.to_str())
+                .is_some_and(|name| SKIPPED_DIRS.contains(&name));
+            if !skipped {
+                collect_braw_files(&path, out);
+            }
+        } else if path.extension().is_some_and(|ext| ext == "braw") {
+            out.insert(path);
+        }
+    }
+}
+
+/// The stdlib the interpreter would use for root: the first `stdlib/` in root or above
+/// it, else the one next to the executable
+pub fn find_stdlib(root: &Path) -> Option<PathBuf> {
+    let beside_exe = std::env::current_exe()
+        .ok()
+        .and_then(|exe| exe.parent().map(|dir| dir.join("stdlib")));
+    root.ancestors()
+        .map(|dir| dir.join("stdlib"))
+        .chain(beside_exe)
+        .find(|dir| dir.is_dir())
+}
+
+/// The local path of a `file://` URI, percent-decoded
+pub fn uri_to_path(uri: &Uri) -> Option<PathBuf> {
+    let encoded = uri.as_str().strip_prefix("file://")?;
+    let bytes = encoded.as_bytes();
+    let mut decoded = Vec::with_capacity(bytes.len());
+    let mut i = 0;
+    while i < bytes.len() {
+        let hex = bytes
+            .get(i + 1..i + 3)
+            .and_then(|hex| std::str::from_utf8(hex).ok())
+            .and_then(|hex| u8::from_str_radix(hex, 16).ok());
+        match (bytes[i], hex) {
+            (b'%', Some(byte)) => {
+                decoded.push(byte);
+                i += 3;
+            }
+            (byte, _) => {
+                decoded.push(byte);
+                i += 1;
+            }
+        }
+    }
+    Some(PathBuf::from(String::from_utf8(decoded).ok()?))
+}
+
+/// The `file://` URI for a local path, percent-encoding anything but path characters
+pub fn path_to_uri(path: &Path) -> Option<Uri> {
+    let mut uri = String::from("file://");
+    for &byte in path.to_str()?.as_bytes() {
+        if byte.is_ascii_alphanumeric() || b"/-._~".contains(&byte) {
+            uri.push(byte as char);
+        } else {
+            uri.push_str(&format!("%{byte:02X}"));
+        }
+    }
+    Uri::from_str(&uri).ok()
+}
+
+/// Where the index for root is cached between runs
+pub fn cache_path(root: &Path) -> Option<PathBuf> {
+    use std::collections::hash_map::DefaultHasher;
+    use std::hash::{Hash, Hasher};
+
+    let mut hasher = DefaultHasher::new();
+    root.hash(&mut hasher);
+    let dir = dirs::cache_dir()?.join("mdhavers");
+    Some(dir.join(format!("lsp-{:016x}.idx", hasher.finish())))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn temp_dir(name: &str) -> PathBuf {
+        let dir = std::env::temp_dir().join(format!("mdh_ws_{name}_{}", std::process::id()));
+        let _ = fs::remove_dir_all(&dir);
+        fs::create_dir_all(&dir).unwrap();
+        dir
+    }
+
+    #[test]
+    fn cache_round_trips_and_rejects_other_formats() {
+        let mut files = HashMap::new();
+        files.insert(
+            PathBuf::from("/tmp/a b.braw"),
+            IndexedFile {
+                len: 42,
+                modified: 1_700_000_000_123_456_789,
+                symbols: vec![Symbol {
+                    name: "add".to_string(),
+                    kind: "function",
+                    detail: "dae add(a, b)".to_string(),
+                    line: 3,
+                    column: 5,
+                }],
+            },
+        );
+        files.insert(
+            PathBuf::from("/tmp/empty.braw"),
+            IndexedFile {
+                len: 0,
+                modified: 7,
+                symbols: Vec::new(),
+            },
+        );
+        assert_eq!(parse_cache(&format_cache(&files)), Some(files));
+        assert_eq!(parse_cache("mdhavers-index 0\n"), None);
+        assert_eq!(
+            parse_cache("mdhavers-index 1\nS\tfunction\t1\t1\tf\tdae f()\n"),
+            None
+        );
+    }
+
+    #[test]
+    fn uris_and_paths_convert_both_ways() {
+        let path = PathBuf::from("/tmp/my project/ü.braw");
+        let uri = path_to_uri(&path).unwrap();
+        assert_eq!(uri.as_str(), "file:///tmp/my%20project/%C3%BC.braw");
+        assert_eq!(uri_to_path(&uri), Some(path));
+        assert_eq!(
+            uri_to_path(&Uri::from_str("untitled:Untitled-1").unwrap()),
+            None
+        );
+    }
+
+    #[test]
+    fn indexer_finds_symbols_and_follows_changes() {
+        let root = temp_dir("index");
+        fs::create_dir_all(root.join("lib")).unwrap();
+        fs::create_dir_all(root.join("target")).unwrap();
+        fs::write(
+            root.join("lib/shapes.braw"),
+            "kin Square {\n}\ndae area(s) {\n}\n",
+        )
+        .unwrap();
+        fs::write(root.join("target/skipped.braw"), "dae hidden() {\n}\n").unwrap();
+        let cache = root.join("cache/index.idx");
+
+        let (indexer, handle) = WorkspaceIndexer::spawn(vec![root.clone()], Some(cache.clone()));
+        let shapes = root.join("lib/shapes.braw");
+        fs::write(&shapes, "kin Square {\n}\n\ndae area(s) {\n}\n").unwrap();
+        indexer.file_changed(shapes.clone());
+        let index = Arc::clone(&indexer.index);
+        drop(indexer);
+        handle.join().unwrap();
+
+        let area = index.lookup("area");
+        assert_eq!(area.len(), 1);
+        assert_eq!(area[0].0, shapes);
+        assert_eq!((area[0].1.line, area[0].1.column), (4, 5));
+        assert!(index.lookup("hidden").is_empty());
+        let mut names: Vec<String> = index
+            .top_level_symbols()
+            .into_iter()
+            .map(|symbol| symbol.name)
+            .collect();
+        names.sort();
+        assert_eq!(names, vec!["Square", "area"]);
+
+        // A fresh index starts from the cache, and drops files that have gone
+        let reloaded = WorkspaceIndex::default();
+        reloaded.load(&cache);
+        assert_eq!(reloaded.lookup("area"), area);
+        fs::remove_file(&shapes).unwrap();
+        reloaded.index_roots(&[root.clone()]);
+        assert!(reloaded.lookup("area").is_empty());
+
+        let _ = fs::remove_dir_all(&root);
+    }
+}
@@ -1,3 +1,5 @@
+use std::collections::HashSet;
+use std::fmt::Write as _;
 use std::fs;
 use std::path::PathBuf;
 use std::process;
@@ -7,15 +9,19 @@ use colored::*;
 use rustyline::error::ReadlineError;
 use rustyline::DefaultEditor;
 
-use mdhavers::compiler::compile;
+use mdhavers::ast::arena::{AstBuilder, StmtKind};
+use mdhavers::compiler::{compile, compile_optimised};
 use mdhavers::error::{format_error_context, random_scots_exclamation};
 use mdhavers::formatter;
+use mdhavers::interpreter::ExecMode;
 use mdhavers::lexer;
 use mdhavers::parser::parse;
 use mdhavers::wasm_compiler;
 use mdhavers::Interpreter;
 use mdhavers::Value;
 
+mod batch;
+
 // Crash handler helpers are excluded from source-based coverage runs.
 #[cfg(not(coverage))]
 use mdhavers::interpreter::{is_crash_handling_enabled, print_stack_trace};
@@ -75,6 +81,10 @@ enum Commands {
     Run {
         /// The .braw file to run
         file: PathBuf,
+
+        /// Compile function bodies to bytecode instead of walking the tree
+        #[arg(long)]
+        bytecode: bool,
     },
 
     /// Compile a .braw program to JavaScript
@@ -85,26 +95,44 @@ enum Commands {
         /// Output file (defaults to <input>.js)
         #[arg(short, long)]
         output: Option<PathBuf>,
+
+        /// Only emit the runtime helpers the program uses, and count `fer` loops over ranges
+        #[arg(long)]
+        optimise: bool,
     },
 
     /// Start the interactive REPL
-    Repl,
+    Repl {
+        /// Compile function bodies to bytecode instead of walking the tree
+        #[arg(long)]
+        bytecode: bool,
+    },
 
-    /// Check a .braw file for errors without running it
+    /// Check .braw files, and the modules they fetch, for errors without running them
     Check {
-        /// The .braw file to check
-        file: PathBuf,
+        /// The .braw files (or directories of them) to check
+        #[arg(required = true, value_name = "FILE")]
+        files: Vec<PathBuf>,
+
+        /// How many files to check at once (defaults to the number of CPUs)
+        #[arg(short, long)]
+        jobs: Option<usize>,
     },
 
-    /// Format a .braw file (pretty print)
+    /// Format .braw files (pretty print)
     #[command(name = "fmt")]
     Format {
-        /// The .braw file to format
-        file: PathBuf,
+        /// The .braw files (or directories of them) to format
+        #[arg(required = true, value_name = "FILE")]
+        files: Vec<PathBuf>,
 
         /// Just check if formatting is needed (dinnae modify)
         #[arg(long)]
         check: bool,
+
+        /// How many files to format at once (defaults to the number of CPUs)
+        #[arg(short, long)]
+        jobs: Option<usize>,
     },
 
     /// Show tokens from lexer (for debugging)
@@ -137,6 +165,10 @@ enum Commands {
         /// Output file (defaults to <input>.wat)
         #[arg(short, long)]
         output: Option<PathBuf>,
+
+        /// Keep int, float and bool locals unboxed instead of in host handles
+        #[arg(long)]
+        unboxed: bool,
     },
 
     /// Run a .wat or .wasm file using the built-in host runner
@@ -162,6 +194,45 @@ enum Commands {
         /// Emit LLVM IR instead of native binary
         #[arg(long)]
         emit_llvm: bool,
+
+        /// Garbage collector to link: "stub" (never frees) or "marksweep"
+        #[arg(long, default_value = "stub", value_parser = ["stub", "marksweep"])]
+        gc: String,
+
+        /// Instrument the executable to write a branch profile when it exits
+        /// (to $MDH_PROFILE_FILE, or default.mdhprof)
+        #[arg(long, conflicts_with = "pgo_use")]
+        pgo_gen: bool,
+
+        /// Optimise using a profile written by a --pgo-gen build
+        #[arg(long, value_name = "PROFILE")]
+        pgo_use: Option<PathBuf>,
+
+        /// Record allocation sites; the executable writes a heap profile
+        /// to $MDH_HEAPPROF when that is set
+        #[arg(long)]
+        heap_prof: bool,
+
+        /// Sample where the CPU time goes; the executable writes a CPU profile
+        /// to $MDH_CPUPROF (default cpu.folded) when it exits
+        #[arg(long)]
+        profile: bool,
+
+        /// Print how long each phase of the build took (parse, codegen,
+        /// optimisation, link, ...) to stderr
+        #[arg(long)]
+        time_passes: bool,
+    },
+
+    /// Decode a log file written with "format": "binary"
+    #[command(name = "log-decode")]
+    LogDecode {
+        /// The binary log file to decode
+        file: PathBuf,
+
+        /// Print JSON lines instead of text
+        #[arg(long)]
+        json: bool,
     },
 }
 
@@ -172,15 +243,27 @@ fn main() {
     let cli = Cli::parse();
 
     let result = match cli.command {
-        Some(Commands::Run { file }) => run_file(&file),
-        Some(Commands::Compile { file, output }) => compile_file(&file, output),
-        Some(Commands::Repl) => run_repl(),
-        Some(Commands::Check { file }) => check_file(&file),
-        Some(Commands::Format { file, check }) => format_file(&file, check),
+        Some(Commands::Run { file, bytecode }) => run_file(&file, exec_mode(bytecode)),
+        Some(Commands::Compile {
+            file,
+            output,
+            optimise,
+        }) => compile_file(&file, output, optimise),
+        Some(Commands::Repl { bytecode }) => run_repl(exec_mode(bytecode)),
+        Some(Commands::Check { files, jobs }) => {
+            check_files(&files, jobs.unwrap_or_else(batch::default_jobs))
+        }
+        Some(Commands::Format { files, check, jobs }) => {
+            format_files(&files, check, jobs.unwrap_or_else(batch::default_jobs))
+        }
         Some(Commands::Tokens { file }) => show_tokens(&file),
         Some(Commands::Ast { file }) => show_ast(&file),
         Some(Commands::Trace { file, verbose }) => trace_file(&file, verbose),
-        Some(Commands::Wasm { file, output }) => compile_wasm(&file, output),
+        Some(Commands::Wasm {
+            file,
+            output,
+            unboxed,
+        }) => compile_wasm(&file, output, unboxed),
         #[cfg(feature = "wasm_runner")]
         Some(Commands::WasmRun { file }) => mdhavers::wasm_runner::run_wasm_file(&file),
         Some(Commands::Build {
@@ -188,14 +271,32 @@ fn main() {
             output,
             opt_level,
             emit_llvm,
-        }) => build_native(&file, output, opt_level, emit_llvm),
+            gc,
+            pgo_gen,
+            pgo_use,
+            heap_prof,
+            profile,
+            time_passes,
+        }) => build_native(
+            &file,
+            output,
+            opt_level,
+            emit_llvm,
+            &gc,
+            pgo_gen,
+            pgo_use,
+            heap_prof,
+            profile,
+            time_passes,
+        ),
+        Some(Commands::LogDecode { file, json }) => decode_log(&file, json),
         None => {
             // If a file is provided directly, run it
             if let Some(file) = cli.file {
-                run_file(&file)
+                run_file(&file, ExecMode::Tree)
             } else {
                 // Otherwise, start REPL
-                run_repl()
+                run_repl(ExecMode::Tree)
             }
         }
     };
@@ -206,13 +307,23 @@ fn main() {
     }
 }
 
-fn run_file(path: &PathBuf) -> Result<(), String> {
+fn exec_mode(bytecode: bool) -> ExecMode {
+    if bytecode {
+        ExecMode::Bytecode
+    } else {
+        ExecMode::Tree
+    }
+}
+
+fn run_file(path: &PathBuf, mode: ExecMode) -> Result<(), String> {
     let source = read_file(path)?;
     let program = match parse(&source) {
         Ok(p) => p,
         Err(e) => return Err(format_parse_error(&source, e)),
     };
+    let program = mdhavers::optimise::optimise(&program);
     let mut interpreter = Interpreter::new();
+    interpreter.set_exec_mode(mode);
 
     // Set the current file name fer logging
     let filename = path
@@ -301,9 +412,14 @@ fn trace_file(path: &PathBuf, verbose: bool) -> Result<(), String> {
     Ok(())
 }
 
-fn compile_file(path: &PathBuf, output: Option<PathBuf>) -> Result<(), String> {
+fn compile_file(path: &PathBuf, output: Option<PathBuf>, optimise: bool) -> Result<(), String> {
     let source = read_file(path)?;
-    let js_code = match compile(&source) {
+    let compiled = if optimise {
+        compile_optimised(&source)
+    } else {
+        compile(&source)
+    };
+    let js_code = match compiled {
         Ok(js) => js,
         Err(e) => return Err(format_parse_error(&source, e)),
     };
@@ -328,9 +444,14 @@ fn compile_file(path: &PathBuf, output: Option<PathBuf>) -> Result<(), String> {
     Ok(())
 }
 
-fn compile_wasm(path: &PathBuf, output: Option<PathBuf>) -> Result<(), String> {
+fn compile_wasm(path: &PathBuf, output: Option<PathBuf>, unboxed: bool) -> Result<(), String> {
     let source = read_file(path)?;
-    let wat_code = match wasm_compiler::compile_to_wat(&source) {
+    let compiled = if unboxed {
+        wasm_compiler::compile_to_wat_unboxed(&source)
+    } else {
+        wasm_compiler::compile_to_wat(&source)
+    };
+    let wat_code = match compiled {
         Ok(wat) => wat,
         Err(e) => return Err(format_parse_error(&source, e)),
     };
@@ -359,11 +480,18 @@ fn compile_wasm(path: &PathBuf, output: Option<PathBuf>) -> Result<(), String> {
 }
 
 #[cfg(not(feature = "llvm"))]
+#[allow(clippy::too_many_arguments)]
 fn build_native(
     _path: &PathBuf,
     _output: Option<PathBuf>,
     _opt_level: u8,
     _emit_llvm: bool,
+    _gc: &str,
+    _pgo_gen: bool,
+    _pgo_use: Option<PathBuf>,
+    _heap_prof: bool,
+    _profile: bool,
+    _time_passes: bool,
 ) -> Result<(), String> {
     use colored::Colorize;
     eprintln!("{}", "═".repeat(60).yellow());
@@ -411,22 +539,42 @@ fn build_native(
 }
 
 #[cfg(feature = "llvm")]
+#[allow(clippy::too_many_arguments)]
 fn build_native(
     path: &PathBuf,
     output: Option<PathBuf>,
     opt_level: u8,
     emit_llvm: bool,
+    gc: &str,
+    pgo_gen: bool,
+    pgo_use: Option<PathBuf>,
+    heap_prof: bool,
+    profile: bool,
+    time_passes: bool,
 ) -> Result<(), String> {
+    let started = std::time::Instant::now();
     let source = read_file(path)?;
     let program = match parse(&source) {
         Ok(p) => p,
         Err(e) => return Err(format_parse_error(&source, e)),
     };
+    let parse_time = started.elapsed();
+    // The report goes out whether or not the build worked
+    let report_passes = |compiler: &mdhavers::LLVMCompiler| {
+        if let Some(report) = compiler.pass_report() {
+            eprint!("{}", report);
+        }
+    };
 
     if emit_llvm {
         // Emit LLVM IR
-        let compiler = mdhavers::LLVMCompiler::new().with_optimization(opt_level);
-        let ir = match compiler.compile_to_ir(&program) {
+        let compiler = mdhavers::LLVMCompiler::new()
+            .with_optimization(opt_level)
+            .with_time_passes(time_passes);
+        compiler.record_pass("parse", parse_time);
+        let ir = compiler.compile_to_ir(&program);
+        report_passes(&compiler);
+        let ir = match ir {
             Ok(ir) => ir,
             Err(e) => return Err(format!("{}", e)),
         };
@@ -455,10 +603,24 @@ fn build_native(
             p
         });
 
-        let compiler = mdhavers::LLVMCompiler::new();
-        if let Err(e) =
-            compiler.compile_to_native_with_source(&program, &output_path, opt_level, Some(path))
-        {
+        let gc_mode = mdhavers::GcMode::from_name(gc)
+            .ok_or_else(|| format!("Unknown garbage collector: {}", gc))?;
+        let pgo = match (pgo_gen, pgo_use) {
+            (true, _) => mdhavers::PgoMode::Generate,
+            (false, Some(profile)) => mdhavers::PgoMode::Use(profile),
+            (false, None) => mdhavers::PgoMode::Off,
+        };
+        let compiler = mdhavers::LLVMCompiler::new()
+            .with_gc(gc_mode)
+            .with_pgo(pgo)
+            .with_heap_profile(heap_prof)
+            .with_cpu_profile(profile)
+            .with_time_passes(time_passes);
+        compiler.record_pass("parse", parse_time);
+        let built =
+            compiler.compile_to_native_with_source(&program, &output_path, opt_level, Some(path));
+        report_passes(&compiler);
+        if let Err(e) = built {
             return Err(format!("{}", e));
         }
 
@@ -528,7 +690,7 @@ fn repl_needs_more_input(buffer: &str) -> bool {
     in_string || braces > 0 || brackets > 0 || parens > 0
 }
 
-fn run_repl() -> Result<(), String> {
+fn run_repl(mode: ExecMode) -> Result<(), String> {
     use mdhavers::interpreter::TraceMode;
 
     println!("{}", "═".repeat(50).cyan());
@@ -564,6 +726,7 @@ fn run_repl() -> Result<(), String> {
     }
 
     let mut interpreter = Interpreter::new();
+    interpreter.set_exec_mode(mode);
     let mut trace_enabled = false;
     let mut verbose_trace = false;
     let mut buffer = String::new();
@@ -637,6 +800,7 @@ fn run_repl() -> Result<(), String> {
                         }
                         ":reset" | "reset" => {
                             interpreter = Interpreter::new();
+                            interpreter.set_exec_mode(mode);
                             if let Err(e) = interpreter.load_prelude() {
                                 eprintln!("{}: Couldnae load prelude: {}", "Warning".yellow(), e);
                             }
@@ -1070,34 +1234,155 @@ fn print_environment(interpreter: &Interpreter) {
     println!();
 }
 
-fn check_file(path: &PathBuf) -> Result<(), String> {
-    let source = read_file(path)?;
+/// What checking or formatting one file had to say, held back so that files report in
+/// the order they were named rather than the order their threads finished
+struct FileReport {
+    warning: Option<String>,
+    out: String,
+    result: Result<(), String>,
+}
+
+impl FileReport {
+    fn new(warning: Option<String>) -> Self {
+        FileReport {
+            warning,
+            out: String::new(),
+            result: Ok(()),
+        }
+    }
+
+    fn print(&self) {
+        if let Some(warning) = &self.warning {
+            eprintln!("{}", warning);
+        }
+        print!("{}", self.out);
+    }
+}
+
+/// Turn the reports into the command's result: a lone file's own error, or a count
+/// after printing each failure
+fn finish_reports(reports: Vec<FileReport>) -> Result<(), String> {
+    if reports.len() == 1 {
+        return reports.into_iter().next().unwrap().result;
+    }
+    let total = reports.len();
+    let mut failed = 0;
+    for report in reports {
+        if let Err(e) = report.result {
+            eprintln!("{}: {}", random_scots_exclamation().red().bold(), e);
+            failed += 1;
+        }
+    }
+    if failed == 0 {
+        Ok(())
+    } else {
+        Err(format!("{} o' {} files had problems", failed, total))
+    }
+}
+
+/// Check the files, then the modules they fetch, then the modules those fetch, and so on.
+/// Each level is checked in parallel, and every module is checked once.
+fn check_files(paths: &[PathBuf], jobs: usize) -> Result<(), String> {
+    let mut level = batch::expand_paths(paths);
+    let mut seen: HashSet<PathBuf> = level.iter().map(|p| batch::canonical(p)).collect();
+    let mut reports = Vec::new();
+
+    while !level.is_empty() {
+        let results = batch::par_map(&level, jobs, check_file);
+        let mut next = Vec::new();
+        for (report, imports) in results {
+            report.print();
+            reports.push(report);
+            for import in imports {
+                if seen.insert(batch::canonical(&import)) {
+                    next.push(import);
+                }
+            }
+        }
+        level = next;
+    }
+
+    finish_reports(reports)
+}
+
+/// Check one file, returning its report and the files it fetches
+fn check_file(path: &PathBuf) -> (FileReport, Vec<PathBuf>) {
+    let (warning, source) = read_source(path);
+    let mut report = FileReport::new(warning);
+    let source = match source {
+        Ok(s) => s,
+        Err(e) => {
+            report.result = Err(e);
+            return (report, Vec::new());
+        }
+    };
 
     // Lex
     let tokens = match lexer::lex(&source) {
         Ok(t) => t,
-        Err(e) => return Err(format_parse_error(&source, e)),
+        Err(e) => {
+            report.result = Err(format_parse_error(&source, e));
+            return (report, Vec::new());
+        }
     };
-    println!("{} Lexing passed ({} tokens)", "✓".green(), tokens.len());
+    let _ = writeln!(
+        report.out,
+        "{} Lexing passed ({} tokens)",
+        "✓".green(),
+        tokens.len()
+    );
 
-    // Parse
-    let _program = match parse(&source) {
-        Ok(p) => p,
-        Err(e) => return Err(format_parse_error(&source, e)),
+    // Parse; only the imports get looked at, so an arena will do
+    let ast = match mdhavers::parser::Parser::with_builder(tokens, AstBuilder::default()).parse() {
+        Ok(a) => a,
+        Err(e) => {
+            report.result = Err(format_parse_error(&source, e));
+            return (report, Vec::new());
+        }
     };
-    println!("{} Parsing passed", "✓".green());
+    let _ = writeln!(report.out, "{} Parsing passed", "✓".green());
 
-    println!(
+    let _ = writeln!(
+        report.out,
         "\n{} {} looks braw!",
         "Bonnie!".green().bold(),
         path.display()
     );
 
-    Ok(())
+    let imports = ast
+        .roots()
+        .iter()
+        .filter_map(|&stmt| match ast.stmt(stmt).kind {
+            StmtKind::Import { path: module, .. } => batch::resolve_import(path, ast.sym(module)),
+            _ => None,
+        })
+        .collect();
+    (report, imports)
 }
 
-fn format_file(path: &PathBuf, check_only: bool) -> Result<(), String> {
-    let source = read_file(path)?;
+fn format_files(paths: &[PathBuf], check_only: bool, jobs: usize) -> Result<(), String> {
+    let files = batch::expand_paths(paths);
+    let reports = batch::par_map(&files, jobs, |path| format_file(path, check_only));
+    for report in &reports {
+        report.print();
+    }
+    finish_reports(reports)
+}
+
+fn format_file(path: &PathBuf, check_only: bool) -> FileReport {
+    let (warning, source) = read_source(path);
+    let mut report = FileReport::new(warning);
+    report.result = format_source_file(path, source, check_only, &mut report.out);
+    report
+}
+
+fn format_source_file(
+    path: &PathBuf,
+    source: Result<String, String>,
+    check_only: bool,
+    out: &mut String,
+) -> Result<(), String> {
+    let source = source?;
 
     // Format the code
     let formatted = match formatter::format_source(&source) {
@@ -1108,14 +1393,15 @@ fn format_file(path: &PathBuf, check_only: bool) -> Result<(), String> {
     if check_only {
         // Just check if formatting would change anything
         if source == formatted {
-            println!(
+            let _ = writeln!(
+                out,
                 "{} {} is already formatted braw!",
                 "✓".green(),
                 path.display()
             );
             Ok(())
         } else {
-            println!("{} {} needs formattin'!", "✗".red(), path.display());
+            let _ = writeln!(out, "{} {} needs formattin'!", "✗".red(), path.display());
             Err("File needs formattin'".to_string())
         }
     } else {
@@ -1124,7 +1410,8 @@ fn format_file(path: &PathBuf, check_only: bool) -> Result<(), String> {
             return Err(format!("Cannae write tae {}: {}", path.display(), e));
         }
 
-        println!(
+        let _ = writeln!(
+            out,
             "{} Formatted {} - lookin' braw!",
             "Bonnie!".green().bold(),
             path.display()
@@ -1180,26 +1467,52 @@ fn show_ast(path: &PathBuf) -> Result<(), String> {
     Ok(())
 }
 
-fn read_file(path: &PathBuf) -> Result<String, String> {
-    // Check extension
-    if let Some(ext) = path.extension() {
-        if ext != "braw" {
-            eprintln!(
-                "{}: File should have .braw extension, but got .{}",
-                "Warning".yellow(),
-                ext.to_string_lossy()
-            );
+fn decode_log(path: &PathBuf, json: bool) -> Result<(), String> {
+    let file =
+        fs::File::open(path).map_err(|e| format!("Cannae open log '{}': {}", path.display(), e))?;
+    let mut reader = mdhavers::binlog::BinlogReader::new(std::io::BufReader::new(file))
+        .map_err(|e| format!("'{}' isnae a binary log: {}", path.display(), e))?;
+    while let Some(record) = reader
+        .next_record()
+        .map_err(|e| format!("Cannae read log '{}': {}", path.display(), e))?
+    {
+        if json {
+            println!("{}", record.to_json());
+        } else {
+            println!("{}", record.to_text());
         }
     }
+    Ok(())
+}
 
-    match fs::read_to_string(path) {
+fn read_file(path: &PathBuf) -> Result<String, String> {
+    let (warning, source) = read_source(path);
+    if let Some(warning) = warning {
+        eprintln!("{}", warning);
+    }
+    source
+}
+
+/// Read a source file, returning the extension warning (if any) rather than printing it
+fn read_source(path: &PathBuf) -> (Option<String>, Result<String, String>) {
+    // Check extension
+    let warning = path.extension().filter(|ext| *ext != "braw").map(|ext| {
+        format!(
+            "{}: File should have .braw extension, but got .{}",
+            "Warning".yellow(),
+            ext.to_string_lossy()
+        )
+    });
+
+    let source = match fs::read_to_string(path) {
         Ok(s) => Ok(s),
         Err(e) => Err(format!(
             "Dinnae be daft! Cannae read '{}': {}",
             path.display(),
             e
         )),
-    }
+    };
+    (warning, source)
 }
 
 fn format_parse_error(source: &str, error: mdhavers::HaversError) -> String {
@@ -1257,7 +1570,7 @@ fn format_runtime_error(source: &str, error: mdhavers::HaversError) -> String {
         let dir = tempdir().expect("tempdir");
         let path = dir.path().join("hello.braw");
         std::fs::write(&path, "blether 1\n").expect("write file");
-        run_file(&path).expect("run file");
+        run_file(&path, ExecMode::Tree).expect("run file");
     }
 
     #[test]
@@ -1308,7 +1621,7 @@ fn format_runtime_error(source: &str, error: mdhavers::HaversError) -> String {
         std::fs::write(&filename, "blether 1\n").expect("write file");
 
         let path = PathBuf::from(&filename);
-        run_file(&path).expect("run file");
+        run_file(&path, ExecMode::Tree).expect("run file");
         trace_file(&path, false).expect("trace file");
 
         std::fs::remove_file(&filename).expect("cleanup file");
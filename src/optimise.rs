@@ -0,0 +1,1474 @@
+//! AST optimisation shared by the backends
+//!
+//! A pass over the parsed program that folds constant expressions, drops branches that
+//! can't run and inlines calls to small expression functions, so the interpreter, the
+//! JavaScript compiler and the LLVM backend all start from less work. Every rewrite keeps
+//! what the program does:
+//!
+//! - Folding covers integer `+ - *` within 2^53 (where JavaScript numbers are exact),
+//!   finite float `+ - *`, string `+`, comparisons of like literals, `nae`, and `an`,
+//!   `or` and `gin ... than` decided by a literal bool or `naething`. Division and
+//!   remainder are left alone: the backends round and report them differently.
+//! - A dead `gin` or `whiles` branch, or a statement after `gie`, `brak`, `haud` or
+//!   `hurl`, is only dropped if it declares nothing, since codegen gives a top-level
+//!   `ken` in any branch a global.
+//! - A function is inlined when it is defined once at the top level and never rebound,
+//!   and its body is a lone `gie` of a small expression reading only its parameters and
+//!   names bound nowhere (functions and builtins). The same goes for a lambda in a
+//!   top-level `ken` that is never rebound. An argument that does work is substituted
+//!   only if its parameter is read once, in order, before the body does anything of its
+//!   own; a variable only if nothing could reassign it while the body runs.
+
+use std::collections::{HashMap, HashSet};
+
+use crate::ast::{
+    BinaryOp, DestructPattern, Expr, FStringPart, Literal, LogicalOp, MatchArm, Param, Pattern,
+    Program, Span, Stmt, UnaryOp,
+};
+
+/// Most nodes an inlined body may have
+const INLINE_BUDGET: usize = 16;
+
+/// Integers up to this size are exact in every backend, JavaScript's doubles included
+const EXACT_INT: i64 = 1 << 53;
+
+/// `program` with constants folded, dead branches dropped and small functions inlined
+pub fn optimise(program: &Program) -> Program {
+    let mut names = Names::default();
+    names.stmts(&program.statements);
+    let inlines = inline_candidates(program, &names);
+    let mut pass = Pass {
+        names: &names,
+        inlines: &inlines,
+        locals: None,
+        inline: true,
+    };
+    let mut optimised = Program::new(pass.stmts(&program.statements));
+    // Inlined bodies now sit in their callers' scopes
+    crate::resolve::resolve(&mut optimised);
+    optimised
+}
+
+/// How names are bound across the whole program
+#[derive(Default)]
+struct Names {
+    /// Bindings by `ken`, assignment, parameters, loops, patterns, catches and imports
+    bound: HashMap<String, usize>,
+    /// Function definitions, at any depth
+    defined: HashMap<String, usize>,
+    /// Names assigned or bound by a loop inside a function, method or lambda: these
+    /// could change while an inlined body runs
+    reassigned: HashSet<String>,
+    depth: usize,
+}
+
+impl Names {
+    fn bind(&mut self, name: &str) {
+        *self.bound.entry(name.to_string()).or_insert(0) += 1;
+    }
+
+    fn rebind(&mut self, name: &str) {
+        self.bind(name);
+        if self.depth > 0 {
+            self.reassigned.insert(name.to_string());
+        }
+    }
+
+    fn function(&mut self, params: &[Param], body: &[Stmt]) {
+        self.depth += 1;
+        for param in params {
+            self.bind(&param.name);
+            if let Some(default) = &param.default {
+                self.expr(default);
+            }
+        }
+        self.stmts(body);
+        self.depth -= 1;
+    }
+
+    fn stmts(&mut self, stmts: &[Stmt]) {
+        for stmt in stmts {
+            self.stmt(stmt);
+        }
+    }
+
+    fn stmt(&mut self, stmt: &Stmt) {
+        match stmt {
+            Stmt::VarDecl {
+                name, initializer, ..
+            } => {
+                self.bind(name);
+                if let Some(init) = initializer {
+                    self.expr(init);
+                }
+            }
+            Stmt::Expression { expr, .. } | Stmt::Print { value: expr, .. } => self.expr(expr),
+            Stmt::Block { statements, .. } => self.stmts(statements),
+            Stmt::If {
+                condition,
+                then_branch,
+                else_branch,
+                ..
+            } => {
+                self.expr(condition);
+                self.stmt(then_branch);
+                if let Some(else_branch) = else_branch {
+                    self.stmt(else_branch);
+                }
+            }
+            Stmt::While {
+                condition, body, ..
+            } => {
+                self.expr(condition);
+                self.stmt(body);
+            }
+            Stmt::For {
+                variable,
+                iterable,
+                body,
+                ..
+            } => {
+                self.rebind(variable);
+                self.expr(iterable);
+                self.stmt(body);
+            }
+            Stmt::Function {
+                name, params, body, ..
+            } => {
+                *self.defined.entry(name.clone()).or_insert(0) += 1;
+                self.function(params, body);
+            }
+            Stmt::Return { value, .. } => {
+                if let Some(value) = value {
+                    self.expr(value);
+                }
+            }
+            Stmt::Class { name, methods, .. } => {
+                self.bind(name);
+                for method in methods {
+                    if let Stmt::Function { params, body, .. } = method {
+                        self.function(params, body);
+                    }
+                }
+            }
+            Stmt::Struct { name, .. } => self.bind(name),
+            Stmt::Import { alias, .. } => {
+                if let Some(alias) = alias {
+                    self.bind(alias);
+                }
+            }
+            Stmt::TryCatch {
+                try_block,
+                error_name,
+                catch_block,
+                ..
+            } => {
+                self.rebind(error_name);
+                self.stmt(try_block);
+                self.stmt(catch_block);
+            }
+            Stmt::Match { value, arms, .. } => {
+                self.expr(value);
+                for arm in arms {
+                    match &arm.pattern {
+                        Pattern::Identifier(name) => self.rebind(name),
+                        Pattern::Range { start, end } => {
+                            self.expr(start);
+                            self.expr(end);
+                        }
+                        Pattern::Literal(_) | Pattern::Wildcard => {}
+                    }
+                    self.stmt(&arm.body);
+                }
+            }
+            Stmt::Assert {
+                condition, message, ..
+            } => {
+                self.expr(condition);
+                if let Some(message) = message {
+                    self.expr(message);
+                }
+            }
+            Stmt::Destructure {
+                patterns, value, ..
+            } => {
+                for pattern in patterns {
+                    if let DestructPattern::Variable(name) | DestructPattern::Rest(name) = pattern {
+                        self.rebind(name);
+                    }
+                }
+                self.expr(value);
+            }
+            Stmt::Log {
+                message, extras, ..
+            } => {
+                self.expr(message);
+                for extra in extras {
+                    self.expr(extra);
+                }
+            }
+            Stmt::Hurl { message, .. } => self.expr(message),
+            Stmt::Break { .. } | Stmt::Continue { .. } => {}
+        }
+    }
+
+    fn expr(&mut self, expr: &Expr) {
+        match expr {
+            Expr::Assign { name, value, .. } => {
+                self.rebind(name);
+                self.expr(value);
+            }
+            Expr::Lambda { params, body, .. } => {
+                self.depth += 1;
+                for param in params {
+                    self.bind(param);
+                }
+                self.expr(body);
+                self.depth -= 1;
+            }
+            Expr::BlockExpr { statements, .. } => self.stmts(statements),
+            _ => each_child(expr, |child| self.expr(child)),
+        }
+    }
+}
+
+/// Calls `f` on each expression directly inside `expr` (not inside its statements)
+fn each_child(expr: &Expr, mut f: impl FnMut(&Expr)) {
+    match expr {
+        Expr::Literal { .. } | Expr::Variable { .. } | Expr::Masel { .. } => {}
+        Expr::BlockExpr { .. } => {}
+        Expr::Assign { value, .. } => f(value),
+        Expr::Binary { left, right, .. }
+        | Expr::Logical { left, right, .. }
+        | Expr::Pipe { left, right, .. }
+        | Expr::Range {
+            start: left,
+            end: right,
+            ..
+        }
+        | Expr::Index {
+            object: left,
+            index: right,
+            ..
+        } => {
+            f(left);
+            f(right);
+        }
+        Expr::Unary { operand: inner, .. }
+        | Expr::Get { object: inner, .. }
+        | Expr::Grouping { expr: inner, .. }
+        | Expr::Spread { expr: inner, .. }
+        | Expr::Input { prompt: inner, .. }
+        | Expr::Lambda { body: inner, .. } => f(inner),
+        Expr::Call {
+            callee, arguments, ..
+        } => {
+            f(callee);
+            arguments.iter().for_each(f);
+        }
+        Expr::Set { object, value, .. } => {
+            f(object);
+            f(value);
+        }
+        Expr::IndexSet {
+            object,
+            index,
+            value,
+            ..
+        } => {
+            f(object);
+            f(index);
+            f(value);
+        }
+        Expr::Slice {
+            object,
+            start,
+            end,
+            step,
+            ..
+        } => {
+            f(object);
+            [start, end, step].into_iter().flatten().for_each(|e| f(e));
+        }
+        Expr::List { elements, .. } => elements.iter().for_each(f),
+        Expr::Dict { pairs, .. } => {
+            for (key, value) in pairs {
+                f(key);
+                f(value);
+            }
+        }
+        Expr::FString { parts, .. } => {
+            for part in parts {
+                if let FStringPart::Expr(expr) = part {
+                    f(expr);
+                }
+            }
+        }
+        Expr::Ternary {
+            condition,
+            then_expr,
+            else_expr,
+            ..
+        } => {
+            f(condition);
+            f(then_expr);
+            f(else_expr);
+        }
+    }
+}
+
+/// A function or lambda whose calls can be replaced by its body
+struct Inline {
+    params: Vec<String>,
+    /// Literal defaults, for calls that leave parameters out
+    defaults: Vec<Option<Expr>>,
+    body: Expr,
+}
+
+fn inline_candidates(program: &Program, names: &Names) -> HashMap<String, Inline> {
+    // A name defined only at the top level means the same function from every call site
+    let top_level: HashSet<&str> = program
+        .statements
+        .iter()
+        .filter_map(|stmt| match stmt {
+            Stmt::Function { name, .. } if names.defined.get(name) == Some(&1) => {
+                Some(name.as_str())
+            }
+            _ => None,
+        })
+        .collect();
+    let mut inlines = HashMap::new();
+    for stmt in &program.statements {
+        let (name, params, defaults, body) = match stmt {
+            Stmt::Function {
+                name, params, body, ..
+            } if names.defined.get(name) == Some(&1) && !names.bound.contains_key(name) => {
+                let [Stmt::Return {
+                    value: Some(body), ..
+                }] = body.as_slice()
+                else {
+                    continue;
+                };
+                let defaults = params.iter().map(|p| p.default.clone()).collect();
+                let params = params.iter().map(|p| p.name.clone()).collect();
+                (name, params, defaults, body)
+            }
+            Stmt::VarDecl {
+                name,
+                initializer: Some(Expr::Lambda { params, body, .. }),
+                ..
+            } if names.bound.get(name) == Some(&1) && !names.defined.contains_key(name) => (
+                name,
+                params.clone(),
+                vec![None; params.len()],
+                body.as_ref(),
+            ),
+            _ => continue,
+        };
+        let unique: HashSet<&String> = params.iter().collect();
+        let literal_defaults = defaults
+            .iter()
+            .all(|d| matches!(d, None | Some(Expr::Literal { .. })));
+        if unique.len() == params.len()
+            && !unique.contains(name)
+            && literal_defaults
+            && size(body) <= INLINE_BUDGET
+            && inlinable(body, name, &params, names, &top_level)
+        {
+            let body = body.clone();
+            inlines.insert(
+                name.clone(),
+                Inline {
+                    params,
+                    defaults,
+                    body,
+                },
+            );
+        }
+    }
+    inlines
+}
+
+fn size(expr: &Expr) -> usize {
+    let mut n = 1;
+    each_child(expr, |child| n += size(child));
+    n
+}
+
+/// Whether `body` reads only `params`, builtins and top-level functions other than
+/// `name`, and neither binds nor captures anything
+fn inlinable(
+    body: &Expr,
+    name: &str,
+    params: &[String],
+    names: &Names,
+    top_level: &HashSet<&str>,
+) -> bool {
+    let ok = match body {
+        Expr::Variable { name: var, .. } => {
+            params.contains(var)
+                || (var != name
+                    && !names.bound.contains_key(var)
+                    && (!names.defined.contains_key(var) || top_level.contains(var.as_str())))
+        }
+        Expr::Call { callee, .. } => !matches!(callee.as_ref(), Expr::Spread { .. }),
+        Expr::Assign { .. }
+        | Expr::Set { .. }
+        | Expr::IndexSet { .. }
+        | Expr::Lambda { .. }
+        | Expr::BlockExpr { .. }
+        | Expr::Masel { .. }
+        | Expr::Input { .. }
+        | Expr::Spread { .. } => false,
+        _ => true,
+    };
+    let mut children = true;
+    each_child(body, |child| {
+        children &= inlinable(child, name, params, names, top_level)
+    });
+    ok && children
+}
+
+/// What evaluating an inlined body does, in order
+#[derive(Debug, PartialEq)]
+enum Event {
+    /// Reads parameter `i`; conditional under a short circuit or `gin ... than`
+    Read { param: usize, conditional: bool },
+    /// Runs code that could see or change the program's state
+    Work,
+}
+
+fn events(body: &Expr, params: &[String], conditional: bool, out: &mut Vec<Event>) {
+    match body {
+        Expr::Variable { name, .. } => {
+            if let Some(param) = params.iter().position(|p| p == name) {
+                out.push(Event::Read { param, conditional });
+            }
+        }
+        Expr::Literal { .. } => {}
+        Expr::Grouping { expr, .. } => events(expr, params, conditional, out),
+        Expr::Logical { left, right, .. } => {
+            events(left, params, conditional, out);
+            events(right, params, true, out);
+        }
+        Expr::Ternary {
+            condition,
+            then_expr,
+            else_expr,
+            ..
+        } => {
+            events(condition, params, conditional, out);
+            events(then_expr, params, true, out);
+            events(else_expr, params, true, out);
+        }
+        _ => {
+            each_child(body, |child| events(child, params, conditional, out));
+            out.push(Event::Work);
+        }
+    }
+}
+
+/// Whether `expr` is a literal, or a variable nothing can reassign mid-call
+enum Arg {
+    Literal,
+    Variable,
+    Work,
+}
+
+fn substitute(body: &Expr, params: &[String], args: &[Expr]) -> Expr {
+    if let Expr::Variable { name, .. } = body {
+        if let Some(i) = params.iter().position(|p| p == name) {
+            return args[i].clone();
+        }
+    }
+    map_children(body, |child| substitute(child, params, args))
+}
+
+/// `expr` with `f` applied to each expression directly inside it
+fn map_children(expr: &Expr, mut f: impl FnMut(&Expr) -> Expr) -> Expr {
+    let mut b = |e: &Expr| Box::new(f(e));
+    match expr {
+        Expr::Literal { .. }
+        | Expr::Variable { .. }
+        | Expr::Masel { .. }
+        | Expr::BlockExpr { .. } => expr.clone(),
+        Expr::Assign {
+            name, value, span, ..
+        } => Expr::Assign {
+            name: name.clone(),
+            value: b(value),
+            slot: None,
+            span: *span,
+        },
+        Expr::Binary {
+            left,
+            operator,
+            right,
+            span,
+        } => Expr::Binary {
+            left: b(left),
+            operator: *operator,
+            right: b(right),
+            span: *span,
+        },
+        Expr::Unary {
+            operator,
+            operand,
+            span,
+        } => Expr::Unary {
+            operator: *operator,
+            operand: b(operand),
+            span: *span,
+        },
+        Expr::Logical {
+            left,
+            operator,
+            right,
+            span,
+        } => Expr::Logical {
+            left: b(left),
+            operator: *operator,
+            right: b(right),
+            span: *span,
+        },
+        Expr::Call {
+            callee,
+            arguments,
+            span,
+        } => Expr::Call {
+            callee: b(callee),
+            arguments: arguments.iter().map(|a| *b(a)).collect(),
+            span: *span,
+        },
+        Expr::Get {
+            object,
+            property,
+            span,
+        } => Expr::Get {
+            object: b(object),
+            property: property.clone(),
+            span: *span,
+        },
+        Expr::Set {
+            object,
+            property,
+            value,
+            span,
+        } => Expr::Set {
+            object: b(object),
+            property: property.clone(),
+            value: b(value),
+            span: *span,
+        },
+        Expr::Index {
+            object,
+            index,
+            span,
+        } => Expr::Index {
+            object: b(object),
+            index: b(index),
+            span: *span,
+        },
+        Expr::IndexSet {
+            object,
+            index,
+            value,
+            span,
+        } => Expr::IndexSet {
+            object: b(object),
+            index: b(index),
+            value: b(value),
+            span: *span,
+        },
+        Expr::Slice {
+            object,
+            start,
+            end,
+            step,
+            span,
+        } => Expr::Slice {
+            object: b(object),
+            start: start.as_deref().map(&mut b),
+            end: end.as_deref().map(&mut b),
+            step: step.as_deref().map(&mut b),
+            span: *span,
+        },
+        Expr::List { elements, span } => Expr::List {
+            elements: elements.iter().map(|e| *b(e)).collect(),
+            span: *span,
+        },
+        Expr::Dict { pairs, span } => Expr::Dict {
+            pairs: pairs.iter().map(|(k, v)| (*b(k), *b(v))).collect(),
+            span: *span,
+        },
+        Expr::Range {
+            start,
+            end,
+            inclusive,
+            span,
+        } => Expr::Range {
+            start: b(start),
+            end: b(end),
+            inclusive: *inclusive,
+            span: *span,
+        },
+        Expr::Grouping { expr, span } => Expr::Grouping {
+            expr: b(expr),
+            span: *span,
+        },
+        Expr::Lambda { params, body, span } => Expr::Lambda {
+            params: params.clone(),
+            body: b(body),
+            span: *span,
+        },
+        Expr::Input { prompt, span } => Expr::Input {
+            prompt: b(prompt),
+            span: *span,
+        },
+        Expr::FString { parts, span } => Expr::FString {
+            parts: parts
+                .iter()
+                .map(|part| match part {
+                    FStringPart::Text(text) => FStringPart::Text(text.clone()),
+                    FStringPart::Expr(expr) => FStringPart::Expr(b(expr)),
+                })
+                .collect(),
+            span: *span,
+        },
+        Expr::Spread { expr, span } => Expr::Spread {
+            expr: b(expr),
+            span: *span,
+        },
+        Expr::Pipe { left, right, span } => Expr::Pipe {
+            left: b(left),
+            right: b(right),
+            span: *span,
+        },
+        Expr::Ternary {
+            condition,
+            then_expr,
+            else_expr,
+            span,
+        } => Expr::Ternary {
+            condition: b(condition),
+            then_expr: b(then_expr),
+            else_expr: b(else_expr),
+            span: *span,
+        },
+    }
+}
+
+/// How a literal tests in a condition, where every backend agrees
+fn truth(expr: &Expr) -> Option<bool> {
+    match expr {
+        Expr::Literal {
+            value: Literal::Bool(b),
+            ..
+        } => Some(*b),
+        Expr::Literal {
+            value: Literal::Nil,
+            ..
+        } => Some(false),
+        _ => None,
+    }
+}
+
+fn exact(n: i64) -> Option<i64> {
+    (-EXACT_INT..=EXACT_INT).contains(&n).then_some(n)
+}
+
+fn fold_binary(left: &Literal, op: BinaryOp, right: &Literal) -> Option<Literal> {
+    use BinaryOp::*;
+    let folded = match (left, right) {
+        (Literal::Integer(a), Literal::Integer(b)) => {
+            let (a, b) = (exact(*a)?, exact(*b)?);
+            match op {
+                Add => Literal::Integer(exact(a + b)?),
+                Subtract => Literal::Integer(exact(a - b)?),
+                Multiply => Literal::Integer(exact(a.checked_mul(b)?)?),
+                Equal => Literal::Bool(a == b),
+                NotEqual => Literal::Bool(a != b),
+                Less => Literal::Bool(a < b),
+                LessEqual => Literal::Bool(a <= b),
+                Greater => Literal::Bool(a > b),
+                GreaterEqual => Literal::Bool(a >= b),
+                Divide | Modulo => return None,
+            }
+        }
+        (Literal::Float(a), Literal::Float(b)) => match op {
+            Add => Literal::Float(a + b),
+            Subtract => Literal::Float(a - b),
+            Multiply => Literal::Float(a * b),
+            Equal => Literal::Bool(a == b),
+            NotEqual => Literal::Bool(a != b),
+            Less => Literal::Bool(a < b),
+            LessEqual => Literal::Bool(a <= b),
+            Greater => Literal::Bool(a > b),
+            GreaterEqual => Literal::Bool(a >= b),
+            Divide | Modulo => return None,
+        },
+        (Literal::String(a), Literal::String(b)) => match op {
+            Add => Literal::String(format!("{}{}", a, b)),
+            Equal => Literal::Bool(a == b),
+            NotEqual => Literal::Bool(a != b),
+            _ => return None,
+        },
+        (Literal::Bool(_), Literal::Bool(_)) | (Literal::Nil, Literal::Nil) => match op {
+            Equal => Literal::Bool(left == right),
+            NotEqual => Literal::Bool(left != right),
+            _ => return None,
+        },
+        _ => return None,
+    };
+    match folded {
+        Literal::Float(f) if !f.is_finite() => None,
+        folded => Some(folded),
+    }
+}
+
+fn fold_unary(op: UnaryOp, operand: &Literal) -> Option<Literal> {
+    match (op, operand) {
+        (UnaryOp::Negate, Literal::Integer(n)) => Some(Literal::Integer(-exact(*n)?)),
+        (UnaryOp::Negate, Literal::Float(f)) => Some(Literal::Float(-f)),
+        (UnaryOp::Not, Literal::Bool(b)) => Some(Literal::Bool(!b)),
+        (UnaryOp::Not, Literal::Nil) => Some(Literal::Bool(true)),
+        _ => None,
+    }
+}
+
+/// Whether running `stmt` could declare a name: such statements are kept even when
+/// they can't run
+fn declares(stmt: &Stmt) -> bool {
+    match stmt {
+        Stmt::Block { statements, .. } => statements.iter().any(declares),
+        Stmt::If {
+            then_branch,
+            else_branch,
+            ..
+        } => declares(then_branch) || else_branch.as_deref().is_some_and(declares),
+        Stmt::While { body, .. } => declares(body),
+        Stmt::Expression { .. }
+        | Stmt::Print { .. }
+        | Stmt::Return { .. }
+        | Stmt::Break { .. }
+        | Stmt::Continue { .. }
+        | Stmt::Assert { .. }
+        | Stmt::Log { .. }
+        | Stmt::Hurl { .. } => false,
+        _ => true,
+    }
+}
+
+struct Pass<'a> {
+    names: &'a Names,
+    inlines: &'a HashMap<String, Inline>,
+    /// Locals of the function being rewritten, when no closure can reach them
+    locals: Option<HashSet<String>>,
+    /// Cleared while folding an inlined body, so inlining stops at one level
+    inline: bool,
+}
+
+impl Pass<'_> {
+    fn stmts(&mut self, stmts: &[Stmt]) -> Vec<Stmt> {
+        let mut out = Vec::with_capacity(stmts.len());
+        let mut done = false;
+        for stmt in stmts {
+            if done && !declares(stmt) {
+                continue;
+            }
+            if let Some(stmt) = self.stmt(stmt) {
+                done |= matches!(
+                    stmt,
+                    Stmt::Return { .. }
+                        | Stmt::Break { .. }
+                        | Stmt::Continue { .. }
+                        | Stmt::Hurl { .. }
+                );
+                out.push(stmt);
+            }
+        }
+        out
+    }
+
+    fn boxed(&mut self, stmt: &Stmt) -> Box<Stmt> {
+        let span = stmt_span(stmt);
+        Box::new(self.stmt(stmt).unwrap_or(Stmt::Block {
+            statements: Vec::new(),
+            span,
+        }))
+    }
+
+    fn function(&mut self, params: &[Param], body: &[Stmt]) -> (Vec<Param>, Vec<Stmt>) {
+        let locals = function_locals(params, body);
+        let outer = std::mem::replace(&mut self.locals, locals);
+        let params = params
+            .iter()
+            .map(|p| Param {
+                name: p.name.clone(),
+                default: p.default.as_ref().map(|d| self.expr(d)),
+            })
+            .collect();
+        let body = self.stmts(body);
+        self.locals = outer;
+        (params, body)
+    }
+
+    /// `stmt` optimised, or `None` if it can never run and declares nothing
+    fn stmt(&mut self, stmt: &Stmt) -> Option<Stmt> {
+        Some(match stmt {
+            Stmt::VarDecl {
+                name,
+                initializer,
+                span,
+            } => Stmt::VarDecl {
+                name: name.clone(),
+                initializer: initializer.as_ref().map(|e| self.expr(e)),
+                span: *span,
+            },
+            Stmt::Expression { expr, span } => Stmt::Expression {
+                expr: self.expr(expr),
+                span: *span,
+            },
+            Stmt::Print { value, span } => Stmt::Print {
+                value: self.expr(value),
+                span: *span,
+            },
+            Stmt::Block { statements, span } => Stmt::Block {
+                statements: self.stmts(statements),
+                span: *span,
+            },
+            Stmt::If {
+                condition,
+                then_branch,
+                else_branch,
+                span,
+            } => {
+                let condition = self.expr(condition);
+                match truth(&condition) {
+                    Some(true) if !else_branch.as_deref().is_some_and(declares) => {
+                        return self.stmt(then_branch);
+                    }
+                    Some(false) if !declares(then_branch) => {
+                        return else_branch.as_deref().and_then(|s| self.stmt(s));
+                    }
+                    _ => Stmt::If {
+                        condition,
+                        then_branch: self.boxed(then_branch),
+                        else_branch: else_branch.as_deref().map(|s| self.boxed(s)),
+                        span: *span,
+                    },
+                }
+            }
+            Stmt::While {
+                condition,
+                body,
+                span,
+            } => {
+                let condition = self.expr(condition);
+                if truth(&condition) == Some(false) && !declares(body) {
+                    return None;
+                }
+                Stmt::While {
+                    condition,
+                    body: self.boxed(body),
+                    span: *span,
+                }
+            }
+            Stmt::For {
+                variable,
+                iterable,
+                body,
+                span,
+            } => Stmt::For {
+                variable: variable.clone(),
+                iterable: self.expr(iterable),
+                body: self.boxed(body),
+                span: *span,
+            },
+            Stmt::Function {
+                name,
+                params,
+                body,
+                span,
+            } => {
+                let (params, body) = self.function(params, body);
+                Stmt::Function {
+                    name: name.clone(),
+                    params,
+                    body,
+                    span: *span,
+                }
+            }
+            Stmt::Return { value, span } => Stmt::Return {
+                value: value.as_ref().map(|e| self.expr(e)),
+                span: *span,
+            },
+            Stmt::Class {
+                name,
+                superclass,
+                methods,
+                span,
+            } => Stmt::Class {
+                name: name.clone(),
+                superclass: superclass.clone(),
+                methods: methods.iter().filter_map(|m| self.stmt(m)).collect(),
+                span: *span,
+            },
+            Stmt::TryCatch {
+                try_block,
+                error_name,
+                catch_block,
+                span,
+            } => Stmt::TryCatch {
+                try_block: self.boxed(try_block),
+                error_name: error_name.clone(),
+                catch_block: self.boxed(catch_block),
+                span: *span,
+            },
+            Stmt::Match { value, arms, span } => Stmt::Match {
+                value: self.expr(value),
+                arms: arms
+                    .iter()
+                    .map(|arm| MatchArm {
+                        pattern: match &arm.pattern {
+                            Pattern::Range { start, end } => Pattern::Range {
+                                start: Box::new(self.expr(start)),
+                                end: Box::new(self.expr(end)),
+                            },
+                            pattern => pattern.clone(),
+                        },
+                        body: *self.boxed(&arm.body),
+                        span: arm.span,
+                    })
+                    .collect(),
+                span: *span,
+            },
+            Stmt::Assert {
+                condition,
+                message,
+                span,
+            } => Stmt::Assert {
+                condition: self.expr(condition),
+                message: message.as_ref().map(|e| self.expr(e)),
+                span: *span,
+            },
+            Stmt::Destructure {
+                patterns,
+                value,
+                span,
+            } => Stmt::Destructure {
+                patterns: patterns.clone(),
+                value: self.expr(value),
+                span: *span,
+            },
+            Stmt::Log {
+                level,
+                message,
+                extras,
+                span,
+            } => Stmt::Log {
+                level: *level,
+                message: self.expr(message),
+                extras: extras.iter().map(|e| self.expr(e)).collect(),
+                span: *span,
+            },
+            Stmt::Hurl { message, span } => Stmt::Hurl {
+                message: self.expr(message),
+                span: *span,
+            },
+            Stmt::Struct { .. }
+            | Stmt::Import { .. }
+            | Stmt::Break { .. }
+            | Stmt::Continue { .. } => stmt.clone(),
+        })
+    }
+
+    fn expr(&mut self, expr: &Expr) -> Expr {
+        match expr {
+            Expr::Lambda { params, body, span } => {
+                // A lambda's body runs later, when the caller's locals may have changed
+                let outer = self.locals.take();
+                let body = self.expr(body);
+                self.locals = outer;
+                Expr::Lambda {
+                    params: params.clone(),
+                    body: Box::new(body),
+                    span: *span,
+                }
+            }
+            Expr::BlockExpr { statements, span } => Expr::BlockExpr {
+                statements: self.stmts(statements),
+                span: *span,
+            },
+            _ => {
+                let expr = map_children(expr, |child| self.expr(child));
+                self.fold(expr)
+            }
+        }
+    }
+
+    /// `expr`, whose children are already optimised, folded or inlined
+    fn fold(&mut self, expr: Expr) -> Expr {
+        match expr {
+            Expr::Binary {
+                left,
+                operator,
+                right,
+                span,
+            } => match (left.as_ref(), right.as_ref()) {
+                (Expr::Literal { value: l, .. }, Expr::Literal { value: r, .. }) => {
+                    match fold_binary(l, operator, r) {
+                        Some(value) => Expr::Literal { value, span },
+                        None => Expr::Binary {
+                            left,
+                            operator,
+                            right,
+                            span,
+                        },
+                    }
+                }
+                _ => Expr::Binary {
+                    left,
+                    operator,
+                    right,
+                    span,
+                },
+            },
+            Expr::Unary {
+                operator,
+                operand,
+                span,
+            } => match operand.as_ref() {
+                Expr::Literal { value, .. } => match fold_unary(operator, value) {
+                    Some(value) => Expr::Literal { value, span },
+                    None => Expr::Unary {
+                        operator,
+                        operand,
+                        span,
+                    },
+                },
+                _ => Expr::Unary {
+                    operator,
+                    operand,
+                    span,
+                },
+            },
+            // `an` gives its left side if that's false, else its right; `or` the reverse
+            Expr::Logical {
+                left,
+                operator,
+                right,
+                span,
+            } => match (truth(&left), operator) {
+                (Some(false), LogicalOp::And) | (Some(true), LogicalOp::Or) => *left,
+                (Some(_), _) => *right,
+                (None, _) => Expr::Logical {
+                    left,
+                    operator,
+                    right,
+                    span,
+                },
+            },
+            Expr::Ternary {
+                condition,
+                then_expr,
+                else_expr,
+                span,
+            } => match truth(&condition) {
+                Some(true) => *then_expr,
+                Some(false) => *else_expr,
+                None => Expr::Ternary {
+                    condition,
+                    then_expr,
+                    else_expr,
+                    span,
+                },
+            },
+            Expr::Grouping { expr, span } => match *expr {
+                literal @ Expr::Literal { .. } => literal,
+                expr => Expr::Grouping {
+                    expr: Box::new(expr),
+                    span,
+                },
+            },
+            Expr::Call {
+                callee,
+                arguments,
+                span,
+            } => match self.inlined(&callee, &arguments) {
+                Some(body) => body,
+                None => Expr::Call {
+                    callee,
+                    arguments,
+                    span,
+                },
+            },
+            expr => expr,
+        }
+    }
+
+    /// The body of the function `callee` names with `arguments` in place of its
+    /// parameters, if that reads the same as the call
+    fn inlined(&mut self, callee: &Expr, arguments: &[Expr]) -> Option<Expr> {
+        if !self.inline {
+            return None;
+        }
+        let Expr::Variable { name, .. } = callee else {
+            return None;
+        };
+        let inline = self.inlines.get(name)?;
+        if arguments.len() > inline.params.len() {
+            return None;
+        }
+        let mut args = Vec::with_capacity(inline.params.len());
+        for (i, default) in inline.defaults.iter().enumerate() {
+            args.push(match (arguments.get(i), default) {
+                (Some(argument), _) => argument.clone(),
+                (None, Some(default)) => default.clone(),
+                (None, None) => return None,
+            });
+        }
+
+        let kinds: Vec<Arg> = args.iter().map(|arg| self.arg_kind(arg)).collect();
+        if kinds.iter().any(|k| matches!(k, Arg::Work)) {
+            // None of the work may be skipped, repeated or reordered, and none may
+            // reassign a variable passed alongside it and read later
+            if args.iter().any(binds) {
+                return None;
+            }
+            let mut trace = Vec::new();
+            events(&inline.body, &inline.params, false, &mut trace);
+            let mut next = 0;
+            let mut worked = false;
+            for event in &trace {
+                match *event {
+                    Event::Work => worked = true,
+                    Event::Read { param, conditional } => {
+                        if !matches!(kinds[param], Arg::Work) {
+                            continue;
+                        }
+                        if worked || conditional || param < next {
+                            return None;
+                        }
+                        next = param + 1;
+                    }
+                }
+            }
+            for (i, kind) in kinds.iter().enumerate() {
+                let reads = trace
+                    .iter()
+                    .filter(|e| matches!(e, Event::Read { param, .. } if *param == i))
+                    .count();
+                if matches!(kind, Arg::Work) && reads != 1 {
+                    return None;
+                }
+            }
+        }
+
+        let body = substitute(&inline.body, &inline.params, &args);
+        let outer = std::mem::replace(&mut self.inline, false);
+        let body = self.expr(&body);
+        self.inline = outer;
+        Some(body)
+    }
+
+    fn arg_kind(&self, arg: &Expr) -> Arg {
+        match arg {
+            Expr::Literal { .. } => Arg::Literal,
+            Expr::Variable { name, .. }
+                if self.locals.as_ref().is_some_and(|l| l.contains(name))
+                    || !self.names.reassigned.contains(name) =>
+            {
+                Arg::Variable
+            }
+            _ => Arg::Work,
+        }
+    }
+}
+
+/// Whether evaluating `expr` could rebind a variable
+fn binds(expr: &Expr) -> bool {
+    if matches!(expr, Expr::Assign { .. } | Expr::BlockExpr { .. }) {
+        return true;
+    }
+    let mut found = false;
+    each_child(expr, |child| found |= binds(child));
+    found
+}
+
+/// The names a function binds for itself, if no closure inside it can reach them
+fn function_locals(params: &[Param], body: &[Stmt]) -> Option<HashSet<String>> {
+    let mut locals: HashSet<String> = params.iter().map(|p| p.name.clone()).collect();
+    let mut closures = false;
+    fn walk(stmt: &Stmt, locals: &mut HashSet<String>, closures: &mut bool) {
+        let mut exprs: Vec<&Expr> = Vec::new();
+        match stmt {
+            Stmt::VarDecl {
+                name, initializer, ..
+            } => {
+                locals.insert(name.clone());
+                exprs.extend(initializer);
+            }
+            Stmt::For {
+                variable,
+                iterable,
+                body,
+                ..
+            } => {
+                locals.insert(variable.clone());
+                exprs.push(iterable);
+                walk(body, locals, closures);
+            }
+            Stmt::Destructure {
+                patterns, value, ..
+            } => {
+                for pattern in patterns {
+                    if let DestructPattern::Variable(name) | DestructPattern::Rest(name) = pattern {
+                        locals.insert(name.clone());
+                    }
+                }
+                exprs.push(value);
+            }
+            Stmt::Expression { expr, .. } | Stmt::Print { value: expr, .. } => exprs.push(expr),
+            Stmt::Return { value, .. } => exprs.extend(value),
+            Stmt::Block { statements, .. } => {
+                for stmt in statements {
+                    walk(stmt, locals, closures);
+                }
+            }
+            Stmt::If {
+                condition,
+                then_branch,
+                else_branch,
+                ..
+            } => {
+                exprs.push(condition);
+                walk(then_branch, locals, closures);
+                if let Some(else_branch) = else_branch {
+                    walk(else_branch, locals, closures);
+                }
+            }
+            Stmt::While {
+                condition, body, ..
+            } => {
+                exprs.push(condition);
+                walk(body, locals, closures);
+            }
+            Stmt::TryCatch {
+                try_block,
+                catch_block,
+                ..
+            } => {
+                walk(try_block, locals, closures);
+                walk(catch_block, locals, closures);
+            }
+            Stmt::Match { value, arms, .. } => {
+                exprs.push(value);
+                for arm in arms {
+                    walk(&arm.body, locals, closures);
+                }
+            }
+            Stmt::Function { .. } | Stmt::Class { .. } => *closures = true,
+            _ => {}
+        }
+        for expr in exprs {
+            *closures |= captures(expr);
+        }
+    }
+    for stmt in body {
+        walk(stmt, &mut locals, &mut closures);
+    }
+    (!closures).then_some(locals)
+}
+
+/// Whether `expr` makes a closure or runs statements of its own
+fn captures(expr: &Expr) -> bool {
+    if matches!(expr, Expr::Lambda { .. } | Expr::BlockExpr { .. }) {
+        return true;
+    }
+    let mut found = false;
+    each_child(expr, |child| found |= captures(child));
+    found
+}
+
+fn stmt_span(stmt: &Stmt) -> Span {
+    match stmt {
+        Stmt::VarDecl { span, .. }
+        | Stmt::Expression { span, .. }
+        | Stmt::Block { span, .. }
+        | Stmt::If { span, .. }
+        | Stmt::While { span, .. }
+        | Stmt::For { span, .. }
+        | Stmt::Function { span, .. }
+        | Stmt::Return { span, .. }
+        | Stmt::Print { span, .. }
+        | Stmt::Break { span }
+        | Stmt::Continue { span }
+        | Stmt::Class { span, .. }
+        | Stmt::Struct { span, .. }
+        | Stmt::Import { span, .. }
+        | Stmt::TryCatch { span, .. }
+        | Stmt::Match { span, .. }
+        | Stmt::Assert { span, .. }
+        | Stmt::Destructure { span, .. }
+        | Stmt::Log { span, .. }
+        | Stmt::Hurl { span, .. } => *span,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::interpreter::Interpreter;
+
+    fn optimised(source: &str) -> Vec<Stmt> {
+        optimise(&crate::parser::parse(source).expect("parse")).statements
+    }
+
+    /// The value each `blether` statement prints, as an expression
+    fn printed(source: &str) -> Vec<Expr> {
+        optimised(source)
+            .into_iter()
+            .filter_map(|stmt| match stmt {
+                Stmt::Print { value, .. } => Some(value),
+                _ => None,
+            })
+            .collect()
+    }
+
+    fn literal(expr: &Expr) -> Option<&Literal> {
+        match expr {
+            Expr::Literal { value, .. } => Some(value),
+            _ => None,
+        }
+    }
+
+    fn output(program: &Program) -> Vec<String> {
+        let mut interpreter = Interpreter::new();
+        interpreter.interpret(program).expect("run");
+        interpreter.get_output().to_vec()
+    }
+
+    #[test]
+    fn test_constants_fold() {
+        let values = printed(
+            "blether 2 + 3 * 4\nblether \"a\" + \"b\"\nblether -(1 + 1)\nblether 1.5 * 2.0\n\
+             blether 3 < 4\nblether nae aye\nblether aye an 5\nblether naething or \"x\"\n\
+             blether gin aye than 1 ither 2",
+        );
+        let folded: Vec<Option<&Literal>> = values.iter().map(literal).collect();
+        assert_eq!(
+            folded,
+            [
+                Some(&Literal::Integer(14)),
+                Some(&Literal::String("ab".to_string())),
+                Some(&Literal::Integer(-2)),
+                Some(&Literal::Float(3.0)),
+                Some(&Literal::Bool(true)),
+                Some(&Literal::Bool(false)),
+                Some(&Literal::Integer(5)),
+                Some(&Literal::String("x".to_string())),
+                Some(&Literal::Integer(1)),
+            ]
+        );
+    }
+
+    #[test]
+    fn test_folds_that_could_change_a_result_are_left() {
+        for source in [
+            "blether 7 / 2",
+            "blether 7 % 0",
+            "blether 9007199254740992 + 1",
+            "blether 1 + 2.0",
+            "blether \"a\" < \"b\"",
+            "blether 0 an x",
+        ] {
+            assert!(literal(&printed(source)[0]).is_none(), "{}", source);
+        }
+    }
+
+    #[test]
+    fn test_dead_branches_go_unless_they_declare() {
+        let stmts = optimised(
+            "gin nae {\n blether 1\n} ither {\n blether 2\n}\nwhiles nae {\n blether 3\n}\n\
+             gin nae {\n ken y = 1\n}",
+        );
+        assert_eq!(stmts.len(), 2);
+        assert!(matches!(&stmts[0], Stmt::Block { statements, .. } if statements.len() == 1));
+        assert!(matches!(&stmts[1], Stmt::If { .. }));
+
+        let stmts = optimised("dae f() {\n gie 1\n blether 2\n}");
+        let Stmt::Function { body, .. } = &stmts[0] else {
+            panic!("no function");
+        };
+        assert_eq!(body.len(), 1);
+    }
+
+    #[test]
+    fn test_wee_functions_are_inlined() {
+        let values = printed(
+            "dae pair(a, b) {\n gie [a, b]\n}\ndae fst(p) {\n gie p[0]\n}\n\
+             dae twice(x) {\n gie x + x\n}\nken halve = |x| x / 2\n\
+             ken xs = [1, 2]\nblether fst(xs)\nblether twice(21)\nblether fst(pair(1, 2))\n\
+             blether halve(xs[1])",
+        );
+        assert!(matches!(&values[0], Expr::Index { .. }));
+        assert_eq!(literal(&values[1]), Some(&Literal::Integer(42)));
+        assert!(matches!(&values[2], Expr::Index { object, .. }
+            if matches!(object.as_ref(), Expr::List { .. })));
+        assert!(matches!(&values[3], Expr::Binary { .. }));
+    }
+
+    #[test]
+    fn test_calls_that_would_read_differently_stay_calls() {
+        for source in [
+            // Work passed to a parameter read twice, or out of order
+            "dae twice(x) {\n gie x + x\n}\nblether twice(len(\"ab\"))",
+            "dae sub(a, b) {\n gie b - a\n}\nblether sub(len(\"a\"), len(\"ab\"))",
+            // Work that might never run
+            "dae either(a, b) {\n gie a or b\n}\nblether either(aye, len(\"a\"))",
+            // Recursive, rebound, or reading a variable
+            "dae f(n) {\n gie f(n)\n}\nblether f(1)",
+            "dae f(n) {\n gie n\n}\nf = 3\nblether f(1)",
+            "ken k = 2\ndae f(n) {\n gie n * k\n}\nblether f(1)",
+            // A global a function reassigns, read after the body has done some work
+            "ken g = 1\ndae bump() {\n g = g + 1\n gie 0\n}\n\
+             dae f(a) {\n gie len(\"x\") + a\n}\nblether f(g)",
+        ] {
+            assert!(
+                matches!(printed(source).last(), Some(Expr::Call { .. })),
+                "{}",
+                source
+            );
+        }
+    }
+
+    #[test]
+    fn test_optimised_programs_print_the_same() {
+        let source = "dae pair(a, b) {\n gie [a, b]\n}\ndae snd(p) {\n gie p[1]\n}\n\
+                      dae is_even(n) {\n gie n % 2 == 0\n}\nken double = |x| x * 2\n\
+                      ken total = 0\nfer i in 0..10 {\n gin is_even(i) {\n total = total + double(i)\n }\n}\n\
+                      blether total\nblether snd(pair(\"a\", \"b\" + \"c\"))\n\
+                      gin 1 + 1 == 2 {\n blether \"aye\"\n} ither {\n blether \"nae\"\n}";
+        let program = crate::parser::parse(source).expect("parse");
+        assert_eq!(output(&optimise(&program)), output(&program));
+    }
+
+    #[test]
+    fn test_optimised_programs_come_back_resolved() {
+        let source = "dae twice(x) {
+ gie len(x) * 2
+}
+ken n = 0
+                      gin aye {
+ ken s = \"abc\"
+ n = twice(s)
+}
+blether n";
+        let program = optimise(&crate::parser::parse(source).expect("parse"));
+        let mut again = program.clone();
+        crate::resolve::resolve(&mut again);
+        assert_eq!(format!("{:?}", again), format!("{:?}", program));
+        assert_eq!(output(&program), vec!["6"]);
+    }
+}
@@ -0,0 +1,529 @@
+//! `pack`/`unpack`: values as MessagePack bytes, the same layout the native runtime
+//! writes, so either side can read what the other packed.
+//!
+//! Ints take the smallest int form and floats are always float 64, so the two never
+//! swap. Strings are str, bytes are bin, and a creel is ext type [`EXT_CREEL`] holding an
+//! array of its items. Functions, instances and native objects can't be packed.
+
+use std::cell::RefCell;
+use std::rc::Rc;
+
+use crate::error::HaversResult;
+use crate::value::{DictValue, NativeObject, SetValue, Value};
+
+/// The ext type a creel is packed as
+pub const EXT_CREEL: u8 = 1;
+
+/// How deep values may nest, so a list that holds itself is an error, not a crash
+const MAX_DEPTH: usize = 512;
+
+/// Heads for a length-prefixed kind: fix form (base, largest), then 8-, 16- and 32-bit
+struct Heads {
+    fix: Option<(u8, usize)>,
+    b8: Option<u8>,
+    b16: u8,
+    b32: u8,
+}
+
+const STR: Heads = Heads {
+    fix: Some((0xa0, 31)),
+    b8: Some(0xd9),
+    b16: 0xda,
+    b32: 0xdb,
+};
+const BIN: Heads = Heads {
+    fix: None,
+    b8: Some(0xc4),
+    b16: 0xc5,
+    b32: 0xc6,
+};
+const ARRAY: Heads = Heads {
+    fix: Some((0x90, 15)),
+    b8: None,
+    b16: 0xdc,
+    b32: 0xdd,
+};
+const MAP: Heads = Heads {
+    fix: Some((0x80, 15)),
+    b8: None,
+    b16: 0xde,
+    b32: 0xdf,
+};
+const EXT: Heads = Heads {
+    fix: None,
+    b8: Some(0xc7),
+    b16: 0xc8,
+    b32: 0xc9,
+};
+
+fn write_head(out: &mut Vec<u8>, heads: &Heads, n: usize) -> Result<(), String> {
+    match heads.fix {
+        Some((base, max)) if n <= max => out.push(base | n as u8),
+        _ => match heads.b8 {
+            Some(b8) if n <= 0xff => out.extend_from_slice(&[b8, n as u8]),
+            _ if n <= 0xffff => {
+                out.push(heads.b16);
+                out.extend_from_slice(&(n as u16).to_be_bytes());
+            }
+            _ => {
+                let n = u32::try_from(n)
+                    .map_err(|_| "pack: a string, bytes or collection is ower 4 GiB")?;
+                out.push(heads.b32);
+                out.extend_from_slice(&n.to_be_bytes());
+            }
+        },
+    }
+    Ok(())
+}
+
+fn write_int(out: &mut Vec<u8>, n: i64) {
+    match n {
+        0..=127 | -32..=-1 => out.push(n as u8),
+        0..=0xff => out.extend_from_slice(&[0xcc, n as u8]),
+        0..=0xffff => {
+            out.push(0xcd);
+            out.extend_from_slice(&(n as u16).to_be_bytes());
+        }
+        0..=0xffff_ffff => {
+            out.push(0xce);
+            out.extend_from_slice(&(n as u32).to_be_bytes());
+        }
+        0.. => {
+            out.push(0xcf);
+            out.extend_from_slice(&(n as u64).to_be_bytes());
+        }
+        -128.. => out.extend_from_slice(&[0xd0, n as u8]),
+        -32768.. => {
+            out.push(0xd1);
+            out.extend_from_slice(&(n as i16).to_be_bytes());
+        }
+        -2_147_483_648.. => {
+            out.push(0xd2);
+            out.extend_from_slice(&(n as i32).to_be_bytes());
+        }
+        _ => {
+            out.push(0xd3);
+            out.extend_from_slice(&n.to_be_bytes());
+        }
+    }
+}
+
+/// Append value to out
+pub fn pack(value: &Value, out: &mut Vec<u8>) -> Result<(), String> {
+    pack_at(value, out, 0)
+}
+
+fn pack_at(value: &Value, out: &mut Vec<u8>, depth: usize) -> Result<(), String> {
+    if depth > MAX_DEPTH {
+        return Err("pack: value is nested ower deep (does it hold itsel'?)".to_string());
+    }
+    match value {
+        Value::Nil => out.push(0xc0),
+        Value::Bool(b) => out.push(if *b { 0xc3 } else { 0xc2 }),
+        Value::Integer(n) => write_int(out, *n),
+        Value::Float(f) => {
+            out.push(0xcb);
+            out.extend_from_slice(&f.to_bits().to_be_bytes());
+        }
+        Value::String(s) => {
+            write_head(out, &STR, s.len())?;
+            out.extend_from_slice(s.as_bytes());
+        }
+        Value::Bytes(b) => {
+            let b = b.borrow();
+            write_head(out, &BIN, b.len())?;
+            out.extend_from_slice(&b);
+        }
+        Value::List(items) => {
+            let items = items.borrow();
+            write_head(out, &ARRAY, items.len())?;
+            for item in items.iter() {
+                pack_at(item, out, depth + 1)?;
+            }
+        }
+        Value::Dict(dict) => {
+            let dict = dict.borrow();
+            write_head(out, &MAP, dict.len())?;
+            for (k, v) in dict.iter() {
+                pack_at(k, out, depth + 1)?;
+                pack_at(v, out, depth + 1)?;
+            }
+        }
+        Value::Set(set) => {
+            let set = set.borrow();
+            let mut payload = Vec::new();
+            write_head(&mut payload, &ARRAY, set.len())?;
+            for item in set.iter() {
+                pack_at(item, &mut payload, depth + 1)?;
+            }
+            write_head(out, &EXT, payload.len())?;
+            out.push(EXT_CREEL);
+            out.extend_from_slice(&payload);
+        }
+        other => return Err(format!("pack: cannae pack a {}", other.type_name())),
+    }
+    Ok(())
+}
+
+/// Why decoding stopped
+#[derive(Debug, PartialEq)]
+pub enum UnpackError {
+    /// The input ends partway through a value
+    Short,
+    /// The input isn't MessagePack this side can read
+    Bad(String),
+}
+
+impl UnpackError {
+    pub fn message(self) -> String {
+        match self {
+            UnpackError::Short => "unpack: input is cut short".to_string(),
+            UnpackError::Bad(msg) => msg,
+        }
+    }
+}
+
+struct Reader<'a> {
+    buf: &'a [u8],
+    pos: usize,
+}
+
+impl<'a> Reader<'a> {
+    fn take(&mut self, n: usize) -> Result<&'a [u8], UnpackError> {
+        if self.buf.len() - self.pos < n {
+            return Err(UnpackError::Short);
+        }
+        self.pos += n;
+        Ok(&self.buf[self.pos - n..self.pos])
+    }
+
+    fn be(&mut self, width: usize) -> Result<u64, UnpackError> {
+        Ok(self
+            .take(width)?
+            .iter()
+            .fold(0u64, |v, &b| (v << 8) | b as u64))
+    }
+
+    fn value(&mut self, depth: usize) -> Result<Value, UnpackError> {
+        let b = self.take(1)?[0];
+        match b {
+            0x00..=0x7f | 0xe0..=0xff => Ok(Value::Integer(b as i8 as i64)),
+            0x80..=0x8f => self.map((b & 0x0f) as usize, depth),
+            0x90..=0x9f => self.array((b & 0x0f) as usize, depth),
+            0xa0..=0xbf => self.string((b & 0x1f) as usize),
+            0xc0 => Ok(Value::Nil),
+            0xc2 => Ok(Value::Bool(false)),
+            0xc3 => Ok(Value::Bool(true)),
+            0xc4..=0xc6 => {
+                let n = self.be(len_width(b))? as usize;
+                Ok(Value::Bytes(Rc::new(RefCell::new(self.take(n)?.to_vec()))))
+            }
+            0xc7..=0xc9 => {
+                let n = self.be(len_width(b))? as usize;
+                self.ext(n, depth)
+            }
+            0xca => Ok(Value::Float(f32::from_bits(self.be(4)? as u32) as f64)),
+            0xcb => Ok(Value::Float(f64::from_bits(self.be(8)?))),
+            0xcc..=0xcf => {
+                let raw = self.be(1 << (b & 3))?;
+                i64::try_from(raw)
+                    .map(Value::Integer)
+                    .map_err(|_| bad("unpack: unsigned int ower big fer an int"))
+            }
+            0xd0..=0xd3 => {
+                let width = 1usize << (b & 3);
+                let shift = 64 - 8 * width;
+                Ok(Value::Integer(((self.be(width)? << shift) as i64) >> shift))
+            }
+            0xd4..=0xd8 => self.ext(1 << (b - 0xd4), depth),
+            0xd9..=0xdb => {
+                let n = self.be(len_width(b))? as usize;
+                self.string(n)
+            }
+            0xdc | 0xdd => {
+                let n = self.be(len_width(b))? as usize;
+                self.array(n, depth)
+            }
+            0xde | 0xdf => {
+                let n = self.be(len_width(b))? as usize;
+                self.map(n, depth)
+            }
+            _ => Err(bad("unpack: not a MessagePack value")),
+        }
+    }
+
+    /// Check a count against the bytes left: every item is at least one byte.
+    fn room(&self, items: usize, depth: usize) -> Result<(), UnpackError> {
+        if depth >= MAX_DEPTH {
+            return Err(bad("unpack: nested ower deep"));
+        }
+        if items > self.buf.len() - self.pos {
+            return Err(UnpackError::Short);
+        }
+        Ok(())
+    }
+
+    fn array(&mut self, n: usize, depth: usize) -> Result<Value, UnpackError> {
+        self.room(n, depth)?;
+        let mut items = Vec::with_capacity(n);
+        for _ in 0..n {
+            items.push(self.value(depth + 1)?);
+        }
+        Ok(Value::List(Rc::new(RefCell::new(items))))
+    }
+
+    fn map(&mut self, n: usize, depth: usize) -> Result<Value, UnpackError> {
+        self.room(n.saturating_mul(2), depth)?;
+        let mut dict = DictValue::with_capacity(n);
+        for _ in 0..n {
+            let key = self.value(depth + 1)?;
+            let value = self.value(depth + 1)?;
+            dict.set(key, value);
+        }
+        Ok(Value::Dict(Rc::new(RefCell::new(dict))))
+    }
+
+    fn string(&mut self, n: usize) -> Result<Value, UnpackError> {
+        let text = String::from_utf8_lossy(self.take(n)?).into_owned();
+        Ok(Value::String(text.into()))
+    }
+
+    fn ext(&mut self, n: usize, depth: usize) -> Result<Value, UnpackError> {
+        let kind = self.take(1)?[0];
+        let payload = self.take(n)?;
+        if kind != EXT_CREEL {
+            return Err(bad("unpack: unknown ext type"));
+        }
+        let mut inner = Reader {
+            buf: payload,
+            pos: 0,
+        };
+        let bad_creel = |_| bad("unpack: bad creel");
+        let items = match inner.value(depth).map_err(bad_creel)? {
+            Value::List(items) if inner.pos == payload.len() => items,
+            _ => return Err(bad("unpack: a creel must hold an array")),
+        };
+        let mut set = SetValue::new();
+        for item in items.borrow().iter() {
+            set.insert(item.clone());
+        }
+        Ok(Value::Set(Rc::new(RefCell::new(set))))
+    }
+}
+
+fn bad(msg: &str) -> UnpackError {
+    UnpackError::Bad(msg.to_string())
+}
+
+fn len_width(b: u8) -> usize {
+    match b {
+        0xc4 | 0xc7 | 0xd9 => 1,
+        0xc5 | 0xc8 | 0xda | 0xdc | 0xde => 2,
+        _ => 4,
+    }
+}
+
+/// Decode the one value that fills buf
+pub fn unpack(buf: &[u8]) -> Result<Value, String> {
+    let mut reader = Reader { buf, pos: 0 };
+    let value = reader.value(0).map_err(UnpackError::message)?;
+    if reader.pos != buf.len() {
+        return Err("unpack: bytes left ower efter the value".to_string());
+    }
+    Ok(value)
+}
+
+/// Values fed in chunks, handed out whole. Finding where one ends needs no decoding:
+/// every head adds its items to a count of values still owed, so each scan picks up
+/// where the last one stopped.
+#[derive(Debug, Default)]
+pub struct UnpackStream {
+    buf: Vec<u8>,
+    start: usize,
+    scan: usize,
+    owed: u64,
+}
+
+impl UnpackStream {
+    pub fn feed(&mut self, chunk: &[u8]) {
+        if self.start > 0 && self.start * 2 >= self.buf.len() {
+            self.buf.drain(..self.start);
+            self.scan -= self.start;
+            self.start = 0;
+        }
+        self.buf.extend_from_slice(chunk);
+    }
+
+    /// The next whole value, or None until more has been fed
+    pub fn next_value(&mut self) -> Result<Option<Value>, String> {
+        if !self.scan_value()? {
+            return Ok(None);
+        }
+        let record = &self.buf[self.start..self.scan];
+        self.start = self.scan;
+        unpack(record).map(Some)
+    }
+
+    fn scan_value(&mut self) -> Result<bool, String> {
+        if self.owed == 0 {
+            self.owed = 1;
+        }
+        while self.owed > 0 {
+            let rest = &self.buf[self.scan..];
+            let Some(&b) = rest.first() else {
+                return Ok(false);
+            };
+            let (mut head, mut payload, mut items) = (1u64, 0u64, 0u64);
+            match b {
+                0x00..=0x7f | 0xe0..=0xff | 0xc0 | 0xc2 | 0xc3 => {}
+                0x80..=0x8f => items = (b & 0x0f) as u64 * 2,
+                0x90..=0x9f => items = (b & 0x0f) as u64,
+                0xa0..=0xbf => payload = (b & 0x1f) as u64,
+                0xca => payload = 4,
+                0xcb => payload = 8,
+                0xcc..=0xd3 => payload = 1 << (b & 3),
+                0xd4..=0xd8 => payload = (1 << (b - 0xd4)) + 1,
+                0xc4..=0xc9 | 0xd9..=0xdf => {
+                    let width = len_width(b);
+                    if rest.len() < 1 + width {
+                        return Ok(false);
+                    }
+                    let n = rest[1..1 + width]
+                        .iter()
+                        .fold(0u64, |v, &x| (v << 8) | x as u64);
+                    head += width as u64;
+                    match b {
+                        0xdc | 0xdd => items = n,
+                        0xde | 0xdf => items = n * 2,
+                        0xc7..=0xc9 => payload = n + 1,
+                        _ => payload = n,
+                    }
+                }
+                _ => {
+                    // No way to find the next boundary: drop the lot
+                    *self = UnpackStream::default();
+                    return Err("unpack_stream_next: not a MessagePack value".to_string());
+                }
+            }
+            if (rest.len() as u64) < head + payload {
+                return Ok(false);
+            }
+            self.scan += (head + payload) as usize;
+            self.owed = self.owed + items - 1;
+        }
+        Ok(true)
+    }
+}
+
+/// An UnpackStream as a value, from unpack_stream_new()
+#[derive(Debug, Default)]
+pub struct UnpackStreamHandle {
+    pub stream: RefCell<UnpackStream>,
+}
+
+impl NativeObject for UnpackStreamHandle {
+    fn type_name(&self) -> &str {
+        "unpack_stream"
+    }
+
+    fn get(&self, _prop: &str) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
+
+    fn set(&self, _prop: &str, _value: Value) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
+
+    fn call(&self, _method: &str, _args: Vec<Value>) -> HaversResult<Value> {
+        Ok(Value::Nil)
+    }
+
+    fn as_any(&self) -> &dyn std::any::Any {
+        self
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn packed(value: &Value) -> Vec<u8> {
+        let mut out = Vec::new();
+        pack(value, &mut out).unwrap();
+        out
+    }
+
+    #[test]
+    fn pack_writes_messagepack_and_round_trips() {
+        let mut dict = DictValue::new();
+        dict.set(Value::String("a".into()), Value::Integer(1));
+        dict.set(Value::Integer(7), Value::Float(2.0));
+        let dict = Value::Dict(Rc::new(RefCell::new(dict)));
+        assert_eq!(
+            packed(&dict),
+            [0x82, 0xa1, b'a', 0x01, 0x07, 0xcb, 0x40, 0, 0, 0, 0, 0, 0, 0]
+        );
+
+        for n in [
+            0,
+            127,
+            128,
+            255,
+            256,
+            65536,
+            -1,
+            -32,
+            -33,
+            -129,
+            -40000,
+            i64::MIN,
+            i64::MAX,
+        ] {
+            let back = unpack(&packed(&Value::Integer(n))).unwrap();
+            assert!(matches!(back, Value::Integer(m) if m == n), "{}", n);
+        }
+        assert_eq!(packed(&Value::Integer(-200)), [0xd1, 0xff, 0x38]);
+
+        let mut set = SetValue::new();
+        set.insert(Value::String("x".into()));
+        let set = Value::Set(Rc::new(RefCell::new(set)));
+        assert_eq!(packed(&set), [0xc7, 0x03, EXT_CREEL, 0x91, 0xa1, b'x']);
+        assert!(matches!(unpack(&packed(&set)).unwrap(), Value::Set(s) if s.borrow().len() == 1));
+
+        let bytes = Value::Bytes(Rc::new(RefCell::new(vec![0, 1, 2])));
+        assert_eq!(packed(&bytes), [0xc4, 0x03, 0, 1, 2]);
+        assert!(pack(
+            &Value::Range(crate::value::RangeValue::new(0, 1, false)),
+            &mut Vec::new()
+        )
+        .is_err());
+        assert_eq!(
+            unpack(&[0x92, 0x01]).unwrap_err(),
+            "unpack: input is cut short"
+        );
+        assert!(unpack(&[0x01, 0x02]).is_err());
+        assert!(unpack(&[0xc1]).is_err());
+    }
+
+    #[test]
+    fn unpack_stream_hands_out_values_fed_a_byte_at_a_time() {
+        let list = Value::List(Rc::new(RefCell::new(vec![
+            Value::String("hullo".into()),
+            Value::Bytes(Rc::new(RefCell::new(vec![9; 300]))),
+            Value::Nil,
+        ])));
+        let mut all = packed(&list);
+        all.extend(packed(&Value::Integer(42)));
+        all.extend(packed(&list));
+
+        let mut stream = UnpackStream::default();
+        let mut got = Vec::new();
+        for b in all {
+            stream.feed(&[b]);
+            while let Some(value) = stream.next_value().unwrap() {
+                got.push(value.type_name());
+            }
+        }
+        assert_eq!(got, ["list", "integer", "list"]);
+    }
+}
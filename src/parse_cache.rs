@@ -0,0 +1,158 @@
+//! On-disk cache of parsed modules, so a warm `fetch` skips the lexer and parser.
+//!
+//! Each entry is the module's [`Program`] as JSON, in a `.brawc` file named after a hash of
+//! the source text and the crate version. A changed source or a new build of mdhavers simply
+//! misses; nothing is ever invalidated in place. Entries live under `$MDH_CACHE_DIR` if set,
+//! otherwise `$XDG_CACHE_HOME/mdhavers` or `~/.cache/mdhavers`. Setting `MDH_NO_CACHE`
+//! turns the cache off.
+//!
+//! The cache is best effort: an unreadable, unwritable or undecodable entry just means the
+//! source gets parsed as usual.
+
+use std::fs;
+use std::path::{Path, PathBuf};
+
+use serde::{Deserialize, Serialize};
+
+use crate::ast::Program;
+use crate::error::HaversResult;
+
+const EXTENSION: &str = "brawc";
+
+/// Bumped whenever what the parser hands back changes within a crate version (format 2
+/// carries resolved variable slots), so older entries miss instead of loading untagged.
+const FORMAT: u8 = 2;
+
+#[derive(Serialize)]
+struct EntryRef<'a> {
+    version: &'a str,
+    program: &'a Program,
+}
+
+#[derive(Deserialize)]
+struct Entry {
+    version: String,
+    program: Program,
+}
+
+/// Where cache entries go, or None if caching is off or there's naewhere to put them.
+pub fn cache_dir() -> Option<PathBuf> {
+    if std::env::var_os("MDH_NO_CACHE").is_some() {
+        return None;
+    }
+    if let Some(dir) = std::env::var_os("MDH_CACHE_DIR") {
+        return Some(PathBuf::from(dir));
+    }
+    if let Some(dir) = std::env::var_os("XDG_CACHE_HOME").filter(|d| !d.is_empty()) {
+        return Some(PathBuf::from(dir).join("mdhavers"));
+    }
+    std::env::var_os("HOME")
+        .filter(|d| !d.is_empty())
+        .map(|home| PathBuf::from(home).join(".cache").join("mdhavers"))
+}
+
+pub(crate) const HASH_SEED: u64 = 0xcbf2_9ce4_8422_2325;
+
+/// FNV-1a over `bytes`, carrying on from `hash` (start with [`HASH_SEED`]).
+pub(crate) fn hash_bytes(hash: u64, bytes: &[u8]) -> u64 {
+    bytes.iter().fold(hash, |hash, &byte| {
+        (hash ^ byte as u64).wrapping_mul(0x0100_0000_01b3)
+    })
+}
+
+/// A hash of the crate version, the entry format and the source, as 16 hex digits.
+fn source_key(source: &str) -> String {
+    let hash = hash_bytes(HASH_SEED, env!("CARGO_PKG_VERSION").as_bytes());
+    let hash = hash_bytes(hash_bytes(hash, &[0, FORMAT]), source.as_bytes());
+    format!("{:016x}", hash)
+}
+
+fn entry_path(dir: &Path, source: &str) -> PathBuf {
+    dir.join(format!("{}.{}", source_key(source), EXTENSION))
+}
+
+/// Parse `source`, going through the cache in `dir` when there is one.
+pub fn parse_cached_in(dir: Option<&Path>, source: &str) -> HaversResult<Program> {
+    let dir = match dir {
+        Some(dir) => dir,
+        None => return crate::parser::parse(source),
+    };
+    let path = entry_path(dir, source);
+
+    if let Ok(text) = fs::read_to_string(&path) {
+        if let Ok(entry) = serde_json::from_str::<Entry>(&text) {
+            if entry.version == env!("CARGO_PKG_VERSION") {
+                return Ok(entry.program);
+            }
+        }
+    }
+
+    let program = crate::parser::parse(source)?;
+    let entry = EntryRef {
+        version: env!("CARGO_PKG_VERSION"),
+        program: &program,
+    };
+    if let Ok(text) = serde_json::to_string(&entry) {
+        // Write aside and rename so a concurrent run never reads half an entry
+        let tmp = path.with_extension(format!("{}.{}", EXTENSION, std::process::id()));
+        if fs::create_dir_all(dir).is_ok() && fs::write(&tmp, text).is_ok() {
+            if fs::rename(&tmp, &path).is_err() {
+                let _ = fs::remove_file(&tmp);
+            }
+        }
+    }
+    Ok(program)
+}
+
+/// Parse `source` through the default cache directory.
+pub fn parse_cached(source: &str) -> HaversResult<Program> {
+    parse_cached_in(cache_dir().as_deref(), source)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_source_key_depends_on_the_source() {
+        assert_eq!(source_key("ken x = 1"), source_key("ken x = 1"));
+        assert_ne!(source_key("ken x = 1"), source_key("ken x = 2"));
+        assert_eq!(source_key("").len(), 16);
+    }
+
+    #[test]
+    fn test_parse_cached_writes_then_reads_an_entry() {
+        let dir = tempfile::tempdir().unwrap();
+        let source = "dae add(a, b = 2) {\n    gie a + b\n}\nken total = add(1)\n";
+
+        let first = parse_cached_in(Some(dir.path()), source).unwrap();
+        let path = entry_path(dir.path(), source);
+        assert!(path.exists());
+
+        let second = parse_cached_in(Some(dir.path()), source).unwrap();
+        assert_eq!(format!("{:?}", first), format!("{:?}", second));
+        // Slots survive the round trip, so a cached program comes back resolved
+        assert!(format!("{:?}", second).contains("slot: Some("));
+    }
+
+    #[test]
+    fn test_parse_cached_ignores_a_bad_entry() {
+        let dir = tempfile::tempdir().unwrap();
+        let source = "ken x = 1\n";
+        fs::write(entry_path(dir.path(), source), "havers").unwrap();
+
+        let program = parse_cached_in(Some(dir.path()), source).unwrap();
+        assert_eq!(program.statements.len(), 1);
+        // The bad entry is replaced with a good one
+        let text = fs::read_to_string(entry_path(dir.path(), source)).unwrap();
+        assert!(serde_json::from_str::<Entry>(&text).is_ok());
+    }
+
+    #[test]
+    fn test_parse_cached_does_not_cache_parse_errors() {
+        let dir = tempfile::tempdir().unwrap();
+        let source = "ken = \n";
+        assert!(parse_cached_in(Some(dir.path()), source).is_err());
+        assert!(!entry_path(dir.path(), source).exists());
+    }
+}
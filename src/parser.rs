@@ -2,19 +2,37 @@ use crate::ast::{LogLevel, *};
 use crate::error::{HaversError, HaversResult};
 use crate::token::{Token, TokenKind};
 
+mod build;
+
+pub use build::{Boxed, Build};
+
 /// The parser - turns tokens intae an AST
-pub struct Parser {
-    tokens: Vec<Token>,
+///
+/// Nodes are made by the [`Build`] it's given: the boxed tree by default, or an arena
+/// ([`crate::ast::arena::AstBuilder`]).
+pub struct Parser<'src, B: Build = Boxed> {
+    tokens: Vec<Token<'src>>,
     current: usize,
+    build: B,
+}
+
+impl<'src> Parser<'src> {
+    pub fn new(tokens: Vec<Token<'src>>) -> Self {
+        Parser::with_builder(tokens, Boxed)
+    }
 }
 
-impl Parser {
-    pub fn new(tokens: Vec<Token>) -> Self {
-        Parser { tokens, current: 0 }
+impl<'src, B: Build> Parser<'src, B> {
+    pub fn with_builder(tokens: Vec<Token<'src>>, build: B) -> Self {
+        Parser {
+            tokens,
+            current: 0,
+            build,
+        }
     }
 
     /// Parse the tokens intae a program
-    pub fn parse(&mut self) -> HaversResult<Program> {
+    pub fn parse(&mut self) -> HaversResult<B::Output> {
         let mut statements = Vec::new();
 
         self.skip_newlines();
@@ -24,12 +42,12 @@ impl Parser {
             self.skip_newlines();
         }
 
-        Ok(Program::new(statements))
+        Ok(self.build.finish(statements))
     }
 
     // === Declaration parsing ===
 
-    fn declaration(&mut self) -> HaversResult<Stmt> {
+    fn declaration(&mut self) -> HaversResult<B::Stmt> {
         if self.check(&TokenKind::Ken) {
             self.var_declaration()
         } else if self.check(&TokenKind::Dae) {
@@ -45,7 +63,7 @@ impl Parser {
         }
     }
 
-    fn var_declaration(&mut self) -> HaversResult<Stmt> {
+    fn var_declaration(&mut self) -> HaversResult<B::Stmt> {
         let span = self.current_span();
         self.advance(); // consume 'ken'
 
@@ -64,15 +82,11 @@ impl Parser {
 
         self.expect_statement_end()?;
 
-        Ok(Stmt::VarDecl {
-            name,
-            initializer,
-            span,
-        })
+        Ok(self.build.var_decl(name, initializer, span))
     }
 
     /// Parse a destructuring pattern: ken [a, b, ...rest] = list
-    fn destructure_declaration(&mut self, span: Span) -> HaversResult<Stmt> {
+    fn destructure_declaration(&mut self, span: Span) -> HaversResult<B::Stmt> {
         self.expect(&TokenKind::LeftBracket, "[")?;
 
         let mut patterns = Vec::new();
@@ -89,15 +103,15 @@ impl Parser {
                     });
                 }
                 let name = self.expect_identifier("rest variable name")?;
-                patterns.push(DestructPattern::Rest(name));
+                patterns.push(self.build.destruct(DestructPattern::Rest(name)));
                 seen_rest = true;
             } else if self.match_token(&TokenKind::Underscore) {
                 // Ignore pattern: _
-                patterns.push(DestructPattern::Ignore);
+                patterns.push(self.build.destruct(DestructPattern::Ignore));
             } else {
                 // Regular variable
                 let name = self.expect_identifier("variable name")?;
-                patterns.push(DestructPattern::Variable(name));
+                patterns.push(self.build.destruct(DestructPattern::Variable(name)));
             }
 
             if !self.match_token(&TokenKind::Comma) {
@@ -112,14 +126,10 @@ impl Parser {
 
         self.expect_statement_end()?;
 
-        Ok(Stmt::Destructure {
-            patterns,
-            value,
-            span,
-        })
+        Ok(self.build.destructure(patterns, value, span))
     }
 
-    fn function_declaration(&mut self) -> HaversResult<Stmt> {
+    fn function_declaration(&mut self) -> HaversResult<B::Stmt> {
         let span = self.current_span();
         self.advance(); // consume 'dae'
 
@@ -150,10 +160,8 @@ impl Parser {
                     None
                 };
 
-                params.push(Param {
-                    name: param_name,
-                    default,
-                });
+                let param = self.build.param(param_name, default);
+                params.push(param);
 
                 if !self.match_token(&TokenKind::Comma) {
                     break;
@@ -167,15 +175,10 @@ impl Parser {
 
         let body = self.block_statements()?;
 
-        Ok(Stmt::Function {
-            name,
-            params,
-            body,
-            span,
-        })
+        Ok(self.build.function(name, params, body, span))
     }
 
-    fn class_declaration(&mut self) -> HaversResult<Stmt> {
+    fn class_declaration(&mut self) -> HaversResult<B::Stmt> {
         let span = self.current_span();
         self.advance(); // consume 'kin'
 
@@ -206,15 +209,10 @@ impl Parser {
 
         self.expect(&TokenKind::RightBrace, "}")?;
 
-        Ok(Stmt::Class {
-            name,
-            superclass,
-            methods,
-            span,
-        })
+        Ok(self.build.class(name, superclass, methods, span))
     }
 
-    fn struct_declaration(&mut self) -> HaversResult<Stmt> {
+    fn struct_declaration(&mut self) -> HaversResult<B::Stmt> {
         let span = self.current_span();
         self.advance(); // consume 'thing'
 
@@ -234,10 +232,10 @@ impl Parser {
 
         self.expect(&TokenKind::RightBrace, "}")?;
 
-        Ok(Stmt::Struct { name, fields, span })
+        Ok(self.build.struct_decl(name, fields, span))
     }
 
-    fn import_declaration(&mut self) -> HaversResult<Stmt> {
+    fn import_declaration(&mut self) -> HaversResult<B::Stmt> {
         let span = self.current_span();
         self.advance(); // consume 'fetch'
 
@@ -251,12 +249,12 @@ impl Parser {
 
         self.expect_statement_end()?;
 
-        Ok(Stmt::Import { path, alias, span })
+        Ok(self.build.import(path, alias, span))
     }
 
     // === Statement parsing ===
 
-    fn statement(&mut self) -> HaversResult<Stmt> {
+    fn statement(&mut self) -> HaversResult<B::Stmt> {
         if self.check(&TokenKind::Gin) {
             self.if_statement()
         } else if self.check(&TokenKind::Whiles) {
@@ -296,50 +294,43 @@ impl Parser {
         }
     }
 
-    fn if_statement(&mut self) -> HaversResult<Stmt> {
+    fn if_statement(&mut self) -> HaversResult<B::Stmt> {
         let span = self.current_span();
         self.advance(); // consume 'gin'
 
         let condition = self.expression()?;
         self.skip_newlines();
-        let then_branch = Box::new(self.block()?);
+        let then_branch = self.block()?;
 
         let else_branch = if self.match_token(&TokenKind::Ither) {
             self.skip_newlines();
             if self.check(&TokenKind::Gin) {
                 // else if
-                Some(Box::new(self.if_statement()?))
+                Some(self.if_statement()?)
             } else {
-                Some(Box::new(self.block()?))
+                Some(self.block()?)
             }
         } else {
             None
         };
 
-        Ok(Stmt::If {
-            condition,
-            then_branch,
-            else_branch,
-            span,
-        })
+        Ok(self
+            .build
+            .if_stmt(condition, then_branch, else_branch, span))
     }
 
-    fn while_statement(&mut self) -> HaversResult<Stmt> {
+    fn while_statement(&mut self) -> HaversResult<B::Stmt> {
         let span = self.current_span();
         self.advance(); // consume 'whiles'
 
         let condition = self.expression()?;
         self.skip_newlines();
-        let body = Box::new(self.block()?);
+        let body = self.block()?;
 
-        Ok(Stmt::While {
-            condition,
-            body,
-            span,
-        })
+        Ok(self.build.while_stmt(condition, body, span))
     }
 
-    fn for_statement(&mut self) -> HaversResult<Stmt> {
+    fn for_statement(&mut self) -> HaversResult<B::Stmt> {
         let span = self.current_span();
         self.advance(); // consume 'fer'
 
@@ -347,17 +338,12 @@ impl Parser {
         self.expect(&TokenKind::In, "in")?;
         let iterable = self.expression()?;
         self.skip_newlines();
-        let body = Box::new(self.block()?);
+        let body = self.block()?;
 
-        Ok(Stmt::For {
-            variable,
-            iterable,
-            body,
-            span,
-        })
+        Ok(self.build.for_stmt(variable, iterable, body, span))
     }
 
-    fn return_statement(&mut self) -> HaversResult<Stmt> {
+    fn return_statement(&mut self) -> HaversResult<B::Stmt> {
         let span = self.current_span();
         self.advance(); // consume 'gie'
 
@@ -369,56 +355,53 @@ impl Parser {
 
         self.expect_statement_end()?;
 
-        Ok(Stmt::Return { value, span })
+        Ok(self.build.return_stmt(value, span))
     }
 
-    fn print_statement(&mut self) -> HaversResult<Stmt> {
+    fn print_statement(&mut self) -> HaversResult<B::Stmt> {
         let span = self.current_span();
         self.advance(); // consume 'blether'
 
         let value = self.expression()?;
         self.expect_statement_end()?;
 
-        Ok(Stmt::Print { value, span })
+        Ok(self.build.print(value, span))
     }
 
-    fn break_statement(&mut self) -> HaversResult<Stmt> {
+    fn break_statement(&mut self) -> HaversResult<B::Stmt> {
         let span = self.current_span();
         self.advance(); // consume 'brak'
         self.expect_statement_end()?;
-        Ok(Stmt::Break { span })
+        Ok(self.build.break_stmt(span))
     }
 
-    fn continue_statement(&mut self) -> HaversResult<Stmt> {
+    fn continue_statement(&mut self) -> HaversResult<B::Stmt> {
         let span = self.current_span();
         self.advance(); // consume 'haud'
         self.expect_statement_end()?;
-        Ok(Stmt::Continue { span })
+        Ok(self.build.continue_stmt(span))
     }
 
-    fn try_catch_statement(&mut self) -> HaversResult<Stmt> {
+    fn try_catch_statement(&mut self) -> HaversResult<B::Stmt> {
         let span = self.current_span();
         self.advance(); // consume 'hae_a_bash'
 
         self.skip_newlines();
-        let try_block = Box::new(self.block()?);
+        let try_block = self.block()?;
 
         self.skip_newlines();
         self.expect(&TokenKind::GinItGangsWrang, "gin_it_gangs_wrang")?;
 
         let error_name = self.expect_identifier("error variable name")?;
         self.skip_newlines();
-        let catch_block = Box::new(self.block()?);
+        let catch_block = self.block()?;
 
-        Ok(Stmt::TryCatch {
-            try_block,
-            error_name,
-            catch_block,
-            span,
-        })
+        Ok(self
+            .build
+            .try_catch(try_block, error_name, catch_block, span))
     }
 
-    fn match_statement(&mut self) -> HaversResult<Stmt> {
+    fn match_statement(&mut self) -> HaversResult<B::Stmt> {
         let span = self.current_span();
         self.advance(); // consume 'keek'
 
@@ -435,10 +418,10 @@ impl Parser {
 
         self.expect(&TokenKind::RightBrace, "}")?;
 
-        Ok(Stmt::Match { value, arms, span })
+        Ok(self.build.match_stmt(value, arms, span))
     }
 
-    fn assert_statement(&mut self) -> HaversResult<Stmt> {
+    fn assert_statement(&mut self) -> HaversResult<B::Stmt> {
         let span = self.current_span();
         self.advance(); // consume 'mak_siccar'
 
@@ -451,14 +434,10 @@ impl Parser {
             None
         };
 
-        Ok(Stmt::Assert {
-            condition,
-            message,
-            span,
-        })
+        Ok(self.build.assert_stmt(condition, message, span))
     }
 
-    fn log_statement(&mut self, level: LogLevel) -> HaversResult<Stmt> {
+    fn log_statement(&mut self, level: LogLevel) -> HaversResult<B::Stmt> {
         let span = self.current_span();
         self.advance(); // consume 'log_whisper', 'log_mutter', etc.
 
@@ -472,25 +451,20 @@ impl Parser {
         }
         self.expect_statement_end()?;
 
-        Ok(Stmt::Log {
-            level,
-            message,
-            extras,
-            span,
-        })
+        Ok(self.build.log(level, message, extras, span))
     }
 
-    fn hurl_statement(&mut self) -> HaversResult<Stmt> {
+    fn hurl_statement(&mut self) -> HaversResult<B::Stmt> {
         let span = self.current_span();
         self.advance(); // consume 'hurl'
 
         let message = self.expression()?;
         self.expect_statement_end()?;
 
-        Ok(Stmt::Hurl { message, span })
+        Ok(self.build.hurl(message, span))
     }
 
-    fn match_arm(&mut self) -> HaversResult<MatchArm> {
+    fn match_arm(&mut self) -> HaversResult<B::Arm> {
         let span = self.current_span();
         self.expect(&TokenKind::Whan, "whan")?;
 
@@ -511,72 +485,63 @@ impl Parser {
             self.continue_statement()?
         } else {
             let expr = self.expression()?;
-            Stmt::Expression {
-                span: expr.span(),
-                expr,
-            }
+            let expr_span = self.build.span(&expr);
+            self.build.expression(expr, expr_span)
         };
 
-        Ok(MatchArm {
-            pattern,
-            body,
-            span,
-        })
+        Ok(self.build.arm(pattern, body, span))
     }
 
-    fn pattern(&mut self) -> HaversResult<Pattern> {
+    fn pattern(&mut self) -> HaversResult<B::Pattern> {
         let token = self.peek().clone();
         match &token.kind {
             TokenKind::Integer(n) => {
                 let n = *n;
                 self.advance();
                 if self.match_token(&TokenKind::DotDot) {
+                    let start = self
+                        .build
+                        .literal(Literal::Integer(n), Span::new(token.line, token.column));
                     let end = self.expression()?;
-                    Ok(Pattern::Range {
-                        start: Box::new(Expr::Literal {
-                            value: Literal::Integer(n),
-                            span: Span::new(token.line, token.column),
-                        }),
-                        end: Box::new(end),
-                    })
+                    Ok(self.build.range_pattern(start, end))
                 } else {
-                    Ok(Pattern::Literal(Literal::Integer(n)))
+                    Ok(self.build.pattern(Pattern::Literal(Literal::Integer(n))))
                 }
             }
             TokenKind::Float(n) => {
                 let n = *n;
                 self.advance();
-                Ok(Pattern::Literal(Literal::Float(n)))
+                Ok(self.build.pattern(Pattern::Literal(Literal::Float(n))))
             }
             TokenKind::String(s) | TokenKind::SingleQuoteString(s) => {
                 let s = process_escapes(s);
                 self.advance();
-                Ok(Pattern::Literal(Literal::String(s)))
+                Ok(self.build.pattern(Pattern::Literal(Literal::String(s))))
             }
             TokenKind::Aye => {
                 self.advance();
-                Ok(Pattern::Literal(Literal::Bool(true)))
+                Ok(self.build.pattern(Pattern::Literal(Literal::Bool(true))))
             }
             TokenKind::Nae => {
                 self.advance();
-                Ok(Pattern::Literal(Literal::Bool(false)))
+                Ok(self.build.pattern(Pattern::Literal(Literal::Bool(false))))
             }
             TokenKind::Naething => {
                 self.advance();
-                Ok(Pattern::Literal(Literal::Nil))
+                Ok(self.build.pattern(Pattern::Literal(Literal::Nil)))
             }
             TokenKind::Underscore => {
                 self.advance();
-                Ok(Pattern::Wildcard)
+                Ok(self.build.pattern(Pattern::Wildcard))
             }
             TokenKind::Identifier(name) if name == "_" => {
                 self.advance();
-                Ok(Pattern::Wildcard)
+                Ok(self.build.pattern(Pattern::Wildcard))
             }
             TokenKind::Identifier(name) => {
                 let name = name.clone();
                 self.advance();
-                Ok(Pattern::Identifier(name))
+                Ok(self.build.pattern(Pattern::Identifier(name)))
             }
             TokenKind::Minus => {
                 // Handle negative number patterns like -5 or -3.14
@@ -586,12 +551,12 @@ impl Parser {
                     TokenKind::Integer(n) => {
                         let n = -*n;
                         self.advance();
-                        Ok(Pattern::Literal(Literal::Integer(n)))
+                        Ok(self.build.pattern(Pattern::Literal(Literal::Integer(n))))
                     }
                     TokenKind::Float(n) => {
                         let n = -*n;
                         self.advance();
-                        Ok(Pattern::Literal(Literal::Float(n)))
+                        Ok(self.build.pattern(Pattern::Literal(Literal::Float(n))))
                     }
                     _ => Err(HaversError::ParseError {
                         message: format!(
@@ -609,14 +574,14 @@ impl Parser {
         }
     }
 
-    fn block(&mut self) -> HaversResult<Stmt> {
+    fn block(&mut self) -> HaversResult<B::Stmt> {
         let span = self.current_span();
         self.expect(&TokenKind::LeftBrace, "{")?;
         let statements = self.block_statements()?;
-        Ok(Stmt::Block { statements, span })
+        Ok(self.build.block(statements, span))
     }
 
-    fn block_statements(&mut self) -> HaversResult<Vec<Stmt>> {
+    fn block_statements(&mut self) -> HaversResult<Vec<B::Stmt>> {
         let mut statements = Vec::new();
         self.skip_newlines();
 
@@ -629,59 +594,33 @@ impl Parser {
         Ok(statements)
     }
 
-    fn expression_statement(&mut self) -> HaversResult<Stmt> {
+    fn expression_statement(&mut self) -> HaversResult<B::Stmt> {
         let expr = self.expression()?;
-        let span = expr.span();
+        let span = self.build.span(&expr);
         self.expect_statement_end()?;
-        Ok(Stmt::Expression { expr, span })
+        Ok(self.build.expression(expr, span))
     }
 
     // === Expression parsing (precedence climbing) ===
 
-    fn expression(&mut self) -> HaversResult<Expr> {
+    fn expression(&mut self) -> HaversResult<B::Expr> {
         self.assignment()
     }
 
-    fn assignment(&mut self) -> HaversResult<Expr> {
+    fn assignment(&mut self) -> HaversResult<B::Expr> {
         let expr = self.pipe_expr()?;
 
         if self.match_token(&TokenKind::Equals) {
             let span = self.current_span();
             let value = self.assignment()?;
 
-            match expr {
-                Expr::Variable { name, .. } => {
-                    return Ok(Expr::Assign {
-                        name,
-                        value: Box::new(value),
-                        span,
-                    });
-                }
-                Expr::Get {
-                    object, property, ..
-                } => {
-                    return Ok(Expr::Set {
-                        object,
-                        property,
-                        value: Box::new(value),
-                        span,
-                    });
-                }
-                Expr::Index { object, index, .. } => {
-                    return Ok(Expr::IndexSet {
-                        object,
-                        index,
-                        value: Box::new(value),
-                        span,
-                    });
-                }
-                _ => {
-                    return Err(HaversError::ParseError {
-                        message: "Invalid assignment target".to_string(),
-                        line: span.line,
-                    });
-                }
-            }
+            return self
+                .build
+                .assign(expr, value, span)
+                .ok_or(HaversError::ParseError {
+                    message: "Invalid assignment target".to_string(),
+                    line: span.line,
+                });
         }
 
         // Handle compound assignment operators
@@ -698,53 +637,35 @@ impl Parser {
         };
 
         if let Some(op) = compound_op {
-            let span = expr.span();
+            let span = self.build.span(&expr);
             let value = self.assignment()?;
 
-            match expr {
-                Expr::Variable { name, .. } => {
-                    return Ok(Expr::Assign {
-                        name: name.clone(),
-                        value: Box::new(Expr::Binary {
-                            left: Box::new(Expr::Variable { name, span }),
-                            operator: op,
-                            right: Box::new(value),
-                            span,
-                        }),
-                        span,
-                    });
-                }
-                _ => {
-                    return Err(HaversError::ParseError {
-                        message: "Invalid compound assignment target".to_string(),
-                        line: span.line,
-                    });
-                }
-            }
+            return self.build.compound_assign(expr, op, value, span).ok_or(
+                HaversError::ParseError {
+                    message: "Invalid compound assignment target".to_string(),
+                    line: span.line,
+                },
+            );
         }
 
         Ok(expr)
     }
 
     /// Pipe expression: left |> right (means call right with left as argument)
-    fn pipe_expr(&mut self) -> HaversResult<Expr> {
+    fn pipe_expr(&mut self) -> HaversResult<B::Expr> {
         let mut expr = self.ternary()?;
 
         while self.match_token(&TokenKind::PipeForward) {
             let span = self.current_span();
             let right = self.ternary()?;
-            expr = Expr::Pipe {
-                left: Box::new(expr),
-                right: Box::new(right),
-                span,
-            };
+            expr = self.build.pipe(expr, right, span);
         }
 
         Ok(expr)
     }
 
     /// Ternary expression: gin condition than truthy ither falsy
-    fn ternary(&mut self) -> HaversResult<Expr> {
+    fn ternary(&mut self) -> HaversResult<B::Expr> {
         // Check fer ternary expression starting wi' 'gin'
         if self.match_token(&TokenKind::Gin) {
             let span = self
@@ -767,18 +688,13 @@ impl Parser {
             // Parse the 'else' expression (falsy case)
             let else_expr = self.ternary()?; // Right-associative
 
-            return Ok(Expr::Ternary {
-                condition: Box::new(condition),
-                then_expr: Box::new(then_expr),
-                else_expr: Box::new(else_expr),
-                span,
-            });
+            return Ok(self.build.ternary(condition, then_expr, else_expr, span));
         }
 
         self.or()
     }
 
-    fn or(&mut self) -> HaversResult<Expr> {
+    fn or(&mut self) -> HaversResult<B::Expr> {
         let mut expr = self.and()?;
 
         while self.match_token(&TokenKind::Or) {
@@ -787,18 +703,13 @@ impl Parser {
                 .map(|t| Span::new(t.line, t.column))
                 .unwrap_or(self.current_span());
             let right = self.and()?;
-            expr = Expr::Logical {
-                left: Box::new(expr),
-                operator: LogicalOp::Or,
-                right: Box::new(right),
-                span,
-            };
+            expr = self.build.logical(expr, LogicalOp::Or, right, span);
         }
 
         Ok(expr)
     }
 
-    fn and(&mut self) -> HaversResult<Expr> {
+    fn and(&mut self) -> HaversResult<B::Expr> {
         let mut expr = self.equality()?;
 
         while self.match_token(&TokenKind::An) {
@@ -807,18 +718,13 @@ impl Parser {
                 .map(|t| Span::new(t.line, t.column))
                 .unwrap_or(self.current_span());
             let right = self.equality()?;
-            expr = Expr::Logical {
-                left: Box::new(expr),
-                operator: LogicalOp::And,
-                right: Box::new(right),
-                span,
-            };
+            expr = self.build.logical(expr, LogicalOp::And, right, span);
         }
 
         Ok(expr)
     }
 
-    fn equality(&mut self) -> HaversResult<Expr> {
+    fn equality(&mut self) -> HaversResult<B::Expr> {
         let mut expr = self.comparison()?;
 
         loop {
@@ -835,18 +741,13 @@ impl Parser {
                 .map(|t| Span::new(t.line, t.column))
                 .unwrap_or(self.current_span());
             let right = self.comparison()?;
-            expr = Expr::Binary {
-                left: Box::new(expr),
-                operator: op,
-                right: Box::new(right),
-                span,
-            };
+            expr = self.build.binary(expr, op, right, span);
         }
 
         Ok(expr)
     }
 
-    fn comparison(&mut self) -> HaversResult<Expr> {
+    fn comparison(&mut self) -> HaversResult<B::Expr> {
         let mut expr = self.term()?;
 
         loop {
@@ -867,18 +768,13 @@ impl Parser {
                 .map(|t| Span::new(t.line, t.column))
                 .unwrap_or(self.current_span());
             let right = self.term()?;
-            expr = Expr::Binary {
-                left: Box::new(expr),
-                operator: op,
-                right: Box::new(right),
-                span,
-            };
+            expr = self.build.binary(expr, op, right, span);
         }
 
         Ok(expr)
     }
 
-    fn term(&mut self) -> HaversResult<Expr> {
+    fn term(&mut self) -> HaversResult<B::Expr> {
         let mut expr = self.factor()?;
 
         loop {
@@ -895,18 +791,13 @@ impl Parser {
                 .map(|t| Span::new(t.line, t.column))
                 .unwrap_or(self.current_span());
             let right = self.factor()?;
-            expr = Expr::Binary {
-                left: Box::new(expr),
-                operator: op,
-                right: Box::new(right),
-                span,
-            };
+            expr = self.build.binary(expr, op, right, span);
         }
 
         Ok(expr)
     }
 
-    fn factor(&mut self) -> HaversResult<Expr> {
+    fn factor(&mut self) -> HaversResult<B::Expr> {
         let mut expr = self.unary()?;
 
         loop {
@@ -925,29 +816,20 @@ impl Parser {
                 .map(|t| Span::new(t.line, t.column))
                 .unwrap_or(self.current_span());
             let right = self.unary()?;
-            expr = Expr::Binary {
-                left: Box::new(expr),
-                operator: op,
-                right: Box::new(right),
-                span,
-            };
+            expr = self.build.binary(expr, op, right, span);
         }
 
         Ok(expr)
     }
 
-    fn unary(&mut self) -> HaversResult<Expr> {
+    fn unary(&mut self) -> HaversResult<B::Expr> {
         if self.match_token(&TokenKind::Minus) {
             let span = self
                 .previous()
                 .map(|t| Span::new(t.line, t.column))
                 .unwrap_or(self.current_span());
             let operand = self.unary()?;
-            return Ok(Expr::Unary {
-                operator: UnaryOp::Negate,
-                operand: Box::new(operand),
-                span,
-            });
+            return Ok(self.build.unary(UnaryOp::Negate, operand, span));
         }
 
         // For `nae`, we need to distinguish between:
@@ -962,11 +844,7 @@ impl Parser {
                     .map(|t| Span::new(t.line, t.column))
                     .unwrap_or(self.current_span());
                 let operand = self.unary()?;
-                return Ok(Expr::Unary {
-                    operator: UnaryOp::Not,
-                    operand: Box::new(operand),
-                    span,
-                });
+                return Ok(self.build.unary(UnaryOp::Not, operand, span));
             }
             // Otherwise, let it be parsed as a literal in primary()
         }
@@ -977,11 +855,7 @@ impl Parser {
                 .map(|t| Span::new(t.line, t.column))
                 .unwrap_or(self.current_span());
             let operand = self.unary()?;
-            return Ok(Expr::Unary {
-                operator: UnaryOp::Not,
-                operand: Box::new(operand),
-                span,
-            });
+            return Ok(self.build.unary(UnaryOp::Not, operand, span));
         }
 
         self.call()
@@ -1013,7 +887,7 @@ impl Parser {
         )
     }
 
-    fn call(&mut self) -> HaversResult<Expr> {
+    fn call(&mut self) -> HaversResult<B::Expr> {
         let mut expr = self.primary()?;
 
         loop {
@@ -1022,11 +896,7 @@ impl Parser {
             } else if self.match_token(&TokenKind::Dot) {
                 let property = self.expect_identifier("property name")?;
                 let span = self.current_span();
-                expr = Expr::Get {
-                    object: Box::new(expr),
-                    property,
-                    span,
-                };
+                expr = self.build.get(expr, property, span);
             } else if self.match_token(&TokenKind::LeftBracket) {
                 let span = self.current_span();
 
@@ -1039,7 +909,7 @@ impl Parser {
                         if self.check(&TokenKind::Colon) || self.check(&TokenKind::RightBracket) {
                             None
                         } else {
-                            Some(Box::new(self.expression()?))
+                            Some(self.expression()?)
                         };
 
                     // Check fer step
@@ -1047,20 +917,14 @@ impl Parser {
                         if self.check(&TokenKind::RightBracket) {
                             None
                         } else {
-                            Some(Box::new(self.expression()?))
+                            Some(self.expression()?)
                         }
                     } else {
                         None
                     };
 
                     self.expect(&TokenKind::RightBracket, "]")?;
-                    expr = Expr::Slice {
-                        object: Box::new(expr),
-                        start: None,
-                        end,
-                        step,
-                        span,
-                    };
+                    expr = self.build.slice(expr, None, end, step, span);
                 } else {
                     // Could be [index] or [start:end] or [start:] or [start:end:step]
                     let first = self.expression()?;
@@ -1072,7 +936,7 @@ impl Parser {
                         {
                             None
                         } else {
-                            Some(Box::new(self.expression()?))
+                            Some(self.expression()?)
                         };
 
                         // Check fer step
@@ -1080,28 +944,18 @@ impl Parser {
                             if self.check(&TokenKind::RightBracket) {
                                 None
                             } else {
-                                Some(Box::new(self.expression()?))
+                                Some(self.expression()?)
                             }
                         } else {
                             None
                         };
 
                         self.expect(&TokenKind::RightBracket, "]")?;
-                        expr = Expr::Slice {
-                            object: Box::new(expr),
-                            start: Some(Box::new(first)),
-                            end,
-                            step,
-                            span,
-                        };
+                        expr = self.build.slice(expr, Some(first), end, step, span);
                     } else {
                         // Regular index access
                         self.expect(&TokenKind::RightBracket, "]")?;
-                        expr = Expr::Index {
-                            object: Box::new(expr),
-                            index: Box::new(first),
-                            span,
-                        };
+                        expr = self.build.index(expr, first, span);
                     }
                 }
             } else {
@@ -1112,8 +966,8 @@ impl Parser {
         Ok(expr)
     }
 
-    fn finish_call(&mut self, callee: Expr) -> HaversResult<Expr> {
-        let span = callee.span();
+    fn finish_call(&mut self, callee: B::Expr) -> HaversResult<B::Expr> {
+        let span = self.build.span(&callee);
         let mut arguments = Vec::new();
 
         if !self.check(&TokenKind::RightParen) {
@@ -1122,10 +976,8 @@ impl Parser {
                 if self.match_token(&TokenKind::DotDotDot) {
                     let spread_span = self.current_span();
                     let expr = self.expression()?;
-                    arguments.push(Expr::Spread {
-                        expr: Box::new(expr),
-                        span: spread_span,
-                    });
+                    let spread = self.build.spread(expr, spread_span);
+                    arguments.push(spread);
                 } else {
                     arguments.push(self.expression()?);
                 }
@@ -1137,14 +989,10 @@ impl Parser {
 
         self.expect(&TokenKind::RightParen, ")")?;
 
-        Ok(Expr::Call {
-            callee: Box::new(callee),
-            arguments,
-            span,
-        })
+        Ok(self.build.call(callee, arguments, span))
     }
 
-    fn primary(&mut self) -> HaversResult<Expr> {
+    fn primary(&mut self) -> HaversResult<B::Expr> {
         let token = self.peek().clone();
         let span = Span::new(token.line, token.column);
 
@@ -1152,26 +1000,18 @@ impl Parser {
             TokenKind::Integer(n) => {
                 let n = *n;
                 self.advance();
-                self.maybe_range(Expr::Literal {
-                    value: Literal::Integer(n),
-                    span,
-                })
+                let start = self.build.literal(Literal::Integer(n), span);
+                self.maybe_range(start)
             }
             TokenKind::Float(n) => {
                 let n = *n;
                 self.advance();
-                Ok(Expr::Literal {
-                    value: Literal::Float(n),
-                    span,
-                })
+                Ok(self.build.literal(Literal::Float(n), span))
             }
             TokenKind::String(s) | TokenKind::SingleQuoteString(s) => {
                 let s = process_escapes(s);
                 self.advance();
-                Ok(Expr::Literal {
-                    value: Literal::String(s),
-                    span,
-                })
+                Ok(self.build.literal(Literal::String(s), span))
             }
             TokenKind::FString(s) => {
                 let s = s.clone();
@@ -1180,41 +1020,29 @@ impl Parser {
             }
             TokenKind::Aye => {
                 self.advance();
-                Ok(Expr::Literal {
-                    value: Literal::Bool(true),
-                    span,
-                })
+                Ok(self.build.literal(Literal::Bool(true), span))
             }
             TokenKind::Nae => {
                 self.advance();
-                Ok(Expr::Literal {
-                    value: Literal::Bool(false),
-                    span,
-                })
+                Ok(self.build.literal(Literal::Bool(false), span))
             }
             TokenKind::Naething => {
                 self.advance();
-                Ok(Expr::Literal {
-                    value: Literal::Nil,
-                    span,
-                })
+                Ok(self.build.literal(Literal::Nil, span))
             }
             TokenKind::Masel => {
                 self.advance();
-                Ok(Expr::Masel { span })
+                Ok(self.build.masel(span))
             }
             TokenKind::Speir => {
                 self.advance();
                 let prompt = self.expression()?;
-                Ok(Expr::Input {
-                    prompt: Box::new(prompt),
-                    span,
-                })
+                Ok(self.build.input(prompt, span))
             }
             TokenKind::Identifier(name) => {
                 let name = name.clone();
                 self.advance();
-                let expr = Expr::Variable { name, span };
+                let expr = self.build.variable(name, span);
                 self.maybe_range(expr)
             }
             TokenKind::LeftParen => {
@@ -1222,10 +1050,8 @@ impl Parser {
                 let expr = self.expression()?;
                 self.expect(&TokenKind::RightParen, ")")?;
                 // Check for range after grouping: (x+1)..10
-                self.maybe_range(Expr::Grouping {
-                    expr: Box::new(expr),
-                    span,
-                })
+                let grouping = self.build.grouping(expr, span);
+                self.maybe_range(grouping)
             }
             TokenKind::LeftBracket => {
                 self.advance();
@@ -1237,10 +1063,8 @@ impl Parser {
                         if self.match_token(&TokenKind::DotDotDot) {
                             let spread_span = self.current_span();
                             let expr = self.expression()?;
-                            elements.push(Expr::Spread {
-                                expr: Box::new(expr),
-                                span: spread_span,
-                            });
+                            let spread = self.build.spread(expr, spread_span);
+                            elements.push(spread);
                         } else {
                             elements.push(self.expression()?);
                         }
@@ -1257,7 +1081,7 @@ impl Parser {
                     }
                 }
                 self.expect(&TokenKind::RightBracket, "]")?;
-                Ok(Expr::List { elements, span })
+                Ok(self.build.list(elements, span))
             }
             TokenKind::LeftBrace => {
                 self.advance(); // consume '{'
@@ -1266,21 +1090,20 @@ impl Parser {
                 // Empty dict literal: {}
                 if self.check(&TokenKind::RightBrace) {
                     self.advance(); // consume '}'
-                    return Ok(Expr::Dict {
-                        pairs: Vec::new(),
-                        span,
-                    });
+                    return Ok(self.build.dict(Vec::new(), span));
                 }
 
                 // If it looks like a statement, parse as block expression.
                 // Otherwise, try dict-first and fall back to block expr if no ':' appears.
                 let checkpoint = self.current;
+                let built = self.build.checkpoint();
                 let key_attempt = self.expression();
                 let is_dict = key_attempt.is_ok() && self.check(&TokenKind::Colon);
 
                 if !is_dict {
                     // Rewind and parse block expression statements until '}'
                     self.current = checkpoint;
+                    self.build.rewind(built);
                     let mut statements = Vec::new();
                     self.skip_newlines();
                     while !self.check(&TokenKind::RightBrace) && !self.is_at_end() {
@@ -1288,7 +1111,7 @@ impl Parser {
                         self.skip_newlines();
                     }
                     self.expect(&TokenKind::RightBrace, "}")?;
-                    return Ok(Expr::BlockExpr { statements, span });
+                    return Ok(self.build.block_expr(statements, span));
                 }
 
                 // Dict literal
@@ -1314,7 +1137,7 @@ impl Parser {
                 }
 
                 self.expect(&TokenKind::RightBrace, "}")?;
-                Ok(Expr::Dict { pairs, span })
+                Ok(self.build.dict(pairs, span))
             }
             // Lambda expressions: |x, y| x + y  or  |x, y| { statements... }
             TokenKind::Pipe => {
@@ -1341,18 +1164,11 @@ impl Parser {
                         self.skip_newlines();
                     }
                     self.expect(&TokenKind::RightBrace, "}")?;
-                    Expr::BlockExpr {
-                        statements,
-                        span: block_span,
-                    }
+                    self.build.block_expr(statements, block_span)
                 } else {
                     self.expression()?
                 };
-                Ok(Expr::Lambda {
-                    params,
-                    body: Box::new(body),
-                    span,
-                })
+                Ok(self.build.lambda(params, body, span))
             }
             _ => Err(HaversError::ParseError {
                 message: format!("Unexpected token: {}", token.kind),
@@ -1361,25 +1177,15 @@ impl Parser {
         }
     }
 
-    fn maybe_range(&mut self, start_expr: Expr) -> HaversResult<Expr> {
+    fn maybe_range(&mut self, start_expr: B::Expr) -> HaversResult<B::Expr> {
         if self.match_token(&TokenKind::DotDotEquals) {
-            let span = start_expr.span();
+            let span = self.build.span(&start_expr);
             let end = self.term()?;
-            Ok(Expr::Range {
-                start: Box::new(start_expr),
-                end: Box::new(end),
-                inclusive: true,
-                span,
-            })
+            Ok(self.build.range(start_expr, end, true, span))
         } else if self.match_token(&TokenKind::DotDot) {
-            let span = start_expr.span();
+            let span = self.build.span(&start_expr);
             let end = self.term()?;
-            Ok(Expr::Range {
-                start: Box::new(start_expr),
-                end: Box::new(end),
-                inclusive: false,
-                span,
-            })
+            Ok(self.build.range(start_expr, end, false, span))
         } else {
             Ok(start_expr)
         }
@@ -1387,13 +1193,13 @@ impl Parser {
 
     // === Helper methods ===
 
-    fn peek(&self) -> &Token {
+    fn peek(&self) -> &Token<'src> {
         self.tokens
             .get(self.current)
             .unwrap_or(&self.tokens[self.tokens.len() - 1])
     }
 
-    fn previous(&self) -> Option<&Token> {
+    fn previous(&self) -> Option<&Token<'src>> {
         if self.current > 0 {
             self.tokens.get(self.current - 1)
         } else {
@@ -1405,7 +1211,7 @@ impl Parser {
         matches!(self.peek().kind, TokenKind::Eof)
     }
 
-    fn advance(&mut self) -> &Token {
+    fn advance(&mut self) -> &Token<'src> {
         if !self.is_at_end() {
             self.current += 1;
         }
@@ -1532,7 +1338,7 @@ impl Parser {
     }
 
     /// Parse an f-string like f"Hello {name}!" into parts
-    fn parse_fstring(&mut self, content: &str, span: Span) -> HaversResult<Expr> {
+    fn parse_fstring(&mut self, content: &str, span: Span) -> HaversResult<B::Expr> {
         let mut parts = Vec::new();
         let mut current_text = String::new();
         let mut chars = content.chars().peekable();
@@ -1548,7 +1354,8 @@ impl Parser {
 
                 // Save current text if any (process escapes)
                 if !current_text.is_empty() {
-                    parts.push(FStringPart::Text(process_escapes(&current_text)));
+                    let text = self.build.text_part(process_escapes(&current_text));
+                    parts.push(text);
                     current_text.clear();
                 }
 
@@ -1592,10 +1399,14 @@ impl Parser {
                 }
 
                 // Parse the expression
+                // The inner parser builds into the same arena as this one
                 let expr_tokens = crate::lexer::lex(&expr_str)?;
-                let mut expr_parser = Parser::new(expr_tokens);
-                let expr = expr_parser.expression()?;
-                parts.push(FStringPart::Expr(Box::new(expr)));
+                let build = std::mem::take(&mut self.build);
+                let mut expr_parser = Parser::with_builder(expr_tokens, build);
+                let expr = expr_parser.expression();
+                self.build = expr_parser.build;
+                let part = self.build.expr_part(expr?);
+                parts.push(part);
             } else if c == '}' {
                 // Check for escaped brace }}
                 if chars.peek() == Some(&'}') {
@@ -1612,10 +1423,11 @@ impl Parser {
 
         // Don't forget remaining text (process escapes)
         if !current_text.is_empty() {
-            parts.push(FStringPart::Text(process_escapes(&current_text)));
+            let text = self.build.text_part(process_escapes(&current_text));
+            parts.push(text);
         }
 
-        Ok(Expr::FString { parts, span })
+        Ok(self.build.fstring(parts, span))
     }
 }
 
@@ -1672,10 +1484,20 @@ fn process_escapes(s: &str) -> String {
 }
 
 /// Convenience function tae parse source code
+///
+/// The program comes back with its variables resolved (see [`crate::resolve`]).
 pub fn parse(source: &str) -> HaversResult<Program> {
     let tokens = crate::lexer::lex(source)?;
     let mut parser = Parser::new(tokens);
-    parser.parse()
+    let mut program = parser.parse()?;
+    crate::resolve::resolve(&mut program);
+    Ok(program)
+}
+
+/// Parse source code straight into an arena, for passes that only need to look at it
+pub fn parse_arena(source: &str) -> HaversResult<crate::ast::arena::Ast> {
+    let tokens = crate::lexer::lex(source)?;
+    Parser::with_builder(tokens, crate::ast::arena::AstBuilder::default()).parse()
 }
 
 #[cfg(test)]
@@ -2150,12 +1972,7 @@ mod tests {
     #[test]
     fn test_pattern_identifier_underscore_is_wildcard() {
         let tokens = vec![
-            Token::new(
-                TokenKind::Identifier("_".to_string()),
-                "_".to_string(),
-                1,
-                1,
-            ),
+            Token::new(TokenKind::Identifier("_".to_string()), "_", 1, 1),
             Token::eof(1),
         ];
         let mut parser = Parser::new(tokens);
@@ -2263,7 +2080,7 @@ mod tests {
 
     #[test]
     fn test_is_nae_followed_by_operand_handles_end_of_stream() {
-        let tokens = vec![Token::new(TokenKind::Nae, "nae".to_string(), 1, 1)];
+        let tokens = vec![Token::new(TokenKind::Nae, "nae", 1, 1)];
         let parser = Parser::new(tokens);
         assert!(!parser.is_nae_followed_by_operand());
     }
@@ -0,0 +1,590 @@
+//! What the parser builds its nodes with
+//!
+//! The parser calls one [`Build`] method per node instead of naming `Expr`/`Stmt` variants
+//! itself, so the same grammar can produce the boxed tree ([`Boxed`], what
+//! [`crate::parser::parse`] returns) or an arena ([`crate::ast::arena::AstBuilder`]) without
+//! building one and converting it into the other.
+
+use crate::ast::*;
+
+/// Node constructors for the parser
+///
+/// Child lists are handed over as `Vec`s in source order. Names and string literals are
+/// handed over as `String`s.
+pub trait Build: Default {
+    type Expr;
+    type Stmt;
+    type Param;
+    type Arm;
+    type Pattern;
+    type Destruct;
+    type Part;
+    /// What a whole program comes out as
+    type Output;
+    /// A point the parser may rewind to after a speculative parse
+    type Checkpoint: Copy;
+
+    fn finish(&mut self, statements: Vec<Self::Stmt>) -> Self::Output;
+    fn span(&self, expr: &Self::Expr) -> Span;
+    fn checkpoint(&self) -> Self::Checkpoint;
+    /// Forget everything built since `checkpoint`
+    fn rewind(&mut self, checkpoint: Self::Checkpoint);
+
+    /// `target = value`, or None if target can't be assigned to
+    fn assign(&mut self, target: Self::Expr, value: Self::Expr, span: Span) -> Option<Self::Expr>;
+    /// `target op= value`, or None if target isn't a variable
+    fn compound_assign(
+        &mut self,
+        target: Self::Expr,
+        operator: BinaryOp,
+        value: Self::Expr,
+        span: Span,
+    ) -> Option<Self::Expr>;
+
+    // === Statements ===
+
+    fn var_decl(&mut self, name: String, initializer: Option<Self::Expr>, span: Span)
+        -> Self::Stmt;
+    fn destructure(
+        &mut self,
+        patterns: Vec<Self::Destruct>,
+        value: Self::Expr,
+        span: Span,
+    ) -> Self::Stmt;
+    fn destruct(&mut self, pattern: DestructPattern) -> Self::Destruct;
+    fn function(
+        &mut self,
+        name: String,
+        params: Vec<Self::Param>,
+        body: Vec<Self::Stmt>,
+        span: Span,
+    ) -> Self::Stmt;
+    fn param(&mut self, name: String, default: Option<Self::Expr>) -> Self::Param;
+    fn class(
+        &mut self,
+        name: String,
+        superclass: Option<String>,
+        methods: Vec<Self::Stmt>,
+        span: Span,
+    ) -> Self::Stmt;
+    fn struct_decl(&mut self, name: String, fields: Vec<String>, span: Span) -> Self::Stmt;
+    fn import(&mut self, path: String, alias: Option<String>, span: Span) -> Self::Stmt;
+    fn if_stmt(
+        &mut self,
+        condition: Self::Expr,
+        then_branch: Self::Stmt,
+        else_branch: Option<Self::Stmt>,
+        span: Span,
+    ) -> Self::Stmt;
+    fn while_stmt(&mut self, condition: Self::Expr, body: Self::Stmt, span: Span) -> Self::Stmt;
+    fn for_stmt(
+        &mut self,
+        variable: String,
+        iterable: Self::Expr,
+        body: Self::Stmt,
+        span: Span,
+    ) -> Self::Stmt;
+    fn return_stmt(&mut self, value: Option<Self::Expr>, span: Span) -> Self::Stmt;
+    fn print(&mut self, value: Self::Expr, span: Span) -> Self::Stmt;
+    fn break_stmt(&mut self, span: Span) -> Self::Stmt;
+    fn continue_stmt(&mut self, span: Span) -> Self::Stmt;
+    fn try_catch(
+        &mut self,
+        try_block: Self::Stmt,
+        error_name: String,
+        catch_block: Self::Stmt,
+        span: Span,
+    ) -> Self::Stmt;
+    fn match_stmt(&mut self, value: Self::Expr, arms: Vec<Self::Arm>, span: Span) -> Self::Stmt;
+    fn arm(&mut self, pattern: Self::Pattern, body: Self::Stmt, span: Span) -> Self::Arm;
+    /// A pattern with no expressions in it (anything but a range)
+    fn pattern(&mut self, pattern: Pattern) -> Self::Pattern;
+    fn range_pattern(&mut self, start: Self::Expr, end: Self::Expr) -> Self::Pattern;
+    fn assert_stmt(
+        &mut self,
+        condition: Self::Expr,
+        message: Option<Self::Expr>,
+        span: Span,
+    ) -> Self::Stmt;
+    fn log(
+        &mut self,
+        level: LogLevel,
+        message: Self::Expr,
+        extras: Vec<Self::Expr>,
+        span: Span,
+    ) -> Self::Stmt;
+    fn hurl(&mut self, message: Self::Expr, span: Span) -> Self::Stmt;
+    fn block(&mut self, statements: Vec<Self::Stmt>, span: Span) -> Self::Stmt;
+    fn expression(&mut self, expr: Self::Expr, span: Span) -> Self::Stmt;
+
+    // === Expressions ===
+
+    fn literal(&mut self, value: Literal, span: Span) -> Self::Expr;
+    fn variable(&mut self, name: String, span: Span) -> Self::Expr;
+    fn binary(
+        &mut self,
+        left: Self::Expr,
+        operator: BinaryOp,
+        right: Self::Expr,
+        span: Span,
+    ) -> Self::Expr;
+    fn unary(&mut self, operator: UnaryOp, operand: Self::Expr, span: Span) -> Self::Expr;
+    fn logical(
+        &mut self,
+        left: Self::Expr,
+        operator: LogicalOp,
+        right: Self::Expr,
+        span: Span,
+    ) -> Self::Expr;
+    fn call(&mut self, callee: Self::Expr, arguments: Vec<Self::Expr>, span: Span) -> Self::Expr;
+    fn get(&mut self, object: Self::Expr, property: String, span: Span) -> Self::Expr;
+    fn index(&mut self, object: Self::Expr, index: Self::Expr, span: Span) -> Self::Expr;
+    fn slice(
+        &mut self,
+        object: Self::Expr,
+        start: Option<Self::Expr>,
+        end: Option<Self::Expr>,
+        step: Option<Self::Expr>,
+        span: Span,
+    ) -> Self::Expr;
+    fn list(&mut self, elements: Vec<Self::Expr>, span: Span) -> Self::Expr;
+    fn dict(&mut self, pairs: Vec<(Self::Expr, Self::Expr)>, span: Span) -> Self::Expr;
+    fn range(
+        &mut self,
+        start: Self::Expr,
+        end: Self::Expr,
+        inclusive: bool,
+        span: Span,
+    ) -> Self::Expr;
+    fn grouping(&mut self, expr: Self::Expr, span: Span) -> Self::Expr;
+    fn lambda(&mut self, params: Vec<String>, body: Self::Expr, span: Span) -> Self::Expr;
+    fn block_expr(&mut self, statements: Vec<Self::Stmt>, span: Span) -> Self::Expr;
+    fn masel(&mut self, span: Span) -> Self::Expr;
+    fn input(&mut self, prompt: Self::Expr, span: Span) -> Self::Expr;
+    fn fstring(&mut self, parts: Vec<Self::Part>, span: Span) -> Self::Expr;
+    fn text_part(&mut self, text: String) -> Self::Part;
+    fn expr_part(&mut self, expr: Self::Expr) -> Self::Part;
+    fn spread(&mut self, expr: Self::Expr, span: Span) -> Self::Expr;
+    fn pipe(&mut self, left: Self::Expr, right: Self::Expr, span: Span) -> Self::Expr;
+    fn ternary(
+        &mut self,
+        condition: Self::Expr,
+        then_expr: Self::Expr,
+        else_expr: Self::Expr,
+        span: Span,
+    ) -> Self::Expr;
+}
+
+/// Builds the boxed [`Program`] tree
+#[derive(Debug, Default, Clone, Copy)]
+pub struct Boxed;
+
+impl Build for Boxed {
+    type Expr = Expr;
+    type Stmt = Stmt;
+    type Param = Param;
+    type Arm = MatchArm;
+    type Pattern = Pattern;
+    type Destruct = DestructPattern;
+    type Part = FStringPart;
+    type Output = Program;
+    type Checkpoint = ();
+
+    fn finish(&mut self, statements: Vec<Stmt>) -> Program {
+        Program::new(statements)
+    }
+
+    fn span(&self, expr: &Expr) -> Span {
+        expr.span()
+    }
+
+    fn checkpoint(&self) {}
+
+    fn rewind(&mut self, _checkpoint: ()) {}
+
+    fn assign(&mut self, target: Expr, value: Expr, span: Span) -> Option<Expr> {
+        match target {
+            Expr::Variable { name, .. } => Some(Expr::Assign {
+                name,
+                value: Box::new(value),
+                slot: None,
+                span,
+            }),
+            Expr::Get {
+                object, property, ..
+            } => Some(Expr::Set {
+                object,
+                property,
+                value: Box::new(value),
+                span,
+            }),
+            Expr::Index { object, index, .. } => Some(Expr::IndexSet {
+                object,
+                index,
+                value: Box::new(value),
+                span,
+            }),
+            _ => None,
+        }
+    }
+
+    fn compound_assign(
+        &mut self,
+        target: Expr,
+        operator: BinaryOp,
+        value: Expr,
+        span: Span,
+    ) -> Option<Expr> {
+        match target {
+            Expr::Variable { name, .. } => Some(Expr::Assign {
+                name: name.clone(),
+                value: Box::new(Expr::Binary {
+                    left: Box::new(Expr::Variable {
+                        name,
+                        slot: None,
+                        span,
+                    }),
+                    operator,
+                    right: Box::new(value),
+                    span,
+                }),
+                slot: None,
+                span,
+            }),
+            _ => None,
+        }
+    }
+
+    fn var_decl(&mut self, name: String, initializer: Option<Expr>, span: Span) -> Stmt {
+        Stmt::VarDecl {
+            name,
+            initializer,
+            span,
+        }
+    }
+
+    fn destructure(&mut self, patterns: Vec<DestructPattern>, value: Expr, span: Span) -> Stmt {
+        Stmt::Destructure {
+            patterns,
+            value,
+            span,
+        }
+    }
+
+    fn destruct(&mut self, pattern: DestructPattern) -> DestructPattern {
+        pattern
+    }
+
+    fn function(&mut self, name: String, params: Vec<Param>, body: Vec<Stmt>, span: Span) -> Stmt {
+        Stmt::Function {
+            name,
+            params,
+            body,
+            span,
+        }
+    }
+
+    fn param(&mut self, name: String, default: Option<Expr>) -> Param {
+        Param { name, default }
+    }
+
+    fn class(
+        &mut self,
+        name: String,
+        superclass: Option<String>,
+        methods: Vec<Stmt>,
+        span: Span,
+    ) -> Stmt {
+        Stmt::Class {
+            name,
+            superclass,
+            methods,
+            span,
+        }
+    }
+
+    fn struct_decl(&mut self, name: String, fields: Vec<String>, span: Span) -> Stmt {
+        Stmt::Struct { name, fields, span }
+    }
+
+    fn import(&mut self, path: String, alias: Option<String>, span: Span) -> Stmt {
+        Stmt::Import { path, alias, span }
+    }
+
+    fn if_stmt(
+        &mut self,
+        condition: Expr,
+        then_branch: Stmt,
+        else_branch: Option<Stmt>,
+        span: Span,
+    ) -> Stmt {
+        Stmt::If {
+            condition,
+            then_branch: Box::new(then_branch),
+            else_branch: else_branch.map(Box::new),
+            span,
+        }
+    }
+
+    fn while_stmt(&mut self, condition: Expr, body: Stmt, span: Span) -> Stmt {
+        Stmt::While {
+            condition,
+            body: Box::new(body),
+            span,
+        }
+    }
+
+    fn for_stmt(&mut self, variable: String, iterable: Expr, body: Stmt, span: Span) -> Stmt {
+        Stmt::For {
+            variable,
+            iterable,
+            body: Box::new(body),
+            span,
+        }
+    }
+
+    fn return_stmt(&mut self, value: Option<Expr>, span: Span) -> Stmt {
+        Stmt::Return { value, span }
+    }
+
+    fn print(&mut self, value: Expr, span: Span) -> Stmt {
+        Stmt::Print { value, span }
+    }
+
+    fn break_stmt(&mut self, span: Span) -> Stmt {
+        Stmt::Break { span }
+    }
+
+    fn continue_stmt(&mut self, span: Span) -> Stmt {
+        Stmt::Continue { span }
+    }
+
+    fn try_catch(
+        &mut self,
+        try_block: Stmt,
+        error_name: String,
+        catch_block: Stmt,
+        span: Span,
+    ) -> Stmt {
+        Stmt::TryCatch {
+            try_block: Box::new(try_block),
+            error_name,
+            catch_block: Box::new(catch_block),
+            span,
+        }
+    }
+
+    fn match_stmt(&mut self, value: Expr, arms: Vec<MatchArm>, span: Span) -> Stmt {
+        Stmt::Match { value, arms, span }
+    }
+
+    fn arm(&mut self, pattern: Pattern, body: Stmt, span: Span) -> MatchArm {
+        MatchArm {
+            pattern,
+            body,
+            span,
+        }
+    }
+
+    fn pattern(&mut self, pattern: Pattern) -> Pattern {
+        pattern
+    }
+
+    fn range_pattern(&mut self, start: Expr, end: Expr) -> Pattern {
+        Pattern::Range {
+            start: Box::new(start),
+            end: Box::new(end),
+        }
+    }
+
+    fn assert_stmt(&mut self, condition: Expr, message: Option<Expr>, span: Span) -> Stmt {
+        Stmt::Assert {
+            condition,
+            message,
+            span,
+        }
+    }
+
+    fn log(&mut self, level: LogLevel, message: Expr, extras: Vec<Expr>, span: Span) -> Stmt {
+        Stmt::Log {
+            level,
+            message,
+            extras,
+            span,
+        }
+    }
+
+    fn hurl(&mut self, message: Expr, span: Span) -> Stmt {
+        Stmt::Hurl { message, span }
+    }
+
+    fn block(&mut self, statements: Vec<Stmt>, span: Span) -> Stmt {
+        Stmt::Block { statements, span }
+    }
+
+    fn expression(&mut self, expr: Expr, span: Span) -> Stmt {
+        Stmt::Expression { expr, span }
+    }
+
+    fn literal(&mut self, value: Literal, span: Span) -> Expr {
+        Expr::Literal { value, span }
+    }
+
+    fn variable(&mut self, name: String, span: Span) -> Expr {
+        Expr::Variable {
+            name,
+            slot: None,
+            span,
+        }
+    }
+
+    fn binary(&mut self, left: Expr, operator: BinaryOp, right: Expr, span: Span) -> Expr {
+        Expr::Binary {
+            left: Box::new(left),
+            operator,
+            right: Box::new(right),
+            span,
+        }
+    }
+
+    fn unary(&mut self, operator: UnaryOp, operand: Expr, span: Span) -> Expr {
+        Expr::Unary {
+            operator,
+            operand: Box::new(operand),
+            span,
+        }
+    }
+
+    fn logical(&mut self, left: Expr, operator: LogicalOp, right: Expr, span: Span) -> Expr {
+        Expr::Logical {
+            left: Box::new(left),
+            operator,
+            right: Box::new(right),
+            span,
+        }
+    }
+
+    fn call(&mut self, callee: Expr, arguments: Vec<Expr>, span: Span) -> Expr {
+        Expr::Call {
+            callee: Box::new(callee),
+            arguments,
+            span,
+        }
+    }
+
+    fn get(&mut self, object: Expr, property: String, span: Span) -> Expr {
+        Expr::Get {
+            object: Box::new(object),
+            property,
+            span,
+        }
+    }
+
+    fn index(&mut self, object: Expr, index: Expr, span: Span) -> Expr {
+        Expr::Index {
+            object: Box::new(object),
+            index: Box::new(index),
+            span,
+        }
+    }
+
+    fn slice(
+        &mut self,
+        object: Expr,
+        start: Option<Expr>,
+        end: Option<Expr>,
+        step: Option<Expr>,
+        span: Span,
+    ) -> Expr {
+        Expr::Slice {
+            object: Box::new(object),
+            start: start.map(Box::new),
+            end: end.map(Box::new),
+            step: step.map(Box::new),
+            span,
+        }
+    }
+
+    fn list(&mut self, elements: Vec<Expr>, span: Span) -> Expr {
+        Expr::List { elements, span }
+    }
+
+    fn dict(&mut self, pairs: Vec<(Expr, Expr)>, span: Span) -> Expr {
+        Expr::Dict { pairs, span }
+    }
+
+    fn range(&mut self, start: Expr, end: Expr, inclusive: bool, span: Span) -> Expr {
+        Expr::Range {
+            start: Box::new(start),
+            end: Box::new(end),
+            inclusive,
+            span,
+        }
+    }
+
+    fn grouping(&mut self, expr: Expr, span: Span) -> Expr {
+        Expr::Grouping {
+            expr: Box::new(expr),
+            span,
+        }
+    }
+
+    fn lambda(&mut self, params: Vec<String>, body: Expr, span: Span) -> Expr {
+        Expr::Lambda {
+            params,
+            body: Box::new(body),
+            span,
+        }
+    }
+
+    fn block_expr(&mut self, statements: Vec<Stmt>, span: Span) -> Expr {
+        Expr::BlockExpr { statements, span }
+    }
+
+    fn masel(&mut self, span: Span) -> Expr {
+        Expr::Masel { span }
+    }
+
+    fn input(&mut self, prompt: Expr, span: Span) -> Expr {
+        Expr::Input {
+            prompt: Box::new(prompt),
+            span,
+        }
+    }
+
+    fn fstring(&mut self, parts: Vec<FStringPart>, span: Span) -> Expr {
+        Expr::FString { parts, span }
+    }
+
+    fn text_part(&mut self, text: String) -> FStringPart {
+        FStringPart::Text(text)
+    }
+
+    fn expr_part(&mut self, expr: Expr) -> FStringPart {
+        FStringPart::Expr(Box::new(expr))
+    }
+
+    fn spread(&mut self, expr: Expr, span: Span) -> Expr {
+        Expr::Spread {
+            expr: Box::new(expr),
+            span,
+        }
+    }
+
+    fn pipe(&mut self, left: Expr, right: Expr, span: Span) -> Expr {
+        Expr::Pipe {
+            left: Box::new(left),
+            right: Box::new(right),
+            span,
+        }
+    }
+
+    fn ternary(&mut self, condition: Expr, then_expr: Expr, else_expr: Expr, span: Span) -> Expr {
+        Expr::Ternary {
+            condition: Box::new(condition),
+            then_expr: Box::new(then_expr),
+            else_expr: Box::new(else_expr),
+            span,
+        }
+    }
+}
@@ -0,0 +1,640 @@
+//! Variable resolution for the tree-walker
+//!
+//! Before a program runs, each variable reference and assignment is tagged with how many
+//! environments up its binding lives and, when the source shows it, which slot it's in.
+//! The scopes here are the ones the interpreter makes: a block, a function or method
+//! frame (`masel`, the parameters and whatever the body declares) and a lambda frame.
+//! `fer` variables, catch names, match bindings and block expressions land in the scope
+//! they're written in, as they do at runtime.
+//!
+//! A tag only hops over scopes that can never bind the name, so it finds what the search
+//! by name would. The top level (globals, a module, the REPL) and any scope with a plain
+//! `fetch` can gain names the source doesn't show, so lookups carry on by name from
+//! there. Slots are checked against the name when used, so a guess that's wrong at
+//! runtime only costs the search it would have done anyway.
+//!
+//! [`crate::parser::parse`] resolves every program it returns, so the tags are worked out
+//! once per parse (and kept in the parse cache). [`crate::optimise::optimise`] resolves its
+//! output again, since inlining moves expressions into other scopes.
+
+use crate::ast::{DestructPattern, Expr, FStringPart, Param, Pattern, Program, Slot, Stmt};
+
+/// The names a scope can bind, in the order they're first defined
+#[derive(Default)]
+struct Scope {
+    names: Vec<String>,
+    /// Has a `fetch` without an alias, which can define anything
+    open: bool,
+}
+
+impl Scope {
+    fn open() -> Self {
+        Scope {
+            names: Vec::new(),
+            open: true,
+        }
+    }
+
+    fn declare(&mut self, name: &str) {
+        if !self.names.iter().any(|n| n == name) {
+            self.names.push(name.to_string());
+        }
+    }
+
+    /// Everything `statements` bind in the scope they run in
+    fn declare_stmts(&mut self, statements: &[Stmt]) {
+        for stmt in statements {
+            self.declare_stmt(stmt);
+        }
+    }
+
+    fn declare_stmt(&mut self, stmt: &Stmt) {
+        match stmt {
+            Stmt::VarDecl {
+                name, initializer, ..
+            } => {
+                if let Some(init) = initializer {
+                    self.declare_expr(init);
+                }
+                self.declare(name);
+            }
+            Stmt::Expression { expr, .. } => self.declare_expr(expr),
+            // A block gets its own scope
+            Stmt::Block { .. } => {}
+            Stmt::If {
+                condition,
+                then_branch,
+                else_branch,
+                ..
+            } => {
+                self.declare_expr(condition);
+                self.declare_stmt(then_branch);
+                if let Some(else_branch) = else_branch {
+                    self.declare_stmt(else_branch);
+                }
+            }
+            Stmt::While {
+                condition, body, ..
+            } => {
+                self.declare_expr(condition);
+                self.declare_stmt(body);
+            }
+            Stmt::For {
+                variable,
+                iterable,
+                body,
+                ..
+            } => {
+                self.declare_expr(iterable);
+                self.declare(variable);
+                self.declare_stmt(body);
+            }
+            Stmt::Function { name, .. } | Stmt::Class { name, .. } | Stmt::Struct { name, .. } => {
+                self.declare(name)
+            }
+            Stmt::Return { value, .. } => {
+                if let Some(value) = value {
+                    self.declare_expr(value);
+                }
+            }
+            Stmt::Print { value, .. } => self.declare_expr(value),
+            Stmt::Break { .. } | Stmt::Continue { .. } => {}
+            Stmt::Import { alias, .. } => match alias {
+                Some(alias) => self.declare(alias),
+                None => self.open = true,
+            },
+            Stmt::TryCatch {
+                try_block,
+                error_name,
+                catch_block,
+                ..
+            } => {
+                self.declare_stmt(try_block);
+                self.declare(error_name);
+                self.declare_stmt(catch_block);
+            }
+            Stmt::Match { value, arms, .. } => {
+                self.declare_expr(value);
+                for arm in arms {
+                    match &arm.pattern {
+                        Pattern::Identifier(name) => self.declare(name),
+                        Pattern::Range { start, end } => {
+                            self.declare_expr(start);
+                            self.declare_expr(end);
+                        }
+                        Pattern::Literal(_) | Pattern::Wildcard => {}
+                    }
+                    self.declare_stmt(&arm.body);
+                }
+            }
+            Stmt::Assert {
+                condition, message, ..
+            } => {
+                self.declare_expr(condition);
+                if let Some(message) = message {
+                    self.declare_expr(message);
+                }
+            }
+            Stmt::Destructure {
+                patterns, value, ..
+            } => {
+                self.declare_expr(value);
+                for pattern in patterns {
+                    if let DestructPattern::Variable(name) | DestructPattern::Rest(name) = pattern {
+                        self.declare(name);
+                    }
+                }
+            }
+            Stmt::Log {
+                message, extras, ..
+            } => {
+                self.declare_expr(message);
+                for extra in extras {
+                    self.declare_expr(extra);
+                }
+            }
+            Stmt::Hurl { message, .. } => self.declare_expr(message),
+        }
+    }
+
+    /// Block expressions run in the scope around them; a lambda's body is its own frame
+    fn declare_expr(&mut self, expr: &Expr) {
+        match expr {
+            Expr::BlockExpr { statements, .. } => self.declare_stmts(statements),
+            Expr::Lambda { .. } => {}
+            _ => for_each_child(expr, |child| self.declare_expr(child)),
+        }
+    }
+}
+
+/// Call `f` on each expression directly inside `expr`
+fn for_each_child(expr: &Expr, mut f: impl FnMut(&Expr)) {
+    match expr {
+        Expr::Literal { .. }
+        | Expr::Variable { .. }
+        | Expr::Masel { .. }
+        | Expr::Lambda { .. }
+        | Expr::BlockExpr { .. } => {}
+        Expr::Assign { value, .. } => f(value),
+        Expr::Binary { left, right, .. }
+        | Expr::Logical { left, right, .. }
+        | Expr::Pipe { left, right, .. } => {
+            f(left);
+            f(right);
+        }
+        Expr::Unary { operand: expr, .. }
+        | Expr::Get { object: expr, .. }
+        | Expr::Grouping { expr, .. }
+        | Expr::Input { prompt: expr, .. }
+        | Expr::Spread { expr, .. } => f(expr),
+        Expr::Call {
+            callee, arguments, ..
+        } => {
+            f(callee);
+            arguments.iter().for_each(f);
+        }
+        Expr::Set { object, value, .. } => {
+            f(object);
+            f(value);
+        }
+        Expr::Index { object, index, .. } => {
+            f(object);
+            f(index);
+        }
+        Expr::IndexSet {
+            object,
+            index,
+            value,
+            ..
+        } => {
+            f(object);
+            f(index);
+            f(value);
+        }
+        Expr::Slice {
+            object,
+            start,
+            end,
+            step,
+            ..
+        } => {
+            f(object);
+            for part in [start, end, step].into_iter().flatten() {
+                f(part);
+            }
+        }
+        Expr::List { elements, .. } => elements.iter().for_each(f),
+        Expr::Dict { pairs, .. } => {
+            for (key, value) in pairs {
+                f(key);
+                f(value);
+            }
+        }
+        Expr::Range { start, end, .. } => {
+            f(start);
+            f(end);
+        }
+        Expr::FString { parts, .. } => {
+            for part in parts {
+                if let FStringPart::Expr(expr) = part {
+                    f(expr);
+                }
+            }
+        }
+        Expr::Ternary {
+            condition,
+            then_expr,
+            else_expr,
+            ..
+        } => {
+            f(condition);
+            f(then_expr);
+            f(else_expr);
+        }
+    }
+}
+
+struct Resolver {
+    scopes: Vec<Scope>,
+}
+
+/// Tag the variables in a program that runs at the top level (globals or a module)
+pub fn resolve(program: &mut Program) {
+    let mut resolver = Resolver {
+        scopes: vec![Scope::open()],
+    };
+    resolver.stmts(&mut program.statements);
+}
+
+impl Resolver {
+    /// Where `name` would be found from the innermost scope, if that's worth recording
+    fn slot(&self, name: &str) -> Option<Slot> {
+        for (depth, scope) in self.scopes.iter().rev().enumerate() {
+            let index = if scope.open {
+                None
+            } else {
+                match scope.names.iter().position(|n| n == name) {
+                    Some(index) => Some(index),
+                    None => continue,
+                }
+            };
+            if depth == 0 && index.is_none() {
+                return None;
+            }
+            return Some(Slot {
+                depth: u16::try_from(depth).ok()?,
+                index: index.and_then(|i| u16::try_from(i).ok()),
+            });
+        }
+        None
+    }
+
+    fn with_scope(&mut self, scope: Scope, f: impl FnOnce(&mut Self)) {
+        self.scopes.push(scope);
+        f(self);
+        self.scopes.pop();
+    }
+
+    fn stmts(&mut self, statements: &mut [Stmt]) {
+        for stmt in statements {
+            self.stmt(stmt);
+        }
+    }
+
+    /// A function or method frame: `masel` for methods, then the parameters, then the body
+    fn frame(&mut self, masel: bool, params: &mut [Param], body: &mut [Stmt]) {
+        let mut scope = Scope::default();
+        if masel {
+            scope.declare("masel");
+        }
+        for param in params.iter() {
+            scope.declare(&param.name);
+        }
+        scope.declare_stmts(body);
+        self.with_scope(scope, |resolver| {
+            for param in params.iter_mut() {
+                if let Some(default) = &mut param.default {
+                    resolver.expr(default);
+                }
+            }
+            resolver.stmts(body);
+        });
+    }
+
+    fn stmt(&mut self, stmt: &mut Stmt) {
+        match stmt {
+            Stmt::VarDecl { initializer, .. } => {
+                if let Some(init) = initializer {
+                    self.expr(init);
+                }
+            }
+            Stmt::Expression { expr, .. } => self.expr(expr),
+            Stmt::Block { statements, .. } => {
+                let mut scope = Scope::default();
+                scope.declare_stmts(statements);
+                self.with_scope(scope, |resolver| resolver.stmts(statements));
+            }
+            Stmt::If {
+                condition,
+                then_branch,
+                else_branch,
+                ..
+            } => {
+                self.expr(condition);
+                self.stmt(then_branch);
+                if let Some(else_branch) = else_branch {
+                    self.stmt(else_branch);
+                }
+            }
+            Stmt::While {
+                condition, body, ..
+            } => {
+                self.expr(condition);
+                self.stmt(body);
+            }
+            Stmt::For { iterable, body, .. } => {
+                self.expr(iterable);
+                self.stmt(body);
+            }
+            Stmt::Function { params, body, .. } => self.frame(false, params, body),
+            Stmt::Return { value, .. } => {
+                if let Some(value) = value {
+                    self.expr(value);
+                }
+            }
+            Stmt::Print { value, .. } => self.expr(value),
+            Stmt::Class { methods, .. } => {
+                for method in methods {
+                    if let Stmt::Function { params, body, .. } = method {
+                        self.frame(true, params, body);
+                    }
+                }
+            }
+            Stmt::Break { .. }
+            | Stmt::Continue { .. }
+            | Stmt::Struct { .. }
+            | Stmt::Import { .. } => {}
+            Stmt::TryCatch {
+                try_block,
+                catch_block,
+                ..
+            } => {
+                self.stmt(try_block);
+                self.stmt(catch_block);
+            }
+            Stmt::Match { value, arms, .. } => {
+                self.expr(value);
+                for arm in arms {
+                    if let Pattern::Range { start, end } = &mut arm.pattern {
+                        self.expr(start);
+                        self.expr(end);
+                    }
+                    self.stmt(&mut arm.body);
+                }
+            }
+            Stmt::Assert {
+                condition, message, ..
+            } => {
+                self.expr(condition);
+                if let Some(message) = message {
+                    self.expr(message);
+                }
+            }
+            Stmt::Destructure { value, .. } => self.expr(value),
+            Stmt::Log {
+                message, extras, ..
+            } => {
+                self.expr(message);
+                for extra in extras {
+                    self.expr(extra);
+                }
+            }
+            Stmt::Hurl { message, .. } => self.expr(message),
+        }
+    }
+
+    fn expr(&mut self, expr: &mut Expr) {
+        match expr {
+            Expr::Literal { .. } | Expr::Masel { .. } => {}
+            Expr::Variable { name, slot, .. } => *slot = self.slot(name),
+            Expr::Assign {
+                name, value, slot, ..
+            } => {
+                self.expr(value);
+                *slot = self.slot(name);
+            }
+            Expr::Binary { left, right, .. }
+            | Expr::Logical { left, right, .. }
+            | Expr::Pipe { left, right, .. } => {
+                self.expr(left);
+                self.expr(right);
+            }
+            Expr::Unary { operand: expr, .. }
+            | Expr::Get { object: expr, .. }
+            | Expr::Grouping { expr, .. }
+            | Expr::Input { prompt: expr, .. }
+            | Expr::Spread { expr, .. } => self.expr(expr),
+            Expr::Call {
+                callee, arguments, ..
+            } => {
+                self.expr(callee);
+                for arg in arguments {
+                    self.expr(arg);
+                }
+            }
+            Expr::Set { object, value, .. } => {
+                self.expr(object);
+                self.expr(value);
+            }
+            Expr::Index { object, index, .. } => {
+                self.expr(object);
+                self.expr(index);
+            }
+            Expr::IndexSet {
+                object,
+                index,
+                value,
+                ..
+            } => {
+                self.expr(object);
+                self.expr(index);
+                self.expr(value);
+            }
+            Expr::Slice {
+                object,
+                start,
+                end,
+                step,
+                ..
+            } => {
+                self.expr(object);
+                for part in [start, end, step].into_iter().flatten() {
+                    self.expr(part);
+                }
+            }
+            Expr::List { elements, .. } => {
+                for element in elements {
+                    self.expr(element);
+                }
+            }
+            Expr::Dict { pairs, .. } => {
+                for (key, value) in pairs {
+                    self.expr(key);
+                    self.expr(value);
+                }
+            }
+            Expr::Range { start, end, .. } => {
+                self.expr(start);
+                self.expr(end);
+            }
+            Expr::Lambda { params, body, .. } => {
+                let mut scope = Scope::default();
+                for param in params.iter() {
+                    scope.declare(param);
+                }
+                scope.declare_expr(body);
+                self.with_scope(scope, |resolver| resolver.expr(body));
+            }
+            Expr::BlockExpr { statements, .. } => self.stmts(statements),
+            Expr::FString { parts, .. } => {
+                for part in parts {
+                    if let FStringPart::Expr(expr) = part {
+                        self.expr(expr);
+                    }
+                }
+            }
+            Expr::Ternary {
+                condition,
+                then_expr,
+                else_expr,
+                ..
+            } => {
+                self.expr(condition);
+                self.expr(then_expr);
+                self.expr(else_expr);
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::interpreter::Interpreter;
+    use crate::parser::parse;
+
+    fn run(source: &str) -> Vec<String> {
+        let program = parse(source).unwrap_or_else(|err| panic!("{}: {}", source, err));
+        let mut interp = Interpreter::new();
+        interp
+            .interpret(&program)
+            .unwrap_or_else(|err| panic!("{}: {}", source, err));
+        interp.get_output().to_vec()
+    }
+
+    /// The slots of every variable reference, in source order
+    fn slots(source: &str) -> Vec<(String, Option<Slot>)> {
+        fn collect(stmts: &[Stmt], out: &mut Vec<(String, Option<Slot>)>) {
+            for stmt in stmts {
+                match stmt {
+                    Stmt::Function { body, .. } => collect(body, out),
+                    Stmt::Block { statements, .. } => collect(statements, out),
+                    Stmt::VarDecl {
+                        initializer: Some(expr),
+                        ..
+                    }
+                    | Stmt::Expression { expr, .. }
+                    | Stmt::Return {
+                        value: Some(expr), ..
+                    }
+                    | Stmt::Print { value: expr, .. } => visit(expr, out),
+                    _ => {}
+                }
+            }
+        }
+        fn visit(expr: &Expr, out: &mut Vec<(String, Option<Slot>)>) {
+            match expr {
+                Expr::Variable { name, slot, .. } => out.push((name.clone(), *slot)),
+                Expr::Lambda { body, .. } => visit(body, out),
+                _ => for_each_child(expr, |child| visit(child, out)),
+            }
+        }
+        let program = parse(source).expect("parse");
+        let mut out = Vec::new();
+        collect(&program.statements, &mut out);
+        out
+    }
+
+    fn at(depth: u16, index: Option<u16>) -> Option<Slot> {
+        Some(Slot { depth, index })
+    }
+
+    #[test]
+    fn test_resolve_tags_locals_and_hops_to_globals() {
+        let got = slots("ken g = 1\ndae f(a) {\n ken b = a\n { ken c = b\n blether c + g }\n gie b\n}\nblether g");
+        let expected = [
+            ("a", at(0, Some(0))),
+            ("b", at(1, Some(1))),
+            ("c", at(0, Some(0))),
+            ("g", at(2, None)),
+            ("b", at(0, Some(1))),
+            ("g", None),
+        ];
+        let expected: Vec<_> = expected
+            .into_iter()
+            .map(|(name, slot)| (name.to_string(), slot))
+            .collect();
+        assert_eq!(got, expected);
+    }
+
+    #[test]
+    fn test_resolve_doesnt_hop_scopes_that_might_bind_the_name() {
+        // The `fer` variable, a later `ken` and a plain `fetch` all stop the hop at their scope
+        let got = slots("dae f(x) {\n { blether x\n fer x in [] {} }\n}");
+        assert_eq!(got[0], ("x".to_string(), at(0, Some(0))));
+        let got = slots("dae f(x) {\n { blether x\n ken x = 2 }\n}");
+        assert_eq!(got[0], ("x".to_string(), at(0, Some(0))));
+        let got = slots("dae f(x) {\n { fetch \"lib/maths\"\n blether x }\n}");
+        assert_eq!(got[0], ("x".to_string(), None));
+        let got = slots("dae f() {\n ken n = 1\n gie |y| y + n\n}");
+        assert_eq!(got[0], ("y".to_string(), at(0, Some(0))));
+        assert_eq!(got[1], ("n".to_string(), at(1, Some(0))));
+    }
+
+    #[test]
+    fn test_resolved_programs_run_as_before() {
+        for (source, expected) in [
+            // A `fer` loop that never runs leaves the outer name showing through
+            (
+                "ken i = \"global\"\ndae f() {\n { blether i\n fer i in [] {} }\n fer i in [1] {}\n gie i\n}\nblether f()",
+                "global\n1",
+            ),
+            // Shadowing before and after a ken in the same block
+            (
+                "dae f(x) {\n { blether x\n ken x = 2\n blether x }\n gie x\n}\nblether f(1)",
+                "1\n2\n1",
+            ),
+            // A method called through a plain function value has no masel in its frame
+            (
+                "kin K {\n dae m(a) { ken b = a * 2\n gie b }\n}\nken k = K()\nken m = k.m\nblether k.m(2)\nblether m(3)",
+                "4\n6",
+            ),
+            // Closures keep their own frame
+            (
+                "dae coonter() {\n ken n = 0\n gie || { n = n + 1\n gie n }\n}\nken c = coonter()\nc()\nblether c()",
+                "2",
+            ),
+            // Catch names, match bindings and block expressions land in the scope around them
+            (
+                "dae f(v) {\n hae_a_bash { hurl \"oops\" } gin_it_gangs_wrang e { blether e }\n keek v {\n whan 1 -> { blether \"yin\" }\n whan other -> { blether other }\n }\n}\nf(2)",
+                "Hurled at line 2: oops\n2",
+            ),
+            (
+                "dae f(n) {\n gin n < 2 { gie n }\n gie f(n - 1) + f(n - 2)\n}\nblether f(10)",
+                "55",
+            ),
+        ] {
+            assert_eq!(run(source).join("\n"), expected, "{}", source);
+        }
+    }
+}
@@ -391,17 +391,18 @@ impl fmt::Display for TokenKind {
     }
 }
 
-/// A token wi' its position in the source
+/// A token with its position in the source. The lexeme borrows from the source
+/// rather than owning a copy, so lexing doesn't allocate for every token.
 #[derive(Debug, Clone, PartialEq)]
-pub struct Token {
+pub struct Token<'src> {
     pub kind: TokenKind,
-    pub lexeme: String,
+    pub lexeme: &'src str,
     pub line: usize,
     pub column: usize,
 }
 
-impl Token {
-    pub fn new(kind: TokenKind, lexeme: String, line: usize, column: usize) -> Self {
+impl<'src> Token<'src> {
+    pub fn new(kind: TokenKind, lexeme: &'src str, line: usize, column: usize) -> Self {
         Token {
             kind,
             lexeme,
@@ -413,14 +414,14 @@ impl Token {
     pub fn eof(line: usize) -> Self {
         Token {
             kind: TokenKind::Eof,
-            lexeme: String::new(),
+            lexeme: "",
             line,
             column: 0,
         }
     }
 }
 
-impl fmt::Display for Token {
+impl fmt::Display for Token<'_> {
     fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
         write!(f, "{} at line {}", self.kind, self.line)
     }
@@ -548,7 +549,7 @@ mod tests {
 
     #[test]
     fn test_token_new() {
-        let token = Token::new(TokenKind::Ken, "ken".to_string(), 1, 5);
+        let token = Token::new(TokenKind::Ken, "ken", 1, 5);
         assert_eq!(token.kind, TokenKind::Ken);
         assert_eq!(token.lexeme, "ken");
         assert_eq!(token.line, 1);
@@ -566,10 +567,10 @@ mod tests {
 
     #[test]
     fn test_token_display() {
-        let token = Token::new(TokenKind::Ken, "ken".to_string(), 5, 1);
+        let token = Token::new(TokenKind::Ken, "ken", 5, 1);
         assert_eq!(format!("{}", token), "ken at line 5");
 
-        let token2 = Token::new(TokenKind::Integer(42), "42".to_string(), 3, 10);
+        let token2 = Token::new(TokenKind::Integer(42), "42", 3, 10);
         assert_eq!(format!("{}", token2), "42 at line 3");
     }
 }
@@ -103,7 +103,7 @@ struct TriObject {
 impl TriObject {
     fn new(kind: &'static str) -> Self {
         let mut fields = HashMap::new();
-        fields.insert("type".to_string(), Value::String(kind.to_string()));
+        fields.insert("type".to_string(), Value::String(kind.into()));
         if tri_has_transform(kind) {
             fields.insert("position".to_string(), make_vec3("Vec3", 0.0, 0.0, 0.0));
             fields.insert("rotation".to_string(), make_vec3("Euler", 0.0, 0.0, 0.0));
@@ -477,11 +477,11 @@ mod tests {
             Value::List(list) if list.borrow().len() == 1
         ));
 
-        obj.call("luik_at", vec![Value::String("target".to_string())])
+        obj.call("luik_at", vec![Value::String("target".into())])
             .unwrap();
         assert_eq!(
             obj.get("lookAtTarget").unwrap(),
-            Value::String("target".to_string())
+            Value::String("target".into())
         );
 
         obj.call("set_sise", vec![Value::Integer(640), Value::Integer(480)])
@@ -496,23 +496,16 @@ mod tests {
         obj.call(
             "render",
             vec![
-                Value::String("scene".to_string()),
-                Value::String("camera".to_string()),
+                Value::String("scene".into()),
+                Value::String("camera".into()),
             ],
         )
         .unwrap();
-        assert_eq!(
-            obj.get("scene").unwrap(),
-            Value::String("scene".to_string())
-        );
-        assert_eq!(
-            obj.get("camera").unwrap(),
-            Value::String("camera".to_string())
-        );
+        assert_eq!(obj.get("scene").unwrap(), Value::String("scene".into()));
+        assert_eq!(obj.get("camera").unwrap(), Value::String("camera".into()));
 
-        obj.call("loop", vec![Value::String("cb".to_string())])
-            .unwrap();
-        assert_eq!(obj.get("loopFn").unwrap(), Value::String("cb".to_string()));
+        obj.call("loop", vec![Value::String("cb".into())]).unwrap();
+        assert_eq!(obj.get("loopFn").unwrap(), Value::String("cb".into()));
 
         let cloned = obj.call("cloan", vec![]).unwrap();
         assert!(matches!(
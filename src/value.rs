@@ -1,11 +1,14 @@
 use std::any::Any;
-use std::cell::RefCell;
+use std::cell::{OnceCell, RefCell};
+use std::collections::hash_map::DefaultHasher;
 use std::collections::HashMap;
 use std::fmt;
+use std::hash::{Hash, Hasher};
 use std::rc::Rc;
 
-use crate::ast::{Expr, Stmt};
+use crate::ast::{Expr, Slot, Stmt};
 use crate::error::HaversResult;
+use crate::interpreter::bytecode::Chunk;
 
 #[derive(Debug, Clone, PartialEq, Eq, Hash)]
 pub enum ValueKey {
@@ -13,7 +16,7 @@ pub enum ValueKey {
     Bool(bool),
     Int(i64),
     Float(u64),
-    String(String),
+    String(Rc<str>),
     List(usize),
     Dict(usize),
     Set(usize),
@@ -40,6 +43,18 @@ pub trait NativeObject: fmt::Debug {
     fn to_string(&self) -> String {
         format!("<native {}>", self.type_name())
     }
+    /// Value equality with another native object; identity is checked first.
+    fn equals(&self, _other: &dyn NativeObject) -> bool {
+        false
+    }
+    /// How many items len() counts, for native collections.
+    fn length(&self) -> Option<usize> {
+        None
+    }
+    /// The items a `fer` loop walks, in order, for native collections.
+    fn items(&self) -> Option<Vec<Value>> {
+        None
+    }
 }
 
 /// Runtime values in mdhavers
@@ -49,8 +64,8 @@ pub enum Value {
     Integer(i64),
     /// Floating point number
     Float(f64),
-    /// String
-    String(String),
+    /// String, shared between copies; cloning one is a reference count bump
+    String(Rc<str>),
     /// Boolean (aye/nae)
     Bool(bool),
     /// Null value (naething)
@@ -208,6 +223,56 @@ impl Value {
             },
         }
     }
+
+    /// A hash consistent with `==`: numbers hash alike across int/float, lists and bytes
+    /// by content, everything else by identity.
+    pub fn eq_hash(&self) -> u64 {
+        let mut h = DefaultHasher::new();
+        self.hash_eq_into(&mut h);
+        h.finish()
+    }
+
+    fn hash_eq_into(&self, h: &mut DefaultHasher) {
+        const EXACT: i64 = 1 << 53;
+        match self {
+            Value::Integer(n) if (-EXACT..=EXACT).contains(n) => n.hash(h),
+            Value::Integer(n) => hash_float_eq(*n as f64, h),
+            Value::Float(f) => hash_float_eq(*f, h),
+            Value::List(items) => {
+                let items = items.borrow();
+                items.len().hash(h);
+                for item in items.iter() {
+                    item.hash_eq_into(h);
+                }
+            }
+            Value::Bytes(bytes) => bytes.borrow().hash(h),
+            Value::NativeObject(obj) => obj.type_name().hash(h),
+            other => other.as_key().hash(h),
+        }
+    }
+}
+
+/// Integral floats within ±2^53 hash as the integer they equal.
+fn hash_float_eq(f: f64, h: &mut DefaultHasher) {
+    if f.fract() == 0.0 && f.abs() <= (1u64 << 53) as f64 {
+        (f as i64).hash(h);
+    } else {
+        f.to_bits().hash(h);
+    }
+}
+
+/// The items with later `==` duplicates dropped, in order, bucketed by `eq_hash`.
+pub fn dedup_values<'a>(items: impl IntoIterator<Item = &'a Value>) -> Vec<Value> {
+    let mut seen: HashMap<u64, Vec<usize>> = HashMap::new();
+    let mut out: Vec<Value> = Vec::new();
+    for item in items {
+        let bucket = seen.entry(item.eq_hash()).or_default();
+        if !bucket.iter().any(|&i| out[i] == *item) {
+            bucket.push(out.len());
+            out.push(item.clone());
+        }
+    }
+    out
 }
 
 impl fmt::Display for Value {
@@ -279,7 +344,9 @@ impl PartialEq for Value {
             (Value::Class(a), Value::Class(b)) => Rc::ptr_eq(a, b),
             (Value::Instance(a), Value::Instance(b)) => Rc::ptr_eq(a, b),
             (Value::Struct(a), Value::Struct(b)) => Rc::ptr_eq(a, b),
-            (Value::NativeObject(a), Value::NativeObject(b)) => Rc::ptr_eq(a, b),
+            (Value::NativeObject(a), Value::NativeObject(b)) => {
+                Rc::ptr_eq(a, b) || a.equals(b.as_ref())
+            }
             _ => false,
         }
     }
@@ -299,6 +366,19 @@ impl DictValue {
         }
     }
 
+    pub fn with_capacity(capacity: usize) -> Self {
+        DictValue {
+            index: HashMap::with_capacity(capacity),
+            entries: Vec::with_capacity(capacity),
+        }
+    }
+
+    /// Make room for `additional` more entries so a bulk fill never regrows.
+    pub fn reserve(&mut self, additional: usize) {
+        self.index.reserve(additional);
+        self.entries.reserve(additional);
+    }
+
     pub fn len(&self) -> usize {
         self.entries.len()
     }
@@ -466,6 +546,9 @@ pub struct HaversFunction {
     pub params: Vec<FunctionParam>,
     pub body: Vec<Stmt>,
     pub closure: Option<Rc<RefCell<Environment>>>,
+    /// The body's bytecode, compiled on the first call in bytecode mode; `None` inside
+    /// when the body uses something only the tree-walker runs
+    pub(crate) compiled: OnceCell<Option<Rc<Chunk>>>,
 }
 
 impl HaversFunction {
@@ -480,6 +563,7 @@ impl HaversFunction {
             params,
             body,
             closure,
+            compiled: OnceCell::new(),
         }
     }
 
@@ -609,6 +693,16 @@ impl RangeValue {
         }
     }
 
+    /// How many integers the range yields, without walking it.
+    pub fn len(&self) -> usize {
+        let end = self.end as i128 + i128::from(self.inclusive);
+        (end - self.start as i128).max(0) as usize
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
     pub fn iter(&self) -> RangeIterator {
         RangeIterator {
             current: self.start,
@@ -644,35 +738,75 @@ impl Iterator for RangeIterator {
     }
 }
 
+/// Scopes with more bindings than this get a name index; smaller ones (function
+/// frames, loop bodies) are scanned in order, which beats hashing at that size
+const ENVIRONMENT_INDEX_THRESHOLD: usize = 8;
+
 /// Environment for variable bindings
+///
+/// Bindings live in parallel vectors so that a fresh scope costs no more than
+/// the names it defines. Big scopes (globals, modules) also keep a name → slot
+/// map once they pass `ENVIRONMENT_INDEX_THRESHOLD`.
 #[derive(Debug)]
 pub struct Environment {
-    values: HashMap<String, Value>,
+    names: Vec<String>,
+    values: Vec<Value>,
+    index: Option<HashMap<String, usize>>,
     enclosing: Option<Rc<RefCell<Environment>>>,
 }
 
 impl Environment {
     pub fn new() -> Self {
         Environment {
-            values: HashMap::new(),
+            names: Vec::new(),
+            values: Vec::new(),
+            index: None,
             enclosing: None,
         }
     }
 
     pub fn with_enclosing(enclosing: Rc<RefCell<Environment>>) -> Self {
         Environment {
-            values: HashMap::new(),
+            names: Vec::new(),
+            values: Vec::new(),
+            index: None,
             enclosing: Some(enclosing),
         }
     }
 
+    /// Slot of `name` in this scope alone
+    fn slot(&self, name: &str) -> Option<usize> {
+        match &self.index {
+            Some(index) => index.get(name).copied(),
+            None => self.names.iter().position(|n| n == name),
+        }
+    }
+
     pub fn define(&mut self, name: String, value: Value) {
-        self.values.insert(name, value);
+        if let Some(slot) = self.slot(&name) {
+            self.values[slot] = value;
+            return;
+        }
+        let slot = self.names.len();
+        if let Some(index) = &mut self.index {
+            index.insert(name.clone(), slot);
+        } else if slot >= ENVIRONMENT_INDEX_THRESHOLD {
+            let mut index: HashMap<String, usize> = self
+                .names
+                .iter()
+                .enumerate()
+                .map(|(i, n)| (n.clone(), i))
+                .collect();
+            index.insert(name.clone(), slot);
+            self.index = Some(index);
+        }
+        self.names.push(name);
+        self.values.push(value);
     }
 
     pub fn get(&self, name: &str) -> Option<Value> {
-        if let Some(value) = self.values.get(name) {
-            return Some(value.clone());
+        if let Some(slot) = self.slot(name) {
+            return Some(self.values[slot].clone());
         }
         if let Some(enclosing) = &self.enclosing {
             return enclosing.borrow().get(name);
@@ -681,8 +815,8 @@ impl Environment {
     }
 
     pub fn assign(&mut self, name: &str, value: Value) -> bool {
-        if self.values.contains_key(name) {
-            self.values.insert(name.to_string(), value);
+        if let Some(slot) = self.slot(name) {
+            self.values[slot] = value;
             return true;
         }
         if let Some(enclosing) = &self.enclosing {
@@ -691,10 +825,60 @@ impl Environment {
         false
     }
 
+    /// `get` for a name the resolver placed `slot.depth` scopes up. The index is checked
+    /// against the name, so a scope laid out differently at runtime (a method frame
+    /// with `masel`, a loop that never ran) falls back to the search by name from there.
+    pub fn get_at(&self, slot: Slot, name: &str) -> Option<Value> {
+        if slot.depth > 0 {
+            return match &self.enclosing {
+                Some(enclosing) => enclosing.borrow().get_at(
+                    Slot {
+                        depth: slot.depth - 1,
+                        ..slot
+                    },
+                    name,
+                ),
+                None => self.get(name),
+            };
+        }
+        match slot.index.map(usize::from) {
+            Some(i) if self.names.get(i).is_some_and(|n| n == name) => Some(self.values[i].clone()),
+            _ => self.get(name),
+        }
+    }
+
+    /// `assign` for a name the resolver placed, checked the same way as `get_at`
+    pub fn assign_at(&mut self, slot: Slot, name: &str, value: Value) -> bool {
+        if slot.depth > 0 {
+            return match &self.enclosing {
+                Some(enclosing) => enclosing.borrow_mut().assign_at(
+                    Slot {
+                        depth: slot.depth - 1,
+                        ..slot
+                    },
+                    name,
+                    value,
+                ),
+                None => self.assign(name, value),
+            };
+        }
+        match slot.index.map(usize::from) {
+            Some(i) if self.names.get(i).is_some_and(|n| n == name) => {
+                self.values[i] = value;
+                true
+            }
+            _ => self.assign(name, value),
+        }
+    }
+
     /// Get all values defined in this environment (not including enclosing)
     /// Used fer module exports
     pub fn get_exports(&self) -> HashMap<String, Value> {
-        self.values.clone()
+        self.names
+            .iter()
+            .cloned()
+            .zip(self.values.iter().cloned())
+            .collect()
     }
 }
 
@@ -740,7 +924,7 @@ mod tests {
     fn test_value_type_name_all_types() {
         assert_eq!(Value::Integer(42).type_name(), "integer");
         assert_eq!(Value::Float(3.14).type_name(), "float");
-        assert_eq!(Value::String("hello".to_string()).type_name(), "string");
+        assert_eq!(Value::String("hello".into()).type_name(), "string");
         assert_eq!(Value::Bool(true).type_name(), "bool");
         assert_eq!(Value::Bool(false).type_name(), "bool");
         assert_eq!(Value::Nil.type_name(), "naething");
@@ -845,9 +1029,9 @@ mod tests {
         assert!(Value::Float(3.14).is_truthy());
 
         // Empty string is falsy, non-empty truthy
-        assert!(!Value::String("".to_string()).is_truthy());
-        assert!(Value::String("hello".to_string()).is_truthy());
-        assert!(Value::String(" ".to_string()).is_truthy());
+        assert!(!Value::String("".into()).is_truthy());
+        assert!(Value::String("hello".into()).is_truthy());
+        assert!(Value::String(" ".into()).is_truthy());
 
         // Empty list is falsy, non-empty truthy
         let empty_list = Value::List(Rc::new(RefCell::new(vec![])));
@@ -858,7 +1042,7 @@ mod tests {
         // Empty set is falsy, non-empty truthy
         let empty_set = Value::Set(Rc::new(RefCell::new(SetValue::new())));
         let mut non_empty = SetValue::new();
-        non_empty.insert(Value::String("item".to_string()));
+        non_empty.insert(Value::String("item".into()));
         let non_empty_set = Value::Set(Rc::new(RefCell::new(non_empty)));
         assert!(!empty_set.is_truthy());
         assert!(non_empty_set.is_truthy());
@@ -891,7 +1075,7 @@ mod tests {
         assert_eq!(Value::Integer(42).as_integer(), Some(42));
         assert_eq!(Value::Float(3.7).as_integer(), Some(3)); // truncates
         assert_eq!(Value::Float(3.2).as_integer(), Some(3));
-        assert_eq!(Value::String("hello".to_string()).as_integer(), None);
+        assert_eq!(Value::String("hello".into()).as_integer(), None);
         assert_eq!(Value::Bool(true).as_integer(), None);
         assert_eq!(Value::Nil.as_integer(), None);
     }
@@ -900,17 +1084,14 @@ mod tests {
     fn test_value_as_float() {
         assert_eq!(Value::Float(3.14).as_float(), Some(3.14));
         assert_eq!(Value::Integer(42).as_float(), Some(42.0));
-        assert_eq!(Value::String("hello".to_string()).as_float(), None);
+        assert_eq!(Value::String("hello".into()).as_float(), None);
         assert_eq!(Value::Bool(true).as_float(), None);
         assert_eq!(Value::Nil.as_float(), None);
     }
 
     #[test]
     fn test_value_as_string() {
-        assert_eq!(
-            Value::String("hello".to_string()).as_string(),
-            Some("hello")
-        );
+        assert_eq!(Value::String("hello".into()).as_string(), Some("hello"));
         assert_eq!(Value::Integer(42).as_string(), None);
         assert_eq!(Value::Float(3.14).as_string(), None);
         assert_eq!(Value::Bool(true).as_string(), None);
@@ -924,7 +1105,7 @@ mod tests {
         assert_eq!(format!("{}", Value::Integer(42)), "42");
         assert_eq!(format!("{}", Value::Integer(-123)), "-123");
         assert_eq!(format!("{}", Value::Float(3.14)), "3.14");
-        assert_eq!(format!("{}", Value::String("hello".to_string())), "hello");
+        assert_eq!(format!("{}", Value::String("hello".into())), "hello");
         assert_eq!(format!("{}", Value::Bool(true)), "aye");
         assert_eq!(format!("{}", Value::Bool(false)), "nae");
         assert_eq!(format!("{}", Value::Nil), "naething");
@@ -960,7 +1141,7 @@ mod tests {
         assert_eq!(format!("{}", empty), "{}");
 
         let mut map = DictValue::new();
-        map.set(Value::String("a".to_string()), Value::Integer(1));
+        map.set(Value::String("a".into()), Value::Integer(1));
         let single = Value::Dict(Rc::new(RefCell::new(map)));
         assert_eq!(format!("{}", single), "{\"a\": 1}");
     }
@@ -971,13 +1152,13 @@ mod tests {
         assert_eq!(format!("{}", empty), "creel{}");
 
         let mut set = SetValue::new();
-        set.insert(Value::String("a".to_string()));
+        set.insert(Value::String("a".into()));
         let single = Value::Set(Rc::new(RefCell::new(set)));
         assert_eq!(format!("{}", single), "creel{\"a\"}");
 
         let mut multi_set = SetValue::new();
-        multi_set.insert(Value::String("a".to_string()));
-        multi_set.insert(Value::String("b".to_string()));
+        multi_set.insert(Value::String("a".into()));
+        multi_set.insert(Value::String("b".into()));
         let multi = Value::Set(Rc::new(RefCell::new(multi_set)));
         // Sorted output
         assert_eq!(format!("{}", multi), "creel{\"a\", \"b\"}");
@@ -1054,14 +1235,8 @@ mod tests {
 
     #[test]
     fn test_value_equality_strings() {
-        assert_eq!(
-            Value::String("hello".to_string()),
-            Value::String("hello".to_string())
-        );
-        assert_ne!(
-            Value::String("hello".to_string()),
-            Value::String("world".to_string())
-        );
+        assert_eq!(Value::String("hello".into()), Value::String("hello".into()));
+        assert_ne!(Value::String("hello".into()), Value::String("world".into()));
     }
 
     #[test]
@@ -1097,7 +1272,7 @@ mod tests {
 
     #[test]
     fn test_value_equality_different_types() {
-        assert_ne!(Value::Integer(42), Value::String("42".to_string()));
+        assert_ne!(Value::Integer(42), Value::String("42".into()));
         assert_ne!(Value::Bool(true), Value::Integer(1));
         assert_ne!(Value::Nil, Value::Integer(0));
         assert_ne!(Value::Nil, Value::Bool(false));
@@ -1201,7 +1376,7 @@ mod tests {
         });
         assert_eq!(native.name, "len");
         assert_eq!(native.arity, 1);
-        let result = (native.func)(vec![Value::String("abcd".to_string())]).unwrap();
+        let result = (native.func)(vec![Value::String("abcd".into())]).unwrap();
         assert_eq!(result, Value::Integer(4));
         let err = (native.func)(vec![Value::Integer(1)]).unwrap_err();
         assert_eq!(err, "Expected string");
@@ -1220,7 +1395,7 @@ mod tests {
         let result = (native.func)(vec![Value::Integer(21)]);
         assert_eq!(result, Ok(Value::Integer(42)));
 
-        let error = (native.func)(vec![Value::String("x".to_string())]);
+        let error = (native.func)(vec![Value::String("x".into())]);
         assert!(error.is_err());
     }
 
@@ -1316,13 +1491,10 @@ mod tests {
         let class = Rc::new(HaversClass::new("Person".to_string(), None));
         let mut instance = HaversInstance::new(class);
 
-        instance.set("name".to_string(), Value::String("Alice".to_string()));
+        instance.set("name".to_string(), Value::String("Alice".into()));
         instance.set("age".to_string(), Value::Integer(30));
 
-        assert_eq!(
-            instance.get("name"),
-            Some(Value::String("Alice".to_string()))
-        );
+        assert_eq!(instance.get("name"), Some(Value::String("Alice".into())));
         assert_eq!(instance.get("age"), Some(Value::Integer(30)));
         assert_eq!(instance.get("nonexistent"), None);
     }
@@ -1560,6 +1732,22 @@ mod tests {
         assert!(!exports.contains_key("outer"));
     }
 
+    #[test]
+    fn test_environment_large_scopes_keep_their_bindings() {
+        let mut env = Environment::new();
+        for i in 0..(ENVIRONMENT_INDEX_THRESHOLD as i64 * 3) {
+            env.define(format!("v{}", i), Value::Integer(i));
+        }
+        assert!(env.index.is_some());
+
+        env.define("v0".to_string(), Value::Integer(-1));
+        assert!(env.assign("v20", Value::Integer(-20)));
+        assert_eq!(env.get("v0"), Some(Value::Integer(-1)));
+        assert_eq!(env.get("v7"), Some(Value::Integer(7)));
+        assert_eq!(env.get("v20"), Some(Value::Integer(-20)));
+        assert_eq!(env.get_exports().len(), ENVIRONMENT_INDEX_THRESHOLD * 3);
+    }
+
     #[test]
     fn test_value_as_key_variants() {
         assert!(matches!(Value::Nil.as_key(), ValueKey::Nil));
@@ -1567,7 +1755,7 @@ mod tests {
         assert!(matches!(Value::Integer(3).as_key(), ValueKey::Int(3)));
         assert!(matches!(Value::Float(1.5).as_key(), ValueKey::Float(_)));
         assert!(matches!(
-            Value::String("x".to_string()).as_key(),
+            Value::String("x".into()).as_key(),
             ValueKey::String(_)
         ));
 
@@ -1696,19 +1884,47 @@ mod tests {
     #[test]
     fn test_dict_value_set_overwrites_existing_key() {
         let mut dict = DictValue::new();
-        dict.set(Value::String("a".to_string()), Value::Integer(1));
+        dict.set(Value::String("a".into()), Value::Integer(1));
         assert_eq!(
-            dict.get(&Value::String("a".to_string()))
+            dict.get(&Value::String("a".into()))
                 .and_then(Value::as_integer),
             Some(1)
         );
 
-        dict.set(Value::String("a".to_string()), Value::Integer(2));
+        dict.set(Value::String("a".into()), Value::Integer(2));
         assert_eq!(
-            dict.get(&Value::String("a".to_string()))
+            dict.get(&Value::String("a".into()))
                 .and_then(Value::as_integer),
             Some(2)
         );
         assert_eq!(dict.len(), 1);
     }
+
+    #[test]
+    fn test_dedup_values_follows_value_equality() {
+        let list = |items: Vec<Value>| Value::List(Rc::new(RefCell::new(items)));
+        let items = vec![
+            Value::Integer(2),
+            Value::Float(2.0),
+            Value::String("ab".into()),
+            Value::String("ab".into()),
+            list(vec![Value::Integer(1)]),
+            list(vec![Value::Float(1.0)]),
+            Value::Float(2.5),
+            Value::Integer(1 << 60),
+            Value::Float((1i64 << 60) as f64),
+        ];
+        assert_eq!(Value::Integer(3).eq_hash(), Value::Float(3.0).eq_hash());
+        let out = dedup_values(items.iter());
+        assert_eq!(
+            out,
+            vec![
+                Value::Integer(2),
+                Value::String("ab".into()),
+                list(vec![Value::Integer(1)]),
+                Value::Float(2.5),
+                Value::Integer(1 << 60),
+            ]
+        );
+    }
 }
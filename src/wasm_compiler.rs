@@ -7,11 +7,21 @@
 //! - Functions
 //! - Basic control flow (if/while)
 //!
+//! Every value is an i64 handle into the host's value store, so by default each literal
+//! and each arithmetic result is a host call. [`WasmCompiler::with_unboxed_scalars`] keeps
+//! locals that only ever hold ints, floats or bools as raw i64/f64/i32 instead, and does
+//! their arithmetic, comparisons and conditions in WASM; they're boxed only when they leave
+//! for the host (printing, lists, calls and the like).
+//!
+//! Strings, lists, dicts and objects are host handles in both modes. Linear memory holds
+//! only the string literal data (from offset 0) and main's spilled GC roots (just below
+//! `GC_ROOTS_END`); there is no in-module allocator yet.
+//!
 //! Note: This is an experimental feature - no' aw mdhavers features are supported!
 
 use crate::ast::*;
 use crate::error::{HaversError, HaversResult};
-use std::collections::{BTreeSet, HashSet};
+use std::collections::{BTreeSet, HashMap, HashSet};
 
 const AUDIO_IMPORTS: &[(&str, &str)] = &[
     (
@@ -199,6 +209,7 @@ const AUDIO_IMPORTS: &[(&str, &str)] = &[
 #[derive(Debug, Default)]
 struct WasmImportRequirements {
     needs_tri_module: bool,
+    needs_gc_safepoints: bool,
     audio_imports: BTreeSet<String>,
 }
 
@@ -214,6 +225,9 @@ impl WasmImportRequirements {
         let mut req = Self::default();
         for stmt in &program.statements {
             req.scan_stmt(stmt, &defined_functions);
+            if !matches!(stmt, Stmt::Function { .. }) && contains_loop(stmt) {
+                req.needs_gc_safepoints = true;
+            }
         }
         req
     }
@@ -438,6 +452,63 @@ pub struct WasmCompiler {
     local_vars: Vec<String>,
     func_params: Vec<String>,
     string_data: Vec<String>,
+    unboxed: bool,
+    /// Locals of the current function held unboxed, by type
+    scalar_locals: HashMap<String, Scalar>,
+    /// Whether main's loops give the host a chance to collect handles
+    gc_safepoints: bool,
+    in_main: bool,
+    /// Where main spills its handle locals for a collection, and how many there are
+    gc_roots: Option<(usize, Vec<String>)>,
+}
+
+/// Main's handle locals are spilled below the end of the first memory page, clear of the
+/// string data growing up from 0
+const GC_ROOTS_END: usize = 65536;
+
+/// A value kept in a WASM register rather than the host store
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum Scalar {
+    /// i64
+    Int,
+    /// f64
+    Float,
+    /// i32, 0 or 1
+    Bool,
+}
+
+impl Scalar {
+    fn wasm_type(self) -> &'static str {
+        match self {
+            Scalar::Int => "i64",
+            Scalar::Float => "f64",
+            Scalar::Bool => "i32",
+        }
+    }
+
+    fn is_number(self) -> bool {
+        matches!(self, Scalar::Int | Scalar::Float)
+    }
+}
+
+/// What local type inference knows about an expression
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum StaticType {
+    /// Depends on a local no assignment has given a type yet
+    Pending,
+    Scalar(Scalar),
+    /// A host handle
+    Boxed,
+}
+
+impl StaticType {
+    fn join(self, other: StaticType) -> StaticType {
+        match (self, other) {
+            (StaticType::Pending, t) | (t, StaticType::Pending) => t,
+            (a, b) if a == b => a,
+            _ => StaticType::Boxed,
+        }
+    }
 }
 
 const TMP_LOGIC: &str = "__mdh$tmp0";
@@ -457,14 +528,27 @@ impl WasmCompiler {
             local_vars: Vec::new(),
             func_params: Vec::new(),
             string_data: Vec::new(),
+            unboxed: false,
+            scalar_locals: HashMap::new(),
+            gc_safepoints: false,
+            in_main: false,
+            gc_roots: None,
         }
     }
 
+    /// Keep int, float and bool locals unboxed (see the module docs)
+    pub fn with_unboxed_scalars(mut self) -> Self {
+        self.unboxed = true;
+        self
+    }
+
     /// Compile a program tae WAT (WebAssembly Text Format)
     pub fn compile(&mut self, program: &Program) -> HaversResult<String> {
         self.output.clear();
         self.string_data.clear();
+        self.gc_roots = None;
         let import_requirements = WasmImportRequirements::from_program(program);
+        self.gc_safepoints = import_requirements.needs_gc_safepoints;
 
         // Start the module
         self.emit("(module");
@@ -536,6 +620,14 @@ impl WasmCompiler {
                 "(import \"env\" \"__mdh_tri_module\" (func $mdh_tri_module (result i64)))",
             );
         }
+        if self.gc_safepoints {
+            self.emit_line(
+                "(import \"env\" \"__mdh_gc_wanted\" (func $mdh_gc_wanted (result i32)))",
+            );
+            self.emit_line(
+                "(import \"env\" \"__mdh_gc_collect\" (func $mdh_gc_collect (param i32 i32)))",
+            );
+        }
 
         if !import_requirements.audio_imports.is_empty() {
             self.emit_line("");
@@ -573,6 +665,15 @@ impl WasmCompiler {
         self.emit_line("");
         self.emit_line("(export \"main\" (func $main))");
 
+        let string_end = self.string_data.iter().map(|s| s.len() + 1).sum::<usize>();
+        if let Some((base, _)) = &self.gc_roots {
+            if string_end > *base {
+                return Err(HaversError::InternalError(
+                    "Too many strings fer the WASM memory page".to_string(),
+                ));
+            }
+        }
+
         // Add string data section if we have strings
         if !self.string_data.is_empty() {
             self.emit_line("");
@@ -624,6 +725,7 @@ impl WasmCompiler {
 
             // Collect locals from body
             self.collect_locals(body);
+            self.infer_scalar_locals(body.iter());
 
             self.ensure_temp_locals();
 
@@ -631,7 +733,7 @@ impl WasmCompiler {
             let local_decls: Vec<String> = self
                 .local_vars
                 .iter()
-                .map(|var| format!("(local ${} i64)", var))
+                .map(|var| format!("(local ${} {})", var, self.local_wasm_type(var)))
                 .collect();
             for decl in local_decls {
                 self.emit_line(&decl);
@@ -663,19 +765,38 @@ impl WasmCompiler {
         for stmt in stmts {
             self.collect_locals_stmt(stmt);
         }
+        self.infer_scalar_locals(stmts.iter().copied());
 
         self.ensure_temp_locals();
 
         // Declare locals
         for var in &self.local_vars.clone() {
-            self.emit_line(&format!("(local ${} i64)", var));
+            let decl = format!("(local ${} {})", var, self.local_wasm_type(var));
+            self.emit_line(&decl);
         }
 
-        // Compile statements
-        for stmt in stmts {
-            self.compile_stmt(stmt)?;
+        if self.gc_safepoints {
+            // Only handle locals are roots; the temporaries are dead between statements
+            let roots: Vec<String> = self
+                .local_vars
+                .iter()
+                .filter(|var| {
+                    !self.scalar_locals.contains_key(*var)
+                        && var.as_str() != TMP_LOGIC
+                        && var.as_str() != TMP_BUILD
+                })
+                .cloned()
+                .collect();
+            let base = GC_ROOTS_END.saturating_sub(roots.len() * 8);
+            self.gc_roots = Some((base, roots));
         }
 
+        // Compile statements
+        self.in_main = true;
+        let compiled = stmts.iter().try_for_each(|stmt| self.compile_stmt(stmt));
+        self.in_main = false;
+        compiled?;
+
         // Return nil
         self.emit_nil();
 
@@ -745,6 +866,36 @@ impl WasmCompiler {
         }
     }
 
+    /// At the top of each loop in main, where no handle is on the operand stack and no
+    /// other function is running, let the host collect once it has allocated enough. The
+    /// handles main holds are spilled to memory for it to read as roots.
+    fn emit_gc_safepoint(&mut self) {
+        if !self.in_main {
+            return;
+        }
+        let (base, roots) = match &self.gc_roots {
+            Some((base, roots)) => (*base, roots.clone()),
+            None => return,
+        };
+        self.emit_line("(call $mdh_gc_wanted)");
+        self.emit_line("(if");
+        self.indent += 1;
+        self.emit_line("(then");
+        self.indent += 1;
+        for (i, root) in roots.iter().enumerate() {
+            self.emit_line(&format!("(i32.const {})", base + i * 8));
+            self.emit_line(&format!("(local.get ${})", root));
+            self.emit_line("(i64.store)");
+        }
+        self.emit_line(&format!("(i32.const {})", base));
+        self.emit_line(&format!("(i32.const {})", roots.len()));
+        self.emit_line("(call $mdh_gc_collect)");
+        self.indent -= 1;
+        self.emit_line(")");
+        self.indent -= 1;
+        self.emit_line(")");
+    }
+
     fn emit_nil(&mut self) {
         self.emit_line("(call $mdh_make_nil)");
     }
@@ -766,6 +917,270 @@ impl WasmCompiler {
         self.func_params.iter().any(|n| n == name) || self.local_vars.iter().any(|n| n == name)
     }
 
+    fn local_wasm_type(&self, name: &str) -> &'static str {
+        self.scalar_locals
+            .get(name)
+            .map_or("i64", |scalar| scalar.wasm_type())
+    }
+
+    /// Work out which locals only ever hold one scalar type. Starts from every local
+    /// pending and widens until nothing changes, so `ken i = 0` then `i = i + 1` stays
+    /// an int.
+    fn infer_scalar_locals<'a>(&mut self, stmts: impl Iterator<Item = &'a Stmt>) {
+        self.scalar_locals.clear();
+        if !self.unboxed {
+            return;
+        }
+
+        let mut assignments = Vec::new();
+        for stmt in stmts {
+            collect_assignments_stmt(stmt, &mut assignments);
+        }
+
+        let mut types: HashMap<String, StaticType> = self
+            .local_vars
+            .iter()
+            .map(|name| (name.clone(), StaticType::Pending))
+            .collect();
+        // Locals nothing assigns (fetch aliases, loop variables) stay handles
+        for name in self.local_vars.iter() {
+            if !assignments.iter().any(|(assigned, _)| assigned == name) {
+                types.insert(name.clone(), StaticType::Boxed);
+            }
+        }
+
+        loop {
+            let mut changed = false;
+            for (name, value) in &assignments {
+                let current = match types.get(*name) {
+                    Some(&current) => current,
+                    None => continue,
+                };
+                let assigned = match value {
+                    Some(expr) => static_type(expr, &|name| {
+                        types.get(name).copied().unwrap_or(StaticType::Boxed)
+                    }),
+                    None => StaticType::Boxed,
+                };
+                let joined = current.join(assigned);
+                if joined != current {
+                    types.insert(name.to_string(), joined);
+                    changed = true;
+                }
+            }
+            if changed {
+                continue;
+            }
+            // Locals only ever assigned from each other are handles; that can widen the
+            // locals they feed, so go round again
+            let mut settled = true;
+            for ty in types.values_mut() {
+                if *ty == StaticType::Pending {
+                    *ty = StaticType::Boxed;
+                    settled = false;
+                }
+            }
+            if settled {
+                break;
+            }
+        }
+
+        for (name, ty) in types {
+            if let StaticType::Scalar(scalar) = ty {
+                self.scalar_locals.insert(name, scalar);
+            }
+        }
+    }
+
+    /// The unboxed type `expr` compiles to, if it has one
+    fn scalar_type(&self, expr: &Expr) -> Option<Scalar> {
+        if !self.unboxed {
+            return None;
+        }
+        let local_type = |name: &str| {
+            self.scalar_locals
+                .get(name)
+                .map_or(StaticType::Boxed, |&scalar| StaticType::Scalar(scalar))
+        };
+        match static_type(expr, &local_type) {
+            StaticType::Scalar(scalar) => Some(scalar),
+            _ => None,
+        }
+    }
+
+    /// Compile `expr`, known to be of type `scalar`, leaving the raw value on the stack
+    fn compile_scalar(&mut self, expr: &Expr, scalar: Scalar) -> HaversResult<()> {
+        match expr {
+            Expr::Literal { value, .. } => match value {
+                Literal::Integer(n) => self.emit_line(&format!("(i64.const {})", n)),
+                Literal::Float(f) => self.emit_line(&format!("(f64.const {})", f)),
+                Literal::Bool(b) => self.emit_line(&format!("(i32.const {})", *b as i32)),
+                _ => return Err(scalar_mismatch()),
+            },
+
+            Expr::Variable { name, .. } => {
+                self.emit_line(&format!("(local.get ${})", name));
+            }
+
+            Expr::Assign { name, value, .. } => {
+                self.compile_scalar(value, scalar)?;
+                self.emit_line(&format!("(local.tee ${})", name));
+            }
+
+            Expr::Grouping { expr, .. } => self.compile_scalar(expr, scalar)?,
+
+            Expr::Binary {
+                left,
+                operator,
+                right,
+                ..
+            } => {
+                let left_type = self.scalar_type(left).ok_or_else(scalar_mismatch)?;
+                let right_type = self.scalar_type(right).ok_or_else(scalar_mismatch)?;
+                // Compare bools as i32, ints as i64 and anything with a float in it as f64
+                let operands = if left_type == Scalar::Bool {
+                    Scalar::Bool
+                } else if left_type == Scalar::Int && right_type == Scalar::Int {
+                    Scalar::Int
+                } else {
+                    Scalar::Float
+                };
+                self.compile_scalar_as(left, left_type, operands)?;
+                self.compile_scalar_as(right, right_type, operands)?;
+                let op = match (operator, operands) {
+                    (BinaryOp::Add, Scalar::Int) => "i64.add",
+                    (BinaryOp::Subtract, Scalar::Int) => "i64.sub",
+                    (BinaryOp::Multiply, Scalar::Int) => "i64.mul",
+                    (BinaryOp::Add, _) => "f64.add",
+                    (BinaryOp::Subtract, _) => "f64.sub",
+                    (BinaryOp::Multiply, _) => "f64.mul",
+                    (BinaryOp::Divide, _) => "f64.div",
+                    (BinaryOp::Equal, Scalar::Bool) => "i32.eq",
+                    (BinaryOp::NotEqual, Scalar::Bool) => "i32.ne",
+                    (BinaryOp::Equal, Scalar::Int) => "i64.eq",
+                    (BinaryOp::NotEqual, Scalar::Int) => "i64.ne",
+                    (BinaryOp::Less, Scalar::Int) => "i64.lt_s",
+                    (BinaryOp::LessEqual, Scalar::Int) => "i64.le_s",
+                    (BinaryOp::Greater, Scalar::Int) => "i64.gt_s",
+                    (BinaryOp::GreaterEqual, Scalar::Int) => "i64.ge_s",
+                    (BinaryOp::Equal, _) => "f64.eq",
+                    (BinaryOp::NotEqual, _) => "f64.ne",
+                    (BinaryOp::Less, _) => "f64.lt",
+                    (BinaryOp::LessEqual, _) => "f64.le",
+                    (BinaryOp::Greater, _) => "f64.gt",
+                    (BinaryOp::GreaterEqual, _) => "f64.ge",
+                    (BinaryOp::Modulo, _) => return Err(scalar_mismatch()),
+                };
+                self.emit_line(&format!("({})", op));
+            }
+
+            Expr::Unary {
+                operator, operand, ..
+            } => {
+                let operand_type = self.scalar_type(operand).ok_or_else(scalar_mismatch)?;
+                match (operator, operand_type) {
+                    (UnaryOp::Negate, Scalar::Int) => {
+                        self.emit_line("(i64.const 0)");
+                        self.compile_scalar(operand, Scalar::Int)?;
+                        self.emit_line("(i64.sub)");
+                    }
+                    (UnaryOp::Negate, Scalar::Float) => {
+                        self.compile_scalar(operand, Scalar::Float)?;
+                        self.emit_line("(f64.neg)");
+                    }
+                    (UnaryOp::Not, _) => {
+                        self.compile_scalar_condition(operand, operand_type)?;
+                        self.emit_line("(i32.eqz)");
+                    }
+                    (UnaryOp::Negate, Scalar::Bool) => return Err(scalar_mismatch()),
+                }
+            }
+
+            Expr::Logical {
+                left,
+                operator,
+                right,
+                ..
+            } => {
+                self.compile_scalar(left, Scalar::Bool)?;
+                self.emit_line("(if (result i32)");
+                self.indent += 1;
+                match operator {
+                    LogicalOp::And => {
+                        self.emit_line("(then");
+                        self.indent += 1;
+                        self.compile_scalar(right, Scalar::Bool)?;
+                        self.indent -= 1;
+                        self.emit_line(")");
+                        self.emit_line("(else (i32.const 0))");
+                    }
+                    LogicalOp::Or => {
+                        self.emit_line("(then (i32.const 1))");
+                        self.emit_line("(else");
+                        self.indent += 1;
+                        self.compile_scalar(right, Scalar::Bool)?;
+                        self.indent -= 1;
+                        self.emit_line(")");
+                    }
+                }
+                self.indent -= 1;
+                self.emit_line(")");
+            }
+
+            _ => return Err(scalar_mismatch()),
+        }
+        Ok(())
+    }
+
+    /// Compile a scalar of type `from` and widen it to `to` (only int to float widens)
+    fn compile_scalar_as(&mut self, expr: &Expr, from: Scalar, to: Scalar) -> HaversResult<()> {
+        self.compile_scalar(expr, from)?;
+        match (from, to) {
+            (Scalar::Int, Scalar::Float) => self.emit_line("(f64.convert_i64_s)"),
+            (from, to) if from == to => {}
+            _ => return Err(scalar_mismatch()),
+        }
+        Ok(())
+    }
+
+    /// Leave a scalar's truthiness on the stack as an i32
+    fn compile_scalar_condition(&mut self, expr: &Expr, scalar: Scalar) -> HaversResult<()> {
+        self.compile_scalar(expr, scalar)?;
+        match scalar {
+            Scalar::Bool => {}
+            Scalar::Int => {
+                self.emit_line("(i64.const 0)");
+                self.emit_line("(i64.ne)");
+            }
+            Scalar::Float => {
+                self.emit_line("(f64.const 0)");
+                self.emit_line("(f64.ne)");
+            }
+        }
+        Ok(())
+    }
+
+    /// Leave `expr`'s truthiness on the stack as an i32
+    fn compile_condition(&mut self, expr: &Expr) -> HaversResult<()> {
+        if let Some(scalar) = self.scalar_type(expr) {
+            return self.compile_scalar_condition(expr, scalar);
+        }
+        self.compile_expr(expr)?;
+        self.emit_line("(call $mdh_truthy)");
+        Ok(())
+    }
+
+    /// Compile `expr` to a host handle, boxing it if it's a scalar
+    fn compile_boxed_scalar(&mut self, expr: &Expr, scalar: Scalar) -> HaversResult<()> {
+        self.compile_scalar(expr, scalar)?;
+        match scalar {
+            Scalar::Int => self.emit_line("(call $mdh_make_int)"),
+            Scalar::Float => self.emit_line("(call $mdh_make_float)"),
+            Scalar::Bool => self.emit_line("(call $mdh_make_bool)"),
+        }
+        Ok(())
+    }
+
     fn emit_value_call(&mut self, callee: &Expr, arguments: &[Expr]) -> HaversResult<()> {
         self.compile_expr(callee)?;
         self.emit_string_handle("call");
@@ -797,16 +1212,20 @@ impl WasmCompiler {
             Stmt::VarDecl {
                 name, initializer, ..
             } => {
-                if let Some(init) = initializer {
-                    self.compile_expr(init)?;
-                } else {
-                    self.emit_nil();
+                match (initializer, self.scalar_locals.get(name).copied()) {
+                    (Some(init), Some(scalar)) => self.compile_scalar(init, scalar)?,
+                    (Some(init), None) => self.compile_expr(init)?,
+                    (None, _) => self.emit_nil(),
                 }
                 self.emit_line(&format!("(local.set ${})", name));
             }
 
             Stmt::Expression { expr, .. } => {
-                self.compile_expr(expr)?;
+                // A statement like `i = i + 1` needn't box what it throws away
+                match self.scalar_type(expr) {
+                    Some(scalar) => self.compile_scalar(expr, scalar)?,
+                    None => self.compile_expr(expr)?,
+                }
                 self.emit_line("(drop)");
             }
 
@@ -823,8 +1242,7 @@ impl WasmCompiler {
                 ..
             } => {
                 // Compile condition
-                self.compile_expr(condition)?;
-                self.emit_line("(call $mdh_truthy)");
+                self.compile_condition(condition)?;
 
                 self.emit_line("(if");
                 self.indent += 1;
@@ -854,9 +1272,10 @@ impl WasmCompiler {
                 self.emit_line("(loop $continue");
                 self.indent += 1;
 
+                self.emit_gc_safepoint();
+
                 // Check condition
-                self.compile_expr(condition)?;
-                self.emit_line("(call $mdh_truthy)");
+                self.compile_condition(condition)?;
                 self.emit_line("(i32.eqz)");
                 self.emit_line("(br_if $break)");
 
@@ -921,6 +1340,9 @@ impl WasmCompiler {
     }
 
     fn compile_expr(&mut self, expr: &Expr) -> HaversResult<()> {
+        if let Some(scalar) = self.scalar_type(expr) {
+            return self.compile_boxed_scalar(expr, scalar);
+        }
         match expr {
             Expr::Literal { value, .. } => match value {
                 Literal::Integer(n) => {
@@ -1145,6 +1567,182 @@ impl WasmCompiler {
     }
 }
 
+fn contains_loop(stmt: &Stmt) -> bool {
+    match stmt {
+        Stmt::While { .. } => true,
+        Stmt::Block { statements, .. } => statements.iter().any(contains_loop),
+        Stmt::If {
+            then_branch,
+            else_branch,
+            ..
+        } => contains_loop(then_branch) || else_branch.as_deref().is_some_and(contains_loop),
+        _ => false,
+    }
+}
+
+fn scalar_mismatch() -> HaversError {
+    HaversError::InternalError("WASM scalar type inference went wrang".to_string())
+}
+
+/// Every `ken` and assignment in `stmt`, with the value assigned (None for a bare `ken x`)
+fn collect_assignments_stmt<'a>(stmt: &'a Stmt, out: &mut Vec<(&'a str, Option<&'a Expr>)>) {
+    match stmt {
+        Stmt::VarDecl {
+            name, initializer, ..
+        } => {
+            out.push((name, initializer.as_ref()));
+            if let Some(init) = initializer {
+                collect_assignments_expr(init, out);
+            }
+        }
+        Stmt::Expression { expr, .. } | Stmt::Print { value: expr, .. } => {
+            collect_assignments_expr(expr, out);
+        }
+        Stmt::Return {
+            value: Some(expr), ..
+        } => collect_assignments_expr(expr, out),
+        Stmt::Block { statements, .. } => {
+            for s in statements {
+                collect_assignments_stmt(s, out);
+            }
+        }
+        Stmt::If {
+            condition,
+            then_branch,
+            else_branch,
+            ..
+        } => {
+            collect_assignments_expr(condition, out);
+            collect_assignments_stmt(then_branch, out);
+            if let Some(eb) = else_branch {
+                collect_assignments_stmt(eb, out);
+            }
+        }
+        Stmt::While {
+            condition, body, ..
+        } => {
+            collect_assignments_expr(condition, out);
+            collect_assignments_stmt(body, out);
+        }
+        _ => {}
+    }
+}
+
+fn collect_assignments_expr<'a>(expr: &'a Expr, out: &mut Vec<(&'a str, Option<&'a Expr>)>) {
+    match expr {
+        Expr::Assign { name, value, .. } => {
+            out.push((name, Some(value)));
+            collect_assignments_expr(value, out);
+        }
+        Expr::Binary { left, right, .. } | Expr::Logical { left, right, .. } => {
+            collect_assignments_expr(left, out);
+            collect_assignments_expr(right, out);
+        }
+        Expr::Unary { operand, .. } => collect_assignments_expr(operand, out),
+        Expr::Grouping { expr, .. } => collect_assignments_expr(expr, out),
+        Expr::Call {
+            callee, arguments, ..
+        } => {
+            collect_assignments_expr(callee, out);
+            for arg in arguments {
+                collect_assignments_expr(arg, out);
+            }
+        }
+        Expr::Get { object, .. } => collect_assignments_expr(object, out),
+        Expr::Set { object, value, .. } => {
+            collect_assignments_expr(object, out);
+            collect_assignments_expr(value, out);
+        }
+        Expr::List { elements, .. } => {
+            for elem in elements {
+                collect_assignments_expr(elem, out);
+            }
+        }
+        Expr::Dict { pairs, .. } => {
+            for (key, value) in pairs {
+                collect_assignments_expr(key, out);
+                collect_assignments_expr(value, out);
+            }
+        }
+        _ => {}
+    }
+}
+
+/// The type `expr` has once compiled, given the types of the locals it reads. Only the
+/// forms compile_scalar can do come out as scalars; the rest go through the host.
+fn static_type(expr: &Expr, local_type: &dyn Fn(&str) -> StaticType) -> StaticType {
+    let int = StaticType::Scalar(Scalar::Int);
+    let float = StaticType::Scalar(Scalar::Float);
+    let boolean = StaticType::Scalar(Scalar::Bool);
+    match expr {
+        Expr::Literal { value, .. } => match value {
+            Literal::Integer(_) => int,
+            Literal::Float(_) => float,
+            Literal::Bool(_) => boolean,
+            Literal::String(_) | Literal::Nil => StaticType::Boxed,
+        },
+        Expr::Variable { name, .. } | Expr::Assign { name, .. } => local_type(name),
+        Expr::Grouping { expr, .. } => static_type(expr, local_type),
+        Expr::Binary {
+            left,
+            operator,
+            right,
+            ..
+        } => {
+            let (left, right) = match (
+                static_type(left, local_type),
+                static_type(right, local_type),
+            ) {
+                (StaticType::Boxed, _) | (_, StaticType::Boxed) => return StaticType::Boxed,
+                (StaticType::Pending, _) | (_, StaticType::Pending) => return StaticType::Pending,
+                (StaticType::Scalar(l), StaticType::Scalar(r)) => (l, r),
+            };
+            let numbers = left.is_number() && right.is_number();
+            let both_ints = left == Scalar::Int && right == Scalar::Int;
+            match operator {
+                BinaryOp::Add | BinaryOp::Subtract | BinaryOp::Multiply if both_ints => int,
+                BinaryOp::Add | BinaryOp::Subtract | BinaryOp::Multiply if numbers => float,
+                // The host gives back an int when an int division comes out even
+                BinaryOp::Divide if numbers && !both_ints => float,
+                BinaryOp::Equal | BinaryOp::NotEqual
+                    if numbers || (left == Scalar::Bool && right == Scalar::Bool) =>
+                {
+                    boolean
+                }
+                BinaryOp::Less
+                | BinaryOp::LessEqual
+                | BinaryOp::Greater
+                | BinaryOp::GreaterEqual
+                    if numbers =>
+                {
+                    boolean
+                }
+                _ => StaticType::Boxed,
+            }
+        }
+        Expr::Unary {
+            operator, operand, ..
+        } => match (operator, static_type(operand, local_type)) {
+            (_, StaticType::Pending) => StaticType::Pending,
+            (UnaryOp::Not, StaticType::Scalar(_)) => boolean,
+            (UnaryOp::Negate, StaticType::Scalar(s)) if s.is_number() => StaticType::Scalar(s),
+            _ => StaticType::Boxed,
+        },
+        Expr::Logical { left, right, .. } => {
+            match (
+                static_type(left, local_type),
+                static_type(right, local_type),
+            ) {
+                (StaticType::Boxed, _) | (_, StaticType::Boxed) => StaticType::Boxed,
+                (StaticType::Pending, _) | (_, StaticType::Pending) => StaticType::Pending,
+                (l, r) if l == boolean && r == boolean => boolean,
+                _ => StaticType::Boxed,
+            }
+        }
+        _ => StaticType::Boxed,
+    }
+}
+
 /// Escape a string fer WAT data section
 fn escape_wat_string(s: &str) -> String {
     let mut result = String::new();
@@ -1169,6 +1767,13 @@ pub fn compile_to_wat(source: &str) -> HaversResult<String> {
     compiler.compile(&program)
 }
 
+/// Compile source code to WAT, keeping scalar locals unboxed
+pub fn compile_to_wat_unboxed(source: &str) -> HaversResult<String> {
+    let program = crate::parser::parse(source)?;
+    let mut compiler = WasmCompiler::new().with_unboxed_scalars();
+    compiler.compile(&program)
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -1780,11 +2385,132 @@ mod tests {
         assert!(wat.contains("(call $soond_stairt)"));
     }
 
+    #[test]
+    fn test_unboxed_int_loop_stays_in_wasm() {
+        let source = r#"
+            ken i = 0
+            ken total = 0
+            whiles i < 10 {
+                total = total + i
+                i = i + 1
+            }
+            blether total
+        "#;
+        let wat = compile_to_wat_unboxed(source).unwrap();
+        assert!(wat.contains("(local $i i64)"));
+        assert!(wat.contains("(i64.add)"));
+        assert!(wat.contains("(i64.lt_s)"));
+        assert!(!wat.contains("(call $mdh_add)"));
+        assert!(!wat.contains("(call $mdh_lt)"));
+        assert!(!wat.contains("(call $mdh_truthy)"));
+        // Boxed once, for blether
+        assert_eq!(wat.matches("(call $mdh_make_int)").count(), 1);
+    }
+
+    #[test]
+    fn test_unboxed_float_and_bool_locals() {
+        let source = r#"
+            ken x = 1.5
+            ken done = nae
+            x = x * 2
+            gin x > 2 an nae done {
+                done = aye
+            }
+        "#;
+        let wat = compile_to_wat_unboxed(source).unwrap();
+        assert!(wat.contains("(local $x f64)"));
+        assert!(wat.contains("(local $done i32)"));
+        assert!(wat.contains("(f64.convert_i64_s)"));
+        assert!(wat.contains("(f64.gt)"));
+        assert!(wat.contains("(i32.eqz)"));
+        assert!(!wat.contains("(call $mdh_make_float)"));
+        assert!(!wat.contains("(call $mdh_make_bool)"));
+    }
+
+    #[test]
+    fn test_unboxed_falls_back_to_handles() {
+        // Mixed types, int division, params and strings all go through the host
+        let source = r#"
+            dae bump(n) {
+                ken m = n + 1
+                gie m
+            }
+            ken x = 1
+            x = "yin"
+            ken half = 7 / 2
+            ken a = 1
+            ken b = c
+            ken c = b
+            a = b + 1
+        "#;
+        let wat = compile_to_wat_unboxed(source).unwrap();
+        assert!(wat.contains("(local $x i64)"));
+        assert!(wat.contains("(call $mdh_div)"));
+        assert!(wat.contains("(call $mdh_add)"));
+        assert!(wat.contains("(call $mdh_make_string)"));
+        assert!(wat.contains("(local $half i64)"));
+        assert!(wat.contains("(local $a i64)"));
+    }
+
+    #[test]
+    fn test_unboxed_locals_box_when_they_leave() {
+        let source = r#"
+            ken n = 3
+            ken xs = [n, n + 1]
+            blether -n
+        "#;
+        let wat = compile_to_wat_unboxed(source).unwrap();
+        assert!(wat.contains("(i64.sub)"));
+        assert!(!wat.contains("(call $mdh_neg)"));
+        assert_eq!(wat.matches("(call $mdh_make_int)").count(), 3);
+        assert!(wat.contains("(call $mdh_list_push)"));
+    }
+
     #[test]
     fn test_unused_imports_not_emitted() {
         let wat = compile_to_wat("blether 1").unwrap();
         assert!(!wat.contains("(import \"env\" \"__mdh_tri_module\""));
         assert!(!wat.contains(";; Audio imports"));
         assert!(!wat.contains("(import \"env\" \"soond_stairt\""));
+        assert!(!wat.contains("__mdh_gc_collect"));
+    }
+
+    #[test]
+    fn test_main_loops_spill_handles_at_safepoints() {
+        let source = r#"
+            dae spin(n) {
+                whiles n > 0 {
+                    n = n - 1
+                }
+                gie n
+            }
+            ken s = ""
+            ken i = 0
+            whiles i < 10 {
+                s = s + "a"
+                i = i + 1
+            }
+            blether spin(3)
+        "#;
+        let wat = compile_to_wat(source).unwrap();
+        assert!(wat.contains("(import \"env\" \"__mdh_gc_collect\""));
+        // Only main's loop gets a safepoint, spilling both its locals
+        assert_eq!(wat.matches("(call $mdh_gc_wanted)").count(), 1);
+        assert!(wat.contains("(i32.const 65520)"));
+        assert!(wat.contains("(i32.const 65528)"));
+        assert!(wat.contains("(call $mdh_gc_collect)"));
+    }
+
+    #[test]
+    fn test_unboxed_scalars_are_not_gc_roots() {
+        let source = r#"
+            ken i = 0
+            whiles i < 10 {
+                i = i + 1
+            }
+        "#;
+        let wat = compile_to_wat_unboxed(source).unwrap();
+        assert!(wat.contains("(i32.const 65536)\n"));
+        assert!(!wat.contains("(i64.store)"));
     }
 }
@@ -46,23 +46,91 @@ impl TriObject {
     }
 }
 
+/// Allocations between collections, at the least; after one it grows to the live count
+const GC_MIN_THRESHOLD: usize = 1024;
+
 #[derive(Debug)]
 struct HostStore {
     values: Vec<HostValue>,
+    /// Slots freed by the last collection, ready for reuse
+    free: Vec<Handle>,
+    allocated: usize,
+    threshold: usize,
 }
 
 impl HostStore {
     fn new() -> Self {
         HostStore {
             values: vec![HostValue::Nil],
+            free: Vec::new(),
+            allocated: 0,
+            threshold: GC_MIN_THRESHOLD,
         }
     }
 
     fn alloc(&mut self, value: HostValue) -> Handle {
+        self.allocated += 1;
+        if let Some(handle) = self.free.pop() {
+            self.values[handle as usize] = value;
+            return handle;
+        }
         self.values.push(value);
         (self.values.len() - 1) as Handle
     }
 
+    fn wants_collection(&self) -> bool {
+        self.allocated >= self.threshold
+    }
+
+    /// Free every value not reachable from `roots`. The handle 0 nil is always kept.
+    fn collect(&mut self, roots: impl IntoIterator<Item = Handle>) {
+        let mut marked = vec![false; self.values.len()];
+        marked[0] = true;
+        let mut pending: Vec<Handle> = roots.into_iter().collect();
+        while let Some(handle) = pending.pop() {
+            let idx = handle as usize;
+            if idx >= marked.len() || marked[idx] {
+                continue;
+            }
+            marked[idx] = true;
+            match &self.values[idx] {
+                HostValue::List(items) => pending.extend(items.iter().copied()),
+                HostValue::Dict(map) => {
+                    for (key, value) in map {
+                        pending.push(*value);
+                        match key {
+                            ValueKey::List(h)
+                            | ValueKey::Dict(h)
+                            | ValueKey::NativeObject(h)
+                            | ValueKey::NativeCtor(h) => pending.push(*h),
+                            _ => {}
+                        }
+                    }
+                }
+                HostValue::NativeObject(obj) => pending.extend(obj.fields.values().copied()),
+                _ => {}
+            }
+        }
+
+        // Drop dead slots off the end, then free the rest for reuse
+        let live_len = marked.iter().rposition(|&live| live).unwrap_or(0) + 1;
+        self.values.truncate(live_len);
+        self.free.clear();
+        let mut live = 0;
+        for (idx, slot) in self.values.iter_mut().enumerate() {
+            if marked[idx] {
+                live += 1;
+            } else {
+                *slot = HostValue::Nil;
+                self.free.push(idx as Handle);
+            }
+        }
+        // Hand out low slots first
+        self.free.reverse();
+        self.allocated = 0;
+        self.threshold = live.max(GC_MIN_THRESHOLD);
+    }
+
     fn get(&self, handle: Handle) -> Option<&HostValue> {
         let idx = handle as usize;
         self.values.get(idx)
@@ -683,6 +751,39 @@ pub fn run_wasm_file(path: &Path) -> Result<(), String> {
         )
         .map_err(|e| e.to_string())?;
 
+    // Collection, from the safepoints the compiler puts at the top of main's loops
+    linker
+        .func_wrap(
+            "env",
+            "__mdh_gc_wanted",
+            |caller: Caller<'_, HostState>| -> i32 {
+                caller.data().store.wants_collection() as i32
+            },
+        )
+        .map_err(|e| e.to_string())?;
+
+    let mem_for_gc = memory;
+    linker
+        .func_wrap(
+            "env",
+            "__mdh_gc_collect",
+            move |mut caller: Caller<'_, HostState>, ptr: i32, count: i32| {
+                let data = mem_for_gc.data(&caller);
+                let start = ptr.max(0) as usize;
+                let end = start
+                    .saturating_add(count.max(0) as usize * 8)
+                    .min(data.len());
+                let mut roots: Vec<Handle> = data[start.min(end)..end]
+                    .chunks_exact(8)
+                    .map(|bytes| Handle::from_le_bytes(bytes.try_into().unwrap()))
+                    .collect();
+                let state = caller.data_mut();
+                roots.extend(state.tri_modules.iter().copied());
+                state.store.collect(roots);
+            },
+        )
+        .map_err(|e| e.to_string())?;
+
     // Truthiness
     linker
         .func_wrap(
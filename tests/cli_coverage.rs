@@ -232,6 +232,39 @@ blether x + 1
         assert!(err.contains("LLVM"), "stderr: {err}");
     }
 
+    // build --time-passes reports each phase on stderr
+    let timed_out = dir.path().join("timed");
+    let (code, _out, err) = run_mdhavers(
+        &[
+            "build",
+            ok_braw.to_str().unwrap(),
+            "-O",
+            "0",
+            "--time-passes",
+            "--output",
+            timed_out.to_str().unwrap(),
+        ],
+        None,
+        home,
+    );
+    if cfg!(feature = "llvm") {
+        assert_eq!(code, 0, "stderr: {err}");
+        assert!(timed_out.exists());
+        for phase in [
+            "Time passes:",
+            "parse",
+            "codegen",
+            "object emission",
+            "link",
+            "total",
+        ] {
+            assert!(err.contains(phase), "missing {phase}, stderr: {err}");
+        }
+    } else {
+        assert_ne!(code, 0);
+        assert!(err.contains("LLVM"), "stderr: {err}");
+    }
+
     // compile to JS (default output path)
     let default_js = dir.path().join("ok.js");
     let (code, _out, err) = run_mdhavers(&["compile", ok_braw.to_str().unwrap()], None, home);
@@ -820,3 +853,45 @@ fn cli_repl_readline_interrupt_error_path_is_covered() {
         "stdout missing interrupted message:\n{stdout}"
     );
 }
+
+#[test]
+fn cli_check_and_fmt_take_many_files_in_order() {
+    let dir = tempdir().unwrap();
+    let home = dir.path();
+
+    let src = dir.path().join("src");
+    fs::create_dir_all(&src).unwrap();
+    write_file(&src.join("main.braw"), "fetch \"helpers\"\nblether 1\n");
+    write_file(&src.join("helpers.braw"), "ken x=1\n");
+    write_file(&src.join("other.braw"), "ken y=2\n");
+
+    // Imports are checked once, after the named files
+    let main = src.join("main.braw");
+    let (code, out, err) = run_mdhavers(
+        &["check", main.to_str().unwrap(), "--jobs", "4"],
+        None,
+        home,
+    );
+    assert_eq!(code, 0, "stderr: {err}");
+    assert_eq!(out.matches("looks braw").count(), 2);
+    assert!(out.find("main.braw").unwrap() < out.find("helpers.braw").unwrap());
+
+    let (code, out, _err) = run_mdhavers(&["fmt", "--check", src.to_str().unwrap()], None, home);
+    assert_ne!(code, 0);
+    assert!(
+        out.contains("helpers.braw needs formattin'"),
+        "stdout: {out}"
+    );
+    assert!(out.contains("other.braw needs formattin'"), "stdout: {out}");
+
+    let (code, out, err) = run_mdhavers(&["fmt", src.to_str().unwrap()], None, home);
+    assert_eq!(code, 0, "stderr: {err}");
+    let helpers = out.find("helpers.braw").unwrap();
+    let main = out.find("main.braw").unwrap();
+    let other = out.find("other.braw").unwrap();
+    assert!(helpers < main && main < other, "stdout: {out}");
+    assert_eq!(
+        fs::read_to_string(src.join("other.braw")).unwrap(),
+        "ken y = 2\n"
+    );
+}
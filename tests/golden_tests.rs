@@ -79,6 +79,21 @@ fn run_interpreter_test(braw_path: &Path) -> Result<String, String> {
     Ok(output.join("\n"))
 }
 
+/// Run a single golden test with the interpreter in bytecode mode
+fn run_bytecode_test(braw_path: &Path) -> Result<String, String> {
+    let source = fs::read_to_string(braw_path)
+        .map_err(|e| format!("Failed to read {}: {}", braw_path.display(), e))?;
+
+    let program = mdhavers::parse(&source).map_err(|e| format!("Parse error: {:?}", e))?;
+    let mut interpreter = mdhavers::Interpreter::new();
+    interpreter.set_exec_mode(mdhavers::interpreter::ExecMode::Bytecode);
+    interpreter
+        .interpret(&program)
+        .map_err(|e| format!("Interpreter error: {:?}", e))?;
+
+    Ok(interpreter.get_output().join("\n"))
+}
+
 /// Run a single golden test with LLVM native compilation
 #[cfg(feature = "llvm")]
 fn run_native_test(braw_path: &Path) -> Result<String, String> {
@@ -161,6 +176,53 @@ fn golden_tests_interpreter() {
     );
 }
 
+/// Run all golden tests with the interpreter in bytecode mode
+#[test]
+fn golden_tests_bytecode() {
+    let golden_dir = Path::new("tests/golden");
+    let tests = discover_tests(golden_dir);
+
+    let mut failures = Vec::new();
+    let mut skipped = 0;
+
+    for test_path in &tests {
+        let source = fs::read_to_string(test_path).unwrap();
+
+        if should_skip(&source, "interpreter") {
+            skipped += 1;
+            continue;
+        }
+
+        let expected_path = test_path.with_extension("expected");
+        let expected = fs::read_to_string(&expected_path).expect("Failed to read expected file");
+
+        match run_bytecode_test(test_path) {
+            Ok(actual) => {
+                if let Err(diff) = compare_output(&actual, &expected) {
+                    failures.push((test_path.clone(), diff));
+                }
+            }
+            Err(e) => {
+                failures.push((test_path.clone(), e));
+            }
+        }
+    }
+
+    if !failures.is_empty() {
+        let mut msg = format!("\n{} golden tests failed (bytecode):\n\n", failures.len());
+        for (path, error) in &failures {
+            msg.push_str(&format!("FAIL: {}\n{}\n\n", path.display(), error));
+        }
+        panic!("{}", msg);
+    }
+
+    println!(
+        "\n✓ {} golden tests passed (bytecode), {} skipped",
+        tests.len() - skipped,
+        skipped
+    );
+}
+
 /// Run all golden tests with LLVM native compilation
 #[test]
 #[cfg(feature = "llvm")]
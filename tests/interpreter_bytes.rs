@@ -24,3 +24,83 @@ blether bytes_get(s, 0)
     let out = interp.get_output().join("\n");
     assert_eq!(out.trim(), "4\n3\n515\n2\n2");
 }
+
+#[test]
+fn interpreter_bytes_bulk_primitives() {
+    let code = r#"
+ken b = bytes(16)
+bytes_write_u32le(b, 0, 305419896)
+blether bytes_get(b, 0)
+blether bytes_read_u32be(b, 0)
+blether bytes_read_u16le(b, 2)
+bytes_write_u64be(b, 8, 72623859790382856)
+blether bytes_get(b, 15)
+blether bytes_read_u64le(b, 8)
+blether bytes_read_u64be(b, 8)
+blether bytes_find(b, bytes_slice(b, 10, 12))
+blether bytes_find(b, bytes_from_string("zz"))
+
+ken key = bytes(16)
+bytes_fill(key, 255, 0, 16)
+ken x = bytes_xor(b, key)
+blether bytes_get(x, 15)
+blether bytes_eq(bytes_xor(x, key), b)
+
+bytes_copy_within(b, 0, 8, 16)
+blether bytes_read_u64be(b, 0)
+bytes_fill(b, 0, -8, 16)
+blether bytes_get(b, 15)
+blether bytes_eq(b, key)
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output().join("\n");
+    assert_eq!(
+        out.trim(),
+        "120\n2018915346\n4660\n8\n578437695752307201\n72623859790382856\n10\n-1\n247\naye\n72623859790382856\n0\nnae"
+    );
+}
+
+#[test]
+fn interpreter_pack_matches_the_native_layout() {
+    let code = r#"
+ken record = {"id": 7, "score": 2.0, "tags": ["a", naething, aye], "raw": bytes_from_string("hi")}
+blether hex_encode_native(pack({"a": 1, "f": 2.0, "n": -200}))
+ken back = unpack(pack(record))
+blether whit_kind(back["score"])
+blether back["tags"]
+blether bytes_eq(back["raw"], bytes_from_string("hi"))
+ken c = unpack(pack(creel(["x", "y"])))
+blether whit_kind(c)
+blether is_in_creel(c, "y")
+ken buf = bytes(0)
+pack_into(buf, [1, 300, "three"])
+blether hex_encode_native(buf)
+blether unpack(buf)
+
+ken wire = pack("first")
+bytes_append(wire, pack(42))
+bytes_append(wire, pack(record))
+ken s = unpack_stream_new()
+ken got = []
+fer i in 0..bytes_len(wire) {
+    unpack_stream_feed(s, bytes_slice(wire, i, i + 1))
+    ken v = unpack_stream_next(s)
+    gin v != naething { shove(got, i) }
+}
+blether got
+blether unpack_stream_next(s)
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output().join("\n");
+    assert_eq!(
+        out.trim(),
+        "83a16101a166cb4000000000000000a16ed1ff38\nfloat\n[a, naething, aye]\naye\ncreel\naye\n\
+         9301cd012ca57468726565\n[1, 300, three]\n[5, 6, 44]\nnaething"
+    );
+}
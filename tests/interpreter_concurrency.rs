@@ -76,6 +76,27 @@ hae_a_bash {
     assert_eq!(out.trim(), "caught");
 }
 
+#[test]
+fn interpreter_thread_spawn_accepts_options_and_reports_cores() {
+    let code = r#"
+ken h = thread_spawn(len, [[1, 2]], {"cpus": 0, "name": "counter"})
+blether thread_join(h)
+blether cpu_count() >= 1
+blether numa_node_of_cpu(-1)
+hae_a_bash {
+    thread_spawn(len, [[1]], "fast")
+} gin_it_gangs_wrang e {
+    blether "caught"
+}
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output().join("\n");
+    assert_eq!(out.trim(), "2\naye\n-1\ncaught");
+}
+
 #[test]
 fn interpreter_atomic_compare_and_swap_covers_success_and_failure_paths() {
     let code = r#"
@@ -92,6 +113,27 @@ blether atomic_cas(a, 1, 3)
     assert_eq!(out.trim(), "aye\n2\nnae");
 }
 
+#[test]
+fn interpreter_atomic_fetch_max_min_and_ordered_access() {
+    let code = r#"
+ken hi = atomic_new(5)
+blether atomic_fetch_max(hi, 9)
+blether atomic_fetch_max(hi, 3)
+blether atomic_load(hi)
+ken lo = atomic_new(5)
+blether atomic_fetch_min(lo, 2)
+blether atomic_load(lo)
+atomic_store_release(lo, 11)
+blether atomic_load_acquire(lo)
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output().join("\n");
+    assert_eq!(out.trim(), "5\n9\n9\n5\n2\n11");
+}
+
 #[test]
 fn interpreter_channel_try_recv_and_is_closed_branches_for_coverage() {
     let code = r#"
@@ -132,3 +174,67 @@ condvar_broadcast(cv)
     let out = interp.get_output().join("\n");
     assert_eq!(out.trim(), "aye\nnae\naye\naye\naye");
 }
+
+#[test]
+fn interpreter_channel_batches_and_timeout() {
+    let code = r#"
+ken ch = chan_new(3)
+blether chan_send_many(ch, [1, 2, 3, 4])
+blether chan_recv_many(ch, 2)
+blether chan_recv_many(ch, 10)
+blether chan_recv_timeout(ch, 5)
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output().join("\n");
+    assert_eq!(out.trim(), "3\n[1, 2]\n[3]\nnaething");
+}
+
+#[test]
+fn interpreter_chan_select_takes_from_first_ready_channel() {
+    let code = r#"
+ken a = chan_new(2)
+ken b = chan_new(2)
+chan_send(b, "hi")
+blether chan_select([a, b], 10)
+blether chan_select([a, b], 10)
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output().join("\n");
+    assert_eq!(out.trim(), "[1, hi]\nnaething");
+}
+
+#[test]
+fn interpreter_pool_submit_joins_like_a_thread() {
+    let code = r#"
+ken h = pool_submit(len, [[1, 2, 3, 4]])
+blether thread_join(h)
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output().join("\n");
+    assert_eq!(out.trim(), "4");
+}
+
+#[test]
+fn interpreter_parallel_hofs_match_sequential_results() {
+    let code = r#"
+ken xs = [1, 2, 3, 4, 5]
+blether parallel_map(xs, |x| x * x, 2)
+blether parallel_filter(xs, |x| x % 2 == 1, 0)
+blether parallel_reduce(xs, |a, x| a + x, 10, 2)
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output().join("\n");
+    assert_eq!(out.trim(), "[1, 4, 9, 16, 25]\n[1, 3, 5]\n25");
+}
@@ -73,7 +73,7 @@ ken r = dns_naptr("example.com")
 r["value"][0]["service"]
 "#,
     );
-    assert_eq!(value, Value::String("SIP+D2U".to_string()));
+    assert_eq!(value, Value::String("SIP+D2U".into()));
 
     // Cover the non-NAPTR filter path without touching the network.
     let name = Name::from_ascii("example.com.").expect("query name");
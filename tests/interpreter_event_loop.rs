@@ -210,3 +210,84 @@ gin r["ok"] {
         "unexpected output: {out}"
     );
 }
+
+#[test]
+fn interpreter_event_loop_poll_into_refills_list() {
+    let code = r#"
+ken loop = event_loop_new()
+
+dae on_timer(ev) {
+    # no-op
+}
+
+ken events = ["stale", "stale", "stale"]
+timer_after(loop, 0, on_timer)
+blether event_loop_poll_into(loop, events, 50)
+blether events[0]["kind"]
+blether event_loop_poll_into(loop, events, 0)
+blether len(events)
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output().join("\n");
+    assert_eq!(out.trim(), "1\ntimer\n0\n0");
+}
+
+#[test]
+fn interpreter_event_loop_run_dispatches_until_stopped() {
+    let code = r#"
+ken loop = event_loop_new()
+ken seen = []
+
+dae on_tick(ev) {
+    shove(seen, ev["kind"])
+    gin len(seen) == 3 {
+        event_loop_stop(loop)
+    }
+}
+
+timer_every(loop, 1, on_tick)
+event_loop_run(loop)
+blether len(seen)
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output().join("\n");
+    assert_eq!(out.trim(), "3");
+}
+
+#[test]
+fn interpreter_event_loop_ns_timers_keep_to_their_schedule() {
+    let code = r#"
+ken loop = event_loop_new()
+ken seen = []
+ken start = mono_ns()
+
+dae on_once(ev) {
+    shove(seen, "once")
+}
+
+dae on_tick(ev) {
+    shove(seen, "tick")
+    gin len(seen) == 6 {
+        event_loop_stop(loop)
+    }
+}
+
+timer_every_ns(loop, 2000000, on_tick)
+timer_after_ns(loop, 500000, on_once)
+event_loop_run(loop)
+blether seen
+blether mono_ns() - start >= 10000000
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output().join("\n");
+    assert_eq!(out.trim(), "[once, tick, tick, tick, tick, tick]\naye");
+}
@@ -231,8 +231,24 @@ fn interpreter_builtin_edges_and_errors_smoke() {
         ("log_init({\"filter\": \"mutter\"})", true),
         ("log_init({\"format\": 1})", false),
         ("log_init({\"format\": \"nae\"})", false),
+        ("log_init({\"format\": \"binary\"})", true),
         ("log_init({\"color\": 1})", false),
         ("log_init({\"timestamps\": 1})", false),
+        ("log_init({\"async\": aye})", true),
+        (
+            "log_init({\"async\": {\"capacity\": 8, \"policy\": \"block\"}})",
+            true,
+        ),
+        ("log_init({\"async\": 1})", false),
+        ("log_init({\"async\": {\"capacity\": 0}})", false),
+        ("log_init({\"async\": {\"policy\": \"spill\"}})", false),
+        ("log_flush()", true),
+        ("log_dropped()", true),
+        ("log_init({\"profile\": 1})", false),
+        ("log_init({\"profile\": {\"sample\": 0}})", false),
+        ("log_init({\"profile\": {\"sample\": 10}})", true),
+        ("log_span_stats()", true),
+        ("log_span_export(\"spans.out\", \"svg\")", false),
         ("log_init({\"sinks\": 1})", false),
         ("log_init({\"sinks\": [1]})", false),
         ("log_init({\"sinks\": [{\"kind\": 1}]})", false),
@@ -285,6 +301,27 @@ f()
         ("json_parse(123)", false),
         ("json_parse(\"-\")", false),
         ("json_parse(\"1e\")", false),
+        ("json_write_into(bytes(0), {\"a\": 1})", true),
+        ("json_write_into(\"x\", 1)", false),
+        ("json_stream_next(json_stream_new())", true),
+        ("json_stream_feed(json_stream_new(), 1)", false),
+        ("json_stream_next(\"x\")", false),
+        ("json_stream_next(9999)", false),
+        ("json_stream_open(\"/nonexistent/records.ndjson\")", false),
+        ("json_stream_close(json_stream_new())", true),
+        ("lines_iter(\"/nonexistent/big.log\")", false),
+        ("lines_next(1)", false),
+        ("lines_close(\"x\")", false),
+        ("file_map(\"/nonexistent/big.log\")", false),
+        ("file_map(1)", false),
+        ("file_open(1)", false),
+        ("file_open(\"/nonexistent/out.csv\")", false),
+        ("file_write(1, \"x\")", false),
+        ("file_flush(\"x\")", false),
+        ("file_close(1)", false),
+        ("slurp_bytes(\"/nonexistent/capture.pcap\")", false),
+        ("slurp_bytes(1)", false),
+        ("scrieve_bytes(\"/tmp/x.bin\", 1)", false),
         // atomics/channels: type errors and edge cases
         ("atomic_store(atomic_new(1), \"x\")", false),
         ("atomic_add(atomic_new(1), \"x\")", false),
@@ -437,6 +474,11 @@ c["FG_RED"]
         ("date_now()", true),
         ("date_format(0, \"%Y-%m-%d\")", true),
         ("date_format(0, 1)", false),
+        ("date_now_ts()", true),
+        ("date_fields(0)[\"yearday\"]", true),
+        ("date_fields(naething)", true),
+        ("date_fields(\"noo\")", false),
+        ("date_fields(0)[\"fortnight\"]", false),
         (
             "date_parse(\"2020-01-02 03:04:05\", \"%Y-%m-%d %H:%M:%S\")",
             true,
@@ -485,6 +527,17 @@ c["FG_RED"]
         ("regex_replace_first(\"a1b2\", \"[0-9]\", 1)", false),
         ("regex_split(\"a1b2\", \"*\")", false),
         ("regex_split(\"a1b2\", 1)", false),
+        ("regex_split(\"a1b2\", regex_compile(\"[0-9]\"))", true),
+        ("regex_test(\"a1\", regex_compile(\"[0-9]\"))", true),
+        ("regex_compile(\"*\")", false),
+        ("regex_compile(1)", false),
+        (
+            "regex_set_match(regex_set_new([\"a\", regex_compile(\"[0-9]\")]), \"a1\")",
+            true,
+        ),
+        ("regex_set_new([\"*\"])", false),
+        ("regex_set_new([1])", false),
+        ("regex_set_match(\"a\", \"a\")", false),
         // timing helpers
         ("noo()", true),
         ("tick()", true),
@@ -516,6 +569,12 @@ log_whisper "shh"
         ("shell(1)", false),
         ("shell_status(\"exit 0\")", true),
         ("shell_status(1)", false),
+        ("spawn([\"echo\", \"hello\"])", true),
+        ("spawn([])", false),
+        ("spawn(\"echo\")", false),
+        ("spawn([\"/nonexistent/prog\"])", false),
+        ("process_spawn([\"true\"])", false),
+        ("process_wait(1)", false),
         ("args()", true),
         ("cwd()", true),
         ("path_join(\"a\", 1)", false),
@@ -736,6 +795,158 @@ blether file_exists("{p}")
     assert!(out.contains('\n'));
 }
 
+#[test]
+fn interpreter_json_stream_reads_records_from_files_and_chunks() {
+    let dir = tempfile::tempdir().unwrap();
+    let path = dir.path().join("records.ndjson");
+    std::fs::write(
+        &path,
+        "{\"id\": 1, \"msg\": \"a \\\"quoted\\\" }\"}\n{\"id\": 2}\n\n[3,\n 4]\n{\"id\":",
+    )
+    .unwrap();
+
+    let code = format!(
+        r#"
+ken s = json_stream_open("{p}")
+blether json_stream_next(s)["msg"]
+blether json_stream_next(s)["id"]
+blether json_stream_next(s)
+hae_a_bash {{
+    json_stream_next(s)
+}} gin_it_gangs_wrang e {{
+    blether e
+}}
+blether json_stream_next(s)
+json_stream_close(s)
+ken p = json_stream_new()
+json_stream_feed(p, "{{\"a\": [1, ")
+blether json_stream_next(p)
+json_stream_feed(p, bytes_from_string("2]}}\n7 "))
+blether json_stream_next(p)["a"]
+blether json_stream_next(p)
+"#,
+        p = path.display(),
+    );
+
+    let program = parse(&code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+
+    let out = interp.get_output();
+    assert_eq!(out[..3], ["a \"quoted\" }", "2", "[3, 4]"]);
+    assert!(out[3].contains("Truncated JSON record"), "got {}", out[3]);
+    assert_eq!(out[4..], ["naething", "naething", "[1, 2]", "7"]);
+}
+
+#[test]
+fn interpreter_lines_iter_streams_lines_and_file_map_reads_bytes() {
+    let dir = tempfile::tempdir().unwrap();
+    let path = dir.path().join("big.log");
+    std::fs::write(&path, "first\n\nthird\nlast").unwrap();
+
+    let code = format!(
+        r#"
+ken r = lines_iter("{p}")
+ken line = lines_next(r)
+whiles line != naething {{
+    blether "[" + line + "]"
+    line = lines_next(r)
+}}
+blether lines_next(r)
+ken early = lines_iter("{p}")
+blether lines_next(early)
+lines_close(early)
+blether lines_next(early)
+ken m = file_map("{p}")
+blether bytes_len(m)
+blether bytes_find(m, bytes_from_string("last"))
+"#,
+        p = path.display(),
+    );
+
+    let program = parse(&code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output();
+    assert_eq!(
+        out,
+        ["[first]", "[]", "[third]", "[last]", "naething", "first", "naething", "17", "13"]
+    );
+}
+
+#[test]
+fn interpreter_file_handles_buffer_writes_until_flush_or_close() {
+    let dir = tempfile::tempdir().unwrap();
+    let path = dir.path().join("rows.csv");
+
+    let code = format!(
+        r#"
+ken f = file_open("{p}", "w", 4096)
+fer i in 0..3 {{
+    file_write(f, tae_string(i) + ",row\n")
+}}
+blether len(read_file("{p}"))
+file_flush(f)
+blether len(read_file("{p}"))
+file_write_lines(f, ["a", 1, bytes_from_string("b")])
+file_close(f)
+file_close(f)
+ken g = file_open("{p}", "a")
+file_write(g, "tail")
+file_close(g)
+blether read_file("{p}")
+hae_a_bash {{
+    file_write(g, "late")
+}} gin_it_gangs_wrang e {{
+    blether e
+}}
+ken unbuffered = file_open("{p}", "a", 0)
+file_write(unbuffered, "!")
+blether len(read_file("{p}"))
+"#,
+        p = path.display(),
+    );
+
+    let program = parse(&code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output();
+    assert_eq!(out[0], "0");
+    assert_eq!(out[1], "18");
+    assert_eq!(out[2], "0,row\n1,row\n2,row\na\n1\nb\ntail");
+    assert!(out[3].contains("closed file"), "{}", out[3]);
+    assert_eq!(out[4], "29");
+}
+
+#[test]
+fn interpreter_slurp_bytes_keeps_zero_bytes_and_reads_ranges() {
+    let dir = tempfile::tempdir().unwrap();
+    let path = dir.path().join("capture.bin");
+
+    let code = format!(
+        r#"
+ken b = bytes(10)
+bytes_set(b, 1, 255)
+bytes_set(b, 9, 7)
+scrieve_bytes("{p}", b)
+ken all = slurp_bytes("{p}")
+blether bytes_len(all)
+blether bytes_get(all, 9)
+ken part = slurp_bytes("{p}", 1, 3)
+blether bytes_len(part)
+blether bytes_get(part, 0)
+blether bytes_len(slurp_bytes("{p}", 8, 100))
+blether bytes_len(slurp_bytes("{p}", 50))
+"#,
+        p = path.display(),
+    );
+
+    let program = parse(&code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    assert_eq!(interp.get_output(), ["10", "7", "3", "255", "2", "0"]);
+}
+
 #[test]
 fn interpreter_file_io_error_branches_cover_map_err_for_coverage() {
     fn assert_interpret_err_contains(src: &str, needle: &str) {
@@ -972,6 +1183,126 @@ ony([1, 2], |x| x > 0, 3)
         ("aw([1])", false),
         ("grup_up([1])", false),
         ("pairt_by([1])", false),
+        ("sort_by([1])", false),
+        ("sort_by(1, |x| x)", false),
+        (
+            r#"
+ken words = ["pear", "fig", "apple", "kiwi"]
+ken by_len = sort_by(words, |w| len(w))
+gin by_len[0] != "fig" or by_len[1] != "pear" or by_len[2] != "kiwi" {
+    hurl "sort_by should be stable"
+}
+"#,
+            true,
+        ),
+        // Typed arrays
+        (
+            r#"
+ken a = int_array([1, 2, 3, 4, 5])
+a[-1] = 50
+ken f = float_array(3)
+f[0] = 2
+gin len(a) != 5 or a[4] != 50 or array_sum(a) != 60 or array_max(a) != 50 {
+    hurl "int_array indexing"
+}
+gin array_dot(a, a) != 2530 or array_sum(array_mul(a, 2)) != 120 {
+    hurl "int_array arithmetic"
+}
+gin array_average(array_div(a, 2)) != 6.0 or array_min(f) != 0.0 or f[0] != 2.0 {
+    hurl "float_array"
+}
+gin array_tae_list(array_add(f, 1)) != [3.0, 1.0, 1.0] {
+    hurl "array_tae_list"
+}
+"#,
+            true,
+        ),
+        ("int_array([1.5])", false),
+        ("ken a = int_array(2)\na[2] = 1", false),
+        ("ken a = int_array(2)\na[0] = 1.5", false),
+        ("ken a = float_array(2)\nblether a[-3]", false),
+        ("array_add(int_array(2), int_array(3))", false),
+        ("array_min(float_array(0))", false),
+        ("array_sum([1, 2])", false),
+        // Deques and heaps
+        (
+            r#"
+ken d = deque()
+deque_push_back(d, 2)
+deque_push_front(d, 1)
+ken seen = []
+fer x in d {
+    shove(seen, x)
+}
+gin seen != [1, 2] or len(d) != 2 or deque_back(d) != 2 or deque_tae_list(d) != [1, 2] {
+    hurl "deque"
+}
+gin deque_pop_back(d) != 2 or deque_pop_front(d) != 1 or deque_pop_front(d) != naething {
+    hurl "deque pops"
+}
+ken h = heap(|p| p[0])
+heap_push(h, [2, "b"])
+heap_push(h, [1, "a"])
+heap_push(h, [2, "c"])
+gin heap_tae_list(h) != [[1, "a"], [2, "b"], [2, "c"]] or heap_peek(h)[1] != "a" {
+    hurl "heap order"
+}
+gin heap_pop(h)[1] != "a" or heap_pop(h)[1] != "b" or len(h) != 1 {
+    hurl "heap pops"
+}
+"#,
+            true,
+        ),
+        ("deque_push_back([], 1)", false),
+        ("heap(3)", false),
+        ("heap_push(heap(|x| x.nope), 1)", false),
+        ("fer x in heap(naething) { }\nfer y in deque() { }", true),
+        // `fer` over a range counts without building the list
+        (
+            r#"
+ken seen = 0
+fer i in range(0, 1000000000000) {
+    gin i == 3 {
+        brak
+    }
+    seen = seen + 1
+}
+fer j in 0..=1000000000000 {
+    brak
+}
+gin seen != 3 {
+    hurl "range loop"
+}
+dae range(a, b) {
+    gie [b, a]
+}
+ken got = []
+fer k in range(1, 2) {
+    shove(got, k)
+}
+gin got != [2, 1] {
+    hurl "user range should shadow the builtin"
+}
+"#,
+            true,
+        ),
+        ("fer i in range(0, \"a\") {\n}", false),
+        // Bulk list building
+        (
+            r#"
+ken xs = list_with_capacity(100)
+reserve(xs, 10)
+shove(xs, 1)
+list_extend(xs, [2, 3])
+list_extend(xs, xs)
+gin xs != [1, 2, 3, 1, 2, 3] or list_concat(xs, [4]) != [1, 2, 3, 1, 2, 3, 4] {
+    hurl "bulk list building"
+}
+"#,
+            true,
+        ),
+        ("list_extend([1], 2)", false),
+        ("list_with_capacity(\"big\")", false),
         // Destructure error + trailing binding after rest
         ("ken [a] = 1\n", false),
         (
@@ -11,7 +11,7 @@ fn interpreter_json_parse_invalid_numbers_and_pretty_list_are_covered() {
     // value_to_json_pretty: cover non-empty list formatting.
     assert_eq!(
         run(r#"json_pretty([1, 2])"#).unwrap(),
-        Value::String("[\n  1,\n  2\n]".to_string())
+        Value::String("[\n  1,\n  2\n]".into())
     );
 }
 
@@ -68,22 +68,22 @@ d.f(1)
 #[test]
 fn interpreter_json_string_escapes_quote_and_backslash_are_covered() {
     let value = run(r#"json_parse("\"a\\\"b\\\\c\"")"#).unwrap();
-    assert_eq!(value, Value::String("a\"b\\c".to_string()));
+    assert_eq!(value, Value::String("a\"b\\c".into()));
 }
 
 #[test]
 fn interpreter_json_unicode_escape_paths_are_covered() {
     assert_eq!(
         run(r#"json_parse("\"\\u0041\"")"#).unwrap(),
-        Value::String("A".to_string())
+        Value::String("A".into())
     );
     assert_eq!(
         run(r#"json_parse("\"\\uD800\"")"#).unwrap(),
-        Value::String("".to_string())
+        Value::String("".into())
     );
     assert_eq!(
         run(r#"json_parse("\"\\uZZZZ\"")"#).unwrap(),
-        Value::String("".to_string())
+        Value::String("".into())
     );
 }
 
@@ -103,7 +103,7 @@ fn interpreter_json_stringify_handles_non_string_dict_keys() {
 
     // Cover bool-false pretty branch too.
     let value = run(r#"json_pretty(nae)"#).unwrap();
-    assert_eq!(value, Value::String("false".to_string()));
+    assert_eq!(value, Value::String("false".into()));
 }
 
 #[test]
@@ -178,10 +178,10 @@ fn interpreter_native_ipv4_resolution_and_nonblocking_false_path_are_covered() {
     };
     let created = created.borrow();
     assert_eq!(
-        created.get(&Value::String("ok".to_string())),
+        created.get(&Value::String("ok".into())),
         Some(&Value::Bool(true))
     );
-    let sock_id = match created.get(&Value::String("value".to_string())) {
+    let sock_id = match created.get(&Value::String("value".into())) {
         Some(Value::Integer(id)) => *id,
         other => panic!("unexpected socket id: {other:?}"),
     };
@@ -190,7 +190,7 @@ fn interpreter_native_ipv4_resolution_and_nonblocking_false_path_are_covered() {
     // Bind to an IPv4 literal so the resolver loop breaks on a v4 address.
     let bound = (socket_bind.func)(vec![
         Value::Integer(sock_id),
-        Value::String("127.0.0.1".to_string()),
+        Value::String("127.0.0.1".into()),
         Value::Integer(0),
     ])
     .expect("socket_bind ok");
@@ -198,7 +198,7 @@ fn interpreter_native_ipv4_resolution_and_nonblocking_false_path_are_covered() {
         panic!("expected result dict, got {bound:?}");
     };
     assert_eq!(
-        bound.borrow().get(&Value::String("ok".to_string())),
+        bound.borrow().get(&Value::String("ok".into())),
         Some(&Value::Bool(true))
     );
 
@@ -209,7 +209,7 @@ fn interpreter_native_ipv4_resolution_and_nonblocking_false_path_are_covered() {
         panic!("expected result dict, got {updated:?}");
     };
     assert_eq!(
-        updated.borrow().get(&Value::String("ok".to_string())),
+        updated.borrow().get(&Value::String("ok".into())),
         Some(&Value::Bool(true))
     );
 
@@ -219,7 +219,7 @@ fn interpreter_native_ipv4_resolution_and_nonblocking_false_path_are_covered() {
         panic!("expected result dict, got {closed:?}");
     };
     assert_eq!(
-        closed.borrow().get(&Value::String("ok".to_string())),
+        closed.borrow().get(&Value::String("ok".into())),
         Some(&Value::Bool(true))
     );
 }
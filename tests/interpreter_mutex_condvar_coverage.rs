@@ -114,7 +114,7 @@ fn interpreter_mutex_and_condvar_builtins_cover_registry_and_branches_for_covera
         (condvar_timed_wait.func)(vec![
             Value::Integer(condvar_id),
             Value::Integer(mutex_id),
-            Value::String("nope".to_string()),
+            Value::String("nope".into()),
         ])
         .is_err(),
         "expected timeout validation error"
@@ -15,13 +15,13 @@ fn sample_list() -> Value {
 
 fn sample_dict() -> Value {
     let mut dict = DictValue::new();
-    dict.set(Value::String("a".to_string()), Value::Integer(1));
+    dict.set(Value::String("a".into()), Value::Integer(1));
     Value::Dict(Rc::new(RefCell::new(dict)))
 }
 
 fn sample_set() -> Value {
     let mut set = SetValue::new();
-    set.insert(Value::String("a".to_string()));
+    set.insert(Value::String("a".into()));
     Value::Set(Rc::new(RefCell::new(set)))
 }
 
@@ -45,7 +45,7 @@ fn interpreter_calls_all_native_builtins_for_coverage() {
         Value::Bool(true),
         Value::Integer(1),
         Value::Float(1.5),
-        Value::String("hello".to_string()),
+        Value::String("hello".into()),
         sample_list(),
         sample_dict(),
         sample_set(),
@@ -72,21 +72,40 @@ fn interpreter_calls_all_native_builtins_for_coverage() {
         "socket_close",
         "udp_send_to",
         "udp_recv_from",
+        "udp_recv_many",
+        "udp_recv_into",
+        "udp_send_many",
+        "addr_resolve",
         "tcp_send",
+        "tcp_send_vec",
+        "tcp_send_all",
+        "socket_send_file",
         "tcp_recv",
+        "tcp_recv_into",
         "dns_lookup",
         "dns_srv",
         "dns_naptr",
+        "dns_lookup_async",
+        "dns_srv_async",
+        "dns_naptr_async",
         "tls_client_new",
         "tls_connect",
+        "tls_connect_start",
+        "tls_step",
         "tls_send",
         "tls_recv",
         "tls_close",
+        "tls_stats",
+        "runtime_stats",
         "dtls_server_new",
         "dtls_handshake",
         "srtp_create",
         "srtp_protect",
         "srtp_unprotect",
+        "srtp_protect_into",
+        "srtp_unprotect_into",
+        "srtp_protect_many",
+        "srtp_unprotect_many",
     ];
 
     for (name, value) in exports {
@@ -99,56 +118,56 @@ fn interpreter_calls_all_native_builtins_for_coverage() {
 
         let candidates: Vec<Vec<Value>> = match (name.as_str(), native.arity) {
             ("bide", 1) => vec![vec![Value::Integer(0)]],
-            ("shell", 1) => vec![vec![Value::String("echo hello".to_string())]],
-            ("shell_status", 1) => vec![vec![Value::String("exit 0".to_string())]],
-            ("env_get", 1) => vec![vec![Value::String("PATH".to_string())]],
+            ("shell", 1) => vec![vec![Value::String("echo hello".into())]],
+            ("shell_status", 1) => vec![vec![Value::String("exit 0".into())]],
+            ("env_get", 1) => vec![vec![Value::String("PATH".into())]],
             ("grup_runs", 1) => vec![
                 vec![Value::List(Rc::new(RefCell::new(Vec::new())))],
                 vec![Value::List(Rc::new(RefCell::new(vec![Value::Integer(1)])))],
             ],
             ("is_a", 2) => {
                 vec![
-                    vec![Value::Integer(1), Value::String("integer".to_string())],
-                    vec![Value::Integer(1), Value::String("int".to_string())],
-                    vec![Value::Float(1.0), Value::String("int".to_string())],
-                    vec![Value::Float(1.0), Value::String("float".to_string())],
-                    vec![Value::Integer(1), Value::String("float".to_string())],
-                    vec![Value::String("x".to_string()), Value::String("string".to_string())],
-                    vec![Value::String("x".to_string()), Value::String("str".to_string())],
-                    vec![Value::Integer(1), Value::String("str".to_string())],
-                    vec![Value::Bool(true), Value::String("bool".to_string())],
-                    vec![Value::Nil, Value::String("bool".to_string())],
-                    vec![sample_list(), Value::String("list".to_string())],
-                    vec![sample_dict(), Value::String("list".to_string())],
+                    vec![Value::Integer(1), Value::String("integer".into())],
+                    vec![Value::Integer(1), Value::String("int".into())],
+                    vec![Value::Float(1.0), Value::String("int".into())],
+                    vec![Value::Float(1.0), Value::String("float".into())],
+                    vec![Value::Integer(1), Value::String("float".into())],
+                    vec![Value::String("x".into()), Value::String("string".into())],
+                    vec![Value::String("x".into()), Value::String("str".into())],
+                    vec![Value::Integer(1), Value::String("str".into())],
+                    vec![Value::Bool(true), Value::String("bool".into())],
+                    vec![Value::Nil, Value::String("bool".into())],
+                    vec![sample_list(), Value::String("list".into())],
+                    vec![sample_dict(), Value::String("list".into())],
                     vec![
                         Value::Bytes(Rc::new(RefCell::new(vec![1, 2, 3]))),
-                        Value::String("bytes".to_string()),
+                        Value::String("bytes".into()),
                     ],
                     vec![
                         Value::Bytes(Rc::new(RefCell::new(vec![1, 2, 3]))),
-                        Value::String("byte".to_string()),
+                        Value::String("byte".into()),
                     ],
-                    vec![Value::Integer(1), Value::String("byte".to_string())],
-                    vec![sample_dict(), Value::String("dict".to_string())],
-                    vec![sample_list(), Value::String("dict".to_string())],
+                    vec![Value::Integer(1), Value::String("byte".into())],
+                    vec![sample_dict(), Value::String("dict".into())],
+                    vec![sample_list(), Value::String("dict".into())],
                     vec![
                         Value::Range(mdhavers::value::RangeValue::new(1, 2, false)),
-                        Value::String("range".to_string()),
+                        Value::String("range".into()),
                     ],
-                    vec![Value::Integer(1), Value::String("range".to_string())],
-                    vec![Value::Nil, Value::String("naething".to_string())],
-                    vec![Value::Nil, Value::String("nil".to_string())],
-                    vec![Value::Integer(1), Value::String("nil".to_string())],
+                    vec![Value::Integer(1), Value::String("range".into())],
+                    vec![Value::Nil, Value::String("naething".into())],
+                    vec![Value::Nil, Value::String("nil".into())],
+                    vec![Value::Integer(1), Value::String("nil".into())],
                     vec![
                         Value::NativeFunction(any_native.clone()),
-                        Value::String("function".to_string()),
+                        Value::String("function".into()),
                     ],
                     vec![
                         Value::NativeFunction(any_native.clone()),
-                        Value::String("dae".to_string()),
+                        Value::String("dae".into()),
                     ],
-                    vec![Value::Integer(1), Value::String("dae".to_string())],
-                    vec![Value::Integer(1), Value::String("unknown".to_string())],
+                    vec![Value::Integer(1), Value::String("dae".into())],
+                    vec![Value::Integer(1), Value::String("unknown".into())],
                 ]
             }
             ("fae_pairs", 1) => vec![vec![Value::List(Rc::new(RefCell::new(vec![
@@ -164,16 +183,16 @@ fn interpreter_calls_all_native_builtins_for_coverage() {
                 vec![Value::Integer(1)],
             ],
             ("scrieve", 2) => vec![vec![
-                Value::String(temp_path.clone()),
-                Value::String("hello\nworld\n".to_string()),
+                Value::String(temp_path.clone().into()),
+                Value::String("hello\nworld\n".into()),
             ]],
             ("append_file", 2) => vec![vec![
-                Value::String(temp_path.clone()),
-                Value::String("!".to_string()),
+                Value::String(temp_path.clone().into()),
+                Value::String("!".into()),
             ]],
-            ("read_file", 1) => vec![vec![Value::String(temp_path.clone())]],
-            ("read_lines", 1) => vec![vec![Value::String(temp_path.clone())]],
-            ("file_exists", 1) => vec![vec![Value::String(temp_path.clone())]],
+            ("read_file", 1) => vec![vec![Value::String(temp_path.clone().into())]],
+            ("read_lines", 1) => vec![vec![Value::String(temp_path.clone().into())]],
+            ("file_exists", 1) => vec![vec![Value::String(temp_path.clone().into())]],
             ("interleave", 2) => vec![
                 vec![
                     Value::List(Rc::new(RefCell::new(vec![Value::Integer(1)]))),
@@ -205,30 +224,27 @@ fn interpreter_calls_all_native_builtins_for_coverage() {
             (_, 0) => vec![vec![]],
             (_, 1) => arity1_args.iter().cloned().map(|v| vec![v]).collect(),
             (_, 2) => vec![
-                vec![
-                    Value::String("hello".to_string()),
-                    Value::String("he".to_string()),
-                ],
+                vec![Value::String("hello".into()), Value::String("he".into())],
                 vec![sample_list(), Value::Integer(1)],
-                vec![sample_dict(), Value::String("a".to_string())],
+                vec![sample_dict(), Value::String("a".into())],
                 vec![Value::Integer(1), Value::Integer(2)],
                 vec![Value::Float(1.0), Value::Float(2.0)],
             ],
             (_, 3) => vec![
                 vec![
-                    Value::String("hello".to_string()),
+                    Value::String("hello".into()),
                     Value::Integer(5),
-                    Value::String(" ".to_string()),
+                    Value::String(" ".into()),
                 ],
                 vec![
                     Value::Integer(0),
                     Value::Integer(1),
-                    Value::String("seconds".to_string()),
+                    Value::String("seconds".into()),
                 ],
                 vec![
-                    Value::String("a1b2".to_string()),
-                    Value::String("[0-9]".to_string()),
-                    Value::String("".to_string()),
+                    Value::String("a1b2".into()),
+                    Value::String("[0-9]".into()),
+                    Value::String("".into()),
                 ],
             ],
             // Unusual arities are uncommon; call with nils to at least execute the arity checks/type
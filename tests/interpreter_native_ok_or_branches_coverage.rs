@@ -29,11 +29,11 @@ fn result_ok_int(value: Value) -> i64 {
     };
     let dict = d.borrow();
     assert_eq!(
-        dict.get(&Value::String("ok".to_string())),
+        dict.get(&Value::String("ok".into())),
         Some(&Value::Bool(true)),
         "expected ok=true result"
     );
-    dict.get(&Value::String("value".to_string()))
+    dict.get(&Value::String("value".into()))
         .and_then(|v| v.as_integer())
         .expect("expected ok.value integer")
 }
@@ -44,7 +44,7 @@ fn assert_result_err(value: Value) {
     };
     let dict = d.borrow();
     assert_eq!(
-        dict.get(&Value::String("ok".to_string())),
+        dict.get(&Value::String("ok".into())),
         Some(&Value::Bool(false)),
         "expected ok=false result"
     );
@@ -67,7 +67,7 @@ fn interpreter_covers_selected_ok_or_error_branches_for_coverage() {
     let tls_recv = native(&interp, "tls_recv");
     let tls_close = native(&interp, "tls_close");
 
-    assert!((tls_client_new.func)(vec![Value::String("nope".to_string())]).is_err());
+    assert!((tls_client_new.func)(vec![Value::String("nope".into())]).is_err());
     let tls_id = result_ok_int((tls_client_new.func)(vec![Value::Nil]).unwrap());
     let tcp_id = result_ok_int((socket_tcp.func)(vec![]).unwrap());
 
@@ -135,15 +135,15 @@ fn interpreter_covers_selected_ok_or_error_branches_for_coverage() {
 
     // Nested argument-validation branches in common stdlib-style natives.
     let range = native(&interp, "range");
-    assert!((range.func)(vec![Value::Integer(0), Value::String("nope".to_string())]).is_err());
+    assert!((range.func)(vec![Value::Integer(0), Value::String("nope".into())]).is_err());
 
     let jammy = native(&interp, "jammy");
-    assert!((jammy.func)(vec![Value::Integer(0), Value::String("nope".to_string())]).is_err());
+    assert!((jammy.func)(vec![Value::Integer(0), Value::String("nope".into())]).is_err());
 
     let chynge = native(&interp, "chynge");
     assert!((chynge.func)(vec![
         Value::List(Rc::new(RefCell::new(vec![Value::Integer(1)]))),
-        Value::String("nope".to_string()),
+        Value::String("nope".into()),
         Value::Integer(2)
     ])
     .is_err());
@@ -151,46 +151,44 @@ fn interpreter_covers_selected_ok_or_error_branches_for_coverage() {
     let dicht = native(&interp, "dicht");
     assert!((dicht.func)(vec![
         Value::List(Rc::new(RefCell::new(vec![Value::Integer(1)]))),
-        Value::String("nope".to_string())
+        Value::String("nope".into())
     ])
     .is_err());
 
     let chunks = native(&interp, "chunks");
     assert!((chunks.func)(vec![
         Value::List(Rc::new(RefCell::new(vec![Value::Integer(1)]))),
-        Value::String("nope".to_string())
+        Value::String("nope".into())
     ])
     .is_err());
 
     let random_int = native(&interp, "random_int");
-    assert!((random_int.func)(vec![Value::Integer(1), Value::String("nope".to_string())]).is_err());
+    assert!((random_int.func)(vec![Value::Integer(1), Value::String("nope".into())]).is_err());
 
     let date_format = native(&interp, "date_format");
-    assert!((date_format.func)(vec![
-        Value::Integer(i64::MAX),
-        Value::String("%Y".to_string())
-    ])
-    .is_err());
+    assert!(
+        (date_format.func)(vec![Value::Integer(i64::MAX), Value::String("%Y".into())]).is_err()
+    );
 
     let date_add = native(&interp, "date_add");
     assert!((date_add.func)(vec![
         Value::Integer(0),
-        Value::String("nope".to_string()),
-        Value::String("seconds".to_string())
+        Value::String("nope".into()),
+        Value::String("seconds".into())
     ])
     .is_err());
     assert!((date_add.func)(vec![
         Value::Integer(i64::MAX),
         Value::Integer(1),
-        Value::String("seconds".to_string())
+        Value::String("seconds".into())
     ])
     .is_err());
 
     let date_diff = native(&interp, "date_diff");
     assert!((date_diff.func)(vec![
         Value::Integer(0),
-        Value::String("nope".to_string()),
-        Value::String("seconds".to_string())
+        Value::String("nope".into()),
+        Value::String("seconds".into())
     ])
     .is_err());
 
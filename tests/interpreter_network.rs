@@ -154,3 +154,154 @@ blether "opts_ok"
     let out = interp.get_output().join("\n");
     assert_eq!(out.trim(), "opts_ok");
 }
+
+const BOUND_UDP: &str = r#"
+dae bound_udp(start) {
+    fer p in start..start + 100 {
+        ken sock = socket_udp()["value"]
+        gin socket_bind(sock, "127.0.0.1", p)["ok"] {
+            gie [sock, p]
+        }
+        socket_close(sock)
+    }
+    gie naething
+}
+"#;
+
+const BOUND_TCP: &str = r#"
+dae bound_tcp(start) {
+    fer p in start..start + 100 {
+        ken sock = socket_tcp()["value"]
+        socket_set_reuseaddr(sock, aye)
+        gin socket_bind(sock, "127.0.0.1", p)["ok"] {
+            socket_listen(sock, 4)
+            gie [sock, p]
+        }
+        socket_close(sock)
+    }
+    gie naething
+}
+"#;
+
+fn run(source: &str) -> String {
+    let program = parse(&[BOUND_UDP, BOUND_TCP, source].concat()).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    interp.get_output().join("\n")
+}
+
+#[test]
+fn interpreter_udp_batches_round_trip() {
+    let out = run(r#"
+ken rx = bound_udp(42000)
+ken tx = bound_udp(42100)
+ken packets = []
+fer i in 0..4 {
+    ken addr = {"host": "127.0.0.1", "port": rx[1]}
+    shove(packets, {"buf": bytes_from_string("pkt" + tae_string(i)), "addr": addr})
+}
+blether udp_send_many(tx[0], packets)["value"]
+
+ken batch = udp_recv_many(rx[0], 8, 64)["value"]
+blether len(batch["bufs"])
+blether batch["addrs"][3]["port"] == tx[1]
+blether udp_send_many(rx[0], batch)["value"]
+blether len(udp_recv_many(tx[0], 3, 64)["value"]["bufs"])
+"#);
+    assert_eq!(out.trim(), "4\n4\naye\n4\n3");
+}
+
+#[test]
+fn interpreter_udp_replies_to_received_and_resolved_addresses() {
+    let out = run(r#"
+ken rx = bound_udp(42200)
+ken tx = bound_udp(42300)
+ken peer = addr_resolve("127.0.0.1", rx[1])["value"]
+blether peer["port"] == rx[1]
+blether udp_send_to(tx[0], bytes_from_string("ping"), peer)["value"]
+
+ken got = udp_recv_from(rx[0], 64)["value"]
+blether join(sort(keys(got["addr"])), ",")
+blether udp_send_to(rx[0], bytes_from_string("pong"), got["addr"])["value"]
+blether bytes_get(udp_recv_from(tx[0], 64)["value"]["buf"], 1)
+blether tae_string(peer) == "127.0.0.1:" + tae_string(rx[1])
+"#);
+    assert_eq!(out.trim(), "aye\n4\nhost,port\n4\n111\naye");
+}
+
+#[test]
+fn interpreter_udp_receives_into_pooled_buffers() {
+    let out = run(r#"
+ken rx = bound_udp(42400)
+ken tx = bound_udp(42500)
+ken buf = bytes_pool_take(2048)
+blether bytes_len(buf)
+udp_send_to(tx[0], bytes_from_string("hello"), "127.0.0.1", rx[1])
+ken got = udp_recv_into(rx[0], buf)["value"]
+blether got["len"]
+blether got["addr"]["port"] == tx[1]
+blether bytes_get(buf, 4)
+bytes_pool_give(buf)
+blether bytes_len(buf)
+blether bytes_len(bytes_pool_take(512))
+"#);
+    assert_eq!(out.trim(), "2048\n5\naye\n111\n0\n512");
+}
+
+#[test]
+fn interpreter_tcp_sends_vectors_and_all() {
+    let out = run(r#"
+ken srv = bound_tcp(42600)
+ken c = socket_tcp()["value"]
+socket_connect(c, "127.0.0.1", srv[1])
+ken s = socket_accept(srv[0])["value"]["sock"]
+blether tcp_send_vec(s, ["HTTP/1.1 200 OK\n\n", bytes_from_string("body")])["value"]
+blether bytes_len(tcp_recv(c, 100)["value"])
+blether tcp_send_all(s, bytes_new(50000))["value"]
+blether tcp_send_all(s, [bytes_from_string("a"), "b"])["value"]
+ken got = 0
+whiles got < 50002 {
+    got = got + bytes_len(tcp_recv(c, 65536)["value"])
+}
+blether got
+"#);
+    assert_eq!(out.trim(), "21\n21\n50000\n2\n50002");
+}
+
+#[test]
+fn interpreter_socket_sends_file_ranges() {
+    let dir = tempfile::tempdir().unwrap();
+    let path = dir.path().join("payload.bin");
+    let data: Vec<u8> = (0..60000u32).map(|i| (i % 251) as u8).collect();
+    std::fs::write(&path, data).unwrap();
+    let source = r#"
+ken srv = bound_tcp(42700)
+ken c = socket_tcp()["value"]
+socket_connect(c, "127.0.0.1", srv[1])
+ken s = socket_accept(srv[0])["value"]["sock"]
+blether socket_send_file(s, "PATH", 10, 5)["value"]
+blether bytes_get(tcp_recv(c, 100)["value"], 0)
+blether socket_send_file(s, "PATH", 0, -1)["value"]
+blether socket_send_file(s, "PATH", 70000, -1)["value"]
+blether socket_send_file(s, "PATH.missing", 0, -1)["ok"]
+ken got = 0
+whiles got < 60000 {
+    got = got + bytes_len(tcp_recv(c, 65536)["value"])
+}
+blether got
+"#
+    .replace("PATH", &path.to_string_lossy());
+    let out = run(&source);
+    assert_eq!(out.trim(), "5\n10\n60000\n0\nnae\n60000");
+}
+
+#[test]
+fn interpreter_dns_lookup_async_returns_filled_channel() {
+    let out = run(r#"
+ken ch = dns_lookup_async("127.0.0.1")
+blether chan_is_closed(ch)
+blether chan_try_recv(ch)["value"][0]
+blether chan_try_recv(ch)
+"#);
+    assert_eq!(out.trim(), "aye\n127.0.0.1\nnaething");
+}
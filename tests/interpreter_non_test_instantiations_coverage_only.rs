@@ -37,7 +37,7 @@ log_span_in(span, f)
 #[test]
 fn char_at_success_executes_non_test_map_closure_for_coverage() {
     let (value, _out) = interpret_ok(r#"char_at("hi", 0)"#);
-    assert_eq!(value, Value::String("h".to_string()));
+    assert_eq!(value, Value::String("h".into()));
 }
 
 #[test]
@@ -29,7 +29,7 @@ fn assert_result_err(value: Value) {
     };
     let dict = d.borrow();
     assert_eq!(
-        dict.get(&Value::String("ok".to_string())),
+        dict.get(&Value::String("ok".into())),
         Some(&Value::Bool(false)),
         "expected ok=false result"
     );
@@ -36,9 +36,9 @@ fn result_ok_value(value: Value) -> Option<Value> {
         return None;
     };
     let dict = d.borrow();
-    let ok = dict.get(&Value::String("ok".to_string()))?;
+    let ok = dict.get(&Value::String("ok".into()))?;
     if ok == &Value::Bool(true) {
-        dict.get(&Value::String("value".to_string())).cloned()
+        dict.get(&Value::String("value".into())).cloned()
     } else {
         None
     }
@@ -56,7 +56,7 @@ fn assert_result_err(value: Value) {
     };
     let dict = d.borrow();
     assert_eq!(
-        dict.get(&Value::String("ok".to_string())),
+        dict.get(&Value::String("ok".into())),
         Some(&Value::Bool(false)),
         "expected ok=false result"
     );
@@ -91,7 +91,7 @@ fn interpreter_socket_and_io_builtins_cover_error_paths_for_coverage() {
     // socket_bind: empty host string is treated like nil (binds to INADDR_ANY).
     let bind_empty = (socket_bind.func)(vec![
         Value::Integer(udp_id),
-        Value::String("".to_string()),
+        Value::String("".into()),
         Value::Integer(0),
     ])
     .unwrap();
@@ -119,7 +119,7 @@ fn interpreter_socket_and_io_builtins_cover_error_paths_for_coverage() {
     assert!(
         (socket_connect.func)(vec![
             Value::Nil,
-            Value::String("127.0.0.1".to_string()),
+            Value::String("127.0.0.1".into()),
             Value::Integer(0)
         ])
         .is_err(),
@@ -128,7 +128,7 @@ fn interpreter_socket_and_io_builtins_cover_error_paths_for_coverage() {
     assert!(
         (socket_connect.func)(vec![
             Value::Integer(tcp_id),
-            Value::String("127.0.0.1".to_string()),
+            Value::String("127.0.0.1".into()),
             Value::Nil
         ])
         .is_err(),
@@ -156,7 +156,7 @@ fn interpreter_socket_and_io_builtins_cover_error_paths_for_coverage() {
         (socket_bind.func)(vec![Value::Integer(tcp_id), Value::Nil, Value::Integer(70000)]).is_err()
     );
     // socket_bind/socket_connect/udp_send_to: resolve_ipv4_addr error mapping (invalid host string)
-    let bad_host = Value::String("bad host".to_string());
+    let bad_host = Value::String("bad host".into());
     assert!(
         (socket_bind.func)(vec![Value::Integer(tcp_id), bad_host.clone(), Value::Integer(0)])
             .is_err()
@@ -178,7 +178,7 @@ fn interpreter_socket_and_io_builtins_cover_error_paths_for_coverage() {
         (udp_send_to.func)(vec![
             Value::Nil,
             bytes(b"hi"),
-            Value::String("127.0.0.1".to_string()),
+            Value::String("127.0.0.1".into()),
             Value::Integer(0),
         ])
         .is_err(),
@@ -188,7 +188,7 @@ fn interpreter_socket_and_io_builtins_cover_error_paths_for_coverage() {
         (udp_send_to.func)(vec![
             Value::Integer(udp_id),
             bytes(b"hi"),
-            Value::String("127.0.0.1".to_string()),
+            Value::String("127.0.0.1".into()),
             Value::Nil,
         ])
         .is_err(),
@@ -198,7 +198,7 @@ fn interpreter_socket_and_io_builtins_cover_error_paths_for_coverage() {
         (udp_send_to.func)(vec![
             Value::Integer(999_999),
             bytes(b"hi"),
-            Value::String("127.0.0.1".to_string()),
+            Value::String("127.0.0.1".into()),
             Value::Integer(0),
         ])
         .is_err(),
@@ -221,30 +221,26 @@ fn interpreter_socket_and_io_builtins_cover_error_paths_for_coverage() {
     assert!(
         (socket_connect.func)(vec![Value::Integer(tcp_id), Value::Nil, Value::Integer(0)]).is_err()
     );
-    assert!(
-        (socket_connect.func)(vec![
-            Value::Integer(tcp_id),
-            Value::String("127.0.0.1".to_string()),
-            Value::Integer(70000)
-        ])
-        .is_err()
-    );
+    assert!((socket_connect.func)(vec![
+        Value::Integer(tcp_id),
+        Value::String("127.0.0.1".into()),
+        Value::Integer(70000)
+    ])
+    .is_err());
     let conn_err = (socket_connect.func)(vec![
         Value::Integer(tcp_id),
-        Value::String("127.0.0.1".to_string()),
+        Value::String("127.0.0.1".into()),
         Value::Integer(0),
     ])
     .unwrap();
     assert_result_err(conn_err);
     // socket_connect: unknown socket handle
-    assert!(
-        (socket_connect.func)(vec![
-            Value::Integer(999_999),
-            Value::String("127.0.0.1".to_string()),
-            Value::Integer(0)
-        ])
-        .is_err()
-    );
+    assert!((socket_connect.func)(vec![
+        Value::Integer(999_999),
+        Value::String("127.0.0.1".into()),
+        Value::Integer(0)
+    ])
+    .is_err());
 
     // socket_listen: syscall error (listen on UDP socket)
     let listen_err = (socket_listen.func)(vec![Value::Integer(udp_id), Value::Integer(1)]).unwrap();
@@ -412,7 +408,7 @@ fn interpreter_socket_and_io_builtins_cover_error_paths_for_coverage() {
     assert!((udp_send_to.func)(vec![
             Value::Integer(udp_id),
             Value::Nil,
-            Value::String("127.0.0.1".to_string()),
+            Value::String("127.0.0.1".into()),
             Value::Integer(0),
         ])
         .is_err());
@@ -426,7 +422,7 @@ fn interpreter_socket_and_io_builtins_cover_error_paths_for_coverage() {
     assert!((udp_send_to.func)(vec![
             Value::Integer(udp_id),
             bytes(b"hi"),
-            Value::String("127.0.0.1".to_string()),
+            Value::String("127.0.0.1".into()),
             Value::Integer(70000),
         ])
         .is_err());
@@ -239,3 +239,71 @@ fn interpreter_srtp_unprotect_rejects_non_bytes_packet_for_coverage() {
         "unexpected error: {s}"
     );
 }
+
+#[test]
+fn interpreter_srtp_protects_in_place() {
+    let code = r#"
+dae make_bytes_seq(n, start) {
+    ken b = bytes(n)
+    fer i in 0..n {
+        bytes_set(b, i, start + i)
+    }
+    gie b
+}
+
+ken ctx = srtp_create({"master_key": make_bytes_seq(16, 1), "master_salt": make_bytes_seq(14, 50)})["value"]
+ken pkt = make_bytes_seq(16, 0)
+bytes_set(pkt, 0, 128)
+ken original = bytes_slice(pkt, 0, 16)
+ken expected = srtp_protect(ctx, pkt)["value"]
+blether srtp_protect_into(ctx, pkt)["value"]
+blether bytes_len(pkt)
+blether bytes_eq(pkt, expected)
+blether srtp_unprotect_into(ctx, pkt)["value"]
+blether bytes_eq(pkt, original)
+ken tampered = bytes_slice(expected, 0, bytes_len(expected))
+bytes_set(tampered, 20, (bytes_get(tampered, 20) + 1) % 256)
+blether srtp_unprotect_into(ctx, tampered)["ok"]
+blether bytes_len(tampered)
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output().join("\n");
+    assert_eq!(out.trim(), "26\n26\naye\n16\naye\nnae\n26");
+}
+
+#[test]
+fn interpreter_srtp_protects_batches() {
+    let code = r#"
+dae make_bytes_seq(n, start) {
+    ken b = bytes(n)
+    fer i in 0..n {
+        bytes_set(b, i, start + i)
+    }
+    gie b
+}
+
+ken ctx = srtp_create({"master_key": make_bytes_seq(16, 1), "master_salt": make_bytes_seq(14, 50)})["value"]
+ken batch = []
+fer i in 0..3 {
+    ken pkt = make_bytes_seq(16, 0)
+    bytes_set(pkt, 0, 128)
+    bytes_set(pkt, 3, i + 1)
+    shove(batch, pkt)
+}
+blether srtp_protect_many(ctx, batch)["value"]
+bytes_set(batch[1], 20, (bytes_get(batch[1], 20) + 1) % 256)
+blether srtp_unprotect_many(ctx, {"bufs": batch, "addrs": []})["value"]
+blether bytes_len(batch[1])
+blether bytes_get(batch[2], 3)
+blether srtp_protect_many(ctx, [])["value"]
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output().join("\n");
+    assert_eq!(out.trim(), "[26, 26, 26]\n[16, -1, 16]\n26\n3\n[]");
+}
@@ -0,0 +1,250 @@
+//! Native bytes: slices that share their parent's buffer.
+
+#![cfg(feature = "llvm")]
+
+use std::process::Command;
+
+use mdhavers::{parse, LLVMCompiler};
+use tempfile::tempdir;
+
+fn compile_and_run(source: &str) -> Result<String, String> {
+    let program = parse(source).map_err(|e| format!("Parse error: {:?}", e))?;
+
+    let dir = tempdir().map_err(|e| format!("Failed to create temp dir: {}", e))?;
+    let exe_path = dir.path().join("bytes_test_exe");
+
+    let compiler = LLVMCompiler::new();
+    compiler
+        .compile_to_native(&program, &exe_path, 2)
+        .map_err(|e| format!("Compile error: {:?}", e))?;
+
+    let output = Command::new(&exe_path)
+        .output()
+        .map_err(|e| format!("Failed to run executable: {}", e))?;
+
+    if !output.status.success() {
+        let stderr = String::from_utf8_lossy(&output.stderr);
+        return Err(format!(
+            "Executable failed with exit code: {:?}, stderr: {}",
+            output.status.code(),
+            stderr
+        ));
+    }
+
+    Ok(String::from_utf8_lossy(&output.stdout).to_string())
+}
+
+#[test]
+fn llvm_bytes_slices_copy_on_write() {
+    let source = r#"
+ken packet = bytes_new(200)
+fer i in 0..200 {
+    bytes_set(packet, i, i)
+}
+ken payload = bytes_slice(packet, 12, 200)
+blether bytes_len(payload)
+blether bytes_get(payload, 0)
+
+bytes_set(payload, 0, 99)
+blether bytes_get(payload, 0)
+blether bytes_get(packet, 12)
+
+ken tail = bytes_slice(packet, 100, 200)
+bytes_write_u16be(packet, 100, 65535)
+blether bytes_get(tail, 0)
+blether bytes_get(packet, 100)
+
+ken head = bytes_slice(packet, 0, 100)
+bytes_append(head, bytes_from_string("zz"))
+blether bytes_len(head)
+blether bytes_len(packet)
+blether bytes_get(packet, 100)
+blether bytes_slice(packet, 0, 150) == bytes_slice(packet, 0, 150)
+"#;
+    let out = compile_and_run(source).expect("compile/run failed");
+    assert_eq!(out.trim(), "188\n12\n99\n12\n100\n255\n102\n200\n255\naye");
+}
+
+#[test]
+fn llvm_bytes_bulk_primitives() {
+    let source = r#"
+ken b = bytes(16)
+bytes_write_u32le(b, 0, 305419896)
+blether bytes_get(b, 0)
+blether bytes_read_u32be(b, 0)
+blether bytes_read_u16le(b, 2)
+bytes_write_u64be(b, 8, 72623859790382856)
+blether bytes_get(b, 15)
+blether bytes_read_u64le(b, 8)
+blether bytes_read_u64be(b, 8)
+blether bytes_find(b, bytes_slice(b, 10, 12))
+blether bytes_find(b, bytes_from_string("zz"))
+
+ken key = bytes(16)
+bytes_fill(key, 255, 0, 16)
+ken x = bytes_xor(b, key)
+blether bytes_get(x, 15)
+blether bytes_eq(bytes_xor(x, key), b)
+
+bytes_copy_within(b, 0, 8, 16)
+blether bytes_read_u64be(b, 0)
+bytes_fill(b, 0, -8, 16)
+blether bytes_get(b, 15)
+blether bytes_eq(b, key)
+"#;
+    let out = compile_and_run(source).expect("compile/run failed");
+    assert_eq!(
+        out.trim(),
+        "120\n2018915346\n4660\n8\n578437695752307201\n72623859790382856\n10\n-1\n247\naye\n72623859790382856\n0\nnae"
+    );
+}
+
+#[test]
+fn llvm_bytes_rtp_header_views_its_payload() {
+    let source = r#"
+ken payload = bytes_new(160)
+bytes_fill(payload, 7, 0, 160)
+ken packet = rtp_build_native(payload, 65535, 4294967295, 12345, 96, aye, [1, 2])
+blether bytes_len(packet)
+
+ken h = rtp_parse_native(packet)
+blether whit_kind(h)
+blether h["ok"]
+blether h["seq"]
+blether h["timestamp"]
+blether h["marker"]
+blether h["csrcs"]
+blether h["header_len"]
+blether h["payload"] == payload
+
+bytes_set(h["payload"], 0, 99)
+blether bytes_get(h["payload"], 0)
+blether bytes_get(packet, 20)
+
+ken short = rtp_parse_native(bytes_new(5))
+blether short["ok"]
+blether short["error"]
+"#;
+    let out = compile_and_run(source).expect("compile/run failed");
+    assert_eq!(
+        out.trim(),
+        "180\nrtp_header\naye\n65535\n4294967295\naye\n[1, 2]\n20\naye\n99\n7\nnae\nrtp packet too short"
+    );
+}
+
+#[test]
+fn llvm_bytes_codecs_and_digests() {
+    let source = r#"
+ken big = bytes_new(300000)
+fer i in 0..300000 {
+    bytes_set(big, i, (i * 7) % 256)
+}
+ken wire = base64_encode_native(big)
+blether len(wire)
+blether bytes_eq(base64_decode_native(wire, nae), big)
+blether bytes_eq(hex_decode_native(hex_encode_native(big), nae), big)
+blether base64_decode_native("SGVs\nbG8=", aye)
+blether hex_decode_native("48zz69", aye)
+
+blether hex_encode_native(sha256("abc"))
+blether hex_encode_native(sha1(""))
+blether hex_encode_native(sha256(big)) == hex_encode_native(sha256(bytes_slice(big, 0, 300000)))
+blether crc32("123456789")
+blether xxhash64("")
+blether base64_encode_native(sha1("dGhlIHNhbXBsZSBub25jZQ==258EAFA5-E914-47DA-95CA-C5AB0DC85B11"))
+"#;
+    let out = compile_and_run(source).expect("compile/run failed");
+    assert_eq!(
+        out.trim(),
+        "400000\naye\naye\nHello\nHi\n\
+         ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad\n\
+         da39a3ee5e6b4b0d3255bfef95601890afd80709\naye\n3421780262\n-1205034819632174695\n\
+         s3pPLMBiTxaQ9kYGzzhZRbK+xOo="
+    );
+}
+
+#[test]
+fn llvm_pack_round_trips_values_as_messagepack() {
+    let source = r#"
+ken record = {"id": 7, "score": 2.0, "tags": ["a", naething, aye], "raw": bytes_from_string("hi")}
+blether hex_encode_native(pack({"a": 1, "f": 2.0, "n": -200}))
+ken back = unpack(pack(record))
+blether whit_kind(back["score"])
+blether back["tags"]
+blether bytes_eq(back["raw"], bytes_from_string("hi"))
+ken c = unpack(pack(creel(["x", "y"])))
+blether whit_kind(c)
+blether is_in_creel(c, "y")
+ken buf = bytes(0)
+pack_into(buf, [1, 300, "three"])
+blether hex_encode_native(buf)
+blether unpack(buf)
+
+ken wire = pack("first")
+bytes_append(wire, pack(42))
+bytes_append(wire, pack(record))
+ken s = unpack_stream_new()
+ken got = []
+fer i in 0..bytes_len(wire) {
+    unpack_stream_feed(s, bytes_slice(wire, i, i + 1))
+    ken v = unpack_stream_next(s)
+    gin v != naething { shove(got, i) }
+}
+blether got
+blether unpack_stream_next(s)
+"#;
+    let out = compile_and_run(source).expect("compile/run failed");
+    assert_eq!(
+        out.trim(),
+        "83a16101a166cb4000000000000000a16ed1ff38\nfloat\n[a, naething, aye]\naye\ncreel\naye\n\
+         9301cd012ca57468726565\n[1, 300, three]\n[5, 6, 44]\nnaething"
+    );
+}
+
+#[test]
+fn llvm_bytes_compress_round_trips_and_gzip_streams_write_sinks() {
+    let dir = tempdir().expect("tempdir");
+    let path = dir.path().join("lines.gz");
+    let source = format!(
+        r#"
+ken text = ""
+fer i in 0..200 {{ text = text + "braw bricht munelicht nicht " }}
+ken gz = bytes_compress(text)
+blether bytes_len(gz) < 200
+blether hex_encode_native(bytes_slice(gz, 0, 3))
+blether bytes_eq(bytes_decompress(gz), bytes_from_string(text))
+ken z = bytes_compress(text, 9, "zlib")
+blether hex_encode_native(bytes_slice(z, 0, 1))
+blether bytes_eq(bytes_decompress(z), bytes_from_string(text))
+blether bytes_eq(bytes_decompress(bytes_compress(text, 0, "raw"), "raw"), bytes_from_string(text))
+
+ken s = gzip_stream_new()
+ken wire = gzip_stream_write(s, "first line\n")
+bytes_append(wire, gzip_stream_flush(s))
+bytes_append(wire, gzip_stream_write(s, text))
+bytes_append(wire, gzip_stream_close(s))
+blether bytes_len(bytes_decompress(wire)) == 11 + len(text)
+
+ken fh = file_open("{path}")
+ken sink = gzip_stream_new(fh, 1)
+fer i in 0..3 {{ gzip_stream_write(sink, text) }}
+gzip_stream_close(sink)
+file_close(fh)
+blether bytes_len(bytes_decompress(file_map("{path}"))) == 3 * len(text)
+
+hae_a_bash {{
+    bytes_decompress(bytes_slice(gz, 0, 20))
+}} gin_it_gangs_wrang e {{
+    blether e
+}}
+"#,
+        path = path.display()
+    );
+    let out = compile_and_run(&source).expect("compile/run failed");
+    assert_eq!(
+        out.trim(),
+        "aye\n1f8b08\naye\n78\naye\naye\naye\naye\nbytes_decompress: bad or cut-short deflate data"
+    );
+    let written = std::fs::read(&path).expect("gzip file");
+    assert_eq!(&written[..2], &[0x1f, 0x8b]);
+}
@@ -591,6 +591,7 @@ fn llvm_codegen_inclusive_range_for_loop_ast_path_for_coverage() {
             statements: vec![Stmt::Print {
                 value: Expr::Variable {
                     name: "i".to_string(),
+                    slot: None,
                     span,
                 },
                 span,
@@ -609,6 +610,7 @@ fn llvm_codegen_covers_haud_yer_wheesht_builtin_via_ast_for_coverage() {
     let call = Expr::Call {
         callee: Box::new(Expr::Variable {
             name: "haud_yer_wheesht".to_string(),
+            slot: None,
             span,
         }),
         arguments: vec![],
@@ -625,6 +627,7 @@ fn llvm_codegen_rejects_haud_yer_wheesht_with_args_via_ast_for_coverage() {
     let call = Expr::Call {
         callee: Box::new(Expr::Variable {
             name: "haud_yer_wheesht".to_string(),
+            slot: None,
             span,
         }),
         arguments: vec![Expr::Literal {
@@ -301,6 +301,39 @@ mod strings {
         assert_eq!(run(r#"blether len("")"#).trim(), "0");
     }
 
+    #[test]
+    fn test_runtime_built_string_length_and_equality() {
+        let code = r#"
+            ken padded = leftpad("abc", 6, "-")
+            blether len(padded)
+            blether padded == "---abc"
+            blether padded == "---abd"
+            ken joined = padded + centre("x", 3)
+            blether len(joined)
+            blether joined
+        "#;
+        assert_eq!(run(code).trim(), "6\naye\nnae\n9\n---abc x");
+    }
+
+    #[test]
+    fn test_self_append_with_variable_keeps_aliases_intact() {
+        let code = r#"
+            ken s = ""
+            ken parts = ["ab", "c", "def"]
+            fer i in 0..1000 {
+                s = s + parts[i % 3]
+            }
+            blether len(s)
+            ken snap = s
+            s = s + "X"
+            s = s + snap
+            blether len(snap)
+            blether len(s)
+            blether s == snap + "X" + snap
+        "#;
+        assert_eq!(run(code).trim(), "2000\n2000\n4001\naye");
+    }
+
     #[test]
     fn test_string_upper_lower() {
         assert_eq!(run(r#"blether upper("hello")"#).trim(), "HELLO");
@@ -552,6 +585,71 @@ mod dicts {
         assert_eq!(run(code).trim(), "aye");
     }
 
+    #[test]
+    fn test_large_dict_indexed_lookup() {
+        let code = r#"
+            ken d = {}
+            fer i in 0..500 {
+                d["k" + tae_string(i)] = i
+            }
+            ken total = 0
+            fer i in 0..500 {
+                total = total + d["k" + tae_string(i)]
+            }
+            blether len(d)
+            blether total
+            blether contains(d, "k499")
+            blether contains(d, "k500")
+        "#;
+        assert_eq!(run(code).trim(), "500\n124750\naye\nnae");
+    }
+
+    #[test]
+    fn test_dict_growth_keeps_insertion_order() {
+        let code = r#"
+            ken d = {}
+            fer i in 0..20 {
+                d[20 - i] = i
+            }
+            d[3] = 99
+            ken k = keys(d)
+            blether len(d)
+            blether k[0]
+            blether k[19]
+            blether d[3]
+        "#;
+        assert_eq!(run(code).trim(), "20\n20\n1\n99");
+    }
+
+    #[test]
+    fn test_keys_added_in_a_function_stay_local_at_every_size() {
+        // Sizes either side of the 4 and 8 entry regrows
+        let code = r#"
+            dae add_key(d) {
+                d[999] = 1
+                gie len(d)
+            }
+            dae add_item(s) {
+                toss_in(s, 999)
+                gie len(s)
+            }
+            ken same = 0
+            fer n in 0..11 {
+                ken d = {}
+                ken s = empty_creel()
+                fer i in 0..n {
+                    d[i] = i
+                    toss_in(s, i)
+                }
+                gin add_key(d) == n + 1 an len(d) == n an add_item(s) == n + 1 an len(s) == n {
+                    same = same + 1
+                }
+            }
+            blether same
+        "#;
+        assert_eq!(run(code).trim(), "11");
+    }
+
     #[test]
     fn test_dict_function_call() {
         let code = r#"
@@ -2345,6 +2443,68 @@ mod advanced_closures {
         "#;
         assert_eq!(run(code).trim(), "20");
     }
+
+    #[test]
+    fn test_closure_captures_many_through_variable() {
+        let code = r#"
+            dae make(a, b, c, d) {
+                gie |x, y| a + b * x + c * y + d
+            }
+            ken f = make(1, 2, 3, 4)
+            ken g = f
+            blether f(10, 100)
+            blether g(1, 1)
+        "#;
+        assert_eq!(run(code).trim(), "325\n10");
+    }
+
+    #[test]
+    fn test_closure_mutates_capture_across_calls() {
+        let code = r#"
+            ken total = 0
+            ken step = 5
+            ken add = |n| {
+                total = total + n * step
+                gie total
+            }
+            add(1)
+            add(2)
+            blether add(3)
+            blether total
+        "#;
+        assert_eq!(run(code).trim(), "30\n30");
+    }
+
+    #[test]
+    fn test_closure_redeclared_capture_is_per_call() {
+        let code = r#"
+            ken base = 7
+            ken f = |n| {
+                ken base = base + n
+                gie base
+            }
+            blether f(1)
+            blether f(2)
+            blether base
+        "#;
+        assert_eq!(run(code).trim(), "8\n9\n7");
+    }
+
+    #[test]
+    fn test_nested_function_with_captures_as_value() {
+        let code = r#"
+            dae scaler(k) {
+                dae scale(v) {
+                    gie v * k
+                }
+                gie scale
+            }
+            ken triple = scaler(3)
+            blether triple(4)
+            blether gaun([1, 2, 3], triple)
+        "#;
+        assert_eq!(run(code).trim(), "12\n[3, 6, 9]");
+    }
 }
 
 // ============================================================================
@@ -38512,6 +38672,28 @@ blether len(sicht.children)
         assert_eq!(run(code).trim(), "1");
     }
 
+    #[test]
+    fn test_tri_native_method_selectors() {
+        let code = r#"
+fetch "tri" tae tri
+ken sicht = tri.Sicht()
+ken a = tri.Sicht()
+ken b = tri.Sicht()
+sicht.adde(a)
+sicht.add(b)
+sicht.remuiv(a)
+blether len(sicht.children)
+sicht.set_sise(640, 480)
+blether sicht.height
+sicht.setPixelRatio(2)
+blether sicht.pixelRatio
+sicht.dispose()
+sicht.nae_sic_method()
+blether "done"
+        "#;
+        assert_eq!(run(code).trim(), "1\n480\n2\ndone");
+    }
+
     #[test]
     fn test_tri_constructor_defaults() {
         let code = r#"
@@ -68483,6 +68665,29 @@ mod median_cov {
         let output = binding.trim();
         assert_eq!(output, "5");
     }
+
+    #[test]
+    fn test_median_unsorted_even() {
+        let code = r#"blether median([5, 1, 4, 2])"#;
+        let binding = run(code);
+        let output = binding.trim();
+        assert_eq!(output, "3");
+    }
+
+    #[test]
+    fn test_percentile_and_stats() {
+        let code = r#"
+blether percentile(range(1, 101), 95)
+ken s = stats([9, 4, 5, 2, 4, 7, 5, 4])
+blether s["count"]
+blether s["stddev"]
+blether s["min"]
+blether s["p50"]
+"#;
+        let binding = run(code);
+        let lines: Vec<&str> = binding.trim().lines().collect();
+        assert_eq!(lines, vec!["95.05", "8", "2", "2", "4.5"]);
+    }
 }
 
 // Tests for zip alternative
@@ -0,0 +1,304 @@
+//! Native event loop: watches on many sockets, readiness from the kernel backend.
+
+#![cfg(feature = "llvm")]
+
+use std::process::Command;
+
+use mdhavers::{parse, LLVMCompiler};
+use tempfile::tempdir;
+
+fn compile_and_run(source: &str, env: &[(&str, &str)]) -> Result<String, String> {
+    let program = parse(source).map_err(|e| format!("Parse error: {:?}", e))?;
+
+    let dir = tempdir().map_err(|e| format!("Failed to create temp dir: {}", e))?;
+    let exe_path = dir.path().join("event_loop_test_exe");
+
+    let compiler = LLVMCompiler::new();
+    compiler
+        .compile_to_native(&program, &exe_path, 2)
+        .map_err(|e| format!("Compile error: {:?}", e))?;
+
+    let output = Command::new(&exe_path)
+        .envs(env.iter().copied())
+        .output()
+        .map_err(|e| format!("Failed to run executable: {}", e))?;
+
+    if !output.status.success() {
+        let stderr = String::from_utf8_lossy(&output.stderr);
+        return Err(format!(
+            "Executable failed with exit code: {:?}, stderr: {}",
+            output.status.code(),
+            stderr
+        ));
+    }
+
+    Ok(String::from_utf8_lossy(&output.stdout).to_string())
+}
+
+const MANY_WATCHES: &str = r#"
+dae on_read(ev) {
+}
+
+ken loop = event_loop_new()
+ken socks = []
+ken ports = []
+ken p = 43000
+whiles len(socks) < 200 && p < 44000 {
+    ken sock = socket_udp()["value"]
+    gin socket_bind(sock, "127.0.0.1", p)["ok"] {
+        event_watch_read(loop, sock, on_read)
+        shove(socks, sock)
+        shove(ports, p)
+    } ither {
+        socket_close(sock)
+    }
+    p = p + 1
+}
+blether len(event_loop_poll(loop, 0))
+
+ken sender = socket_udp()["value"]
+udp_send_to(sender, bytes_from_string("a"), "127.0.0.1", ports[7])
+udp_send_to(sender, bytes_from_string("b"), "127.0.0.1", ports[150])
+ken events = event_loop_poll(loop, 200)
+ken total = 0
+fer ev in events {
+    total = total + ev["sock"]
+}
+blether len(events)
+blether total == socks[7] + socks[150]
+
+event_unwatch(loop, socks[7])
+blether len(event_loop_poll(loop, 0))
+socket_close(sender)
+"#;
+
+#[test]
+fn llvm_event_loop_reports_only_ready_sockets() {
+    let out = compile_and_run(MANY_WATCHES, &[]).expect("compile/run failed");
+    assert_eq!(out.trim(), "0\n2\naye\n1");
+}
+
+#[test]
+fn llvm_event_loop_poll_fallback_matches_backend() {
+    let out = compile_and_run(MANY_WATCHES, &[("MDH_EVENT_BACKEND", "poll")])
+        .expect("compile/run failed");
+    assert_eq!(out.trim(), "0\n2\naye\n1");
+}
+
+#[test]
+fn llvm_event_loop_io_uring_reads_carry_datagrams() {
+    // Falls back to epoll (no "buf" on events) where io_uring is unavailable.
+    let out = compile_and_run(
+        r#"
+dae on_read(ev) {
+}
+
+ken loop = event_loop_new()
+ken sock = naething
+ken port = 44000
+whiles sock == naething && port < 44100 {
+    ken s = socket_udp()["value"]
+    gin socket_bind(s, "127.0.0.1", port)["ok"] {
+        sock = s
+    } ither {
+        socket_close(s)
+        port = port + 1
+    }
+}
+event_watch_read(loop, sock, on_read)
+ken sender = socket_udp()["value"]
+fer i in 0..3 {
+    udp_send_to(sender, bytes_from_string("pkt" + tae_string(i)), "127.0.0.1", port)
+}
+ken seen = 0
+ken payloads = []
+whiles seen < 3 {
+    fer ev in event_loop_poll(loop, 200) {
+        seen = seen + 1
+        gin dict_has(ev, "buf") {
+            shove(payloads, bytes_get(ev["buf"], 3) - 48)
+        } ither {
+            shove(payloads, bytes_get(udp_recv_from(sock, 64)["value"]["buf"], 3) - 48)
+        }
+    }
+}
+blether payloads
+"#,
+        &[("MDH_EVENT_BACKEND", "io_uring")],
+    )
+    .expect("compile/run failed");
+    assert_eq!(out.trim(), "[0, 1, 2]");
+}
+
+#[test]
+fn llvm_event_loop_timers_fire_in_deadline_order() {
+    let out = compile_and_run(
+        r#"
+dae on_timer(ev) {
+}
+
+ken loop = event_loop_new()
+ken names = {}
+names[tae_string(timer_after(loop, 40, on_timer))] = "late"
+names[tae_string(timer_after(loop, 5, on_timer))] = "early"
+ken dropped = timer_after(loop, 10, on_timer)
+names[tae_string(timer_after(loop, 20, on_timer))] = "middle"
+names[tae_string(timer_after(loop, 5, on_timer))] = "early2"
+blether timer_cancel(loop, dropped)
+blether timer_cancel(loop, dropped)
+
+ken ids = []
+fer i in 0..1000 {
+    shove(ids, timer_after(loop, i % 7, on_timer))
+}
+fer i in 0..500 {
+    timer_cancel(loop, ids[i * 2])
+}
+
+ken order = []
+ken bulk = 0
+whiles len(order) < 4 {
+    fer ev in event_loop_poll(loop, -1) {
+        ken key = tae_string(ev["id"])
+        gin dict_has(names, key) {
+            shove(order, names[key])
+        } ither {
+            bulk = bulk + 1
+        }
+    }
+}
+blether order
+blether bulk
+"#,
+        &[],
+    )
+    .expect("compile/run failed");
+    assert_eq!(out.trim(), "aye\nnae\n[early, early2, middle, late]\n500");
+}
+
+#[test]
+fn llvm_event_loop_poll_into_reuses_the_list() {
+    let out = compile_and_run(
+        r#"
+dae on_timer(ev) {
+}
+
+ken loop = event_loop_new()
+ken events = []
+ken kinds = []
+ken total = 0
+fer round in 0..50 {
+    timer_after(loop, 0, on_timer)
+    timer_after(loop, 0, on_timer)
+    ken n = event_loop_poll_into(loop, events, 20)
+    total = total + n
+    gin round == 49 {
+        fer ev in events {
+            shove(kinds, ev["kind"])
+        }
+    }
+}
+blether total
+blether kinds
+blether event_loop_poll_into(loop, events, 0)
+blether len(events)
+"#,
+        &[],
+    )
+    .expect("compile/run failed");
+    assert_eq!(out.trim(), "100\n[timer, timer]\n0\n0");
+}
+
+#[test]
+fn llvm_event_loop_run_dispatches_until_stopped() {
+    let out = compile_and_run(
+        r#"
+ken loop = event_loop_new()
+ken seen = []
+
+dae on_tick(ev) {
+    shove(seen, ev["kind"])
+    gin len(seen) == 5 {
+        event_loop_stop(loop)
+    }
+}
+
+timer_every(loop, 1, on_tick)
+event_loop_run(loop)
+blether len(seen)
+blether seen[4]
+event_loop_run(loop, 0)
+blether len(seen)
+"#,
+        &[],
+    )
+    .expect("compile/run failed");
+    assert_eq!(out.trim(), "5\ntimer\n5");
+}
+
+const SUPERVISE_WORKERS: &str = r#"
+dae on_child(ev) {
+}
+
+ken loop = event_loop_new()
+fer i in 0..40 {
+    ken cmd = "echo w" + tae_string(i) + "; echo e >&2; exit " + tae_string(i % 3)
+    ken p = process_spawn(["sh", "-c", cmd], {"stderr": "stdout"})
+    event_watch_read(loop, p["stdout"], on_child)
+    process_watch(loop, p, on_child)
+}
+ken exits = 0
+ken status_sum = 0
+ken pipes = 40
+ken got = 0
+whiles exits < 40 or pipes > 0 {
+    fer ev in event_loop_poll(loop, 1000) {
+        gin ev["kind"] == "exit" {
+            exits = exits + 1
+            status_sum = status_sum + ev["status"]
+        } ither {
+            ken chunk = process_read(ev["sock"], 4096)["value"]
+            gin bytes_len(chunk) == 0 {
+                event_unwatch(loop, ev["sock"])
+                socket_close(ev["sock"])
+                pipes = pipes - 1
+            } ither {
+                got = got + bytes_len(chunk)
+            }
+        }
+    }
+}
+blether status_sum
+blether got
+
+ken cat = process_spawn(["cat"], {"stdin": aye})
+blether process_write(cat["stdin"], "round trip")["value"]
+socket_close(cat["stdin"])
+blether process_wait(cat)
+blether bytes_len(process_read(cat["stdout"], 64)["value"])
+ken sleeper = process_spawn(["sleep", "10"])
+process_watch(loop, sleeper, on_child)
+blether process_kill(sleeper)
+ken killed = []
+whiles len(killed) == 0 {
+    killed = event_loop_poll(loop, 1000)
+}
+blether killed[0]["status"]
+"#;
+
+// 40 workers print "wN\n" (w0..w9 three bytes, w10..w39 four) plus "e\n"; exit codes
+// cycle 0, 1, 2.
+const SUPERVISE_EXPECTED: &str = "39\n230\n10\n0\n10\naye\n-1";
+
+#[test]
+fn llvm_event_loop_supervises_child_processes() {
+    let out = compile_and_run(SUPERVISE_WORKERS, &[]).expect("compile/run failed");
+    assert_eq!(out.trim(), SUPERVISE_EXPECTED);
+}
+
+#[test]
+fn llvm_event_loop_supervises_child_processes_with_poll() {
+    let out = compile_and_run(SUPERVISE_WORKERS, &[("MDH_EVENT_BACKEND", "poll")])
+        .expect("compile/run failed");
+    assert_eq!(out.trim(), SUPERVISE_EXPECTED);
+}
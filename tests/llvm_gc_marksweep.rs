@@ -0,0 +1,243 @@
+//! Native executables linked against the mark-sweep collector.
+
+#![cfg(feature = "llvm")]
+
+use std::process::Command;
+
+use mdhavers::{parse, GcMode, LLVMCompiler};
+use tempfile::tempdir;
+
+fn compile_and_run_with_stats(source: &str) -> Result<(String, String), String> {
+    let program = parse(source).map_err(|e| format!("Parse error: {:?}", e))?;
+
+    let dir = tempdir().map_err(|e| format!("Failed to create temp dir: {}", e))?;
+    let exe_path = dir.path().join("gc_test_exe");
+
+    let compiler = LLVMCompiler::new().with_gc(GcMode::MarkSweep);
+    compiler
+        .compile_to_native(&program, &exe_path, 2)
+        .map_err(|e| format!("Compile error: {:?}", e))?;
+
+    let output = Command::new(&exe_path)
+        .env("MDH_GC_STATS", "1")
+        .output()
+        .map_err(|e| format!("Failed to run executable: {}", e))?;
+
+    let stderr = String::from_utf8_lossy(&output.stderr).to_string();
+    if !output.status.success() {
+        return Err(format!(
+            "Executable failed with exit code: {:?}, stderr: {}",
+            output.status.code(),
+            stderr
+        ));
+    }
+
+    Ok((String::from_utf8_lossy(&output.stdout).to_string(), stderr))
+}
+
+fn collections(stderr: &str) -> u64 {
+    stderr
+        .lines()
+        .find_map(|line| line.strip_prefix("[mdh] gc: "))
+        .and_then(|rest| rest.split_whitespace().next())
+        .and_then(|n| n.parse().ok())
+        .unwrap_or(0)
+}
+
+#[test]
+fn llvm_marksweep_reclaims_garbage_and_keeps_live_data() {
+    let (out, stderr) = compile_and_run_with_stats(
+        r#"
+ken keep = []
+fer i in 0..200 {
+    shove(keep, "keep-" + tae_string(i))
+}
+ken total = 0
+fer round in 0..400 {
+    ken scratch = []
+    fer j in 0..200 {
+        shove(scratch, "item-" + tae_string(j) + "-" + tae_string(round))
+    }
+    ken d = {"first": scratch[0], "last": scratch[199]}
+    total = total + len(d["last"])
+}
+blether keep[0]
+blether keep[199]
+blether total
+"#,
+    )
+    .expect("compile/run failed");
+    let lines: Vec<&str> = out.lines().collect();
+    assert_eq!(lines[0], "keep-0");
+    assert_eq!(lines[1], "keep-199");
+    assert!(lines[2].parse::<i64>().unwrap() > 0);
+    assert!(collections(&stderr) > 0, "no collections: {}", stderr);
+}
+
+#[test]
+fn llvm_marksweep_scans_spawned_threads() {
+    let (out, _stderr) = compile_and_run_with_stats(
+        r#"
+dae worker(n) {
+    ken parts = []
+    fer i in 0..20000 {
+        shove(parts, "w" + tae_string(n) + ":" + tae_string(i))
+        gin len(parts) > 64 {
+            parts = [parts[64]]
+        }
+    }
+    gie parts[0]
+}
+
+ken threads = []
+fer n in 0..4 {
+    shove(threads, thread_spawn(worker, [n]))
+}
+fer t in threads {
+    blether thread_join(t)
+}
+"#,
+    )
+    .expect("compile/run failed");
+    let lines: Vec<&str> = out.lines().collect();
+    assert_eq!(lines.len(), 4);
+    for (n, line) in lines.iter().enumerate() {
+        assert!(line.starts_with(&format!("w{}:", n)), "got {}", line);
+    }
+}
+
+#[test]
+fn llvm_marksweep_thread_caches_keep_each_threads_data() {
+    let (out, stderr) = compile_and_run_with_stats(
+        r#"
+dae worker(n) {
+    ken kept = []
+    fer i in 0..20000 {
+        shove(kept, "t" + tae_string(n) + "-" + tae_string(i))
+        ken scratch = [i, i + 1, "junk-" + tae_string(i)]
+    }
+    ken bad = 0
+    fer i in 0..20000 {
+        gin kept[i] != "t" + tae_string(n) + "-" + tae_string(i) {
+            bad = bad + 1
+        }
+    }
+    gie bad
+}
+
+ken threads = []
+fer n in 0..8 {
+    shove(threads, thread_spawn(worker, [n]))
+}
+ken bad = 0
+fer t in threads {
+    bad = bad + thread_join(t)
+}
+blether bad
+"#,
+    )
+    .expect("compile/run failed");
+    assert_eq!(out.trim(), "0");
+    assert!(collections(&stderr) > 0, "no collections: {}", stderr);
+}
+
+#[test]
+fn llvm_marksweep_keeps_atomic_payloads_alive() {
+    let (out, stderr) = compile_and_run_with_stats(
+        r#"
+ken packets = []
+fer i in 0..64 {
+    shove(packets, bytes_from_string("packet-" + tae_string(i)))
+}
+fer round in 0..2000 {
+    ken scratch = bytes_new(8192)
+    bytes_set(scratch, 0, round % 256)
+    ken label = "round-" + tae_string(round)
+}
+blether bytes_len(packets[63])
+blether bytes_get(packets[63], 0)
+"#,
+    )
+    .expect("compile/run failed");
+    assert_eq!(out.trim(), "9\n112");
+    assert!(collections(&stderr) > 0, "no collections: {}", stderr);
+}
+
+#[test]
+fn llvm_marksweep_tuning_and_stats() {
+    let (out, stderr) = compile_and_run_with_stats(
+        r#"
+gc_config({"markers": 4, "incremental": aye, "free_space_divisor": 2})
+ken keep = []
+fer i in 0..200000 {
+    shove(keep, "keep-" + tae_string(i))
+}
+fer round in 0..50 {
+    ken scratch = []
+    fer j in 0..2000 {
+        shove(scratch, "item-" + tae_string(j) + "-" + tae_string(round))
+    }
+}
+gc_collect()
+ken stats = gc_stats()
+blether keep[0]
+blether keep[199999]
+blether stats["markers"]
+blether stats["incremental"]
+blether stats["free_space_divisor"]
+blether stats["collections"] > 0
+blether stats["in_use"] > 0 an stats["in_use"] <= stats["heap_size"]
+blether stats["pause_max_ms"] >= stats["pause_last_ms"]
+hae_a_bash {
+    gc_config({"markers": 0})
+} gin_it_gangs_wrang err {
+    blether err
+}
+"#,
+    )
+    .expect("compile/run failed");
+    assert_eq!(
+        out.trim(),
+        "keep-0\nkeep-199999\n4\naye\n2\naye\naye\naye\n\
+         gc_config: markers must be a positive integer"
+    );
+    assert!(collections(&stderr) > 0, "no collections: {}", stderr);
+}
+
+#[test]
+fn llvm_arena_scopes_promote_escaping_values() {
+    let (out, _stderr) = compile_and_run_with_stats(
+        r#"
+dae on_timer(ev) {
+}
+
+ken loop = event_loop_new()
+ken kept = []
+ken last = ""
+fer i in 0..5000 {
+    timer_after(loop, 0, on_timer)
+    arena_push()
+    ken events = event_loop_poll(loop, 0)
+    gin i % 1000 == 0 {
+        shove(kept, events[0])
+    }
+    last = arena_pop(events[0]["kind"] + "-" + tae_string(i))
+}
+ken caught = ""
+hae_a_bash {
+    arena_push()
+    timer_after(loop, 0, on_timer)
+    ken evs = event_loop_poll(loop, 0)
+    hurl evs[0]["kind"]
+} gin_it_gangs_wrang err {
+    caught = err
+}
+blether len(kept)
+blether kept[4]["kind"]
+blether last
+blether caught
+"#,
+    )
+    .expect("compile/run failed");
+    assert_eq!(out.trim(), "5\ntimer\ntimer-4999\ntimer");
+}
@@ -0,0 +1,620 @@
+//! Native networking over loopback: batched UDP, vectored TCP, file sends, async DNS,
+//! in-place SRTP, TLS session resumption, non-blocking TLS on an event loop and
+//! socketless DTLS handshakes.
+
+#![cfg(feature = "llvm")]
+
+use std::process::Command;
+
+use mdhavers::{parse, LLVMCompiler};
+use rcgen::generate_simple_self_signed;
+use tempfile::tempdir;
+
+fn compile_and_run(source: &str) -> Result<String, String> {
+    let program = parse(source).map_err(|e| format!("Parse error: {:?}", e))?;
+
+    let dir = tempdir().map_err(|e| format!("Failed to create temp dir: {}", e))?;
+    let exe_path = dir.path().join("network_test_exe");
+
+    let compiler = LLVMCompiler::new();
+    compiler
+        .compile_to_native(&program, &exe_path, 2)
+        .map_err(|e| format!("Compile error: {:?}", e))?;
+
+    let output = Command::new(&exe_path)
+        .output()
+        .map_err(|e| format!("Failed to run executable: {}", e))?;
+
+    if !output.status.success() {
+        let stderr = String::from_utf8_lossy(&output.stderr);
+        return Err(format!(
+            "Executable failed with exit code: {:?}, stderr: {}",
+            output.status.code(),
+            stderr
+        ));
+    }
+
+    Ok(String::from_utf8_lossy(&output.stdout).to_string())
+}
+
+const BOUND_UDP: &str = r#"
+dae bound_udp(start) {
+    fer p in start..start + 100 {
+        ken sock = socket_udp()["value"]
+        gin socket_bind(sock, "127.0.0.1", p)["ok"] {
+            gie [sock, p]
+        }
+        socket_close(sock)
+    }
+    gie naething
+}
+"#;
+
+const BOUND_TCP: &str = r#"
+dae bound_tcp(start) {
+    fer p in start..start + 100 {
+        ken sock = socket_tcp()["value"]
+        socket_set_reuseaddr(sock, aye)
+        gin socket_bind(sock, "127.0.0.1", p)["ok"] {
+            socket_listen(sock, 4)
+            gie [sock, p]
+        }
+        socket_close(sock)
+    }
+    gie naething
+}
+"#;
+
+#[test]
+fn llvm_udp_batches_round_trip() {
+    let source = r#"
+ken rx = bound_udp(45000)
+ken tx = bound_udp(45100)
+ken packets = []
+fer i in 0..5 {
+    ken addr = {"host": "127.0.0.1", "port": rx[1]}
+    shove(packets, {"buf": bytes_from_string("pkt" + tae_string(i)), "addr": addr})
+}
+blether udp_send_many(tx[0], packets)["value"]
+
+ken batch = udp_recv_many(rx[0], 8, 64)["value"]
+ken ids = []
+fer buf in batch["bufs"] {
+    shove(ids, bytes_get(buf, 3) - 48)
+}
+blether ids
+blether batch["addrs"][4]["port"] == tx[1]
+
+blether udp_send_many(rx[0], batch)["value"]
+blether len(udp_recv_many(tx[0], 3, 64)["value"]["bufs"])
+blether len(udp_recv_many(tx[0], 3, 64)["value"]["bufs"])
+"#;
+    let out = compile_and_run(&[BOUND_UDP, source].concat()).expect("compile/run failed");
+    assert_eq!(out.trim(), "5\n[0, 1, 2, 3, 4]\naye\n5\n3\n2");
+}
+
+#[test]
+fn llvm_udp_replies_to_received_and_resolved_addresses() {
+    let source = r#"
+ken rx = bound_udp(45200)
+ken tx = bound_udp(45300)
+ken peer = addr_resolve("127.0.0.1", rx[1])["value"]
+blether peer["port"] == rx[1]
+blether udp_send_to(tx[0], bytes_from_string("ping"), peer)["value"]
+
+ken got = udp_recv_from(rx[0], 64)["value"]
+blether join(sort(keys(got["addr"])), ",")
+blether udp_send_to(rx[0], bytes_from_string("pong"), got["addr"])["value"]
+blether bytes_get(udp_recv_from(tx[0], 64)["value"]["buf"], 1)
+blether tae_string(peer) == "127.0.0.1:" + tae_string(rx[1])
+"#;
+    let out = compile_and_run(&[BOUND_UDP, source].concat()).expect("compile/run failed");
+    assert_eq!(out.trim(), "aye\n4\nhost,port\n4\n111\naye");
+}
+
+#[test]
+fn llvm_udp_receives_into_pooled_buffers() {
+    let source = r#"
+ken rx = bound_udp(45400)
+ken tx = bound_udp(45500)
+ken buf = bytes_pool_take(2048)
+blether bytes_len(buf)
+ken from = naething
+fer i in 0..3 {
+    udp_send_to(tx[0], bytes_from_string("hello" + tae_string(i)), "127.0.0.1", rx[1])
+    ken got = udp_recv_into(rx[0], buf)["value"]
+    blether got["len"]
+    blether bytes_get(buf, 5) - 48
+    from = got["addr"]
+}
+blether from["port"] == tx[1]
+bytes_pool_give(buf)
+blether bytes_len(buf)
+blether bytes_len(bytes_pool_take(2048))
+"#;
+    let out = compile_and_run(&[BOUND_UDP, source].concat()).expect("compile/run failed");
+    assert_eq!(out.trim(), "2048\n6\n0\n6\n1\n6\n2\naye\n0\n2048");
+}
+
+#[test]
+fn llvm_tcp_sends_vectors_and_all() {
+    let source = r#"
+ken srv = bound_tcp(45600)
+ken c = socket_tcp()["value"]
+socket_connect(c, "127.0.0.1", srv[1])
+ken s = socket_accept(srv[0])["value"]["sock"]
+blether tcp_send_vec(s, ["HTTP/1.1 200 OK\n\n", bytes_from_string("body")])["value"]
+blether bytes_len(tcp_recv(c, 100)["value"])
+blether tcp_send_all(s, bytes_new(50000))["value"]
+blether tcp_send_all(s, [bytes_from_string("a"), "b"])["value"]
+ken got = 0
+whiles got < 50002 {
+    got = got + bytes_len(tcp_recv(c, 65536)["value"])
+}
+blether got
+"#;
+    let out = compile_and_run(&[BOUND_TCP, source].concat()).expect("compile/run failed");
+    assert_eq!(out.trim(), "21\n21\n50000\n2\n50002");
+}
+
+#[test]
+fn llvm_socket_sends_file_ranges() {
+    let dir = tempdir().unwrap();
+    let path = dir.path().join("payload.bin");
+    let data: Vec<u8> = (0..60000u32).map(|i| (i % 251) as u8).collect();
+    std::fs::write(&path, data).unwrap();
+    let source = r#"
+ken srv = bound_tcp(45700)
+ken c = socket_tcp()["value"]
+socket_connect(c, "127.0.0.1", srv[1])
+ken s = socket_accept(srv[0])["value"]["sock"]
+blether socket_send_file(s, "PATH", 10, 5)["value"]
+blether bytes_get(tcp_recv(c, 100)["value"], 0)
+blether socket_send_file(s, "PATH", 0, -1)["value"]
+blether socket_send_file(s, "PATH", 70000, -1)["value"]
+blether socket_send_file(s, "PATH.missing", 0, -1)["ok"]
+ken got = 0
+whiles got < 60000 {
+    got = got + bytes_len(tcp_recv(c, 65536)["value"])
+}
+blether got
+"#
+    .replace("PATH", &path.to_string_lossy());
+    let out = compile_and_run(&[BOUND_TCP, &source].concat()).expect("compile/run failed");
+    assert_eq!(out.trim(), "5\n10\n60000\n0\nnae\n60000");
+}
+
+#[test]
+fn llvm_dns_lookup_async_completes_through_event_loop() {
+    let source = r#"
+dae on_dns(ev) {
+}
+
+ken loop = event_loop_new()
+ken chans = []
+fer i in 0..4 {
+    ken ch = dns_lookup_async("127.0.0.1")
+    event_watch_read(loop, chan_fd(ch), on_dns)
+    shove(chans, ch)
+}
+ken done = 0
+whiles done < 4 {
+    event_loop_poll(loop, 2000)
+    fer ch in chans {
+        ken r = chan_try_recv(ch)
+        gin r != naething {
+            done = done + 1
+            blether r["value"][0]
+        }
+    }
+}
+blether dns_lookup("127.0.0.1")["value"][0]
+"#;
+    let out = compile_and_run(source).expect("compile/run failed");
+    assert_eq!(
+        out.trim(),
+        "127.0.0.1\n127.0.0.1\n127.0.0.1\n127.0.0.1\n127.0.0.1"
+    );
+}
+
+#[test]
+fn llvm_srtp_protects_in_place() {
+    let source = r#"
+dae make_bytes_seq(n, start) {
+    ken b = bytes(n)
+    fer i in 0..n {
+        bytes_set(b, i, start + i)
+    }
+    gie b
+}
+
+ken ctx = srtp_create({"master_key": make_bytes_seq(16, 1), "master_salt": make_bytes_seq(14, 50)})["value"]
+ken pkt = make_bytes_seq(16, 0)
+bytes_set(pkt, 0, 128)
+ken original = bytes_slice(pkt, 0, 16)
+ken expected = srtp_protect(ctx, pkt)["value"]
+blether srtp_protect_into(ctx, pkt)["value"]
+blether bytes_len(pkt)
+blether bytes_eq(pkt, expected)
+blether srtp_unprotect_into(ctx, pkt)["value"]
+blether bytes_eq(pkt, original)
+ken tampered = bytes_slice(expected, 0, bytes_len(expected))
+bytes_set(tampered, 20, (bytes_get(tampered, 20) + 1) % 256)
+blether srtp_unprotect_into(ctx, tampered)["ok"]
+blether bytes_len(tampered)
+"#;
+    let out = compile_and_run(source).expect("compile/run failed");
+    assert_eq!(out.trim(), "26\n26\naye\n16\naye\nnae\n26");
+}
+
+#[test]
+fn llvm_srtp_protects_batches() {
+    let source = r#"
+dae make_bytes_seq(n, start) {
+    ken b = bytes(n)
+    fer i in 0..n {
+        bytes_set(b, i, start + i)
+    }
+    gie b
+}
+
+ken ctx = srtp_create({"master_key": make_bytes_seq(16, 1), "master_salt": make_bytes_seq(14, 50)})["value"]
+ken batch = []
+fer i in 0..3 {
+    ken pkt = make_bytes_seq(16, 0)
+    bytes_set(pkt, 0, 128)
+    bytes_set(pkt, 3, i + 1)
+    shove(batch, pkt)
+}
+blether srtp_protect_many(ctx, batch)["value"]
+bytes_set(batch[1], 20, (bytes_get(batch[1], 20) + 1) % 256)
+blether srtp_unprotect_many(ctx, {"bufs": batch, "addrs": []})["value"]
+blether bytes_len(batch[1])
+blether bytes_get(batch[2], 3)
+blether srtp_protect_many(ctx, [])["value"]
+"#;
+    let out = compile_and_run(source).expect("compile/run failed");
+    assert_eq!(out.trim(), "[26, 26, 26]\n[16, -1, 16]\n26\n3\n[]");
+}
+
+#[test]
+fn llvm_tls_reconnects_resume_sessions() {
+    let cert = generate_simple_self_signed(vec!["localhost".to_string()]).unwrap();
+    let escape = |pem: String| pem.replace('\n', "\\n");
+    let cert_pem = escape(cert.serialize_pem().unwrap());
+    let key_pem = escape(cert.serialize_private_key_pem());
+    let source = r#"
+dae serve(listener) {
+    fer i in 0..2 {
+        ken s = socket_accept(listener)["value"]["sock"]
+        ken t = tls_client_new({"mode": "server", "cert_pem": "CERT", "key_pem": "KEY"})["value"]
+        tls_connect(t, s)
+        tls_send(t, tls_recv(t, 4)["value"])
+        tls_close(t)
+    }
+    gie 0
+}
+
+ken srv = bound_tcp(45800)
+ken server = thread_spawn(serve, [srv[0]])
+fer i in 0..2 {
+    ken c = socket_tcp()["value"]
+    socket_connect(c, "127.0.0.1", srv[1])
+    ken t = tls_client_new({"server_name": "localhost", "ca_pem": "CERT"})["value"]
+    blether tls_connect(t, c)["ok"]
+    tls_send(t, bytes_from_string("ping"))
+    blether bytes_len(tls_recv(t, 4)["value"])
+    tls_close(t)
+}
+thread_join(server)
+ken stats = tls_stats()
+blether stats["full"]
+blether stats["resumed"]
+"#
+    .replace("CERT", &cert_pem)
+    .replace("KEY", &key_pem);
+    let out = compile_and_run(&[BOUND_TCP, &source].concat()).expect("compile/run failed");
+    // One full and one resumed handshake on each side of the two connections.
+    assert_eq!(out.trim(), "aye\n4\naye\n4\n2\n2");
+}
+
+#[test]
+fn llvm_tls_nonblocking_handshakes_share_one_event_loop() {
+    let cert = generate_simple_self_signed(vec!["localhost".to_string()]).unwrap();
+    let escape = |pem: String| pem.replace('\n', "\\n");
+    let cert_pem = escape(cert.serialize_pem().unwrap());
+    let key_pem = escape(cert.serialize_private_key_pem());
+    let source = r#"
+dae serve(listener) {
+    fer i in 0..8 {
+        ken s = socket_accept(listener)["value"]["sock"]
+        ken t = tls_client_new({"mode": "server", "cert_pem": "CERT", "key_pem": "KEY"})["value"]
+        tls_connect(t, s)
+        tls_send(t, tls_recv(t, 4)["value"])
+        tls_close(t)
+    }
+    gie 0
+}
+
+dae on_tls(ev) {
+}
+
+dae rewatch(loop, sock, status) {
+    event_unwatch(loop, sock)
+    gin status == "want_read" {
+        event_watch_read(loop, sock, on_tls)
+    } ither gin status == "want_write" {
+        event_watch_write(loop, sock, on_tls)
+    }
+}
+
+ken srv = bound_tcp(45900)
+ken server = thread_spawn(serve, [srv[0]])
+ken loop = event_loop_new()
+ken socks = []
+ken sessions = []
+ken phases = []
+ken pending = 0
+fer i in 0..8 {
+    ken c = socket_tcp()["value"]
+    socket_connect(c, "127.0.0.1", srv[1])
+    ken t = tls_client_new({"server_name": "localhost", "ca_pem": "CERT"})["value"]
+    ken status = tls_connect_start(t, c)["value"]
+    gin status != "ready" {
+        pending = pending + 1
+    }
+    rewatch(loop, c, status)
+    shove(socks, c)
+    shove(sessions, t)
+    shove(phases, 0)
+}
+blether pending
+
+ken idle = 0
+ken echoed = 0
+ken rounds = 0
+whiles echoed < 8 an rounds < 1000 {
+    rounds = rounds + 1
+    event_loop_poll(loop, 2000)
+    fer i in 0..8 {
+        ken t = sessions[i]
+        gin phases[i] == 0 {
+            ken status = tls_step(t)["value"]
+            gin status == "ready" {
+                ken early = tls_recv(t, 4)
+                gin early["ok"] == nae an early["code"] == 11 {
+                    idle = idle + 1
+                }
+                tls_send(t, bytes_from_string("ping"))
+                phases[i] = 1
+                status = "want_read"
+            }
+            rewatch(loop, socks[i], status)
+        } ither gin phases[i] == 1 {
+            ken r = tls_recv(t, 4)
+            gin r["ok"] {
+                gin bytes_len(r["value"]) == 4 {
+                    echoed = echoed + 1
+                }
+                phases[i] = 2
+                event_unwatch(loop, socks[i])
+            }
+        }
+    }
+}
+thread_join(server)
+blether idle
+blether echoed
+ken stats = tls_stats()
+blether stats["full"] + stats["resumed"]
+"#
+    .replace("CERT", &cert_pem)
+    .replace("KEY", &key_pem);
+    let out = compile_and_run(&[BOUND_TCP, &source].concat()).expect("compile/run failed");
+    // Every handshake waits on the server's first flight, recv with nothing decrypted
+    // reports EAGAIN, and all eight echoes arrive; each side counts eight handshakes.
+    assert_eq!(out.trim(), "8\n8\n8\n16");
+}
+
+#[test]
+fn llvm_dtls_sessions_handshake_without_sockets() {
+    let cert = generate_simple_self_signed(vec!["localhost".to_string()]).unwrap();
+    let escape = |pem: String| pem.replace('\n', "\\n");
+    let cert_pem = escape(cert.serialize_pem().unwrap());
+    let key_pem = escape(cert.serialize_private_key_pem());
+    let source = r#"
+dae make_bytes_seq(n, start) {
+    ken b = bytes(n)
+    fer i in 0..n {
+        bytes_set(b, i, start + i)
+    }
+    gie b
+}
+
+ken server_cfg = dtls_server_new({"mode": "server", "cert_pem": "CERT", "key_pem": "KEY"})["value"]
+ken client_cfg = dtls_server_new({"mode": "client", "insecure": aye})["value"]
+ken connected = 0
+ken keyed = 0
+fer i in 0..4 {
+    ken c = dtls_session_new(client_cfg)["value"]
+    ken s = dtls_session_new(server_cfg)["value"]
+    ken first = dtls_session_step(c, naething)["value"]
+    gin i == 0 {
+        blether first["state"]
+        blether first["timeout_ms"] > 0
+    }
+    ken to_server = first["out"]
+    ken rounds = 0
+    whiles len(to_server) > 0 an rounds < 10 {
+        rounds = rounds + 1
+        ken to_client = []
+        fer d in to_server {
+            fer o in dtls_session_step(s, d)["value"]["out"] {
+                shove(to_client, o)
+            }
+        }
+        to_server = []
+        fer d in to_client {
+            fer o in dtls_session_step(c, d)["value"]["out"] {
+                shove(to_server, o)
+            }
+        }
+    }
+    gin dtls_session_step(c, naething)["value"]["state"] == "connected" an dtls_session_step(s, naething)["value"]["state"] == "connected" {
+        connected = connected + 1
+    }
+
+    ken pkt = make_bytes_seq(16, 0)
+    bytes_set(pkt, 0, 128)
+    ken sealed = srtp_protect(dtls_session_srtp(c)["value"], pkt)["value"]
+    ken opened = srtp_unprotect(dtls_session_srtp(s)["value"], sealed)["value"]
+    gin bytes_len(sealed) > 16 an bytes_len(opened) == 16 an bytes_get(opened, 15) == 15 {
+        keyed = keyed + 1
+    }
+
+    gin i == 3 {
+        fer d in dtls_session_close(c)["value"] {
+            blether dtls_session_step(s, d)["value"]["state"]
+        }
+        blether dtls_session_step(c, naething)["ok"]
+    }
+    dtls_session_close(s)
+}
+blether connected
+blether keyed
+"#
+    .replace("CERT", &cert_pem)
+    .replace("KEY", &key_pem);
+    let out = compile_and_run(&source).expect("compile/run failed");
+    // The client's first flight arms the retransmit timer, every pair connects with
+    // matching SRTP keys, and close_notify closes the server side.
+    assert_eq!(out.trim(), "handshaking\naye\nclosed\nnae\n4\n4");
+}
+
+#[test]
+fn llvm_sip_messages_parse_into_spans() {
+    let source = r#"
+ken wire = bytes_from_string("SIP/2.0 200 OK\r\nVia: a\r\nvia: b\r\nContent-Length: 2\r\n\r\nhiBYE sip:x SIP/2.0\r\n\r\n")
+ken m = sip_parse_native(wire)
+blether whit_kind(m)
+blether m["type"]
+blether m["status"]
+blether m["headers"]["VIA"]
+blether sip_header(m, "content-length")
+blether m["headers"]["call-id"]
+blether m["body"]
+blether m["length"]
+
+bytes_set(wire, 0, 88)
+blether m["version"]
+
+ken next = sip_parse_native(bytes_slice(wire, m["length"], bytes_len(wire)))
+blether next["method"]
+blether next["complete"]
+blether sip_parse_native("nope")["type"]
+"#;
+    let out = compile_and_run(source).expect("compile/run failed");
+    assert_eq!(
+        out.trim(),
+        "sip_message\nresponse\n200\nb\n2\nnaething\nhi\n55\nSIP/2.0\nBYE\naye\ninvalid"
+    );
+}
+
+#[test]
+fn llvm_http_serve_answers_pipelined_requests() {
+    let source = r#"
+dae client(port) {
+    ken c = socket_tcp()["value"]
+    socket_connect(c, "127.0.0.1", port)
+    tcp_send_all(c, "GET /a HTTP/1.1\r\nHost: x\r\n\r\nPOST /echo HTTP/1.1\r\nContent-Length: 5\r\n\r\nhelloGET /boom HTTP/1.1\r\n\r\n")
+    tcp_send_all(c, "GET /stop HTTP/1.1\r\nConnection: close\r\n\r\n")
+    ken all = bytes_new(0)
+    ken chunk = tcp_recv(c, 65536)["value"]
+    whiles bytes_len(chunk) > 0 {
+        bytes_append(all, chunk)
+        chunk = tcp_recv(c, 65536)["value"]
+    }
+    socket_close(c)
+    gie all
+}
+
+ken srv = bound_tcp(45900)
+ken loop = event_loop_new()
+dae handle(req) {
+    gin req["uri"] == "/boom" {
+        hurl "boom"
+    }
+    gin req["uri"] == "/stop" {
+        event_loop_stop(loop)
+        gie "bye"
+    }
+    gin req["method"] == "POST" {
+        gie {"status": 201, "headers": {"X-Method": req["method"]}, "body": req["body"]}
+    }
+    gie req["uri"]
+}
+http_serve(loop, srv[0], handle)
+ken t = thread_spawn(client, [srv[1]])
+event_loop_run(loop)
+ken wire = thread_join(t)
+
+ken at = 0
+whiles at < bytes_len(wire) {
+    ken m = http_parse_native(bytes_slice(wire, at, bytes_len(wire)))
+    blether tae_string(m["status"]) + " " + m["headers"]["content-length"] + " " + m["body"]
+    at = at + m["length"]
+}
+blether http_parse_native("PUT /x HTTP/1.0\r\n\r\n")["version"]
+"#;
+    let out = compile_and_run(&[BOUND_TCP, source].concat()).expect("compile/run failed");
+    // Answered in order on one connection; the hurl is a 500 that keeps it open.
+    assert_eq!(
+        out.trim(),
+        "200 2 /a\n201 5 hello\n500 21 Internal Server Error\n200 3 bye\nHTTP/1.0"
+    );
+}
+
+#[test]
+fn llvm_http_request_reuses_pooled_connections() {
+    let source = r#"
+dae client(port) {
+    ken base = "http://127.0.0.1:" + tae_string(port)
+    ken seen = []
+    fer path in ["/a", "/b", "/c"] {
+        ken m = http_request({"url": base + path})["value"]
+        shove(seen, tae_string(m["status"]) + " " + m["body"])
+    }
+    ken posted = http_request({"method": "post", "url": base + "/echo", "body": "hullo"})["value"]
+    shove(seen, tae_string(posted["status"]) + " " + posted["body"] + " " + posted["headers"]["x-method"])
+    http_request({"url": base + "/stop"})
+    gie seen
+}
+
+ken srv = bound_tcp(46000)
+ken loop = event_loop_new()
+dae handle(req) {
+    gin req["uri"] == "/stop" {
+        event_loop_stop(loop)
+    }
+    gin req["method"] == "POST" {
+        gie {"status": 201, "headers": {"X-Method": req["method"]}, "body": req["body"]}
+    }
+    gie req["uri"]
+}
+http_serve(loop, srv[0], handle)
+ken t = thread_spawn(client, [srv[1]])
+event_loop_run(loop)
+fer line in thread_join(t) {
+    blether line
+}
+ken stats = http_pool_stats()
+blether tae_string(stats["opened"]) + " " + tae_string(stats["reused"])
+blether http_request({"url": "gopher://x"})["ok"]
+"#;
+    let out = compile_and_run(&[BOUND_TCP, source].concat()).expect("compile/run failed");
+    // Five requests, one connection
+    assert_eq!(
+        out.trim(),
+        "200 /a\n200 /b\n200 /c\n201 hullo POST\n1 4\nnae"
+    );
+}
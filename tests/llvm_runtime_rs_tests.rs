@@ -58,6 +58,420 @@ hae_a_bash {
     assert_eq!(out.trim(), "caught");
 }
 
+#[test]
+fn llvm_json_parse_builds_presized_dicts_with_shared_keys() {
+    let out = run(r#"
+ken rows = []
+fer i in 0..500 {
+    shove(rows, {"id": i, "name": "row" + tae_string(i), "tags": [i % 3, i % 5]})
+}
+ken wide = {}
+fer i in 0..40 {
+    wide["f" + tae_string(i)] = i * 2
+}
+ken doc = json_parse(json_stringify({"rows": rows, "wide": wide, "empty": {}}))
+blether len(doc["rows"])
+blether doc["rows"][321]["name"]
+blether doc["rows"][499]["tags"]
+blether doc["wide"]["f37"]
+blether len(keys(doc["wide"]))
+ken w = doc["wide"]
+w["f3"] = "changed"
+w["extra"] = 1
+blether w["f3"]
+blether len(keys(w))
+blether len(doc["empty"])
+"#);
+    assert_eq!(out.trim(), "500\nrow321\n[1, 4]\n74\n40\nchanged\n41\n0");
+}
+
+#[test]
+fn llvm_json_stringify_and_write_into_match_serializer_format() {
+    let out = run(r#"
+ken doc = {"f": [0.1, 1.0, 1.5e-7, 0.1 + 0.2], "s": "a\"b\\c\n", 7: naething, "e": {}}
+blether json_stringify(doc)
+blether json_pretty({"a": [1, {}], "b": []})
+ken buf = bytes(0)
+fer i in 0..3 {
+    json_write_into(buf, {"i": i, "tags": ["x", "y"]})
+}
+blether bytes_len(buf)
+blether bytes_eq(buf, bytes_from_string("{\"i\": 2, \"tags\": [\"x\", \"y\"]}"))
+json_write_into(buf, "short")
+blether bytes_eq(buf, bytes_from_string("\"short\""))
+log_init({"format": "json", "sinks": [{"kind": "stdout"}]})
+log_blether "hi \"there\""
+"#);
+    let lines: Vec<&str> = out.lines().collect();
+    assert_eq!(
+        lines[0],
+        r#"{"f": [0.1, 1, 0.00000015, 0.30000000000000004], "s": "a\"b\\c\n", "7": null, "e": {}}"#
+    );
+    assert_eq!(
+        lines[1..8].join("\n"),
+        "{\n  \"a\": [\n    1,\n    {}\n  ],\n  \"b\": []\n}"
+    );
+    assert_eq!(lines[8], "28");
+    assert_eq!(lines[9..11], ["aye", "aye"]);
+    assert!(
+        lines[11].starts_with(r#"{"level": "BLETHER", "message": "hi \"there\"", "target": "#),
+        "got {}",
+        lines[11]
+    );
+    assert!(
+        lines[11].ends_with(r#", "fields": null, "span": ""}"#),
+        "got {}",
+        lines[11]
+    );
+}
+
+#[test]
+fn llvm_log_filter_picks_longest_target_and_follows_changes() {
+    let out = run(r#"
+log_set_filter(" mutter, net=whisper, net.tls = roar, net=wheesht")
+blether log_enabled(4, "app")
+blether log_enabled(5, "app")
+blether log_enabled(5, "net.udp")
+blether log_enabled(2, "net.tls.x")
+fer i in 0..1000 {
+    log_enabled(5, "net")
+}
+log_set_filter("net=whisper")
+set_log_level(1)
+blether log_enabled(2, "app")
+blether log_enabled(5, "net")
+set_log_level(3)
+blether log_enabled(3, "app")
+"#);
+    assert_eq!(out.trim(), "aye\nnay\naye\nnay\nnay\naye\naye");
+}
+
+#[test]
+fn llvm_async_log_writer_keeps_or_counts_every_record() {
+    let dir = tempdir().unwrap();
+    let path = dir.path().join("async.log");
+    let path_str = path.to_string_lossy().replace('\\', "/");
+    let out = run(&format!(
+        r#"
+ken sinks = [{{"kind": "file", "path": "{path}"}}]
+log_init({{"format": "compact", "sinks": sinks, "async": {{"capacity": 8, "policy": "block"}}}})
+fer i in 0..2000 {{
+    log_roar "kept " + tae_string(i)
+}}
+log_flush()
+blether log_dropped()
+log_init({{"format": "compact", "sinks": sinks, "async": {{"capacity": 8}}}})
+fer i in 0..2000 {{
+    log_roar "maybe " + tae_string(i)
+}}
+log_flush()
+blether log_dropped()
+"#,
+        path = path_str
+    ));
+    let lines: Vec<&str> = out.lines().collect();
+    assert_eq!(lines[0], "0");
+    let dropped: usize = lines[1].parse().unwrap();
+    let log = std::fs::read_to_string(&path).unwrap();
+    let kept: Vec<&str> = log.lines().filter(|l| l.contains("kept ")).collect();
+    assert_eq!(kept.len(), 2000);
+    assert_eq!(kept[1999], "[ROAR] kept 1999");
+    let maybe = log.lines().filter(|l| l.contains("maybe ")).count();
+    assert_eq!(maybe + dropped, 2000);
+}
+
+#[test]
+fn llvm_binary_log_interns_callsites_and_keeps_field_types() {
+    let dir = tempdir().unwrap();
+    let path = dir.path().join("app.mdhlog");
+    let path_str = path.to_string_lossy().replace('\\', "/");
+    run(&format!(
+        r#"
+log_init({{"format": "binary", "sinks": [{{"kind": "file", "path": "{path}"}}]}})
+fer i in 0..3 {{
+    log_roar "tick", {{"i": i, "ok": aye}}
+}}
+log_whisper "quiet"
+"#,
+        path = path_str
+    ));
+    let file = std::fs::File::open(&path).unwrap();
+    let mut reader = mdhavers::binlog::BinlogReader::new(std::io::BufReader::new(file)).unwrap();
+    let mut records = Vec::new();
+    while let Some(record) = reader.next_record().unwrap() {
+        records.push(record);
+    }
+    assert_eq!(records.len(), 3);
+    assert_eq!(records[0].line, records[2].line);
+    assert!(records.iter().all(|r| r.level_name() == "ROAR"));
+    assert_eq!(records[1].message.to_string(), "tick");
+    assert_eq!(
+        records[2].fields.to_json(),
+        serde_json::json!({"i": 2, "ok": true})
+    );
+}
+
+#[test]
+fn llvm_text_log_lines_are_not_truncated_and_carry_span_path() {
+    let out = run(r#"
+log_init({"timestamps": nae, "sinks": [{"kind": "stdout"}]})
+ken outer = log_span("outer")
+ken inner = log_span("inner")
+log_span_enter(outer)
+log_span_enter(inner)
+log_roar "deep", {"k": 1}
+log_span_exit(inner)
+ken long = ""
+fer i in 0..300 {
+    long = long + "0123456789"
+}
+log_roar long
+log_span_exit(outer)
+log_roar "bare"
+"#);
+    let lines: Vec<&str> = out.lines().collect();
+    assert!(lines[0].starts_with("[ROAR] "), "got {}", lines[0]);
+    assert!(
+        lines[0].ends_with(r#"| deep {"k": 1} span=outer>inner"#),
+        "got {}",
+        lines[0]
+    );
+    assert!(lines[1].ends_with(" span=outer"), "got {}", lines[1]);
+    assert!(lines[1].contains(&"0123456789".repeat(300)));
+    assert!(lines[2].ends_with("| bare"), "got {}", lines[2]);
+}
+
+#[test]
+fn llvm_span_profile_aggregates_and_exports_traces() {
+    let dir = tempdir().unwrap();
+    let trace = dir.path().join("trace.json");
+    let folded = dir.path().join("spans.folded");
+    let out = run(&format!(
+        r#"
+log_init({{"profile": {{"sample": 2}}}})
+ken outer = log_span("outer")
+ken inner = log_span("inner")
+fer i in 0..50 {{
+    log_span_enter(outer)
+    log_span_enter(inner)
+    log_span_exit(inner)
+    log_span_exit(outer)
+}}
+ken stats = log_span_stats()
+blether stats["outer"]["count"]
+blether stats["inner"]["count"]
+blether stats["outer"]["total_ms"] >= stats["inner"]["total_ms"]
+blether log_span_export("{trace}", "chrome")
+blether log_span_export("{folded}", "folded")
+"#,
+        trace = trace.to_string_lossy().replace('\\', "/"),
+        folded = folded.to_string_lossy().replace('\\', "/")
+    ));
+    assert_eq!(out.trim(), "50\n50\naye\n50\n2");
+    let json: serde_json::Value =
+        serde_json::from_str(&std::fs::read_to_string(&trace).unwrap()).unwrap();
+    let events = json["traceEvents"].as_array().unwrap();
+    assert_eq!(events.len(), 50);
+    assert_eq!(events[0]["ph"], "X");
+    assert_eq!(events[0]["args"]["path"], "outer>inner");
+    let stacks = std::fs::read_to_string(&folded).unwrap();
+    assert!(
+        stacks.lines().any(|l| l.starts_with("outer;inner ")),
+        "{}",
+        stacks
+    );
+}
+
+#[test]
+fn llvm_lines_iter_and_file_map_stream_large_files() {
+    let dir = tempdir().unwrap();
+    let path = dir.path().join("big.log");
+    let mut text = String::new();
+    for i in 0..50_000 {
+        text.push_str(&format!("event {}\n", i));
+    }
+    // A line longer than the reader's buffer, then one with no newline.
+    text.push_str(&"y".repeat(150_000));
+    text.push_str("\nend");
+    std::fs::write(&path, &text).unwrap();
+
+    let out = run(&format!(
+        r#"
+ken r = lines_iter("{p}")
+ken count = 0
+ken longest = 0
+ken last = ""
+ken line = lines_next(r)
+whiles line != naething {{
+    count = count + 1
+    gin len(line) > longest {{
+        longest = len(line)
+    }}
+    last = line
+    line = lines_next(r)
+}}
+blether count
+blether longest
+blether last
+ken m = file_map("{p}")
+blether bytes_len(m)
+blether bytes_find(m, bytes_from_string("event 49999"))
+bytes_set(m, 0, 88)
+blether bytes_get(file_map("{p}"), 0)
+"#,
+        p = path.to_string_lossy().replace('\\', "/")
+    ));
+    let offset = text.find("event 49999").unwrap();
+    assert_eq!(
+        out.trim(),
+        format!("50002\n150000\nend\n{}\n{}\n101", text.len(), offset)
+    );
+}
+
+#[test]
+fn llvm_file_handles_buffer_rows_and_flush_at_exit() {
+    let dir = tempdir().unwrap();
+    let path = dir.path().join("rows.csv");
+    let left_open = dir.path().join("left_open.txt");
+
+    let out = run(&format!(
+        r#"
+ken f = file_open("{p}", "w", 256)
+fer i in 0..20000 {{
+    file_write(f, tae_string(i) + ",row\n")
+}}
+file_write_lines(f, ["x", 7])
+file_write(f, bytes_from_string("end"))
+file_close(f)
+file_close(f)
+ken g = file_open("{p}", "a")
+file_write(g, "+tail")
+file_flush(g)
+blether len(slurp("{p}"))
+hae_a_bash {{
+    file_write(f, "late")
+}} gin_it_gangs_wrang e {{
+    blether e
+}}
+ken h = file_open("{q}")
+file_write(h, "kept at exit")
+"#,
+        p = path.to_string_lossy().replace('\\', "/"),
+        q = left_open.to_string_lossy().replace('\\', "/")
+    ));
+    let mut expected = String::new();
+    for i in 0..20000 {
+        expected.push_str(&format!("{},row\n", i));
+    }
+    expected.push_str("x\n7\nend+tail");
+    assert_eq!(std::fs::read_to_string(&path).unwrap(), expected);
+    assert_eq!(
+        out.trim(),
+        format!("{}\nfile_write() got a closed file", expected.len())
+    );
+    assert_eq!(std::fs::read_to_string(&left_open).unwrap(), "kept at exit");
+}
+
+#[test]
+fn llvm_slurp_bytes_round_trips_binary_files_and_ranges() {
+    let dir = tempdir().unwrap();
+    let input = dir.path().join("capture.pcap");
+    let output = dir.path().join("copy.pcap");
+    let data: Vec<u8> = (0..200_000u32).map(|i| (i % 251) as u8).collect();
+    std::fs::write(&input, &data).unwrap();
+
+    let out = run(&format!(
+        r#"
+ken all = slurp_bytes("{p}")
+blether bytes_len(all)
+scrieve_bytes("{q}", all)
+ken header = slurp_bytes("{p}", 251, 4)
+blether bytes_len(header)
+blether bytes_get(header, 0)
+blether bytes_get(header, 3)
+blether bytes_len(slurp_bytes("{p}", 199998, 10))
+blether bytes_len(slurp_bytes("{p}", 300000))
+"#,
+        p = input.to_string_lossy().replace('\\', "/"),
+        q = output.to_string_lossy().replace('\\', "/")
+    ));
+    assert_eq!(out.trim(), "200000\n4\n0\n3\n2\n0");
+    assert_eq!(std::fs::read(&output).unwrap(), data);
+}
+
+#[test]
+fn llvm_shell_and_spawn_capture_output_through_pipes() {
+    let out = run(r#"
+blether shell("echo out; echo err >&2")
+blether shell("echo only-err >&2")
+blether len(shell("head -c 200000 /dev/zero | tr '\\0' a; head -c 100000 /dev/zero >&2"))
+ken r = spawn(["printf", "%s|%s", "a b", "it's"])
+blether r["stdout"]
+blether r["status"]
+blether spawn(["sh", "-c", "echo bad >&2; exit 3"])["status"]
+hae_a_bash {
+    spawn(["/nonexistent/prog"])
+} gin_it_gangs_wrang e {
+    blether e
+}
+"#);
+    assert_eq!(
+        out.trim(),
+        "out\n\nonly-err\n\n200000\na b|it's\n0\n3\nspawn() cannae run '/nonexistent/prog': No such file or directory"
+    );
+}
+
+#[test]
+fn llvm_json_stream_reads_ndjson_across_read_chunks() {
+    let dir = tempdir().unwrap();
+    let path = dir.path().join("events.ndjson");
+    let mut ndjson = String::new();
+    for i in 0..3000 {
+        ndjson.push_str(&format!(
+            "{{\"id\": {}, \"note\": \"n\\\"{}\\\"\"}}\n",
+            i, i
+        ));
+    }
+    // One record larger than a read chunk, split over several reads.
+    ndjson.push_str(&format!(
+        "{{\"id\": 3000, \"note\": \"{}\"}}\n",
+        "x".repeat(200_000)
+    ));
+    std::fs::write(&path, ndjson).unwrap();
+
+    let out = run(&format!(
+        r#"
+ken s = json_stream_open("{}")
+ken count = 0
+ken total = 0
+ken last = naething
+ken rec = json_stream_next(s)
+whiles rec != naething {{
+    count = count + 1
+    total = total + rec["id"]
+    last = rec
+    rec = json_stream_next(s)
+}}
+json_stream_close(s)
+blether count
+blether total
+blether len(last["note"])
+ken p = json_stream_new()
+json_stream_feed(p, "[1, {{\"k\": \"}}")
+blether json_stream_next(p)
+json_stream_feed(p, bytes_from_string("]\"}}]\n"))
+blether json_stream_next(p)[1]["k"]
+hae_a_bash {{
+    json_stream_next(12345)
+}} gin_it_gangs_wrang e {{
+    blether "caught"
+}}
+"#,
+        path.display()
+    ));
+    assert_eq!(out.trim(), "3001\n3001500\n200000\nnaething\n}]\ncaught");
+}
+
 #[test]
 fn llvm_regex_invalid_pattern_is_catchable() {
     let out = run(r#"
@@ -77,3 +491,1010 @@ fn llvm_regex_replace_supports_capture_expansion() {
     let out = run(r#"blether regex_replace("abc123def", "([0-9]+)", "[$1]")"#);
     assert_eq!(out.trim(), "abc[123]def");
 }
+
+#[test]
+fn llvm_regex_compiled_patterns_and_cache_agree() {
+    let out = run(r##"
+ken digits = regex_compile("[0-9]+")
+blether regex_test("abc123", digits)
+blether regex_match("abc123", digits)["match"]
+blether len(regex_match_all("a1b22c333", digits))
+blether regex_replace("a1b2", digits, "#")
+blether regex_replace_first("a1b2", digits, "#")
+blether len(regex_split("a1b2c", digits))
+ken hits = 0
+fer i in 0..300 {
+    ken key = "key" + tae_string(i % 100)
+    gin regex_test(key, "^" + key + "$") {
+        hits = hits + 1
+    }
+}
+blether hits
+hae_a_bash {
+    regex_compile("*")
+    blether "unreachable"
+} gin_it_gangs_wrang e {
+    blether "caught"
+}
+"##);
+    // 100 distinct patterns cycle through the 64-entry cache, so lookups both hit and evict.
+    assert_eq!(out.trim(), "aye\n123\n3\na#b#\na#b2\n3\n300\ncaught");
+}
+
+#[test]
+fn llvm_regex_set_reports_every_matching_pattern() {
+    let out = run(r#"
+ken set = regex_set_new(["^GET ", "timeout", regex_compile("[0-9]{3}$"), "^POST "])
+blether regex_set_match(set, "GET /index timeout 504")
+blether regex_set_match(set, "POST /form")
+blether regex_set_match(set, "nothing here")
+blether regex_set_match(regex_set_new([]), "x")
+hae_a_bash {
+    regex_set_new(["ok", "("])
+    blether "unreachable"
+} gin_it_gangs_wrang e {
+    blether "caught"
+}
+"#);
+    assert_eq!(out.trim(), "[0, 1, 2]\n[3]\n[]\n[]\ncaught");
+}
+
+#[test]
+fn llvm_unique_and_creel_ops_scale_linearly() {
+    let out = run(r#"
+blether unique([2, 2.0, "ab", "a" + "b", [1], [1.0], naething, naething, 2.5])
+ken big = []
+fer i in 0..200000 {
+    shove(big, i % 50000)
+}
+blether len(uniq(big))
+ken a = make_creel(big)
+ken evens = []
+fer i in 0..50000 {
+    shove(evens, i * 2)
+}
+ken b = make_creel(evens)
+blether len(creel_tae_list(creels_thegither(a, b)))
+blether len(creel_tae_list(creels_baith(a, b)))
+blether len(creel_tae_list(creels_differ(a, b)))
+blether is_subset(creels_baith(a, b), a)
+blether is_disjoint(creels_differ(a, b), b)
+"#);
+    // Quadratic scans would take minutes at these sizes.
+    assert_eq!(
+        out.trim(),
+        "[2, ab, [1], naething, 2.5]\n50000\n75000\n25000\n25000\naye\naye"
+    );
+}
+
+#[test]
+fn llvm_sort_kernels_and_stable_sort_by() {
+    let out = run(r#"
+blether sort([5, -3, 9, 0, -3, 7])
+blether sort([2.5, -1.0, 0.0, 3.0, -0.5])
+blether sort([3, 1.5, 2])
+blether sort(["pear", "apple", "applesauce", "", "fig"])
+ken seen = []
+dae key_len(w) {
+    shove(seen, w)
+    gie len(w)
+}
+blether sort_by(["pear", "fig", "apple", "kiwi", "yew"], key_len)
+blether len(seen)
+ken big = []
+fer i in 0..100000 {
+    shove(big, (i * 7919) % 100003)
+}
+ken sorted = sort(big)
+ken ok = aye
+fer i in 1..100000 {
+    gin sorted[i - 1] > sorted[i] {
+        ok = nae
+    }
+}
+blether ok
+"#);
+    assert_eq!(
+        out.trim(),
+        "[-3, -3, 0, 5, 7, 9]\n[-1, -0.5, 0, 2.5, 3]\n[1.5, 2, 3]\n\
+         [, apple, applesauce, fig, pear]\n[fig, yew, pear, kiwi, apple]\n5\naye"
+    );
+}
+
+#[test]
+fn llvm_large_sorts_stay_ordered_and_stable() {
+    // Above the parallel threshold, so multi-core machines run the pool sample sort.
+    let out = run(r#"
+ken xs = []
+fer i in 0..300000 {
+    shove(xs, (i * 7919) % 300007 - 150000)
+}
+ken sorted = sort(xs)
+ken ok = aye
+fer i in 1..300000 {
+    gin sorted[i - 1] > sorted[i] {
+        ok = nae
+    }
+}
+blether ok
+ken idx = []
+fer i in 0..300000 {
+    shove(idx, i)
+}
+ken by_mod = sort_by(idx, |i| i % 10)
+ken stable = aye
+fer i in 1..300000 {
+    ken a = by_mod[i - 1]
+    ken b = by_mod[i]
+    gin a % 10 > b % 10 or (a % 10 == b % 10 an a > b) {
+        stable = nae
+    }
+}
+blether stable
+blether by_mod[0]
+blether by_mod[299999]
+"#);
+    assert_eq!(out.trim(), "aye\naye\n0\n299999");
+}
+
+#[test]
+fn llvm_typed_arrays_index_and_reduce() {
+    let out = run(r#"
+ken a = int_array([3, 1, 4, 1, 5])
+a[0] = 9
+a[-1] = a[-1] * 2
+blether a
+blether len(a)
+blether array_sum(a)
+blether array_min(a)
+blether array_max(a)
+ken f = float_array(a)
+f[1] = 0.5
+blether f
+blether array_average(f)
+blether array_dot(a, a)
+blether array_add(a, a)
+blether array_sub(a, 1)
+blether array_mul(f, 2)
+blether array_div(a, 2)
+blether array_tae_list(int_array(3))
+ken big = float_array(100003)
+fer i in 0..100003 {
+    big[i] = i
+}
+blether array_sum(big) == 5000250003.0
+blether array_max(big)
+hae_a_bash {
+    blether a[5]
+} gin_it_gangs_wrang e {
+    blether e
+}
+hae_a_bash {
+    a[0] = 1.5
+} gin_it_gangs_wrang e {
+    blether "nae float"
+}
+"#);
+    assert_eq!(
+        out.trim(),
+        "int_array[9, 1, 4, 1, 10]\n5\n25\n1\n10\nfloat_array[9, 0.5, 4, 1, 10]\n4.9\n199\n\
+         int_array[18, 2, 8, 2, 20]\nint_array[8, 0, 3, 0, 9]\nfloat_array[18, 1, 8, 2, 20]\n\
+         float_array[4.5, 0.5, 2, 0.5, 5]\n[0, 0, 0]\naye\n100002\n\
+         Och! Index 5 oot o' bounds (int_array has 5 items)\nnae float"
+    );
+}
+
+#[test]
+fn llvm_deque_and_heap_push_pop_and_iterate() {
+    let out = run(r#"
+ken d = deque()
+deque_push_back(d, 2)
+deque_push_back(d, 3)
+deque_push_front(d, 1)
+blether d
+blether len(d)
+ken total = 0
+fer x in d {
+    total = total + x
+}
+blether total
+blether deque_pop_front(d)
+blether deque_pop_back(d)
+blether deque_front(d)
+blether deque_back(d)
+deque_pop_back(d)
+blether deque_pop_front(d)
+fer i in 0..100000 {
+    deque_push_back(d, i)
+    gin i % 2 == 0 {
+        deque_pop_front(d)
+    }
+}
+blether len(d)
+blether deque_front(d)
+blether deque_back(d)
+ken h = heap(|w| len(w))
+fer w in ["pear", "fig", "apple", "kiwi"] {
+    heap_push(h, w)
+}
+blether h
+blether len(h)
+blether heap_pop(h)
+blether heap_peek(h)
+fer w in h {
+    blether w
+}
+ken n = heap(naething)
+fer v in [5, 1.5, 3, -2] {
+    heap_push(n, v)
+}
+blether heap_tae_list(n)
+blether heap_pop(heap(naething))
+fer i in 0..50000 {
+    heap_push(n, (i * 7919) % 50000)
+}
+ken prev = -10
+ken sorted = aye
+whiles len(n) > 0 {
+    ken v = heap_pop(n)
+    gin v < prev {
+        sorted = nae
+    }
+    prev = v
+}
+blether sorted
+"#);
+    assert_eq!(
+        out.trim(),
+        "deque[1, 2, 3]\n3\n6\n1\n3\n2\n2\nnaething\n50000\n50000\n99999\n\
+         heap[fig, pear, kiwi, apple]\n4\nfig\npear\npear\nkiwi\napple\n\
+         [-2, 1.5, 3, 5]\nnaething\naye"
+    );
+}
+
+#[test]
+fn llvm_dense_matrix_kernels_match_the_naive_loops() {
+    let out = run(r#"
+ken a = mat_from_rows([[1, 2], [3, 4]])
+blether a
+blether mat_matmul(a, [[5, 6], [7, 8]])
+blether mat_tae_rows(mat_add(a, a))
+blether mat_sub(a, mat_identity(2))
+blether mat_scale(a, 0.5)
+blether mat_transpose(mat_new(2, 3, 7))
+blether mat_shape(mat_new(2, 3, 7))
+blether mat_det([[4, 2], [2, 3]])
+blether mat_solve([[4, 2], [2, 3]], [[8], [7]])
+mat_set(a, 0, 0, 9)
+blether mat_get(a, 0, 0)
+ken x = mat_new(13, 300, 0)
+ken y = mat_new(300, 21, 0)
+fer i in 0..13 {
+    fer k in 0..300 {
+        mat_set(x, i, k, (i * 31 + k * 7) % 11 - 5)
+    }
+}
+fer k in 0..300 {
+    fer j in 0..21 {
+        mat_set(y, k, j, (k * 13 + j * 3) % 9 - 4)
+    }
+}
+ken z = mat_matmul(x, y)
+ken same = aye
+fer i in 0..13 {
+    fer j in 0..21 {
+        ken s = 0
+        fer k in 0..300 {
+            s = s + mat_get(x, i, k) * mat_get(y, k, j)
+        }
+        gin s != mat_get(z, i, j) {
+            same = nae
+        }
+    }
+}
+blether same
+blether mat_get(z, 12, 20)
+"#);
+    assert_eq!(
+        out.trim(),
+        "matrix[[1, 2], [3, 4]]\nmatrix[[19, 22], [43, 50]]\n[[2, 4], [6, 8]]\n\
+         matrix[[0, 2], [3, 3]]\nmatrix[[0.5, 1], [1.5, 2]]\nmatrix[[7, 7], [7, 7], [7, 7]]\n\
+         [2, 3]\n8\nmatrix[[1.25], [1.5]]\n9\naye\n4"
+    );
+}
+
+#[test]
+fn llvm_table_helpers_parse_csv_and_hash_join() {
+    let out = run(r#"
+ken parsed = table_parse_csv("id, name\n1,\"Smith, J\"\n\n2,\"say \"\"hi\"\"\"\n3")
+blether parsed[0]
+ken rows = parsed[1]
+blether len(rows)
+blether rows[0]["name"]
+blether rows[1]["name"]
+blether contains(rows[2], "name")
+blether table_widths(rows, parsed[0])["name"]
+ken groups = table_group(rows, "name")
+blether len(groups)
+blether len(groups["naething"])
+ken pets = [{"id": "9", "pet": "cat"}, {"id": "1", "pet": "dug"}, {"id": "1", "pet": "hen"}, {"pet": "stray"}]
+ken inner = table_join(rows, parsed[0], pets, ["id", "pet"], "id", nae)
+fer row in inner {
+    blether row["name"] + " " + row["pet"]
+}
+ken left = table_join(rows, parsed[0], pets, ["id", "pet"], "id", aye)
+blether len(left)
+blether left[2]["pet"]
+"#);
+    assert_eq!(
+        out.trim(),
+        "[id, name]\n3\nSmith, J\nsay \"hi\"\nnae\n8\n3\n1\n\
+         Smith, J dug\nSmith, J hen\n4\nnaething"
+    );
+}
+
+#[test]
+fn llvm_hashmap_and_memoize_key_by_value() {
+    let out = run(r#"
+ken m = hashmap()
+hashmap_set(m, [1, "a"], "first")
+hashmap_set(m, 2, "two")
+blether hashmap_get(m, [1, "a"], "missing")
+blether hashmap_get(m, 2.0, "missing")
+blether hashmap_has(m, [1, "b"])
+blether len(m)
+blether hashmap_remove(m, [1, "a"])
+blether m
+blether hash([1, "a"]) == hash([1, "a"])
+
+ken calls = [0]
+dae slow_square(x) {
+    calls[0] = calls[0] + 1
+    gie x * x
+}
+ken sq = memoize(slow_square, 2)
+blether sq(3)
+blether sq(3)
+blether sq(4)
+blether sq(5)
+blether sq(4)
+blether sq(3)
+blether calls[0]
+
+ken fast_fib = naething
+dae fib(n) {
+    gin n < 2 { gie n }
+    gie fast_fib(n - 1) + fast_fib(n - 2)
+}
+fast_fib = memoize(fib)
+blether fast_fib(80)
+"#);
+    assert_eq!(
+        out.trim(),
+        "first\ntwo\nnae\n2\nfirst\nhashmap{2: two}\naye\n\
+         9\n9\n16\n25\n16\n9\n4\n23416728348467685"
+    );
+}
+
+#[test]
+fn llvm_coroutines_park_on_sleep_channels_and_sockets() {
+    let out = run(r#"
+ken lp = event_loop_new()
+ken trace = []
+
+dae stepper(name) {
+    fer i in 0..3 {
+        shove(trace, name + tae_string(i))
+        co_yield()
+    }
+    gie name + "!"
+}
+ken a = co_spawn(lp, stepper, ["a"])
+ken b = co_spawn(lp, stepper, ["b"])
+blether co_count(lp)
+co_run(lp)
+blether trace
+blether chan_recv(a) + chan_recv(b)
+blether co_count(lp)
+
+ken woke = []
+dae napper(ms) {
+    sleep(ms)
+    shove(woke, ms)
+}
+co_spawn(lp, napper, [30])
+co_spawn(lp, napper, [10])
+co_spawn(lp, napper, [20])
+co_run(lp)
+blether woke
+
+ken ch = chan_new(4)
+dae taker() {
+    ken got = []
+    ken v = chan_recv(ch)
+    whiles v != naething {
+        shove(got, v)
+        v = chan_recv(ch)
+    }
+    gie got
+}
+dae giver() {
+    fer i in 1..4 {
+        sleep(5)
+        chan_send(ch, i * 10)
+    }
+    chan_close(ch)
+}
+ken taken = co_spawn(lp, taker)
+co_spawn(lp, giver)
+co_run(lp)
+blether chan_recv(taken)
+
+ken server = naething
+ken port = -1
+fer p in 43200..43300 {
+    ken s = socket_tcp()["value"]
+    socket_set_reuseaddr(s, aye)
+    gin socket_bind(s, "127.0.0.1", p)["ok"] an socket_listen(s, 4)["ok"] {
+        server = s
+        port = p
+        brak
+    }
+    socket_close(s)
+}
+dae serve() {
+    ken conn = socket_accept(server)["value"]["sock"]
+    ken got = tcp_recv(conn, 64)
+    socket_close(conn)
+    gie bytes_len(got["value"])
+}
+dae client() {
+    ken c = socket_tcp()["value"]
+    socket_connect(c, "127.0.0.1", port)
+    sleep(20)
+    tcp_send(c, bytes_from_string("hullo"))
+    socket_close(c)
+}
+ken served = co_spawn(lp, serve)
+co_spawn(lp, client)
+co_run(lp)
+blether chan_recv(served)
+socket_close(server)
+"#);
+    assert_eq!(
+        out.trim(),
+        "2\n[a0, b0, a1, b1, a2, b2]\na!b!\n0\n[10, 20, 30]\n[10, 20, 30]\n5"
+    );
+}
+
+#[test]
+fn llvm_loops_take_posts_from_other_threads_and_reactors_share_a_port() {
+    let out = run(r#"
+ken lp = event_loop_new()
+ken seen = chan_new(4)
+dae on_post(ev) {
+    chan_send(seen, ev["kind"])
+    event_loop_stop(lp)
+}
+dae poster(target) {
+    sleep(20)
+    event_loop_post(target, on_post)
+}
+ken t = thread_spawn(poster, [lp])
+event_loop_run(lp)
+thread_join(t)
+blether chan_recv(seen)
+
+ken ready = chan_new(4)
+dae echo(ev) {
+    ken got = udp_recv_from(ev["sock"], 64)
+    gin got["ok"] { udp_send_to(ev["sock"], got["value"]["buf"], got["value"]["addr"]) }
+}
+dae setup(loop, sock, index) {
+    event_watch_read(loop, sock, echo)
+    chan_send(ready, index)
+}
+ken reactors = naething
+ken port = -1
+fer p in 43400..43500 {
+    ken r = reactor_start({"port": p, "host": "127.0.0.1", "threads": 2}, setup)
+    gin r["ok"] {
+        reactors = r["value"]
+        port = p
+        brak
+    }
+}
+blether len(reactors["loops"])
+blether chan_recv(ready) + chan_recv(ready)
+ken c = socket_udp()["value"]
+udp_send_to(c, bytes_from_string("ping"), "127.0.0.1", port)
+blether bytes_len(udp_recv_from(c, 64)["value"]["buf"])
+socket_close(c)
+reactor_stop(reactors)
+blether "stopped"
+"#);
+    assert_eq!(out.trim(), "post\n2\n1\n4\nstopped");
+}
+
+#[test]
+fn llvm_shm_rings_carry_frames_between_senders_and_wake_the_loop() {
+    let out = run(r#"
+ken name = "test-" + tae_string(mono_ns())
+ken ring = shm_ring_create(name, 4096)["value"]
+blether shm_ring_create(name, 4096)["ok"]
+blether shm_ring_open("nae-such-ring-here")["ok"]
+dae sender(tag) {
+    ken mine = shm_ring_open(name)["value"]
+    fer i in 0..500 {
+        ken frame = bytes_new(8)
+        bytes_write_u32le(frame, 0, tag)
+        bytes_write_u32le(frame, 4, i)
+        whiles nae shm_ring_send(mine, frame) { sleep(0) }
+    }
+    shm_ring_close(mine)
+}
+ken a = thread_spawn(sender, [1])
+ken b = thread_spawn(sender, [2])
+ken next = {1: 0, 2: 0}
+ken in_order = aye
+fer n in 0..1000 {
+    ken frame = shm_ring_recv(ring, 5000)
+    ken tag = bytes_read_u32le(frame, 0)
+    gin bytes_read_u32le(frame, 4) != next[tag] { in_order = nae }
+    next[tag] = next[tag] + 1
+}
+thread_join(a)
+thread_join(b)
+blether in_order
+blether shm_ring_recv(ring, 0)
+
+ken small = bytes_new(2)
+shm_ring_send(ring, bytes_from_string("hullo"))
+blether shm_ring_recv_into(ring, small)
+blether bytes_eq(small, bytes_from_string("hu"))
+blether shm_ring_recv_into(ring, small)
+
+ken lp = event_loop_new()
+dae on_bell(ev) {
+    blether bytes_len(shm_ring_recv(ring, 0))
+    event_loop_stop(lp)
+}
+event_watch_read(lp, shm_ring_fd(ring), on_bell)
+dae late(r) {
+    sleep(20)
+    shm_ring_send(r, bytes_new(3))
+}
+ken t = thread_spawn(late, [ring])
+event_loop_run(lp, 5000)
+thread_join(t)
+shm_ring_close(ring)
+blether shm_ring_open(name)["ok"]
+"#);
+    assert_eq!(out.trim(), "nae\nnae\naye\nnaething\n5\naye\n-1\n3\nnae");
+}
+
+#[test]
+fn llvm_kv_store_persists_scans_and_compacts() {
+    let dir = tempdir().unwrap();
+    let path = dir.path().join("sessions.db");
+    let out = run(&r#"
+ken path = "DB_PATH"
+ken db = kv_open(path)["value"]
+blether kv_open(path)["ok"]
+kv_put(db, "b", [1, "twa", 3.5])
+kv_put(db, "a", "first")
+kv_put(db, "a", "second")
+kv_put(db, "c", aye)
+blether kv_get(db, "a")
+blether kv_get(db, "zz")
+blether kv_delete(db, "c")
+blether kv_delete(db, "c")
+blether kv_scan(db)
+blether kv_scan(db, "b", naething)
+dae writer(store, tag) {
+    fer i in 0..100 {
+        kv_put(store, f"t{tag}-{i}", i)
+        kv_sync(store)
+    }
+}
+ken workers = []
+fer tag in 0..3 {
+    shove(workers, thread_spawn(writer, [db, tag]))
+}
+fer w in workers {
+    thread_join(w)
+}
+blether kv_stats(db)["keys"]
+blether len(kv_scan(db, "t1-", "t1.", 10))
+kv_close(db)
+
+ken again = kv_open(path)["value"]
+blether kv_get(again, "b")[1]
+blether kv_get(again, "t2-99")
+kv_compact(again)
+blether kv_stats(again)["compactions"]
+blether kv_get(again, "a")
+kv_close(again)
+"#
+    .replace("DB_PATH", &path.to_string_lossy()));
+    assert_eq!(
+        out.trim(),
+        "nae\nsecond\nnaething\naye\nnae\n[[a, second], [b, [1, twa, 3.5]]]\n\
+         [[b, [1, twa, 3.5]]]\n302\n10\ntwa\n99\n1\nsecond"
+    );
+}
+
+#[test]
+fn llvm_ns_timers_stay_on_schedule_under_load() {
+    let out = run(r#"
+ken lp = event_loop_new()
+ken ticks = []
+ken start = mono_ns()
+dae on_tick(ev) {
+    shove(ticks, mono_ns() - start)
+    ken busy = mono_ns() + 500000
+    whiles mono_ns() < busy {}
+    gin len(ticks) == 10 { event_loop_stop(lp) }
+}
+ken late = []
+dae on_once(ev) {
+    shove(late, mono_ns() - start - 300000)
+}
+timer_every_ns(lp, 2000000, on_tick)
+timer_after_ns(lp, 300000, on_once)
+event_loop_run(lp)
+blether floor(ticks[9] / 2000000)
+blether late[0] >= 0 an late[0] < 2000000
+"#);
+    assert_eq!(out.trim(), "10\naye");
+}
+
+#[test]
+fn llvm_strbuf_appends_and_builds_without_disturbing_built_strings() {
+    let out = run(r#"
+ken b = strbuf()
+fer i in 0..5 {
+    strbuf_append_int(b, i)
+}
+strbuf_append(strbuf_append_float(b, 2.5), [aye, naething])
+blether b
+blether len(b)
+ken first = strbuf_build(b)
+strbuf_append(b, "!")
+blether first
+blether strbuf_build(b)
+strbuf_clear(b)
+fer i in 0..10000 {
+    strbuf_append_int(b, 0 - i)
+}
+blether strbuf_len(b)
+blether len(strbuf_build(b))
+"#);
+    assert_eq!(
+        out.trim(),
+        "012342.5[aye, naething]\n23\n012342.5[aye, naething]\n012342.5[aye, naething]!\n48889\n48889"
+    );
+}
+
+#[test]
+fn llvm_blether_buffers_a_piped_stdout_and_keeps_it_in_order() {
+    let out = run(r#"
+blether "afore"
+shell_status("echo fae the shell")
+fer i in 0..20000 {
+    blether i
+}
+blether naething
+blether aye
+blether -2.5
+blether [1, "a"]
+blether "café"
+flush()
+blether "efter"
+"#);
+    let lines: Vec<&str> = out.lines().collect();
+    assert_eq!(lines.len(), 20008);
+    assert_eq!(&lines[..3], ["afore", "fae the shell", "0"]);
+    assert_eq!(lines[20001], "19999");
+    assert_eq!(
+        &lines[20002..],
+        ["naething", "aye", "-2.5", "[1, a]", "café", "efter"]
+    );
+}
+
+#[test]
+fn llvm_numbers_format_like_printf_and_parse_like_strtod() {
+    let out = run(r#"
+blether 3.14159
+blether 1.0 / 3.0
+blether 999999.5
+blether 123456789.0
+blether 0.0001
+blether 0.00001
+blether 1.5 * 1000000.0
+blether -9223372036854775807 - 1
+blether tae_string(0.1 + 0.2) + "|" + tae_string(-1234567)
+blether json_stringify([0.1 + 0.2, 123456.789, 1.0, -7])
+blether tae_int("-42") + tae_int("+7")
+blether tae_float("2.5e3")
+blether tae_float("0.1") + 0.2
+blether tae_float("123456789012345678901234")
+fer s in ["9223372036854775808", "12a", "-"] {
+    hae_a_bash {
+        tae_int(s)
+    } gin_it_gangs_wrang e {
+        blether "nae int"
+    }
+}
+hae_a_bash {
+    tae_float("1e400")
+} gin_it_gangs_wrang e {
+    blether "nae float"
+}
+"#);
+    let lines: Vec<&str> = out.lines().collect();
+    assert_eq!(
+        lines,
+        [
+            "3.14159",
+            "0.333333",
+            "1e+06",
+            "1.23457e+08",
+            "0.0001",
+            "1e-05",
+            "1.5e+06",
+            "-9223372036854775808",
+            "0.3|-1234567",
+            "[0.30000000000000004, 123456.789, 1, -7]",
+            "-35",
+            "2500",
+            "0.3",
+            "1.23457e+23",
+            "nae int",
+            "nae int",
+            "nae int",
+            "nae float",
+        ]
+    );
+}
+
+#[test]
+fn llvm_seeded_random_matches_the_interpreter_sequence() {
+    let out = run(r#"
+seed(42)
+blether random_list(5, 1, 100)
+blether random_int(0, 9)
+blether shuffle([1, 2, 3, 4, 5])
+blether jammy(10, 20)
+seed(7)
+ken f = random()
+seed(7)
+blether f == random()
+ken fs = random_list(1000, 2.0, 3)
+ken ok = aye
+fer x in fs {
+    gin x < 2.0 or x >= 3.0 {
+        ok = nae
+    }
+}
+blether ok
+blether len(random_list(0, 1, 5))
+"#);
+    assert_eq!(
+        out.trim(),
+        "[9, 38, 69, 93, 100]\n7\n[1, 2, 3, 5, 4]\n16\naye\naye\n0"
+    );
+}
+
+#[test]
+fn llvm_runtime_record_keys_match_built_strings() {
+    let out = run(r#"
+ken d = date_now()
+blether join(keys(d), ",")
+ken k = "week" + "day"
+blether d[k] == d["weekday"]
+blether d["year"] > 2000
+blether keys(d)[0] == "year"
+ken copy = {}
+fer key in keys(d) {
+    copy[key + ""] = d[key]
+}
+blether copy["month"] == d["month"]
+"#);
+    assert_eq!(
+        out.trim(),
+        "year,month,day,hour,minute,second,weekday\naye\naye\naye\naye"
+    );
+}
+
+#[test]
+fn llvm_date_fields_match_date_format() {
+    let out = run(r#"
+ken ts = date_now_ts()
+blether ts > 1700000000
+ken names = ["year", "month", "day", "hour", "minute", "second", "yearday"]
+ken fmts = ["%Y", "%-m", "%-d", "%-H", "%-M", "%-S", "%-j"]
+fer t in [0, 951782400, 1700000000, ts] {
+    ken d = date_fields(t)
+    ken same = aye
+    fer i in 0..len(names) {
+        gin d[names[i]] != tae_int(date_format(t, fmts[i])) {
+            same = nae
+        }
+    }
+    blether same
+}
+blether whit_kind(date_fields(naething))
+"#);
+    assert_eq!(out.trim(), "aye\naye\naye\naye\naye\ndate");
+}
+
+#[test]
+fn llvm_bulk_dict_building() {
+    let out = run(r#"
+ken a = dict_with_capacity(2000)
+ken b = {}
+fer i in 0..1000 {
+    a[i] = i
+    b[i + 500] = 0 - i
+}
+ken m = dict_merge(a, b)
+blether len(m)
+blether m[10]
+blether m[600]
+blether len(a)
+dict_update(a, b)
+blether len(a)
+blether a[1499]
+ken p = dict_from_pairs([["x", 1], ["y", 2], ["x", 3]])
+blether p["x"]
+blether len(p)
+blether len(dict_invert(m))
+"#);
+    assert_eq!(out.trim(), "1500\n10\n-100\n1000\n1500\n-999\n3\n2\n1499");
+}
+
+#[test]
+fn llvm_frozen_dicts_and_lists_keep_old_versions() {
+    let out = run(r#"
+ken v0 = frozen_dict({"b": 1, "a": 2})
+ken v1 = frozen_set(v0, "c", 3)
+ken v2 = frozen_remove(frozen_set(v1, "b", 10), "a")
+blether v0
+blether v2
+blether len(v1)
+blether dict_get(v0, "c", "nane")
+blether dict_has(v2, "a")
+ken big = frozen_dict({})
+fer i in 0..2000 {
+    big = frozen_set(big, i, i * 2)
+}
+blether big[1234]
+ken l0 = frozen_list(["x", "y"])
+ken l1 = frozen_set(l0, -1, 2)
+ken l2 = l1
+fer i in 0..1100 {
+    l2 = frozen_push(l2, i)
+}
+blether l1
+blether len(l2)
+blether l2[1000]
+blether thaw(l0)
+"#);
+    assert_eq!(
+        out.trim(),
+        "frozen_dict{\"b\": 1, \"a\": 2}\nfrozen_dict{\"b\": 10, \"c\": 3}\n3\nnane\nnae\n2468\nfrozen_list[x, 2]\n1102\n998\n[x, y]"
+    );
+}
+
+#[test]
+fn llvm_for_over_range_call_is_a_counted_loop() {
+    let out = run(r#"
+ken total = 0
+fer i in range(0, 1000000000000) {
+    gin i == 5 {
+        brak
+    }
+    total = total + i
+}
+blether total
+ken r = range(2, 5)
+blether r
+fer c in range(3, 1) {
+    blether "never"
+}
+"#);
+    assert_eq!(out.trim(), "10\n[2, 3, 4]");
+}
+
+#[test]
+fn llvm_list_slices_copy_on_write() {
+    let out = run(r#"
+ken base = []
+fer i in 0..200 {
+    shove(base, i)
+}
+ken view = base[10:150]
+view[0] = -1
+base[11] = -2
+blether base[10]
+blether view[1]
+ken tail = base[100:]
+shove(tail, 999)
+blether len(tail)
+blether len(base)
+ken firsts = tak(base, 100)
+base[0] = 42
+blether firsts[0]
+ken parts = chunks(base, 64)
+parts[0][1] = 7
+blether base[1]
+dae merge_sort(xs) {
+    gin len(xs) < 2 {
+        gie xs
+    }
+    ken mid = len(xs) / 2
+    ken left = merge_sort(xs[:mid])
+    ken right = merge_sort(xs[mid:])
+    ken out = []
+    ken i = 0
+    ken j = 0
+    whiles i < len(left) an j < len(right) {
+        gin left[i] <= right[j] {
+            shove(out, left[i])
+            i = i + 1
+        } ither {
+            shove(out, right[j])
+            j = j + 1
+        }
+    }
+    whiles i < len(left) {
+        shove(out, left[i])
+        i = i + 1
+    }
+    whiles j < len(right) {
+        shove(out, right[j])
+        j = j + 1
+    }
+    gie out
+}
+ken jumbled = []
+fer i in 0..500 {
+    shove(jumbled, (i * 7919) % 500)
+}
+ken sorted = merge_sort(jumbled)
+blether sorted[0]
+blether sorted[499]
+blether jumbled[1]
+"#);
+    assert_eq!(out.trim(), "10\n11\n101\n200\n0\n1\n0\n499\n419");
+}
+
+#[test]
+fn llvm_bulk_list_building() {
+    let out = run(r#"
+ken xs = list_with_capacity(4)
+fer i in 0..3 {
+    shove(xs, i)
+}
+list_extend(xs, xs)
+blether xs
+ken big = []
+fer i in 0..100 {
+    shove(big, i)
+}
+ken part = big[10:90]
+list_extend(part, [100])
+blether len(part)
+blether part[80]
+blether big[90]
+reserve(big, 1000)
+shove(big, 100)
+blether len(big)
+blether list_concat(xs, [9])
+"#);
+    assert_eq!(
+        out.trim(),
+        "[0, 1, 2, 0, 1, 2]\n81\n100\n90\n101\n[0, 1, 2, 0, 1, 2, 9]"
+    );
+}
@@ -52,3 +52,355 @@ blether atomic_load(a)
     .expect("compile/run failed");
     assert_eq!(out.trim(), "1");
 }
+
+#[test]
+fn llvm_threads_hurl_into_their_own_handlers() {
+    let out = compile_and_run(
+        r#"
+dae deep(n, tag) {
+    gin n == 0 {
+        hurl tag
+    }
+    ken got = ""
+    hae_a_bash {
+        got = deep(n - 1, tag)
+    } gin_it_gangs_wrang err {
+        got = err
+    }
+    gie got
+}
+
+dae worker(tag) {
+    ken ok = 0
+    fer i in 0..2000 {
+        gin deep(100, tag) == tag {
+            ok = ok + 1
+        }
+    }
+    gie ok
+}
+
+ken threads = []
+fer n in 0..4 {
+    shove(threads, thread_spawn(worker, ["w" + tae_string(n)]))
+}
+fer t in threads {
+    blether thread_join(t)
+}
+"#,
+    )
+    .expect("compile/run failed");
+    assert_eq!(out.trim(), "2000\n2000\n2000\n2000");
+}
+
+#[test]
+fn llvm_atomics_stay_consistent_under_contention() {
+    let out = compile_and_run(
+        r#"
+dae worker(count, peak, n) {
+    fer i in 0..20000 {
+        atomic_add(count, 1)
+        atomic_fetch_max(peak, n * 100000 + i)
+    }
+    gie naething
+}
+
+ken count = atomic_new(0)
+ken peak = atomic_new(0)
+ken threads = []
+fer n in 0..4 {
+    shove(threads, thread_spawn(worker, [count, peak, n]))
+}
+fer t in threads {
+    thread_join(t)
+}
+blether atomic_load(count)
+blether atomic_load_acquire(peak)
+blether atomic_fetch_min(peak, 7)
+blether atomic_load(peak)
+"#,
+    )
+    .expect("compile/run failed");
+    assert_eq!(out.trim(), "80000\n319999\n319999\n7");
+}
+
+#[test]
+fn llvm_bounded_channel_fan_in_delivers_every_message() {
+    let out = compile_and_run(
+        r#"
+dae producer(ch, base) {
+    fer i in 0..5000 {
+        chan_send(ch, base + i)
+    }
+    gie naething
+}
+
+ken ch = chan_new(3)
+ken threads = []
+fer n in 0..4 {
+    shove(threads, thread_spawn(producer, [ch, n * 5000]))
+}
+ken total = 0
+fer i in 0..20000 {
+    total = total + chan_recv(ch)
+}
+fer t in threads {
+    thread_join(t)
+}
+chan_close(ch)
+blether total
+blether chan_send(ch, 1)
+blether chan_recv(ch)
+"#,
+    )
+    .expect("compile/run failed");
+    assert_eq!(out.trim(), "199990000\nnae\nnaething");
+}
+
+#[test]
+fn llvm_channel_batches_move_whole_bursts() {
+    let out = compile_and_run(
+        r#"
+dae producer(ch) {
+    fer round in 0..100 {
+        ken batch = []
+        fer i in 0..64 {
+            shove(batch, round * 64 + i)
+        }
+        chan_send_many(ch, batch)
+    }
+    chan_close(ch)
+    gie naething
+}
+
+ken ch = chan_new(256)
+ken t = thread_spawn(producer, [ch])
+ken total = 0
+ken count = 0
+ken batch = chan_recv_many(ch, 64)
+whiles len(batch) > 0 {
+    fer v in batch {
+        total = total + v
+        count = count + 1
+    }
+    batch = chan_recv_many(ch, 64)
+}
+thread_join(t)
+blether count
+blether total
+blether chan_recv_timeout(chan_new(1), 10)
+"#,
+    )
+    .expect("compile/run failed");
+    assert_eq!(out.trim(), "6400\n20476800\nnaething");
+}
+
+#[test]
+fn llvm_chan_select_waits_on_every_channel() {
+    let out = compile_and_run(
+        r#"
+dae producer(ch, n) {
+    fer i in 0..n {
+        chan_send(ch, i)
+    }
+    chan_close(ch)
+    gie naething
+}
+
+ken a = chan_new(1)
+ken b = chan_new(0)
+ken ta = thread_spawn(producer, [a, 3000])
+ken tb = thread_spawn(producer, [b, 2000])
+ken counts = [0, 0]
+ken total = 0
+ken got = chan_select([a, b], -1)
+whiles got != naething {
+    counts[got[0]] = counts[got[0]] + 1
+    total = total + got[1]
+    got = chan_select([a, b], -1)
+}
+thread_join(ta)
+thread_join(tb)
+blether counts
+blether total
+blether chan_select([chan_new(4)], 10)
+"#,
+    )
+    .expect("compile/run failed");
+    assert_eq!(out.trim(), "[3000, 2000]\n6497500\nnaething");
+}
+
+#[test]
+fn llvm_pool_submit_runs_nested_tasks() {
+    let out = compile_and_run(
+        r#"
+dae leaves(depth) {
+    gin depth == 0 {
+        gie 1
+    }
+    ken left = pool_submit(leaves, [depth - 1])
+    ken right = pool_submit(leaves, [depth - 1])
+    gie thread_join(left) + thread_join(right)
+}
+
+dae square(x) {
+    gie x * x
+}
+
+ken handles = []
+fer i in 0..1000 {
+    shove(handles, pool_submit(square, [i]))
+}
+ken total = 0
+fer h in handles {
+    total = total + thread_join(h)
+}
+blether total
+blether thread_join(pool_submit(leaves, [10]))
+thread_detach(pool_submit(square, [2]))
+"#,
+    )
+    .expect("compile/run failed");
+    assert_eq!(out.trim(), "332833500\n1024");
+}
+
+#[test]
+fn llvm_parallel_hofs_keep_order_across_chunks() {
+    let out = compile_and_run(
+        r#"
+dae square(x) {
+    gie x * x
+}
+
+dae is_even(x) {
+    gie x % 2 == 0
+}
+
+dae add(a, b) {
+    gie a + b
+}
+
+ken xs = []
+fer i in 0..10000 {
+    shove(xs, i)
+}
+ken squares = parallel_map(xs, square, 64)
+blether len(squares)
+blether squares[9999]
+ken evens = parallel_filter(xs, is_even, 0)
+blether len(evens)
+blether evens[1]
+blether parallel_reduce(xs, add, 0, 100)
+blether parallel_reduce([], add, 7, 0)
+"#,
+    )
+    .expect("compile/run failed");
+    assert_eq!(out.trim(), "10000\n99980001\n5000\n2\n49995000\n7");
+}
+
+#[test]
+fn llvm_thread_calls_take_many_arguments_and_captures() {
+    let out = compile_and_run(
+        r#"
+dae weigh(a, b, c, d, e, f, g, h) {
+    gie a + 2 * b + 3 * c + 4 * d + 5 * e + 6 * f + 7 * g + 8 * h
+}
+
+dae make_adder(p, q, r, s) {
+    gie |x, y| p + q + r + s + x * y
+}
+
+blether thread_join(thread_spawn(weigh, [1, 1, 1, 1, 1, 1, 1, 1]))
+ken adder = make_adder(1, 2, 3, 4)
+blether thread_join(pool_submit(adder, [5, 6]))
+"#,
+    )
+    .expect("compile/run failed");
+    assert_eq!(out.trim(), "36\n40");
+}
+
+#[test]
+fn llvm_channels_keep_every_kind_of_value() {
+    // Channel cells hold packed values; large integers and heap values must survive.
+    let out = compile_and_run(
+        r#"
+ken values = [0, -1, 9007199254740993, -9223372036854775807, 2.5, -0.125, "word", [1, 2], {"k": 3}, aye, naething]
+fer cap in [0, 4, 16] {
+    ken ch = chan_new(cap)
+    ken got = []
+    fer v in values {
+        chan_send(ch, v)
+        gin cap == 4 {
+            shove(got, chan_recv(ch))
+        }
+    }
+    gin cap != 4 {
+        fer v in values {
+            shove(got, chan_recv(ch))
+        }
+    }
+    blether got == values
+    blether got[2]
+    blether got[3]
+}
+"#,
+    )
+    .expect("compile/run failed");
+    let once = "aye\n9007199254740993\n-9223372036854775807";
+    assert_eq!(out.trim(), [once, once, once].join("\n"));
+}
+
+#[test]
+fn llvm_runtime_stats_count_finished_threads() {
+    let out = compile_and_run(
+        r#"
+dae worker(n) {
+    ken xs = []
+    fer i in 0..n {
+        shove(xs, i)
+    }
+    hae_a_bash {
+        hurl "oot"
+    } gin_it_gangs_wrang err {
+        gie len(xs)
+    }
+}
+
+ken before = runtime_stats()
+ken t = thread_spawn(worker, [1000])
+blether thread_join(t)
+ken after = runtime_stats()
+blether after["list_grows"] > before["list_grows"]
+blether after["hurls"] - before["hurls"]
+blether after["allocs"]["list"] > before["allocs"]["list"]
+"#,
+    )
+    .expect("compile/run failed");
+    assert_eq!(out.trim(), "1000\naye\n1\naye");
+}
+
+#[test]
+fn llvm_thread_spawn_takes_placement_options() {
+    let out = compile_and_run(
+        r#"
+dae deep(n) {
+    gin n == 0 { gie 0 }
+    gie 1 + deep(n - 1)
+}
+
+ken last = cpu_count() - 1
+ken t = thread_spawn(deep, [2000], {"cpus": [0, last], "name": "deep-worker", "stack_kb": 4096})
+blether thread_join(t)
+blether cpu_count() >= 1
+blether numa_node_of_cpu(0) >= 0
+blether numa_node_of_cpu(-1)
+hae_a_bash {
+    thread_spawn(deep, [1], {"cpus": "all"})
+} gin_it_gangs_wrang err {
+    blether "bad cpus"
+}
+"#,
+    )
+    .expect("compile/run failed");
+    assert_eq!(out.trim(), "2000\naye\naye\n-1\nbad cpus");
+}
@@ -325,3 +325,418 @@ fn test_complex_standalone() {
     let output = compile_and_run(source).expect("Compilation failed");
     assert_eq!(output.trim(), "55");
 }
+
+#[test]
+fn test_unboxed_loop_arithmetic() {
+    let source = r#"
+        dae fib(n) {
+            ken a = 0
+            ken b = 1
+            fer i in 0..n {
+                ken t = a + b
+                a = b
+                b = t
+            }
+            gie a
+        }
+
+        dae halves(n) {
+            ken x = 1.0
+            ken steps = 0
+            whiles x > 0.001 {
+                x = x / 2
+                steps = steps + 1
+            }
+            gie steps
+        }
+
+        blether fib(50)
+        blether halves(0)
+    "#;
+
+    let output = compile_and_run(source).expect("Compilation failed");
+    assert_eq!(output.trim(), "12586269025\n10");
+}
+
+#[test]
+fn test_counted_loop_indexing_unshares_once() {
+    let source = r#"
+        ken xs = []
+        fer i in 0..100 {
+            shove(xs, 0)
+        }
+        ken head = xs[0:80]
+        fer i in 0..len(xs) {
+            xs[i] = i * i
+        }
+        ken total = 0
+        fer i in 0..len(xs) {
+            total = total + xs[i]
+        }
+        blether total
+        blether head[3]
+    "#;
+
+    let output = compile_and_run(source).expect("Compilation failed");
+    assert_eq!(output.trim(), "328350\n0");
+}
+
+#[test]
+fn test_functions_specialised_by_argument_type() {
+    let source = r#"
+        dae fib(n) {
+            gin n < 2 {
+                gie n
+            }
+            gie fib(n - 1) + fib(n - 2)
+        }
+
+        dae twice(x) {
+            gie x + x
+        }
+
+        blether fib(25)
+        blether fib(tae_int("20"))
+        blether twice(1.25)
+        blether twice(3)
+        blether twice("ab")
+    "#;
+
+    let output = compile_and_run(source).expect("Compilation failed");
+    assert_eq!(output.trim(), "75025\n6765\n2.5\n6\nabab");
+}
+
+#[test]
+fn test_variable_rebound_to_other_types_stays_boxed() {
+    let source = r#"
+        dae mixed(xs) {
+            ken x = 1
+            ken i = 0
+            whiles i < 3 {
+                x = x + 1
+                i = i + 1
+            }
+            x = "done"
+            blether x
+            blether len(xs)
+        }
+
+        mixed([1, 2, 3, 4])
+    "#;
+
+    let output = compile_and_run(source).expect("Compilation failed");
+    assert_eq!(output.trim(), "done\n4");
+}
+
+#[test]
+fn test_field_caches_follow_differently_shaped_instances() {
+    let source = r#"
+        kin Point {
+            dae init(x, label) {
+                masel.x = x
+                masel.label = label
+            }
+        }
+
+        kin Tag {
+            dae init(label) {
+                masel.label = label
+            }
+        }
+
+        dae name_of(thing) {
+            gie thing.label
+        }
+
+        ken things = [Point(1, "p"), Tag("t"), Point(2, "q")]
+        ken names = ""
+        fer thing in things {
+            names = names + name_of(thing)
+        }
+        blether names
+
+        ken p = things[0]
+        p.label = "r"
+        p.extra = 5
+        p.extra = p.extra + 1
+        blether name_of(p)
+        blether p.extra
+        blether name_of(things[1])
+    "#;
+
+    let output = compile_and_run(source).expect("Compilation failed");
+    assert_eq!(output.trim(), "ptq\nr\n6\nt");
+}
+
+#[test]
+fn test_method_calls_dispatch_on_the_receivers_class() {
+    let source = r#"
+        kin Shape {
+            dae describe() {
+                gie masel.area() * 10
+            }
+            dae area() {
+                gie 0
+            }
+        }
+
+        kin Square fae Shape {
+            dae init(side) {
+                masel.side = side
+            }
+            dae area() {
+                gie masel.side * masel.side
+            }
+        }
+
+        kin Circle {
+            dae init(r) {
+                masel.r = r
+            }
+            dae area() {
+                gie 3 * masel.r * masel.r
+            }
+            dae scaled(by = 2) {
+                gie masel.area() * by
+            }
+        }
+
+        kin Rect {
+            dae init(w, h) {
+                masel.w = w
+                masel.h = h
+            }
+            dae area() {
+                gie masel.w * masel.h
+            }
+            dae scaled(by = 10) {
+                gie masel.area() * by
+            }
+        }
+
+        dae total(shapes) {
+            ken sum = 0
+            fer s in shapes {
+                sum = sum + s.area()
+            }
+            gie sum
+        }
+
+        blether total([Square(2), Circle(1), Rect(2, 3), Square(3)])
+        fer s in [Circle(1), Rect(1, 2), Circle(2)] {
+            blether s.scaled()
+        }
+
+        ken sq = Square(4)
+        blether sq.describe()
+
+        ken x = Circle(2)
+        fer i in 0..2 {
+            blether x.area()
+            x = Rect(2, 3)
+        }
+    "#;
+
+    let output = compile_and_run(source).expect("Compilation failed");
+    assert_eq!(output.trim(), "22\n6\n20\n24\n160\n12\n6");
+}
+
+#[test]
+fn test_loop_and_destructure_literals_on_the_stack() {
+    let source = r#"
+        ken total = 0
+        ken words = []
+        fer round in 0..3 {
+            fer n in [round, round * 10, 7] {
+                total = total + n
+            }
+            fer word in ["aye", "nae"] {
+                shove(words, word)
+            }
+        }
+        ken a = 1
+        ken b = 2
+        ken [c, d] = [b, a]
+        blether total
+        blether len(words)
+        blether words[5]
+        blether c
+        blether d
+    "#;
+
+    let output = compile_and_run(source).expect("Compilation failed");
+    assert_eq!(output.trim(), "54\n6\nnae\n2\n1");
+}
+
+#[test]
+fn test_substring_search_over_long_lines() {
+    let source = r#"
+        ken line = ""
+        fer i in 0..12 {
+            line = line + "user=bob token=abc123 "
+        }
+        blether len(chynge(line, "token=abc123", "token=[redacted]"))
+        blether len(haggis_hunt(line, "user=bob"))
+        ken at = indices_o(line, "abc123")
+        blether at[0]
+        blether at[11]
+        blether contains(line, "token=abc124")
+        blether contains(line + "!", "123 !")
+        blether chynge("aaaa-aa-a", "aa", "X")
+        blether chynge("abc", "zz", "y")
+    "#;
+
+    let output = compile_and_run(source).expect("Compilation failed");
+    assert_eq!(output.trim(), "312\n12\n15\n257\nnae\naye\nXX-X-a\nabc");
+}
+
+#[test]
+fn test_split_words_and_trims_keep_their_pieces() {
+    let source = r#"
+        ken line = ""
+        fer i in 0..300 {
+            line = line + "word" + " "
+        }
+        ken pieces = split(line, " ")
+        blether len(pieces)
+        blether len(words(line))
+        blether len(pieces[299]) + len(pieces[300])
+        blether split("a::b::::c", "::")
+        blether len(split("", ","))
+        blether split("naw", "")
+        blether "[" + ltrim("  hi  ") + "|" + rtrim("  hi  ") + "]"
+        blether strip_left("xxhixx", "x") + strip_right("xxhixx", "x")
+    "#;
+
+    let output = compile_and_run(source).expect("Compilation failed");
+    assert_eq!(
+        output.trim(),
+        "301\n300\n4\n[a, b, , c]\n1\n[naw]\n[hi  |  hi]\nhixxxxhi"
+    );
+}
+
+#[test]
+fn test_string_index_counts_characters() {
+    let source = r#"
+        ken s = ""
+        fer i in 0..200 {
+            s = s + "aé日"
+        }
+        blether s[0] + s[1] + s[598] + s[-1] + s[-599]
+        blether char_at(s, 400) + scran("héllo日")
+        ken count = 0
+        fer c in s {
+            gin c == "日" {
+                count = count + 1
+            }
+        }
+        blether count
+        blether s[2] + "x"[0] + "naw"[-1]
+    "#;
+
+    let output = compile_and_run(source).expect("Compilation failed");
+    assert_eq!(output.trim(), "aéé日é\né日\n200\n日xw");
+}
+
+#[test]
+fn test_blether_format_templates_compile_once() {
+    let source = r#"
+        ken t = format_compile("{who} has {n} {{who}} {missing}")
+        ken lines = []
+        fer i in 0..3 {
+            lines = lines + [blether_format("row {i}: {who}", {"i": i, "who": "Isla"})]
+        }
+        blether lines
+        blether format_apply(t, {"who": "Isla", "n": 3})
+        blether format_apply(t, {"who": "{n}", "n": 0})
+        blether blether_format("{7} {x}", {7: "seven", "x": "{7}"})
+    "#;
+
+    let output = compile_and_run(source).expect("Compilation failed");
+    assert_eq!(
+        output.trim(),
+        "[row 0: Isla, row 1: Isla, row 2: Isla]\nIsla has 3 {Isla} {missing}\n{n} has 0 {{n}} {missing}\nseven {7}"
+    );
+}
+
+#[test]
+fn test_self_tail_calls_run_in_constant_stack() {
+    let source = r#"
+        dae sum_to(n, acc = 0) {
+            gin n == 0 {
+                gie acc
+            }
+            gie sum_to(n - 1, acc + n)
+        }
+        dae gcd(a, b) {
+            gin b == 0 {
+                gie a
+            } ither {
+                gie gcd(b, a % b)
+            }
+        }
+        dae depth(n) {
+            gin n == 0 {
+                gie 0
+            }
+            gie 1 + depth(n - 1)
+        }
+        blether sum_to(1000000)
+        blether gcd(1071, 462)
+        blether depth(100000)
+    "#;
+
+    let output = compile_and_run(source).expect("Compilation failed");
+    assert_eq!(output.trim(), "500000500000\n21\n100000");
+}
+
+#[test]
+fn test_hurls_carry_a_stack_trace() {
+    let source = r#"
+        dae inner(n) {
+            gin n == 0 {
+                hurl "boom"
+            }
+            gie inner(n - 1) + 1
+        }
+        dae outer(n) {
+            ken r = inner(n)
+            gie r * 2
+        }
+        dae caught() {
+            hae_a_bash {
+                outer(2)
+            } gin_it_gangs_wrang e {
+                gie stacktrace()
+            }
+            gie ""
+        }
+        blether caught()
+        outer(1)
+    "#;
+
+    let program = parse(source).expect("parse");
+    let dir = tempdir().expect("temp dir");
+    let exe_path = dir.path().join("test_exe");
+    LLVMCompiler::new()
+        .compile_to_native(&program, &exe_path, 2)
+        .expect("compile");
+    let output = Command::new(&exe_path).output().expect("run");
+
+    // Read in the catch block: where the caught hurl came from
+    let stdout = String::from_utf8_lossy(&output.stdout);
+    assert!(stdout.starts_with("  at inner ("), "{}", stdout);
+
+    // Uncaught: the message, then the frames
+    assert!(!output.status.success());
+    let stderr = String::from_utf8_lossy(&output.stderr);
+    let mut lines = stderr.lines();
+    assert_eq!(lines.next(), Some("boom"));
+    assert!(
+        lines
+            .next()
+            .is_some_and(|line| line.starts_with("  at inner (")),
+        "{}",
+        stderr
+    );
+}
@@ -0,0 +1,52 @@
+use mdhavers::{parse, Interpreter};
+
+fn run(code: &str) -> String {
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    interp.get_output().join("\n")
+}
+
+#[test]
+fn stdlib_chance_draws_repeat_after_seed() {
+    let out = run(r#"
+fetch "stdlib/chance"
+
+seed(42)
+blether random_list(5, 1, 100)
+blether random_int(0, 9)
+blether shuffle([1, 2, 3, 4, 5])
+blether jammy(10, 20)
+
+seed(7)
+ken a = roll_dice(10, 6)
+ken f = random_float()
+seed(7)
+blether a == roll_dice(10, 6) an f == random_float()
+blether a >= 10 an a <= 60
+
+ken fs = random_list(1000, 0.0, 1.0)
+blether minaw(fs) >= 0.0 an maxaw(fs) < 1.0
+blether random_list(0, 1, 5)
+"#);
+    // The same numbers as the native runtime's generator gives for seed(42)
+    assert_eq!(
+        out.trim(),
+        "Chance module loaded! Fortune favours the braw!\n[9, 38, 69, 93, 100]\n7\n[1, 2, 3, 5, 4]\n16\naye\naye\naye\n[]"
+    );
+}
+
+#[test]
+fn stdlib_chance_random_builtins_report_bad_arguments() {
+    for (code, message) in [
+        ("seed(1.5)", "seed() needs an integer"),
+        ("random_list(-1, 0, 1)", "needs a count"),
+        ("random_list(3, 5, 1)", "min must be <= max"),
+        ("random_list(3, \"a\", 1)", "needs number bounds"),
+    ] {
+        let program = parse(code).unwrap();
+        let mut interp = Interpreter::new();
+        let err = interp.interpret(&program).unwrap_err();
+        assert!(err.to_string().contains(message), "{}: {}", code, err);
+    }
+}
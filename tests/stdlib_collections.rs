@@ -0,0 +1,81 @@
+use mdhavers::{parse, Interpreter};
+
+fn run(code: &str) -> String {
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    interp.get_output().join("\n")
+}
+
+#[test]
+fn stdlib_collections_queue_and_deque_on_native_deque() {
+    let out = run(r#"
+fetch "stdlib/collections"
+
+ken q = Queue()
+fer i in 0..10000 {
+    q.enqueue(i)
+}
+ken drained = 0
+whiles nae q.is_empty() {
+    drained = drained + q.dequeue()
+}
+blether drained
+blether q.dequeue()
+q.enqueue("a")
+q.enqueue("b")
+blether q.front()
+blether q.back()
+blether q.size()
+q.clear()
+blether q.is_empty()
+
+ken d = Deque()
+d.push_back(2)
+d.push_front(1)
+d.push_back(3)
+blether d.items
+blether d.pop_front()
+blether d.pop_back()
+blether d.front()
+blether d.size()
+"#);
+    assert_eq!(
+        out.trim(),
+        "Collections module loaded! Yer data's in guid hauns!\n49995000\nnaething\na\nb\n2\naye\ndeque[1, 2, 3]\n1\n3\n2\n1"
+    );
+}
+
+#[test]
+fn stdlib_priority_queue_and_scheduler_on_native_heap() {
+    let out = run(r#"
+fetch "stdlib/structures"
+
+ken pq = PriorityQueue()
+pq.enqueue("low", 5)
+pq.enqueue("first", 1)
+pq.enqueue("second", 1)
+pq.enqueue("mid", 3)
+blether pq.peek()
+ken order = []
+whiles nae pq.is_empty() {
+    shove(order, pq.dequeue())
+}
+blether order
+blether pq.dequeue()
+
+fetch "stdlib/scheduler"
+
+ken s = Scheduler()
+s.add(Task("a", || naething))
+s.add(Task("b", || naething).with_priority(PRIORITY_HIGH))
+s.add(Task("c", || naething))
+s.add(Task("d", || naething).with_priority(PRIORITY_HIGH).with_delay(5))
+s._sort_tasks()
+blether gaun(s.tasks, |t| t.name)
+"#);
+    assert_eq!(
+        out.trim(),
+        "Structures module loaded! Yer data's aw organised noo!\nfirst\n[first, second, mid, low]\nnaething\nScheduler module loaded! Ready tae schedule yer tasks!\n[b, d, a, c]"
+    );
+}
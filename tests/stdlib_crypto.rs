@@ -0,0 +1,38 @@
+use mdhavers::{parse, Interpreter};
+
+#[test]
+fn stdlib_crypto_codecs_and_digests() {
+    let code = r#"
+fetch "stdlib/crypto"
+
+blether base64_encode("Hello, World!")
+blether base64_decode("SGVsbG8s\nIFdvcmxkIQ==")
+blether base64_encode("hi")
+blether bytes_len(base64_decode_bytes("AP8="))
+blether bytes_get(base64_decode_bytes("AP8="), 1)
+blether hex_encode("Hi!")
+blether hex_decode("48zz69")
+blether bytes_get(hex_decode_bytes("00FF"), 1)
+
+blether sha256_hex("abc")
+blether sha1_hex("")
+blether bytes_len(sha256(bytes(100)))
+blether crc32("123456789")
+blether xxhash64("")
+blether xxhash64("abc") == xxhash64(bytes_from_string("abc"))
+blether websocket_accept("dGhlIHNhbXBsZSBub25jZQ==")
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output().join("\n");
+    assert_eq!(
+        out.trim(),
+        "Crypto module loaded! Keep yer secrets safe!\n\
+         SGVsbG8sIFdvcmxkIQ==\nHello, World!\naGk=\n2\n255\n486921\nHi\n255\n\
+         ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad\n\
+         da39a3ee5e6b4b0d3255bfef95601890afd80709\n32\n3421780262\n-1205034819632174695\n\
+         aye\ns3pPLMBiTxaQ9kYGzzhZRbK+xOo="
+    );
+}
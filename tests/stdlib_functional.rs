@@ -0,0 +1,69 @@
+use mdhavers::{parse, Interpreter};
+
+fn run(code: &str) -> String {
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    interp.get_output().join("\n")
+}
+
+#[test]
+fn stdlib_functional_memoize_keys_by_value_and_drops_least_recent() {
+    let out = run(r#"
+fetch "stdlib/functional"
+
+ken calls = 0
+dae slow_square(x) {
+    calls = calls + 1
+    gie x * x
+}
+ken sq = memoize(slow_square, 2)
+blether sq(3)
+blether sq(3.0)
+blether sq(4)
+blether sq(5)
+blether sq(4)
+blether sq(3)
+blether calls
+
+ken fast_fib = naething
+dae fib(n) {
+    gin n < 2 { gie n }
+    gie fast_fib(n - 1) + fast_fib(n - 2)
+}
+fast_fib = memoize(fib)
+blether fast_fib(30)
+
+ken memo = Memoize(|pair| pair[0] + pair[1])
+blether memo.call([1, 2])
+blether memo.call([1, 2])
+blether memo.cache_size()
+"#);
+    assert_eq!(
+        out.trim(),
+        "Functional module loaded! Ready fer some functional havers!\n\
+         9\n9\n16\n25\n16\n9\n4\n832040\n3\n3\n1"
+    );
+}
+
+#[test]
+fn hashmap_matches_keys_with_eq() {
+    let out = run(r#"
+ken m = hashmap()
+hashmap_set(m, [1, "a"], "first")
+hashmap_set(m, 2, "two")
+blether hashmap_get(m, [1, "a"], "missing")
+blether hashmap_get(m, 2.0, "missing")
+blether hashmap_has(m, [1, "b"])
+blether len(m)
+blether hashmap_remove(m, [1, "a"])
+blether hashmap_keys(m)
+blether m
+blether hash([1, "a"]) == hash([1, "a"])
+blether hash(2) == hash(2.0)
+"#);
+    assert_eq!(
+        out.trim(),
+        "first\ntwo\nnae\n2\nfirst\n[2]\nhashmap{2: two}\naye\naye"
+    );
+}
@@ -0,0 +1,42 @@
+use mdhavers::{parse, Interpreter};
+
+#[test]
+fn stdlib_http_parse_request_spans_and_framing() {
+    let code = r#"
+fetch "stdlib/http"
+
+ken stream = "GET /metrics HTTP/1.1\r\nHost: a\r\n\r\nPOST /echo HTTP/1.1\r\nContent-Length: 4\r\n\r\nbodyGET /x"
+ken req = parse_request(stream)
+blether whit_kind(req)
+blether whit_kind(req["headers"])
+blether req["method"]
+blether req["uri"]
+blether req["version"]
+blether request_header(req, "HOST")
+blether req["body"] == ""
+blether req["complete"]
+blether req["length"]
+
+ken post = parse_request(bytes_slice(bytes_from_string(stream), req["length"], len(stream)))
+blether post["body"]
+blether post["length"]
+blether parse_request("GET /x\r\n\r\n")["version"]
+blether parse_request("GET /x HTTP/1.1\r\nContent-Length: 9\r\n\r\nhi")["complete"]
+blether parse_request("HTTP/1.1 200 OK\r\n\r\nrest")["body"]
+blether parse_request("nope")["type"]
+
+ken resp = response_fer_wire(Response(201, {"X-Test": "1"}, "made"))
+blether resp["status"]
+blether resp["headers"]["x-test"]
+blether response_fer_wire("plain")
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output().join("\n");
+    assert_eq!(
+        out.trim(),
+        "HTTP module loaded! Ready tae fetch frae the web!\nhttp_message\nhttp_headers\nGET\n/metrics\nHTTP/1.1\na\naye\naye\n34\nbody\n46\nHTTP/0.9\nnae\nrest\ninvalid\n201\n1\nplain"
+    );
+}
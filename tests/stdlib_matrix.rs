@@ -0,0 +1,54 @@
+use mdhavers::{parse, Interpreter};
+
+#[test]
+fn stdlib_matrix_arithmetic_runs_on_native_matrices() {
+    let code = r#"
+fetch "stdlib/matrix"
+
+ken a = [[1, 2], [3, 4]]
+ken b = [[5, 6], [7, 8]]
+blether matrix_multiply(a, b)
+blether matrix_multiply(a, identity_matrix(2)) == a
+blether matrix_add(a, b)
+blether matrix_subtract(a, b)
+blether scalar_multiply(a, 3)
+blether scalar_multiply(a, 0.5)
+blether transpose([["a", "b"]])
+blether determinant([[4, 2], [2, 3]])
+blether solve([[4, 2], [2, 3]], [8, 7])
+blether solve([[4, 2], [2, 3]], [[8, 4], [7, 2]])
+blether whit_kind(mat_from_rows(a))
+blether mat_shape(mat_matmul(matrix(3, 4, 1), matrix(4, 5, 2)))
+blether mat_get(mat_matmul(matrix(3, 4, 1), matrix(4, 5, 2)), 2, 4)
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output().join("\n");
+    assert_eq!(
+        out.trim(),
+        "Matrix module loaded! Rows an' columns, like a tartan weave!\n[[19, 22], [43, 50]]\naye\n[[6, 8], [10, 12]]\n[[-4, -4], [-4, -4]]\n[[3, 6], [9, 12]]\n[[0.5, 1], [1.5, 2]]\n[[a], [b]]\n8\n[1.25, 1.5]\n[[1.25, 1], [1.5, 0]]\nmatrix\n[3, 5]\n8"
+    );
+}
+
+#[test]
+fn stdlib_matrix_reports_bad_shapes() {
+    for (code, message) in [
+        ("blether mat_matmul([[1, 2]], [[1, 2]])", "cannae multiply"),
+        ("blether mat_add([[1, 2]], [[1], [2]])", "same shape"),
+        (
+            "blether mat_from_rows([[1, 2], [3]])",
+            "same number o' columns",
+        ),
+        (
+            "blether mat_solve([[1, 2], [2, 4]], [[1], [2]])",
+            "singular",
+        ),
+    ] {
+        let program = parse(code).unwrap();
+        let mut interp = Interpreter::new();
+        let err = interp.interpret(&program).unwrap_err();
+        assert!(err.to_string().contains(message), "{}: {}", code, err);
+    }
+}
@@ -25,3 +25,42 @@ gin ok { blether "rtp_ok" } ither { blether "rtp_fail" }
     let out = interp.get_output().join("\n");
     assert_eq!(out.trim(), "rtp_ok");
 }
+
+#[test]
+fn stdlib_rtp_csrcs_and_short_packets() {
+    let code = r#"
+fetch "stdlib/rtp"
+
+ken pkt = rtp_packet("hullo", 65535, 4294967295, 7, 0, 0, [11, 22, 33])
+ken info = rtp_parse(pkt)
+blether whit_kind(info)
+blether info["version"]
+blether info["marker"]
+blether info["csrc_count"]
+blether info["csrcs"]
+blether info["header_len"]
+blether info["seq"]
+blether info["timestamp"]
+blether bytes_len(info["payload"])
+blether rtp_seq_next(info["seq"])
+
+ken header = rtp_header(1, 2, 3)
+blether bytes_len(header)
+blether rtp_parse(header)["payload"] == bytes(0)
+
+ken short = rtp_parse(bytes(5))
+blether short["ok"]
+blether short["error"]
+ken cut = rtp_parse(bytes_slice(pkt, 0, 16))
+blether cut["error"]
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output().join("\n");
+    assert_eq!(
+        out.trim(),
+        "rtp_header\n2\nnae\n3\n[11, 22, 33]\n24\n65535\n4294967295\n5\n0\n12\naye\nnae\nrtp packet too short\nrtp header too short"
+    );
+}
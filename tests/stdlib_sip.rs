@@ -38,3 +38,45 @@ gin resolve_ok { blether "resolve_ok" } ither { blether "resolve_fail" }
     let out = interp.get_output().join("\n");
     assert_eq!(out.trim(), "parse_ok\nparse_bytes_ok\nbuild_ok\nresolve_ok");
 }
+
+#[test]
+fn stdlib_sip_parse_message_spans_and_framing() {
+    let code = r#"
+fetch "stdlib/sip"
+
+ken stream = "SIP/2.0 180 Ringing Noo\r\nVia: one\r\nvia: two\r\nCONTENT-LENGTH: 3\r\n\r\nabcINVITE sip:bob SIP/2.0\r\n"
+ken m = sip_parse_message(stream)
+blether whit_kind(m)
+blether m["type"]
+blether m["status"]
+blether m["reason"]
+blether m["headers"]["Via"]
+blether m["headers"]["x-missing"]
+blether sip_header_get(m["headers"], "Content-Length")
+blether sip_header_get(m["headers"], "Call-ID", "none")
+blether m["body"]
+blether m["complete"]
+blether m["length"]
+
+ken rest = sip_parse_message(bytes_slice(bytes_from_string(stream), m["length"], len(stream)))
+blether rest["method"]
+blether rest["uri"]
+blether rest["complete"]
+
+ken short = sip_parse_message("MESSAGE sip:x\nContent-Length: 10\n\nhi")
+blether short["version"]
+blether short["body"]
+blether short["complete"]
+
+blether sip_parse_message("GARBAGE")["type"]
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output().join("\n");
+    assert_eq!(
+        out.trim(),
+        "sip_message\nresponse\n180\nRinging Noo\ntwo\nnaething\n3\nnone\nabc\naye\n69\nINVITE\nsip:bob\nnae\nSIP/2.0\nhi\nnae\ninvalid"
+    );
+}
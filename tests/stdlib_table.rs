@@ -0,0 +1,88 @@
+use mdhavers::{parse, Interpreter};
+
+fn run(code: &str) -> String {
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    interp.get_output().join("\n").trim().to_string()
+}
+
+#[test]
+fn stdlib_table_parses_quoted_csv_and_measures_widths() {
+    let out = run(r#"
+fetch "stdlib/table"
+
+ken t = table_from_csv("id, name ,score\n1,\"Smith, J\",10\n\n2,\"say \"\"hi\"\"\",20\n3,Bob\n")
+blether t.columns
+blether t.count_rows()
+blether t.get(0, "name")
+blether t.get(1, "name")
+blether contains(t.get_row(2), "score")
+blether t.column_widths["name"]
+blether t.column_widths["score"]
+blether len(t.group_by("score"))
+blether len(t.group_by("score")["naething"])
+"#);
+    assert_eq!(
+        out,
+        "Table module loaded! Ready tae wrangle yer data!\n[id, name, score]\n3\nSmith, J\nsay \"hi\"\nnae\n8\n5\n3\n1"
+    );
+}
+
+#[test]
+fn stdlib_table_joins_match_keys_in_table_order() {
+    let out = run(r#"
+fetch "stdlib/table"
+
+ken people = table_from_list([
+    {"id": 1, "name": "Morag"},
+    {"id": 2, "name": "Hamish"},
+    {"id": 3, "name": "Isla"},
+    {"name": "Naebody"}
+])
+ken pets = table_from_list([
+    {"id": 3, "pet": "cat"},
+    {"id": 1, "pet": "dug"},
+    {"id": 1, "pet": "hen"},
+    {"pet": "stray"}
+])
+
+ken inner = inner_join(people, pets, "id")
+blether inner.columns
+fer row in inner.rows {
+    blether row["name"] + " " + row["pet"]
+}
+
+ken left = left_join(people, pets, "id")
+blether left.count_rows()
+blether left.get(2, "name")
+blether left.get(2, "pet")
+blether left.column_widths["pet"]
+"#);
+    assert_eq!(
+        out,
+        "Table module loaded! Ready tae wrangle yer data!\n[id, name, pet]\nMorag dug\nMorag hen\nIsla cat\n5\nHamish\nnaething\n8"
+    );
+}
+
+#[test]
+fn stdlib_table_pivots_grouped_rows() {
+    let out = run(r#"
+fetch "stdlib/table"
+
+ken sales = table_from_list([
+    {"shop": "Leith", "month": "Jan", "sold": 3},
+    {"shop": "Leith", "month": "Feb", "sold": 4},
+    {"shop": "Portree", "month": "Jan", "sold": 5},
+    {"shop": "Leith", "month": "Jan", "sold": 2}
+])
+ken p = pivot(sales, "shop", "month", "sold")
+blether p.columns
+blether p.get(0, "Jan")
+blether p.get(1, "Feb")
+"#);
+    assert_eq!(
+        out,
+        "Table module loaded! Ready tae wrangle yer data!\n[shop, Jan, Feb]\n5\n0"
+    );
+}
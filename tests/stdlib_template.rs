@@ -0,0 +1,58 @@
+use mdhavers::{parse, Interpreter};
+
+#[test]
+fn stdlib_template_string_builder_sits_on_a_native_strbuf() {
+    let code = r#"
+fetch "stdlib/template"
+
+ken sb = string_builder()
+sb.append("n=").append_int(-42).append(" x=").append_float(2.5)
+sb.appendln("").append_join([1, 2.5, "three"], ", ")
+blether sb.build()
+blether sb.length()
+ken first = sb.build()
+sb.append("!")
+blether first
+blether sb.tae_string()
+blether sb.clear().is_empty()
+
+ken t = text_table()
+t.set_headers(["name", "age"])
+t.add_row(["Hamish", 42])
+blether t.render()
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    let out = interp.get_output().join("\n");
+    assert_eq!(
+        out.trim(),
+        "Template module loaded! Mak yer strings bonnie!\nn=-42 x=2.5\n1, 2.5, three\n25\n\
+         n=-42 x=2.5\n1, 2.5, three\nn=-42 x=2.5\n1, 2.5, three!\naye\n\
+         +--------+-----+\n | name   | age | \n+--------+-----+\n | Hamish | 42  | \n+--------+-----+"
+    );
+}
+
+#[test]
+fn stdlib_template_strbuf_builtins() {
+    let code = r#"
+ken b = strbuf()
+fer i in 0..5 {
+    strbuf_append_int(b, i)
+}
+strbuf_append(b, [aye, naething])
+blether b
+blether len(b)
+blether whit_kind(b)
+blether strbuf_len(strbuf_clear(b))
+"#;
+
+    let program = parse(code).unwrap();
+    let mut interp = Interpreter::new();
+    interp.interpret(&program).unwrap();
+    assert_eq!(
+        interp.get_output().join("\n"),
+        "01234[aye, naething]\n20\nstrbuf\n0"
+    );
+}